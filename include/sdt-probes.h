@@ -0,0 +1,24 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef PIPEWIRE_SDT_PROBES_H
+#define PIPEWIRE_SDT_PROBES_H
+
+/* Static tracepoints (USDT) for bpftrace, perf and systemtap. A probe is a
+ * single nop in the code, but its arguments are still computed every time
+ * the code runs, also when no tracer is attached. Only pass values that
+ * are at hand anyway. Without sys/sdt.h the probes compile to nothing.
+ *
+ *   bpftrace -e 'usdt:/usr/lib64/libpipewire-0.3.so.0:pipewire:node_process_end
+ *                { @[arg0] = hist(arg2); }'
+ */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define SDT_PROBE(provider,name,...)	STAP_PROBEV(provider, name, ##__VA_ARGS__)
+#else
+#define SDT_PROBE(provider,name,...)	do { } while (0)
+#endif
+
+#endif /* PIPEWIRE_SDT_PROBES_H */
@@ -57,6 +57,7 @@ typedef struct {
 	unsigned int xrun_detected:1;
 	unsigned int hw_params_changed:1;
 	unsigned int negotiated:1;
+	uint32_t signaled;		/* the eventfd was written */
 
 	snd_pcm_uframes_t hw_ptr;
 	snd_pcm_uframes_t boundary;
@@ -88,7 +89,10 @@ typedef struct {
 
 static int snd_pcm_pipewire_stop(snd_pcm_ioplug_t *io);
 
-static int update_active(snd_pcm_ioplug_t *io)
+/* update the eventfd, this is called for every cycle and for every poll
+ * of the application. The eventfd is only written when it was not signaled
+ * yet and only read when it was signaled or when it woke up the poll. */
+static int update_active(snd_pcm_ioplug_t *io, bool polled)
 {
 	snd_pcm_pipewire_t *pw = io->private_data;
 	snd_pcm_sframes_t avail;
@@ -118,10 +122,13 @@ static int update_active(snd_pcm_ioplug_t *io)
 		pw->hw_ptr, io->appl_ptr, active,
 		snd_pcm_state_name(io->state));
 
-	if (active)
-		spa_system_eventfd_write(pw->system, io->poll_fd, 1);
-	else
+	if (active) {
+		if (SPA_ATOMIC_XCHG(pw->signaled, 1) == 0)
+			spa_system_eventfd_write(pw->system, io->poll_fd, 1);
+	} else if (polled || SPA_ATOMIC_LOAD(pw->signaled)) {
 		spa_system_eventfd_read(pw->system, io->poll_fd, &val);
+		SPA_ATOMIC_STORE(pw->signaled, 0);
+	}
 
 	return active;
 }
@@ -168,7 +175,7 @@ static int snd_pcm_pipewire_poll_revents(snd_pcm_ioplug_t *io,
 		return pw->error;
 
 	*revents = pfds[0].revents & ~(POLLIN | POLLOUT);
-	if (pfds[0].revents & POLLIN && update_active(io))
+	if (pfds[0].revents & POLLIN && update_active(io, true))
 		*revents |= (io->stream == SND_PCM_STREAM_PLAYBACK) ? POLLOUT : POLLIN;
 
 	pw_log_trace_fp("poll %d", *revents);
@@ -374,7 +381,7 @@ static void on_stream_state_changed(void *data, enum pw_stream_state old, enum p
 	if (state == PW_STREAM_STATE_ERROR) {
 		pw_log_warn("%s", error);
 		pw->error = -EIO;
-		update_active(&pw->io);
+		update_active(&pw->io, false);
 	}
 }
 
@@ -401,6 +408,8 @@ static void on_stream_process(void *data)
 	delay = pwt.delay;
 	if (pwt.rate.num != 0)
 		delay = delay * io->rate * pwt.rate.num / pwt.rate.denom;
+	/* the samples in the resampler of the stream are in the stream rate */
+	delay += pwt.buffered;
 
 	before = hw_avail = snd_pcm_ioplug_hw_avail(io, pw->hw_ptr, io->appl_ptr);
 
@@ -448,7 +457,7 @@ static void on_stream_process(void *data)
 		}
 	}
 done:
-	update_active(io);
+	update_active(io, false);
 }
 
 static const struct pw_stream_events stream_events = {
@@ -593,7 +602,7 @@ static int snd_pcm_pipewire_stop(snd_pcm_ioplug_t *io)
 	snd_pcm_pipewire_t *pw = io->private_data;
 
 	pw_log_debug("%p: stop", pw);
-	update_active(io);
+	update_active(io, false);
 
 	pw_thread_loop_lock(pw->main_loop);
 	if (pw->activated && pw->stream != NULL) {
@@ -1115,7 +1124,7 @@ static void on_core_error(void *data, uint32_t id, int seq, int res, const char
 	if (id == PW_ID_CORE) {
 		pw->error = res;
 		if (pw->fd != -1)
-			update_active(&pw->io);
+			update_active(&pw->io, false);
 	}
 	pw_thread_loop_signal(pw->main_loop, false);
 }
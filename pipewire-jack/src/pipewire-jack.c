@@ -29,6 +29,7 @@
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
 #include <spa/utils/ringbuffer.h>
+#include <spa/control/ump-utils.h>
 
 #include <pipewire/pipewire.h>
 #include <pipewire/private.h>
@@ -39,6 +40,10 @@
 #include "pipewire/extensions/metadata.h"
 #include "pipewire-jack-extensions.h"
 
+#ifdef HAVE_AUDIOMIXER
+#include "mix-ops.h"
+#endif
+
 #define JACK_DEFAULT_VIDEO_TYPE	"32 bit float RGBA video"
 
 /* use 512KB stack per thread - the default is way too high to be feasible
@@ -79,7 +84,9 @@ PW_LOG_TOPIC_STATIC(jack_log_topic, "jack");
 #define OTHER_CONNECT_FAIL	-1
 #define OTHER_CONNECT_IGNORE	0
 
-#define NOTIFY_BUFFER_SIZE	(1u<<13)
+#define NOTIFY_BUFFER_SIZE	(1u<<16)
+
+#define CPU_LOAD_WINDOW		32
 #define NOTIFY_BUFFER_MASK	(NOTIFY_BUFFER_SIZE-1)
 
 struct notify {
@@ -101,6 +108,13 @@ struct notify {
 	const char *msg;
 };
 
+/* notifications that only need to be delivered once per burst, they are
+ * not queued in the notify ring but collected in client.notify_pending */
+#define NOTIFY_PENDING_BUFFER_FRAMES	(1u<<0)
+#define NOTIFY_PENDING_SAMPLE_RATE	(1u<<1)
+#define NOTIFY_PENDING_CAPTURE_LATENCY	(1u<<2)
+#define NOTIFY_PENDING_PLAYBACK_LATENCY	(1u<<3)
+
 struct client;
 struct port;
 
@@ -123,9 +137,24 @@ static thread_local float midi_scratch[MIDI_SCRATCH_FRAMES];
 #define OBJECT_CHUNK		8
 #define RECYCLE_THRESHOLD	128
 
+/* Hash chains to find objects, see object_reindex(). Each slot has its own
+ * table, the key depends on the object type. */
+#define INDEX_ID		0	/* id */
+#define INDEX_SERIAL		1	/* serial */
+#define INDEX_NAME		2	/* port name, link output port serial */
+#define INDEX_ALIAS1		3	/* port alias1, link input port serial */
+#define INDEX_ALIAS2		4	/* port alias2 */
+#define INDEX_SYSTEM		5	/* port system name */
+#define N_INDEX			6
+#define INDEX_BITS		9
+#define INDEX_SIZE		(1u << INDEX_BITS)
+
 typedef void (*mix_func) (float *dst, float *src[], uint32_t n_src, bool aligned, uint32_t n_samples);
 
 static mix_func mix_function;
+#ifdef HAVE_AUDIOMIXER
+static struct mix_ops mix_ops;
+#endif
 
 struct object {
 	struct spa_list link;
@@ -183,6 +212,9 @@ struct object {
 	unsigned int visible;
 	unsigned int removing:1;
 	unsigned int removed:1;
+
+	struct spa_list index_link[N_INDEX];
+	uint32_t indexed;		/* mask of the linked index_link */
 };
 
 struct midi_buffer {
@@ -266,6 +298,11 @@ struct port {
 
 	void *(*get_buffer) (struct port *p, jack_nframes_t frames);
 
+	/* input of the last get_buffer call, valid for the cycle */
+	void *mix_ptr;
+	uint32_t mix_cycle;
+	uint32_t mix_frames;
+
 	float *emptyptr;
 	float empty[];
 };
@@ -293,6 +330,7 @@ struct context {
 	pthread_mutex_t lock;		/* protects map and lists below, in addition to thread_lock */
 	struct spa_list objects;
 	uint32_t free_count;
+	struct spa_list index[N_INDEX][INDEX_SIZE];
 };
 
 #define GET_DIRECTION(f)	((f) & JackPortIsInput ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT)
@@ -423,8 +461,12 @@ struct client {
 		unsigned int prepared:1;
 		unsigned int first:1;
 		unsigned int thread_entered:1;
+		uint32_t load_count;
+		float load_max;
 	} rt;
 
+	float cpu_load;
+
 	pthread_mutex_t rt_lock;
 	unsigned int rt_locked:1;
 	unsigned int data_locked:1;
@@ -453,6 +495,9 @@ struct client {
 	unsigned int passive_links:1;
 	unsigned int pending_callbacks:1;
 	int frozen_callbacks;
+	uint32_t notify_pending;
+	uint32_t notify_buffer_frames;
+	uint32_t notify_sample_rate;
 	char filter_char;
 	uint32_t max_ports;
 	unsigned int fill_aliases:1;
@@ -493,6 +538,86 @@ int pw_jack_match_rules(const char *rules, size_t size, const struct spa_dict *p
 		int (*matched) (void *data, const char *action, const char *val, int len),
 		void *data);
 
+static inline uint32_t index_hash_int(uint32_t val)
+{
+	return (val * 2654435761u) >> (32 - INDEX_BITS);
+}
+
+static inline uint32_t index_hash_str(const char *str)
+{
+	uint32_t hash = 2166136261u;
+	while (*str) {
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619u;
+	}
+	return index_hash_int(hash);
+}
+
+/* the hash chain of an object for an index slot, NULL when the object has
+ * no key for the slot */
+static struct spa_list *object_index_head(struct client *c, struct object *o, uint32_t slot)
+{
+	const char *str = NULL;
+	uint32_t val;
+
+	switch (slot) {
+	case INDEX_ID:
+		if (o->id == SPA_ID_INVALID)
+			return NULL;
+		val = o->id;
+		break;
+	case INDEX_SERIAL:
+		val = o->serial;
+		break;
+	default:
+		if (o->removed)
+			return NULL;
+		if (o->type == INTERFACE_Port) {
+			str = slot == INDEX_NAME ? o->port.name :
+				slot == INDEX_ALIAS1 ? o->port.alias1 :
+				slot == INDEX_ALIAS2 ? o->port.alias2 : o->port.system;
+			if (str[0] == '\0')
+				return NULL;
+		} else if (o->type == INTERFACE_Link && slot == INDEX_NAME) {
+			val = o->port_link.src_serial;
+		} else if (o->type == INTERFACE_Link && slot == INDEX_ALIAS1) {
+			val = o->port_link.dst_serial;
+		} else {
+			return NULL;
+		}
+		break;
+	}
+	return &c->context.index[slot][str ? index_hash_str(str) : index_hash_int(val)];
+}
+
+static void object_unindex(struct object *o)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_INDEX; i++) {
+		if (SPA_FLAG_IS_SET(o->indexed, 1u << i))
+			spa_list_remove(&o->index_link[i]);
+	}
+	o->indexed = 0;
+}
+
+/* Update the hash chains of an object after its id, serial, names or link
+ * ports changed. Called with the context lock. */
+static void object_reindex(struct client *c, struct object *o)
+{
+	struct spa_list *head;
+	uint32_t i;
+
+	object_unindex(o);
+
+	for (i = 0; i < N_INDEX; i++) {
+		if ((head = object_index_head(c, o, i)) == NULL)
+			continue;
+		spa_list_append(head, &o->index_link[i]);
+		SPA_FLAG_SET(o->indexed, 1u << i);
+	}
+}
+
 static struct object * alloc_object(struct client *c, int type)
 {
 	struct object *o;
@@ -528,6 +653,7 @@ static void recycle_objects(struct client *c, uint32_t remain)
 		if (o->removed) {
 			pw_log_debug("%p: recycle object:%p type:%d id:%u/%u",
 					c, o, o->type, o->id, o->serial);
+			object_unindex(o);
 			spa_list_remove(&o->link);
 			memset(o, 0, sizeof(struct object));
 			spa_list_append(&globals.free_objects, &o->link);
@@ -548,6 +674,7 @@ static void free_object(struct client *c, struct object *o)
 	spa_list_remove(&o->link);
 	o->removed = true;
 	o->id = SPA_ID_INVALID;
+	object_reindex(c, o);
 	spa_list_append(&c->context.objects, &o->link);
 	if (++c->context.free_count > RECYCLE_THRESHOLD)
 		recycle_objects(c, RECYCLE_THRESHOLD / 2);
@@ -674,6 +801,7 @@ static struct mix *create_mix(struct client *c, struct port *port,
 	spa_list_append(&c->mix, &mix->link);
 
 	spa_list_append(&port->mix, &mix->port_link);
+	port->mix_ptr = NULL;
 
 	init_mix(mix, mix_id, port, peer_id);
 
@@ -698,6 +826,7 @@ static int clear_buffers(struct client *c, struct mix *mix)
 	}
 	mix->n_buffers = 0;
 	spa_list_init(&mix->queue);
+	port->mix_ptr = NULL;
 	return 0;
 }
 
@@ -707,6 +836,7 @@ static void free_mix(struct client *c, struct mix *mix)
 
 	clear_buffers(c, mix);
 	spa_list_remove(&mix->port_link);
+	port->mix_ptr = NULL;
 	if (mix->id == SPA_ID_INVALID)
 		port->global_mix = NULL;
 	spa_list_remove(&mix->link);
@@ -750,6 +880,7 @@ static struct port * alloc_port(struct client *c, enum spa_direction direction)
 
 	p->valid = true;
 	p->zeroed = false;
+	p->mix_ptr = NULL;
 	p->client = c;
 	p->object = o;
 	spa_list_init(&p->mix);
@@ -819,19 +950,32 @@ static inline bool client_port_visible(struct client *c, struct object *o)
 	return o->visible;
 }
 
+#define index_for_each(o,c,slot,hash) \
+	spa_list_for_each(o, &(c)->context.index[slot][hash], index_link[slot])
+
 static struct object *find_port_by_name(struct client *c, const char *name)
 {
 	struct object *o;
+	uint32_t hash = index_hash_str(name);
 
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->type != INTERFACE_Port || o->removed ||
-		    (!client_port_visible(c, o)))
-			continue;
-		if (spa_streq(o->port.name, name) ||
-		    spa_streq(o->port.alias1, name) ||
+	index_for_each(o, c, INDEX_NAME, hash) {
+		if (o->type == INTERFACE_Port && client_port_visible(c, o) &&
+		    spa_streq(o->port.name, name))
+			return o;
+	}
+	index_for_each(o, c, INDEX_ALIAS1, hash) {
+		if (o->type == INTERFACE_Port && client_port_visible(c, o) &&
+		    spa_streq(o->port.alias1, name))
+			return o;
+	}
+	index_for_each(o, c, INDEX_ALIAS2, hash) {
+		if (o->type == INTERFACE_Port && client_port_visible(c, o) &&
 		    spa_streq(o->port.alias2, name))
 			return o;
-		if (is_port_default(c, o) && spa_streq(o->port.system, name))
+	}
+	index_for_each(o, c, INDEX_SYSTEM, hash) {
+		if (o->type == INTERFACE_Port && client_port_visible(c, o) &&
+		    is_port_default(c, o) && spa_streq(o->port.system, name))
 			return o;
 	}
 	return NULL;
@@ -840,7 +984,7 @@ static struct object *find_port_by_name(struct client *c, const char *name)
 static struct object *find_by_id(struct client *c, uint32_t id)
 {
 	struct object *o;
-	spa_list_for_each(o, &c->context.objects, link) {
+	index_for_each(o, c, INDEX_ID, index_hash_int(id)) {
 		if (o->id == id)
 			return o;
 	}
@@ -850,7 +994,7 @@ static struct object *find_by_id(struct client *c, uint32_t id)
 static struct object *find_by_serial(struct client *c, uint32_t serial)
 {
 	struct object *o;
-	spa_list_for_each(o, &c->context.objects, link) {
+	index_for_each(o, c, INDEX_SERIAL, index_hash_int(serial)) {
 		if (o->serial == serial)
 			return o;
 	}
@@ -926,6 +1070,14 @@ static void mix_c(float *dst, float *src[], uint32_t n_src, bool aligned, uint32
 	}
 }
 
+#ifdef HAVE_AUDIOMIXER
+/* the audiomixer kernels check the alignment themselves */
+static void mix_audiomixer(float *dst, float *src[], uint32_t n_src, bool aligned, uint32_t n_samples)
+{
+	mix_ops_process(&mix_ops, dst, (const void **)src, n_src, n_samples);
+}
+#endif
+
 SPA_EXPORT
 void jack_get_version(int *major_ptr, int *minor_ptr, int *micro_ptr, int *proto_ptr)
 {
@@ -994,7 +1146,8 @@ jack_get_version_string(void)
 
 #define check_callbacks(c)							\
 ({										\
-	if ((c)->frozen_callbacks == 0 && (c)->pending_callbacks)		\
+	if ((c)->frozen_callbacks == 0 &&					\
+	    ((c)->pending_callbacks || SPA_ATOMIC_LOAD((c)->notify_pending)))	\
 		pw_loop_signal_event((c)->context.nl, (c)->notify_source);	\
  })
 #define thaw_callbacks(c)							\
@@ -1010,10 +1163,12 @@ static void on_notify_event(void *data, uint64_t count)
 	int32_t avail;
 	uint32_t index;
 	struct notify *notify;
+	uint32_t pending;
 	bool do_graph = false, do_recompute_capture = false, do_recompute_playback = false;
 
 	pw_thread_loop_lock(c->context.loop);
-	if (c->frozen_callbacks != 0 || !c->pending_callbacks)
+	if (c->frozen_callbacks != 0 ||
+	    (!c->pending_callbacks && SPA_ATOMIC_LOAD(c->notify_pending) == 0))
 		goto done;
 
 	pw_log_debug("%p: enter active:%u", c, c->active);
@@ -1066,23 +1221,6 @@ static void on_notify_event(void *data, uint64_t count)
 			do_graph = true;
 			do_recompute_capture = do_recompute_playback = true;
 			break;
-		case NOTIFY_TYPE_BUFFER_FRAMES:
-			pw_log_debug("%p: buffer frames %d", c, notify->arg1);
-			if (c->buffer_frames != (uint32_t)notify->arg1) {
-				do_callback_expr(c, c->buffer_frames = notify->arg1,
-						bufsize_callback, c->active,
-						notify->arg1, c->bufsize_arg);
-				do_recompute_capture = do_recompute_playback = true;
-			}
-			break;
-		case NOTIFY_TYPE_SAMPLE_RATE:
-			pw_log_debug("%p: sample rate %d", c, notify->arg1);
-			if (c->sample_rate != (uint32_t)notify->arg1) {
-				do_callback_expr(c, c->sample_rate = notify->arg1,
-						srate_callback, c->active,
-						notify->arg1, c->srate_arg);
-			}
-			break;
 		case NOTIFY_TYPE_FREEWHEEL:
 			pw_log_debug("%p: freewheel %d", c, notify->arg1);
 			do_callback(c, freewheel_callback, c->active,
@@ -1097,17 +1235,6 @@ static void on_notify_event(void *data, uint64_t count)
 			else
 				do_callback(c, shutdown_callback, c->active, c->shutdown_arg);
 			break;
-		case NOTIFY_TYPE_LATENCY:
-			pw_log_debug("%p: latency %d", c, notify->arg1);
-			if (notify->arg1 == JackCaptureLatency)
-				do_recompute_capture = true;
-			else if (notify->arg1 == JackPlaybackLatency)
-				do_recompute_playback = true;
-			break;
-		case NOTIFY_TYPE_TOTAL_LATENCY:
-			pw_log_debug("%p: total latency", c);
-			do_recompute_capture = do_recompute_playback = true;
-			break;
 		default:
 			break;
 		}
@@ -1122,6 +1249,33 @@ static void on_notify_event(void *data, uint64_t count)
 		index += sizeof(struct notify);
 		spa_ringbuffer_read_update(&c->notify_ring, index);
 	}
+
+	/* only the last value of the coalesced notifications is delivered */
+	pending = SPA_ATOMIC_XCHG(c->notify_pending, 0);
+	if (pending & NOTIFY_PENDING_BUFFER_FRAMES) {
+		uint32_t buffer_frames = SPA_ATOMIC_LOAD(c->notify_buffer_frames);
+		pw_log_debug("%p: buffer frames %d", c, buffer_frames);
+		if (c->buffer_frames != buffer_frames) {
+			do_callback_expr(c, c->buffer_frames = buffer_frames,
+					bufsize_callback, c->active,
+					buffer_frames, c->bufsize_arg);
+			do_recompute_capture = do_recompute_playback = true;
+		}
+	}
+	if (pending & NOTIFY_PENDING_SAMPLE_RATE) {
+		uint32_t sample_rate = SPA_ATOMIC_LOAD(c->notify_sample_rate);
+		pw_log_debug("%p: sample rate %d", c, sample_rate);
+		if (c->sample_rate != sample_rate) {
+			do_callback_expr(c, c->sample_rate = sample_rate,
+					srate_callback, c->active,
+					sample_rate, c->srate_arg);
+		}
+	}
+	if (pending & NOTIFY_PENDING_CAPTURE_LATENCY)
+		do_recompute_capture = true;
+	if (pending & NOTIFY_PENDING_PLAYBACK_LATENCY)
+		do_recompute_playback = true;
+
 	if (do_recompute_capture)
 		do_callback(c, latency_callback, c->active, JackCaptureLatency, c->latency_arg);
 	if (do_recompute_playback)
@@ -1140,6 +1294,7 @@ static int queue_notify(struct client *c, int type, struct object *o, int arg1,
 	int32_t filled;
 	uint32_t index;
 	struct notify *notify;
+	uint32_t pending = 0;
 	bool emit = false;
 	int res = 0;
 
@@ -1198,6 +1353,34 @@ static int queue_notify(struct client *c, int type, struct object *o, int arg1,
 		return res;
 	}
 
+	/* these can be queued from the process thread, merge them into the
+	 * pending mask without taking the lock */
+	switch (type) {
+	case NOTIFY_TYPE_BUFFER_FRAMES:
+		SPA_ATOMIC_STORE(c->notify_buffer_frames, (uint32_t)arg1);
+		pending = NOTIFY_PENDING_BUFFER_FRAMES;
+		break;
+	case NOTIFY_TYPE_SAMPLE_RATE:
+		SPA_ATOMIC_STORE(c->notify_sample_rate, (uint32_t)arg1);
+		pending = NOTIFY_PENDING_SAMPLE_RATE;
+		break;
+	case NOTIFY_TYPE_LATENCY:
+		if (arg1 == JackCaptureLatency)
+			pending = NOTIFY_PENDING_CAPTURE_LATENCY;
+		else if (arg1 == JackPlaybackLatency)
+			pending = NOTIFY_PENDING_PLAYBACK_LATENCY;
+		break;
+	case NOTIFY_TYPE_TOTAL_LATENCY:
+		pending = NOTIFY_PENDING_CAPTURE_LATENCY | NOTIFY_PENDING_PLAYBACK_LATENCY;
+		break;
+	}
+	if (pending != 0) {
+		pw_log_debug("%p: pending notify type:%d arg1:%d", c, type, arg1);
+		if ((__atomic_fetch_or(&c->notify_pending, pending, __ATOMIC_SEQ_CST) & pending) != pending)
+			pw_loop_signal_event(c->context.nl, c->notify_source);
+		return res;
+	}
+
 	pthread_mutex_lock(&c->context.lock);
 	filled = spa_ringbuffer_get_write_index(&c->notify_ring, &index);
 	if (filled < 0 || filled + sizeof(struct notify) > NOTIFY_BUFFER_SIZE) {
@@ -1403,36 +1586,51 @@ static size_t convert_from_midi(void *midi, void *buffer, size_t size)
 	return b.state.offset;
 }
 
+static inline uint8_t event_status(struct spa_pod_control *c)
+{
+	switch (c->type) {
+	case SPA_CONTROL_Midi:
+		if (SPA_POD_BODY_SIZE(&c->value) < 1)
+			return 0;
+		return *(uint8_t*)SPA_POD_BODY(&c->value);
+	case SPA_CONTROL_UMP:
+	{
+		uint32_t *ump = SPA_POD_BODY(&c->value);
+
+		if (SPA_POD_BODY_SIZE(&c->value) < 4)
+			return 0;
+		/* MIDI 1.0 and 2.0 channel voice messages */
+		if ((ump[0] >> 28) != 0x2 && (ump[0] >> 28) != 0x4)
+			return 0;
+		return (ump[0] >> 16) & 0xff;
+	}
+	default:
+		return 0;
+	}
+}
+
 static inline int event_sort(struct spa_pod_control *a, struct spa_pod_control *b)
 {
+	/* 11 (controller) > 12 (program change) >
+	 * 8 (note off) > 9 (note on) > 10 (aftertouch) >
+	 * 13 (channel pressure) > 14 (pitch bend) */
+	static const int priotab[] = { 5,4,3,7,6,2,1,0 };
+	uint8_t sa, sb;
+
 	if (a->offset < b->offset)
 		return -1;
 	if (a->offset > b->offset)
 		return 1;
 	if (a->type != b->type)
 		return 0;
-	switch(a->type) {
-	case SPA_CONTROL_Midi:
-	{
-		/* 11 (controller) > 12 (program change) >
-		 * 8 (note off) > 9 (note on) > 10 (aftertouch) >
-		 * 13 (channel pressure) > 14 (pitch bend) */
-		static int priotab[] = { 5,4,3,7,6,2,1,0 };
-		uint8_t *da, *db;
-
-		if (SPA_POD_BODY_SIZE(&a->value) < 1 ||
-		    SPA_POD_BODY_SIZE(&b->value) < 1)
-			return 0;
+	if (a->type != SPA_CONTROL_Midi && a->type != SPA_CONTROL_UMP)
+		return 0;
 
-		da = SPA_POD_BODY(&a->value);
-		db = SPA_POD_BODY(&b->value);
-		if ((da[0] & 0xf) != (db[0] & 0xf))
-			return 0;
-		return priotab[(db[0]>>4) & 7] - priotab[(da[0]>>4) & 7];
-	}
-	default:
+	sa = event_status(a);
+	sb = event_status(b);
+	if ((sa & 0xf) != (sb & 0xf))
 		return 0;
-	}
+	return priotab[(sb>>4) & 7] - priotab[(sa>>4) & 7];
 }
 
 static inline void fix_midi_event(uint8_t *data, size_t size)
@@ -1496,6 +1694,18 @@ static void convert_to_midi(struct spa_pod_sequence **seq, uint32_t n_seq, void
 						spa_strerror(res));
 			break;
 		}
+		case SPA_CONTROL_UMP:
+		{
+			uint8_t data[16];
+
+			if ((res = spa_ump_to_midi(SPA_POD_BODY(&next->value),
+					SPA_POD_BODY_SIZE(&next->value), data, sizeof(data))) <= 0)
+				break;
+			if ((res = midi_event_write(midi, next->offset, data, res, fix)) < 0)
+				pw_log_warn("midi %p: can't write event: %s", midi,
+						spa_strerror(res));
+			break;
+		}
 		}
 		c[next_index] = spa_pod_control_next(c[next_index]);
 	}
@@ -1799,6 +2009,44 @@ static inline int check_sample_rate(struct client *c, struct spa_io_position *po
 	return c->sample_rate == sample_rate;
 }
 
+/* Like jackd, the reported load is the running average of the maximum
+ * graph load in a window of cycles. */
+static inline void update_cpu_load(struct client *c, struct pw_node_activation *driver)
+{
+	c->rt.load_max = SPA_MAX(c->rt.load_max, driver->cpu_load[0]);
+	if (++c->rt.load_count < CPU_LOAD_WINDOW)
+		return;
+	c->cpu_load = (c->cpu_load + c->rt.load_max * 100.0f) / 2.0f;
+	c->rt.load_max = 0.0f;
+	c->rt.load_count = 0;
+}
+
+/* The load of this client, the time between wakeup and finish against
+ * the cycle time, averaged the same way as the driver load. */
+static inline void update_dsp_load(struct client *c, uint64_t nsec)
+{
+	struct pw_node_activation *a = c->activation;
+	struct spa_io_position *pos = c->rt.position;
+	uint64_t period;
+	float load;
+
+	/* the server keeps the load of drivers */
+	if (SPA_UNLIKELY(a == c->rt.driver_activation))
+		return;
+	if (SPA_UNLIKELY(pos == NULL || pos->clock.rate.denom == 0 || nsec < a->awake_time))
+		return;
+
+	period = pos->clock.duration * SPA_NSEC_PER_SEC * pos->clock.rate.num /
+		pos->clock.rate.denom;
+	if (SPA_UNLIKELY(period == 0))
+		return;
+
+	load = (float)(nsec - a->awake_time) / (float)period;
+	a->cpu_load[0] = (a->cpu_load[0] + load) / 2.0f;
+	a->cpu_load[1] = (a->cpu_load[1] * 7.0f + load) / 8.0f;
+	a->cpu_load[2] = (a->cpu_load[2] * 31.0f + load) / 32.0f;
+}
+
 static inline uint32_t cycle_run(struct client *c)
 {
 	uint64_t cmd;
@@ -1860,6 +2108,8 @@ static inline uint32_t cycle_run(struct client *c)
 		    c->xrun_count != 0 && c->xrun_callback))
 			c->xrun_callback(c->xrun_arg);
 		c->xrun_count = driver->xrun_count;
+
+		update_cpu_load(c, driver);
 	}
 	pw_log_trace_fp("%p: wait %"PRIu64" frames:%d rate:%d pos:%d delay:%"PRIi64" corr:%f", c,
 			activation->awake_time, c->buffer_frames, c->sample_rate,
@@ -1946,6 +2196,7 @@ static inline void signal_sync(struct client *c)
 	complete_process(c, c->buffer_frames);
 
 	nsec = get_time_ns(c->l->system);
+	update_dsp_load(c, nsec);
 	old_status = SPA_ATOMIC_XCHG(activation->status, PW_NODE_ACTIVATION_FINISHED);
 	activation->finish_time = nsec;
 
@@ -2808,6 +3059,10 @@ static int client_node_port_use_buffers(void *data,
 	/* clear previous buffers */
 	clear_buffers(c, mix);
 
+	/* The buffers of a link are shared between the output and the input
+	 * mix, the input mix maps the memory the peer writes into. An input
+	 * with only one link returns this memory from jack_port_get_buffer()
+	 * without a copy, see get_buffer_input_float(). */
 	for (i = 0; i < n_buffers; i++) {
 		off_t offset;
 		struct spa_buffer *buf;
@@ -3503,6 +3758,32 @@ static const struct pw_port_events port_events = {
 	.param = port_param,
 };
 
+/* bind a port of another client to receive its latency params, this is
+ * done lazily so that clients don't keep a proxy for every port in the
+ * graph. Returns 1 when a new proxy was created and a sync is needed.
+ * called with thread-loop lock */
+static int port_bind(struct client *c, struct object *o)
+{
+	uint32_t ids[1] = { SPA_PARAM_Latency };
+
+	if (o->proxy != NULL || o->removed || o->id == SPA_ID_INVALID)
+		return 0;
+
+	o->proxy = pw_registry_bind(c->registry,
+			o->id, PW_TYPE_INTERFACE_Port, PW_VERSION_PORT, 0);
+	if (o->proxy == NULL)
+		return -errno;
+
+	pw_proxy_add_listener(o->proxy,
+			&o->proxy_listener, &proxy_events, o);
+	pw_proxy_add_object_listener(o->proxy,
+			&o->object_listener, &port_events, o);
+
+	if (type_is_dsp(o->port.type_id))
+		pw_port_subscribe_params((struct pw_port*)o->proxy, ids, 1);
+	return 1;
+}
+
 #define FILTER_NAME	" ()[].:*$"
 #define FILTER_PORT	" ()[].*$"
 
@@ -3687,21 +3968,8 @@ static void registry_event_global(void *data, uint32_t id,
 
 			do_emit = node_is_active(c, ot);
 
-			o->proxy = pw_registry_bind(c->registry,
-				id, type, PW_VERSION_PORT, 0);
-			if (o->proxy) {
-				uint32_t ids[1] = { SPA_PARAM_Latency };
-
-				pw_proxy_add_listener(o->proxy,
-						&o->proxy_listener, &proxy_events, o);
-				pw_proxy_add_object_listener(o->proxy,
-						&o->object_listener, &port_events, o);
-
-				if (type_is_dsp(type_id))
-					pw_port_subscribe_params((struct pw_port*)o->proxy,
-							ids, 1);
-				do_sync = true;
-			}
+			/* the port is only bound when its latency is queried,
+			 * see port_bind() */
 			pthread_mutex_lock(&c->context.lock);
 			spa_list_append(&c->context.objects, &o->link);
 			pthread_mutex_unlock(&c->context.lock);
@@ -3840,8 +4108,11 @@ static void registry_event_global(void *data, uint32_t id,
 		goto exit;
 	}
 
+	pthread_mutex_lock(&c->context.lock);
 	o->id = id;
 	o->serial = serial;
+	object_reindex(c, o);
+	pthread_mutex_unlock(&c->context.lock);
 
 	switch (o->type) {
 	case INTERFACE_Node:
@@ -3970,7 +4241,7 @@ jack_client_t * jack_client_open (const char *client_name,
 {
 	struct client *client;
 	const struct spa_support *support;
-	uint32_t n_support;
+	uint32_t i, j, n_support;
 	const char *str;
 	struct spa_cpu *cpu_iface;
 	const struct pw_properties *props;
@@ -3997,6 +4268,9 @@ jack_client_t * jack_client_open (const char *client_name,
 
 	pthread_mutex_init(&client->context.lock, NULL);
 	spa_list_init(&client->context.objects);
+	for (i = 0; i < N_INDEX; i++)
+		for (j = 0; j < INDEX_SIZE; j++)
+			spa_list_init(&client->context.index[i][j]);
 
 	client->node_id = SPA_ID_INVALID;
 
@@ -4076,6 +4350,17 @@ jack_client_t * jack_client_open (const char *client_name,
 			mix_function = mix_sse;
 #endif
 	}
+#ifdef HAVE_AUDIOMIXER
+	if (mix_ops.process == NULL) {
+		mix_ops.fmt = SPA_AUDIO_FORMAT_F32;
+		mix_ops.n_channels = 1;
+		mix_ops.cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
+		if (mix_ops_init(&mix_ops) < 0)
+			spa_zero(mix_ops);
+	}
+	if (mix_ops.process != NULL)
+		mix_function = mix_audiomixer;
+#endif
 	client->context.old_thread_utils =
 		pw_context_get_object(client->context.context,
 				SPA_TYPE_INTERFACE_ThreadUtils);
@@ -5112,8 +5397,10 @@ float jack_cpu_load (jack_client_t *client)
 
 	return_val_if_fail(c != NULL, 0.0);
 
-	if (c->driver_activation)
-		res = c->driver_activation->cpu_load[0] * 100.0f;
+	if (c->active)
+		res = c->cpu_load;
+	else if (c->driver_activation)
+		res = c->driver_activation->cpu_load[1] * 100.0f;
 
 	pw_log_trace("%p: cpu load %f", client, res);
 	return res;
@@ -5191,6 +5478,10 @@ jack_port_t * jack_port_register (jack_client_t *client,
 	strcpy(o->port.name, name);
 	o->port.type_id = type_id;
 
+	pthread_mutex_lock(&c->context.lock);
+	object_reindex(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+
 	init_buffer(p, c->max_frames);
 
 	if (direction == SPA_DIRECTION_INPUT) {
@@ -5390,19 +5681,28 @@ static inline void *get_buffer_data(struct buffer *b, jack_nframes_t frames)
 	return SPA_PTROFF(d->data, offset, void);
 }
 
+/* The mixed input is kept for the rest of the cycle, clients that get the
+ * buffer more than once don't mix again. Inputs connected to an output of
+ * the same client can change during the cycle and are not kept. */
 static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 {
 	struct mix *mix;
 	struct buffer *b;
 	void *ptr = NULL;
 	float *mix_ptr[MAX_MIX], *np;
-	uint32_t n_ptr = 0;
-	bool ptr_aligned = true;
+	uint32_t n_ptr = 0, cycle = p->client->rt.position->clock.cycle;
+	bool ptr_aligned = true, cache = true;
+
+	if (p->mix_ptr != NULL && p->mix_cycle == cycle && p->mix_frames == frames)
+		return p->mix_ptr;
 
 	spa_list_for_each(mix, &p->mix, port_link) {
 		if (mix->id == SPA_ID_INVALID)
 			continue;
 
+		if (mix->peer_port != NULL)
+			cache = false;
+
 		pw_log_trace_fp("%p: port %s mix %d.%d get buffer %d",
 				p->client, p->object->port.name, p->port_id, mix->id, frames);
 
@@ -5428,6 +5728,10 @@ static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 	}
 	if (ptr == NULL)
 		ptr = init_buffer(p, frames);
+
+	p->mix_ptr = cache ? ptr : NULL;
+	p->mix_cycle = cycle;
+	p->mix_frames = frames;
 	return ptr;
 }
 
@@ -5741,19 +6045,20 @@ const char ** jack_port_get_all_connections (const jack_client_t *client,
 	pw_array_init(&tmp, sizeof(void*) * 32);
 
 	pthread_mutex_lock(&c->context.lock);
-	spa_list_for_each(l, &c->context.objects, link) {
-		if (l->type != INTERFACE_Link || l->removed)
+	index_for_each(l, c, INDEX_NAME, index_hash_int(o->serial)) {
+		if (l->type != INTERFACE_Link || l->port_link.src_serial != o->serial)
 			continue;
-		if (l->port_link.src_serial == o->serial)
-			p = find_type(c, l->port_link.dst, INTERFACE_Port, true);
-		else if (l->port_link.dst_serial == o->serial)
-			p = find_type(c, l->port_link.src, INTERFACE_Port, true);
-		else
+		if ((p = find_type(c, l->port_link.dst, INTERFACE_Port, true)) == NULL)
 			continue;
-
-		if (p == NULL)
+		pw_array_add_ptr(&tmp, (void*)port_name(p));
+		count++;
+	}
+	index_for_each(l, c, INDEX_ALIAS1, index_hash_int(o->serial)) {
+		if (l->type != INTERFACE_Link || l->port_link.dst_serial != o->serial ||
+		    l->port_link.src_serial == o->serial)
+			continue;
+		if ((p = find_type(c, l->port_link.src, INTERFACE_Port, true)) == NULL)
 			continue;
-
 		pw_array_add_ptr(&tmp, (void*)port_name(p));
 		count++;
 	}
@@ -5831,7 +6136,11 @@ int jack_port_rename (jack_client_t* client, jack_port_t *port, const char *port
 	}
 
 	pw_properties_set(p->props, PW_KEY_PORT_NAME, port_name);
+
+	pthread_mutex_lock(&c->context.lock);
 	snprintf(o->port.name, sizeof(o->port.name), "%s:%s", c->name, port_name);
+	object_reindex(c, o);
+	pthread_mutex_unlock(&c->context.lock);
 
 	p->info.change_mask |= SPA_PORT_CHANGE_MASK_PROPS;
 	p->info.props = &p->props->dict;
@@ -5887,6 +6196,10 @@ int jack_port_set_alias (jack_port_t *port, const char *alias)
 		goto done;
 	}
 
+	pthread_mutex_lock(&c->context.lock);
+	object_reindex(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+
 	pw_properties_set(p->props, key, alias);
 
 	p->info.change_mask |= SPA_PORT_CHANGE_MASK_PROPS;
@@ -6313,6 +6626,13 @@ void jack_port_get_latency_range (jack_port_t *port, jack_latency_callback_mode_
 		return;
 	}
 
+	if (o->port.port == NULL || o->port.port->client != c) {
+		pw_thread_loop_lock(c->context.loop);
+		if (port_bind(c, o) > 0)
+			do_sync(c);
+		pw_thread_loop_unlock(c->context.loop);
+	}
+
 	if (mode == JackCaptureLatency)
 		direction = SPA_DIRECTION_OUTPUT;
 	else
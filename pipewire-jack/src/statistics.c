@@ -13,7 +13,7 @@ float jack_get_max_delayed_usecs (jack_client_t *client)
 	spa_return_val_if_fail(c != NULL, 0.0);
 
 	if (c->driver_activation)
-		res = (float)c->driver_activation->max_delay / SPA_USEC_PER_SEC;
+		res = (float)c->driver_activation->max_delay;
 
 	pw_log_trace("%p: max delay %f", client, res);
 	return res;
@@ -28,7 +28,7 @@ float jack_get_xrun_delayed_usecs (jack_client_t *client)
 	spa_return_val_if_fail(c != NULL, 0.0);
 
 	if (c->driver_activation)
-		res = (float)c->driver_activation->xrun_delay / SPA_USEC_PER_SEC;
+		res = (float)c->driver_activation->xrun_delay;
 
 	pw_log_trace("%p: xrun delay %f", client, res);
 	return res;
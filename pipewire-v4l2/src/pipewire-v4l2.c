@@ -16,6 +16,7 @@
 #include <pthread.h>
 #include <limits.h>
 #include <linux/videodev2.h>
+#include <linux/dma-buf.h>
 
 #include "pipewire-v4l2.h"
 
@@ -1293,7 +1294,8 @@ static void on_stream_param_changed(void *data, uint32_t id, const struct spa_po
 			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
 			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(size, 0, INT_MAX),
 			SPA_PARAM_BUFFERS_stride,  SPA_POD_CHOICE_RANGE_Int(stride, 0, INT_MAX),
-			SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int((1<<SPA_DATA_MemFd)));
+			SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int((1<<SPA_DATA_MemFd) |
+							(1<<SPA_DATA_DmaBuf)));
 
 
 	pw_stream_update_params(file->stream, params, n_params);
@@ -1939,6 +1941,23 @@ exit_unlock:
 	return res;
 }
 
+/* DMABUF memory that is mapped by the application must be bracketed with
+ * sync calls so that the CPU sees the data written by the device */
+static void buffer_sync(struct buffer *buf, uint64_t flags)
+{
+	struct spa_data *d = &buf->buf->buffer->datas[0];
+	struct dma_buf_sync sync;
+
+	if (d->type != SPA_DATA_DmaBuf ||
+	    !SPA_FLAG_IS_SET(buf->v4l2.flags, V4L2_BUF_FLAG_MAPPED))
+		return;
+
+	spa_zero(sync);
+	sync.flags = flags | DMA_BUF_SYNC_READ;
+	if (globals.old_fops.ioctl(d->fd, DMA_BUF_IOCTL_SYNC, &sync) < 0)
+		pw_log_debug("fd:%"PRIi64" sync failed: %m", d->fd);
+}
+
 static int vidioc_qbuf(struct file *file, struct v4l2_buffer *arg)
 {
 	int res = 0;
@@ -1961,6 +1980,8 @@ static int vidioc_qbuf(struct file *file, struct v4l2_buffer *arg)
 		goto exit;
 	}
 
+	buffer_sync(buf, DMA_BUF_SYNC_END);
+
 	SPA_FLAG_SET(buf->v4l2.flags, V4L2_BUF_FLAG_QUEUED);
 	arg->flags = buf->v4l2.flags;
 
@@ -2029,6 +2050,8 @@ static int vidioc_dqbuf(struct file *file, int fd, struct v4l2_buffer *arg)
 	buf->v4l2.sequence = file->sequence++;
 	*arg = buf->v4l2;
 
+	buffer_sync(buf, DMA_BUF_SYNC_START);
+
 exit_unlock:
 	pw_log_debug("file:%d (%d) %d -> %d (%s)", file->fd, fd,
 			arg->index, res, spa_strerror(res));
@@ -2036,6 +2059,48 @@ exit_unlock:
 	return res;
 }
 
+static int vidioc_expbuf(struct file *file, struct v4l2_exportbuffer *arg)
+{
+	int res;
+	struct spa_data *d;
+
+	if (arg->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
+		return -EINVAL;
+	if (arg->plane != 0)
+		return -EINVAL;
+	if (arg->flags & ~(O_CLOEXEC | O_ACCMODE))
+		return -EINVAL;
+
+	pw_thread_loop_lock(file->loop);
+	if (arg->index >= file->n_buffers) {
+		res = -EINVAL;
+		goto exit_unlock;
+	}
+	d = &file->buffers[arg->index].buf->buffer->datas[0];
+
+	/* the exported fd is mapped from offset 0 by the application, memfd
+	 * buffers that are packed in one shared memfd can't be exported */
+	if (d->fd < 0 || d->mapoffset != 0) {
+		res = -EINVAL;
+		goto exit_unlock;
+	}
+	res = fcntl(d->fd, (arg->flags & O_CLOEXEC) ? F_DUPFD_CLOEXEC : F_DUPFD, 0);
+	if (res < 0) {
+		res = -errno;
+		goto exit_unlock;
+	}
+	arg->fd = res;
+	memset(arg->reserved, 0, sizeof(arg->reserved));
+	res = 0;
+
+	pw_log_info("file:%d id:%u fd:%"PRIi64" type:%u -> %d", file->fd,
+			arg->index, d->fd, d->type, arg->fd);
+
+exit_unlock:
+	pw_thread_loop_unlock(file->loop);
+	return res;
+}
+
 static int vidioc_streamon(struct file *file, int *arg)
 {
 	int res;
@@ -2417,6 +2482,9 @@ static int v4l2_ioctl(int fd, unsigned long int request, void *arg)
 	case VIDIOC_DQBUF:
 		res = vidioc_dqbuf(file, fd, (struct v4l2_buffer *)arg);
 		break;
+	case VIDIOC_EXPBUF:
+		res = vidioc_expbuf(file, (struct v4l2_exportbuffer *)arg);
+		break;
 	case VIDIOC_STREAMON:
 		res = vidioc_streamon(file, (int *)arg);
 		break;
@@ -0,0 +1,63 @@
+/* Spa cache directory */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef SPA_PRIVATE_CACHE_DIR_H
+#define SPA_PRIVATE_CACHE_DIR_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * Get the PipeWire cache directory, $XDG_CACHE_HOME/pipewire or
+ * $HOME/.cache/pipewire, with \a subdir appended when not NULL. Relative
+ * values of the variables are ignored.
+ *
+ * With \a create, the missing directories of the path are made.
+ *
+ * \return 0 on success, -ENOENT when there is no cache directory or
+ *    -ENAMETOOLONG when \a path is too small
+ */
+static inline int get_pipewire_cache_dir(char *path, size_t size,
+		const char *subdir, bool create)
+{
+	const char *dir, *suffix;
+	char *p;
+	int len;
+
+	if ((dir = getenv("XDG_CACHE_HOME")) != NULL && dir[0] == '/')
+		suffix = "";
+	else if ((dir = getenv("HOME")) != NULL && dir[0] == '/')
+		suffix = "/.cache";
+	else
+		return -ENOENT;
+
+	len = snprintf(path, size, "%s%s/pipewire%s%s", dir, suffix,
+			subdir ? "/" : "", subdir ? subdir : "");
+	if (len < 0 || (size_t)len >= size)
+		return -ENAMETOOLONG;
+
+	if (!create)
+		return 0;
+
+	for (p = strchr(path + 1, '/'); ; p = strchr(p + 1, '/')) {
+		if (p != NULL)
+			*p = '\0';
+		if (mkdir(path, 0700) < 0 && errno != EEXIST) {
+			int res = -errno;
+			if (p != NULL)
+				*p = '/';
+			return res;
+		}
+		if (p == NULL)
+			break;
+		*p = '/';
+	}
+	return 0;
+}
+
+#endif /* SPA_PRIVATE_CACHE_DIR_H */
@@ -167,8 +167,19 @@ struct spa_meta_videotransform {
  *
  * Metadata to describe the time on the timeline when the buffer
  * can be acquired and when it can be reused.
+ *
+ * The buffer has two extra datas of type SPA_DATA_SyncObj after the
+ * memory datas. The first one is the acquire timeline and the second
+ * one the release timeline, they can refer to the same syncobj.
  */
 struct spa_meta_sync_timeline {
+#define SPA_META_SYNC_TIMELINE_UNSCHEDULED_RELEASE	(1 << 0)	/**< the release point was not yet
+								  *  scheduled by the consumer. The producer
+								  *  sets this flag and the consumer clears it
+								  *  when it will signal the release point. When
+								  *  the flag is still set when the buffer is
+								  *  recycled, the producer can reuse the buffer
+								  *  without waiting for the release point. */
 	uint32_t flags;
 	uint32_t padding;
 	uint64_t acquire_point;			/**< the timeline acquire point, this is when the data
@@ -27,6 +27,9 @@ enum spa_control_type {
 	SPA_CONTROL_Properties,		/**< data contains a SPA_TYPE_OBJECT_Props */
 	SPA_CONTROL_Midi,		/**< data contains a spa_pod_bytes with raw midi data */
 	SPA_CONTROL_OSC,		/**< data contains a spa_pod_bytes with an OSC packet */
+	SPA_CONTROL_UMP,		/**< data contains a spa_pod_bytes with one UMP
+					  *  (Universal MIDI Packet) message in 32 bit
+					  *  words of host endianness */
 
 	_SPA_CONTROL_LAST,		/**< not part of ABI */
 };
@@ -0,0 +1,240 @@
+/* Simple Plugin API */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef SPA_CONTROL_UMP_UTILS_H
+#define SPA_CONTROL_UMP_UTILS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <spa/utils/defs.h>
+
+/**
+ * \addtogroup spa_control
+ * \{
+ */
+
+/** the size in 32 bit words of a UMP message of \a type */
+static inline size_t spa_ump_message_size(uint8_t message_type)
+{
+	static const uint32_t ump_sizes[] = {
+		[0x0] = 1, /* Utility messages */
+		[0x1] = 1, /* System messages */
+		[0x2] = 1, /* MIDI 1.0 messages */
+		[0x3] = 2, /* 7bit SysEx messages */
+		[0x4] = 2, /* MIDI 2.0 messages */
+		[0x5] = 4, /* 8bit data message */
+		[0x6] = 1,
+		[0x7] = 1,
+		[0x8] = 2,
+		[0x9] = 2,
+		[0xa] = 2,
+		[0xb] = 3,
+		[0xc] = 3,
+		[0xd] = 4, /* Flexible data messages */
+		[0xe] = 4,
+		[0xf] = 4, /* Stream messages */
+	};
+	return ump_sizes[message_type & 0xf];
+}
+
+static inline size_t spa_ump_midi_status_size(uint8_t status)
+{
+	switch (status & 0xf0) {
+	case 0xc0:
+	case 0xd0:
+		return 2;
+	case 0xf0:
+		switch (status) {
+		case 0xf1:
+		case 0xf3:
+			return 2;
+		case 0xf2:
+			return 3;
+		default:
+			return 1;
+		}
+	default:
+		return 3;
+	}
+}
+
+/**
+ * Convert one UMP message to MIDI 1.0 bytes.
+ *
+ * MIDI 2.0 channel voice messages are scaled down to MIDI 1.0, 7bit SysEx
+ * packets produce the part of the SysEx message they carry.
+ *
+ * \param ump the UMP message
+ * \param ump_size the size of \a ump in bytes
+ * \param midi the destination
+ * \param midi_maxsize the size of \a midi
+ * \return the number of bytes written to \a midi, 0 when the message has no
+ *	MIDI 1.0 equivalent or < 0 on error.
+ */
+static inline int spa_ump_to_midi(const uint32_t *ump, size_t ump_size,
+		uint8_t *midi, size_t midi_maxsize)
+{
+	int size = 0;
+	uint8_t status;
+
+	if (ump_size < 4)
+		return -EINVAL;
+	if (ump_size < spa_ump_message_size(ump[0] >> 28) * 4)
+		return -EINVAL;
+	if (midi_maxsize < 8)
+		return -ENOSPC;
+
+	status = (ump[0] >> 16) & 0xff;
+
+	switch (ump[0] >> 28) {
+	case 0x1: /* System Real Time and System Common */
+		midi[size++] = status;
+		switch (spa_ump_midi_status_size(status)) {
+		case 3:
+			midi[size++] = (ump[0] >> 8) & 0x7f;
+			SPA_FALLTHROUGH;
+		case 2:
+			midi[size++] = ump[0] & 0x7f;
+			break;
+		}
+		break;
+	case 0x2: /* MIDI 1.0 Channel Voice */
+		midi[size++] = status;
+		midi[size++] = (ump[0] >> 8) & 0x7f;
+		if (spa_ump_midi_status_size(status) == 3)
+			midi[size++] = ump[0] & 0x7f;
+		break;
+	case 0x3: /* 7bit SysEx */
+	{
+		uint8_t i, n_bytes = SPA_MIN((ump[0] >> 16) & 0xf, 6u);
+		uint8_t kind = (ump[0] >> 20) & 0xf;
+
+		if (kind == 0 || kind == 1)
+			midi[size++] = 0xf0;
+		for (i = 0; i < n_bytes; i++)
+			midi[size++] = ump[(i + 2) / 4] >> ((5 - i) % 4 * 8);
+		if (kind == 0 || kind == 3)
+			midi[size++] = 0xf7;
+		break;
+	}
+	case 0x4: /* MIDI 2.0 Channel Voice */
+		midi[size++] = status;
+		switch (status & 0xf0) {
+		case 0x80:
+		case 0x90:
+			midi[size++] = (ump[0] >> 8) & 0x7f;
+			midi[size++] = ump[1] >> 25;
+			/* a MIDI 2.0 note on with velocity 0 is not a note off */
+			if ((status & 0xf0) == 0x90 && midi[size-1] == 0)
+				midi[size-1] = 1;
+			break;
+		case 0xa0:
+		case 0xb0:
+			midi[size++] = (ump[0] >> 8) & 0x7f;
+			midi[size++] = ump[1] >> 25;
+			break;
+		case 0xc0:
+			midi[size++] = (ump[1] >> 24) & 0x7f;
+			break;
+		case 0xd0:
+			midi[size++] = ump[1] >> 25;
+			break;
+		case 0xe0:
+			midi[size++] = (ump[1] >> 18) & 0x7f;
+			midi[size++] = ump[1] >> 25;
+			break;
+		default:
+			/* registered and per-note controllers */
+			return 0;
+		}
+		break;
+	default:
+		return 0;
+	}
+	return size;
+}
+
+/**
+ * Convert a MIDI 1.0 message to UMP.
+ *
+ * Channel voice and system messages produce one MIDI 1.0 UMP message, a
+ * SysEx message produces as many 7bit SysEx packets as needed.
+ *
+ * \param midi the MIDI message
+ * \param midi_size the size of \a midi
+ * \param ump the destination
+ * \param ump_maxsize the size of \a ump in bytes
+ * \param group the UMP group
+ * \return the number of bytes written to \a ump or < 0 on error.
+ */
+static inline int spa_ump_from_midi(const uint8_t *midi, size_t midi_size,
+		uint32_t *ump, size_t ump_maxsize, uint8_t group)
+{
+	uint32_t prefix = (uint32_t)(group & 0xf) << 24;
+	size_t i, n_words = 0;
+
+	if (midi_size < 1)
+		return -EINVAL;
+
+	if (midi[0] == 0xf0 || midi[0] == 0xf7) {
+		/* SysEx, without the 0xf0 and 0xf7 framing */
+		bool start = midi[0] == 0xf0, end;
+
+		midi++;
+		midi_size--;
+		if (midi_size > 0 && midi[midi_size-1] == 0xf7) {
+			midi_size--;
+			end = true;
+		} else {
+			end = false;
+		}
+		do {
+			uint8_t n_bytes = SPA_MIN(midi_size, 6u), kind;
+
+			if (ump_maxsize < (n_words + 2) * 4)
+				return -ENOSPC;
+
+			if (midi_size <= 6 && end)
+				kind = start ? 0 : 3;
+			else
+				kind = start ? 1 : 2;
+
+			ump[n_words] = 0x30000000 | prefix | (kind << 20) | (n_bytes << 16);
+			ump[n_words+1] = 0;
+			for (i = 0; i < n_bytes; i++)
+				ump[n_words + (i + 2) / 4] |= (uint32_t)(midi[i] & 0x7f) << ((5 - i) % 4 * 8);
+
+			n_words += 2;
+			midi += n_bytes;
+			midi_size -= n_bytes;
+			start = false;
+		} while (midi_size > 0);
+	} else {
+		size_t size = SPA_MIN(midi_size, spa_ump_midi_status_size(midi[0]));
+
+		if (ump_maxsize < 4)
+			return -ENOSPC;
+
+		ump[0] = prefix | ((midi[0] >= 0xf0 ? 0x1u : 0x2u) << 28) | (midi[0] << 16);
+		if (size > 1)
+			ump[0] |= (midi[1] & 0x7f) << 8;
+		if (size > 2)
+			ump[0] |= midi[2] & 0x7f;
+		n_words = 1;
+	}
+	return n_words * 4;
+}
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* SPA_CONTROL_UMP_UTILS_H */
@@ -41,6 +41,8 @@ enum spa_io_type {
 	SPA_IO_RateMatch,	/**< rate matching between nodes, struct spa_io_rate_match */
 	SPA_IO_Memory,		/**< memory pointer, struct spa_io_memory (currently not used in PipeWire) */
 	SPA_IO_AsyncBuffers,	/**< async area to exchange buffers, struct spa_io_async_buffers */
+	SPA_IO_Volumes,		/**< volume updates, struct spa_io_volumes */
+	SPA_IO_Meter,		/**< peak and RMS levels, struct spa_io_meter */
 };
 
 /**
@@ -314,6 +316,55 @@ struct spa_io_async_buffers {
 						  *  readers read from (cycle)&1 */
 };
 
+#define SPA_IO_VOLUMES_MAX_CHANNELS	64u
+
+/**
+ * Volume updates without parameters.
+ *
+ * The writer fills in values[(seq + 1) & 1] and then increments
+ * \a seq. The reader applies values[seq & 1] when \a seq changed since the
+ * last cycle. After copying the values, the reader checks \a seq again,
+ * after an acquire fence. When it changed, the copy might be torn and
+ * the reader should try again in the next cycle.
+ */
+struct spa_io_volumes {
+	uint32_t seq;				/**< incremented after each update */
+	uint32_t padding[3];
+	struct spa_io_volumes_values {
+#define SPA_IO_VOLUMES_FLAG_MUTE	(1 << 0)
+		uint32_t flags;			/**< extra flags */
+		float volume;			/**< volume of all channels */
+		uint32_t n_volumes;		/**< number of channel volumes */
+		uint32_t padding;
+		float volumes[SPA_IO_VOLUMES_MAX_CHANNELS];	/**< channel volumes */
+	} values[2];
+};
+
+#define SPA_IO_METER_MAX_CHANNELS	64u
+
+/**
+ * Peak and RMS levels of each cycle.
+ *
+ * The node fills in values[(seq + 1) & 1] and then increments \a seq.
+ * A reader copies values[seq & 1] and checks that \a seq did not change
+ * while copying, otherwise the values might have been overwritten and the
+ * reader should try again.
+ *
+ * The area contains no pointers so that it can be placed in shared memory
+ * and read by other processes without running a stream.
+ */
+struct spa_io_meter {
+	uint32_t seq;				/**< incremented after each update */
+	uint32_t padding[3];
+	struct spa_io_meter_values {
+		uint64_t position;		/**< clock position of the cycle */
+		uint32_t n_samples;		/**< number of measured samples */
+		uint32_t n_channels;		/**< number of channel levels */
+		float peak[SPA_IO_METER_MAX_CHANNELS];	/**< absolute peak of each channel */
+		float rms[SPA_IO_METER_MAX_CHANNELS];	/**< RMS level of each channel */
+	} values[2];
+};
+
 /**
  * \}
  */
@@ -62,6 +62,9 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_ULAW,
 	SPA_AUDIO_FORMAT_ALAW,
 
+	SPA_AUDIO_FORMAT_F16_LE,
+	SPA_AUDIO_FORMAT_F16_BE,
+
 	/* planar formats */
 	SPA_AUDIO_FORMAT_START_Planar		= 0x200,
 	SPA_AUDIO_FORMAT_U8P,
@@ -72,6 +75,7 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_F32P,
 	SPA_AUDIO_FORMAT_F64P,
 	SPA_AUDIO_FORMAT_S8P,
+	SPA_AUDIO_FORMAT_F16P,
 
 	/* other formats start here */
 	SPA_AUDIO_FORMAT_START_Other		= 0x400,
@@ -82,6 +86,7 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_DSP_S32 = SPA_AUDIO_FORMAT_S24_32P,
 	SPA_AUDIO_FORMAT_DSP_F32 = SPA_AUDIO_FORMAT_F32P,
 	SPA_AUDIO_FORMAT_DSP_F64 = SPA_AUDIO_FORMAT_F64P,
+	SPA_AUDIO_FORMAT_DSP_F16 = SPA_AUDIO_FORMAT_F16P,
 
 	/* native endian */
 #if __BYTE_ORDER == __BIG_ENDIAN
@@ -99,6 +104,7 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_U18 = SPA_AUDIO_FORMAT_U18_BE,
 	SPA_AUDIO_FORMAT_F32 = SPA_AUDIO_FORMAT_F32_BE,
 	SPA_AUDIO_FORMAT_F64 = SPA_AUDIO_FORMAT_F64_BE,
+	SPA_AUDIO_FORMAT_F16 = SPA_AUDIO_FORMAT_F16_BE,
 	SPA_AUDIO_FORMAT_S16_OE = SPA_AUDIO_FORMAT_S16_LE,
 	SPA_AUDIO_FORMAT_U16_OE = SPA_AUDIO_FORMAT_U16_LE,
 	SPA_AUDIO_FORMAT_S24_32_OE = SPA_AUDIO_FORMAT_S24_32_LE,
@@ -113,6 +119,7 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_U18_OE = SPA_AUDIO_FORMAT_U18_LE,
 	SPA_AUDIO_FORMAT_F32_OE = SPA_AUDIO_FORMAT_F32_LE,
 	SPA_AUDIO_FORMAT_F64_OE = SPA_AUDIO_FORMAT_F64_LE,
+	SPA_AUDIO_FORMAT_F16_OE = SPA_AUDIO_FORMAT_F16_LE,
 #elif __BYTE_ORDER == __LITTLE_ENDIAN
 	SPA_AUDIO_FORMAT_S16 = SPA_AUDIO_FORMAT_S16_LE,
 	SPA_AUDIO_FORMAT_U16 = SPA_AUDIO_FORMAT_U16_LE,
@@ -128,6 +135,7 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_U18 = SPA_AUDIO_FORMAT_U18_LE,
 	SPA_AUDIO_FORMAT_F32 = SPA_AUDIO_FORMAT_F32_LE,
 	SPA_AUDIO_FORMAT_F64 = SPA_AUDIO_FORMAT_F64_LE,
+	SPA_AUDIO_FORMAT_F16 = SPA_AUDIO_FORMAT_F16_LE,
 	SPA_AUDIO_FORMAT_S16_OE = SPA_AUDIO_FORMAT_S16_BE,
 	SPA_AUDIO_FORMAT_U16_OE = SPA_AUDIO_FORMAT_U16_BE,
 	SPA_AUDIO_FORMAT_S24_32_OE = SPA_AUDIO_FORMAT_S24_32_BE,
@@ -142,6 +150,7 @@ enum spa_audio_format {
 	SPA_AUDIO_FORMAT_U18_OE = SPA_AUDIO_FORMAT_U18_BE,
 	SPA_AUDIO_FORMAT_F32_OE = SPA_AUDIO_FORMAT_F32_BE,
 	SPA_AUDIO_FORMAT_F64_OE = SPA_AUDIO_FORMAT_F64_BE,
+	SPA_AUDIO_FORMAT_F16_OE = SPA_AUDIO_FORMAT_F16_BE,
 #endif
 };
 
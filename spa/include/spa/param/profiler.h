@@ -51,7 +51,9 @@ enum spa_profiler {
 							  *      Long : driver finish,
 							  *      Int : driver status,
 							  *      Fraction : latency,
-							  *      Int : xrun_count))  */
+							  *      Int : xrun_count,
+							  *      Int : overrun_count,
+							  *      Long : overrun_time))  */
 
 	SPA_PROFILER_START_Follower	= 0x20000,	/**< follower related profiler properties */
 	SPA_PROFILER_followerBlock,			/**< generic follower info block
@@ -64,7 +66,14 @@ enum spa_profiler {
 							  *      Long : finish,
 							  *      Int : status,
 							  *      Fraction : latency,
-							  *      Int : xrun_count))  */
+							  *      Int : xrun_count,
+							  *      Int : overrun_count,
+							  *      Long : overrun_time))
+							  *
+							  * The overrun_count is the number of cycles
+							  * where the node was still processing when the
+							  * next cycle started, overrun_time the time of
+							  * the last overrun in microseconds. */
 
 	SPA_PROFILER_START_CUSTOM	= 0x1000000,
 };
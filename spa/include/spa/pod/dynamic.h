@@ -23,9 +23,15 @@ static int spa_pod_dynamic_builder_overflow(void *data, uint32_t size)
 {
 	struct spa_pod_dynamic_builder *d = (struct spa_pod_dynamic_builder*)data;
 	int32_t old_size = d->b.size;
-	int32_t new_size = SPA_ROUND_UP_N(size, d->extend);
+	int32_t new_size;
 	void *old_data = d->b.data, *new_data;
 
+	/* grow at least by half of the current size so that building
+	 * large pods does not realloc for every extend bytes */
+	if (size < (uint32_t)old_size + old_size / 2)
+		size = old_size + old_size / 2;
+	new_size = SPA_ROUND_UP_N(size, d->extend);
+
 	if (old_data == d->data)
 		d->b.data = NULL;
 	if ((new_data = realloc(d->b.data, new_size)) == NULL)
@@ -50,6 +56,16 @@ static inline void spa_pod_dynamic_builder_init(struct spa_pod_dynamic_builder *
 	builder->data = data;
 }
 
+/**
+ * Rewind the builder so that a new pod can be built. Memory that was
+ * allocated while building previous pods is kept and reused.
+ */
+static inline void spa_pod_dynamic_builder_reset(struct spa_pod_dynamic_builder *builder)
+{
+	struct spa_pod_builder_state state = { 0 };
+	spa_pod_builder_reset(&builder->b, &state);
+}
+
 static inline void spa_pod_dynamic_builder_clean(struct spa_pod_dynamic_builder *builder)
 {
 	if (builder->data != builder->b.data)
@@ -125,6 +125,137 @@ static inline int spa_pod_filter_is_step_of(uint32_t type, const void *r1,
 	return 0;
 }
 
+#define SPA_POD_FILTER_SORT_MIN	8
+#define SPA_POD_FILTER_SORT_MAX	512
+
+/* a total order for values that is consistent with spa_pod_compare_value()
+ * returning 0, or -ENOTSUP when the values of this type can't be ordered */
+static inline int spa_pod_filter_order_value(uint32_t type, const void *r1,
+		const void *r2, uint32_t size)
+{
+	switch (type) {
+	case SPA_TYPE_Id:
+	case SPA_TYPE_Int:
+	case SPA_TYPE_Long:
+	case SPA_TYPE_Fraction:
+		return spa_pod_compare_value(type, r1, r2, size);
+	case SPA_TYPE_Rectangle:
+	{
+		const struct spa_rectangle *rec1 = (struct spa_rectangle *) r1,
+		    *rec2 = (struct spa_rectangle *) r2;
+		if (rec1->width != rec2->width)
+			return SPA_CMP(rec1->width, rec2->width);
+		return SPA_CMP(rec1->height, rec2->height);
+	}
+	default:
+		break;
+	}
+	return -ENOTSUP;
+}
+
+static inline bool spa_pod_filter_can_order(uint32_t type, const void *vals,
+		uint32_t n_vals, uint32_t size)
+{
+	uint32_t i;
+
+	switch (type) {
+	case SPA_TYPE_Id:
+	case SPA_TYPE_Int:
+	case SPA_TYPE_Long:
+	case SPA_TYPE_Rectangle:
+		return true;
+	case SPA_TYPE_Fraction:
+		/* fractions with a 0 denominator compare equal to everything */
+		for (i = 0; i < n_vals; i++) {
+			const struct spa_fraction *f = SPA_PTROFF(vals, i * size, struct spa_fraction);
+			if (f->denom == 0)
+				return false;
+		}
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+static inline void spa_pod_filter_sift_down(uint32_t type, const void *vals, uint32_t size,
+		uint16_t *idx, uint32_t start, uint32_t n)
+{
+	uint32_t root = start, child;
+	uint16_t tmp;
+
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n &&
+		    spa_pod_filter_order_value(type,
+			    SPA_PTROFF(vals, idx[child] * size, void),
+			    SPA_PTROFF(vals, idx[child + 1] * size, void), size) < 0)
+			child++;
+		if (spa_pod_filter_order_value(type,
+			    SPA_PTROFF(vals, idx[root] * size, void),
+			    SPA_PTROFF(vals, idx[child] * size, void), size) >= 0)
+			break;
+		tmp = idx[root];
+		idx[root] = idx[child];
+		idx[child] = tmp;
+		root = child;
+	}
+}
+
+/* Intersect two enums by sorting the values of the second one and doing a
+ * binary search for each value of the first one. The values are emitted
+ * exactly like the nested loop in spa_pod_filter_prop() does: in the order
+ * of the first enum and once for each equal value in the second enum.
+ * Returns the number of matches or -ENOTSUP when the values can't be sorted. */
+static inline int spa_pod_filter_enum_sorted(struct spa_pod_builder *b,
+		uint32_t type, uint32_t size, bool copy_first,
+		const void *alt1, uint32_t nalt1, const void *alt2, uint32_t nalt2)
+{
+	uint16_t idx[SPA_POD_FILTER_SORT_MAX];
+	uint32_t i, j, lo, hi, mid;
+	int n_copied = 0;
+	uint16_t tmp;
+
+	if (nalt2 > SPA_POD_FILTER_SORT_MAX ||
+	    !spa_pod_filter_can_order(type, alt1, nalt1, size) ||
+	    !spa_pod_filter_can_order(type, alt2, nalt2, size))
+		return -ENOTSUP;
+
+	for (i = 0; i < nalt2; i++)
+		idx[i] = i;
+	for (i = nalt2 / 2; i > 0; i--)
+		spa_pod_filter_sift_down(type, alt2, size, idx, i - 1, nalt2);
+	for (i = nalt2; i > 1; i--) {
+		tmp = idx[0];
+		idx[0] = idx[i - 1];
+		idx[i - 1] = tmp;
+		spa_pod_filter_sift_down(type, alt2, size, idx, 0, i - 1);
+	}
+
+	for (j = 0; j < nalt1; j++) {
+		const void *a1 = SPA_PTROFF(alt1, j * size, void);
+
+		lo = 0;
+		hi = nalt2;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (spa_pod_filter_order_value(type,
+					SPA_PTROFF(alt2, idx[mid] * size, void), a1, size) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (; lo < nalt2; lo++) {
+			if (spa_pod_filter_order_value(type,
+					SPA_PTROFF(alt2, idx[lo] * size, void), a1, size) != 0)
+				break;
+			if (copy_first || j > 0)
+				spa_pod_builder_raw(b, a1, size);
+			n_copied++;
+		}
+	}
+	return n_copied;
+}
+
 static inline int
 spa_pod_filter_prop(struct spa_pod_builder *b,
 	    const struct spa_pod_prop *p1,
@@ -175,14 +306,22 @@ spa_pod_filter_prop(struct spa_pod_builder *b,
 	    (p1c == SPA_CHOICE_None && p2c == SPA_CHOICE_Enum) ||
 	    (p1c == SPA_CHOICE_Enum && p2c == SPA_CHOICE_None) ||
 	    (p1c == SPA_CHOICE_Enum && p2c == SPA_CHOICE_Enum)) {
-		int n_copied = 0;
-		/* copy all equal values but don't copy the default value again */
-		for (j = 0, a1 = alt1; j < nalt1; j++, a1 = SPA_PTROFF(a1, size, void)) {
-			for (k = 0, a2 = alt2; k < nalt2; k++, a2 = SPA_PTROFF(a2,size,void)) {
-				if (spa_pod_compare_value(type, a1, a2, size) == 0) {
-					if (p1c == SPA_CHOICE_Enum || j > 0)
-						spa_pod_builder_raw(b, a1, size);
-					n_copied++;
+		int n_copied = -ENOTSUP;
+
+		/* avoid quadratic work for large enums */
+		if (nalt1 >= SPA_POD_FILTER_SORT_MIN && nalt2 >= SPA_POD_FILTER_SORT_MIN)
+			n_copied = spa_pod_filter_enum_sorted(b, type, size,
+					p1c == SPA_CHOICE_Enum, alt1, nalt1, alt2, nalt2);
+		if (n_copied < 0) {
+			n_copied = 0;
+			/* copy all equal values but don't copy the default value again */
+			for (j = 0, a1 = alt1; j < nalt1; j++, a1 = SPA_PTROFF(a1, size, void)) {
+				for (k = 0, a2 = alt2; k < nalt2; k++, a2 = SPA_PTROFF(a2,size,void)) {
+					if (spa_pod_compare_value(type, a1, a2, size) == 0) {
+						if (p1c == SPA_CHOICE_Enum || j > 0)
+							spa_pod_builder_raw(b, a1, size);
+						n_copied++;
+					}
 				}
 			}
 		}
@@ -286,7 +425,7 @@ spa_pod_filter_prop(struct spa_pod_builder *b,
 	if ((p1c == SPA_CHOICE_Step && p2c == SPA_CHOICE_None) ||
 	    (p1c == SPA_CHOICE_Step && p2c == SPA_CHOICE_Enum)) {
 		int n_copied = 0;
-		for (j = 0, a1 = alt1, a2 = alt2; j < nalt2; j++, a2 = SPA_PTROFF(a1,size,void)) {
+		for (j = 0, a1 = alt1, a2 = alt2; j < nalt2; j++, a2 = SPA_PTROFF(a2,size,void)) {
 			int res;
 			if (spa_pod_compare_value(type, a2, a1, size) < 0)
 				continue;
@@ -372,6 +372,8 @@ static inline bool spa_log_level_topic_enabled(const struct spa_log *log,
 #define SPA_KEY_LOG_TIMESTAMP		"log.timestamp"		/**< log timestamps */
 #define SPA_KEY_LOG_LINE		"log.line"		/**< log file and line numbers */
 #define SPA_KEY_LOG_PATTERNS		"log.patterns"		/**< Spa:String:JSON array of [ {"pattern" : level}, ... ] */
+#define SPA_KEY_LOG_ASYNC		"log.async"		/**< don't block the caller, write the messages
+								  *  from a loop or a separate thread */
 
 /**
  * \}
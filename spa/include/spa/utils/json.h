@@ -20,6 +20,12 @@ extern "C" {
 #include <spa/utils/defs.h>
 #include <spa/utils/string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 /** \defgroup spa_json JSON
  * Relaxed JSON variant parsing
  */
@@ -54,6 +60,88 @@ static inline void spa_json_enter(struct spa_json * iter, struct spa_json * sub)
 
 #define SPA_JSON_SAVE(iter) ((struct spa_json) { (iter)->cur, (iter)->end, NULL, (iter)->state, 0 })
 
+/* Fast scanners for runs of bytes that don't change the state of the
+ * tokenizer. They return the first byte in [cur, end) that needs to be
+ * looked at by the state machine. */
+#if defined(__SSE2__)
+#define _SPA_JSON_SCAN(cur,end,v,match)						\
+	for (; (end) - (cur) >= 16; (cur) += 16) {				\
+		__m128i v = _mm_loadu_si128((const __m128i *)(cur));		\
+		int mask = _mm_movemask_epi8(match);				\
+		if (mask != 0) {						\
+			(cur) += __builtin_ctz(mask);				\
+			return (cur);						\
+		}								\
+	}
+#define _SPA_JSON_EQ(v,c)	_mm_cmpeq_epi8(v, _mm_set1_epi8(c))
+#define _SPA_JSON_OR(a,b)	_mm_or_si128(a, b)
+/* signed compare, bytes >= 0x80 are smaller than ' ' as well */
+#define _SPA_JSON_NOT_ASCII(v)	_mm_cmplt_epi8(v, _mm_set1_epi8(' '))
+#define _SPA_JSON_NOT(v)	_mm_xor_si128(v, _mm_set1_epi8(-1))
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define _SPA_JSON_SCAN(cur,end,v,match)						\
+	for (; (end) - (cur) >= 16; (cur) += 16) {				\
+		uint8x16_t v = vld1q_u8((const uint8_t *)(cur));		\
+		if (vmaxvq_u8(match) != 0)					\
+			break;							\
+	}
+#define _SPA_JSON_EQ(v,c)	vceqq_u8(v, vdupq_n_u8(c))
+#define _SPA_JSON_OR(a,b)	vorrq_u8(a, b)
+#define _SPA_JSON_NOT_ASCII(v)	vorrq_u8(vcltq_u8(v, vdupq_n_u8(' ')), vcgeq_u8(v, vdupq_n_u8(0x80)))
+#define _SPA_JSON_NOT(v)	vmvnq_u8(v)
+#else
+#define _SPA_JSON_SCAN(cur,end,v,match)
+#endif
+
+/* plain string characters, stops at quote, escape, control chars and UTF-8 */
+static inline const char *_spa_json_skip_string(const char *cur, const char *end)
+{
+	_SPA_JSON_SCAN(cur, end, v,
+		_SPA_JSON_OR(_SPA_JSON_NOT_ASCII(v),
+			_SPA_JSON_OR(_SPA_JSON_EQ(v, '"'), _SPA_JSON_EQ(v, '\\'))));
+	for (; cur < end; cur++) {
+		unsigned char c = (unsigned char)*cur;
+		if (c < 32 || c >= 128 || c == '"' || c == '\\')
+			break;
+	}
+	return cur;
+}
+
+/* comments, stops at the end of the line */
+static inline const char *_spa_json_skip_comment(const char *cur, const char *end)
+{
+	_SPA_JSON_SCAN(cur, end, v,
+		_SPA_JSON_OR(_SPA_JSON_EQ(v, '\n'), _SPA_JSON_EQ(v, '\r')));
+	for (; cur < end; cur++) {
+		if (*cur == '\n' || *cur == '\r')
+			break;
+	}
+	return cur;
+}
+
+/* whitespace and separators between tokens */
+static inline const char *_spa_json_skip_space(const char *cur, const char *end)
+{
+	_SPA_JSON_SCAN(cur, end, v,
+		_SPA_JSON_NOT(_SPA_JSON_OR(
+			_SPA_JSON_OR(_SPA_JSON_EQ(v, ' '), _SPA_JSON_EQ(v, '\n')),
+			_SPA_JSON_OR(_SPA_JSON_OR(_SPA_JSON_EQ(v, '\t'), _SPA_JSON_EQ(v, '\r')),
+				_SPA_JSON_OR(_SPA_JSON_EQ(v, ','), _SPA_JSON_EQ(v, '\0'))))));
+	for (; cur < end; cur++) {
+		switch (*cur) {
+		case '\0': case '\t': case ' ': case '\r': case '\n': case ',':
+			continue;
+		}
+		break;
+	}
+	return cur;
+}
+#undef _SPA_JSON_SCAN
+#undef _SPA_JSON_EQ
+#undef _SPA_JSON_OR
+#undef _SPA_JSON_NOT_ASCII
+#undef _SPA_JSON_NOT
+
 /** Get the next token. \a value points to the token and the return value
  * is the length. Returns -1 on parse error, 0 on end of input. */
 static inline int spa_json_next(struct spa_json * iter, const char **value)
@@ -103,6 +191,7 @@ static inline int spa_json_next(struct spa_json * iter, const char **value)
 		case __STRUCT:
 			switch (cur) {
 			case '\0': case '\t': case ' ': case '\r': case '\n': case ',':
+				iter->cur = _spa_json_skip_space(iter->cur + 1, iter->end) - 1;
 				continue;
 			case ':': case '=':
 				if (flag & __ARRAY_FLAG)
@@ -238,8 +327,10 @@ static inline int spa_json_next(struct spa_json * iter, const char **value)
 				iter->state = __UTF8 | flag;
 				continue;
 			default:
-				if (cur >= 32 && cur <= 127)
+				if (cur >= 32 && cur <= 127) {
+					iter->cur = _spa_json_skip_string(iter->cur + 1, iter->end) - 1;
 					continue;
+				}
 			}
 			_SPA_ERROR(CHARACTERS_NOT_ALLOWED);
 		case __UTF8:
@@ -262,6 +353,9 @@ static inline int spa_json_next(struct spa_json * iter, const char **value)
 			switch (cur) {
 			case '\n': case '\r':
 				iter->state = __STRUCT | flag;
+				break;
+			default:
+				iter->cur = _spa_json_skip_comment(iter->cur + 1, iter->end) - 1;
 			}
 			break;
 		default:
@@ -156,6 +156,159 @@ static inline void spa_ringbuffer_write_update(struct spa_ringbuffer *rbuf, int3
 	__atomic_store_n(&rbuf->writeindex, index, __ATOMIC_RELEASE);
 }
 
+/** the size of the cache lines that separate the indexes of
+ * struct spa_ringbuffer_padded */
+#define SPA_RINGBUFFER_CACHELINE	64
+
+/**
+ * A ringbuffer for one reader and one writer thread.
+ *
+ * The read and write index are on separate cache lines so that the reader
+ * and writer don't invalidate each other's cache line when they update
+ * their own index. Each side also keeps a copy of the other side's index
+ * and only loads it again when the copy doesn't show enough data or space.
+ *
+ * Only the reader updates the read index and only the writer updates the
+ * write index. Several blocks can be read or written at consecutive
+ * indexes before publishing them all with one update.
+ */
+struct spa_ringbuffer_padded {
+	uint32_t readindex;	/*< the current read index */
+	uint32_t writecache;	/*< the last write index seen by the reader */
+	uint8_t _pad0[SPA_RINGBUFFER_CACHELINE - 2 * sizeof(uint32_t)];
+	uint32_t writeindex;	/*< the current write index */
+	uint32_t readcache;	/*< the last read index seen by the writer */
+	uint8_t _pad1[SPA_RINGBUFFER_CACHELINE - 2 * sizeof(uint32_t)];
+} SPA_ALIGNED(SPA_RINGBUFFER_CACHELINE);
+
+/**
+ * Initialize a spa_ringbuffer_padded.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ */
+static inline void spa_ringbuffer_padded_init(struct spa_ringbuffer_padded *rbuf)
+{
+	memset(rbuf, 0, sizeof(*rbuf));
+}
+
+/**
+ * Get the read index and available bytes for reading. The write index is
+ * only loaded from the writer when less than \a len bytes were available
+ * the last time it was loaded.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ * \param index the value of readindex, should be taken modulo the size of the
+ *         ringbuffer memory to get the offset in the ringbuffer memory
+ * \param len the number of bytes the reader wants to read
+ * \return number of available bytes to read, this can be less than the
+ *         number of bytes in the ringbuffer when at least \a len bytes are
+ *         available.
+ */
+static inline int32_t spa_ringbuffer_padded_get_read_index(struct spa_ringbuffer_padded *rbuf,
+		uint32_t *index, uint32_t len)
+{
+	int32_t avail;
+
+	*index = rbuf->readindex;
+	avail = (int32_t) (rbuf->writecache - *index);
+	if (avail < (int32_t) len) {
+		rbuf->writecache = __atomic_load_n(&rbuf->writeindex, __ATOMIC_ACQUIRE);
+		avail = (int32_t) (rbuf->writecache - *index);
+	}
+	return avail;
+}
+
+/**
+ * Read \a len bytes from \a rbuf starting \a offset. \a offset must be taken
+ * modulo \a size and len should be smaller than \a size.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ * \param buffer memory to read from
+ * \param size the size of \a buffer
+ * \param offset offset in \a buffer to read from
+ * \param data destination memory
+ * \param len number of bytes to read
+ */
+static inline void
+spa_ringbuffer_padded_read_data(struct spa_ringbuffer_padded *rbuf SPA_UNUSED,
+			 const void *buffer, uint32_t size,
+			 uint32_t offset, void *data, uint32_t len)
+{
+	spa_ringbuffer_read_data(NULL, buffer, size, offset, data, len);
+}
+
+/**
+ * Update the read pointer to \a index. This makes the space of all the
+ * data read up to \a index available to the writer.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ * \param index new index
+ */
+static inline void spa_ringbuffer_padded_read_update(struct spa_ringbuffer_padded *rbuf, uint32_t index)
+{
+	__atomic_store_n(&rbuf->readindex, index, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the write index and the number of bytes inside the ringbuffer. The
+ * read index is only loaded from the reader when there was less than
+ * \a len bytes of space the last time it was loaded.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ * \param index the value of writeindex, should be taken modulo the size of the
+ *         ringbuffer memory to get the offset in the ringbuffer memory
+ * \param size the size of the ringbuffer memory
+ * \param len the number of bytes the writer wants to write
+ * \return the fill level of \a rbuf, this can be more than the number of
+ *         bytes in the ringbuffer when there is space for at least
+ *         \a len bytes. Subtract from \a size to get the number of bytes
+ *         available for writing.
+ */
+static inline int32_t spa_ringbuffer_padded_get_write_index(struct spa_ringbuffer_padded *rbuf,
+		uint32_t *index, uint32_t size, uint32_t len)
+{
+	int32_t filled;
+
+	*index = rbuf->writeindex;
+	filled = (int32_t) (*index - rbuf->readcache);
+	if ((int32_t) size - filled < (int32_t) len) {
+		rbuf->readcache = __atomic_load_n(&rbuf->readindex, __ATOMIC_ACQUIRE);
+		filled = (int32_t) (*index - rbuf->readcache);
+	}
+	return filled;
+}
+
+/**
+ * Write \a len bytes to \a buffer starting \a offset. \a offset must be taken
+ * modulo \a size and len should be smaller than \a size.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ * \param buffer memory to write to
+ * \param size the size of \a buffer
+ * \param offset offset in \a buffer to write to
+ * \param data source memory
+ * \param len number of bytes to write
+ */
+static inline void
+spa_ringbuffer_padded_write_data(struct spa_ringbuffer_padded *rbuf SPA_UNUSED,
+			  void *buffer, uint32_t size,
+			  uint32_t offset, const void *data, uint32_t len)
+{
+	spa_ringbuffer_write_data(NULL, buffer, size, offset, data, len);
+}
+
+/**
+ * Update the write pointer to \a index. This makes all the data written
+ * up to \a index available to the reader.
+ *
+ * \param rbuf a spa_ringbuffer_padded
+ * \param index new index
+ */
+static inline void spa_ringbuffer_padded_write_update(struct spa_ringbuffer_padded *rbuf, uint32_t index)
+{
+	__atomic_store_n(&rbuf->writeindex, index, __ATOMIC_RELEASE);
+}
+
 /**
  * \}
  */
@@ -115,6 +115,13 @@ static int webrtc_init2(void *object, const struct spa_dict *args,
 	bool beamforming = webrtc_get_spa_bool(args, "webrtc.beamforming", false);
 #else
 	bool transient_suppression = webrtc_get_spa_bool(args, "webrtc.transient_suppression", true);
+	// With multichannel capture, the channels are cancelled against one analysis of
+	// the playback signal. Without, the capture is downmixed to mono.
+	bool multi_channel_capture = webrtc_get_spa_bool(args, "webrtc.multi_channel_capture",
+			rec_info->channels > 1);
+	// Without multichannel render, the playback is downmixed before the analysis
+	bool multi_channel_render = webrtc_get_spa_bool(args, "webrtc.multi_channel_render",
+			play_info->channels > 1);
 #endif
 	// Note: AGC seems to mess up with Agnostic Delay Detection, especially with speech,
 	// result in very poor performance, disable by default
@@ -171,8 +178,11 @@ static int webrtc_init2(void *object, const struct spa_dict *args,
 #else
 	webrtc::AudioProcessing::Config config;
 	config.echo_canceller.enabled = true;
-	config.pipeline.multi_channel_capture = rec_info->channels > 1;
-	config.pipeline.multi_channel_render = play_info->channels > 1;
+	config.pipeline.multi_channel_capture = multi_channel_capture;
+	config.pipeline.multi_channel_render = multi_channel_render;
+	spa_log_info(impl->log, "%u capture channels (%s), %u playback channels (%s)",
+			rec_info->channels, multi_channel_capture ? "multichannel" : "downmixed",
+			play_info->channels, multi_channel_render ? "multichannel" : "downmixed");
 	// FIXME: Example code enables both gain controllers, but that seems sus
 	config.gain_controller1.enabled = gain_control;
 	config.gain_controller1.mode = webrtc::AudioProcessing::Config::GainController1::Mode::kAdaptiveDigital;
@@ -9,6 +9,8 @@
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
 
+#include <spa-private/cache-dir.h>
+
 int _acp_log_level = 1;
 acp_log_func _acp_log_func;
 void *_acp_log_data;
@@ -17,6 +19,9 @@ struct spa_i18n *acp_i18n;
 
 #define DEFAULT_RATE	48000
 
+/* bump when the probe logic changes in a way that invalidates old caches */
+#define PROBE_CACHE_VERSION	1
+
 #define VOLUME_ACCURACY (PA_VOLUME_NORM/100)  /* don't require volume adjustments to be perfectly correct. don't necessarily extend granularity in software unless the differences get greater than this level */
 
 static const uint32_t channel_table[PA_CHANNEL_POSITION_MAX] = {
@@ -1625,12 +1630,141 @@ static void prune_singleton_availability_groups(pa_hashmap *ports) {
     pa_hashmap_free(group_counts);
 }
 
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+	/* FNV-1a */
+	while (str && *str) {
+		hash ^= (uint8_t)*str++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash ^ 0xff;
+}
+
+/* Make a key for the card from everything that can change the probe
+ * result: the card info, the names of all controls and the probe
+ * configuration. */
+static int get_card_key(pa_card *impl, const char *profile_set, uint64_t *key)
+{
+	snd_ctl_t *ctl;
+	snd_ctl_card_info_t *info;
+	snd_ctl_elem_list_t *list;
+	char device[16], buf[64];
+	unsigned int i, count;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	int err;
+
+	snprintf(device, sizeof(device), "hw:%d", impl->card.index);
+	if ((err = snd_ctl_open(&ctl, device, 0)) < 0)
+		return err;
+
+	snd_ctl_card_info_alloca(&info);
+	snd_ctl_elem_list_alloca(&list);
+
+	if ((err = snd_ctl_card_info(ctl, info)) < 0)
+		goto exit;
+
+	hash = hash_string(hash, snd_ctl_card_info_get_driver(info));
+	hash = hash_string(hash, snd_ctl_card_info_get_name(info));
+	hash = hash_string(hash, snd_ctl_card_info_get_longname(info));
+	hash = hash_string(hash, snd_ctl_card_info_get_mixername(info));
+	hash = hash_string(hash, snd_ctl_card_info_get_components(info));
+
+	if ((err = snd_ctl_elem_list(ctl, list)) < 0)
+		goto exit;
+	count = snd_ctl_elem_list_get_count(list);
+	if ((err = snd_ctl_elem_list_alloc_space(list, count)) < 0)
+		goto exit;
+	if ((err = snd_ctl_elem_list(ctl, list)) < 0)
+		goto free_list;
+
+	for (i = 0; i < snd_ctl_elem_list_get_used(list); i++) {
+		hash = hash_string(hash, snd_ctl_elem_list_get_name(list, i));
+		snprintf(buf, sizeof(buf), "%u", snd_ctl_elem_list_get_index(list, i));
+		hash = hash_string(hash, buf);
+	}
+
+	snprintf(buf, sizeof(buf), "%d %d %u %u", PROBE_CACHE_VERSION,
+			impl->use_ucm, impl->rate, impl->pro_channels);
+	hash = hash_string(hash, buf);
+	hash = hash_string(hash, profile_set);
+
+	*key = hash;
+free_list:
+	snd_ctl_elem_list_free_space(list);
+exit:
+	snd_ctl_close(ctl);
+	return err;
+}
+
+static int get_probe_cache_path(pa_card *impl, const char *profile_set,
+		char *path, size_t size)
+{
+	char base[PATH_MAX];
+	uint64_t key;
+	int res;
+
+	if ((res = get_card_key(impl, profile_set, &key)) < 0)
+		return res;
+
+	if ((res = get_pipewire_cache_dir(base, sizeof(base), NULL, true)) < 0)
+		return res;
+
+	snprintf(path, size, "%s/acp-probe-%016"PRIx64".conf", base, key);
+	return 0;
+}
+
+/* The cache contains the names of the profiles that failed to probe, one
+ * per line. */
+static void load_probe_cache(pa_alsa_profile_set *ps, const char *path)
+{
+	FILE *f;
+	char line[1024];
+	size_t len;
+
+	ps->probe_cache = pa_hashmap_new_full(pa_idxset_string_hash_func,
+			pa_idxset_string_compare_func, pa_xfree, NULL);
+
+	if ((f = fopen(path, "r")) == NULL)
+		return;
+
+	pa_log_info("Using probe cache %s", path);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		len = strcspn(line, "\n");
+		line[len] = '\0';
+		if (len > 0)
+			pa_hashmap_put(ps->probe_cache, pa_xstrdup(line), PA_UINT_TO_PTR(1));
+	}
+	fclose(f);
+	ps->probe_cached = true;
+}
+
+static void save_probe_cache(pa_alsa_profile_set *ps, const char *path)
+{
+	FILE *f;
+	char tmp[PATH_MAX];
+	const char *name;
+	void *state, *val;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((f = fopen(tmp, "w")) == NULL) {
+		pa_log_warn("can't write probe cache %s: %m", tmp);
+		return;
+	}
+	PA_HASHMAP_FOREACH_KV(name, val, ps->probe_cache, state)
+		fprintf(f, "%s\n", name);
+
+	if (fclose(f) != 0 || rename(tmp, path) < 0) {
+		pa_log_warn("can't write probe cache %s: %m", path);
+		unlink(tmp);
+	}
+}
+
 struct acp_card *acp_card_new(uint32_t index, const struct acp_dict *props)
 {
 	pa_card *impl;
 	struct acp_card *card;
 	const char *s, *profile_set = NULL, *profile = NULL;
-	char device_id[16];
+	char device_id[16], cache_path[PATH_MAX] = "";
 	uint32_t profile_index;
 	int res;
 
@@ -1674,6 +1808,8 @@ struct acp_card *acp_card_new(uint32_t index, const struct acp_dict *props)
 			impl->rate = atoi(s);
 		if ((s = acp_dict_lookup(props, "api.acp.pro-channels")) != NULL)
 			impl->pro_channels = atoi(s);
+		if ((s = acp_dict_lookup(props, "api.acp.probe-cache")) != NULL)
+			impl->probe_cache = spa_atob(s);
 	}
 
 	impl->ucm.default_sample_spec.format = PA_SAMPLE_S16NE;
@@ -1715,12 +1851,23 @@ struct acp_card *acp_card_new(uint32_t index, const struct acp_dict *props)
 
 	impl->profile_set->ignore_dB = impl->ignore_dB;
 
+	if (impl->probe_cache &&
+	    get_probe_cache_path(impl, profile_set, cache_path, sizeof(cache_path)) == 0)
+		load_probe_cache(impl->profile_set, cache_path);
+
 	pa_alsa_profile_set_probe(impl->profile_set, impl->ucm.mixers,
 			device_id,
 			&impl->ucm.default_sample_spec,
 			impl->ucm.default_n_fragments,
 			impl->ucm.default_fragment_size_msec);
 
+	if (impl->profile_set->probe_cache && !impl->profile_set->probe_cached) {
+		if (impl->profile_set->probe_busy)
+			pa_log_info("Not saving probe cache, some devices were busy");
+		else
+			save_probe_cache(impl->profile_set, cache_path);
+	}
+
 	pa_alsa_init_proplist_card(NULL, impl->proplist, impl->card.index);
 	pa_proplist_sets(impl->proplist, PA_PROP_DEVICE_STRING, device_id);
 	pa_alsa_init_description(impl->proplist, NULL);
@@ -3834,6 +3834,9 @@ void pa_alsa_profile_set_free(pa_alsa_profile_set *ps) {
     if (ps->decibel_fixes)
         pa_hashmap_free(ps->decibel_fixes);
 
+    if (ps->probe_cache)
+        pa_hashmap_free(ps->probe_cache);
+
     pa_xfree(ps);
 }
 
@@ -5084,6 +5087,13 @@ void pa_alsa_profile_set_probe(
             if (selected_fallback_output == NULL || pa_idxset_get_by_index(p->output_mappings, 0) != selected_fallback_output)
                 continue;
 
+        /* Skip if a previous probe of the same card found it unsupported */
+        if (!p->supported && ps->probe_cached &&
+            pa_hashmap_get(ps->probe_cache, p->name) != NULL) {
+            pa_log_debug("Skipping profile %s - unsupported in probe cache", p->name);
+            continue;
+        }
+
         /* Skip if this is already marked that it is supported (i.e. from the config file) */
         if (!p->supported) {
 
@@ -5126,6 +5136,8 @@ void pa_alsa_profile_set_probe(
                                                            default_n_fragments,
                                                            default_fragment_size_msec))) {
                         p->supported = false;
+                        if (errno == EBUSY || errno == EAGAIN)
+                            ps->probe_busy = true;
                         if (pa_idxset_size(p->output_mappings) == 1 &&
                             ((!p->input_mappings) || pa_idxset_size(p->input_mappings) == 0)) {
                             pa_log_debug("Caching failure to open output:%s", m->name);
@@ -5150,6 +5162,8 @@ void pa_alsa_profile_set_probe(
                                                           default_n_fragments,
                                                           default_fragment_size_msec))) {
                         p->supported = false;
+                        if (errno == EBUSY || errno == EAGAIN)
+                            ps->probe_busy = true;
                         if (pa_idxset_size(p->input_mappings) == 1 &&
                             ((!p->output_mappings) || pa_idxset_size(p->output_mappings) == 0)) {
                             pa_log_debug("Caching failure to open input:%s", m->name);
@@ -5164,8 +5178,11 @@ void pa_alsa_profile_set_probe(
 
             last = p;
 
-            if (!p->supported)
+            if (!p->supported) {
+                if (ps->probe_cache && !ps->probe_cached)
+                    pa_hashmap_put(ps->probe_cache, pa_xstrdup(p->name), PA_UINT_TO_PTR(1));
                 continue;
+            }
         }
 
         pa_log_debug("Profile %s supported.", p->name);
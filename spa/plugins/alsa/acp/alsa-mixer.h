@@ -415,9 +415,18 @@ struct pa_alsa_profile_set {
     pa_hashmap *input_paths;
     pa_hashmap *output_paths;
 
+    /* Names of the profiles that failed probing. When probe_cached is set,
+     * this was loaded from a previous run and these profiles are skipped,
+     * else the failed profiles are added while probing. probe_busy is set
+     * when a PCM could not be opened because it was busy, the failures of
+     * such a probe are not definitive and are not saved. */
+    pa_hashmap *probe_cache;
+
     bool auto_profiles;
     bool ignore_dB:1;
     bool probed:1;
+    bool probe_cached:1;
+    bool probe_busy:1;
 };
 
 void pa_alsa_mapping_dump(pa_alsa_mapping *m);
@@ -769,6 +769,7 @@ snd_pcm_t *pa_alsa_open_by_device_string(
             pa_log("Device %s has %u channels, but PulseAudio supports only %u channels. Unable to use the device.",
                    d, ss->channels, PA_CHANNELS_MAX);
             pa_alsa_close(&pcm_handle);
+            err = -EINVAL;
             goto fail;
         }
 
@@ -786,6 +787,7 @@ snd_pcm_t *pa_alsa_open_by_device_string(
 fail:
     pa_xfree(d);
 
+    errno = -err;
     return NULL;
 }
 
@@ -807,6 +809,7 @@ snd_pcm_t *pa_alsa_open_by_template(
 
     snd_pcm_t *pcm_handle;
     char **i;
+    int busy = 0;
 
     for (i = template; *i; i++) {
         char *d;
@@ -832,8 +835,14 @@ snd_pcm_t *pa_alsa_open_by_template(
 
         if (pcm_handle)
             return pcm_handle;
+
+        if (errno == EBUSY || errno == EAGAIN)
+            busy = errno;
     }
 
+    /* report a busy device over the error of a later template */
+    if (busy)
+        errno = busy;
     return NULL;
 }
 
@@ -60,6 +60,15 @@
  *]
  *\endcode
  *
+ * With api.alsa.compress-offload.low-power = true, the device is configured
+ * with the largest fragments it supports. While the device has room for
+ * more data, cycles are run faster than realtime to fill it. When it is
+ * full, the driver timer sleeps until about half of the buffered data was
+ * played, so that the DSP can play for seconds without wakeups of the CPU.
+ * The buffered time is estimated from the device timestamps and reported as
+ * the clock delay. This is meant for long-form playback where latency does
+ * not matter.
+ *
  * TODO:
  * - DLL for adjusting driver timer intervals to match the device timestamps in on_driver_timeout()
  * - Automatic loading using alsa-udev
@@ -90,6 +99,10 @@
 
 #define BUFFER_FLAG_AVAILABLE_FOR_NEW_DATA  (1 << 0)
 
+/* In low-power mode, fill the device with cycles at this multiple of the
+ * realtime speed */
+#define LOW_POWER_FILL_SPEED                (4)
+
 
 /* Information about a buffer that got allocated by the PW graph. */
 struct buffer {
@@ -109,6 +122,8 @@ struct props {
 	int card_nr;
 	int device_nr;
 	bool device_name_set;
+	/* Use large fragments and few wakeups */
+	bool low_power;
 };
 
 
@@ -192,6 +207,8 @@ struct impl {
 	uint32_t max_num_fragments;
 	uint32_t configured_fragment_size;
 	uint32_t configured_num_fragments;
+	/* Played time of the data in the device, at the cycle rate */
+	uint64_t buffered_frames;
 	bool device_is_paused;
 };
 
@@ -609,6 +626,58 @@ static int device_write(struct impl *this, const void *data, uint32_t size)
 
 /* Driver timer functions */
 
+/* Estimate how much time the data in the device lasts, using the ratio
+ * between copied bytes and rendered frames from the device timestamp. */
+static int get_buffered_time(struct impl *this, uint32_t *avail, uint64_t *nsec)
+{
+	struct snd_compr_avail available_space;
+	const struct snd_compr_tstamp *ts = &available_space.tstamp;
+	uint64_t buffer_size, buffered;
+	int res;
+
+	if (this->device_context == NULL || !this->device_started)
+		return -EIO;
+
+	if ((res = compress_offload_api_get_available_space(this->device_context,
+					&available_space)) < 0)
+		return res;
+
+	buffer_size = (uint64_t)this->configured_fragment_size * this->configured_num_fragments;
+	buffered = buffer_size - SPA_MIN(available_space.avail, buffer_size);
+
+	*avail = SPA_MIN(available_space.avail, (uint64_t)UINT32_MAX);
+	if (ts->copied_total == 0 || ts->pcm_io_frames == 0 || ts->sampling_rate == 0)
+		*nsec = 0;
+	else
+		*nsec = buffered * ts->pcm_io_frames / ts->copied_total *
+			SPA_NSEC_PER_SEC / ts->sampling_rate;
+	return 0;
+}
+
+/* In low-power mode, run the cycles faster than realtime until the device
+ * is full and then sleep until half of the buffered data was played. */
+static void update_low_power_timeout(struct impl *this, uint64_t current_time)
+{
+	uint64_t cycle_time, buffered_time;
+	uint32_t avail;
+
+	cycle_time = ((uint64_t)this->cycle_duration) * SPA_NSEC_PER_SEC / this->cycle_rate;
+
+	if (get_buffered_time(this, &avail, &buffered_time) < 0) {
+		this->buffered_frames = 0;
+		return;
+	}
+	this->buffered_frames = buffered_time * this->cycle_rate / SPA_NSEC_PER_SEC;
+
+	if (avail >= this->configured_fragment_size)
+		this->next_driver_time = current_time + cycle_time / LOW_POWER_FILL_SPEED;
+	else
+		this->next_driver_time = current_time + SPA_MAX(buffered_time / 2, cycle_time);
+
+	spa_log_trace_fp(this->log, "%p: avail:%u buffered:%" PRIu64 " next:%" PRIu64,
+			this, avail, buffered_time, this->next_driver_time - current_time);
+}
+
 static int set_driver_timeout(struct impl *this, uint64_t time)
 {
 	struct itimerspec ts;
@@ -717,12 +786,15 @@ static void on_driver_timeout(struct spa_source *source)
 	current_time = this->next_driver_time;
 
 	this->next_driver_time += ((uint64_t)(this->cycle_duration)) * 1000000000ULL / this->cycle_rate;
+	if (this->props.low_power)
+		update_low_power_timeout(this, current_time);
+
 	if (this->node_clock_io != NULL) {
 		this->node_clock_io->nsec = current_time;
 		this->node_clock_io->rate = this->node_clock_io->target_rate;
 		this->node_clock_io->position += this->node_clock_io->duration;
 		this->node_clock_io->duration = this->cycle_duration;
-		this->node_clock_io->delay = 0;
+		this->node_clock_io->delay = this->props.low_power ? this->buffered_frames : 0;
 		this->node_clock_io->rate_diff = 1.0;
 		this->node_clock_io->next_nsec = this->next_driver_time;
 		spa_log_trace_fp(this->log, "%p: clock IO updated to: nsec %" PRIu64
@@ -895,6 +967,7 @@ static void reset_props(struct props *props)
 	props->card_nr = 0;
 	props->device_nr = 0;
 	props->device_name_set = false;
+	props->low_power = false;
 }
 
 static void clear_buffers(struct impl *this)
@@ -1583,11 +1656,14 @@ static int port_set_format(void *object,
 			return -ENOTSUP;
 		}
 
-		if ((res = compress_offload_api_set_params(this->device_context, &(this->audio_codec_info), 0, 0)) < 0)
-			return res;
-
 		compress_offload_caps = compress_offload_api_get_caps(this->device_context);
 
+		/* In low-power mode, use the largest fragments to get the most
+		 * buffered data in the device */
+		if ((res = compress_offload_api_set_params(this->device_context, &(this->audio_codec_info),
+				this->props.low_power ? compress_offload_caps->max_fragment_size : 0, 0)) < 0)
+			return res;
+
 		this->min_fragment_size = compress_offload_caps->min_fragment_size;
 		this->max_fragment_size = compress_offload_caps->max_fragment_size;
 		this->min_num_fragments = compress_offload_caps->min_fragments;
@@ -1968,6 +2044,8 @@ impl_init(const struct spa_handle_factory *factory, struct spa_handle *handle,
 			snprintf(this->props.device, sizeof(this->props.device), "%s", s);
 			if ((res = parse_device(this)) < 0)
 				return res;
+		} else if (spa_streq(k, "api.alsa.compress-offload.low-power")) {
+			this->props.low_power = spa_atob(s);
 		}
 	}
 
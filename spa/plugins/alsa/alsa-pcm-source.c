@@ -625,7 +625,7 @@ impl_node_port_use_buffers(void *object,
 {
 	struct state *this = object;
 	int res;
-	uint32_t i;
+	uint32_t i, j;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -657,6 +657,12 @@ impl_node_port_use_buffers(void *object,
 			spa_log_error(this->log, "%p: need mapped memory", this);
 			return -EINVAL;
 		}
+		if (SPA_FLAG_IS_SET(d[0].flags, SPA_DATA_FLAG_DYNAMIC) &&
+		    buffers[i]->n_datas <= SPA_N_ELEMENTS(b->datas)) {
+			SPA_FLAG_SET(b->flags, BUFFER_FLAG_DYNAMIC);
+			for (j = 0; j < buffers[i]->n_datas; j++)
+				b->datas[j] = d[j].data;
+		}
 		spa_list_append(&this->free, &b->link);
 	}
 	this->n_buffers = n_buffers;
@@ -873,7 +879,8 @@ impl_init(const struct spa_handle_factory *factory,
 	this->port_info = SPA_PORT_INFO_INIT();
 	this->port_info.flags = SPA_PORT_FLAG_LIVE |
 			   SPA_PORT_FLAG_PHYSICAL |
-			   SPA_PORT_FLAG_TERMINAL;
+			   SPA_PORT_FLAG_TERMINAL |
+			   SPA_PORT_FLAG_DYNAMIC_DATA;
 	this->port_params[PORT_EnumFormat] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
 	this->port_params[PORT_Meta] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
 	this->port_params[PORT_IO] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
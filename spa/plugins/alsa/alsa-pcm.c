@@ -1,3 +1,5 @@
+#include "config.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +18,8 @@
 #include <spa/node/keys.h>
 #include <spa/monitor/device.h>
 
+#include <sdt-probes.h>
+
 #include "alsa-pcm.h"
 
 static struct spa_list cards = SPA_LIST_INIT(&cards);
@@ -149,6 +153,34 @@ static int write_bind_ctl_param(struct state *state, const char *name, const cha
 	return 0;
 }
 
+static const struct {
+	const char *name;
+	snd_pcm_audio_tstamp_type_t type;
+} audio_tstamp_types[] = {
+	{ "none", SND_PCM_AUDIO_TSTAMP_TYPE_COMPAT },
+	{ "default", SND_PCM_AUDIO_TSTAMP_TYPE_DEFAULT },
+	{ "link", SND_PCM_AUDIO_TSTAMP_TYPE_LINK },
+	{ "link-absolute", SND_PCM_AUDIO_TSTAMP_TYPE_LINK_ABSOLUTE },
+	{ "link-estimated", SND_PCM_AUDIO_TSTAMP_TYPE_LINK_ESTIMATED },
+	{ "link-synchronized", SND_PCM_AUDIO_TSTAMP_TYPE_LINK_SYNCHRONIZED },
+};
+
+static snd_pcm_audio_tstamp_type_t audio_tstamp_type_from_name(const char *name)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(audio_tstamp_types, t)
+		if (spa_streq(t->name, name))
+			return t->type;
+	return SND_PCM_AUDIO_TSTAMP_TYPE_COMPAT;
+}
+
+static const char *audio_tstamp_type_name(snd_pcm_audio_tstamp_type_t type)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(audio_tstamp_types, t)
+		if (t->type == type)
+			return t->name;
+	return "none";
+}
+
 static int alsa_set_param(struct state *state, const char *k, const char *s)
 {
 	int fmt_change = 0;
@@ -185,6 +217,8 @@ static int alsa_set_param(struct state *state, const char *k, const char *s)
 		state->disable_batch = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.disable-tsched")) {
 		state->disable_tsched = spa_atob(s);
+	} else if (spa_streq(k, "api.alsa.adaptive-headroom")) {
+		state->adaptive_headroom = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.use-chmap")) {
 		state->props.use_chmap = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.multi-rate")) {
@@ -193,6 +227,8 @@ static int alsa_set_param(struct state *state, const char *k, const char *s)
 		state->htimestamp = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.htimestamp.max-errors")) {
 		state->htimestamp_max_errors = atoi(s);
+	} else if (spa_streq(k, "api.alsa.audio-tstamp")) {
+		state->audio_tstamp_type = audio_tstamp_type_from_name(s);
 	} else if (spa_streq(k, "api.alsa.auto-link")) {
 		state->auto_link = spa_atob(s);
 	} else if (spa_streq(k, "latency.internal.rate")) {
@@ -482,9 +518,25 @@ struct spa_pod *spa_alsa_enum_propinfo(struct state *state,
 			SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Int(state->htimestamp_max_errors, 0, INT32_MAX),
 			SPA_PROP_INFO_params, SPA_POD_Bool(true));
 		break;
+	case 19:
+		param = spa_pod_builder_add_object(b,
+			SPA_TYPE_OBJECT_PropInfo, SPA_PARAM_PropInfo,
+			SPA_PROP_INFO_name, SPA_POD_String("api.alsa.adaptive-headroom"),
+			SPA_PROP_INFO_description, SPA_POD_String("Adapt headroom to wakeup lateness"),
+			SPA_PROP_INFO_type, SPA_POD_Bool(state->adaptive_headroom),
+			SPA_PROP_INFO_params, SPA_POD_Bool(true));
+		break;
+	case 20:
+		param = spa_pod_builder_add_object(b,
+			SPA_TYPE_OBJECT_PropInfo, SPA_PARAM_PropInfo,
+			SPA_PROP_INFO_name, SPA_POD_String("api.alsa.audio-tstamp"),
+			SPA_PROP_INFO_description, SPA_POD_String("Audio timestamp type for rate matching"),
+			SPA_PROP_INFO_type, SPA_POD_String(audio_tstamp_type_name(state->audio_tstamp_type)),
+			SPA_PROP_INFO_params, SPA_POD_Bool(true));
+		break;
 	// While adding params here, update the math in default too
 	default:
-		idx -= 18;
+		idx -= 20;
 		if (idx <= state->num_bind_ctls)
 			param = enum_bind_ctl_propinfo(state, idx - 1, b);
 		else
@@ -625,6 +677,20 @@ int spa_alsa_add_prop_params(struct state *state, struct spa_pod_builder *b)
 	spa_pod_builder_string(b, "api.alsa.htimestamp.max-errors");
 	spa_pod_builder_int(b, state->htimestamp_max_errors);
 
+	spa_pod_builder_string(b, "api.alsa.adaptive-headroom");
+	spa_pod_builder_bool(b, state->adaptive_headroom);
+
+	spa_pod_builder_string(b, "api.alsa.audio-tstamp");
+	spa_pod_builder_string(b, audio_tstamp_type_name(state->audio_tstamp_type));
+
+	/* read-only stats */
+	spa_pod_builder_string(b, "api.alsa.dll-error");
+	spa_pod_builder_float(b, state->dll_err);
+
+	uint32_array_to_string(state->late_hist, LATE_HIST_SIZE, buf, sizeof(buf));
+	spa_pod_builder_string(b, "api.alsa.wakeup-late-histogram");
+	spa_pod_builder_string(b, buf);
+
 	spa_pod_builder_string(b, "latency.internal.rate");
 	spa_pod_builder_int(b, state->process_latency.rate);
 
@@ -954,6 +1020,7 @@ int spa_alsa_init(struct state *state, const struct spa_dict *info)
 	state->multi_rate = true;
 	state->htimestamp = false;
 	state->htimestamp_max_errors = MAX_HTIMESTAMP_ERROR;
+	state->adapt_headroom = 32u;
 	for (i = 0; info && i < info->n_items; i++) {
 		const char *k = info->items[i].key;
 		const char *s = info->items[i].value;
@@ -1990,8 +2057,11 @@ static void recalc_headroom(struct state *state)
 			state->headroom += state->period_frames;
 		/* Add 32 extra samples of headroom to handle jitter in capture.
 		 * For IRQ, we don't need this because when we wake up, we have
-		 * exactly enough samples to read or write. */
-		if (state->stream == SND_PCM_STREAM_CAPTURE)
+		 * exactly enough samples to read or write. With adaptive headroom,
+		 * the extra samples follow the measured wakeup lateness. */
+		if (state->adaptive_headroom)
+			state->headroom += state->adapt_headroom;
+		else if (state->stream == SND_PCM_STREAM_CAPTURE)
 			state->headroom = SPA_MAX(state->headroom, 32u);
 	}
 	if (SPA_LIKELY(state->buffer_frames >= state->threshold))
@@ -2324,6 +2394,15 @@ int spa_alsa_set_format(struct state *state, struct spa_audio_info *fmt, uint32_
 			periods, state->frame_size, state->headroom, state->start_delay,
 			state->is_batch, !state->disable_tsched);
 
+	state->use_audio_tstamp = false;
+	if (state->audio_tstamp_type != SND_PCM_AUDIO_TSTAMP_TYPE_COMPAT) {
+		state->use_audio_tstamp = snd_pcm_hw_params_supports_audio_ts_type(params,
+				state->audio_tstamp_type);
+		if (!state->use_audio_tstamp)
+			spa_log_warn(state->log, "%s: audio timestamp type %s not supported",
+					state->name, audio_tstamp_type_name(state->audio_tstamp_type));
+	}
+
 	/* write the parameters to device */
 	CHECK(snd_pcm_hw_params(hndl, params), "set_hw_params");
 
@@ -2548,6 +2627,7 @@ static inline int do_start(struct state *state)
 			return res;
 		}
 		state->alsa_started = true;
+		state->audio_tstamp_valid = false;
 	}
 	return 0;
 }
@@ -2645,6 +2725,68 @@ static inline snd_pcm_sframes_t alsa_avail(struct state *state)
 	return avail;
 }
 
+/* linked followers that use the same clock as their driver were started
+ * together with the driver and run sample aligned with it */
+static inline bool in_clock_group(struct state *state)
+{
+	struct state *driver = state->rt.driver;
+	return driver != NULL && driver != state && state->linked &&
+		!state->matching && state->rate == driver->rate;
+}
+
+/* Get the avail at current_time from the audio timestamp of the device. The
+ * audio timestamp gives the exact position of the device at the system time
+ * of the status, without the granularity of the hardware pointer. */
+static int get_audio_tstamp_avail(struct state *state, uint64_t current_time,
+		snd_pcm_sframes_t avail, double *result)
+{
+	snd_pcm_status_t *status;
+	snd_pcm_audio_tstamp_config_t config;
+	snd_pcm_audio_tstamp_report_t report;
+	snd_htimestamp_t tstamp, audio_tstamp;
+	uint64_t then;
+	double est, diff;
+	int res;
+
+	snd_pcm_status_alloca(&status);
+	spa_zero(config);
+	config.type_requested = state->audio_tstamp_type;
+	snd_pcm_status_set_audio_htstamp_config(status, &config);
+
+	if ((res = snd_pcm_status(state->hndl, status)) < 0)
+		return res;
+
+	snd_pcm_status_get_audio_htstamp_report(status, &report);
+	if (!report.valid || report.actual_type != (unsigned int)state->audio_tstamp_type)
+		return -ENOTSUP;
+
+	snd_pcm_status_get_htstamp(status, &tstamp);
+	snd_pcm_status_get_audio_htstamp(status, &audio_tstamp);
+	if ((then = SPA_TIMESPEC_TO_NSEC(&tstamp)) == 0)
+		return -EIO;
+
+	/* the avail follows the frames processed by the device. The offset
+	 * to the avail of the hardware pointer is constant, we average it to
+	 * remove the granularity of the pointer. */
+	est = (double)SPA_TIMESPEC_TO_NSEC(&audio_tstamp) * state->rate / SPA_NSEC_PER_SEC -
+		state->sample_count;
+	diff = avail - est - state->audio_tstamp_offset;
+	if (!state->audio_tstamp_valid || fabs(diff) > state->threshold) {
+		state->audio_tstamp_offset = avail - est;
+		state->audio_tstamp_valid = true;
+	} else {
+		state->audio_tstamp_offset += diff / 32.0;
+	}
+	est += state->audio_tstamp_offset;
+
+	/* and move it to the wakeup time */
+	diff = ((double)current_time - (double)then) * state->rate / SPA_NSEC_PER_SEC;
+	est += SPA_CLAMP(diff, -(double)state->threshold, (double)state->threshold);
+
+	*result = SPA_MAX(est, 0.0);
+	return 0;
+}
+
 static int get_avail(struct state *state, uint64_t current_time, snd_pcm_uframes_t *delay)
 {
 	int res, suppressed;
@@ -2664,8 +2806,25 @@ static int get_avail(struct state *state, uint64_t current_time, snd_pcm_uframes
 		state->alsa_recovering = false;
 	}
 	*delay = avail;
+	state->rt.htime_corr = 0;
+
+	if (in_clock_group(state)) {
+		/* the hardware timestamp of the driver is valid for us as well,
+		 * this saves a snd_pcm_htimestamp() call */
+		*delay += state->rt.driver->rt.htime_corr;
+	} else if (state->use_audio_tstamp) {
+		double est;
 
-	if (state->htimestamp) {
+		if ((res = get_audio_tstamp_avail(state, current_time, avail, &est)) < 0) {
+			if ((suppressed = spa_ratelimit_test(&state->rate_limit, current_time)) >= 0) {
+				spa_log_warn(state->log, "%s: (%d suppressed) audio timestamp error: %s",
+					state->name, suppressed, spa_strerror(res));
+			}
+			return avail;
+		}
+		*delay = (snd_pcm_uframes_t)est;
+		state->rt.htime_corr = (int64_t)*delay - avail;
+	} else if (state->htimestamp) {
 		snd_pcm_uframes_t havail;
 		snd_htimestamp_t tstamp;
 		uint64_t then;
@@ -2690,7 +2849,9 @@ static int get_avail(struct state *state, uint64_t current_time, snd_pcm_uframes
 			spa_log_trace_fp(state->log, "%"PRIu64" %"PRIu64" %"PRIi64, current_time, then, diff);
 
 			if (SPA_ABS(diff) < state->threshold * 3) {
-				*delay += SPA_CLAMP(diff, -((int64_t)state->threshold), (int64_t)state->threshold);
+				state->rt.htime_corr = SPA_CLAMP(diff, -((int64_t)state->threshold),
+						(int64_t)state->threshold);
+				*delay += state->rt.htime_corr;
 				state->htimestamp_error = 0;
 			} else if (state->htimestamp_max_errors) {
 				if (++state->htimestamp_error > state->htimestamp_max_errors) {
@@ -2709,15 +2870,40 @@ static int get_avail(struct state *state, uint64_t current_time, snd_pcm_uframes
 	return avail;
 }
 
+/* take the status of all followers in the clock group of the driver in one
+ * pass right after the driver, so that they are all sampled at the same time */
+static void get_group_status(struct state *state, uint64_t current_time)
+{
+	struct state *follower;
+
+	spa_list_for_each(follower, &state->rt.followers, rt.driver_link) {
+		if (follower == state || !in_clock_group(follower) ||
+		    !follower->alsa_started)
+			continue;
+		follower->rt.avail = get_avail(follower, current_time, &follower->rt.delay);
+		follower->rt.have_status = true;
+	}
+}
+
 static int get_status(struct state *state, uint64_t current_time, snd_pcm_uframes_t *avail,
 		snd_pcm_uframes_t *delay, snd_pcm_uframes_t *target)
 {
 	int res;
 	snd_pcm_uframes_t a, d;
 
-	if ((res = get_avail(state, current_time, &d)) < 0)
+	if (state->rt.have_status) {
+		state->rt.have_status = false;
+		res = state->rt.avail;
+		d = state->rt.delay;
+	} else {
+		res = get_avail(state, current_time, &d);
+	}
+	if (res < 0)
 		return res;
 
+	if (!state->following)
+		get_group_status(state, current_time);
+
 	a = SPA_MIN(res, (int)state->buffer_frames);
 
 	if (state->resample && state->rate_match) {
@@ -2740,6 +2926,61 @@ static int get_status(struct state *state, uint64_t current_time, snd_pcm_uframe
 	return 0;
 }
 
+static int do_emit_latency(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct state *state = user_data;
+
+	state->port_info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	state->port_params[PORT_Latency].user++;
+	spa_alsa_emit_port_info(state, false);
+
+	state->info.change_mask |= SPA_NODE_CHANGE_MASK_PROPS;
+	spa_alsa_emit_node_info(state, false);
+	return 0;
+}
+
+static void update_adaptive_headroom(struct state *state, uint64_t current_time,
+		double err, bool follower)
+{
+	struct state *driver = follower ? state->rt.driver : state;
+	uint64_t late;
+	uint32_t i, need, headroom;
+
+	state->dll_err = err;
+
+	/* followers use the wakeup lateness of their ALSA driver, we can't
+	 * measure it for other drivers */
+	if (driver == NULL)
+		return;
+
+	late = driver->wakeup_late;
+	for (i = 0; i < LATE_HIST_SIZE - 1 && late >= (SPA_NSEC_PER_USEC << i); i++);
+	state->late_hist[i]++;
+	state->late_max = SPA_MAX(state->late_max, late);
+
+	/* enough samples for the worst lateness in this period, with some margin */
+	need = (uint32_t)SPA_MIN(state->late_max * state->rate / SPA_NSEC_PER_SEC,
+			(uint64_t)state->buffer_frames);
+	need = SPA_MAX(need + need / 2, ADAPT_MIN);
+
+	/* grow right away, shrink slowly when the lateness stays low */
+	headroom = SPA_MAX(state->adapt_headroom, need);
+	if (current_time - state->adapt_time > ADAPT_PERIOD) {
+		if (need < headroom)
+			headroom -= (headroom - need + 3) / 4;
+		state->adapt_time = current_time;
+		state->late_max = 0;
+	}
+	if (headroom != state->adapt_headroom) {
+		spa_log_debug(state->log, "%s: adaptive headroom %u -> %u late:%"PRIu64" err:%f",
+				state->name, state->adapt_headroom, headroom, late, err);
+		state->adapt_headroom = headroom;
+		recalc_headroom(state);
+		spa_loop_invoke(state->main_loop, do_emit_latency, 0, NULL, 0, false, state);
+	}
+}
+
 static int update_time(struct state *state, uint64_t current_time, snd_pcm_sframes_t delay,
 		snd_pcm_sframes_t target, bool follower)
 {
@@ -2786,6 +3027,9 @@ static int update_time(struct state *state, uint64_t current_time, snd_pcm_sfram
 	else
 		corr = 1.0;
 
+	if (state->adaptive_headroom)
+		update_adaptive_headroom(state, current_time, err, follower);
+
 	if (diff < 0)
 		state->next_time += (uint64_t)(diff / corr * 1e9 / state->rate);
 
@@ -3013,9 +3257,15 @@ again:
 		n_bytes = n_frames * frame_size;
 
 		if (SPA_LIKELY(state->use_mmap)) {
-			for (i = 0; i < b->buf->n_datas; i++) {
-				spa_memcpy(channel_area_addr(&my_areas[i], off),
-						SPA_PTROFF(d[i].data, offs, void), n_bytes);
+			if (SPA_FLAG_IS_SET(d[0].chunk->flags, SPA_CHUNK_FLAG_EMPTY)) {
+				/* no need to read the data when it is marked as silence */
+				snd_pcm_areas_silence(my_areas, off, state->channels,
+						n_frames, state->format);
+			} else {
+				for (i = 0; i < b->buf->n_datas; i++) {
+					spa_memcpy(channel_area_addr(&my_areas[i], off),
+							SPA_PTROFF(d[i].data, offs, void), n_bytes);
+				}
 			}
 		} else {
 			void *bufs[b->buf->n_datas];
@@ -3075,13 +3325,46 @@ again:
 	return 0;
 }
 
+/* Buffers with dynamic data can point to the memory of the upstream
+ * node, which is only valid in this cycle. Copy what is left of them to
+ * their own memory before they are kept for the next cycle. */
+static void keep_ready_buffers(struct state *state)
+{
+	struct buffer *b;
+	uint32_t i, offs, size;
+
+	spa_list_for_each(b, &state->ready, link) {
+		struct spa_data *d = b->buf->datas;
+
+		if (!SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_DYNAMIC))
+			continue;
+
+		for (i = 0; i < b->buf->n_datas; i++) {
+			if (d[i].data == b->datas[i])
+				continue;
+			offs = SPA_MIN(d[i].chunk->offset, d[i].maxsize);
+			size = SPA_MIN(d[i].chunk->size, d[i].maxsize - offs);
+			spa_memcpy(SPA_PTROFF(b->datas[i], offs, void),
+					SPA_PTROFF(d[i].data, offs, void), size);
+			d[i].data = b->datas[i];
+		}
+	}
+}
+
 int spa_alsa_write(struct state *state)
 {
+	int res;
+
 	if (state->following && state->rt.driver == NULL) {
 		uint64_t current_time = state->position->clock.nsec;
 		alsa_write_sync(state, current_time);
 	}
-	return alsa_write_frames(state);
+	res = alsa_write_frames(state);
+
+	if (SPA_UNLIKELY(!spa_list_is_empty(&state->ready)))
+		keep_ready_buffers(state);
+
+	return res;
 }
 
 void spa_alsa_recycle_buffer(struct state *this, uint32_t buffer_id)
@@ -3111,6 +3394,7 @@ push_frames(struct state *state,
 		struct buffer *b;
 		struct spa_data *d;
 		uint32_t i, avail, l0, l1;
+		bool direct;
 
 		b = spa_list_first(&state->free, struct buffer, link);
 		spa_list_remove(&b->link);
@@ -3127,19 +3411,37 @@ push_frames(struct state *state,
 		total_frames = SPA_MIN(avail, frames);
 		n_bytes = total_frames * frame_size;
 
+		if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_DYNAMIC)) {
+			for (i = 0; i < b->buf->n_datas; i++)
+				d[i].data = b->datas[i];
+		}
+
 		if (my_areas) {
 			left = state->buffer_frames - offset;
 			l0 = SPA_MIN(n_bytes, left * frame_size);
 			l1 = n_bytes - l0;
 
+			/* When the buffer is consumed in this cycle, let it point
+			 * to the ringbuffer memory instead of copying. The committed
+			 * frames are only overwritten after the device captured
+			 * most of the ringbuffer again. */
+			direct = l1 == 0 && SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_DYNAMIC) &&
+				spa_list_is_empty(&state->ready);
+			for (i = 0; direct && i < b->buf->n_datas; i++)
+				direct = SPA_IS_ALIGNED(channel_area_addr(&my_areas[i], offset), 16);
+
 			for (i = 0; i < b->buf->n_datas; i++) {
-				spa_memcpy(d[i].data,
-						channel_area_addr(&my_areas[i], offset),
-						l0);
-				if (SPA_UNLIKELY(l1 > 0))
-					spa_memcpy(SPA_PTROFF(d[i].data, l0, void),
-							channel_area_addr(&my_areas[i], 0),
-							l1);
+				if (direct) {
+					d[i].data = channel_area_addr(&my_areas[i], offset);
+				} else {
+					spa_memcpy(d[i].data,
+							channel_area_addr(&my_areas[i], offset),
+							l0);
+					if (SPA_UNLIKELY(l1 > 0))
+						spa_memcpy(SPA_PTROFF(d[i].data, l0, void),
+								channel_area_addr(&my_areas[i], 0),
+								l1);
+				}
 				d[i].chunk->offset = 0;
 				d[i].chunk->size = n_bytes;
 				d[i].chunk->stride = frame_size;
@@ -3392,6 +3694,8 @@ static inline int alsa_do_wakeup_work(struct state *state, uint64_t current_time
 	struct state *follower;
 	int res;
 
+	SDT_PROBE(spa, alsa_wakeup, state->name, current_time, state->stream);
+
 	/* first do all the sync */
 	if (state->stream == SND_PCM_STREAM_CAPTURE)
 		res = alsa_read_sync(state, current_time);
@@ -3491,6 +3795,11 @@ static void alsa_timer_wakeup_event(struct spa_source *source)
 	}
 	current_time = state->next_time;
 
+	if (state->adaptive_headroom) {
+		uint64_t now = get_time_ns(state);
+		state->wakeup_late = now > current_time ? now - current_time : 0;
+	}
+
 	alsa_do_wakeup_work(state, current_time);
 
 	if (state->next_time > current_time + SPA_NSEC_PER_SEC ||
@@ -3538,6 +3847,7 @@ static int do_state_sync(struct spa_loop *loop, bool async, uint32_t seq,
 
 		if (rt->driver != state->driver) {
 			spa_dll_init(&state->dll);
+			rt->have_status = false;
 
 			if (rt->driver != NULL)
 				spa_list_remove(&rt->driver_link);
@@ -3612,6 +3922,11 @@ int spa_alsa_start(struct state *state)
 
 	spa_alsa_prepare(state);
 
+	state->adapt_time = 0;
+	state->late_max = 0;
+	state->wakeup_late = 0;
+	spa_zero(state->late_hist);
+
 	if (!state->disable_tsched) {
 		/* Timer-based scheduling */
 		state->source[0].func = alsa_timer_wakeup_event;
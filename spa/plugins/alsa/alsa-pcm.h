@@ -57,11 +57,14 @@ struct props {
 
 struct buffer {
 	uint32_t id;
-#define BUFFER_FLAG_OUT	(1<<0)
+#define BUFFER_FLAG_OUT		(1<<0)
+#define BUFFER_FLAG_DYNAMIC	(1<<1)
 	uint32_t flags;
 	struct spa_buffer *buf;
 	struct spa_meta_header *h;
 	struct spa_list link;
+	/* the memory of the buffer, the data can point to the ringbuffer */
+	void *datas[SPA_AUDIO_MAX_CHANNELS];
 };
 
 #define BW_MAX		0.128
@@ -69,6 +72,10 @@ struct buffer {
 #define BW_MIN		0.016
 #define BW_PERIOD	(3 * SPA_NSEC_PER_SEC)
 
+#define ADAPT_PERIOD	(1 * SPA_NSEC_PER_SEC)
+#define ADAPT_MIN	16u
+#define LATE_HIST_SIZE	16
+
 struct channel_map {
 	uint32_t channels;
 	uint32_t pos[SPA_AUDIO_MAX_CHANNELS];
@@ -91,6 +98,13 @@ struct rt_state {
 
 	unsigned int sources_added:1;
 	unsigned int following:1;
+
+	/* status taken together with the driver */
+	unsigned int have_status:1;
+	snd_pcm_sframes_t avail;
+	snd_pcm_uframes_t delay;
+	/* htimestamp delay correction of the last status */
+	int64_t htime_corr;
 };
 
 struct bound_ctl {
@@ -151,6 +165,8 @@ struct state {
 	unsigned int disable_mmap:1;
 	unsigned int disable_batch:1;
 	unsigned int disable_tsched:1;
+	unsigned int adaptive_headroom:1;
+	snd_pcm_audio_tstamp_type_t audio_tstamp_type;
 	char clock_name[64];
 	uint32_t quantum_limit;
 
@@ -204,6 +220,7 @@ struct state {
 	uint32_t max_delay;
 	uint32_t htimestamp_error;
 	uint32_t htimestamp_max_errors;
+	double audio_tstamp_offset;
 
 	struct spa_fraction driver_rate;
 	uint32_t driver_duration;
@@ -229,6 +246,8 @@ struct state {
 	unsigned int linked:1;
 	unsigned int is_batch:1;
 	unsigned int force_rate:1;
+	unsigned int use_audio_tstamp:1;
+	unsigned int audio_tstamp_valid:1;
 
 	uint64_t iec958_codecs;
 
@@ -244,6 +263,14 @@ struct state {
 	double max_error;
 	double max_resync;
 
+	/* adaptive headroom and wakeup stats, updated in the data thread */
+	uint32_t adapt_headroom;
+	uint64_t adapt_time;
+	uint64_t wakeup_late;		/* lateness of the last timer wakeup in nsec */
+	uint64_t late_max;		/* max wakeup lateness in this adapt period */
+	uint32_t late_hist[LATE_HIST_SIZE];	/* bucket n counts lateness < 2^n usec */
+	double dll_err;
+
 	struct spa_latency_info latency[2];
 	struct spa_process_latency_info process_latency;
 
@@ -16,6 +16,7 @@
 #include <spa/pod/filter.h>
 #include <spa/support/system.h>
 #include <spa/control/control.h>
+#include <spa/control/ump-utils.h>
 
 #include "alsa.h"
 
@@ -23,6 +24,9 @@
 
 #define CHECK(s,msg,...) if ((res = (s)) < 0) { spa_log_error(state->log, msg ": %s", ##__VA_ARGS__, snd_strerror(res)); return res; }
 
+/* room for the events of many devices in one cycle */
+#define SEQ_BUFFER_SIZE	(4096 * sizeof(snd_seq_event_t))
+
 static int seq_open(struct seq_state *state, struct seq_conn *conn, bool with_queue)
 {
 	struct props *props = &state->props;
@@ -66,6 +70,13 @@ static int seq_init(struct seq_state *state, struct seq_conn *conn, bool with_qu
 	if ((res = snd_seq_nonblock(conn->hndl, 1)) < 0)
 		spa_log_warn(state->log, "can't set nonblock mode: %s", snd_strerror(res));
 
+	if (with_queue) {
+		if ((res = snd_seq_set_input_buffer_size(conn->hndl, SEQ_BUFFER_SIZE)) < 0)
+			spa_log_warn(state->log, "can't set input buffer size: %s", snd_strerror(res));
+		if ((res = snd_seq_set_output_buffer_size(conn->hndl, SEQ_BUFFER_SIZE)) < 0)
+			spa_log_warn(state->log, "can't set output buffer size: %s", snd_strerror(res));
+	}
+
 	/* port for receiving */
 	snd_seq_port_info_alloca(&pinfo);
 	snd_seq_port_info_set_name(pinfo, "input");
@@ -520,10 +531,111 @@ static int process_recycle(struct seq_state *state)
 #define NSEC_TO_CLOCK(r,n) (((n) * (r)->denom) / ((r)->num * SPA_NSEC_PER_SEC))
 #define NSEC_FROM_CLOCK(r,n) (((n) * (r)->num * SPA_NSEC_PER_SEC) / (r)->denom)
 
+/* Decode the common short messages directly, other events go through the
+ * midi event codec */
+static inline long decode_short_event(const snd_seq_event_t *ev, uint8_t *data)
+{
+	const snd_seq_ev_note_t *n = &ev->data.note;
+	const snd_seq_ev_ctrl_t *c = &ev->data.control;
+	int32_t v;
+
+	switch (ev->type) {
+	case SND_SEQ_EVENT_NOTEOFF:
+	case SND_SEQ_EVENT_NOTEON:
+	case SND_SEQ_EVENT_KEYPRESS:
+		data[0] = (ev->type == SND_SEQ_EVENT_NOTEOFF ? 0x80 :
+			ev->type == SND_SEQ_EVENT_NOTEON ? 0x90 : 0xa0) | (n->channel & 0xf);
+		data[1] = n->note & 0x7f;
+		data[2] = n->velocity & 0x7f;
+		return 3;
+	case SND_SEQ_EVENT_CONTROLLER:
+		data[0] = 0xb0 | (c->channel & 0xf);
+		data[1] = c->param & 0x7f;
+		data[2] = c->value & 0x7f;
+		return 3;
+	case SND_SEQ_EVENT_PGMCHANGE:
+	case SND_SEQ_EVENT_CHANPRESS:
+		data[0] = (ev->type == SND_SEQ_EVENT_PGMCHANGE ? 0xc0 : 0xd0) | (c->channel & 0xf);
+		data[1] = c->value & 0x7f;
+		return 2;
+	case SND_SEQ_EVENT_PITCHBEND:
+		v = SPA_CLAMP(c->value + 8192, 0, 16383);
+		data[0] = 0xe0 | (c->channel & 0xf);
+		data[1] = v & 0x7f;
+		data[2] = (v >> 7) & 0x7f;
+		return 3;
+	case SND_SEQ_EVENT_CLOCK:
+		data[0] = 0xf8;
+		return 1;
+	case SND_SEQ_EVENT_START:
+		data[0] = 0xfa;
+		return 1;
+	case SND_SEQ_EVENT_CONTINUE:
+		data[0] = 0xfb;
+		return 1;
+	case SND_SEQ_EVENT_STOP:
+		data[0] = 0xfc;
+		return 1;
+	case SND_SEQ_EVENT_SENSING:
+		data[0] = 0xfe;
+		return 1;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/* Encode a control with exactly one complete short message directly, returns
+ * the number of bytes used or 0 when the midi event codec should be used */
+static inline long encode_short_event(const uint8_t *data, long size, snd_seq_event_t *ev)
+{
+	uint8_t ch = data[0] & 0xf;
+
+	switch (data[0] & 0xf0) {
+	case 0x80:
+		if (size != 3 || ((data[1] | data[2]) & 0x80))
+			return 0;
+		snd_seq_ev_set_noteoff(ev, ch, data[1], data[2]);
+		return 3;
+	case 0x90:
+		if (size != 3 || ((data[1] | data[2]) & 0x80))
+			return 0;
+		snd_seq_ev_set_noteon(ev, ch, data[1], data[2]);
+		return 3;
+	case 0xa0:
+		if (size != 3 || ((data[1] | data[2]) & 0x80))
+			return 0;
+		snd_seq_ev_set_keypress(ev, ch, data[1], data[2]);
+		return 3;
+	case 0xb0:
+		if (size != 3 || ((data[1] | data[2]) & 0x80))
+			return 0;
+		snd_seq_ev_set_controller(ev, ch, data[1], data[2]);
+		return 3;
+	case 0xc0:
+		if (size != 2 || (data[1] & 0x80))
+			return 0;
+		snd_seq_ev_set_pgmchange(ev, ch, data[1]);
+		return 2;
+	case 0xd0:
+		if (size != 2 || (data[1] & 0x80))
+			return 0;
+		snd_seq_ev_set_chanpress(ev, ch, data[1]);
+		return 2;
+	case 0xe0:
+		if (size != 3 || ((data[1] | data[2]) & 0x80))
+			return 0;
+		snd_seq_ev_set_pitchbend(ev, ch, ((data[2] << 7) | data[1]) - 8192);
+		return 3;
+	default:
+		return 0;
+	}
+}
+
 static int process_read(struct seq_state *state)
 {
 	snd_seq_event_t *ev;
 	struct seq_stream *stream = &state->streams[SPA_DIRECTION_OUTPUT];
+	struct seq_port *port = NULL;
 	uint32_t i;
 	long size;
 	uint8_t data[MAX_EVENT_SIZE];
@@ -532,13 +644,18 @@ static int process_read(struct seq_state *state)
 	/* copy all new midi events into their port buffers */
 	while ((res = snd_seq_event_input(state->event.hndl, &ev)) > 0) {
 		const snd_seq_addr_t *addr = &ev->source;
-		struct seq_port *port;
 		uint64_t ev_time, diff;
 		uint32_t offset;
 
 		debug_event(state, ev);
 
-		if ((port = find_port(state, stream, addr)) == NULL) {
+		/* events usually come in runs from the same port */
+		if (port == NULL ||
+		    port->addr.client != addr->client ||
+		    port->addr.port != addr->port)
+			port = find_port(state, stream, addr);
+
+		if (port == NULL) {
 			spa_log_debug(state->log, "unknown port %d.%d",
 					addr->client, addr->port);
 			continue;
@@ -552,10 +669,12 @@ static int process_read(struct seq_state *state)
 			continue;
 		}
 
-		snd_midi_event_reset_decode(stream->codec);
-		if ((size = snd_midi_event_decode(stream->codec, data, MAX_EVENT_SIZE, ev)) < 0) {
-			spa_log_warn(state->log, "decode failed: %s", snd_strerror(size));
-			continue;
+		if ((size = decode_short_event(ev, data)) < 0) {
+			snd_midi_event_reset_decode(stream->codec);
+			if ((size = snd_midi_event_decode(stream->codec, data, MAX_EVENT_SIZE, ev)) < 0) {
+				spa_log_warn(state->log, "decode failed: %s", snd_strerror(size));
+				continue;
+			}
 		}
 
 		/* queue_time is the estimated current time of the queue as calculated by
@@ -687,20 +806,31 @@ static int process_write(struct seq_state *state)
 
 		SPA_POD_SEQUENCE_FOREACH(pod, c) {
 			long s, body_size;
-			uint8_t *body;
-
-			if (c->type != SPA_CONTROL_Midi)
+			uint8_t *body, midi[16];
+
+			switch (c->type) {
+			case SPA_CONTROL_Midi:
+				body = SPA_POD_BODY(&c->value);
+				body_size = SPA_POD_BODY_SIZE(&c->value);
+				break;
+			case SPA_CONTROL_UMP:
+				body = midi;
+				body_size = spa_ump_to_midi(SPA_POD_BODY(&c->value),
+						SPA_POD_BODY_SIZE(&c->value), midi, sizeof(midi));
+				break;
+			default:
 				continue;
-
-			body = SPA_POD_BODY(&c->value);
-			body_size = SPA_POD_BODY_SIZE(&c->value);
+			}
 
 			while (body_size > 0) {
 				if (size == 0)
 					/* only reset when we start decoding a new message */
 					snd_seq_ev_clear(&ev);
 
-				if ((s = snd_midi_event_encode(stream->codec,
+				if (size == 0 &&
+				    (s = encode_short_event(body, body_size, &ev)) > 0) {
+					/* complete short message, no need for the codec */
+				} else if ((s = snd_midi_event_encode(stream->codec,
 							body, body_size, &ev)) < 0) {
 					spa_log_warn(state->log, "failed to encode event: %s",
 							snd_strerror(s));
@@ -14,6 +14,7 @@
 #include <libudev.h>
 #include <alsa/asoundlib.h>
 
+#include <spa/utils/atomic.h>
 #include <spa/utils/cleanup.h>
 #include <spa/utils/type.h>
 #include <spa/utils/keys.h>
@@ -22,6 +23,7 @@
 #include <spa/utils/string.h>
 #include <spa/support/loop.h>
 #include <spa/support/plugin.h>
+#include <spa/support/thread.h>
 #include <spa/monitor/device.h>
 #include <spa/monitor/utils.h>
 #include <spa/debug/log.h>
@@ -30,6 +32,8 @@
 #include "alsa.h"
 
 #define MAX_CARDS	64
+#define MAX_INSPECT_THREADS	16
+#define DEFAULT_INSPECT_THREADS	4
 
 enum action {
 	ACTION_CHANGE,
@@ -48,6 +52,10 @@ struct card {
 	unsigned int accessible:1;
 	unsigned int ignored:1;
 	unsigned int emitted:1;
+	/* a worker thread is inspecting the card */
+	unsigned int inspecting:1;
+	/* the card changed while it was inspected */
+	unsigned int changed:1;
 
 	/* Local SPA object IDs. (Global IDs are produced by PipeWire
 	 * out of this using its registry.) Compress-Offload or PCM
@@ -61,6 +69,20 @@ struct card {
 	uint32_t compress_offload_device_id;
 };
 
+/* The devices of a card. This is found without touching the impl state,
+ * so that it can be done in a worker thread. */
+struct card_info {
+	unsigned int card_nr;
+	int res;
+	int num_pcm_devices;
+	int num_compress_offload_devices;
+	char *name;
+	char *longname;
+	uint64_t inspect_nsec;
+	int done;
+	bool handled;
+};
+
 static uint32_t calc_pcm_device_id(struct card *card)
 {
 	return (card->card_nr + 1) * 2 + 0;
@@ -78,6 +100,7 @@ struct impl {
 	struct spa_log *log;
 	struct spa_loop *main_loop;
 	struct spa_system *main_system;
+	struct spa_thread_utils *thread_utils;
 
 	struct spa_hook_list hooks;
 
@@ -94,6 +117,20 @@ struct impl {
 	struct spa_source notify;
 	unsigned int use_acp:1;
 	unsigned int expose_busy:1;
+	unsigned int enumerating:1;
+
+	/* cards found while enumerating are inspected in worker threads */
+	uint32_t inspect_threads;
+	struct {
+		struct card_info jobs[MAX_CARDS];
+		uint32_t n_jobs;
+		uint32_t n_done;
+		uint32_t next_job;
+		int stop;
+		struct spa_thread *threads[MAX_INSPECT_THREADS];
+		uint32_t n_threads;
+		struct spa_source source;
+	} inspect;
 };
 
 static int impl_udev_open(struct impl *this)
@@ -352,8 +389,8 @@ static int check_udev_environment(struct udev *udev, const char *devname)
 	return ret;
 }
 
-static int check_pcm_device_availability(struct impl *this, struct card *card,
-                                         int *num_pcm_devices)
+static int check_pcm_device_availability(struct impl *this, struct udev *udev,
+                                         unsigned int card_nr, int *num_pcm_devices)
 {
 	char path[PATH_MAX];
 	char buf[16];
@@ -361,16 +398,16 @@ static int check_pcm_device_availability(struct impl *this, struct card *card,
 	struct dirent *entry, *entry_pcm;
 	int res;
 
-	res = get_num_pcm_devices(card->card_nr);
+	res = get_num_pcm_devices(card_nr);
 	if (res < 0) {
 		spa_log_error(this->log, "Error finding PCM devices for ALSA card %u: %s",
-			card->card_nr, spa_strerror(res));
+			card_nr, spa_strerror(res));
 		return res;
 	}
 	*num_pcm_devices = res;
 
 	spa_log_debug(this->log, "card %u has %d PCM device(s)",
-	              card->card_nr, *num_pcm_devices);
+	              card_nr, *num_pcm_devices);
 
 	/*
 	 * Check if some pcm devices of the card are busy.  Check it via /proc, as we
@@ -386,7 +423,7 @@ static int check_pcm_device_availability(struct impl *this, struct card *card,
 	if (this->expose_busy)
 		return res;
 
-	spa_scnprintf(path, sizeof(path), "/proc/asound/card%u", card->card_nr);
+	spa_scnprintf(path, sizeof(path), "/proc/asound/card%u", card_nr);
 
 	spa_autoptr(DIR) card_dir = opendir(path);
 	if (card_dir == NULL)
@@ -398,16 +435,16 @@ static int check_pcm_device_availability(struct impl *this, struct card *card,
 			continue;
 
 		spa_scnprintf(path, sizeof(path), "pcmC%uD%s",
-				card->card_nr, entry->d_name+3);
+				card_nr, entry->d_name+3);
 		if (check_device_pcm_class(path) < 0)
 			continue;
 		/* Check udev environment */
-		if (check_udev_environment(this->udev, path) < 0)
+		if (check_udev_environment(udev, path) < 0)
 			continue;
 
 		/* Check busy status */
 		spa_scnprintf(path, sizeof(path), "/proc/asound/card%u/%s",
-				card->card_nr, entry->d_name);
+				card_nr, entry->d_name);
 
 		spa_autoptr(DIR) pcm = opendir(path);
 		if (pcm == NULL)
@@ -419,7 +456,7 @@ static int check_pcm_device_availability(struct impl *this, struct card *card,
 				continue;
 
 			spa_scnprintf(path, sizeof(path), "/proc/asound/card%u/%s/%s/status",
-					card->card_nr, entry->d_name, entry_pcm->d_name);
+					card_nr, entry->d_name, entry_pcm->d_name);
 
 			spa_autoptr(FILE) f = fopen(path, "re");
 			if (f == NULL)
@@ -429,12 +466,12 @@ static int check_pcm_device_availability(struct impl *this, struct card *card,
 
 			if (!spa_strstartswith(buf, "closed")) {
 				spa_log_debug(this->log, "card %u pcm device %s busy",
-						card->card_nr, entry->d_name);
+						card_nr, entry->d_name);
 				res = -EBUSY;
 				goto done;
 			}
 			spa_log_debug(this->log, "card %u pcm device %s free",
-					card->card_nr, entry->d_name);
+					card_nr, entry->d_name);
 		}
 		if (errno != 0)
 			goto done;
@@ -445,49 +482,89 @@ static int check_pcm_device_availability(struct impl *this, struct card *card,
 done:
 	if (errno != 0) {
 		spa_log_info(this->log, "card %u: failed to find busy status (%s)",
-				card->card_nr, spa_strerror(-errno));
+				card_nr, spa_strerror(-errno));
 	}
 
 	return res;
 }
 
-static int check_compress_offload_device_availability(struct impl *this, struct card *card,
+static int check_compress_offload_device_availability(struct impl *this, unsigned int card_nr,
                                                       int *num_compress_offload_devices)
 {
 	int res;
 
-	res = get_num_compress_offload_devices(card->card_nr);
+	res = get_num_compress_offload_devices(card_nr);
 	if (res < 0) {
 		spa_log_error(this->log, "Error finding Compress-Offload devices for ALSA card %u: %s",
-			card->card_nr, spa_strerror(res));
+			card_nr, spa_strerror(res));
 		return res;
 	}
 	*num_compress_offload_devices = res;
 
 	spa_log_debug(this->log, "card %u has %d Compress-Offload device(s)",
-	              card->card_nr, *num_compress_offload_devices);
+	              card_nr, *num_compress_offload_devices);
 
 	return 0;
 }
 
-static int emit_added_object_info(struct impl *this, struct card *card)
+static uint64_t get_time_ns(struct impl *this)
 {
-	char path[32];
-	int res, num_pcm_devices, num_compress_offload_devices;
-	const char *str;
-	struct udev_device *udev_device = card->udev_device;
+	struct timespec ts;
+	spa_system_clock_gettime(this->main_system, CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void inspect_card(struct impl *this, struct udev *udev, struct card_info *info)
+{
+	uint64_t start = get_time_ns(this);
+
+	info->name = info->longname = NULL;
+
+	if ((info->res = check_pcm_device_availability(this, udev, info->card_nr,
+					&info->num_pcm_devices)) < 0)
+		goto done;
+	if ((info->res = check_compress_offload_device_availability(this, info->card_nr,
+					&info->num_compress_offload_devices)) < 0)
+		goto done;
 
 	/*
-	 * inotify close events under /dev/snd must not be emitted, except after setting
-	 * card->emitted to true. alsalib functions can be used after that.
+	 * This opens the control device. The inotify close event must be handled only
+	 * after card->emitted is set to true, which happens before the main loop
+	 * processes the event or, in a worker thread, because the card is marked
+	 * as inspecting.
 	 */
+	if (info->num_pcm_devices > 0) {
+		if (snd_card_get_name(info->card_nr, &info->name) < 0)
+			info->name = NULL;
+		if (snd_card_get_longname(info->card_nr, &info->longname) < 0)
+			info->longname = NULL;
+	}
+done:
+	info->inspect_nsec = get_time_ns(this) - start;
+}
+
+static void card_info_clear(struct card_info *info)
+{
+	free(info->name);
+	free(info->longname);
+	info->name = info->longname = NULL;
+}
+
+static int emit_added_object_info(struct impl *this, struct card *card,
+		const struct card_info *card_info)
+{
+	char path[32];
+	int num_pcm_devices, num_compress_offload_devices;
+	const char *str;
+	struct udev_device *udev_device = card->udev_device;
 
 	snprintf(path, sizeof(path), "hw:%u", card->card_nr);
 
-	if ((res = check_pcm_device_availability(this, card, &num_pcm_devices)) < 0)
-		return res;
-	if ((res = check_compress_offload_device_availability(this, card, &num_compress_offload_devices)) < 0)
-		return res;
+	if (card_info->res < 0)
+		return card_info->res;
+
+	num_pcm_devices = card_info->num_pcm_devices;
+	num_compress_offload_devices = card_info->num_compress_offload_devices;
 
 	if ((num_pcm_devices == 0) && (num_compress_offload_devices == 0)) {
 		spa_log_debug(this->log, "no PCM and no Compress-Offload devices for %s", path);
@@ -499,7 +576,6 @@ static int emit_added_object_info(struct impl *this, struct card *card)
 
 	if (num_pcm_devices > 0) {
 		struct spa_device_object_info info;
-		char *cn = NULL, *cln = NULL;
 		struct spa_dict_item items[25];
 		unsigned int n_items = 0;
 
@@ -523,10 +599,10 @@ static int emit_added_object_info(struct impl *this, struct card *card)
 		items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_MEDIA_CLASS, "Audio/Device");
 		items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_PATH, path);
 		items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_CARD, path+3);
-		if (snd_card_get_name(card->card_nr, &cn) >= 0)
-			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_CARD_NAME, cn);
-		if (snd_card_get_longname(card->card_nr, &cln) >= 0)
-			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_CARD_LONGNAME, cln);
+		if (card_info->name != NULL)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_CARD_NAME, card_info->name);
+		if (card_info->longname != NULL)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_API_ALSA_CARD_LONGNAME, card_info->longname);
 
 		if ((str = udev_device_get_property_value(udev_device, "ACP_NAME")) && *str)
 			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_DEVICE_NAME, str);
@@ -614,8 +690,6 @@ static int emit_added_object_info(struct impl *this, struct card *card)
 		spa_debug_log_dict(this->log, SPA_LOG_LEVEL_DEBUG, 2, info.props);
 
 		spa_device_emit_object_info(&this->hooks, card->pcm_device_id, &info);
-		free(cn);
-		free(cln);
 	} else {
 		card->pcm_device_id = ID_DEVICE_NOT_SUPPORTED;
 	}
@@ -719,6 +793,45 @@ static bool check_access(struct impl *this, struct card *card)
 	return card->accessible;
 }
 
+static void card_added(struct impl *this, struct card *card, const struct card_info *info)
+{
+	uint64_t start = get_time_ns(this);
+	int res;
+
+	res = emit_added_object_info(this, card, info);
+	if (res < 0) {
+		if (card->ignored)
+			spa_log_info(this->log, "ALSA card %u unavailable (%s): it is ignored",
+					card->card_nr, spa_strerror(res));
+		else if (!card->unavailable)
+			spa_log_info(this->log, "ALSA card %u unavailable (%s): wait for it",
+					card->card_nr, spa_strerror(res));
+		else
+			spa_log_debug(this->log, "ALSA card %u still unavailable (%s)",
+					card->card_nr, spa_strerror(res));
+		card->unavailable = true;
+	} else {
+		if (card->unavailable)
+			spa_log_info(this->log, "ALSA card %u now available",
+					card->card_nr);
+		card->unavailable = false;
+
+		/* emitting includes the time the listener takes to make the device */
+		spa_log_info(this->log, "ALSA card %u inspected in %.3fms, emitted in %.3fms",
+				card->card_nr, info->inspect_nsec / 1e6,
+				(get_time_ns(this) - start) / 1e6);
+	}
+}
+
+static void queue_inspect(struct impl *this, struct card *card)
+{
+	struct card_info *info = &this->inspect.jobs[this->inspect.n_jobs++];
+
+	spa_zero(*info);
+	info->card_nr = card->card_nr;
+	card->inspecting = true;
+}
+
 static void process_card(struct impl *this, enum action action, struct card *card)
 {
 	if (card->ignored)
@@ -726,26 +839,21 @@ static void process_card(struct impl *this, enum action action, struct card *car
 
 	switch (action) {
 	case ACTION_CHANGE: {
+		if (card->inspecting) {
+			card->changed = true;
+			break;
+		}
 		check_access(this, card);
 		if (card->accessible && !card->emitted) {
-			int res = emit_added_object_info(this, card);
-			if (res < 0) {
-				if (card->ignored)
-					spa_log_info(this->log, "ALSA card %u unavailable (%s): it is ignored",
-							card->card_nr, spa_strerror(res));
-				else if (!card->unavailable)
-					spa_log_info(this->log, "ALSA card %u unavailable (%s): wait for it",
-							card->card_nr, spa_strerror(res));
-				else
-					spa_log_debug(this->log, "ALSA card %u still unavailable (%s)",
-							card->card_nr, spa_strerror(res));
-				card->unavailable = true;
-			} else {
-				if (card->unavailable)
-					spa_log_info(this->log, "ALSA card %u now available",
-							card->card_nr);
-				card->unavailable = false;
+			struct card_info info = { .card_nr = card->card_nr };
+
+			if (this->enumerating && this->inspect_threads > 0) {
+				queue_inspect(this, card);
+				break;
 			}
+			inspect_card(this, this->udev, &info);
+			card_added(this, card, &info);
+			card_info_clear(&info);
 		} else if (!card->accessible && card->emitted) {
 			card->emitted = false;
 
@@ -792,6 +900,148 @@ static void process_udev_device(struct impl *this, enum action action, struct ud
 	process_card(this, action, card);
 }
 
+static void *inspect_thread(void *data)
+{
+	struct impl *this = data;
+	struct udev *udev;
+	uint32_t idx;
+
+	/* udev objects can't be shared between threads */
+	udev = udev_new();
+
+	while (!SPA_ATOMIC_LOAD(this->inspect.stop)) {
+		struct card_info *info;
+
+		idx = SPA_ATOMIC_INC(this->inspect.next_job) - 1;
+		if (idx >= this->inspect.n_jobs)
+			break;
+
+		info = &this->inspect.jobs[idx];
+		inspect_card(this, udev, info);
+		SPA_ATOMIC_STORE(info->done, 1);
+		spa_system_eventfd_write(this->main_system, this->inspect.source.fd, 1);
+	}
+	if (udev)
+		udev_unref(udev);
+	return NULL;
+}
+
+static void inspect_done(struct impl *this, struct card_info *info)
+{
+	struct card *card;
+	bool changed;
+
+	if ((card = find_card(this, info->card_nr)) == NULL || !card->inspecting)
+		return;
+
+	changed = card->changed;
+	card->inspecting = card->changed = false;
+
+	if (card->ignored || !check_access(this, card) || card->emitted)
+		return;
+
+	card_added(this, card, info);
+
+	/* events that arrived while inspecting were skipped, check again */
+	if (changed && !card->emitted)
+		process_card(this, ACTION_CHANGE, card);
+}
+
+static void stop_inspect(struct impl *this)
+{
+	uint32_t i;
+
+	SPA_ATOMIC_STORE(this->inspect.stop, 1);
+	for (i = 0; i < this->inspect.n_threads; i++)
+		spa_thread_utils_join(this->thread_utils, this->inspect.threads[i], NULL);
+	this->inspect.n_threads = 0;
+
+	if (this->inspect.source.fd != -1) {
+		spa_loop_remove_source(this->main_loop, &this->inspect.source);
+		spa_system_close(this->main_system, this->inspect.source.fd);
+		this->inspect.source.fd = -1;
+	}
+	for (i = 0; i < this->inspect.n_jobs; i++)
+		card_info_clear(&this->inspect.jobs[i]);
+	this->inspect.n_jobs = 0;
+}
+
+static void on_inspect_done(struct spa_source *source)
+{
+	struct impl *this = source->data;
+	uint64_t count;
+	uint32_t i;
+
+	if (spa_system_eventfd_read(this->main_system, source->fd, &count) < 0)
+		return;
+
+	for (i = 0; i < this->inspect.n_jobs; i++) {
+		struct card_info *info = &this->inspect.jobs[i];
+
+		if (info->handled || !SPA_ATOMIC_LOAD(info->done))
+			continue;
+
+		info->handled = true;
+		this->inspect.n_done++;
+		inspect_done(this, info);
+	}
+	if (this->inspect.n_done == this->inspect.n_jobs)
+		stop_inspect(this);
+}
+
+/* Inspect the queued cards in worker threads and emit them from the main
+ * loop as they complete. */
+static void start_inspect(struct impl *this)
+{
+	uint32_t i, n_threads;
+	int fd;
+
+	if (this->inspect.n_jobs == 0)
+		return;
+
+	this->inspect.n_done = 0;
+	this->inspect.next_job = 0;
+	this->inspect.stop = 0;
+
+	fd = spa_system_eventfd_create(this->main_system, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+	if (fd < 0) {
+		spa_log_warn(this->log, "can't create eventfd: %s", spa_strerror(fd));
+		goto inline_inspect;
+	}
+	this->inspect.source.func = on_inspect_done;
+	this->inspect.source.data = this;
+	this->inspect.source.fd = fd;
+	this->inspect.source.mask = SPA_IO_IN | SPA_IO_ERR;
+	spa_loop_add_source(this->main_loop, &this->inspect.source);
+
+	n_threads = SPA_MIN(this->inspect_threads, this->inspect.n_jobs);
+	for (i = 0; i < n_threads; i++) {
+		struct spa_thread *thread;
+
+		thread = spa_thread_utils_create(this->thread_utils, NULL, inspect_thread, this);
+		if (thread == NULL) {
+			spa_log_warn(this->log, "can't create inspect thread: %m");
+			break;
+		}
+		this->inspect.threads[this->inspect.n_threads++] = thread;
+	}
+	if (this->inspect.n_threads > 0) {
+		spa_log_info(this->log, "inspecting %u cards with %u threads",
+				this->inspect.n_jobs, this->inspect.n_threads);
+		return;
+	}
+
+inline_inspect:
+	for (i = 0; i < this->inspect.n_jobs; i++) {
+		struct card_info *info = &this->inspect.jobs[i];
+
+		inspect_card(this, this->udev, info);
+		info->handled = true;
+		inspect_done(this, info);
+	}
+	stop_inspect(this);
+}
+
 static int stop_inotify(struct impl *this)
 {
 	if (this->notify.fd == -1)
@@ -945,6 +1195,7 @@ static int stop_monitor(struct impl *this)
 	if (this->umonitor == NULL)
 		return 0;
 
+	stop_inspect(this);
         clear_cards (this);
 
 	spa_loop_remove_source(this->main_loop, &this->source);
@@ -968,6 +1219,7 @@ static int enum_cards(struct impl *this)
 	udev_enumerate_add_match_subsystem(enumerate, "sound");
 	udev_enumerate_scan_devices(enumerate);
 
+	this->enumerating = this->thread_utils != NULL && this->inspect.n_jobs == 0;
 	for (udev_devices = udev_enumerate_get_list_entry(enumerate); udev_devices;
 			udev_devices = udev_list_entry_get_next(udev_devices)) {
 		struct udev_device *udev_device;
@@ -983,6 +1235,11 @@ static int enum_cards(struct impl *this)
 	}
 	udev_enumerate_unref(enumerate);
 
+	if (this->enumerating) {
+		this->enumerating = false;
+		start_inspect(this);
+	}
+
 	return 0;
 }
 
@@ -1100,11 +1357,13 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this = (struct impl *) handle;
 	this->notify.fd = -1;
+	this->inspect.source.fd = -1;
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	alsa_log_topic_init(this->log);
 	this->main_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
 	this->main_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_System);
+	this->thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
 
 	if (this->main_loop == NULL) {
 		spa_log_error(this->log, "a main-loop is needed");
@@ -1125,13 +1384,17 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info_all = SPA_DEVICE_CHANGE_MASK_FLAGS |
 			SPA_DEVICE_CHANGE_MASK_PROPS;
 	this->info.flags = 0;
+	this->inspect_threads = DEFAULT_INSPECT_THREADS;
 
 	if (info) {
 		if ((str = spa_dict_lookup(info, "alsa.use-acp")) != NULL)
 			this->use_acp = spa_atob(str);
 		else if ((str = spa_dict_lookup(info, "alsa.udev.expose-busy")) != NULL)
 			this->expose_busy = spa_atob(str);
+		if ((str = spa_dict_lookup(info, "alsa.udev.inspect-threads")) != NULL)
+			spa_atou32(str, &this->inspect_threads, 0);
 	}
+	this->inspect_threads = SPA_MIN(this->inspect_threads, MAX_INSPECT_THREADS);
 
 	return 0;
 }
@@ -83,6 +83,7 @@ struct impl {
 	uint32_t convert_params_flags[N_NODE_PARAMS];
 	uint32_t follower_params_flags[N_NODE_PARAMS];
 	uint64_t follower_port_flags;
+	unsigned int follower_dynamic:1;
 
 	struct spa_hook_list hooks;
 	struct spa_callbacks callbacks;
@@ -385,7 +386,7 @@ static int negotiate_buffers(struct impl *this)
 	int res;
 	bool follower_alloc, conv_alloc;
 	uint32_t i, size, buffers, blocks, align, flags, stride = 0;
-	uint32_t *aligns;
+	uint32_t *aligns, data_flags;
 	struct spa_data *datas;
 	uint64_t follower_flags, conv_flags;
 
@@ -451,17 +452,25 @@ static int negotiate_buffers(struct impl *this)
 	if (this->async)
 		buffers = SPA_MAX(2u, buffers);
 
-	spa_log_debug(this->log, "%p: buffers:%d, blocks:%d, size:%d, stride:%d align:%d %d:%d",
-			this, buffers, blocks, size, stride, align, follower_alloc, conv_alloc);
+	spa_log_debug(this->log, "%p: buffers:%d, blocks:%d, size:%d, stride:%d align:%d %d:%d dynamic:%d",
+			this, buffers, blocks, size, stride, align, follower_alloc, conv_alloc,
+			this->follower_dynamic);
 
 	align = SPA_MAX(align, this->max_align);
 
+	/* when the follower can handle it, let the converter point the
+	 * buffers to its input memory when nothing needs to be converted.
+	 * In async mode, the follower might use the data in a later cycle. */
+	data_flags = SPA_DATA_FLAG_READWRITE;
+	if (this->follower_dynamic && !this->async)
+		data_flags |= SPA_DATA_FLAG_DYNAMIC;
+
 	datas = alloca(sizeof(struct spa_data) * blocks);
 	memset(datas, 0, sizeof(struct spa_data) * blocks);
 	aligns = alloca(sizeof(uint32_t) * blocks);
 	for (i = 0; i < blocks; i++) {
 		datas[i].type = SPA_DATA_MemPtr;
-		datas[i].flags = SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC;
+		datas[i].flags = data_flags;
 		datas[i].maxsize = size;
 		aligns[i] = align;
 	}
@@ -1257,6 +1266,7 @@ static void follower_port_info(void *data,
 		(SPA_PORT_FLAG_LIVE |
 		 SPA_PORT_FLAG_PHYSICAL |
 		 SPA_PORT_FLAG_TERMINAL);
+	this->follower_dynamic = SPA_FLAG_IS_SET(info->flags, SPA_PORT_FLAG_DYNAMIC_DATA);
 
 	spa_log_debug(this->log, "%p: follower port info %s %p %08"PRIx64" recalc:%u", this,
 			this->direction == SPA_DIRECTION_INPUT ?
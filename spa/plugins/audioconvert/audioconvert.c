@@ -17,6 +17,7 @@
 #include <spa/utils/names.h>
 #include <spa/utils/string.h>
 #include <spa/utils/ratelimit.h>
+#include <spa/utils/atomic.h>
 #include <spa/node/node.h>
 #include <spa/node/io.h>
 #include <spa/node/utils.h>
@@ -30,6 +31,7 @@
 #include <spa/debug/types.h>
 
 #include "volume-ops.h"
+#include "peaks-ops.h"
 #include "fmt-ops.h"
 #include "channelmix-ops.h"
 #include "resample.h"
@@ -47,6 +49,11 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.audioconvert");
 #define MAX_DATAS	SPA_AUDIO_MAX_CHANNELS
 #define MAX_PORTS	(SPA_AUDIO_MAX_CHANNELS+1)
 
+/* bytes of one tmp buffer for all channels of a tile */
+#define TILE_BYTES	(32 * 1024)
+#define MIN_TILE	64u
+#define MAX_TILE	1024u
+
 #define DEFAULT_MUTE		false
 #define DEFAULT_VOLUME		VOLUME_NORM
 #define DEFAULT_MIN_VOLUME	0.0
@@ -156,6 +163,7 @@ struct port {
 	unsigned int is_dsp:1;
 	unsigned int is_monitor:1;
 	unsigned int is_control:1;
+	unsigned int is_dynamic:1;
 
 	uint32_t blocks;
 	uint32_t stride;
@@ -193,6 +201,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_loop *main_loop;
 
 	uint32_t cpu_flags;
 	uint32_t max_align;
@@ -205,6 +214,9 @@ struct impl {
 
 	struct spa_io_position *io_position;
 	struct spa_io_rate_match *io_rate_match;
+	struct spa_io_volumes *io_volumes;
+	uint32_t io_volumes_seq;
+	struct spa_io_meter *io_meter;
 
 	uint64_t info_all;
 	struct spa_node_info info;
@@ -224,6 +236,7 @@ struct impl {
 	struct channelmix mix;
 	struct resample resample;
 	struct volume volume;
+	struct peaks peaks;
 	double rate_scale;
 	struct spa_pod_sequence *vol_ramp_sequence;
 	uint32_t vol_ramp_offset;
@@ -233,12 +246,12 @@ struct impl {
 	unsigned int started:1;
 	unsigned int setup:1;
 	unsigned int resample_peaks:1;
-	unsigned int is_passthrough:1;
 	unsigned int ramp_volume:1;
 	unsigned int drained:1;
 	unsigned int rate_adjust:1;
 	unsigned int port_ignore_latency:1;
 	unsigned int monitor_passthrough:1;
+	unsigned int calibrate:1;
 
 	char group_name[128];
 
@@ -248,6 +261,8 @@ struct impl {
 	float *scratch;
 	float *tmp[2];
 	float *tmp_datas[2][MAX_PORTS];
+	uint32_t tile_size;
+	float *tile_datas[2][MAX_PORTS];
 
 	struct wav_file *wav_file;
 };
@@ -852,6 +867,19 @@ static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
 	case SPA_IO_Position:
 		this->io_position = data;
 		break;
+	case SPA_IO_Volumes:
+		if (data && size < sizeof(struct spa_io_volumes))
+			return -EINVAL;
+		this->io_volumes = data;
+		/* only apply the values after the next update */
+		if (data)
+			this->io_volumes_seq = SPA_ATOMIC_LOAD(this->io_volumes->seq);
+		break;
+	case SPA_IO_Meter:
+		if (data && size < sizeof(struct spa_io_meter))
+			return -EINVAL;
+		this->io_meter = data;
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -1482,6 +1510,8 @@ static int setup_in_convert(struct impl *this)
 	in->conv.dst_fmt = dst_info.info.raw.format;
 	in->conv.n_channels = dst_info.info.raw.channels;
 	in->conv.cpu_flags = this->cpu_flags;
+	in->conv.log = this->log;
+	in->conv.calibrate = this->calibrate;
 	in->need_remap = remap;
 
 	if ((res = convert_init(&in->conv)) < 0)
@@ -1580,6 +1610,118 @@ static void set_volume(struct impl *this)
 	this->params[IDX_Props].user++;
 }
 
+static int do_update_io_volumes(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	const struct spa_io_volumes_values *v = data;
+	struct props *p = &this->props;
+	uint32_t n;
+
+	n = SPA_MIN(v->n_volumes, SPA_AUDIO_MAX_CHANNELS);
+	p->volume = v->volume;
+	p->channel.mute = SPA_FLAG_IS_SET(v->flags, SPA_IO_VOLUMES_FLAG_MUTE);
+	if (n > 0) {
+		memcpy(p->channel.volumes, v->volumes, n * sizeof(float));
+		p->channel.n_volumes = n;
+	}
+	p->have_soft_volume = false;
+
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+	this->params[IDX_Props].user++;
+	emit_node_info(this, false);
+	return 0;
+}
+
+/* called from the data thread, only updates the channelmix gains, the
+ * props are updated from the main loop */
+static void apply_io_volumes(struct impl *this)
+{
+	struct spa_io_volumes *io = this->io_volumes;
+	struct props *p = &this->props;
+	struct dir *dir = &this->dir[this->direction];
+	struct spa_io_volumes_values v;
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	const float *src;
+	uint32_t seq, i, n;
+
+	seq = SPA_ATOMIC_LOAD(io->seq);
+	if (SPA_LIKELY(seq == this->io_volumes_seq) || p->lock_volumes)
+		return;
+
+	v = io->values[seq & 1];
+
+	/* the copy must be complete before checking seq again. When the
+	 * writer made an update while we were copying, try again in the
+	 * next cycle */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (SPA_ATOMIC_LOAD(io->seq) != seq)
+		return;
+
+	this->io_volumes_seq = seq;
+
+	spa_log_trace_fp(this->log, "%p: io volumes seq:%u volume:%f", this, seq, v.volume);
+
+	if (this->mix.set_volume != NULL) {
+		if (v.n_volumes > 0) {
+			n = SPA_MIN(v.n_volumes, SPA_AUDIO_MAX_CHANNELS);
+			src = v.volumes;
+		} else {
+			n = p->channel.n_volumes;
+			src = p->channel.volumes;
+		}
+		for (i = 0; i < n; i++)
+			volumes[i] = SPA_CLAMPF(src[dir->remap[i]],
+					p->min_volume, p->max_volume);
+
+		channelmix_set_volume(&this->mix,
+				SPA_CLAMPF(v.volume, p->min_volume, p->max_volume),
+				SPA_FLAG_IS_SET(v.flags, SPA_IO_VOLUMES_FLAG_MUTE),
+				n, volumes);
+	}
+	if (this->main_loop)
+		spa_loop_invoke(this->main_loop, do_update_io_volumes, seq,
+				&v, sizeof(v), false, this);
+}
+
+/* measure the DSP side of the converter, like the monitor ports see it */
+static void update_io_meter(struct impl *this, const void * SPA_RESTRICT datas[],
+		uint32_t n_datas, uint32_t n_samples)
+{
+	struct spa_io_meter *io = this->io_meter;
+	struct spa_io_meter_values *v;
+	uint32_t i, seq;
+
+	if (n_samples == 0)
+		return;
+
+	seq = SPA_ATOMIC_LOAD(io->seq);
+	v = &io->values[(seq + 1) & 1];
+
+	v->position = this->io_position ? this->io_position->clock.position : 0;
+	v->n_samples = n_samples;
+	v->n_channels = SPA_MIN(n_datas, SPA_IO_METER_MAX_CHANNELS);
+
+	for (i = 0; i < v->n_channels; i++) {
+		float volume = 1.0f, sum;
+
+		if (this->direction == SPA_DIRECTION_OUTPUT) {
+			/* in merge mode the volume is applied after the DSP side */
+			volume = this->props.monitor.mute ?
+				0.0f : this->props.monitor.volumes[i];
+			if (this->monitor_channel_volumes)
+				volume *= this->props.channel.mute ? 0.0f :
+					this->props.channel.volumes[i];
+			volume = fabsf(SPA_CLAMPF(volume, this->props.min_volume,
+						this->props.max_volume));
+		}
+		v->peak[i] = peaks_abs_max(&this->peaks, datas[i], n_samples, 0.0f) * volume;
+		sum = peaks_sum_sqr(&this->peaks, datas[i], n_samples, 0.0f);
+		v->rms[i] = sqrtf(sum / n_samples) * volume;
+	}
+	SPA_ATOMIC_STORE(io->seq, seq + 1);
+}
+
 static char *format_position(char *str, size_t len, uint32_t channels, uint32_t *position)
 {
 	uint32_t i, idx = 0;
@@ -1701,6 +1843,9 @@ static int calc_width(struct spa_audio_info *info)
 	case SPA_AUDIO_FORMAT_S16P:
 	case SPA_AUDIO_FORMAT_S16:
 	case SPA_AUDIO_FORMAT_S16_OE:
+	case SPA_AUDIO_FORMAT_F16P:
+	case SPA_AUDIO_FORMAT_F16:
+	case SPA_AUDIO_FORMAT_F16_OE:
 		return 2;
 	case SPA_AUDIO_FORMAT_S24P:
 	case SPA_AUDIO_FORMAT_S24:
@@ -1765,6 +1910,8 @@ static int setup_out_convert(struct impl *this)
 	out->conv.rate = dst_info.info.raw.rate;
 	out->conv.n_channels = dst_info.info.raw.channels;
 	out->conv.cpu_flags = this->cpu_flags;
+	out->conv.log = this->log;
+	out->conv.calibrate = this->calibrate;
 	out->need_remap = remap;
 
 	if ((res = convert_init(&out->conv)) < 0)
@@ -1788,6 +1935,7 @@ static void free_tmp(struct impl *this)
 	this->empty = NULL;
 	this->scratch_size = 0;
 	this->scratch_ports = 0;
+	this->tile_size = 0;
 	free(this->scratch);
 	this->scratch = NULL;
 	free(this->tmp[0]);
@@ -1835,6 +1983,31 @@ static int ensure_tmp(struct impl *this, uint32_t maxsize, uint32_t maxports)
 	return 0;
 }
 
+static void setup_tiles(struct impl *this, uint32_t maxsize, uint32_t maxports)
+{
+	uint32_t i, tile, stride;
+
+	/* pack the planes of a tile next to each other so that the tmp data
+	 * of all channels stays in the cache. Pad the planes to avoid
+	 * cache set aliasing. */
+	tile = TILE_BYTES / (maxports * sizeof(float));
+	tile = SPA_ROUND_DOWN_N(SPA_CLAMP(tile, MIN_TILE, MAX_TILE), 16);
+	stride = SPA_ROUND_UP_N(tile * sizeof(float), MAX_ALIGN) + MAX_ALIGN;
+
+	if (stride > maxsize) {
+		this->tile_size = 0;
+		return;
+	}
+	this->tile_size = tile;
+	for (i = 0; i < maxports; i++) {
+		this->tile_datas[0][i] = SPA_PTR_ALIGN(this->tmp[0], MAX_ALIGN, float) +
+			i * stride / sizeof(float);
+		this->tile_datas[1][i] = SPA_PTR_ALIGN(this->tmp[1], MAX_ALIGN, float) +
+			i * stride / sizeof(float);
+	}
+	spa_log_debug(this->log, "%p: tile size %d", this, tile);
+}
+
 static uint32_t resample_update_rate_match(struct impl *this, bool passthrough, uint32_t size, uint32_t queued)
 {
 	uint32_t delay, match_size;
@@ -1953,6 +2126,8 @@ static int setup_convert(struct impl *this)
 	if ((res = ensure_tmp(this, maxsize, maxports)) < 0)
 		return res;
 
+	setup_tiles(this, maxsize, maxports);
+
 	resample_update_rate_match(this, resample_is_passthrough(this), duration, 0);
 
 	this->setup = true;
@@ -2081,7 +2256,7 @@ static int port_enum_formats(void *object,
 			spa_pod_builder_add(builder,
 				SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 				SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-				SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(25,
+				SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(28,
 							SPA_AUDIO_FORMAT_F32P,
 							SPA_AUDIO_FORMAT_F32P,
 							SPA_AUDIO_FORMAT_F32,
@@ -2106,7 +2281,10 @@ static int port_enum_formats(void *object,
 							SPA_AUDIO_FORMAT_U8P,
 							SPA_AUDIO_FORMAT_U8,
 							SPA_AUDIO_FORMAT_ULAW,
-							SPA_AUDIO_FORMAT_ALAW),
+							SPA_AUDIO_FORMAT_ALAW,
+							SPA_AUDIO_FORMAT_F16P,
+							SPA_AUDIO_FORMAT_F16,
+							SPA_AUDIO_FORMAT_F16_OE),
 				0);
 			if (!this->props.resample_disabled) {
 				spa_pod_builder_add(builder,
@@ -2633,6 +2811,7 @@ impl_node_port_use_buffers(void *object,
 		return -ENOSPC;
 
 	maxsize = this->quantum_limit * sizeof(float);
+	port->is_dynamic = direction == SPA_DIRECTION_OUTPUT && n_buffers > 0;
 
 	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b;
@@ -2660,9 +2839,8 @@ impl_node_port_use_buffers(void *object,
 				spa_log_warn(this->log, "%p: memory %d on buffer %d not aligned",
 						this, j, i);
 			}
-			if (direction == SPA_DIRECTION_OUTPUT &&
-			    !SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC))
-				this->is_passthrough = false;
+			if (!SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC))
+				port->is_dynamic = false;
 
 			b->datas[j] = d[j].data;
 
@@ -2828,6 +3006,200 @@ static inline uint32_t resample_get_in_size(struct impl *this, bool passthrough,
 	return match_size;
 }
 
+/* run the conversion stages on n_samples of src_datas and produce at most n_out
+ * samples in dst_datas. Returns the number of produced samples and the number of
+ * consumed samples in consumed. */
+static uint32_t process_chain(struct impl *this, const void **src_datas, void **dst_datas,
+		uint32_t n_samples, uint32_t n_out, uint32_t *consumed,
+		float *tmp_datas[2][MAX_PORTS], bool in_passthrough, bool mix_passthrough,
+		bool resample_passthrough, bool out_passthrough,
+		struct port *ctrlport, struct spa_io_buffers *ctrlio)
+{
+	struct dir *dir = &this->dir[SPA_DIRECTION_OUTPUT];
+	void *remap_src_datas[MAX_PORTS], *remap_dst_datas[MAX_PORTS];
+	const void **in_datas;
+	void **out_datas, **dst_remap;
+	uint32_t i;
+	int tmp = 0;
+
+	if (out_passthrough && dir->need_remap) {
+		for (i = 0; i < dir->conv.n_channels; i++) {
+			remap_dst_datas[i] = dst_datas[dir->remap[i]];
+			spa_log_trace_fp(this->log, "%p: output remap %d -> %d", this, i, dir->remap[i]);
+		}
+		dst_remap = (void **)remap_dst_datas;
+	} else {
+		dst_remap = (void **)dst_datas;
+	}
+
+	dir = &this->dir[SPA_DIRECTION_INPUT];
+	if (!in_passthrough) {
+		if (mix_passthrough && resample_passthrough && out_passthrough)
+			out_datas = (void **)dst_remap;
+		else
+			out_datas = (void **)tmp_datas[(tmp++) & 1];
+
+		if (dir->need_remap) {
+			for (i = 0; i < dir->conv.n_channels; i++) {
+				remap_src_datas[i] = out_datas[dir->remap[i]];
+				spa_log_trace_fp(this->log, "%p: input remap %d -> %d", this, dir->remap[i], i);
+			}
+		} else {
+			for (i = 0; i < dir->conv.n_channels; i++)
+				remap_src_datas[i] = out_datas[i];
+		}
+
+		spa_log_trace_fp(this->log, "%p: input convert %d", this, n_samples);
+		convert_process(&dir->conv, remap_src_datas, src_datas, n_samples);
+	} else {
+		if (dir->need_remap) {
+			for (i = 0; i < dir->conv.n_channels; i++) {
+				remap_src_datas[dir->remap[i]] = (void *)src_datas[i];
+				spa_log_trace_fp(this->log, "%p: input remap %d -> %d", this, dir->remap[i], i);
+			}
+			out_datas = (void **)remap_src_datas;
+		} else {
+			out_datas = (void **)src_datas;
+		}
+	}
+
+	if (!mix_passthrough) {
+		in_datas = (const void**)out_datas;
+		if (resample_passthrough && out_passthrough) {
+			out_datas = (void **)dst_remap;
+			n_samples = SPA_MIN(n_samples, n_out);
+		} else {
+			out_datas = (void **)tmp_datas[(tmp++) & 1];
+		}
+		spa_log_trace_fp(this->log, "%p: channelmix %d %d %d", this, n_samples,
+				resample_passthrough, out_passthrough);
+		if (ctrlport != NULL && ctrlport->ctrl != NULL) {
+			if (channelmix_process_apply_sequence(this, ctrlport->ctrl,
+						&ctrlport->ctrl_offset, out_datas, in_datas, n_samples) == 1) {
+				ctrlio->status = SPA_STATUS_OK;
+				ctrlport->ctrl = NULL;
+			}
+		} else if (this->vol_ramp_sequence) {
+			if (channelmix_process_apply_sequence(this, this->vol_ramp_sequence,
+					&this->vol_ramp_offset, out_datas, in_datas, n_samples) == 1) {
+				free(this->vol_ramp_sequence);
+				this->vol_ramp_sequence = NULL;
+			}
+		}
+		else {
+			channelmix_process(&this->mix, out_datas, in_datas, n_samples);
+		}
+	}
+	if (!resample_passthrough) {
+		uint32_t in_len, out_len;
+
+		in_datas = (const void**)out_datas;
+		if (out_passthrough)
+			out_datas = (void **)dst_remap;
+		else
+			out_datas = (void **)tmp_datas[(tmp++) & 1];
+
+		in_len = n_samples;
+		out_len = n_out;
+		resample_process(&this->resample, in_datas, &in_len, out_datas, &out_len);
+		spa_log_trace_fp(this->log, "%p: resample %d/%d -> %d/%d %d", this,
+				n_samples, in_len, n_out, out_len, out_passthrough);
+		*consumed = in_len;
+		n_samples = out_len;
+	} else {
+		n_samples = SPA_MIN(n_samples, n_out);
+		*consumed = n_samples;
+	}
+
+	if (!out_passthrough) {
+		dir = &this->dir[SPA_DIRECTION_OUTPUT];
+		if (dir->need_remap) {
+			for (i = 0; i < dir->conv.n_channels; i++) {
+				remap_dst_datas[dir->remap[i]] = out_datas[i];
+				spa_log_trace_fp(this->log, "%p: output remap %d -> %d", this, i, dir->remap[i]);
+			}
+			in_datas = (const void**)remap_dst_datas;
+		} else {
+			in_datas = (const void**)out_datas;
+		}
+		spa_log_trace_fp(this->log, "%p: output convert %d", this, n_samples);
+		convert_process(&dir->conv, dst_datas, in_datas, n_samples);
+	}
+
+	return n_samples;
+}
+
+static bool can_zero_copy(struct impl *this, struct buffer **out_bufs,
+		uint32_t *src_strides, uint32_t n_src_datas,
+		uint32_t *dst_strides, uint32_t n_dst_datas)
+{
+	struct dir *in = &this->dir[SPA_DIRECTION_INPUT];
+	struct dir *out = &this->dir[SPA_DIRECTION_OUTPUT];
+	struct port *port;
+	uint32_t i;
+
+	if (!out->conv.is_passthrough || in->need_remap || out->need_remap ||
+	    this->in_offset != 0 || this->out_offset != 0 ||
+	    n_src_datas != n_dst_datas)
+		return false;
+
+	for (i = 0; i < n_src_datas; i++)
+		if (src_strides[i] != dst_strides[i])
+			return false;
+
+	for (i = 0; i < out->n_ports; i++) {
+		port = GET_OUT_PORT(this, i);
+		if (port->is_monitor || port->is_control)
+			continue;
+		if (!port->is_dynamic || out_bufs[i] == NULL)
+			return false;
+	}
+	return true;
+}
+
+static void zero_copy(struct impl *this, struct buffer **out_bufs,
+		const void **src_datas, void **dst_datas)
+{
+	struct dir *dir = &this->dir[SPA_DIRECTION_OUTPUT];
+	struct port *port;
+	uint32_t i, j, remap = 0;
+
+	for (i = 0; i < dir->n_ports; i++) {
+		port = GET_OUT_PORT(this, i);
+		if (port->is_monitor || port->is_control)
+			continue;
+		for (j = 0; j < port->blocks; j++, remap++) {
+			dst_datas[remap] = (void *)src_datas[remap];
+			out_bufs[i]->buf->datas[j].data = dst_datas[remap];
+		}
+	}
+}
+
+static inline bool is_zero_silence(uint32_t format)
+{
+	switch (format) {
+	case SPA_AUDIO_FORMAT_U8:
+	case SPA_AUDIO_FORMAT_U8P:
+	case SPA_AUDIO_FORMAT_U16_LE:
+	case SPA_AUDIO_FORMAT_U16_BE:
+	case SPA_AUDIO_FORMAT_U18_LE:
+	case SPA_AUDIO_FORMAT_U18_BE:
+	case SPA_AUDIO_FORMAT_U20_LE:
+	case SPA_AUDIO_FORMAT_U20_BE:
+	case SPA_AUDIO_FORMAT_U24_LE:
+	case SPA_AUDIO_FORMAT_U24_BE:
+	case SPA_AUDIO_FORMAT_U24_32_LE:
+	case SPA_AUDIO_FORMAT_U24_32_BE:
+	case SPA_AUDIO_FORMAT_U32_LE:
+	case SPA_AUDIO_FORMAT_U32_BE:
+	case SPA_AUDIO_FORMAT_ULAW:
+	case SPA_AUDIO_FORMAT_ALAW:
+		return false;
+	default:
+		return true;
+	}
+}
+
 static uint64_t get_time_ns(struct impl *impl)
 {
 	struct timespec now;
@@ -2839,16 +3211,16 @@ static uint64_t get_time_ns(struct impl *impl)
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
-	const void *src_datas[MAX_PORTS], **in_datas;
-	void *dst_datas[MAX_PORTS], *remap_src_datas[MAX_PORTS], *remap_dst_datas[MAX_PORTS];
-	void **out_datas, **dst_remap;
+	const void *src_datas[MAX_PORTS];
+	void *dst_datas[MAX_PORTS];
+	uint32_t src_strides[MAX_PORTS], dst_strides[MAX_PORTS];
 	uint32_t i, j, n_src_datas = 0, n_dst_datas = 0, n_mon_datas = 0, remap;
-	uint32_t n_samples, max_in, n_out, max_out, quant_samples;
+	uint32_t n_samples, max_in, n_out, max_out, quant_samples, in_len, n_stages;
 	struct port *port, *ctrlport = NULL;
 	struct buffer *buf, *out_bufs[MAX_PORTS];
 	struct spa_data *bd;
 	struct dir *dir;
-	int tmp = 0, res = 0, suppressed;
+	int res = 0, suppressed;
 	bool in_passthrough, mix_passthrough, resample_passthrough, out_passthrough;
 	bool in_avail = false, flush_in = false, flush_out = false;
 	bool draining = false, in_empty = this->out_offset == 0;
@@ -2856,6 +3228,9 @@ static int impl_node_process(void *object)
 	const struct spa_pod_sequence *ctrl = NULL;
 	uint64_t current_time;
 
+	if (this->io_volumes)
+		apply_io_volumes(this);
+
 	/* calculate quantum scale, this is how many samples we need to produce or
 	 * consume. Also update the rate scale, this is sent to the resampler to adjust
 	 * the rate, either when the graph clock changed or when the user adjusted the
@@ -2933,6 +3308,7 @@ static int impl_node_process(void *object)
 				} else {
 					remap = n_src_datas++;
 					src_datas[remap] = SPA_PTR_ALIGN(this->empty, MAX_ALIGN, void);
+					src_strides[remap] = port->stride;
 					spa_log_trace_fp(this->log, "%p: empty input %d->%d", this,
 							i * port->blocks + j, remap);
 					max_in = SPA_MIN(max_in, this->scratch_size / port->stride);
@@ -2969,6 +3345,7 @@ static int impl_node_process(void *object)
 					remap = n_src_datas++;
 					offs += this->in_offset * port->stride;
 					src_datas[remap] = SPA_PTROFF(bd->data, offs, void);
+					src_strides[remap] = port->stride;
 
 					spa_log_trace_fp(this->log, "%p: input %d:%d:%d %d %d %d->%d", this,
 							offs, size, port->stride, this->in_offset, max_in,
@@ -3034,6 +3411,7 @@ static int impl_node_process(void *object)
 				} else {
 					remap = n_dst_datas++;
 					dst_datas[remap] = SPA_PTR_ALIGN(this->scratch, MAX_ALIGN, void);
+					dst_strides[remap] = port->stride;
 					spa_log_trace_fp(this->log, "%p: empty output %d->%d", this,
 						i * port->blocks + j, remap);
 					max_out = SPA_MIN(max_out, this->scratch_size / port->stride);
@@ -3077,9 +3455,14 @@ static int impl_node_process(void *object)
 				} else if (SPA_UNLIKELY(port->is_control)) {
 					spa_log_trace_fp(this->log, "%p: control %d", this, j);
 				} else {
+					/* undo the zero-copy of the previous cycle */
+					if (port->is_dynamic)
+						bd->data = buf->datas[j];
+
 					remap = n_dst_datas++;
 					dst_datas[remap] = SPA_PTROFF(bd->data,
 							this->out_offset * port->stride, void);
+					dst_strides[remap] = port->stride;
 					max_out = SPA_MIN(max_out, bd->maxsize / port->stride);
 
 					spa_log_trace_fp(this->log, "%p: output %d offs:%d %d->%d", this,
@@ -3120,113 +3503,84 @@ static int impl_node_process(void *object)
 	if (in_passthrough && mix_passthrough && resample_passthrough)
 		out_passthrough = false;
 
-	if (out_passthrough && dir->need_remap) {
-		for (i = 0; i < dir->conv.n_channels; i++) {
-			remap_dst_datas[i] = dst_datas[dir->remap[i]];
-			spa_log_trace_fp(this->log, "%p: output remap %d -> %d", this, i, dir->remap[i]);
-		}
-		dst_remap = (void **)remap_dst_datas;
-	} else {
-		dst_remap = (void **)dst_datas;
-	}
-
 	if (this->direction == SPA_DIRECTION_INPUT)
 		handle_wav(this, src_datas, n_samples);
 
-	dir = &this->dir[SPA_DIRECTION_INPUT];
-	if (!in_passthrough) {
-		if (mix_passthrough && resample_passthrough && out_passthrough)
-			out_datas = (void **)dst_remap;
-		else
-			out_datas = (void **)this->tmp_datas[(tmp++) & 1];
-
-		if (dir->need_remap) {
-			for (i = 0; i < dir->conv.n_channels; i++) {
-				remap_src_datas[i] = out_datas[dir->remap[i]];
-				spa_log_trace_fp(this->log, "%p: input remap %d -> %d", this, dir->remap[i], i);
-			}
-		} else {
-			for (i = 0; i < dir->conv.n_channels; i++)
-				remap_src_datas[i] = out_datas[i];
+	n_stages = !in_passthrough + !mix_passthrough + !resample_passthrough + !out_passthrough;
+	if (in_passthrough && mix_passthrough && resample_passthrough &&
+	    (flush_out || n_samples >= n_out) &&
+	    can_zero_copy(this, out_bufs, src_strides, n_src_datas,
+			    dst_strides, n_dst_datas)) {
+		/* nothing to convert and the output buffers can point to
+		 * our input memory, avoid the copy */
+		n_samples = SPA_MIN(n_samples, n_out);
+		in_len = n_samples;
+		zero_copy(this, out_bufs, src_datas, dst_datas);
+		spa_log_trace_fp(this->log, "%p: zero-copy %d", this, n_samples);
+	} else if (in_empty && resample_passthrough &&
+	    (ctrlport == NULL || ctrlport->ctrl == NULL) &&
+	    this->vol_ramp_sequence == NULL &&
+	    (mix_passthrough || channelmix_is_stateless(&this->mix)) &&
+	    is_zero_silence(dir->conv.dst_fmt)) {
+		/* all input is silence, there is nothing to convert */
+		n_samples = SPA_MIN(n_samples, n_out);
+		in_len = n_samples;
+		for (i = 0; i < n_dst_datas; i++)
+			memset(dst_datas[i], 0, n_samples * dst_strides[i]);
+		spa_log_trace_fp(this->log, "%p: silence %d", this, n_samples);
+	} else if (this->tile_size > 0 && n_stages > 1 && n_samples > this->tile_size &&
+	    (ctrlport == NULL || ctrlport->ctrl == NULL) &&
+	    this->vol_ramp_sequence == NULL) {
+		const void *tile_src[MAX_PORTS];
+		void *tile_dst[MAX_PORTS];
+		uint32_t done_in = 0, done_out = 0, chunk, max_chunk, produced;
+
+		/* run all stages on tiles that stay in the cache instead of
+		 * passing the whole quantum through the tmp buffers for each
+		 * stage. The resampler keeps its state between the tiles, we
+		 * only need to make sure its output fits in a tile. */
+		while (done_in < n_samples && done_out < n_out) {
+			chunk = SPA_MIN(this->tile_size, n_samples - done_in);
+			max_chunk = SPA_MIN(this->tile_size, n_out - done_out);
+			if (resample_passthrough)
+				chunk = SPA_MIN(chunk, max_chunk);
+			else
+				chunk = SPA_CLAMP(resample_in_len(&this->resample, max_chunk), 1u, chunk);
+
+			for (i = 0; i < n_src_datas; i++)
+				tile_src[i] = SPA_PTROFF(src_datas[i], done_in * src_strides[i], void);
+			for (i = 0; i < n_dst_datas; i++)
+				tile_dst[i] = SPA_PTROFF(dst_datas[i], done_out * dst_strides[i], void);
+
+			produced = process_chain(this, tile_src, tile_dst, chunk, max_chunk, &in_len,
+					this->tile_datas, in_passthrough, mix_passthrough,
+					resample_passthrough, out_passthrough, NULL, NULL);
+			done_in += in_len;
+			done_out += produced;
+			if (in_len == 0 && produced == 0)
+				break;
 		}
-
-		spa_log_trace_fp(this->log, "%p: input convert %d", this, n_samples);
-		convert_process(&dir->conv, remap_src_datas, src_datas, n_samples);
+		spa_log_trace_fp(this->log, "%p: tiled %d/%d %d/%d %d", this, done_in, n_samples,
+				done_out, n_out, this->tile_size);
+		in_len = done_in;
+		n_samples = done_out;
 	} else {
-		if (dir->need_remap) {
-			for (i = 0; i < dir->conv.n_channels; i++) {
-				remap_src_datas[dir->remap[i]] = (void *)src_datas[i];
-				spa_log_trace_fp(this->log, "%p: input remap %d -> %d", this, dir->remap[i], i);
-			}
-			out_datas = (void **)remap_src_datas;
+		n_samples = process_chain(this, src_datas, dst_datas, n_samples, n_out,
+				&in_len, this->tmp_datas, in_passthrough, mix_passthrough,
+				resample_passthrough, out_passthrough, ctrlport, ctrlio);
+	}
+	if (this->io_meter != NULL) {
+		if (this->direction == SPA_DIRECTION_OUTPUT) {
+			if (this->dir[SPA_DIRECTION_INPUT].mode == SPA_PARAM_PORT_CONFIG_MODE_dsp)
+				update_io_meter(this, src_datas, n_src_datas, in_len);
 		} else {
-			out_datas = (void **)src_datas;
+			if (this->dir[SPA_DIRECTION_OUTPUT].mode == SPA_PARAM_PORT_CONFIG_MODE_dsp)
+				update_io_meter(this, (const void**)dst_datas, n_dst_datas, n_samples);
 		}
 	}
-
-	if (!mix_passthrough) {
-		in_datas = (const void**)out_datas;
-		if (resample_passthrough && out_passthrough) {
-			out_datas = (void **)dst_remap;
-			n_samples = SPA_MIN(n_samples, n_out);
-		} else {
-			out_datas = (void **)this->tmp_datas[(tmp++) & 1];
-		}
-		spa_log_trace_fp(this->log, "%p: channelmix %d %d %d", this, n_samples,
-				resample_passthrough, out_passthrough);
-		if (ctrlport != NULL && ctrlport->ctrl != NULL) {
-			if (channelmix_process_apply_sequence(this, ctrlport->ctrl,
-						&ctrlport->ctrl_offset, out_datas, in_datas, n_samples) == 1) {
-				ctrlio->status = SPA_STATUS_OK;
-				ctrlport->ctrl = NULL;
-			}
-		} else if (this->vol_ramp_sequence) {
-			if (channelmix_process_apply_sequence(this, this->vol_ramp_sequence,
-					&this->vol_ramp_offset, out_datas, in_datas, n_samples) == 1) {
-				free(this->vol_ramp_sequence);
-				this->vol_ramp_sequence = NULL;
-			}
-		}
-		else {
-			channelmix_process(&this->mix, out_datas, in_datas, n_samples);
-		}
-	}
-	if (!resample_passthrough) {
-		uint32_t in_len, out_len;
-
-		in_datas = (const void**)out_datas;
-		if (out_passthrough)
-			out_datas = (void **)dst_remap;
-		else
-			out_datas = (void **)this->tmp_datas[(tmp++) & 1];
-
-		in_len = n_samples;
-		out_len = n_out;
-		resample_process(&this->resample, in_datas, &in_len, out_datas, &out_len);
-		spa_log_trace_fp(this->log, "%p: resample %d/%d -> %d/%d %d", this,
-				n_samples, in_len, n_out, out_len, out_passthrough);
-		this->in_offset += in_len;
-		n_samples = out_len;
-	} else {
-		n_samples = SPA_MIN(n_samples, n_out);
-		this->in_offset += n_samples;
-	}
+	this->in_offset += in_len;
 	this->out_offset += n_samples;
 
-	if (!out_passthrough) {
-		dir = &this->dir[SPA_DIRECTION_OUTPUT];
-		if (dir->need_remap) {
-			for (i = 0; i < dir->conv.n_channels; i++) {
-				remap_dst_datas[dir->remap[i]] = out_datas[i];
-				spa_log_trace_fp(this->log, "%p: output remap %d -> %d", this, i, dir->remap[i]);
-			}
-			in_datas = (const void**)remap_dst_datas;
-		} else {
-			in_datas = (const void**)out_datas;
-		}
-		spa_log_trace_fp(this->log, "%p: output convert %d", this, n_samples);
-		convert_process(&dir->conv, dst_datas, in_datas, n_samples);
-	}
 	if (this->direction == SPA_DIRECTION_OUTPUT)
 		handle_wav(this, (const void**)dst_datas, n_samples);
 
@@ -3366,6 +3720,10 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	/* flush the pending volume updates from the data thread */
+	if (this->main_loop)
+		spa_loop_invoke(this->main_loop, NULL, 0, NULL, 0, true, this);
+
 	free_dir(&this->dir[SPA_DIRECTION_INPUT]);
 	free_dir(&this->dir[SPA_DIRECTION_OUTPUT]);
 
@@ -3436,6 +3794,7 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_log_topic_init(this->log, &log_topic);
 
 	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->main_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
 	if (this->cpu) {
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 		this->max_align = SPA_MIN(MAX_ALIGN, spa_cpu_get_max_align(this->cpu));
@@ -3463,6 +3822,14 @@ impl_init(const struct spa_handle_factory *factory,
 		else if (spa_streq(k, "resample.prefill"))
 			SPA_FLAG_UPDATE(this->resample.options,
 				RESAMPLE_OPTION_PREFILL, spa_atob(s));
+		else if (spa_streq(k, "resample.minimum-phase"))
+			SPA_FLAG_UPDATE(this->resample.options,
+				RESAMPLE_OPTION_MINIMUM_PHASE, spa_atob(s));
+		else if (spa_streq(k, "cpu.calibrate")) {
+			this->calibrate = spa_atob(s);
+			SPA_FLAG_UPDATE(this->resample.options,
+				RESAMPLE_OPTION_CALIBRATE, this->calibrate);
+		}
 		else if (spa_streq(k, SPA_KEY_AUDIO_POSITION)) {
 			if (s != NULL)
 	                        this->props.n_channels = parse_position(this->props.channel_map, s, strlen(s));
@@ -3509,6 +3876,10 @@ impl_init(const struct spa_handle_factory *factory,
 	this->volume.cpu_flags = this->cpu_flags;
 	volume_init(&this->volume);
 
+	this->peaks.log = this->log;
+	this->peaks.cpu_flags = this->cpu_flags;
+	peaks_init(&this->peaks);
+
 	this->rate_scale = 1.0;
 
 	reconfigure_mode(this, SPA_PARAM_PORT_CONFIG_MODE_convert, SPA_DIRECTION_INPUT, false, false, NULL);
@@ -0,0 +1,311 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/utils/names.h>
+#include <spa/utils/string.h>
+#include <spa/support/plugin.h>
+#include <spa/param/param.h>
+#include <spa/param/audio/format.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/support/log-impl.h>
+
+SPA_LOG_IMPL(logger);
+
+#define MAX_PORTS	(SPA_AUDIO_MAX_CHANNELS+1)
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t n_channels;
+	uint64_t perf;
+	const char *name;
+};
+
+#define MAX_SAMPLES	8192
+#define MAX_CHANNELS	64
+
+#define MAX_COUNT 200
+
+static uint8_t samp_in[MAX_SAMPLES * MAX_CHANNELS * 4];
+static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
+
+static const int sample_sizes[] = { 256, 1024, 2048, 4096, 8192 };
+static const int channel_counts[] = { 2, 8, 64 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 8
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+struct buffer {
+	struct spa_buffer buffer;
+	struct spa_data datas[MAX_PORTS];
+	struct spa_chunk chunks[MAX_PORTS];
+};
+
+struct context {
+	struct spa_handle *handle;
+	struct spa_node *node;
+
+	struct buffer in_buffer;
+	struct buffer out_buffer;
+	struct spa_io_buffers in_io;
+	struct spa_io_buffers out_io;
+};
+
+static const struct spa_handle_factory *find_factory(const char *name)
+{
+	uint32_t index = 0;
+	const struct spa_handle_factory *factory;
+
+	while (spa_handle_factory_enum(&factory, &index) == 1) {
+		if (spa_streq(factory->name, name))
+			return factory;
+	}
+	return NULL;
+}
+
+static void setup_context(struct context *ctx)
+{
+	struct spa_support support[1];
+	struct spa_dict_item items[1];
+	const struct spa_handle_factory *factory;
+	void *iface;
+	int res;
+
+	logger.log.level = SPA_LOG_LEVEL_WARN;
+	support[0] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Log, &logger);
+
+	factory = find_factory(SPA_NAME_AUDIO_CONVERT);
+	spa_assert_se(factory != NULL);
+
+	ctx->handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert_se(ctx->handle != NULL);
+
+	items[0] = SPA_DICT_ITEM_INIT("clock.quantum-limit", SPA_STRINGIFY(MAX_SAMPLES));
+	res = spa_handle_factory_init(factory, ctx->handle,
+			&SPA_DICT_INIT(items, 1), support, 1);
+	spa_assert_se(res >= 0);
+
+	res = spa_handle_get_interface(ctx->handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert_se(res >= 0);
+	ctx->node = iface;
+}
+
+static void clean_context(struct context *ctx)
+{
+	spa_handle_clear(ctx->handle);
+	free(ctx->handle);
+}
+
+static void setup_direction(struct context *ctx, enum spa_direction direction,
+		uint32_t format, uint32_t rate, uint32_t n_channels)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[2048];
+	struct spa_audio_info_raw info;
+	struct spa_pod *param;
+	uint32_t i;
+	int res;
+
+	spa_zero(info);
+	info.format = format;
+	info.rate = rate;
+	info.channels = n_channels;
+	for (i = 0; i < n_channels; i++)
+		info.position[i] = SPA_AUDIO_CHANNEL_AUX0 + i;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_ParamPortConfig, SPA_PARAM_PortConfig,
+		SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(direction),
+		SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(SPA_PARAM_PORT_CONFIG_MODE_convert));
+	res = spa_node_set_param(ctx->node, SPA_PARAM_PortConfig, 0, param);
+	spa_assert_se(res == 0);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	res = spa_node_port_set_param(ctx->node, direction, 0,
+			SPA_PARAM_Format, 0, param);
+	spa_assert_se(res == 0);
+}
+
+static uint32_t format_planes(uint32_t format, uint32_t n_channels)
+{
+	return format >= SPA_AUDIO_FORMAT_START_Planar &&
+		format < SPA_AUDIO_FORMAT_START_Other ? n_channels : 1;
+}
+
+static uint32_t format_size(uint32_t format)
+{
+	switch (format) {
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16P:
+		return 2;
+	case SPA_AUDIO_FORMAT_S24:
+	case SPA_AUDIO_FORMAT_S24P:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+static void setup_buffer(struct context *ctx, enum spa_direction direction,
+		struct buffer *b, struct spa_io_buffers *io, uint8_t *mem,
+		uint32_t n_planes, uint32_t size)
+{
+	struct spa_buffer *buffers[1];
+	uint32_t i;
+	int res;
+
+	spa_zero(*b);
+	b->buffer.datas = b->datas;
+	b->buffer.n_datas = n_planes;
+
+	for (i = 0; i < n_planes; i++) {
+		b->datas[i].type = SPA_DATA_MemPtr;
+		b->datas[i].fd = -1;
+		b->datas[i].maxsize = size;
+		b->datas[i].data = mem + i * size;
+		b->datas[i].chunk = &b->chunks[i];
+		b->datas[i].chunk->size = direction == SPA_DIRECTION_INPUT ? size : 0;
+	}
+	buffers[0] = &b->buffer;
+	res = spa_node_port_use_buffers(ctx->node, direction, 0, 0, buffers, 1);
+	spa_assert_se(res == 0);
+
+	io->status = direction == SPA_DIRECTION_INPUT ?
+		SPA_STATUS_HAVE_DATA : SPA_STATUS_NEED_DATA;
+	io->buffer_id = direction == SPA_DIRECTION_INPUT ? 0 : SPA_ID_INVALID;
+	res = spa_node_port_set_io(ctx->node, direction, 0,
+			SPA_IO_Buffers, io, sizeof(*io));
+	spa_assert_se(res == 0);
+}
+
+static void run_test1(const char *name, uint32_t in_format, uint32_t in_rate,
+		uint32_t out_format, uint32_t out_rate, int n_channels, int n_samples)
+{
+	struct context ctx;
+	struct spa_command cmd;
+	struct timespec ts;
+	uint32_t in_planes, out_planes;
+	uint64_t count, t1, t2;
+	int i, res;
+
+	spa_zero(ctx);
+	setup_context(&ctx);
+
+	setup_direction(&ctx, SPA_DIRECTION_INPUT, in_format, in_rate, n_channels);
+	setup_direction(&ctx, SPA_DIRECTION_OUTPUT, out_format, out_rate, n_channels);
+
+	cmd = SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start);
+	res = spa_node_send_command(ctx.node, &cmd);
+	spa_assert_se(res == 0);
+
+	in_planes = format_planes(in_format, n_channels);
+	out_planes = format_planes(out_format, n_channels);
+	setup_buffer(&ctx, SPA_DIRECTION_INPUT, &ctx.in_buffer, &ctx.in_io, samp_in,
+			in_planes, n_samples * n_channels / in_planes * format_size(in_format));
+	setup_buffer(&ctx, SPA_DIRECTION_OUTPUT, &ctx.out_buffer, &ctx.out_io, samp_out,
+			out_planes, n_samples * n_channels / out_planes * format_size(out_format));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		ctx.in_io.status = SPA_STATUS_HAVE_DATA;
+		ctx.in_io.buffer_id = 0;
+		/* recycle the output buffer */
+		ctx.out_io.status = SPA_STATUS_NEED_DATA;
+		res = spa_node_process(ctx.node);
+		spa_assert_se(res >= 0);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	cmd = SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Suspend);
+	res = spa_node_send_command(ctx.node, &cmd);
+	spa_assert_se(res == 0);
+
+	clean_context(&ctx);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_channels = n_channels,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+	};
+}
+
+static void run_test(const char *name, uint32_t in_format, uint32_t in_rate,
+		uint32_t out_format, uint32_t out_rate)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s) {
+		SPA_FOR_EACH_ELEMENT_VAR(channel_counts, c) {
+			run_test1(name, in_format, in_rate, out_format, out_rate, *c, *s);
+		}
+	}
+}
+
+static void test_convert(void)
+{
+	run_test("test_s16_f32p", SPA_AUDIO_FORMAT_S16, 48000,
+			SPA_AUDIO_FORMAT_F32P, 48000);
+	run_test("test_s16_s32", SPA_AUDIO_FORMAT_S16, 48000,
+			SPA_AUDIO_FORMAT_S32, 48000);
+	run_test("test_s24_f32", SPA_AUDIO_FORMAT_S24, 48000,
+			SPA_AUDIO_FORMAT_F32, 48000);
+}
+
+static void test_resample(void)
+{
+	run_test("test_s16p_f32p_resample", SPA_AUDIO_FORMAT_S16P, 44100,
+			SPA_AUDIO_FORMAT_F32P, 48000);
+	run_test("test_s16_s32_resample", SPA_AUDIO_FORMAT_S16, 44100,
+			SPA_AUDIO_FORMAT_S32, 48000);
+	run_test("test_s32_s16_resample", SPA_AUDIO_FORMAT_S32, 96000,
+			SPA_AUDIO_FORMAT_S16, 48000);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->n_channels - b->n_channels) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	test_convert();
+	test_resample();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s \t samples %d, channels %d\n",
+				s->perf, s->name, s->n_samples, s->n_channels);
+	}
+	return 0;
+}
@@ -0,0 +1,166 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/log-impl.h>
+
+SPA_LOG_IMPL(logger);
+
+#include "test-helper.h"
+#include "channelmix-ops.h"
+
+static uint32_t cpu_flags;
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t src_chan;
+	uint32_t dst_chan;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	4096
+#define MAX_CHANNELS	16
+
+#define MAX_COUNT 100
+
+static float samp_in[MAX_SAMPLES * MAX_CHANNELS];
+static float samp_out[MAX_SAMPLES * MAX_CHANNELS];
+
+static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * 100
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void run_test1(const char *name, const char *impl, struct channelmix *mix, int n_samples)
+{
+	uint32_t i, j;
+	const void *ip[MAX_CHANNELS];
+	void *op[MAX_CHANNELS];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+
+	for (j = 0; j < mix->src_chan; j++)
+		ip[j] = &samp_in[j * MAX_SAMPLES];
+	for (j = 0; j < mix->dst_chan; j++)
+		op[j] = &samp_out[j * MAX_SAMPLES];
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		channelmix_process(mix, op, ip, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.src_chan = mix->src_chan,
+		.dst_chan = mix->dst_chan,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl, uint32_t flags,
+		uint32_t src_chan, uint64_t src_mask, uint32_t dst_chan, uint64_t dst_mask)
+{
+	struct channelmix mix;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.src_mask = src_mask;
+	mix.dst_chan = dst_chan;
+	mix.dst_mask = dst_mask;
+	mix.cpu_flags = flags;
+	mix.options = CHANNELMIX_OPTION_UPMIX;
+	mix.upmix = CHANNELMIX_UPMIX_SIMPLE;
+	mix.freq = 48000.0f;
+	mix.log = &logger.log;
+
+	spa_assert_se(channelmix_init(&mix) == 0);
+	channelmix_set_volume(&mix, 0.8f, false, 0, NULL);
+
+	SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s)
+		run_test1(name, impl, &mix, *s);
+
+	channelmix_free(&mix);
+}
+
+#define MASK_2		(_M(FL)|_M(FR))
+#define MASK_5P1	(_M(FL)|_M(FR)|_M(FC)|_M(LFE)|_M(SL)|_M(SR))
+#define MASK_7P1	(_M(FL)|_M(FR)|_M(FC)|_M(LFE)|_M(SL)|_M(SR)|_M(RL)|_M(RR))
+#define MASK_7P1P4	(MASK_7P1|_M(TFL)|_M(TFR)|_M(TRL)|_M(TRR))
+
+static void run_tests(const char *impl, uint32_t flags)
+{
+	run_test("copy_2", impl, flags, 2, MASK_2, 2, MASK_2);
+	run_test("2_5p1", impl, flags, 2, MASK_2, 6, MASK_5P1);
+	run_test("5p1_2", impl, flags, 6, MASK_5P1, 2, MASK_2);
+	run_test("7p1_2", impl, flags, 8, MASK_7P1, 2, MASK_2);
+	run_test("7p1_5p1", impl, flags, 8, MASK_7P1, 6, MASK_5P1);
+	run_test("7p1p4_5p1", impl, flags, 12, MASK_7P1P4, 6, MASK_5P1);
+	run_test("16_2", impl, flags, 16, 0, 2, MASK_2);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	logger.log.level = SPA_LOG_LEVEL_ERROR;
+
+	run_tests("c", 0);
+#if defined (HAVE_SSE)
+	if (cpu_flags & SPA_CPU_FLAG_SSE)
+		run_tests("sse", SPA_CPU_FLAG_SSE);
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_tests("avx2", SPA_CPU_FLAG_AVX2);
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_tests("neon", SPA_CPU_FLAG_NEON);
+#endif
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-16.16s %s \t samples %d, channels %d->%d\n",
+				s->perf, s->name, s->impl, s->n_samples,
+				s->src_chan, s->dst_chan);
+	}
+	return 0;
+}
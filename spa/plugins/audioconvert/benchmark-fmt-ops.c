@@ -11,7 +11,10 @@
 #include <errno.h>
 #include <time.h>
 
+#include <spa/param/audio/raw.h>
+
 #include "test-helper.h"
+#include "benchmark-helper.h"
 #include "fmt-ops.h"
 
 static uint32_t cpu_flags;
@@ -38,7 +41,7 @@ static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int channel_counts[] = { 1, 2, 4, 6, 8, 11 };
 
-#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 70
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 100
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -104,6 +107,16 @@ static void test_f32_u8(void)
 {
 	run_test("test_f32_u8", "c", true, true, conv_f32_to_u8_c);
 	run_test("test_f32d_u8", "c", false, true, conv_f32d_to_u8_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_u8", "avx2", false, true, conv_f32d_to_u8_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_u8", "avx512", false, true, conv_f32d_to_u8_avx512);
+	}
+#endif
 	run_test("test_f32_u8d", "c", true, false, conv_f32_to_u8d_c);
 	run_test("test_f32d_u8d", "c", false, false, conv_f32d_to_u8d_c);
 }
@@ -113,6 +126,16 @@ static void test_u8_f32(void)
 	run_test("test_u8_f32", "c", true, true, conv_u8_to_f32_c);
 	run_test("test_u8d_f32", "c", false, true, conv_u8d_to_f32_c);
 	run_test("test_u8_f32d", "c", true, false, conv_u8_to_f32d_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_u8_f32d", "avx2", true, false, conv_u8_to_f32d_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_u8_f32d", "avx512", true, false, conv_u8_to_f32d_avx512);
+	}
+#endif
 	run_test("test_u8d_f32d", "c", false, false, conv_u8d_to_f32d_c);
 }
 
@@ -197,6 +220,16 @@ static void test_f32_s24(void)
 {
 	run_test("test_f32_s24", "c", true, true, conv_f32_to_s24_c);
 	run_test("test_f32d_s24", "c", false, true, conv_f32d_to_s24_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s24", "avx2", false, true, conv_f32d_to_s24_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s24", "avx512", false, true, conv_f32d_to_s24_avx512);
+	}
+#endif
 	run_test("test_f32_s24d", "c", true, false, conv_f32_to_s24d_c);
 	run_test("test_f32d_s24d", "c", false, false, conv_f32d_to_s24d_c);
 }
@@ -216,6 +249,11 @@ static void test_s24_f32(void)
 		run_test("test_s24_f32d", "avx2", true, false, conv_s24_to_f32d_avx2);
 	}
 #endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s24_f32d", "avx512", true, false, conv_s24_to_f32d_avx512);
+	}
+#endif
 #if defined (HAVE_SSSE3)
 	if (cpu_flags & SPA_CPU_FLAG_SSSE3) {
 		run_test("test_s24_f32d", "ssse3", true, false, conv_s24_to_f32d_ssse3);
@@ -233,6 +271,16 @@ static void test_f32_s24_32(void)
 {
 	run_test("test_f32_s24_32", "c", true, true, conv_f32_to_s24_32_c);
 	run_test("test_f32d_s24_32", "c", false, true, conv_f32d_to_s24_32_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s24_32", "avx2", false, true, conv_f32d_to_s24_32_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s24_32", "avx512", false, true, conv_f32d_to_s24_32_avx512);
+	}
+#endif
 	run_test("test_f32_s24_32d", "c", true, false, conv_f32_to_s24_32d_c);
 	run_test("test_f32d_s24_32d", "c", false, false, conv_f32d_to_s24_32d_c);
 }
@@ -242,9 +290,55 @@ static void test_s24_32_f32(void)
 	run_test("test_s24_32_f32", "c", true, true, conv_s24_32_to_f32_c);
 	run_test("test_s24_32d_f32", "c", false, true, conv_s24_32d_to_f32_c);
 	run_test("test_s24_32_f32d", "c", true, false, conv_s24_32_to_f32d_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s24_32_f32d", "avx2", true, false, conv_s24_32_to_f32d_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s24_32_f32d", "avx512", true, false, conv_s24_32_to_f32d_avx512);
+	}
+#endif
 	run_test("test_s24_32d_f32d", "c", false, false, conv_s24_32d_to_f32d_c);
 }
 
+static void test_f32_f64(void)
+{
+	run_test("test_f32_f64", "c", true, true, conv_f32_to_f64_c);
+	run_test("test_f32d_f64", "c", false, true, conv_f32d_to_f64_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_f64", "avx2", false, true, conv_f32d_to_f64_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_f64", "avx512", false, true, conv_f32d_to_f64_avx512);
+	}
+#endif
+	run_test("test_f32_f64d", "c", true, false, conv_f32_to_f64d_c);
+	run_test("test_f32d_f64d", "c", false, false, conv_f32d_to_f64d_c);
+}
+
+static void test_f64_f32(void)
+{
+	run_test("test_f64_f32", "c", true, true, conv_f64_to_f32_c);
+	run_test("test_f64d_f32", "c", false, true, conv_f64d_to_f32_c);
+	run_test("test_f64_f32d", "c", true, false, conv_f64_to_f32d_c);
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f64_f32d", "avx2", true, false, conv_f64_to_f32d_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f64_f32d", "avx512", true, false, conv_f64_to_f32d_avx512);
+	}
+#endif
+	run_test("test_f64d_f32d", "c", false, false, conv_f64d_to_f32d_c);
+}
+
 static void test_interleave(void)
 {
 	run_test("test_8d_to_8", "c", false, true, conv_8d_to_8_c);
@@ -261,6 +355,105 @@ static void test_deinterleave(void)
 	run_test("test_32_to_32d", "c", true, false, conv_32_to_32d_c);
 }
 
+static void run_test_dither1(const char *name, const char *impl, uint32_t dst_fmt,
+		uint32_t method, uint32_t flags, int n_channels, int n_samples)
+{
+	int i, j;
+	const void *ip[n_channels];
+	void *op[n_channels];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct convert conv;
+	bool planar = dst_fmt == SPA_AUDIO_FORMAT_S16P;
+
+	spa_zero(conv);
+	conv.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	conv.dst_fmt = dst_fmt;
+	conv.n_channels = n_channels;
+	conv.rate = 48000;
+	conv.method = method;
+	conv.cpu_flags = flags;
+	spa_assert_se(convert_init(&conv) == 0);
+
+	for (j = 0; j < n_channels; j++) {
+		ip[j] = &samp_in[j * n_samples * 4];
+		op[j] = planar ? &samp_out[j * n_samples * 4] : samp_out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		convert_process(&conv, op, ip, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	convert_free(&conv);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_channels = n_channels,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test_dither(const char *name, const char *impl, uint32_t dst_fmt,
+		uint32_t method, uint32_t flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s) {
+		SPA_FOR_EACH_ELEMENT_VAR(channel_counts, c) {
+			run_test_dither1(name, impl, dst_fmt, method, flags, *c, (*s + (*c -1)) / *c);
+		}
+	}
+}
+
+static void test_dither(void)
+{
+	run_test_dither("test_f32d_s16_tri_hf", "c", SPA_AUDIO_FORMAT_S16,
+			DITHER_METHOD_TRIANGULAR_HF, 0);
+	run_test_dither("test_f32d_s16_shaped5", "c", SPA_AUDIO_FORMAT_S16,
+			DITHER_METHOD_LIPSHITZ, 0);
+	run_test_dither("test_f32d_s16d_shaped5", "c", SPA_AUDIO_FORMAT_S16P,
+			DITHER_METHOD_LIPSHITZ, 0);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test_dither("test_f32d_s16_tri_hf", "sse2", SPA_AUDIO_FORMAT_S16,
+				DITHER_METHOD_TRIANGULAR_HF, SPA_CPU_FLAG_SSE2);
+		run_test_dither("test_f32d_s16_shaped5", "sse2", SPA_AUDIO_FORMAT_S16,
+				DITHER_METHOD_LIPSHITZ, SPA_CPU_FLAG_SSE2);
+		run_test_dither("test_f32d_s16d_shaped5", "sse2", SPA_AUDIO_FORMAT_S16P,
+				DITHER_METHOD_LIPSHITZ, SPA_CPU_FLAG_SSE2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test_dither("test_f32d_s16_tri_hf", "avx2", SPA_AUDIO_FORMAT_S16,
+				DITHER_METHOD_TRIANGULAR_HF, SPA_CPU_FLAG_AVX2);
+		run_test_dither("test_f32d_s16_shaped5", "avx2", SPA_AUDIO_FORMAT_S16,
+				DITHER_METHOD_LIPSHITZ, SPA_CPU_FLAG_AVX2);
+		run_test_dither("test_f32d_s16d_shaped5", "avx2", SPA_AUDIO_FORMAT_S16P,
+				DITHER_METHOD_LIPSHITZ, SPA_CPU_FLAG_AVX2);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test_dither("test_f32d_s16_tri_hf", "neon", SPA_AUDIO_FORMAT_S16,
+				DITHER_METHOD_TRIANGULAR_HF, SPA_CPU_FLAG_NEON);
+		run_test_dither("test_f32d_s16_shaped5", "neon", SPA_AUDIO_FORMAT_S16,
+				DITHER_METHOD_LIPSHITZ, SPA_CPU_FLAG_NEON);
+		run_test_dither("test_f32d_s16d_shaped5", "neon", SPA_AUDIO_FORMAT_S16P,
+				DITHER_METHOD_LIPSHITZ, SPA_CPU_FLAG_NEON);
+	}
+#endif
+}
+
 static int compare_func(const void *_a, const void *_b)
 {
 	const struct stats *a = _a, *b = _b;
@@ -274,6 +467,8 @@ static int compare_func(const void *_a, const void *_b)
 
 int main(int argc, char *argv[])
 {
+	struct benchmark_results br;
+	char key[128];
 	uint32_t i;
 
 	cpu_flags = get_cpu_flags();
@@ -289,15 +484,22 @@ int main(int argc, char *argv[])
 	test_s24_f32();
 	test_f32_s24_32();
 	test_s24_32_f32();
+	test_f32_f64();
+	test_f64_f32();
 	test_interleave();
 	test_deinterleave();
+	test_dither();
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
+	benchmark_results_init(&br, "fmt-ops");
 	for (i = 0; i < n_results; i++) {
 		struct stats *s = &results[i];
 		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, channels %d\n",
 				s->perf, s->name, s->impl, s->n_samples, s->n_channels);
+		snprintf(key, sizeof(key), "%s/%s/%d/%d",
+				s->name, s->impl, s->n_samples, s->n_channels);
+		benchmark_results_add(&br, key, s->perf);
 	}
-	return 0;
+	return benchmark_results_finish(&br);
 }
@@ -0,0 +1,215 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <spa/utils/list.h>
+#include <spa/utils/string.h>
+
+#include <spa-private/cache-dir.h>
+
+#include "calibrate.h"
+
+#define CALIBRATE_RUNS		5
+
+struct result {
+	struct spa_list link;
+	uint32_t cpu_flags;
+	char key[];
+};
+
+/* results are shared between all instances in the process and
+ * backed by a file per CPU model */
+static struct spa_list results = SPA_LIST_INIT(&results);
+static pthread_mutex_t results_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool results_loaded;
+static char cache_path[PATH_MAX];
+
+static int get_cpu_model(char *model, size_t size)
+{
+	FILE *f;
+	char line[256], *val;
+	size_t len = 0;
+	bool done = false;
+
+	if ((f = fopen("/proc/cpuinfo", "r")) == NULL)
+		return -errno;
+
+	/* x86 has a model name, on ARM we use the implementer and the
+	 * part number of the first core */
+	while (!done && fgets(line, sizeof(line), f) != NULL) {
+		if ((val = strchr(line, ':')) == NULL)
+			continue;
+		val += strspn(val, ": \t");
+		val[strcspn(val, "\n")] = '\0';
+
+		if (spa_strstartswith(line, "model name") ||
+		    spa_strstartswith(line, "CPU part"))
+			done = true;
+		else if (!spa_strstartswith(line, "CPU implementer"))
+			continue;
+
+		len += spa_scnprintf(model + len, size - len, "%s%s",
+				len ? "-" : "", val);
+	}
+	fclose(f);
+	return len > 0 ? 0 : -ENOENT;
+}
+
+static int get_cache_path(char *path, size_t size)
+{
+	char model[128] = "", base[PATH_MAX], *p;
+	int res;
+
+	if (get_cpu_model(model, sizeof(model)) < 0)
+		return -ENOENT;
+
+	for (p = model; *p; p++) {
+		if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+		      (*p >= '0' && *p <= '9') || *p == '-'))
+			*p = '_';
+	}
+
+	if ((res = get_pipewire_cache_dir(base, sizeof(base), NULL, true)) < 0)
+		return res;
+
+	spa_scnprintf(path, size, "%s/calibrate-%s.conf", base, model);
+	return 0;
+}
+
+static struct result *find_result(const char *key)
+{
+	struct result *r;
+	spa_list_for_each(r, &results, link) {
+		if (spa_streq(r->key, key))
+			return r;
+	}
+	return NULL;
+}
+
+static void add_result(const char *key, uint32_t cpu_flags)
+{
+	struct result *r;
+
+	if ((r = find_result(key)) == NULL) {
+		if ((r = calloc(1, sizeof(*r) + strlen(key) + 1)) == NULL)
+			return;
+		strcpy(r->key, key);
+		spa_list_append(&results, &r->link);
+	}
+	r->cpu_flags = cpu_flags;
+}
+
+static void load_results(struct spa_log *log)
+{
+	FILE *f;
+	char line[256], key[128];
+	uint32_t cpu_flags;
+
+	results_loaded = true;
+
+	if (get_cache_path(cache_path, sizeof(cache_path)) < 0) {
+		cache_path[0] = '\0';
+		return;
+	}
+	if ((f = fopen(cache_path, "r")) == NULL)
+		return;
+
+	spa_log_debug(log, "calibrate: loading %s", cache_path);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "%127s %x", key, &cpu_flags) == 2)
+			add_result(key, cpu_flags);
+	}
+	fclose(f);
+}
+
+static void save_result(struct spa_log *log, const char *key, uint32_t cpu_flags)
+{
+	FILE *f;
+
+	if (cache_path[0] == '\0')
+		return;
+	if ((f = fopen(cache_path, "a")) == NULL) {
+		spa_log_warn(log, "calibrate: can't open %s: %m", cache_path);
+		return;
+	}
+	fprintf(f, "%s %08x\n", key, cpu_flags);
+	fclose(f);
+}
+
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static uint64_t time_candidate(calibrate_func_t func, void *data, uint32_t index)
+{
+	uint64_t t, best = UINT64_MAX;
+	uint32_t i;
+
+	/* warm up caches and the branch predictor */
+	func(data, index);
+
+	for (i = 0; i < CALIBRATE_RUNS; i++) {
+		t = get_time_ns();
+		func(data, index);
+		t = get_time_ns() - t;
+		best = SPA_MIN(best, t);
+	}
+	return best;
+}
+
+uint32_t calibrate_select(struct spa_log *log, const char *key,
+		const struct calibrate_candidate *candidates, uint32_t n_candidates,
+		calibrate_func_t func, void *data)
+{
+	struct result *r;
+	uint32_t i, best = 0;
+	uint64_t t, times[n_candidates];
+
+	if (n_candidates < 2)
+		return 0;
+
+	pthread_mutex_lock(&results_lock);
+	if (!results_loaded)
+		load_results(log);
+
+	if ((r = find_result(key)) != NULL) {
+		for (i = 0; i < n_candidates; i++) {
+			if (candidates[i].cpu_flags == r->cpu_flags) {
+				spa_log_info(log, "calibrate %s: using %s (cached)",
+						key, candidates[i].name);
+				best = i;
+				goto done;
+			}
+		}
+	}
+
+	/* candidates are timed with the lock held so that concurrent
+	 * instances don't disturb the measurements */
+	for (i = 0; i < n_candidates; i++) {
+		times[i] = t = time_candidate(func, data, i);
+		spa_log_debug(log, "calibrate %s: %s %08x: %"PRIu64"ns",
+				key, candidates[i].name, candidates[i].cpu_flags, t);
+		if (t < times[best])
+			best = i;
+	}
+	spa_log_info(log, "calibrate %s: using %s %"PRIu64"ns (%s %"PRIu64"ns)",
+			key, candidates[best].name, times[best],
+			candidates[0].name, times[0]);
+
+	add_result(key, candidates[best].cpu_flags);
+	save_result(log, key, candidates[best].cpu_flags);
+done:
+	pthread_mutex_unlock(&results_lock);
+	return best;
+}
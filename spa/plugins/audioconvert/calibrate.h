@@ -0,0 +1,34 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+#include <spa/utils/defs.h>
+#include <spa/support/log.h>
+
+/* number of samples to run each candidate kernel on */
+#define CALIBRATE_SAMPLES	1024
+
+struct calibrate_candidate {
+	const char *name;
+	uint32_t cpu_flags;
+};
+
+/* run candidate kernel \a index once on scratch data */
+typedef void (*calibrate_func_t) (void *data, uint32_t index);
+
+/* Select the fastest of \a n_candidates kernels for the operation
+ * identified by \a key.
+ *
+ * The candidates are ordered by preference, the first one is what the
+ * cpu flags would select. The result is cached in memory and on disk for
+ * the current CPU model so that the kernels are only timed once.
+ *
+ * Returns the index of the selected candidate. */
+uint32_t calibrate_select(struct spa_log *log, const char *key,
+		const struct calibrate_candidate *candidates, uint32_t n_candidates,
+		calibrate_func_t func, void *data);
+
+#endif /* CALIBRATE_H */
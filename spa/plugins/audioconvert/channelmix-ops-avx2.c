@@ -0,0 +1,605 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "channelmix-ops.h"
+
+#include <immintrin.h>
+
+static inline void clear_avx2(float *d, uint32_t n_samples)
+{
+	memset(d, 0, n_samples * sizeof(float));
+}
+
+static inline void copy_avx2(float *d, const float *s, uint32_t n_samples)
+{
+	spa_memcpy(d, s, n_samples * sizeof(float));
+}
+
+static inline void vol_avx2(float *d, const float *s, float vol, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	if (vol == 0.0f) {
+		clear_avx2(d, n_samples);
+	} else if (vol == 1.0f) {
+		copy_avx2(d, s, n_samples);
+	} else {
+		__m256 t[4];
+		const __m256 v = _mm256_set1_ps(vol);
+
+		unrolled = n_samples & ~31;
+
+		for(n = 0; n < unrolled; n += 32) {
+			t[0] = _mm256_loadu_ps(&s[n]);
+			t[1] = _mm256_loadu_ps(&s[n+8]);
+			t[2] = _mm256_loadu_ps(&s[n+16]);
+			t[3] = _mm256_loadu_ps(&s[n+24]);
+			_mm256_storeu_ps(&d[n], _mm256_mul_ps(t[0], v));
+			_mm256_storeu_ps(&d[n+8], _mm256_mul_ps(t[1], v));
+			_mm256_storeu_ps(&d[n+16], _mm256_mul_ps(t[2], v));
+			_mm256_storeu_ps(&d[n+24], _mm256_mul_ps(t[3], v));
+		}
+		for(; n < n_samples; n++)
+			_mm_store_ss(&d[n], _mm_mul_ss(_mm_load_ss(&s[n]),
+						_mm256_castps256_ps128(v)));
+	}
+}
+
+static inline void conv_avx2(float *d, const float **s, float *c, uint32_t n_c, uint32_t n_samples)
+{
+	__m256 mi[n_c], sum[2];
+	__m128 t;
+	uint32_t n, j, unrolled;
+
+	for (j = 0; j < n_c; j++)
+		mi[j] = _mm256_set1_ps(c[j]);
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		sum[0] = sum[1] = _mm256_setzero_ps();
+		for (j = 0; j < n_c; j++) {
+			sum[0] = _mm256_add_ps(sum[0], _mm256_mul_ps(_mm256_loadu_ps(&s[j][n + 0]), mi[j]));
+			sum[1] = _mm256_add_ps(sum[1], _mm256_mul_ps(_mm256_loadu_ps(&s[j][n + 8]), mi[j]));
+		}
+		_mm256_storeu_ps(&d[n + 0], sum[0]);
+		_mm256_storeu_ps(&d[n + 8], sum[1]);
+	}
+	for (; n < n_samples; n++) {
+		t = _mm_setzero_ps();
+		for (j = 0; j < n_c; j++)
+			t = _mm_add_ss(t, _mm_mul_ss(_mm_load_ss(&s[j][n]),
+						_mm256_castps256_ps128(mi[j])));
+		_mm_store_ss(&d[n], t);
+	}
+}
+
+static inline void avg_avx2(float *d, const float *s0, const float *s1, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m256 half = _mm256_set1_ps(0.5f);
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		_mm256_storeu_ps(&d[n + 0],
+				_mm256_mul_ps(
+					_mm256_add_ps(
+						_mm256_loadu_ps(&s0[n + 0]),
+						_mm256_loadu_ps(&s1[n + 0])),
+					half));
+		_mm256_storeu_ps(&d[n + 8],
+				_mm256_mul_ps(
+					_mm256_add_ps(
+						_mm256_loadu_ps(&s0[n + 8]),
+						_mm256_loadu_ps(&s1[n + 8])),
+					half));
+	}
+	for (; n < n_samples; n++)
+		d[n] = (s0[n] + s1[n]) * 0.5f;
+}
+
+static inline void sub_avx2(float *d, const float *s0, const float *s1, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		_mm256_storeu_ps(&d[n + 0],
+			_mm256_sub_ps(_mm256_loadu_ps(&s0[n + 0]), _mm256_loadu_ps(&s1[n + 0])));
+		_mm256_storeu_ps(&d[n + 8],
+			_mm256_sub_ps(_mm256_loadu_ps(&s0[n + 8]), _mm256_loadu_ps(&s1[n + 8])));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s0[n] - s1[n];
+}
+
+void channelmix_copy_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	for (i = 0; i < n_dst; i++)
+		vol_avx2(d[i], s[i], mix->matrix[i][i], n_samples);
+}
+
+void
+channelmix_f32_n_m_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	uint32_t i, j, n_dst = mix->dst_chan, n_src = mix->src_chan;
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+		return;
+	}
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		float mj[n_src];
+		const float *sj[n_src];
+		uint32_t n_j = 0;
+
+		/* only mix the sources with a non zero coefficient, most
+		 * downmix matrices are sparse */
+		for (j = 0; j < n_src; j++) {
+			if (mix->matrix[i][j] == 0.0f)
+				continue;
+			mj[n_j] = mix->matrix[i][j];
+			sj[n_j++] = s[j];
+		}
+		if (n_j == 0) {
+			clear_avx2(di, n_samples);
+		} else if (n_j == 1) {
+			if (mix->lr4[i].active)
+				lr4_process(&mix->lr4[i], di, sj[0], mj[0], n_samples);
+			else
+				vol_avx2(di, sj[0], mj[0], n_samples);
+		} else {
+			conv_avx2(di, sj, mj, n_j, n_samples);
+			lr4_process(&mix->lr4[i], di, di, 1.0f, n_samples);
+		}
+	}
+}
+
+void
+channelmix_f32_2_3p1_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float v0 = mix->matrix[0][0];
+	const float v1 = mix->matrix[1][1];
+	const float v2 = (mix->matrix[2][0] + mix->matrix[2][1]) * 0.5f;
+	const float v3 = (mix->matrix[3][0] + mix->matrix[3][1]) * 0.5f;
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		if (mix->widen == 0.0f) {
+			vol_avx2(d[0], s[0], v0, n_samples);
+			vol_avx2(d[1], s[1], v1, n_samples);
+			avg_avx2(d[2], s[0], s[1], n_samples);
+		} else {
+			const __m256 mv0 = _mm256_set1_ps(v0);
+			const __m256 mv1 = _mm256_set1_ps(v1);
+			const __m256 mw = _mm256_set1_ps(mix->widen);
+			const __m256 mh = _mm256_set1_ps(0.5f);
+			__m256 t0, t1, w, c;
+
+			unrolled = n_samples & ~7;
+
+			for(n = 0; n < unrolled; n += 8) {
+				t0 = _mm256_loadu_ps(&s[0][n]);
+				t1 = _mm256_loadu_ps(&s[1][n]);
+				c = _mm256_add_ps(t0, t1);
+				w = _mm256_mul_ps(c, mw);
+				_mm256_storeu_ps(&d[0][n], _mm256_mul_ps(_mm256_sub_ps(t0, w), mv0));
+				_mm256_storeu_ps(&d[1][n], _mm256_mul_ps(_mm256_sub_ps(t1, w), mv1));
+				_mm256_storeu_ps(&d[2][n], _mm256_mul_ps(c, mh));
+			}
+			for (; n < n_samples; n++) {
+				float c = s[0][n] + s[1][n];
+				float w = c * mix->widen;
+				d[0][n] = (s[0][n] - w) * v0;
+				d[1][n] = (s[1][n] - w) * v1;
+				d[2][n] = c * 0.5f;
+			}
+		}
+		lr4_process(&mix->lr4[3], d[3], d[2], v3, n_samples);
+		lr4_process(&mix->lr4[2], d[2], d[2], v2, n_samples);
+	}
+}
+
+void
+channelmix_f32_2_5p1_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float v4 = mix->matrix[4][0];
+	const float v5 = mix->matrix[5][1];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		channelmix_f32_2_3p1_avx2(mix, dst, src, n_samples);
+
+		if (mix->upmix != CHANNELMIX_UPMIX_PSD) {
+			vol_avx2(d[4], s[0], v4, n_samples);
+			vol_avx2(d[5], s[1], v5, n_samples);
+		} else {
+			sub_avx2(d[4], s[0], s[1], n_samples);
+
+			delay_convolve_run(mix->buffer[1], &mix->pos[1], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[5], d[4], -v5, n_samples);
+			delay_convolve_run(mix->buffer[0], &mix->pos[0], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[4], d[4], v4, n_samples);
+		}
+	}
+}
+
+void
+channelmix_f32_2_7p1_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float v4 = mix->matrix[4][0];
+	const float v5 = mix->matrix[5][1];
+	const float v6 = mix->matrix[6][0];
+	const float v7 = mix->matrix[7][1];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		channelmix_f32_2_3p1_avx2(mix, dst, src, n_samples);
+
+		vol_avx2(d[4], s[0], v4, n_samples);
+		vol_avx2(d[5], s[1], v5, n_samples);
+
+		if (mix->upmix != CHANNELMIX_UPMIX_PSD) {
+			vol_avx2(d[6], s[0], v6, n_samples);
+			vol_avx2(d[7], s[1], v7, n_samples);
+		} else {
+			sub_avx2(d[6], s[0], s[1], n_samples);
+
+			delay_convolve_run(mix->buffer[1], &mix->pos[1], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[7], d[6], -v7, n_samples);
+			delay_convolve_run(mix->buffer[0], &mix->pos[0], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[6], d[6], v6, n_samples);
+		}
+	}
+}
+
+/* FL+FR+FC+LFE -> FL+FR */
+void
+channelmix_f32_3p1_2_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+
+	if (m0 == 0.0f && m1 == 0.0f && m2 == 0.0f && m3 == 0.0f) {
+		clear_avx2(d[0], n_samples);
+		clear_avx2(d[1], n_samples);
+	}
+	else {
+		uint32_t n, unrolled;
+		const __m256 v0 = _mm256_set1_ps(m0);
+		const __m256 v1 = _mm256_set1_ps(m1);
+		const __m256 clev = _mm256_set1_ps(m2);
+		const __m256 llev = _mm256_set1_ps(m3);
+		__m256 ctr;
+
+		unrolled = n_samples & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			ctr = _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[2][n]), clev),
+					_mm256_mul_ps(_mm256_loadu_ps(&s[3][n]), llev));
+			_mm256_storeu_ps(&d[0][n], _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s[0][n]), v0), ctr));
+			_mm256_storeu_ps(&d[1][n], _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s[1][n]), v1), ctr));
+		}
+		for(; n < n_samples; n++) {
+			const float c = m2 * s[2][n] + m3 * s[3][n];
+			d[0][n] = s[0][n] * m0 + c;
+			d[1][n] = s[1][n] * m1 + c;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float m4 = mix->matrix[0][4];
+	const float m5 = mix->matrix[1][5];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		clear_avx2(d[0], n_samples);
+		clear_avx2(d[1], n_samples);
+	}
+	else {
+		const __m256 v0 = _mm256_set1_ps(m0);
+		const __m256 v1 = _mm256_set1_ps(m1);
+		const __m256 clev = _mm256_set1_ps(m2);
+		const __m256 llev = _mm256_set1_ps(m3);
+		const __m256 slev0 = _mm256_set1_ps(m4);
+		const __m256 slev1 = _mm256_set1_ps(m5);
+		__m256 in, ctr;
+
+		unrolled = n_samples & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			ctr = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s[2][n]), clev),
+					_mm256_mul_ps(_mm256_loadu_ps(&s[3][n]), llev));
+			in = _mm256_mul_ps(_mm256_loadu_ps(&s[0][n]), v0);
+			in = _mm256_add_ps(in, ctr);
+			in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&s[4][n]), slev0));
+			_mm256_storeu_ps(&d[0][n], in);
+			in = _mm256_mul_ps(_mm256_loadu_ps(&s[1][n]), v1);
+			in = _mm256_add_ps(in, ctr);
+			in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&s[5][n]), slev1));
+			_mm256_storeu_ps(&d[1][n], in);
+		}
+		for(; n < n_samples; n++) {
+			const float c = m2 * s[2][n] + m3 * s[3][n];
+			d[0][n] = s[0][n] * m0 + c + (m4 * s[4][n]);
+			d[1][n] = s[1][n] * m1 + c + (m5 * s[5][n]);
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_5p1_3p1_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m4 = mix->matrix[0][4];
+	const float m5 = mix->matrix[1][5];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		const __m256 v0 = _mm256_set1_ps(m0);
+		const __m256 v1 = _mm256_set1_ps(m1);
+		const __m256 slev0 = _mm256_set1_ps(m4);
+		const __m256 slev1 = _mm256_set1_ps(m5);
+
+		unrolled = n_samples & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			_mm256_storeu_ps(&d[0][n], _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[0][n]), v0),
+					_mm256_mul_ps(_mm256_loadu_ps(&s[4][n]), slev0)));
+
+			_mm256_storeu_ps(&d[1][n], _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[1][n]), v1),
+					_mm256_mul_ps(_mm256_loadu_ps(&s[5][n]), slev1)));
+		}
+		for(; n < n_samples; n++) {
+			d[0][n] = s[0][n] * m0 + s[4][n] * m4;
+			d[1][n] = s[1][n] * m1 + s[5][n] * m5;
+		}
+		vol_avx2(d[2], s[2], mix->matrix[2][2], n_samples);
+		vol_avx2(d[3], s[3], mix->matrix[3][3], n_samples);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+RL+RR*/
+void
+channelmix_f32_5p1_4_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float v4 = mix->matrix[2][4];
+	const float v5 = mix->matrix[3][5];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		channelmix_f32_3p1_2_avx2(mix, dst, src, n_samples);
+
+		vol_avx2(d[2], s[4], v4, n_samples);
+		vol_avx2(d[3], s[5], v5, n_samples);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR */
+void
+channelmix_f32_7p1_2_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float m4 = mix->matrix[0][4];
+	const float m5 = mix->matrix[1][5];
+	const float m6 = mix->matrix[0][6];
+	const float m7 = mix->matrix[1][7];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		clear_avx2(d[0], n_samples);
+		clear_avx2(d[1], n_samples);
+	}
+	else {
+		const __m256 v0 = _mm256_set1_ps(m0);
+		const __m256 v1 = _mm256_set1_ps(m1);
+		const __m256 clev = _mm256_set1_ps(m2);
+		const __m256 llev = _mm256_set1_ps(m3);
+		const __m256 slev0 = _mm256_set1_ps(m4);
+		const __m256 slev1 = _mm256_set1_ps(m5);
+		const __m256 rlev0 = _mm256_set1_ps(m6);
+		const __m256 rlev1 = _mm256_set1_ps(m7);
+		__m256 in, ctr;
+
+		unrolled = n_samples & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			ctr = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s[2][n]), clev),
+					_mm256_mul_ps(_mm256_loadu_ps(&s[3][n]), llev));
+			in = _mm256_mul_ps(_mm256_loadu_ps(&s[0][n]), v0);
+			in = _mm256_add_ps(in, ctr);
+			in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&s[4][n]), slev0));
+			in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&s[6][n]), rlev0));
+			_mm256_storeu_ps(&d[0][n], in);
+			in = _mm256_mul_ps(_mm256_loadu_ps(&s[1][n]), v1);
+			in = _mm256_add_ps(in, ctr);
+			in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&s[5][n]), slev1));
+			in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&s[7][n]), rlev1));
+			_mm256_storeu_ps(&d[1][n], in);
+		}
+		for(; n < n_samples; n++) {
+			const float c = m2 * s[2][n] + m3 * s[3][n];
+			d[0][n] = s[0][n] * m0 + c + s[4][n] * m4 + s[6][n] * m6;
+			d[1][n] = s[1][n] * m1 + c + s[5][n] * m5 + s[7][n] * m7;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_7p1_3p1_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m4 = (mix->matrix[0][4] + mix->matrix[0][6]) * 0.5f;
+	const float m5 = (mix->matrix[1][5] + mix->matrix[1][7]) * 0.5f;
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		const __m256 v0 = _mm256_set1_ps(m0);
+		const __m256 v1 = _mm256_set1_ps(m1);
+		const __m256 slev0 = _mm256_set1_ps(m4);
+		const __m256 slev1 = _mm256_set1_ps(m5);
+
+		unrolled = n_samples & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			_mm256_storeu_ps(&d[0][n], _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[0][n]), v0),
+					_mm256_mul_ps(_mm256_add_ps(
+							_mm256_loadu_ps(&s[4][n]),
+							_mm256_loadu_ps(&s[6][n])), slev0)));
+			_mm256_storeu_ps(&d[1][n], _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[1][n]), v1),
+					_mm256_mul_ps(_mm256_add_ps(
+							_mm256_loadu_ps(&s[5][n]),
+							_mm256_loadu_ps(&s[7][n])), slev1)));
+		}
+		for(; n < n_samples; n++) {
+			d[0][n] = s[0][n] * m0 + (s[4][n] + s[6][n]) * m4;
+			d[1][n] = s[1][n] * m1 + (s[5][n] + s[7][n]) * m5;
+		}
+		vol_avx2(d[2], s[2], mix->matrix[2][2], n_samples);
+		vol_avx2(d[3], s[3], mix->matrix[3][3], n_samples);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+RL+RR*/
+void
+channelmix_f32_7p1_4_avx2(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float m4 = mix->matrix[2][4];
+	const float m5 = mix->matrix[3][5];
+	const float m6 = mix->matrix[2][6];
+	const float m7 = mix->matrix[3][7];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_avx2(d[i], n_samples);
+	}
+	else {
+		const __m256 v0 = _mm256_set1_ps(m0);
+		const __m256 v1 = _mm256_set1_ps(m1);
+		const __m256 clev = _mm256_set1_ps(m2);
+		const __m256 llev = _mm256_set1_ps(m3);
+		const __m256 slev0 = _mm256_set1_ps(m4);
+		const __m256 slev1 = _mm256_set1_ps(m5);
+		const __m256 rlev0 = _mm256_set1_ps(m6);
+		const __m256 rlev1 = _mm256_set1_ps(m7);
+		__m256 ctr, sl, sr;
+
+		unrolled = n_samples & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			ctr = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s[2][n]), clev),
+					_mm256_mul_ps(_mm256_loadu_ps(&s[3][n]), llev));
+			sl = _mm256_mul_ps(_mm256_loadu_ps(&s[4][n]), slev0);
+			sr = _mm256_mul_ps(_mm256_loadu_ps(&s[5][n]), slev1);
+			_mm256_storeu_ps(&d[0][n], _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[0][n]), v0), ctr), sl));
+			_mm256_storeu_ps(&d[1][n], _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[1][n]), v1), ctr), sr));
+			_mm256_storeu_ps(&d[2][n], _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[6][n]), rlev0), sl));
+			_mm256_storeu_ps(&d[3][n], _mm256_add_ps(
+					_mm256_mul_ps(_mm256_loadu_ps(&s[7][n]), rlev1), sr));
+		}
+		for(; n < n_samples; n++) {
+			const float c = s[2][n] * m2 + s[3][n] * m3;
+			const float l = s[4][n] * m4;
+			const float r = s[5][n] * m5;
+			d[0][n] = s[0][n] * m0 + c + l;
+			d[1][n] = s[1][n] * m1 + c + r;
+			d[2][n] = s[6][n] * m6 + l;
+			d[3][n] = s[7][n] * m7 + r;
+		}
+	}
+}
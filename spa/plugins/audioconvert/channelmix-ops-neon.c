@@ -0,0 +1,544 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "channelmix-ops.h"
+
+#include <arm_neon.h>
+
+static inline void clear_neon(float *d, uint32_t n_samples)
+{
+	memset(d, 0, n_samples * sizeof(float));
+}
+
+static inline void copy_neon(float *d, const float *s, uint32_t n_samples)
+{
+	spa_memcpy(d, s, n_samples * sizeof(float));
+}
+
+static inline void vol_neon(float *d, const float *s, float vol, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	if (vol == 0.0f) {
+		clear_neon(d, n_samples);
+	} else if (vol == 1.0f) {
+		copy_neon(d, s, n_samples);
+	} else {
+		float32x4_t t[4];
+
+		unrolled = n_samples & ~15;
+
+		for(n = 0; n < unrolled; n += 16) {
+			t[0] = vld1q_f32(&s[n]);
+			t[1] = vld1q_f32(&s[n+4]);
+			t[2] = vld1q_f32(&s[n+8]);
+			t[3] = vld1q_f32(&s[n+12]);
+			vst1q_f32(&d[n], vmulq_n_f32(t[0], vol));
+			vst1q_f32(&d[n+4], vmulq_n_f32(t[1], vol));
+			vst1q_f32(&d[n+8], vmulq_n_f32(t[2], vol));
+			vst1q_f32(&d[n+12], vmulq_n_f32(t[3], vol));
+		}
+		for(; n < n_samples; n++)
+			d[n] = s[n] * vol;
+	}
+}
+
+static inline void conv_neon(float *d, const float **s, float *c, uint32_t n_c, uint32_t n_samples)
+{
+	float32x4_t sum[2];
+	uint32_t n, j, unrolled;
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		sum[0] = sum[1] = vdupq_n_f32(0.0f);
+		for (j = 0; j < n_c; j++) {
+			sum[0] = vaddq_f32(sum[0], vmulq_n_f32(vld1q_f32(&s[j][n + 0]), c[j]));
+			sum[1] = vaddq_f32(sum[1], vmulq_n_f32(vld1q_f32(&s[j][n + 4]), c[j]));
+		}
+		vst1q_f32(&d[n + 0], sum[0]);
+		vst1q_f32(&d[n + 4], sum[1]);
+	}
+	for (; n < n_samples; n++) {
+		float t = 0.0f;
+		for (j = 0; j < n_c; j++)
+			t += s[j][n] * c[j];
+		d[n] = t;
+	}
+}
+
+static inline void avg_neon(float *d, const float *s0, const float *s1, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		vst1q_f32(&d[n + 0], vmulq_n_f32(vaddq_f32(
+					vld1q_f32(&s0[n + 0]), vld1q_f32(&s1[n + 0])), 0.5f));
+		vst1q_f32(&d[n + 4], vmulq_n_f32(vaddq_f32(
+					vld1q_f32(&s0[n + 4]), vld1q_f32(&s1[n + 4])), 0.5f));
+	}
+	for (; n < n_samples; n++)
+		d[n] = (s0[n] + s1[n]) * 0.5f;
+}
+
+static inline void sub_neon(float *d, const float *s0, const float *s1, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		vst1q_f32(&d[n + 0], vsubq_f32(vld1q_f32(&s0[n + 0]), vld1q_f32(&s1[n + 0])));
+		vst1q_f32(&d[n + 4], vsubq_f32(vld1q_f32(&s0[n + 4]), vld1q_f32(&s1[n + 4])));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s0[n] - s1[n];
+}
+
+void channelmix_copy_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	for (i = 0; i < n_dst; i++)
+		vol_neon(d[i], s[i], mix->matrix[i][i], n_samples);
+}
+
+void
+channelmix_f32_n_m_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	uint32_t i, j, n_dst = mix->dst_chan, n_src = mix->src_chan;
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+		return;
+	}
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		float mj[n_src];
+		const float *sj[n_src];
+		uint32_t n_j = 0;
+
+		/* only mix the sources with a non zero coefficient, most
+		 * downmix matrices are sparse */
+		for (j = 0; j < n_src; j++) {
+			if (mix->matrix[i][j] == 0.0f)
+				continue;
+			mj[n_j] = mix->matrix[i][j];
+			sj[n_j++] = s[j];
+		}
+		if (n_j == 0) {
+			clear_neon(di, n_samples);
+		} else if (n_j == 1) {
+			if (mix->lr4[i].active)
+				lr4_process(&mix->lr4[i], di, sj[0], mj[0], n_samples);
+			else
+				vol_neon(di, sj[0], mj[0], n_samples);
+		} else {
+			conv_neon(di, sj, mj, n_j, n_samples);
+			lr4_process(&mix->lr4[i], di, di, 1.0f, n_samples);
+		}
+	}
+}
+
+void
+channelmix_f32_2_3p1_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float v0 = mix->matrix[0][0];
+	const float v1 = mix->matrix[1][1];
+	const float v2 = (mix->matrix[2][0] + mix->matrix[2][1]) * 0.5f;
+	const float v3 = (mix->matrix[3][0] + mix->matrix[3][1]) * 0.5f;
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		if (mix->widen == 0.0f) {
+			vol_neon(d[0], s[0], v0, n_samples);
+			vol_neon(d[1], s[1], v1, n_samples);
+			avg_neon(d[2], s[0], s[1], n_samples);
+		} else {
+			const float widen = mix->widen;
+			float32x4_t t0, t1, w, c;
+
+			unrolled = n_samples & ~3;
+
+			for(n = 0; n < unrolled; n += 4) {
+				t0 = vld1q_f32(&s[0][n]);
+				t1 = vld1q_f32(&s[1][n]);
+				c = vaddq_f32(t0, t1);
+				w = vmulq_n_f32(c, widen);
+				vst1q_f32(&d[0][n], vmulq_n_f32(vsubq_f32(t0, w), v0));
+				vst1q_f32(&d[1][n], vmulq_n_f32(vsubq_f32(t1, w), v1));
+				vst1q_f32(&d[2][n], vmulq_n_f32(c, 0.5f));
+			}
+			for (; n < n_samples; n++) {
+				float c = s[0][n] + s[1][n];
+				float w = c * widen;
+				d[0][n] = (s[0][n] - w) * v0;
+				d[1][n] = (s[1][n] - w) * v1;
+				d[2][n] = c * 0.5f;
+			}
+		}
+		lr4_process(&mix->lr4[3], d[3], d[2], v3, n_samples);
+		lr4_process(&mix->lr4[2], d[2], d[2], v2, n_samples);
+	}
+}
+
+void
+channelmix_f32_2_5p1_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float v4 = mix->matrix[4][0];
+	const float v5 = mix->matrix[5][1];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		channelmix_f32_2_3p1_neon(mix, dst, src, n_samples);
+
+		if (mix->upmix != CHANNELMIX_UPMIX_PSD) {
+			vol_neon(d[4], s[0], v4, n_samples);
+			vol_neon(d[5], s[1], v5, n_samples);
+		} else {
+			sub_neon(d[4], s[0], s[1], n_samples);
+
+			delay_convolve_run(mix->buffer[1], &mix->pos[1], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[5], d[4], -v5, n_samples);
+			delay_convolve_run(mix->buffer[0], &mix->pos[0], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[4], d[4], v4, n_samples);
+		}
+	}
+}
+
+void
+channelmix_f32_2_7p1_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float v4 = mix->matrix[4][0];
+	const float v5 = mix->matrix[5][1];
+	const float v6 = mix->matrix[6][0];
+	const float v7 = mix->matrix[7][1];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		channelmix_f32_2_3p1_neon(mix, dst, src, n_samples);
+
+		vol_neon(d[4], s[0], v4, n_samples);
+		vol_neon(d[5], s[1], v5, n_samples);
+
+		if (mix->upmix != CHANNELMIX_UPMIX_PSD) {
+			vol_neon(d[6], s[0], v6, n_samples);
+			vol_neon(d[7], s[1], v7, n_samples);
+		} else {
+			sub_neon(d[6], s[0], s[1], n_samples);
+
+			delay_convolve_run(mix->buffer[1], &mix->pos[1], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[7], d[6], -v7, n_samples);
+			delay_convolve_run(mix->buffer[0], &mix->pos[0], BUFFER_SIZE, mix->delay,
+					mix->taps, mix->n_taps, d[6], d[6], v6, n_samples);
+		}
+	}
+}
+
+/* FL+FR+FC+LFE -> FL+FR */
+void
+channelmix_f32_3p1_2_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		   const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+
+	if (m0 == 0.0f && m1 == 0.0f && m2 == 0.0f && m3 == 0.0f) {
+		clear_neon(d[0], n_samples);
+		clear_neon(d[1], n_samples);
+	}
+	else {
+		uint32_t n, unrolled;
+		float32x4_t ctr;
+
+		unrolled = n_samples & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vaddq_f32(vmulq_n_f32(vld1q_f32(&s[2][n]), m2),
+					vmulq_n_f32(vld1q_f32(&s[3][n]), m3));
+			vst1q_f32(&d[0][n], vaddq_f32(vmulq_n_f32(vld1q_f32(&s[0][n]), m0), ctr));
+			vst1q_f32(&d[1][n], vaddq_f32(vmulq_n_f32(vld1q_f32(&s[1][n]), m1), ctr));
+		}
+		for(; n < n_samples; n++) {
+			const float c = m2 * s[2][n] + m3 * s[3][n];
+			d[0][n] = s[0][n] * m0 + c;
+			d[1][n] = s[1][n] * m1 + c;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float m4 = mix->matrix[0][4];
+	const float m5 = mix->matrix[1][5];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		clear_neon(d[0], n_samples);
+		clear_neon(d[1], n_samples);
+	}
+	else {
+		float32x4_t in, ctr;
+
+		unrolled = n_samples & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vaddq_f32(vmulq_n_f32(vld1q_f32(&s[2][n]), m2),
+					vmulq_n_f32(vld1q_f32(&s[3][n]), m3));
+			in = vmulq_n_f32(vld1q_f32(&s[0][n]), m0);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vmulq_n_f32(vld1q_f32(&s[4][n]), m4));
+			vst1q_f32(&d[0][n], in);
+			in = vmulq_n_f32(vld1q_f32(&s[1][n]), m1);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vmulq_n_f32(vld1q_f32(&s[5][n]), m5));
+			vst1q_f32(&d[1][n], in);
+		}
+		for(; n < n_samples; n++) {
+			const float c = m2 * s[2][n] + m3 * s[3][n];
+			d[0][n] = s[0][n] * m0 + c + (m4 * s[4][n]);
+			d[1][n] = s[1][n] * m1 + c + (m5 * s[5][n]);
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_5p1_3p1_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m4 = mix->matrix[0][4];
+	const float m5 = mix->matrix[1][5];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		unrolled = n_samples & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			vst1q_f32(&d[0][n], vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[0][n]), m0),
+					vmulq_n_f32(vld1q_f32(&s[4][n]), m4)));
+			vst1q_f32(&d[1][n], vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[1][n]), m1),
+					vmulq_n_f32(vld1q_f32(&s[5][n]), m5)));
+		}
+		for(; n < n_samples; n++) {
+			d[0][n] = s[0][n] * m0 + s[4][n] * m4;
+			d[1][n] = s[1][n] * m1 + s[5][n] * m5;
+		}
+		vol_neon(d[2], s[2], mix->matrix[2][2], n_samples);
+		vol_neon(d[3], s[3], mix->matrix[3][3], n_samples);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+RL+RR*/
+void
+channelmix_f32_5p1_4_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float v4 = mix->matrix[2][4];
+	const float v5 = mix->matrix[3][5];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		channelmix_f32_3p1_2_neon(mix, dst, src, n_samples);
+
+		vol_neon(d[2], s[4], v4, n_samples);
+		vol_neon(d[3], s[5], v5, n_samples);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR */
+void
+channelmix_f32_7p1_2_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float m4 = mix->matrix[0][4];
+	const float m5 = mix->matrix[1][5];
+	const float m6 = mix->matrix[0][6];
+	const float m7 = mix->matrix[1][7];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		clear_neon(d[0], n_samples);
+		clear_neon(d[1], n_samples);
+	}
+	else {
+		float32x4_t in, ctr;
+
+		unrolled = n_samples & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vaddq_f32(vmulq_n_f32(vld1q_f32(&s[2][n]), m2),
+					vmulq_n_f32(vld1q_f32(&s[3][n]), m3));
+			in = vmulq_n_f32(vld1q_f32(&s[0][n]), m0);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vmulq_n_f32(vld1q_f32(&s[4][n]), m4));
+			in = vaddq_f32(in, vmulq_n_f32(vld1q_f32(&s[6][n]), m6));
+			vst1q_f32(&d[0][n], in);
+			in = vmulq_n_f32(vld1q_f32(&s[1][n]), m1);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vmulq_n_f32(vld1q_f32(&s[5][n]), m5));
+			in = vaddq_f32(in, vmulq_n_f32(vld1q_f32(&s[7][n]), m7));
+			vst1q_f32(&d[1][n], in);
+		}
+		for(; n < n_samples; n++) {
+			const float c = m2 * s[2][n] + m3 * s[3][n];
+			d[0][n] = s[0][n] * m0 + c + s[4][n] * m4 + s[6][n] * m6;
+			d[1][n] = s[1][n] * m1 + c + s[5][n] * m5 + s[7][n] * m7;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_7p1_3p1_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m4 = (mix->matrix[0][4] + mix->matrix[0][6]) * 0.5f;
+	const float m5 = (mix->matrix[1][5] + mix->matrix[1][7]) * 0.5f;
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		unrolled = n_samples & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			vst1q_f32(&d[0][n], vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[0][n]), m0),
+					vmulq_n_f32(vaddq_f32(vld1q_f32(&s[4][n]),
+							vld1q_f32(&s[6][n])), m4)));
+			vst1q_f32(&d[1][n], vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[1][n]), m1),
+					vmulq_n_f32(vaddq_f32(vld1q_f32(&s[5][n]),
+							vld1q_f32(&s[7][n])), m5)));
+		}
+		for(; n < n_samples; n++) {
+			d[0][n] = s[0][n] * m0 + (s[4][n] + s[6][n]) * m4;
+			d[1][n] = s[1][n] * m1 + (s[5][n] + s[7][n]) * m5;
+		}
+		vol_neon(d[2], s[2], mix->matrix[2][2], n_samples);
+		vol_neon(d[3], s[3], mix->matrix[3][3], n_samples);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+RL+RR*/
+void
+channelmix_f32_7p1_4_neon(struct channelmix *mix, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_dst = mix->dst_chan;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0];
+	const float m1 = mix->matrix[1][1];
+	const float m2 = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float m3 = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float m4 = mix->matrix[2][4];
+	const float m5 = mix->matrix[3][5];
+	const float m6 = mix->matrix[2][6];
+	const float m7 = mix->matrix[3][7];
+
+	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
+		for (i = 0; i < n_dst; i++)
+			clear_neon(d[i], n_samples);
+	}
+	else {
+		float32x4_t ctr, sl, sr;
+
+		unrolled = n_samples & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vaddq_f32(vmulq_n_f32(vld1q_f32(&s[2][n]), m2),
+					vmulq_n_f32(vld1q_f32(&s[3][n]), m3));
+			sl = vmulq_n_f32(vld1q_f32(&s[4][n]), m4);
+			sr = vmulq_n_f32(vld1q_f32(&s[5][n]), m5);
+			vst1q_f32(&d[0][n], vaddq_f32(vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[0][n]), m0), ctr), sl));
+			vst1q_f32(&d[1][n], vaddq_f32(vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[1][n]), m1), ctr), sr));
+			vst1q_f32(&d[2][n], vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[6][n]), m6), sl));
+			vst1q_f32(&d[3][n], vaddq_f32(
+					vmulq_n_f32(vld1q_f32(&s[7][n]), m7), sr));
+		}
+		for(; n < n_samples; n++) {
+			const float c = s[2][n] * m2 + s[3][n] * m3;
+			const float l = s[4][n] * m4;
+			const float r = s[5][n] * m5;
+			d[0][n] = s[0][n] * m0 + c + l;
+			d[1][n] = s[1][n] * m1 + c + r;
+			d[2][n] = s[6][n] * m6 + l;
+			d[3][n] = s[7][n] * m7 + r;
+		}
+	}
+}
@@ -60,7 +60,7 @@ struct channelmix {
 	uint32_t hilbert_taps;				/* to phase shift, 0 disabled */
 	struct lr4 lr4[SPA_AUDIO_MAX_CHANNELS];
 
-	float buffer[2][BUFFER_SIZE];
+	float buffer[2][BUFFER_SIZE * 2];
 	uint32_t pos[2];
 	uint32_t delay;
 	float taps[MAX_TAPS];
@@ -77,6 +77,18 @@ struct channelmix {
 
 int channelmix_init(struct channelmix *mix);
 
+/** the mix has no filters or delay lines that need to see the silence */
+static inline bool channelmix_is_stateless(struct channelmix *mix)
+{
+	uint32_t i;
+	if (mix->delay > 0 || mix->n_taps > 1)
+		return false;
+	for (i = 0; i < mix->dst_chan; i++)
+		if (mix->lr4[i].active)
+			return false;
+	return true;
+}
+
 static const struct channelmix_upmix_info {
 	const char *label;
 	const char *description;
@@ -136,5 +148,33 @@ DEFINE_FUNCTION(f32_5p1_3p1, sse);
 DEFINE_FUNCTION(f32_5p1_4, sse);
 DEFINE_FUNCTION(f32_7p1_4, sse);
 #endif
+#if defined (HAVE_AVX2)
+DEFINE_FUNCTION(copy, avx2);
+DEFINE_FUNCTION(f32_n_m, avx2);
+DEFINE_FUNCTION(f32_2_3p1, avx2);
+DEFINE_FUNCTION(f32_2_5p1, avx2);
+DEFINE_FUNCTION(f32_2_7p1, avx2);
+DEFINE_FUNCTION(f32_3p1_2, avx2);
+DEFINE_FUNCTION(f32_5p1_2, avx2);
+DEFINE_FUNCTION(f32_5p1_3p1, avx2);
+DEFINE_FUNCTION(f32_5p1_4, avx2);
+DEFINE_FUNCTION(f32_7p1_2, avx2);
+DEFINE_FUNCTION(f32_7p1_3p1, avx2);
+DEFINE_FUNCTION(f32_7p1_4, avx2);
+#endif
+#if defined (HAVE_NEON)
+DEFINE_FUNCTION(copy, neon);
+DEFINE_FUNCTION(f32_n_m, neon);
+DEFINE_FUNCTION(f32_2_3p1, neon);
+DEFINE_FUNCTION(f32_2_5p1, neon);
+DEFINE_FUNCTION(f32_2_7p1, neon);
+DEFINE_FUNCTION(f32_3p1_2, neon);
+DEFINE_FUNCTION(f32_5p1_2, neon);
+DEFINE_FUNCTION(f32_5p1_3p1, neon);
+DEFINE_FUNCTION(f32_5p1_4, neon);
+DEFINE_FUNCTION(f32_7p1_2, neon);
+DEFINE_FUNCTION(f32_7p1_3p1, neon);
+DEFINE_FUNCTION(f32_7p1_4, neon);
+#endif
 
 #undef DEFINE_FUNCTION
@@ -9,6 +9,8 @@
 extern "C" {
 #endif
 
+#include <spa/utils/defs.h>
+
 static inline void delay_run(float *buffer, uint32_t *pos,
 		uint32_t n_buffer, uint32_t delay,
 		float *dst, const float *src, const float vol, uint32_t n_samples)
@@ -24,23 +26,65 @@ static inline void delay_run(float *buffer, uint32_t *pos,
 	*pos = p;
 }
 
+/* buffer needs to be 2 * n_buffer samples, the second half mirrors the first
+ * half so that the history of a block of samples can be read without
+ * wrapping around */
 static inline void delay_convolve_run(float *buffer, uint32_t *pos,
 		uint32_t n_buffer, uint32_t delay,
 		const float *taps, uint32_t n_taps,
 		float *dst, const float *src, const float vol, uint32_t n_samples)
 {
-	uint32_t i, j;
+	uint32_t i, j, n;
 	uint32_t p = *pos;
+	uint32_t mask = n_buffer - 1;
+	uint32_t d = delay & mask;
 
-	for (i = 0; i < n_samples; i++) {
-		float sum = 0.0f;
+	if (d + n_taps > n_buffer) {
+		for (i = 0; i < n_samples; i++) {
+			float sum = 0.0f;
 
-		buffer[p] = src[i];
-		for (j = 0; j < n_taps; j++)
-			sum += (taps[j] * buffer[((p - delay) - j) & (n_buffer-1)]);
-		dst[i] = sum * vol;
+			buffer[p] = buffer[p + n_buffer] = src[i];
+			for (j = 0; j < n_taps; j++)
+				sum += (taps[j] * buffer[((p - d) - j) & mask]);
+			dst[i] = sum * vol;
 
-		p = (p + 1) & (n_buffer-1);
+			p = (p + 1) & mask;
+		}
+		*pos = p;
+		return;
+	}
+
+	while (n_samples > 0) {
+		/* don't overwrite the oldest sample we still need */
+		uint32_t chunk = SPA_MIN(n_samples, n_buffer + 1 - d - n_taps);
+		const float *h = &buffer[(p - d - (n_taps - 1)) & mask];
+
+		/* src and dst can be the same, copy everything before
+		 * writing to dst */
+		for (i = 0; i < chunk; i++) {
+			buffer[p] = buffer[p + n_buffer] = src[i];
+			p = (p + 1) & mask;
+		}
+		for (i = 0; i < chunk; i++)
+			dst[i] = 0.0f;
+
+		/* loop over the taps and run over the block for each tap,
+		 * this skips the zero taps and makes the inner loop
+		 * vectorizable */
+		for (j = 0; j < n_taps; j++) {
+			const float t = taps[j];
+			const float *x = &h[n_taps - 1 - j];
+			if (t == 0.0f)
+				continue;
+			for (n = 0; n < chunk; n++)
+				dst[n] += t * x[n];
+		}
+		for (i = 0; i < chunk; i++)
+			dst[i] *= vol;
+
+		src += chunk;
+		dst += chunk;
+		n_samples -= chunk;
 	}
 	*pos = p;
 }
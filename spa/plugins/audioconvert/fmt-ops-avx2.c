@@ -1006,3 +1006,1112 @@ conv_f32d_to_s16_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const v
 		d += 2;
 	}
 }
+
+static void
+conv_s24_32_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256i in[4];
+	__m256 out[4], factor = _mm256_set1_ps(1.0f / S32_SCALE_I2F);
+	__m256i mask1 = _mm256_setr_epi32(0*n_channels, 1*n_channels, 2*n_channels, 3*n_channels,
+					  4*n_channels, 5*n_channels, 6*n_channels, 7*n_channels);
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_i32gather_epi32((int*)&s[0], mask1, 4);
+		in[1] = _mm256_i32gather_epi32((int*)&s[1], mask1, 4);
+		in[2] = _mm256_i32gather_epi32((int*)&s[2], mask1, 4);
+		in[3] = _mm256_i32gather_epi32((int*)&s[3], mask1, 4);
+
+		in[0] = _mm256_slli_epi32(in[0], 8);
+		in[1] = _mm256_slli_epi32(in[1], 8);
+		in[2] = _mm256_slli_epi32(in[2], 8);
+		in[3] = _mm256_slli_epi32(in[3], 8);
+
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[1] = _mm256_cvtepi32_ps(in[1]);
+		out[2] = _mm256_cvtepi32_ps(in[2]);
+		out[3] = _mm256_cvtepi32_ps(in[3]);
+
+		out[0] = _mm256_mul_ps(out[0], factor);
+		out[1] = _mm256_mul_ps(out[1], factor);
+		out[2] = _mm256_mul_ps(out[2], factor);
+		out[3] = _mm256_mul_ps(out[3], factor);
+
+		_mm256_store_ps(&d0[n], out[0]);
+		_mm256_store_ps(&d1[n], out[1]);
+		_mm256_store_ps(&d2[n], out[2]);
+		_mm256_store_ps(&d3[n], out[3]);
+
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		__m128 out[4], factor = _mm_set1_ps(1.0f / S32_SCALE_I2F);
+		out[0] = _mm_cvtsi32_ss(factor, S24_32_TO_S32(s[0]));
+		out[1] = _mm_cvtsi32_ss(factor, S24_32_TO_S32(s[1]));
+		out[2] = _mm_cvtsi32_ss(factor, S24_32_TO_S32(s[2]));
+		out[3] = _mm_cvtsi32_ss(factor, S24_32_TO_S32(s[3]));
+		out[0] = _mm_mul_ss(out[0], factor);
+		out[1] = _mm_mul_ss(out[1], factor);
+		out[2] = _mm_mul_ss(out[2], factor);
+		out[3] = _mm_mul_ss(out[3], factor);
+		_mm_store_ss(&d0[n], out[0]);
+		_mm_store_ss(&d1[n], out[1]);
+		_mm_store_ss(&d2[n], out[2]);
+		_mm_store_ss(&d3[n], out[3]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s24_32_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in[2];
+	__m256 out[2], factor = _mm256_set1_ps(1.0f / S32_SCALE_I2F);
+	__m256i mask1 = _mm256_setr_epi32(0*n_channels, 1*n_channels, 2*n_channels, 3*n_channels,
+					  4*n_channels, 5*n_channels, 6*n_channels, 7*n_channels);
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm256_i32gather_epi32(&s[0*n_channels], mask1, 4);
+		in[1] = _mm256_i32gather_epi32(&s[8*n_channels], mask1, 4);
+
+		in[0] = _mm256_slli_epi32(in[0], 8);
+		in[1] = _mm256_slli_epi32(in[1], 8);
+
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[1] = _mm256_cvtepi32_ps(in[1]);
+
+		out[0] = _mm256_mul_ps(out[0], factor);
+		out[1] = _mm256_mul_ps(out[1], factor);
+
+		_mm256_store_ps(&d0[n+0], out[0]);
+		_mm256_store_ps(&d0[n+8], out[1]);
+
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		__m128 out, factor = _mm_set1_ps(1.0f / S32_SCALE_I2F);
+		out = _mm_cvtsi32_ss(factor, S24_32_TO_S32(s[0]));
+		out = _mm_mul_ss(out, factor);
+		_mm_store_ss(&d0[n], out);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24_32_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24_32_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+/* the scalar version of the conversion, avoids a call to lrintf */
+static inline int32_t f32_to_i32_ss(float v, __m256 scale, __m256 offs,
+		__m256 int_min, __m256 int_max)
+{
+	__m128 in = _mm_set_ss(v);
+	in = _mm_mul_ss(in, _mm256_castps256_ps128(scale));
+	in = _mm_add_ss(in, _mm256_castps256_ps128(offs));
+	in = _MM_CLAMP_SS(in, _mm256_castps256_ps128(int_min), _mm256_castps256_ps128(int_max));
+	return _mm_cvtss_si32(in);
+}
+
+/* convert 4 channels of 8 samples to integers and transpose them so that
+ * each 128 bits lane of out holds one frame. out[k] holds frame k in the low
+ * lane and frame k+4 in the high lane. The planar buffers are not always
+ * aligned, unaligned loads on aligned memory are free. */
+#define F32D_TO_I32_4S_AVX2(s0,s1,s2,s3,n,scale,offs,int_min,int_max,out)		\
+({											\
+	__m256 _in[4];									\
+	__m256i _t[4];									\
+	_in[0] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s0[n]), scale), offs);	\
+	_in[1] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s1[n]), scale), offs);	\
+	_in[2] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s2[n]), scale), offs);	\
+	_in[3] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s3[n]), scale), offs);	\
+	out[0] = _mm256_cvtps_epi32(_MM256_CLAMP_PS(_in[0], int_min, int_max));	\
+	out[1] = _mm256_cvtps_epi32(_MM256_CLAMP_PS(_in[1], int_min, int_max));	\
+	out[2] = _mm256_cvtps_epi32(_MM256_CLAMP_PS(_in[2], int_min, int_max));	\
+	out[3] = _mm256_cvtps_epi32(_MM256_CLAMP_PS(_in[3], int_min, int_max));	\
+	_t[0] = _mm256_unpacklo_epi32(out[0], out[1]);					\
+	_t[1] = _mm256_unpackhi_epi32(out[0], out[1]);					\
+	_t[2] = _mm256_unpacklo_epi32(out[2], out[3]);					\
+	_t[3] = _mm256_unpackhi_epi32(out[2], out[3]);					\
+	out[0] = _mm256_unpacklo_epi64(_t[0], _t[2]);					\
+	out[1] = _mm256_unpackhi_epi64(_t[0], _t[2]);					\
+	out[2] = _mm256_unpacklo_epi64(_t[1], _t[3]);					\
+	out[3] = _mm256_unpackhi_epi64(_t[1], _t[3]);					\
+})
+
+static void
+conv_f32d_to_s24_32_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256i out[4];
+	__m256 scale = _mm256_set1_ps(S24_SCALE);
+	__m256 offs = _mm256_setzero_ps();
+	__m256 int_min = _mm256_set1_ps(S24_MIN);
+	__m256 int_max = _mm256_set1_ps(S24_MAX);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		F32D_TO_I32_4S_AVX2(s0, s1, s2, s3, n, scale, offs, int_min, int_max, out);
+
+		_mm_storeu_si128((__m128i*)(d + 0*n_channels), _mm256_extracti128_si256(out[0], 0));
+		_mm_storeu_si128((__m128i*)(d + 1*n_channels), _mm256_extracti128_si256(out[1], 0));
+		_mm_storeu_si128((__m128i*)(d + 2*n_channels), _mm256_extracti128_si256(out[2], 0));
+		_mm_storeu_si128((__m128i*)(d + 3*n_channels), _mm256_extracti128_si256(out[3], 0));
+		_mm_storeu_si128((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[0], 1));
+		_mm_storeu_si128((__m128i*)(d + 5*n_channels), _mm256_extracti128_si256(out[1], 1));
+		_mm_storeu_si128((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storeu_si128((__m128i*)(d + 7*n_channels), _mm256_extracti128_si256(out[3], 1));
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = f32_to_i32_ss(s0[n], scale, offs, int_min, int_max);
+		d[1] = f32_to_i32_ss(s1[n], scale, offs, int_min, int_max);
+		d[2] = f32_to_i32_ss(s2[n], scale, offs, int_min, int_max);
+		d[3] = f32_to_i32_ss(s3[n], scale, offs, int_min, int_max);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_32_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[1];
+	__m128i out[4];
+	__m128 scale = _mm_set1_ps(S24_SCALE);
+	__m128 int_min = _mm_set1_ps(S24_MIN);
+	__m128 int_max = _mm_set1_ps(S24_MAX);
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_loadu_ps(&s0[n]), scale);
+		in[0] = _MM_CLAMP_PS(in[0], int_min, int_max);
+		out[0] = _mm_cvtps_epi32(in[0]);
+		out[1] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(0, 3, 2, 1));
+		out[2] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(1, 0, 3, 2));
+		out[3] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(2, 1, 0, 3));
+
+		d[0*n_channels] = _mm_cvtsi128_si32(out[0]);
+		d[1*n_channels] = _mm_cvtsi128_si32(out[1]);
+		d[2*n_channels] = _mm_cvtsi128_si32(out[2]);
+		d[3*n_channels] = _mm_cvtsi128_si32(out[3]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		in[0] = _mm_load_ss(&s0[n]);
+		in[0] = _mm_mul_ss(in[0], scale);
+		in[0] = _MM_CLAMP_SS(in[0], int_min, int_max);
+		*d = _mm_cvtss_si32(in[0]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_32_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_32_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+/* store the low 3 bytes of the 4 samples in v */
+static inline void store_s24x4(uint8_t *d, __m128i v)
+{
+	const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+			-1, -1, -1, -1);
+	v = _mm_shuffle_epi8(v, pack);
+	_mm_storel_epi64((__m128i*)d, v);
+	spa_write_unaligned(d + 8, uint32_t, _mm_extract_epi32(v, 2));
+}
+
+static void
+conv_f32d_to_s24_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled, stride = 3 * n_channels;
+	__m256i out[4];
+	__m256 scale = _mm256_set1_ps(S24_SCALE);
+	__m256 offs = _mm256_setzero_ps();
+	__m256 int_min = _mm256_set1_ps(S24_MIN);
+	__m256 int_max = _mm256_set1_ps(S24_MAX);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		F32D_TO_I32_4S_AVX2(s0, s1, s2, s3, n, scale, offs, int_min, int_max, out);
+
+		store_s24x4(d + 0*stride, _mm256_extracti128_si256(out[0], 0));
+		store_s24x4(d + 1*stride, _mm256_extracti128_si256(out[1], 0));
+		store_s24x4(d + 2*stride, _mm256_extracti128_si256(out[2], 0));
+		store_s24x4(d + 3*stride, _mm256_extracti128_si256(out[3], 0));
+		store_s24x4(d + 4*stride, _mm256_extracti128_si256(out[0], 1));
+		store_s24x4(d + 5*stride, _mm256_extracti128_si256(out[1], 1));
+		store_s24x4(d + 6*stride, _mm256_extracti128_si256(out[2], 1));
+		store_s24x4(d + 7*stride, _mm256_extracti128_si256(out[3], 1));
+		d += 8*stride;
+	}
+	for(; n < n_samples; n++) {
+		int24_t *d24 = (int24_t*)d;
+		d24[0] = s32_to_s24(f32_to_i32_ss(s0[n], scale, offs, int_min, int_max));
+		d24[1] = s32_to_s24(f32_to_i32_ss(s1[n], scale, offs, int_min, int_max));
+		d24[2] = s32_to_s24(f32_to_i32_ss(s2[n], scale, offs, int_min, int_max));
+		d24[3] = s32_to_s24(f32_to_i32_ss(s3[n], scale, offs, int_min, int_max));
+		d += stride;
+	}
+}
+
+static void
+conv_f32d_to_s24_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, unrolled, stride = 3 * n_channels;
+	__m256 in;
+	__m256 scale = _mm256_set1_ps(S24_SCALE);
+	__m256 offs = _mm256_setzero_ps();
+	__m256 int_min = _mm256_set1_ps(S24_MIN);
+	__m256 int_max = _mm256_set1_ps(S24_MAX);
+	int32_t out[8];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_loadu_ps(&s0[n]), scale);
+		in = _MM256_CLAMP_PS(in, int_min, int_max);
+		_mm256_storeu_si256((__m256i*)out, _mm256_cvtps_epi32(in));
+
+		*(int24_t*)(d + 0*stride) = s32_to_s24(out[0]);
+		*(int24_t*)(d + 1*stride) = s32_to_s24(out[1]);
+		*(int24_t*)(d + 2*stride) = s32_to_s24(out[2]);
+		*(int24_t*)(d + 3*stride) = s32_to_s24(out[3]);
+		*(int24_t*)(d + 4*stride) = s32_to_s24(out[4]);
+		*(int24_t*)(d + 5*stride) = s32_to_s24(out[5]);
+		*(int24_t*)(d + 6*stride) = s32_to_s24(out[6]);
+		*(int24_t*)(d + 7*stride) = s32_to_s24(out[7]);
+		d += 8*stride;
+	}
+	for(; n < n_samples; n++) {
+		*(int24_t*)d = s32_to_s24(f32_to_i32_ss(s0[n], scale, offs, int_min, int_max));
+		d += stride;
+	}
+}
+
+void
+conv_f32d_to_s24_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_4s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_1s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_u8_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / U8_SCALE);
+	__m256 offs = _mm256_set1_ps(1.0f);
+	__m256i mask = _mm256_set1_epi32(0xff);
+	__m256i mask1 = _mm256_setr_epi32(0*n_channels, 1*n_channels, 2*n_channels, 3*n_channels,
+					  4*n_channels, 5*n_channels, 6*n_channels, 7*n_channels);
+
+	/* the gather reads 4 bytes for each sample, stay away from the
+	 * end of the buffer */
+	if (SPA_IS_ALIGNED(d0, 32) && n_samples > 3)
+		unrolled = (n_samples - 3) & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32((int*)s, mask1, 1);
+		in = _mm256_and_si256(in, mask);
+		out = _mm256_cvtepi32_ps(in);
+		out = _mm256_sub_ps(_mm256_mul_ps(out, factor), offs);
+		_mm256_store_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = U8_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_u8_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint8_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_u8_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_u8_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m256i out[4];
+	__m256 scale = _mm256_set1_ps(U8_SCALE);
+	__m256 offs = _mm256_set1_ps(U8_OFFS);
+	__m256 int_min = _mm256_set1_ps(U8_MIN);
+	__m256 int_max = _mm256_set1_ps(U8_MAX);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		F32D_TO_I32_4S_AVX2(s0, s1, s2, s3, n, scale, offs, int_min, int_max, out);
+
+		/* the values are clamped, pack them to 4 bytes per frame */
+		out[0] = _mm256_packus_epi32(out[0], out[1]);
+		out[2] = _mm256_packus_epi32(out[2], out[3]);
+		out[0] = _mm256_packus_epi16(out[0], out[2]);
+
+		spa_write_unaligned(d + 0*n_channels, uint32_t, _mm256_extract_epi32(out[0], 0));
+		spa_write_unaligned(d + 1*n_channels, uint32_t, _mm256_extract_epi32(out[0], 1));
+		spa_write_unaligned(d + 2*n_channels, uint32_t, _mm256_extract_epi32(out[0], 2));
+		spa_write_unaligned(d + 3*n_channels, uint32_t, _mm256_extract_epi32(out[0], 3));
+		spa_write_unaligned(d + 4*n_channels, uint32_t, _mm256_extract_epi32(out[0], 4));
+		spa_write_unaligned(d + 5*n_channels, uint32_t, _mm256_extract_epi32(out[0], 5));
+		spa_write_unaligned(d + 6*n_channels, uint32_t, _mm256_extract_epi32(out[0], 6));
+		spa_write_unaligned(d + 7*n_channels, uint32_t, _mm256_extract_epi32(out[0], 7));
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = f32_to_i32_ss(s0[n], scale, offs, int_min, int_max);
+		d[1] = f32_to_i32_ss(s1[n], scale, offs, int_min, int_max);
+		d[2] = f32_to_i32_ss(s2[n], scale, offs, int_min, int_max);
+		d[3] = f32_to_i32_ss(s3[n], scale, offs, int_min, int_max);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_u8_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256 scale = _mm256_set1_ps(U8_SCALE);
+	__m256 offs = _mm256_set1_ps(U8_OFFS);
+	__m256 int_min = _mm256_set1_ps(U8_MIN);
+	__m256 int_max = _mm256_set1_ps(U8_MAX);
+	int32_t out[8];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s0[n]), scale), offs);
+		in = _MM256_CLAMP_PS(in, int_min, int_max);
+		_mm256_storeu_si256((__m256i*)out, _mm256_cvtps_epi32(in));
+
+		d[0*n_channels] = out[0];
+		d[1*n_channels] = out[1];
+		d[2*n_channels] = out[2];
+		d[3*n_channels] = out[3];
+		d[4*n_channels] = out[4];
+		d[5*n_channels] = out[5];
+		d[6*n_channels] = out[6];
+		d[7*n_channels] = out[7];
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = f32_to_i32_ss(s0[n], scale, offs, int_min, int_max);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_u8_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_u8_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_u8_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f64_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const double *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256d in[2];
+	__m128 out[2];
+	__m128i mask1 = _mm_setr_epi32(0*n_channels, 1*n_channels, 2*n_channels, 3*n_channels);
+
+	if (SPA_IS_ALIGNED(d0, 16))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_i32gather_pd(&s[0*n_channels], mask1, 8);
+		in[1] = _mm256_i32gather_pd(&s[4*n_channels], mask1, 8);
+		out[0] = _mm256_cvtpd_ps(in[0]);
+		out[1] = _mm256_cvtpd_ps(in[1]);
+		_mm_store_ps(&d0[n+0], out[0]);
+		_mm_store_ps(&d0[n+4], out[1]);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = (float)s[0];
+		s += n_channels;
+	}
+}
+
+void
+conv_f64_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const double *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_f64_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_f64_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	double *d = dst;
+	uint32_t n, unrolled;
+	__m256d in[4], t[4];
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm256_cvtps_pd(_mm_loadu_ps(&s0[n])); /* a0 a1 a2 a3 */
+		in[1] = _mm256_cvtps_pd(_mm_loadu_ps(&s1[n])); /* b0 b1 b2 b3 */
+		in[2] = _mm256_cvtps_pd(_mm_loadu_ps(&s2[n])); /* c0 c1 c2 c3 */
+		in[3] = _mm256_cvtps_pd(_mm_loadu_ps(&s3[n])); /* d0 d1 d2 d3 */
+
+		t[0] = _mm256_unpacklo_pd(in[0], in[1]);	/* a0 b0 a2 b2 */
+		t[1] = _mm256_unpackhi_pd(in[0], in[1]);	/* a1 b1 a3 b3 */
+		t[2] = _mm256_unpacklo_pd(in[2], in[3]);	/* c0 d0 c2 d2 */
+		t[3] = _mm256_unpackhi_pd(in[2], in[3]);	/* c1 d1 c3 d3 */
+
+		in[0] = _mm256_permute2f128_pd(t[0], t[2], 0x20);	/* a0 b0 c0 d0 */
+		in[1] = _mm256_permute2f128_pd(t[1], t[3], 0x20);	/* a1 b1 c1 d1 */
+		in[2] = _mm256_permute2f128_pd(t[0], t[2], 0x31);	/* a2 b2 c2 d2 */
+		in[3] = _mm256_permute2f128_pd(t[1], t[3], 0x31);	/* a3 b3 c3 d3 */
+
+		_mm256_storeu_pd(d + 0*n_channels, in[0]);
+		_mm256_storeu_pd(d + 1*n_channels, in[1]);
+		_mm256_storeu_pd(d + 2*n_channels, in[2]);
+		_mm256_storeu_pd(d + 3*n_channels, in[3]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_f64_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	double *d = dst[0];
+	uint32_t i = 0, j, n, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_f64_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(j = i; j < n_channels; j++) {
+		const float *s = src[j];
+		for (n = 0; n < n_samples; n++)
+			d[n * n_channels + j] = s[n];
+	}
+}
+
+#if defined(HAVE_F16C)
+void
+conv_f16d_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_channels = conv->n_channels;
+
+	unrolled = n_samples & ~7;
+
+	for (i = 0; i < n_channels; i++) {
+		const uint16_t *s = src[i];
+		float *d = dst[i];
+
+		for(n = 0; n < unrolled; n += 8)
+			_mm256_storeu_ps(&d[n], _mm256_cvtph_ps(_mm_loadu_si128((__m128i*)&s[n])));
+		for(; n < n_samples; n++)
+			d[n] = F16_TO_F32(s[n]);
+	}
+}
+
+static void
+conv_f16_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint16_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in, mask1 = _mm256_setr_epi32(0*n_channels, 1*n_channels, 2*n_channels, 3*n_channels,
+			4*n_channels, 5*n_channels, 6*n_channels, 7*n_channels);
+	__m256i mask2 = _mm256_set1_epi32(0xffff);
+	__m128i h;
+
+	/* the 32 bit gather reads one sample past the last frame */
+	if (n_samples > 0)
+		unrolled = (n_samples - 1) & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32((const int*)s, mask1, 2);
+		in = _mm256_and_si256(in, mask2);
+		h = _mm_packus_epi32(_mm256_castsi256_si128(in),
+				_mm256_extracti128_si256(in, 1));
+		_mm256_storeu_ps(&d0[n], _mm256_cvtph_ps(h));
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = F16_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_f16_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_f16_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+void
+conv_f32d_to_f16d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t i, n, unrolled, n_channels = conv->n_channels;
+
+	unrolled = n_samples & ~7;
+
+	for (i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+		uint16_t *d = dst[i];
+
+		for(n = 0; n < unrolled; n += 8)
+			_mm_storeu_si128((__m128i*)&d[n],
+				_mm256_cvtps_ph(_mm256_loadu_ps(&s[n]), _MM_FROUND_TO_NEAREST_INT));
+		for(; n < n_samples; n++)
+			d[n] = F32_TO_F16(s[n]);
+	}
+}
+
+void
+conv_f32d_to_f16_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint16_t *d = dst[0];
+	uint32_t i, j, n, unrolled, n_channels = conv->n_channels;
+	uint16_t h[8];
+
+	unrolled = n_samples & ~7;
+
+	for (i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+
+		for(n = 0; n < unrolled; n += 8) {
+			_mm_storeu_si128((__m128i*)h,
+				_mm256_cvtps_ph(_mm256_loadu_ps(&s[n]), _MM_FROUND_TO_NEAREST_INT));
+			for (j = 0; j < 8; j++)
+				d[(n + j) * n_channels + i] = h[j];
+		}
+		for(; n < n_samples; n++)
+			d[n * n_channels + i] = F32_TO_F16(s[n]);
+	}
+}
+#endif
+
+/* 32 bit xorshift PRNG, see https://en.wikipedia.org/wiki/Xorshift */
+#define _MM256_XORSHIFT_EPI32(r)			\
+({							\
+	__m256i i, t;					\
+	i = _mm256_load_si256((__m256i*)r);		\
+	t = _mm256_slli_epi32(i, 13);			\
+	i = _mm256_xor_si256(i, t);			\
+	t = _mm256_srli_epi32(i, 17);			\
+	i = _mm256_xor_si256(i, t);			\
+	t = _mm256_slli_epi32(i, 5);			\
+	i = _mm256_xor_si256(i, t);			\
+	_mm256_store_si256((__m256i*)r, i);		\
+	i;						\
+})
+
+void conv_noise_rect_avx2(struct convert *conv, float *noise, uint32_t n_samples)
+{
+	uint32_t n;
+	const uint32_t *r = conv->random;
+	__m256 scale = _mm256_set1_ps(conv->scale);
+	__m256i in[1];
+	__m256 out[1];
+
+	for (n = 0; n < n_samples; n += 8) {
+		in[0] = _MM256_XORSHIFT_EPI32(r);
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[0] = _mm256_mul_ps(out[0], scale);
+		_mm256_store_ps(&noise[n], out[0]);
+	}
+}
+
+void conv_noise_tri_avx2(struct convert *conv, float *noise, uint32_t n_samples)
+{
+	uint32_t n;
+	const uint32_t *r = conv->random;
+	__m256 scale = _mm256_set1_ps(conv->scale);
+	__m256i in[1];
+	__m256 out[1];
+
+	for (n = 0; n < n_samples; n += 8) {
+		in[0] = _mm256_sub_epi32(_MM256_XORSHIFT_EPI32(r), _MM256_XORSHIFT_EPI32(r));
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[0] = _mm256_mul_ps(out[0], scale);
+		_mm256_store_ps(&noise[n], out[0]);
+	}
+}
+
+void conv_noise_tri_hf_avx2(struct convert *conv, float *noise, uint32_t n_samples)
+{
+	uint32_t n;
+	int32_t *p = conv->prev;
+	const uint32_t *r = conv->random;
+	__m256 scale = _mm256_set1_ps(conv->scale);
+	__m256i rot = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+	__m256i in[1], old[1], new[1];
+	__m256 out[1];
+
+	old[0] = _mm256_load_si256((__m256i*)p);
+	for (n = 0; n < n_samples; n += 8) {
+		new[0] = _MM256_XORSHIFT_EPI32(r);
+		/* subtract the previous sample, the last one of the previous
+		 * vector for the first lane */
+		in[0] = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(new[0], rot),
+				_mm256_permutevar8x32_epi32(old[0], rot), 0x01);
+		in[0] = _mm256_sub_epi32(new[0], in[0]);
+		old[0] = new[0];
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[0] = _mm256_mul_ps(out[0], scale);
+		_mm256_store_ps(&noise[n], out[0]);
+	}
+	_mm256_store_si256((__m256i*)p, old[0]);
+}
+
+static void
+conv_f32d_to_s16_1s_noise_avx2(struct convert *conv, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src,
+		const float *noise, uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src;
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[1];
+	__m128i out[1];
+	__m256 int_scale = _mm256_set1_ps(S16_SCALE);
+	__m128 int_max = _mm_set1_ps(S16_MAX);
+	__m128 int_min = _mm_set1_ps(S16_MIN);
+	__m128 in1[1];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_loadu_ps(&s0[n]), int_scale);
+		in[0] = _mm256_add_ps(in[0], _mm256_load_ps(&noise[n]));
+		out[0] = _mm_packs_epi32(_mm256_castsi256_si128(_mm256_cvtps_epi32(in[0])),
+				_mm256_extracti128_si256(_mm256_cvtps_epi32(in[0]), 1));
+
+		d[0*n_channels] = _mm_extract_epi16(out[0], 0);
+		d[1*n_channels] = _mm_extract_epi16(out[0], 1);
+		d[2*n_channels] = _mm_extract_epi16(out[0], 2);
+		d[3*n_channels] = _mm_extract_epi16(out[0], 3);
+		d[4*n_channels] = _mm_extract_epi16(out[0], 4);
+		d[5*n_channels] = _mm_extract_epi16(out[0], 5);
+		d[6*n_channels] = _mm_extract_epi16(out[0], 6);
+		d[7*n_channels] = _mm_extract_epi16(out[0], 7);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		in1[0] = _mm_mul_ss(_mm_load_ss(&s0[n]), _mm256_castps256_ps128(int_scale));
+		in1[0] = _mm_add_ss(in1[0], _mm_load_ss(&noise[n]));
+		in1[0] = _MM_CLAMP_SS(in1[0], int_min, int_max);
+		*d = _mm_cvtss_si32(in1[0]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_4s_noise_avx2(struct convert *conv, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const float *noise, uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4], nz;
+	__m256i out[4], t[4];
+	__m256 int_scale = _mm256_set1_ps(S16_SCALE);
+	__m128 int_max = _mm_set1_ps(S16_MAX);
+	__m128 int_min = _mm_set1_ps(S16_MIN);
+	__m128 in1[4];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		/* all channels use the same noise */
+		nz = _mm256_load_ps(&noise[n]);
+		in[0] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s0[n]), int_scale), nz);
+		in[1] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s1[n]), int_scale), nz);
+		in[2] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s2[n]), int_scale), nz);
+		in[3] = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&s3[n]), int_scale), nz);
+
+		t[0] = _mm256_cvtps_epi32(in[0]);  /* a0 a1 a2 a3 a4 a5 a6 a7 */
+		t[1] = _mm256_cvtps_epi32(in[1]);  /* b0 b1 b2 b3 b4 b5 b6 b7 */
+		t[2] = _mm256_cvtps_epi32(in[2]);  /* c0 c1 c2 c3 c4 c5 c6 c7 */
+		t[3] = _mm256_cvtps_epi32(in[3]);  /* d0 d1 d2 d3 d4 d5 d6 d7 */
+
+		t[0] = _mm256_packs_epi32(t[0], t[2]); /* a0 a1 a2 a3 c0 c1 c2 c3 a4 a5 a6 a7 c4 c5 c6 c7 */
+		t[1] = _mm256_packs_epi32(t[1], t[3]); /* b0 b1 b2 b3 d0 d1 d2 d3 b4 b5 b6 b7 d4 d5 d6 d7 */
+
+		out[0] = _mm256_unpacklo_epi16(t[0], t[1]);     /* a0 b0 a1 b1 a2 b2 a3 b3 a4 b4 a5 b5 a6 b6 a7 b7 */
+		out[1] = _mm256_unpackhi_epi16(t[0], t[1]);     /* c0 d0 c1 d1 c2 d2 c3 d3 c4 d4 c5 d5 c6 d6 c7 d7 */
+
+		out[2] = _mm256_unpacklo_epi32(out[0], out[1]); /* a0 b0 c0 d0 a1 b1 c1 d1 a4 b4 c4 d4 a5 b5 c5 d5 */
+		out[3] = _mm256_unpackhi_epi32(out[0], out[1]); /* a2 b2 c2 d2 a3 b3 c3 d3 a6 b6 c6 d6 a7 b7 c7 d7 */
+
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), _mm256_extracti128_si256(out[2], 0));
+		_mm_storel_epi64((__m128i*)(d + 1*n_channels), _mm_srli_si128(_mm256_extracti128_si256(out[2], 0), 8));
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), _mm256_extracti128_si256(out[3], 0));
+		_mm_storel_epi64((__m128i*)(d + 3*n_channels), _mm_srli_si128(_mm256_extracti128_si256(out[3], 0), 8));
+		_mm_storel_epi64((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storel_epi64((__m128i*)(d + 5*n_channels), _mm_srli_si128(_mm256_extracti128_si256(out[2], 1), 8));
+		_mm_storel_epi64((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[3], 1));
+		_mm_storel_epi64((__m128i*)(d + 7*n_channels), _mm_srli_si128(_mm256_extracti128_si256(out[3], 1), 8));
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		__m128 nz1 = _mm_load_ss(&noise[n]), int_scale1 = _mm256_castps256_ps128(int_scale);
+
+		in1[0] = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&s0[n]), int_scale1), nz1);
+		in1[1] = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&s1[n]), int_scale1), nz1);
+		in1[2] = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&s2[n]), int_scale1), nz1);
+		in1[3] = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&s3[n]), int_scale1), nz1);
+		d[0] = _mm_cvtss_si32(_MM_CLAMP_SS(in1[0], int_min, int_max));
+		d[1] = _mm_cvtss_si32(_MM_CLAMP_SS(in1[1], int_min, int_max));
+		d[2] = _mm_cvtss_si32(_MM_CLAMP_SS(in1[2], int_min, int_max));
+		d[3] = _mm_cvtss_si32(_MM_CLAMP_SS(in1[3], int_min, int_max));
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_noise_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i, k, chunk, n_channels = conv->n_channels;
+	float *noise = conv->noise;
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	for(k = 0; k < n_samples; k += chunk) {
+		const float *s[4];
+		uint32_t c;
+
+		chunk = SPA_MIN(n_samples - k, conv->noise_size);
+		for(i = 0; i + 3 < n_channels; i += 4) {
+			for (c = 0; c < 4; c++)
+				s[c] = (const float*)src[i + c] + k;
+			conv_f32d_to_s16_4s_noise_avx2(conv, &d[i + k*n_channels],
+					(const void **)s, noise, n_channels, chunk);
+		}
+		for(; i < n_channels; i++) {
+			const float *s0 = src[i];
+			conv_f32d_to_s16_1s_noise_avx2(conv, &d[i + k*n_channels],
+					&s0[k], noise, n_channels, chunk);
+		}
+	}
+}
+
+static void
+conv_f32_to_s16_1_noise_avx2(struct convert *conv, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src,
+		const float *noise, uint32_t n_samples)
+{
+	const float *s = src;
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[2];
+	__m256i out[2];
+	__m256 int_scale = _mm256_set1_ps(S16_SCALE);
+	__m128 int_max = _mm_set1_ps(S16_MAX);
+	__m128 int_min = _mm_set1_ps(S16_MIN);
+	__m128 in1[1];
+
+	unrolled = n_samples & ~15;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm256_mul_ps(_mm256_loadu_ps(&s[n]), int_scale);
+		in[1] = _mm256_mul_ps(_mm256_loadu_ps(&s[n+8]), int_scale);
+		in[0] = _mm256_add_ps(in[0], _mm256_load_ps(&noise[n]));
+		in[1] = _mm256_add_ps(in[1], _mm256_load_ps(&noise[n+8]));
+		out[0] = _mm256_cvtps_epi32(in[0]);
+		out[1] = _mm256_cvtps_epi32(in[1]);
+		/* packs works per 128 bits lane, put the samples back in order */
+		out[0] = _mm256_packs_epi32(out[0], out[1]);
+		out[0] = _mm256_permute4x64_epi64(out[0], _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(&d[n]), out[0]);
+	}
+	for(; n < n_samples; n++) {
+		in1[0] = _mm_mul_ss(_mm_load_ss(&s[n]), _mm256_castps256_ps128(int_scale));
+		in1[0] = _mm_add_ss(in1[0], _mm_load_ss(&noise[n]));
+		in1[0] = _MM_CLAMP_SS(in1[0], int_min, int_max);
+		d[n] = _mm_cvtss_si32(in1[0]);
+	}
+}
+
+void
+conv_f32d_to_s16d_noise_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t i, k, chunk, n_channels = conv->n_channels;
+	float *noise = conv->noise;
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	for(i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+		int16_t *d = dst[i];
+		for(k = 0; k < n_samples; k += chunk) {
+			chunk = SPA_MIN(n_samples - k, conv->noise_size);
+			conv_f32_to_s16_1_noise_avx2(conv, &d[k], &s[k], noise, chunk);
+		}
+	}
+}
+
+/* run the noise shaper of 8 channels for one sample, v holds the channels
+ * and h the error history of the channels, most recent first */
+static inline __m128i
+shaper_step_avx2(__m256 v, __m256 *h, const __m256 *w, uint32_t n_ns,
+		__m256 noise, __m256 int_min, __m256 int_max)
+{
+	__m256i t;
+	uint32_t n;
+
+	for (n = 0; n < n_ns; n++)
+		v = _mm256_add_ps(v, _mm256_mul_ps(h[n], w[n]));
+	t = _mm256_cvtps_epi32(_MM256_CLAMP_PS(_mm256_add_ps(v, noise), int_min, int_max));
+	for (n = n_ns - 1; n > 0; n--)
+		h[n] = h[n-1];
+	h[0] = _mm256_sub_ps(v, _mm256_cvtepi32_ps(t));
+	/* the values are clamped, packing them is lossless */
+	return _mm_packs_epi32(_mm256_castsi256_si128(t), _mm256_extracti128_si256(t, 1));
+}
+
+static inline void
+store_s16_8s_avx2(int16_t **d, uint32_t offs, __m128i t, uint32_t n_channels, bool packed)
+{
+	if (packed && n_channels == 8) {
+		_mm_storeu_si128((__m128i*)&d[0][offs], t);
+		return;
+	}
+	d[0][offs] = _mm_extract_epi16(t, 0);
+	if (n_channels > 1)
+		d[1][offs] = _mm_extract_epi16(t, 1);
+	if (n_channels > 2)
+		d[2][offs] = _mm_extract_epi16(t, 2);
+	if (n_channels > 3)
+		d[3][offs] = _mm_extract_epi16(t, 3);
+	if (n_channels > 4)
+		d[4][offs] = _mm_extract_epi16(t, 4);
+	if (n_channels > 5)
+		d[5][offs] = _mm_extract_epi16(t, 5);
+	if (n_channels > 6)
+		d[6][offs] = _mm_extract_epi16(t, 6);
+	if (n_channels > 7)
+		d[7][offs] = _mm_extract_epi16(t, 7);
+}
+
+/* noise shape up to 8 channels at once. The shaper of each channel is a
+ * recursive filter over the samples so we vectorize over the channels. The
+ * unused lanes read from s[0] and write to a dummy shaper. */
+static void
+conv_f32d_to_s16_8s_shaped_avx2(struct convert *conv, int16_t *d[8], uint32_t stride,
+		const float *s[8], struct shaper *sh[8], const float *noise,
+		uint32_t n_channels, uint32_t n_samples, bool packed)
+{
+	const float *ns = conv->ns;
+	uint32_t c, n, j, unrolled, n_ns = conv->n_ns;
+	__m256 in[4], h[NS_MAX], w[NS_MAX];
+	__m128 lo[4], hi[4];
+	__m256 scale = _mm256_set1_ps(S16_SCALE);
+	__m256 int_min = _mm256_set1_ps(S16_MIN);
+	__m256 int_max = _mm256_set1_ps(S16_MAX);
+	__m128i out;
+	float e[8];
+
+	for (n = 0; n < n_ns; n++) {
+		for (c = 0; c < 8; c++)
+			e[c] = sh[c]->e[sh[c]->idx + n];
+		h[n] = _mm256_loadu_ps(e);
+		w[n] = _mm256_set1_ps(ns[n]);
+	}
+
+	unrolled = n_samples & ~3;
+
+	for (j = 0; j < unrolled; j += 4) {
+		lo[0] = _mm_loadu_ps(&s[0][j]);
+		lo[1] = _mm_loadu_ps(&s[1][j]);
+		lo[2] = _mm_loadu_ps(&s[2][j]);
+		lo[3] = _mm_loadu_ps(&s[3][j]);
+		hi[0] = _mm_loadu_ps(&s[4][j]);
+		hi[1] = _mm_loadu_ps(&s[5][j]);
+		hi[2] = _mm_loadu_ps(&s[6][j]);
+		hi[3] = _mm_loadu_ps(&s[7][j]);
+		_MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+		_MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+		for (c = 0; c < 4; c++)
+			in[c] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[c]), hi[c], 1);
+
+		for (c = 0; c < 4; c++) {
+			out = shaper_step_avx2(_mm256_mul_ps(in[c], scale), h, w, n_ns,
+					_mm256_set1_ps(noise[j + c]), int_min, int_max);
+			store_s16_8s_avx2(d, (j + c) * stride, out, n_channels, packed);
+		}
+	}
+	for (; j < n_samples; j++) {
+		in[0] = _mm256_setr_ps(s[0][j], s[1][j], s[2][j], s[3][j],
+				s[4][j], s[5][j], s[6][j], s[7][j]);
+		out = shaper_step_avx2(_mm256_mul_ps(in[0], scale), h, w, n_ns,
+				_mm256_set1_ps(noise[j]), int_min, int_max);
+		store_s16_8s_avx2(d, j * stride, out, n_channels, packed);
+	}
+
+	for (c = 0; c < 8; c++)
+		sh[c]->idx = (sh[c]->idx - n_samples) & NS_MASK;
+	for (n = 0; n < n_ns; n++) {
+		_mm256_storeu_ps(e, h[n]);
+		for (c = 0; c < 8; c++) {
+			uint32_t idx = (sh[c]->idx + n) & NS_MASK;
+			sh[c]->e[idx] = sh[c]->e[idx + NS_MAX] = e[c];
+		}
+	}
+}
+
+static void
+conv_f32d_to_s16_shaped_avx2_impl(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples, bool interleaved)
+{
+	uint32_t i, c, k, chunk, nc, n_channels = conv->n_channels;
+	uint32_t stride = interleaved ? n_channels : 1;
+	float *noise = conv->noise;
+	struct shaper dummy, *sh[8];
+	const float *s[8];
+	int16_t *d[8];
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	spa_zero(dummy);
+	for(i = 0; i < n_channels; i += 8) {
+		nc = SPA_MIN(n_channels - i, 8u);
+		for(c = 0; c < 8; c++) {
+			s[c] = src[i + (c < nc ? c : 0)];
+			sh[c] = c < nc ? &conv->shaper[i + c] : &dummy;
+			d[c] = interleaved ? (int16_t*)dst[0] + i + c : dst[i + (c < nc ? c : 0)];
+		}
+		for(k = 0; k < n_samples; k += chunk) {
+			chunk = SPA_MIN(n_samples - k, conv->noise_size);
+			conv_f32d_to_s16_8s_shaped_avx2(conv, d, stride, s, sh, noise,
+					nc, chunk, interleaved);
+			for(c = 0; c < 8; c++) {
+				s[c] += chunk;
+				d[c] += chunk * stride;
+			}
+		}
+	}
+}
+
+void
+conv_f32d_to_s16_shaped_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32d_to_s16_shaped_avx2_impl(conv, dst, src, n_samples, true);
+}
+
+void
+conv_f32d_to_s16d_shaped_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32d_to_s16_shaped_avx2_impl(conv, dst, src, n_samples, false);
+}
@@ -0,0 +1,558 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "fmt-ops.h"
+
+#include <immintrin.h>
+
+/* Only AVX512F is used. The buffers are FMT_OPS_MAX_ALIGN aligned, which is
+ * less than the 64 bytes of a register, so all loads and stores are
+ * unaligned. */
+
+#define _MM512_CLAMP_PS(r,min,max)			\
+	_mm512_min_ps(_mm512_max_ps(r, min), max)
+
+#define spa_write_unaligned(ptr, type, val) \
+__extension__ ({ \
+	__typeof__(type) _val = (val); \
+	memcpy((ptr), &_val, sizeof(_val)); \
+})
+
+static inline __m512i gather_offsets(uint32_t stride)
+{
+	return _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+				8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(stride));
+}
+
+static void
+conv_s24_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int8_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m512i in, mask1 = gather_offsets(3 * n_channels);
+	__m512 out, factor = _mm512_set1_ps(1.0f / S24_SCALE);
+
+	/* the gather reads 4 bytes for each sample, don't read the last
+	 * sample with it */
+	if (n_samples > 0)
+		unrolled = (n_samples - 1) & ~15;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_i32gather_epi32(mask1, s, 1);
+		in = _mm512_slli_epi32(in, 8);
+		in = _mm512_srai_epi32(in, 8);
+		out = _mm512_mul_ps(_mm512_cvtepi32_ps(in), factor);
+		_mm512_storeu_ps(&d0[n], out);
+		s += 48 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(*(int24_t*)s);
+		s += 3 * n_channels;
+	}
+}
+
+void
+conv_s24_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int8_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_s24_to_f32d_1s_avx512(conv, &dst[i], &s[3*i], n_channels, n_samples);
+}
+
+static void
+conv_s24_32_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m512i in, mask1 = gather_offsets(n_channels);
+	__m512 out, factor = _mm512_set1_ps(1.0f / S32_SCALE_I2F);
+
+	unrolled = n_samples & ~15;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_i32gather_epi32(mask1, s, 4);
+		in = _mm512_slli_epi32(in, 8);
+		out = _mm512_mul_ps(_mm512_cvtepi32_ps(in), factor);
+		_mm512_storeu_ps(&d0[n], out);
+		s += 16 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_32_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_s24_32_to_f32d_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_u8_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m512i in, mask = _mm512_set1_epi32(0xff), mask1 = gather_offsets(n_channels);
+	__m512 out, factor = _mm512_set1_ps(1.0f / U8_SCALE), offs = _mm512_set1_ps(1.0f);
+
+	/* the gather reads 4 bytes for each sample, stay away from the
+	 * end of the buffer */
+	if (n_samples > 3)
+		unrolled = (n_samples - 3) & ~15;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_i32gather_epi32(mask1, s, 1);
+		in = _mm512_and_si512(in, mask);
+		out = _mm512_cvtepi32_ps(in);
+		out = _mm512_sub_ps(_mm512_mul_ps(out, factor), offs);
+		_mm512_storeu_ps(&d0[n], out);
+		s += 16 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = U8_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_u8_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint8_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_u8_to_f32d_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f64_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const double *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i mask1 = _mm512_castsi512_si256(gather_offsets(n_channels));
+	__m512d in;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm512_i32gather_pd(mask1, s, 8);
+		_mm256_storeu_ps(&d0[n], _mm512_cvtpd_ps(in));
+		s += 8 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = (float)s[0];
+		s += n_channels;
+	}
+}
+
+void
+conv_f64_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const double *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i < n_channels; i++)
+		conv_f64_to_f32d_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+/* convert 4 channels of 16 samples to integers and transpose them so that
+ * each 128 bits lane of out holds one frame. Lane l of out[k] holds
+ * frame 4*l+k. */
+#define F32D_TO_I32_4S_AVX512(s0,s1,s2,s3,n,scale,offs,int_min,int_max,out)		\
+({											\
+	__m512 _in[4];									\
+	__m512i _t[4];									\
+	_in[0] = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(&s0[n]), scale), offs);	\
+	_in[1] = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(&s1[n]), scale), offs);	\
+	_in[2] = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(&s2[n]), scale), offs);	\
+	_in[3] = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(&s3[n]), scale), offs);	\
+	out[0] = _mm512_cvtps_epi32(_MM512_CLAMP_PS(_in[0], int_min, int_max));	\
+	out[1] = _mm512_cvtps_epi32(_MM512_CLAMP_PS(_in[1], int_min, int_max));	\
+	out[2] = _mm512_cvtps_epi32(_MM512_CLAMP_PS(_in[2], int_min, int_max));	\
+	out[3] = _mm512_cvtps_epi32(_MM512_CLAMP_PS(_in[3], int_min, int_max));	\
+	_t[0] = _mm512_unpacklo_epi32(out[0], out[1]);					\
+	_t[1] = _mm512_unpackhi_epi32(out[0], out[1]);					\
+	_t[2] = _mm512_unpacklo_epi32(out[2], out[3]);					\
+	_t[3] = _mm512_unpackhi_epi32(out[2], out[3]);					\
+	out[0] = _mm512_unpacklo_epi64(_t[0], _t[2]);					\
+	out[1] = _mm512_unpackhi_epi64(_t[0], _t[2]);					\
+	out[2] = _mm512_unpacklo_epi64(_t[1], _t[3]);					\
+	out[3] = _mm512_unpackhi_epi64(_t[1], _t[3]);					\
+})
+
+#define EXTRACT_FRAME(out,f)	_mm512_extracti32x4_epi32(out[(f) & 3], (f) >> 2)
+
+/* the scalar version of the conversion, avoids a call to lrintf */
+static inline int32_t f32_to_i32_ss(float v, __m512 scale, __m512 offs,
+		__m512 int_min, __m512 int_max)
+{
+	__m128 in = _mm_set_ss(v);
+	in = _mm_mul_ss(in, _mm512_castps512_ps128(scale));
+	in = _mm_add_ss(in, _mm512_castps512_ps128(offs));
+	in = _mm_min_ss(_mm_max_ss(in, _mm512_castps512_ps128(int_min)),
+			_mm512_castps512_ps128(int_max));
+	return _mm_cvtss_si32(in);
+}
+
+/* convert 16 samples of one channel, the samples past n_samples are
+ * masked off */
+static inline void f32_to_i32_1s_avx512(int32_t *out, const float *s, uint32_t n_samples,
+		__m512 scale, __m512 offs, __m512 int_min, __m512 int_max)
+{
+	__mmask16 mask = n_samples < 16 ? (1u << n_samples) - 1 : 0xffff;
+	__m512 in = _mm512_maskz_loadu_ps(mask, s);
+	in = _mm512_add_ps(_mm512_mul_ps(in, scale), offs);
+	in = _MM512_CLAMP_PS(in, int_min, int_max);
+	_mm512_storeu_si512(out, _mm512_cvtps_epi32(in));
+}
+
+static void
+conv_f32d_to_s24_32_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m512i out[4];
+	__m512 scale = _mm512_set1_ps(S24_SCALE);
+	__m512 offs = _mm512_setzero_ps();
+	__m512 int_min = _mm512_set1_ps(S24_MIN);
+	__m512 int_max = _mm512_set1_ps(S24_MAX);
+
+	unrolled = n_samples & ~15;
+
+	for(n = 0; n < unrolled; n += 16) {
+		F32D_TO_I32_4S_AVX512(s0, s1, s2, s3, n, scale, offs, int_min, int_max, out);
+
+		_mm_storeu_si128((__m128i*)(d +  0*n_channels), EXTRACT_FRAME(out, 0));
+		_mm_storeu_si128((__m128i*)(d +  1*n_channels), EXTRACT_FRAME(out, 1));
+		_mm_storeu_si128((__m128i*)(d +  2*n_channels), EXTRACT_FRAME(out, 2));
+		_mm_storeu_si128((__m128i*)(d +  3*n_channels), EXTRACT_FRAME(out, 3));
+		_mm_storeu_si128((__m128i*)(d +  4*n_channels), EXTRACT_FRAME(out, 4));
+		_mm_storeu_si128((__m128i*)(d +  5*n_channels), EXTRACT_FRAME(out, 5));
+		_mm_storeu_si128((__m128i*)(d +  6*n_channels), EXTRACT_FRAME(out, 6));
+		_mm_storeu_si128((__m128i*)(d +  7*n_channels), EXTRACT_FRAME(out, 7));
+		_mm_storeu_si128((__m128i*)(d +  8*n_channels), EXTRACT_FRAME(out, 8));
+		_mm_storeu_si128((__m128i*)(d +  9*n_channels), EXTRACT_FRAME(out, 9));
+		_mm_storeu_si128((__m128i*)(d + 10*n_channels), EXTRACT_FRAME(out, 10));
+		_mm_storeu_si128((__m128i*)(d + 11*n_channels), EXTRACT_FRAME(out, 11));
+		_mm_storeu_si128((__m128i*)(d + 12*n_channels), EXTRACT_FRAME(out, 12));
+		_mm_storeu_si128((__m128i*)(d + 13*n_channels), EXTRACT_FRAME(out, 13));
+		_mm_storeu_si128((__m128i*)(d + 14*n_channels), EXTRACT_FRAME(out, 14));
+		_mm_storeu_si128((__m128i*)(d + 15*n_channels), EXTRACT_FRAME(out, 15));
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = f32_to_i32_ss(s0[n], scale, offs, int_min, int_max);
+		d[1] = f32_to_i32_ss(s1[n], scale, offs, int_min, int_max);
+		d[2] = f32_to_i32_ss(s2[n], scale, offs, int_min, int_max);
+		d[3] = f32_to_i32_ss(s3[n], scale, offs, int_min, int_max);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_32_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, i, stride = n_channels;
+	__m512 scale = _mm512_set1_ps(S24_SCALE);
+	__m512 offs = _mm512_setzero_ps();
+	__m512 int_min = _mm512_set1_ps(S24_MIN);
+	__m512 int_max = _mm512_set1_ps(S24_MAX);
+	int32_t out[16];
+
+	for(n = 0; n < n_samples; n += 16) {
+		uint32_t len = SPA_MIN(n_samples - n, 16u);
+		f32_to_i32_1s_avx512(out, &s0[n], len, scale, offs, int_min, int_max);
+		for (i = 0; i < len; i++) {
+			*d = out[i];
+			d += stride;
+		}
+	}
+}
+
+void
+conv_f32d_to_s24_32_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_32_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_32_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+/* store the low 3 bytes of the 4 samples in v */
+static inline void store_s24x4(uint8_t *d, __m128i v)
+{
+	const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+			-1, -1, -1, -1);
+	v = _mm_shuffle_epi8(v, pack);
+	_mm_storel_epi64((__m128i*)d, v);
+	spa_write_unaligned(d + 8, uint32_t, _mm_extract_epi32(v, 2));
+}
+
+static void
+conv_f32d_to_s24_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled, stride = 3 * n_channels;
+	__m512i out[4];
+	__m512 scale = _mm512_set1_ps(S24_SCALE);
+	__m512 offs = _mm512_setzero_ps();
+	__m512 int_min = _mm512_set1_ps(S24_MIN);
+	__m512 int_max = _mm512_set1_ps(S24_MAX);
+
+	unrolled = n_samples & ~15;
+
+	for(n = 0; n < unrolled; n += 16) {
+		F32D_TO_I32_4S_AVX512(s0, s1, s2, s3, n, scale, offs, int_min, int_max, out);
+
+		store_s24x4(d +  0*stride, EXTRACT_FRAME(out, 0));
+		store_s24x4(d +  1*stride, EXTRACT_FRAME(out, 1));
+		store_s24x4(d +  2*stride, EXTRACT_FRAME(out, 2));
+		store_s24x4(d +  3*stride, EXTRACT_FRAME(out, 3));
+		store_s24x4(d +  4*stride, EXTRACT_FRAME(out, 4));
+		store_s24x4(d +  5*stride, EXTRACT_FRAME(out, 5));
+		store_s24x4(d +  6*stride, EXTRACT_FRAME(out, 6));
+		store_s24x4(d +  7*stride, EXTRACT_FRAME(out, 7));
+		store_s24x4(d +  8*stride, EXTRACT_FRAME(out, 8));
+		store_s24x4(d +  9*stride, EXTRACT_FRAME(out, 9));
+		store_s24x4(d + 10*stride, EXTRACT_FRAME(out, 10));
+		store_s24x4(d + 11*stride, EXTRACT_FRAME(out, 11));
+		store_s24x4(d + 12*stride, EXTRACT_FRAME(out, 12));
+		store_s24x4(d + 13*stride, EXTRACT_FRAME(out, 13));
+		store_s24x4(d + 14*stride, EXTRACT_FRAME(out, 14));
+		store_s24x4(d + 15*stride, EXTRACT_FRAME(out, 15));
+		d += 16*stride;
+	}
+	for(; n < n_samples; n++) {
+		int24_t *d24 = (int24_t*)d;
+		d24[0] = s32_to_s24(f32_to_i32_ss(s0[n], scale, offs, int_min, int_max));
+		d24[1] = s32_to_s24(f32_to_i32_ss(s1[n], scale, offs, int_min, int_max));
+		d24[2] = s32_to_s24(f32_to_i32_ss(s2[n], scale, offs, int_min, int_max));
+		d24[3] = s32_to_s24(f32_to_i32_ss(s3[n], scale, offs, int_min, int_max));
+		d += stride;
+	}
+}
+
+static void
+conv_f32d_to_s24_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, i, stride = 3 * n_channels;
+	__m512 scale = _mm512_set1_ps(S24_SCALE);
+	__m512 offs = _mm512_setzero_ps();
+	__m512 int_min = _mm512_set1_ps(S24_MIN);
+	__m512 int_max = _mm512_set1_ps(S24_MAX);
+	int32_t out[16];
+
+	for(n = 0; n < n_samples; n += 16) {
+		uint32_t len = SPA_MIN(n_samples - n, 16u);
+		f32_to_i32_1s_avx512(out, &s0[n], len, scale, offs, int_min, int_max);
+		for (i = 0; i < len; i++) {
+			*(int24_t*)d = s32_to_s24(out[i]);
+			d += stride;
+		}
+	}
+}
+
+void
+conv_f32d_to_s24_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int24_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_u8_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m512i out[4];
+	__m128i b[4];
+	__m512 scale = _mm512_set1_ps(U8_SCALE);
+	__m512 offs = _mm512_set1_ps(U8_OFFS);
+	__m512 int_min = _mm512_set1_ps(U8_MIN);
+	__m512 int_max = _mm512_set1_ps(U8_MAX);
+
+	unrolled = n_samples & ~15;
+
+	for(n = 0; n < unrolled; n += 16) {
+		F32D_TO_I32_4S_AVX512(s0, s1, s2, s3, n, scale, offs, int_min, int_max, out);
+
+		/* the values are clamped, truncate them to bytes. 32 bits l
+		 * of b[k] holds frame 4*l+k */
+		b[0] = _mm512_cvtepi32_epi8(out[0]);
+		b[1] = _mm512_cvtepi32_epi8(out[1]);
+		b[2] = _mm512_cvtepi32_epi8(out[2]);
+		b[3] = _mm512_cvtepi32_epi8(out[3]);
+
+		spa_write_unaligned(d +  0*n_channels, uint32_t, _mm_extract_epi32(b[0], 0));
+		spa_write_unaligned(d +  1*n_channels, uint32_t, _mm_extract_epi32(b[1], 0));
+		spa_write_unaligned(d +  2*n_channels, uint32_t, _mm_extract_epi32(b[2], 0));
+		spa_write_unaligned(d +  3*n_channels, uint32_t, _mm_extract_epi32(b[3], 0));
+		spa_write_unaligned(d +  4*n_channels, uint32_t, _mm_extract_epi32(b[0], 1));
+		spa_write_unaligned(d +  5*n_channels, uint32_t, _mm_extract_epi32(b[1], 1));
+		spa_write_unaligned(d +  6*n_channels, uint32_t, _mm_extract_epi32(b[2], 1));
+		spa_write_unaligned(d +  7*n_channels, uint32_t, _mm_extract_epi32(b[3], 1));
+		spa_write_unaligned(d +  8*n_channels, uint32_t, _mm_extract_epi32(b[0], 2));
+		spa_write_unaligned(d +  9*n_channels, uint32_t, _mm_extract_epi32(b[1], 2));
+		spa_write_unaligned(d + 10*n_channels, uint32_t, _mm_extract_epi32(b[2], 2));
+		spa_write_unaligned(d + 11*n_channels, uint32_t, _mm_extract_epi32(b[3], 2));
+		spa_write_unaligned(d + 12*n_channels, uint32_t, _mm_extract_epi32(b[0], 3));
+		spa_write_unaligned(d + 13*n_channels, uint32_t, _mm_extract_epi32(b[1], 3));
+		spa_write_unaligned(d + 14*n_channels, uint32_t, _mm_extract_epi32(b[2], 3));
+		spa_write_unaligned(d + 15*n_channels, uint32_t, _mm_extract_epi32(b[3], 3));
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = f32_to_i32_ss(s0[n], scale, offs, int_min, int_max);
+		d[1] = f32_to_i32_ss(s1[n], scale, offs, int_min, int_max);
+		d[2] = f32_to_i32_ss(s2[n], scale, offs, int_min, int_max);
+		d[3] = f32_to_i32_ss(s3[n], scale, offs, int_min, int_max);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_u8_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, i, stride = n_channels;
+	__m512 scale = _mm512_set1_ps(U8_SCALE);
+	__m512 offs = _mm512_set1_ps(U8_OFFS);
+	__m512 int_min = _mm512_set1_ps(U8_MIN);
+	__m512 int_max = _mm512_set1_ps(U8_MAX);
+	int32_t out[16];
+
+	for(n = 0; n < n_samples; n += 16) {
+		uint32_t len = SPA_MIN(n_samples - n, 16u);
+		f32_to_i32_1s_avx512(out, &s0[n], len, scale, offs, int_min, int_max);
+		for (i = 0; i < len; i++) {
+			*d = out[i];
+			d += stride;
+		}
+	}
+}
+
+void
+conv_f32d_to_u8_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_u8_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_u8_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+#define STORE_F64_FRAME(d,ab,cd,l)						\
+({										\
+	_mm_storeu_ps((float*)((d) + 0), _mm512_extractf32x4_ps(ab, l));	\
+	_mm_storeu_ps((float*)((d) + 2), _mm512_extractf32x4_ps(cd, l));	\
+})
+
+static void
+conv_f32d_to_f64_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	double *d = dst;
+	uint32_t n, unrolled;
+	__m512d in[4];
+	__m512 t[4];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm512_cvtps_pd(_mm256_loadu_ps(&s0[n]));
+		in[1] = _mm512_cvtps_pd(_mm256_loadu_ps(&s1[n]));
+		in[2] = _mm512_cvtps_pd(_mm256_loadu_ps(&s2[n]));
+		in[3] = _mm512_cvtps_pd(_mm256_loadu_ps(&s3[n]));
+
+		/* 128 bits lane l holds frame 2*l (even) or 2*l+1 (odd) */
+		t[0] = _mm512_castpd_ps(_mm512_unpacklo_pd(in[0], in[1]));	/* a b even */
+		t[1] = _mm512_castpd_ps(_mm512_unpackhi_pd(in[0], in[1]));	/* a b odd */
+		t[2] = _mm512_castpd_ps(_mm512_unpacklo_pd(in[2], in[3]));	/* c d even */
+		t[3] = _mm512_castpd_ps(_mm512_unpackhi_pd(in[2], in[3]));	/* c d odd */
+
+		STORE_F64_FRAME(d + 0*n_channels, t[0], t[2], 0);
+		STORE_F64_FRAME(d + 1*n_channels, t[1], t[3], 0);
+		STORE_F64_FRAME(d + 2*n_channels, t[0], t[2], 1);
+		STORE_F64_FRAME(d + 3*n_channels, t[1], t[3], 1);
+		STORE_F64_FRAME(d + 4*n_channels, t[0], t[2], 2);
+		STORE_F64_FRAME(d + 5*n_channels, t[1], t[3], 2);
+		STORE_F64_FRAME(d + 6*n_channels, t[0], t[2], 3);
+		STORE_F64_FRAME(d + 7*n_channels, t[1], t[3], 3);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_f64_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	double *d = dst[0];
+	uint32_t i = 0, j, n, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_f64_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(j = i; j < n_channels; j++) {
+		const float *s = src[j];
+		for (n = 0; n < n_samples; n++)
+			d[n * n_channels + j] = s[n];
+	}
+}
@@ -146,6 +146,12 @@ MAKE_I_TO_D(f64, double, f32, float, (float));
 MAKE_D_TO_I(f64, double, f32, float, (float));
 MAKE_I_TO_D(f64s, uint64_t, f32, float, (float)F64S_TO_F64);
 
+MAKE_D_TO_D(f16, uint16_t, f32, float, F16_TO_F32);
+MAKE_I_TO_I(f16, uint16_t, f32, float, F16_TO_F32);
+MAKE_I_TO_D(f16, uint16_t, f32, float, F16_TO_F32);
+MAKE_D_TO_I(f16, uint16_t, f32, float, F16_TO_F32);
+MAKE_I_TO_D(f16s, uint16_t, f32, float, F16S_TO_F32);
+
 /* from f32 */
 MAKE_D_TO_D(f32, float, u8, uint8_t, F32_TO_U8);
 MAKE_I_TO_I(f32, float, u8, uint8_t, F32_TO_U8);
@@ -202,6 +208,12 @@ MAKE_I_TO_D(f32, float, f64, double, (double));
 MAKE_D_TO_I(f32, float, f64, double, (double));
 MAKE_D_TO_I(f32, float, f64s, uint64_t, F64_TO_F64S);
 
+MAKE_D_TO_D(f32, float, f16, uint16_t, F32_TO_F16);
+MAKE_I_TO_I(f32, float, f16, uint16_t, F32_TO_F16);
+MAKE_I_TO_D(f32, float, f16, uint16_t, F32_TO_F16);
+MAKE_D_TO_I(f32, float, f16, uint16_t, F32_TO_F16);
+MAKE_D_TO_I(f32, float, f16s, uint16_t, F32_TO_F16S);
+
 
 static inline int32_t
 lcnoise(uint32_t *state)
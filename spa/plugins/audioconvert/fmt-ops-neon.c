@@ -465,3 +465,283 @@ conv_f32d_to_s16_neon(struct convert *conv, void * SPA_RESTRICT dst[], const voi
 	for(; i < n_channels; i++)
 		conv_f32d_to_s16_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
 }
+
+/* 32 bit xorshift PRNG, see https://en.wikipedia.org/wiki/Xorshift */
+static inline int32x4_t xorshift_neon(uint32_t *r)
+{
+	uint32x4_t i = vld1q_u32(r);
+	i = veorq_u32(i, vshlq_n_u32(i, 13));
+	i = veorq_u32(i, vshrq_n_u32(i, 17));
+	i = veorq_u32(i, vshlq_n_u32(i, 5));
+	vst1q_u32(r, i);
+	return vreinterpretq_s32_u32(i);
+}
+
+void conv_noise_rect_neon(struct convert *conv, float *noise, uint32_t n_samples)
+{
+	uint32_t n;
+	uint32_t *r = conv->random;
+	float32x4_t scale = vdupq_n_f32(conv->scale);
+
+	for (n = 0; n < n_samples; n += 4)
+		vst1q_f32(&noise[n], vmulq_f32(vcvtq_f32_s32(xorshift_neon(r)), scale));
+}
+
+void conv_noise_tri_neon(struct convert *conv, float *noise, uint32_t n_samples)
+{
+	uint32_t n;
+	uint32_t *r = conv->random;
+	float32x4_t scale = vdupq_n_f32(conv->scale);
+	int32x4_t in;
+
+	for (n = 0; n < n_samples; n += 4) {
+		in = xorshift_neon(r);
+		in = vsubq_s32(in, xorshift_neon(r));
+		vst1q_f32(&noise[n], vmulq_f32(vcvtq_f32_s32(in), scale));
+	}
+}
+
+void conv_noise_tri_hf_neon(struct convert *conv, float *noise, uint32_t n_samples)
+{
+	uint32_t n;
+	int32_t *p = conv->prev;
+	uint32_t *r = conv->random;
+	float32x4_t scale = vdupq_n_f32(conv->scale);
+	int32x4_t in, old, new;
+
+	old = vld1q_s32(p);
+	for (n = 0; n < n_samples; n += 4) {
+		new = xorshift_neon(r);
+		/* subtract the previous sample, the last one of the previous
+		 * vector for the first lane */
+		in = vsubq_s32(new, vextq_s32(old, new, 3));
+		old = new;
+		vst1q_f32(&noise[n], vmulq_f32(vcvtq_f32_s32(in), scale));
+	}
+	vst1q_s32(p, old);
+}
+
+static inline int32x4_t round_s32_neon(float32x4_t v)
+{
+#ifdef __aarch64__
+	return vcvtnq_s32_f32(v);
+#else
+	/* there is no round to nearest conversion, round half away
+	 * from zero instead */
+	uint32x4_t neg = vcltq_f32(v, vdupq_n_f32(0.0f));
+	float32x4_t half = vbslq_f32(neg, vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+	return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+
+static void
+conv_f32d_to_s16_1s_noise_neon(struct convert *conv, int16_t *d, const float *s,
+		const float *noise, uint32_t stride, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float32x4_t in;
+	int16x4_t out;
+	float32x4_t scale = vdupq_n_f32(S16_SCALE);
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vmlaq_f32(vld1q_f32(&noise[n]), vld1q_f32(&s[n]), scale);
+		out = vqmovn_s32(round_s32_neon(in));
+		if (stride == 1) {
+			vst1_s16(&d[n], out);
+		} else {
+			vst1_lane_s16(&d[(n+0)*stride], out, 0);
+			vst1_lane_s16(&d[(n+1)*stride], out, 1);
+			vst1_lane_s16(&d[(n+2)*stride], out, 2);
+			vst1_lane_s16(&d[(n+3)*stride], out, 3);
+		}
+	}
+	for(; n < n_samples; n++) {
+		in = vdupq_n_f32(s[n] * S16_SCALE + noise[n]);
+		out = vqmovn_s32(round_s32_neon(in));
+		vst1_lane_s16(&d[n*stride], out, 0);
+	}
+}
+
+void
+conv_f32d_to_s16_noise_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i, k, chunk, n_channels = conv->n_channels;
+	float *noise = conv->noise;
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	for(i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+		for(k = 0; k < n_samples; k += chunk) {
+			chunk = SPA_MIN(n_samples - k, conv->noise_size);
+			conv_f32d_to_s16_1s_noise_neon(conv, &d[i + k*n_channels],
+					&s[k], noise, n_channels, chunk);
+		}
+	}
+}
+
+void
+conv_f32d_to_s16d_noise_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t i, k, chunk, n_channels = conv->n_channels;
+	float *noise = conv->noise;
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	for(i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+		int16_t *d = dst[i];
+		for(k = 0; k < n_samples; k += chunk) {
+			chunk = SPA_MIN(n_samples - k, conv->noise_size);
+			conv_f32d_to_s16_1s_noise_neon(conv, &d[k], &s[k], noise, 1, chunk);
+		}
+	}
+}
+
+/* run the noise shaper of 4 channels for one sample, v holds the channels
+ * and h the error history of the channels, most recent first */
+static inline int16x4_t
+shaper_step_neon(float32x4_t v, float32x4_t *h, const float *ns, uint32_t n_ns,
+		float32x4_t noise, float32x4_t int_min, float32x4_t int_max)
+{
+	int32x4_t t;
+	uint32_t n;
+
+	for (n = 0; n < n_ns; n++)
+		v = vaddq_f32(v, vmulq_n_f32(h[n], ns[n]));
+	t = round_s32_neon(vminq_f32(vmaxq_f32(vaddq_f32(v, noise), int_min), int_max));
+	for (n = n_ns - 1; n > 0; n--)
+		h[n] = h[n-1];
+	h[0] = vsubq_f32(v, vcvtq_f32_s32(t));
+	/* the values are clamped, narrowing them is lossless */
+	return vqmovn_s32(t);
+}
+
+static inline void
+store_s16_4s_neon(int16_t **d, uint32_t offs, int16x4_t t, uint32_t n_channels, bool packed)
+{
+	if (packed && n_channels == 4) {
+		vst1_s16(&d[0][offs], t);
+		return;
+	}
+	vst1_lane_s16(&d[0][offs], t, 0);
+	if (n_channels > 1)
+		vst1_lane_s16(&d[1][offs], t, 1);
+	if (n_channels > 2)
+		vst1_lane_s16(&d[2][offs], t, 2);
+	if (n_channels > 3)
+		vst1_lane_s16(&d[3][offs], t, 3);
+}
+
+/* noise shape up to 4 channels at once. The shaper of each channel is a
+ * recursive filter over the samples so we vectorize over the channels. The
+ * unused lanes read from s[0] and write to a dummy shaper. */
+static void
+conv_f32d_to_s16_4s_shaped_neon(struct convert *conv, int16_t *d[4], uint32_t stride,
+		const float *s[4], struct shaper *sh[4], const float *noise,
+		uint32_t n_channels, uint32_t n_samples, bool packed)
+{
+	const float *ns = conv->ns;
+	uint32_t c, n, j, unrolled, n_ns = conv->n_ns;
+	float32x4_t in[4], h[NS_MAX];
+	float32x4x2_t t[2];
+	float32x4_t scale = vdupq_n_f32(S16_SCALE);
+	float32x4_t int_min = vdupq_n_f32(S16_MIN);
+	float32x4_t int_max = vdupq_n_f32(S16_MAX);
+	int16x4_t out;
+	float e[4];
+
+	for (n = 0; n < n_ns; n++) {
+		for (c = 0; c < 4; c++)
+			e[c] = sh[c]->e[sh[c]->idx + n];
+		h[n] = vld1q_f32(e);
+	}
+
+	unrolled = n_samples & ~3;
+
+	for (j = 0; j < unrolled; j += 4) {
+		/* transpose the 4x4 block so that in[k] holds sample j+k
+		 * of the 4 channels */
+		t[0] = vtrnq_f32(vld1q_f32(&s[0][j]), vld1q_f32(&s[1][j]));
+		t[1] = vtrnq_f32(vld1q_f32(&s[2][j]), vld1q_f32(&s[3][j]));
+		in[0] = vcombine_f32(vget_low_f32(t[0].val[0]), vget_low_f32(t[1].val[0]));
+		in[1] = vcombine_f32(vget_low_f32(t[0].val[1]), vget_low_f32(t[1].val[1]));
+		in[2] = vcombine_f32(vget_high_f32(t[0].val[0]), vget_high_f32(t[1].val[0]));
+		in[3] = vcombine_f32(vget_high_f32(t[0].val[1]), vget_high_f32(t[1].val[1]));
+
+		for (c = 0; c < 4; c++) {
+			out = shaper_step_neon(vmulq_f32(in[c], scale), h, ns, n_ns,
+					vdupq_n_f32(noise[j + c]), int_min, int_max);
+			store_s16_4s_neon(d, (j + c) * stride, out, n_channels, packed);
+		}
+	}
+	for (; j < n_samples; j++) {
+		for (c = 0; c < 4; c++)
+			e[c] = s[c][j];
+		out = shaper_step_neon(vmulq_f32(vld1q_f32(e), scale), h, ns, n_ns,
+				vdupq_n_f32(noise[j]), int_min, int_max);
+		store_s16_4s_neon(d, j * stride, out, n_channels, packed);
+	}
+
+	for (c = 0; c < 4; c++)
+		sh[c]->idx = (sh[c]->idx - n_samples) & NS_MASK;
+	for (n = 0; n < n_ns; n++) {
+		vst1q_f32(e, h[n]);
+		for (c = 0; c < 4; c++) {
+			uint32_t idx = (sh[c]->idx + n) & NS_MASK;
+			sh[c]->e[idx] = sh[c]->e[idx + NS_MAX] = e[c];
+		}
+	}
+}
+
+static void
+conv_f32d_to_s16_shaped_neon_impl(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples, bool interleaved)
+{
+	uint32_t i, c, k, chunk, nc, n_channels = conv->n_channels;
+	uint32_t stride = interleaved ? n_channels : 1;
+	float *noise = conv->noise;
+	struct shaper dummy, *sh[4];
+	const float *s[4];
+	int16_t *d[4];
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	spa_zero(dummy);
+	for(i = 0; i < n_channels; i += 4) {
+		nc = SPA_MIN(n_channels - i, 4u);
+		for(c = 0; c < 4; c++) {
+			s[c] = src[i + (c < nc ? c : 0)];
+			sh[c] = c < nc ? &conv->shaper[i + c] : &dummy;
+			d[c] = interleaved ? (int16_t*)dst[0] + i + c : dst[i + (c < nc ? c : 0)];
+		}
+		for(k = 0; k < n_samples; k += chunk) {
+			chunk = SPA_MIN(n_samples - k, conv->noise_size);
+			conv_f32d_to_s16_4s_shaped_neon(conv, d, stride, s, sh, noise,
+					nc, chunk, interleaved);
+			for(c = 0; c < 4; c++) {
+				s[c] += chunk;
+				d[c] += chunk * stride;
+			}
+		}
+	}
+}
+
+void
+conv_f32d_to_s16_shaped_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32d_to_s16_shaped_neon_impl(conv, dst, src, n_samples, true);
+}
+
+void
+conv_f32d_to_s16d_shaped_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32d_to_s16_shaped_neon_impl(conv, dst, src, n_samples, false);
+}
@@ -601,7 +601,10 @@ void conv_noise_tri_hf_sse2(struct convert *conv, float *noise, uint32_t n_sampl
 	old[0] = _mm_load_si128((__m128i*)p);
 	for (n = 0; n < n_samples; n += 4) {
 		new[0] = _MM_XORSHIFT_EPI32(r);
-		in[0] = _mm_sub_epi32(old[0], new[0]);
+		/* subtract the previous sample, the last one of the previous
+		 * vector for the first lane */
+		in[0] = _mm_or_si128(_mm_slli_si128(new[0], 4), _mm_srli_si128(old[0], 12));
+		in[0] = _mm_sub_epi32(new[0], in[0]);
 		old[0] = new[0];
 		out[0] = _mm_cvtepi32_ps(in[0]);
 		out[0] = _mm_mul_ps(out[0], scale);
@@ -1367,6 +1370,144 @@ conv_f32d_to_s16d_noise_sse2(struct convert *conv, void * SPA_RESTRICT dst[], co
 	}
 }
 
+/* run the noise shaper of 4 channels for one sample, v holds the channels
+ * and h the error history of the channels, most recent first */
+static inline __m128i
+shaper_step_sse2(__m128 v, __m128 *h, const __m128 *w, uint32_t n_ns,
+		__m128 noise, __m128 int_min, __m128 int_max)
+{
+	__m128i t;
+	uint32_t n;
+
+	for (n = 0; n < n_ns; n++)
+		v = _mm_add_ps(v, _mm_mul_ps(h[n], w[n]));
+	t = _mm_cvtps_epi32(_MM_CLAMP_PS(_mm_add_ps(v, noise), int_min, int_max));
+	for (n = n_ns - 1; n > 0; n--)
+		h[n] = h[n-1];
+	h[0] = _mm_sub_ps(v, _mm_cvtepi32_ps(t));
+	return t;
+}
+
+static inline void
+store_s16_4s_sse2(int16_t **d, uint32_t offs, __m128i t, uint32_t n_channels, bool packed)
+{
+	if (packed && n_channels == 4) {
+		/* the values are clamped, packing them is lossless */
+		_mm_storel_epi64((__m128i*)&d[0][offs], _mm_packs_epi32(t, t));
+		return;
+	}
+	d[0][offs] = _mm_extract_epi16(t, 0);
+	if (n_channels > 1)
+		d[1][offs] = _mm_extract_epi16(t, 2);
+	if (n_channels > 2)
+		d[2][offs] = _mm_extract_epi16(t, 4);
+	if (n_channels > 3)
+		d[3][offs] = _mm_extract_epi16(t, 6);
+}
+
+/* noise shape up to 4 channels at once. The shaper of each channel is a
+ * recursive filter over the samples so we vectorize over the channels. The
+ * unused lanes read from s[0] and write to a dummy shaper. */
+static void
+conv_f32d_to_s16_4s_shaped_sse2(struct convert *conv, int16_t *d[4], uint32_t stride,
+		const float *s[4], struct shaper *sh[4], const float *noise,
+		uint32_t n_channels, uint32_t n_samples, bool packed)
+{
+	const float *ns = conv->ns;
+	uint32_t c, n, j, unrolled, n_ns = conv->n_ns;
+	__m128 in[4], h[NS_MAX], w[NS_MAX];
+	__m128 scale = _mm_set1_ps(S16_SCALE);
+	__m128 int_min = _mm_set1_ps(S16_MIN);
+	__m128 int_max = _mm_set1_ps(S16_MAX);
+	__m128i out;
+	float e[4];
+
+	for (n = 0; n < n_ns; n++) {
+		h[n] = _mm_setr_ps(sh[0]->e[sh[0]->idx + n], sh[1]->e[sh[1]->idx + n],
+				sh[2]->e[sh[2]->idx + n], sh[3]->e[sh[3]->idx + n]);
+		w[n] = _mm_set1_ps(ns[n]);
+	}
+
+	unrolled = n_samples & ~3;
+
+	for (j = 0; j < unrolled; j += 4) {
+		in[0] = _mm_loadu_ps(&s[0][j]);
+		in[1] = _mm_loadu_ps(&s[1][j]);
+		in[2] = _mm_loadu_ps(&s[2][j]);
+		in[3] = _mm_loadu_ps(&s[3][j]);
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		for (c = 0; c < 4; c++) {
+			out = shaper_step_sse2(_mm_mul_ps(in[c], scale), h, w, n_ns,
+					_mm_set1_ps(noise[j + c]), int_min, int_max);
+			store_s16_4s_sse2(d, (j + c) * stride, out, n_channels, packed);
+		}
+	}
+	for (; j < n_samples; j++) {
+		in[0] = _mm_setr_ps(s[0][j], s[1][j], s[2][j], s[3][j]);
+		out = shaper_step_sse2(_mm_mul_ps(in[0], scale), h, w, n_ns,
+				_mm_set1_ps(noise[j]), int_min, int_max);
+		store_s16_4s_sse2(d, j * stride, out, n_channels, packed);
+	}
+
+	for (c = 0; c < 4; c++)
+		sh[c]->idx = (sh[c]->idx - n_samples) & NS_MASK;
+	for (n = 0; n < n_ns; n++) {
+		_mm_storeu_ps(e, h[n]);
+		for (c = 0; c < 4; c++) {
+			uint32_t idx = (sh[c]->idx + n) & NS_MASK;
+			sh[c]->e[idx] = sh[c]->e[idx + NS_MAX] = e[c];
+		}
+	}
+}
+
+static void
+conv_f32d_to_s16_shaped_sse2_impl(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_samples, bool interleaved)
+{
+	uint32_t i, c, k, chunk, nc, n_channels = conv->n_channels;
+	uint32_t stride = interleaved ? n_channels : 1;
+	float *noise = conv->noise;
+	struct shaper dummy, *sh[4];
+	const float *s[4];
+	int16_t *d[4];
+
+	convert_update_noise(conv, noise, SPA_MIN(n_samples, conv->noise_size));
+
+	spa_zero(dummy);
+	for(i = 0; i < n_channels; i += 4) {
+		nc = SPA_MIN(n_channels - i, 4u);
+		for(c = 0; c < 4; c++) {
+			s[c] = src[i + (c < nc ? c : 0)];
+			sh[c] = c < nc ? &conv->shaper[i + c] : &dummy;
+			d[c] = interleaved ? (int16_t*)dst[0] + i + c : dst[i + (c < nc ? c : 0)];
+		}
+		for(k = 0; k < n_samples; k += chunk) {
+			chunk = SPA_MIN(n_samples - k, conv->noise_size);
+			conv_f32d_to_s16_4s_shaped_sse2(conv, d, stride, s, sh, noise,
+					nc, chunk, interleaved);
+			for(c = 0; c < 4; c++) {
+				s[c] += chunk;
+				d[c] += chunk * stride;
+			}
+		}
+	}
+}
+
+void
+conv_f32d_to_s16_shaped_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32d_to_s16_shaped_sse2_impl(conv, dst, src, n_samples, true);
+}
+
+void
+conv_f32d_to_s16d_shaped_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32d_to_s16_shaped_sse2_impl(conv, dst, src, n_samples, false);
+}
+
 void
 conv_f32d_to_s16_2_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
 		uint32_t n_samples)
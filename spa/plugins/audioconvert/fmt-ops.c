@@ -11,6 +11,7 @@
 #include <spa/param/audio/format-utils.h>
 
 #include "fmt-ops.h"
+#include "calibrate.h"
 
 #define NOISE_SIZE	(1<<10)
 #define RANDOM_SIZE	(16)
@@ -41,6 +42,12 @@ static struct conv_info conv_table[] =
 	MAKE(U8, F32, 0, conv_u8_to_f32_c),
 	MAKE(U8, F32, 0, conv_u8_to_f32_c),
 	MAKE(U8P, F32P, 0, conv_u8d_to_f32d_c),
+#if defined (HAVE_AVX512)
+	MAKE(U8, F32P, 0, conv_u8_to_f32d_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(U8, F32P, 0, conv_u8_to_f32d_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(U8, F32P, 0, conv_u8_to_f32d_c),
 	MAKE(U8P, F32, 0, conv_u8d_to_f32_c),
 
@@ -115,6 +122,9 @@ static struct conv_info conv_table[] =
 
 	MAKE(S24, F32, 0, conv_s24_to_f32_c),
 	MAKE(S24P, F32P, 0, conv_s24d_to_f32d_c),
+#if defined (HAVE_AVX512)
+	MAKE(S24, F32P, 0, conv_s24_to_f32d_avx512, SPA_CPU_FLAG_AVX512),
+#endif
 #if defined (HAVE_AVX2)
 	MAKE(S24, F32P, 0, conv_s24_to_f32d_avx2, SPA_CPU_FLAG_AVX2),
 #endif
@@ -137,6 +147,12 @@ static struct conv_info conv_table[] =
 
 	MAKE(S24_32, F32, 0, conv_s24_32_to_f32_c),
 	MAKE(S24_32P, F32P, 0, conv_s24_32d_to_f32d_c),
+#if defined (HAVE_AVX512)
+	MAKE(S24_32, F32P, 0, conv_s24_32_to_f32d_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(S24_32, F32P, 0, conv_s24_32_to_f32d_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(S24_32, F32P, 0, conv_s24_32_to_f32d_c),
 	MAKE(S24_32P, F32, 0, conv_s24_32d_to_f32_c),
 
@@ -144,11 +160,30 @@ static struct conv_info conv_table[] =
 
 	MAKE(F64, F32, 0, conv_f64_to_f32_c),
 	MAKE(F64P, F32P, 0, conv_f64d_to_f32d_c),
+#if defined (HAVE_AVX512)
+	MAKE(F64, F32P, 0, conv_f64_to_f32d_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(F64, F32P, 0, conv_f64_to_f32d_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(F64, F32P, 0, conv_f64_to_f32d_c),
 	MAKE(F64P, F32, 0, conv_f64d_to_f32_c),
 
 	MAKE(F64_OE, F32P, 0, conv_f64s_to_f32d_c),
 
+	MAKE(F16, F32, 0, conv_f16_to_f32_c),
+#if defined (HAVE_AVX2) && defined (HAVE_F16C)
+	MAKE(F16P, F32P, 0, conv_f16d_to_f32d_avx2, SPA_CPU_FLAG_AVX2 | SPA_CPU_FLAG_F16C),
+#endif
+	MAKE(F16P, F32P, 0, conv_f16d_to_f32d_c),
+#if defined (HAVE_AVX2) && defined (HAVE_F16C)
+	MAKE(F16, F32P, 0, conv_f16_to_f32d_avx2, SPA_CPU_FLAG_AVX2 | SPA_CPU_FLAG_F16C),
+#endif
+	MAKE(F16, F32P, 0, conv_f16_to_f32d_c),
+	MAKE(F16P, F32, 0, conv_f16d_to_f32_c),
+
+	MAKE(F16_OE, F32P, 0, conv_f16s_to_f32d_c),
+
 	/* from f32 */
 	MAKE(F32, U8, 0, conv_f32_to_u8_c),
 	MAKE(F32P, U8P, 0, conv_f32d_to_u8d_shaped_c, 0, CONV_SHAPE),
@@ -157,6 +192,12 @@ static struct conv_info conv_table[] =
 	MAKE(F32, U8P, 0, conv_f32_to_u8d_c),
 	MAKE(F32P, U8, 0, conv_f32d_to_u8_shaped_c, 0, CONV_SHAPE),
 	MAKE(F32P, U8, 0, conv_f32d_to_u8_noise_c, 0, CONV_NOISE),
+#if defined (HAVE_AVX512)
+	MAKE(F32P, U8, 0, conv_f32d_to_u8_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(F32P, U8, 0, conv_f32d_to_u8_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(F32P, U8, 0, conv_f32d_to_u8_c),
 
 	MAKE(F32, S8, 0, conv_f32_to_s8_c),
@@ -179,9 +220,24 @@ static struct conv_info conv_table[] =
 #endif
 	MAKE(F32, S16, 0, conv_f32_to_s16_c),
 
+#if defined (HAVE_AVX2)
+	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_shaped_avx2, SPA_CPU_FLAG_AVX2, CONV_SHAPE),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_shaped_sse2, SPA_CPU_FLAG_SSE2, CONV_SHAPE),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_shaped_neon, SPA_CPU_FLAG_NEON, CONV_SHAPE),
+#endif
 	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_shaped_c, 0, CONV_SHAPE),
+#if defined (HAVE_AVX2)
+	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_noise_avx2, SPA_CPU_FLAG_AVX2, CONV_NOISE),
+#endif
 #if defined (HAVE_SSE2)
 	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_noise_sse2, SPA_CPU_FLAG_SSE2, CONV_NOISE),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_noise_neon, SPA_CPU_FLAG_NEON, CONV_NOISE),
 #endif
 	MAKE(F32P, S16P, 0, conv_f32d_to_s16d_noise_c, 0, CONV_NOISE),
 #if defined (HAVE_SSE2)
@@ -191,9 +247,24 @@ static struct conv_info conv_table[] =
 
 	MAKE(F32, S16P, 0, conv_f32_to_s16d_c),
 
+#if defined (HAVE_AVX2)
+	MAKE(F32P, S16, 0, conv_f32d_to_s16_shaped_avx2, SPA_CPU_FLAG_AVX2, CONV_SHAPE),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(F32P, S16, 0, conv_f32d_to_s16_shaped_sse2, SPA_CPU_FLAG_SSE2, CONV_SHAPE),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(F32P, S16, 0, conv_f32d_to_s16_shaped_neon, SPA_CPU_FLAG_NEON, CONV_SHAPE),
+#endif
 	MAKE(F32P, S16, 0, conv_f32d_to_s16_shaped_c, 0, CONV_SHAPE),
+#if defined (HAVE_AVX2)
+	MAKE(F32P, S16, 0, conv_f32d_to_s16_noise_avx2, SPA_CPU_FLAG_AVX2, CONV_NOISE),
+#endif
 #if defined (HAVE_SSE2)
 	MAKE(F32P, S16, 0, conv_f32d_to_s16_noise_sse2, SPA_CPU_FLAG_SSE2, CONV_NOISE),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(F32P, S16, 0, conv_f32d_to_s16_noise_neon, SPA_CPU_FLAG_NEON, CONV_NOISE),
 #endif
 	MAKE(F32P, S16, 0, conv_f32d_to_s16_noise_c, 0, CONV_NOISE),
 #if defined (HAVE_NEON)
@@ -246,6 +317,12 @@ static struct conv_info conv_table[] =
 	MAKE(F32P, S24P, 0, conv_f32d_to_s24d_c),
 	MAKE(F32, S24P, 0, conv_f32_to_s24d_c),
 	MAKE(F32P, S24, 0, conv_f32d_to_s24_noise_c, 0, CONV_NOISE),
+#if defined (HAVE_AVX512)
+	MAKE(F32P, S24, 0, conv_f32d_to_s24_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(F32P, S24, 0, conv_f32d_to_s24_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(F32P, S24, 0, conv_f32d_to_s24_c),
 
 	MAKE(F32P, S24_OE, 0, conv_f32d_to_s24s_noise_c, 0, CONV_NOISE),
@@ -259,6 +336,12 @@ static struct conv_info conv_table[] =
 	MAKE(F32P, S24_32P, 0, conv_f32d_to_s24_32d_c),
 	MAKE(F32, S24_32P, 0, conv_f32_to_s24_32d_c),
 	MAKE(F32P, S24_32, 0, conv_f32d_to_s24_32_noise_c, 0, CONV_NOISE),
+#if defined (HAVE_AVX512)
+	MAKE(F32P, S24_32, 0, conv_f32d_to_s24_32_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(F32P, S24_32, 0, conv_f32d_to_s24_32_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(F32P, S24_32, 0, conv_f32d_to_s24_32_c),
 
 	MAKE(F32P, S24_32_OE, 0, conv_f32d_to_s24_32s_noise_c, 0, CONV_NOISE),
@@ -267,10 +350,29 @@ static struct conv_info conv_table[] =
 	MAKE(F32, F64, 0, conv_f32_to_f64_c),
 	MAKE(F32P, F64P, 0, conv_f32d_to_f64d_c),
 	MAKE(F32, F64P, 0, conv_f32_to_f64d_c),
+#if defined (HAVE_AVX512)
+	MAKE(F32P, F64, 0, conv_f32d_to_f64_avx512, SPA_CPU_FLAG_AVX512),
+#endif
+#if defined (HAVE_AVX2)
+	MAKE(F32P, F64, 0, conv_f32d_to_f64_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 	MAKE(F32P, F64, 0, conv_f32d_to_f64_c),
 
 	MAKE(F32P, F64_OE, 0, conv_f32d_to_f64s_c),
 
+	MAKE(F32, F16, 0, conv_f32_to_f16_c),
+#if defined (HAVE_AVX2) && defined (HAVE_F16C)
+	MAKE(F32P, F16P, 0, conv_f32d_to_f16d_avx2, SPA_CPU_FLAG_AVX2 | SPA_CPU_FLAG_F16C),
+#endif
+	MAKE(F32P, F16P, 0, conv_f32d_to_f16d_c),
+	MAKE(F32, F16P, 0, conv_f32_to_f16d_c),
+#if defined (HAVE_AVX2) && defined (HAVE_F16C)
+	MAKE(F32P, F16, 0, conv_f32d_to_f16_avx2, SPA_CPU_FLAG_AVX2 | SPA_CPU_FLAG_F16C),
+#endif
+	MAKE(F32P, F16, 0, conv_f32d_to_f16_c),
+
+	MAKE(F32P, F16_OE, 0, conv_f32d_to_f16s_c),
+
 	/* u8 */
 	MAKE(U8, U8, 0, conv_copy8_c),
 	MAKE(U8P, U8P, 0, conv_copy8d_c),
@@ -329,6 +431,12 @@ static struct conv_info conv_table[] =
 	MAKE(F64P, F64P, 0, conv_copy64d_c),
 	MAKE(F64, F64P, 0, conv_64_to_64d_c),
 	MAKE(F64P, F64, 0, conv_64d_to_64_c),
+
+	/* F16 */
+	MAKE(F16, F16, 0, conv_copy16_c),
+	MAKE(F16P, F16P, 0, conv_copy16d_c),
+	MAKE(F16, F16P, 0, conv_16_to_16d_c),
+	MAKE(F16P, F16, 0, conv_16d_to_16_c),
 };
 #undef MAKE
 
@@ -366,10 +474,20 @@ struct noise_info {
 
 static struct noise_info noise_table[] =
 {
+#if defined (HAVE_AVX2)
+	MAKE(RECTANGULAR, conv_noise_rect_avx2, SPA_CPU_FLAG_AVX2),
+	MAKE(TRIANGULAR, conv_noise_tri_avx2, SPA_CPU_FLAG_AVX2),
+	MAKE(TRIANGULAR_HF, conv_noise_tri_hf_avx2, SPA_CPU_FLAG_AVX2),
+#endif
 #if defined (HAVE_SSE2)
 	MAKE(RECTANGULAR, conv_noise_rect_sse2, SPA_CPU_FLAG_SSE2),
 	MAKE(TRIANGULAR, conv_noise_tri_sse2, SPA_CPU_FLAG_SSE2),
 	MAKE(TRIANGULAR_HF, conv_noise_tri_hf_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(RECTANGULAR, conv_noise_rect_neon, SPA_CPU_FLAG_NEON),
+	MAKE(TRIANGULAR, conv_noise_tri_neon, SPA_CPU_FLAG_NEON),
+	MAKE(TRIANGULAR_HF, conv_noise_tri_hf_neon, SPA_CPU_FLAG_NEON),
 #endif
 	MAKE(NONE, conv_noise_none_c),
 	MAKE(RECTANGULAR, conv_noise_rect_c),
@@ -390,6 +508,82 @@ static const struct noise_info *find_noise_info(uint32_t method,
 	return NULL;
 }
 
+#define MAX_CANDIDATES	8
+
+struct conv_calibrate {
+	struct convert *conv;
+	const struct conv_info *info[MAX_CANDIDATES];
+	const void *src[SPA_AUDIO_MAX_CHANNELS];
+	void *dst[SPA_AUDIO_MAX_CHANNELS];
+};
+
+static void run_conv_info(void *data, uint32_t index)
+{
+	struct conv_calibrate *c = data;
+	c->info[index]->process(c->conv, c->dst, c->src, CALIBRATE_SAMPLES);
+}
+
+/* time all the functions for the conversion that the cpu supports and
+ * return the fastest one */
+static const struct conv_info *calibrate_conv_info(struct convert *conv,
+		const struct conv_info *info, uint32_t conv_flags)
+{
+	struct conv_calibrate c;
+	struct calibrate_candidate candidates[MAX_CANDIDATES];
+	uint32_t i, n_candidates = 0, stride;
+	char key[64];
+	void *mem;
+
+	if (conv->n_channels > SPA_AUDIO_MAX_CHANNELS)
+		return info;
+
+	SPA_FOR_EACH_ELEMENT_VAR(conv_table, t) {
+		if (t->src_fmt != conv->src_fmt ||
+		    t->dst_fmt != conv->dst_fmt ||
+		    !MATCH_CHAN(t->n_channels, conv->n_channels) ||
+		    !MATCH_CPU_FLAGS(t->cpu_flags, conv->cpu_flags) ||
+		    !MATCH_DITHER(t->conv_flags, conv_flags))
+			continue;
+		/* only the first function for each set of cpu flags is
+		 * ever selected */
+		for (i = 0; i < n_candidates; i++)
+			if (c.info[i]->cpu_flags == t->cpu_flags)
+				break;
+		if (i < n_candidates || n_candidates == MAX_CANDIDATES)
+			continue;
+		c.info[n_candidates] = t;
+		candidates[n_candidates++] = (struct calibrate_candidate) {
+			.name = t->name,
+			.cpu_flags = t->cpu_flags,
+		};
+	}
+	if (n_candidates < 2)
+		return info;
+
+	/* room for the largest sample size, planar or interleaved */
+	stride = SPA_ROUND_UP(CALIBRATE_SAMPLES * sizeof(double), FMT_OPS_MAX_ALIGN);
+	if ((mem = calloc(2 * conv->n_channels * stride + FMT_OPS_MAX_ALIGN, 1)) == NULL)
+		return info;
+
+	c.conv = conv;
+	for (i = 0; i < conv->n_channels; i++) {
+		c.src[i] = SPA_PTROFF(SPA_PTR_ALIGN(mem, FMT_OPS_MAX_ALIGN, void), i * stride, void);
+		c.dst[i] = SPA_PTROFF(c.src[i], conv->n_channels * stride, void);
+	}
+
+	spa_scnprintf(key, sizeof(key), "convert-%u-%u-%u-%u", conv->src_fmt,
+			conv->dst_fmt, conv->n_channels, conv_flags);
+	info = c.info[calibrate_select(conv->log, key, candidates, n_candidates,
+				run_conv_info, &c)];
+
+	/* the test runs updated the dither state */
+	memset(conv->shaper, 0, sizeof(conv->shaper));
+	memset(conv->prev, 0, RANDOM_SIZE * sizeof(int32_t));
+	free(mem);
+
+	return info;
+}
+
 static void impl_convert_free(struct convert *conv)
 {
 	conv->process = NULL;
@@ -542,8 +736,11 @@ int convert_init(struct convert *conv)
 		conv->random[i] = random();
 
 	conv->is_passthrough = conv->src_fmt == conv->dst_fmt;
-	conv->cpu_flags = info->cpu_flags;
 	conv->update_noise = ninfo->noise;
+	if (conv->calibrate && !conv->is_passthrough)
+		info = calibrate_conv_info(conv, info, conv_flags);
+
+	conv->cpu_flags = info->cpu_flags;
 	conv->process = info->process;
 	conv->free = impl_convert_free;
 	conv->func_name = info->name;
@@ -202,6 +202,49 @@ static inline int24_t bswap_s24(int24_t src)
 #define F64S_TO_F64(v) \
 	((union { uint64_t i; double d; }){ .i = bswap_32(v) }.d)
 
+/* IEEE 754 binary16, the exponent is rebiased and the mantissa shifted.
+ * Denormals are converted by the FPU, out of range values become inf. */
+static inline float f16_to_f32(uint16_t v)
+{
+	union { uint32_t i; float f; } u;
+	uint32_t exp = (v >> 10) & 0x1f, mant = v & 0x3ff;
+
+	if (exp == 0x1f)
+		u.i = 0x7f800000 | (mant << 13);
+	else if (exp != 0)
+		u.i = ((exp + 112) << 23) | (mant << 13);
+	else
+		u.f = mant * 0x1p-24f;
+	u.i |= (uint32_t)(v & 0x8000) << 16;
+	return u.f;
+}
+
+static inline uint16_t f32_to_f16(float v)
+{
+	union { uint32_t i; float f; } u = { .f = v };
+	uint32_t sign = (u.i >> 16) & 0x8000, x = u.i & 0x7fffffff;
+
+	if (x >= 0x47800000) {
+		/* overflow, inf and nan */
+		x = x > 0x7f800000 ? 0x7e00 : 0x7c00;
+	} else if (x < 0x38800000) {
+		/* denormal, adding 0.5 makes the FPU round the mantissa */
+		u.i = x;
+		u.f += 0.5f;
+		x = u.i - 0x3f000000;
+	} else {
+		/* rebias and round to nearest even */
+		x += 0xc8000fff + ((x >> 13) & 1);
+		x >>= 13;
+	}
+	return (uint16_t)(sign | x);
+}
+
+#define F16_TO_F32(v)		f16_to_f32(v)
+#define F16S_TO_F32(v)		f16_to_f32(bswap_16(v))
+#define F32_TO_F16(v)		f32_to_f16(v)
+#define F32_TO_F16S(v)		bswap_16(f32_to_f16(v))
+
 #define NS_MAX	8
 #define NS_MASK	(NS_MAX-1)
 
@@ -228,7 +271,10 @@ struct convert {
 	uint32_t cpu_flags;
 	const char *func_name;
 
+	struct spa_log *log;
+
 	unsigned int is_passthrough:1;
+	unsigned int calibrate:1;	/**< time the candidate kernels */
 
 	float scale;
 	uint32_t *random;
@@ -296,11 +342,21 @@ DEFINE_NOISE_FUNCTION(rect, c);
 DEFINE_NOISE_FUNCTION(tri, c);
 DEFINE_NOISE_FUNCTION(tri_hf, c);
 DEFINE_NOISE_FUNCTION(pattern, c);
+#if defined(HAVE_NEON)
+DEFINE_NOISE_FUNCTION(rect, neon);
+DEFINE_NOISE_FUNCTION(tri, neon);
+DEFINE_NOISE_FUNCTION(tri_hf, neon);
+#endif
 #if defined(HAVE_SSE2)
 DEFINE_NOISE_FUNCTION(rect, sse2);
 DEFINE_NOISE_FUNCTION(tri, sse2);
 DEFINE_NOISE_FUNCTION(tri_hf, sse2);
 #endif
+#if defined(HAVE_AVX2)
+DEFINE_NOISE_FUNCTION(rect, avx2);
+DEFINE_NOISE_FUNCTION(tri, avx2);
+DEFINE_NOISE_FUNCTION(tri_hf, avx2);
+#endif
 
 #undef DEFINE_NOISE_FUNCTION
 
@@ -361,6 +417,11 @@ DEFINE_FUNCTION(f64_to_f32, c);
 DEFINE_FUNCTION(f64_to_f32d, c);
 DEFINE_FUNCTION(f64s_to_f32d, c);
 DEFINE_FUNCTION(f64d_to_f32, c);
+DEFINE_FUNCTION(f16d_to_f32d, c);
+DEFINE_FUNCTION(f16_to_f32, c);
+DEFINE_FUNCTION(f16_to_f32d, c);
+DEFINE_FUNCTION(f16s_to_f32d, c);
+DEFINE_FUNCTION(f16d_to_f32, c);
 DEFINE_FUNCTION(f32d_to_u8d, c);
 DEFINE_FUNCTION(f32d_to_u8d_noise, c);
 DEFINE_FUNCTION(f32d_to_u8d_shaped, c);
@@ -427,6 +488,11 @@ DEFINE_FUNCTION(f32_to_f64, c);
 DEFINE_FUNCTION(f32_to_f64d, c);
 DEFINE_FUNCTION(f32d_to_f64, c);
 DEFINE_FUNCTION(f32d_to_f64s, c);
+DEFINE_FUNCTION(f32d_to_f16d, c);
+DEFINE_FUNCTION(f32_to_f16, c);
+DEFINE_FUNCTION(f32_to_f16d, c);
+DEFINE_FUNCTION(f32d_to_f16, c);
+DEFINE_FUNCTION(f32d_to_f16s, c);
 DEFINE_FUNCTION(8_to_8d, c);
 DEFINE_FUNCTION(16_to_16d, c);
 DEFINE_FUNCTION(24_to_24d, c);
@@ -446,6 +512,10 @@ DEFINE_FUNCTION(64sd_to_64s, c);
 DEFINE_FUNCTION(s16_to_f32d_2, neon);
 DEFINE_FUNCTION(s16_to_f32d, neon);
 DEFINE_FUNCTION(f32d_to_s16, neon);
+DEFINE_FUNCTION(f32d_to_s16_noise, neon);
+DEFINE_FUNCTION(f32d_to_s16_shaped, neon);
+DEFINE_FUNCTION(f32d_to_s16d_noise, neon);
+DEFINE_FUNCTION(f32d_to_s16d_shaped, neon);
 #endif
 #if defined(HAVE_SSE2)
 DEFINE_FUNCTION(s16_to_f32d_2, sse2);
@@ -458,8 +528,10 @@ DEFINE_FUNCTION(f32_to_s16, sse2);
 DEFINE_FUNCTION(f32d_to_s16_2, sse2);
 DEFINE_FUNCTION(f32d_to_s16, sse2);
 DEFINE_FUNCTION(f32d_to_s16_noise, sse2);
+DEFINE_FUNCTION(f32d_to_s16_shaped, sse2);
 DEFINE_FUNCTION(f32d_to_s16d, sse2);
 DEFINE_FUNCTION(f32d_to_s16d_noise, sse2);
+DEFINE_FUNCTION(f32d_to_s16d_shaped, sse2);
 DEFINE_FUNCTION(32_to_32d, sse2);
 DEFINE_FUNCTION(32s_to_32d, sse2);
 DEFINE_FUNCTION(32d_to_32, sse2);
@@ -480,6 +552,33 @@ DEFINE_FUNCTION(f32d_to_s32, avx2);
 DEFINE_FUNCTION(f32d_to_s16_4, avx2);
 DEFINE_FUNCTION(f32d_to_s16_2, avx2);
 DEFINE_FUNCTION(f32d_to_s16, avx2);
+DEFINE_FUNCTION(f32d_to_s16_noise, avx2);
+DEFINE_FUNCTION(f32d_to_s16_shaped, avx2);
+DEFINE_FUNCTION(f32d_to_s16d_noise, avx2);
+DEFINE_FUNCTION(f32d_to_s16d_shaped, avx2);
+DEFINE_FUNCTION(s24_32_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_s24_32, avx2);
+DEFINE_FUNCTION(f32d_to_s24, avx2);
+DEFINE_FUNCTION(u8_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_u8, avx2);
+DEFINE_FUNCTION(f64_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_f64, avx2);
+#if defined(HAVE_F16C)
+DEFINE_FUNCTION(f16d_to_f32d, avx2);
+DEFINE_FUNCTION(f16_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_f16d, avx2);
+DEFINE_FUNCTION(f32d_to_f16, avx2);
+#endif
+#endif
+#if defined(HAVE_AVX512)
+DEFINE_FUNCTION(s24_to_f32d, avx512);
+DEFINE_FUNCTION(s24_32_to_f32d, avx512);
+DEFINE_FUNCTION(u8_to_f32d, avx512);
+DEFINE_FUNCTION(f64_to_f32d, avx512);
+DEFINE_FUNCTION(f32d_to_s24_32, avx512);
+DEFINE_FUNCTION(f32d_to_s24, avx512);
+DEFINE_FUNCTION(f32d_to_u8, avx512);
+DEFINE_FUNCTION(f32d_to_f64, avx512);
 #endif
 
 #undef DEFINE_FUNCTION
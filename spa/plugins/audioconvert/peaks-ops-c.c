@@ -28,3 +28,12 @@ float peaks_abs_max_c(struct peaks *peaks, const float * SPA_RESTRICT src,
 		max = fmaxf(fabsf(src[n]), max);
 	return max;
 }
+
+float peaks_sum_sqr_c(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float sum)
+{
+	uint32_t n;
+	for (n = 0; n < n_samples; n++)
+		sum += src[n] * src[n];
+	return sum;
+}
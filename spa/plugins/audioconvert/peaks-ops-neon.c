@@ -0,0 +1,113 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <math.h>
+
+#include <arm_neon.h>
+
+#include "peaks-ops.h"
+
+static inline float hmin_f32(float32x4_t val)
+{
+#if defined(__aarch64__)
+	return vminvq_f32(val);
+#else
+	float32x2_t t = vmin_f32(vget_low_f32(val), vget_high_f32(val));
+	t = vpmin_f32(t, t);
+	return vget_lane_f32(t, 0);
+#endif
+}
+
+static inline float hmax_f32(float32x4_t val)
+{
+#if defined(__aarch64__)
+	return vmaxvq_f32(val);
+#else
+	float32x2_t t = vmax_f32(vget_low_f32(val), vget_high_f32(val));
+	t = vpmax_f32(t, t);
+	return vget_lane_f32(t, 0);
+#endif
+}
+
+void peaks_min_max_neon(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float *min, float *max)
+{
+	uint32_t n;
+	float32x4_t in;
+	float32x4_t mi = vdupq_n_f32(*min);
+	float32x4_t ma = vdupq_n_f32(*max);
+
+	for (n = 0; n + 15 < n_samples; n += 16) {
+		in = vld1q_f32(&src[n + 0]);
+		mi = vminq_f32(mi, in);
+		ma = vmaxq_f32(ma, in);
+		in = vld1q_f32(&src[n + 4]);
+		mi = vminq_f32(mi, in);
+		ma = vmaxq_f32(ma, in);
+		in = vld1q_f32(&src[n + 8]);
+		mi = vminq_f32(mi, in);
+		ma = vmaxq_f32(ma, in);
+		in = vld1q_f32(&src[n + 12]);
+		mi = vminq_f32(mi, in);
+		ma = vmaxq_f32(ma, in);
+	}
+	for (; n < n_samples; n++) {
+		in = vdupq_n_f32(src[n]);
+		mi = vminq_f32(mi, in);
+		ma = vmaxq_f32(ma, in);
+	}
+	*min = hmin_f32(mi);
+	*max = hmax_f32(ma);
+}
+
+float peaks_abs_max_neon(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float max)
+{
+	uint32_t n;
+	float32x4_t in;
+	float32x4_t ma = vdupq_n_f32(max);
+
+	for (n = 0; n + 15 < n_samples; n += 16) {
+		in = vabsq_f32(vld1q_f32(&src[n + 0]));
+		ma = vmaxq_f32(ma, in);
+		in = vabsq_f32(vld1q_f32(&src[n + 4]));
+		ma = vmaxq_f32(ma, in);
+		in = vabsq_f32(vld1q_f32(&src[n + 8]));
+		ma = vmaxq_f32(ma, in);
+		in = vabsq_f32(vld1q_f32(&src[n + 12]));
+		ma = vmaxq_f32(ma, in);
+	}
+	for (; n < n_samples; n++) {
+		in = vabsq_f32(vdupq_n_f32(src[n]));
+		ma = vmaxq_f32(ma, in);
+	}
+	return hmax_f32(ma);
+}
+
+float peaks_sum_sqr_neon(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float sum)
+{
+	uint32_t n;
+	float32x4_t in;
+	float32x4_t s[2] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+	float32x2_t t;
+
+	for (n = 0; n + 15 < n_samples; n += 16) {
+		in = vld1q_f32(&src[n + 0]);
+		s[0] = vmlaq_f32(s[0], in, in);
+		in = vld1q_f32(&src[n + 4]);
+		s[1] = vmlaq_f32(s[1], in, in);
+		in = vld1q_f32(&src[n + 8]);
+		s[0] = vmlaq_f32(s[0], in, in);
+		in = vld1q_f32(&src[n + 12]);
+		s[1] = vmlaq_f32(s[1], in, in);
+	}
+	for (; n < n_samples; n++)
+		sum += src[n] * src[n];
+
+	s[0] = vaddq_f32(s[0], s[1]);
+	t = vadd_f32(vget_low_f32(s[0]), vget_high_f32(s[0]));
+	t = vpadd_f32(t, t);
+	return sum + vget_lane_f32(t, 0);
+}
@@ -100,3 +100,34 @@ float peaks_abs_max_sse(struct peaks *peaks, const float * SPA_RESTRICT src,
 	}
 	return hmax_ps(ma);
 }
+
+float peaks_sum_sqr_sse(struct peaks *peaks, const float * SPA_RESTRICT src,
+		uint32_t n_samples, float sum)
+{
+	uint32_t n;
+	__m128 in, t;
+	__m128 s[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+
+	for (n = 0; n < n_samples; n++) {
+		if (SPA_IS_ALIGNED(&src[n], 16))
+			break;
+		sum += src[n] * src[n];
+	}
+	for (; n + 15 < n_samples; n += 16) {
+		in = _mm_load_ps(&src[n + 0]);
+		s[0] = _mm_add_ps(s[0], _mm_mul_ps(in, in));
+		in = _mm_load_ps(&src[n + 4]);
+		s[1] = _mm_add_ps(s[1], _mm_mul_ps(in, in));
+		in = _mm_load_ps(&src[n + 8]);
+		s[0] = _mm_add_ps(s[0], _mm_mul_ps(in, in));
+		in = _mm_load_ps(&src[n + 12]);
+		s[1] = _mm_add_ps(s[1], _mm_mul_ps(in, in));
+	}
+	for (; n < n_samples; n++)
+		sum += src[n] * src[n];
+
+	s[0] = _mm_add_ps(s[0], s[1]);
+	t = _mm_add_ps(s[0], _mm_movehl_ps(s[0], s[0]));
+	t = _mm_add_ss(t, _mm_shuffle_ps(t, t, 0x55));
+	return sum + _mm_cvtss_f32(t);
+}
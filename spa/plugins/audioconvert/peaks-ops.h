@@ -19,6 +19,8 @@ struct peaks {
 		uint32_t n_samples, float *min, float *max);
 	float (*abs_max) (struct peaks *peaks, const float * SPA_RESTRICT src,
 			uint32_t n_samples, float max);
+	float (*sum_sqr) (struct peaks *peaks, const float * SPA_RESTRICT src,
+			uint32_t n_samples, float sum);
 
 	void (*free) (struct peaks *peaks);
 };
@@ -27,6 +29,7 @@ int peaks_init(struct peaks *peaks);
 
 #define peaks_min_max(peaks,...)	(peaks)->min_max(peaks, __VA_ARGS__)
 #define peaks_abs_max(peaks,...)	(peaks)->abs_max(peaks, __VA_ARGS__)
+#define peaks_sum_sqr(peaks,...)	(peaks)->sum_sqr(peaks, __VA_ARGS__)
 #define peaks_free(peaks)		(peaks)->free(peaks)
 
 #define DEFINE_MIN_MAX_FUNCTION(arch)				\
@@ -39,14 +42,26 @@ float peaks_abs_max_##arch(struct peaks *peaks,			\
 		const float * SPA_RESTRICT src,			\
 		uint32_t n_samples, float max);
 
+#define DEFINE_SUM_SQR_FUNCTION(arch)				\
+float peaks_sum_sqr_##arch(struct peaks *peaks,			\
+		const float * SPA_RESTRICT src,			\
+		uint32_t n_samples, float sum);
+
 #define PEAKS_OPS_MAX_ALIGN	16
 
 DEFINE_MIN_MAX_FUNCTION(c);
 DEFINE_ABS_MAX_FUNCTION(c);
+DEFINE_SUM_SQR_FUNCTION(c);
 
 #if defined (HAVE_SSE)
 DEFINE_MIN_MAX_FUNCTION(sse);
 DEFINE_ABS_MAX_FUNCTION(sse);
+DEFINE_SUM_SQR_FUNCTION(sse);
+#endif
+#if defined (HAVE_NEON)
+DEFINE_MIN_MAX_FUNCTION(neon);
+DEFINE_ABS_MAX_FUNCTION(neon);
+DEFINE_SUM_SQR_FUNCTION(neon);
 #endif
 
 #undef DEFINE_FUNCTION
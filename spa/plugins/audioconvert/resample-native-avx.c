@@ -70,5 +70,57 @@ static inline void inner_product_ip_avx(float *d, const float * SPA_RESTRICT s,
 	_mm_store_ss(d, sx[0]);
 }
 
-MAKE_RESAMPLER_FULL(avx);
-MAKE_RESAMPLER_INTER(avx);
+static inline void store4_avx(float **d, uint32_t o, __m256 sum[4])
+{
+	float r[4] SPA_ALIGNED(16);
+	__m128 sx[4];
+	uint32_t c;
+
+	for (c = 0; c < 4; c++)
+		sx[c] = _mm_add_ps(_mm256_extractf128_ps(sum[c], 0),
+				_mm256_extractf128_ps(sum[c], 1));
+	_MM_TRANSPOSE4_PS(sx[0], sx[1], sx[2], sx[3]);
+	sx[0] = _mm_add_ps(_mm_add_ps(sx[0], sx[1]), _mm_add_ps(sx[2], sx[3]));
+	_mm_store_ps(r, sx[0]);
+	d[0][o] = r[0];
+	d[1][o] = r[1];
+	d[2][o] = r[2];
+	d[3][o] = r[3];
+}
+
+static inline void inner_product4_avx(float **d, uint32_t o,
+		const float **s, uint32_t index,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	const float *s0 = &s[0][index], *s1 = &s[1][index];
+	const float *s2 = &s[2][index], *s3 = &s[3][index];
+	__m256 sum[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(),
+		_mm256_setzero_ps(), _mm256_setzero_ps() }, t;
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 8) {
+		t = _mm256_load_ps(taps + i);
+		sum[0] = _mm256_fmadd_ps(_mm256_loadu_ps(s0 + i), t, sum[0]);
+		sum[1] = _mm256_fmadd_ps(_mm256_loadu_ps(s1 + i), t, sum[1]);
+		sum[2] = _mm256_fmadd_ps(_mm256_loadu_ps(s2 + i), t, sum[2]);
+		sum[3] = _mm256_fmadd_ps(_mm256_loadu_ps(s3 + i), t, sum[3]);
+	}
+	store4_avx(d, o, sum);
+}
+
+static inline void interpolate_taps_avx(float * SPA_RESTRICT taps,
+		const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1,
+		float x, uint32_t n_taps)
+{
+	__m256 a, b, vx = _mm256_set1_ps(x);
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 8) {
+		a = _mm256_load_ps(t0 + i);
+		b = _mm256_load_ps(t1 + i);
+		_mm256_store_ps(taps + i, _mm256_fmadd_ps(_mm256_sub_ps(b, a), vx, a));
+	}
+}
+
+MAKE_RESAMPLER_FULL_BLOCK(avx);
+MAKE_RESAMPLER_INTER_BLOCK(avx);
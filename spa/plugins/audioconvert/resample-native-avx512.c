@@ -0,0 +1,92 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "resample-native-impl.h"
+
+#include <assert.h>
+#include <immintrin.h>
+
+static inline void inner_product_avx512(float *d, const float * SPA_RESTRICT s,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	__m512 sz[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() }, tz;
+	__m256 sy, ty;
+	__m128 sx;
+	uint32_t i = 0;
+	uint32_t n_taps32 = n_taps & ~0x1f;
+
+	/* taps are 64 byte aligned, see filter_stride */
+	for (; i < n_taps32; i += 32) {
+		tz = _mm512_loadu_ps(s + i + 0);
+		sz[0] = _mm512_fmadd_ps(tz, _mm512_load_ps(taps + i + 0), sz[0]);
+		tz = _mm512_loadu_ps(s + i + 16);
+		sz[1] = _mm512_fmadd_ps(tz, _mm512_load_ps(taps + i + 16), sz[1]);
+	}
+	if (i + 16 <= n_taps) {
+		tz = _mm512_loadu_ps(s + i);
+		sz[0] = _mm512_fmadd_ps(tz, _mm512_load_ps(taps + i), sz[0]);
+		i += 16;
+	}
+	sz[0] = _mm512_add_ps(sz[0], sz[1]);
+	sy = _mm256_add_ps(_mm512_castps512_ps256(sz[0]),
+			_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sz[0]), 1)));
+	/* n_taps is a multiple of 8 */
+	if (i < n_taps) {
+		ty = _mm256_loadu_ps(s + i);
+		sy = _mm256_fmadd_ps(ty, _mm256_load_ps(taps + i), sy);
+	}
+	sx = _mm_add_ps(_mm256_castps256_ps128(sy), _mm256_extractf128_ps(sy, 1));
+	sx = _mm_hadd_ps(sx, sx);
+	sx = _mm_hadd_ps(sx, sx);
+	_mm_store_ss(d, sx);
+}
+
+static inline void inner_product_ip_avx512(float *d, const float * SPA_RESTRICT s,
+	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
+	uint32_t n_taps)
+{
+	__m512 sz[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() }, tz;
+	__m256 sy[2], ty;
+	__m128 sx;
+	uint32_t i, n_taps16 = n_taps & ~0xf;
+
+	for (i = 0; i < n_taps16; i += 16) {
+		tz = _mm512_loadu_ps(s + i);
+		sz[0] = _mm512_fmadd_ps(tz, _mm512_load_ps(t0 + i), sz[0]);
+		sz[1] = _mm512_fmadd_ps(tz, _mm512_load_ps(t1 + i), sz[1]);
+	}
+	sy[0] = _mm256_add_ps(_mm512_castps512_ps256(sz[0]),
+			_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sz[0]), 1)));
+	sy[1] = _mm256_add_ps(_mm512_castps512_ps256(sz[1]),
+			_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sz[1]), 1)));
+	/* n_taps is a multiple of 8 */
+	if (i < n_taps) {
+		ty = _mm256_loadu_ps(s + i);
+		sy[0] = _mm256_fmadd_ps(ty, _mm256_load_ps(t0 + i), sy[0]);
+		sy[1] = _mm256_fmadd_ps(ty, _mm256_load_ps(t1 + i), sy[1]);
+	}
+	sy[1] = _mm256_mul_ps(_mm256_sub_ps(sy[1], sy[0]), _mm256_set1_ps(x));
+	sy[0] = _mm256_add_ps(sy[0], sy[1]);
+	sx = _mm_add_ps(_mm256_castps256_ps128(sy[0]), _mm256_extractf128_ps(sy[0], 1));
+	sx = _mm_hadd_ps(sx, sx);
+	sx = _mm_hadd_ps(sx, sx);
+	_mm_store_ss(d, sx);
+}
+
+static inline void interpolate_taps_avx512(float * SPA_RESTRICT taps,
+		const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1,
+		float x, uint32_t n_taps)
+{
+	__m256 a, b, vx = _mm256_set1_ps(x);
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 8) {
+		a = _mm256_load_ps(t0 + i);
+		b = _mm256_load_ps(t1 + i);
+		_mm256_store_ps(taps + i, _mm256_fmadd_ps(_mm256_sub_ps(b, a), vx, a));
+	}
+}
+
+MAKE_RESAMPLER_FULL(avx512);
+MAKE_RESAMPLER_INTER(avx512);
@@ -41,5 +41,36 @@ static inline void inner_product_ip_c(float *d, const float * SPA_RESTRICT s,
 	*d = (sum[1] - sum[0]) * x + sum[0];
 }
 
-MAKE_RESAMPLER_FULL(c);
-MAKE_RESAMPLER_INTER(c);
+static inline void inner_product4_c(float **d, uint32_t o,
+		const float **s, uint32_t index,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	const float *s0 = &s[0][index], *s1 = &s[1][index];
+	const float *s2 = &s[2][index], *s3 = &s[3][index];
+	float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i++) {
+		float t = taps[i];
+		sum[0] += s0[i] * t;
+		sum[1] += s1[i] * t;
+		sum[2] += s2[i] * t;
+		sum[3] += s3[i] * t;
+	}
+	d[0][o] = sum[0];
+	d[1][o] = sum[1];
+	d[2][o] = sum[2];
+	d[3][o] = sum[3];
+}
+
+static inline void interpolate_taps_c(float * SPA_RESTRICT taps,
+		const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1,
+		float x, uint32_t n_taps)
+{
+	uint32_t i;
+	for (i = 0; i < n_taps; i++)
+		taps[i] = (t1[i] - t0[i]) * x + t0[i];
+}
+
+MAKE_RESAMPLER_FULL_BLOCK(c);
+MAKE_RESAMPLER_INTER_BLOCK(c);
@@ -27,6 +27,7 @@ struct native_data {
 	double rate;
 	uint32_t n_taps;
 	uint32_t n_phases;
+	uint32_t delay;
 	uint32_t in_rate;
 	uint32_t out_rate;
 	float phase;
@@ -38,6 +39,8 @@ struct native_data {
 	float **history;
 	resample_func_t func;
 	float *filter;
+	float *inter_taps;
+	struct resample_filter *filter_cache;
 	float *hist_mem;
 	const struct resample_info *info;
 };
@@ -51,7 +54,7 @@ void do_resample_##type##_##arch(struct resample *r,				\
 DEFINE_RESAMPLER(copy,arch)							\
 {										\
 	struct native_data *data = r->data;					\
-	uint32_t index, n_taps = data->n_taps, n_taps2 = n_taps/2;		\
+	uint32_t index, n_taps = data->n_taps, offs = n_taps - data->delay;	\
 	uint32_t c, olen = *out_len, ilen = *in_len;				\
 										\
 	if (r->channels == 0)							\
@@ -64,7 +67,7 @@ DEFINE_RESAMPLER(copy,arch)							\
 		for (c = 0; c < r->channels; c++) {				\
 			const float *s = src[c];				\
 			float *d = dst[c];					\
-			spa_memcpy(&d[ooffs], &s[index + n_taps2],		\
+			spa_memcpy(&d[ooffs], &s[index + offs],			\
 					to_copy * sizeof(float));		\
 		}								\
 		index += to_copy;						\
@@ -82,6 +85,14 @@ DEFINE_RESAMPLER(copy,arch)							\
 		index += 1;					\
 	}
 
+#define RESAMPLE_FULL_LOOP(arch)						\
+	for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {		\
+		inner_product_##arch(&d[o], &s[index],				\
+				&data->filter[phase * stride],			\
+				n_taps);					\
+		INC(index, phase, n_phases);					\
+	}
+
 #define MAKE_RESAMPLER_FULL(arch)						\
 DEFINE_RESAMPLER(full,arch)							\
 {										\
@@ -99,48 +110,148 @@ DEFINE_RESAMPLER(full,arch)							\
 		float *d = dst[c];						\
 										\
 		index = ioffs;							\
+		phase = (uint32_t)data->phase;					\
+		RESAMPLE_FULL_LOOP(arch);					\
+	}									\
+	*in_len = index;							\
+	*out_len = o;								\
+	data->phase = phase;							\
+}
+
+/* Like MAKE_RESAMPLER_FULL but runs blocks of 4 channels through
+ * inner_product4_##arch so that each filter phase is loaded once for
+ * the 4 channels. Remaining channels use inner_product_##arch. */
+#define MAKE_RESAMPLER_FULL_BLOCK(arch)						\
+DEFINE_RESAMPLER(full,arch)							\
+{										\
+	struct native_data *data = r->data;					\
+	uint32_t n_taps = data->n_taps, stride = data->filter_stride_os;	\
+	uint32_t index = ioffs, phase = (uint32_t)data->phase;			\
+	uint32_t c, o = ooffs, olen = *out_len, ilen = *in_len;			\
+	uint32_t n_phases = data->out_rate;					\
+	uint32_t inc = data->inc, frac = data->frac;				\
+										\
+	if (r->channels == 0)							\
+		return;								\
+										\
+	for (c = 0; c + 4 <= r->channels; c += 4) {				\
+		const float *s[4] = { src[c], src[c+1], src[c+2], src[c+3] };	\
+		float *d[4] = { dst[c], dst[c+1], dst[c+2], dst[c+3] };		\
+										\
+		index = ioffs;							\
 		phase = (uint32_t)data->phase;					\
 										\
 		for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {	\
-			inner_product_##arch(&d[o], &s[index],			\
+			inner_product4_##arch(d, o, s, index,			\
 					&data->filter[phase * stride],		\
 					n_taps);				\
 			INC(index, phase, n_phases);				\
 		}								\
 	}									\
+	for (; c < r->channels; c++) {						\
+		const float *s = src[c];					\
+		float *d = dst[c];						\
+										\
+		index = ioffs;							\
+		phase = (uint32_t)data->phase;					\
+		RESAMPLE_FULL_LOOP(arch);					\
+	}									\
 	*in_len = index;							\
 	*out_len = o;								\
 	data->phase = phase;							\
 }
 
+#define RESAMPLE_INTER_LOOP(arch)						\
+	for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {		\
+		float ph = phase * n_phases / out_rate;				\
+		uint32_t offset = (uint32_t)floorf(ph);				\
+		inner_product_ip_##arch(&d[o], &s[index],			\
+				&data->filter[(offset + 0) * stride],		\
+				&data->filter[(offset + 1) * stride],		\
+				ph - offset, n_taps);				\
+		INC(index, phase, out_rate);					\
+	}
+
+/* the taps between two filter phases, interpolated once for each output
+ * sample and shared by all channels */
+#define INTERPOLATE_TAPS(arch)							\
+	float ph = phase * n_phases / out_rate;					\
+	uint32_t offset = (uint32_t)floorf(ph);					\
+	interpolate_taps_##arch(taps, &data->filter[(offset + 0) * stride],	\
+			&data->filter[(offset + 1) * stride],			\
+			ph - offset, n_taps);
+
+/* With more than one channel, the interpolated taps are computed once for
+ * each output sample and then the same inner product as the full resampler
+ * is used for all channels, instead of two inner products per channel. */
 #define MAKE_RESAMPLER_INTER(arch)						\
 DEFINE_RESAMPLER(inter,arch)							\
 {										\
 	struct native_data *data = r->data;					\
-	uint32_t index, stride = data->filter_stride;				\
+	uint32_t index = ioffs, stride = data->filter_stride;			\
 	uint32_t n_phases = data->n_phases, out_rate = data->out_rate;		\
 	uint32_t n_taps = data->n_taps;						\
-	uint32_t c, o, olen = *out_len, ilen = *in_len;				\
+	uint32_t c, o = ooffs, olen = *out_len, ilen = *in_len;			\
 	uint32_t inc = data->inc, frac = data->frac;				\
-	float phase;								\
+	float phase = data->phase, *taps = data->inter_taps;			\
 										\
 	if (r->channels == 0)							\
 		return;								\
 										\
-	for (c = 0; c < r->channels; c++) {					\
-		const float *s = src[c];					\
-		float *d = dst[c];						\
+	if (r->channels == 1) {							\
+		const float *s = src[0];					\
+		float *d = dst[0];						\
+		RESAMPLE_INTER_LOOP(arch);					\
+	} else {								\
+		for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {	\
+			INTERPOLATE_TAPS(arch);					\
+			for (c = 0; c < r->channels; c++) {			\
+				const float *s = src[c];			\
+				float *d = dst[c];				\
+				inner_product_##arch(&d[o], &s[index],		\
+						taps, n_taps);			\
+			}							\
+			INC(index, phase, out_rate);				\
+		}								\
+	}									\
+	*in_len = index;							\
+	*out_len = o;								\
+	data->phase = phase;							\
+}
+
+/* Like MAKE_RESAMPLER_INTER but runs blocks of 4 channels through
+ * inner_product4_##arch. */
+#define MAKE_RESAMPLER_INTER_BLOCK(arch)					\
+DEFINE_RESAMPLER(inter,arch)							\
+{										\
+	struct native_data *data = r->data;					\
+	uint32_t index = ioffs, stride = data->filter_stride;			\
+	uint32_t n_phases = data->n_phases, out_rate = data->out_rate;		\
+	uint32_t n_taps = data->n_taps;						\
+	uint32_t c, o = ooffs, olen = *out_len, ilen = *in_len;			\
+	uint32_t inc = data->inc, frac = data->frac;				\
+	float phase = data->phase, *taps = data->inter_taps;			\
 										\
-		index = ioffs;							\
-		phase = data->phase;						\
+	if (r->channels == 0)							\
+		return;								\
 										\
+	if (r->channels == 1) {							\
+		const float *s = src[0];					\
+		float *d = dst[0];						\
+		RESAMPLE_INTER_LOOP(arch);					\
+	} else {								\
 		for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {	\
-			float ph = phase * n_phases / out_rate;			\
-			uint32_t offset = (uint32_t)floorf(ph);			\
-			inner_product_ip_##arch(&d[o], &s[index],		\
-					&data->filter[(offset + 0) * stride],	\
-					&data->filter[(offset + 1) * stride],	\
-					ph - offset, n_taps);			\
+			INTERPOLATE_TAPS(arch);					\
+			for (c = 0; c + 4 <= r->channels; c += 4)		\
+				inner_product4_##arch((float **)&dst[c], o,	\
+						(const float **)&src[c], index,	\
+						taps, n_taps);			\
+			for (; c < r->channels; c++) {				\
+				const float *s = src[c];			\
+				float *d = dst[c];				\
+				inner_product_##arch(&d[o], &s[index],		\
+						taps, n_taps);			\
+			}							\
 			INC(index, phase, out_rate);				\
 		}								\
 	}									\
@@ -170,3 +281,7 @@ DEFINE_RESAMPLER(inter,ssse3);
 DEFINE_RESAMPLER(full,avx);
 DEFINE_RESAMPLER(inter,avx);
 #endif
+#if defined (HAVE_AVX512) && defined(HAVE_FMA)
+DEFINE_RESAMPLER(full,avx512);
+DEFINE_RESAMPLER(inter,avx512);
+#endif
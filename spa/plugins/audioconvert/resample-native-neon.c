@@ -194,5 +194,19 @@ static inline void inner_product_ip_neon(float *d, const float * SPA_RESTRICT s,
 #endif
 }
 
+static inline void interpolate_taps_neon(float * SPA_RESTRICT taps,
+		const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1,
+		float x, uint32_t n_taps)
+{
+	float32x4_t a, b;
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 4) {
+		a = vld1q_f32(t0 + i);
+		b = vld1q_f32(t1 + i);
+		vst1q_f32(taps + i, vmlaq_n_f32(a, vsubq_f32(b, a), x));
+	}
+}
+
 MAKE_RESAMPLER_FULL(neon);
 MAKE_RESAMPLER_INTER(neon);
@@ -70,5 +70,52 @@ static inline void inner_product_ip_sse(float *d, const float * SPA_RESTRICT s,
 	_mm_store_ss(d, sum[0]);
 }
 
-MAKE_RESAMPLER_FULL(sse);
-MAKE_RESAMPLER_INTER(sse);
+static inline void store4_sse(float **d, uint32_t o, __m128 sum[4])
+{
+	float r[4] SPA_ALIGNED(16);
+
+	_MM_TRANSPOSE4_PS(sum[0], sum[1], sum[2], sum[3]);
+	sum[0] = _mm_add_ps(_mm_add_ps(sum[0], sum[1]), _mm_add_ps(sum[2], sum[3]));
+	_mm_store_ps(r, sum[0]);
+	d[0][o] = r[0];
+	d[1][o] = r[1];
+	d[2][o] = r[2];
+	d[3][o] = r[3];
+}
+
+static inline void inner_product4_sse(float **d, uint32_t o,
+		const float **s, uint32_t index,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	const float *s0 = &s[0][index], *s1 = &s[1][index];
+	const float *s2 = &s[2][index], *s3 = &s[3][index];
+	__m128 sum[4] = { _mm_setzero_ps(), _mm_setzero_ps(),
+		_mm_setzero_ps(), _mm_setzero_ps() }, t;
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 4) {
+		t = _mm_load_ps(taps + i);
+		sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(_mm_loadu_ps(s0 + i), t));
+		sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(_mm_loadu_ps(s1 + i), t));
+		sum[2] = _mm_add_ps(sum[2], _mm_mul_ps(_mm_loadu_ps(s2 + i), t));
+		sum[3] = _mm_add_ps(sum[3], _mm_mul_ps(_mm_loadu_ps(s3 + i), t));
+	}
+	store4_sse(d, o, sum);
+}
+
+static inline void interpolate_taps_sse(float * SPA_RESTRICT taps,
+		const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1,
+		float x, uint32_t n_taps)
+{
+	__m128 a, b, vx = _mm_set1_ps(x);
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 4) {
+		a = _mm_load_ps(t0 + i);
+		b = _mm_load_ps(t1 + i);
+		_mm_store_ps(taps + i, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(b, a), vx), a));
+	}
+}
+
+MAKE_RESAMPLER_FULL_BLOCK(sse);
+MAKE_RESAMPLER_INTER_BLOCK(sse);
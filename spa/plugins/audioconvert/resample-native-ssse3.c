@@ -91,5 +91,19 @@ static inline void inner_product_ip_ssse3(float *d, const float * SPA_RESTRICT s
 	*d = (sum[1] - sum[0]) * x + sum[0];
 }
 
+static inline void interpolate_taps_ssse3(float * SPA_RESTRICT taps,
+		const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1,
+		float x, uint32_t n_taps)
+{
+	__m128 a, b, vx = _mm_set1_ps(x);
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 4) {
+		a = _mm_load_ps(t0 + i);
+		b = _mm_load_ps(t1 + i);
+		_mm_store_ps(taps + i, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(b, a), vx), a));
+	}
+}
+
 MAKE_RESAMPLER_FULL(ssse3);
 MAKE_RESAMPLER_INTER(ssse3);
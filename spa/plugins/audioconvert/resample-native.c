@@ -3,10 +3,14 @@
 /* SPDX-License-Identifier: MIT */
 
 #include <errno.h>
+#include <pthread.h>
 
 #include <spa/param/audio/format.h>
+#include <spa/utils/list.h>
+#include <spa/utils/string.h>
 
 #include "resample-native-impl.h"
+#include "calibrate.h"
 
 struct quality {
 	uint32_t n_taps;
@@ -79,6 +83,121 @@ static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t
 	return 0;
 }
 
+struct cpx {
+	double re;
+	double im;
+};
+
+static void fft(struct cpx *x, uint32_t n, bool inverse)
+{
+	uint32_t i, j, k, len;
+
+	for (i = 1, j = 0; i < n; i++) {
+		uint32_t bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			SPA_SWAP(x[i], x[j]);
+	}
+	for (len = 2; len <= n; len <<= 1) {
+		double a = (inverse ? 2.0 : -2.0) * M_PI / len;
+		struct cpx w = { cos(a), sin(a) };
+
+		for (i = 0; i < n; i += len) {
+			struct cpx u = { 1.0, 0.0 };
+			for (k = 0; k < len / 2; k++) {
+				struct cpx *p = &x[i + k], *q = &x[i + k + len / 2];
+				struct cpx t = {
+					q->re * u.re - q->im * u.im,
+					q->re * u.im + q->im * u.re };
+				double r;
+
+				q->re = p->re - t.re;
+				q->im = p->im - t.im;
+				p->re += t.re;
+				p->im += t.im;
+
+				r = u.re * w.re - u.im * w.im;
+				u.im = u.re * w.im + u.im * w.re;
+				u.re = r;
+			}
+		}
+	}
+	if (inverse) {
+		for (i = 0; i < n; i++) {
+			x[i].re /= n;
+			x[i].im /= n;
+		}
+	}
+}
+
+#define MAX_MIN_PHASE_FFT	(1u << 22)
+
+/* Build the minimum phase version of the filter from build_filter() with
+ * the real cepstrum method. The magnitude response is the same but most of
+ * the energy is in the newest taps, which lowers the delay to the group
+ * delay at DC, returned in delay in input samples. */
+static int build_filter_min_phase(float *taps, uint32_t stride, uint32_t n_taps,
+		uint32_t n_phases, double cutoff, double *delay)
+{
+	uint32_t i, k, m, n_fft, len = n_taps * n_phases;
+	double sum = 0.0, msum = 0.0;
+	struct cpx *x;
+
+	for (n_fft = 1; n_fft < 2 * (len + 1); n_fft <<= 1);
+	if (n_fft > MAX_MIN_PHASE_FFT)
+		return -E2BIG;
+
+	if ((x = calloc(n_fft, sizeof(struct cpx))) == NULL)
+		return -errno;
+
+	/* the linear phase prototype, all phases interleaved */
+	for (m = 0; m <= len; m++) {
+		double t = fabs((double)m - len / 2.0) / n_phases;
+		x[m].re = cutoff * sinc(t * cutoff) * window(t, n_taps);
+	}
+	fft(x, n_fft, false);
+	for (i = 0; i < n_fft; i++) {
+		x[i].re = log(fmax(hypot(x[i].re, x[i].im), 1e-15));
+		x[i].im = 0.0;
+	}
+	fft(x, n_fft, true);
+
+	/* fold the cepstrum to make it causal */
+	for (i = 1; i < n_fft / 2; i++)
+		x[i].re *= 2.0;
+	for (i = n_fft / 2 + 1; i < n_fft; i++)
+		x[i].re = 0.0;
+	for (i = 0; i < n_fft; i++)
+		x[i].im = 0.0;
+
+	fft(x, n_fft, false);
+	for (i = 0; i < n_fft; i++) {
+		double e = exp(x[i].re);
+		x[i].re = e * cos(x[i].im);
+		x[i].im = e * sin(x[i].im);
+	}
+	fft(x, n_fft, true);
+
+	for (m = 0; m <= len; m++) {
+		sum += x[m].re;
+		msum += m * x[m].re;
+	}
+	*delay = msum / sum / n_phases;
+
+	/* the taps are applied to the oldest sample first, so reverse the
+	 * impulse response */
+	for (i = 0; i <= n_phases; i++) {
+		for (k = 0; k < n_taps; k++) {
+			m = k * n_phases + n_phases - i;
+			taps[i * stride + k] = (float)x[len - m].re;
+		}
+	}
+	free(x);
+	return 0;
+}
+
 MAKE_RESAMPLER_COPY(c);
 
 #define MAKE(fmt,copy,full,inter,...) \
@@ -90,6 +209,9 @@ static struct resample_info resample_table[] =
 #if defined (HAVE_NEON)
 	MAKE(F32, copy_c, full_neon, inter_neon, SPA_CPU_FLAG_NEON),
 #endif
+#if defined(HAVE_AVX512) && defined(HAVE_FMA)
+	MAKE(F32, copy_c, full_avx512, inter_avx512, SPA_CPU_FLAG_AVX512 | SPA_CPU_FLAG_FMA3),
+#endif
 #if defined(HAVE_AVX) && defined(HAVE_FMA)
 	MAKE(F32, copy_c, full_avx, inter_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
 #endif
@@ -104,6 +226,85 @@ static struct resample_info resample_table[] =
 #undef MAKE
 
 #define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+/* filters only depend on the rates, quality and the resulting number of
+ * taps and phases, share them between all resamplers in the process. */
+struct resample_filter {
+	struct spa_list link;
+	int ref;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	int quality;
+	bool min_phase;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	uint32_t stride;
+	uint32_t delay;
+	bool is_min_phase;
+	float *taps;
+};
+
+static struct spa_list filter_cache = SPA_LIST_INIT(&filter_cache);
+static pthread_mutex_t filter_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct resample_filter *filter_ref(uint32_t in_rate, uint32_t out_rate,
+		int quality, bool min_phase, uint32_t n_taps, uint32_t n_phases,
+		uint32_t stride, double cutoff)
+{
+	struct resample_filter *f;
+	size_t filter_size = (size_t)stride * sizeof(float) * (n_phases + 1);
+
+	pthread_mutex_lock(&filter_cache_lock);
+	spa_list_for_each(f, &filter_cache, link) {
+		if (f->in_rate == in_rate && f->out_rate == out_rate &&
+		    f->quality == quality && f->min_phase == min_phase &&
+		    f->n_taps == n_taps &&
+		    f->n_phases == n_phases && f->stride == stride) {
+			f->ref++;
+			goto done;
+		}
+	}
+	f = calloc(1, sizeof(*f) + filter_size + 64);
+	if (f == NULL)
+		goto done;
+
+	f->ref = 1;
+	f->in_rate = in_rate;
+	f->out_rate = out_rate;
+	f->quality = quality;
+	f->min_phase = min_phase;
+	f->n_taps = n_taps;
+	f->n_phases = n_phases;
+	f->stride = stride;
+	f->taps = SPA_PTROFF_ALIGN(f, sizeof(*f), 64, float);
+	f->delay = n_taps / 2;
+
+	if (min_phase) {
+		double delay = 0.0;
+		/* fall back to linear phase when the filter is too long */
+		if (build_filter_min_phase(f->taps, stride, n_taps, n_phases,
+					cutoff, &delay) == 0) {
+			f->delay = SPA_CLAMP((uint32_t)lround(delay), 1u, n_taps / 2);
+			f->is_min_phase = true;
+		}
+	}
+	if (!f->is_min_phase)
+		build_filter(f->taps, stride, n_taps, n_phases, cutoff);
+	spa_list_append(&filter_cache, &f->link);
+done:
+	pthread_mutex_unlock(&filter_cache_lock);
+	return f;
+}
+
+static void filter_unref(struct resample_filter *f)
+{
+	pthread_mutex_lock(&filter_cache_lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		free(f);
+	}
+	pthread_mutex_unlock(&filter_cache_lock);
+}
+
 static const struct resample_info *find_resample_info(uint32_t format, uint32_t cpu_flags)
 {
 	SPA_FOR_EACH_ELEMENT_VAR(resample_table, t) {
@@ -114,9 +315,83 @@ static const struct resample_info *find_resample_info(uint32_t format, uint32_t
 	return NULL;
 }
 
+#define MAX_CANDIDATES	8
+
+struct resample_calibrate {
+	struct resample *r;
+	const struct resample_info *info[MAX_CANDIDATES];
+	const void **src;
+	void **dst;
+	uint32_t in_len;
+};
+
+static void run_resample_info(void *data, uint32_t index)
+{
+	struct resample_calibrate *c = data;
+	uint32_t in_len = c->in_len, out_len = CALIBRATE_SAMPLES;
+	c->info[index]->process_full(c->r, c->src, 0, &in_len, c->dst, 0, &out_len);
+}
+
+/* time the full resamplers that the cpu supports and return the fastest
+ * one. The copy and interpolating variants follow the same choice. */
+static const struct resample_info *calibrate_resample_info(struct resample *r)
+{
+	struct native_data *d = r->data;
+	const struct resample_info *info = d->info;
+	struct resample_calibrate c;
+	struct calibrate_candidate candidates[MAX_CANDIDATES];
+	uint32_t n_candidates = 0, ch;
+	char key[64];
+	float *mem;
+
+	if (d->in_rate == d->out_rate || r->channels == 0)
+		return info;
+
+	SPA_FOR_EACH_ELEMENT_VAR(resample_table, t) {
+		if (t->format != SPA_AUDIO_FORMAT_F32 ||
+		    !MATCH_CPU_FLAGS(t->cpu_flags, r->cpu_flags) ||
+		    n_candidates == MAX_CANDIDATES)
+			continue;
+		c.info[n_candidates] = t;
+		candidates[n_candidates++] = (struct calibrate_candidate) {
+			.name = t->full_name,
+			.cpu_flags = t->cpu_flags,
+		};
+	}
+	if (n_candidates < 2)
+		return info;
+
+	/* enough input for the filter and CALIBRATE_SAMPLES of output for
+	 * the fastest ratio we support */
+	c.in_len = d->n_taps + CALIBRATE_SAMPLES * (d->inc + 1);
+	mem = calloc(r->channels * (c.in_len + CALIBRATE_SAMPLES), sizeof(float));
+	c.src = calloc(2 * r->channels, sizeof(void*));
+	if (mem == NULL || c.src == NULL)
+		goto exit;
+
+	c.r = r;
+	c.dst = (void**)&c.src[r->channels];
+	for (ch = 0; ch < r->channels; ch++) {
+		c.src[ch] = &mem[ch * c.in_len];
+		c.dst[ch] = &mem[r->channels * c.in_len + ch * CALIBRATE_SAMPLES];
+	}
+
+	spa_scnprintf(key, sizeof(key), "resample-%u-%u", d->n_taps, r->channels);
+	info = c.info[calibrate_select(r->log, key, candidates, n_candidates,
+				run_resample_info, &c)];
+exit:
+	free(c.src);
+	free(mem);
+	return info;
+}
+
 static void impl_native_free(struct resample *r)
 {
+	struct native_data *d = r->data;
+
 	spa_log_debug(r->log, "native %p: free", r);
+	if (d && d->filter_cache)
+		filter_unref(d->filter_cache);
 	free(r->data);
 	r->data = NULL;
 }
@@ -302,14 +577,14 @@ static void impl_native_reset (struct resample *r)
 	if (r->options & RESAMPLE_OPTION_PREFILL)
 		d->hist = d->n_taps - 1;
 	else
-		d->hist = (d->n_taps / 2) - 1;
+		d->hist = d->n_taps - d->delay - 1;
 	d->phase = 0;
 }
 
 static uint32_t impl_native_delay (struct resample *r)
 {
 	struct native_data *d = r->data;
-	return d->n_taps / 2;
+	return d->delay;
 }
 
 int resample_native_init(struct resample *r)
@@ -317,7 +592,7 @@ int resample_native_init(struct resample *r)
 	struct native_data *d;
 	const struct quality *q;
 	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
+	uint32_t c, n_taps, n_phases, in_rate, out_rate, gcd, filter_stride;
 	uint32_t history_stride, history_size, oversample;
 
 	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(window_qualities) - 1);
@@ -349,13 +624,12 @@ int resample_native_init(struct resample *r)
 	n_phases *= oversample;
 
 	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
 	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
 
 	d = calloc(1, sizeof(struct native_data) +
-			filter_size +
 			history_size +
+			filter_stride +
 			(r->channels * sizeof(float*)) +
 			64);
 
@@ -367,15 +641,25 @@ int resample_native_init(struct resample *r)
 	d->n_phases = n_phases;
 	d->in_rate = in_rate;
 	d->out_rate = out_rate;
-	d->filter = SPA_PTROFF_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_PTROFF_ALIGN(d->filter, filter_size, 64, float);
-	d->history = SPA_PTROFF(d->hist_mem, history_size, float*);
+	d->hist_mem = SPA_PTROFF_ALIGN(d, sizeof(struct native_data), 64, float);
+	d->inter_taps = SPA_PTROFF(d->hist_mem, history_size, float);
+	d->history = SPA_PTROFF(d->inter_taps, filter_stride, float*);
 	d->filter_stride = filter_stride / sizeof(float);
 	d->filter_stride_os = d->filter_stride * oversample;
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_PTROFF(d->hist_mem, c * history_stride, float);
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
+	d->filter_cache = filter_ref(in_rate, out_rate, r->quality,
+			SPA_FLAG_IS_SET(r->options, RESAMPLE_OPTION_MINIMUM_PHASE),
+			n_taps, n_phases, d->filter_stride, scale);
+	if (SPA_UNLIKELY(d->filter_cache == NULL))
+		return -errno;
+	d->filter = d->filter_cache->taps;
+	d->delay = d->filter_cache->delay;
+
+	if (SPA_FLAG_IS_SET(r->options, RESAMPLE_OPTION_MINIMUM_PHASE) &&
+	    !d->filter_cache->is_min_phase)
+		spa_log_warn(r->log, "native %p: filter too long for minimum phase, using linear phase", r);
 
 	d->info = find_resample_info(SPA_AUDIO_FORMAT_F32, r->cpu_flags);
 	if (SPA_UNLIKELY(d->info == NULL)) {
@@ -383,14 +667,22 @@ int resample_native_init(struct resample *r)
 	    return -ENOTSUP;
 	}
 
-	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d gcd:%d n_taps:%d n_phases:%d features:%08x:%08x",
-			r, r->quality, r->i_rate, r->o_rate, gcd, n_taps, n_phases,
+	impl_native_reset(r);
+	impl_native_update_rate(r, 1.0);
+
+	if (SPA_FLAG_IS_SET(r->options, RESAMPLE_OPTION_CALIBRATE)) {
+		d->info = calibrate_resample_info(r);
+		/* the test runs moved the phase, start again */
+		d->rate = 0.0;
+		impl_native_reset(r);
+		impl_native_update_rate(r, 1.0);
+	}
+
+	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d gcd:%d n_taps:%d n_phases:%d delay:%d features:%08x:%08x",
+			r, r->quality, r->i_rate, r->o_rate, gcd, n_taps, n_phases, d->delay,
 			r->cpu_flags, d->info->cpu_flags);
 
 	r->cpu_flags = d->info->cpu_flags;
 
-	impl_native_reset(r);
-	impl_native_update_rate(r, 1.0);
-
 	return 0;
 }
@@ -13,6 +13,8 @@
 struct resample {
 	struct spa_log *log;
 #define RESAMPLE_OPTION_PREFILL		(1<<0)
+#define RESAMPLE_OPTION_MINIMUM_PHASE	(1<<1)
+#define RESAMPLE_OPTION_CALIBRATE	(1<<2)	/**< time the candidate kernels */
 	uint32_t options;
 	uint32_t cpu_flags;
 	const char *func_name;
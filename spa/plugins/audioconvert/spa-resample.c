@@ -9,11 +9,14 @@
 #include <errno.h>
 #include <time.h>
 #include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include <spa/support/log-impl.h>
 #include <spa/debug/mem.h>
 #include <spa/utils/string.h>
 #include <spa/utils/result.h>
+#include <spa/utils/atomic.h>
 
 #include <sndfile.h>
 
@@ -24,6 +27,7 @@ SPA_LOG_IMPL(logger);
 #define DEFAULT_QUALITY	RESAMPLE_DEFAULT_QUALITY
 
 #define MAX_SAMPLES	4096u
+#define MAX_JOBS	64
 
 struct data {
 	bool verbose;
@@ -31,6 +35,7 @@ struct data {
 	int format;
 	int quality;
 	int cpu_flags;
+	bool min_phase;
 
 	const char *iname;
 	SF_INFO iinfo;
@@ -39,11 +44,32 @@ struct data {
 	const char *oname;
 	SF_INFO oinfo;
 	SNDFILE *ofile;
+
+	size_t read;
+	size_t written;
+};
+
+/* files are handed out to the jobs one by one */
+struct batch {
+	const struct data *defaults;
+	const char *outdir;
+	char **files;
+	int n_files;
+	int next;
+};
+
+struct job {
+	struct batch *batch;
+	pthread_t thread;
+	uint64_t frames;
+	double duration;
+	int n_files;
+	int errors;
 };
 
 #define STR_FMTS "(s8|s16|s32|f32|f64)"
 
-#define OPTIONS		"hvr:f:q:c:"
+#define OPTIONS		"hvr:f:q:c:pj:o:"
 static const struct option long_options[] = {
 	{ "help",	no_argument,		NULL, 'h'},
 	{ "verbose",	no_argument,		NULL, 'v'},
@@ -52,6 +78,9 @@ static const struct option long_options[] = {
 	{ "format",	required_argument,	NULL, 'f' },
 	{ "quality",	required_argument,	NULL, 'q' },
 	{ "cpuflags",	required_argument,	NULL, 'c' },
+	{ "minimum-phase", no_argument,		NULL, 'p' },
+	{ "jobs",	required_argument,	NULL, 'j' },
+	{ "output-dir",	required_argument,	NULL, 'o' },
 
         { NULL, 0, NULL, 0 }
 };
@@ -63,6 +92,7 @@ static void show_usage(const char *name, bool is_error)
 	fp = is_error ? stderr : stdout;
 
 	fprintf(fp, "%s [options] <infile> <outfile>\n", name);
+	fprintf(fp, "%s [options] -o <outdir> <infile>...\n", name);
 	fprintf(fp,
 		"  -h, --help                            Show this help\n"
 		"  -v  --verbose                         Be verbose\n"
@@ -72,6 +102,10 @@ static void show_usage(const char *name, bool is_error)
 		"  -f  --format                          Output sample format %s (default as input)\n"
 		"  -q  --quality                         Resampler quality (default %u)\n"
 		"  -c  --cpuflags                        CPU flags (default 0)\n"
+		"  -p  --minimum-phase                   Use a minimum phase filter (lower delay)\n"
+		"  -o  --output-dir                      Convert all infiles into this directory\n"
+		"  -j  --jobs                            Number of files to convert in parallel\n"
+		"                                        with --output-dir (default 1)\n"
 		"\n",
 		STR_FMTS, DEFAULT_QUALITY);
 }
@@ -181,6 +215,8 @@ static int do_conversion(struct data *d)
 	r.i_rate = d->iinfo.samplerate;
 	r.o_rate = d->oinfo.samplerate;
 	r.quality = d->quality < 0 ? DEFAULT_QUALITY : d->quality;
+	if (d->min_phase)
+		r.options |= RESAMPLE_OPTION_MINIMUM_PHASE;
 	if ((res = resample_native_init(&r)) < 0) {
 		fprintf(stderr, "can't init converter: %s\n", spa_strerror(res));
 		return res;
@@ -245,13 +281,109 @@ static int do_conversion(struct data *d)
 	if (d->verbose)
 		fprintf(stdout, "read %zu samples, wrote %zu samples\n", read, written);
 
+	d->read = read;
+	d->written = written;
+
 	return 0;
 }
 
+static void *job_thread(void *userdata)
+{
+	struct job *j = userdata;
+	struct batch *b = j->batch;
+	char oname[PATH_MAX];
+	const char *base;
+	int idx;
+
+	while ((idx = SPA_ATOMIC_INC(b->next) - 1) < b->n_files) {
+		struct data d = *b->defaults;
+
+		d.iname = b->files[idx];
+		base = strrchr(d.iname, '/');
+		base = base ? base + 1 : d.iname;
+		if (spa_scnprintf(oname, sizeof(oname), "%s/%s", b->outdir, base) >=
+				(int)sizeof(oname) - 1) {
+			fprintf(stderr, "error: output name for \"%s\" too long\n", d.iname);
+			j->errors++;
+			continue;
+		}
+		d.oname = oname;
+
+		if (open_files(&d) < 0 || do_conversion(&d) < 0) {
+			j->errors++;
+		} else {
+			j->frames += d.read;
+			j->duration += (double)d.read / d.iinfo.samplerate;
+			j->n_files++;
+		}
+		close_files(&d);
+	}
+	return NULL;
+}
+
+static int do_batch(struct data *d, const char *outdir, int n_jobs, char **files, int n_files)
+{
+	struct batch b;
+	struct job jobs[MAX_JOBS];
+	struct timespec ts;
+	uint64_t t1, t2, frames = 0;
+	double duration = 0.0, elapsed;
+	int i, res, converted = 0, errors = 0;
+
+	spa_zero(b);
+	b.defaults = d;
+	b.outdir = outdir;
+	b.files = files;
+	b.n_files = n_files;
+
+	n_jobs = SPA_CLAMP(n_jobs, 1, SPA_MIN(n_files, MAX_JOBS));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < n_jobs; i++) {
+		spa_zero(jobs[i]);
+		jobs[i].batch = &b;
+		if ((res = pthread_create(&jobs[i].thread, NULL, job_thread, &jobs[i])) != 0) {
+			fprintf(stderr, "error: can't create job: %s\n", strerror(res));
+			break;
+		}
+	}
+	n_jobs = i;
+	/* no threads at all, convert from here */
+	if (n_jobs == 0) {
+		jobs[n_jobs++].batch = &b;
+		job_thread(&jobs[0]);
+	} else {
+		for (i = 0; i < n_jobs; i++)
+			pthread_join(jobs[i].thread, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < n_jobs; i++) {
+		frames += jobs[i].frames;
+		duration += jobs[i].duration;
+		converted += jobs[i].n_files;
+		errors += jobs[i].errors;
+	}
+	elapsed = (t2 - t1) / (double)SPA_NSEC_PER_SEC;
+
+	fprintf(stdout, "converted %d files (%d errors) with %d jobs in %.3f seconds\n",
+			converted, errors, n_jobs, elapsed);
+	if (elapsed > 0.0)
+		fprintf(stdout, "%.1f files/sec %.0f frames/sec %.1fx realtime\n",
+				converted / elapsed, frames / elapsed, duration / elapsed);
+
+	return errors > 0 ? -EIO : 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int c;
-	int longopt_index = 0, ret;
+	int longopt_index = 0, ret, n_jobs = 1;
+	const char *outdir = NULL;
 	struct data data;
 
 	spa_zero(data);
@@ -294,11 +426,33 @@ int main(int argc, char *argv[])
 		case 'c':
 			data.cpu_flags = strtol(optarg, NULL, 0);
 			break;
+		case 'p':
+			data.min_phase = true;
+			break;
+		case 'j':
+			n_jobs = atoi(optarg);
+			if (n_jobs <= 0) {
+				fprintf(stderr, "error: bad number of jobs %s\n", optarg);
+				goto error_usage;
+			}
+			break;
+		case 'o':
+			outdir = optarg;
+			break;
                 default:
 			fprintf(stderr, "error: unknown option '%c'\n", c);
 			goto error_usage;
 		}
 	}
+	if (outdir != NULL) {
+		if (optind >= argc) {
+			fprintf(stderr, "error: filename arguments missing\n");
+			goto error_usage;
+		}
+		ret = do_batch(&data, outdir, n_jobs, &argv[optind], argc - optind);
+		return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
 	if (optind + 1 >= argc) {
                 fprintf(stderr, "error: filename arguments missing (%d %d)\n", optind, argc);
 		goto error_usage;
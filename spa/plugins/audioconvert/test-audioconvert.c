@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 
 #include <spa/utils/names.h>
 #include <spa/utils/string.h>
@@ -569,14 +570,18 @@ struct data {
 	uint32_t planes;
 	const void *data[MAX_PORTS];
 	uint32_t size;
+	uint32_t data_flags;
+	uint32_t chunk_flags;
 };
 
+/* returns the number of output planes that point to the input memory */
 static int run_convert(struct context *ctx, struct data *in_data,
 		struct data *out_data)
 {
 	struct spa_command cmd;
-	int res;
+	int res, n_zero_copy = 0;
 	uint32_t i, j, k;
+	void *out_mem[out_data->ports][MAX_PORTS];
 	struct buffer in_buffers[in_data->ports];
 	struct buffer out_buffers[out_data->ports];
 	struct spa_io_buffers in_io[in_data->ports];
@@ -607,6 +612,7 @@ static int run_convert(struct context *ctx, struct data *in_data,
 			b->datas[j].chunk->offset = 0;
 			b->datas[j].chunk->size = in_data->size;
 			b->datas[j].chunk->stride = 0;
+			b->datas[j].chunk->flags = in_data->chunk_flags;
 		}
 		buffers[0] = &b->buffer;
 		res = spa_node_port_use_buffers(ctx->convert_node, SPA_DIRECTION_INPUT, i,
@@ -629,11 +635,11 @@ static int run_convert(struct context *ctx, struct data *in_data,
 
 		for (j = 0; j < out_data->planes; j++) {
 			b->datas[j].type = SPA_DATA_MemPtr;
-			b->datas[j].flags = 0;
+			b->datas[j].flags = out_data->data_flags;
 			b->datas[j].fd = -1;
 			b->datas[j].mapoffset = 0;
 			b->datas[j].maxsize = out_data->size;
-			b->datas[j].data = calloc(1, out_data->size);
+			b->datas[j].data = out_mem[i][j] = calloc(1, out_data->size);
 			b->datas[j].chunk = &b->chunks[j];
 			b->datas[j].chunk->offset = 0;
 			b->datas[j].chunk->size = 0;
@@ -675,14 +681,16 @@ static int run_convert(struct context *ctx, struct data *in_data,
 			}
 			spa_assert_se(res == 0);
 
-			free(b->datas[j].data);
+			if (b->datas[j].data != out_mem[i][j])
+				n_zero_copy++;
+			free(out_mem[i][j]);
 		}
 	}
 	cmd = SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Suspend);
 	res = spa_node_send_command(ctx->convert_node, &cmd);
 	spa_assert_se(res == 0);
 
-	return 0;
+	return n_zero_copy;
 }
 
 static const float data_f32p_1[] = { 0.1f, 0.1f, 0.1f, 0.1f };
@@ -1116,6 +1124,169 @@ static int test_convert_remap_conv(struct context *ctx)
 	return 0;
 }
 
+#define N_TILED	2048
+
+static int test_convert_tiled(struct context *ctx)
+{
+	struct data in = conv_f32_48000_6p1, out = dsp_5p1_from_6p1;
+	float *src, *dst[6];
+	uint32_t i, j;
+
+	/* large enough to be processed in more than one tile */
+	src = malloc(N_TILED * 7 * sizeof(float));
+	spa_assert_se(src != NULL);
+	for (i = 0; i < N_TILED; i++)
+		memcpy(&src[i * 7], data_f32_6p1, 7 * sizeof(float));
+	in.data[0] = src;
+	in.size = N_TILED * 7 * sizeof(float);
+
+	for (j = 0; j < 6; j++) {
+		dst[j] = malloc(N_TILED * sizeof(float));
+		spa_assert_se(dst[j] != NULL);
+		for (i = 0; i < N_TILED; i++)
+			dst[j][i] = ((const float *)dsp_5p1_from_6p1.data[j])[0];
+		out.data[j] = dst[j];
+	}
+	out.size = N_TILED * sizeof(float);
+
+	run_convert(ctx, &in, &out);
+
+	free(src);
+	for (j = 0; j < 6; j++)
+		free(dst[j]);
+	return 0;
+}
+
+static void set_io_volumes(struct spa_io_volumes *io, float volume, uint32_t n_volumes)
+{
+	struct spa_io_volumes_values *v = &io->values[(io->seq + 1) & 1];
+	uint32_t i;
+
+	v->flags = 0;
+	v->volume = 1.0f;
+	v->n_volumes = n_volumes;
+	for (i = 0; i < n_volumes; i++)
+		v->volumes[i] = volume;
+	io->seq++;
+}
+
+static int test_convert_io_volumes(struct context *ctx)
+{
+	struct data out = conv_f32_48000_5p1;
+	struct spa_io_volumes io;
+	float dst[SPA_N_ELEMENTS(data_f32_5p1)];
+	uint32_t i;
+	int res;
+
+	spa_zero(io);
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Volumes, &io, sizeof(io) - 1);
+	spa_assert_se(res == -EINVAL);
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Volumes, &io, sizeof(io));
+	spa_assert_se(res == 0);
+
+	/* values are only applied after an update */
+	run_convert(ctx, &dsp_5p1, &conv_f32_48000_5p1);
+
+	set_io_volumes(&io, 0.5f, 6);
+	for (i = 0; i < SPA_N_ELEMENTS(data_f32_5p1); i++)
+		dst[i] = data_f32_5p1[i] * 0.5f;
+	out.data[0] = dst;
+	run_convert(ctx, &dsp_5p1, &out);
+
+	set_io_volumes(&io, 1.0f, 6);
+	run_convert(ctx, &dsp_5p1, &conv_f32_48000_5p1);
+
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Volumes, NULL, 0);
+	spa_assert_se(res == 0);
+	return 0;
+}
+
+static int test_convert_io_meter(struct context *ctx)
+{
+	struct spa_io_meter io;
+	struct spa_io_meter_values *v;
+	uint32_t i;
+	int res;
+
+	spa_zero(io);
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Meter, &io, sizeof(io) - 1);
+	spa_assert_se(res == -EINVAL);
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Meter, &io, sizeof(io));
+	spa_assert_se(res == 0);
+
+	run_convert(ctx, &dsp_5p1, &conv_f32_48000_5p1);
+
+	spa_assert_se(io.seq == 1);
+	v = &io.values[io.seq & 1];
+	spa_assert_se(v->n_samples == 4);
+	spa_assert_se(v->n_channels == 6);
+	for (i = 0; i < 6; i++) {
+		spa_assert_se(fabsf(v->peak[i] - (i + 1) * 0.1f) < 1e-6f);
+		spa_assert_se(fabsf(v->rms[i] - (i + 1) * 0.1f) < 1e-6f);
+	}
+
+	run_convert(ctx, &dsp_5p1, &conv_f32_48000_5p1);
+	spa_assert_se(io.seq == 2);
+
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Meter, NULL, 0);
+	spa_assert_se(res == 0);
+	return 0;
+}
+
+static int test_convert_zero_copy(struct context *ctx)
+{
+	struct data out = conv_f32p_48000_5p1;
+	struct spa_io_volumes io;
+	float dst[6][4];
+	uint32_t i, j;
+	int res;
+
+	/* only dynamic data can be zero-copied */
+	spa_assert_se(run_convert(ctx, &dsp_5p1, &out) == 0);
+
+	out.data_flags = SPA_DATA_FLAG_DYNAMIC;
+	spa_assert_se(run_convert(ctx, &dsp_5p1, &out) == 6);
+
+	/* needs a conversion */
+	spa_assert_se(run_convert(ctx, &dsp_5p1, &conv_f32_48000_5p1) == 0);
+
+	/* volume changes fall back to copying */
+	spa_zero(io);
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Volumes, &io, sizeof(io));
+	spa_assert_se(res == 0);
+	set_io_volumes(&io, 0.5f, 6);
+	for (i = 0; i < 6; i++) {
+		for (j = 0; j < 4; j++)
+			dst[i][j] = ((const float *)dsp_5p1.data[i])[j] * 0.5f;
+		out.data[i] = dst[i];
+	}
+	spa_assert_se(run_convert(ctx, &dsp_5p1, &out) == 0);
+
+	set_io_volumes(&io, 1.0f, 6);
+	spa_assert_se(run_convert(ctx, &dsp_5p1, &conv_f32p_48000_5p1) == 0);
+	res = spa_node_set_io(ctx->convert_node, SPA_IO_Volumes, NULL, 0);
+	spa_assert_se(res == 0);
+
+	return 0;
+}
+
+static int test_convert_silence(struct context *ctx)
+{
+	struct data in = dsp_5p1, out = conv_f32_48000_5p1;
+	float dst[SPA_N_ELEMENTS(data_f32_5p1)];
+
+	/* the input data is not looked at when it is marked empty */
+	spa_zero(dst);
+	in.chunk_flags = SPA_CHUNK_FLAG_EMPTY;
+	out.data[0] = dst;
+	run_convert(ctx, &in, &out);
+
+	in.chunk_flags = 0;
+	run_convert(ctx, &in, &conv_f32_48000_5p1);
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	struct context ctx;
@@ -1139,6 +1310,11 @@ int main(int argc, char *argv[])
 
 	test_convert_remap_dsp(&ctx);
 	test_convert_remap_conv(&ctx);
+	test_convert_tiled(&ctx);
+	test_convert_io_volumes(&ctx);
+	test_convert_io_meter(&ctx);
+	test_convert_zero_copy(&ctx);
+	test_convert_silence(&ctx);
 
 	clean_context(&ctx);
 
@@ -323,6 +323,18 @@ static void run_n_m_impl(struct channelmix *mix, const void **src, uint32_t n_sa
 		check_samples((float**)dst_c, (float**)dst_x, dst_chan, n_samples);
 	}
 #endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		channelmix_f32_n_m_avx2(mix, dst_x, src, n_samples);
+		check_samples((float**)dst_c, (float**)dst_x, dst_chan, n_samples);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		channelmix_f32_n_m_neon(mix, dst_x, src, n_samples);
+		check_samples((float**)dst_c, (float**)dst_x, dst_chan, n_samples);
+	}
+#endif
 }
 
 static void test_n_m_impl(void)
@@ -368,6 +380,77 @@ static void test_n_m_impl(void)
 	run_n_m_impl(&mix, (const void**)src, N_SAMPLES);
 }
 
+static void run_layout_impl(uint32_t src_chan, uint64_t src_mask,
+		uint32_t dst_chan, uint64_t dst_mask, uint32_t upmix, float widen)
+{
+	struct channelmix mix_c, mix_x;
+	uint32_t i, j;
+	float src_data[src_chan][N_SAMPLES], *src[src_chan];
+	float dst_c_data[dst_chan][N_SAMPLES], dst_x_data[dst_chan][N_SAMPLES];
+	void *dst_c[dst_chan], *dst_x[dst_chan];
+
+	for (i = 0; i < src_chan; i++) {
+		for (j = 0; j < N_SAMPLES; j++)
+			src_data[i][j] = (float)((drand48() - 0.5f) * 2.5f);
+		src[i] = src_data[i];
+	}
+	for (i = 0; i < dst_chan; i++) {
+		dst_c[i] = dst_c_data[i];
+		dst_x[i] = dst_x_data[i];
+	}
+
+	spa_zero(mix_c);
+	mix_c.src_chan = src_chan;
+	mix_c.dst_chan = dst_chan;
+	mix_c.src_mask = src_mask;
+	mix_c.dst_mask = dst_mask;
+	mix_c.upmix = upmix;
+	mix_c.widen = widen;
+	mix_c.options = CHANNELMIX_OPTION_UPMIX;
+	mix_c.log = &logger.log;
+	mix_x = mix_c;
+	mix_x.cpu_flags = cpu_flags;
+
+	spa_assert_se(channelmix_init(&mix_c) == 0);
+	channelmix_set_volume(&mix_c, 0.8f, false, 0, NULL);
+	spa_assert_se(channelmix_init(&mix_x) == 0);
+	channelmix_set_volume(&mix_x, 0.8f, false, 0, NULL);
+
+	spa_log_debug(&logger.log, "%s <-> %s", mix_c.func_name, mix_x.func_name);
+
+	/* odd sizes to also exercise the tails */
+	channelmix_process(&mix_c, dst_c, (const void**)src, N_SAMPLES);
+	channelmix_process(&mix_x, dst_x, (const void**)src, N_SAMPLES);
+	check_samples((float**)dst_c, (float**)dst_x, dst_chan, N_SAMPLES);
+
+	channelmix_process(&mix_c, dst_c, (const void**)src, 7);
+	channelmix_process(&mix_x, dst_x, (const void**)src, 7);
+	check_samples((float**)dst_c, (float**)dst_x, dst_chan, 7);
+}
+
+#define _MASK_2		(_M(FL)|_M(FR))
+#define _MASK_3P1	(_M(FL)|_M(FR)|_M(FC)|_M(LFE))
+#define _MASK_4		(_M(FL)|_M(FR)|_M(RL)|_M(RR))
+#define _MASK_5P1	(_M(FL)|_M(FR)|_M(FC)|_M(LFE)|_M(SL)|_M(SR))
+#define _MASK_7P1	(_M(FL)|_M(FR)|_M(FC)|_M(LFE)|_M(SL)|_M(SR)|_M(RL)|_M(RR))
+
+static void test_layout_impl(void)
+{
+	run_layout_impl(2, _MASK_2, 2, _MASK_2, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(2, _MASK_2, 4, _MASK_3P1, CHANNELMIX_UPMIX_SIMPLE, 0.0f);
+	run_layout_impl(2, _MASK_2, 4, _MASK_3P1, CHANNELMIX_UPMIX_SIMPLE, 0.3f);
+	run_layout_impl(2, _MASK_2, 6, _MASK_5P1, CHANNELMIX_UPMIX_SIMPLE, 0.0f);
+	run_layout_impl(2, _MASK_2, 8, _MASK_7P1, CHANNELMIX_UPMIX_SIMPLE, 0.0f);
+	run_layout_impl(4, _MASK_3P1, 2, _MASK_2, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(6, _MASK_5P1, 2, _MASK_2, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(6, _MASK_5P1, 4, _MASK_3P1, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(6, _MASK_5P1, 4, _MASK_4, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(8, _MASK_7P1, 2, _MASK_2, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(8, _MASK_7P1, 4, _MASK_3P1, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(8, _MASK_7P1, 4, _MASK_4, CHANNELMIX_UPMIX_NONE, 0.0f);
+	run_layout_impl(16, 0, 2, _MASK_2, CHANNELMIX_UPMIX_NONE, 0.0f);
+}
+
 int main(int argc, char *argv[])
 {
 	struct timespec ts;
@@ -391,6 +474,7 @@ int main(int argc, char *argv[])
 	test_7p1_N();
 
 	test_n_m_impl();
+	test_layout_impl();
 
 	return 0;
 }
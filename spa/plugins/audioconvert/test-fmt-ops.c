@@ -10,6 +10,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <dirent.h>
+#include <limits.h>
 
 #include <spa/debug/mem.h>
 
@@ -150,6 +152,18 @@ static void test_f32_u8(void)
 			true, false, conv_f32_to_u8d_c);
 	run_test("test_f32d_u8d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_u8d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_u8_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_u8_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_u8_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_u8_avx512);
+	}
+#endif
 }
 
 static void test_u8_f32(void)
@@ -165,6 +179,18 @@ static void test_u8_f32(void)
 			true, false, conv_u8_to_f32d_c);
 	run_test("test_u8d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_u8d_to_f32d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_u8_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_u8_to_f32d_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_u8_f32d_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_u8_to_f32d_avx512);
+	}
+#endif
 }
 
 static void test_f32_u16(void)
@@ -411,6 +437,18 @@ static void test_f32_s24(void)
 			true, false, conv_f32_to_s24d_c);
 	run_test("test_f32d_s24d", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
 			false, false, conv_f32d_to_s24d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s24_avx2", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s24_avx512", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24_avx512);
+	}
+#endif
 }
 
 static void test_s24_f32(void)
@@ -451,6 +489,12 @@ static void test_s24_f32(void)
 			true, false, conv_s24_to_f32d_avx2);
 	}
 #endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s24_f32d_avx512", in, 3, out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_to_f32d_avx512);
+	}
+#endif
 }
 
 static void test_f32_u24_32(void)
@@ -494,6 +538,18 @@ static void test_f32_s24_32(void)
 			true, false, conv_f32_to_s24_32d_c);
 	run_test("test_f32d_s24_32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_s24_32d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s24_32_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s24_32_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s24_32_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s24_32_avx512);
+	}
+#endif
 }
 
 static void test_s24_32_f32(void)
@@ -509,6 +565,18 @@ static void test_s24_32_f32(void)
 			true, true, conv_s24_32_to_f32_c);
 	run_test("test_s24_32d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_s24_32d_to_f32d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s24_32_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_32_to_f32d_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s24_32_f32d_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_32_to_f32d_avx512);
+	}
+#endif
 }
 
 static void test_f64_f32(void)
@@ -524,6 +592,18 @@ static void test_f64_f32(void)
 			true, true, conv_f64_to_f32_c);
 	run_test("test_f64d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f64d_to_f32d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f64_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_f64_to_f32d_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f64_f32d_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_f64_to_f32d_avx512);
+	}
+#endif
 }
 
 static void test_f32_f64(void)
@@ -539,6 +619,70 @@ static void test_f32_f64(void)
 			true, false, conv_f32_to_f64d_c);
 	run_test("test_f32d_f64d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_f64d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_f64_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_f64_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_f64_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_f64_avx512);
+	}
+#endif
+}
+
+static void test_f16_f32(void)
+{
+	static const uint16_t in[] = { 0x0000, 0x3c00, 0xbc00, 0x3800, 0xb800, 0x3c66, 0xbc66,
+		0x0001, 0x8001, 0x0400, 0x7bff, 0x7c00, 0xfc00 };
+	static const float out[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.099609375f, -1.099609375f,
+		0x1p-24f, -0x1p-24f, 0x1p-14f, 65504.0f, INFINITY, -INFINITY };
+
+	run_test("test_f16_f32", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, true, conv_f16_to_f32_c);
+	run_test("test_f16d_f32", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f16d_to_f32_c);
+	run_test("test_f16_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_f16_to_f32d_c);
+	run_test("test_f16d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, false, conv_f16d_to_f32d_c);
+#if defined(HAVE_AVX2) && defined(HAVE_F16C)
+	if ((cpu_flags & SPA_CPU_FLAG_AVX2) && (cpu_flags & SPA_CPU_FLAG_F16C)) {
+		run_test("test_f16_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_f16_to_f32d_avx2);
+		run_test("test_f16d_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, false, conv_f16d_to_f32d_avx2);
+	}
+#endif
+}
+
+static void test_f32_f16(void)
+{
+	static const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f,
+		0x1p-24f, 0x1p-25f, 0x3p-25f, 1.0f + 0x1p-11f, 1.0f + 0x3p-11f,
+		65504.0f, 65520.0f, 1e10f, -1e10f };
+	static const uint16_t out[] = { 0x0000, 0x3c00, 0xbc00, 0x3800, 0xb800, 0x3c66, 0xbc66,
+		0x0001, 0x0000, 0x0002, 0x3c00, 0x3c02,
+		0x7bff, 0x7c00, 0x7c00, 0xfc00 };
+
+	run_test("test_f32_f16", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, true, conv_f32_to_f16_c);
+	run_test("test_f32d_f16", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_f16_c);
+	run_test("test_f32_f16d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_f32_to_f16d_c);
+	run_test("test_f32d_f16d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, false, conv_f32d_to_f16d_c);
+#if defined(HAVE_AVX2) && defined(HAVE_F16C)
+	if ((cpu_flags & SPA_CPU_FLAG_AVX2) && (cpu_flags & SPA_CPU_FLAG_F16C)) {
+		run_test("test_f32d_f16_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_f16_avx2);
+		run_test("test_f32d_f16d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, false, conv_f32d_to_f16d_avx2);
+	}
+#endif
 }
 
 static void test_lossless_s8(void)
@@ -821,12 +965,124 @@ static void test_noise(void)
 	run_test_noise(SPA_AUDIO_FORMAT_U8, 2, 0);
 	run_test_noise(SPA_AUDIO_FORMAT_S16, 1, 0);
 	run_test_noise(SPA_AUDIO_FORMAT_S16, 2, 0);
+	run_test_noise(SPA_AUDIO_FORMAT_S16, 1, cpu_flags);
+	run_test_noise(SPA_AUDIO_FORMAT_S16, 2, cpu_flags);
 	run_test_noise(SPA_AUDIO_FORMAT_S24, 1, 0);
 	run_test_noise(SPA_AUDIO_FORMAT_S24, 2, 0);
 	run_test_noise(SPA_AUDIO_FORMAT_S32, 1, 0);
 	run_test_noise(SPA_AUDIO_FORMAT_S32, 2, 0);
 }
 
+static void run_test_dither(uint32_t fmt, uint32_t method, uint32_t flags, uint32_t max_diff)
+{
+	struct convert c1, c2;
+	static float in[N_CHANNELS][N_SAMPLES * 5];
+	static int16_t out1[N_CHANNELS * N_SAMPLES * 5], out2[N_CHANNELS * N_SAMPLES * 5];
+	const void *ip[N_CHANNELS];
+	void *op1[N_CHANNELS], *op2[N_CHANNELS];
+	uint32_t i, j, n_samples, planar = fmt == SPA_AUDIO_FORMAT_S16P;
+
+	spa_zero(c1);
+	c1.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	c1.dst_fmt = fmt;
+	c1.n_channels = N_CHANNELS;
+	c1.rate = 48000;
+	c1.method = method;
+	c2 = c1;
+	c2.cpu_flags = flags;
+	spa_assert_se(convert_init(&c1) == 0);
+	spa_assert_se(convert_init(&c2) == 0);
+	fprintf(stderr, "test dither %s:\n", c2.func_name);
+
+	/* use the same noise for both so that only the conversion differs */
+	c2.update_noise = c1.update_noise;
+	memcpy(c2.random, c1.random, sizeof(c1.random[0]) * RANDOM_SIZE);
+
+	for (i = 0; i < N_CHANNELS; i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(in[i]); j++)
+			in[i][j] = sinf(j * (0.01f + i * 0.003f)) * 0.5f;
+		ip[i] = in[i];
+		op1[i] = planar ? &out1[i * N_SAMPLES * 5] : out1;
+		op2[i] = planar ? &out2[i * N_SAMPLES * 5] : out2;
+	}
+	/* odd sizes to exercise the tails and more than one noise block */
+	for (n_samples = 1; n_samples < N_SAMPLES * 5; n_samples = n_samples * 3 + 7) {
+		convert_process(&c1, op1, ip, n_samples);
+		convert_process(&c2, op2, ip, n_samples);
+
+		for (i = 0; i < N_CHANNELS; i++) {
+			for (j = 0; j < n_samples; j++) {
+				uint32_t idx = planar ? i * N_SAMPLES * 5 + j : j * N_CHANNELS + i;
+				/* the C version is built with -Ofast and is allowed to
+				 * reorder the noise shaping sums */
+				spa_assert_se((uint32_t)SPA_ABS(out1[idx] - out2[idx]) <= max_diff);
+			}
+		}
+	}
+	convert_free(&c1);
+	convert_free(&c2);
+}
+
+static void test_dither(void)
+{
+	run_test_dither(SPA_AUDIO_FORMAT_S16, DITHER_METHOD_TRIANGULAR_HF, cpu_flags, 1);
+	run_test_dither(SPA_AUDIO_FORMAT_S16P, DITHER_METHOD_TRIANGULAR_HF, cpu_flags, 1);
+	run_test_dither(SPA_AUDIO_FORMAT_S16, DITHER_METHOD_WANNAMAKER_3, cpu_flags, 8);
+	run_test_dither(SPA_AUDIO_FORMAT_S16P, DITHER_METHOD_WANNAMAKER_3, cpu_flags, 8);
+	run_test_dither(SPA_AUDIO_FORMAT_S16, DITHER_METHOD_LIPSHITZ, cpu_flags, 8);
+	run_test_dither(SPA_AUDIO_FORMAT_S16P, DITHER_METHOD_LIPSHITZ, cpu_flags, 8);
+}
+
+static void remove_dir(const char *path)
+{
+	DIR *dir;
+	struct dirent *e;
+	char name[PATH_MAX];
+
+	if ((dir = opendir(path)) != NULL) {
+		while ((e = readdir(dir)) != NULL) {
+			if (spa_streq(e->d_name, ".") || spa_streq(e->d_name, ".."))
+				continue;
+			spa_scnprintf(name, sizeof(name), "%s/%s", path, e->d_name);
+			if (e->d_type == DT_DIR)
+				remove_dir(name);
+			else
+				unlink(name);
+		}
+		closedir(dir);
+	}
+	rmdir(path);
+}
+
+static void test_calibrate(void)
+{
+	struct convert c1, c2;
+	char dir[] = "/tmp/test-fmt-ops-XXXXXX";
+
+	spa_assert_se(mkdtemp(dir) != NULL);
+	setenv("XDG_CACHE_HOME", dir, 1);
+
+	spa_zero(c1);
+	c1.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	c1.dst_fmt = SPA_AUDIO_FORMAT_S16;
+	c1.n_channels = 2;
+	c1.rate = 48000;
+	c1.cpu_flags = cpu_flags;
+	c1.calibrate = true;
+	c2 = c1;
+	spa_assert_se(convert_init(&c1) == 0);
+	fprintf(stderr, "test calibrate %s:\n", c1.func_name);
+	spa_assert_se(MATCH_CPU_FLAGS(c1.cpu_flags, cpu_flags));
+
+	/* the second converter uses the cached result */
+	spa_assert_se(convert_init(&c2) == 0);
+	spa_assert_se(c2.process == c1.process);
+
+	convert_free(&c1);
+	convert_free(&c2);
+	remove_dir(dir);
+}
+
 int main(int argc, char *argv[])
 {
 	cpu_flags = get_cpu_flags();
@@ -854,6 +1110,8 @@ int main(int argc, char *argv[])
 	test_s24_32_f32();
 	test_f32_f64();
 	test_f64_f32();
+	test_f32_f16();
+	test_f16_f32();
 
 	test_lossless_s8();
 	test_lossless_u8();
@@ -872,6 +1130,8 @@ int main(int argc, char *argv[])
 	test_swaps();
 
 	test_noise();
+	test_dither();
+	test_calibrate();
 
 	return 0;
 }
@@ -28,6 +28,7 @@ static void test_impl(void)
 	unsigned int i;
 	float vals[1038];
 	float min[2] = { 0.0f, 0.0f }, max[2] = { 0.0f, 0.0f }, absmax[2] = { 0.0f, 0.0f };
+	float sumsqr[2] = { 0.0f, 0.0f };
 
 	for (i = 0; i < SPA_N_ELEMENTS(vals); i++)
 		vals[i] = (float)((drand48() - 0.5f) * 2.5f);
@@ -38,6 +39,9 @@ static void test_impl(void)
 	absmax[0] = peaks_abs_max_c(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
 	printf("c peaks abs-max:%f\n", absmax[0]);
 
+	sumsqr[0] = peaks_sum_sqr_c(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
+	printf("c peaks sum-sqr:%f\n", sumsqr[0]);
+
 #if defined(HAVE_SSE)
 	if (cpu_flags & SPA_CPU_FLAG_SSE) {
 		peaks_min_max_sse(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, &min[1], &max[1]);
@@ -46,9 +50,32 @@ static void test_impl(void)
 		absmax[1] = peaks_abs_max_sse(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
 		printf("sse peaks abs-max:%f\n", absmax[1]);
 
+		sumsqr[1] = peaks_sum_sqr_sse(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
+		printf("sse peaks sum-sqr:%f\n", sumsqr[1]);
+
 		spa_assert(min[0] == min[1]);
 		spa_assert(max[0] == max[1]);
 		spa_assert(absmax[0] == absmax[1]);
+		/* the sum is done in a different order */
+		spa_assert(fabsf(sumsqr[0] - sumsqr[1]) < 1e-3f);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		peaks_min_max_neon(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, &min[1], &max[1]);
+		printf("neon peaks min:%f max:%f\n", min[1], max[1]);
+
+		absmax[1] = peaks_abs_max_neon(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
+		printf("neon peaks abs-max:%f\n", absmax[1]);
+
+		sumsqr[1] = peaks_sum_sqr_neon(&peaks, &vals[1], SPA_N_ELEMENTS(vals) - 1, 0.0f);
+		printf("neon peaks sum-sqr:%f\n", sumsqr[1]);
+
+		spa_assert(min[0] == min[1]);
+		spa_assert(max[0] == max[1]);
+		spa_assert(absmax[0] == absmax[1]);
+		/* the sum is done in a different order */
+		spa_assert(fabsf(sumsqr[0] - sumsqr[1]) < 1e-3f);
 	}
 #endif
 
@@ -87,6 +114,22 @@ static void test_abs_max(void)
 	spa_assert(max == 0.8f);
 }
 
+static void test_sum_sqr(void)
+{
+	struct peaks peaks;
+	const float vals[] = { 0.0f, 0.5f, -0.5f, 0.0f, 0.5f, -1.0f, -0.5f, 0.0f };
+	float sum = 0.0f;
+
+	spa_zero(peaks);
+	peaks.log = &logger.log;
+	peaks.cpu_flags = cpu_flags;
+	peaks_init(&peaks);
+
+	sum = peaks_sum_sqr(&peaks, vals, SPA_N_ELEMENTS(vals), sum);
+
+	spa_assert(sum == 2.0f);
+}
+
 int main(int argc, char *argv[])
 {
 	struct timespec ts;
@@ -103,6 +146,7 @@ int main(int argc, char *argv[])
 
 	test_min_max();
 	test_abs_max();
+	test_sum_sqr();
 
 	return 0;
 }
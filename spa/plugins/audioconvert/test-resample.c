@@ -15,6 +15,7 @@
 SPA_LOG_IMPL(logger);
 
 #include "resample.h"
+#include "resample-native-impl.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -146,12 +147,81 @@ static void test_in_len(void)
 	resample_free(&r);
 }
 
+static void test_filter_cache(void)
+{
+	struct resample r1, r2, r3;
+	struct native_data *d1, *d2, *d3;
+
+	spa_zero(r1);
+	r1.log = &logger.log;
+	r1.channels = 2;
+	r1.i_rate = 44100;
+	r1.o_rate = 48000;
+	r1.quality = RESAMPLE_DEFAULT_QUALITY;
+	r2 = r1;
+	r3 = r1;
+	r3.quality = RESAMPLE_DEFAULT_QUALITY + 1;
+
+	spa_assert_se(resample_native_init(&r1) == 0);
+	spa_assert_se(resample_native_init(&r2) == 0);
+	spa_assert_se(resample_native_init(&r3) == 0);
+	d1 = r1.data;
+	d2 = r2.data;
+	d3 = r3.data;
+
+	/* same rates and quality share the filter, other quality does not */
+	spa_assert_se(d1->filter == d2->filter);
+	spa_assert_se(d1->filter != d3->filter);
+
+	resample_free(&r1);
+	spa_assert_se(d2->filter[d2->n_taps / 2] != 0.0f);
+	resample_free(&r2);
+	resample_free(&r3);
+}
+
+static void test_minimum_phase(void)
+{
+	struct resample r1, r2;
+	const void *src[1];
+	void *dst[1];
+	uint32_t i, in, out;
+
+	spa_zero(r1);
+	r1.log = &logger.log;
+	r1.channels = 1;
+	r1.i_rate = 44100;
+	r1.o_rate = 48000;
+	r1.quality = RESAMPLE_DEFAULT_QUALITY;
+	r2 = r1;
+	r2.options = RESAMPLE_OPTION_MINIMUM_PHASE;
+
+	spa_assert_se(resample_native_init(&r1) == 0);
+	spa_assert_se(resample_native_init(&r2) == 0);
+	spa_assert_se(resample_delay(&r2) < resample_delay(&r1) / 2);
+
+	/* DC is passed with the same gain */
+	for (i = 0; i < N_SAMPLES; i++)
+		samp_in[i] = 1.0f;
+	src[0] = samp_in;
+	dst[0] = samp_out;
+	in = N_SAMPLES;
+	out = N_SAMPLES * 2;
+	resample_process(&r2, src, &in, dst, &out);
+	spa_assert_se(out > 100);
+	spa_assert_se(fabsf(samp_out[out - 1] - 1.0f) < 0.001f);
+
+	resample_free(&r1);
+	resample_free(&r2);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
 	test_native();
 	test_in_len();
+	test_filter_cache();
+	test_minimum_phase();
 
 	return 0;
 }
@@ -27,6 +27,9 @@ static const struct volume_info {
 {
 #if defined (HAVE_SSE)
 	MAKE(volume_f32_sse, SPA_CPU_FLAG_SSE),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(volume_f32_neon, SPA_CPU_FLAG_NEON),
 #endif
 	MAKE(volume_f32_c),
 };
@@ -5,13 +5,17 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <semaphore.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/cpu.h>
 #include <spa/support/loop.h>
+#include <spa/support/thread.h>
+#include <spa/utils/atomic.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
+#include <spa/utils/result.h>
 #include <spa/utils/string.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
@@ -33,6 +37,9 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.audiomixer");
 #define MAX_PORTS       512
 #define MAX_CHANNELS    64
 #define MAX_ALIGN	MIX_OPS_MAX_ALIGN
+#define MAX_WORKERS	16u
+/* don't split the mix in parts of less than this many samples */
+#define MIN_WORKER_SAMPLES	8192
 
 #define PORT_DEFAULT_VOLUME	1.0
 #define PORT_DEFAULT_MUTE	false
@@ -81,6 +88,20 @@ struct port {
 	size_t queued_bytes;
 };
 
+struct impl;
+
+/* a helper thread that mixes one part of the output */
+struct worker {
+	struct impl *impl;
+	struct spa_thread *thread;
+	sem_t start;
+
+	void *dst;
+	const void *datas[MAX_PORTS];
+	uint32_t n_src;
+	uint32_t n_samples;
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_node node;
@@ -91,8 +112,15 @@ struct impl {
 	uint32_t max_align;
 
 	struct spa_loop *data_loop;
+	struct spa_thread_utils *thread_utils;
+
+	struct worker *workers;
+	uint32_t n_workers;
+	sem_t workers_done;
+	bool workers_running;
 
 	uint32_t quantum_limit;
+	unsigned int calibrate:1;
 
 	struct mix_ops ops;
 
@@ -581,10 +609,16 @@ static int port_set_format(void *object,
 			this->ops.fmt = info.info.raw.format;
 			this->ops.n_channels = info.info.raw.channels;
 			this->ops.cpu_flags = this->cpu_flags;
+			this->ops.log = this->log;
+			this->ops.calibrate = this->calibrate;
 
 			if ((res = mix_ops_init(&this->ops)) < 0)
 				return res;
 
+			spa_log_debug(this->log, "%p: got mixer features %08x:%08x %s",
+					this, this->cpu_flags, this->ops.cpu_flags,
+					this->ops.func_name);
+
 			this->stride = calc_width(&info);
 
 			if (SPA_AUDIO_FORMAT_IS_PLANAR(info.info.raw.format)) {
@@ -769,6 +803,130 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return queue_buffer(this, port, &port->buffers[buffer_id]);
 }
 
+static void *worker_thread(void *data)
+{
+	struct worker *w = data;
+	struct impl *this = w->impl;
+
+	while (true) {
+		sem_wait(&w->start);
+		if (!SPA_ATOMIC_LOAD(this->workers_running))
+			break;
+		mix_ops_process(&this->ops, w->dst, w->datas, w->n_src, w->n_samples);
+		sem_post(&this->workers_done);
+	}
+	return NULL;
+}
+
+static void stop_workers(struct impl *this)
+{
+	uint32_t i;
+
+	if (this->workers == NULL)
+		return;
+
+	SPA_ATOMIC_STORE(this->workers_running, false);
+	for (i = 0; i < this->n_workers; i++) {
+		struct worker *w = &this->workers[i];
+		if (w->thread) {
+			sem_post(&w->start);
+			spa_thread_utils_join(this->thread_utils, w->thread, NULL);
+		}
+		sem_destroy(&w->start);
+	}
+	sem_destroy(&this->workers_done);
+	free(this->workers);
+	this->workers = NULL;
+	this->n_workers = 0;
+}
+
+static int start_workers(struct impl *this, uint32_t n_workers)
+{
+	struct worker *workers;
+	uint32_t i;
+	int res;
+
+	if (this->thread_utils == NULL) {
+		spa_log_warn(this->log, "%p: no thread utils, can't start %u mixer threads",
+				this, n_workers);
+		return -ENOTSUP;
+	}
+	workers = calloc(n_workers, sizeof(struct worker));
+	if (workers == NULL)
+		return -errno;
+
+	if (sem_init(&this->workers_done, 0, 0) < 0) {
+		res = -errno;
+		free(workers);
+		return res;
+	}
+	this->workers = workers;
+	SPA_ATOMIC_STORE(this->workers_running, true);
+
+	for (i = 0; i < n_workers; i++) {
+		struct worker *w = &this->workers[i];
+
+		w->impl = this;
+		if (sem_init(&w->start, 0, 0) < 0) {
+			res = -errno;
+			goto error;
+		}
+		this->n_workers++;
+
+		w->thread = spa_thread_utils_create(this->thread_utils, NULL, worker_thread, w);
+		if (w->thread == NULL) {
+			res = -errno;
+			goto error;
+		}
+		spa_thread_utils_acquire_rt(this->thread_utils, w->thread, -1);
+	}
+	spa_log_info(this->log, "%p: started %u mixer threads", this, n_workers);
+	return 0;
+
+error:
+	spa_log_error(this->log, "%p: can't start mixer thread: %s",
+			this, spa_strerror(res));
+	stop_workers(this);
+	return res;
+}
+
+/* split the mix in frame blocks, the helper threads do all but the
+ * first block, which we do ourselves. */
+static void mix_parallel(struct impl *this, void *dst, const void *datas[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, j, n_parts, part, offs = 0, n_channels = this->ops.n_channels;
+
+	n_parts = SPA_MIN(this->n_workers + 1,
+			n_samples * n_channels * n_src / MIN_WORKER_SAMPLES);
+	/* keep the parts aligned for the SIMD functions */
+	part = SPA_ROUND_UP(n_samples / SPA_MAX(n_parts, 1u), 16u);
+
+	if (this->blocks != 1 || n_parts < 2 || part >= n_samples) {
+		mix_ops_process(&this->ops, dst, datas, n_src, n_samples);
+		return;
+	}
+
+	for (i = 0; i < this->n_workers && n_samples - offs > part; i++) {
+		struct worker *w = &this->workers[i];
+		uint32_t boffs;
+
+		offs += part;
+		boffs = offs * this->stride;
+
+		w->dst = SPA_PTROFF(dst, boffs, void);
+		for (j = 0; j < n_src; j++)
+			w->datas[j] = SPA_PTROFF(datas[j], boffs, void);
+		w->n_src = n_src;
+		w->n_samples = SPA_MIN(part, n_samples - offs);
+		sem_post(&w->start);
+	}
+	mix_ops_process(&this->ops, dst, datas, n_src, part);
+
+	for (j = 0; j < i; j++)
+		sem_wait(&this->workers_done);
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -865,8 +1023,11 @@ static int impl_node_process(void *object)
 		d[0].chunk->stride = this->stride;
 		SPA_FLAG_UPDATE(d[0].chunk->flags, SPA_CHUNK_FLAG_EMPTY, n_buffers == 0);
 
-		mix_ops_process(&this->ops, d[0].data,
-				datas, n_buffers, maxsize / this->stride);
+		if (this->n_workers > 0)
+			mix_parallel(this, d[0].data, datas, n_buffers, maxsize / this->stride);
+		else
+			mix_ops_process(&this->ops, d[0].data,
+					datas, n_buffers, maxsize / this->stride);
 	}
 
 	outio->buffer_id = outb->id;
@@ -919,6 +1080,7 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	stop_workers(this);
 	for (i = 0; i < MAX_PORTS; i++)
 		free(this->in_ports[i]);
 	mix_ops_free(&this->ops);
@@ -941,7 +1103,7 @@ impl_init(const struct spa_handle_factory *factory,
 {
 	struct impl *this;
 	struct port *port;
-	uint32_t i;
+	uint32_t i, n_workers = 0;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -965,13 +1127,21 @@ impl_init(const struct spa_handle_factory *factory,
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 		this->max_align = SPA_MIN(MAX_ALIGN, spa_cpu_get_max_align(this->cpu));
 	}
+	this->thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
 
 	for (i = 0; info && i < info->n_items; i++) {
 		const char *k = info->items[i].key;
 		const char *s = info->items[i].value;
 		if (spa_streq(k, "clock.quantum-limit"))
 			spa_atou32(s, &this->quantum_limit, 0);
+		else if (spa_streq(k, "cpu.calibrate"))
+			this->calibrate = spa_atob(s);
+		else if (spa_streq(k, "mixer.threads"))
+			spa_atou32(s, &n_workers, 0);
 	}
+	if (n_workers > 0 &&
+	    start_workers(this, SPA_MIN(n_workers, MAX_WORKERS)) < 0)
+		spa_log_warn(this->log, "%p: mixing without helper threads", this);
 
 	spa_hook_list_init(&this->hooks);
 
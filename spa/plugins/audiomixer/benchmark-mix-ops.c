@@ -12,6 +12,7 @@
 #include <time.h>
 
 #include "test-helper.h"
+#include "benchmark-helper.h"
 #include "mix-ops.h"
 
 static uint32_t cpu_flags;
@@ -27,7 +28,7 @@ struct stats {
 };
 
 #define MAX_SAMPLES	4096
-#define MAX_SRC		11
+#define MAX_SRC		32
 
 #define MAX_COUNT 100
 
@@ -35,7 +36,7 @@ static uint8_t samp_in[MAX_SAMPLES * MAX_SRC * 8];
 static uint8_t samp_out[MAX_SAMPLES * 8];
 
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
-static const int src_counts[] = { 1, 2, 4, 6, 8, 11 };
+static const int src_counts[] = { 1, 2, 4, 6, 8, 11, 16, 32 };
 
 #define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(src_counts) * 70
 
@@ -103,6 +104,11 @@ static void test_u8(void)
 static void test_s16(void)
 {
 	run_test("test_s16", "c", mix_s16_c);
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s16", "neon", mix_s16_neon);
+	}
+#endif
 }
 static void test_u16(void)
 {
@@ -148,6 +154,16 @@ static void test_f32(void)
 		run_test("test_f32", "avx", mix_f32_avx);
 	}
 #endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32", "avx512", mix_f32_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32", "neon", mix_f32_neon);
+	}
+#endif
 }
 
 static void test_f64(void)
@@ -158,6 +174,11 @@ static void test_f64(void)
 		run_test("test_f64", "sse2", mix_f64_sse2);
 	}
 #endif
+#if defined (HAVE_NEON) && defined(__aarch64__)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f64", "neon", mix_f64_neon);
+	}
+#endif
 }
 
 static int compare_func(const void *_a, const void *_b)
@@ -173,6 +194,8 @@ static int compare_func(const void *_a, const void *_b)
 
 int main(int argc, char *argv[])
 {
+	struct benchmark_results br;
+	char key[128];
 	uint32_t i;
 
 	cpu_flags = get_cpu_flags();
@@ -193,10 +216,14 @@ int main(int argc, char *argv[])
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
+	benchmark_results_init(&br, "mix-ops");
 	for (i = 0; i < n_results; i++) {
 		struct stats *s = &results[i];
 		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, src %d\n",
 				s->perf, s->name, s->impl, s->n_samples, s->n_src);
+		snprintf(key, sizeof(key), "%s/%s/%d/%d",
+				s->name, s->impl, s->n_samples, s->n_src);
+		benchmark_results_add(&br, key, s->perf);
 	}
-	return 0;
+	return benchmark_results_finish(&br);
 }
@@ -19,7 +19,7 @@ mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 	n_samples *= ops->n_channels;
 
 	if (n_src == 0)
-		memset(dst, 0, n_samples * ops->n_channels * sizeof(float));
+		memset(dst, 0, n_samples * sizeof(float));
 	else if (n_src == 1) {
 		if (dst != src[0])
 			spa_memcpy(dst, src[0], n_samples * sizeof(float));
@@ -28,34 +28,25 @@ mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 		const float **s = (const float **)src;
 		float *d = dst;
 
-		if (SPA_LIKELY(SPA_IS_ALIGNED(dst, 32))) {
-			unrolled = n_samples & ~31;
-			for (i = 0; i < n_src; i++) {
-				if (SPA_UNLIKELY(!SPA_IS_ALIGNED(src[i], 32))) {
-					unrolled = 0;
-					break;
-				}
-			}
-		} else
-			unrolled = 0;
+		unrolled = n_samples & ~31;
 
 		for (n = 0; n < unrolled; n += 32) {
 			__m256 in[4];
 
-			in[0] = _mm256_load_ps(&s[0][n +  0]);
-			in[1] = _mm256_load_ps(&s[0][n +  8]);
-			in[2] = _mm256_load_ps(&s[0][n + 16]);
-			in[3] = _mm256_load_ps(&s[0][n + 24]);
+			in[0] = _mm256_loadu_ps(&s[0][n +  0]);
+			in[1] = _mm256_loadu_ps(&s[0][n +  8]);
+			in[2] = _mm256_loadu_ps(&s[0][n + 16]);
+			in[3] = _mm256_loadu_ps(&s[0][n + 24]);
 			for (i = 1; i < n_src; i++) {
-				in[0] = _mm256_add_ps(in[0], _mm256_load_ps(&s[i][n +  0]));
-				in[1] = _mm256_add_ps(in[1], _mm256_load_ps(&s[i][n +  8]));
-				in[2] = _mm256_add_ps(in[2], _mm256_load_ps(&s[i][n + 16]));
-				in[3] = _mm256_add_ps(in[3], _mm256_load_ps(&s[i][n + 24]));
+				in[0] = _mm256_add_ps(in[0], _mm256_loadu_ps(&s[i][n +  0]));
+				in[1] = _mm256_add_ps(in[1], _mm256_loadu_ps(&s[i][n +  8]));
+				in[2] = _mm256_add_ps(in[2], _mm256_loadu_ps(&s[i][n + 16]));
+				in[3] = _mm256_add_ps(in[3], _mm256_loadu_ps(&s[i][n + 24]));
 			}
-			_mm256_store_ps(&d[n +  0], in[0]);
-			_mm256_store_ps(&d[n +  8], in[1]);
-			_mm256_store_ps(&d[n + 16], in[2]);
-			_mm256_store_ps(&d[n + 24], in[3]);
+			_mm256_storeu_ps(&d[n +  0], in[0]);
+			_mm256_storeu_ps(&d[n +  8], in[1]);
+			_mm256_storeu_ps(&d[n + 16], in[2]);
+			_mm256_storeu_ps(&d[n + 24], in[3]);
 		}
 		for (; n < n_samples; n++) {
 			__m128 in[1];
@@ -66,3 +57,55 @@ mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 		}
 	}
 }
+
+static inline __m256 gain_avx(const struct mix_gain *g, uint32_t n)
+{
+	if (n >= g->n_ramp)
+		return _mm256_set1_ps(mix_gain_at(g, n));
+	return _mm256_fmadd_ps(_mm256_set1_ps(g->delta),
+			_mm256_min_ps(_mm256_add_ps(_mm256_set1_ps((float)n),
+					_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)),
+				_mm256_set1_ps((float)g->n_ramp)),
+			_mm256_set1_ps(g->gain));
+}
+
+void
+mix_gain_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	const float **s = (const float **)src;
+	float *d = dst;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+		return;
+	}
+
+	unrolled = n_samples & ~31;
+
+	for (n = 0; n < unrolled; n += 32) {
+		__m256 in[4];
+
+		in[0] = in[1] = in[2] = in[3] = _mm256_setzero_ps();
+		for (i = 0; i < n_src; i++) {
+			const struct mix_gain *g = &gain[i];
+			in[0] = _mm256_fmadd_ps(_mm256_loadu_ps(&s[i][n +  0]), gain_avx(g, n +  0), in[0]);
+			in[1] = _mm256_fmadd_ps(_mm256_loadu_ps(&s[i][n +  8]), gain_avx(g, n +  8), in[1]);
+			in[2] = _mm256_fmadd_ps(_mm256_loadu_ps(&s[i][n + 16]), gain_avx(g, n + 16), in[2]);
+			in[3] = _mm256_fmadd_ps(_mm256_loadu_ps(&s[i][n + 24]), gain_avx(g, n + 24), in[3]);
+		}
+		_mm256_storeu_ps(&d[n +  0], in[0]);
+		_mm256_storeu_ps(&d[n +  8], in[1]);
+		_mm256_storeu_ps(&d[n + 16], in[2]);
+		_mm256_storeu_ps(&d[n + 24], in[3]);
+	}
+	for (; n < n_samples; n++) {
+		__m128 in[1];
+		in[0] = _mm_setzero_ps();
+		for (i = 0; i < n_src; i++)
+			in[0] = _mm_add_ss(in[0], _mm_mul_ss(_mm_load_ss(&s[i][n]),
+						_mm_set_ss(mix_gain_at(&gain[i], n))));
+		_mm_store_ss(&d[n], in[0]);
+	}
+}
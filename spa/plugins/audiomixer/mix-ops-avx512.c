@@ -0,0 +1,63 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#include <immintrin.h>
+
+void
+mix_f32_avx512(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+	else if (n_src == 1) {
+		if (dst != src[0])
+			spa_memcpy(dst, src[0], n_samples * sizeof(float));
+	} else {
+		uint32_t i, n, unrolled;
+		const float **s = (const float **)src;
+		float *d = dst;
+
+		unrolled = n_samples & ~63;
+
+		for (n = 0; n < unrolled; n += 64) {
+			__m512 in[4];
+
+			in[0] = _mm512_loadu_ps(&s[0][n +  0]);
+			in[1] = _mm512_loadu_ps(&s[0][n + 16]);
+			in[2] = _mm512_loadu_ps(&s[0][n + 32]);
+			in[3] = _mm512_loadu_ps(&s[0][n + 48]);
+			for (i = 1; i < n_src; i++) {
+				in[0] = _mm512_add_ps(in[0], _mm512_loadu_ps(&s[i][n +  0]));
+				in[1] = _mm512_add_ps(in[1], _mm512_loadu_ps(&s[i][n + 16]));
+				in[2] = _mm512_add_ps(in[2], _mm512_loadu_ps(&s[i][n + 32]));
+				in[3] = _mm512_add_ps(in[3], _mm512_loadu_ps(&s[i][n + 48]));
+			}
+			_mm512_storeu_ps(&d[n +  0], in[0]);
+			_mm512_storeu_ps(&d[n + 16], in[1]);
+			_mm512_storeu_ps(&d[n + 32], in[2]);
+			_mm512_storeu_ps(&d[n + 48], in[3]);
+		}
+		/* the remaining samples, 16 at a time with a mask for the last ones */
+		for (; n < n_samples; n += 16) {
+			uint32_t remain = SPA_MIN(n_samples - n, 16u);
+			__mmask16 mask = (__mmask16)((1u << remain) - 1);
+			__m512 in[1];
+
+			in[0] = _mm512_maskz_loadu_ps(mask, &s[0][n]);
+			for (i = 1; i < n_src; i++)
+				in[0] = _mm512_add_ps(in[0], _mm512_maskz_loadu_ps(mask, &s[i][n]));
+			_mm512_mask_storeu_ps(&d[n], mask, in[0]);
+		}
+	}
+}
@@ -46,3 +46,25 @@ MAKE_FUNC(s24_32, int32_t, int32_t, S24_32_ACCUM, S24_32_CLAMP, true);
 MAKE_FUNC(u24_32, uint32_t, int32_t, U24_32_ACCUM, U24_32_CLAMP, false);
 MAKE_FUNC(f32, float, float, F32_ACCUM, F32_CLAMP, true);
 MAKE_FUNC(f64, double, double, F64_ACCUM, F64_CLAMP, true);
+
+void mix_gain_f32_c(struct mix_ops *ops,
+		void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, j, n, c = ops->n_channels;
+	float *d = dst;
+	const float **s = (const float **)src;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * c * sizeof(float));
+		return;
+	}
+	for (n = 0; n < n_samples; n++) {
+		for (j = 0; j < c; j++) {
+			float ac = 0.0f;
+			for (i = 0; i < n_src; i++)
+				ac += s[i][n * c + j] * mix_gain_at(&gain[i], n);
+			d[n * c + j] = ac;
+		}
+	}
+}
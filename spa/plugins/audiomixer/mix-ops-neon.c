@@ -0,0 +1,150 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#include <arm_neon.h>
+
+void
+mix_f32_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			spa_memcpy(dst, src[0], n_samples * sizeof(float));
+	} else {
+		uint32_t n, i, unrolled;
+		float32x4_t in[4];
+		const float **s = (const float **)src;
+		float *d = dst;
+
+		unrolled = n_samples & ~15;
+
+		for (n = 0; n < unrolled; n += 16) {
+			in[0] = vld1q_f32(&s[0][n+ 0]);
+			in[1] = vld1q_f32(&s[0][n+ 4]);
+			in[2] = vld1q_f32(&s[0][n+ 8]);
+			in[3] = vld1q_f32(&s[0][n+12]);
+
+			for (i = 1; i < n_src; i++) {
+				in[0] = vaddq_f32(in[0], vld1q_f32(&s[i][n+ 0]));
+				in[1] = vaddq_f32(in[1], vld1q_f32(&s[i][n+ 4]));
+				in[2] = vaddq_f32(in[2], vld1q_f32(&s[i][n+ 8]));
+				in[3] = vaddq_f32(in[3], vld1q_f32(&s[i][n+12]));
+			}
+			vst1q_f32(&d[n+ 0], in[0]);
+			vst1q_f32(&d[n+ 4], in[1]);
+			vst1q_f32(&d[n+ 8], in[2]);
+			vst1q_f32(&d[n+12], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			float t = s[0][n];
+			for (i = 1; i < n_src; i++)
+				t += s[i][n];
+			d[n] = t;
+		}
+	}
+}
+
+#if defined(__aarch64__)
+void
+mix_f64_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(double));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			spa_memcpy(dst, src[0], n_samples * sizeof(double));
+	} else {
+		uint32_t n, i, unrolled;
+		float64x2_t in[4];
+		const double **s = (const double **)src;
+		double *d = dst;
+
+		unrolled = n_samples & ~7;
+
+		for (n = 0; n < unrolled; n += 8) {
+			in[0] = vld1q_f64(&s[0][n+0]);
+			in[1] = vld1q_f64(&s[0][n+2]);
+			in[2] = vld1q_f64(&s[0][n+4]);
+			in[3] = vld1q_f64(&s[0][n+6]);
+
+			for (i = 1; i < n_src; i++) {
+				in[0] = vaddq_f64(in[0], vld1q_f64(&s[i][n+0]));
+				in[1] = vaddq_f64(in[1], vld1q_f64(&s[i][n+2]));
+				in[2] = vaddq_f64(in[2], vld1q_f64(&s[i][n+4]));
+				in[3] = vaddq_f64(in[3], vld1q_f64(&s[i][n+6]));
+			}
+			vst1q_f64(&d[n+0], in[0]);
+			vst1q_f64(&d[n+2], in[1]);
+			vst1q_f64(&d[n+4], in[2]);
+			vst1q_f64(&d[n+6], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			double t = s[0][n];
+			for (i = 1; i < n_src; i++)
+				t += s[i][n];
+			d[n] = t;
+		}
+	}
+}
+#endif
+
+void
+mix_s16_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int16_t));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			spa_memcpy(dst, src[0], n_samples * sizeof(int16_t));
+	} else {
+		uint32_t n, i, unrolled;
+		int32x4_t acc[4];
+		int16x8_t in[2];
+		const int16_t **s = (const int16_t **)src;
+		int16_t *d = dst;
+
+		unrolled = n_samples & ~15;
+
+		/* accumulate in 32 bits and saturate once at the end, like the
+		 * C version does */
+		for (n = 0; n < unrolled; n += 16) {
+			acc[0] = acc[1] = acc[2] = acc[3] = vdupq_n_s32(0);
+
+			for (i = 0; i < n_src; i++) {
+				in[0] = vld1q_s16(&s[i][n+0]);
+				in[1] = vld1q_s16(&s[i][n+8]);
+				acc[0] = vaddw_s16(acc[0], vget_low_s16(in[0]));
+				acc[1] = vaddw_s16(acc[1], vget_high_s16(in[0]));
+				acc[2] = vaddw_s16(acc[2], vget_low_s16(in[1]));
+				acc[3] = vaddw_s16(acc[3], vget_high_s16(in[1]));
+			}
+			vst1q_s16(&d[n+0], vcombine_s16(vqmovn_s32(acc[0]), vqmovn_s32(acc[1])));
+			vst1q_s16(&d[n+8], vcombine_s16(vqmovn_s32(acc[2]), vqmovn_s32(acc[3])));
+		}
+		for (; n < n_samples; n++) {
+			int32_t t = 0;
+			for (i = 0; i < n_src; i++)
+				t += s[i][n];
+			d[n] = S16_CLAMP(t);
+		}
+	}
+}
@@ -28,34 +28,52 @@ mix_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 		__m128 in[4];
 		const float **s = (const float **)src;
 		float *d = dst;
+		bool aligned = SPA_IS_ALIGNED(dst, 16);
 
-		if (SPA_LIKELY(SPA_IS_ALIGNED(dst, 16))) {
-			unrolled = n_samples & ~15;
-			for (i = 0; i < n_src; i++) {
-				if (SPA_UNLIKELY(!SPA_IS_ALIGNED(src[i], 16))) {
-					unrolled = 0;
-					break;
+		/* with many peers it is likely that one of them has an unaligned
+		 * chunk offset, use unaligned loads for all of them then instead
+		 * of falling back to the scalar loop */
+		for (i = 0; i < n_src && aligned; i++)
+			aligned = SPA_IS_ALIGNED(src[i], 16);
+
+		unrolled = n_samples & ~15;
+
+		if (SPA_LIKELY(aligned)) {
+			for (n = 0; n < unrolled; n += 16) {
+				in[0] = _mm_load_ps(&s[0][n+ 0]);
+				in[1] = _mm_load_ps(&s[0][n+ 4]);
+				in[2] = _mm_load_ps(&s[0][n+ 8]);
+				in[3] = _mm_load_ps(&s[0][n+12]);
+
+				for (i = 1; i < n_src; i++) {
+					in[0] = _mm_add_ps(in[0], _mm_load_ps(&s[i][n+ 0]));
+					in[1] = _mm_add_ps(in[1], _mm_load_ps(&s[i][n+ 4]));
+					in[2] = _mm_add_ps(in[2], _mm_load_ps(&s[i][n+ 8]));
+					in[3] = _mm_add_ps(in[3], _mm_load_ps(&s[i][n+12]));
 				}
+				_mm_store_ps(&d[n+ 0], in[0]);
+				_mm_store_ps(&d[n+ 4], in[1]);
+				_mm_store_ps(&d[n+ 8], in[2]);
+				_mm_store_ps(&d[n+12], in[3]);
 			}
-		} else
-			unrolled = 0;
-
-		for (n = 0; n < unrolled; n += 16) {
-			in[0] = _mm_load_ps(&s[0][n+ 0]);
-			in[1] = _mm_load_ps(&s[0][n+ 4]);
-			in[2] = _mm_load_ps(&s[0][n+ 8]);
-			in[3] = _mm_load_ps(&s[0][n+12]);
-
-			for (i = 1; i < n_src; i++) {
-				in[0] = _mm_add_ps(in[0], _mm_load_ps(&s[i][n+ 0]));
-				in[1] = _mm_add_ps(in[1], _mm_load_ps(&s[i][n+ 4]));
-				in[2] = _mm_add_ps(in[2], _mm_load_ps(&s[i][n+ 8]));
-				in[3] = _mm_add_ps(in[3], _mm_load_ps(&s[i][n+12]));
+		} else {
+			for (n = 0; n < unrolled; n += 16) {
+				in[0] = _mm_loadu_ps(&s[0][n+ 0]);
+				in[1] = _mm_loadu_ps(&s[0][n+ 4]);
+				in[2] = _mm_loadu_ps(&s[0][n+ 8]);
+				in[3] = _mm_loadu_ps(&s[0][n+12]);
+
+				for (i = 1; i < n_src; i++) {
+					in[0] = _mm_add_ps(in[0], _mm_loadu_ps(&s[i][n+ 0]));
+					in[1] = _mm_add_ps(in[1], _mm_loadu_ps(&s[i][n+ 4]));
+					in[2] = _mm_add_ps(in[2], _mm_loadu_ps(&s[i][n+ 8]));
+					in[3] = _mm_add_ps(in[3], _mm_loadu_ps(&s[i][n+12]));
+				}
+				_mm_storeu_ps(&d[n+ 0], in[0]);
+				_mm_storeu_ps(&d[n+ 4], in[1]);
+				_mm_storeu_ps(&d[n+ 8], in[2]);
+				_mm_storeu_ps(&d[n+12], in[3]);
 			}
-			_mm_store_ps(&d[n+ 0], in[0]);
-			_mm_store_ps(&d[n+ 4], in[1]);
-			_mm_store_ps(&d[n+ 8], in[2]);
-			_mm_store_ps(&d[n+12], in[3]);
 		}
 		for (; n < n_samples; n++) {
 			in[0] = _mm_load_ss(&s[0][n]);
@@ -65,3 +83,54 @@ mix_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 		}
 	}
 }
+
+static inline __m128 gain_sse(const struct mix_gain *g, uint32_t n)
+{
+	if (n >= g->n_ramp)
+		return _mm_set1_ps(mix_gain_at(g, n));
+	return _mm_add_ps(_mm_set1_ps(g->gain),
+			_mm_mul_ps(_mm_set1_ps(g->delta),
+				_mm_min_ps(_mm_add_ps(_mm_set1_ps((float)n),
+						_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)),
+					_mm_set1_ps((float)g->n_ramp))));
+}
+
+void
+mix_gain_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t n, i, unrolled;
+	__m128 in[4];
+	const float **s = (const float **)src;
+	float *d = dst;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+		return;
+	}
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		in[0] = in[1] = in[2] = in[3] = _mm_setzero_ps();
+
+		for (i = 0; i < n_src; i++) {
+			const struct mix_gain *g = &gain[i];
+			in[0] = _mm_add_ps(in[0], _mm_mul_ps(_mm_loadu_ps(&s[i][n+ 0]), gain_sse(g, n+ 0)));
+			in[1] = _mm_add_ps(in[1], _mm_mul_ps(_mm_loadu_ps(&s[i][n+ 4]), gain_sse(g, n+ 4)));
+			in[2] = _mm_add_ps(in[2], _mm_mul_ps(_mm_loadu_ps(&s[i][n+ 8]), gain_sse(g, n+ 8)));
+			in[3] = _mm_add_ps(in[3], _mm_mul_ps(_mm_loadu_ps(&s[i][n+12]), gain_sse(g, n+12)));
+		}
+		_mm_storeu_ps(&d[n+ 0], in[0]);
+		_mm_storeu_ps(&d[n+ 4], in[1]);
+		_mm_storeu_ps(&d[n+ 8], in[2]);
+		_mm_storeu_ps(&d[n+12], in[3]);
+	}
+	for (; n < n_samples; n++) {
+		in[0] = _mm_setzero_ps();
+		for (i = 0; i < n_src; i++)
+			in[0] = _mm_add_ss(in[0], _mm_mul_ss(_mm_load_ss(&s[i][n]),
+						_mm_set_ss(mix_gain_at(&gain[i], n))));
+		_mm_store_ss(&d[n], in[0]);
+	}
+}
@@ -4,13 +4,16 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
 #include <spa/support/cpu.h>
 #include <spa/utils/defs.h>
+#include <spa/utils/string.h>
 #include <spa/param/audio/format-utils.h>
 
 #include "mix-ops.h"
+#include "calibrate.h"
 
 typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
 		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
@@ -18,59 +21,110 @@ typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
 struct mix_info {
 	uint32_t fmt;
 	uint32_t n_channels;
-	uint32_t cpu_flags;
 	uint32_t stride;
 	mix_func_t process;
+	const char *name;
+	uint32_t cpu_flags;
 };
 
+#define MAKE(fmt,chan,stride,func,...) \
+	{ SPA_AUDIO_FORMAT_ ##fmt, chan, stride, func, #func, __VA_ARGS__ }
+
 static struct mix_info mix_table[] =
 {
 	/* f32 */
+#if defined(HAVE_AVX512)
+	MAKE(F32, 0, 4, mix_f32_avx512, SPA_CPU_FLAG_AVX512),
+	MAKE(F32P, 0, 4, mix_f32_avx512, SPA_CPU_FLAG_AVX512),
+#endif
 #if defined(HAVE_AVX)
-	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
-	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
+	MAKE(F32, 0, 4, mix_f32_avx, SPA_CPU_FLAG_AVX),
+	MAKE(F32P, 0, 4, mix_f32_avx, SPA_CPU_FLAG_AVX),
 #endif
 #if defined (HAVE_SSE)
-	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
-	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
+	MAKE(F32, 0, 4, mix_f32_sse, SPA_CPU_FLAG_SSE),
+	MAKE(F32P, 0, 4, mix_f32_sse, SPA_CPU_FLAG_SSE),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(F32, 0, 4, mix_f32_neon, SPA_CPU_FLAG_NEON),
+	MAKE(F32P, 0, 4, mix_f32_neon, SPA_CPU_FLAG_NEON),
 #endif
-	{ SPA_AUDIO_FORMAT_F32, 0, 0, 4, mix_f32_c },
-	{ SPA_AUDIO_FORMAT_F32P, 0, 0, 4, mix_f32_c },
+	MAKE(F32, 0, 4, mix_f32_c),
+	MAKE(F32P, 0, 4, mix_f32_c),
 
 	/* f64 */
 #if defined (HAVE_SSE2)
-	{ SPA_AUDIO_FORMAT_F64, 0, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
-	{ SPA_AUDIO_FORMAT_F64P, 0, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
+	MAKE(F64, 0, 8, mix_f64_sse2, SPA_CPU_FLAG_SSE2),
+	MAKE(F64P, 0, 8, mix_f64_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+#if defined (HAVE_NEON) && defined(__aarch64__)
+	MAKE(F64, 0, 8, mix_f64_neon, SPA_CPU_FLAG_NEON),
+	MAKE(F64P, 0, 8, mix_f64_neon, SPA_CPU_FLAG_NEON),
 #endif
-	{ SPA_AUDIO_FORMAT_F64, 0, 0, 8, mix_f64_c },
-	{ SPA_AUDIO_FORMAT_F64P, 0, 0, 8, mix_f64_c },
+	MAKE(F64, 0, 8, mix_f64_c),
+	MAKE(F64P, 0, 8, mix_f64_c),
 
 	/* s8 */
-	{ SPA_AUDIO_FORMAT_S8, 0, 0, 1, mix_s8_c },
-	{ SPA_AUDIO_FORMAT_S8P, 0, 0, 1, mix_s8_c },
-	{ SPA_AUDIO_FORMAT_U8, 0, 0, 1, mix_u8_c },
-	{ SPA_AUDIO_FORMAT_U8P, 0, 0, 1, mix_u8_c },
+	MAKE(S8, 0, 1, mix_s8_c),
+	MAKE(S8P, 0, 1, mix_s8_c),
+	MAKE(U8, 0, 1, mix_u8_c),
+	MAKE(U8P, 0, 1, mix_u8_c),
 
 	/* s16 */
-	{ SPA_AUDIO_FORMAT_S16, 0, 0, 2, mix_s16_c },
-	{ SPA_AUDIO_FORMAT_S16P, 0, 0, 2, mix_s16_c },
-	{ SPA_AUDIO_FORMAT_U16, 0, 0, 2, mix_u16_c },
+#if defined (HAVE_NEON)
+	MAKE(S16, 0, 2, mix_s16_neon, SPA_CPU_FLAG_NEON),
+	MAKE(S16P, 0, 2, mix_s16_neon, SPA_CPU_FLAG_NEON),
+#endif
+	MAKE(S16, 0, 2, mix_s16_c),
+	MAKE(S16P, 0, 2, mix_s16_c),
+	MAKE(U16, 0, 2, mix_u16_c),
 
 	/* s24 */
-	{ SPA_AUDIO_FORMAT_S24, 0, 0, 3, mix_s24_c },
-	{ SPA_AUDIO_FORMAT_S24P, 0, 0, 3, mix_s24_c },
-	{ SPA_AUDIO_FORMAT_U24, 0, 0, 3, mix_u24_c },
+	MAKE(S24, 0, 3, mix_s24_c),
+	MAKE(S24P, 0, 3, mix_s24_c),
+	MAKE(U24, 0, 3, mix_u24_c),
 
 	/* s32 */
-	{ SPA_AUDIO_FORMAT_S32, 0, 0, 4, mix_s32_c },
-	{ SPA_AUDIO_FORMAT_S32P, 0, 0, 4, mix_s32_c },
-	{ SPA_AUDIO_FORMAT_U32, 0, 0, 4, mix_u32_c },
+	MAKE(S32, 0, 4, mix_s32_c),
+	MAKE(S32P, 0, 4, mix_s32_c),
+	MAKE(U32, 0, 4, mix_u32_c),
 
 	/* s24_32 */
-	{ SPA_AUDIO_FORMAT_S24_32, 0, 0, 4, mix_s24_32_c },
-	{ SPA_AUDIO_FORMAT_S24_32P, 0, 0, 4, mix_s24_32_c },
-	{ SPA_AUDIO_FORMAT_U24_32, 0, 0, 4, mix_u24_32_c },
+	MAKE(S24_32, 0, 4, mix_s24_32_c),
+	MAKE(S24_32P, 0, 4, mix_s24_32_c),
+	MAKE(U24_32, 0, 4, mix_u24_32_c),
+};
+#undef MAKE
+
+typedef void (*mix_gain_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], const struct mix_gain gain[],
+		uint32_t n_src, uint32_t n_samples);
+
+struct mix_gain_info {
+	uint32_t fmt;
+	uint32_t n_channels;
+	mix_gain_func_t process;
+	uint32_t cpu_flags;
+};
+
+#define MAKE(fmt,chan,func,...) \
+	{ SPA_AUDIO_FORMAT_ ##fmt, chan, func, __VA_ARGS__ }
+
+/* the SIMD functions only do one gain per sample */
+static struct mix_gain_info mix_gain_table[] =
+{
+#if defined(HAVE_AVX) && defined(HAVE_FMA)
+	MAKE(F32, 1, mix_gain_f32_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
+	MAKE(F32P, 1, mix_gain_f32_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
+#endif
+#if defined (HAVE_SSE)
+	MAKE(F32, 1, mix_gain_f32_sse, SPA_CPU_FLAG_SSE),
+	MAKE(F32P, 1, mix_gain_f32_sse, SPA_CPU_FLAG_SSE),
+#endif
+	MAKE(F32, 0, mix_gain_f32_c),
+	MAKE(F32P, 0, mix_gain_f32_c),
 };
+#undef MAKE
 
 #define MATCH_CHAN(a,b)		((a) == 0 || (a) == (b))
 #define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
@@ -87,6 +141,79 @@ static const struct mix_info *find_mix_info(uint32_t fmt,
 	return NULL;
 }
 
+static const struct mix_gain_info *find_mix_gain_info(uint32_t fmt,
+		uint32_t n_channels, uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(mix_gain_table, t) {
+		if (t->fmt == fmt &&
+		    MATCH_CHAN(t->n_channels, n_channels) &&
+		    MATCH_CPU_FLAGS(t->cpu_flags, cpu_flags))
+			return t;
+	}
+	return NULL;
+}
+
+#define MAX_CANDIDATES	8
+#define CALIBRATE_SRC	4
+
+struct mix_calibrate {
+	struct mix_ops *ops;
+	const struct mix_info *info[MAX_CANDIDATES];
+	const void *src[CALIBRATE_SRC];
+	void *dst;
+};
+
+static void run_mix_info(void *data, uint32_t index)
+{
+	struct mix_calibrate *c = data;
+	c->info[index]->process(c->ops, c->dst, c->src, CALIBRATE_SRC, CALIBRATE_SAMPLES);
+}
+
+/* time all the mix functions that the cpu supports and return the
+ * fastest one */
+static const struct mix_info *calibrate_mix_info(struct mix_ops *ops,
+		const struct mix_info *info)
+{
+	struct mix_calibrate c;
+	struct calibrate_candidate candidates[MAX_CANDIDATES];
+	uint32_t i, n_candidates = 0;
+	size_t size;
+	char key[64];
+	void *mem;
+
+	SPA_FOR_EACH_ELEMENT_VAR(mix_table, t) {
+		if (t->fmt != ops->fmt ||
+		    !MATCH_CHAN(t->n_channels, ops->n_channels) ||
+		    !MATCH_CPU_FLAGS(t->cpu_flags, ops->cpu_flags) ||
+		    n_candidates == MAX_CANDIDATES)
+			continue;
+		c.info[n_candidates] = t;
+		candidates[n_candidates++] = (struct calibrate_candidate) {
+			.name = t->name,
+			.cpu_flags = t->cpu_flags,
+		};
+	}
+	if (n_candidates < 2)
+		return info;
+
+	size = SPA_ROUND_UP(CALIBRATE_SAMPLES * ops->n_channels * info->stride,
+			MIX_OPS_MAX_ALIGN);
+	if ((mem = calloc(CALIBRATE_SRC + 1, size + MIX_OPS_MAX_ALIGN)) == NULL)
+		return info;
+
+	c.ops = ops;
+	c.dst = SPA_PTR_ALIGN(mem, MIX_OPS_MAX_ALIGN, void);
+	for (i = 0; i < CALIBRATE_SRC; i++)
+		c.src[i] = SPA_PTROFF(c.dst, (i + 1) * size, void);
+
+	spa_scnprintf(key, sizeof(key), "mix-%u-%u", ops->fmt, ops->n_channels);
+	info = c.info[calibrate_select(ops->log, key, candidates, n_candidates,
+				run_mix_info, &c)];
+	free(mem);
+
+	return info;
+}
+
 static void impl_mix_ops_clear(struct mix_ops *ops, void * SPA_RESTRICT dst, uint32_t n_samples)
 {
 	const struct mix_info *info = ops->priv;
@@ -101,15 +228,23 @@ static void impl_mix_ops_free(struct mix_ops *ops)
 int mix_ops_init(struct mix_ops *ops)
 {
 	const struct mix_info *info;
+	const struct mix_gain_info *gain_info;
 
 	info = find_mix_info(ops->fmt, ops->n_channels, ops->cpu_flags);
 	if (info == NULL)
 		return -ENOTSUP;
 
+	gain_info = find_mix_gain_info(ops->fmt, ops->n_channels, ops->cpu_flags);
+
+	if (ops->calibrate)
+		info = calibrate_mix_info(ops, info);
+
 	ops->priv = info;
 	ops->cpu_flags = info->cpu_flags;
+	ops->func_name = info->name;
 	ops->clear = impl_mix_ops_clear;
 	ops->process = info->process;
+	ops->process_gain = gain_info ? gain_info->process : NULL;
 	ops->free = impl_mix_ops_free;
 
 	return 0;
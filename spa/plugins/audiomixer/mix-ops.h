@@ -97,16 +97,40 @@ static inline int24_t s32_to_s24(int32_t src)
 #define F64_ACCUM(a,b)		((a) + (b))
 #define F64_CLAMP(a)		(a)
 
+/** gain of one source for a mix_ops process_gain call */
+struct mix_gain {
+	float gain;		/**< gain of the first frame */
+	float delta;		/**< gain change per frame while ramping */
+	uint32_t n_ramp;	/**< number of frames to ramp, the gain stays at
+				  *  gain + n_ramp * delta after that */
+};
+
+static inline float mix_gain_at(const struct mix_gain *g, uint32_t n)
+{
+	return g->gain + g->delta * (float)SPA_MIN(n, g->n_ramp);
+}
+
 struct mix_ops {
 	uint32_t fmt;
 	uint32_t n_channels;
 	uint32_t cpu_flags;
+	const char *func_name;
+
+	struct spa_log *log;
+
+	unsigned int calibrate:1;	/**< time the candidate kernels */
 
 	void (*clear) (struct mix_ops *ops, void * SPA_RESTRICT dst, uint32_t n_samples);
 	void (*process) (struct mix_ops *ops,
 			void * SPA_RESTRICT dst,
 			const void * SPA_RESTRICT src[], uint32_t n_src,
 			uint32_t n_samples);
+	/** like process but multiply each source with its gain, NULL when the
+	 * format has no gain function */
+	void (*process_gain) (struct mix_ops *ops,
+			void * SPA_RESTRICT dst,
+			const void * SPA_RESTRICT src[], const struct mix_gain gain[],
+			uint32_t n_src, uint32_t n_samples);
 	void (*free) (struct mix_ops *ops);
 
 	const void *priv;
@@ -116,6 +140,7 @@ int mix_ops_init(struct mix_ops *ops);
 
 #define mix_ops_clear(ops,...)		(ops)->clear(ops, __VA_ARGS__)
 #define mix_ops_process(ops,...)	(ops)->process(ops, __VA_ARGS__)
+#define mix_ops_process_gain(ops,...)	(ops)->process_gain(ops, __VA_ARGS__)
 #define mix_ops_free(ops)		(ops)->free(ops)
 
 #define DEFINE_FUNCTION(name,arch) \
@@ -123,6 +148,11 @@ void mix_##name##_##arch(struct mix_ops *ops, void * SPA_RESTRICT dst,	\
 		const void * SPA_RESTRICT src[], uint32_t n_src,		\
 		uint32_t n_samples)						\
 
+#define DEFINE_GAIN_FUNCTION(name,arch) \
+void mix_gain_##name##_##arch(struct mix_ops *ops, void * SPA_RESTRICT dst,	\
+		const void * SPA_RESTRICT src[], const struct mix_gain gain[],	\
+		uint32_t n_src, uint32_t n_samples)				\
+
 #define MIX_OPS_MAX_ALIGN	32
 
 DEFINE_FUNCTION(s8, c);
@@ -137,13 +167,26 @@ DEFINE_FUNCTION(s24_32, c);
 DEFINE_FUNCTION(u24_32, c);
 DEFINE_FUNCTION(f32, c);
 DEFINE_FUNCTION(f64, c);
+DEFINE_GAIN_FUNCTION(f32, c);
 
 #if defined(HAVE_SSE)
 DEFINE_FUNCTION(f32, sse);
+DEFINE_GAIN_FUNCTION(f32, sse);
 #endif
 #if defined(HAVE_SSE2)
 DEFINE_FUNCTION(f64, sse2);
 #endif
 #if defined(HAVE_AVX)
 DEFINE_FUNCTION(f32, avx);
+DEFINE_GAIN_FUNCTION(f32, avx);
+#endif
+#if defined(HAVE_AVX512)
+DEFINE_FUNCTION(f32, avx512);
+#endif
+#if defined(HAVE_NEON)
+DEFINE_FUNCTION(f32, neon);
+DEFINE_FUNCTION(s16, neon);
+#if defined(__aarch64__)
+DEFINE_FUNCTION(f64, neon);
+#endif
 #endif
@@ -18,6 +18,7 @@
 #include <spa/node/io.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/param.h>
+#include <spa/param/props.h>
 #include <spa/pod/filter.h>
 
 #include "mix-ops.h"
@@ -32,16 +33,19 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.mixer-dsp");
 
 #define PORT_DEFAULT_VOLUME	1.0
 #define PORT_DEFAULT_MUTE	false
+#define PORT_DEFAULT_RAMP_SAMPLES	0
 
 struct port_props {
-	double volume;
-	int32_t mute;
+	float volume;
+	bool mute;
+	uint32_t ramp_samples;
 };
 
 static void port_props_reset(struct port_props *props)
 {
 	props->volume = PORT_DEFAULT_VOLUME;
 	props->mute = PORT_DEFAULT_MUTE;
+	props->ramp_samples = PORT_DEFAULT_RAMP_SAMPLES;
 }
 
 struct buffer {
@@ -61,6 +65,11 @@ struct port {
 
 	struct port_props props;
 
+	/* gain state, only used in the data loop */
+	float gain;
+	float target;
+	uint32_t ramp;
+
 	struct spa_io_buffers *io[2];
 
 	uint64_t info_all;
@@ -89,6 +98,7 @@ struct impl {
 	struct spa_loop *data_loop;
 
 	uint32_t quantum_limit;
+	unsigned int calibrate:1;
 
 	struct mix_ops ops;
 
@@ -107,6 +117,8 @@ struct impl {
 
 	struct buffer *mix_buffers[MAX_PORTS];
 	const void *mix_datas[MAX_PORTS];
+	struct port *mix_ports[MAX_PORTS];
+	struct mix_gain mix_gains[MAX_PORTS];
 
 	int n_formats;
 	struct spa_audio_info format;
@@ -252,6 +264,8 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	port->id = port_id;
 
 	port_props_reset(&port->props);
+	port->gain = port->target = 1.0f;
+	port->ramp = 0;
 
 	spa_list_init(&port->queue);
 	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
@@ -266,8 +280,9 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	port->params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
 	port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
 	port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->params[5] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
 	port->info.params = port->params;
-	port->info.n_params = 5;
+	port->info.n_params = 6;
 
 	this->port_count++;
 	if (this->last_port <= port_id)
@@ -416,6 +431,19 @@ next:
 		}
 		break;
 
+	case SPA_PARAM_Props:
+		if (port == NULL || port->direction != SPA_DIRECTION_INPUT)
+			return -ENOENT;
+		if (result.index > 0)
+			return 0;
+
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Props, id,
+			SPA_PROP_volume,		SPA_POD_Float(port->props.volume),
+			SPA_PROP_mute,			SPA_POD_Bool(port->props.mute),
+			SPA_PROP_volumeRampSamples,	SPA_POD_Int(port->props.ramp_samples));
+		break;
+
 	case SPA_PARAM_IO:
 		switch (result.index) {
 		case 0:
@@ -525,10 +553,16 @@ static int port_set_format(void *object,
 			this->ops.fmt = info.info.dsp.format;
 			this->ops.n_channels = 1;
 			this->ops.cpu_flags = this->cpu_flags;
+			this->ops.log = this->log;
+			this->ops.calibrate = this->calibrate;
 
 			if ((res = mix_ops_init(&this->ops)) < 0)
 				return res;
 
+			spa_log_debug(this->log, "%p: got mixer features %08x:%08x %s",
+					this, this->cpu_flags, this->ops.cpu_flags,
+					this->ops.func_name);
+
 			this->stride = sizeof(float);
 			this->have_format = true;
 			this->format = info;
@@ -553,6 +587,47 @@ static int port_set_format(void *object,
 	return 0;
 }
 
+static int do_port_set_props(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct port *port = user_data;
+
+	port->target = port->props.mute ? 0.0f : port->props.volume;
+	port->ramp = port->props.ramp_samples;
+	if (port->ramp == 0)
+		port->gain = port->target;
+	return 0;
+}
+
+static int port_set_props(struct impl *this, struct port *port,
+		const struct spa_pod *param)
+{
+	struct port_props *p = &port->props;
+	int32_t ramp_samples = p->ramp_samples;
+
+	if (param == NULL) {
+		port_props_reset(p);
+	} else {
+		if (spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_Props, NULL,
+				SPA_PROP_volume,		SPA_POD_OPT_Float(&p->volume),
+				SPA_PROP_mute,			SPA_POD_OPT_Bool(&p->mute),
+				SPA_PROP_volumeRampSamples,	SPA_POD_OPT_Int(&ramp_samples)) < 0)
+			return -EINVAL;
+		p->ramp_samples = SPA_MAX(ramp_samples, 0);
+	}
+	spa_log_debug(this->log, "%p: port %d volume:%f mute:%d ramp:%u", this,
+			port->id, p->volume, p->mute, p->ramp_samples);
+
+	spa_loop_invoke(this->data_loop,
+			do_port_set_props, SPA_ID_INVALID, NULL, 0, true, port);
+
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	port->params[5].user++;
+	emit_port_info(this, port, false);
+
+	return 0;
+}
 
 static int
 impl_node_port_set_param(void *object,
@@ -565,11 +640,16 @@ impl_node_port_set_param(void *object,
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
 
-	if (id == SPA_PARAM_Format) {
+	switch (id) {
+	case SPA_PARAM_Format:
 		return port_set_format(this, direction, port_id, flags, param);
-	}
-	else
+	case SPA_PARAM_Props:
+		if (direction != SPA_DIRECTION_INPUT)
+			return -ENOENT;
+		return port_set_props(this, GET_IN_PORT(this, port_id), param);
+	default:
 		return -ENOENT;
+	}
 }
 
 static int
@@ -704,6 +784,22 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return queue_buffer(this, port, &port->buffers[buffer_id]);
 }
 
+/* get the gain of the port for the next n_samples and advance its ramp */
+static void port_get_gain(struct port *port, struct mix_gain *g, uint32_t n_samples)
+{
+	g->gain = port->gain;
+	if (port->ramp > 0) {
+		g->n_ramp = SPA_MIN(port->ramp, n_samples);
+		g->delta = (port->target - port->gain) / port->ramp;
+		port->ramp -= g->n_ramp;
+		port->gain = port->ramp == 0 ? port->target :
+			port->gain + g->delta * g->n_ramp;
+	} else {
+		g->delta = 0.0f;
+		g->n_ramp = 0;
+	}
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -713,6 +809,8 @@ static int impl_node_process(void *object)
 	struct buffer **buffers;
 	struct buffer *outb;
 	const void **datas;
+	struct port **ports;
+	bool unity = true;
 	uint32_t cycle = this->position->clock.cycle & 1;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
@@ -735,6 +833,7 @@ static int impl_node_process(void *object)
 
 	buffers = this->mix_buffers;
 	datas = this->mix_datas;
+	ports = this->mix_ports;
 	n_buffers = 0;
 
 	maxsize = UINT32_MAX;
@@ -772,8 +871,13 @@ static int impl_node_process(void *object)
 				offs, size, (int)sizeof(float),
 				bd->chunk->flags);
 
-		if (!SPA_FLAG_IS_SET(bd->chunk->flags, SPA_CHUNK_FLAG_EMPTY)) {
+		/* muted ports are skipped like empty ones */
+		if (!SPA_FLAG_IS_SET(bd->chunk->flags, SPA_CHUNK_FLAG_EMPTY) &&
+		    (inport->gain != 0.0f || inport->ramp > 0)) {
+			if (inport->gain != 1.0f || inport->ramp > 0)
+				unity = false;
 			datas[n_buffers] = SPA_PTROFF(bd->data, offs, void);
+			ports[n_buffers] = inport;
 			buffers[n_buffers++] = inb;
 		}
 		inio->status = SPA_STATUS_NEED_DATA;
@@ -787,10 +891,11 @@ static int impl_node_process(void *object)
 		return -EPIPE;
 	}
 
-	if (n_buffers == 1) {
+	if (n_buffers == 1 && unity) {
 		*outb->buffer = *buffers[0]->buffer;
 	} else {
 		struct spa_data *d = outb->buf.datas;
+		uint32_t n_samples;
 
 		*outb->buffer = outb->buf;
 
@@ -803,8 +908,17 @@ static int impl_node_process(void *object)
 
 		spa_log_trace_fp(this->log, "%p: %d mix %d", this, n_buffers, maxsize);
 
-		mix_ops_process(&this->ops, d[0].data,
-				datas, n_buffers, maxsize / sizeof(float));
+		n_samples = maxsize / sizeof(float);
+		if (unity) {
+			mix_ops_process(&this->ops, d[0].data,
+					datas, n_buffers, n_samples);
+		} else {
+			for (i = 0; i < n_buffers; i++)
+				port_get_gain(ports[i], &this->mix_gains[i], n_samples);
+
+			mix_ops_process_gain(&this->ops, d[0].data,
+					datas, this->mix_gains, n_buffers, n_samples);
+		}
 	}
 
 	outio->buffer_id = outb->id;
@@ -908,6 +1022,8 @@ impl_init(const struct spa_handle_factory *factory,
 		const char *s = info->items[i].value;
 		if (spa_streq(k, "clock.quantum-limit"))
 			spa_atou32(s, &this->quantum_limit, 0);
+		else if (spa_streq(k, "cpu.calibrate"))
+			this->calibrate = spa_atob(s);
 	}
 
 	spa_hook_list_init(&this->hooks);
@@ -93,6 +93,13 @@ static void test_s16(void)
 	run_test("test_s16_0", NULL, 0, out, sizeof(out), SPA_N_ELEMENTS(out), mix_s16_c);
 	run_test("test_s16_1", src, 1, in_1, sizeof(in_1), SPA_N_ELEMENTS(in_1), mix_s16_c);
 	run_test("test_s16_4", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_s16_c);
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s16_0_neon", NULL, 0, out, sizeof(out), SPA_N_ELEMENTS(out), mix_s16_neon);
+		run_test("test_s16_1_neon", src, 1, in_1, sizeof(in_1), SPA_N_ELEMENTS(in_1), mix_s16_neon);
+		run_test("test_s16_4_neon", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_s16_neon);
+	}
+#endif
 }
 
 static void test_u16(void)
@@ -227,6 +234,119 @@ static void test_f32(void)
 		run_test("test_f32_4_avx", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_f32_avx);
 	}
 #endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32_0_avx512", NULL, 0, out, sizeof(out), SPA_N_ELEMENTS(out), mix_f32_avx512);
+		run_test("test_f32_1_avx512", src, 1, in_1, sizeof(in_1), SPA_N_ELEMENTS(in_1), mix_f32_avx512);
+		run_test("test_f32_4_avx512", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_f32_avx512);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32_0_neon", NULL, 0, out, sizeof(out), SPA_N_ELEMENTS(out), mix_f32_neon);
+		run_test("test_f32_1_neon", src, 1, in_1, sizeof(in_1), SPA_N_ELEMENTS(in_1), mix_f32_neon);
+		run_test("test_f32_4_neon", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_f32_neon);
+	}
+#endif
+}
+
+#define N_MANY_SRC	11
+#define N_MANY		1021
+
+/* many sources with unaligned pointers and a tail. The values add up
+ * exactly so the order of the additions does not matter. */
+static void test_f32_many(void)
+{
+	static float in[N_MANY_SRC][N_MANY + 1], out[N_MANY];
+	const void *src[N_MANY_SRC];
+	uint32_t i, n, n_src;
+
+	for (i = 0; i < N_MANY_SRC; i++) {
+		for (n = 0; n < N_MANY + 1; n++)
+			in[i][n] = (float)((int)((i * 7 + n) % 17) - 8) * 0.125f;
+		src[i] = &in[i][i & 1];
+	}
+	for (n_src = 2; n_src <= N_MANY_SRC; n_src++) {
+		mix_f32_c(&(struct mix_ops) { .n_channels = 1 }, out, src, n_src, N_MANY);
+
+#if defined(HAVE_SSE)
+		if (cpu_flags & SPA_CPU_FLAG_SSE)
+			run_test("test_f32_many_sse", src, n_src, out, sizeof(out), N_MANY, mix_f32_sse);
+#endif
+#if defined(HAVE_AVX)
+		if (cpu_flags & SPA_CPU_FLAG_AVX)
+			run_test("test_f32_many_avx", src, n_src, out, sizeof(out), N_MANY, mix_f32_avx);
+#endif
+#if defined(HAVE_AVX512)
+		if (cpu_flags & SPA_CPU_FLAG_AVX512)
+			run_test("test_f32_many_avx512", src, n_src, out, sizeof(out), N_MANY, mix_f32_avx512);
+#endif
+#if defined(HAVE_NEON)
+		if (cpu_flags & SPA_CPU_FLAG_NEON)
+			run_test("test_f32_many_neon", src, n_src, out, sizeof(out), N_MANY, mix_f32_neon);
+#endif
+	}
+}
+
+static void run_test_gain(const char *name, const void *src[], const struct mix_gain gain[],
+		uint32_t n_src, const float *dst, uint32_t n_samples, mix_gain_func_t mix)
+{
+	struct mix_ops ops;
+	float *out = (float *)samp_out;
+	uint32_t n;
+
+	ops.fmt = SPA_AUDIO_FORMAT_F32;
+	ops.n_channels = 1;
+	ops.cpu_flags = cpu_flags;
+	mix_ops_init(&ops);
+
+	fprintf(stderr, "%s\n", name);
+
+	mix(&ops, out, src, gain, n_src, n_samples);
+	for (n = 0; n < n_samples; n++) {
+		if (fabsf(out[n] - dst[n]) > 1e-5f) {
+			fprintf(stderr, "%d: %f != %f\n", n, out[n], dst[n]);
+			spa_assert_not_reached();
+		}
+	}
+}
+
+/* a constant gain, a ramp that ends inside the buffer and one that
+ * goes on past the end, on unaligned sources with a tail */
+static void test_f32_gain(void)
+{
+	static float in[3][N_MANY + 1], out[N_MANY];
+	const struct mix_gain gain[3] = {
+		{ .gain = 0.5f },
+		{ .gain = 0.0f, .delta = 1.0f / 100.0f, .n_ramp = 100 },
+		{ .gain = 1.0f, .delta = -0.5f / 2048.0f, .n_ramp = 2048 },
+	};
+	const void *src[3];
+	uint32_t i, n, n_src;
+
+	for (i = 0; i < 3; i++) {
+		for (n = 0; n < N_MANY + 1; n++)
+			in[i][n] = (float)((int)((i * 7 + n) % 17) - 8) * 0.125f;
+		src[i] = &in[i][i & 1];
+	}
+	for (n_src = 0; n_src <= 3; n_src++) {
+		for (n = 0; n < N_MANY; n++) {
+			double ac = 0.0;
+			for (i = 0; i < n_src; i++)
+				ac += ((const float *)src[i])[n] *
+					(gain[i].gain + gain[i].delta * SPA_MIN(n, gain[i].n_ramp));
+			out[n] = (float)ac;
+		}
+		run_test_gain("test_f32_gain", src, gain, n_src, out, N_MANY, mix_gain_f32_c);
+#if defined(HAVE_SSE)
+		if (cpu_flags & SPA_CPU_FLAG_SSE)
+			run_test_gain("test_f32_gain_sse", src, gain, n_src, out, N_MANY, mix_gain_f32_sse);
+#endif
+#if defined(HAVE_AVX) && defined(HAVE_FMA)
+		if ((cpu_flags & SPA_CPU_FLAG_AVX) && (cpu_flags & SPA_CPU_FLAG_FMA3))
+			run_test_gain("test_f32_gain_avx", src, gain, n_src, out, N_MANY, mix_gain_f32_avx);
+#endif
+	}
 }
 
 static void test_f64(void)
@@ -249,6 +369,13 @@ static void test_f64(void)
 		run_test("test_f64_4_sse2", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_f64_sse2);
 	}
 #endif
+#if defined(HAVE_NEON) && defined(__aarch64__)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f64_0_neon", NULL, 0, out, sizeof(out), SPA_N_ELEMENTS(out), mix_f64_neon);
+		run_test("test_f64_1_neon", src, 1, in_1, sizeof(in_1), SPA_N_ELEMENTS(in_1), mix_f64_neon);
+		run_test("test_f64_4_neon", src, 4, out_4, sizeof(out_4), SPA_N_ELEMENTS(out_4), mix_f64_neon);
+	}
+#endif
 }
 
 int main(int argc, char *argv[])
@@ -267,6 +394,8 @@ int main(int argc, char *argv[])
 	test_s24_32();
 	test_u24_32();
 	test_f32();
+	test_f32_many();
+	test_f32_gain();
 	test_f64();
 
 	return 0;
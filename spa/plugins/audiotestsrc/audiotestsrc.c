@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
@@ -64,6 +65,20 @@ static void reset_props(struct props *props)
 #define MAX_BUFFERS	16
 #define MAX_PORTS	1
 
+#define WAVE_TABLE_SIZE	4096
+
+/* synthetic load, to reproduce the cost of real nodes in a graph. Configured
+ * with the load.busy-usec, load.jitter-usec, load.memory-size and
+ * load.memory-stride properties. */
+struct load {
+	uint64_t busy;			/* busy time per cycle in nsec */
+	uint64_t jitter;		/* extra random busy time per cycle in nsec */
+	uint32_t memory_size;		/* bytes of memory to touch per cycle */
+	uint32_t memory_stride;		/* distance between touched bytes */
+	uint8_t *memory;
+	uint32_t seed;
+};
+
 struct buffer {
 	uint32_t id;
 	struct spa_buffer *outbuf;
@@ -126,6 +141,9 @@ struct impl {
 
 	uint64_t sample_count;
 
+	struct load load;
+	float wave_table[WAVE_TABLE_SIZE + 1];
+
 	struct port port;
 };
 
@@ -310,6 +328,35 @@ static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
 
 #include "render.c"
 
+static uint64_t get_time_ns(struct impl *this)
+{
+	struct timespec now;
+	spa_system_clock_gettime(this->data_system, CLOCK_MONOTONIC, &now);
+	return SPA_TIMESPEC_TO_NSEC(&now);
+}
+
+static void generate_load(struct impl *this)
+{
+	struct load *l = &this->load;
+	uint64_t start, busy;
+	uint32_t i;
+
+	if (l->busy == 0 && l->jitter == 0 && l->memory == NULL)
+		return;
+
+	start = get_time_ns(this);
+
+	for (i = 0; i < l->memory_size; i += l->memory_stride)
+		l->memory[i]++;
+
+	busy = l->busy;
+	if (l->jitter > 0) {
+		l->seed = l->seed * 1103515245u + 12345u;
+		busy += (l->seed >> 8) % (l->jitter + 1);
+	}
+	while (get_time_ns(this) - start < busy);
+}
+
 static void set_timer(struct impl *this, bool enabled)
 {
 	if (this->async || this->props.live) {
@@ -409,6 +456,8 @@ static int make_buffer(struct impl *this)
 	if (l1 > 0)
 		port->render_func(this, data, l1);
 
+	generate_load(this);
+
 	d[0].chunk->offset = index;
 	d[0].chunk->size = n_bytes;
 	d[0].chunk->stride = port->bpf;
@@ -1015,6 +1064,7 @@ static int impl_clear(struct spa_handle *handle)
 	if (this->data_loop)
 		spa_loop_invoke(this->data_loop, do_remove_timer, 0, NULL, 0, true, this);
 	spa_system_close(this->data_system, this->timer_source.fd);
+	free(this->load.memory);
 
 	return 0;
 }
@@ -1049,12 +1099,33 @@ impl_init(const struct spa_handle_factory *factory,
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
 
+	this->load.memory_stride = 64;
+
 	for (i = 0; info && i < info->n_items; i++) {
 		const char *k = info->items[i].key;
 		const char *s = info->items[i].value;
 		if (spa_streq(k, "clock.quantum-limit"))
 			spa_atou32(s, &this->quantum_limit, 0);
+		else if (spa_streq(k, "load.busy-usec"))
+			spa_atou64(s, &this->load.busy, 0);
+		else if (spa_streq(k, "load.jitter-usec"))
+			spa_atou64(s, &this->load.jitter, 0);
+		else if (spa_streq(k, "load.memory-size"))
+			spa_atou32(s, &this->load.memory_size, 0);
+		else if (spa_streq(k, "load.memory-stride"))
+			spa_atou32(s, &this->load.memory_stride, 0);
 	}
+	this->load.busy *= SPA_NSEC_PER_USEC;
+	this->load.jitter *= SPA_NSEC_PER_USEC;
+	if (this->load.memory_size > 0) {
+		this->load.memory_stride = SPA_MAX(this->load.memory_stride, 1u);
+		this->load.memory = calloc(1, this->load.memory_size);
+		if (this->load.memory == NULL)
+			return -errno;
+	}
+	this->load.seed = (uint32_t)(uintptr_t)this;
+	fill_wave_table(this->wave_table);
+
 	spa_hook_list_init(&this->hooks);
 
 	this->node.iface = SPA_INTERFACE_INIT(
@@ -6,6 +6,14 @@
 
 #define M_PI_M2f (float)(M_PI+M_PI)
 
+static void fill_wave_table(float *table)
+{
+	uint32_t i;
+	/* one period of the sine with an extra point for the interpolation */
+	for (i = 0; i <= WAVE_TABLE_SIZE; i++)
+		table[i] = sinf(M_PI_M2f * i / WAVE_TABLE_SIZE);
+}
+
 #define DEFINE_SINE(type,scale)								\
 static void										\
 audio_test_src_create_sine_##type (struct impl *this, type *samples, size_t n_samples)	\
@@ -15,17 +23,23 @@ audio_test_src_create_sine_##type (struct impl *this, type *samples, size_t n_sa
 	float step, amp;								\
 	float freq = this->props.freq;							\
 	float volume = this->props.volume;						\
+	const float *table = this->wave_table;						\
 											\
 	channels = this->port.current_format.info.raw.channels;				\
-	step = M_PI_M2f * freq / this->port.current_format.info.raw.rate;		\
+	step = fmodf(WAVE_TABLE_SIZE * freq / this->port.current_format.info.raw.rate,	\
+			WAVE_TABLE_SIZE);						\
 	amp = volume * scale;								\
 											\
 	for (i = 0; i < n_samples; i++) {						\
 		type val;								\
+		uint32_t idx;								\
+		float frac;								\
 		this->port.accumulator += step;						\
-		if (this->port.accumulator >= M_PI_M2f)					\
-			this->port.accumulator -= M_PI_M2f;				\
-		val = (type) (sin (this->port.accumulator) * amp);			\
+		if (this->port.accumulator >= WAVE_TABLE_SIZE)				\
+			this->port.accumulator -= WAVE_TABLE_SIZE;			\
+		idx = (uint32_t) this->port.accumulator;				\
+		frac = this->port.accumulator - idx;					\
+		val = (type) ((table[idx] + (table[idx + 1] - table[idx]) * frac) * amp); \
 		for (c = 0; c < channels; ++c)						\
 			*samples++ = val;						\
 	}										\
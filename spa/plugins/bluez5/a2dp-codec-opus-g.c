@@ -24,9 +24,13 @@
 
 #include "rtp.h"
 #include "media-codecs.h"
+#include "codec-complexity.h"
 
 static struct spa_log *log;
 
+#define COMPLEXITY_MIN		3
+#define COMPLEXITY_MAX		10
+
 struct dec_data {
 };
 
@@ -39,6 +43,8 @@ struct enc_data {
 	int frame_dms;
 	int bitrate;
 	int packet_size;
+
+	struct spa_bt_complexity complexity;
 };
 
 struct impl {
@@ -336,6 +342,10 @@ static void *codec_init(const struct media_codec *codec, uint32_t flags,
 
 	opus_encoder_ctl(this->enc, OPUS_SET_BITRATE(this->e.bitrate));
 
+	spa_bt_complexity_init(&this->e.complexity, COMPLEXITY_MIN, COMPLEXITY_MAX,
+			COMPLEXITY_MAX, SPA_BT_COMPLEXITY_WINDOW);
+	opus_encoder_ctl(this->enc, OPUS_SET_COMPLEXITY(this->e.complexity.value));
+
 	/*
 	 * Setup decoder
 	 */
@@ -406,6 +416,7 @@ static int codec_encode(void *data,
 		size_t *dst_out, int *need_flush)
 {
 	struct impl *this = data;
+	uint64_t start;
 	int res;
 
 	if (src_size < (size_t)this->e.codesize) {
@@ -417,10 +428,17 @@ static int codec_encode(void *data,
 
 	dst_size = SPA_MIN(dst_size, (size_t)(this->mtu - this->e.packet_size));
 
+	start = spa_bt_complexity_now();
 	res = opus_encode_float(this->enc, src, this->e.samples, dst, dst_size);
 	if (res < 0)
 		return -EINVAL;
 
+	if (spa_bt_complexity_update(&this->e.complexity, this->e.frame_dms * 100000ULL,
+					spa_bt_complexity_now() - start)) {
+		spa_log_debug(log, "opus-g complexity:%d", this->e.complexity.value);
+		opus_encoder_ctl(this->enc, OPUS_SET_COMPLEXITY(this->e.complexity.value));
+	}
+
 	*dst_out = res;
 
 	this->e.packet_size += res;
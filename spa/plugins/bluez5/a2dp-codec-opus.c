@@ -25,6 +25,7 @@
 
 #include "rtp.h"
 #include "media-codecs.h"
+#include "codec-complexity.h"
 
 static struct spa_log *log;
 
@@ -62,6 +63,14 @@ static struct spa_log *log;
 
 #define OPUS_05_MAX_BYTES	(15 * 1024)
 
+/*
+ * Encoder complexity range. Starts at the Opus default and is lowered
+ * when encoding takes too much of the real-time budget, e.g. for
+ * surround streams on slow devices.
+ */
+#define COMPLEXITY_MIN		3
+#define COMPLEXITY_MAX		10
+
 struct props {
 	uint32_t channels;
 	uint32_t coupled_streams;
@@ -121,6 +130,8 @@ struct enc_data {
 
 	int frame_dms;
 	int application;
+
+	struct spa_bt_complexity complexity;
 };
 
 struct impl {
@@ -1004,6 +1015,10 @@ static void *codec_init(const struct media_codec *codec, uint32_t flags,
 	this->e.next_bitrate = this->e.bitrate;
 	opus_multistream_encoder_ctl(this->enc, OPUS_SET_BITRATE(this->e.bitrate));
 
+	spa_bt_complexity_init(&this->e.complexity, COMPLEXITY_MIN, COMPLEXITY_MAX,
+			COMPLEXITY_MAX, SPA_BT_COMPLEXITY_WINDOW);
+	opus_multistream_encoder_ctl(this->enc, OPUS_SET_COMPLEXITY(this->e.complexity.value));
+
 	this->e.samples = this->e.frame_dms * this->samplerate / 10000;
 	this->e.codesize = this->e.samples * (int)this->channels * sizeof(float);
 
@@ -1100,6 +1115,7 @@ static int codec_encode(void *data,
 {
 	struct impl *this = data;
 	const int header_size = sizeof(struct rtp_header) + sizeof(struct rtp_payload);
+	uint64_t start;
 	int size;
 	int res;
 
@@ -1141,12 +1157,19 @@ static int codec_encode(void *data,
 		return 0;
 	}
 
+	start = spa_bt_complexity_now();
 	res = opus_multistream_encode_float(
 		this->enc, src, this->e.samples, dst, dst_size);
 	if (res < 0)
 		return -EINVAL;
 	*dst_out = res;
 
+	if (spa_bt_complexity_update(&this->e.complexity, this->e.frame_dms * 100000ULL,
+					spa_bt_complexity_now() - start)) {
+		spa_log_debug(log, "opus complexity:%d", this->e.complexity.value);
+		opus_multistream_encoder_ctl(this->enc, OPUS_SET_COMPLEXITY(this->e.complexity.value));
+	}
+
 	this->e.packet_size += res;
 	this->e.payload->frame_count++;
 
@@ -0,0 +1,96 @@
+/* Spa Bluez5 codec complexity control */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef SPA_BLUEZ5_CODEC_COMPLEXITY_H
+#define SPA_BLUEZ5_CODEC_COMPLEXITY_H
+
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+/**
+ * Encoder complexity control.
+ *
+ * Measures the time spent in the encoder against the duration of the
+ * audio it produced, over windows of \a window nsec. When the encoder
+ * uses more than half of the real-time budget the complexity is lowered
+ * right away, and it is raised again one step at a time after the load
+ * has stayed low for a few windows.
+ */
+struct spa_bt_complexity
+{
+	int value;
+	int min;
+	int max;
+
+	uint64_t window;
+	uint64_t duration;
+	uint64_t used;
+
+	uint32_t low_count;
+};
+
+#define SPA_BT_COMPLEXITY_WINDOW	(1 * SPA_NSEC_PER_SEC)
+#define SPA_BT_COMPLEXITY_HIGH		0.5
+#define SPA_BT_COMPLEXITY_LOW		0.2
+#define SPA_BT_COMPLEXITY_LOW_COUNT	5
+
+static inline void spa_bt_complexity_init(struct spa_bt_complexity *c,
+		int min, int max, int value, uint64_t window)
+{
+	spa_zero(*c);
+	c->min = min;
+	c->max = max;
+	c->value = SPA_CLAMP(value, min, max);
+	c->window = window;
+}
+
+static inline uint64_t spa_bt_complexity_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/**
+ * Account \a used nsec of encoding for \a duration nsec of audio.
+ *
+ * \return true when the complexity value changed
+ */
+static inline bool spa_bt_complexity_update(struct spa_bt_complexity *c,
+		uint64_t duration, uint64_t used)
+{
+	int value = c->value;
+	double load;
+
+	c->duration += duration;
+	c->used += used;
+	if (c->duration < c->window)
+		return false;
+
+	load = (double)c->used / c->duration;
+	c->duration = c->used = 0;
+
+	if (load > SPA_BT_COMPLEXITY_HIGH) {
+		/* way over the budget, back off faster */
+		value -= load > 2 * SPA_BT_COMPLEXITY_HIGH ? 2 : 1;
+		c->low_count = 0;
+	} else if (load < SPA_BT_COMPLEXITY_LOW) {
+		if (++c->low_count >= SPA_BT_COMPLEXITY_LOW_COUNT) {
+			value++;
+			c->low_count = 0;
+		}
+	} else {
+		c->low_count = 0;
+	}
+
+	value = SPA_CLAMP(value, c->min, c->max);
+	if (value == c->value)
+		return false;
+
+	c->value = value;
+	return true;
+}
+
+#endif
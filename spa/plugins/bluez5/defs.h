@@ -576,6 +576,9 @@ void spa_bt_sco_io_destroy(struct spa_bt_sco_io *io);
 void spa_bt_sco_io_set_source_cb(struct spa_bt_sco_io *io, int (*source_cb)(void *userdata, uint8_t *data, int size), void *userdata);
 void spa_bt_sco_io_set_sink_cb(struct spa_bt_sco_io *io, int (*sink_cb)(void *userdata), void *userdata);
 int spa_bt_sco_io_write(struct spa_bt_sco_io *io, uint8_t *data, int size);
+int spa_bt_sco_io_read(struct spa_bt_sco_io *io);
+void spa_bt_sco_io_set_batch(struct spa_bt_sco_io *io, bool batch);
+uint64_t spa_bt_sco_io_get_rx_time(struct spa_bt_sco_io *io);
 
 #define SPA_BT_VOLUME_ID_RX	0
 #define SPA_BT_VOLUME_ID_TX	1
@@ -59,6 +59,13 @@ struct stream {
 	const struct media_codec *codec;
 	uint32_t block_size;
 
+	/* Last encoded silence packet. Once encoding silence gives the same
+	 * packet twice, the encoder is in steady state and the packet is
+	 * reused without encoding. */
+	uint8_t silence[sizeof(((struct spa_bt_iso_io *)0)->buf)];
+	size_t silence_size;
+	bool silence_valid;
+
 	struct spa_bt_latency tx_latency;
 };
 
@@ -107,6 +114,12 @@ static int stream_silence(struct stream *stream)
 
 	stream->idle = true;
 
+	if (stream->silence_valid) {
+		memcpy(stream->this.buf, stream->silence, stream->silence_size);
+		stream->this.size = stream->silence_size;
+		return 0;
+	}
+
 	res = used = stream->codec->start_encode(stream->this.codec_data, stream->this.buf, max_size, 0, 0);
 	if (res < 0)
 		return res;
@@ -122,6 +135,14 @@ static int stream_silence(struct stream *stream)
 		return -EINVAL;
 
 	stream->this.size = used;
+
+	if (stream->silence_size == (size_t)used &&
+			memcmp(stream->silence, stream->this.buf, used) == 0) {
+		stream->silence_valid = true;
+	} else {
+		memcpy(stream->silence, stream->this.buf, used);
+		stream->silence_size = used;
+	}
 	return 0;
 }
 
@@ -282,6 +303,12 @@ static void group_on_timeout(struct spa_source *source)
 			stream->idle = false;
 			stream->this.now = group->next;
 			stream->pull(&stream->this);
+
+			/* encoder state moved on, silence must be encoded again */
+			if (stream->this.size > 0) {
+				stream->silence_valid = false;
+				stream->silence_size = 0;
+			}
 		} else {
 			stream_silence(stream);
 		}
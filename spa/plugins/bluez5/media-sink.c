@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <sys/ioctl.h>
 
@@ -12,7 +13,10 @@
 #include <spa/support/loop.h>
 #include <spa/support/log.h>
 #include <spa/support/system.h>
+#include <spa/support/thread.h>
+#include <spa/utils/atomic.h>
 #include <spa/utils/list.h>
+#include <spa/utils/ringbuffer.h>
 #include <spa/utils/keys.h>
 #include <spa/utils/names.h>
 #include <spa/utils/result.h>
@@ -65,6 +69,17 @@ struct props {
  * first cycle may have strange number of samples. */
 #define RESYNC_CYCLES 2
 
+/* Size of the input ring of the encoder thread, a power of 2 */
+#define ENCODER_RING_SIZE	(BUFFER_SIZE * 4)
+
+/* Bitrate control from the socket send queue, see abr_update(). The queue
+ * depth is in packets, between the low and high marks nothing is done. */
+#define ABR_LEVEL_HIGH		3.0f
+#define ABR_LEVEL_LOW		0.5f
+#define ABR_REDUCE_INTERVAL	(SPA_NSEC_PER_SEC / 2)
+#define ABR_HOLD_MIN		(1 * SPA_NSEC_PER_SEC)
+#define ABR_HOLD_MAX		(32 * SPA_NSEC_PER_SEC)
+
 struct buffer {
 	uint32_t id;
 #define BUFFER_FLAG_OUT	(1<<0)
@@ -112,6 +127,7 @@ struct impl {
 	struct spa_loop *data_loop;
 	struct spa_system *data_system;
 	struct spa_loop_utils *loop_utils;
+	struct spa_thread_utils *thread_utils;
 
 	struct spa_hook_list hooks;
 	struct spa_callbacks callbacks;
@@ -142,6 +158,7 @@ struct impl {
 
 	unsigned int is_duplex:1;
 	unsigned int is_internal:1;
+	unsigned int use_encoder_thread:1;
 
 	struct spa_source source;
 	int timerfd;
@@ -154,7 +171,6 @@ struct impl {
 
 	uint64_t current_time;
 	uint64_t next_time;
-	uint64_t last_error;
 	uint64_t process_time;
 	uint64_t process_duration;
 	uint64_t process_rate;
@@ -165,6 +181,18 @@ struct impl {
 	uint64_t packet_delay_ns;
 	struct spa_source *update_delay_event;
 
+	struct {
+		float level;		/* smoothed queue depth, in packets */
+		uint64_t delay_ns;	/* queue depth, in time */
+		uint64_t last_change;
+		uint64_t low_since;
+		uint64_t hold;
+		uint32_t n_reduce;
+		uint32_t n_increase;
+		uint32_t n_drop;
+	} abr;
+	struct spa_source *abr_event;
+
 	const struct media_codec *codec;
 	bool codec_props_changed;
 	void *codec_props;
@@ -185,6 +213,17 @@ struct impl {
 	uint8_t tmp_buffer[BUFFER_SIZE];
 	uint32_t tmp_buffer_used;
 	uint32_t fd_buffer_size;
+
+	/* With the encoder thread, the data loop only copies the input to the
+	 * ring and the thread does the encoding and flushing. */
+	struct {
+		struct spa_thread *thread;
+		int fd;
+		int running;
+		int error;
+		struct spa_ringbuffer ring;
+		uint8_t *data;
+	} enc;
 };
 
 #define CHECK_PORT(this,d,p)	((d) == SPA_DIRECTION_INPUT && (p) == 0)
@@ -400,7 +439,9 @@ static void set_latency(struct impl *this, bool emit_latency)
 
 	port->latency.min_ns = port->latency.max_ns = delay;
 	port->latency.min_rate = port->latency.max_rate = 0;
-	port->latency.min_quantum = port->latency.max_quantum = 0.0f;
+	/* the encoder thread works on the data of the previous cycle */
+	port->latency.min_quantum = port->latency.max_quantum =
+		this->use_encoder_thread ? 1.0f : 0.0f;
 
 	spa_log_info(this->log, "%p: total latency:%d ms", this, (int)(delay / SPA_NSEC_PER_MSEC));
 
@@ -434,6 +475,97 @@ static void update_packet_delay(struct impl *this, uint64_t delay)
 		spa_loop_utils_signal_event(this->loop_utils, this->update_delay_event);
 }
 
+static void abr_event(void *data, uint64_t count)
+{
+	struct impl *this = data;
+
+	/* in main loop */
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_PROPS;
+	emit_node_info(this, false);
+}
+
+static void abr_reset(struct impl *this)
+{
+	spa_zero(this->abr);
+	this->abr.hold = ABR_HOLD_MIN;
+}
+
+/*
+ * Adjust the codec bitrate from the socket send queue.
+ *
+ * The queue depth before each packet is smoothed with a fast attack and a
+ * slow release, so that congestion is acted on right away. When the queue
+ * grows over the high mark or a packet had to be dropped, the bitrate is
+ * reduced, at most every ABR_REDUCE_INTERVAL. When the queue stays under
+ * the low mark for the hold time, the bitrate is increased again. Each
+ * reduction doubles the hold time and each increase shortens it, so that
+ * a link that can't take the higher rate is not probed too often.
+ *
+ * Codecs with their own rate control in abr_process() are free to
+ * ignore the requests.
+ */
+static void abr_update(struct impl *this, uint64_t now_time, int queued,
+		uint32_t packet_size, uint64_t packet_time, bool dropped)
+{
+	float inst;
+	bool notify = false;
+	int res;
+
+	/* in data thread or encoder thread */
+
+	if (queued < 0 || packet_size == 0)
+		return;
+
+	inst = (float)queued / packet_size;
+	if (inst > this->abr.level)
+		this->abr.level = inst;
+	else
+		this->abr.level += (inst - this->abr.level) / 8.0f;
+
+	__atomic_store_n(&this->abr.delay_ns, queued * packet_time / packet_size,
+			__ATOMIC_RELAXED);
+
+	if (dropped)
+		__atomic_store_n(&this->abr.n_drop, this->abr.n_drop + 1, __ATOMIC_RELAXED);
+
+	if (dropped || this->abr.level > ABR_LEVEL_HIGH ||
+			(uint32_t)queued > this->fd_buffer_size / 2) {
+		this->abr.low_since = 0;
+		if (now_time - this->abr.last_change < ABR_REDUCE_INTERVAL)
+			return;
+
+		res = this->codec->reduce_bitpool(this->codec_data);
+		spa_log_debug(this->log, "%p: reduce bitpool: %i level:%.2f dropped:%d",
+				this, res, this->abr.level, dropped);
+
+		if (res >= 0)
+			__atomic_store_n(&this->abr.n_reduce, this->abr.n_reduce + 1,
+					__ATOMIC_RELAXED);
+		this->abr.last_change = now_time;
+		this->abr.hold = SPA_MIN(this->abr.hold * 2, ABR_HOLD_MAX);
+		notify = true;
+	} else if (this->abr.level >= ABR_LEVEL_LOW) {
+		this->abr.low_since = 0;
+	} else if (this->abr.low_since == 0) {
+		this->abr.low_since = now_time;
+	} else if (now_time - this->abr.low_since >= this->abr.hold &&
+			now_time - this->abr.last_change >= this->abr.hold) {
+		res = this->codec->increase_bitpool(this->codec_data);
+		spa_log_debug(this->log, "%p: increase bitpool: %i", this, res);
+
+		if (res >= 0)
+			__atomic_store_n(&this->abr.n_increase, this->abr.n_increase + 1,
+					__ATOMIC_RELAXED);
+		this->abr.last_change = now_time;
+		this->abr.low_since = now_time;
+		this->abr.hold = SPA_MAX(this->abr.hold / 2, ABR_HOLD_MIN);
+		notify = true;
+	}
+
+	if (notify && this->abr_event)
+		spa_loop_utils_signal_event(this->loop_utils, this->abr_event);
+}
+
 static int apply_props(struct impl *this, const struct spa_pod *param)
 {
 	struct props new_props = this->props;
@@ -742,6 +874,39 @@ static int add_data(struct impl *this, const void *data, uint32_t size)
 	return total;
 }
 
+/* Encode the data that the data loop put in the ring, in the encoder thread */
+static int encode_ring(struct impl *this)
+{
+	uint32_t index, offs, avail, l0, l1;
+	int32_t filled;
+	int written;
+
+	filled = spa_ringbuffer_get_read_index(&this->enc.ring, &index);
+	if (filled <= 0)
+		return 0;
+
+	avail = SPA_MIN((uint32_t)filled, ENCODER_RING_SIZE);
+	offs = index & (ENCODER_RING_SIZE - 1);
+	l0 = SPA_MIN(avail, ENCODER_RING_SIZE - offs);
+	l1 = avail - l0;
+
+	written = add_data(this, this->enc.data + offs, l0);
+	if (written == (int)l0 && l1 > 0) {
+		int res = add_data(this, this->enc.data, l1);
+		if (res > 0)
+			written += res;
+	}
+	if (written < 0 && written != -ENOSPC) {
+		spa_log_warn(this->log, "%p: error %s, drop %u bytes",
+				this, spa_strerror(written), avail);
+		written = avail;
+	}
+	if (written > 0)
+		spa_ringbuffer_read_update(&this->enc.ring, index + written);
+
+	return written;
+}
+
 static void enable_flush_timer(struct impl *this, bool enabled)
 {
 	struct itimerspec ts;
@@ -765,13 +930,14 @@ static int flush_data(struct impl *this, uint64_t now_time)
 	uint32_t total_frames;
 	struct port *port = &this->port;
 	int unused_buffer;
+	bool dropped = false;
 
 	spa_assert(this->transport_started);
 
 	/* I/O in error state? */
 	if (this->transport == NULL || !this->flush_source.loop)
 		return -EIO;
-	if (!this->flush_timer_source.loop && !this->transport->iso_io)
+	if (!this->flush_timer_source.loop && !this->transport->iso_io && !this->enc.thread)
 		return -EIO;
 
 	if (this->transport->iso_io && !this->iso_pending)
@@ -789,7 +955,13 @@ again:
 			return res;
 		}
 	}
-	while (!spa_list_is_empty(&port->ready) && !this->need_flush) {
+	while (this->enc.thread && !this->need_flush) {
+		written = encode_ring(this);
+		if (written <= 0)
+			break;
+		total_frames += written / port->frame_size;
+	}
+	while (!this->enc.thread && !spa_list_is_empty(&port->ready) && !this->need_flush) {
 		uint8_t *src;
 		uint32_t n_bytes, n_frames;
 		struct buffer *b;
@@ -875,9 +1047,8 @@ again:
 	}
 
 	/*
-	 * Get socket queue size before writing to it.
-	 * This should be the same as buffer size to increase bitpool
-	 * Bitpool shouldn't be increased when data is left over in the buffer
+	 * Get socket queue size before writing to it, this drives the
+	 * bitrate control.
 	 */
 	unused_buffer = get_transport_unused_size(this);
 
@@ -885,12 +1056,7 @@ again:
 
 	if (written == -EAGAIN) {
 		spa_log_trace(this->log, "%p: fail flush", this);
-		if (now_time - this->last_error > SPA_NSEC_PER_SEC / 2) {
-			int res = this->codec->reduce_bitpool(this->codec_data);
-
-			spa_log_debug(this->log, "%p: reduce bitpool: %i", this, res);
-			this->last_error = now_time;
-		}
+		dropped = true;
 
 		/*
 		 * The socket buffer is full, and the device is not processing data
@@ -949,21 +1115,17 @@ again:
 
 		update_packet_delay(this, packet_time);
 
+		abr_update(this, now_time,
+				unused_buffer < 0 ? unused_buffer :
+				(int)this->fd_buffer_size - unused_buffer,
+				this->buffer_used, packet_time, dropped);
+
 		if (this->need_flush == NEED_FLUSH_FRAGMENT) {
 			reset_buffer(this);
 			this->fragment = true;
 			goto again;
 		}
 
-		if (now_time - this->last_error > SPA_NSEC_PER_SEC) {
-			if (unused_buffer == (int)this->fd_buffer_size) {
-				int res = this->codec->increase_bitpool(this->codec_data);
-
-				spa_log_debug(this->log, "%p: increase bitpool: %i", this, res);
-			}
-			this->last_error = now_time;
-		}
-
 		spa_log_trace(this->log, "%p: flush at:%"PRIu64" process:%"PRIu64, this,
 				this->next_flush_time, this->process_time);
 		reset_buffer(this);
@@ -1137,6 +1299,141 @@ static void media_on_flush_timeout(struct spa_source *source)
 	}
 }
 
+static void *encoder_thread(void *data)
+{
+	struct impl *this = data;
+	struct pollfd fds[2] = {
+		{ .fd = this->enc.fd, .events = POLLIN },
+		{ .fd = this->flush_timerfd, .events = POLLIN },
+	};
+	uint64_t count;
+	int res;
+
+	while (SPA_ATOMIC_LOAD(this->enc.running)) {
+		if (poll(fds, SPA_N_ELEMENTS(fds), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			SPA_ATOMIC_STORE(this->enc.error, -errno);
+			break;
+		}
+		if (!SPA_ATOMIC_LOAD(this->enc.running))
+			break;
+
+		if (fds[0].revents & POLLIN)
+			spa_system_eventfd_read(this->data_system, this->enc.fd, &count);
+		if ((fds[1].revents & POLLIN) &&
+		    spa_system_timerfd_read(this->data_system, this->flush_timerfd, &count) == 0)
+			this->flush_pending = false;
+
+		if ((res = flush_data(this, this->current_time)) < 0) {
+			SPA_ATOMIC_STORE(this->enc.error, res);
+			break;
+		}
+	}
+	return NULL;
+}
+
+/* Move the queued input to the ring of the encoder thread */
+static void push_encoder_data(struct impl *this)
+{
+	struct port *port = &this->port;
+	uint32_t index, space;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_write_index(&this->enc.ring, &index);
+	space = ENCODER_RING_SIZE - SPA_CLAMP(filled, 0, ENCODER_RING_SIZE);
+
+	while (!spa_list_is_empty(&port->ready)) {
+		uint8_t *src;
+		struct buffer *b;
+		struct spa_data *d;
+		uint32_t offs, avail, l0, l1;
+
+		b = spa_list_first(&port->ready, struct buffer, link);
+		d = b->buf->datas;
+
+		src = d[0].data;
+		offs = (d[0].chunk->offset + port->ready_offset) % d[0].maxsize;
+		avail = SPA_MIN(d[0].chunk->size - port->ready_offset, space);
+		avail -= avail % port->frame_size;
+		if (avail == 0) {
+			spa_log_trace(this->log, "%p: encoder ring full", this);
+			break;
+		}
+
+		l0 = SPA_MIN(avail, d[0].maxsize - offs);
+		l1 = avail - l0;
+		spa_ringbuffer_write_data(&this->enc.ring, this->enc.data, ENCODER_RING_SIZE,
+				index & (ENCODER_RING_SIZE - 1), src + offs, l0);
+		if (l1 > 0)
+			spa_ringbuffer_write_data(&this->enc.ring, this->enc.data, ENCODER_RING_SIZE,
+					(index + l0) & (ENCODER_RING_SIZE - 1), src, l1);
+		index += avail;
+		space -= avail;
+		port->ready_offset += avail;
+
+		if (port->ready_offset >= d[0].chunk->size) {
+			spa_list_remove(&b->link);
+			SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+			spa_log_trace(this->log, "%p: reuse buffer %u", this, b->id);
+			this->port.io->buffer_id = b->id;
+
+			spa_node_call_reuse_buffer(&this->callbacks, 0, b->id);
+			port->ready_offset = 0;
+		}
+	}
+	spa_ringbuffer_write_update(&this->enc.ring, index);
+	spa_system_eventfd_write(this->data_system, this->enc.fd, 1);
+}
+
+static int start_encoder_thread(struct impl *this)
+{
+	if ((this->enc.data = calloc(1, ENCODER_RING_SIZE)) == NULL)
+		return -errno;
+
+	spa_ringbuffer_init(&this->enc.ring);
+	this->enc.running = 1;
+	this->enc.error = 0;
+
+	this->enc.thread = spa_thread_utils_create(this->thread_utils, NULL, encoder_thread, this);
+	if (this->enc.thread == NULL) {
+		int res = -errno;
+		spa_log_error(this->log, "%p: can't create encoder thread: %m", this);
+		free(this->enc.data);
+		this->enc.data = NULL;
+		return res;
+	}
+	spa_thread_utils_acquire_rt(this->thread_utils, this->enc.thread, -1);
+	spa_log_info(this->log, "%p: started encoder thread", this);
+	return 0;
+}
+
+static int do_clear_encoder_thread(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	this->enc.thread = NULL;
+	return 0;
+}
+
+static void stop_encoder_thread(struct impl *this)
+{
+	struct spa_thread *thread = this->enc.thread;
+
+	if (thread == NULL)
+		return;
+
+	SPA_ATOMIC_STORE(this->enc.running, 0);
+	spa_system_eventfd_write(this->data_system, this->enc.fd, 1);
+	spa_thread_utils_join(this->thread_utils, thread, NULL);
+
+	/* the data loop must stop pushing before the ring is freed */
+	spa_loop_invoke(this->data_loop, do_clear_encoder_thread, 0, NULL, 0, true, this);
+
+	free(this->enc.data);
+	this->enc.data = NULL;
+}
+
 static void media_on_timeout(struct spa_source *source)
 {
 	struct impl *this = source->data;
@@ -1291,7 +1588,14 @@ static int transport_start(struct impl *this)
 
 	this->update_delay_event = spa_loop_utils_add_event(this->loop_utils, update_delay_event, this);
 
-	if (!this->transport->iso_io) {
+	abr_reset(this);
+	this->abr_event = spa_loop_utils_add_event(this->loop_utils, abr_event, this);
+
+	if (!this->transport->iso_io && this->use_encoder_thread) {
+		int res;
+		if ((res = start_encoder_thread(this)) < 0)
+			return res;
+	} else if (!this->transport->iso_io) {
 		this->flush_timer_source.data = this;
 		this->flush_timer_source.fd = this->flush_timerfd;
 		this->flush_timer_source.func = media_on_flush_timeout;
@@ -1374,6 +1678,10 @@ static int do_remove_source(struct spa_loop *loop,
 		spa_loop_utils_destroy_source(this->loop_utils, this->update_delay_event);
 		this->update_delay_event = NULL;
 	}
+	if (this->abr_event) {
+		spa_loop_utils_destroy_source(this->loop_utils, this->abr_event);
+		this->abr_event = NULL;
+	}
 
 	return 0;
 }
@@ -1411,6 +1719,8 @@ static void transport_stop(struct impl *this)
 
 	spa_log_trace(this->log, "%p: stop transport", this);
 
+	stop_encoder_thread(this);
+
 	spa_loop_invoke(this->data_loop, do_remove_transport_source, 0, NULL, 0, true, this);
 
 	if (this->codec_data && this->own_codec_data)
@@ -1477,6 +1787,8 @@ static void emit_node_info(struct impl *this, bool full)
 {
 	char node_group_buf[256];
 	char *node_group = NULL;
+	char abr_reduce[32], abr_increase[32], abr_drop[32], abr_delay[32];
+	bool abr = this->transport && !this->transport->iso_io;
 
 	if (this->transport && (this->transport->profile & SPA_BT_PROFILE_BAP_SINK)) {
 		spa_scnprintf(node_group_buf, sizeof(node_group_buf), "[\"bluez-iso-%s-cig-%d\"]",
@@ -1498,11 +1810,26 @@ static void emit_node_info(struct impl *this, bool full)
 					this->transport->device->name : this->codec->bap ? "BAP" : "A2DP" ) },
 		{ SPA_KEY_NODE_DRIVER, this->is_output ? "true" : "false" },
 		{ "node.group", node_group },
+		{ "bluez5.abr.reduce-count", abr ? abr_reduce : NULL },
+		{ "bluez5.abr.increase-count", abr ? abr_increase : NULL },
+		{ "bluez5.abr.drop-count", abr ? abr_drop : NULL },
+		{ "bluez5.abr.queue-delay-us", abr ? abr_delay : NULL },
 	};
 	uint64_t old = full ? this->info.change_mask : 0;
 	if (full)
 		this->info.change_mask = this->info_all;
 	if (this->info.change_mask) {
+		if (abr) {
+			spa_scnprintf(abr_reduce, sizeof(abr_reduce), "%u",
+					__atomic_load_n(&this->abr.n_reduce, __ATOMIC_RELAXED));
+			spa_scnprintf(abr_increase, sizeof(abr_increase), "%u",
+					__atomic_load_n(&this->abr.n_increase, __ATOMIC_RELAXED));
+			spa_scnprintf(abr_drop, sizeof(abr_drop), "%u",
+					__atomic_load_n(&this->abr.n_drop, __ATOMIC_RELAXED));
+			spa_scnprintf(abr_delay, sizeof(abr_delay), "%"PRIu64,
+					(uint64_t)(__atomic_load_n(&this->abr.delay_ns,
+						__ATOMIC_RELAXED) / SPA_NSEC_PER_USEC));
+		}
 		this->info.props = &SPA_DICT_INIT_ARRAY(node_info_items);
 		spa_node_emit_info(&this->hooks, &this->info);
 		this->info.change_mask = old;
@@ -1973,7 +2300,13 @@ static int impl_node_process(void *object)
 	setup_matching(this);
 
 	spa_log_trace(this->log, "%p: on process time:%"PRIu64, this, this->process_time);
-	if ((res = flush_data(this, this->current_time)) < 0) {
+	if (this->enc.thread) {
+		if ((res = SPA_ATOMIC_LOAD(this->enc.error)) < 0) {
+			io->status = res;
+			return SPA_STATUS_STOPPED;
+		}
+		push_encoder_data(this);
+	} else if ((res = flush_data(this, this->current_time)) < 0) {
 		io->status = res;
 		return SPA_STATUS_STOPPED;
 	}
@@ -2023,6 +2356,7 @@ static void transport_destroy(void *data)
 {
 	struct impl *this = data;
 	spa_log_debug(this->log, "transport %p destroy", this->transport);
+	stop_encoder_thread(this);
 	spa_loop_invoke(this->data_loop, do_transport_destroy, 0, NULL, 0, true, this);
 }
 
@@ -2103,6 +2437,8 @@ static int impl_clear(struct spa_handle *handle)
 		spa_hook_remove(&this->transport_listener);
 	spa_system_close(this->data_system, this->timerfd);
 	spa_system_close(this->data_system, this->flush_timerfd);
+	if (this->enc.fd >= 0)
+		spa_system_close(this->data_system, this->enc.fd);
 	return 0;
 }
 
@@ -2136,6 +2472,7 @@ impl_init(const struct spa_handle_factory *factory,
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
 	this->loop_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_LoopUtils);
+	this->thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
 
 	spa_log_topic_init(this->log, &log_topic);
 
@@ -2233,6 +2570,23 @@ impl_init(const struct spa_handle_factory *factory,
 	else
 		this->is_output = true;
 
+	if (!this->codec->bap && this->transport->device->settings &&
+			(str = spa_dict_lookup(this->transport->device->settings,
+					"bluez5.a2dp.encoder-thread")) != NULL)
+		this->use_encoder_thread = spa_atob(str);
+	if (this->use_encoder_thread && this->thread_utils == NULL) {
+		spa_log_warn(this->log, "%p: no thread utils, encoding in the data loop", this);
+		this->use_encoder_thread = false;
+	}
+	this->enc.fd = -1;
+	if (this->use_encoder_thread &&
+	    (this->enc.fd = spa_system_eventfd_create(this->data_system,
+				SPA_FD_CLOEXEC | SPA_FD_NONBLOCK)) < 0) {
+		spa_log_warn(this->log, "%p: can't create eventfd: %s, encoding in the data loop",
+				this, spa_strerror(this->enc.fd));
+		this->use_encoder_thread = false;
+	}
+
 	reset_props(this, &this->props);
 
 	set_latency(this, false);
@@ -23,6 +23,7 @@
 #include <spa/utils/ringbuffer.h>
 #include <spa/monitor/device.h>
 #include <spa/control/control.h>
+#include <spa/control/ump-utils.h>
 
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
@@ -51,6 +52,9 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.bluez5.midi.node");
 
 #define DEFAULT_LATENCY_OFFSET	(0 * SPA_NSEC_PER_MSEC)
 
+/* the minimum BLE connection interval */
+#define DEFAULT_PACKET_INTERVAL	(7500 * SPA_NSEC_PER_USEC)
+
 #define MAX_BUFFERS		32
 
 #define MIDI_RINGBUF_SIZE	(8192*4)
@@ -193,6 +197,8 @@ struct impl {
 	uint8_t read_buffer[MIDI_MAX_MTU];
 
 	struct spa_bt_midi_writer writer;
+	uint64_t packet_time;
+	uint64_t packet_interval;
 
 	enum node_role role;
 
@@ -751,9 +757,32 @@ static int flush_packet(struct impl *this)
 	spa_log_trace(this->log, "%p: send packet size:%d", this, this->writer.size);
 	spa_debug_log_mem(this->log, SPA_LOG_LEVEL_TRACE, 4, this->writer.buf, this->writer.size);
 
+	this->writer.size = 0;
+	this->writer.flush = false;
 	return 0;
 }
 
+/*
+ * Events of consecutive cycles are collected in one packet, each event has its
+ * own timestamp in the packet. The packet is sent when waiting for the next
+ * cycle would hold it for longer than a connection interval, so that with small
+ * quantums we send about one packet per connection event instead of one per
+ * cycle.
+ */
+static int flush_pending(struct impl *this)
+{
+	uint64_t end_time;
+
+	if (this->writer.size == 0 || !this->ports[PORT_IN].acquired)
+		return 0;
+
+	end_time = this->current_time + this->duration * SPA_NSEC_PER_SEC / this->rate;
+	if (end_time < this->packet_time + this->packet_interval)
+		return 0;
+
+	return flush_packet(this);
+}
+
 static int write_data(struct impl *this, struct spa_data *d)
 {
 	struct port *port = &this->ports[PORT_IN];
@@ -769,27 +798,43 @@ static int write_data(struct impl *this, struct spa_data *d)
 		return -EINVAL;
 	}
 
-	spa_bt_midi_writer_init(&this->writer, port->mtu);
+	if (this->writer.size == 0)
+		spa_bt_midi_writer_init(&this->writer, port->mtu);
 	time = 0;
 
 	SPA_POD_SEQUENCE_FOREACH(pod, c) {
-		uint8_t *event;
-		size_t size;
+		uint8_t *event, midi[16];
+		int size;
 
-		if (c->type != SPA_CONTROL_Midi)
+		switch (c->type) {
+		case SPA_CONTROL_Midi:
+			event = SPA_POD_BODY(&c->value);
+			size = SPA_POD_BODY_SIZE(&c->value);
+			break;
+		case SPA_CONTROL_UMP:
+			event = midi;
+			size = spa_ump_to_midi(SPA_POD_BODY(&c->value),
+					SPA_POD_BODY_SIZE(&c->value), midi, sizeof(midi));
+			if (size <= 0)
+				continue;
+			break;
+		default:
 			continue;
+		}
 
 		time = SPA_MAX(time, this->current_time + c->offset * SPA_NSEC_PER_SEC / this->rate);
-		event = SPA_POD_BODY(&c->value);
-		size = SPA_POD_BODY_SIZE(&c->value);
 
 		spa_log_trace(this->log, "%p: output event:0x%x time:%"PRIu64, this,
 				(size > 0) ? event[0] : 0, time);
 
 		do {
+			if (this->writer.size == 0)
+				this->packet_time = this->current_time;
+
 			res = spa_bt_midi_writer_write(&this->writer,
 					time, event, size);
 			if (res < 0) {
+				spa_bt_midi_writer_init(&this->writer, port->mtu);
 				return res;
 			} else if (res) {
 				int res2;
@@ -799,9 +844,6 @@ static int write_data(struct impl *this, struct spa_data *d)
 		} while (res);
 	}
 
-	if ((res = flush_packet(this)) < 0)
-		return res;
-
 	return 0;
 }
 
@@ -950,6 +992,9 @@ static void acquire_reply(GObject *source_object, GAsyncResult *res, gpointer us
 	port->mtu = mtu;
 	port->acquired = true;
 
+	if (port->direction == SPA_DIRECTION_INPUT)
+		spa_bt_midi_writer_init(&this->writer, mtu);
+
 	if (port->direction == SPA_DIRECTION_OUTPUT) {
 		spa_bt_midi_parser_init(&this->parser);
 
@@ -1046,6 +1091,8 @@ static int server_do_acquire(struct port *port, int fd, uint16_t mtu)
 
 	if (port->direction == SPA_DIRECTION_OUTPUT)
 		spa_bt_midi_parser_init(&this->parser);
+	else
+		spa_bt_midi_writer_init(&this->writer, mtu);
 
 	/* Start source */
 	port->source.data = port;
@@ -1802,7 +1849,7 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
-	int status = SPA_STATUS_OK;
+	int status = SPA_STATUS_OK, res;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -1826,6 +1873,10 @@ static int impl_node_process(void *object)
 
 	status |= process_input(this);
 
+	if ((res = flush_pending(this)) < 0)
+		spa_log_info(this->log, "%p: sending data failed: %s",
+				this, spa_strerror(res));
+
 	return status;
 }
 
@@ -1946,6 +1997,7 @@ impl_init(const struct spa_handle_factory *factory,
 	}
 
 	this->role = NODE_CLIENT;
+	this->packet_interval = DEFAULT_PACKET_INTERVAL;
 
 	if (info) {
 		const char *str;
@@ -1958,6 +2010,11 @@ impl_init(const struct spa_handle_factory *factory,
 				this->role = NODE_SERVER;
 		}
 
+		/* in usec, 0 sends a packet every cycle */
+		if ((str = spa_dict_lookup(info, "bluez5.midi.packet-interval")) != NULL &&
+		    spa_atou64(str, &this->packet_interval, 0))
+			this->packet_interval *= SPA_NSEC_PER_USEC;
+
 		if ((str = spa_dict_lookup(info, "node.nick")) != NULL)
 			device_name = str;
 		else if ((str = spa_dict_lookup(info, "node.description")) != NULL)
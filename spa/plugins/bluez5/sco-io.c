@@ -5,8 +5,12 @@
 #include <unistd.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/loop.h>
@@ -47,12 +51,18 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.bluez5.sco-io");
  */
 #define MAX_MTU 1024
 
+/* Packets read or written with one recvmmsg/sendmmsg call */
+#define MAX_BATCH 16
+
 
 struct spa_bt_sco_io {
 	bool started;
+	bool batch;
+	bool rx_timestamps;
 
-	uint8_t read_buffer[MAX_MTU];
+	uint8_t read_buffer[MAX_BATCH][MAX_MTU];
 	uint32_t read_size;
+	uint64_t rx_time;
 
 	int fd;
 	uint16_t read_mtu;
@@ -75,6 +85,14 @@ static void update_source(struct spa_bt_sco_io *io)
 	int enabled;
 	int changed = 0;
 
+	/* In batch mode the source reads from its graph cycle. Without a
+	 * source we still poll, to keep the socket flushed. */
+	enabled = !(io->batch && io->source_cb != NULL);
+	if (SPA_FLAG_IS_SET(io->source.mask, SPA_IO_IN) != enabled) {
+		SPA_FLAG_UPDATE(io->source.mask, SPA_IO_IN, enabled);
+		changed = 1;
+	}
+
 	enabled = io->sink_cb != NULL;
 	if (SPA_FLAG_IS_SET(io->source.mask, SPA_IO_OUT) != enabled) {
 		SPA_FLAG_UPDATE(io->source.mask, SPA_IO_OUT, enabled);
@@ -86,43 +104,122 @@ static void update_source(struct spa_bt_sco_io *io)
 	}
 }
 
-static void sco_io_on_ready(struct spa_source *source)
+/* Arrival time of the packet in CLOCK_MONOTONIC, from the kernel software
+ * timestamp when available. Those are in CLOCK_REALTIME, offset is the
+ * difference of the clocks. */
+static uint64_t get_rx_time(struct spa_bt_sco_io *io, struct msghdr *msg,
+		int64_t offset, uint64_t now)
 {
-	struct spa_bt_sco_io *io = source->data;
+	struct cmsghdr *cmsg;
 
-	if (SPA_FLAG_IS_SET(source->rmask, SPA_IO_IN)) {
-		int res;
+	if (!io->rx_timestamps)
+		return now;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		struct scm_timestamping tss;
+		int64_t t;
 
-	read_again:
-		res = recv(io->fd, io->read_buffer, SPA_MIN(io->read_mtu, MAX_MTU), MSG_DONTWAIT);
-		if (res <= 0) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+			continue;
+
+		memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+		if (tss.ts[0].tv_sec == 0 && tss.ts[0].tv_nsec == 0)
+			break;
+
+		t = SPA_TIMESPEC_TO_NSEC(&tss.ts[0]) + offset;
+		if (t <= 0 || (uint64_t)t > now)
+			break;
+		return t;
+	}
+	return now;
+}
+
+/*
+ * Read all pending packets from the socket, MAX_BATCH at a time, and pass
+ * them to the source callback. Returns the number of packets read, or <0
+ * on socket error.
+ */
+int spa_bt_sco_io_read(struct spa_bt_sco_io *io)
+{
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iov[MAX_BATCH];
+	uint8_t control[MAX_BATCH][CMSG_SPACE(sizeof(struct scm_timestamping))];
+	struct timespec ts;
+	uint64_t now;
+	int64_t offset = 0;
+	int i, n, total = 0;
+
+	do {
+		for (i = 0; i < MAX_BATCH; i++) {
+			iov[i].iov_base = io->read_buffer[i];
+			iov[i].iov_len = SPA_MIN(io->read_mtu, MAX_MTU);
+			spa_zero(msgs[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			if (io->rx_timestamps) {
+				msgs[i].msg_hdr.msg_control = control[i];
+				msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+			}
+		}
+
+		n = recvmmsg(io->fd, msgs, MAX_BATCH, MSG_DONTWAIT, NULL);
+		if (n < 0) {
 			if (errno == EINTR) {
 				/* retry if interrupted */
-				goto read_again;
+				continue;
 			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
 				/* no data: try it next time */
-				goto read_done;
+				break;
 			}
+			return -errno;
+		}
 
-			/* error */
-			goto stop;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		now = SPA_TIMESPEC_TO_NSEC(&ts);
+		if (io->rx_timestamps) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			offset = (int64_t)now - (int64_t)SPA_TIMESPEC_TO_NSEC(&ts);
 		}
 
-		if (res != (int)io->read_size)
-			spa_log_trace(io->log, "%p: packet size:%d", io, res);
+		for (i = 0; i < n; i++) {
+			int size = msgs[i].msg_len;
 
-		io->read_size = res;
+			if (size <= 0)
+				return -EPIPE;
 
-		if (io->source_cb) {
-			int res;
-			res = io->source_cb(io->source_userdata, io->read_buffer, io->read_size);
-			if (res) {
-				io->source_cb = NULL;
+			if (size != (int)io->read_size)
+				spa_log_trace(io->log, "%p: packet size:%d", io, size);
+
+			io->read_size = size;
+			io->rx_time = get_rx_time(io, &msgs[i].msg_hdr, offset, now);
+
+			if (io->source_cb) {
+				int res;
+				res = io->source_cb(io->source_userdata, io->read_buffer[i], io->read_size);
+				if (res) {
+					io->source_cb = NULL;
+				}
 			}
 		}
+		total += n;
+	} while (n == MAX_BATCH || n < 0);
+
+	/* the source callback may have been removed */
+	if (io->started)
+		update_source(io);
+
+	return total;
+}
+
+static void sco_io_on_ready(struct spa_source *source)
+{
+	struct spa_bt_sco_io *io = source->data;
+
+	if (SPA_FLAG_IS_SET(source->rmask, SPA_IO_IN)) {
+		if (spa_bt_sco_io_read(io) < 0)
+			goto stop;
 	}
 
-read_done:
 	if (SPA_FLAG_IS_SET(source->rmask, SPA_IO_OUT)) {
 		if (io->sink_cb) {
 			int res;
@@ -150,12 +247,15 @@ stop:
 }
 
 /*
- * Write data to socket in correctly sized blocks.
+ * Write data to socket in correctly sized blocks, up to MAX_BATCH blocks
+ * per sendmmsg call.
  * Returns the number of bytes written, 0 when data cannot be written now or
  * there is too little of it to write, and <0 on write error.
  */
 int spa_bt_sco_io_write(struct spa_bt_sco_io *io, uint8_t *buf, int size)
 {
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iov[MAX_BATCH];
 	uint16_t packet_size;
 	uint8_t *buf_start = buf;
 
@@ -171,10 +271,19 @@ int spa_bt_sco_io_write(struct spa_bt_sco_io *io, uint8_t *buf, int size)
 	}
 
 	do {
-		int written;
+		int i, n;
+
+		n = SPA_MIN(size / packet_size, MAX_BATCH);
+		for (i = 0; i < n; i++) {
+			iov[i].iov_base = buf + i * packet_size;
+			iov[i].iov_len = packet_size;
+			spa_zero(msgs[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
 
-		written = send(io->fd, buf, packet_size, MSG_DONTWAIT | MSG_NOSIGNAL);
-		if (written < 0) {
+		n = sendmmsg(io->fd, msgs, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0) {
 			if (errno == EINTR) {
 				/* retry if interrupted */
 				continue;
@@ -185,8 +294,13 @@ int spa_bt_sco_io_write(struct spa_bt_sco_io *io, uint8_t *buf, int size)
 			return -errno;
 		}
 
-		buf += written;
-		size -= written;
+		for (i = 0; i < n; i++) {
+			buf += msgs[i].msg_len;
+			size -= msgs[i].msg_len;
+		}
+
+		if (n == 0 || msgs[n-1].msg_len < packet_size)
+			break;
 	} while (size >= packet_size);
 
 	return buf - buf_start;
@@ -196,6 +310,7 @@ int spa_bt_sco_io_write(struct spa_bt_sco_io *io, uint8_t *buf, int size)
 struct spa_bt_sco_io *spa_bt_sco_io_create(struct spa_bt_transport *transport, struct spa_loop *data_loop, struct spa_log *log)
 {
 	struct spa_bt_sco_io *io;
+	uint32_t val;
 
 	spa_log_topic_init(log, &log_topic);
 
@@ -230,6 +345,12 @@ struct spa_bt_sco_io *spa_bt_sco_io_create(struct spa_bt_transport *transport, s
 
 	spa_log_debug(io->log, "%p: initial packet size:%d", io, io->read_size);
 
+	val = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+	if (setsockopt(io->fd, SOL_SOCKET, SO_TIMESTAMPING, &val, sizeof(val)) == 0)
+		io->rx_timestamps = true;
+	else
+		spa_log_debug(io->log, "%p: no RX timestamps: %m", io);
+
 	/* Add the ready callback */
 	io->source.data = io;
 	io->source.fd = io->fd;
@@ -294,3 +415,26 @@ void spa_bt_sco_io_set_sink_cb(struct spa_bt_sco_io *io, int (*sink_cb)(void *),
 		update_source(io);
 	}
 }
+
+/* Enable batch mode.
+ * This function should only be called from the data thread.
+ * The socket is then not polled for input while there is a source
+ * callback. The source reads the packets with spa_bt_sco_io_read() once per
+ * graph cycle instead of waking up for each packet.
+ */
+void spa_bt_sco_io_set_batch(struct spa_bt_sco_io *io, bool batch)
+{
+	io->batch = batch;
+
+	if (io->started) {
+		update_source(io);
+	}
+}
+
+/* Arrival time of the packet passed to the source callback, in
+ * CLOCK_MONOTONIC nsec. Only valid in the callback.
+ */
+uint64_t spa_bt_sco_io_get_rx_time(struct spa_bt_sco_io *io)
+{
+	return io->rx_time;
+}
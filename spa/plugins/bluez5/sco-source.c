@@ -53,6 +53,9 @@ struct props {
 
 #define MAX_BUFFERS 32
 
+/* Lost mSBC frames fade out to silence over this many frames */
+#define PLC_FADE_FRAMES 3
+
 struct buffer {
 	uint32_t id;
 	unsigned int outstanding:1;
@@ -125,6 +128,7 @@ struct impl {
 	unsigned int io_error:1;
 
 	unsigned int is_internal:1;
+	unsigned int batch_io:1;
 
 	struct spa_source timer_source;
 	int timerfd;
@@ -146,6 +150,13 @@ struct impl {
 	/* mSBC */
 	sbc_t msbc;
 
+	/* Packet loss concealment */
+	struct {
+		int16_t frame[MSBC_DECODED_SIZE / sizeof(int16_t)];
+		uint32_t lost;
+		bool valid;
+	} plc;
+
 	/* LC3 */
 #ifdef HAVE_LC3
 	lc3_decoder_t lc3;
@@ -436,19 +447,20 @@ static bool is_zero_packet(uint8_t *data, int size)
 	return true;
 }
 
+/* with src == NULL, the decoder conceals a lost frame */
 static int lc3_decode_frame(struct impl *this, const void *src, size_t src_size, void *dst,
 		size_t dst_size, size_t *dst_out)
 {
 #ifdef HAVE_LC3
 	int res;
 
-	if (src_size != LC3_SWB_PAYLOAD_SIZE)
+	if (src != NULL && src_size != LC3_SWB_PAYLOAD_SIZE)
 		return -EINVAL;
 	if (dst_size < LC3_SWB_DECODED_SIZE)
 		return -EINVAL;
 
-	res = lc3_decode(this->lc3, src, src_size, LC3_PCM_FORMAT_S24, dst, 1);
-	if (res != 0)
+	res = lc3_decode(this->lc3, src, src ? src_size : 0, LC3_PCM_FORMAT_S24, dst, 1);
+	if (res < 0 || (src != NULL && res != 0))
 		return -EINVAL;
 
 	*dst_out = LC3_SWB_DECODED_SIZE;
@@ -458,6 +470,62 @@ static int lc3_decode_frame(struct impl *this, const void *src, size_t src_size,
 #endif
 }
 
+/* dst = src with a gain ramp from g0 to g1, plain loop for the vectorizer */
+static SPA_UNUSED void plc_fade_s16(int16_t * SPA_RESTRICT dst, const int16_t * SPA_RESTRICT src,
+		uint32_t n_samples, float g0, float g1)
+{
+	const float dg = (g1 - g0) / n_samples;
+	uint32_t i;
+
+	for (i = 0; i < n_samples; i++)
+		dst[i] = (int16_t)(src[i] * (g0 + dg * i));
+}
+
+/*
+ * Fill in lost mSBC/LC3 frames before the next received one. LC3 has
+ * concealment in the decoder. mSBC repeats the last good frame and fades
+ * it out over PLC_FADE_FRAMES frames.
+ */
+static uint32_t conceal_lost_frames(struct impl *this, uint32_t n_lost)
+{
+	struct port *port = &this->port;
+	uint32_t i, decoded = 0;
+
+	for (i = 0; i < n_lost; i++) {
+		void *buf;
+		uint32_t avail;
+		size_t written;
+
+		buf = spa_bt_decode_buffer_get_write(&port->buffer, &avail);
+
+		if (this->transport->codec == HFP_AUDIO_CODEC_MSBC) {
+			uint32_t n = this->plc.lost;
+
+			if (!this->plc.valid || avail < MSBC_DECODED_SIZE)
+				break;
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+			plc_fade_s16(buf, this->plc.frame, SPA_N_ELEMENTS(this->plc.frame),
+					SPA_MAX(0.0f, 1.0f - (float)n / PLC_FADE_FRAMES),
+					SPA_MAX(0.0f, 1.0f - (float)(n + 1) / PLC_FADE_FRAMES));
+#else
+			/* the samples are little endian */
+			spa_memzero(buf, MSBC_DECODED_SIZE);
+			(void)n;
+#endif
+			written = MSBC_DECODED_SIZE;
+		} else if (lc3_decode_frame(this, NULL, 0, buf, avail, &written) < 0) {
+			break;
+		}
+
+		this->plc.lost++;
+		spa_bt_decode_buffer_write_packet(&port->buffer, written);
+		decoded += written;
+	}
+
+	return decoded;
+}
+
 static uint32_t preprocess_and_decode_codec_data(void *userdata, uint8_t *read_data, int size_read)
 {
 	struct impl *this = userdata;
@@ -493,8 +561,6 @@ static uint32_t preprocess_and_decode_codec_data(void *userdata, uint8_t *read_d
 		 * Handle found mSBC/LC3 packet
 		 */
 
-		buf = spa_bt_decode_buffer_get_write(&port->buffer, &avail);
-
 		/* Check sequence number */
 		seq = ((this->recv_buffer[1] >> 4) & 1) |
 			((this->recv_buffer[1] >> 6) & 2);
@@ -504,14 +570,16 @@ static uint32_t preprocess_and_decode_codec_data(void *userdata, uint8_t *read_d
 			this->h2_seq_initialized = true;
 			this->h2_seq = seq;
 		} else if (seq != this->h2_seq) {
-			/* TODO: PLC (too late to insert data now) */
 			spa_log_info(this->log,
 					"missing mSBC/LC3 packet: %u != %u", seq, this->h2_seq);
+			decoded += conceal_lost_frames(this, (seq - this->h2_seq + 4) % 4);
 			this->h2_seq = seq;
 		}
 
 		this->h2_seq = (this->h2_seq + 1) % 4;
 
+		buf = spa_bt_decode_buffer_get_write(&port->buffer, &avail);
+
 		if (this->transport->codec == HFP_AUDIO_CODEC_MSBC) {
 			if (avail < decoded_size)
 				spa_log_warn(this->log, "Output buffer full, dropping msbc data");
@@ -531,6 +599,13 @@ static uint32_t preprocess_and_decode_codec_data(void *userdata, uint8_t *read_d
 			continue;
 		}
 
+		if (this->transport->codec == HFP_AUDIO_CODEC_MSBC &&
+				written == MSBC_DECODED_SIZE) {
+			memcpy(this->plc.frame, buf, written);
+			this->plc.valid = true;
+		}
+		this->plc.lost = 0;
+
 		spa_bt_decode_buffer_write_packet(&port->buffer, written);
 		decoded += written;
 	}
@@ -543,7 +618,7 @@ static int sco_source_cb(void *userdata, uint8_t *read_data, int size_read)
 	struct impl *this = userdata;
 	struct port *port = &this->port;
 	uint32_t decoded;
-	uint64_t dt;
+	uint64_t dt, rx_time;
 
 	/* Drop data when not started */
 	if (!this->started)
@@ -555,9 +630,10 @@ static int sco_source_cb(void *userdata, uint8_t *read_data, int size_read)
 	}
 
 	/* update the current pts */
-	dt = SPA_TIMESPEC_TO_NSEC(&this->now);
-	spa_system_clock_gettime(this->data_system, CLOCK_MONOTONIC, &this->now);
-	dt = SPA_TIMESPEC_TO_NSEC(&this->now) - dt;
+	rx_time = spa_bt_sco_io_get_rx_time(this->transport->sco_io);
+	dt = rx_time - SPA_TIMESPEC_TO_NSEC(&this->now);
+	this->now.tv_sec = rx_time / SPA_NSEC_PER_SEC;
+	this->now.tv_nsec = rx_time % SPA_NSEC_PER_SEC;
 
 	/* handle data read from socket */
 #if 0
@@ -698,6 +774,7 @@ static int do_add_source(struct spa_loop *loop,
 {
 	struct impl *this = user_data;
 
+	spa_bt_sco_io_set_batch(this->transport->sco_io, this->batch_io);
 	spa_bt_sco_io_set_source_cb(this->transport->sco_io, sco_source_cb, this);
 
 	return 0;
@@ -741,6 +818,7 @@ static int transport_start(struct impl *this)
 		/* Libsbc expects audio samples by default in host endianness, mSBC requires little endian */
 		this->msbc.endian = SBC_LE;
 		this->h2_seq_initialized = false;
+		spa_zero(this->plc);
 
 		this->recv_buffer_pos = 0;
 	} else if (this->transport->codec == HFP_AUDIO_CODEC_LC3_SWB) {
@@ -753,6 +831,7 @@ static int transport_start(struct impl *this)
 		spa_assert(lc3_frame_samples(7500, 32000) * port->frame_size == LC3_SWB_DECODED_SIZE);
 
 		this->h2_seq_initialized = false;
+		spa_zero(this->plc);
 		this->recv_buffer_pos = 0;
 #else
 		res = -EINVAL;
@@ -1474,6 +1553,13 @@ static int produce_buffer(struct impl *this)
 		return SPA_STATUS_STOPPED;
 	}
 
+	/* In batch mode, read the packets received during the cycle */
+	if (this->transport_started && this->batch_io && this->transport->sco_io) {
+		int res = spa_bt_sco_io_read(this->transport->sco_io);
+		if (res < 0)
+			spa_log_debug(this->log, "%p: read error: %s", this, spa_strerror(res));
+	}
+
 	/* Handle buffering */
 	if (this->transport_started)
 		process_buffering(this);
@@ -1730,6 +1816,11 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_bt_transport_add_listener(this->transport,
 			&this->transport_listener, &transport_events, this);
 
+	if (this->transport->device->settings &&
+			(str = spa_dict_lookup(this->transport->device->settings,
+					"bluez5.sco.batch-io")) != NULL)
+		this->batch_io = spa_atob(str);
+
 	this->timerfd = spa_system_timerfd_create(this->data_system,
 			CLOCK_MONOTONIC, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
 
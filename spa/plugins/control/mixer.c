@@ -81,6 +81,7 @@ struct impl {
 
 	struct spa_pod_control *mix_ctrl[MAX_PORTS];
 	struct spa_pod_sequence *mix_seq[MAX_PORTS];
+	uint32_t mix_heap[MAX_PORTS];
 
 	int n_formats;
 
@@ -620,38 +621,85 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return queue_buffer(this, port, &port->buffers[buffer_id]);
 }
 
+static inline uint8_t event_status(struct spa_pod_control *c)
+{
+	switch (c->type) {
+	case SPA_CONTROL_Midi:
+		if (SPA_POD_BODY_SIZE(&c->value) < 1)
+			return 0;
+		return *(uint8_t*)SPA_POD_BODY(&c->value);
+	case SPA_CONTROL_UMP:
+	{
+		uint32_t *ump = SPA_POD_BODY(&c->value);
+
+		if (SPA_POD_BODY_SIZE(&c->value) < 4)
+			return 0;
+		/* MIDI 1.0 and 2.0 channel voice messages */
+		if ((ump[0] >> 28) != 0x2 && (ump[0] >> 28) != 0x4)
+			return 0;
+		return (ump[0] >> 16) & 0xff;
+	}
+	default:
+		return 0;
+	}
+}
+
 static inline int event_sort(struct spa_pod_control *a, struct spa_pod_control *b)
 {
+	/* 11 (controller) > 12 (program change) >
+	 * 8 (note off) > 9 (note on) > 10 (aftertouch) >
+	 * 13 (channel pressure) > 14 (pitch bend) */
+	static const int priotab[] = { 5,4,3,7,6,2,1,0 };
+	uint8_t sa, sb;
+
 	if (a->offset < b->offset)
 		return -1;
 	if (a->offset > b->offset)
 		return 1;
 	if (a->type != b->type)
 		return 0;
-	switch(a->type) {
-	case SPA_CONTROL_Midi:
-	{
-		/* 11 (controller) > 12 (program change) >
-		 * 8 (note off) > 9 (note on) > 10 (aftertouch) >
-		 * 13 (channel pressure) > 14 (pitch bend) */
-		static int priotab[] = { 5,4,3,7,6,2,1,0 };
-		uint8_t *da, *db;
-
-		if (SPA_POD_BODY_SIZE(&a->value) < 1 ||
-		    SPA_POD_BODY_SIZE(&b->value) < 1)
-			return 0;
+	if (a->type != SPA_CONTROL_Midi && a->type != SPA_CONTROL_UMP)
+		return 0;
 
-		da = SPA_POD_BODY(&a->value);
-		db = SPA_POD_BODY(&b->value);
-		if ((da[0] & 0xf) != (db[0] & 0xf))
-			return 0;
-		return priotab[(db[0]>>4) & 7] - priotab[(da[0]>>4) & 7];
-	}
-	default:
+	sa = event_status(a);
+	sb = event_status(b);
+	if ((sa & 0xf) != (sb & 0xf))
 		return 0;
+	return priotab[(sb>>4) & 7] - priotab[(sa>>4) & 7];
+}
+
+/* the heap is ordered on the next control of each input, equal controls
+ * are taken from the highest input index first */
+static inline bool heap_less(struct impl *this, uint32_t a, uint32_t b)
+{
+	int res = event_sort(this->mix_ctrl[a], this->mix_ctrl[b]);
+	return res < 0 || (res == 0 && a > b);
+}
+
+static void heap_sift_down(struct impl *this, uint32_t n_heap, uint32_t pos)
+{
+	uint32_t *heap = this->mix_heap;
+
+	while (true) {
+		uint32_t l = 2 * pos + 1, r = l + 1, min = pos;
+
+		if (l < n_heap && heap_less(this, heap[l], heap[min]))
+			min = l;
+		if (r < n_heap && heap_less(this, heap[r], heap[min]))
+			min = r;
+		if (min == pos)
+			break;
+		SPA_SWAP(heap[pos], heap[min]);
+		pos = min;
 	}
 }
 
+static inline bool seq_has_control(struct impl *this, uint32_t i)
+{
+	return spa_pod_control_is_inside(&this->mix_seq[i]->body,
+			SPA_POD_BODY_SIZE(this->mix_seq[i]), this->mix_ctrl[i]);
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -745,28 +793,35 @@ static int impl_node_process(void *object)
 	spa_pod_builder_init(&builder, d->data, d->maxsize);
 	spa_pod_builder_push_sequence(&builder, &f, 0);
 
-	/* merge sort all sequences into output buffer */
-	while (true) {
-		struct spa_pod_control *next = NULL;
-		uint32_t next_index = 0;
+	if (n_seq == 1) {
+		/* a single input is copied as is */
+		spa_pod_builder_raw(&builder, SPA_PTROFF(&seq[0]->body,
+					sizeof(struct spa_pod_sequence_body), void),
+				SPA_POD_BODY_SIZE(seq[0]) - sizeof(struct spa_pod_sequence_body));
+	} else {
+		uint32_t *heap = this->mix_heap, n_heap = 0;
 
+		/* merge all sequences into the output buffer with a heap of
+		 * the inputs, keyed on their next control */
 		for (i = 0; i < n_seq; i++) {
-			if (!spa_pod_control_is_inside(&seq[i]->body,
-					SPA_POD_BODY_SIZE(seq[i]), ctrl[i]))
-				continue;
-
-			if (next == NULL || event_sort(ctrl[i], next) <= 0) {
-				next = ctrl[i];
-				next_index = i;
-			}
+			if (seq_has_control(this, i))
+				heap[n_heap++] = i;
 		}
-		if (next == NULL)
-			break;
+		for (i = n_heap / 2; i-- > 0;)
+			heap_sift_down(this, n_heap, i);
 
-		spa_pod_builder_control(&builder, next->offset, next->type);
-		spa_pod_builder_primitive(&builder, &next->value);
+		while (n_heap > 0) {
+			uint32_t idx = heap[0];
+			struct spa_pod_control *next = ctrl[idx];
 
-		ctrl[next_index] = spa_pod_control_next(ctrl[next_index]);
+			spa_pod_builder_control(&builder, next->offset, next->type);
+			spa_pod_builder_primitive(&builder, &next->value);
+
+			ctrl[idx] = spa_pod_control_next(next);
+			if (!seq_has_control(this, idx))
+				heap[0] = heap[--n_heap];
+			heap_sift_down(this, n_heap, 0);
+		}
 	}
 	spa_pod_builder_pop(&builder, &f);
 
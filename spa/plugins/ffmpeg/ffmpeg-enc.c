@@ -4,19 +4,30 @@
 
 #include <errno.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 
 #include <spa/utils/string.h>
+#include <spa/utils/result.h>
+#include <spa/utils/ringbuffer.h>
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
 #include <spa/node/io.h>
+#include <spa/buffer/meta.h>
 #include <spa/param/video/format-utils.h>
 #include <spa/pod/filter.h>
 
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/hwcontext_drm.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+
 #include "ffmpeg.h"
 
 #undef SPA_LOG_TOPIC_DEFAULT
@@ -29,11 +40,89 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.ffmpeg.enc");
 #define GET_PORT(this,d,p)		(d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,p) : GET_OUT_PORT(this,p))
 
 #define MAX_BUFFERS    32
+#define MASK_BUFFERS   (MAX_BUFFERS-1)
+
+#define DEFAULT_DEVICE		"/dev/dri/renderD128"
+
+#define DRM_FOURCC(a,b,c,d)	((uint32_t)(a) | ((uint32_t)(b) << 8) | \
+				 ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define DRM_FORMAT_MOD_LINEAR	0
+
+static const struct format_info {
+	uint32_t format;
+	enum AVPixelFormat pix_fmt;
+	uint32_t drm_format;
+} format_info[] = {
+	{ SPA_VIDEO_FORMAT_NV12, AV_PIX_FMT_NV12, DRM_FOURCC('N', 'V', '1', '2') },
+	{ SPA_VIDEO_FORMAT_I420, AV_PIX_FMT_YUV420P, DRM_FOURCC('Y', 'U', '1', '2') },
+	{ SPA_VIDEO_FORMAT_YUY2, AV_PIX_FMT_YUYV422, DRM_FOURCC('Y', 'U', 'Y', 'V') },
+	{ SPA_VIDEO_FORMAT_BGRx, AV_PIX_FMT_BGR0, DRM_FOURCC('X', 'R', '2', '4') },
+	{ SPA_VIDEO_FORMAT_RGBx, AV_PIX_FMT_RGB0, DRM_FOURCC('X', 'B', '2', '4') },
+	{ SPA_VIDEO_FORMAT_BGRA, AV_PIX_FMT_BGRA, DRM_FOURCC('A', 'R', '2', '4') },
+	{ SPA_VIDEO_FORMAT_RGBA, AV_PIX_FMT_RGBA, DRM_FOURCC('A', 'B', '2', '4') },
+};
+
+/* formats that the VAAPI encoders can import */
+static const uint32_t hw_formats[] = {
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_BGRx,
+	SPA_VIDEO_FORMAT_RGBx,
+};
+
+static const struct format_info *find_format_info(uint32_t format)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(format_info, i)
+		if (i->format == format)
+			return i;
+	return NULL;
+}
+
+static const struct format_info *find_format_info_by_pix_fmt(enum AVPixelFormat pix_fmt)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(format_info, i)
+		if (i->pix_fmt == pix_fmt)
+			return i;
+	return NULL;
+}
+
+/* single producer, single consumer queue of buffer ids, used to pass
+ * buffers between the data thread and the encoder thread */
+struct id_ring {
+	struct spa_ringbuffer ring;
+	uint32_t ids[MAX_BUFFERS];
+};
+
+static inline void id_ring_reset(struct id_ring *r)
+{
+	spa_ringbuffer_init(&r->ring);
+}
+
+static inline void id_ring_push(struct id_ring *r, uint32_t id)
+{
+	uint32_t index;
+	spa_ringbuffer_get_write_index(&r->ring, &index);
+	r->ids[index & MASK_BUFFERS] = id;
+	spa_ringbuffer_write_update(&r->ring, index + 1);
+}
+
+static inline uint32_t id_ring_pop(struct id_ring *r)
+{
+	uint32_t index, id;
+	if (spa_ringbuffer_get_read_index(&r->ring, &index) < 1)
+		return SPA_ID_INVALID;
+	id = r->ids[index & MASK_BUFFERS];
+	spa_ringbuffer_read_update(&r->ring, index + 1);
+	return id;
+}
+
+struct impl;
 
 struct buffer {
 	uint32_t id;
 	uint32_t flags;
 	struct spa_buffer *outbuf;
+	struct spa_meta_header *h;
+	struct impl *impl;
 	struct spa_list link;
 };
 
@@ -43,7 +132,13 @@ struct port {
 
 	uint64_t info_all;
 	struct spa_port_info info;
-	struct spa_param_info params[8];
+#define IDX_EnumFormat	0
+#define IDX_Meta	1
+#define IDX_IO		2
+#define IDX_Format	3
+#define IDX_Buffer	4
+#define N_PORT_PARAMS	5
+	struct spa_param_info params[N_PORT_PARAMS];
 
 	struct spa_video_info current_format;
 	unsigned int have_format:1;
@@ -57,6 +152,12 @@ struct port {
 	struct spa_list ready;
 };
 
+enum encode_mode {
+	MODE_SW,		/* software frames from mapped memory */
+	MODE_DRM_PRIME,		/* the codec takes DRM PRIME frames directly */
+	MODE_HW_MAP,		/* DMABUF mapped into a hardware device, VAAPI */
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_node node;
@@ -73,6 +174,34 @@ struct impl {
 	struct port out_ports[1];
 
 	bool started;
+
+	char device[256];
+	int64_t bitrate;
+	int gop_size;
+
+	const AVCodec *codec;
+	enum encode_mode mode;
+	enum AVHWDeviceType hw_type;
+	enum AVPixelFormat hw_pix_fmt;
+
+	AVCodecContext *ctx;
+	AVPacket *pkt;
+	AVBufferRef *drm_device;
+	AVBufferRef *drm_frames;
+	AVBufferRef *hw_device;
+	uint64_t frame_count;
+
+	/* encoding happens in a separate thread, buffers are exchanged with
+	 * the data thread with these queues */
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool running;
+
+	struct id_ring encode_queue;	/* input buffers to encode */
+	struct id_ring done_queue;	/* input buffers released by the encoder */
+	struct id_ring free_queue;	/* empty output buffers */
+	struct id_ring ready_queue;	/* output buffers with encoded data */
 };
 
 static int impl_node_enum_params(void *object, int seq,
@@ -93,18 +222,398 @@ static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
 	return -ENOTSUP;
 }
 
+static int init_hw(struct impl *this, AVCodecContext *ctx, const struct format_info *fi)
+{
+	AVHWFramesContext *frames;
+	int res;
+
+	if ((res = av_hwdevice_ctx_create(&this->drm_device, AV_HWDEVICE_TYPE_DRM,
+					this->device, NULL, 0)) < 0) {
+		spa_log_error(this->log, "%p: can't open DRM device %s: %s", this,
+				this->device, av_err2str(res));
+		return -ENODEV;
+	}
+
+	this->drm_frames = av_hwframe_ctx_alloc(this->drm_device);
+	if (this->drm_frames == NULL)
+		return -ENOMEM;
+
+	frames = (AVHWFramesContext*)this->drm_frames->data;
+	frames->format = AV_PIX_FMT_DRM_PRIME;
+	frames->sw_format = fi->pix_fmt;
+	frames->width = ctx->width;
+	frames->height = ctx->height;
+	if ((res = av_hwframe_ctx_init(this->drm_frames)) < 0)
+		goto error;
+
+	if (this->mode == MODE_DRM_PRIME) {
+		ctx->pix_fmt = AV_PIX_FMT_DRM_PRIME;
+		ctx->sw_pix_fmt = fi->pix_fmt;
+		ctx->hw_frames_ctx = av_buffer_ref(this->drm_frames);
+		return 0;
+	}
+
+	/* derive the encoder device and frames from the DRM ones so that the
+	 * DMABUFs can be mapped without a copy */
+	if ((res = av_hwdevice_ctx_create_derived(&this->hw_device, this->hw_type,
+					this->drm_device, 0)) < 0)
+		goto error;
+	if ((res = av_hwframe_ctx_create_derived(&ctx->hw_frames_ctx, this->hw_pix_fmt,
+					this->hw_device, this->drm_frames, 0)) < 0)
+		goto error;
+
+	ctx->pix_fmt = this->hw_pix_fmt;
+	ctx->sw_pix_fmt = fi->pix_fmt;
+	return 0;
+error:
+	spa_log_error(this->log, "%p: can't setup hardware frames: %s", this,
+			av_err2str(res));
+	return -EIO;
+}
+
+static void close_encoder(struct impl *this)
+{
+	/* this drops the last references to the input frames */
+	avcodec_free_context(&this->ctx);
+	av_packet_free(&this->pkt);
+	av_buffer_unref(&this->drm_frames);
+	av_buffer_unref(&this->hw_device);
+	av_buffer_unref(&this->drm_device);
+}
+
+static int open_encoder(struct impl *this)
+{
+	struct port *port = GET_IN_PORT(this, 0);
+	struct spa_video_info_raw *info = &port->current_format.info.raw;
+	const struct format_info *fi;
+	AVCodecContext *ctx;
+	int res;
+
+	if (!port->have_format || !GET_OUT_PORT(this, 0)->have_format)
+		return -EIO;
+
+	if ((fi = find_format_info(info->format)) == NULL)
+		return -ENOTSUP;
+
+	if ((ctx = avcodec_alloc_context3(this->codec)) == NULL)
+		return -ENOMEM;
+	this->ctx = ctx;
+
+	ctx->width = info->size.width;
+	ctx->height = info->size.height;
+	ctx->time_base = (AVRational) { 1, SPA_NSEC_PER_SEC };
+	if (info->framerate.denom != 0 && info->framerate.num != 0)
+		ctx->framerate = (AVRational) { info->framerate.num, info->framerate.denom };
+	if (this->bitrate > 0)
+		ctx->bit_rate = this->bitrate;
+	if (this->gop_size > 0)
+		ctx->gop_size = this->gop_size;
+	/* no reordering, every input frame produces a packet right away */
+	ctx->max_b_frames = 0;
+
+	if (this->mode == MODE_SW) {
+		ctx->pix_fmt = fi->pix_fmt;
+	} else if ((res = init_hw(this, ctx, fi)) < 0) {
+		goto error;
+	}
+
+	if ((res = avcodec_open2(ctx, this->codec, NULL)) < 0) {
+		spa_log_error(this->log, "%p: can't open codec %s: %s", this,
+				this->codec->name, av_err2str(res));
+		res = -EIO;
+		goto error;
+	}
+	if ((this->pkt = av_packet_alloc()) == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+	this->frame_count = 0;
+
+	spa_log_info(this->log, "%p: opened %s %dx%d %s bitrate:%"PRIi64" gop:%d", this,
+			this->codec->name, ctx->width, ctx->height,
+			av_get_pix_fmt_name(fi->pix_fmt), ctx->bit_rate, ctx->gop_size);
+	return 0;
+error:
+	close_encoder(this);
+	return res;
+}
+
+static void release_input(void *opaque, uint8_t *data)
+{
+	struct buffer *b = opaque;
+	id_ring_push(&b->impl->done_queue, b->id);
+}
+
+static void release_dmabuf(void *opaque, uint8_t *data)
+{
+	av_free(data);
+	release_input(opaque, NULL);
+}
+
+/* wrap the DMABUF planes of the buffer in a DRM PRIME frame. The input
+ * buffer is released when the encoder drops the last reference to the
+ * frame or right away when the import fails. */
+static AVFrame *import_dmabuf(struct impl *this, struct buffer *b)
+{
+	struct port *port = GET_IN_PORT(this, 0);
+	struct spa_video_info_raw *info = &port->current_format.info.raw;
+	struct spa_data *d = b->outbuf->datas;
+	uint32_t i, n_datas = SPA_MIN(b->outbuf->n_datas, (uint32_t)AV_DRM_MAX_PLANES);
+	const struct format_info *fi = find_format_info(info->format);
+	AVDRMFrameDescriptor *desc;
+	AVFrame *frame = NULL, *hw = NULL;
+	int res;
+
+	if (d[0].type != SPA_DATA_DmaBuf) {
+		spa_log_error(this->log, "%p: buffer %d is not a DMABUF", this, b->id);
+		goto error_release;
+	}
+	if ((desc = av_mallocz(sizeof(*desc))) == NULL)
+		goto error_release;
+
+	desc->nb_layers = 1;
+	desc->layers[0].format = fi->drm_format;
+	desc->layers[0].nb_planes = n_datas;
+	for (i = 0; i < n_datas; i++) {
+		desc->objects[i].fd = d[i].fd;
+		desc->objects[i].size = d[i].maxsize + d[i].mapoffset;
+		desc->objects[i].format_modifier = info->modifier;
+		desc->layers[0].planes[i].object_index = i;
+		desc->layers[0].planes[i].offset = d[i].chunk->offset + d[i].mapoffset;
+		desc->layers[0].planes[i].pitch = d[i].chunk->stride;
+	}
+	desc->nb_objects = n_datas;
+
+	if ((frame = av_frame_alloc()) == NULL) {
+		av_free(desc);
+		goto error_release;
+	}
+	frame->buf[0] = av_buffer_create((uint8_t*)desc, sizeof(*desc),
+			release_dmabuf, b, 0);
+	if (frame->buf[0] == NULL) {
+		av_free(desc);
+		av_frame_free(&frame);
+		goto error_release;
+	}
+	frame->data[0] = (uint8_t*)desc;
+	frame->format = AV_PIX_FMT_DRM_PRIME;
+	frame->width = info->size.width;
+	frame->height = info->size.height;
+	frame->hw_frames_ctx = av_buffer_ref(this->drm_frames);
+
+	if (this->mode == MODE_DRM_PRIME)
+		return frame;
+
+	if ((hw = av_frame_alloc()) == NULL)
+		goto error;
+	hw->format = this->hw_pix_fmt;
+	hw->hw_frames_ctx = av_buffer_ref(this->ctx->hw_frames_ctx);
+	/* the mapped frame keeps a reference to the DRM frame */
+	if ((res = av_hwframe_map(hw, frame, AV_HWFRAME_MAP_READ)) < 0) {
+		spa_log_error(this->log, "%p: can't map DMABUF: %s", this, av_err2str(res));
+		av_frame_free(&hw);
+		goto error;
+	}
+	av_frame_free(&frame);
+	return hw;
+error:
+	/* frees the descriptor and releases the buffer */
+	av_frame_free(&frame);
+	return NULL;
+error_release:
+	release_input(b, NULL);
+	return NULL;
+}
+
+/* point a software frame to the mapped memory of the buffer, the buffer
+ * is released like with import_dmabuf() */
+static AVFrame *wrap_buffer(struct impl *this, struct buffer *b)
+{
+	struct port *port = GET_IN_PORT(this, 0);
+	struct spa_video_info_raw *info = &port->current_format.info.raw;
+	struct spa_data *d = b->outbuf->datas;
+	const struct format_info *fi = find_format_info(info->format);
+	int i, n_planes = av_pix_fmt_count_planes(fi->pix_fmt);
+	AVFrame *frame;
+
+	if (d[0].data == NULL) {
+		spa_log_error(this->log, "%p: buffer %d is not mapped", this, b->id);
+		goto error_release;
+	}
+	if ((frame = av_frame_alloc()) == NULL)
+		goto error_release;
+
+	frame->format = fi->pix_fmt;
+	frame->width = info->size.width;
+	frame->height = info->size.height;
+
+	if (b->outbuf->n_datas >= (uint32_t)n_planes) {
+		for (i = 0; i < n_planes; i++) {
+			frame->data[i] = SPA_PTROFF(d[i].data, d[i].chunk->offset, uint8_t);
+			frame->linesize[i] = d[i].chunk->stride;
+		}
+	} else {
+		/* all planes in one block */
+		av_image_fill_linesizes(frame->linesize, fi->pix_fmt, frame->width);
+		if (d[0].chunk->stride > 0)
+			frame->linesize[0] = d[0].chunk->stride;
+		av_image_fill_pointers(frame->data, fi->pix_fmt, frame->height,
+				SPA_PTROFF(d[0].data, d[0].chunk->offset, uint8_t),
+				frame->linesize);
+	}
+	frame->buf[0] = av_buffer_create(frame->data[0], d[0].maxsize,
+			release_input, b, AV_BUFFER_FLAG_READONLY);
+	if (frame->buf[0] == NULL) {
+		av_frame_free(&frame);
+		goto error_release;
+	}
+	return frame;
+error_release:
+	release_input(b, NULL);
+	return NULL;
+}
+
+static void receive_packets(struct impl *this)
+{
+	struct port *port = GET_OUT_PORT(this, 0);
+	AVPacket *pkt = this->pkt;
+	int res;
+
+	while ((res = avcodec_receive_packet(this->ctx, pkt)) >= 0) {
+		struct buffer *b;
+		struct spa_data *d;
+		uint32_t id;
+
+		if ((id = id_ring_pop(&this->free_queue)) == SPA_ID_INVALID) {
+			spa_log_warn(this->log, "%p: out of buffers, dropping packet", this);
+			av_packet_unref(pkt);
+			continue;
+		}
+		b = &port->buffers[id];
+		d = b->outbuf->datas;
+
+		if ((uint32_t)pkt->size > d[0].maxsize) {
+			spa_log_warn(this->log, "%p: packet size %d > %d", this,
+					pkt->size, d[0].maxsize);
+			d[0].chunk->size = 0;
+			d[0].chunk->flags = SPA_CHUNK_FLAG_CORRUPTED;
+		} else {
+			memcpy(d[0].data, pkt->data, pkt->size);
+			d[0].chunk->size = pkt->size;
+			d[0].chunk->flags = 0;
+		}
+		d[0].chunk->offset = 0;
+		d[0].chunk->stride = 0;
+
+		if (b->h) {
+			b->h->flags = (pkt->flags & AV_PKT_FLAG_KEY) ?
+				0 : SPA_META_HEADER_FLAG_DELTA_UNIT;
+			b->h->offset = 0;
+			b->h->seq = this->frame_count++;
+			b->h->pts = pkt->pts;
+			b->h->dts_offset = pkt->dts - pkt->pts;
+		}
+		av_packet_unref(pkt);
+
+		id_ring_push(&this->ready_queue, id);
+	}
+	if (res != AVERROR(EAGAIN) && res != AVERROR_EOF)
+		spa_log_warn(this->log, "%p: receive packet: %s", this, av_err2str(res));
+}
+
+static void encode_buffer(struct impl *this, uint32_t id)
+{
+	struct port *port = GET_IN_PORT(this, 0);
+	struct buffer *b = &port->buffers[id];
+	AVFrame *frame;
+	int res;
+
+	if (this->mode == MODE_SW)
+		frame = wrap_buffer(this, b);
+	else
+		frame = import_dmabuf(this, b);
+
+	if (frame == NULL)
+		return;
+	if (b->h)
+		frame->pts = b->h->pts;
+
+	res = avcodec_send_frame(this->ctx, frame);
+	av_frame_free(&frame);
+	if (res < 0)
+		spa_log_warn(this->log, "%p: send frame: %s", this, av_err2str(res));
+
+	receive_packets(this);
+}
+
+static void *encode_thread(void *data)
+{
+	struct impl *this = data;
+	uint32_t id;
+
+	pthread_mutex_lock(&this->lock);
+	while (this->running) {
+		if ((id = id_ring_pop(&this->encode_queue)) == SPA_ID_INVALID) {
+			pthread_cond_wait(&this->cond, &this->lock);
+			continue;
+		}
+		pthread_mutex_unlock(&this->lock);
+		encode_buffer(this, id);
+		pthread_mutex_lock(&this->lock);
+	}
+	pthread_mutex_unlock(&this->lock);
+	return NULL;
+}
+
+static int start_encoder(struct impl *this)
+{
+	int res;
+
+	if ((res = open_encoder(this)) < 0)
+		return res;
+
+	this->running = true;
+	if ((res = pthread_create(&this->thread, NULL, encode_thread, this)) != 0) {
+		this->running = false;
+		close_encoder(this);
+		return -res;
+	}
+	return 0;
+}
+
+static void stop_encoder(struct impl *this)
+{
+	if (!this->running)
+		return;
+
+	pthread_mutex_lock(&this->lock);
+	this->running = false;
+	pthread_cond_signal(&this->cond);
+	pthread_mutex_unlock(&this->lock);
+	pthread_join(this->thread, NULL);
+
+	close_encoder(this);
+}
+
 static int impl_node_send_command(void *object, const struct spa_command *command)
 {
 	struct impl *this = object;
+	int res;
 
 	if (this == NULL || command == NULL)
 		return -EINVAL;
 
 	switch (SPA_NODE_COMMAND_ID(command)) {
 	case SPA_NODE_COMMAND_Start:
+		if (this->started)
+			return 0;
+		if ((res = start_encoder(this)) < 0)
+			return res;
 		this->started = true;
 		break;
+	case SPA_NODE_COMMAND_Suspend:
 	case SPA_NODE_COMMAND_Pause:
+		stop_encoder(this);
 		this->started = false;
 		break;
 	default:
@@ -180,6 +689,22 @@ impl_node_remove_port(void *object,
 	return -ENOTSUP;
 }
 
+static uint32_t codec_media_subtype(const AVCodec *codec)
+{
+	switch (codec->id) {
+	case AV_CODEC_ID_H264:
+		return SPA_MEDIA_SUBTYPE_h264;
+	case AV_CODEC_ID_MJPEG:
+		return SPA_MEDIA_SUBTYPE_mjpg;
+	case AV_CODEC_ID_VP8:
+		return SPA_MEDIA_SUBTYPE_vp8;
+	case AV_CODEC_ID_VP9:
+		return SPA_MEDIA_SUBTYPE_vp9;
+	default:
+		return SPA_ID_INVALID;
+	}
+}
+
 static int port_enum_formats(void *object,
 			enum spa_direction direction, uint32_t port_id,
 			uint32_t index,
@@ -187,7 +712,103 @@ static int port_enum_formats(void *object,
 			struct spa_pod **param,
 			struct spa_pod_builder *builder)
 {
-	return -ENOTSUP;
+	struct impl *this = object;
+	struct port *other = GET_PORT(this, SPA_DIRECTION_REVERSE(direction), port_id);
+	struct spa_rectangle size = SPA_RECTANGLE(1920, 1080);
+	struct spa_fraction framerate = SPA_FRACTION(30, 1);
+	struct spa_pod_frame f[2];
+	uint32_t i, n_formats = 0;
+
+	if (index > 0)
+		return 0;
+
+	if (other->have_format) {
+		if (other->current_format.media_subtype == SPA_MEDIA_SUBTYPE_raw) {
+			size = other->current_format.info.raw.size;
+			framerate = other->current_format.info.raw.framerate;
+		} else {
+			size = other->current_format.info.h264.size;
+			framerate = other->current_format.info.h264.framerate;
+		}
+	}
+
+	spa_pod_builder_push_object(builder, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+
+	if (direction == SPA_DIRECTION_OUTPUT) {
+		uint32_t subtype = codec_media_subtype(this->codec);
+
+		if (subtype == SPA_ID_INVALID) {
+			spa_pod_builder_pop(builder, &f[0]);
+			return 0;
+		}
+		spa_pod_builder_add(builder,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(subtype),
+			0);
+		if (subtype == SPA_MEDIA_SUBTYPE_h264)
+			spa_pod_builder_add(builder,
+				SPA_FORMAT_VIDEO_H264_streamFormat,
+					SPA_POD_Id(SPA_H264_STREAM_FORMAT_BYTESTREAM),
+				SPA_FORMAT_VIDEO_H264_alignment,
+					SPA_POD_Id(SPA_H264_ALIGNMENT_AU),
+				0);
+	} else {
+		spa_pod_builder_add(builder,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+			0);
+
+		spa_pod_builder_prop(builder, SPA_FORMAT_VIDEO_format, 0);
+		spa_pod_builder_push_choice(builder, &f[1], SPA_CHOICE_Enum, 0);
+		if (this->mode == MODE_HW_MAP) {
+			spa_pod_builder_id(builder, hw_formats[0]);
+			for (i = 0; i < SPA_N_ELEMENTS(hw_formats); i++)
+				spa_pod_builder_id(builder, hw_formats[i]);
+			n_formats = SPA_N_ELEMENTS(hw_formats);
+		} else {
+			const enum AVPixelFormat *p;
+			const struct format_info *fi;
+
+			for (p = this->codec->pix_fmts; p && *p != AV_PIX_FMT_NONE; p++) {
+				if ((fi = find_format_info_by_pix_fmt(*p)) == NULL)
+					continue;
+				if (n_formats++ == 0)
+					spa_pod_builder_id(builder, fi->format);
+				spa_pod_builder_id(builder, fi->format);
+			}
+			if (n_formats == 0 && this->mode == MODE_DRM_PRIME) {
+				spa_pod_builder_id(builder, SPA_VIDEO_FORMAT_NV12);
+				spa_pod_builder_id(builder, SPA_VIDEO_FORMAT_NV12);
+				n_formats++;
+			}
+		}
+		spa_pod_builder_pop(builder, &f[1]);
+
+		if (n_formats == 0) {
+			spa_pod_builder_pop(builder, &f[0]);
+			return 0;
+		}
+		/* the hardware paths only take DMABUFs */
+		if (this->mode != MODE_SW) {
+			spa_pod_builder_prop(builder, SPA_FORMAT_VIDEO_modifier,
+					SPA_POD_PROP_FLAG_MANDATORY);
+			spa_pod_builder_long(builder, DRM_FORMAT_MOD_LINEAR);
+		}
+	}
+	spa_pod_builder_add(builder,
+		SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle(
+			&size,
+			&SPA_RECTANGLE(1, 1),
+			&SPA_RECTANGLE(8192, 8192)),
+		SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+			&framerate,
+			&SPA_FRACTION(0, 1),
+			&SPA_FRACTION(INT32_MAX, 1)),
+		0);
+
+	*param = spa_pod_builder_pop(builder, &f[0]);
+
+	return 1;
 }
 
 static int port_get_format(void *object,
@@ -208,8 +829,24 @@ static int port_get_format(void *object,
 	if (index > 0)
 		return 0;
 
-	*param = NULL;
-
+	switch (port->current_format.media_subtype) {
+	case SPA_MEDIA_SUBTYPE_raw:
+		*param = spa_format_video_raw_build(builder, SPA_PARAM_Format,
+				&port->current_format.info.raw);
+		break;
+	case SPA_MEDIA_SUBTYPE_h264:
+		*param = spa_format_video_h264_build(builder, SPA_PARAM_Format,
+				&port->current_format.info.h264);
+		break;
+	default:
+		*param = spa_pod_builder_add_object(builder,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_Format,
+			SPA_FORMAT_mediaType,		SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,	SPA_POD_Id(port->current_format.media_subtype),
+			SPA_FORMAT_VIDEO_size,		SPA_POD_Rectangle(&port->current_format.info.h264.size),
+			SPA_FORMAT_VIDEO_framerate,	SPA_POD_Fraction(&port->current_format.info.h264.framerate));
+		break;
+	}
 	return 1;
 }
 
@@ -220,6 +857,7 @@ impl_node_port_enum_params(void *object, int seq,
 			const struct spa_pod *filter)
 {
 	struct impl *this = object;
+	struct port *port;
 	struct spa_pod_builder b = { 0 };
 	uint8_t buffer[1024];
 	struct spa_pod *param;
@@ -227,6 +865,11 @@ impl_node_port_enum_params(void *object, int seq,
 	uint32_t count = 0;
 	int res;
 
+	if (!IS_VALID_PORT(this, direction, port_id))
+		return -EINVAL;
+
+	port = GET_PORT(this, direction, port_id);
+
 	result.id = id;
 	result.next = start;
       next:
@@ -247,6 +890,70 @@ impl_node_port_enum_params(void *object, int seq,
 			return res;
 		break;
 
+	case SPA_PARAM_Buffers:
+	{
+		struct port *in = GET_IN_PORT(this, 0);
+		const struct format_info *fi;
+		uint32_t size, blocks = 1, types;
+
+		if (!port->have_format || !in->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		if ((fi = find_format_info(in->current_format.info.raw.format)) == NULL)
+			return -EIO;
+
+		size = av_image_get_buffer_size(fi->pix_fmt,
+				in->current_format.info.raw.size.width,
+				in->current_format.info.raw.size.height, 1);
+
+		if (direction == SPA_DIRECTION_INPUT) {
+			blocks = av_pix_fmt_count_planes(fi->pix_fmt);
+			if (this->mode == MODE_SW)
+				types = (1<<SPA_DATA_MemPtr) | (1<<SPA_DATA_MemFd) |
+					(1<<SPA_DATA_DmaBuf);
+			else
+				types = 1<<SPA_DATA_DmaBuf;
+		} else {
+			/* encoded frames are smaller than the raw frames */
+			types = (1<<SPA_DATA_MemPtr) | (1<<SPA_DATA_MemFd);
+		}
+
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, id,
+			SPA_PARAM_BUFFERS_buffers,  SPA_POD_CHOICE_RANGE_Int(4, 2, MAX_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,   SPA_POD_Int(blocks),
+			SPA_PARAM_BUFFERS_size,     SPA_POD_Int(size),
+			SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(types));
+		break;
+	}
+	case SPA_PARAM_Meta:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	case SPA_PARAM_IO:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id,   SPA_POD_Id(SPA_IO_Buffers),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
 	default:
 		return -ENOENT;
 	}
@@ -262,6 +969,15 @@ impl_node_port_enum_params(void *object, int seq,
 	return 0;
 }
 
+static int clear_buffers(struct impl *this, struct port *port)
+{
+	if (port->n_buffers > 0) {
+		spa_log_debug(this->log, "%p: clear buffers", this);
+		port->n_buffers = 0;
+	}
+	return 0;
+}
+
 static int port_set_format(void *object,
 			   enum spa_direction direction, uint32_t port_id,
 			   uint32_t flags, const struct spa_pod *format)
@@ -274,24 +990,48 @@ static int port_set_format(void *object,
 
 	if (format == NULL) {
 		port->have_format = false;
+		clear_buffers(this, port);
 	} else {
 		struct spa_video_info info = { 0 };
 
 		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0)
 			return res;
 
-		if (info.media_type != SPA_MEDIA_TYPE_video &&
-		    info.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+		if (info.media_type != SPA_MEDIA_TYPE_video)
 			return -EINVAL;
 
-		if (spa_format_video_raw_parse(format, &info.info.raw) < 0)
-			return -EINVAL;
+		if (direction == SPA_DIRECTION_INPUT) {
+			if (info.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+				return -EINVAL;
+			if (spa_format_video_raw_parse(format, &info.info.raw) < 0)
+				return -EINVAL;
+			if (find_format_info(info.info.raw.format) == NULL)
+				return -ENOTSUP;
+		} else {
+			if (info.media_subtype != codec_media_subtype(this->codec))
+				return -EINVAL;
+			/* the h264 info has the size and framerate at the
+			 * same place as we use for the other codecs */
+			if (spa_format_video_h264_parse(format, &info.info.h264) < 0)
+				return -EINVAL;
+		}
 
 		if (!(flags & SPA_NODE_PARAM_FLAG_TEST_ONLY)) {
 			port->current_format = info;
 			port->have_format = true;
 		}
 	}
+
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	if (port->have_format) {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
+		port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	} else {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+		port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	}
+	emit_port_info(this, port, false);
+
 	return 0;
 }
 
@@ -315,13 +1055,63 @@ impl_node_port_use_buffers(void *object,
 				     uint32_t flags,
 				     struct spa_buffer **buffers, uint32_t n_buffers)
 {
-	if (object == NULL)
+	struct impl *this = object;
+	struct port *port;
+	uint32_t i;
+
+	if (this == NULL)
 		return -EINVAL;
 
 	if (!IS_VALID_PORT(object, direction, port_id))
 		return -EINVAL;
 
-	return -ENOTSUP;
+	port = GET_PORT(this, direction, port_id);
+
+	/* the encoder thread must not hold any of the buffers */
+	if (this->running) {
+		stop_encoder(this);
+		this->started = false;
+	}
+
+	clear_buffers(this, port);
+
+	if (n_buffers > 0 && !port->have_format)
+		return -EIO;
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
+
+	if (direction == SPA_DIRECTION_INPUT) {
+		id_ring_reset(&this->encode_queue);
+		id_ring_reset(&this->done_queue);
+	} else {
+		id_ring_reset(&this->free_queue);
+		id_ring_reset(&this->ready_queue);
+	}
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b = &port->buffers[i];
+		struct spa_data *d = buffers[i]->datas;
+
+		if (buffers[i]->n_datas == 0) {
+			spa_log_error(this->log, "%p: invalid blocks on buffer %d", this, i);
+			return -EINVAL;
+		}
+		if (direction == SPA_DIRECTION_OUTPUT && d[0].data == NULL) {
+			spa_log_error(this->log, "%p: invalid memory on buffer %d", this, i);
+			return -EINVAL;
+		}
+		b->id = i;
+		b->outbuf = buffers[i];
+		b->flags = 0;
+		b->impl = this;
+		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+
+		if (direction == SPA_DIRECTION_OUTPUT)
+			id_ring_push(&this->free_queue, i);
+	}
+	port->n_buffers = n_buffers;
+
+	return 0;
 }
 
 static int
@@ -353,36 +1143,72 @@ impl_node_port_set_io(void *object,
 static int
 impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
 {
-	if (object == NULL)
+	struct impl *this = object;
+
+	if (this == NULL)
 		return -EINVAL;
 
 	if (port_id != 0)
 		return -EINVAL;
 
-	return -ENOTSUP;
+	if (buffer_id >= GET_OUT_PORT(this, 0)->n_buffers)
+		return -EINVAL;
+
+	id_ring_push(&this->free_queue, buffer_id);
+
+	return 0;
 }
 
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
-	struct port *port;
-	struct spa_io_buffers *output;
+	struct port *in_port, *out_port;
+	struct spa_io_buffers *input, *output;
+	uint32_t id;
+	int res = 0;
 
 	if (this == NULL)
 		return -EINVAL;
 
-	if ((output = this->out_ports[0].io) == NULL)
-		return -EIO;
+	in_port = GET_IN_PORT(this, 0);
+	out_port = GET_OUT_PORT(this, 0);
 
-	port = &this->out_ports[0];
+	if ((input = in_port->io) == NULL || (output = out_port->io) == NULL)
+		return -EIO;
 
-	if (!port->have_format) {
+	if (!out_port->have_format || !this->running) {
 		output->status = -EIO;
 		return -EIO;
 	}
-	output->status = SPA_STATUS_OK;
 
-	return SPA_STATUS_OK;
+	/* recycle the output buffer that the peer is done with */
+	if (output->status != SPA_STATUS_HAVE_DATA &&
+	    output->buffer_id < out_port->n_buffers) {
+		id_ring_push(&this->free_queue, output->buffer_id);
+		output->buffer_id = SPA_ID_INVALID;
+	}
+
+	/* hand the new input buffer to the encoder thread, we keep it until
+	 * the encoder released it */
+	if (input->status == SPA_STATUS_HAVE_DATA &&
+	    input->buffer_id < in_port->n_buffers) {
+		id_ring_push(&this->encode_queue, input->buffer_id);
+		pthread_mutex_lock(&this->lock);
+		pthread_cond_signal(&this->cond);
+		pthread_mutex_unlock(&this->lock);
+	}
+	input->buffer_id = id_ring_pop(&this->done_queue);
+	input->status = SPA_STATUS_NEED_DATA;
+	res |= SPA_STATUS_NEED_DATA;
+
+	/* and push out the next encoded buffer */
+	if (output->status != SPA_STATUS_HAVE_DATA &&
+	    (id = id_ring_pop(&this->ready_queue)) != SPA_ID_INVALID) {
+		output->buffer_id = id;
+		output->status = SPA_STATUS_HAVE_DATA;
+		res |= SPA_STATUS_HAVE_DATA;
+	}
+	return res;
 }
 
 static const struct spa_node_methods impl_node = {
@@ -424,8 +1250,16 @@ impl_get_interface(struct spa_handle *handle, const char *type, void **interface
 static int
 impl_clear(struct spa_handle *handle)
 {
+	struct impl *this;
+
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
 
+	this = (struct impl *) handle;
+
+	stop_encoder(this);
+	pthread_cond_destroy(&this->cond);
+	pthread_mutex_destroy(&this->lock);
+
 	return 0;
 }
 
@@ -435,13 +1269,45 @@ spa_ffmpeg_enc_get_size(const struct spa_handle_factory *factory, const struct s
 	return sizeof(struct impl);
 }
 
+/* select how frames are passed to the codec. VAAPI codecs get DMABUFs
+ * mapped into a derived device, codecs that accept DRM PRIME frames
+ * (like some V4L2 M2M encoders) get the DMABUFs directly and all other
+ * codecs read from mapped memory. */
+static void probe_codec(struct impl *this)
+{
+	const AVCodecHWConfig *config;
+	const enum AVPixelFormat *p;
+	int i;
+
+	this->mode = MODE_SW;
+	this->hw_type = AV_HWDEVICE_TYPE_NONE;
+	this->hw_pix_fmt = AV_PIX_FMT_NONE;
+
+	for (i = 0; (config = avcodec_get_hw_config(this->codec, i)) != NULL; i++) {
+		if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) &&
+		    config->device_type == AV_HWDEVICE_TYPE_VAAPI) {
+			this->mode = MODE_HW_MAP;
+			this->hw_type = config->device_type;
+			this->hw_pix_fmt = config->pix_fmt;
+			return;
+		}
+	}
+	for (p = this->codec->pix_fmts; p && *p != AV_PIX_FMT_NONE; p++) {
+		if (*p == AV_PIX_FMT_DRM_PRIME) {
+			this->mode = MODE_DRM_PRIME;
+			return;
+		}
+	}
+}
+
 int
-spa_ffmpeg_enc_init(struct spa_handle *handle,
+spa_ffmpeg_enc_init(struct spa_handle *handle, const char *codec_name,
 		    const struct spa_dict *info,
 		    const struct spa_support *support, uint32_t n_support)
 {
 	struct impl *this;
 	struct port *port;
+	const char *str;
 
 	handle->get_interface = impl_get_interface;
 	handle->clear = impl_clear;
@@ -450,6 +1316,27 @@ spa_ffmpeg_enc_init(struct spa_handle *handle,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 
+	if ((this->codec = avcodec_find_encoder_by_name(codec_name)) == NULL) {
+		spa_log_error(this->log, "%p: unknown encoder %s", this, codec_name);
+		return -ENOENT;
+	}
+	probe_codec(this);
+
+	spa_scnprintf(this->device, sizeof(this->device), "%s", DEFAULT_DEVICE);
+	if (info) {
+		if ((str = spa_dict_lookup(info, "ffmpeg.device")) != NULL)
+			spa_scnprintf(this->device, sizeof(this->device), "%s", str);
+		if ((str = spa_dict_lookup(info, "ffmpeg.bitrate")) != NULL)
+			spa_atoi64(str, &this->bitrate, 0);
+		if ((str = spa_dict_lookup(info, "ffmpeg.gop-size")) != NULL)
+			spa_atoi32(str, &this->gop_size, 0);
+	}
+	spa_log_info(this->log, "%p: encoder %s mode:%d device:%s", this,
+			codec_name, this->mode, this->device);
+
+	pthread_mutex_init(&this->lock, NULL);
+	pthread_cond_init(&this->cond, NULL);
+
 	spa_hook_list_init(&this->hooks);
 
 	this->node.iface = SPA_INTERFACE_INIT(
@@ -470,10 +1357,13 @@ spa_ffmpeg_enc_init(struct spa_handle *handle,
 			SPA_PORT_CHANGE_MASK_PARAMS;
 	port->info = SPA_PORT_INFO_INIT();
 	port->info.flags = 0;
-	port->params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
-	port->params[1] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_EnumFormat] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[IDX_Meta] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[IDX_IO] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
 	port->info.params = port->params;
-	port->info.n_params = 2;
+	port->info.n_params = N_PORT_PARAMS;
 
 	port = GET_OUT_PORT(this, 0);
 	port->direction = SPA_DIRECTION_OUTPUT;
@@ -482,10 +1372,13 @@ spa_ffmpeg_enc_init(struct spa_handle *handle,
 			SPA_PORT_CHANGE_MASK_PARAMS;
 	port->info = SPA_PORT_INFO_INIT();
 	port->info.flags = 0;
-	port->params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
-	port->params[1] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_EnumFormat] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[IDX_Meta] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[IDX_IO] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
 	port->info.params = port->params;
-	port->info.n_params = 2;
+	port->info.n_params = N_PORT_PARAMS;
 
 	return 0;
 }
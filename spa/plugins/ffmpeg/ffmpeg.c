@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
@@ -36,7 +37,9 @@ ffmpeg_enc_init(const struct spa_handle_factory *factory,
 	if (factory == NULL || handle == NULL)
 		return -EINVAL;
 
-	return spa_ffmpeg_enc_init(handle, info, support, n_support);
+	/* factory names are encoder.<codec name> */
+	return spa_ffmpeg_enc_init(handle, factory->name + strlen("encoder."),
+			info, support, n_support);
 }
 
 static const struct spa_interface_info ffmpeg_interfaces[] = {
@@ -53,6 +53,7 @@ struct port {
 	struct spa_param_info params[5];
 
 	unsigned int have_format:1;
+	unsigned int is_dynamic:1;
 	struct spa_audio_info current_format;
 	int stride;
 
@@ -377,7 +378,8 @@ static int init_port(struct impl *this, struct port *port)
 			SPA_PORT_CHANGE_MASK_PROPS |
 			SPA_PORT_CHANGE_MASK_PARAMS;
 	port->info = SPA_PORT_INFO_INIT();
-	port->info.flags = SPA_PORT_FLAG_NO_REF;
+	port->info.flags = SPA_PORT_FLAG_NO_REF |
+		SPA_PORT_FLAG_DYNAMIC_DATA;
 
 	port->items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_FORMAT_DSP, "32 bit float mono audio");
 	port->props = SPA_DICT_INIT(port->items, 1);
@@ -693,6 +695,8 @@ impl_node_port_use_buffers(void *object,
 	if (n_buffers > MAX_BUFFERS)
 		return -ENOSPC;
 
+	port->is_dynamic = n_buffers > 0;
+
 	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b;
 
@@ -700,6 +704,8 @@ impl_node_port_use_buffers(void *object,
 		b->id = i;
 		b->outbuf = buffers[i];
 		b->flags = 0;
+		if (!SPA_FLAG_IS_SET(buffers[i]->datas[0].flags, SPA_DATA_FLAG_DYNAMIC))
+			port->is_dynamic = false;
 		spa_list_append(&port->empty, &b->link);
 	}
 	port->n_buffers = n_buffers;
@@ -782,7 +788,11 @@ static int impl_node_process(void *object)
 		src = jack_port_get_buffer(port->jack_port, n_frames);
 
 		d = &b->outbuf->datas[0];
-		spa_memcpy(d->data, src, n_frames * port->stride);
+		if (port->is_dynamic)
+			/* point the buffer to the JACK port memory for this cycle */
+			d->data = (void*)src;
+		else
+			spa_memcpy(d->data, src, n_frames * port->stride);
 		d->chunk->offset = 0;
 		d->chunk->size = n_frames * port->stride;
 		d->chunk->stride = port->stride;
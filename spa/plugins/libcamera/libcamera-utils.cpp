@@ -71,14 +71,9 @@ static int spa_libcamera_buffer_recycle(struct impl *impl, struct port *port, ui
 				buffer_id, impl->requestPool.size());
 		return -EINVAL;
 	}
+	/* the FrameBuffer stays attached to the request of the pool, we
+	 * only need to queue it again */
 	Request *request = impl->requestPool[buffer_id].get();
-	Stream *stream = port->streamConfig.stream();
-	FrameBuffer *buffer = impl->allocator->buffers(stream)[buffer_id].get();
-	if ((res = request->addBuffer(stream, buffer)) < 0) {
-		spa_log_warn(impl->log, "can't add buffer %u for request: %s",
-				buffer_id, spa_strerror(res));
-		return -ENOMEM;
-	}
 	if (!impl->active) {
 		impl->pendingRequests.push_back(request);
 		return 0;
@@ -96,17 +91,31 @@ static int spa_libcamera_buffer_recycle(struct impl *impl, struct port *port, ui
 
 static int allocBuffers(struct impl *impl, struct port *port, unsigned int count)
 {
+	Stream *stream = port->streamConfig.stream();
 	int res;
 
-	if ((res = impl->allocator->allocate(port->streamConfig.stream())) < 0)
+	if ((res = impl->allocator->allocate(stream)) < 0)
 		return res;
 
+	const std::vector<std::unique_ptr<FrameBuffer>> &bufs =
+			impl->allocator->buffers(stream);
+	count = SPA_MIN(count, (unsigned int)bufs.size());
+
+	/* create one request per buffer and attach the buffer once, the
+	 * requests are reused with ReuseBuffers for all following frames */
 	for (unsigned int i = 0; i < count; i++) {
+		int res2;
 		std::unique_ptr<Request> request = impl->camera->createRequest(i);
 		if (!request) {
 			impl->requestPool.clear();
 			return -ENOMEM;
 		}
+		if ((res2 = request->addBuffer(stream, bufs[i].get())) < 0) {
+			spa_log_error(impl->log, "can't add buffer %u for request: %s",
+					i, spa_strerror(res2));
+			impl->requestPool.clear();
+			return -ENOMEM;
+		}
 		impl->requestPool.push_back(std::move(request));
 	}
 	return res;
@@ -870,7 +879,7 @@ void impl::requestComplete(libcamera::Request *request)
 
 	if ((request->status() == Request::RequestCancelled)) {
 		spa_log_debug(impl->log, "Request was cancelled");
-		request->reuse();
+		request->reuse(Request::ReuseBuffers);
 		SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUTSTANDING);
 		spa_libcamera_buffer_recycle(impl, port, b->id);
 		return;
@@ -903,7 +912,7 @@ void impl::requestComplete(libcamera::Request *request)
 		b->h->pts = fmd.timestamp;
 		b->h->dts_offset = 0;
 	}
-	request->reuse();
+	request->reuse(Request::ReuseBuffers);
 
 	spa_ringbuffer_get_write_index(&port->ring, &index);
 	port->ring_ids[index & MASK_BUFFERS] = buffer_id;
@@ -982,7 +991,7 @@ static int spa_libcamera_stream_off(struct impl *impl)
 
 	if (!impl->active) {
 		for (std::unique_ptr<Request> &req : impl->requestPool)
-			req->reuse();
+			req->reuse(Request::ReuseBuffers);
 		return 0;
 	}
 
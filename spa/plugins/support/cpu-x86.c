@@ -52,6 +52,8 @@ x86_init(struct impl *impl)
 	has_osxsave = ecx & bit_OSXSAVE;
 	if (ecx & bit_FMA)
 		flags |= SPA_CPU_FLAG_FMA3;
+	if (ecx & bit_F16C)
+		flags |= SPA_CPU_FLAG_F16C;
 
 	if (edx & bit_CMOV)
 		flags |= SPA_CPU_FLAG_CMOV;
@@ -125,6 +127,7 @@ x86_init(struct impl *impl)
 		flags &= ~(SPA_CPU_FLAG_AVX |
 				SPA_CPU_FLAG_AVX2 |
 				SPA_CPU_FLAG_FMA3 |
+				SPA_CPU_FLAG_F16C |
 				SPA_CPU_FLAG_FMA4 |
 				SPA_CPU_FLAG_XOP);
 	}
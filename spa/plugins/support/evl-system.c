@@ -184,6 +184,8 @@ static int impl_pollfd_mod(void *object, int pfd, int fd, uint32_t events, void
 
 	e->events = events;
 	e->data = data;
+	if (!e->attached)
+		return 0;
 	return evl_mod_pollfd(pfd, fd, e->events, evl_nil);
 }
 
@@ -198,10 +200,30 @@ static int impl_pollfd_del(void *object, int pfd, int fd)
 
 	e->pfd = -1;
 	e->fd = -1;
+	if (!e->attached)
+		return 0;
 	e->attached = false;
 	return evl_del_pollfd(pfd, fd);
 }
 
+/* EVL timeouts are absolute on the EVL monotonic clock, a zero timeout
+ * waits forever */
+static inline void make_timeout(struct timespec *abstime, int64_t nsec)
+{
+	if (nsec < 0) {
+		abstime->tv_sec = 0;
+		abstime->tv_nsec = 0;
+		return;
+	}
+	evl_read_clock(EVL_CLOCK_MONOTONIC, abstime);
+	abstime->tv_sec += nsec / SPA_NSEC_PER_SEC;
+	abstime->tv_nsec += nsec % SPA_NSEC_PER_SEC;
+	if (abstime->tv_nsec >= (long)SPA_NSEC_PER_SEC) {
+		abstime->tv_sec++;
+		abstime->tv_nsec -= SPA_NSEC_PER_SEC;
+	}
+}
+
 static int impl_pollfd_wait(void *object, int pfd,
 		struct spa_poll_event *ev, int n_ev, int timeout)
 {
@@ -223,14 +245,12 @@ static int impl_pollfd_wait(void *object, int pfd,
 		}
 	}
 
-	if (timeout == -1) {
-		tv.tv_sec = 0;
-		tv.tv_nsec = 0;
-	} else {
-		tv.tv_sec = timeout / SPA_MSEC_PER_SEC;
-		tv.tv_nsec = (timeout % SPA_MSEC_PER_SEC) * SPA_NSEC_PER_MSEC;
-	}
+	/* a 0 timeout gives the current time, which has expired when
+	 * evl_timedpoll() checks it, so it does not block */
+	make_timeout(&tv, timeout < 0 ? -1 : (int64_t)timeout * SPA_NSEC_PER_MSEC);
 	res = evl_timedpoll(pfd, pollset, n_ev, &tv);
+	if (res == -ETIMEDOUT)
+		return 0;
 	if (SPA_UNLIKELY(res < 0))
 		return res;
 
@@ -270,17 +290,11 @@ static int impl_timerfd_settime(void *object,
 {
 	struct itimerspec val = *new_value;
 
-	if (!(flags & SPA_FD_TIMER_ABSTIME)) {
-		struct timespec now;
+	/* a zero value disarms the timer and must stay zero */
+	if (!(flags & SPA_FD_TIMER_ABSTIME) &&
+	    (val.it_value.tv_sec != 0 || val.it_value.tv_nsec != 0))
+		make_timeout(&val.it_value, SPA_TIMESPEC_TO_NSEC(&new_value->it_value));
 
-		evl_read_clock(EVL_CLOCK_MONOTONIC, &now);
-		val.it_value.tv_sec += now.tv_sec;
-		val.it_value.tv_nsec += now.tv_nsec;
-		if (val.it_value.tv_nsec >= 1000000000) {
-			val.it_value.tv_sec++;
-			val.it_value.tv_nsec -= 1000000000;
-		}
-	}
 	return evl_set_timer(fd, &val, old_value);
 }
 
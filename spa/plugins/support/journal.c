@@ -21,6 +21,8 @@
 
 #include <systemd/sd-journal.h>
 
+#include "log-queue.h"
+
 #undef SPA_LOG_TOPIC_DEFAULT
 #define SPA_LOG_TOPIC_DEFAULT &log_topic
 SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.journal");
@@ -33,8 +35,58 @@ struct impl {
 
 	/* if non-null, we'll additionally forward all logging to there */
 	struct spa_log *chain_log;
+
+	struct log_queue queue;
+	unsigned int async:1;
 };
 
+static void journal_send(enum spa_log_level level, const char *file, int line,
+		const char *func, int tid, const char *message)
+{
+	char line_buffer[32];
+	char file_buffer[strlen("CODE_FILE=") + strlen(file) + 1];
+	int priority;
+
+	/* convert SPA log level to syslog priority */
+	switch (level) {
+	case SPA_LOG_LEVEL_ERROR:
+		priority = LOG_ERR;
+		break;
+	case SPA_LOG_LEVEL_WARN:
+		priority = LOG_WARNING;
+		break;
+	case SPA_LOG_LEVEL_INFO:
+		priority = LOG_INFO;
+		break;
+	case SPA_LOG_LEVEL_DEBUG:
+	case SPA_LOG_LEVEL_TRACE:
+	default:
+		priority = LOG_DEBUG;
+		break;
+	}
+
+	/* we'll be using the low-level journal API, which expects us to provide
+	 * the location explicitly. line and file are to be passed as preformatted
+	 * entries, whereas the function name is passed as-is, and converted into
+	 * a field inside sd_journal_send_with_location(). */
+	snprintf(line_buffer, sizeof(line_buffer), "CODE_LINE=%d", line);
+	snprintf(file_buffer, sizeof(file_buffer), "CODE_FILE=%s", file);
+
+	sd_journal_send_with_location(file_buffer, line_buffer, func,
+				      "MESSAGE=%s", message,
+				      "PRIORITY=%i", priority,
+#ifdef HAVE_GETTID
+				      "TID=%jd", (intmax_t) tid,
+#endif
+				      NULL);
+}
+
+static void queue_write(void *data, const struct log_record *rec)
+{
+	journal_send(rec->level, rec->file, rec->line,
+			rec->func, rec->tid, rec->data);
+}
+
 static SPA_PRINTF_FUNC(7,0) void
 impl_log_logtv(void *object,
 	      enum spa_log_level level,
@@ -47,11 +99,9 @@ impl_log_logtv(void *object,
 {
 	static const char * const levels[] = { "-", "E", "W", "I", "D", "T", "*T*" };
 	struct impl *impl = object;
-	char line_buffer[32];
-	char file_buffer[strlen("CODE_FILE=") + strlen(file) + 1];
 	char message_buffer[LINE_MAX];
-	int priority;
 	size_t sz = 0;
+	int tid = 0;
 
 	if (impl->chain_log != NULL) {
 		va_list args_copy;
@@ -63,24 +113,6 @@ impl_log_logtv(void *object,
 		va_end(args_copy);
 	}
 
-	/* convert SPA log level to syslog priority */
-	switch (level) {
-	case SPA_LOG_LEVEL_ERROR:
-		priority = LOG_ERR;
-		break;
-	case SPA_LOG_LEVEL_WARN:
-		priority = LOG_WARNING;
-		break;
-	case SPA_LOG_LEVEL_INFO:
-		priority = LOG_INFO;
-		break;
-	case SPA_LOG_LEVEL_DEBUG:
-	case SPA_LOG_LEVEL_TRACE:
-	default:
-		priority = LOG_DEBUG;
-		break;
-	}
-
 	if (spa_log_level_topic_enabled(&impl->log, topic, SPA_LOG_LEVEL_DEBUG)) {
 		const char *lev = levels[SPA_CLAMP(level, 0u, SPA_N_ELEMENTS(levels) - 1u)];
 		const char *tp = topic ? topic->topic : "";
@@ -102,21 +134,30 @@ impl_log_logtv(void *object,
 				"%s: ", topic->topic);
 	}
 
-	/* we'll be using the low-level journal API, which expects us to provide
-	 * the location explicitly. line and file are to be passed as preformatted
-	 * entries, whereas the function name is passed as-is, and converted into
-	 * a field inside sd_journal_send_with_location(). */
-	snprintf(line_buffer, sizeof(line_buffer), "CODE_LINE=%d", line);
-	snprintf(file_buffer, sizeof(file_buffer), "CODE_FILE=%s", file);
 	vsnprintf(message_buffer + sz, sizeof(message_buffer) - sz, fmt, args);
 
-	sd_journal_send_with_location(file_buffer, line_buffer, func,
-				      "MESSAGE=%s", message_buffer,
-				      "PRIORITY=%i", priority,
 #ifdef HAVE_GETTID
-				      "TID=%jd", (intmax_t) gettid(),
+	tid = gettid();
 #endif
-				      NULL);
+	if (impl->async) {
+		struct log_record *r;
+
+		if ((r = log_queue_begin(&impl->queue)) == NULL)
+			return;
+
+		r->level = level;
+		spa_scnprintf(r->file, sizeof(r->file), "%s", file ? file : "");
+		r->line = line;
+		spa_scnprintf(r->func, sizeof(r->func), "%s", func ? func : "");
+		r->tid = tid;
+		r->size = spa_scnprintf(r->data, sizeof(r->data), "%s", message_buffer);
+
+		if (log_queue_commit(&impl->queue, r))
+			log_queue_wakeup(&impl->queue);
+	} else {
+		journal_send(level, file ? file : "", line, func ? func : "",
+				tid, message_buffer);
+	}
 }
 
 static SPA_PRINTF_FUNC(6,7) void
@@ -187,12 +228,16 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 static int impl_clear(struct spa_handle *handle)
 {
-	struct impl SPA_UNUSED *this;
+	struct impl *this;
 
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
 
 	this = (struct impl *) handle;
 
+	log_queue_stop(&this->queue);
+	this->async = false;
+	log_queue_flush(&this->queue);
+
 	return 0;
 }
 
@@ -257,9 +302,20 @@ impl_init(const struct spa_handle_factory *factory,
 			&impl_log, impl);
 	impl->log.level = DEFAULT_LOG_LEVEL;
 
+	log_queue_init(&impl->queue, queue_write, impl);
+
 	if (info) {
 		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_LEVEL)) != NULL)
 			impl->log.level = atoi(str);
+		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_ASYNC)) != NULL &&
+		    spa_atob(str)) {
+			int res;
+			if ((res = log_queue_start(&impl->queue)) < 0)
+				fprintf(stderr, "Warning: failed to start log thread: %s\n",
+						strerror(-res));
+			else
+				impl->async = true;
+		}
 	}
 
 	/* if our stderr goes to the journal, there's no point in logging both
@@ -0,0 +1,172 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef SPA_LOG_QUEUE_H
+#define SPA_LOG_QUEUE_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/atomic.h>
+#include <spa/support/log.h>
+
+/* A bounded queue of log records with multiple producers and one consumer.
+ * Producers never block or allocate, when the queue is full the message is
+ * dropped and counted. The consumer writes the records from a loop or from
+ * its own thread. */
+
+#define LOG_QUEUE_RECORDS	64
+#define LOG_QUEUE_MASK		(LOG_QUEUE_RECORDS - 1)
+#define LOG_QUEUE_SIZE		1024
+#define LOG_QUEUE_FILE_SIZE	128
+#define LOG_QUEUE_FUNC_SIZE	64
+
+struct log_record {
+	uint64_t seq;
+	uint64_t pos;
+	int level;
+	int line;
+	int tid;
+	/* copies, the strings of the caller can be gone when the record
+	 * is written */
+	char file[LOG_QUEUE_FILE_SIZE];
+	char func[LOG_QUEUE_FUNC_SIZE];
+	uint32_t size;
+	char data[LOG_QUEUE_SIZE];
+};
+
+struct log_queue {
+	uint64_t head;
+	uint64_t tail;
+	uint32_t dropped;
+	uint32_t signaled;
+
+	void (*write) (void *data, const struct log_record *rec);
+	void *data;
+
+	pthread_t thread;
+	sem_t sem;
+	uint32_t running;
+
+	struct log_record records[LOG_QUEUE_RECORDS];
+};
+
+static inline void log_queue_init(struct log_queue *q,
+		void (*write) (void *data, const struct log_record *rec), void *data)
+{
+	uint32_t i;
+
+	q->head = q->tail = 0;
+	q->dropped = q->signaled = q->running = 0;
+	q->write = write;
+	q->data = data;
+	for (i = 0; i < LOG_QUEUE_RECORDS; i++)
+		q->records[i].seq = i;
+}
+
+/* reserve a record, returns NULL when the queue is full */
+static inline struct log_record *log_queue_begin(struct log_queue *q)
+{
+	struct log_record *r;
+	uint64_t pos, seq;
+
+	pos = SPA_ATOMIC_LOAD(q->head);
+	while (true) {
+		r = &q->records[pos & LOG_QUEUE_MASK];
+		seq = SPA_ATOMIC_LOAD(r->seq);
+		if (seq == pos) {
+			if (SPA_ATOMIC_CAS(q->head, pos, pos + 1))
+				break;
+		} else if ((int64_t)(seq - pos) < 0) {
+			SPA_ATOMIC_INC(q->dropped);
+			return NULL;
+		}
+		pos = SPA_ATOMIC_LOAD(q->head);
+	}
+	r->pos = pos;
+	return r;
+}
+
+/* make the record available to the consumer, returns true when the
+ * consumer needs to be woken up */
+static inline bool log_queue_commit(struct log_queue *q, struct log_record *r)
+{
+	SPA_ATOMIC_STORE(r->seq, r->pos + 1);
+	return SPA_ATOMIC_XCHG(q->signaled, 1) == 0;
+}
+
+/* write all pending records, must be called from one thread only */
+static inline void log_queue_flush(struct log_queue *q)
+{
+	struct log_record *r, drop;
+	uint32_t dropped;
+
+	SPA_ATOMIC_STORE(q->signaled, 0);
+
+	while (true) {
+		r = &q->records[q->tail & LOG_QUEUE_MASK];
+		if (SPA_ATOMIC_LOAD(r->seq) != q->tail + 1)
+			break;
+		q->write(q->data, r);
+		SPA_ATOMIC_STORE(r->seq, q->tail + LOG_QUEUE_RECORDS);
+		q->tail++;
+	}
+	if ((dropped = SPA_ATOMIC_XCHG(q->dropped, 0)) > 0) {
+		spa_zero(drop);
+		drop.level = SPA_LOG_LEVEL_WARN;
+		drop.size = snprintf(drop.data, sizeof(drop.data),
+				"%u log messages dropped\n", dropped);
+		q->write(q->data, &drop);
+	}
+}
+
+static inline void *log_queue_thread(void *data)
+{
+	struct log_queue *q = data;
+
+	while (SPA_ATOMIC_LOAD(q->running)) {
+		if (sem_wait(&q->sem) < 0 && errno == EINTR)
+			continue;
+		log_queue_flush(q);
+	}
+	return NULL;
+}
+
+/* start a thread to write the records */
+static inline int log_queue_start(struct log_queue *q)
+{
+	int res;
+
+	if (sem_init(&q->sem, 0, 0) < 0)
+		return -errno;
+
+	q->running = 1;
+	if ((res = pthread_create(&q->thread, NULL, log_queue_thread, q)) != 0) {
+		q->running = 0;
+		sem_destroy(&q->sem);
+		return -res;
+	}
+	return 0;
+}
+
+static inline void log_queue_wakeup(struct log_queue *q)
+{
+	sem_post(&q->sem);
+}
+
+static inline void log_queue_stop(struct log_queue *q)
+{
+	if (!q->running)
+		return;
+
+	SPA_ATOMIC_STORE(q->running, 0);
+	sem_post(&q->sem);
+	pthread_join(q->thread, NULL);
+	sem_destroy(&q->sem);
+}
+
+#endif /* SPA_LOG_QUEUE_H */
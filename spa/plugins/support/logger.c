@@ -14,12 +14,13 @@
 #include <spa/support/loop.h>
 #include <spa/support/system.h>
 #include <spa/support/plugin.h>
-#include <spa/utils/ringbuffer.h>
 #include <spa/utils/type.h>
 #include <spa/utils/names.h>
 #include <spa/utils/string.h>
 #include <spa/utils/ansi.h>
 
+#include "log-queue.h"
+
 #if defined(__FreeBSD__) || defined(__MidnightBSD__)
 #define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
 #endif
@@ -30,8 +31,6 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.logger");
 
 #define DEFAULT_LOG_LEVEL SPA_LOG_LEVEL_INFO
 
-#define TRACE_BUFFER (16*1024)
-
 struct impl {
 	struct spa_handle handle;
 	struct spa_log log;
@@ -41,10 +40,10 @@ struct impl {
 
 	struct spa_system *system;
 	struct spa_source source;
-	struct spa_ringbuffer trace_rb;
-	uint8_t trace_data[TRACE_BUFFER];
+	struct log_queue queue;
 
 	unsigned int have_source:1;
+	unsigned int async:1;
 	unsigned int colors:1;
 	unsigned int timestamp:1;
 	unsigned int line:1;
@@ -70,10 +69,16 @@ impl_log_logtv(void *object,
 	static const char * const levels[] = { "-", "E", "W", "I", "D", "T", "*T*" };
 	const char *prefix = "", *suffix = "";
 	int size, len;
-	bool do_trace;
+	bool do_queue;
 
-	if ((do_trace = (level == SPA_LOG_LEVEL_TRACE && impl->have_source)))
+	/* trace messages are written from the loop when possible, other
+	 * messages only when they are written asynchronously */
+	if (level == SPA_LOG_LEVEL_TRACE && impl->have_source) {
+		do_queue = true;
 		level++;
+	} else {
+		do_queue = impl->async;
+	}
 
 	if (impl->colors) {
 		if (level <= SPA_LOG_LEVEL_ERROR)
@@ -134,16 +139,21 @@ impl_log_logtv(void *object,
 
 	size += spa_scnprintf(p + size, len - size, "%s\n", suffix);
 
-	if (SPA_UNLIKELY(do_trace)) {
-		uint32_t index;
+	if (SPA_UNLIKELY(do_queue)) {
+		struct log_record *r;
+
+		if ((r = log_queue_begin(&impl->queue)) == NULL)
+			return;
 
-		spa_ringbuffer_get_write_index(&impl->trace_rb, &index);
-		spa_ringbuffer_write_data(&impl->trace_rb, impl->trace_data, TRACE_BUFFER,
-					  index & (TRACE_BUFFER - 1), location, size);
-		spa_ringbuffer_write_update(&impl->trace_rb, index + size);
+		r->size = SPA_MIN(size, LOG_QUEUE_SIZE);
+		memcpy(r->data, location, r->size);
 
-		if (spa_system_eventfd_write(impl->system, impl->source.fd, 1) < 0)
-			fprintf(impl->file, "error signaling eventfd: %s\n", strerror(errno));
+		if (log_queue_commit(&impl->queue, r)) {
+			if (!impl->have_source)
+				log_queue_wakeup(&impl->queue);
+			else if (spa_system_eventfd_write(impl->system, impl->source.fd, 1) < 0)
+				fprintf(impl->file, "error signaling eventfd: %s\n", strerror(errno));
+		}
 	} else
 		fputs(location, impl->file);
 
@@ -191,32 +201,21 @@ impl_log_log(void *object,
 	va_end(args);
 }
 
+static void queue_write(void *data, const struct log_record *rec)
+{
+	struct impl *impl = data;
+	fwrite(rec->data, rec->size, 1, impl->file);
+}
+
 static void on_trace_event(struct spa_source *source)
 {
 	struct impl *impl = source->data;
-	int32_t avail;
-	uint32_t index;
 	uint64_t count;
 
 	if (spa_system_eventfd_read(impl->system, source->fd, &count) < 0)
 		fprintf(impl->file, "failed to read event fd: %s", strerror(errno));
 
-	while ((avail = spa_ringbuffer_get_read_index(&impl->trace_rb, &index)) > 0) {
-		int32_t offset, first;
-
-		if (avail > TRACE_BUFFER) {
-			index += avail - TRACE_BUFFER;
-			avail = TRACE_BUFFER;
-		}
-		offset = index & (TRACE_BUFFER - 1);
-		first = SPA_MIN(avail, TRACE_BUFFER - offset);
-
-		fwrite(impl->trace_data + offset, first, 1, impl->file);
-		if (SPA_UNLIKELY(avail > first)) {
-			fwrite(impl->trace_data, avail - first, 1, impl->file);
-		}
-		spa_ringbuffer_read_update(&impl->trace_rb, index + avail);
-        }
+	log_queue_flush(&impl->queue);
 }
 
 static const struct spa_log_methods impl_log = {
@@ -252,14 +251,21 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
-	if (this->close_file && this->file != NULL)
-		fclose(this->file);
+	log_queue_stop(&this->queue);
 
 	if (this->have_source) {
 		spa_loop_remove_source(this->source.loop, &this->source);
 		spa_system_close(this->system, this->source.fd);
 		this->have_source = false;
 	}
+	this->async = false;
+
+	/* write what is left in the queue */
+	log_queue_flush(&this->queue);
+
+	if (this->close_file && this->file != NULL)
+		fclose(this->file);
+
 	return 0;
 }
 
@@ -282,6 +288,7 @@ impl_init(const struct spa_handle_factory *factory,
 	const char *str, *dest = "";
 	bool linebuf = false;
 	bool force_colors = false;
+	bool async = false;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -329,6 +336,8 @@ impl_init(const struct spa_handle_factory *factory,
 		}
 		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_LEVEL)) != NULL)
 			this->log.level = atoi(str);
+		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_ASYNC)) != NULL)
+			async = spa_atob(str);
 		if ((str = spa_dict_lookup(info, SPA_KEY_LOG_FILE)) != NULL) {
 			dest = str;
 			if (spa_streq(str, "stderr"))
@@ -357,9 +366,21 @@ impl_init(const struct spa_handle_factory *factory,
 		this->colors = false;
 	}
 
-	spa_ringbuffer_init(&this->trace_rb);
+	log_queue_init(&this->queue, queue_write, this);
+
+	/* without a loop, use a thread to write the messages */
+	if (async) {
+		int res;
+		if (this->have_source)
+			this->async = true;
+		else if ((res = log_queue_start(&this->queue)) < 0)
+			fprintf(stderr, "Warning: failed to start log thread: %s\n", strerror(-res));
+		else
+			this->async = true;
+	}
 
-	spa_log_debug(&this->log, "%p: initialized to %s linebuf:%u", this, dest, linebuf);
+	spa_log_debug(&this->log, "%p: initialized to %s linebuf:%u async:%u",
+			this, dest, linebuf, this->async);
 
 	return 0;
 }
@@ -2,6 +2,8 @@
 /* SPDX-FileCopyrightText: Copyright © 2018 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include "config.h"
+
 #include <unistd.h>
 #include <errno.h>
 #include <sys/types.h>
@@ -25,6 +27,8 @@
 #include <spa/utils/ringbuffer.h>
 #include <spa/utils/string.h>
 
+#include <sdt-probes.h>
+
 SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.loop");
 
 #undef SPA_LOG_TOPIC_DEFAULT
@@ -36,6 +40,7 @@ SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.loop");
 #define DATAS_SIZE	(4096*8)
 #define MAX_EP		32
 #define DEFAULT_RETRY	(1 * SPA_USEC_PER_SEC)
+#define LATENCY_PERIOD	(1 * SPA_NSEC_PER_SEC)
 
 /** \cond */
 
@@ -49,6 +54,7 @@ struct invoke_item {
 	bool block;
 	void *user_data;
 	int res;
+	uint64_t time;
 };
 
 static int loop_signal_event(void *object, struct spa_source *source);
@@ -67,6 +73,7 @@ struct impl {
 	struct spa_list queue_list;
 	struct spa_hook_list hooks_list;
 	int retry_timeout;
+	uint64_t spin_time;
 
 	int poll_fd;
 	pthread_t thread;
@@ -79,6 +86,14 @@ struct impl {
 	uint32_t count;
 	uint32_t flush_count;
 
+	uint64_t spin_count;
+	uint64_t spin_hits;
+
+	uint64_t invoke_count;
+	uint64_t invoke_latency_total;
+	uint64_t invoke_latency_max;
+	uint64_t invoke_latency_start;
+
 	unsigned int polling:1;
 };
 
@@ -177,6 +192,42 @@ static inline int32_t item_compare(struct invoke_item *a, struct invoke_item *b)
 	return (int32_t)(a->count - b->count);
 }
 
+static inline bool latency_enabled(struct impl *impl)
+{
+	return spa_log_level_topic_enabled(impl->log, &log_topic, SPA_LOG_LEVEL_DEBUG);
+}
+
+/* The invoke latency is only measured when debug logging is enabled for
+ * the loop, items that were queued without it have no time. The stats
+ * are logged and reset every LATENCY_PERIOD. */
+static inline void update_latency(struct impl *impl, struct invoke_item *item)
+{
+	uint64_t now, latency;
+
+	if (item->time == 0)
+		return;
+
+	now = get_time_ns(impl->system);
+	latency = now - item->time;
+
+	impl->invoke_count++;
+	impl->invoke_latency_total += latency;
+	impl->invoke_latency_max = SPA_MAX(impl->invoke_latency_max, latency);
+
+	if (impl->invoke_latency_start == 0) {
+		impl->invoke_latency_start = now;
+	} else if (now - impl->invoke_latency_start >= LATENCY_PERIOD) {
+		spa_log_debug(impl->log, "%p: invoked %"PRIu64" items, latency avg:%"PRIu64
+				" max:%"PRIu64" nsec", impl, impl->invoke_count,
+				impl->invoke_latency_total / impl->invoke_count,
+				impl->invoke_latency_max);
+		impl->invoke_count = 0;
+		impl->invoke_latency_total = 0;
+		impl->invoke_latency_max = 0;
+		impl->invoke_latency_start = now;
+	}
+}
+
 static void flush_all_queues(struct impl *impl)
 {
 	uint32_t flush_count;
@@ -185,52 +236,70 @@ static void flush_all_queues(struct impl *impl)
 	pthread_mutex_lock(&impl->queue_lock);
 	flush_count = ++impl->flush_count;
 	while (true) {
-		struct queue *cqueue, *queue;
+		struct queue *cqueue, *queue = NULL;
 		struct invoke_item *citem, *item = NULL;
-		uint32_t cindex, index;
+		uint32_t cindex, index, n_queues = 0;
+		int32_t cavail, avail = 0;
 		spa_invoke_func_t func;
 		bool block;
 
 		spa_list_for_each(cqueue, &impl->queue_list, link) {
-			if (spa_ringbuffer_get_read_index(&cqueue->buffer, &cindex) <
+			if ((cavail = spa_ringbuffer_get_read_index(&cqueue->buffer, &cindex)) <
 					(int32_t)sizeof(struct invoke_item))
 				continue;
 			citem = SPA_PTROFF(cqueue->buffer_data, cindex & (DATAS_SIZE - 1), struct invoke_item);
+			n_queues++;
 
 			if (item == NULL || item_compare(citem, item) < 0) {
 				item = citem;
 				queue = cqueue;
 				index = cindex;
+				avail = cavail;
 			}
 		}
 		if (item == NULL)
 			break;
 
-		spa_log_trace_fp(impl->log, "%p: flush item %p", queue, item);
-		/* first we remove the function from the item so that recursive
-		 * calls don't call the callback again. We can't update the
-		 * read index before we call the function because then the item
-		 * might get overwritten. */
-		func = spa_steal_ptr(item->func);
-		if (func)
-			item->res = func(&impl->loop, true, item->seq, item->data,
-				item->size, item->user_data);
-
-		/* if this function did a recursive invoke, it now flushed the
-		 * ringbuffer and we can exit */
-		if (flush_count != impl->flush_count)
-			break;
+		/* When there is only one queue with items, we can flush all the
+		 * items that are in the queue now without looking at the other
+		 * queues again, the items are already in the right order. */
+		if (n_queues > 1)
+			avail = item->item_size;
+
+		while (true) {
+			spa_log_trace_fp(impl->log, "%p: flush item %p", queue, item);
+			/* first we remove the function from the item so that recursive
+			 * calls don't call the callback again. We can't update the
+			 * read index before we call the function because then the item
+			 * might get overwritten. */
+			func = spa_steal_ptr(item->func);
+			if (func) {
+				update_latency(impl, item);
+				item->res = func(&impl->loop, true, item->seq, item->data,
+					item->size, item->user_data);
+			}
 
-		index += item->item_size;
-		block = item->block;
-		spa_ringbuffer_read_update(&queue->buffer, index);
+			/* if this function did a recursive invoke, it now flushed the
+			 * ringbuffer and we can exit */
+			if (flush_count != impl->flush_count)
+				goto done;
 
-		if (block) {
-			if ((res = spa_system_eventfd_write(impl->system, queue->ack_fd, 1)) < 0)
-				spa_log_warn(impl->log, "%p: failed to write event fd:%d: %s",
-						queue, queue->ack_fd, spa_strerror(res));
+			index += item->item_size;
+			avail -= item->item_size;
+			block = item->block;
+			spa_ringbuffer_read_update(&queue->buffer, index);
+
+			if (block) {
+				if ((res = spa_system_eventfd_write(impl->system, queue->ack_fd, 1)) < 0)
+					spa_log_warn(impl->log, "%p: failed to write event fd:%d: %s",
+							queue, queue->ack_fd, spa_strerror(res));
+			}
+			if (avail < (int32_t)sizeof(struct invoke_item))
+				break;
+			item = SPA_PTROFF(queue->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
 		}
 	}
+done:
 	pthread_mutex_unlock(&impl->queue_lock);
 }
 
@@ -277,6 +346,7 @@ retry:
 	item->block = in_thread ? false : block;
 	item->user_data = user_data;
 	item->res = 0;
+	item->time = latency_enabled(impl) ? get_time_ns(impl->system) : 0;
 	item->item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
 
 	spa_log_trace_fp(impl->log, "%p: add item %p filled:%d", queue, item, filled);
@@ -511,6 +581,40 @@ static void cancellation_handler(void *closure)
 	}
 }
 
+/* When a spin time is configured, first poll without blocking until an
+ * event arrives or the spin time is over. This avoids the scheduler wakeup
+ * latency when the events are expected soon, at the cost of keeping the
+ * CPU busy. */
+static int loop_poll_wait(struct impl *impl, struct spa_poll_event *ep, int n_ep, int timeout)
+{
+	uint64_t start, now, end;
+	int nfds;
+
+	if (SPA_LIKELY(impl->spin_time == 0 || timeout == 0))
+		return spa_system_pollfd_wait(impl->system, impl->poll_fd, ep, n_ep, timeout);
+
+	start = now = get_time_ns(impl->system);
+	end = start + impl->spin_time;
+	if (timeout > 0)
+		end = SPA_MIN(end, start + timeout * SPA_NSEC_PER_MSEC);
+
+	impl->spin_count++;
+	do {
+		nfds = spa_system_pollfd_wait(impl->system, impl->poll_fd, ep, n_ep, 0);
+		if (nfds != 0) {
+			if (nfds > 0)
+				impl->spin_hits++;
+			return nfds;
+		}
+		now = get_time_ns(impl->system);
+	} while (now < end);
+
+	if (timeout > 0)
+		timeout = SPA_MAX(timeout - (int)((now - start) / SPA_NSEC_PER_MSEC), 0);
+
+	return spa_system_pollfd_wait(impl->system, impl->poll_fd, ep, n_ep, timeout);
+}
+
 static int loop_iterate_cancel(void *object, int timeout)
 {
 	struct impl *impl = object;
@@ -520,7 +624,7 @@ static int loop_iterate_cancel(void *object, int timeout)
 	impl->polling = true;
 	spa_loop_control_hook_before(&impl->hooks_list);
 
-	nfds = spa_system_pollfd_wait(impl->system, impl->poll_fd, ep, SPA_N_ELEMENTS(ep), timeout);
+	nfds = loop_poll_wait(impl, ep, SPA_N_ELEMENTS(ep), timeout);
 
 	spa_loop_control_hook_after(&impl->hooks_list);
 	impl->polling = false;
@@ -567,11 +671,13 @@ static int loop_iterate(void *object, int timeout)
 	impl->polling = true;
 	spa_loop_control_hook_before(&impl->hooks_list);
 
-	nfds = spa_system_pollfd_wait(impl->system, impl->poll_fd, ep, SPA_N_ELEMENTS(ep), timeout);
+	nfds = loop_poll_wait(impl, ep, SPA_N_ELEMENTS(ep), timeout);
 
 	spa_loop_control_hook_after(&impl->hooks_list);
 	impl->polling = false;
 
+	SDT_PROBE(spa, loop_iterate, impl, timeout, nfds);
+
 	/* first we set all the rmasks, then call the callbacks. The reason is that
 	 * some callback might also want to look at other sources it manages and
 	 * can then reset the rmask to suppress the callback */
@@ -1061,6 +1167,10 @@ static int impl_clear(struct spa_handle *handle)
 	spa_list_consume(queue, &impl->queue_list, link)
 		loop_queue_destroy(queue);
 
+	if (impl->spin_count > 0)
+		spa_log_info(impl->log, "%p: spin found events %"PRIu64" of %"PRIu64" times",
+				impl, impl->spin_hits, impl->spin_count);
+
 	spa_system_close(impl->system, impl->poll_fd);
 	pthread_mutex_destroy(&impl->queue_lock);
 	tss_delete(impl->queue_tss_id);
@@ -1123,6 +1233,8 @@ impl_init(const struct spa_handle_factory *factory,
 			impl->control.iface.cb.funcs = &impl_loop_control_cancel;
 		if ((str = spa_dict_lookup(info, "loop.retry-timeout")) != NULL)
 			impl->retry_timeout = atoi(str);
+		if ((str = spa_dict_lookup(info, "loop.spin-time")) != NULL)
+			impl->spin_time = SPA_MAX(atoi(str), 0) * SPA_NSEC_PER_USEC;
 	}
 
 	CHECK(pthread_mutexattr_init(&attr), error_exit);
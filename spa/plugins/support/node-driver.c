@@ -95,8 +95,14 @@ struct impl {
 	struct spa_dll dll;
 	double max_error;
 	double max_resync;
+	double peak_error;
 
 	struct clock_offset nsec_offset;
+
+	/* freewheel statistics, data thread only */
+	uint64_t fw_start;
+	uint64_t fw_report;
+	uint64_t fw_rendered;
 };
 
 static void reset_props(struct props *props)
@@ -172,10 +178,29 @@ static inline uint64_t gettime_nsec(struct impl *this, clockid_t clock_id)
 	return nsec;
 }
 
+static void freewheel_report(struct impl *this, uint64_t nsec, bool done)
+{
+	uint64_t elapsed = nsec - this->fw_start;
+
+	if (elapsed == 0)
+		return;
+
+	spa_log_info(this->log, "%p: freewheel%s rendered %.3fs in %.3fs: %.2fx realtime",
+			this, done ? " done," : "",
+			this->fw_rendered / (double)SPA_NSEC_PER_SEC,
+			elapsed / (double)SPA_NSEC_PER_SEC,
+			this->fw_rendered / (double)elapsed);
+	this->fw_report = nsec;
+}
+
 static int set_timers(struct impl *this)
 {
 	this->next_time = gettime_nsec(this, this->timer_clockid);
 
+	if (this->fw_start != 0 && !this->started)
+		freewheel_report(this, this->next_time, true);
+	this->fw_start = this->fw_report = this->fw_rendered = 0;
+
 	spa_log_debug(this->log, "%p now:%"PRIu64, this, this->next_time);
 
 	if (this->following || !this->started) {
@@ -372,7 +397,13 @@ static void on_timeout(struct spa_source *source)
 
 	if (this->props.freewheel) {
 		corr = 1.0;
+		/* this is only a timeout, the next cycle is started as soon as
+		 * the graph completes this one, see impl_node_process() */
 		this->next_time = nsec + this->props.freewheel_wait * SPA_NSEC_PER_SEC;
+		if (this->fw_start == 0)
+			this->fw_start = this->fw_report = nsec;
+		else if (SPA_UNLIKELY(nsec - this->fw_report > BW_PERIOD))
+			freewheel_report(this, nsec, false);
 	} else if (this->tracking) {
 		/* check the elapsed time of the other clock against
 		 * the graph clock elapsed time, feed this error into the
@@ -391,6 +422,7 @@ static void on_timeout(struct spa_source *source)
 		}
 		corr = spa_dll_update(&this->dll, err);
 		this->next_time = (uint64_t)(nsec + duration / corr * 1e9 / rate);
+		this->peak_error = SPA_MAX(this->peak_error, fabs(err));
 	} else {
 		corr = 1.0;
 		this->next_time = scale_u64(position + duration, SPA_NSEC_PER_SEC, rate);
@@ -398,10 +430,13 @@ static void on_timeout(struct spa_source *source)
 
 	if (SPA_UNLIKELY((this->next_time - this->base_time) > BW_PERIOD)) {
 		this->base_time = this->next_time;
-		spa_log_debug(this->log, "%p: rate:%f "
-			"bw:%f dur:%"PRIu64" max:%f drift:%f",
-				this, corr, this->dll.bw, duration,
-				this->max_error, err);
+		/* the drift against the followed clock in ppm and the largest
+		 * phase error since the last report in usec */
+		spa_log_debug(this->log, "%p: rate:%f (%+.3f ppm) "
+			"bw:%f dur:%"PRIu64" max:%f drift:%f peak:%.3fus",
+				this, corr, (corr - 1.0) * 1e6, this->dll.bw, duration,
+				this->max_error, err, this->peak_error * 1e6 / rate);
+		this->peak_error = 0.0;
 	}
 
 	if (SPA_LIKELY(this->clock)) {
@@ -431,6 +466,7 @@ static int do_start(struct impl *this)
 	this->following = is_following(this);
 	this->started = true;
 	this->last_time = 0;
+	this->peak_error = 0.0;
 	spa_loop_invoke(this->data_loop, do_set_timers, 0, NULL, 0, true, this);
 	return 0;
 }
@@ -525,6 +561,10 @@ static int impl_node_process(void *object)
 	spa_log_trace(this->log, "process %d", this->props.freewheel);
 
 	if (this->props.freewheel) {
+		if (SPA_LIKELY(this->clock) && this->clock->rate.denom > 0)
+			this->fw_rendered += this->clock->duration * SPA_NSEC_PER_SEC *
+				this->clock->rate.num / this->clock->rate.denom;
+
 		this->next_time = gettime_nsec(this, this->timer_clockid);
 		set_timeout(this, this->next_time);
 	}
@@ -593,6 +593,9 @@ static int calc_width(struct spa_audio_info *info)
 	case SPA_AUDIO_FORMAT_S16P:
 	case SPA_AUDIO_FORMAT_S16:
 	case SPA_AUDIO_FORMAT_S16_OE:
+	case SPA_AUDIO_FORMAT_F16P:
+	case SPA_AUDIO_FORMAT_F16:
+	case SPA_AUDIO_FORMAT_F16_OE:
 		return 2;
 	case SPA_AUDIO_FORMAT_S24P:
 	case SPA_AUDIO_FORMAT_S24:
@@ -0,0 +1,889 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+#include <linux/io_uring.h>
+
+#include <spa/support/log.h>
+#include <spa/support/system.h>
+#include <spa/support/plugin.h>
+#include <spa/utils/list.h>
+#include <spa/utils/type.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+#include <spa/utils/string.h>
+
+SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.uring-system");
+
+#undef SPA_LOG_TOPIC_DEFAULT
+#define SPA_LOG_TOPIC_DEFAULT &log_topic
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#  define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+#ifndef IORING_SETUP_COOP_TASKRUN
+#  define IORING_SETUP_COOP_TASKRUN (1U << 8)
+#endif
+
+#define RING_ENTRIES	256
+
+/* One poll entry per fd. The address of the entry is the user_data of the
+ * poll request so it can only be reused after the kernel posted the
+ * completion for it. */
+struct poll_entry {
+	struct spa_list link;
+	int fd;
+	uint32_t events;
+	void *data;
+	unsigned armed:1;
+	unsigned removed:1;
+	unsigned rearm:1;
+};
+
+/* A ring is what the pollfd of the spa_system API refers to. Changes to
+ * the polled fds are queued as SQEs and submitted together with the wait
+ * for completions, so that a loop iteration costs a single syscall.
+ *
+ * Polls are oneshot and armed again when they complete. The new poll is
+ * only queued at the start of the next wait, after the events were
+ * dispatched, and completes right away when the fd is still ready. This
+ * gives the same level triggered behaviour as epoll. */
+struct ring {
+	struct spa_list link;
+	int fd;
+
+	pthread_mutex_t lock;
+	pthread_t owner;
+	unsigned has_owner:1;
+
+	void *sq_ptr;
+	size_t sq_size;
+	void *cq_ptr;
+	size_t cq_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned sq_mask;
+	unsigned sq_entries;
+	unsigned sqe_tail;
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+
+	struct spa_list entries;
+	struct spa_list free;
+	unsigned n_rearm;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_system system;
+        struct spa_log *log;
+
+	pthread_mutex_t lock;
+	struct spa_list rings;
+};
+
+static inline int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		unsigned flags, void *arg, size_t argsz)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static void ring_free(struct ring *r)
+{
+	struct poll_entry *e;
+
+	spa_list_consume(e, &r->entries, link) {
+		spa_list_remove(&e->link);
+		free(e);
+	}
+	spa_list_consume(e, &r->free, link) {
+		spa_list_remove(&e->link);
+		free(e);
+	}
+	if (r->sqes != NULL && r->sqes != MAP_FAILED)
+		munmap(r->sqes, r->sqes_size);
+	if (r->cq_ptr != NULL && r->cq_ptr != MAP_FAILED && r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_size);
+	if (r->sq_ptr != NULL && r->sq_ptr != MAP_FAILED)
+		munmap(r->sq_ptr, r->sq_size);
+	if (r->fd >= 0)
+		close(r->fd);
+	pthread_mutex_destroy(&r->lock);
+	free(r);
+}
+
+static struct ring *ring_new(struct impl *impl)
+{
+	struct io_uring_params p;
+	struct ring *r;
+	unsigned *sq_array, i;
+	int res;
+
+	if ((r = calloc(1, sizeof(*r))) == NULL)
+		return NULL;
+
+	r->fd = -1;
+	pthread_mutex_init(&r->lock, NULL);
+	spa_list_init(&r->entries);
+	spa_list_init(&r->free);
+
+	spa_zero(p);
+	p.flags = IORING_SETUP_CLAMP | IORING_SETUP_COOP_TASKRUN;
+	if ((r->fd = sys_io_uring_setup(RING_ENTRIES, &p)) < 0 && errno == EINVAL) {
+		/* older kernels don't know about COOP_TASKRUN */
+		spa_zero(p);
+		p.flags = IORING_SETUP_CLAMP;
+		r->fd = sys_io_uring_setup(RING_ENTRIES, &p);
+	}
+	if (r->fd < 0)
+		goto error;
+
+	if (!(p.features & IORING_FEAT_EXT_ARG) ||
+	    !(p.features & IORING_FEAT_NODROP)) {
+		spa_log_error(impl->log, "%p: io_uring is missing required features:%08x",
+				impl, p.features);
+		errno = ENOTSUP;
+		goto error;
+	}
+
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		r->sq_size = r->cq_size = SPA_MAX(r->sq_size, r->cq_size);
+
+	r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED)
+		goto error;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	} else {
+		r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED)
+			goto error;
+	}
+
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED)
+		goto error;
+
+	r->sq_head = SPA_PTROFF(r->sq_ptr, p.sq_off.head, unsigned);
+	r->sq_tail = SPA_PTROFF(r->sq_ptr, p.sq_off.tail, unsigned);
+	r->sq_mask = *SPA_PTROFF(r->sq_ptr, p.sq_off.ring_mask, unsigned);
+	r->sq_entries = p.sq_entries;
+	r->sqe_tail = *r->sq_tail;
+
+	/* we fill the SQEs in order, make the index array an identity map */
+	sq_array = SPA_PTROFF(r->sq_ptr, p.sq_off.array, unsigned);
+	for (i = 0; i < p.sq_entries; i++)
+		sq_array[i] = i;
+
+	r->cq_head = SPA_PTROFF(r->cq_ptr, p.cq_off.head, unsigned);
+	r->cq_tail = SPA_PTROFF(r->cq_ptr, p.cq_off.tail, unsigned);
+	r->cq_mask = *SPA_PTROFF(r->cq_ptr, p.cq_off.ring_mask, unsigned);
+	r->cqes = SPA_PTROFF(r->cq_ptr, p.cq_off.cqes, struct io_uring_cqe);
+
+	spa_log_debug(impl->log, "%p: new ring fd:%d sq:%u cq:%u features:%08x",
+			impl, r->fd, p.sq_entries, p.cq_entries, p.features);
+	return r;
+
+error:
+	res = errno;
+	ring_free(r);
+	errno = res;
+	return NULL;
+}
+
+static struct ring *find_ring(struct impl *impl, int fd)
+{
+	struct ring *r, *found = NULL;
+
+	pthread_mutex_lock(&impl->lock);
+	spa_list_for_each(r, &impl->rings, link) {
+		if (r->fd == fd) {
+			found = r;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&impl->lock);
+	return found;
+}
+
+/* must be called with the ring lock, returns the number of queued SQEs
+ * the kernel did not consume yet */
+static inline unsigned ring_flush(struct ring *r)
+{
+	__atomic_store_n(r->sq_tail, r->sqe_tail, __ATOMIC_RELEASE);
+	return r->sqe_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/* must be called with the ring lock */
+static int ring_submit(struct ring *r)
+{
+	unsigned to_submit = ring_flush(r);
+	int res;
+
+	if (to_submit == 0)
+		return 0;
+	if ((res = sys_io_uring_enter(r->fd, to_submit, 0, 0, NULL, 0)) < 0)
+		return -errno;
+	return res;
+}
+
+/* must be called with the ring lock */
+static struct io_uring_sqe *ring_get_sqe(struct ring *r)
+{
+	struct io_uring_sqe *sqe;
+
+	if (r->sqe_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+		ring_submit(r);
+		if (r->sqe_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries)
+			return NULL;
+	}
+	sqe = &r->sqes[r->sqe_tail & r->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	r->sqe_tail++;
+	return sqe;
+}
+
+/* must be called with the ring lock. Requests queued by the thread that
+ * waits on the ring are submitted with the next wait, other threads submit
+ * right away so that the waiting thread sees the change. */
+static int ring_commit(struct ring *r)
+{
+	if (r->has_owner && pthread_equal(r->owner, pthread_self()))
+		return 0;
+	return ring_submit(r);
+}
+
+static int queue_poll_add(struct ring *r, struct poll_entry *e)
+{
+	struct io_uring_sqe *sqe;
+	uint32_t events = e->events;
+
+	if ((sqe = ring_get_sqe(r)) == NULL)
+		return -EBUSY;
+
+#if __BYTE_ORDER == __BIG_ENDIAN
+	events = (events << 16) | (events >> 16);
+#endif
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = e->fd;
+	sqe->poll32_events = events;
+	sqe->user_data = (uintptr_t) e;
+	e->armed = true;
+	return 0;
+}
+
+static int queue_poll_remove(struct ring *r, struct poll_entry *e)
+{
+	struct io_uring_sqe *sqe;
+
+	if ((sqe = ring_get_sqe(r)) == NULL)
+		return -EBUSY;
+
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = (uintptr_t) e;
+	sqe->user_data = 0;
+	return 0;
+}
+
+static struct poll_entry *find_entry(struct ring *r, int fd)
+{
+	struct poll_entry *e;
+	spa_list_for_each(e, &r->entries, link) {
+		if (e->fd == fd && !e->removed)
+			return e;
+	}
+	return NULL;
+}
+
+static inline void release_entry(struct ring *r, struct poll_entry *e)
+{
+	spa_list_remove(&e->link);
+	spa_list_append(&r->free, &e->link);
+}
+
+/* must be called with the ring lock */
+static int add_entry(struct ring *r, int fd, uint32_t events, void *data)
+{
+	struct poll_entry *e;
+	int res;
+
+	if (!spa_list_is_empty(&r->free)) {
+		e = spa_list_first(&r->free, struct poll_entry, link);
+		spa_list_remove(&e->link);
+	} else if ((e = calloc(1, sizeof(*e))) == NULL) {
+		return -errno;
+	}
+	e->fd = fd;
+	e->events = events;
+	e->data = data;
+	e->armed = false;
+	e->removed = false;
+	e->rearm = false;
+	spa_list_append(&r->entries, &e->link);
+
+	if ((res = queue_poll_add(r, e)) < 0) {
+		release_entry(r, e);
+		return res;
+	}
+	return 0;
+}
+
+/* must be called with the ring lock */
+static int remove_entry(struct ring *r, struct poll_entry *e)
+{
+	e->removed = true;
+	if (e->rearm) {
+		e->rearm = false;
+		r->n_rearm--;
+	}
+	if (!e->armed) {
+		release_entry(r, e);
+		return 0;
+	}
+	/* the entry is released when the cancelled poll completes */
+	return queue_poll_remove(r, e);
+}
+
+static ssize_t impl_read(void *object, int fd, void *buf, size_t count)
+{
+	ssize_t res = read(fd, buf, count);
+	return res < 0 ? -errno : res;
+}
+
+static ssize_t impl_write(void *object, int fd, const void *buf, size_t count)
+{
+	ssize_t res = write(fd, buf, count);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_ioctl(void *object, int fd, unsigned long request, ...)
+{
+	int res;
+	va_list ap;
+	long arg;
+
+	va_start(ap, request);
+	arg = va_arg(ap, long);
+	res = ioctl(fd, request, arg);
+	va_end(ap);
+
+	return res < 0 ? -errno : res;
+}
+
+static int impl_close(void *object, int fd)
+{
+	struct impl *impl = object;
+	struct ring *r;
+	int res;
+
+	if ((r = find_ring(impl, fd)) != NULL) {
+		pthread_mutex_lock(&impl->lock);
+		spa_list_remove(&r->link);
+		pthread_mutex_unlock(&impl->lock);
+		ring_free(r);
+		res = 0;
+	} else {
+		res = close(fd);
+	}
+	spa_log_debug(impl->log, "%p: close fd:%d", impl, fd);
+	return res < 0 ? -errno : res;
+}
+
+/* clock */
+static int impl_clock_gettime(void *object,
+			int clockid, struct timespec *value)
+{
+	int res = clock_gettime(clockid, value);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_clock_getres(void *object,
+			int clockid, struct timespec *res)
+{
+	int r = clock_getres(clockid, res);
+	return r < 0 ? -errno : r;
+}
+
+/* poll */
+static int impl_pollfd_create(void *object, int flags)
+{
+	struct impl *impl = object;
+	struct ring *r;
+
+	/* the ring fd is always close-on-exec */
+	if ((r = ring_new(impl)) == NULL) {
+		spa_log_error(impl->log, "%p: can't create io_uring: %m", impl);
+		return -errno;
+	}
+	pthread_mutex_lock(&impl->lock);
+	spa_list_append(&impl->rings, &r->link);
+	pthread_mutex_unlock(&impl->lock);
+
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, r->fd);
+	return r->fd;
+}
+
+static int impl_pollfd_add(void *object, int pfd, int fd, uint32_t events, void *data)
+{
+	struct impl *impl = object;
+	struct ring *r;
+	struct stat st;
+	int res;
+
+	if ((r = find_ring(impl, pfd)) == NULL)
+		return -EBADF;
+
+	/* match the epoll behaviour so that the loop can fall back to
+	 * an idle source for files */
+	if (fstat(fd, &st) < 0)
+		return -errno;
+	if (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode))
+		return -EPERM;
+
+	pthread_mutex_lock(&r->lock);
+	if (find_entry(r, fd) != NULL)
+		res = -EEXIST;
+	else if ((res = add_entry(r, fd, events, data)) >= 0)
+		res = ring_commit(r);
+	pthread_mutex_unlock(&r->lock);
+
+	return SPA_MIN(res, 0);
+}
+
+static int impl_pollfd_mod(void *object, int pfd, int fd, uint32_t events, void *data)
+{
+	struct impl *impl = object;
+	struct poll_entry *e;
+	struct ring *r;
+	int res;
+
+	if ((r = find_ring(impl, pfd)) == NULL)
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	if ((e = find_entry(r, fd)) == NULL)
+		res = -ENOENT;
+	else if (e->events == events && e->data == data && (e->armed || e->rearm))
+		res = 0;
+	else if ((res = remove_entry(r, e)) >= 0 &&
+	    (res = add_entry(r, fd, events, data)) >= 0)
+		res = ring_commit(r);
+	pthread_mutex_unlock(&r->lock);
+
+	return SPA_MIN(res, 0);
+}
+
+static int impl_pollfd_del(void *object, int pfd, int fd)
+{
+	struct impl *impl = object;
+	struct poll_entry *e;
+	struct ring *r;
+	int res;
+
+	if ((r = find_ring(impl, pfd)) == NULL)
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	if ((e = find_entry(r, fd)) == NULL)
+		res = -ENOENT;
+	else if ((res = remove_entry(r, e)) >= 0)
+		res = ring_commit(r);
+	pthread_mutex_unlock(&r->lock);
+
+	return SPA_MIN(res, 0);
+}
+
+/* must be called with the ring lock */
+static int ring_reap(struct impl *impl, struct ring *r,
+		struct spa_poll_event *ev, int n_ev)
+{
+	unsigned head, tail;
+	int nfds = 0;
+
+	head = *r->cq_head;
+	tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+	while (head != tail && nfds < n_ev) {
+		struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+		struct poll_entry *e = (struct poll_entry *)(uintptr_t) cqe->user_data;
+		int res = cqe->res;
+
+		head++;
+
+		/* completions of the remove requests */
+		if (e == NULL)
+			continue;
+
+		e->armed = false;
+
+		if (e->removed) {
+			release_entry(r, e);
+			continue;
+		}
+		if (SPA_UNLIKELY(res < 0)) {
+			spa_log_warn(impl->log, "%p: poll on fd:%d failed: %s",
+					impl, e->fd, spa_strerror(res));
+			continue;
+		}
+		/* armed again at the start of the next wait */
+		e->rearm = true;
+		r->n_rearm++;
+
+		if (res == 0)
+			continue;
+
+		ev[nfds].events = res;
+		ev[nfds].data = e->data;
+		nfds++;
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+	return nfds;
+}
+
+/* must be called with the ring lock, queues the polls that completed in
+ * the previous wait, their events have been dispatched now */
+static void ring_rearm(struct ring *r)
+{
+	struct poll_entry *e;
+
+	if (r->n_rearm == 0)
+		return;
+
+	spa_list_for_each(e, &r->entries, link) {
+		if (!e->rearm)
+			continue;
+		if (queue_poll_add(r, e) < 0)
+			break;
+		e->rearm = false;
+		if (--r->n_rearm == 0)
+			break;
+	}
+}
+
+static int impl_pollfd_wait(void *object, int pfd,
+		struct spa_poll_event *ev, int n_ev, int timeout)
+{
+	struct impl *impl = object;
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	struct ring *r;
+	unsigned to_submit, min_complete, flags;
+	int res, nfds;
+
+	if (SPA_UNLIKELY((r = find_ring(impl, pfd)) == NULL))
+		return -EBADF;
+
+	pthread_mutex_lock(&r->lock);
+	if (SPA_UNLIKELY(!r->has_owner || !pthread_equal(r->owner, pthread_self()))) {
+		r->owner = pthread_self();
+		r->has_owner = true;
+	}
+	ring_rearm(r);
+	nfds = ring_reap(impl, r, ev, n_ev);
+	if (nfds > 0) {
+		/* dispatch first, submitting now would complete the polls
+		 * of the fds that are still ready again */
+		pthread_mutex_unlock(&r->lock);
+		return nfds;
+	}
+	to_submit = ring_flush(r);
+	pthread_mutex_unlock(&r->lock);
+
+	min_complete = timeout != 0 ? 1 : 0;
+	if (to_submit == 0 && min_complete == 0)
+		return 0;
+
+	spa_zero(arg);
+	flags = IORING_ENTER_EXT_ARG;
+	if (min_complete > 0) {
+		flags |= IORING_ENTER_GETEVENTS;
+		if (timeout > 0) {
+			ts.tv_sec = timeout / SPA_MSEC_PER_SEC;
+			ts.tv_nsec = (timeout % SPA_MSEC_PER_SEC) * SPA_NSEC_PER_MSEC;
+			arg.ts = (uintptr_t) &ts;
+		}
+	}
+
+	res = sys_io_uring_enter(r->fd, to_submit, min_complete, flags, &arg, sizeof(arg));
+	if (res < 0 && errno != ETIME)
+		return -errno;
+
+	if (min_complete > 0) {
+		pthread_mutex_lock(&r->lock);
+		nfds = ring_reap(impl, r, ev, n_ev);
+		pthread_mutex_unlock(&r->lock);
+	}
+	return nfds;
+}
+
+/* timers */
+static int impl_timerfd_create(void *object, int clockid, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= TFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= TFD_NONBLOCK;
+	res = timerfd_create(clockid, fl);
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, res);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_timerfd_settime(void *object,
+			int fd, int flags,
+			const struct itimerspec *new_value,
+			struct itimerspec *old_value)
+{
+	int fl = 0, res;
+	if (flags & SPA_FD_TIMER_ABSTIME)
+		fl |= TFD_TIMER_ABSTIME;
+	if (flags & SPA_FD_TIMER_CANCEL_ON_SET)
+		fl |= TFD_TIMER_CANCEL_ON_SET;
+	res = timerfd_settime(fd, fl, new_value, old_value);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_timerfd_gettime(void *object,
+			int fd, struct itimerspec *curr_value)
+{
+	int res = timerfd_gettime(fd, curr_value);
+	return res < 0 ? -errno : res;
+
+}
+static int impl_timerfd_read(void *object, int fd, uint64_t *expirations)
+{
+	if (read(fd, expirations, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+/* events */
+static int impl_eventfd_create(void *object, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res, err;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= EFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= EFD_NONBLOCK;
+	if (flags & SPA_FD_EVENT_SEMAPHORE)
+		fl |= EFD_SEMAPHORE;
+	res = eventfd(0, fl);
+	err = -errno; /* save errno in case it is overwritten before return */
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, res);
+	return res < 0 ? err : res;
+}
+
+static int impl_eventfd_write(void *object, int fd, uint64_t count)
+{
+	/* this wakes up other threads, don't delay it until the next wait */
+	if (write(fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+static int impl_eventfd_read(void *object, int fd, uint64_t *count)
+{
+	if (read(fd, count, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+/* signals */
+static int impl_signalfd_create(void *object, int signal, int flags)
+{
+	struct impl *impl = object;
+	sigset_t mask;
+	int res, fl = 0;
+
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= SFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= SFD_NONBLOCK;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, signal);
+	res = signalfd(-1, &mask, fl);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	spa_log_debug(impl->log, "%p: new fd:%d", impl, res);
+
+	return res < 0 ? -errno : res;
+}
+
+static int impl_signalfd_read(void *object, int fd, int *signal)
+{
+	struct signalfd_siginfo signal_info;
+	int len;
+
+	len = read(fd, &signal_info, sizeof signal_info);
+	if (!(len == -1 && errno == EAGAIN) && len != sizeof signal_info)
+		return -errno;
+
+	*signal = signal_info.ssi_signo;
+
+	return 0;
+}
+
+static const struct spa_system_methods impl_system = {
+	SPA_VERSION_SYSTEM_METHODS,
+	.read = impl_read,
+	.write = impl_write,
+	.ioctl = impl_ioctl,
+	.close = impl_close,
+	.clock_gettime = impl_clock_gettime,
+	.clock_getres = impl_clock_getres,
+	.pollfd_create = impl_pollfd_create,
+	.pollfd_add = impl_pollfd_add,
+	.pollfd_mod = impl_pollfd_mod,
+	.pollfd_del = impl_pollfd_del,
+	.pollfd_wait = impl_pollfd_wait,
+	.timerfd_create = impl_timerfd_create,
+	.timerfd_settime = impl_timerfd_settime,
+	.timerfd_gettime = impl_timerfd_gettime,
+	.timerfd_read = impl_timerfd_read,
+	.eventfd_create = impl_eventfd_create,
+	.eventfd_write = impl_eventfd_write,
+	.eventfd_read = impl_eventfd_read,
+	.signalfd_create = impl_signalfd_create,
+	.signalfd_read = impl_signalfd_read,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *impl;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	if (spa_streq(type, SPA_TYPE_INTERFACE_System))
+		*interface = &impl->system;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *impl;
+	struct ring *r;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	spa_list_consume(r, &impl->rings, link) {
+		spa_list_remove(&r->link);
+		ring_free(r);
+	}
+	pthread_mutex_destroy(&impl->lock);
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *impl;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	impl = (struct impl *) handle;
+	impl->system.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_System,
+			SPA_VERSION_SYSTEM,
+			&impl_system, impl);
+
+	impl->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	spa_log_topic_init(impl->log, &log_topic);
+
+	pthread_mutex_init(&impl->lock, NULL);
+	spa_list_init(&impl->rings);
+
+	spa_log_debug(impl->log, "%p: initialized", impl);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_System,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	if (*index >= SPA_N_ELEMENTS(impl_interfaces))
+		return 0;
+
+	*info = &impl_interfaces[(*index)++];
+	return 1;
+}
+
+const struct spa_handle_factory spa_support_uring_system_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_SUPPORT_SYSTEM,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info
+};
@@ -0,0 +1,186 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef SPA_BENCHMARK_HELPER_H
+#define SPA_BENCHMARK_HELPER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include <spa/utils/json.h>
+
+/* Results of the kernel benchmarks, in operations per second, can be saved
+ * as a JSON object and compared with the results of an earlier run on the
+ * same machine:
+ *
+ *   SPA_BENCHMARK_RESULTS=<dir>    write <dir>/<name>.json
+ *   SPA_BENCHMARK_BASELINE=<dir>   compare with <dir>/<name>.json and fail
+ *                                  when a kernel is slower than the baseline
+ *   SPA_BENCHMARK_TOLERANCE=<pct>  by more than this percentage (default 15)
+ *
+ * The keys are "<kernel>/<impl>/<params>...". Single results of small sizes
+ * are too noisy to compare, so the geometric mean of the ratios with the
+ * baseline over all results of a kernel and implementation is used.
+ */
+struct benchmark_group {
+	char name[128];
+	double sum;
+	uint32_t count;
+};
+
+struct benchmark_results {
+	const char *name;
+	FILE *out;
+	char *baseline;
+	size_t baseline_len;
+	double tolerance;
+	uint32_t n_results;
+	struct benchmark_group *groups;
+	uint32_t n_groups;
+};
+
+static inline char *benchmark_read_file(const char *path, size_t *len)
+{
+	FILE *f;
+	char *data = NULL;
+	long size;
+
+	if ((f = fopen(path, "re")) == NULL)
+		return NULL;
+	if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 &&
+	    fseek(f, 0, SEEK_SET) == 0 &&
+	    (data = malloc(size)) != NULL) {
+		*len = fread(data, 1, size, f);
+	}
+	fclose(f);
+	return data;
+}
+
+static inline void benchmark_results_init(struct benchmark_results *r, const char *name)
+{
+	char path[PATH_MAX];
+	const char *str;
+
+	memset(r, 0, sizeof(*r));
+	r->name = name;
+	r->tolerance = 15.0;
+
+	if ((str = getenv("SPA_BENCHMARK_TOLERANCE")) != NULL)
+		r->tolerance = atof(str);
+
+	if ((str = getenv("SPA_BENCHMARK_RESULTS")) != NULL) {
+		snprintf(path, sizeof(path), "%s/%s.json", str, name);
+		if ((r->out = fopen(path, "we")) == NULL)
+			fprintf(stderr, "can't open %s: %m\n", path);
+		else
+			fprintf(r->out, "{\n");
+	}
+	if ((str = getenv("SPA_BENCHMARK_BASELINE")) != NULL) {
+		snprintf(path, sizeof(path), "%s/%s.json", str, name);
+		if ((r->baseline = benchmark_read_file(path, &r->baseline_len)) == NULL)
+			fprintf(stderr, "can't read baseline %s: %m\n", path);
+	}
+}
+
+static inline bool benchmark_baseline_find(struct benchmark_results *r, const char *key, float *val)
+{
+	struct spa_json it[2];
+	char k[256];
+	const char *v;
+	int len;
+
+	spa_json_init(&it[0], r->baseline, r->baseline_len);
+	if (spa_json_enter_object(&it[0], &it[1]) <= 0)
+		return false;
+
+	while (spa_json_get_string(&it[1], k, sizeof(k)) > 0) {
+		if ((len = spa_json_next(&it[1], &v)) <= 0)
+			break;
+		if (strcmp(k, key) == 0)
+			return spa_json_parse_float(v, len, val) > 0;
+	}
+	return false;
+}
+
+static inline struct benchmark_group *benchmark_group_get(struct benchmark_results *r,
+		const char *key)
+{
+	struct benchmark_group *g;
+	const char *end;
+	size_t len;
+	uint32_t i;
+
+	/* the group is the kernel and implementation */
+	if ((end = strchr(key, '/')) == NULL || (end = strchr(end + 1, '/')) == NULL)
+		end = key + strlen(key);
+	len = SPA_MIN((size_t)(end - key), sizeof(g->name) - 1);
+
+	for (i = 0; i < r->n_groups; i++) {
+		g = &r->groups[i];
+		if (strncmp(g->name, key, len) == 0 && g->name[len] == '\0')
+			return g;
+	}
+	if ((g = realloc(r->groups, (r->n_groups + 1) * sizeof(*g))) == NULL)
+		return NULL;
+	r->groups = g;
+	g = &r->groups[r->n_groups++];
+	memcpy(g->name, key, len);
+	g->name[len] = '\0';
+	g->sum = 0.0;
+	g->count = 0;
+	return g;
+}
+
+static inline void benchmark_results_add(struct benchmark_results *r, const char *key, uint64_t perf)
+{
+	struct benchmark_group *g;
+	float base;
+
+	if (r->out)
+		fprintf(r->out, "%s  \"%s\": %"PRIu64"\n", r->n_results ? "," : " ", key, perf);
+	r->n_results++;
+
+	if (r->baseline == NULL || perf == 0 ||
+	    !benchmark_baseline_find(r, key, &base) || base <= 0.0f)
+		return;
+	if ((g = benchmark_group_get(r, key)) == NULL)
+		return;
+	g->sum += log(perf / base);
+	g->count++;
+}
+
+/* returns the exit code of the benchmark */
+static inline int benchmark_results_finish(struct benchmark_results *r)
+{
+	uint32_t i, n_regressions = 0;
+
+	for (i = 0; i < r->n_groups; i++) {
+		struct benchmark_group *g = &r->groups[i];
+		double ratio = exp(g->sum / g->count);
+
+		if (ratio < 1.0 - r->tolerance / 100.0) {
+			fprintf(stderr, "%s: regression in %s: %.1f%% slower over %u results\n",
+					r->name, g->name, 100.0 * (1.0 - ratio), g->count);
+			n_regressions++;
+		}
+	}
+	if (r->out) {
+		fprintf(r->out, "}\n");
+		fclose(r->out);
+	}
+	free(r->baseline);
+	free(r->groups);
+
+	if (n_regressions > 0) {
+		fprintf(stderr, "%s: %u of %u kernels regressed more than %.1f%%\n",
+				r->name, n_regressions, r->n_groups, r->tolerance);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif /* SPA_BENCHMARK_HELPER_H */
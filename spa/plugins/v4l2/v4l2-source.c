@@ -12,6 +12,8 @@
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/loop.h>
+#include <spa/support/thread.h>
+#include <spa/utils/atomic.h>
 #include <spa/utils/list.h>
 #include <spa/utils/keys.h>
 #include <spa/utils/names.h>
@@ -25,6 +27,7 @@
 #include <spa/param/param.h>
 #include <spa/param/latency-utils.h>
 #include <spa/pod/filter.h>
+#include <spa/pod/dynamic.h>
 #include <spa/control/control.h>
 #include <spa/debug/types.h>
 
@@ -48,6 +51,7 @@ static void reset_props(struct props *props)
 #define BUFFER_FLAG_OUTSTANDING	(1<<0)
 #define BUFFER_FLAG_ALLOCATED	(1<<1)
 #define BUFFER_FLAG_MAPPED	(1<<2)
+#define BUFFER_FLAG_FENCED	(1<<3)
 
 struct buffer {
 	uint32_t id;
@@ -57,7 +61,36 @@ struct buffer {
 	struct spa_meta_header *h;
 	struct spa_meta_videotransform *vt;
 	struct v4l2_buffer v4l2_buffer;
+	struct v4l2_plane planes[1];
 	void *ptr;
+	struct spa_source fence;
+};
+
+#define MAX_FORMAT_CACHE	128
+
+struct format_cache {
+	uint32_t fourcc;
+	bool supported;
+};
+
+struct format_enum_state {
+	bool next_fmtdesc;
+	struct v4l2_fmtdesc fmtdesc;
+	bool next_frmsize;
+	struct v4l2_frmsizeenum frmsize;
+	struct v4l2_frmivalenum frmival;
+};
+
+/* all EnumFormat results of the device, without filter */
+struct format_enum {
+	char device[64];
+	struct spa_thread *thread;
+	bool started;
+	bool from_cache;
+	int done;
+	int res;
+	struct spa_pod_dynamic_builder b;
+	uint32_t n_formats;
 };
 
 #define MAX_CONTROLS	64
@@ -75,12 +108,14 @@ struct port {
 	bool alloc_buffers;
 	bool probed_expbuf;
 	bool have_expbuf;
+	bool no_sync_file;
 
-	bool next_fmtdesc;
-	struct v4l2_fmtdesc fmtdesc;
-	bool next_frmsize;
-	struct v4l2_frmsizeenum frmsize;
-	struct v4l2_frmivalenum frmival;
+	/* VIDIOC_TRY_FMT results of the device */
+	struct format_cache format_cache[MAX_FORMAT_CACHE];
+	uint32_t n_format_cache;
+
+	struct format_enum_state enum_state;
+	struct format_enum format_enum;
 
 	bool have_format;
 	struct spa_video_info current_format;
@@ -122,6 +157,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_loop *data_loop;
+	struct spa_thread_utils *thread_utils;
 
 	enum spa_meta_videotransform_value transform;
 
@@ -381,6 +417,8 @@ static int impl_node_set_param(void *object,
 				strncpy(p->device,
 						(char *)SPA_POD_CONTENTS(struct spa_pod_string, &prop->value),
 						sizeof(p->device)-1);
+				this->out_ports[0].n_format_cache = 0;
+				format_enum_start(this);
 				break;
 			default:
 				spa_v4l2_set_control(this, prop->key, prop);
@@ -960,6 +998,9 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 static int impl_clear(struct spa_handle *handle)
 {
+	struct impl *this = (struct impl *) handle;
+
+	format_enum_stop(this);
 	return 0;
 }
 
@@ -998,6 +1039,7 @@ impl_init(const struct spa_handle_factory *factory,
 		spa_log_error(this->log, "a data_loop is needed");
 		return -EINVAL;
 	}
+	this->thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
 
 	this->node.iface = SPA_INTERFACE_INIT(
 			SPA_TYPE_INTERFACE_Node,
@@ -1046,6 +1088,7 @@ impl_init(const struct spa_handle_factory *factory,
 	port->have_query_ext_ctrl = true;
 	port->dev.log = this->log;
 	port->dev.fd = -1;
+	spa_pod_dynamic_builder_init(&port->format_enum.b, NULL, 0, 4096);
 
 	for (i = 0; info && i < info->n_items; i++) {
 		const char *k = info->items[i].key;
@@ -1055,6 +1098,7 @@ impl_init(const struct spa_handle_factory *factory,
 			if ((res = spa_v4l2_open(&port->dev, this->props.device)) < 0)
 				return res;
 			spa_v4l2_close(&port->dev);
+			format_enum_start(this);
 		} else if (spa_streq(k, "meta.videotransform.transform")) {
 			this->transform = spa_debug_type_find_type_short(spa_type_meta_videotransform_type, s);
 		}
@@ -10,6 +10,7 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <poll.h>
+#include <linux/dma-buf.h>
 
 #include <spa/utils/result.h>
 
@@ -75,12 +76,25 @@ error:
 	return -err;
 }
 
-int spa_v4l2_is_capture(struct spa_v4l2_device *dev)
+static uint32_t device_caps(struct spa_v4l2_device *dev)
 {
 	uint32_t caps = dev->cap.capabilities;
 	if ((caps & V4L2_CAP_DEVICE_CAPS))
 		caps = dev->cap.device_caps;
-	return (caps & V4L2_CAP_VIDEO_CAPTURE) == V4L2_CAP_VIDEO_CAPTURE;
+	return caps;
+}
+
+int spa_v4l2_is_capture(struct spa_v4l2_device *dev)
+{
+	return (device_caps(dev) &
+		(V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_VIDEO_CAPTURE_MPLANE)) != 0;
+}
+
+/* only use the multi-planar API when the device can't do single-planar */
+int spa_v4l2_is_mplane(struct spa_v4l2_device *dev)
+{
+	uint32_t caps = device_caps(dev);
+	return !(caps & V4L2_CAP_VIDEO_CAPTURE) && (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE);
 }
 
 int spa_v4l2_close(struct spa_v4l2_device *dev)
@@ -100,12 +114,203 @@ int spa_v4l2_close(struct spa_v4l2_device *dev)
 	return 0;
 }
 
+static enum v4l2_buf_type buf_type(struct port *port)
+{
+	return spa_v4l2_is_mplane(&port->dev) ?
+		V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE :
+		V4L2_BUF_TYPE_VIDEO_CAPTURE;
+}
+
+/* with the multi-planar API, the memory is described by the planes. We only
+ * handle formats that use one memory plane. */
+static void buffer_init(struct port *port, struct buffer *b, uint32_t index)
+{
+	spa_zero(b->v4l2_buffer);
+	spa_zero(b->planes);
+	b->v4l2_buffer.type = buf_type(port);
+	b->v4l2_buffer.memory = port->memtype;
+	b->v4l2_buffer.index = index;
+	if (b->v4l2_buffer.type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+		b->v4l2_buffer.m.planes = b->planes;
+		b->v4l2_buffer.length = SPA_N_ELEMENTS(b->planes);
+	}
+}
+
+static inline bool buffer_is_mplane(const struct v4l2_buffer *buf)
+{
+	return buf->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+}
+
+static inline uint32_t buffer_length(const struct v4l2_buffer *buf)
+{
+	return buffer_is_mplane(buf) ? buf->m.planes[0].length : buf->length;
+}
+
+static inline uint32_t buffer_mem_offset(const struct v4l2_buffer *buf)
+{
+	return buffer_is_mplane(buf) ? buf->m.planes[0].m.mem_offset : buf->m.offset;
+}
+
+static inline int buffer_fd(const struct v4l2_buffer *buf)
+{
+	return buffer_is_mplane(buf) ? buf->m.planes[0].m.fd : buf->m.fd;
+}
+
+static void buffer_set_userptr(struct v4l2_buffer *buf, void *ptr, uint32_t size)
+{
+	if (buffer_is_mplane(buf)) {
+		buf->m.planes[0].m.userptr = (unsigned long) ptr;
+		buf->m.planes[0].length = size;
+	} else {
+		buf->m.userptr = (unsigned long) ptr;
+		buf->length = size;
+	}
+}
+
+static void buffer_set_fd(struct v4l2_buffer *buf, int fd)
+{
+	if (buffer_is_mplane(buf))
+		buf->m.planes[0].m.fd = fd;
+	else
+		buf->m.fd = fd;
+}
+
+/* fill the format for the buffer type of the port */
+static void format_init(struct port *port, struct v4l2_format *fmt, uint32_t fourcc,
+		uint32_t width, uint32_t height)
+{
+	spa_zero(*fmt);
+	fmt->type = buf_type(port);
+	if (fmt->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+		fmt->fmt.pix_mp.pixelformat = fourcc;
+		fmt->fmt.pix_mp.field = V4L2_FIELD_ANY;
+		fmt->fmt.pix_mp.width = width;
+		fmt->fmt.pix_mp.height = height;
+		fmt->fmt.pix_mp.num_planes = 1;
+	} else {
+		fmt->fmt.pix.pixelformat = fourcc;
+		fmt->fmt.pix.field = V4L2_FIELD_ANY;
+		fmt->fmt.pix.width = width;
+		fmt->fmt.pix.height = height;
+	}
+}
+
+/* convert a multi-planar format with one plane to the single-planar layout
+ * that the rest of the code uses */
+static int format_to_single_plane(struct v4l2_format *fmt)
+{
+	struct v4l2_pix_format_mplane mp;
+	struct v4l2_pix_format *pix = &fmt->fmt.pix;
+
+	if (fmt->type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+		return 0;
+
+	mp = fmt->fmt.pix_mp;
+	if (mp.num_planes != 1)
+		return -ENOTSUP;
+
+	spa_zero(*pix);
+	pix->width = mp.width;
+	pix->height = mp.height;
+	pix->pixelformat = mp.pixelformat;
+	pix->field = mp.field;
+	pix->bytesperline = mp.plane_fmt[0].bytesperline;
+	pix->sizeimage = mp.plane_fmt[0].sizeimage;
+	pix->colorspace = mp.colorspace;
+	pix->flags = mp.flags;
+	pix->ycbcr_enc = mp.ycbcr_enc;
+	pix->quantization = mp.quantization;
+	pix->xfer_func = mp.xfer_func;
+	fmt->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	return 0;
+}
+
+static int buffer_queue(struct impl *this, struct buffer *b)
+{
+	struct port *port = &this->out_ports[0];
+	int err;
+
+	if (xioctl(port->dev.fd, VIDIOC_QBUF, &b->v4l2_buffer) < 0) {
+		err = errno;
+		spa_log_error(this->log, "'%s' VIDIOC_QBUF: %m", this->props.device);
+		return -err;
+	}
+	return 0;
+}
+
+static void buffer_clear_fence(struct impl *this, struct buffer *b)
+{
+	if (!SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_FENCED))
+		return;
+	if (b->fence.loop)
+		spa_loop_remove_source(this->data_loop, &b->fence);
+	close(b->fence.fd);
+	b->fence.fd = -1;
+	SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_FENCED);
+}
+
+static void on_buffer_fence(struct spa_source *source)
+{
+	struct impl *this = source->data;
+	struct buffer *b = SPA_CONTAINER_OF(source, struct buffer, fence);
+
+	spa_log_trace(this->log, "v4l2 %p: fence of buffer %d signaled", this, b->id);
+	buffer_clear_fence(this, b);
+	buffer_queue(this, b);
+}
+
+/* An imported DMABUF can still be read by the consumer when the buffer is
+ * recycled, the GPU work is only submitted. Get the fences of the readers
+ * as a sync_file and queue the buffer when they are signaled, else the
+ * device would overwrite the frame that is being read. Must be called from
+ * the data thread. Returns 1 when the buffer will be queued later. */
+static int buffer_wait_fence(struct impl *this, struct buffer *b)
+{
+#ifdef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+	struct port *port = &this->out_ports[0];
+	struct dma_buf_export_sync_file sync;
+	struct pollfd pfd;
+
+	if (port->no_sync_file)
+		return 0;
+
+	spa_zero(sync);
+	sync.flags = DMA_BUF_SYNC_WRITE;
+	sync.fd = -1;
+	if (xioctl(buffer_fd(&b->v4l2_buffer), DMA_BUF_IOCTL_EXPORT_SYNC_FILE, &sync) < 0) {
+		if (errno == ENOTTY || errno == EINVAL) {
+			spa_log_info(this->log, "'%s' no sync_file support: %m",
+					this->props.device);
+			port->no_sync_file = true;
+		}
+		return 0;
+	}
+
+	pfd.fd = sync.fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) != 0) {
+		/* signaled or error, queue now */
+		close(sync.fd);
+		return 0;
+	}
+	b->fence.func = on_buffer_fence;
+	b->fence.data = this;
+	b->fence.fd = sync.fd;
+	b->fence.mask = SPA_IO_IN;
+	b->fence.rmask = 0;
+	SPA_FLAG_SET(b->flags, BUFFER_FLAG_FENCED);
+	spa_loop_add_source(this->data_loop, &b->fence);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 static int spa_v4l2_buffer_recycle(struct impl *this, uint32_t buffer_id)
 {
 	struct port *port = &this->out_ports[0];
 	struct buffer *b = &port->buffers[buffer_id];
-	struct spa_v4l2_device *dev = &port->dev;
-	int err;
 
 	if (!SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUTSTANDING))
 		return 0;
@@ -113,13 +318,12 @@ static int spa_v4l2_buffer_recycle(struct impl *this, uint32_t buffer_id)
 	SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUTSTANDING);
 	spa_log_trace(this->log, "v4l2 %p: recycle buffer %d", this, buffer_id);
 
-	if (xioctl(dev->fd, VIDIOC_QBUF, &b->v4l2_buffer) < 0) {
-		err = errno;
-		spa_log_error(this->log, "'%s' VIDIOC_QBUF: %m", this->props.device);
-		return -err;
-	}
+	/* only when streaming, then we are called from the data thread */
+	if (port->dev.active && port->memtype == V4L2_MEMORY_DMABUF &&
+	    buffer_wait_fence(this, b) > 0)
+		return 0;
 
-	return 0;
+	return buffer_queue(this, b);
 }
 
 static int spa_v4l2_clear_buffers(struct impl *this)
@@ -153,7 +357,7 @@ static int spa_v4l2_clear_buffers(struct impl *this)
 	}
 
 	spa_zero(reqbuf);
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.type = buf_type(port);
 	reqbuf.memory = port->memtype;
 	reqbuf.count = 0;
 
@@ -493,37 +697,74 @@ filter_framerate(struct v4l2_frmivalenum *frmival,
 
 #define FOURCC_ARGS(f) (f)&0x7f,((f)>>8)&0x7f,((f)>>16)&0x7f,((f)>>24)&0x7f
 
-static int
-spa_v4l2_enum_format(struct impl *this, int seq,
-		     uint32_t start, uint32_t num,
-		     const struct spa_pod *filter)
+/* the result of VIDIOC_TRY_FMT for a fourcc does not change while the device
+ * is open, remember it so that each negotiation does not probe again */
+static int try_format(struct impl *this, uint32_t fourcc)
 {
 	struct port *port = &this->out_ports[0];
+	struct v4l2_format fmt;
+	uint32_t i;
+	bool supported;
+
+	for (i = 0; i < port->n_format_cache; i++) {
+		if (port->format_cache[i].fourcc == fourcc)
+			return port->format_cache[i].supported ? 0 : -ENOTSUP;
+	}
+
+	format_init(port, &fmt, fourcc, 0, 0);
+
+	if (xioctl(port->dev.fd, VIDIOC_TRY_FMT, &fmt) < 0 ||
+	    format_to_single_plane(&fmt) < 0) {
+		spa_log_debug(this->log, "'%s' VIDIOC_TRY_FMT %08x: %m",
+				this->props.device, fourcc);
+		supported = false;
+	} else if (fmt.fmt.pix.pixelformat != fourcc) {
+		spa_log_debug(this->log, "'%s' VIDIOC_TRY_FMT wanted %.4s gave %.4s",
+				this->props.device, (char*)&fourcc,
+				(char*)&fmt.fmt.pix.pixelformat);
+		supported = false;
+	} else {
+		supported = true;
+	}
+	if (port->n_format_cache < MAX_FORMAT_CACHE) {
+		port->format_cache[port->n_format_cache++] = (struct format_cache) {
+			.fourcc = fourcc,
+			.supported = supported,
+		};
+	}
+	return supported ? 0 : -ENOTSUP;
+}
+
+static int
+enum_format_device(struct impl *this, struct spa_v4l2_device *dev,
+		struct format_enum_state *st, int seq,
+		uint32_t start, uint32_t num, const struct spa_pod *filter,
+		void (*emit)(void *data, int seq, const struct spa_result_node_params *result),
+		void *data)
+{
 	int res, n_fractions;
 	const struct format_info *info;
 	struct spa_pod_choice *choice;
 	uint32_t filter_media_type, filter_media_subtype;
-	struct spa_v4l2_device *dev = &port->dev;
 	uint8_t buffer[1024];
 	struct spa_pod_builder b = { 0 };
 	struct spa_pod_frame f[2];
 	struct spa_result_node_params result;
 	uint32_t count = 0;
 
-	if ((res = spa_v4l2_open(dev, this->props.device)) < 0)
-		return res;
-
 	result.id = SPA_PARAM_EnumFormat;
 	result.next = start;
 
 	if (result.next == 0) {
-		spa_zero(port->fmtdesc);
-		port->fmtdesc.index = 0;
-		port->fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		port->next_fmtdesc = true;
-		spa_zero(port->frmsize);
-		port->next_frmsize = true;
-		spa_zero(port->frmival);
+		spa_zero(st->fmtdesc);
+		st->fmtdesc.index = 0;
+		st->fmtdesc.type = spa_v4l2_is_mplane(dev) ?
+			V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE :
+			V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		st->next_fmtdesc = true;
+		spa_zero(st->frmsize);
+		st->next_frmsize = true;
+		spa_zero(st->frmival);
 	}
 
 	if (filter) {
@@ -533,20 +774,18 @@ spa_v4l2_enum_format(struct impl *this, int seq,
 
 	if (false) {
 	      next_fmtdesc:
-		port->fmtdesc.index++;
-		port->next_fmtdesc = true;
+		st->fmtdesc.index++;
+		st->next_fmtdesc = true;
 	}
 
       next:
 	result.index = result.next++;
 
-	while (port->next_fmtdesc) {
+	while (st->next_fmtdesc) {
 		if (filter) {
-			struct v4l2_format fmt;
-
 			res = enum_filter_format(filter_media_type,
 					    filter_media_subtype,
-					    filter, port->fmtdesc.index);
+					    filter, st->fmtdesc.index);
 			if (res == -ENOENT)
 				goto do_enum_fmt;
 			if (res < 0)
@@ -560,30 +799,14 @@ spa_v4l2_enum_format(struct impl *this, int seq,
 			if (info == NULL)
 				goto next_fmtdesc;
 
-			port->fmtdesc.pixelformat = info->fourcc;
-
-			spa_zero(fmt);
-			fmt.type = port->fmtdesc.type;
-			fmt.fmt.pix.pixelformat = info->fourcc;
-			fmt.fmt.pix.field = V4L2_FIELD_ANY;
-			fmt.fmt.pix.width = 0;
-			fmt.fmt.pix.height = 0;
+			st->fmtdesc.pixelformat = info->fourcc;
 
-			if ((res = xioctl(dev->fd, VIDIOC_TRY_FMT, &fmt)) < 0) {
-				spa_log_debug(this->log, "'%s' VIDIOC_TRY_FMT %08x: %m",
-						this->props.device, info->fourcc);
-				goto next_fmtdesc;
-			}
-			if (fmt.fmt.pix.pixelformat != info->fourcc) {
-				spa_log_debug(this->log, "'%s' VIDIOC_TRY_FMT wanted %.4s gave %.4s",
-						this->props.device, (char*)&info->fourcc,
-						(char*)&fmt.fmt.pix.pixelformat);
+			if (try_format(this, info->fourcc) < 0)
 				goto next_fmtdesc;
-			}
 
 		} else {
 do_enum_fmt:
-			if ((res = xioctl(dev->fd, VIDIOC_ENUM_FMT, &port->fmtdesc)) < 0) {
+			if ((res = xioctl(dev->fd, VIDIOC_ENUM_FMT, &st->fmtdesc)) < 0) {
 				if (errno == EINVAL)
 					goto enum_end;
 
@@ -593,16 +816,16 @@ do_enum_fmt:
 				goto exit;
 			}
 		}
-		port->next_fmtdesc = false;
-		port->frmsize.index = 0;
-		port->frmsize.pixel_format = port->fmtdesc.pixelformat;
-		port->next_frmsize = true;
+		st->next_fmtdesc = false;
+		st->frmsize.index = 0;
+		st->frmsize.pixel_format = st->fmtdesc.pixelformat;
+		st->next_frmsize = true;
 	}
-	if (!(info = fourcc_to_format_info(port->fmtdesc.pixelformat)))
+	if (!(info = fourcc_to_format_info(st->fmtdesc.pixelformat)))
 		goto next_fmtdesc;
 
       next_frmsize:
-	while (port->next_frmsize) {
+	while (st->next_frmsize) {
 		if (filter) {
 			const struct spa_pod_prop *p;
 			struct spa_pod *val;
@@ -619,17 +842,17 @@ do_enum_fmt:
 			if (choice == SPA_CHOICE_None) {
 				const struct spa_rectangle *values = SPA_POD_BODY(val);
 
-				if (port->frmsize.index > 0)
+				if (st->frmsize.index > 0)
 					goto next_fmtdesc;
 
-				port->frmsize.type = V4L2_FRMSIZE_TYPE_DISCRETE;
-				port->frmsize.discrete.width = values[0].width;
-				port->frmsize.discrete.height = values[0].height;
+				st->frmsize.type = V4L2_FRMSIZE_TYPE_DISCRETE;
+				st->frmsize.discrete.width = values[0].width;
+				st->frmsize.discrete.height = values[0].height;
 				goto have_size;
 			}
 		}
 	      do_frmsize:
-		if ((res = xioctl(dev->fd, VIDIOC_ENUM_FRAMESIZES, &port->frmsize)) < 0) {
+		if ((res = xioctl(dev->fd, VIDIOC_ENUM_FRAMESIZES, &st->frmsize)) < 0) {
 			if (errno == EINVAL || errno == ENOTTY)
 				goto next_fmtdesc;
 
@@ -657,41 +880,41 @@ do_enum_fmt:
 			values = SPA_POD_BODY_CONST(val);
 
 			if (choice == SPA_CHOICE_Range && n_values > 2) {
-				if (filter_framesize(&port->frmsize, &values[1], &values[2], &step))
+				if (filter_framesize(&st->frmsize, &values[1], &values[2], &step))
 					goto have_size;
 			} else if (choice == SPA_CHOICE_Step && n_values > 3) {
-				if (filter_framesize(&port->frmsize, &values[1], &values[2], &values[3]))
+				if (filter_framesize(&st->frmsize, &values[1], &values[2], &values[3]))
 					goto have_size;
 			} else if (choice == SPA_CHOICE_Enum) {
 				for (i = 1; i < n_values; i++) {
-					if (filter_framesize(&port->frmsize, &values[i], &values[i], &step))
+					if (filter_framesize(&st->frmsize, &values[i], &values[i], &step))
 						goto have_size;
 				}
 			}
 			/* nothing matches the filter, get next frame size */
-			port->frmsize.index++;
+			st->frmsize.index++;
 			continue;
 		}
 
 	      have_size:
-		if (port->frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+		if (st->frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
 			/* we have a fixed size, use this to get the frame intervals */
-			port->frmival.index = 0;
-			port->frmival.pixel_format = port->frmsize.pixel_format;
-			port->frmival.width = port->frmsize.discrete.width;
-			port->frmival.height = port->frmsize.discrete.height;
-			port->next_frmsize = false;
-		} else if (port->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS ||
-			   port->frmsize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
+			st->frmival.index = 0;
+			st->frmival.pixel_format = st->frmsize.pixel_format;
+			st->frmival.width = st->frmsize.discrete.width;
+			st->frmival.height = st->frmsize.discrete.height;
+			st->next_frmsize = false;
+		} else if (st->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS ||
+			   st->frmsize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
 			/* we have a non fixed size, fix to something sensible to get the
 			 * framerate */
-			port->frmival.index = 0;
-			port->frmival.pixel_format = port->frmsize.pixel_format;
-			port->frmival.width = port->frmsize.stepwise.min_width;
-			port->frmival.height = port->frmsize.stepwise.min_height;
-			port->next_frmsize = false;
+			st->frmival.index = 0;
+			st->frmival.pixel_format = st->frmsize.pixel_format;
+			st->frmival.width = st->frmsize.stepwise.min_width;
+			st->frmival.height = st->frmsize.stepwise.min_height;
+			st->next_frmsize = false;
 		} else {
-			port->frmsize.index++;
+			st->frmsize.index++;
 		}
 	}
 
@@ -707,32 +930,32 @@ do_enum_fmt:
 		spa_pod_builder_id(&b, info->format);
 	}
 	spa_pod_builder_prop(&b, SPA_FORMAT_VIDEO_size, 0);
-	if (port->frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+	if (st->frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
 		spa_pod_builder_rectangle(&b,
-				port->frmsize.discrete.width,
-				port->frmsize.discrete.height);
-	} else if (port->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS ||
-		   port->frmsize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
+				st->frmsize.discrete.width,
+				st->frmsize.discrete.height);
+	} else if (st->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS ||
+		   st->frmsize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
 		spa_pod_builder_push_choice(&b, &f[1], SPA_CHOICE_None, 0);
 		choice = (struct spa_pod_choice*)spa_pod_builder_frame(&b, &f[1]);
 
 		spa_pod_builder_rectangle(&b,
-				port->frmsize.stepwise.min_width,
-				port->frmsize.stepwise.min_height);
+				st->frmsize.stepwise.min_width,
+				st->frmsize.stepwise.min_height);
 		spa_pod_builder_rectangle(&b,
-				port->frmsize.stepwise.min_width,
-				port->frmsize.stepwise.min_height);
+				st->frmsize.stepwise.min_width,
+				st->frmsize.stepwise.min_height);
 		spa_pod_builder_rectangle(&b,
-				port->frmsize.stepwise.max_width,
-				port->frmsize.stepwise.max_height);
+				st->frmsize.stepwise.max_width,
+				st->frmsize.stepwise.max_height);
 
-		if (port->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS) {
+		if (st->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS) {
 			choice->body.type = SPA_CHOICE_Range;
 		} else {
 			choice->body.type = SPA_CHOICE_Step;
 			spa_pod_builder_rectangle(&b,
-					port->frmsize.stepwise.max_width,
-					port->frmsize.stepwise.max_height);
+					st->frmsize.stepwise.max_width,
+					st->frmsize.stepwise.max_height);
 		}
 		spa_pod_builder_pop(&b, &f[1]);
 	}
@@ -743,15 +966,15 @@ do_enum_fmt:
 
 	spa_pod_builder_push_choice(&b, &f[1], SPA_CHOICE_None, 0);
 	choice = (struct spa_pod_choice*)spa_pod_builder_frame(&b, &f[1]);
-	port->frmival.index = 0;
+	st->frmival.index = 0;
 
 	while (true) {
-		if ((res = xioctl(dev->fd, VIDIOC_ENUM_FRAMEINTERVALS, &port->frmival)) < 0) {
+		if ((res = xioctl(dev->fd, VIDIOC_ENUM_FRAMEINTERVALS, &st->frmival)) < 0) {
 			res = -errno;
 			if (errno == EINVAL || errno == ENOTTY) {
-				port->frmsize.index++;
-				port->next_frmsize = true;
-				if (port->frmival.index == 0)
+				st->frmsize.index++;
+				st->next_frmsize = true;
+				if (st->frmival.index == 0)
 					goto next_frmsize;
 				break;
 			}
@@ -778,70 +1001,70 @@ do_enum_fmt:
 
 			switch (choice) {
 			case SPA_CHOICE_None:
-				if (filter_framerate(&port->frmival, &values[0], &values[0], &step))
+				if (filter_framerate(&st->frmival, &values[0], &values[0], &step))
 					goto have_framerate;
 				break;
 
 			case SPA_CHOICE_Range:
-				if (n_values > 2 && filter_framerate(&port->frmival, &values[1], &values[2], &step))
+				if (n_values > 2 && filter_framerate(&st->frmival, &values[1], &values[2], &step))
 					goto have_framerate;
 				break;
 
 			case SPA_CHOICE_Step:
-				if (n_values > 3 && filter_framerate(&port->frmival, &values[1], &values[2], &values[3]))
+				if (n_values > 3 && filter_framerate(&st->frmival, &values[1], &values[2], &values[3]))
 					goto have_framerate;
 				break;
 
 			case SPA_CHOICE_Enum:
 				for (i = 1; i < n_values; i++) {
-					if (filter_framerate(&port->frmival, &values[i], &values[i], &step))
+					if (filter_framerate(&st->frmival, &values[i], &values[i], &step))
 						goto have_framerate;
 				}
 				break;
 			default:
 				break;
 			}
-			port->frmival.index++;
+			st->frmival.index++;
 			continue;
 		}
 
 	      have_framerate:
 
-		if (port->frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+		if (st->frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
 			choice->body.type = SPA_CHOICE_Enum;
 			if (n_fractions == 0)
 				spa_pod_builder_fraction(&b,
-							 port->frmival.discrete.denominator,
-							 port->frmival.discrete.numerator);
+							 st->frmival.discrete.denominator,
+							 st->frmival.discrete.numerator);
 			spa_pod_builder_fraction(&b,
-						 port->frmival.discrete.denominator,
-						 port->frmival.discrete.numerator);
-			port->frmival.index++;
+						 st->frmival.discrete.denominator,
+						 st->frmival.discrete.numerator);
+			st->frmival.index++;
 			n_fractions++;
-		} else if (port->frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS ||
-			   port->frmival.type == V4L2_FRMIVAL_TYPE_STEPWISE) {
+		} else if (st->frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS ||
+			   st->frmival.type == V4L2_FRMIVAL_TYPE_STEPWISE) {
 			if (n_fractions == 0)
 				spa_pod_builder_fraction(&b, 25, 1);
 			spa_pod_builder_fraction(&b,
-						 port->frmival.stepwise.min.denominator,
-						 port->frmival.stepwise.min.numerator);
+						 st->frmival.stepwise.min.denominator,
+						 st->frmival.stepwise.min.numerator);
 			spa_pod_builder_fraction(&b,
-						 port->frmival.stepwise.max.denominator,
-						 port->frmival.stepwise.max.numerator);
+						 st->frmival.stepwise.max.denominator,
+						 st->frmival.stepwise.max.numerator);
 
-			if (port->frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS) {
+			if (st->frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS) {
 				choice->body.type = SPA_CHOICE_Range;
 				n_fractions += 2;
 			} else {
 				choice->body.type = SPA_CHOICE_Step;
 				spa_pod_builder_fraction(&b,
-							 port->frmival.stepwise.step.denominator,
-							 port->frmival.stepwise.step.numerator);
+							 st->frmival.stepwise.step.denominator,
+							 st->frmival.stepwise.step.numerator);
 				n_fractions += 3;
 			}
 
-			port->frmsize.index++;
-			port->next_frmsize = true;
+			st->frmsize.index++;
+			st->next_frmsize = true;
 			break;
 		}
 	}
@@ -853,7 +1076,7 @@ do_enum_fmt:
 	spa_pod_builder_pop(&b, &f[1]);
 	result.param = spa_pod_builder_pop(&b, &f[0]);
 
-	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+	emit(data, seq, &result);
 
 	if (++count != num)
 		goto next;
@@ -861,7 +1084,168 @@ do_enum_fmt:
       enum_end:
 	res = 0;
       exit:
-	spa_v4l2_close(dev);
+	return res;
+}
+
+static void emit_format(void *data, int seq, const struct spa_result_node_params *result)
+{
+	struct impl *this = data;
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, result);
+}
+
+static void cache_format(void *data, int seq, const struct spa_result_node_params *result)
+{
+	struct format_enum *e = data;
+
+	if (spa_pod_builder_raw_padded(&e->b.b, result->param, SPA_POD_SIZE(result->param)) < 0)
+		e->res = -ENOSPC;
+	else
+		e->n_formats++;
+}
+
+/* collect all formats of the device with its own fd, this does not touch
+ * the port and can run outside of the main loop */
+static int format_enum_fill(struct impl *this, struct format_enum *e)
+{
+	struct spa_v4l2_device dev = { .log = this->log, .fd = -1 };
+	struct format_enum_state st;
+	int res;
+
+	if ((res = spa_v4l2_open(&dev, e->device)) < 0)
+		return res;
+	res = enum_format_device(this, &dev, &st, 0, 0, 0, NULL, cache_format, e);
+	spa_v4l2_close(&dev);
+
+	return res < 0 ? res : e->res;
+}
+
+static void *format_enum_thread(void *data)
+{
+	struct impl *this = data;
+	struct format_enum *e = &this->out_ports[0].format_enum;
+	int res;
+
+	res = format_enum_fill(this, e);
+	e->res = res;
+	SPA_ATOMIC_STORE(e->done, 1);
+	return NULL;
+}
+
+static void format_enum_stop(struct impl *this)
+{
+	struct format_enum *e = &this->out_ports[0].format_enum;
+
+	if (e->thread != NULL) {
+		spa_thread_utils_join(this->thread_utils, e->thread, NULL);
+		e->thread = NULL;
+	}
+	spa_pod_dynamic_builder_clean(&e->b);
+	spa_pod_dynamic_builder_init(&e->b, NULL, 0, 4096);
+	e->n_formats = 0;
+	e->res = 0;
+	e->done = 0;
+	e->started = false;
+	e->from_cache = false;
+}
+
+/* Enumerating the formats of a camera takes many ioctls. Start collecting
+ * them in a worker thread when the device is known so that the main loop
+ * only needs to filter the cached formats later. */
+static void format_enum_start(struct impl *this)
+{
+	struct format_enum *e = &this->out_ports[0].format_enum;
+
+	format_enum_stop(this);
+
+	if (this->thread_utils == NULL || this->props.device[0] == '\0')
+		return;
+
+	memcpy(e->device, this->props.device, sizeof(e->device));
+	e->started = true;
+	e->thread = spa_thread_utils_create(this->thread_utils, NULL, format_enum_thread, this);
+	if (e->thread == NULL) {
+		spa_log_warn(this->log, "'%s' can't create format thread: %m", e->device);
+		e->started = false;
+	}
+}
+
+static bool format_enum_ready(struct impl *this)
+{
+	struct format_enum *e = &this->out_ports[0].format_enum;
+
+	if (!e->started) {
+		/* no worker, collect the formats now and cache them */
+		memcpy(e->device, this->props.device, sizeof(e->device));
+		e->started = true;
+		e->res = format_enum_fill(this, e);
+		e->done = 1;
+	}
+	if (!SPA_ATOMIC_LOAD(e->done))
+		return false;
+	if (e->thread != NULL) {
+		spa_thread_utils_join(this->thread_utils, e->thread, NULL);
+		e->thread = NULL;
+	}
+	if (e->res < 0)
+		spa_log_debug(this->log, "'%s' no cached formats: %s",
+				e->device, spa_strerror(e->res));
+	return e->res >= 0;
+}
+
+static int enum_format_cache(struct impl *this, int seq,
+		     uint32_t start, uint32_t num,
+		     const struct spa_pod *filter)
+{
+	struct format_enum *e = &this->out_ports[0].format_enum;
+	struct spa_pod *pod = e->b.b.data;
+	struct spa_result_node_params result;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = { 0 };
+	uint32_t i, count = 0;
+
+	result.id = SPA_PARAM_EnumFormat;
+
+	for (i = 0; i < e->n_formats; i++, pod = spa_pod_next(pod)) {
+		if (i < start)
+			continue;
+
+		result.index = i;
+		result.next = i + 1;
+
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		if (spa_pod_filter(&b, &result.param, pod, filter) < 0)
+			continue;
+
+		spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+		if (++count == num)
+			break;
+	}
+	return 0;
+}
+
+static int
+spa_v4l2_enum_format(struct impl *this, int seq,
+		     uint32_t start, uint32_t num,
+		     const struct spa_pod *filter)
+{
+	struct port *port = &this->out_ports[0];
+	struct format_enum *e = &port->format_enum;
+	int res;
+
+	/* an enumeration continues from where it started */
+	if (start == 0)
+		e->from_cache = format_enum_ready(this);
+	if (e->from_cache)
+		return enum_format_cache(this, seq, start, num, filter);
+
+	if ((res = spa_v4l2_open(&port->dev, this->props.device)) < 0)
+		return res;
+
+	res = enum_format_device(this, &port->dev, &port->enum_state, seq,
+			start, num, filter, emit_format, this);
+
+	spa_v4l2_close(&port->dev);
 	return res;
 }
 
@@ -877,7 +1261,7 @@ static int probe_expbuf(struct impl *this)
 	port->probed_expbuf = true;
 
 	spa_zero(reqbuf);
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.type = buf_type(port);
 	reqbuf.memory = V4L2_MEMORY_MMAP;
 	reqbuf.count = 2;
 
@@ -887,7 +1271,7 @@ static int probe_expbuf(struct impl *this)
 	}
 
 	spa_zero(expbuf);
-	expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	expbuf.type = buf_type(port);
 	expbuf.index = 0;
 	expbuf.flags = O_CLOEXEC | O_RDONLY;
 	if (xioctl(dev->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
@@ -920,11 +1304,7 @@ static int spa_v4l2_set_format(struct impl *this, struct spa_video_info *format,
 	struct spa_fraction *framerate = NULL;
 	bool match;
 
-	spa_zero(fmt);
-	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-
 	spa_zero(streamparm);
-	streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
 	switch (format->media_subtype) {
 	case SPA_MEDIA_SUBTYPE_raw:
@@ -957,23 +1337,23 @@ static int spa_v4l2_set_format(struct impl *this, struct spa_video_info *format,
 		return -EINVAL;
 	}
 
-	fmt.fmt.pix.pixelformat = info->fourcc;
-	fmt.fmt.pix.field = V4L2_FIELD_ANY;
-	fmt.fmt.pix.width = size->width;
-	fmt.fmt.pix.height = size->height;
 	streamparm.parm.capture.timeperframe.numerator = framerate->denom;
 	streamparm.parm.capture.timeperframe.denominator = framerate->num;
 
-	spa_log_debug(this->log, "set %.4s %dx%d %d/%d", (char *)&fmt.fmt.pix.pixelformat,
-		     fmt.fmt.pix.width, fmt.fmt.pix.height,
+	spa_log_debug(this->log, "set %.4s %dx%d %d/%d", (char *)&info->fourcc,
+		     size->width, size->height,
 		     streamparm.parm.capture.timeperframe.denominator,
 		     streamparm.parm.capture.timeperframe.numerator);
 
-	reqfmt = fmt;
-
 	if ((res = spa_v4l2_open(dev, this->props.device)) < 0)
 		return res;
 
+	/* the buffer type depends on the device so it needs to be open */
+	streamparm.type = buf_type(port);
+	format_init(port, &fmt, info->fourcc, size->width, size->height);
+	reqfmt = fmt;
+	format_to_single_plane(&reqfmt);
+
 	cmd = (flags & SPA_NODE_PARAM_FLAG_TEST_ONLY) ? VIDIOC_TRY_FMT : VIDIOC_S_FMT;
 	if (xioctl(dev->fd, cmd, &fmt) < 0) {
 		res = -errno;
@@ -981,6 +1361,12 @@ static int spa_v4l2_set_format(struct impl *this, struct spa_video_info *format,
 				this->props.device);
 		return res;
 	}
+	if ((res = format_to_single_plane(&fmt)) < 0) {
+		spa_log_error(this->log, "'%s' %.4s uses %d memory planes, only 1 is supported",
+				this->props.device, (char *)&info->fourcc,
+				fmt.fmt.pix_mp.num_planes);
+		return res;
+	}
 
 	/* some cheap USB cam's won't accept any change */
 	if (xioctl(dev->fd, VIDIOC_S_PARM, &streamparm) < 0)
@@ -1358,13 +1744,20 @@ static int mmap_read(struct impl *this)
 	struct port *port = &this->out_ports[0];
 	struct spa_v4l2_device *dev = &port->dev;
 	struct v4l2_buffer buf;
+	struct v4l2_plane planes[1];
 	struct buffer *b;
 	struct spa_data *d;
+	uint32_t offset, size;
 	int64_t pts;
 
 	spa_zero(buf);
-	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	spa_zero(planes);
+	buf.type = buf_type(port);
 	buf.memory = port->memtype;
+	if (buffer_is_mplane(&buf)) {
+		buf.m.planes = planes;
+		buf.length = SPA_N_ELEMENTS(planes);
+	}
 
 	if (xioctl(dev->fd, VIDIOC_DQBUF, &buf) < 0)
 		return -errno;
@@ -1374,7 +1767,19 @@ static int mmap_read(struct impl *this)
 	if (buf.sequence == 0)
 		return 0;
 
-	pts = SPA_TIMEVAL_TO_NSEC(&buf.timestamp);
+	if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+		pts = SPA_TIMEVAL_TO_NSEC(&buf.timestamp);
+		/* make the timestamp point to the start of the frame, like
+		 * the devices that take it at the start of exposure */
+		if ((buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK) == V4L2_BUF_FLAG_TSTAMP_SRC_EOF &&
+		    port->info.rate.denom > 0)
+			pts -= port->info.rate.num * SPA_NSEC_PER_SEC / port->info.rate.denom;
+	} else {
+		/* not in our clock, use the time we got the frame */
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		pts = SPA_TIMESPEC_TO_NSEC(&now);
+	}
 	spa_log_trace(this->log, "v4l2 %p: have output %d", this, buf.index);
 
 	if (this->clock) {
@@ -1406,9 +1811,17 @@ static int mmap_read(struct impl *this)
 		b->vt->transform = this->transform;
 	}
 
+	if (buffer_is_mplane(&buf)) {
+		offset = SPA_MIN(planes[0].data_offset, planes[0].bytesused);
+		size = planes[0].bytesused - offset;
+	} else {
+		offset = 0;
+		size = buf.bytesused;
+	}
+
 	d = b->outbuf->datas;
-	d[0].chunk->offset = 0;
-	d[0].chunk->size = buf.bytesused;
+	d[0].chunk->offset = offset;
+	d[0].chunk->size = size;
 	d[0].chunk->stride = port->fmt.fmt.pix.bytesperline;
 	d[0].chunk->flags = 0;
 	if (buf.flags & V4L2_BUF_FLAG_ERROR)
@@ -1424,6 +1837,7 @@ static void v4l2_on_fd_events(struct spa_source *source)
 	struct spa_io_buffers *io;
 	struct port *port = &this->out_ports[0];
 	struct buffer *b;
+	uint32_t n_read;
 
 	if (source->rmask & SPA_IO_ERR) {
 		struct port *port = &this->out_ports[0];
@@ -1438,12 +1852,25 @@ static void v4l2_on_fd_events(struct spa_source *source)
 		return;
 	}
 
-	if (mmap_read(this) < 0)
+	/* take all the frames that are ready, at high frame rates more than
+	 * one can be ready when we wake up */
+	for (n_read = 0; mmap_read(this) == 0; n_read++);
+	if (n_read == 0)
 		return;
 
 	if (spa_list_is_empty(&port->queue))
 		return;
 
+	/* only the newest frame is kept, the older ones are stale */
+	while (spa_list_first(&port->queue, struct buffer, link) !=
+	       spa_list_last(&port->queue, struct buffer, link)) {
+		b = spa_list_first(&port->queue, struct buffer, link);
+		spa_list_remove(&b->link);
+		SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUTSTANDING);
+		spa_log_trace(this->log, "v4l2 %p: drop stale buffer %d", this, b->id);
+		spa_v4l2_buffer_recycle(this, b->id);
+	}
+
 	io = port->io;
 	if (io == NULL) {
 		b = spa_list_first(&port->queue, struct buffer, link);
@@ -1490,7 +1917,7 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 	}
 
 	spa_zero(reqbuf);
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.type = buf_type(port);
 	reqbuf.memory = port->memtype;
 	reqbuf.count = n_buffers;
 
@@ -1524,10 +1951,7 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 		}
 		d = buffers[i]->datas;
 
-		spa_zero(b->v4l2_buffer);
-		b->v4l2_buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		b->v4l2_buffer.memory = port->memtype;
-		b->v4l2_buffer.index = i;
+		buffer_init(port, b, i);
 
 		if (port->memtype == V4L2_MEMORY_USERPTR) {
 			if (d[0].data == NULL) {
@@ -1547,11 +1971,10 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 			else
 				b->ptr = d[0].data;
 
-			b->v4l2_buffer.m.userptr = (unsigned long) b->ptr;
-			b->v4l2_buffer.length = d[0].maxsize;
+			buffer_set_userptr(&b->v4l2_buffer, b->ptr, d[0].maxsize);
 		}
 		else if (port->memtype == V4L2_MEMORY_DMABUF) {
-			b->v4l2_buffer.m.fd = d[0].fd;
+			buffer_set_fd(&b->v4l2_buffer, d[0].fd);
 		}
 		else {
 			spa_log_error(this->log, "%s: invalid port memory %d",
@@ -1579,7 +2002,7 @@ mmap_init(struct impl *this,
 	port->memtype = V4L2_MEMORY_MMAP;
 
 	spa_zero(reqbuf);
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.type = buf_type(port);
 	reqbuf.memory = port->memtype;
 	reqbuf.count = n_buffers;
 
@@ -1613,10 +2036,7 @@ mmap_init(struct impl *this,
 		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
 		b->vt = spa_buffer_find_meta_data(buffers[i], SPA_META_VideoTransform, sizeof(*b->vt));
 
-		spa_zero(b->v4l2_buffer);
-		b->v4l2_buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		b->v4l2_buffer.memory = port->memtype;
-		b->v4l2_buffer.index = i;
+		buffer_init(port, b, i);
 
 		if (xioctl(dev->fd, VIDIOC_QUERYBUF, &b->v4l2_buffer) < 0) {
 			spa_log_error(this->log, "'%s' VIDIOC_QUERYBUF: %m", this->props.device);
@@ -1632,7 +2052,7 @@ mmap_init(struct impl *this,
 
 		d = buffers[i]->datas;
 		d[0].mapoffset = 0;
-		d[0].maxsize = b->v4l2_buffer.length;
+		d[0].maxsize = buffer_length(&b->v4l2_buffer);
 		d[0].chunk->offset = 0;
 		d[0].chunk->size = 0;
 		d[0].chunk->stride = port->fmt.fmt.pix.bytesperline;
@@ -1647,7 +2067,7 @@ again:
 			struct v4l2_exportbuffer expbuf;
 
 			spa_zero(expbuf);
-			expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			expbuf.type = buf_type(port);
 			expbuf.index = i;
 			expbuf.flags = O_CLOEXEC | O_RDONLY;
 			if (xioctl(dev->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
@@ -1674,12 +2094,12 @@ again:
 			d[0].type = SPA_DATA_MemPtr;
 			d[0].flags = SPA_DATA_FLAG_READABLE;
 			d[0].fd = -1;
-			d[0].mapoffset = b->v4l2_buffer.m.offset;
+			d[0].mapoffset = buffer_mem_offset(&b->v4l2_buffer);
 			d[0].data = mmap(NULL,
-					b->v4l2_buffer.length,
+					buffer_length(&b->v4l2_buffer),
 					PROT_READ, MAP_SHARED,
 					dev->fd,
-					b->v4l2_buffer.m.offset);
+					buffer_mem_offset(&b->v4l2_buffer));
 			if (d[0].data == MAP_FAILED) {
 				spa_log_error(this->log, "'%s' mmap: %m", this->props.device);
 				return -errno;
@@ -1759,7 +2179,7 @@ static int spa_v4l2_stream_on(struct impl *this)
 
 	spa_log_debug(this->log, "starting");
 
-	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	type = buf_type(port);
 	if (xioctl(dev->fd, VIDIOC_STREAMON, &type) < 0) {
 		spa_log_error(this->log, "'%s' VIDIOC_STREAMON: %m", this->props.device);
 		return -errno;
@@ -1785,8 +2205,13 @@ static int do_remove_source(struct spa_loop *loop,
 			    void *user_data)
 {
 	struct port *port = user_data;
+	uint32_t i;
+
 	if (port->source.loop)
 		spa_loop_remove_source(loop, &port->source);
+	/* the fenced buffers are queued again after the stream is stopped */
+	for (i = 0; i < port->n_buffers; i++)
+		buffer_clear_fence(port->impl, &port->buffers[i]);
 	return 0;
 }
 
@@ -1807,7 +2232,7 @@ static int spa_v4l2_stream_off(struct impl *this)
 
 	spa_loop_invoke(this->data_loop, do_remove_source, 0, NULL, 0, true, port);
 
-	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	type = buf_type(port);
 	if (xioctl(dev->fd, VIDIOC_STREAMOFF, &type) < 0) {
 		spa_log_error(this->log, "'%s' VIDIOC_STREAMOFF: %m", this->props.device);
 		return -errno;
@@ -29,3 +29,4 @@ struct spa_v4l2_device {
 int spa_v4l2_open(struct spa_v4l2_device *dev, const char *path);
 int spa_v4l2_close(struct spa_v4l2_device *dev);
 int spa_v4l2_is_capture(struct spa_v4l2_device *dev);
+int spa_v4l2_is_mplane(struct spa_v4l2_device *dev);
@@ -0,0 +1,237 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "video-ops.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*convert_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels);
+
+struct stats {
+	uint32_t width;
+	uint32_t height;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_WIDTH	1920
+#define MAX_HEIGHT	1080
+
+#define MAX_COUNT 20
+
+static uint8_t frame_in[MAX_WIDTH * MAX_HEIGHT * 4];
+static uint8_t frame_out[MAX_WIDTH * 3 * MAX_HEIGHT * 3 * 4];
+
+static const struct {
+	uint32_t width;
+	uint32_t height;
+} frame_sizes[] = { { 320, 240 }, { 1280, 720 }, { 1920, 1080 } };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(frame_sizes) * 100
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void run_test1(const char *name, const char *impl, uint32_t src_fmt, uint32_t dst_fmt,
+		convert_func_t func, uint32_t width, uint32_t height)
+{
+	const struct format_info *si = format_info_find(src_fmt);
+	const struct format_info *di = format_info_find(dst_fmt);
+	uint32_t i, y, p, ss[3] = { 0, }, ds[3] = { 0, }, so[3], dof[3];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct convert conv;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = conv.dst_width = width;
+	conv.src_height = conv.dst_height = height;
+	spa_assert_se(convert_init(&conv) == 0);
+
+	format_info_layout(si, width, height, ss, so);
+	format_info_layout(di, width, height, ds, dof);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		for (y = 0; y < height; y++) {
+			const void *s[3];
+			void *d[3];
+
+			for (p = 0; p < si->n_planes; p++)
+				s[p] = &frame_in[so[p] + (y >> si->ysub[p]) * ss[p]];
+			for (p = 0; p < di->n_planes; p++)
+				d[p] = (y & ((1u << di->ysub[p]) - 1)) ? NULL :
+					&frame_out[dof[p] + (y >> di->ysub[p]) * ds[p]];
+			func(&conv, d, s, width);
+		}
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	convert_free(&conv);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.width = width,
+		.height = height,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl, uint32_t src_fmt, uint32_t dst_fmt,
+		convert_func_t func)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(frame_sizes, s)
+		run_test1(name, impl, src_fmt, dst_fmt, func, s->width, s->height);
+}
+
+static void run_scale1(uint32_t fmt, uint32_t src_width, uint32_t src_height,
+		uint32_t dst_width, uint32_t dst_height)
+{
+	const struct format_info *info = format_info_find(fmt);
+	uint32_t i, ss[3] = { 0, }, ds[3] = { 0, }, so[3], dof[3];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct convert conv;
+	const void *s[3];
+	void *d[3];
+
+	spa_zero(conv);
+	conv.src_fmt = conv.dst_fmt = fmt;
+	conv.src_width = src_width;
+	conv.src_height = src_height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	spa_assert_se(convert_init(&conv) == 0);
+
+	format_info_layout(info, src_width, src_height, ss, so);
+	format_info_layout(info, dst_width, dst_height, ds, dof);
+	for (i = 0; i < info->n_planes; i++) {
+		s[i] = &frame_in[so[i]];
+		d[i] = &frame_out[dof[i]];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		convert_process(&conv, d, ds, s, ss);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.width = dst_width,
+		.height = dst_height,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = "scale",
+		.impl = conv.scale_name
+	};
+	convert_free(&conv);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->width - b->width) != 0) return diff;
+	if ((diff = a->height - b->height) != 0) return diff;
+	return b->perf - a->perf;
+}
+
+#define MAKE_TEST(fmt1,fmt2,func,impl) \
+	run_test(#fmt1 "_to_" #fmt2, impl, SPA_VIDEO_FORMAT_ ##fmt1, SPA_VIDEO_FORMAT_ ##fmt2, func)
+
+static void test_yuv_rgb(void)
+{
+	MAKE_TEST(I420, BGRx, conv_i420_to_bgrx_c, "c");
+	MAKE_TEST(NV12, BGRx, conv_nv12_to_bgrx_c, "c");
+	MAKE_TEST(YUY2, BGRx, conv_yuy2_to_bgrx_c, "c");
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		MAKE_TEST(I420, BGRx, conv_i420_to_bgrx_sse2, "sse2");
+		MAKE_TEST(NV12, BGRx, conv_nv12_to_bgrx_sse2, "sse2");
+		MAKE_TEST(YUY2, BGRx, conv_yuy2_to_bgrx_sse2, "sse2");
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		MAKE_TEST(I420, BGRx, conv_i420_to_bgrx_avx2, "avx2");
+		MAKE_TEST(NV12, BGRx, conv_nv12_to_bgrx_avx2, "avx2");
+		MAKE_TEST(YUY2, BGRx, conv_yuy2_to_bgrx_avx2, "avx2");
+	}
+#endif
+}
+
+static void test_rgb_yuv(void)
+{
+	MAKE_TEST(BGRx, I420, conv_bgrx_to_i420_c, "c");
+	MAKE_TEST(BGRx, NV12, conv_bgrx_to_nv12_c, "c");
+	MAKE_TEST(BGRx, YUY2, conv_bgrx_to_yuy2_c, "c");
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		MAKE_TEST(BGRx, I420, conv_bgrx_to_i420_sse2, "sse2");
+		MAKE_TEST(BGRx, NV12, conv_bgrx_to_nv12_sse2, "sse2");
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		MAKE_TEST(BGRx, I420, conv_bgrx_to_i420_avx2, "avx2");
+		MAKE_TEST(BGRx, NV12, conv_bgrx_to_nv12_avx2, "avx2");
+	}
+#endif
+}
+
+static void test_scale(void)
+{
+	run_scale1(SPA_VIDEO_FORMAT_BGRx, 1280, 720, 1920, 1080);
+	run_scale1(SPA_VIDEO_FORMAT_BGRx, 1920, 1080, 640, 360);
+	run_scale1(SPA_VIDEO_FORMAT_NV12, 1280, 720, 1920, 1080);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got CPU flags %d\n", cpu_flags);
+
+	test_yuv_rgb();
+	test_rgb_yuv();
+	test_scale();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12.12s \t%dx%d\tperf:%"PRIu64"\t%s\n",
+				s->name, s->width, s->height, s->perf, s->impl);
+	}
+	return 0;
+}
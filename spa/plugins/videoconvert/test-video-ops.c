@@ -0,0 +1,267 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <spa/debug/mem.h>
+
+#include "test-helper.h"
+#include "video-ops.c"
+
+#define N_PIXELS	131
+#define WIDTH		64
+#define HEIGHT		48
+
+static uint32_t cpu_flags;
+
+static uint8_t line_in[3][N_PIXELS * 4];
+static uint8_t line_out1[3][N_PIXELS * 4];
+static uint8_t line_out2[3][N_PIXELS * 4];
+
+static void compare_mem(int i, const void *m1, const void *m2, size_t size)
+{
+	int res = memcmp(m1, m2, size);
+	if (res != 0) {
+		fprintf(stderr, "%d %zd:\n", i, size);
+		spa_debug_mem(0, m1, size);
+		spa_debug_mem(0, m2, size);
+	}
+	spa_assert_se(res == 0);
+}
+
+static void init_convert(struct convert *conv, uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t matrix)
+{
+	spa_zero(*conv);
+	conv->src_fmt = src_fmt;
+	conv->dst_fmt = dst_fmt;
+	conv->minfo = find_matrix_info(matrix);
+}
+
+static void run_line(convert_func_t func, struct convert *conv, uint8_t out[3][N_PIXELS * 4],
+		uint32_t n_pixels, bool chroma)
+{
+	const void *s[3] = { line_in[0], line_in[1], line_in[2] };
+	void *d[3] = { out[0], chroma ? out[1] : NULL, chroma ? out[2] : NULL };
+
+	memset(out, 0, sizeof(line_out1));
+	func(conv, d, s, n_pixels);
+}
+
+/* run the C and the optimized version on random data for all sizes up to
+ * N_PIXELS and check that they produce exactly the same result */
+static void run_compare(uint32_t src_fmt, uint32_t dst_fmt, convert_func_t func)
+{
+	struct convert conv;
+	const struct conv_info *info;
+	uint32_t i, n, j;
+
+	info = find_conv_info(src_fmt, dst_fmt, 0);
+	spa_assert_se(info != NULL);
+	spa_assert_se(info->process != func);
+
+	for (j = 0; j < SPA_N_ELEMENTS(matrix_table); j++) {
+		init_convert(&conv, src_fmt, dst_fmt, matrix_table[j].matrix);
+
+		for (n = 1; n <= N_PIXELS; n++) {
+			for (i = 0; i < sizeof(line_in); i++)
+				((uint8_t*)line_in)[i] = rand();
+
+			run_line(info->process, &conv, line_out1, n, true);
+			run_line(func, &conv, line_out2, n, true);
+			compare_mem(n, line_out1, line_out2, sizeof(line_out1));
+
+			run_line(info->process, &conv, line_out1, n, false);
+			run_line(func, &conv, line_out2, n, false);
+			compare_mem(n, line_out1, line_out2, sizeof(line_out1));
+		}
+	}
+}
+
+static void test_compare(void)
+{
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_compare(SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx, conv_i420_to_bgrx_sse2);
+		run_compare(SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBx, conv_i420_to_rgbx_sse2);
+		run_compare(SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx, conv_nv12_to_bgrx_sse2);
+		run_compare(SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBx, conv_nv12_to_rgbx_sse2);
+		run_compare(SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, conv_yuy2_to_bgrx_sse2);
+		run_compare(SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBx, conv_yuy2_to_rgbx_sse2);
+		run_compare(SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_I420, conv_bgrx_to_i420_sse2);
+		run_compare(SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_I420, conv_rgbx_to_i420_sse2);
+		run_compare(SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_NV12, conv_bgrx_to_nv12_sse2);
+		run_compare(SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_NV12, conv_rgbx_to_nv12_sse2);
+	}
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_compare(SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx, conv_i420_to_bgrx_avx2);
+		run_compare(SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_RGBx, conv_i420_to_rgbx_avx2);
+		run_compare(SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx, conv_nv12_to_bgrx_avx2);
+		run_compare(SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBx, conv_nv12_to_rgbx_avx2);
+		run_compare(SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, conv_yuy2_to_bgrx_avx2);
+		run_compare(SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_RGBx, conv_yuy2_to_rgbx_avx2);
+		run_compare(SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_I420, conv_bgrx_to_i420_avx2);
+		run_compare(SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_I420, conv_rgbx_to_i420_avx2);
+		run_compare(SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_NV12, conv_bgrx_to_nv12_avx2);
+		run_compare(SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_NV12, conv_rgbx_to_nv12_avx2);
+	}
+#endif
+}
+
+static void test_values(void)
+{
+	struct convert conv;
+	static const uint8_t yuv[][3] = {
+		{ 16, 128, 128 }, { 235, 128, 128 }, { 125, 128, 128 },
+	};
+	static const uint8_t rgb[][3] = {
+		{ 0, 0, 0 }, { 255, 255, 255 }, { 128, 128, 128 },
+	};
+	uint32_t i;
+
+	init_convert(&conv, SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx,
+			SPA_VIDEO_COLOR_MATRIX_UNKNOWN);
+
+	for (i = 0; i < SPA_N_ELEMENTS(yuv); i++) {
+		line_in[0][0] = line_in[0][1] = yuv[i][0];
+		line_in[1][0] = yuv[i][1];
+		line_in[2][0] = yuv[i][2];
+		run_line(conv_i420_to_bgrx_c, &conv, line_out1, 2, true);
+		spa_assert_se(line_out1[0][0] == rgb[i][2]);
+		spa_assert_se(line_out1[0][1] == rgb[i][1]);
+		spa_assert_se(line_out1[0][2] == rgb[i][0]);
+		spa_assert_se(line_out1[0][3] == 0xff);
+		spa_assert_se(memcmp(&line_out1[0][0], &line_out1[0][4], 4) == 0);
+
+		memcpy(&line_in[0][0], line_out1[0], 8);
+		run_line(conv_bgrx_to_i420_c, &conv, line_out2, 2, true);
+		spa_assert_se(abs(line_out2[0][0] - yuv[i][0]) <= 1);
+		spa_assert_se(line_out2[1][0] == yuv[i][1]);
+		spa_assert_se(line_out2[2][0] == yuv[i][2]);
+	}
+}
+
+static void fill_frame(uint8_t *data, uint32_t fmt, uint32_t width, uint32_t height,
+		uint32_t stride[], void *planes[])
+{
+	const struct format_info *info = format_info_find(fmt);
+	uint32_t i, offset[VIDEO_MAX_PLANES], size;
+
+	spa_assert_se(info != NULL);
+	spa_zero(offset);
+	stride[0] = 0;
+	size = format_info_layout(info, width, height, stride, offset);
+	for (i = 0; i < size; i++)
+		data[i] = rand();
+	for (i = 0; i < info->n_planes; i++)
+		planes[i] = data + offset[i];
+}
+
+/* convert RGB to YUV and back and check that the result is close */
+static void run_roundtrip(uint32_t yuv_fmt)
+{
+	struct convert c1, c2;
+	static uint8_t rgb[WIDTH * HEIGHT * 4], yuv[WIDTH * HEIGHT * 4], out[WIDTH * HEIGHT * 4];
+	void *rgb_p[3], *yuv_p[3], *out_p[3];
+	uint32_t rgb_s[3], yuv_s[3], out_s[3], i;
+
+	spa_zero(c1);
+	c1.src_fmt = SPA_VIDEO_FORMAT_BGRx;
+	c1.dst_fmt = yuv_fmt;
+	c1.src_width = c1.dst_width = WIDTH;
+	c1.src_height = c1.dst_height = HEIGHT;
+	c1.cpu_flags = cpu_flags;
+	spa_assert_se(convert_init(&c1) == 0);
+
+	c2 = c1;
+	c2.src_fmt = yuv_fmt;
+	c2.dst_fmt = SPA_VIDEO_FORMAT_BGRx;
+	spa_assert_se(convert_init(&c2) == 0);
+
+	fill_frame(rgb, SPA_VIDEO_FORMAT_BGRx, WIDTH, HEIGHT, rgb_s, rgb_p);
+	/* make the chroma the same for each 2x2 block */
+	for (i = 0; i < WIDTH * HEIGHT; i++) {
+		uint32_t x = i % WIDTH, y = i / WIDTH;
+		memcpy(&rgb[i * 4], &rgb[((y & ~1) * WIDTH + (x & ~1)) * 4], 4);
+	}
+	fill_frame(yuv, yuv_fmt, WIDTH, HEIGHT, yuv_s, yuv_p);
+	fill_frame(out, SPA_VIDEO_FORMAT_BGRx, WIDTH, HEIGHT, out_s, out_p);
+
+	convert_process(&c1, yuv_p, yuv_s, (const void **)rgb_p, rgb_s);
+	convert_process(&c2, out_p, out_s, (const void **)yuv_p, yuv_s);
+
+	for (i = 0; i < WIDTH * HEIGHT * 4; i++) {
+		if (i % 4 == 3)
+			continue;
+		spa_assert_se(abs((int)rgb[i] - (int)out[i]) <= 8);
+	}
+	convert_free(&c1);
+	convert_free(&c2);
+}
+
+static void test_roundtrip(void)
+{
+	run_roundtrip(SPA_VIDEO_FORMAT_I420);
+	run_roundtrip(SPA_VIDEO_FORMAT_NV12);
+	run_roundtrip(SPA_VIDEO_FORMAT_YUY2);
+}
+
+/* scaling a constant frame keeps it constant */
+static void test_scale(void)
+{
+	struct convert conv;
+	static uint8_t in[WIDTH * HEIGHT * 4], out[WIDTH * 3 * HEIGHT * 3 * 4];
+	void *in_p[3], *out_p[3];
+	uint32_t in_s[3], out_s[3], i, x, y;
+	static const uint32_t sizes[][2] = {
+		{ WIDTH * 3, HEIGHT * 3 }, { WIDTH / 3, HEIGHT / 2 }, { 1, 1 }, { 17, 91 },
+	};
+
+	fill_frame(in, SPA_VIDEO_FORMAT_BGRx, WIDTH, HEIGHT, in_s, in_p);
+	for (i = 0; i < WIDTH * HEIGHT; i++)
+		memcpy(&in[i * 4], "\x10\x80\xf0\xff", 4);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		spa_zero(conv);
+		conv.src_fmt = conv.dst_fmt = SPA_VIDEO_FORMAT_BGRx;
+		conv.src_width = WIDTH;
+		conv.src_height = HEIGHT;
+		conv.dst_width = sizes[i][0];
+		conv.dst_height = sizes[i][1];
+		spa_assert_se(convert_init(&conv) == 0);
+		spa_assert_se(conv.is_passthrough);
+		spa_assert_se(conv.is_scaling);
+
+		fill_frame(out, SPA_VIDEO_FORMAT_BGRx, conv.dst_width, conv.dst_height,
+				out_s, out_p);
+		convert_process(&conv, out_p, out_s, (const void **)in_p, in_s);
+
+		for (y = 0; y < conv.dst_height; y++)
+			for (x = 0; x < conv.dst_width; x++)
+				spa_assert_se(memcmp(&out[y * out_s[0] + x * 4],
+							"\x10\x80\xf0\xff", 4) == 0);
+		convert_free(&conv);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+	printf("got CPU flags %d\n", cpu_flags);
+
+	test_values();
+	test_compare();
+	test_roundtrip();
+	test_scale();
+
+	return 0;
+}
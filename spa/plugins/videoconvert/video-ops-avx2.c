@@ -0,0 +1,317 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+#include <immintrin.h>
+
+/* y, u and v are 16 16 bits values, the result is 16 16 bits values
+ * for r, g and b, not clamped yet */
+static inline void
+yuv_to_rgb_avx2(const int16_t *m, __m256i y, __m256i u, __m256i v,
+		__m256i *r, __m256i *g, __m256i *b)
+{
+	__m256i c;
+
+	y = _mm256_sub_epi16(y, _mm256_set1_epi16(16));
+	u = _mm256_sub_epi16(u, _mm256_set1_epi16(128));
+	v = _mm256_sub_epi16(v, _mm256_set1_epi16(128));
+
+	c = _mm256_add_epi16(_mm256_mullo_epi16(y, _mm256_set1_epi16(m[0])),
+			_mm256_set1_epi16(1 << (YUV2RGB_SHIFT - 1)));
+
+	/* saturation only happens when the result is clamped to 255 anyway */
+	*r = _mm256_srai_epi16(_mm256_adds_epi16(c,
+				_mm256_mullo_epi16(v, _mm256_set1_epi16(m[1]))),
+			YUV2RGB_SHIFT);
+	*g = _mm256_srai_epi16(_mm256_subs_epi16(_mm256_subs_epi16(c,
+				_mm256_mullo_epi16(u, _mm256_set1_epi16(m[2]))),
+				_mm256_mullo_epi16(v, _mm256_set1_epi16(m[3]))),
+			YUV2RGB_SHIFT);
+	*b = _mm256_srai_epi16(_mm256_adds_epi16(c,
+				_mm256_mullo_epi16(u, _mm256_set1_epi16(m[4]))),
+			YUV2RGB_SHIFT);
+}
+
+static inline void
+store_rgbx_avx2(uint8_t *d, __m256i c0, __m256i c1, __m256i c2)
+{
+	__m256i t0, t1, lo, hi;
+
+	c0 = _mm256_packus_epi16(c0, c0);
+	c1 = _mm256_packus_epi16(c1, c1);
+	c2 = _mm256_packus_epi16(c2, c2);
+
+	t0 = _mm256_unpacklo_epi8(c0, c1);
+	t1 = _mm256_unpacklo_epi8(c2, _mm256_set1_epi8(-1));
+
+	/* pixels 0-3 and 8-11 in lo, 4-7 and 12-15 in hi */
+	lo = _mm256_unpacklo_epi16(t0, t1);
+	hi = _mm256_unpackhi_epi16(t0, t1);
+
+	_mm256_storeu_si256((__m256i*)(d + 0), _mm256_permute2x128_si256(lo, hi, 0x20));
+	_mm256_storeu_si256((__m256i*)(d + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+static inline void
+store_yuv_to_rgb_avx2(const int16_t *m, uint8_t *d, __m256i y, __m256i u, __m256i v,
+		bool bgr)
+{
+	__m256i r, g, b;
+
+	yuv_to_rgb_avx2(m, y, u, v, &r, &g, &b);
+	if (bgr)
+		store_rgbx_avx2(d, b, g, r);
+	else
+		store_rgbx_avx2(d, r, g, b);
+}
+
+static inline void
+i420_to_rgb_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	const uint8_t *sy = src[0], *su = src[1], *sv = src[2];
+	uint8_t *d = dst[0];
+	uint32_t i, unrolled = n_pixels & ~15u;
+	__m128i cu, cv;
+	__m256i y, u, v;
+
+	for (i = 0; i < unrolled; i += 16) {
+		y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)&sy[i]));
+		cu = _mm_loadl_epi64((const __m128i*)&su[i >> 1]);
+		cv = _mm_loadl_epi64((const __m128i*)&sv[i >> 1]);
+		u = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(cu, cu));
+		v = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(cv, cv));
+		store_yuv_to_rgb_avx2(m, &d[i * 4], y, u, v, bgr);
+	}
+	if (i < n_pixels) {
+		const void *s[3] = { &sy[i], &su[i >> 1], &sv[i >> 1] };
+		void *o[1] = { &d[i * 4] };
+		if (bgr)
+			conv_i420_to_bgrx_c(conv, o, s, n_pixels - i);
+		else
+			conv_i420_to_rgbx_c(conv, o, s, n_pixels - i);
+	}
+}
+
+static inline void
+nv12_to_rgb_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	const uint8_t *sy = src[0], *suv = src[1];
+	uint8_t *d = dst[0];
+	const __m256i mask = _mm256_set1_epi16(0xff);
+	uint32_t i, unrolled = n_pixels & ~15u;
+	__m128i cuv;
+	__m256i y, u, v, uv;
+
+	for (i = 0; i < unrolled; i += 16) {
+		y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)&sy[i]));
+		cuv = _mm_loadu_si128((const __m128i*)&suv[i]);
+		uv = _mm256_set_m128i(_mm_unpackhi_epi16(cuv, cuv),
+				_mm_unpacklo_epi16(cuv, cuv));
+		u = _mm256_and_si256(uv, mask);
+		v = _mm256_srli_epi16(uv, 8);
+		store_yuv_to_rgb_avx2(m, &d[i * 4], y, u, v, bgr);
+	}
+	if (i < n_pixels) {
+		const void *s[2] = { &sy[i], &suv[i] };
+		void *o[1] = { &d[i * 4] };
+		if (bgr)
+			conv_nv12_to_bgrx_c(conv, o, s, n_pixels - i);
+		else
+			conv_nv12_to_rgbx_c(conv, o, s, n_pixels - i);
+	}
+}
+
+static inline void
+yuy2_to_rgb_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	const __m256i mask8 = _mm256_set1_epi16(0xff);
+	const __m256i mask16 = _mm256_set1_epi32(0xffff);
+	uint32_t i, unrolled = n_pixels & ~15u;
+	__m256i in, y, u, v, c;
+
+	for (i = 0; i < unrolled; i += 16) {
+		in = _mm256_loadu_si256((const __m256i*)&s[i * 2]);
+		y = _mm256_and_si256(in, mask8);
+		c = _mm256_srli_epi16(in, 8);
+		u = _mm256_and_si256(c, mask16);
+		u = _mm256_or_si256(u, _mm256_slli_epi32(u, 16));
+		v = _mm256_srli_epi32(c, 16);
+		v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+		store_yuv_to_rgb_avx2(m, &d[i * 4], y, u, v, bgr);
+	}
+	if (i < n_pixels) {
+		const void *si[1] = { &s[i * 2] };
+		void *o[1] = { &d[i * 4] };
+		if (bgr)
+			conv_yuy2_to_bgrx_c(conv, o, si, n_pixels - i);
+		else
+			conv_yuy2_to_rgbx_c(conv, o, si, n_pixels - i);
+	}
+}
+
+#define MAKE_YUV_TO_RGB(fmt)							\
+void										\
+conv_##fmt##_to_bgrx_avx2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	fmt##_to_rgb_avx2(conv, dst, src, n_pixels, true);			\
+}										\
+void										\
+conv_##fmt##_to_rgbx_avx2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	fmt##_to_rgb_avx2(conv, dst, src, n_pixels, false);			\
+}
+
+MAKE_YUV_TO_RGB(i420);
+MAKE_YUV_TO_RGB(nv12);
+MAKE_YUV_TO_RGB(yuy2);
+
+/* load 16 RGBx pixels and produce 16 16 bits y values and 8 bits u and v
+ * values averaged over each pair of pixels. The u and v of pixels 0-7 are
+ * in the low 4 16 bits lanes of the low half, the ones of pixels 8-15 in
+ * the low 4 16 bits lanes of the high half. */
+static inline void
+rgb_to_yuv_avx2(const int16_t *m, const uint8_t *s, bool bgr,
+		__m256i *y, __m256i *u, __m256i *v)
+{
+	const __m256i mask = _mm256_set1_epi32(0xff);
+	const __m256i mask8 = _mm256_set1_epi16(0xff);
+	const __m256i round = _mm256_set1_epi16(1 << (RGB2YUV_SHIFT - 1));
+	__m256i p0, p1, r, g, b, t;
+
+	p0 = _mm256_loadu_si256((const __m256i*)(s + 0));
+	p1 = _mm256_loadu_si256((const __m256i*)(s + 32));
+
+	/* the packs work per 128 bits half, put the pixels back in order */
+#define PACK(a,b)	_mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8)
+	r = PACK(_mm256_and_si256(p0, mask), _mm256_and_si256(p1, mask));
+	g = PACK(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask),
+			_mm256_and_si256(_mm256_srli_epi32(p1, 8), mask));
+	b = PACK(_mm256_and_si256(_mm256_srli_epi32(p0, 16), mask),
+			_mm256_and_si256(_mm256_srli_epi32(p1, 16), mask));
+#undef PACK
+	if (bgr) {
+		t = r;
+		r = b;
+		b = t;
+	}
+
+#define DOT(c0,c1,c2)	_mm256_add_epi16(_mm256_add_epi16(			\
+			_mm256_mullo_epi16(r, _mm256_set1_epi16(c0)),		\
+			_mm256_mullo_epi16(g, _mm256_set1_epi16(c1))),		\
+			_mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(c2)), round))
+
+	*y = _mm256_add_epi16(_mm256_srai_epi16(DOT(m[0], m[1], m[2]), RGB2YUV_SHIFT),
+			_mm256_set1_epi16(16));
+	*u = _mm256_add_epi16(_mm256_srai_epi16(DOT(m[3], m[4], m[5]), RGB2YUV_SHIFT),
+			_mm256_set1_epi16(128));
+	*v = _mm256_add_epi16(_mm256_srai_epi16(DOT(m[6], m[7], m[8]), RGB2YUV_SHIFT),
+			_mm256_set1_epi16(128));
+#undef DOT
+
+	/* clamp each pixel first, then average the pairs like the C version */
+	t = _mm256_packus_epi16(*u, *u);
+	*u = _mm256_avg_epu16(_mm256_and_si256(t, mask8), _mm256_srli_epi16(t, 8));
+	t = _mm256_packus_epi16(*v, *v);
+	*v = _mm256_avg_epu16(_mm256_and_si256(t, mask8), _mm256_srli_epi16(t, 8));
+}
+
+/* the low 8 bytes of each half of v */
+static inline __m128i low_bytes_avx2(__m256i v)
+{
+	return _mm_unpacklo_epi64(_mm256_castsi256_si128(v),
+			_mm256_extracti128_si256(v, 1));
+}
+
+static inline void
+rgb_to_i420_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->rgb2yuv;
+	const uint8_t *s = src[0];
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	uint32_t i, unrolled = n_pixels & ~15u;
+	__m256i y, u, v;
+
+	for (i = 0; i < unrolled; i += 16) {
+		rgb_to_yuv_avx2(m, &s[i * 4], bgr, &y, &u, &v);
+		_mm_storeu_si128((__m128i*)&dy[i], low_bytes_avx2(_mm256_packus_epi16(y, y)));
+		if (du != NULL) {
+			/* the 4 u and v bytes of each half */
+			u = _mm256_packus_epi16(u, u);
+			v = _mm256_packus_epi16(v, v);
+			_mm_storel_epi64((__m128i*)&du[i >> 1],
+					_mm_unpacklo_epi32(_mm256_castsi256_si128(u),
+						_mm256_extracti128_si256(u, 1)));
+			_mm_storel_epi64((__m128i*)&dv[i >> 1],
+					_mm_unpacklo_epi32(_mm256_castsi256_si128(v),
+						_mm256_extracti128_si256(v, 1)));
+		}
+	}
+	if (i < n_pixels) {
+		const void *si[1] = { &s[i * 4] };
+		void *o[3] = { &dy[i], du ? &du[i >> 1] : NULL, dv ? &dv[i >> 1] : NULL };
+		if (bgr)
+			conv_bgrx_to_i420_c(conv, o, si, n_pixels - i);
+		else
+			conv_rgbx_to_i420_c(conv, o, si, n_pixels - i);
+	}
+}
+
+static inline void
+rgb_to_nv12_avx2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->rgb2yuv;
+	const uint8_t *s = src[0];
+	uint8_t *dy = dst[0], *duv = dst[1];
+	uint32_t i, unrolled = n_pixels & ~15u;
+	__m256i y, u, v;
+
+	for (i = 0; i < unrolled; i += 16) {
+		rgb_to_yuv_avx2(m, &s[i * 4], bgr, &y, &u, &v);
+		_mm_storeu_si128((__m128i*)&dy[i], low_bytes_avx2(_mm256_packus_epi16(y, y)));
+		if (duv != NULL) {
+			u = _mm256_or_si256(u, _mm256_slli_epi16(v, 8));
+			_mm_storeu_si128((__m128i*)&duv[i], low_bytes_avx2(u));
+		}
+	}
+	if (i < n_pixels) {
+		const void *si[1] = { &s[i * 4] };
+		void *o[2] = { &dy[i], duv ? &duv[i] : NULL };
+		if (bgr)
+			conv_bgrx_to_nv12_c(conv, o, si, n_pixels - i);
+		else
+			conv_rgbx_to_nv12_c(conv, o, si, n_pixels - i);
+	}
+}
+
+#define MAKE_RGB_TO_YUV(fmt)							\
+void										\
+conv_bgrx_to_##fmt##_avx2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	rgb_to_##fmt##_avx2(conv, dst, src, n_pixels, true);			\
+}										\
+void										\
+conv_rgbx_to_##fmt##_avx2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	rgb_to_##fmt##_avx2(conv, dst, src, n_pixels, false);			\
+}
+
+MAKE_RGB_TO_YUV(i420);
+MAKE_RGB_TO_YUV(nv12);
@@ -0,0 +1,259 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+static inline uint8_t clamp_u8(int v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline void
+yuv_line_to_rgb(struct convert *conv, uint8_t * SPA_RESTRICT d,
+		const uint8_t * SPA_RESTRICT y, uint32_t ys,
+		const uint8_t * SPA_RESTRICT u, const uint8_t * SPA_RESTRICT v,
+		uint32_t uvs, uint32_t n_pixels, uint32_t ri, uint32_t bi)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	uint32_t i;
+
+	for (i = 0; i < n_pixels; i++) {
+		uint32_t c = (i >> 1) * uvs;
+		int cy = (y[i * ys] - 16) * m[0] + (1 << (YUV2RGB_SHIFT - 1));
+		int cu = u[c] - 128;
+		int cv = v[c] - 128;
+
+		d[ri] = clamp_u8((cy + m[1] * cv) >> YUV2RGB_SHIFT);
+		d[1] = clamp_u8((cy - m[2] * cu - m[3] * cv) >> YUV2RGB_SHIFT);
+		d[bi] = clamp_u8((cy + m[4] * cu) >> YUV2RGB_SHIFT);
+		d[3] = 0xff;
+		d += 4;
+	}
+}
+
+static inline void
+rgb_to_yuv(const int16_t *m, const uint8_t *s, uint32_t ri, uint32_t bi,
+		uint8_t *y, uint8_t *u, uint8_t *v)
+{
+	int r = s[ri], g = s[1], b = s[bi];
+	const int round = 1 << (RGB2YUV_SHIFT - 1);
+
+	*y = clamp_u8(((m[0] * r + m[1] * g + m[2] * b + round) >> RGB2YUV_SHIFT) + 16);
+	*u = clamp_u8(((m[3] * r + m[4] * g + m[5] * b + round) >> RGB2YUV_SHIFT) + 128);
+	*v = clamp_u8(((m[6] * r + m[7] * g + m[8] * b + round) >> RGB2YUV_SHIFT) + 128);
+}
+
+/* chroma is the average of each horizontal pair of pixels, u and v are
+ * NULL when the line does not carry chroma */
+static inline void
+rgb_line_to_yuv(struct convert *conv, const uint8_t * SPA_RESTRICT s,
+		uint32_t ri, uint32_t bi, uint8_t * SPA_RESTRICT y, uint32_t ys,
+		uint8_t * SPA_RESTRICT u, uint8_t * SPA_RESTRICT v, uint32_t uvs,
+		uint32_t n_pixels)
+{
+	const int16_t *m = conv->minfo->rgb2yuv;
+	uint32_t i;
+	uint8_t u0, v0, u1, v1;
+
+	for (i = 0; i < n_pixels; i += 2) {
+		rgb_to_yuv(m, &s[i * 4], ri, bi, &y[i * ys], &u0, &v0);
+		if (i + 1 < n_pixels)
+			rgb_to_yuv(m, &s[i * 4 + 4], ri, bi, &y[(i + 1) * ys], &u1, &v1);
+		else
+			u1 = u0, v1 = v0;
+		if (u != NULL) {
+			u[(i >> 1) * uvs] = (u0 + u1 + 1) >> 1;
+			v[(i >> 1) * uvs] = (v0 + v1 + 1) >> 1;
+		}
+	}
+}
+
+static inline void
+yuv_line_to_yuv(uint8_t * SPA_RESTRICT dy, uint32_t dys,
+		uint8_t * SPA_RESTRICT du, uint8_t * SPA_RESTRICT dv, uint32_t duvs,
+		const uint8_t * SPA_RESTRICT sy, uint32_t sys,
+		const uint8_t * SPA_RESTRICT su, const uint8_t * SPA_RESTRICT sv, uint32_t suvs,
+		uint32_t n_pixels)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_pixels; i++)
+		dy[i * dys] = sy[i * sys];
+	if (du == NULL)
+		return;
+	for (i = 0; i < (n_pixels + 1) >> 1; i++) {
+		du[i * duvs] = su[i * suvs];
+		dv[i * duvs] = sv[i * suvs];
+	}
+}
+
+void
+conv_swap_rb_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	uint32_t i;
+
+	for (i = 0; i < n_pixels; i++) {
+		d[0] = s[2];
+		d[1] = s[1];
+		d[2] = s[0];
+		d[3] = s[3];
+		d += 4;
+		s += 4;
+	}
+}
+
+#define MAKE_YUV_TO_RGB(name,ri,bi)						\
+void										\
+conv_i420_to_##name##_c(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	yuv_line_to_rgb(conv, dst[0], src[0], 1, src[1], src[2], 1,		\
+			n_pixels, ri, bi);					\
+}										\
+void										\
+conv_nv12_to_##name##_c(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	const uint8_t *uv = src[1];						\
+	yuv_line_to_rgb(conv, dst[0], src[0], 1, uv, uv + 1, 2,		\
+			n_pixels, ri, bi);					\
+}										\
+void										\
+conv_yuy2_to_##name##_c(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	const uint8_t *s = src[0];						\
+	yuv_line_to_rgb(conv, dst[0], s, 2, s + 1, s + 3, 4,			\
+			n_pixels, ri, bi);					\
+}
+
+MAKE_YUV_TO_RGB(bgrx, 2, 0);
+MAKE_YUV_TO_RGB(rgbx, 0, 2);
+
+#define MAKE_RGB_TO_YUV(name,ri,bi)						\
+void										\
+conv_##name##_to_i420_c(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	rgb_line_to_yuv(conv, src[0], ri, bi, dst[0], 1, dst[1], dst[2], 1,	\
+			n_pixels);						\
+}										\
+void										\
+conv_##name##_to_nv12_c(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	uint8_t *uv = dst[1];							\
+	rgb_line_to_yuv(conv, src[0], ri, bi, dst[0], 1, uv,			\
+			uv ? uv + 1 : NULL, 2, n_pixels);			\
+}										\
+void										\
+conv_##name##_to_yuy2_c(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	uint8_t *d = dst[0];							\
+	rgb_line_to_yuv(conv, src[0], ri, bi, d, 2, d + 1, d + 3, 4,		\
+			n_pixels);						\
+}
+
+MAKE_RGB_TO_YUV(bgrx, 2, 0);
+MAKE_RGB_TO_YUV(rgbx, 0, 2);
+
+void
+conv_i420_to_nv12_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	uint8_t *uv = dst[1];
+	yuv_line_to_yuv(dst[0], 1, uv, uv ? uv + 1 : NULL, 2,
+			src[0], 1, src[1], src[2], 1, n_pixels);
+}
+
+void
+conv_nv12_to_i420_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	const uint8_t *uv = src[1];
+	yuv_line_to_yuv(dst[0], 1, dst[1], dst[2], 1,
+			src[0], 1, uv, uv + 1, 2, n_pixels);
+}
+
+void
+conv_i420_to_yuy2_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	uint8_t *d = dst[0];
+	yuv_line_to_yuv(d, 2, d + 1, d + 3, 4,
+			src[0], 1, src[1], src[2], 1, n_pixels);
+}
+
+void
+conv_nv12_to_yuy2_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	const uint8_t *uv = src[1];
+	uint8_t *d = dst[0];
+	yuv_line_to_yuv(d, 2, d + 1, d + 3, 4,
+			src[0], 1, uv, uv + 1, 2, n_pixels);
+}
+
+void
+conv_yuy2_to_i420_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	const uint8_t *s = src[0];
+	yuv_line_to_yuv(dst[0], 1, dst[1], dst[2], 1,
+			s, 2, s + 1, s + 3, 4, n_pixels);
+}
+
+void
+conv_yuy2_to_nv12_c(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+{
+	const uint8_t *s = src[0];
+	uint8_t *uv = dst[1];
+	yuv_line_to_yuv(dst[0], 1, uv, uv ? uv + 1 : NULL, 2,
+			s, 2, s + 1, s + 3, 4, n_pixels);
+}
+
+/* bilinear filter with 8 bits of precision for the weights. Positions are
+ * tracked in 16.16 fixed point with the pixel centers aligned. */
+void
+scale_bilinear_c(struct convert *conv, void * SPA_RESTRICT dst,
+		uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height,
+		const void * SPA_RESTRICT src, uint32_t src_stride,
+		uint32_t src_width, uint32_t src_height, uint32_t bpe)
+{
+	int32_t xstep = ((int64_t)src_width << 16) / dst_width;
+	int32_t ystep = ((int64_t)src_height << 16) / dst_height;
+	int32_t sy = ystep / 2 - (1 << 15);
+	uint32_t x, y, c;
+
+	for (y = 0; y < dst_height; y++, sy += ystep) {
+		uint32_t y0 = sy < 0 ? 0 : sy >> 16;
+		uint32_t fy = sy < 0 ? 0 : (sy >> 8) & 0xff;
+		uint32_t y1 = SPA_MIN(y0 + 1, src_height - 1);
+		const uint8_t *r0 = SPA_PTROFF(src, y0 * src_stride, uint8_t);
+		const uint8_t *r1 = SPA_PTROFF(src, y1 * src_stride, uint8_t);
+		uint8_t *d = SPA_PTROFF(dst, y * dst_stride, uint8_t);
+		int32_t sx = xstep / 2 - (1 << 15);
+
+		for (x = 0; x < dst_width; x++, sx += xstep) {
+			uint32_t x0 = sx < 0 ? 0 : sx >> 16;
+			uint32_t fx = sx < 0 ? 0 : (sx >> 8) & 0xff;
+			uint32_t x1 = SPA_MIN(x0 + 1, src_width - 1);
+
+			x0 *= bpe;
+			x1 *= bpe;
+			for (c = 0; c < bpe; c++) {
+				uint32_t a = r0[x0 + c] * (256 - fx) + r0[x1 + c] * fx;
+				uint32_t b = r1[x0 + c] * (256 - fx) + r1[x1 + c] * fx;
+				*d++ = (a * (256 - fy) + b * fy + (1 << 15)) >> 16;
+			}
+		}
+	}
+}
@@ -0,0 +1,304 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+#include <emmintrin.h>
+
+static inline __m128i load_u32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return _mm_cvtsi32_si128(v);
+}
+
+static inline void store_u32(uint8_t *p, __m128i v)
+{
+	uint32_t t = _mm_cvtsi128_si32(v);
+	memcpy(p, &t, sizeof(t));
+}
+
+/* y, u and v are 8 16 bits values, the result is 8 16 bits values
+ * for r, g and b, not clamped yet */
+static inline void
+yuv_to_rgb_sse2(const int16_t *m, __m128i y, __m128i u, __m128i v,
+		__m128i *r, __m128i *g, __m128i *b)
+{
+	__m128i c;
+
+	y = _mm_sub_epi16(y, _mm_set1_epi16(16));
+	u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+	v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+	c = _mm_add_epi16(_mm_mullo_epi16(y, _mm_set1_epi16(m[0])),
+			_mm_set1_epi16(1 << (YUV2RGB_SHIFT - 1)));
+
+	/* saturation only happens when the result is clamped to 255 anyway */
+	*r = _mm_srai_epi16(_mm_adds_epi16(c, _mm_mullo_epi16(v, _mm_set1_epi16(m[1]))),
+			YUV2RGB_SHIFT);
+	*g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(c,
+				_mm_mullo_epi16(u, _mm_set1_epi16(m[2]))),
+				_mm_mullo_epi16(v, _mm_set1_epi16(m[3]))),
+			YUV2RGB_SHIFT);
+	*b = _mm_srai_epi16(_mm_adds_epi16(c, _mm_mullo_epi16(u, _mm_set1_epi16(m[4]))),
+			YUV2RGB_SHIFT);
+}
+
+static inline void
+store_rgbx_sse2(uint8_t *d, __m128i c0, __m128i c1, __m128i c2)
+{
+	__m128i t0, t1;
+
+	c0 = _mm_packus_epi16(c0, c0);
+	c1 = _mm_packus_epi16(c1, c1);
+	c2 = _mm_packus_epi16(c2, c2);
+
+	t0 = _mm_unpacklo_epi8(c0, c1);
+	t1 = _mm_unpacklo_epi8(c2, _mm_set1_epi8(-1));
+
+	_mm_storeu_si128((__m128i*)(d + 0), _mm_unpacklo_epi16(t0, t1));
+	_mm_storeu_si128((__m128i*)(d + 16), _mm_unpackhi_epi16(t0, t1));
+}
+
+static inline void
+store_yuv_to_rgb_sse2(const int16_t *m, uint8_t *d, __m128i y, __m128i u, __m128i v,
+		bool bgr)
+{
+	__m128i r, g, b;
+
+	yuv_to_rgb_sse2(m, y, u, v, &r, &g, &b);
+	if (bgr)
+		store_rgbx_sse2(d, b, g, r);
+	else
+		store_rgbx_sse2(d, r, g, b);
+}
+
+static inline void
+i420_to_rgb_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	const uint8_t *sy = src[0], *su = src[1], *sv = src[2];
+	uint8_t *d = dst[0];
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t i, unrolled = n_pixels & ~7u;
+	__m128i y, u, v;
+
+	for (i = 0; i < unrolled; i += 8) {
+		y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&sy[i]), zero);
+		u = load_u32(&su[i >> 1]);
+		v = load_u32(&sv[i >> 1]);
+		u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u, u), zero);
+		v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v, v), zero);
+		store_yuv_to_rgb_sse2(m, &d[i * 4], y, u, v, bgr);
+	}
+	if (i < n_pixels) {
+		const void *s[3] = { &sy[i], &su[i >> 1], &sv[i >> 1] };
+		void *o[1] = { &d[i * 4] };
+		if (bgr)
+			conv_i420_to_bgrx_c(conv, o, s, n_pixels - i);
+		else
+			conv_i420_to_rgbx_c(conv, o, s, n_pixels - i);
+	}
+}
+
+static inline void
+nv12_to_rgb_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	const uint8_t *sy = src[0], *suv = src[1];
+	uint8_t *d = dst[0];
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi16(0xff);
+	uint32_t i, unrolled = n_pixels & ~7u;
+	__m128i y, u, v, uv;
+
+	for (i = 0; i < unrolled; i += 8) {
+		y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&sy[i]), zero);
+		uv = _mm_loadl_epi64((const __m128i*)&suv[i]);
+		uv = _mm_unpacklo_epi16(uv, uv);
+		u = _mm_and_si128(uv, mask);
+		v = _mm_srli_epi16(uv, 8);
+		store_yuv_to_rgb_sse2(m, &d[i * 4], y, u, v, bgr);
+	}
+	if (i < n_pixels) {
+		const void *s[2] = { &sy[i], &suv[i] };
+		void *o[1] = { &d[i * 4] };
+		if (bgr)
+			conv_nv12_to_bgrx_c(conv, o, s, n_pixels - i);
+		else
+			conv_nv12_to_rgbx_c(conv, o, s, n_pixels - i);
+	}
+}
+
+static inline void
+yuy2_to_rgb_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->yuv2rgb;
+	const uint8_t *s = src[0];
+	uint8_t *d = dst[0];
+	const __m128i mask8 = _mm_set1_epi16(0xff);
+	const __m128i mask16 = _mm_set1_epi32(0xffff);
+	uint32_t i, unrolled = n_pixels & ~7u;
+	__m128i in, y, u, v, c;
+
+	for (i = 0; i < unrolled; i += 8) {
+		in = _mm_loadu_si128((const __m128i*)&s[i * 2]);
+		y = _mm_and_si128(in, mask8);
+		c = _mm_srli_epi16(in, 8);
+		u = _mm_and_si128(c, mask16);
+		u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+		v = _mm_srli_epi32(c, 16);
+		v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+		store_yuv_to_rgb_sse2(m, &d[i * 4], y, u, v, bgr);
+	}
+	if (i < n_pixels) {
+		const void *si[1] = { &s[i * 2] };
+		void *o[1] = { &d[i * 4] };
+		if (bgr)
+			conv_yuy2_to_bgrx_c(conv, o, si, n_pixels - i);
+		else
+			conv_yuy2_to_rgbx_c(conv, o, si, n_pixels - i);
+	}
+}
+
+#define MAKE_YUV_TO_RGB(fmt)							\
+void										\
+conv_##fmt##_to_bgrx_sse2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	fmt##_to_rgb_sse2(conv, dst, src, n_pixels, true);			\
+}										\
+void										\
+conv_##fmt##_to_rgbx_sse2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	fmt##_to_rgb_sse2(conv, dst, src, n_pixels, false);			\
+}
+
+MAKE_YUV_TO_RGB(i420);
+MAKE_YUV_TO_RGB(nv12);
+MAKE_YUV_TO_RGB(yuy2);
+
+/* load 8 RGBx pixels and produce 8 16 bits y values and 8 bits u and v
+ * values averaged over each pair of pixels in the low 4 16 bits lanes */
+static inline void
+rgb_to_yuv_sse2(const int16_t *m, const uint8_t *s, bool bgr,
+		__m128i *y, __m128i *u, __m128i *v)
+{
+	const __m128i mask = _mm_set1_epi32(0xff);
+	const __m128i mask8 = _mm_set1_epi16(0xff);
+	const __m128i round = _mm_set1_epi16(1 << (RGB2YUV_SHIFT - 1));
+	__m128i p0, p1, r, g, b, t;
+
+	p0 = _mm_loadu_si128((const __m128i*)(s + 0));
+	p1 = _mm_loadu_si128((const __m128i*)(s + 16));
+
+	r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+	g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+			_mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+	b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+			_mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+	if (bgr) {
+		t = r;
+		r = b;
+		b = t;
+	}
+
+#define DOT(c0,c1,c2)	_mm_add_epi16(_mm_add_epi16(				\
+			_mm_mullo_epi16(r, _mm_set1_epi16(c0)),			\
+			_mm_mullo_epi16(g, _mm_set1_epi16(c1))),		\
+			_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(c2)), round))
+
+	*y = _mm_add_epi16(_mm_srai_epi16(DOT(m[0], m[1], m[2]), RGB2YUV_SHIFT),
+			_mm_set1_epi16(16));
+	*u = _mm_add_epi16(_mm_srai_epi16(DOT(m[3], m[4], m[5]), RGB2YUV_SHIFT),
+			_mm_set1_epi16(128));
+	*v = _mm_add_epi16(_mm_srai_epi16(DOT(m[6], m[7], m[8]), RGB2YUV_SHIFT),
+			_mm_set1_epi16(128));
+#undef DOT
+
+	/* clamp each pixel first, then average the pairs like the C version */
+	t = _mm_packus_epi16(*u, *u);
+	*u = _mm_avg_epu16(_mm_and_si128(t, mask8), _mm_srli_epi16(t, 8));
+	t = _mm_packus_epi16(*v, *v);
+	*v = _mm_avg_epu16(_mm_and_si128(t, mask8), _mm_srli_epi16(t, 8));
+}
+
+static inline void
+rgb_to_i420_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->rgb2yuv;
+	const uint8_t *s = src[0];
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	uint32_t i, unrolled = n_pixels & ~7u;
+	__m128i y, u, v;
+
+	for (i = 0; i < unrolled; i += 8) {
+		rgb_to_yuv_sse2(m, &s[i * 4], bgr, &y, &u, &v);
+		_mm_storel_epi64((__m128i*)&dy[i], _mm_packus_epi16(y, y));
+		if (du != NULL) {
+			store_u32(&du[i >> 1], _mm_packus_epi16(u, u));
+			store_u32(&dv[i >> 1], _mm_packus_epi16(v, v));
+		}
+	}
+	if (i < n_pixels) {
+		const void *si[1] = { &s[i * 4] };
+		void *o[3] = { &dy[i], du ? &du[i >> 1] : NULL, dv ? &dv[i >> 1] : NULL };
+		if (bgr)
+			conv_bgrx_to_i420_c(conv, o, si, n_pixels - i);
+		else
+			conv_rgbx_to_i420_c(conv, o, si, n_pixels - i);
+	}
+}
+
+static inline void
+rgb_to_nv12_sse2(struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels, bool bgr)
+{
+	const int16_t *m = conv->minfo->rgb2yuv;
+	const uint8_t *s = src[0];
+	uint8_t *dy = dst[0], *duv = dst[1];
+	uint32_t i, unrolled = n_pixels & ~7u;
+	__m128i y, u, v;
+
+	for (i = 0; i < unrolled; i += 8) {
+		rgb_to_yuv_sse2(m, &s[i * 4], bgr, &y, &u, &v);
+		_mm_storel_epi64((__m128i*)&dy[i], _mm_packus_epi16(y, y));
+		if (duv != NULL) {
+			u = _mm_or_si128(u, _mm_slli_epi16(v, 8));
+			_mm_storel_epi64((__m128i*)&duv[i], u);
+		}
+	}
+	if (i < n_pixels) {
+		const void *si[1] = { &s[i * 4] };
+		void *o[2] = { &dy[i], duv ? &duv[i] : NULL };
+		if (bgr)
+			conv_bgrx_to_nv12_c(conv, o, si, n_pixels - i);
+		else
+			conv_rgbx_to_nv12_c(conv, o, si, n_pixels - i);
+	}
+}
+
+#define MAKE_RGB_TO_YUV(fmt)							\
+void										\
+conv_bgrx_to_##fmt##_sse2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	rgb_to_##fmt##_sse2(conv, dst, src, n_pixels, true);			\
+}										\
+void										\
+conv_rgbx_to_##fmt##_sse2(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)		\
+{										\
+	rgb_to_##fmt##_sse2(conv, dst, src, n_pixels, false);			\
+}
+
+MAKE_RGB_TO_YUV(i420);
+MAKE_RGB_TO_YUV(nv12);
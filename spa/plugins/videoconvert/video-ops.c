@@ -0,0 +1,362 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+#include <spa/param/video/raw.h>
+
+#include "video-ops.h"
+
+#define MAKE_FORMAT(fmt,n,...) \
+	{ SPA_VIDEO_FORMAT_ ##fmt, n, __VA_ARGS__ }
+
+static const struct format_info format_table[] =
+{
+	/*           format  planes  bpe         xsub        ysub */
+	MAKE_FORMAT(I420, 3, { 1, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 }),
+	MAKE_FORMAT(NV12, 2, { 1, 2, 0 }, { 0, 1, 0 }, { 0, 1, 0 }),
+	MAKE_FORMAT(YUY2, 1, { 4, 0, 0 }, { 1, 0, 0 }, { 0, 0, 0 }),
+	MAKE_FORMAT(BGRx, 1, { 4, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 }),
+	MAKE_FORMAT(RGBx, 1, { 4, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 }),
+};
+
+#undef MAKE_FORMAT
+
+const struct format_info *format_info_find(uint32_t format)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(format_table, f) {
+		if (f->format == format)
+			return f;
+	}
+	return NULL;
+}
+
+uint32_t format_info_layout(const struct format_info *info, uint32_t width,
+		uint32_t height, uint32_t stride[], uint32_t offset[])
+{
+	uint32_t i, size = 0;
+
+	if (stride[0] == 0)
+		stride[0] = SPA_ROUND_UP_N(format_info_plane_width(info, 0, width) *
+				info->bpe[0], 4);
+
+	for (i = 0; i < info->n_planes; i++) {
+		if (i > 0)
+			stride[i] = ((stride[0] * info->bpe[i] / info->bpe[0]) <<
+					info->xsub[0]) >> info->xsub[i];
+		offset[i] = size;
+		size += stride[i] * format_info_plane_height(info, i, height);
+	}
+	return size;
+}
+
+static const struct matrix_info matrix_table[] =
+{
+	{ SPA_VIDEO_COLOR_MATRIX_BT709,
+		{ 75, 115, 14, 34, 135 },
+		{ 23, 79, 8, -13, -43, 56, 56, -51, -5 } },
+	/* default, BT.601 */
+	{ SPA_VIDEO_COLOR_MATRIX_UNKNOWN,
+		{ 75, 102, 25, 52, 129 },
+		{ 33, 64, 13, -19, -37, 56, 56, -47, -9 } },
+};
+
+static const struct matrix_info *find_matrix_info(uint32_t matrix)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(matrix_table, m) {
+		if (m->matrix == matrix || m->matrix == SPA_VIDEO_COLOR_MATRIX_UNKNOWN)
+			return m;
+	}
+	return NULL;
+}
+
+typedef void (*convert_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t n_pixels);
+
+struct conv_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+
+	convert_func_t process;
+	const char *name;
+
+	uint32_t cpu_flags;
+};
+
+#define MAKE(fmt1,fmt2,func,...) \
+	{  SPA_VIDEO_FORMAT_ ##fmt1, SPA_VIDEO_FORMAT_ ##fmt2, func, #func , __VA_ARGS__ }
+
+static struct conv_info conv_table[] =
+{
+	/* YUV to RGB */
+#if defined (HAVE_AVX2)
+	MAKE(I420, BGRx, conv_i420_to_bgrx_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(I420, BGRx, conv_i420_to_bgrx_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(I420, BGRx, conv_i420_to_bgrx_c),
+#if defined (HAVE_AVX2)
+	MAKE(I420, RGBx, conv_i420_to_rgbx_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(I420, RGBx, conv_i420_to_rgbx_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(I420, RGBx, conv_i420_to_rgbx_c),
+#if defined (HAVE_AVX2)
+	MAKE(NV12, BGRx, conv_nv12_to_bgrx_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(NV12, BGRx, conv_nv12_to_bgrx_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(NV12, BGRx, conv_nv12_to_bgrx_c),
+#if defined (HAVE_AVX2)
+	MAKE(NV12, RGBx, conv_nv12_to_rgbx_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(NV12, RGBx, conv_nv12_to_rgbx_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(NV12, RGBx, conv_nv12_to_rgbx_c),
+#if defined (HAVE_AVX2)
+	MAKE(YUY2, BGRx, conv_yuy2_to_bgrx_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(YUY2, BGRx, conv_yuy2_to_bgrx_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(YUY2, BGRx, conv_yuy2_to_bgrx_c),
+#if defined (HAVE_AVX2)
+	MAKE(YUY2, RGBx, conv_yuy2_to_rgbx_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(YUY2, RGBx, conv_yuy2_to_rgbx_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(YUY2, RGBx, conv_yuy2_to_rgbx_c),
+
+	/* RGB to YUV */
+#if defined (HAVE_AVX2)
+	MAKE(BGRx, I420, conv_bgrx_to_i420_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(BGRx, I420, conv_bgrx_to_i420_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(BGRx, I420, conv_bgrx_to_i420_c),
+#if defined (HAVE_AVX2)
+	MAKE(RGBx, I420, conv_rgbx_to_i420_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(RGBx, I420, conv_rgbx_to_i420_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(RGBx, I420, conv_rgbx_to_i420_c),
+#if defined (HAVE_AVX2)
+	MAKE(BGRx, NV12, conv_bgrx_to_nv12_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(BGRx, NV12, conv_bgrx_to_nv12_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(BGRx, NV12, conv_bgrx_to_nv12_c),
+#if defined (HAVE_AVX2)
+	MAKE(RGBx, NV12, conv_rgbx_to_nv12_avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(RGBx, NV12, conv_rgbx_to_nv12_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(RGBx, NV12, conv_rgbx_to_nv12_c),
+	MAKE(BGRx, YUY2, conv_bgrx_to_yuy2_c),
+	MAKE(RGBx, YUY2, conv_rgbx_to_yuy2_c),
+
+	/* YUV to YUV */
+	MAKE(I420, NV12, conv_i420_to_nv12_c),
+	MAKE(NV12, I420, conv_nv12_to_i420_c),
+	MAKE(I420, YUY2, conv_i420_to_yuy2_c),
+	MAKE(NV12, YUY2, conv_nv12_to_yuy2_c),
+	MAKE(YUY2, I420, conv_yuy2_to_i420_c),
+	MAKE(YUY2, NV12, conv_yuy2_to_nv12_c),
+
+	/* RGB to RGB */
+	MAKE(BGRx, RGBx, conv_swap_rb_c),
+	MAKE(RGBx, BGRx, conv_swap_rb_c),
+};
+#undef MAKE
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct conv_info *find_conv_info(uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(conv_table, c) {
+		if (c->src_fmt == src_fmt &&
+		    c->dst_fmt == dst_fmt &&
+		    MATCH_CPU_FLAGS(c->cpu_flags, cpu_flags))
+			return c;
+	}
+	return NULL;
+}
+
+typedef void (*scale_func_t) (struct convert *conv, void * SPA_RESTRICT dst,
+		uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height,
+		const void * SPA_RESTRICT src, uint32_t src_stride,
+		uint32_t src_width, uint32_t src_height, uint32_t bpe);
+
+struct scale_info {
+	scale_func_t scale;
+	const char *name;
+
+	uint32_t cpu_flags;
+};
+
+#define MAKE(func,...) \
+	{ func, #func , __VA_ARGS__ }
+
+static struct scale_info scale_table[] =
+{
+	MAKE(scale_bilinear_c),
+};
+#undef MAKE
+
+static const struct scale_info *find_scale_info(uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(scale_table, s) {
+		if (MATCH_CPU_FLAGS(s->cpu_flags, cpu_flags))
+			return s;
+	}
+	return NULL;
+}
+
+static void copy_plane(void * SPA_RESTRICT dst, uint32_t dst_stride,
+		const void * SPA_RESTRICT src, uint32_t src_stride,
+		uint32_t size, uint32_t height)
+{
+	uint32_t i;
+
+	if (dst_stride == src_stride) {
+		memcpy(dst, src, dst_stride * (height - 1) + size);
+		return;
+	}
+	for (i = 0; i < height; i++)
+		memcpy(SPA_PTROFF(dst, i * dst_stride, void),
+				SPA_PTROFF(src, i * src_stride, void), size);
+}
+
+static void impl_convert_process(struct convert *conv, void * SPA_RESTRICT dst[],
+		const uint32_t dst_stride[], const void * SPA_RESTRICT src[],
+		const uint32_t src_stride[])
+{
+	const struct format_info *si = conv->src_info, *di = conv->dst_info;
+	const void *s[VIDEO_MAX_PLANES];
+	uint32_t ss[VIDEO_MAX_PLANES];
+	uint32_t i, y, width = conv->dst_width, height = conv->dst_height;
+
+	if (conv->is_scaling) {
+		/* scale in the source format, into the destination when
+		 * there is no conversion, else into the temp frame */
+		for (i = 0; i < si->n_planes; i++) {
+			void *d = conv->is_passthrough ? dst[i] : conv->tmp[i];
+			uint32_t ds = conv->is_passthrough ? dst_stride[i] : conv->tmp_stride[i];
+
+			conv->scale(conv, d, ds,
+					format_info_plane_width(si, i, conv->dst_width),
+					format_info_plane_height(si, i, conv->dst_height),
+					src[i], src_stride[i],
+					format_info_plane_width(si, i, conv->src_width),
+					format_info_plane_height(si, i, conv->src_height),
+					si->bpe[i]);
+			s[i] = d;
+			ss[i] = ds;
+		}
+		if (conv->is_passthrough)
+			return;
+	} else {
+		for (i = 0; i < si->n_planes; i++) {
+			s[i] = src[i];
+			ss[i] = src_stride[i];
+		}
+		if (conv->is_passthrough) {
+			for (i = 0; i < si->n_planes; i++)
+				copy_plane(dst[i], dst_stride[i], s[i], ss[i],
+						format_info_plane_width(si, i, width) * si->bpe[i],
+						format_info_plane_height(si, i, height));
+			return;
+		}
+	}
+
+	for (y = 0; y < height; y++) {
+		const void *sl[VIDEO_MAX_PLANES];
+		void *dl[VIDEO_MAX_PLANES];
+
+		for (i = 0; i < si->n_planes; i++)
+			sl[i] = SPA_PTROFF(s[i], (y >> si->ysub[i]) * ss[i], void);
+		for (i = 0; i < di->n_planes; i++)
+			dl[i] = (y & ((1u << di->ysub[i]) - 1)) ? NULL :
+				SPA_PTROFF(dst[i], (y >> di->ysub[i]) * dst_stride[i], void);
+
+		conv->convert(conv, dl, sl, width);
+	}
+}
+
+static void impl_convert_free(struct convert *conv)
+{
+	conv->process = NULL;
+	free(conv->data);
+	conv->data = NULL;
+}
+
+int convert_init(struct convert *conv)
+{
+	const struct conv_info *info = NULL;
+	const struct scale_info *sinfo = NULL;
+	uint32_t i, size, offset[VIDEO_MAX_PLANES];
+
+	conv->src_info = format_info_find(conv->src_fmt);
+	conv->dst_info = format_info_find(conv->dst_fmt);
+	if (conv->src_info == NULL || conv->dst_info == NULL)
+		return -ENOTSUP;
+
+	if (conv->src_width == 0 || conv->src_height == 0 ||
+	    conv->dst_width == 0 || conv->dst_height == 0)
+		return -EINVAL;
+
+	conv->minfo = find_matrix_info(conv->matrix);
+	conv->is_passthrough = conv->src_fmt == conv->dst_fmt;
+	conv->is_scaling = conv->src_width != conv->dst_width ||
+		conv->src_height != conv->dst_height;
+
+	if (!conv->is_passthrough) {
+		info = find_conv_info(conv->src_fmt, conv->dst_fmt, conv->cpu_flags);
+		if (info == NULL)
+			return -ENOTSUP;
+	}
+	conv->data = NULL;
+	if (conv->is_scaling) {
+		sinfo = find_scale_info(conv->cpu_flags);
+		if (sinfo == NULL)
+			return -ENOTSUP;
+
+		if (!conv->is_passthrough) {
+			/* scaled frame in the source format */
+			spa_zero(conv->tmp_stride);
+			size = format_info_layout(conv->src_info, conv->dst_width,
+					conv->dst_height, conv->tmp_stride, offset);
+			conv->data = calloc(VIDEO_OPS_MAX_ALIGN + size, 1);
+			if (conv->data == NULL)
+				return -errno;
+			for (i = 0; i < conv->src_info->n_planes; i++)
+				conv->tmp[i] = SPA_PTROFF(SPA_PTR_ALIGN(conv->data,
+						VIDEO_OPS_MAX_ALIGN, void), offset[i], void);
+		}
+	}
+
+	conv->convert = info ? info->process : NULL;
+	conv->func_name = info ? info->name : "copy";
+	conv->scale = sinfo ? sinfo->scale : NULL;
+	conv->scale_name = sinfo ? sinfo->name : "none";
+	conv->cpu_flags = info ? info->cpu_flags : 0;
+	conv->process = impl_convert_process;
+	conv->free = impl_convert_free;
+
+	return 0;
+}
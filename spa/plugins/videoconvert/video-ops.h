@@ -0,0 +1,158 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <spa/utils/defs.h>
+#include <spa/support/log.h>
+#include <spa/param/video/raw.h>
+
+#define VIDEO_OPS_MAX_ALIGN	32
+#define VIDEO_MAX_PLANES	3
+
+/* fixed point BT.601/BT.709 limited range coefficients. YUV to RGB uses
+ * 6 fractional bits and RGB to YUV uses 7 fractional bits so that all
+ * intermediate values fit in 16 bits and the SIMD versions are bit exact
+ * with the C versions. */
+#define YUV2RGB_SHIFT	6
+#define RGB2YUV_SHIFT	7
+
+struct matrix_info {
+	uint32_t matrix;
+	int16_t yuv2rgb[5];	/* y, rv, gu, gv, bu */
+	int16_t rgb2yuv[9];	/* yr, yg, yb, ur, ug, ub, vr, vg, vb */
+};
+
+struct format_info {
+	uint32_t format;
+	uint32_t n_planes;
+	/* bytes per element, an element covers 1 << xsub pixels */
+	uint8_t bpe[VIDEO_MAX_PLANES];
+	uint8_t xsub[VIDEO_MAX_PLANES];
+	uint8_t ysub[VIDEO_MAX_PLANES];
+};
+
+const struct format_info *format_info_find(uint32_t format);
+
+/* Fill the strides and offsets of the planes of a contiguous frame and
+ * return the size of the frame. */
+uint32_t format_info_layout(const struct format_info *info, uint32_t width,
+		uint32_t height, uint32_t stride[], uint32_t offset[]);
+
+static inline uint32_t format_info_plane_height(const struct format_info *info,
+		uint32_t plane, uint32_t height)
+{
+	return (height + (1u << info->ysub[plane]) - 1) >> info->ysub[plane];
+}
+
+static inline uint32_t format_info_plane_width(const struct format_info *info,
+		uint32_t plane, uint32_t width)
+{
+	return (width + (1u << info->xsub[plane]) - 1) >> info->xsub[plane];
+}
+
+struct convert {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t matrix;
+	uint32_t cpu_flags;
+	const char *func_name;
+	const char *scale_name;
+
+	struct spa_log *log;
+
+	unsigned int is_passthrough:1;
+	unsigned int is_scaling:1;
+
+	const struct format_info *src_info;
+	const struct format_info *dst_info;
+	const struct matrix_info *minfo;
+
+	/* convert one line of n_pixels. For 4:2:0 destinations dst[1..] is
+	 * NULL on lines that don't carry chroma. */
+	void (*convert) (struct convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], uint32_t n_pixels);
+	/* bilinear scale of one plane with elements of bpe bytes */
+	void (*scale) (struct convert *conv, void * SPA_RESTRICT dst, uint32_t dst_stride,
+			uint32_t dst_width, uint32_t dst_height,
+			const void * SPA_RESTRICT src, uint32_t src_stride,
+			uint32_t src_width, uint32_t src_height, uint32_t bpe);
+	/* convert and scale a complete frame */
+	void (*process) (struct convert *conv, void * SPA_RESTRICT dst[],
+			const uint32_t dst_stride[], const void * SPA_RESTRICT src[],
+			const uint32_t src_stride[]);
+	void (*free) (struct convert *conv);
+
+	void *data;
+	void *tmp[VIDEO_MAX_PLANES];
+	uint32_t tmp_stride[VIDEO_MAX_PLANES];
+};
+
+int convert_init(struct convert *conv);
+
+#define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define convert_free(conv)		(conv)->free(conv)
+
+#define DEFINE_FUNCTION(name,arch)						\
+void conv_##name##_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_pixels)
+
+DEFINE_FUNCTION(swap_rb, c);
+DEFINE_FUNCTION(i420_to_bgrx, c);
+DEFINE_FUNCTION(i420_to_rgbx, c);
+DEFINE_FUNCTION(nv12_to_bgrx, c);
+DEFINE_FUNCTION(nv12_to_rgbx, c);
+DEFINE_FUNCTION(yuy2_to_bgrx, c);
+DEFINE_FUNCTION(yuy2_to_rgbx, c);
+DEFINE_FUNCTION(bgrx_to_i420, c);
+DEFINE_FUNCTION(rgbx_to_i420, c);
+DEFINE_FUNCTION(bgrx_to_nv12, c);
+DEFINE_FUNCTION(rgbx_to_nv12, c);
+DEFINE_FUNCTION(bgrx_to_yuy2, c);
+DEFINE_FUNCTION(rgbx_to_yuy2, c);
+DEFINE_FUNCTION(i420_to_nv12, c);
+DEFINE_FUNCTION(nv12_to_i420, c);
+DEFINE_FUNCTION(i420_to_yuy2, c);
+DEFINE_FUNCTION(nv12_to_yuy2, c);
+DEFINE_FUNCTION(yuy2_to_i420, c);
+DEFINE_FUNCTION(yuy2_to_nv12, c);
+
+#if defined(HAVE_SSE2)
+DEFINE_FUNCTION(i420_to_bgrx, sse2);
+DEFINE_FUNCTION(i420_to_rgbx, sse2);
+DEFINE_FUNCTION(nv12_to_bgrx, sse2);
+DEFINE_FUNCTION(nv12_to_rgbx, sse2);
+DEFINE_FUNCTION(yuy2_to_bgrx, sse2);
+DEFINE_FUNCTION(yuy2_to_rgbx, sse2);
+DEFINE_FUNCTION(bgrx_to_i420, sse2);
+DEFINE_FUNCTION(rgbx_to_i420, sse2);
+DEFINE_FUNCTION(bgrx_to_nv12, sse2);
+DEFINE_FUNCTION(rgbx_to_nv12, sse2);
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(i420_to_bgrx, avx2);
+DEFINE_FUNCTION(i420_to_rgbx, avx2);
+DEFINE_FUNCTION(nv12_to_bgrx, avx2);
+DEFINE_FUNCTION(nv12_to_rgbx, avx2);
+DEFINE_FUNCTION(yuy2_to_bgrx, avx2);
+DEFINE_FUNCTION(yuy2_to_rgbx, avx2);
+DEFINE_FUNCTION(bgrx_to_i420, avx2);
+DEFINE_FUNCTION(rgbx_to_i420, avx2);
+DEFINE_FUNCTION(bgrx_to_nv12, avx2);
+DEFINE_FUNCTION(rgbx_to_nv12, avx2);
+#endif
+
+#undef DEFINE_FUNCTION
+
+#define DEFINE_SCALE_FUNCTION(name,arch)					\
+void scale_##name##_##arch(struct convert *conv, void * SPA_RESTRICT dst,	\
+		uint32_t dst_stride, uint32_t dst_width, uint32_t dst_height,	\
+		const void * SPA_RESTRICT src, uint32_t src_stride,		\
+		uint32_t src_width, uint32_t src_height, uint32_t bpe)
+
+DEFINE_SCALE_FUNCTION(bilinear, c);
+
+#undef DEFINE_SCALE_FUNCTION
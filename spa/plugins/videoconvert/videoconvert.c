@@ -0,0 +1,990 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/log.h>
+#include <spa/support/cpu.h>
+#include <spa/utils/list.h>
+#include <spa/utils/keys.h>
+#include <spa/utils/names.h>
+#include <spa/utils/string.h>
+#include <spa/utils/result.h>
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/node/io.h>
+#include <spa/node/keys.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/video/type-info.h>
+#include <spa/param/param.h>
+#include <spa/param/port-config.h>
+#include <spa/pod/filter.h>
+#include <spa/debug/types.h>
+
+#include "video-ops.h"
+
+#undef SPA_LOG_TOPIC_DEFAULT
+#define SPA_LOG_TOPIC_DEFAULT &log_topic
+SPA_LOG_TOPIC_DEFINE_STATIC(log_topic, "spa.videoconvert");
+
+#define MAX_BUFFERS	32
+
+static const uint32_t supported_formats[] = {
+	SPA_VIDEO_FORMAT_I420,
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_YUY2,
+	SPA_VIDEO_FORMAT_BGRx,
+	SPA_VIDEO_FORMAT_RGBx,
+};
+
+struct buffer {
+	uint32_t id;
+#define BUFFER_FLAG_OUT (1<<0)
+	uint32_t flags;
+	struct spa_buffer *outbuf;
+	struct spa_meta_header *h;
+	struct spa_list link;
+};
+
+struct port {
+	uint64_t info_all;
+	struct spa_port_info info;
+
+	enum spa_direction direction;
+#define IDX_EnumFormat	0
+#define IDX_Meta	1
+#define IDX_IO		2
+#define IDX_Format	3
+#define IDX_Buffer	4
+#define N_PORT_PARAMS	5
+	struct spa_param_info params[N_PORT_PARAMS];
+
+	struct spa_io_buffers *io;
+
+	bool have_format;
+	struct spa_video_info_raw format;
+	const struct format_info *finfo;
+	uint32_t stride[VIDEO_MAX_PLANES];
+	uint32_t offset[VIDEO_MAX_PLANES];
+	uint32_t size;
+
+	struct buffer buffers[MAX_BUFFERS];
+	uint32_t n_buffers;
+
+	struct spa_list empty;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_node node;
+
+	struct spa_log *log;
+	struct spa_cpu *cpu;
+	uint32_t cpu_flags;
+
+	uint64_t info_all;
+	struct spa_node_info info;
+#define IDX_PortConfig	0
+#define N_NODE_PARAMS	1
+	struct spa_param_info params[N_NODE_PARAMS];
+
+	struct spa_hook_list hooks;
+	struct spa_callbacks callbacks;
+
+	bool started;
+	enum spa_param_port_config_mode mode;
+
+	struct port port[2];
+
+	struct convert conv;
+};
+
+#define CHECK_PORT(this,d,p)  ((p) == 0)
+#define GET_PORT(this,d)      (&(this)->port[d])
+#define GET_OTHER_PORT(this,d) (&(this)->port[SPA_DIRECTION_REVERSE(d)])
+
+static int impl_node_enum_params(void *object, int seq,
+				 uint32_t id, uint32_t start, uint32_t num,
+				 const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_PortConfig:
+		if (result.index > 1)
+			return 0;
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamPortConfig, id,
+			SPA_PARAM_PORT_CONFIG_direction, SPA_POD_Id(result.index == 0 ?
+				SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT),
+			SPA_PARAM_PORT_CONFIG_mode,      SPA_POD_Id(this->mode));
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return -ENOTSUP;
+}
+
+static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
+			       const struct spa_pod *param)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	switch (id) {
+	case SPA_PARAM_PortConfig:
+	{
+		enum spa_direction direction;
+		enum spa_param_port_config_mode mode;
+
+		if (param == NULL)
+			return 0;
+		if (spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_ParamPortConfig, NULL,
+				SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(&direction),
+				SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(&mode)) < 0)
+			return -EINVAL;
+
+		/* we only have one port in each direction, there is nothing
+		 * to split or merge */
+		switch (mode) {
+		case SPA_PARAM_PORT_CONFIG_MODE_none:
+		case SPA_PARAM_PORT_CONFIG_MODE_passthrough:
+		case SPA_PARAM_PORT_CONFIG_MODE_convert:
+			break;
+		default:
+			return -ENOTSUP;
+		}
+		this->mode = mode;
+		this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+		this->params[IDX_PortConfig].flags ^= SPA_PARAM_INFO_SERIAL;
+		break;
+	}
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static inline void reuse_buffer(struct impl *this, struct port *port, uint32_t id)
+{
+	struct buffer *b = &port->buffers[id];
+
+	if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUT)) {
+		spa_log_trace_fp(this->log, "%p: reuse buffer %d", this, id);
+
+		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUT);
+		spa_list_append(&port->empty, &b->link);
+	}
+}
+
+static int impl_node_send_command(void *object, const struct spa_command *command)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(command != NULL, -EINVAL);
+
+	switch (SPA_NODE_COMMAND_ID(command)) {
+	case SPA_NODE_COMMAND_Start:
+		this->started = true;
+		break;
+	case SPA_NODE_COMMAND_Suspend:
+	case SPA_NODE_COMMAND_Pause:
+		this->started = false;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+static const struct spa_dict_item node_info_items[] = {
+	{ SPA_KEY_MEDIA_CLASS, "Video/Filter" },
+};
+
+static void emit_node_info(struct impl *this, bool full)
+{
+	uint64_t old = full ? this->info.change_mask : 0;
+	if (full)
+		this->info.change_mask = this->info_all;
+	if (this->info.change_mask) {
+		this->info.props = &SPA_DICT_INIT_ARRAY(node_info_items);
+		spa_node_emit_info(&this->hooks, &this->info);
+		this->info.change_mask = old;
+	}
+}
+
+static void emit_port_info(struct impl *this, struct port *port, bool full)
+{
+	uint64_t old = full ? port->info.change_mask : 0;
+	if (full)
+		port->info.change_mask = port->info_all;
+	if (port->info.change_mask) {
+		spa_node_emit_port_info(&this->hooks,
+				port->direction, 0, &port->info);
+		port->info.change_mask = old;
+	}
+}
+
+static int
+impl_node_add_listener(void *object,
+		struct spa_hook *listener,
+		const struct spa_node_events *events,
+		void *data)
+{
+	struct impl *this = object;
+	struct spa_hook_list save;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_hook_list_isolate(&this->hooks, &save, listener, events, data);
+
+	emit_node_info(this, true);
+	emit_port_info(this, GET_PORT(this, SPA_DIRECTION_INPUT), true);
+	emit_port_info(this, GET_PORT(this, SPA_DIRECTION_OUTPUT), true);
+
+	spa_hook_list_join(&this->hooks, &save);
+
+	return 0;
+}
+
+static int
+impl_node_set_callbacks(void *object,
+			const struct spa_node_callbacks *callbacks,
+			void *data)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	this->callbacks = SPA_CALLBACKS_INIT(callbacks, data);
+
+	return 0;
+}
+
+static int impl_node_add_port(void *object, enum spa_direction direction, uint32_t port_id,
+		const struct spa_dict *props)
+{
+	return -ENOTSUP;
+}
+
+static int
+impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_id)
+{
+	return -ENOTSUP;
+}
+
+static int port_enum_formats(struct impl *this, enum spa_direction direction,
+		uint32_t index, struct spa_pod **param, struct spa_pod_builder *b)
+{
+	struct port *other = GET_OTHER_PORT(this, direction);
+	struct spa_pod_frame f[2];
+	struct spa_rectangle size = SPA_RECTANGLE(320, 240);
+	uint32_t i, preferred = SPA_VIDEO_FORMAT_BGRx;
+
+	if (index > 0)
+		return 0;
+
+	/* prefer the format and size of the other port so that we can
+	 * run in passthrough when possible */
+	if (other->have_format) {
+		preferred = other->format.format;
+		size = other->format.size;
+	}
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+		SPA_FORMAT_mediaType,    SPA_POD_Id(SPA_MEDIA_TYPE_video),
+		SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+		0);
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_format, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_id(b, preferred);
+	for (i = 0; i < SPA_N_ELEMENTS(supported_formats); i++)
+		spa_pod_builder_id(b, supported_formats[i]);
+	spa_pod_builder_pop(b, &f[1]);
+	spa_pod_builder_add(b,
+		SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle(
+			&size,
+			&SPA_RECTANGLE(1, 1),
+			&SPA_RECTANGLE(INT32_MAX, INT32_MAX)),
+		0);
+	if (other->have_format)
+		spa_pod_builder_add(b,
+			SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&other->format.framerate),
+			0);
+	else
+		spa_pod_builder_add(b,
+			SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+				&SPA_FRACTION(25, 1),
+				&SPA_FRACTION(0, 1),
+				&SPA_FRACTION(INT32_MAX, 1)),
+			0);
+	*param = spa_pod_builder_pop(b, &f[0]);
+	return 1;
+}
+
+static int
+impl_node_port_enum_params(void *object, int seq,
+			enum spa_direction direction, uint32_t port_id,
+			uint32_t id, uint32_t start, uint32_t num,
+			const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct port *port;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+	port = GET_PORT(this, direction);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumFormat:
+		if ((res = port_enum_formats(this, direction, result.index, &param, &b)) <= 0)
+			return res;
+		break;
+
+	case SPA_PARAM_Format:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+		param = spa_format_video_raw_build(&b, id, &port->format);
+		break;
+
+	case SPA_PARAM_Buffers:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, id,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->size),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->stride[0]));
+		break;
+
+	case SPA_PARAM_Meta:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	case SPA_PARAM_IO:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id,   SPA_POD_Id(SPA_IO_Buffers),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int clear_buffers(struct impl *this, struct port *port)
+{
+	if (port->n_buffers > 0) {
+		spa_log_debug(this->log, "%p: clear buffers", this);
+		port->n_buffers = 0;
+		spa_list_init(&port->empty);
+	}
+	return 0;
+}
+
+static const char *format_name(uint32_t format)
+{
+	return spa_debug_type_find_short_name(spa_type_video_format, format);
+}
+
+static int setup_convert(struct impl *this)
+{
+	struct port *in = GET_PORT(this, SPA_DIRECTION_INPUT);
+	struct port *out = GET_PORT(this, SPA_DIRECTION_OUTPUT);
+	int res;
+
+	if (this->conv.process)
+		convert_free(&this->conv);
+
+	if (!in->have_format || !out->have_format)
+		return 0;
+
+	this->conv.src_fmt = in->format.format;
+	this->conv.dst_fmt = out->format.format;
+	this->conv.src_width = in->format.size.width;
+	this->conv.src_height = in->format.size.height;
+	this->conv.dst_width = out->format.size.width;
+	this->conv.dst_height = out->format.size.height;
+	this->conv.matrix = in->format.color_matrix;
+	this->conv.cpu_flags = this->cpu_flags;
+	this->conv.log = this->log;
+
+	if ((res = convert_init(&this->conv)) < 0) {
+		spa_log_error(this->log, "%p: can't convert %s/%ux%u to %s/%ux%u: %s",
+				this, format_name(this->conv.src_fmt),
+				this->conv.src_width, this->conv.src_height,
+				format_name(this->conv.dst_fmt),
+				this->conv.dst_width, this->conv.dst_height,
+				spa_strerror(res));
+		return res;
+	}
+	spa_log_info(this->log, "%p: %s/%ux%u -> %s/%ux%u using %s and %s (cpu:%08x)",
+			this, format_name(this->conv.src_fmt),
+			this->conv.src_width, this->conv.src_height,
+			format_name(this->conv.dst_fmt),
+			this->conv.dst_width, this->conv.dst_height,
+			this->conv.func_name, this->conv.scale_name,
+			this->conv.cpu_flags);
+	return 0;
+}
+
+static int port_set_format(struct impl *this, struct port *port,
+			   uint32_t flags, const struct spa_pod *format)
+{
+	int res;
+
+	if (format == NULL) {
+		port->have_format = false;
+		clear_buffers(this, port);
+		setup_convert(this);
+	} else {
+		struct spa_video_info info = { 0 };
+		const struct format_info *finfo;
+
+		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0)
+			return res;
+
+		if (info.media_type != SPA_MEDIA_TYPE_video ||
+		    info.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+			return -EINVAL;
+
+		if (spa_format_video_raw_parse(format, &info.info.raw) < 0)
+			return -EINVAL;
+
+		if ((finfo = format_info_find(info.info.raw.format)) == NULL)
+			return -ENOTSUP;
+		if (info.info.raw.size.width == 0 || info.info.raw.size.height == 0)
+			return -EINVAL;
+
+		port->format = info.info.raw;
+		port->finfo = finfo;
+		spa_zero(port->stride);
+		port->size = format_info_layout(finfo, port->format.size.width,
+				port->format.size.height, port->stride, port->offset);
+		port->have_format = true;
+
+		if ((res = setup_convert(this)) < 0) {
+			port->have_format = false;
+			return res;
+		}
+	}
+
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	if (port->have_format) {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
+		port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	} else {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+		port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	}
+	emit_port_info(this, port, false);
+
+	return 0;
+}
+
+static int
+impl_node_port_set_param(void *object,
+			 enum spa_direction direction, uint32_t port_id,
+			 uint32_t id, uint32_t flags,
+			 const struct spa_pod *param)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	switch (id) {
+	case SPA_PARAM_Format:
+		return port_set_format(this, GET_PORT(this, direction), flags, param);
+	default:
+		return -ENOENT;
+	}
+}
+
+/* check that the planes we write in process fit in the memory of an
+ * output buffer, planes are either in separate datas or packed in the
+ * first data. */
+static int check_output_planes(struct port *port, struct spa_buffer *buf)
+{
+	const struct format_info *finfo = port->finfo;
+	struct spa_data *d = buf->datas;
+	uint32_t i, size;
+	bool separate = finfo->n_planes > 1 && buf->n_datas >= finfo->n_planes;
+
+	for (i = 0; i < finfo->n_planes; i++) {
+		size = port->stride[i] * format_info_plane_height(finfo, i,
+				port->format.size.height);
+		if (separate ? size > d[i].maxsize :
+		    port->offset[i] + size > d[0].maxsize)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static int
+impl_node_port_use_buffers(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   struct spa_buffer **buffers,
+			   uint32_t n_buffers)
+{
+	struct impl *this = object;
+	struct port *port;
+	uint32_t i, j;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+	port = GET_PORT(this, direction);
+
+	clear_buffers(this, port);
+
+	if (n_buffers > 0 && !port->have_format)
+		return -EIO;
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b = &port->buffers[i];
+		struct spa_data *d = buffers[i]->datas;
+		uint32_t n_datas = buffers[i]->n_datas;
+
+		if (n_datas == 0) {
+			spa_log_error(this->log, "%p: invalid blocks %d on buffer %d",
+					this, n_datas, i);
+			return -EINVAL;
+		}
+		for (j = 0; j < n_datas; j++) {
+			if (d[j].data == NULL) {
+				spa_log_error(this->log, "%p: invalid memory %d on buffer %d %d %p",
+						this, j, i, d[j].type, d[j].data);
+				return -EINVAL;
+			}
+		}
+		if (direction == SPA_DIRECTION_OUTPUT &&
+		    check_output_planes(port, buffers[i]) < 0) {
+			spa_log_error(this->log, "%p: buffer %d too small for %dx%d frames",
+					this, i, port->format.size.width,
+					port->format.size.height);
+			return -EINVAL;
+		}
+		b->id = i;
+		b->outbuf = buffers[i];
+		b->flags = 0;
+		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+
+		if (direction == SPA_DIRECTION_OUTPUT)
+			spa_list_append(&port->empty, &b->link);
+	}
+	port->n_buffers = n_buffers;
+
+	return 0;
+}
+
+static int
+impl_node_port_set_io(void *object,
+		      enum spa_direction direction,
+		      uint32_t port_id,
+		      uint32_t id,
+		      void *data, size_t size)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+	port = GET_PORT(this, direction);
+
+	switch (id) {
+	case SPA_IO_Buffers:
+		port->io = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(port_id == 0, -EINVAL);
+
+	port = GET_PORT(this, SPA_DIRECTION_OUTPUT);
+	spa_return_val_if_fail(buffer_id < port->n_buffers, -EINVAL);
+
+	reuse_buffer(this, port, buffer_id);
+
+	return 0;
+}
+
+/* get the plane pointers and strides of a buffer, planes are either in
+ * separate datas or packed in the first data. */
+static int get_planes(struct port *port, struct buffer *b,
+		void *data[], uint32_t stride[])
+{
+	const struct format_info *finfo = port->finfo;
+	struct spa_data *d = b->outbuf->datas;
+	uint32_t i, offset[VIDEO_MAX_PLANES], size, offs;
+
+	if (b->outbuf->n_datas >= finfo->n_planes && finfo->n_planes > 1) {
+		for (i = 0; i < finfo->n_planes; i++) {
+			offs = SPA_MIN(d[i].chunk->offset, d[i].maxsize);
+			data[i] = SPA_PTROFF(d[i].data, offs, void);
+			stride[i] = d[i].chunk->stride > 0 ?
+				(uint32_t)d[i].chunk->stride : port->stride[i];
+			if (offs + stride[i] * format_info_plane_height(finfo, i,
+						port->format.size.height) > d[i].maxsize)
+				return -ENOSPC;
+		}
+		return 0;
+	}
+
+	stride[0] = d[0].chunk->stride > 0 ? (uint32_t)d[0].chunk->stride : 0;
+	size = format_info_layout(finfo, port->format.size.width,
+			port->format.size.height, stride, offset);
+	offs = SPA_MIN(d[0].chunk->offset, d[0].maxsize);
+	if (offs + size > d[0].maxsize)
+		return -ENOSPC;
+
+	for (i = 0; i < finfo->n_planes; i++)
+		data[i] = SPA_PTROFF(d[0].data, offs + offset[i], void);
+	return 0;
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+	struct port *inport, *outport;
+	struct spa_io_buffers *inio, *outio;
+	struct buffer *ib, *ob;
+	void *src[VIDEO_MAX_PLANES], *dst[VIDEO_MAX_PLANES];
+	uint32_t i, src_stride[VIDEO_MAX_PLANES], dst_stride[VIDEO_MAX_PLANES];
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	inport = GET_PORT(this, SPA_DIRECTION_INPUT);
+	outport = GET_PORT(this, SPA_DIRECTION_OUTPUT);
+	if ((inio = inport->io) == NULL || (outio = outport->io) == NULL)
+		return -EIO;
+
+	if (outio->status == SPA_STATUS_HAVE_DATA)
+		return SPA_STATUS_HAVE_DATA;
+
+	if (outio->buffer_id < outport->n_buffers) {
+		reuse_buffer(this, outport, outio->buffer_id);
+		outio->buffer_id = SPA_ID_INVALID;
+	}
+
+	if (inio->status != SPA_STATUS_HAVE_DATA)
+		return inio->status;
+
+	if (inio->buffer_id >= inport->n_buffers) {
+		inio->status = -EINVAL;
+		return -EINVAL;
+	}
+	if (this->conv.process == NULL)
+		return -EIO;
+
+	if (spa_list_is_empty(&outport->empty)) {
+		spa_log_debug(this->log, "%p: out of buffers", this);
+		return -EPIPE;
+	}
+
+	ib = &inport->buffers[inio->buffer_id];
+	inio->status = SPA_STATUS_NEED_DATA;
+
+	if ((res = get_planes(inport, ib, src, src_stride)) < 0) {
+		spa_log_warn(this->log, "%p: invalid input buffer %d: %s",
+				this, ib->id, spa_strerror(res));
+		return SPA_STATUS_NEED_DATA;
+	}
+
+	ob = spa_list_first(&outport->empty, struct buffer, link);
+	spa_list_remove(&ob->link);
+	SPA_FLAG_SET(ob->flags, BUFFER_FLAG_OUT);
+
+	if (outport->finfo->n_planes > 1 &&
+	    ob->outbuf->n_datas >= outport->finfo->n_planes) {
+		for (i = 0; i < outport->finfo->n_planes; i++) {
+			struct spa_data *d = &ob->outbuf->datas[i];
+			dst[i] = d->data;
+			dst_stride[i] = outport->stride[i];
+			d->chunk->offset = 0;
+			d->chunk->size = dst_stride[i] * format_info_plane_height(
+					outport->finfo, i, outport->format.size.height);
+			d->chunk->stride = dst_stride[i];
+		}
+	} else {
+		struct spa_data *d = &ob->outbuf->datas[0];
+		for (i = 0; i < outport->finfo->n_planes; i++) {
+			dst[i] = SPA_PTROFF(d->data, outport->offset[i], void);
+			dst_stride[i] = outport->stride[i];
+		}
+		d->chunk->offset = 0;
+		d->chunk->size = outport->size;
+		d->chunk->stride = outport->stride[0];
+	}
+
+	convert_process(&this->conv, dst, dst_stride, (const void **)src, src_stride);
+
+	if (ib->h && ob->h)
+		*ob->h = *ib->h;
+
+	outio->buffer_id = ob->id;
+	outio->status = SPA_STATUS_HAVE_DATA;
+
+	return SPA_STATUS_NEED_DATA | SPA_STATUS_HAVE_DATA;
+}
+
+static const struct spa_node_methods impl_node = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = impl_node_add_listener,
+	.set_callbacks = impl_node_set_callbacks,
+	.enum_params = impl_node_enum_params,
+	.set_param = impl_node_set_param,
+	.set_io = impl_node_set_io,
+	.send_command = impl_node_send_command,
+	.add_port = impl_node_add_port,
+	.remove_port = impl_node_remove_port,
+	.port_enum_params = impl_node_port_enum_params,
+	.port_set_param = impl_node_port_set_param,
+	.port_use_buffers = impl_node_port_use_buffers,
+	.port_set_io = impl_node_port_set_io,
+	.port_reuse_buffer = impl_node_port_reuse_buffer,
+	.process = impl_node_process,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (spa_streq(type, SPA_TYPE_INTERFACE_Node))
+		*interface = &this->node;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (this->conv.process)
+		convert_free(&this->conv);
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static void init_port(struct impl *this, enum spa_direction direction)
+{
+	struct port *port = GET_PORT(this, direction);
+
+	port->direction = direction;
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
+			SPA_PORT_CHANGE_MASK_PARAMS;
+	port->info = SPA_PORT_INFO_INIT();
+	port->info.flags = SPA_PORT_FLAG_NO_REF;
+	port->params[IDX_EnumFormat] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[IDX_Meta] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[IDX_IO] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_Buffer] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->info.params = port->params;
+	port->info.n_params = N_PORT_PARAMS;
+	spa_list_init(&port->empty);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	this = (struct impl *) handle;
+
+	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	spa_log_topic_init(this->log, &log_topic);
+
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
+
+	spa_hook_list_init(&this->hooks);
+
+	this->node.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE,
+			&impl_node, this);
+
+	this->mode = SPA_PARAM_PORT_CONFIG_MODE_convert;
+
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS |
+			SPA_NODE_CHANGE_MASK_PROPS |
+			SPA_NODE_CHANGE_MASK_PARAMS;
+	this->info = SPA_NODE_INFO_INIT();
+	this->info.max_output_ports = 1;
+	this->info.max_input_ports = 1;
+	this->info.flags = SPA_NODE_FLAG_RT;
+	this->params[IDX_PortConfig] = SPA_PARAM_INFO(SPA_PARAM_PortConfig, SPA_PARAM_INFO_READWRITE);
+	this->info.params = this->params;
+	this->info.n_params = N_NODE_PARAMS;
+
+	init_port(this, SPA_DIRECTION_INPUT);
+	init_port(this, SPA_DIRECTION_OUTPUT);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_Node,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	switch (*index) {
+	case 0:
+		*info = &impl_interfaces[*index];
+		break;
+	default:
+		return 0;
+	}
+	(*index)++;
+	return 1;
+}
+
+static const struct spa_dict_item info_items[] = {
+	{ SPA_KEY_FACTORY_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
+	{ SPA_KEY_FACTORY_DESCRIPTION, "Convert and scale raw video frames" },
+};
+
+static const struct spa_dict info = SPA_DICT_INIT_ARRAY(info_items);
+
+const struct spa_handle_factory spa_videoconvert_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_VIDEO_CONVERT,
+	&info,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info,
+};
@@ -80,8 +80,10 @@ struct impl {
 	struct spa_node_info info;
 #define IDX_PropInfo	0
 #define IDX_Props	1
-#define N_NODE_PARAMS	2
+#define IDX_PortConfig	2
+#define N_NODE_PARAMS	3
 	struct spa_param_info params[N_NODE_PARAMS];
+	enum spa_param_port_config_mode mode;
 
 	struct spa_hook_list hooks;
 	struct spa_callbacks callbacks;
@@ -141,6 +143,15 @@ static int impl_node_enum_params(void *object, int seq,
 	spa_pod_builder_init(&b, buffer, sizeof(buffer));
 
 	switch (id) {
+	case SPA_PARAM_PortConfig:
+		if (result.index > 1)
+			return 0;
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamPortConfig, id,
+			SPA_PARAM_PORT_CONFIG_direction, SPA_POD_Id(result.index == 0 ?
+				SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT),
+			SPA_PARAM_PORT_CONFIG_mode,      SPA_POD_Id(this->mode));
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -181,6 +192,36 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
 	switch (id) {
+	case SPA_PARAM_PortConfig:
+	{
+		enum spa_direction direction;
+		enum spa_param_port_config_mode mode;
+
+		if (param == NULL)
+			return 0;
+		if (spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_ParamPortConfig, NULL,
+				SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(&direction),
+				SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(&mode)) < 0)
+			return -EINVAL;
+
+		/* we only have one port in each direction, there is nothing
+		 * to split or merge. This makes the filter usable as the
+		 * converter of a videoadapter. */
+		switch (mode) {
+		case SPA_PARAM_PORT_CONFIG_MODE_none:
+		case SPA_PARAM_PORT_CONFIG_MODE_passthrough:
+		case SPA_PARAM_PORT_CONFIG_MODE_convert:
+		case SPA_PARAM_PORT_CONFIG_MODE_dsp:
+			break;
+		default:
+			return -ENOTSUP;
+		}
+		this->mode = mode;
+		this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+		this->params[IDX_PortConfig].flags ^= SPA_PARAM_INFO_SERIAL;
+		break;
+	}
 	default:
 		return -ENOENT;
 	}
@@ -961,8 +1002,10 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.max_output_ports = 1;
 	this->info.max_input_ports = 1;
 	this->info.flags = SPA_NODE_FLAG_RT;
+	this->mode = SPA_PARAM_PORT_CONFIG_MODE_convert;
 	this->params[IDX_PropInfo] = SPA_PARAM_INFO(SPA_PARAM_PropInfo, SPA_PARAM_INFO_READ);
 	this->params[IDX_Props] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
+	this->params[IDX_PortConfig] = SPA_PARAM_INFO(SPA_PARAM_PortConfig, SPA_PARAM_INFO_READWRITE);
 	this->info.params = this->params;
 	this->info.n_params = N_NODE_PARAMS;
 
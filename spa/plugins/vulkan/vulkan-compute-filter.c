@@ -304,6 +304,12 @@ static int port_enum_formats(void *object,
 	}
 }
 
+/* the input can wait for the producer on the GPU with explicit sync */
+static bool port_explicit_sync(struct impl *this, enum spa_direction direction)
+{
+	return direction == SPA_DIRECTION_INPUT && this->state.base.explicit_sync;
+}
+
 static int
 impl_node_port_enum_params(void *object, int seq,
 			enum spa_direction direction, uint32_t port_id,
@@ -350,11 +356,15 @@ impl_node_port_enum_params(void *object, int seq,
 
 	case SPA_PARAM_Buffers:
 	{
+		bool explicit_sync;
+
 		if (!port->have_format)
 			return -EIO;
 		if (this->position == NULL)
 			return -EIO;
-		if (result.index > 0)
+		explicit_sync = port_explicit_sync(this, direction) &&
+			(port->current_format.info.dsp.flags & SPA_VIDEO_FLAG_MODIFIER);
+		if (result.index > (explicit_sync ? 1u : 0u))
 			return 0;
 
 		spa_log_debug(this->log, "%p: %dx%d stride %d", this,
@@ -365,6 +375,16 @@ impl_node_port_enum_params(void *object, int seq,
 		if (port->current_format.info.dsp.flags & SPA_VIDEO_FLAG_MODIFIER) {
 			struct vulkan_modifier_info *mod_info = spa_vulkan_compute_get_modifier_info(&this->state,
 				&port->current_format.info.dsp);
+			if (explicit_sync && result.index == 0) {
+				/* the planes followed by the acquire and release syncobj */
+				param = spa_pod_builder_add_object(&b,
+					SPA_TYPE_OBJECT_ParamBuffers, id,
+					SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
+					SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(mod_info->props.drmFormatModifierPlaneCount + 2),
+					SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(1<<SPA_DATA_DmaBuf),
+					SPA_PARAM_BUFFERS_metaType, SPA_POD_Int(1<<SPA_META_SyncTimeline));
+				break;
+			}
 			param = spa_pod_builder_add_object(&b,
 				SPA_TYPE_OBJECT_ParamBuffers, id,
 				SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
@@ -391,7 +411,14 @@ impl_node_port_enum_params(void *object, int seq,
 				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
 				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
 			break;
-
+		case 1:
+			if (!port_explicit_sync(this, direction))
+				return 0;
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_SyncTimeline),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_sync_timeline)));
+			break;
 		default:
 			return 0;
 		}
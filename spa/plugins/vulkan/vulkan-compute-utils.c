@@ -227,9 +227,23 @@ static int createComputePipeline(struct vulkan_compute_state *s, const char *sha
 		.stage = shaderStageCreateInfo,
 		.layout = s->pipelineLayout,
 	};
-	VK_CHECK_RESULT(vkCreateComputePipelines(s->base.device, VK_NULL_HANDLE,
+	/* the pipeline cache is saved on disk so that the shader doesn't need
+	 * to be compiled again for the next node that uses it */
+	const char *cache_name = strrchr(shader_file, '/');
+	cache_name = cache_name ? cache_name + 1 : shader_file;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	if (vulkan_pipelineCache_create(&s->base, cache_name, &pipelineCache) < 0)
+		pipelineCache = VK_NULL_HANDLE;
+
+	VkResult result = vkCreateComputePipelines(s->base.device, pipelineCache,
 				1, &pipelineCreateInfo, NULL,
-				&s->pipeline));
+				&s->pipeline);
+	if (pipelineCache != VK_NULL_HANDLE) {
+		if (result == VK_SUCCESS)
+			vulkan_pipelineCache_save(&s->base, cache_name, pipelineCache);
+		vkDestroyPipelineCache(s->base.device, pipelineCache, NULL);
+	}
+	VK_CHECK_RESULT(result);
 	return 0;
 }
 
@@ -335,8 +349,9 @@ static int runCommandBuffer(struct vulkan_compute_state *s)
 	VkImageMemoryBarrier release_barrier[s->n_streams];
 	VkSemaphoreSubmitInfo semaphore_wait_info[s->n_streams];
 	uint32_t semaphore_wait_info_len = 0;
-	VkSemaphoreSubmitInfo semaphore_signal_info[1];
+	VkSemaphoreSubmitInfo semaphore_signal_info[s->n_streams + 1];
 	uint32_t semaphore_signal_info_len = 0;
+	bool explicit_sync[s->n_streams];
 
 	uint32_t i;
 	for (i = 0; i < s->n_streams; i++) {
@@ -379,9 +394,21 @@ static int runCommandBuffer(struct vulkan_compute_state *s)
 			.subresourceRange.layerCount = 1,
 		};
 
+		explicit_sync[i] = false;
 		if (current_spa_buffer->datas[0].type != SPA_DATA_DmaBuf)
 			continue;
 
+		/* wait for the acquire point and signal the release point on the
+		 * GPU instead of going through the implicit DMA-BUF fences */
+		if (vulkan_buffer_sync_timeline(current_buffer, current_spa_buffer,
+					&semaphore_wait_info[semaphore_wait_info_len],
+					&semaphore_signal_info[semaphore_signal_info_len])) {
+			semaphore_wait_info_len++;
+			semaphore_signal_info_len++;
+			explicit_sync[i] = true;
+			continue;
+		}
+
 		if (vulkan_sync_foreign_dmabuf(&s->base, current_buffer) < 0) {
 			spa_log_warn(s->log, "Failed to wait for foreign buffer DMA-BUF fence");
 		} else {
@@ -458,7 +485,7 @@ static int runCommandBuffer(struct vulkan_compute_state *s)
 		struct vulkan_stream *p = &s->streams[i];
 		struct spa_buffer *current_spa_buffer = p->spa_buffers[p->current_buffer_id];
 
-		if (current_spa_buffer->datas[0].type != SPA_DATA_DmaBuf)
+		if (current_spa_buffer->datas[0].type != SPA_DATA_DmaBuf || explicit_sync[i])
 			continue;
 
 		if (!vulkan_sync_export_dmabuf(&s->base, &p->buffers[p->current_buffer_id], sync_file_fd)) {
@@ -563,8 +590,12 @@ int spa_vulkan_compute_use_buffers(struct vulkan_compute_state *s, struct vulkan
 					.spa_buf = buffers[i],
 				};
 				struct vulkan_modifier_info *modifierInfo = vulkan_modifierInfo_find(&s->formatInfos, format, dsp_info->modifier);
-				CHECK(vulkan_validate_dmabuf_properties(modifierInfo, &dmabufInfo.spa_buf->n_datas, &dmabufInfo.size));
+				uint32_t planeCount = vulkan_buffer_plane_count(buffers[i]);
+				CHECK(vulkan_validate_dmabuf_properties(modifierInfo, &planeCount, &dmabufInfo.size));
 				ret = vulkan_import_dmabuf(&s->base, &dmabufInfo, &p->buffers[i]);
+				if (ret == 0 && p->direction == SPA_DIRECTION_INPUT &&
+				    vulkan_buffer_import_sync_timeline(&s->base, &p->buffers[i], buffers[i]) < 0)
+					spa_log_warn(s->log, "Failed to import explicit sync timeline of buffer %d", i);
 				break;
 			case SPA_DATA_MemPtr:;
 				struct external_buffer_info memptrInfo = {
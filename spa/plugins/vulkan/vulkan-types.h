@@ -38,6 +38,8 @@ struct vulkan_buffer {
 	VkImageView view;
 	VkDeviceMemory memory;
 	VkSemaphore foreign_semaphore;
+	VkSemaphore acquire_semaphore;
+	VkSemaphore release_semaphore;
 };
 
 struct vulkan_staging_buffer {
@@ -61,6 +63,7 @@ struct vulkan_base {
 	VkDevice device;
 
 	bool implicit_sync_interop;
+	bool explicit_sync;
 
 	unsigned int initialized:1;
 };
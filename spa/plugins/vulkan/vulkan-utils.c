@@ -19,6 +19,8 @@
 #include <assert.h>
 #include <math.h>
 #include <time.h>
+#include <limits.h>
+#include <stdlib.h>
 
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
@@ -26,6 +28,8 @@
 #include <spa/support/log.h>
 #include <spa/debug/mem.h>
 
+#include <spa-private/cache-dir.h>
+
 #include "vulkan-utils.h"
 #include "dmabuf.h"
 
@@ -198,6 +202,23 @@ static int getComputeQueueFamilyIndex(struct vulkan_base *s, uint32_t queueFlags
 	return 0;
 }
 
+static bool hasDeviceExtension(struct vulkan_base *s, const char *name)
+{
+	VkExtensionProperties *props;
+	uint32_t i, count = 0;
+
+	if (vkEnumerateDeviceExtensionProperties(s->physicalDevice, NULL, &count, NULL) != VK_SUCCESS)
+		return false;
+	props = alloca(count * sizeof(*props));
+	if (vkEnumerateDeviceExtensionProperties(s->physicalDevice, NULL, &count, props) != VK_SUCCESS)
+		return false;
+	for (i = 0; i < count; i++) {
+		if (spa_streq(props[i].extensionName, name))
+			return true;
+	}
+	return false;
+}
+
 static int createDevice(struct vulkan_base *s, struct vulkan_base_info *info)
 {
 
@@ -209,11 +230,15 @@ static int createDevice(struct vulkan_base *s, struct vulkan_base_info *info)
 		.queueCount = 1,
 		.pQueuePriorities = (const float[]) { 1.0f }
 	};
-	const VkPhysicalDeviceSynchronization2FeaturesKHR sync2_features = {
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+		.timelineSemaphore = VK_TRUE,
+	};
+	VkPhysicalDeviceSynchronization2FeaturesKHR sync2_features = {
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR,
 		.synchronization2 = VK_TRUE,
 	};
-	static const char * const extensions[] = {
+	const char *extensions[] = {
 		VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
 		VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
 		VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME,
@@ -221,13 +246,22 @@ static int createDevice(struct vulkan_base *s, struct vulkan_base_info *info)
 		VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
 		VK_EXT_IMAGE_DRM_FORMAT_MODIFIER_EXTENSION_NAME,
 		VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME,
+		NULL,
 	};
+	uint32_t extensionCount = SPA_N_ELEMENTS(extensions) - 1;
+
+	/* timeline semaphores are only needed for explicit sync */
+	s->explicit_sync = hasDeviceExtension(s, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+	if (s->explicit_sync) {
+		extensions[extensionCount++] = VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME;
+		sync2_features.pNext = &timeline_features;
+	}
 
 	const VkDeviceCreateInfo deviceCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
 		.queueCreateInfoCount = 1,
 		.pQueueCreateInfos = &queueCreateInfo,
-		.enabledExtensionCount = SPA_N_ELEMENTS(extensions),
+		.enabledExtensionCount = extensionCount,
 		.ppEnabledExtensionNames = extensions,
 		.pNext = &sync2_features,
 	};
@@ -324,6 +358,134 @@ int vulkan_fence_create(struct vulkan_base *s, VkFence *fence)
 	return 0;
 }
 
+static int pipelineCache_path(struct vulkan_base *s, const char *name,
+		char *path, size_t size, bool create)
+{
+	VkPhysicalDeviceProperties props;
+	char dir[PATH_MAX], uuid[VK_UUID_SIZE * 2 + 1];
+	uint32_t i;
+	int res;
+
+	if ((res = get_pipewire_cache_dir(dir, sizeof(dir), "vulkan", create)) < 0)
+		return res;
+
+	vkGetPhysicalDeviceProperties(s->physicalDevice, &props);
+	for (i = 0; i < VK_UUID_SIZE; i++)
+		snprintf(&uuid[i * 2], 3, "%02x", props.pipelineCacheUUID[i]);
+
+	if (snprintf(path, size, "%s/%s-%04x-%04x-%s",
+				dir, name, props.vendorID, props.deviceID, uuid) >= (int)size)
+		return -ENAMETOOLONG;
+	return 0;
+}
+
+static void *pipelineCache_load(struct vulkan_base *s, const char *path, size_t *size)
+{
+	struct stat st;
+	void *data = NULL;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return NULL;
+	if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+	    (data = malloc(st.st_size)) != NULL) {
+		if (read(fd, data, st.st_size) != st.st_size) {
+			free(data);
+			data = NULL;
+		} else {
+			*size = st.st_size;
+		}
+	}
+	close(fd);
+	return data;
+}
+
+/**
+ * Create a pipeline cache with the data that was saved for \a name on this
+ * device with vulkan_pipelineCache_save(). The driver ignores data that
+ * doesn't match the device or driver version.
+ */
+int vulkan_pipelineCache_create(struct vulkan_base *s, const char *name, VkPipelineCache *cache)
+{
+	char path[PATH_MAX];
+	void *data = NULL;
+	size_t size = 0;
+	VkResult result;
+
+	if (pipelineCache_path(s, name, path, sizeof(path), false) == 0)
+		data = pipelineCache_load(s, path, &size);
+
+	VkPipelineCacheCreateInfo createInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = size,
+		.pInitialData = data,
+	};
+	result = vkCreatePipelineCache(s->device, &createInfo, NULL, cache);
+	if (result != VK_SUCCESS && data != NULL) {
+		spa_log_warn(s->log, "ignoring pipeline cache %s: %d", path, result);
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = NULL;
+		result = vkCreatePipelineCache(s->device, &createInfo, NULL, cache);
+	} else if (data != NULL) {
+		spa_log_debug(s->log, "loaded pipeline cache %s: %zu bytes", path, size);
+	}
+	free(data);
+	VK_CHECK_RESULT(result);
+
+	return 0;
+}
+
+/**
+ * Save the data of \a cache for \a name so that the next
+ * vulkan_pipelineCache_create() doesn't have to compile the pipelines again.
+ */
+int vulkan_pipelineCache_save(struct vulkan_base *s, const char *name, VkPipelineCache cache)
+{
+	char path[PATH_MAX], tmp[PATH_MAX + 8];
+	void *data;
+	size_t size;
+	int fd, res = 0;
+
+	if ((res = pipelineCache_path(s, name, path, sizeof(path), true)) < 0)
+		return res;
+
+	VK_CHECK_RESULT(vkGetPipelineCacheData(s->device, cache, &size, NULL));
+	if (size == 0)
+		return 0;
+	if ((data = malloc(size)) == NULL)
+		return -errno;
+	if (vkGetPipelineCacheData(s->device, cache, &size, data) != VK_SUCCESS) {
+		res = -EIO;
+		goto done;
+	}
+
+	/* write a new file and rename it so that readers never see a
+	 * partial cache */
+	spa_scnprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	if ((fd = mkostemp(tmp, O_CLOEXEC)) < 0) {
+		res = -errno;
+		goto done;
+	}
+	if (write(fd, data, size) != (ssize_t)size) {
+		res = errno ? -errno : -EIO;
+		close(fd);
+		unlink(tmp);
+		goto done;
+	}
+	close(fd);
+	if (rename(tmp, path) < 0) {
+		res = -errno;
+		unlink(tmp);
+		goto done;
+	}
+	spa_log_debug(s->log, "saved pipeline cache %s: %zu bytes", path, size);
+done:
+	if (res < 0)
+		spa_log_warn(s->log, "can't save pipeline cache %s: %s", path, spa_strerror(res));
+	free(data);
+	return res;
+}
+
 int vulkan_commandPool_create(struct vulkan_base *s, VkCommandPool *commandPool)
 {
 	const VkCommandPoolCreateInfo commandPoolCreateInfo = {
@@ -457,10 +619,97 @@ int vulkan_buffer_import_syncfd(struct vulkan_base *s, struct vulkan_buffer *vk_
 	return 0;
 }
 
+static int import_timeline(struct vulkan_base *s, int fd, VkSemaphore *semaphore)
+{
+	VULKAN_INSTANCE_FUNCTION(vkImportSemaphoreFdKHR);
+
+	VkSemaphoreTypeCreateInfoKHR type_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+	};
+	VkSemaphoreCreateInfo semaphore_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &type_info,
+	};
+	VK_CHECK_RESULT(vkCreateSemaphore(s->device, &semaphore_info, NULL, semaphore));
+
+	/* a DRM syncobj is the opaque fd of a timeline semaphore. The import
+	 * takes ownership of the fd, the spa_data keeps its own. */
+	int syncobj_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (syncobj_fd < 0)
+		return -errno;
+
+	VkImportSemaphoreFdInfoKHR import_info = {
+		.sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR,
+		.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT,
+		.semaphore = *semaphore,
+		.fd = syncobj_fd,
+	};
+	VK_CHECK_RESULT_WITH_CLEANUP(vkImportSemaphoreFdKHR(s->device, &import_info), close(syncobj_fd));
+
+	return 0;
+}
+
+int vulkan_buffer_import_sync_timeline(struct vulkan_base *s, struct vulkan_buffer *vk_buf, struct spa_buffer *spa_buf)
+{
+	int fds[2] = { -1, -1 };
+	uint32_t i, n_syncobj = 0;
+
+	if (!s->explicit_sync ||
+	    spa_buffer_find_meta(spa_buf, SPA_META_SyncTimeline) == NULL)
+		return 0;
+
+	for (i = 0; i < spa_buf->n_datas && n_syncobj < 2; i++) {
+		if (spa_buf->datas[i].type == SPA_DATA_SyncObj)
+			fds[n_syncobj++] = spa_buf->datas[i].fd;
+	}
+	if (n_syncobj == 0)
+		return 0;
+	if (n_syncobj == 1)
+		fds[1] = fds[0];
+
+	CHECK(import_timeline(s, fds[0], &vk_buf->acquire_semaphore));
+	CHECK(import_timeline(s, fds[1], &vk_buf->release_semaphore));
+
+	return 1;
+}
+
+bool vulkan_buffer_sync_timeline(struct vulkan_buffer *vk_buf, struct spa_buffer *spa_buf,
+		VkSemaphoreSubmitInfo *wait_info, VkSemaphoreSubmitInfo *signal_info)
+{
+	struct spa_meta_sync_timeline *stl;
+
+	if (vk_buf->acquire_semaphore == VK_NULL_HANDLE)
+		return false;
+	stl = spa_buffer_find_meta_data(spa_buf, SPA_META_SyncTimeline, sizeof(*stl));
+	if (stl == NULL)
+		return false;
+
+	*wait_info = (VkSemaphoreSubmitInfo) {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = vk_buf->acquire_semaphore,
+		.value = stl->acquire_point,
+		.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+	};
+	*signal_info = (VkSemaphoreSubmitInfo) {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = vk_buf->release_semaphore,
+		.value = stl->release_point,
+		.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+	};
+	/* the submit will signal the release point */
+	SPA_FLAG_CLEAR(stl->flags, SPA_META_SYNC_TIMELINE_UNSCHEDULED_RELEASE);
+	return true;
+}
+
 void vulkan_buffer_clear(struct vulkan_base *s, struct vulkan_buffer *buffer)
 {
 	if (buffer->fd != -1)
 		close(buffer->fd);
+	vkDestroySemaphore(s->device, buffer->acquire_semaphore, NULL);
+	vkDestroySemaphore(s->device, buffer->release_semaphore, NULL);
+	buffer->acquire_semaphore = VK_NULL_HANDLE;
+	buffer->release_semaphore = VK_NULL_HANDLE;
 	vkFreeMemory(s->device, buffer->memory, NULL);
 	vkDestroyImage(s->device, buffer->image, NULL);
 	vkDestroyImageView(s->device, buffer->view, NULL);
@@ -665,13 +914,25 @@ int vulkan_create_dmabuf(struct vulkan_base *s, struct external_buffer_info *inf
 	return 0;
 }
 
+uint32_t vulkan_buffer_plane_count(struct spa_buffer *spa_buf)
+{
+	uint32_t i;
+
+	/* the explicit sync syncobjs come after the planes */
+	for (i = 0; i < spa_buf->n_datas; i++) {
+		if (spa_buf->datas[i].type == SPA_DATA_SyncObj)
+			break;
+	}
+	return i;
+}
+
 int vulkan_import_dmabuf(struct vulkan_base *s, struct external_buffer_info *info, struct vulkan_buffer *vk_buf)
 {
 
-	if (info->spa_buf->n_datas == 0 || info->spa_buf->n_datas > DMABUF_MAX_PLANES)
-		return -1;
+	uint32_t planeCount = vulkan_buffer_plane_count(info->spa_buf);
 
-	uint32_t planeCount = info->spa_buf->n_datas;
+	if (planeCount == 0 || planeCount > DMABUF_MAX_PLANES)
+		return -1;
 
 	VkSubresourceLayout planeLayouts[DMABUF_MAX_PLANES] = {0};
 	for (uint32_t i = 0; i < planeCount; i++) {
@@ -86,6 +86,12 @@ int vulkan_read_pixels(struct vulkan_base *s, struct vulkan_read_pixels_info *in
 int vulkan_sync_foreign_dmabuf(struct vulkan_base *s, struct vulkan_buffer *vk_buf);
 bool vulkan_sync_export_dmabuf(struct vulkan_base *s, struct vulkan_buffer *vk_buf, int sync_file_fd);
 
+/* explicit sync with the SyncObj datas of a buffer with SPA_META_SyncTimeline */
+int vulkan_buffer_import_sync_timeline(struct vulkan_base *s, struct vulkan_buffer *vk_buf, struct spa_buffer *spa_buf);
+bool vulkan_buffer_sync_timeline(struct vulkan_buffer *vk_buf, struct spa_buffer *spa_buf,
+		VkSemaphoreSubmitInfo *wait_info, VkSemaphoreSubmitInfo *signal_info);
+uint32_t vulkan_buffer_plane_count(struct spa_buffer *spa_buf);
+
 int vulkan_staging_buffer_create(struct vulkan_base *s, uint32_t size, struct vulkan_staging_buffer *s_buf);
 void vulkan_staging_buffer_destroy(struct vulkan_base *s, struct vulkan_staging_buffer *s_buf);
 
@@ -99,6 +105,9 @@ int vulkan_fence_create(struct vulkan_base *s, VkFence *fence);
 int vulkan_commandPool_create(struct vulkan_base *s, VkCommandPool *commandPool);
 int vulkan_commandBuffer_create(struct vulkan_base *s, VkCommandPool commandPool, VkCommandBuffer *commandBuffer);
 
+int vulkan_pipelineCache_create(struct vulkan_base *s, const char *name, VkPipelineCache *cache);
+int vulkan_pipelineCache_save(struct vulkan_base *s, const char *name, VkPipelineCache cache);
+
 uint32_t vulkan_memoryType_find(struct vulkan_base *s,
 		uint32_t memoryTypeBits, VkMemoryPropertyFlags properties);
 struct vulkan_format_info *vulkan_formatInfo_find(struct vulkan_format_infos *fmtInfo, VkFormat format);
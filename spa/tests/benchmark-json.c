@@ -0,0 +1,146 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+
+#include <spa/utils/json.h>
+#include <spa/utils/string.h>
+
+#define MAX_COUNT 200
+#define MAX_SIZE (1024 * 1024)
+
+static char data[MAX_SIZE];
+
+/* something that looks like a filter-chain graph with comments, indentation,
+ * long strings and nested containers */
+static size_t gen_graph(char *str, size_t size, uint32_t n_nodes)
+{
+	size_t len = 0;
+	uint32_t i;
+
+	len += spa_scnprintf(str + len, size - len,
+			"# generated filter graph\n"
+			"filter.graph = {\n"
+			"    nodes = [\n");
+	for (i = 0; i < n_nodes; i++) {
+		len += spa_scnprintf(str + len, size - len,
+			"        # convolver node %u with a long impulse response path\n"
+			"        {\n"
+			"            type   = builtin\n"
+			"            name   = \"convolver-%u\"\n"
+			"            label  = convolver\n"
+			"            config = {\n"
+			"                filename = \"/usr/share/pipewire/impulses/room-%u-left-channel.wav\"\n"
+			"                gain     = 0.7\n"
+			"                offset   = %u\n"
+			"                channel  = [ 0 1 ]\n"
+			"            }\n"
+			"            control = { \"Gain 1\" = 0.5 \"Gain 2\" = 0.25 }\n"
+			"        }\n", i, i, i, i * 16);
+	}
+	len += spa_scnprintf(str + len, size - len,
+			"    ]\n"
+			"    links = [ { output = \"convolver-0:Out\" input = \"convolver-1:In\" } ]\n"
+			"}\n");
+	return len;
+}
+
+static uint32_t walk(struct spa_json *it)
+{
+	struct spa_json sub;
+	const char *value;
+	uint32_t count = 0;
+	int len;
+
+	while ((len = spa_json_next(it, &value)) > 0) {
+		count++;
+		if (spa_json_is_container(value, len)) {
+			spa_json_enter(it, &sub);
+			count += walk(&sub);
+		}
+	}
+	return count;
+}
+
+static void test_parse(uint32_t n_nodes)
+{
+	struct timespec ts;
+	uint64_t t1, t2;
+	struct spa_json it;
+	uint32_t i, count = 0, tokens;
+	size_t size;
+
+	size = gen_graph(data, sizeof(data), n_nodes);
+
+	spa_json_init(&it, data, size);
+	tokens = walk(&it);
+	assert(spa_json_get_error(&it, data, NULL) == false);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		spa_json_init(&it, data, size);
+		count += walk(&it);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	assert(count == tokens * MAX_COUNT);
+
+	fprintf(stderr, "parse %zd bytes %u tokens: elapsed %"PRIu64" count %u = %"PRIu64" MB/sec\n",
+			size, tokens, t2 - t1, MAX_COUNT,
+			(uint64_t)(size * MAX_COUNT * SPA_NSEC_PER_SEC / (t2 - t1) / (1024 * 1024)));
+}
+
+static void test_skip(uint32_t n_nodes)
+{
+	struct timespec ts;
+	uint64_t t1, t2;
+	struct spa_json it;
+	const char *value;
+	uint32_t i;
+	size_t size;
+	int len;
+
+	size = gen_graph(data, sizeof(data), n_nodes);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	/* skip over the graph as a whole, like when looking up a section */
+	for (i = 0; i < MAX_COUNT; i++) {
+		spa_json_init(&it, data, size);
+		while ((len = spa_json_next(&it, &value)) > 0) {
+			if (spa_json_is_container(value, len))
+				len = spa_json_container_len(&it, value, len);
+		}
+		assert(len == 0);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "skip %zd bytes: elapsed %"PRIu64" count %u = %"PRIu64" MB/sec\n",
+			size, t2 - t1, MAX_COUNT,
+			(uint64_t)(size * MAX_COUNT * SPA_NSEC_PER_SEC / (t2 - t1) / (1024 * 1024)));
+}
+
+int main(int argc, char *argv[])
+{
+	test_parse(10);
+	test_parse(100);
+	test_parse(1000);
+
+	test_skip(10);
+	test_skip(100);
+	test_skip(1000);
+
+	return 0;
+}
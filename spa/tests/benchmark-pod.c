@@ -12,6 +12,7 @@
 #include <spa/pod/pod.h>
 #include <spa/pod/builder.h>
 #include <spa/pod/parser.h>
+#include <spa/pod/filter.h>
 #include <spa/param/video/format-utils.h>
 #include <spa/debug/pod.h>
 
@@ -264,11 +265,62 @@ static void test_parser(void)
 			t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
 }
 
+static struct spa_pod *build_sizes(struct spa_pod_builder *b, uint32_t n_sizes, uint32_t step)
+{
+	struct spa_pod_frame f[2];
+	uint32_t i;
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, 0);
+	spa_pod_builder_prop(b, SPA_FORMAT_mediaType, 0);
+	spa_pod_builder_id(b, SPA_MEDIA_TYPE_video);
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_size, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	spa_pod_builder_rectangle(b, 640, 480);
+	for (i = 0; i < n_sizes; i++)
+		spa_pod_builder_rectangle(b, 160 + (i * step) * 16, 120 + (i * step) * 9);
+	spa_pod_builder_pop(b, &f[1]);
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+static void test_filter(uint32_t n_sizes)
+{
+	uint8_t buffer[3][32 * 1024];
+	struct spa_pod_builder b = { NULL, };
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint64_t count = 0;
+	struct spa_pod *fmt, *filter, *res;
+
+	spa_pod_builder_init(&b, buffer[0], sizeof(buffer[0]));
+	fmt = build_sizes(&b, n_sizes, 1);
+	spa_pod_builder_init(&b, buffer[1], sizeof(buffer[1]));
+	filter = build_sizes(&b, n_sizes, 2);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "test_filter(%u) : ", n_sizes);
+	for (count = 0; count < MAX_COUNT; count++) {
+		spa_pod_builder_init(&b, buffer[2], sizeof(buffer[2]));
+		spa_assert(spa_pod_filter(&b, &res, fmt, filter) == 0);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+		if (t2 - t1 > 1 * SPA_NSEC_PER_SEC)
+			break;
+	}
+	fprintf(stderr, "elapsed %"PRIu64" count %"PRIu64" = %"PRIu64"/sec\n",
+			t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
 int main(int argc, char *argv[])
 {
 	test_builder();
 	test_builder2();
 	test_parse();
 	test_parser();
+	test_filter(4);
+	test_filter(32);
+	test_filter(256);
 	return 0;
 }
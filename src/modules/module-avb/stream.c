@@ -8,6 +8,10 @@
 #include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <spa/utils/atomic.h>
+#include <spa/utils/result.h>
 
 #include <spa/debug/mem.h>
 #include <spa/pod/builder.h>
@@ -18,6 +22,10 @@
 #include "utils.h"
 #include "aecp-aem-descriptors.h"
 
+#define RX_FRAME_SIZE	2048
+#define RX_BLOCK_SIZE	(16 * RX_FRAME_SIZE)
+#define RX_BLOCK_NR	4
+
 static void on_stream_destroy(void *d)
 {
 	struct stream *stream = d;
@@ -83,15 +91,29 @@ set_iovec(struct spa_ringbuffer *rbuf, void *buffer, uint32_t size,
 	iov[1].iov_base = buffer;
 }
 
+static void send_pdus(struct stream *stream, uint32_t n_pdus)
+{
+	uint32_t i = 0;
+	int n;
+
+	while (i < n_pdus) {
+		n = sendmmsg(stream->source->fd, &stream->msg[i], n_pdus - i, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pw_log_error("sendmmsg() failed: %m");
+			break;
+		}
+		i += n;
+	}
+}
+
 static int flush_write(struct stream *stream, uint64_t current_time)
 {
 	int32_t avail;
-	uint32_t index;
+	uint32_t index, n_batch = 0;
         uint64_t ptime, txtime;
 	int pdu_count;
-	ssize_t n;
-	struct avb_frame_header *h = (void*)stream->pdu;
-	struct avb_packet_iec61883 *p = SPA_PTROFF(h, sizeof(*h), void);
 	uint8_t dbc;
 
 	avail = spa_ringbuffer_get_read_index(&stream->ring, &index);
@@ -102,29 +124,36 @@ static int flush_write(struct stream *stream, uint64_t current_time)
 	ptime = txtime + stream->mtt;
 	dbc = stream->dbc;
 
+	/* the PDUs keep their own txtime so the ETF qdisc still paces them
+	 * when they are handed to the kernel in one batch */
 	while (pdu_count--) {
-		*(uint64_t*)CMSG_DATA(stream->cmsg) = txtime;
+		struct avb_frame_header *h = (void*)stream->hdr[n_batch];
+		struct avb_packet_iec61883 *p = SPA_PTROFF(h, sizeof(*h), void);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&stream->msg[n_batch].msg_hdr);
+
+		memcpy(h, stream->pdu, stream->hdr_size);
+		*(uint64_t*)CMSG_DATA(cmsg) = txtime;
 
 		set_iovec(&stream->ring,
 			stream->buffer_data,
 			stream->buffer_size,
 			index % stream->buffer_size,
-			&stream->iov[1], stream->payload_size);
+			&stream->iov[n_batch][1], stream->payload_size);
 
 		p->seq_num = stream->pdu_seq++;
 		p->tv = 1;
 		p->timestamp = ptime;
 		p->dbc = dbc;
 
-		n = sendmsg(stream->source->fd, &stream->msg, MSG_NOSIGNAL);
-		if (n < 0 || n != (ssize_t)stream->pdu_size) {
-			pw_log_error("sendmsg() failed %zd != %zd: %m",
-					n, stream->pdu_size);
-		}
 		txtime += stream->pdu_period;
 		ptime += stream->pdu_period;
 		index += stream->payload_size;
 		dbc += stream->frames_per_pdu;
+
+		if (++n_batch == AVB_MAX_BATCH || pdu_count == 0) {
+			send_pdus(stream, n_batch);
+			n_batch = 0;
+		}
 	}
 	stream->dbc = dbc;
 	spa_ringbuffer_read_update(&stream->ring, index);
@@ -203,6 +232,7 @@ static void setup_pdu(struct stream *stream)
 		p->fdf = 0x2;
 		p->syt = htons(0x0008);
 	}
+	spa_assert(hdr_size <= AVB_MAX_HDR_SIZE);
 	stream->hdr_size = hdr_size;
 	stream->payload_size = payload_size;
 	stream->pdu_size = pdu_size;
@@ -210,22 +240,30 @@ static void setup_pdu(struct stream *stream)
 
 static int setup_msg(struct stream *stream)
 {
-	stream->iov[0].iov_base = stream->pdu;
-	stream->iov[0].iov_len = stream->hdr_size;
-	stream->iov[1].iov_base = SPA_PTROFF(stream->pdu, stream->hdr_size, void);
-	stream->iov[1].iov_len = stream->payload_size;
-	stream->iov[2].iov_base = SPA_PTROFF(stream->pdu, stream->hdr_size, void);
-	stream->iov[2].iov_len = 0;
-	stream->msg.msg_name = &stream->sock_addr;
-	stream->msg.msg_namelen = sizeof(stream->sock_addr);
-	stream->msg.msg_iov = stream->iov;
-	stream->msg.msg_iovlen = 3;
-	stream->msg.msg_control = stream->control;
-	stream->msg.msg_controllen = sizeof(stream->control);
-	stream->cmsg = CMSG_FIRSTHDR(&stream->msg);
-	stream->cmsg->cmsg_level = SOL_SOCKET;
-	stream->cmsg->cmsg_type = SCM_TXTIME;
-	stream->cmsg->cmsg_len = CMSG_LEN(sizeof(__u64));
+	uint32_t i;
+
+	for (i = 0; i < AVB_MAX_BATCH; i++) {
+		struct iovec *iov = stream->iov[i];
+		struct msghdr *msg = &stream->msg[i].msg_hdr;
+		struct cmsghdr *cmsg;
+
+		iov[0].iov_base = stream->hdr[i];
+		iov[0].iov_len = stream->hdr_size;
+		iov[1].iov_base = SPA_PTROFF(stream->pdu, stream->hdr_size, void);
+		iov[1].iov_len = stream->payload_size;
+		iov[2].iov_base = SPA_PTROFF(stream->pdu, stream->hdr_size, void);
+		iov[2].iov_len = 0;
+		msg->msg_name = &stream->sock_addr;
+		msg->msg_namelen = sizeof(stream->sock_addr);
+		msg->msg_iov = iov;
+		msg->msg_iovlen = 3;
+		msg->msg_control = stream->control[i];
+		msg->msg_controllen = sizeof(stream->control[i]);
+		cmsg = CMSG_FIRSTHDR(msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_TXTIME;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(__u64));
+	}
 	return 0;
 }
 
@@ -358,8 +396,47 @@ error_free:
 	return NULL;
 }
 
+static void clear_rx_ring(struct stream *stream)
+{
+	if (stream->rx_ring != NULL) {
+		munmap(stream->rx_ring, stream->rx_ring_size);
+		stream->rx_ring = NULL;
+	}
+}
+
+/* map a PACKET_MMAP receive ring so that all the pending packets can be
+ * handled without a recv() for each of them */
+static int setup_rx_ring(struct stream *stream, int fd)
+{
+	struct tpacket_req req;
+	int version = TPACKET_V2;
+	void *ring;
+
+	spa_zero(req);
+	req.tp_block_size = RX_BLOCK_SIZE;
+	req.tp_block_nr = RX_BLOCK_NR;
+	req.tp_frame_size = RX_FRAME_SIZE;
+	req.tp_frame_nr = RX_BLOCK_SIZE / RX_FRAME_SIZE * RX_BLOCK_NR;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+	    setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+		return -errno;
+
+	ring = mmap(NULL, (size_t)req.tp_block_size * req.tp_block_nr,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED)
+		return -errno;
+
+	stream->rx_ring = ring;
+	stream->rx_ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+	stream->rx_frame_nr = req.tp_frame_nr;
+	stream->rx_frame = 0;
+	return 0;
+}
+
 void stream_destroy(struct stream *stream)
 {
+	clear_rx_ring(stream);
 	avb_mrp_attribute_destroy(stream->listener_attr->mrp);
 	spa_list_remove(&stream->link);
 	free(stream);
@@ -415,6 +492,10 @@ static int setup_socket(struct stream *stream)
 	} else {
 		struct packet_mreq mreq;
 
+		if ((res = setup_rx_ring(stream, fd)) < 0)
+			pw_log_warn("can't map receive ring, using recv(): %s",
+					spa_strerror(res));
+
 		res = bind(fd, (struct sockaddr *) &stream->sock_addr, sizeof(stream->sock_addr));
 		if (res < 0) {
 			pw_log_error("bind() failed: %m");
@@ -441,6 +522,7 @@ static int setup_socket(struct stream *stream)
 	return fd;
 
 error_close:
+	clear_rx_ring(stream);
 	close(fd);
 	return res;
 }
@@ -467,6 +549,41 @@ static void handle_iec61883_packet(struct stream *stream,
 	}
 }
 
+static void handle_packet(struct stream *stream, uint8_t *buffer, int len)
+{
+	if (len < (int)sizeof(struct avb_packet_header)) {
+		pw_log_warn("short packet received (%d < %d)", len,
+				(int)sizeof(struct avb_packet_header));
+	} else {
+		struct avb_frame_header *h = (void*)buffer;
+		struct avb_packet_iec61883 *p = SPA_PTROFF(h, sizeof(*h), void);
+
+		if (memcmp(h->dest, stream->addr, 6) != 0 ||
+		    p->subtype != AVB_SUBTYPE_61883_IIDC)
+			return;
+
+		handle_iec61883_packet(stream, p, len - sizeof(*h));
+	}
+}
+
+/* handle all the frames the kernel has filled and give them back */
+static void read_rx_ring(struct stream *stream)
+{
+	while (true) {
+		struct tpacket2_hdr *hdr = SPA_PTROFF(stream->rx_ring,
+				(size_t)stream->rx_frame * RX_FRAME_SIZE, struct tpacket2_hdr);
+
+		if (!(SPA_ATOMIC_LOAD(hdr->tp_status) & TP_STATUS_USER))
+			break;
+
+		handle_packet(stream, SPA_PTROFF(hdr, hdr->tp_mac, uint8_t),
+				hdr->tp_snaplen);
+
+		SPA_ATOMIC_STORE(hdr->tp_status, TP_STATUS_KERNEL);
+		stream->rx_frame = (stream->rx_frame + 1) % stream->rx_frame_nr;
+	}
+}
+
 static void on_socket_data(void *data, int fd, uint32_t mask)
 {
 	struct stream *stream = data;
@@ -475,24 +592,17 @@ static void on_socket_data(void *data, int fd, uint32_t mask)
 		int len;
 		uint8_t buffer[2048];
 
+		if (stream->rx_ring != NULL) {
+			read_rx_ring(stream);
+			return;
+		}
+
 		len = recv(fd, buffer, sizeof(buffer), 0);
 
-		if (len < 0) {
+		if (len < 0)
 			pw_log_warn("got recv error: %m");
-		}
-		else if (len < (int)sizeof(struct avb_packet_header)) {
-			pw_log_warn("short packet received (%d < %d)", len,
-					(int)sizeof(struct avb_packet_header));
-		} else {
-			struct avb_frame_header *h = (void*)buffer;
-			struct avb_packet_iec61883 *p = SPA_PTROFF(h, sizeof(*h), void);
-
-			if (memcmp(h->dest, stream->addr, 6) != 0 ||
-			    p->subtype != AVB_SUBTYPE_61883_IIDC)
-				return;
-
-			handle_iec61883_packet(stream, p, len - sizeof(*h));
-		}
+		else
+			handle_packet(stream, buffer, len);
 	}
 }
 
@@ -557,6 +667,7 @@ int stream_deactivate(struct stream *stream, uint64_t now)
 		pw_loop_destroy_source(stream->server->impl->loop, stream->source);
 		stream->source = NULL;
 	}
+	clear_rx_ring(stream);
 
 	avb_mrp_attribute_leave(stream->vlan_attr->mrp, now);
 
@@ -18,6 +18,10 @@
 #define BUFFER_SIZE	(1u<<16)
 #define BUFFER_MASK	(BUFFER_SIZE-1)
 
+/* max number of PDUs sent with one sendmmsg() */
+#define AVB_MAX_BATCH		16
+#define AVB_MAX_HDR_SIZE	64
+
 struct stream {
 	struct spa_list link;
 
@@ -50,11 +54,18 @@ struct stream {
 	uint8_t prev_seq;
 	uint8_t dbc;
 
-	struct iovec iov[3];
+	/* each PDU of a batch has its own header and txtime */
+	uint8_t hdr[AVB_MAX_BATCH][AVB_MAX_HDR_SIZE];
+	struct iovec iov[AVB_MAX_BATCH][3];
 	struct sockaddr_ll sock_addr;
-	struct msghdr msg;
-	char control[CMSG_SPACE(sizeof(uint64_t))];
-	struct cmsghdr *cmsg;
+	struct mmsghdr msg[AVB_MAX_BATCH];
+	char control[AVB_MAX_BATCH][CMSG_SPACE(sizeof(uint64_t))];
+
+	/* PACKET_MMAP receive ring, NULL when recv() is used */
+	void *rx_ring;
+	size_t rx_ring_size;
+	uint32_t rx_frame_nr;
+	uint32_t rx_frame;
 
 	struct spa_ringbuffer ring;
 	void *buffer_data;
@@ -1273,7 +1273,7 @@ static void node_peer_added(void *data, struct pw_impl_node *peer)
 	struct impl *impl = data;
 	struct pw_memblock *m;
 
-	m = pw_mempool_import_block(impl->client_pool, peer->activation);
+	m = pw_mempool_import_block(impl->client_pool, peer->activation->block);
 	if (m == NULL) {
 		pw_log_warn("%p: can't ensure mem: %m", impl);
 		return;
@@ -1289,7 +1289,7 @@ static void node_peer_added(void *data, struct pw_impl_node *peer)
 					  peer->info.id,
 					  peer->source.fd,
 					  m->id,
-					  0,
+					  peer->activation->offset,
 					  sizeof(struct pw_node_activation));
 }
 
@@ -1298,7 +1298,7 @@ static void node_peer_removed(void *data, struct pw_impl_node *peer)
 	struct impl *impl = data;
 	struct pw_memblock *m;
 
-	m = pw_mempool_find_fd(impl->client_pool, peer->activation->fd);
+	m = pw_mempool_find_fd(impl->client_pool, peer->activation->block->fd);
 	if (m == NULL) {
 		pw_log_warn("%p: unknown peer %p fd:%d", impl, peer,
 			peer->source.fd);
@@ -1328,7 +1328,7 @@ void pw_impl_client_node_registered(struct pw_impl_client_node *this, struct pw_
 
 	pw_log_debug("%p: %d", &impl->node, node_id);
 
-	impl->activation = pw_mempool_import_block(impl->client_pool, node->activation);
+	impl->activation = pw_mempool_import_block(impl->client_pool, node->activation->block);
 	if (impl->activation == NULL) {
 		pw_log_debug("%p: can't import block: %m", &impl->node);
 		return;
@@ -1344,7 +1344,7 @@ void pw_impl_client_node_registered(struct pw_impl_client_node *this, struct pw_
 					  this->node->source.fd,
 					  impl->data_source.fd,
 					  impl->activation->id,
-					  0,
+					  node->activation->offset,
 					  sizeof(struct pw_node_activation));
 
 	if (impl->bind_node_id) {
@@ -1416,8 +1416,9 @@ static void node_free(void *data)
 	while ((mm = pw_mempool_find_tag(impl->client_pool, tag, sizeof(uint32_t))) != NULL)
 		pw_memmap_free(mm);
 
+	/* the activation block can be shared with other nodes, only drop our ref */
 	if (impl->activation)
-		pw_memblock_free(impl->activation);
+		pw_memblock_unref(impl->activation);
 
 	pw_array_for_each(area, &impl->io_areas) {
 		if (*area)
@@ -125,7 +125,7 @@ static void clean_transport(struct node_data *data)
 	}
 
 	pw_memmap_free(data->activation);
-	node->rt.target.activation = node->activation->map->ptr;
+	node->rt.target.activation = node->activation->ptr;
 
 	spa_system_close(data->data_system, data->rtwritefd);
 	data->have_transport = false;
@@ -1111,7 +1111,8 @@ static void combine_input_process(void *d)
 	}
 
 	spa_list_for_each(s, &impl->streams, link) {
-		uint32_t j;
+		uint32_t j, outsize;
+		int32_t stride;
 
 		if (s->stream == NULL)
 			continue;
@@ -1124,33 +1125,44 @@ static void combine_input_process(void *d)
 			goto do_trigger;
 		}
 
+		outsize = 0;
+		stride = 0;
 		for (j = 0; j < out->buffer->n_datas; j++) {
 			struct spa_data *ds, *dd;
-			uint32_t outsize = 0, remap;
-			int32_t stride = 0;
+			uint32_t offs, size, remap;
+
+			remap = s->remap[j];
+			if (remap >= in->buffer->n_datas)
+				continue;
 
 			dd = &out->buffer->datas[j];
+			ds = &in->buffer->datas[remap];
 
-			remap = s->remap[j];
-			if (remap < in->buffer->n_datas) {
-				uint32_t offs, size;
+			offs = SPA_MIN(ds->chunk->offset, ds->maxsize);
+			size = SPA_MIN(ds->chunk->size, ds->maxsize - offs);
+			size = SPA_MIN(size, dd->maxsize);
+
+			ringbuffer_memcpy(&s->delay[j],
+				dd->data, SPA_PTROFF(ds->data, offs, void), size);
 
-				ds = &in->buffer->datas[remap];
+			dd->chunk->offset = 0;
+			dd->chunk->size = size;
+			dd->chunk->stride = ds->chunk->stride;
 
-				offs = SPA_MIN(ds->chunk->offset, ds->maxsize);
-				size = SPA_MIN(ds->chunk->size, ds->maxsize - offs);
+			outsize = SPA_MAX(outsize, size);
+			stride = SPA_MAX(stride, ds->chunk->stride);
+		}
+		/* channels without a source get silence of the same size */
+		for (j = 0; j < out->buffer->n_datas; j++) {
+			struct spa_data *dd = &out->buffer->datas[j];
 
-				ringbuffer_memcpy(&s->delay[j],
-					dd->data, SPA_PTROFF(ds->data, offs, void), size);
+			if (s->remap[j] < in->buffer->n_datas)
+				continue;
 
-				outsize = SPA_MAX(outsize, size);
-				stride = SPA_MAX(stride, ds->chunk->stride);
-			} else {
-				memset(dd->data, 0, outsize);
-			}
 			dd->chunk->offset = 0;
-			dd->chunk->size = outsize;
+			dd->chunk->size = SPA_MIN(outsize, dd->maxsize);
 			dd->chunk->stride = stride;
+			memset(dd->data, 0, dd->chunk->size);
 		}
 		pw_stream_queue_buffer(s->stream, out);
 do_trigger:
@@ -1171,6 +1183,9 @@ static void combine_output_process(void *d)
 	struct pw_buffer *in, *out;
 	struct stream *s;
 	bool delay_changed = false;
+	uint64_t written = 0;
+	uint32_t j, outsize = 0;
+	int32_t stride = 0;
 
 	if ((out = pw_stream_dequeue_buffer(impl->combine)) == NULL) {
 		pw_log_debug("%p: out of output buffers: %m", impl);
@@ -1178,8 +1193,6 @@ static void combine_output_process(void *d)
 	}
 
 	spa_list_for_each(s, &impl->streams, link) {
-		uint32_t j;
-
 		if (s->stream == NULL)
 			continue;
 
@@ -1203,35 +1216,52 @@ static void combine_output_process(void *d)
 
 		for (j = 0; j < in->buffer->n_datas; j++) {
 			struct spa_data *ds, *dd;
-			uint32_t outsize = 0, remap;
-			int32_t stride = 0;
+			uint32_t offs, size, remap;
 
 			ds = &in->buffer->datas[j];
 
 			/* FIXME, need to do mixing for overlapping streams */
 			remap = s->remap[j];
-			if (remap < out->buffer->n_datas) {
-				uint32_t offs, size;
+			if (remap >= out->buffer->n_datas)
+				continue;
 
-				dd = &out->buffer->datas[remap];
+			dd = &out->buffer->datas[remap];
 
-				offs = SPA_MIN(ds->chunk->offset, ds->maxsize);
-				size = SPA_MIN(ds->chunk->size, ds->maxsize - offs);
-				size = SPA_MIN(size, dd->maxsize);
+			offs = SPA_MIN(ds->chunk->offset, ds->maxsize);
+			size = SPA_MIN(ds->chunk->size, ds->maxsize - offs);
+			size = SPA_MIN(size, dd->maxsize);
 
-				ringbuffer_memcpy(&s->delay[j],
-					dd->data, SPA_PTROFF(ds->data, offs, void), size);
+			ringbuffer_memcpy(&s->delay[j],
+				dd->data, SPA_PTROFF(ds->data, offs, void), size);
 
-				outsize = SPA_MAX(outsize, size);
-				stride = SPA_MAX(stride, ds->chunk->stride);
+			dd->chunk->offset = 0;
+			dd->chunk->size = size;
+			dd->chunk->stride = ds->chunk->stride;
 
-				dd->chunk->offset = 0;
-				dd->chunk->size = outsize;
-				dd->chunk->stride = stride;
-			}
+			outsize = SPA_MAX(outsize, size);
+			stride = SPA_MAX(stride, ds->chunk->stride);
+			if (remap < 64)
+				written |= 1ULL << remap;
 		}
 		pw_stream_queue_buffer(s->stream, in);
 	}
+	/* clear the channels of streams that had no data in this cycle, the
+	 * buffer still contains the samples of an older cycle */
+	if (outsize == 0 && out->requested > 0) {
+		outsize = out->requested * sizeof(float);
+		stride = sizeof(float);
+	}
+	for (j = 0; j < out->buffer->n_datas; j++) {
+		struct spa_data *dd = &out->buffer->datas[j];
+
+		if (j < 64 && (written & (1ULL << j)))
+			continue;
+
+		dd->chunk->offset = 0;
+		dd->chunk->size = SPA_MIN(outsize, dd->maxsize);
+		dd->chunk->stride = stride;
+		memset(dd->data, 0, dd->chunk->size);
+	}
 	pw_stream_queue_buffer(impl->combine, out);
 
 	if (impl->latency_compensate && delay_changed)
@@ -40,6 +40,8 @@
 
 #include <pipewire/extensions/profiler.h>
 
+#include "ringbuffer-utils.h"
+
 /** \page page_module_echo_cancel Echo Cancel
  *
  * The `echo-cancel` module performs echo cancellation. The module creates
@@ -80,6 +82,15 @@
  *   This data then goes into the application (the conference application) and
  *   does not contain the echo from the other participants anymore.
  *
+ * One module can cancel the echo from several microphones or beams of a
+ * microphone array against the same playback signal. Give the capture stream
+ * and the source a channel for each of them, the channels of the source can
+ * then be linked separately. The playback signal is only buffered and analyzed
+ * once for all of the channels instead of once per module with a module for
+ * each microphone. With the webrtc canceller, the `webrtc.multi_channel_capture`
+ * and `webrtc.multi_channel_render` aec.args control if the capture and playback
+ * channels are processed separately or downmixed first.
+ *
  * ## Module Name
  *
  * `libpipewire-module-echo-cancel`
@@ -97,6 +108,11 @@
  * - `aec.args = <str>`: arguments to pass to the echo cancellation method
  * - `monitor.mode`: Instead of making a sink, make a stream that captures from
  *                   the monitor ports of the default sink.
+ * - `aec.thread = <bool>`: run the echo canceller in a separate thread instead of
+ *                   in the realtime thread, default false. This keeps the cost of
+ *                   the realtime thread the same for each cycle when the canceller
+ *                   processes in larger blocks than the quantum but it adds the
+ *                   latency of one canceller block to the source.
  *
  * ## General options
  *
@@ -123,6 +139,7 @@
  *          # library.name  = aec/libspa-aec-webrtc
  *          # node.latency = 1024/48000
  *          # monitor.mode = false
+ *          # aec.args = { webrtc.multi_channel_render = false }
  *          capture.props = {
  *             node.name = "Echo Cancellation Capture"
  *          }
@@ -170,6 +187,7 @@ static const struct spa_dict_item module_props[] = {
 				"( buffer.play_delay=<delay as fraction> ) "
 				"( library.name =<library name> ) "
 				"( aec.args=<aec arguments> ) "
+				"( aec.thread=<run aec in a thread> ) "
 				"( capture.props=<properties> ) "
 				"( source.props=<properties> ) "
 				"( sink.props=<properties> ) "
@@ -201,9 +219,7 @@ struct impl {
 	struct spa_hook source_listener;
 	struct spa_audio_info_raw source_info;
 
-	void *rec_buffer[SPA_AUDIO_MAX_CHANNELS];
-	uint32_t rec_ringsize;
-	struct spa_ringbuffer rec_ring;
+	struct pw_planar_ring rec_ring;
 
 	struct pw_properties *playback_props;
 	struct pw_stream *playback;
@@ -213,18 +229,18 @@ struct impl {
 	struct pw_properties *sink_props;
 	struct pw_stream *sink;
 	struct spa_hook sink_listener;
-	void *play_buffer[SPA_AUDIO_MAX_CHANNELS];
-	uint32_t play_ringsize;
-	struct spa_ringbuffer play_ring;
+	struct pw_planar_ring play_ring;
+	/* reads the play_ring memory buffer_delay behind */
 	struct spa_ringbuffer play_delayed_ring;
 	struct spa_audio_info_raw sink_info;
 
-	void *out_buffer[SPA_AUDIO_MAX_CHANNELS];
-	uint32_t out_ringsize;
-	struct spa_ringbuffer out_ring;
+	struct pw_planar_ring out_ring;
 
 	struct spa_audio_aec *aec;
 	uint32_t aec_blocksize;
+	/* when set, the canceller runs here and the ring buffers of the
+	 * canceller are only read and written from this thread */
+	struct pw_thread_loop *aec_loop;
 
 	unsigned int capture_ready:1;
 	unsigned int sink_ready:1;
@@ -291,80 +307,79 @@ static inline void aec_run(struct impl *impl, const float *rec[], const float *p
 #endif
 }
 
-static void process(struct impl *impl)
+static void process_aec(struct impl *impl)
 {
-	struct pw_buffer *cout;
-	struct pw_buffer *pout = NULL;
 	float rec_buf[impl->rec_info.channels][impl->aec_blocksize / sizeof(float)];
-	float play_buf[impl->play_info.channels][impl->aec_blocksize / sizeof(float)];
 	float play_delayed_buf[impl->play_info.channels][impl->aec_blocksize / sizeof(float)];
 	float out_buf[impl->out_info.channels][impl->aec_blocksize / sizeof(float)];
+	void *rec_tmp[impl->rec_info.channels];
+	void *play_delayed_tmp[impl->play_info.channels];
+	void *out_tmp[impl->out_info.channels];
+	void *ptrs[SPA_AUDIO_MAX_CHANNELS];
 	const float *rec[impl->rec_info.channels];
-	const float *play[impl->play_info.channels];
 	const float *play_delayed[impl->play_info.channels];
 	float *out[impl->out_info.channels];
-	struct spa_data *dd;
 	uint32_t i, size;
-	uint32_t rindex, pindex, oindex, pdindex, avail;
-
-	if (impl->playback != NULL && (pout = pw_stream_dequeue_buffer(impl->playback)) == NULL) {
-		pw_log_debug("out of playback buffers: %m");
-		goto done;
-	}
+	uint32_t rindex, oindex, pdindex;
+	int32_t avail;
+	bool out_direct, out_drop = false;
 
 	size = impl->aec_blocksize;
 
-	/* First read a block from the playback and capture ring buffers */
-	spa_ringbuffer_get_read_index(&impl->rec_ring, &rindex);
-
+	/* First get a block from the capture and delayed playback ring buffers.
+	 * The canceller reads from the ringbuffer memory unless the block wraps
+	 * around. */
+	spa_ringbuffer_get_read_index(&impl->rec_ring.ring, &rindex);
+	for (i = 0; i < impl->rec_info.channels; i++)
+		rec_tmp[i] = &rec_buf[i][0];
+	if (!pw_planar_ring_get_ptrs(&impl->rec_ring, rindex, size, ptrs, rec_tmp))
+		pw_planar_ring_read_data(&impl->rec_ring, rindex, ptrs,
+				impl->rec_info.channels, size);
 	for (i = 0; i < impl->rec_info.channels; i++) {
 		/* captured samples, with echo from sink */
-		rec[i] = &rec_buf[i][0];
-
-		spa_ringbuffer_read_data(&impl->rec_ring, impl->rec_buffer[i],
-				impl->rec_ringsize, rindex % impl->rec_ringsize,
-				(void*)rec[i], size);
-
-	}
-	spa_ringbuffer_read_update(&impl->rec_ring, rindex + size);
-
-	for (i = 0; i < impl->out_info.channels; i++) {
-		/* filtered samples, without echo from sink */
-		out[i] = &out_buf[i][0];
+		rec[i] = ptrs[i];
 	}
 
-	spa_ringbuffer_get_read_index(&impl->play_ring, &pindex);
 	spa_ringbuffer_get_read_index(&impl->play_delayed_ring, &pdindex);
-
+	for (i = 0; i < impl->play_info.channels; i++)
+		play_delayed_tmp[i] = &play_delayed_buf[i][0];
+	if (!pw_planar_ring_get_ptrs(&impl->play_ring, pdindex, size, ptrs, play_delayed_tmp))
+		pw_planar_ring_read_data(&impl->play_ring, pdindex, ptrs,
+				impl->play_info.channels, size);
 	for (i = 0; i < impl->play_info.channels; i++) {
-		/* echo from sink */
-		play[i] = &play_buf[i][0];
 		/* echo from sink delayed */
-		play_delayed[i] = &play_delayed_buf[i][0];
-
-		spa_ringbuffer_read_data(&impl->play_ring, impl->play_buffer[i],
-				impl->play_ringsize, pindex % impl->play_ringsize,
-				(void *)play[i], size);
+		play_delayed[i] = ptrs[i];
+	}
 
-		spa_ringbuffer_read_data(&impl->play_delayed_ring, impl->play_buffer[i],
-				impl->play_ringsize, pdindex % impl->play_ringsize,
-				(void *)play_delayed[i], size);
+	/* Then make room in the output ringbuffer */
+	avail = spa_ringbuffer_get_write_index(&impl->out_ring.ring, &oindex);
+	if (avail + size > impl->out_ring.size) {
+		uint32_t rindex, drop;
 
-		if (pout != NULL) {
-			/* output to sink, just copy */
-			dd = &pout->buffer->datas[i];
-			memcpy(dd->data, play[i], size);
+		/* the data thread reads from the output ringbuffer, we can only
+		 * drop the new block */
+		if (impl->aec_loop != NULL) {
+			pw_log_debug("output ringbuffer xrun %d + %u > %u, dropping block",
+					avail, size, impl->out_ring.size);
+			out_drop = true;
+		} else {
+			/* Drop enough so we have size bytes left */
+			drop = avail + size - impl->out_ring.size;
+			pw_log_debug("output ringbuffer xrun %d + %u > %u, dropping %u",
+					avail, size, impl->out_ring.size, drop);
 
-			dd->chunk->offset = 0;
-			dd->chunk->size = size;
-			dd->chunk->stride = sizeof(float);
+			spa_ringbuffer_get_read_index(&impl->out_ring.ring, &rindex);
+			spa_ringbuffer_read_update(&impl->out_ring.ring, rindex + drop);
 		}
 	}
-	spa_ringbuffer_read_update(&impl->play_ring, pindex + size);
-	spa_ringbuffer_read_update(&impl->play_delayed_ring, pdindex + size);
-
-	if (impl->playback != NULL)
-		pw_stream_queue_buffer(impl->playback, pout);
+	for (i = 0; i < impl->out_info.channels; i++)
+		out_tmp[i] = &out_buf[i][0];
+	out_direct = !out_drop &&
+		pw_planar_ring_get_ptrs(&impl->out_ring, oindex, size, ptrs, out_tmp);
+	for (i = 0; i < impl->out_info.channels; i++) {
+		/* filtered samples, without echo from sink */
+		out[i] = out_direct ? ptrs[i] : out_tmp[i];
+	}
 
 	if (SPA_UNLIKELY (impl->current_delay < impl->buffer_delay)) {
 		uint32_t delay_left = impl->buffer_delay - impl->current_delay;
@@ -394,55 +409,92 @@ static void process(struct impl *impl)
 		aec_run(impl, rec, play_delayed, out, size / sizeof(float));
 	}
 
-	/* Next, copy over the output to the output ringbuffer */
-	avail = spa_ringbuffer_get_write_index(&impl->out_ring, &oindex);
-	if (avail + size > impl->out_ringsize) {
-		uint32_t rindex, drop;
+	spa_ringbuffer_read_update(&impl->rec_ring.ring, rindex + size);
+	spa_ringbuffer_read_update(&impl->play_delayed_ring, pdindex + size);
 
-		/* Drop enough so we have size bytes left */
-		drop = avail + size - impl->out_ringsize;
-		pw_log_debug("output ringbuffer xrun %d + %u > %u, dropping %u",
-				avail, size, impl->out_ringsize, drop);
+	/* Next, copy over the output to the output ringbuffer when it was
+	 * not written there directly */
+	if (out_drop)
+		return;
+	if (!out_direct)
+		pw_planar_ring_write_data(&impl->out_ring, oindex, (const void **)out,
+				impl->out_info.channels, size);
+	spa_ringbuffer_write_update(&impl->out_ring.ring, oindex + size);
+}
 
-		spa_ringbuffer_get_read_index(&impl->out_ring, &rindex);
-		spa_ringbuffer_read_update(&impl->out_ring, rindex + drop);
+static int do_process_aec(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	process_aec(user_data);
+	return 0;
+}
 
-		avail += drop;
+static void process(struct impl *impl)
+{
+	struct pw_buffer *cout;
+	struct pw_buffer *pout = NULL;
+	struct spa_data *dd;
+	void *dst[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i, size, n_datas;
+	uint32_t pindex, oindex, avail;
+
+	if (impl->playback != NULL && (pout = pw_stream_dequeue_buffer(impl->playback)) == NULL) {
+		pw_log_debug("out of playback buffers: %m");
+		goto done;
 	}
 
-	for (i = 0; i < impl->out_info.channels; i++) {
-		/* captured samples, with echo from sink */
-		spa_ringbuffer_write_data(&impl->out_ring, impl->out_buffer[i],
-				impl->out_ringsize, oindex % impl->out_ringsize,
-				(void *)out[i], size);
+	size = impl->aec_blocksize;
+
+	/* First pass a block from the playback ring buffer to the playback stream */
+	spa_ringbuffer_get_read_index(&impl->play_ring.ring, &pindex);
+
+	if (pout != NULL) {
+		n_datas = SPA_MIN(pout->buffer->n_datas, impl->play_info.channels);
+		for (i = 0; i < n_datas; i++) {
+			/* output to sink, just copy */
+			dd = &pout->buffer->datas[i];
+			dst[i] = dd->data;
+			dd->chunk->offset = 0;
+			dd->chunk->size = size;
+			dd->chunk->stride = sizeof(float);
+		}
+		pw_planar_ring_read_data(&impl->play_ring, pindex, dst, n_datas, size);
+		pw_stream_queue_buffer(impl->playback, pout);
 	}
+	spa_ringbuffer_read_update(&impl->play_ring.ring, pindex + size);
 
-	spa_ringbuffer_write_update(&impl->out_ring, oindex + size);
+	/* Then cancel the echo from a block. In the aec thread, the block
+	 * will be available in the output ringbuffer in the next cycle. */
+	if (impl->aec_loop != NULL)
+		pw_loop_invoke(pw_thread_loop_get_loop(impl->aec_loop),
+				do_process_aec, 1, NULL, 0, false, impl);
+	else
+		process_aec(impl);
 
 	/* And finally take data from the output ringbuffer and make it
 	 * available on the source */
 
-	avail = spa_ringbuffer_get_read_index(&impl->out_ring, &oindex);
+	avail = spa_ringbuffer_get_read_index(&impl->out_ring.ring, &oindex);
 	while (avail >= size) {
 		if ((cout = pw_stream_dequeue_buffer(impl->source)) == NULL) {
 			pw_log_debug("out of source buffers: %m");
 			break;
 		}
 
-		for (i = 0; i < impl->out_info.channels; i++) {
+		n_datas = SPA_MIN(cout->buffer->n_datas, impl->out_info.channels);
+		for (i = 0; i < n_datas; i++) {
 			dd = &cout->buffer->datas[i];
-			spa_ringbuffer_read_data(&impl->out_ring, impl->out_buffer[i],
-					impl->out_ringsize, oindex % impl->out_ringsize,
-					(void *)dd->data, size);
+			dst[i] = dd->data;
 			dd->chunk->offset = 0;
 			dd->chunk->size = size;
 			dd->chunk->stride = sizeof(float);
 		}
+		pw_planar_ring_read_data(&impl->out_ring, oindex, dst, n_datas, size);
 
 		pw_stream_queue_buffer(impl->source, cout);
 
 		oindex += size;
-		spa_ringbuffer_read_update(&impl->out_ring, oindex);
+		spa_ringbuffer_read_update(&impl->out_ring.ring, oindex);
 		avail -= size;
 	}
 
@@ -463,7 +515,8 @@ static void capture_process(void *data)
 	struct impl *impl = data;
 	struct pw_buffer *buf;
 	struct spa_data *d;
-	uint32_t i, index, offs, size;
+	const void *src[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i, index, offs, size, n_datas;
 	int32_t avail;
 
 	if ((buf = pw_stream_dequeue_buffer(impl->capture)) == NULL) {
@@ -475,18 +528,26 @@ static void capture_process(void *data)
 	offs = SPA_MIN(d->chunk->offset, d->maxsize);
 	size = SPA_MIN(d->chunk->size, d->maxsize - offs);
 
-	avail = spa_ringbuffer_get_write_index(&impl->rec_ring, &index);
+	avail = spa_ringbuffer_get_write_index(&impl->rec_ring.ring, &index);
 
-	if (avail + size > impl->rec_ringsize) {
+	if (avail + size > impl->rec_ring.size) {
 		uint32_t rindex, drop;
 
+		/* the aec thread reads from the ringbuffer, drop the new data */
+		if (impl->aec_loop != NULL) {
+			pw_log_debug("capture ringbuffer xrun %d + %u > %u, dropping buffer",
+					avail, size, impl->rec_ring.size);
+			pw_stream_queue_buffer(impl->capture, buf);
+			return;
+		}
+
 		/* Drop enough so we have size bytes left */
-		drop = avail + size - impl->rec_ringsize;
+		drop = avail + size - impl->rec_ring.size;
 		pw_log_debug("capture ringbuffer xrun %d + %u > %u, dropping %u",
-				avail, size, impl->rec_ringsize, drop);
+				avail, size, impl->rec_ring.size, drop);
 
-		spa_ringbuffer_get_read_index(&impl->rec_ring, &rindex);
-		spa_ringbuffer_read_update(&impl->rec_ring, rindex + drop);
+		spa_ringbuffer_get_read_index(&impl->rec_ring.ring, &rindex);
+		spa_ringbuffer_read_update(&impl->rec_ring.ring, rindex + drop);
 
 		avail += drop;
 	}
@@ -499,19 +560,18 @@ static void capture_process(void *data)
 		pw_log_debug("Setting AEC block size to %u", impl->aec_blocksize);
 	}
 
-	for (i = 0; i < impl->rec_info.channels; i++) {
+	n_datas = SPA_MIN(buf->buffer->n_datas, impl->rec_info.channels);
+	for (i = 0; i < n_datas; i++) {
 		/* captured samples, with echo from sink */
 		d = &buf->buffer->datas[i];
 
 		offs = SPA_MIN(d->chunk->offset, d->maxsize);
-		size = SPA_MIN(d->chunk->size, d->maxsize - offs);
-
-		spa_ringbuffer_write_data(&impl->rec_ring, impl->rec_buffer[i],
-				impl->rec_ringsize, index % impl->rec_ringsize,
-				SPA_PTROFF(d->data, offs, void), size);
+		size = SPA_MIN(size, SPA_MIN(d->chunk->size, d->maxsize - offs));
+		src[i] = SPA_PTROFF(d->data, offs, void);
 	}
+	pw_planar_ring_write_data(&impl->rec_ring, index, src, n_datas, size);
 
-	spa_ringbuffer_write_update(&impl->rec_ring, index + size);
+	spa_ringbuffer_write_update(&impl->rec_ring.ring, index + size);
 
 	if (avail + size >= impl->aec_blocksize) {
 		impl->capture_ready = true;
@@ -586,26 +646,32 @@ static void source_state_changed(void *data, enum pw_stream_state old,
 	}
 }
 
-static void reset_buffers(struct impl *impl)
+static int do_reset_buffers(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
 {
-	uint32_t index, i;
+	struct impl *impl = user_data;
+	uint32_t index;
 
-	spa_ringbuffer_init(&impl->rec_ring);
-	spa_ringbuffer_init(&impl->play_ring);
+	pw_planar_ring_reset(&impl->rec_ring);
+	pw_planar_ring_reset(&impl->play_ring);
 	spa_ringbuffer_init(&impl->play_delayed_ring);
-	spa_ringbuffer_init(&impl->out_ring);
+	pw_planar_ring_reset(&impl->out_ring);
 
-	for (i = 0; i < impl->rec_info.channels; i++)
-		memset(impl->rec_buffer[i], 0, impl->rec_ringsize);
-	for (i = 0; i < impl->play_info.channels; i++)
-		memset(impl->play_buffer[i], 0, impl->play_ringsize);
-	for (i = 0; i < impl->out_info.channels; i++)
-		memset(impl->out_buffer[i], 0, impl->out_ringsize);
+	spa_ringbuffer_get_write_index(&impl->play_ring.ring, &index);
+	spa_ringbuffer_write_update(&impl->play_ring.ring, index + (sizeof(float) * (impl->buffer_delay)));
+	spa_ringbuffer_get_read_index(&impl->play_ring.ring, &index);
+	spa_ringbuffer_read_update(&impl->play_ring.ring, index + (sizeof(float) * (impl->buffer_delay)));
+	return 0;
+}
 
-	spa_ringbuffer_get_write_index(&impl->play_ring, &index);
-	spa_ringbuffer_write_update(&impl->play_ring, index + (sizeof(float) * (impl->buffer_delay)));
-	spa_ringbuffer_get_read_index(&impl->play_ring, &index);
-	spa_ringbuffer_read_update(&impl->play_ring, index + (sizeof(float) * (impl->buffer_delay)));
+static void reset_buffers(struct impl *impl)
+{
+	/* wait for the blocks that are still queued in the aec thread */
+	if (impl->aec_loop != NULL)
+		pw_loop_invoke(pw_thread_loop_get_loop(impl->aec_loop),
+				do_reset_buffers, 0, NULL, 0, true, impl);
+	else
+		do_reset_buffers(NULL, false, 0, NULL, 0, impl);
 }
 
 static void input_param_latency_changed(struct impl *impl, const struct spa_pod *param)
@@ -618,6 +684,12 @@ static void input_param_latency_changed(struct impl *impl, const struct spa_pod
 	if (param == NULL || spa_latency_parse(param, &latency) < 0)
 		return;
 
+	/* the output of the aec thread is one block late */
+	if (impl->aec_loop != NULL) {
+		latency.min_rate += impl->aec_blocksize / sizeof(float);
+		latency.max_rate += impl->aec_blocksize / sizeof(float);
+	}
+
 	spa_pod_builder_init(&b, buffer, sizeof(buffer));
 	params[0] = spa_latency_build(&b, SPA_PARAM_Latency, &latency);
 
@@ -868,7 +940,8 @@ static void sink_process(void *data)
 	struct impl *impl = data;
 	struct pw_buffer *buf;
 	struct spa_data *d;
-	uint32_t i, index, offs, size;
+	const void *src[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i, index, offs, size, n_datas;
 	int32_t avail;
 
 	if ((buf = pw_stream_dequeue_buffer(impl->sink)) == NULL) {
@@ -880,18 +953,26 @@ static void sink_process(void *data)
 	offs = SPA_MIN(d->chunk->offset, d->maxsize);
 	size = SPA_MIN(d->chunk->size, d->maxsize - offs);
 
-	avail = spa_ringbuffer_get_write_index(&impl->play_ring, &index);
+	avail = spa_ringbuffer_get_write_index(&impl->play_ring.ring, &index);
 
-	if (avail + size > impl->play_ringsize) {
+	if (avail + size > impl->play_ring.size) {
 		uint32_t rindex, drop;
 
+		/* the aec thread reads from the delayed ringbuffer, drop the new data */
+		if (impl->aec_loop != NULL) {
+			pw_log_debug("sink ringbuffer xrun %d + %u > %u, dropping buffer",
+					avail, size, impl->play_ring.size);
+			pw_stream_queue_buffer(impl->sink, buf);
+			return;
+		}
+
 		/* Drop enough so we have size bytes left */
-		drop = avail + size - impl->play_ringsize;
+		drop = avail + size - impl->play_ring.size;
 		pw_log_debug("sink ringbuffer xrun %d + %u > %u, dropping %u",
-				avail, size, impl->play_ringsize, drop);
+				avail, size, impl->play_ring.size, drop);
 
-		spa_ringbuffer_get_read_index(&impl->play_ring, &rindex);
-		spa_ringbuffer_read_update(&impl->play_ring, rindex + drop);
+		spa_ringbuffer_get_read_index(&impl->play_ring.ring, &rindex);
+		spa_ringbuffer_read_update(&impl->play_ring.ring, rindex + drop);
 
 		spa_ringbuffer_get_read_index(&impl->play_delayed_ring, &rindex);
 		spa_ringbuffer_read_update(&impl->play_delayed_ring, rindex + drop);
@@ -904,18 +985,17 @@ static void sink_process(void *data)
 		pw_log_debug("Setting AEC block size to %u", impl->aec_blocksize);
 	}
 
-	for (i = 0; i < impl->play_info.channels; i++) {
+	n_datas = SPA_MIN(buf->buffer->n_datas, impl->play_info.channels);
+	for (i = 0; i < n_datas; i++) {
 		/* echo from sink */
 		d = &buf->buffer->datas[i];
 
 		offs = SPA_MIN(d->chunk->offset, d->maxsize);
-		size = SPA_MIN(d->chunk->size, d->maxsize - offs);
-
-		spa_ringbuffer_write_data(&impl->play_ring, impl->play_buffer[i],
-				impl->play_ringsize, index % impl->play_ringsize,
-				SPA_PTROFF(d->data, offs, void), size);
+		size = SPA_MIN(size, SPA_MIN(d->chunk->size, d->maxsize - offs));
+		src[i] = SPA_PTROFF(d->data, offs, void);
 	}
-	spa_ringbuffer_write_update(&impl->play_ring, index + size);
+	pw_planar_ring_write_data(&impl->play_ring, index, src, n_datas, size);
+	spa_ringbuffer_write_update(&impl->play_ring.ring, index + size);
 
 	if (avail + size >= impl->aec_blocksize) {
 		impl->sink_ready = true;
@@ -1099,15 +1179,14 @@ static int setup_streams(struct impl *impl)
 
 	spa_pod_dynamic_builder_clean(&b);
 
-	impl->rec_ringsize = sizeof(float) * impl->max_buffer_size * impl->rec_info.rate / 1000;
-	impl->play_ringsize = sizeof(float) * ((impl->max_buffer_size * impl->play_info.rate / 1000) + impl->buffer_delay);
-	impl->out_ringsize = sizeof(float) * impl->max_buffer_size * impl->out_info.rate / 1000;
-	for (i = 0; i < impl->rec_info.channels; i++)
-		impl->rec_buffer[i] = malloc(impl->rec_ringsize);
-	for (i = 0; i < impl->play_info.channels; i++)
-		impl->play_buffer[i] = malloc(impl->play_ringsize);
-	for (i = 0; i < impl->out_info.channels; i++)
-		impl->out_buffer[i] = malloc(impl->out_ringsize);
+	if ((res = pw_planar_ring_alloc(&impl->rec_ring, impl->rec_info.channels,
+			sizeof(float) * impl->max_buffer_size * impl->rec_info.rate / 1000)) < 0 ||
+	    (res = pw_planar_ring_alloc(&impl->play_ring, impl->play_info.channels,
+			sizeof(float) * ((impl->max_buffer_size * impl->play_info.rate / 1000) +
+				impl->buffer_delay))) < 0 ||
+	    (res = pw_planar_ring_alloc(&impl->out_ring, impl->out_info.channels,
+			sizeof(float) * impl->max_buffer_size * impl->out_info.rate / 1000)) < 0)
+		return res;
 
 	reset_buffers(impl);
 
@@ -1149,7 +1228,6 @@ static const struct pw_proxy_events core_proxy_events = {
 
 static void impl_destroy(struct impl *impl)
 {
-	uint32_t i;
 	if (impl->capture)
 		pw_stream_destroy(impl->capture);
 	if (impl->source)
@@ -1158,6 +1236,8 @@ static void impl_destroy(struct impl *impl)
 		pw_stream_destroy(impl->playback);
 	if (impl->sink)
 		pw_stream_destroy(impl->sink);
+	if (impl->aec_loop)
+		pw_thread_loop_destroy(impl->aec_loop);
 	if (impl->core && impl->do_disconnect)
 		pw_core_disconnect(impl->core);
 	if (impl->spa_handle)
@@ -1167,12 +1247,9 @@ static void impl_destroy(struct impl *impl)
 	pw_properties_free(impl->playback_props);
 	pw_properties_free(impl->sink_props);
 
-	for (i = 0; i < impl->rec_info.channels; i++)
-		free(impl->rec_buffer[i]);
-	for (i = 0; i < impl->play_info.channels; i++)
-		free(impl->play_buffer[i]);
-	for (i = 0; i < impl->out_info.channels; i++)
-		free(impl->out_buffer[i]);
+	pw_planar_ring_free(&impl->rec_ring);
+	pw_planar_ring_free(&impl->play_ring);
+	pw_planar_ring_free(&impl->out_ring);
 
 	free(impl);
 }
@@ -1524,6 +1601,20 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	copy_props(impl, props, PW_KEY_NODE_LATENCY);
 
+	if ((str = pw_properties_get(props, "aec.thread")) != NULL &&
+	    pw_properties_parse_bool(str)) {
+		impl->aec_loop = pw_thread_loop_new("echo-cancel", NULL);
+		if (impl->aec_loop == NULL) {
+			res = -errno;
+			pw_log_error("can't create aec thread: %m");
+			goto error;
+		}
+		if ((res = pw_thread_loop_start(impl->aec_loop)) < 0) {
+			pw_log_error("can't start aec thread: %s", spa_strerror(res));
+			goto error;
+		}
+	}
+
 	impl->core = pw_context_get_object(impl->context, PW_TYPE_INTERFACE_Core);
 	if (impl->core == NULL) {
 		str = pw_properties_get(props, PW_KEY_REMOTE_NAME);
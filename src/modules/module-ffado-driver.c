@@ -154,6 +154,7 @@ struct port_data {
 struct port {
 	enum spa_direction direction;
 	ffado_streaming_stream_type stream_type;
+	uint32_t index;
 	char name[280];
 
 	struct spa_latency_info latency[2];
@@ -161,6 +162,8 @@ struct port {
 	unsigned int is_midi:1;
 	unsigned int cleared:1;
 	void *buffer;
+	void *stream_buffer;		/* the buffer configured in FFADO, either
+					 * buffer or the DSP buffer of the port */
 
 	uint8_t event_byte;
 	uint8_t event_type;
@@ -296,6 +299,37 @@ static void clear_port_buffer(struct port *p, uint32_t n_samples)
 	}
 }
 
+static inline bool is_unity_volume(struct volume *vol, uint32_t ch)
+{
+	return !vol->mute && vol->volumes[ch] == 1.0f;
+}
+
+/* audio ports with unity volume let FFADO read or write the DSP buffer of the
+ * port directly, this avoids a copy of every channel in each cycle. */
+static void set_stream_buffer(struct impl *impl, struct port *p, void *buffer)
+{
+	if (p->stream_buffer == buffer)
+		return;
+	if (p->direction == PW_DIRECTION_INPUT) {
+		if (ffado_streaming_set_playback_stream_buffer(impl->dev, p->index, buffer))
+			pw_log_error("cannot configure port buffer for %s", p->name);
+	} else {
+		if (ffado_streaming_set_capture_stream_buffer(impl->dev, p->index, buffer))
+			pw_log_error("cannot configure port buffer for %s", p->name);
+	}
+	p->stream_buffer = buffer;
+}
+
+static void reset_stream_buffers(struct impl *impl, struct stream *s)
+{
+	uint32_t i;
+	for (i = 0; i < s->n_ports; i++) {
+		struct port *p = s->ports[i];
+		if (p != NULL && p->buffer != NULL)
+			set_stream_buffer(impl, p, p->buffer);
+	}
+}
+
 static inline void fix_midi_event(uint8_t *data, size_t size)
 {
 	/* fixup NoteOn with vel 0 */
@@ -587,15 +621,20 @@ static void sink_process(void *d, struct spa_io_position *position)
 
 		src = pw_filter_get_dsp_buffer(p->data, n_samples);
 		if (src == NULL) {
+			set_stream_buffer(impl, p, p->buffer);
 			clear_port_buffer(p, n_samples);
 			continue;
 		}
 
-		if (SPA_UNLIKELY(p->is_midi))
+		if (SPA_UNLIKELY(p->is_midi)) {
 			midi_to_ffado(p, src, n_samples);
-		else
+		} else if (is_unity_volume(&s->volume, i)) {
+			set_stream_buffer(impl, p, src);
+			continue;
+		} else {
+			set_stream_buffer(impl, p, p->buffer);
 			do_volume(p->buffer, src, &s->volume, i, n_samples);
-
+		}
 		p->cleared = false;
 	}
 	ffado_streaming_transfer_playback_buffers(impl->dev);
@@ -613,6 +652,7 @@ static void silence_playback(struct impl *impl)
 	uint32_t i;
 	struct stream *s = &impl->sink;
 
+	reset_stream_buffers(impl, s);
 	for (i = 0; i < s->n_ports; i++) {
 		struct port *p = s->ports[i];
 		if (p != NULL)
@@ -641,6 +681,20 @@ static void source_process(void *d, struct spa_io_position *position)
 
 	impl->triggered = false;
 
+	for (i = 0; i < s->n_ports; i++) {
+		struct port *p = s->ports[i];
+		float *dst;
+
+		if (p == NULL || p->data == NULL || p->buffer == NULL)
+			continue;
+
+		dst = pw_filter_get_dsp_buffer(p->data, n_samples);
+		if (dst != NULL && !p->is_midi && is_unity_volume(&s->volume, i))
+			set_stream_buffer(impl, p, dst);
+		else
+			set_stream_buffer(impl, p, p->buffer);
+	}
+
 	ffado_streaming_transfer_capture_buffers(impl->dev);
 	s->transfered = true;
 
@@ -648,7 +702,8 @@ static void source_process(void *d, struct spa_io_position *position)
 		struct port *p = s->ports[i];
 		float *dst;
 
-		if (p == NULL || p->data == NULL || p->buffer == NULL)
+		if (p == NULL || p->data == NULL || p->buffer == NULL ||
+		    p->stream_buffer != p->buffer)
 			continue;
 
 		dst = pw_filter_get_dsp_buffer(p->data, n_samples);
@@ -785,6 +840,7 @@ static void setup_stream_ports(struct stream *s)
 	uint32_t i;
 	for (i = 0; i < s->n_ports; i++) {
 		struct port *port = s->ports[i];
+		port->stream_buffer = port->buffer;
 		if (s->direction == PW_DIRECTION_INPUT) {
 			if (ffado_streaming_set_playback_stream_buffer(impl->dev, i, port->buffer))
 				pw_log_error("cannot configure port buffer for %s", port->name);
@@ -985,6 +1041,7 @@ again:
 	impl->sink.transfered = false;
 
 	if (!source_running) {
+		reset_stream_buffers(impl, &impl->source);
 		ffado_streaming_transfer_capture_buffers(impl->dev);
 		impl->source.transfered = true;
 	}
@@ -1139,6 +1196,7 @@ static int probe_ffado_device(struct impl *impl)
 			return -errno;
 
 		port->direction = impl->source.direction;
+		port->index = i;
 		port->stream_type = ffado_streaming_get_capture_stream_type(impl->dev, i);
 		ffado_streaming_get_capture_stream_name(impl->dev, i, name, sizeof(name));
 		snprintf(port->name, sizeof(port->name), "%s_out", name);
@@ -1165,6 +1223,7 @@ static int probe_ffado_device(struct impl *impl)
 			return -errno;
 
 		port->direction = impl->sink.direction;
+		port->index = i;
 		port->stream_type = ffado_streaming_get_playback_stream_type(impl->dev, i);
 		ffado_streaming_get_playback_stream_name(impl->dev, i, name, sizeof(name));
 		snprintf(port->name, sizeof(port->name), "%s_in", name);
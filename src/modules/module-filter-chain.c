@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <dlfcn.h>
 #include <unistd.h>
+#include <semaphore.h>
 
 #include "config.h"
 
@@ -19,6 +20,7 @@
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
 #include <spa/support/cpu.h>
+#include <spa/support/thread.h>
 #include <spa/param/latency-utils.h>
 #include <spa/param/tag-utils.h>
 #include <spa/pod/dynamic.h>
@@ -59,6 +61,13 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * - `filter.graph = []`: a description of the filter graph to run, see below
  * - `capture.props = {}`: properties to be passed to the input stream
  * - `playback.props = {}`: properties to be passed to the output stream
+ * - `filter.silence-timeout`: when the input has been silence and the graph
+ *   produced silence for this many milliseconds, the graph is not run anymore
+ *   until the input is not silence. Default 0, always run the graph.
+ * - `filter.threads`: the number of extra realtime threads used to run
+ *   independent parts of the graph in parallel. Parts are independent when
+ *   there are no links between them, such as the copies of the graph made
+ *   for each group of channels. Default 0, run the graph in one thread.
  *
  * ## Filter graph description
  *
@@ -181,7 +190,8 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  *
  * Use the `copy` plugin if you need to copy a stream input signal to multiple filters.
  *
- * It has one input port "In" and one output port "Out".
+ * It has one input port "In" and one output port "Out". Copies between other
+ * nodes in the graph are removed when the graph is set up and cause no overhead.
  *
  * ### Biquads
  *
@@ -232,6 +242,88 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * }
  *\endcode
  *
+ * ### Parametric equalizer
+ *
+ * The `param_eq` plugin runs a cascade of biquads on up to 8 channels at once.
+ * It is faster than a chain of separate biquad nodes because the channels are
+ * filtered in parallel with SIMD instructions.
+ *
+ * It has input ports "In 1" to "In 8" and output ports "Out 1" to "Out 8".
+ * Unconnected inputs produce silence on their output.
+ *
+ * The filters are configured in the config section. `filters` is applied to
+ * all channels, `filters1` to `filters8` override the filters of one channel.
+ * The type is one of the biquad labels above. `bq_raw` filters take the
+ * coefficients `b0`, `b1`, `b2`, `a0`, `a1` and `a2` instead of `freq`,
+ * `gain` and `q`. There can be at most 64 filters per channel.
+ *
+ *\code{.unparsed}
+ * filter.graph = {
+ *     nodes = [
+ *         {
+ *             type   = builtin
+ *             name   = ...
+ *             label  = param_eq
+ *             config = {
+ *                 filters = [
+ *                     { type = bq_lowshelf, freq = 60, gain = -3.0, q = 0.7 },
+ *                     { type = bq_peaking, freq = 1000, gain = 2.0, q = 1.0 }
+ *                 ]
+ *                 filters2 = [
+ *                     { type = bq_highshelf, freq = 8000, gain = -6.0, q = 0.7 }
+ *                 ]
+ *             }
+ *             ...
+ *         }
+ *     }
+ *     ...
+ * }
+ *\endcode
+ *
+ * ### Crossover
+ *
+ * The `crossover` plugin splits the input into up to 8 bands with
+ * Linkwitz-Riley (LR4) filters. The bands are in phase and sum to a flat
+ * response. All bands are filtered in parallel with SIMD instructions, which
+ * is faster than building the crossover from separate biquad nodes.
+ *
+ * It has an input port "In", output ports "Out 1" to "Out 8" from the lowest
+ * to the highest band and controls "Freq 1" to "Freq 7" with the crossover
+ * frequencies in ascending order. The number of bands is one more than the
+ * number of frequencies before the first frequency of 0.
+ *
+ * ### Compressor
+ *
+ * The `compressor` plugin reduces the level of the signal above a threshold.
+ * It has input ports "In 1" to "In 8" and output ports "Out 1" to "Out 8".
+ * The level of all channels is detected together and the same gain is
+ * applied to all channels.
+ *
+ * The controls are "Threshold" in dB, "Ratio", "Attack" and "Release" in
+ * milliseconds and "Makeup" gain in dB. The "Gain Reduction" output control
+ * contains the largest gain reduction of the last cycle in dB.
+ *
+ * ### Limiter
+ *
+ * The `limiter` plugin keeps the peaks of the signal below a threshold. The
+ * signal is delayed by the lookahead time so that the gain can be reduced
+ * smoothly before the peak arrives. It has the same audio ports as the
+ * compressor and the same channel linking.
+ *
+ * The controls are "Threshold" in dB, "Lookahead" in milliseconds (up to 20)
+ * and "Release" in milliseconds. The "Gain Reduction" output control
+ * contains the largest gain reduction of the last cycle in dB.
+ *
+ * ### Loudness
+ *
+ * The `loudness` plugin measures the loudness of the signal as specified in
+ * EBU R128. It has the same audio ports as the compressor, the audio is passed
+ * through unchanged. All channels are weighted equally.
+ *
+ * The "Momentary", "Short-term" and "Integrated" output controls contain the
+ * loudness in LUFS. The integrated loudness is measured since the node was
+ * activated.
+ *
  * ### Convolver
  *
  * The convolver can be used to apply an impulse response to a signal. It is usually used
@@ -251,6 +343,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  *             config = {
  *                 blocksize = ...
  *                 tailsize = ...
+ *                 tailthread = ...
  *                 gain = ...
  *                 delay = ...
  *                 filename = ...
@@ -258,6 +351,10 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  *                 length = ...
  *                 channel = ...
  *                 resample_quality = ...
+ *                 irs = [
+ *                     { filename = ... gain = ... delay = ... }
+ *                     ...
+ *                 ]
  *             }
  *             ...
  *         }
@@ -270,6 +367,10 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  *               between 64 and 256. When not specified, this value is
  *               computed automatically from the number of samples in the file.
  * - `tailsize` specifies the size of the tail blocks to use in the FFT.
+ * - `tailthread` run the convolution of the part of the IR after 2 * `tailsize`
+ *               in a separate thread, default true. The thread has the time of
+ *               one tail block to complete so that the processing cost of each
+ *               cycle stays the same with long IR files.
  * - `gain`     the overall gain to apply to the IR file.
  * - `delay`    The extra delay (in samples) to add to the IR.
  * - `filename` The IR to load or create. Possible values are:
@@ -287,13 +388,22 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * - `channel` The channel to use from the file as the IR.
  * - `resample_quality` The resample quality in case the IR does not match the graph
  *                      samplerate.
+ * - `irs`     An optional array of up to 16 IR sections. Each section accepts the
+ *             `filename`, `gain`, `delay`, `offset`, `length` and `channel` keys and
+ *             inherits the values not given from the top-level config.
+ *
+ * The convolver also has an "IR" control port that selects the IR section to use,
+ * 0 being the top-level IR. When the control changes, the new IR is loaded and
+ * prepared in the main thread and the output is crossfaded from the old IR to the
+ * new one over one processing cycle, without re-creating the filter.
  *
  * ### Delay
  *
  * The delay can be used to delay a signal in time.
  *
  * The delay has an input port "In" and an output port "Out". It also has
- * a "Delay (s)" control port. It requires a config section in the node declaration
+ * a "Delay (s)" control port. Changes to the delay are crossfaded over one
+ * processing cycle. It requires a config section in the node declaration
  * in this format:
  *
  *\code{.unparsed}
@@ -567,6 +677,8 @@ static const struct spa_dict_item module_props[] = {
 				"( audio.rate=<sample rate> ) "
 				"( audio.channels=<number of channels> ) "
 				"( audio.position=<channel map> ) "
+				"( filter.silence-timeout=<timeout in milliseconds> ) "
+				"( filter.threads=<number of threads> ) "
 				"filter.graph = [ "
 				"    nodes = [ "
 				"        { "
@@ -609,6 +721,7 @@ static const struct spa_dict_item module_props[] = {
 #include <pipewire/pipewire.h>
 
 #define MAX_HNDL 64
+#define MAX_WORKERS 16u
 
 #define DEFAULT_RATE	48000
 
@@ -663,6 +776,7 @@ struct port {
 	struct spa_list link_list;
 	uint32_t n_links;
 	uint32_t external;
+	uint32_t n_consumers;
 
 	float control_data[MAX_HNDL];
 	float *audio_data[MAX_HNDL];
@@ -686,8 +800,10 @@ struct node {
 	void *hndl[MAX_HNDL];
 
 	unsigned int n_deps;
+	uint32_t component;
 	unsigned int visited:1;
 	unsigned int disabled:1;
+	unsigned int elided:1;
 	unsigned int control_changed:1;
 };
 
@@ -708,9 +824,30 @@ struct graph_port {
 	unsigned next:1;
 };
 
+/* n_hndl consecutive instances of a node, more than one when they are
+ * run together with run_multi */
 struct graph_hndl {
 	const struct fc_descriptor *desc;
 	void **hndl;
+	uint32_t n_hndl;
+};
+
+static inline void graph_hndl_run(struct graph_hndl *hndl, unsigned long n_samples)
+{
+	if (hndl->n_hndl > 1)
+		hndl->desc->run_multi(hndl->hndl, hndl->n_hndl, n_samples);
+	else
+		hndl->desc->run(*hndl->hndl, n_samples);
+}
+
+/* runs a range of the graph handles in parallel with the data thread */
+struct graph_worker {
+	struct graph *graph;
+	struct spa_thread *thread;
+	sem_t start;
+
+	uint32_t first_hndl;
+	uint32_t n_hndl;
 };
 
 struct volume {
@@ -742,9 +879,27 @@ struct graph {
 	uint32_t n_hndl;
 	struct graph_hndl *hndl;
 
+	/* the independent parts of the graph are ordered in hndl so that
+	 * the data thread runs the first n_main_hndl and each worker a range
+	 * after that */
+	uint32_t n_main_hndl;
+	uint32_t n_workers;
+	struct graph_worker *workers;
+	struct spa_thread_utils *thread_utils;
+	sem_t workers_done;
+	bool workers_running;
+	unsigned long n_samples;
+
 	uint32_t n_control;
 	struct port **control_port;
 
+	/* audio buffers shared between the ports, see assign_buffers() */
+	uint32_t n_buffers;
+	float **buffers;
+	uint32_t n_free;
+	float **free_buffers;
+	uint32_t *free_pool;
+
 	struct volume capture_volume;
 	struct volume playback_volume;
 
@@ -786,6 +941,11 @@ struct impl {
 
 	long unsigned rate;
 
+	uint32_t silence_timeout;
+	uint64_t silence_samples;
+
+	uint32_t n_threads;
+
 	struct graph graph;
 
 	float *silence_data;
@@ -809,6 +969,102 @@ static void capture_process(void *d)
 	pw_stream_trigger_process(impl->playback);
 }
 
+static bool is_silence(const float *data, uint32_t n_samples)
+{
+	uint32_t i;
+	for (i = 0; i < n_samples; i++)
+		if (data[i] != 0.0f)
+			return false;
+	return true;
+}
+
+static void *graph_worker_thread(void *data)
+{
+	struct graph_worker *w = data;
+	struct graph *graph = w->graph;
+	uint32_t i;
+
+	while (true) {
+		sem_wait(&w->start);
+		if (!graph->workers_running)
+			break;
+		for (i = 0; i < w->n_hndl; i++) {
+			graph_hndl_run(&graph->hndl[w->first_hndl + i], graph->n_samples);
+		}
+		sem_post(&graph->workers_done);
+	}
+	return NULL;
+}
+
+static void graph_stop_workers(struct graph *graph)
+{
+	uint32_t i;
+
+	if (graph->thread_utils == NULL)
+		return;
+
+	graph->workers_running = false;
+	for (i = 0; i < graph->n_workers; i++) {
+		struct graph_worker *w = &graph->workers[i];
+		if (w->thread) {
+			sem_post(&w->start);
+			spa_thread_utils_join(graph->thread_utils, w->thread, NULL);
+			w->thread = NULL;
+		}
+		sem_destroy(&w->start);
+	}
+	sem_destroy(&graph->workers_done);
+	graph->thread_utils = NULL;
+}
+
+/* when the workers can't be started, the data thread runs all of the
+ * graph, the order of graph->hndl is still valid for that */
+static int graph_start_workers(struct graph *graph, struct spa_thread_utils *utils)
+{
+	uint32_t i;
+	int res;
+
+	if (utils == NULL) {
+		pw_log_warn("no thread utils, can't start %u filter threads",
+				graph->n_workers);
+		return -ENOTSUP;
+	}
+	graph->thread_utils = utils;
+	sem_init(&graph->workers_done, 0, 0);
+	for (i = 0; i < graph->n_workers; i++)
+		sem_init(&graph->workers[i].start, 0, 0);
+
+	graph->workers_running = true;
+	for (i = 0; i < graph->n_workers; i++) {
+		struct graph_worker *w = &graph->workers[i];
+
+		w->thread = spa_thread_utils_create(utils, NULL, graph_worker_thread, w);
+		if (w->thread == NULL) {
+			res = -errno;
+			pw_log_error("can't create filter thread: %m");
+			graph_stop_workers(graph);
+			return res;
+		}
+		spa_thread_utils_acquire_rt(utils, w->thread, -1);
+	}
+	pw_log_info("started %u filter threads", graph->n_workers);
+	return 0;
+}
+
+static void graph_run_parallel(struct graph *graph, unsigned long n_samples)
+{
+	uint32_t i;
+
+	graph->n_samples = n_samples;
+	for (i = 0; i < graph->n_workers; i++)
+		sem_post(&graph->workers[i].start);
+
+	for (i = 0; i < graph->n_main_hndl; i++)
+		graph_hndl_run(&graph->hndl[i], n_samples);
+	for (i = 0; i < graph->n_workers; i++)
+		sem_wait(&graph->workers_done);
+}
+
 static void playback_process(void *d)
 {
 	struct impl *impl = d;
@@ -818,6 +1074,8 @@ static void playback_process(void *d)
 	int32_t stride = 0;
 	struct graph_port *port;
 	struct spa_data *bd;
+	bool in_empty = true, skip;
+	uint64_t timeout;
 
 	in = NULL;
 	while (true) {
@@ -856,9 +1114,18 @@ static void playback_process(void *d)
 		}
 		insize = i == 0 ? size : SPA_MIN(insize, size);
 		stride = SPA_MAX(stride, bd->chunk->stride);
+		if (!SPA_FLAG_IS_SET(bd->chunk->flags, SPA_CHUNK_FLAG_EMPTY))
+			in_empty = false;
 	}
 	outsize = insize;
 
+	/* when the input and output were silence for long enough, assume the
+	 * graph has no more tail and skip it while the input is silence */
+	timeout = (uint64_t)impl->silence_timeout * (impl->rate ? impl->rate : DEFAULT_RATE) / 1000;
+	if (!in_empty)
+		impl->silence_samples = 0;
+	skip = in_empty && timeout > 0 && impl->silence_samples >= timeout;
+
 	for (i = 0; i < out->buffer->n_datas; i++) {
 		bd = &out->buffer->datas[i];
 
@@ -866,7 +1133,7 @@ static void playback_process(void *d)
 
 		port = i < graph->n_output ? &graph->output[i] : NULL;
 
-		if (port && port->desc)
+		if (port && port->desc && !skip)
 			port->desc->connect_port(*port->hndl, port->port, bd->data);
 		else
 			memset(bd->data, 0, outsize);
@@ -874,14 +1141,32 @@ static void playback_process(void *d)
 		bd->chunk->offset = 0;
 		bd->chunk->size = outsize;
 		bd->chunk->stride = stride;
+		SPA_FLAG_UPDATE(bd->chunk->flags, SPA_CHUNK_FLAG_EMPTY, skip);
 	}
 
-	pw_log_trace_fp("%p: stride:%d in:%d out:%d requested:%"PRIu64" (%"PRIu64")", impl,
-			stride, insize, outsize, out->requested, out->requested * stride);
+	pw_log_trace_fp("%p: stride:%d in:%d out:%d requested:%"PRIu64" (%"PRIu64") skip:%d", impl,
+			stride, insize, outsize, out->requested, out->requested * stride, skip);
 
-	for (i = 0; i < n_hndl; i++) {
-		struct graph_hndl *hndl = &graph->hndl[i];
-		hndl->desc->run(*hndl->hndl, outsize / sizeof(float));
+	if (skip)
+		goto done;
+
+	if (graph->workers_running) {
+		graph_run_parallel(graph, outsize / sizeof(float));
+	} else {
+		for (i = 0; i < n_hndl; i++)
+			graph_hndl_run(&graph->hndl[i], outsize / sizeof(float));
+	}
+
+	if (in_empty && timeout > 0) {
+		for (i = 0; i < out->buffer->n_datas; i++) {
+			bd = &out->buffer->datas[i];
+			if (!is_silence(bd->data, outsize / sizeof(float)))
+				break;
+		}
+		if (i == out->buffer->n_datas)
+			impl->silence_samples += outsize / sizeof(float);
+		else
+			impl->silence_samples = 0;
 	}
 
 done:
@@ -1160,16 +1445,18 @@ static int parse_params(struct graph *graph, const struct spa_pod *pod)
 
 static void graph_reset(struct graph *graph)
 {
-	uint32_t i;
+	uint32_t i, j;
 	for (i = 0; i < graph->n_hndl; i++) {
 		struct graph_hndl *hndl = &graph->hndl[i];
 		const struct fc_descriptor *d = hndl->desc;
-		if (hndl->hndl == NULL || *hndl->hndl == NULL)
-			continue;
-		if (d->deactivate)
-			d->deactivate(*hndl->hndl);
-		if (d->activate)
-			d->activate(*hndl->hndl);
+		for (j = 0; j < hndl->n_hndl; j++) {
+			if (hndl->hndl == NULL || hndl->hndl[j] == NULL)
+				continue;
+			if (d->deactivate)
+				d->deactivate(hndl->hndl[j]);
+			if (d->activate)
+				d->activate(hndl->hndl[j]);
+		}
 	}
 }
 
@@ -2273,35 +2560,9 @@ static void node_cleanup(struct node *node)
 	}
 }
 
-static int port_ensure_data(struct port *port, uint32_t i, uint32_t max_samples)
-{
-	float *data;
-	if ((data = port->audio_data[i]) == NULL) {
-		data = calloc(max_samples, sizeof(float));
-		if (data == NULL) {
-			pw_log_error("cannot create port data: %m");
-			return -errno;
-		}
-	}
-	port->audio_data[i] = data;
-	return 0;
-}
-
-static void port_free_data(struct port *port, uint32_t i)
-{
-	free(port->audio_data[i]);
-	port->audio_data[i] = NULL;
-}
-
 static void node_free(struct node *node)
 {
-	uint32_t i, j;
-
 	spa_list_remove(&node->link);
-	for (i = 0; i < node->n_hndl; i++) {
-		for (j = 0; j < node->desc->n_output; j++)
-			port_free_data(&node->output_port[j], i);
-	}
 	node_cleanup(node);
 	descriptor_unref(node->desc);
 	free(node->input_port);
@@ -2330,9 +2591,9 @@ static int graph_instantiate(struct graph *graph)
 	struct link *link;
 	struct descriptor *desc;
 	const struct fc_descriptor *d;
-	uint32_t i, j, max_samples = impl->quantum_limit;
+	uint32_t i, j;
 	int res;
-	float *sd = impl->silence_data, *dd = impl->discard_data;
+	float *sd, *dd;
 
 	if (graph->instantiated)
 		return 0;
@@ -2345,8 +2606,12 @@ static int graph_instantiate(struct graph *graph)
 
 		desc = node->desc;
 		d = desc->desc;
-		if (d->flags & FC_DESCRIPTOR_SUPPORTS_NULL_DATA)
+		if (d->flags & FC_DESCRIPTOR_SUPPORTS_NULL_DATA) {
 			sd = dd = NULL;
+		} else {
+			sd = impl->silence_data;
+			dd = impl->discard_data;
+		}
 
 		for (i = 0; i < node->n_hndl; i++) {
 			pw_log_info("instantiate %s %d rate:%lu", d->name, i, impl->rate);
@@ -2362,22 +2627,21 @@ static int graph_instantiate(struct graph *graph)
 
 				spa_list_for_each(link, &port->link_list, input_link) {
 					struct port *peer = link->output;
-					if ((res = port_ensure_data(peer, i, max_samples)) < 0)
-						goto error;
+					float *data = peer->audio_data[i] ? peer->audio_data[i] : sd;
 					pw_log_info("connect input port %s[%d]:%s %p",
-							node->name, i, d->ports[port->p].name,
-							peer->audio_data[i]);
-					d->connect_port(node->hndl[i], port->p, peer->audio_data[i]);
+							node->name, i, d->ports[port->p].name, data);
+					d->connect_port(node->hndl[i], port->p, data);
 				}
 			}
 			for (j = 0; j < desc->n_output; j++) {
+				float *data;
 				port = &node->output_port[j];
-				if ((res = port_ensure_data(port, i, max_samples)) < 0)
-					goto error;
+				/* unlinked outputs are discarded or connected to the
+				 * stream buffers in process */
+				data = port->audio_data[i] ? port->audio_data[i] : dd;
 				pw_log_info("connect output port %s[%d]:%s %p",
-						node->name, i, d->ports[port->p].name,
-						port->audio_data[i]);
-				d->connect_port(node->hndl[i], port->p, port->audio_data[i]);
+						node->name, i, d->ports[port->p].name, data);
+				d->connect_port(node->hndl[i], port->p, data);
 			}
 			for (j = 0; j < desc->n_control; j++) {
 				port = &node->control_port[j];
@@ -2427,6 +2691,272 @@ static void setup_node_controls(struct node *node)
 	}
 }
 
+/* buffers are only shared between ports in the same pool. When the graph
+ * runs in parallel, each independent part has its own pool. */
+static uint32_t buffer_pool(struct graph *graph, struct node *node, uint32_t i)
+{
+	return graph->n_workers > 0 ? node->component * MAX_HNDL + i : 0;
+}
+
+static float *graph_acquire_buffer(struct graph *graph, uint32_t pool, bool clean)
+{
+	float *data;
+	uint32_t i;
+
+	for (i = graph->n_free; i > 0 && !clean; i--) {
+		if (graph->free_pool[i-1] != pool)
+			continue;
+		data = graph->free_buffers[i-1];
+		graph->n_free--;
+		graph->free_buffers[i-1] = graph->free_buffers[graph->n_free];
+		graph->free_pool[i-1] = graph->free_pool[graph->n_free];
+		return data;
+	}
+	if ((data = calloc(graph->impl->quantum_limit, sizeof(float))) == NULL)
+		return NULL;
+	graph->buffers[graph->n_buffers++] = data;
+	return data;
+}
+
+static void graph_release_buffer(struct graph *graph, uint32_t pool, float *data)
+{
+	graph->free_pool[graph->n_free] = pool;
+	graph->free_buffers[graph->n_free++] = data;
+}
+
+/* nodes that support NULL data might not write to their outputs when
+ * none of their inputs has data */
+static bool node_has_input_data(struct node *node)
+{
+	struct port *port;
+	uint32_t i;
+
+	if (!(node->desc->desc->flags & FC_DESCRIPTOR_SUPPORTS_NULL_DATA))
+		return true;
+	for (i = 0; i < node->desc->n_input; i++) {
+		port = &node->input_port[i];
+		if (!spa_list_is_empty(&port->link_list) || port->external != SPA_ID_INVALID)
+			return true;
+	}
+	return node->desc->n_input == 0;
+}
+
+/* the output port that produces the data for a link, looking through
+ * elided copy nodes. Returns NULL when the data is silence or comes
+ * from the capture stream. */
+static struct port *link_source(struct link *link)
+{
+	struct port *port = link->output;
+
+	while (port->node->elided) {
+		struct port *in = &port->node->input_port[0];
+		if (spa_list_is_empty(&in->link_list))
+			return NULL;
+		port = spa_list_first(&in->link_list, struct link, input_link)->output;
+	}
+	return port->node->disabled ? NULL : port;
+}
+
+/* a copy node inside the graph does not need to run when its consumers
+ * can read from its source directly */
+static bool node_can_elide(struct node *node)
+{
+	struct descriptor *desc = node->desc;
+	struct port *in;
+	uint32_t i;
+
+	if (!(desc->desc->flags & FC_DESCRIPTOR_COPY) || node->disabled ||
+	    desc->n_input != 1 || desc->n_control != 0 || desc->n_notify != 0)
+		return false;
+
+	in = &node->input_port[0];
+	if (in->external != SPA_ID_INVALID || spa_list_is_empty(&in->link_list) ||
+	    link_source(spa_list_first(&in->link_list, struct link, input_link)) == NULL)
+		return false;
+
+	for (i = 0; i < desc->n_output; i++) {
+		if (node->output_port[i].external != SPA_ID_INVALID)
+			return false;
+	}
+	return true;
+}
+
+/* give every linked output port a buffer from a pool. Nodes are
+ * visited in the order they run and a buffer goes back to the pool
+ * when all nodes reading it have run, so that a long chain of nodes
+ * only uses a few buffers that stay in the cache. */
+static int assign_buffers(struct graph *graph, struct node **order, uint32_t n_nodes)
+{
+	struct node *node;
+	struct port *port, *src;
+	struct link *link;
+	uint32_t i, j, k, n_ports = 0;
+	bool clean;
+
+	for (i = 0; i < n_nodes; i++)
+		n_ports += order[i]->desc->n_output;
+
+	graph->buffers = calloc(n_ports * MAX_HNDL, sizeof(float *));
+	graph->free_buffers = calloc(n_ports * MAX_HNDL, sizeof(float *));
+	graph->free_pool = calloc(n_ports * MAX_HNDL, sizeof(uint32_t));
+	if (graph->buffers == NULL || graph->free_buffers == NULL ||
+	    graph->free_pool == NULL)
+		return -errno;
+
+	/* count the nodes that read each port */
+	for (i = 0; i < n_nodes; i++) {
+		node = order[i];
+		if (node->disabled || node->elided)
+			continue;
+		for (j = 0; j < node->desc->n_input; j++) {
+			spa_list_for_each(link, &node->input_port[j].link_list, input_link) {
+				if ((src = link_source(link)) != NULL)
+					src->n_consumers++;
+			}
+		}
+	}
+
+	for (i = 0; i < n_nodes; i++) {
+		node = order[i];
+		if (node->disabled)
+			continue;
+
+		/* outputs that might not be written need a zeroed buffer that
+		 * is not shared with other ports */
+		clean = !node_has_input_data(node);
+
+		for (j = 0; j < node->desc->n_output; j++) {
+			port = &node->output_port[j];
+			if (node->elided) {
+				src = link_source(spa_list_first(&node->input_port[0].link_list,
+							struct link, input_link));
+				for (k = 0; k < node->n_hndl; k++)
+					port->audio_data[k] = src->audio_data[k];
+				continue;
+			}
+			if (port->n_consumers == 0)
+				continue;
+			for (k = 0; k < node->n_hndl; k++) {
+				if ((port->audio_data[k] = graph_acquire_buffer(graph,
+						buffer_pool(graph, node, k), clean)) == NULL) {
+					pw_log_error("cannot create port data: %m");
+					return -errno;
+				}
+			}
+		}
+		if (node->elided)
+			continue;
+
+		/* the outputs are acquired first so that they never reuse the
+		 * buffer of an input of the same node */
+		for (j = 0; j < node->desc->n_input; j++) {
+			spa_list_for_each(link, &node->input_port[j].link_list, input_link) {
+				if ((src = link_source(link)) == NULL || --src->n_consumers > 0 ||
+				    !node_has_input_data(src->node))
+					continue;
+				for (k = 0; k < src->node->n_hndl; k++)
+					graph_release_buffer(graph, buffer_pool(graph, src->node, k),
+							src->audio_data[k]);
+			}
+		}
+	}
+	pw_log_info("using %d buffers for %d output ports", graph->n_buffers, n_ports);
+	return 0;
+}
+
+/* split the graph in parts without links between them. Each copy of a
+ * part for the channel groups is also independent. The parts are
+ * divided over the data thread and the workers. */
+static int graph_split(struct graph *graph, struct node **order, uint32_t n_nodes)
+{
+	struct impl *impl = graph->impl;
+	struct node *node;
+	struct link *link;
+	uint32_t i, j, k, c, n_hndl, n_tasks, n_parts, n_total, start, *task_end;
+	bool changed;
+
+	/* label the connected nodes with the lowest index in the order */
+	for (i = 0; i < n_nodes; i++)
+		order[i]->component = i;
+	do {
+		changed = false;
+		spa_list_for_each(link, &graph->link_list, link) {
+			struct node *a = link->output->node, *b = link->input->node;
+			/* the data of a disabled copy comes from the capture stream */
+			if (a->disabled || a->component == b->component)
+				continue;
+			c = SPA_MIN(a->component, b->component);
+			a->component = b->component = c;
+			changed = true;
+		}
+	} while (changed);
+
+	if (impl->n_threads == 0 || graph->n_hndl == 0)
+		return 0;
+
+	n_hndl = order[0]->n_hndl;
+	n_tasks = 0;
+	for (i = 0; i < n_nodes; i++) {
+		if (order[i]->component == i && !order[i]->disabled)
+			n_tasks += n_hndl;
+	}
+	n_parts = SPA_MIN(impl->n_threads + 1, n_tasks);
+	if (n_parts < 2)
+		return 0;
+
+	task_end = calloc(n_tasks, sizeof(uint32_t));
+	graph->workers = calloc(n_parts - 1, sizeof(struct graph_worker));
+	if (task_end == NULL || graph->workers == NULL) {
+		free(task_end);
+		return -errno;
+	}
+
+	/* put the handles of each part after each other, keeping the order
+	 * of the nodes in the part */
+	n_total = 0;
+	n_tasks = 0;
+	for (c = 0; c < n_nodes; c++) {
+		if (order[c]->component != c || order[c]->disabled)
+			continue;
+		for (k = 0; k < n_hndl; k++) {
+			for (i = c; i < n_nodes; i++) {
+				node = order[i];
+				if (node->component != c || node->disabled || node->elided)
+					continue;
+				graph->hndl[n_total].hndl = &node->hndl[k];
+				graph->hndl[n_total].desc = node->desc->desc;
+				graph->hndl[n_total].n_hndl = 1;
+				n_total++;
+			}
+			task_end[n_tasks++] = n_total;
+		}
+	}
+
+	/* give each thread about the same number of handles to run */
+	for (i = 0, j = 0, start = 0; i < n_tasks; i++) {
+		if (i + 1 < n_tasks && task_end[i] * n_parts < (j + 1) * n_total)
+			continue;
+		if (j == 0) {
+			graph->n_main_hndl = task_end[i];
+		} else {
+			struct graph_worker *w = &graph->workers[j-1];
+			w->graph = graph;
+			w->first_hndl = start;
+			w->n_hndl = task_end[i] - start;
+		}
+		start = task_end[i];
+		j++;
+	}
+	free(task_end);
+	graph->n_workers = j - 1;
+	/* the channels of a node are split over the parts, don't batch them */
+	graph->n_hndl = n_total;
+
+	pw_log_info("running %d handles in %d independent parts on %d threads",
+			n_total, n_tasks, graph->n_workers + 1);
+	return 0;
+}
+
 static struct node *find_next_node(struct graph *graph)
 {
 	struct node *node;
@@ -2443,11 +2973,12 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 {
 	struct impl *impl = graph->impl;
 	struct node *node, *first, *last;
+	struct node **order = NULL;
 	struct port *port;
 	struct link *link;
 	struct graph_port *gp;
 	struct graph_hndl *gh;
-	uint32_t i, j, n_nodes, n_input, n_output, n_control, n_hndl = 0;
+	uint32_t i, j, n_nodes, n_order = 0, n_input, n_output, n_control, n_hndl = 0;
 	int res;
 	struct descriptor *desc;
 	const struct fc_descriptor *d;
@@ -2539,6 +3070,7 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 				gp = &graph->input[graph->n_input++];
 				pw_log_info("input port %s[%d]:%s",
 						first->name, i, d->ports[desc->input[j]].name);
+				first->input_port[j].external = graph->n_input - 1;
 				gp->desc = d;
 				gp->hndl = &first->hndl[i];
 				gp->port = desc->input[j];
@@ -2618,6 +3150,7 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 				gp = &graph->output[graph->n_output++];
 				pw_log_info("output port %s[%d]:%s",
 						last->name, i, d->ports[desc->output[j]].name);
+				last->output_port[j].external = graph->n_output - 1;
 				gp->desc = d;
 				gp->hndl = &last->hndl[i];
 				gp->port = desc->output[j];
@@ -2666,6 +3199,11 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 	graph->hndl = calloc(n_nodes * n_hndl, sizeof(struct graph_hndl));
 	graph->n_control = 0;
 	graph->control_port = calloc(n_control, sizeof(struct port *));
+	order = calloc(n_nodes, sizeof(struct node *));
+	if (graph->hndl == NULL || order == NULL) {
+		res = -errno;
+		goto error;
+	}
 	while (true) {
 		if ((node = find_next_node(graph)) == NULL)
 			break;
@@ -2673,11 +3211,24 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 		desc = node->desc;
 		d = desc->desc;
 
-		if (!node->disabled) {
-			for (i = 0; i < n_hndl; i++) {
+		order[n_order++] = node;
+		if (node_can_elide(node)) {
+			pw_log_info("elide copy node %s", node->name);
+			node->elided = true;
+		}
+		if (!node->disabled && !node->elided) {
+			if (d->run_multi != NULL && n_hndl > 1) {
 				gh = &graph->hndl[graph->n_hndl++];
-				gh->hndl = &node->hndl[i];
+				gh->hndl = &node->hndl[0];
 				gh->desc = d;
+				gh->n_hndl = n_hndl;
+			} else {
+				for (i = 0; i < n_hndl; i++) {
+					gh = &graph->hndl[graph->n_hndl++];
+					gh->hndl = &node->hndl[i];
+					gh->desc = d;
+					gh->n_hndl = 1;
+				}
 			}
 		}
 		for (i = 0; i < desc->n_output; i++) {
@@ -2695,8 +3246,11 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 			graph->n_control++;
 		}
 	}
-	res = 0;
+	if ((res = graph_split(graph, order, n_order)) < 0)
+		goto error;
+	res = assign_buffers(graph, order, n_order);
 error:
+	free(order);
 	return res;
 }
 
@@ -2825,6 +3379,12 @@ static void graph_free(struct graph *graph)
 	free(graph->output);
 	free(graph->hndl);
 	free(graph->control_port);
+	while (graph->n_buffers > 0)
+		free(graph->buffers[--graph->n_buffers]);
+	free(graph->buffers);
+	free(graph->free_buffers);
+	free(graph->free_pool);
+	free(graph->workers);
 }
 
 static void core_error(void *data, uint32_t id, int seq, int res, const char *message)
@@ -2880,6 +3440,7 @@ static void impl_destroy(struct impl *impl)
 
 	pw_properties_free(impl->capture_props);
 	pw_properties_free(impl->playback_props);
+	graph_stop_workers(&impl->graph);
 	graph_free(&impl->graph);
 	spa_list_consume(pl, &impl->plugin_func_list, link)
 		free_plugin_func(pl);
@@ -3030,6 +3591,9 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		pw_properties_set(props, PW_KEY_NODE_VIRTUAL, "true");
 	if (pw_properties_get(props, "resample.prefill") == NULL)
 		pw_properties_set(props, "resample.prefill", "true");
+
+	impl->silence_timeout = pw_properties_get_uint32(props, "filter.silence-timeout", 0);
+	impl->n_threads = SPA_MIN(pw_properties_get_uint32(props, "filter.threads", 0), MAX_WORKERS);
 	if (pw_properties_get(props, PW_KEY_NODE_DESCRIPTION) == NULL)
 		pw_properties_setf(props, PW_KEY_NODE_DESCRIPTION, "filter-chain-%u-%u", pid, id);
 
@@ -3092,6 +3656,9 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		pw_log_error("can't load graph: %s", spa_strerror(res));
 		goto error;
 	}
+	if (impl->graph.n_workers > 0)
+		graph_start_workers(&impl->graph,
+				spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils));
 
 	impl->core = pw_context_get_object(impl->context, PW_TYPE_INTERFACE_Core);
 	if (impl->core == NULL) {
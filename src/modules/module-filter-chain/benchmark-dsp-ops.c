@@ -0,0 +1,177 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "benchmark-helper.h"
+#include "dsp-ops.h"
+#include "pffft.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*cmul_func_t) (struct dsp_ops *ops, void *fft,
+		float * SPA_RESTRICT dst, const float * SPA_RESTRICT a,
+		const float * SPA_RESTRICT b, uint32_t len, const float scale);
+typedef void (*cmuladd_func_t) (struct dsp_ops *ops, void *fft,
+		float * dst, const float * src,
+		const float * SPA_RESTRICT a, const float * SPA_RESTRICT b,
+		uint32_t len, const float scale);
+
+struct stats {
+	uint32_t n_samples;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	16384
+
+#define MAX_COUNT 1000
+
+static float *samp_a, *samp_b, *samp_c, *samp_out;
+
+static const int fft_sizes[] = { 128, 512, 2048, 8192, 16384 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(fft_sizes) * 10
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void add_result(const char *name, const char *impl, int n_samples,
+		uint64_t count, uint64_t t1, uint64_t t2)
+{
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void run_test_cmul(const char *impl, cmul_func_t func)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(fft_sizes, s) {
+		void *fft = dsp_fft_new_c(NULL, *s, true);
+		uint64_t i, t1, t2;
+
+		t1 = get_time();
+		for (i = 0; i < MAX_COUNT; i++)
+			func(NULL, fft, samp_out, samp_a, samp_b, *s / 2 + 1, 0.5f);
+		t2 = get_time();
+
+		add_result("fft_cmul", impl, *s, i, t1, t2);
+		dsp_fft_free_c(NULL, fft);
+	}
+}
+
+static void run_test_cmuladd(const char *impl, cmuladd_func_t func)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(fft_sizes, s) {
+		void *fft = dsp_fft_new_c(NULL, *s, true);
+		uint64_t i, t1, t2;
+
+		t1 = get_time();
+		for (i = 0; i < MAX_COUNT; i++)
+			func(NULL, fft, samp_out, samp_c, samp_a, samp_b, *s / 2 + 1, 0.5f);
+		t2 = get_time();
+
+		add_result("fft_cmuladd", impl, *s, i, t1, t2);
+		dsp_fft_free_c(NULL, fft);
+	}
+}
+
+static void test_cmul(void)
+{
+	run_test_cmul("c", dsp_fft_cmul_c);
+#if defined (HAVE_AVX)
+	if (cpu_flags & SPA_CPU_FLAG_AVX)
+		run_test_cmul("avx", dsp_fft_cmul_avx);
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512)
+		run_test_cmul("avx512", dsp_fft_cmul_avx512);
+#endif
+}
+
+static void test_cmuladd(void)
+{
+	run_test_cmuladd("c", dsp_fft_cmuladd_c);
+#if defined (HAVE_AVX)
+	if (cpu_flags & SPA_CPU_FLAG_AVX)
+		run_test_cmuladd("avx", dsp_fft_cmuladd_avx);
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512)
+		run_test_cmuladd("avx512", dsp_fft_cmuladd_avx512);
+#endif
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct benchmark_results br;
+	char key[128];
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	pffft_select_cpu(cpu_flags);
+
+	samp_a = pffft_aligned_malloc(MAX_SAMPLES * 2 * sizeof(float));
+	samp_b = pffft_aligned_malloc(MAX_SAMPLES * 2 * sizeof(float));
+	samp_c = pffft_aligned_malloc(MAX_SAMPLES * 2 * sizeof(float));
+	samp_out = pffft_aligned_malloc(MAX_SAMPLES * 2 * sizeof(float));
+	for (i = 0; i < MAX_SAMPLES * 2; i++) {
+		samp_a[i] = (float)(drand48() - 0.5);
+		samp_b[i] = (float)(drand48() - 0.5);
+		samp_c[i] = (float)(drand48() - 0.5);
+	}
+
+	test_cmul();
+	test_cmuladd();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	benchmark_results_init(&br, "dsp-ops");
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-16.16s %s \t samples %d\n",
+				s->perf, s->name, s->impl, s->n_samples);
+		snprintf(key, sizeof(key), "%s/%s/%d", s->name, s->impl, s->n_samples);
+		benchmark_results_add(&br, key, s->perf);
+	}
+
+	pffft_aligned_free(samp_a);
+	pffft_aligned_free(samp_b);
+	pffft_aligned_free(samp_c);
+	pffft_aligned_free(samp_out);
+	return benchmark_results_finish(&br);
+}
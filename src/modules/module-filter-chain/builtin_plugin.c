@@ -13,8 +13,12 @@
 #include <limits.h>
 
 #include <spa/utils/json.h>
+#include <spa/utils/list.h>
 #include <spa/utils/result.h>
+#include <spa/utils/string.h>
 #include <spa/support/cpu.h>
+#include <spa/support/loop.h>
+#include <spa/support/thread.h>
 #include <spa/plugins/audioconvert/resample.h>
 
 #include <pipewire/log.h>
@@ -27,8 +31,13 @@
 #include "dsp-ops.h"
 
 #define MAX_RATES	32u
+#define MAX_IRS		16u
+#define MAX_SAMPLES	8192u
 
 static struct dsp_ops *dsp_ops;
+static struct spa_thread_utils *thread_utils;
+static struct spa_loop *data_loop;
+static struct spa_loop *main_loop;
 
 struct builtin {
 	unsigned long rate;
@@ -477,13 +486,8 @@ static void bq_activate(void * Instance)
 	}
 }
 
-static void bq_run(void *Instance, unsigned long samples)
+static void bq_update(struct builtin *impl)
 {
-	struct builtin *impl = Instance;
-	struct biquad *bq = &impl->bq;
-	float *out = impl->port[0];
-	float *in = impl->port[1];
-
 	if (impl->type == BQ_NONE) {
 		float b0, b1, b2, a0, a1, a2;
 		b0 = impl->port[5][0];
@@ -503,7 +507,40 @@ static void bq_run(void *Instance, unsigned long samples)
 		if (impl->freq != freq || impl->Q != Q || impl->gain != gain)
 			bq_freq_update(impl, impl->type, freq, Q, gain);
 	}
-	dsp_ops_biquad_run(dsp_ops, bq, out, in, samples);
+}
+
+static void bq_run(void *Instance, unsigned long samples)
+{
+	struct builtin *impl = Instance;
+	bq_update(impl);
+	dsp_ops_biquad_run(dsp_ops, &impl->bq, impl->port[0], impl->port[1], samples);
+}
+
+#define BQ_MULTI	8u
+
+/* run the channels together so that the biquads can be run in SIMD lanes */
+static void bq_run_multi(void **Instances, uint32_t n_instances, unsigned long samples)
+{
+	struct biquad bq[BQ_MULTI];
+	float *out[BQ_MULTI];
+	const float *in[BQ_MULTI];
+	uint32_t i, j, n;
+
+	for (i = 0; i < n_instances; i += n) {
+		n = SPA_MIN(n_instances - i, BQ_MULTI);
+		for (j = 0; j < n; j++) {
+			struct builtin *impl = Instances[i + j];
+			bq_update(impl);
+			bq[j] = impl->bq;
+			out[j] = impl->port[0];
+			in[j] = impl->port[1];
+		}
+		dsp_ops_biquadn_run(dsp_ops, bq, 1, 1, out, in, n, samples);
+		for (j = 0; j < n; j++) {
+			struct builtin *impl = Instances[i + j];
+			impl->bq = bq[j];
+		}
+	}
 }
 
 /** bq_lowpass */
@@ -517,6 +554,7 @@ static const struct fc_descriptor bq_lowpass_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -531,6 +569,7 @@ static const struct fc_descriptor bq_highpass_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -545,6 +584,7 @@ static const struct fc_descriptor bq_bandpass_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -559,6 +599,7 @@ static const struct fc_descriptor bq_lowshelf_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -573,6 +614,7 @@ static const struct fc_descriptor bq_highshelf_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -587,6 +629,7 @@ static const struct fc_descriptor bq_peaking_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -601,6 +644,7 @@ static const struct fc_descriptor bq_notch_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -616,6 +660,7 @@ static const struct fc_descriptor bq_allpass_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
@@ -630,17 +675,98 @@ static const struct fc_descriptor bq_raw_desc = {
 	.connect_port = builtin_connect_port,
 	.activate = bq_activate,
 	.run = bq_run,
+	.run_multi = bq_run_multi,
 	.cleanup = builtin_cleanup,
 };
 
 /** convolve */
+struct ir_cache {
+	struct spa_list link;
+	int ref;
+	char *key;
+	float *samples;
+	int n_samples;
+};
+
+/* loaded and resampled IRs, shared by all convolvers with the same IR
+ * config so that instantiating the same filter-chain again does not
+ * load and resample the files again */
+static struct spa_list ir_cache_list = { &ir_cache_list, &ir_cache_list };
+
+/* the settings of one IR */
+struct ir_config {
+	char *filenames[MAX_RATES];
+	float gain;
+	int delay;
+	int offset;
+	int length;
+	int channel;
+};
+
 struct convolver_impl {
 	unsigned long rate;
 	float *port[64];
 
+	int blocksize;
+	int tailsize;
+	bool tailthread;
+	int resample_quality;
+
+	uint32_t n_irs;
+	struct ir_config irs[MAX_IRS];
+	uint32_t selected;
+
+	struct ir_cache *ir;
 	struct convolver *conv;
+
+	/* the IR to switch to, prepared on the main thread and swapped
+	 * into next in the data thread. run crossfades to it */
+	struct ir_cache *prep_ir;
+	struct convolver *prep_conv;
+	struct ir_cache *next_ir;
+	struct convolver *next_conv;
+	float *tmp;
 };
 
+static struct ir_cache *ir_cache_find(const char *key)
+{
+	struct ir_cache *c;
+	spa_list_for_each(c, &ir_cache_list, link) {
+		if (spa_streq(c->key, key)) {
+			c->ref++;
+			return c;
+		}
+	}
+	return NULL;
+}
+
+static struct ir_cache *ir_cache_add(const char *key, float *samples, int n_samples)
+{
+	struct ir_cache *c;
+
+	if ((c = calloc(1, sizeof(*c))) == NULL)
+		return NULL;
+	if ((c->key = strdup(key)) == NULL) {
+		free(c);
+		return NULL;
+	}
+	c->ref = 1;
+	c->samples = samples;
+	c->n_samples = n_samples;
+	spa_list_append(&ir_cache_list, &c->link);
+	return c;
+}
+
+static void ir_cache_unref(struct ir_cache *c)
+{
+	if (c == NULL || --c->ref > 0)
+		return;
+	spa_list_remove(&c->link);
+	free(c->samples);
+	free(c->key);
+	free(c);
+}
+
 #ifdef HAVE_SNDFILE
 static float *read_samples_from_sf(SNDFILE *f, SF_INFO info, float gain, int delay,
 		int offset, int length, int channel, long unsigned *rate, int *n_samples) {
@@ -858,22 +984,194 @@ error:
 #endif
 }
 
+static void ir_config_clear(struct ir_config *c)
+{
+	uint32_t i;
+	for (i = 0; i < MAX_RATES; i++) {
+		free(c->filenames[i]);
+		c->filenames[i] = NULL;
+	}
+}
+
+static int ir_config_copy(struct ir_config *dst, const struct ir_config *src)
+{
+	uint32_t i;
+
+	*dst = *src;
+	for (i = 0; i < MAX_RATES; i++) {
+		if (src->filenames[i] && (dst->filenames[i] = strdup(src->filenames[i])) == NULL) {
+			ir_config_clear(dst);
+			return -errno;
+		}
+	}
+	return 0;
+}
+
+/* parse the value of key when it is an IR setting, returns 0 when key
+ * is not an IR setting */
+static int ir_config_parse(struct ir_config *c, const char *key, struct spa_json *it)
+{
+	struct spa_json sub;
+	const char *val;
+	char v[256];
+	uint32_t i = 0;
+	int len;
+
+	if (spa_streq(key, "gain")) {
+		if (spa_json_get_float(it, &c->gain) <= 0) {
+			pw_log_error("convolver:gain requires a number");
+			return -EINVAL;
+		}
+	}
+	else if (spa_streq(key, "delay")) {
+		if (spa_json_get_int(it, &c->delay) <= 0) {
+			pw_log_error("convolver:delay requires a number");
+			return -EINVAL;
+		}
+	}
+	else if (spa_streq(key, "filename")) {
+		if ((len = spa_json_next(it, &val)) <= 0) {
+			pw_log_error("convolver:filename requires a string or an array");
+			return -EINVAL;
+		}
+		ir_config_clear(c);
+		if (spa_json_is_array(val, len)) {
+			spa_json_enter(it, &sub);
+			while (spa_json_get_string(&sub, v, sizeof(v)) > 0 &&
+				i < SPA_N_ELEMENTS(c->filenames)) {
+					c->filenames[i] = strdup(v);
+					i++;
+			}
+		}
+		else if (spa_json_parse_stringn(val, len, v, sizeof(v)) <= 0) {
+			pw_log_error("convolver:filename requires a string or an array");
+			return -EINVAL;
+		} else {
+			c->filenames[0] = strdup(v);
+		}
+	}
+	else if (spa_streq(key, "offset")) {
+		if (spa_json_get_int(it, &c->offset) <= 0) {
+			pw_log_error("convolver:offset requires a number");
+			return -EINVAL;
+		}
+	}
+	else if (spa_streq(key, "length")) {
+		if (spa_json_get_int(it, &c->length) <= 0) {
+			pw_log_error("convolver:length requires a number");
+			return -EINVAL;
+		}
+	}
+	else if (spa_streq(key, "channel")) {
+		if (spa_json_get_int(it, &c->channel) <= 0) {
+			pw_log_error("convolver:channel requires a number");
+			return -EINVAL;
+		}
+	}
+	else
+		return 0;
+	return 1;
+}
+
+/* load an IR or find it in the cache */
+static struct ir_cache *ir_load(const struct ir_config *c, unsigned long SampleRate,
+		int resample_quality)
+{
+	struct ir_cache *ir;
+	struct spa_strbuf buf;
+	char ir_key[MAX_RATES * 256 + 256];
+	float *samples;
+	int n_samples = 0, delay, offset;
+	unsigned long rate;
+	uint32_t i;
+
+	if (c->filenames[0] == NULL) {
+		pw_log_error("convolver:filename was not given");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	delay = SPA_MAX(c->delay, 0);
+	offset = SPA_MAX(c->offset, 0);
+
+	spa_strbuf_init(&buf, ir_key, sizeof(ir_key));
+	for (i = 0; i < MAX_RATES && c->filenames[i]; i++)
+		spa_strbuf_append(&buf, "%s:", c->filenames[i]);
+	spa_strbuf_append(&buf, "%g:%d:%d:%d:%d:%lu:%d", c->gain, delay, offset,
+			c->length, c->channel, SampleRate, resample_quality);
+
+	if ((ir = ir_cache_find(ir_key)) != NULL) {
+		pw_log_info("using cached IR %s", ir_key);
+		return ir;
+	}
+
+	if (spa_streq(c->filenames[0], "/hilbert")) {
+		samples = create_hilbert(c->filenames[0], c->gain, delay, offset,
+				c->length, &n_samples);
+	} else if (spa_streq(c->filenames[0], "/dirac")) {
+		samples = create_dirac(c->filenames[0], c->gain, delay, offset,
+				c->length, &n_samples);
+	} else {
+		rate = SampleRate;
+		samples = read_closest((char **)c->filenames, c->gain, delay, offset,
+				c->length, c->channel, &rate, &n_samples);
+		if (samples != NULL && rate != SampleRate)
+			samples = resample_buffer(samples, &n_samples,
+					rate, SampleRate, resample_quality);
+	}
+	if (samples == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+	if ((ir = ir_cache_add(ir_key, samples, n_samples)) == NULL)
+		free(samples);
+	return ir;
+}
+
+static struct convolver *ir_make_convolver(struct convolver_impl *impl, struct ir_cache *ir)
+{
+	struct convolver *conv;
+	int res;
+
+	conv = convolver_new(dsp_ops, impl->blocksize, impl->tailsize,
+			ir->samples, ir->n_samples);
+	if (conv == NULL)
+		return NULL;
+
+	if (impl->tailthread && (res = convolver_start_thread(conv, thread_utils)) < 0)
+		pw_log_warn("convolver: can't start tail thread: %s", spa_strerror(res));
+	return conv;
+}
+
+static void convolver_cleanup(void * Instance)
+{
+	struct convolver_impl *impl = Instance;
+	uint32_t i;
+
+	if (impl->conv)
+		convolver_free(impl->conv);
+	if (impl->next_conv)
+		convolver_free(impl->next_conv);
+	if (impl->prep_conv)
+		convolver_free(impl->prep_conv);
+	ir_cache_unref(impl->ir);
+	ir_cache_unref(impl->next_ir);
+	ir_cache_unref(impl->prep_ir);
+	for (i = 0; i < MAX_IRS; i++)
+		ir_config_clear(&impl->irs[i]);
+	free(impl->tmp);
+	free(impl);
+}
+
 static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 		unsigned long SampleRate, int index, const char *config)
 {
 	struct convolver_impl *impl;
-	float *samples;
-	int offset = 0, length = 0, channel = index, n_samples = 0, len;
-	uint32_t i = 0;
-	struct spa_json it[3];
+	struct ir_config def;
+	struct spa_json it[3], irs, *pirs = NULL;
 	const char *val;
-	char key[256], v[256];
-	char *filenames[MAX_RATES] = { 0 };
-	int blocksize = 0, tailsize = 0;
-	int delay = 0;
-	int resample_quality = RESAMPLE_DEFAULT_QUALITY;
-	float gain = 1.0f;
-	unsigned long rate;
+	char key[256];
+	int res, n_samples;
 
 	errno = EINVAL;
 	if (config == NULL) {
@@ -887,139 +1185,107 @@ static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 		return NULL;
 	}
 
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+	impl->tailthread = true;
+	impl->resample_quality = RESAMPLE_DEFAULT_QUALITY;
+
+	spa_zero(def);
+	def.gain = 1.0f;
+	def.channel = index;
+
 	while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+		if ((res = ir_config_parse(&def, key, &it[1])) < 0)
+			goto error;
+		else if (res > 0)
+			continue;
+
 		if (spa_streq(key, "blocksize")) {
-			if (spa_json_get_int(&it[1], &blocksize) <= 0) {
+			if (spa_json_get_int(&it[1], &impl->blocksize) <= 0) {
 				pw_log_error("convolver:blocksize requires a number");
-				return NULL;
+				goto error;
 			}
 		}
 		else if (spa_streq(key, "tailsize")) {
-			if (spa_json_get_int(&it[1], &tailsize) <= 0) {
+			if (spa_json_get_int(&it[1], &impl->tailsize) <= 0) {
 				pw_log_error("convolver:tailsize requires a number");
-				return NULL;
-			}
-		}
-		else if (spa_streq(key, "gain")) {
-			if (spa_json_get_float(&it[1], &gain) <= 0) {
-				pw_log_error("convolver:gain requires a number");
-				return NULL;
-			}
-		}
-		else if (spa_streq(key, "delay")) {
-			if (spa_json_get_int(&it[1], &delay) <= 0) {
-				pw_log_error("convolver:delay requires a number");
-				return NULL;
-			}
-		}
-		else if (spa_streq(key, "filename")) {
-			if ((len = spa_json_next(&it[1], &val)) <= 0) {
-				pw_log_error("convolver:filename requires a string or an array");
-				return NULL;
-			}
-			if (spa_json_is_array(val, len)) {
-				spa_json_enter(&it[1], &it[2]);
-				while (spa_json_get_string(&it[2], v, sizeof(v)) > 0 &&
-					i < SPA_N_ELEMENTS(filenames)) {
-						filenames[i] = strdup(v);
-						i++;
-				}
-			}
-			else if (spa_json_parse_stringn(val, len, v, sizeof(v)) <= 0) {
-				pw_log_error("convolver:filename requires a string or an array");
-				return NULL;
-			} else {
-				filenames[0] = strdup(v);
-			}
-		}
-		else if (spa_streq(key, "offset")) {
-			if (spa_json_get_int(&it[1], &offset) <= 0) {
-				pw_log_error("convolver:offset requires a number");
-				return NULL;
-			}
-		}
-		else if (spa_streq(key, "length")) {
-			if (spa_json_get_int(&it[1], &length) <= 0) {
-				pw_log_error("convolver:length requires a number");
-				return NULL;
+				goto error;
 			}
 		}
-		else if (spa_streq(key, "channel")) {
-			if (spa_json_get_int(&it[1], &channel) <= 0) {
-				pw_log_error("convolver:channel requires a number");
-				return NULL;
+		else if (spa_streq(key, "tailthread")) {
+			if (spa_json_get_bool(&it[1], &impl->tailthread) <= 0) {
+				pw_log_error("convolver:tailthread requires a boolean");
+				goto error;
 			}
 		}
 		else if (spa_streq(key, "resample_quality")) {
-			if (spa_json_get_int(&it[1], &resample_quality) <= 0) {
+			if (spa_json_get_int(&it[1], &impl->resample_quality) <= 0) {
 				pw_log_error("convolver:resample_quality requires a number");
-				return NULL;
+				goto error;
 			}
 		}
+		else if (spa_streq(key, "irs")) {
+			if (spa_json_enter_array(&it[1], &irs) <= 0) {
+				pw_log_error("convolver:irs requires an array");
+				goto error;
+			}
+			pirs = &irs;
+		}
 		else {
 			pw_log_warn("convolver: ignoring config key: '%s'", key);
 			if (spa_json_next(&it[1], &val) < 0)
 				break;
 		}
 	}
-	if (filenames[0] == NULL) {
-		pw_log_error("convolver:filename was not given");
-		return NULL;
-	}
 
-	if (delay < 0)
-		delay = 0;
-	if (offset < 0)
-		offset = 0;
+	/* the irs inherit the settings from the top level */
+	if (pirs != NULL) {
+		while (impl->n_irs < MAX_IRS &&
+		    spa_json_enter_object(pirs, &it[2]) > 0) {
+			struct ir_config *c = &impl->irs[impl->n_irs++];
 
-	if (spa_streq(filenames[0], "/hilbert")) {
-		samples = create_hilbert(filenames[0], gain, delay, offset,
-				length, &n_samples);
-	} else if (spa_streq(filenames[0], "/dirac")) {
-		samples = create_dirac(filenames[0], gain, delay, offset,
-				length, &n_samples);
-	} else {
-		rate = SampleRate;
-		samples = read_closest(filenames, gain, delay, offset,
-				length, channel, &rate, &n_samples);
-		if (samples != NULL && rate != SampleRate)
-			samples = resample_buffer(samples, &n_samples,
-					rate, SampleRate, resample_quality);
+			if (ir_config_copy(c, &def) < 0)
+				goto error;
+			while (spa_json_get_string(&it[2], key, sizeof(key)) > 0) {
+				if ((res = ir_config_parse(c, key, &it[2])) < 0)
+					goto error;
+				else if (res == 0) {
+					pw_log_warn("convolver: ignoring irs key: '%s'", key);
+					if (spa_json_next(&it[2], &val) < 0)
+						break;
+				}
+			}
+		}
 	}
-
-	for (i = 0; i < MAX_RATES; i++)
-		if (filenames[i])
-			free(filenames[i]);
-
-	if (samples == NULL) {
-		errno = ENOENT;
-		return NULL;
+	if (impl->n_irs == 0) {
+		impl->irs[0] = def;
+		spa_zero(def);
+		impl->n_irs = 1;
 	}
+	ir_config_clear(&def);
 
-	if (blocksize <= 0)
-		blocksize = SPA_CLAMP(n_samples, 64, 256);
-	if (tailsize <= 0)
-		tailsize = SPA_CLAMP(4096, blocksize, 32768);
-
-	pw_log_info("using n_samples:%u %d:%d blocksize", n_samples,
-			blocksize, tailsize);
-
-	impl = calloc(1, sizeof(*impl));
-	if (impl == NULL)
+	if ((impl->ir = ir_load(&impl->irs[0], SampleRate, impl->resample_quality)) == NULL)
 		goto error;
 
-	impl->rate = SampleRate;
+	n_samples = impl->ir->n_samples;
+	if (impl->blocksize <= 0)
+		impl->blocksize = SPA_CLAMP(n_samples, 64, 256);
+	if (impl->tailsize <= 0)
+		impl->tailsize = SPA_CLAMP(4096, impl->blocksize, 32768);
 
-	impl->conv = convolver_new(dsp_ops, blocksize, tailsize, samples, n_samples);
-	if (impl->conv == NULL)
-		goto error;
+	pw_log_info("using n_samples:%u %d:%d blocksize, %u irs", n_samples,
+			impl->blocksize, impl->tailsize, impl->n_irs);
 
-	free(samples);
+	if ((impl->conv = ir_make_convolver(impl, impl->ir)) == NULL)
+		goto error;
 
 	return impl;
 error:
-	free(samples);
-	free(impl);
+	ir_config_clear(&def);
+	convolver_cleanup(impl);
 	return NULL;
 }
 
@@ -1030,14 +1296,6 @@ static void convolver_connect_port(void * Instance, unsigned long Port,
 	impl->port[Port] = DataLocation;
 }
 
-static void convolver_cleanup(void * Instance)
-{
-	struct convolver_impl *impl = Instance;
-	if (impl->conv)
-		convolver_free(impl->conv);
-	free(impl);
-}
-
 static struct fc_port convolve_ports[] = {
 	{ .index = 0,
 	  .name = "Out",
@@ -1047,6 +1305,11 @@ static struct fc_port convolve_ports[] = {
 	  .name = "In",
 	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
 	},
+	{ .index = 2,
+	  .name = "IR",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 0.0f, .min = 0.0f, .max = MAX_IRS - 1
+	},
 };
 
 static void convolver_deactivate(void * Instance)
@@ -1055,20 +1318,119 @@ static void convolver_deactivate(void * Instance)
 	convolver_reset(impl->conv);
 }
 
+struct free_data {
+	struct convolver *conv;
+	struct ir_cache *ir;
+};
+
+static int
+do_free(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
+		size_t size, void *user_data)
+{
+	const struct free_data *fd = data;
+	if (fd->conv)
+		convolver_free(fd->conv);
+	ir_cache_unref(fd->ir);
+	return 0;
+}
+
+static int
+do_switch(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
+		size_t size, void *user_data)
+{
+	struct convolver_impl *impl = user_data;
+	SPA_SWAP(impl->next_conv, impl->prep_conv);
+	SPA_SWAP(impl->next_ir, impl->prep_ir);
+	return 0;
+}
+
+/* load the selected IR on the main thread, the data thread switches to it
+ * in the next cycle */
+static void convolver_control_changed(void * Instance)
+{
+	struct convolver_impl *impl = Instance;
+	uint32_t selected;
+
+	if (impl->port[2] == NULL)
+		return;
+
+	selected = (uint32_t)SPA_CLAMPF(impl->port[2][0], 0.0f, impl->n_irs - 1.0f);
+	if (selected == impl->selected)
+		return;
+
+	if (impl->tmp == NULL &&
+	    (impl->tmp = calloc(MAX_SAMPLES, sizeof(float))) == NULL)
+		return;
+
+	if ((impl->prep_ir = ir_load(&impl->irs[selected], impl->rate,
+				impl->resample_quality)) == NULL) {
+		pw_log_error("convolver: can't load IR %u: %m", selected);
+		return;
+	}
+	if ((impl->prep_conv = ir_make_convolver(impl, impl->prep_ir)) == NULL) {
+		pw_log_error("convolver: can't create convolver for IR %u: %m", selected);
+		ir_cache_unref(impl->prep_ir);
+		impl->prep_ir = NULL;
+		return;
+	}
+	pw_log_info("convolver: switch to IR %u", selected);
+	impl->selected = selected;
+
+	if (data_loop)
+		spa_loop_invoke(data_loop, do_switch, 1, NULL, 0, true, impl);
+	else
+		do_switch(NULL, false, 0, NULL, 0, impl);
+
+	/* a switch that was not done yet */
+	if (impl->prep_conv)
+		convolver_free(impl->prep_conv);
+	ir_cache_unref(impl->prep_ir);
+	impl->prep_conv = NULL;
+	impl->prep_ir = NULL;
+}
+
 static void convolve_run(void * Instance, unsigned long SampleCount)
 {
 	struct convolver_impl *impl = Instance;
-	convolver_run(impl->conv, impl->port[1], impl->port[0], SampleCount);
+	float *in = impl->port[1], *out = impl->port[0];
+	struct free_data free_data;
+	unsigned long offs, len, n;
+
+	if (impl->next_conv == NULL) {
+		convolver_run(impl->conv, in, out, SampleCount);
+		return;
+	}
+
+	/* crossfade from the old to the new IR in this cycle */
+	for (offs = 0; offs < SampleCount; offs += len) {
+		len = SPA_MIN(SampleCount - offs, MAX_SAMPLES);
+		convolver_run(impl->conv, in + offs, out + offs, len);
+		convolver_run(impl->next_conv, in + offs, impl->tmp, len);
+		for (n = 0; n < len; n++) {
+			float t = (float)(offs + n) / SampleCount;
+			out[offs + n] = out[offs + n] * (1.0f - t) + impl->tmp[n] * t;
+		}
+	}
+	free_data.conv = impl->conv;
+	free_data.ir = impl->ir;
+	impl->conv = impl->next_conv;
+	impl->ir = impl->next_ir;
+	impl->next_conv = NULL;
+	impl->next_ir = NULL;
+
+	if (main_loop)
+		spa_loop_invoke(main_loop, do_free, 1, &free_data, sizeof(free_data), false, impl);
 }
 
 static const struct fc_descriptor convolve_desc = {
 	.name = "convolver",
 
-	.n_ports = 2,
+	.n_ports = 3,
 	.ports = convolve_ports,
 
 	.instantiate = convolver_instantiate,
 	.connect_port = convolver_connect_port,
+	.control_changed = convolver_control_changed,
 	.deactivate = convolver_deactivate,
 	.run = convolve_run,
 	.cleanup = convolver_cleanup,
@@ -1134,6 +1496,7 @@ static void *delay_instantiate(const struct fc_descriptor * Descriptor,
 		return NULL;
 
 	impl->rate = SampleRate;
+	impl->delay = -1.0f;
 	impl->buffer_samples = (uint32_t)(max_delay * impl->rate);
 	pw_log_info("max-delay:%f seconds rate:%lu samples:%d", max_delay, impl->rate, impl->buffer_samples);
 
@@ -1160,26 +1523,42 @@ static void delay_run(void * Instance, unsigned long SampleCount)
 	float *in = impl->port[1], *out = impl->port[0];
 	float delay = impl->port[2][0];
 	unsigned long n;
-	uint32_t r, w;
+	uint32_t r, r1, w, d, d1, size = impl->buffer_samples;
 
+	d = d1 = impl->delay_samples;
 	if (delay != impl->delay) {
-		impl->delay_samples = SPA_CLAMP((uint32_t)(delay * impl->rate), 0u, impl->buffer_samples-1);
+		d1 = SPA_CLAMP((uint32_t)(delay * impl->rate), 0u, size-1);
+		/* no crossfade for the first cycle */
+		if (impl->delay < 0.0f)
+			d = d1;
 		impl->delay = delay;
 	}
-	r = impl->ptr;
-	w = impl->ptr + impl->delay_samples;
-	if (w >= impl->buffer_samples)
-		w -= impl->buffer_samples;
+	w = impl->ptr;
 
-	for (n = 0; n < SampleCount; n++) {
-		impl->buffer[w] = in[n];
-		out[n] = impl->buffer[r];
-		if (++r >= impl->buffer_samples)
-			r = 0;
-		if (++w >= impl->buffer_samples)
-			w = 0;
+	if (d == d1) {
+		r = w >= d ? w - d : w + size - d;
+		for (n = 0; n < SampleCount; n++) {
+			impl->buffer[w] = in[n];
+			out[n] = impl->buffer[r];
+			if (++r >= size)
+				r = 0;
+			if (++w >= size)
+				w = 0;
+		}
+	} else {
+		/* crossfade from the old to the new delay to avoid a click */
+		for (n = 0; n < SampleCount; n++) {
+			float t = (float)n / SampleCount;
+			impl->buffer[w] = in[n];
+			r = w >= d ? w - d : w + size - d;
+			r1 = w >= d1 ? w - d1 : w + size - d1;
+			out[n] = impl->buffer[r] * (1.0f - t) + impl->buffer[r1] * t;
+			if (++w >= size)
+				w = 0;
+		}
 	}
-	impl->ptr = r;
+	impl->delay_samples = d1;
+	impl->ptr = w;
 }
 
 static struct fc_port delay_ports[] = {
@@ -1680,6 +2059,1367 @@ static const struct fc_descriptor sine_desc = {
 	.cleanup = builtin_cleanup,
 };
 
+/** param_eq */
+#define PARAM_EQ_CHANNELS	8
+#define PARAM_EQ_MAX		64
+
+struct param_eq_impl {
+	unsigned long rate;
+	float *port[PARAM_EQ_CHANNELS * 2];
+
+	uint32_t n_bq;
+	uint32_t n_chan_bq[PARAM_EQ_CHANNELS];
+	struct biquad bq[PARAM_EQ_CHANNELS * PARAM_EQ_MAX];
+};
+
+/* parse an array of filters into the cascade of one channel */
+static int param_eq_parse_filters(struct param_eq_impl *impl, struct spa_json *it,
+		struct biquad *bq, uint32_t *n_bq)
+{
+	struct spa_json obj;
+	char key[256], type[256];
+	const char *val;
+	uint32_t n = 0;
+
+	while (spa_json_enter_object(it, &obj) > 0) {
+		float freq = 0.0f, gain = 0.0f, q = 1.0f;
+		float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+		float a0 = 1.0f, a1 = 0.0f, a2 = 0.0f;
+		int bq_type;
+
+		spa_scnprintf(type, sizeof(type), "bq_peaking");
+
+		while (spa_json_get_string(&obj, key, sizeof(key)) > 0) {
+			float *f = NULL;
+
+			if (spa_streq(key, "type")) {
+				if (spa_json_get_string(&obj, type, sizeof(type)) <= 0) {
+					pw_log_error("param_eq:type requires a string");
+					return -EINVAL;
+				}
+				continue;
+			}
+			else if (spa_streq(key, "freq"))
+				f = &freq;
+			else if (spa_streq(key, "gain"))
+				f = &gain;
+			else if (spa_streq(key, "q"))
+				f = &q;
+			else if (spa_streq(key, "b0"))
+				f = &b0;
+			else if (spa_streq(key, "b1"))
+				f = &b1;
+			else if (spa_streq(key, "b2"))
+				f = &b2;
+			else if (spa_streq(key, "a0"))
+				f = &a0;
+			else if (spa_streq(key, "a1"))
+				f = &a1;
+			else if (spa_streq(key, "a2"))
+				f = &a2;
+
+			if (f == NULL) {
+				pw_log_warn("param_eq: ignoring filter key: '%s'", key);
+				if (spa_json_next(&obj, &val) < 0)
+					break;
+			} else if (spa_json_get_float(&obj, f) <= 0) {
+				pw_log_error("param_eq:%s requires a number", key);
+				return -EINVAL;
+			}
+		}
+		if (n == PARAM_EQ_MAX) {
+			pw_log_error("param_eq: too many filters, max %d", PARAM_EQ_MAX);
+			return -ENOSPC;
+		}
+
+		bq_type = bq_type_from_name(type);
+		if (bq_type == BQ_NONE && !spa_streq(type, "bq_raw")) {
+			pw_log_error("param_eq: unknown filter type '%s'", type);
+			return -EINVAL;
+		}
+		if (bq_type == BQ_NONE) {
+			if (a0 != 0.0f)
+				a0 = 1.0f / a0;
+			bq[n] = (struct biquad) {
+				.b0 = b0 * a0, .b1 = b1 * a0, .b2 = b2 * a0,
+				.a1 = a1 * a0, .a2 = a2 * a0 };
+		} else {
+			biquad_set(&bq[n], bq_type, freq * 2 / impl->rate, q, gain);
+		}
+		n++;
+	}
+	*n_bq = n;
+	return 0;
+}
+
+/*
+ * config = {
+ *     filters = [
+ *         { type = bq_lowshelf, freq = 100, gain = -3.0, q = 0.7 },
+ *         { type = bq_peaking, freq = 1000, gain = 2.0, q = 1.0 },
+ *         ...
+ *     ]
+ *     filters2 = [ ... ]
+ * }
+ *
+ * filters is used for all channels, filtersN overrides it for channel N.
+ */
+static void *param_eq_instantiate(const struct fc_descriptor * Descriptor,
+		unsigned long SampleRate, int index, const char *config)
+{
+	struct param_eq_impl *impl;
+	struct spa_json it[3];
+	const char *val;
+	char key[256];
+	bool set[PARAM_EQ_CHANNELS] = { false, };
+	uint32_t i, j, n;
+	int res;
+
+	if (config == NULL) {
+		pw_log_error("param_eq: requires a config section");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+
+	spa_json_init(&it[0], config, strlen(config));
+	if (spa_json_enter_object(&it[0], &it[1]) <= 0) {
+		pw_log_error("param_eq:config must be an object");
+		res = -EINVAL;
+		goto error;
+	}
+
+	while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+		int chan;
+
+		if (spa_streq(key, "filters")) {
+			chan = 0;
+		} else if (sscanf(key, "filters%d", &chan) == 1 &&
+		    chan > 0 && chan <= PARAM_EQ_CHANNELS) {
+			chan--;
+		} else {
+			pw_log_warn("param_eq: ignoring config key: '%s'", key);
+			if (spa_json_next(&it[1], &val) < 0)
+				break;
+			continue;
+		}
+		if (spa_json_enter_array(&it[1], &it[2]) <= 0) {
+			pw_log_error("param_eq:%s requires an array", key);
+			res = -EINVAL;
+			goto error;
+		}
+		if (spa_streq(key, "filters")) {
+			/* the shared filters go in all channels without their own */
+			if ((res = param_eq_parse_filters(impl, &it[2], impl->bq, &n)) < 0)
+				goto error;
+			for (i = 0; i < PARAM_EQ_CHANNELS; i++) {
+				if (set[i])
+					continue;
+				memcpy(&impl->bq[i * PARAM_EQ_MAX], impl->bq, n * sizeof(struct biquad));
+				impl->n_chan_bq[i] = n;
+			}
+		} else {
+			if ((res = param_eq_parse_filters(impl, &it[2],
+					&impl->bq[chan * PARAM_EQ_MAX], &n)) < 0)
+				goto error;
+			impl->n_chan_bq[chan] = n;
+			set[chan] = true;
+		}
+	}
+
+	/* all channels run the same number of biquads, pad the shorter
+	 * cascades with pass-through filters */
+	for (i = 0; i < PARAM_EQ_CHANNELS; i++)
+		impl->n_bq = SPA_MAX(impl->n_bq, impl->n_chan_bq[i]);
+	for (i = 0; i < PARAM_EQ_CHANNELS; i++) {
+		for (j = impl->n_chan_bq[i]; j < impl->n_bq; j++)
+			impl->bq[i * PARAM_EQ_MAX + j] = (struct biquad) { .b0 = 1.0f };
+	}
+	pw_log_info("param_eq: %d biquads per channel", impl->n_bq);
+
+	return impl;
+error:
+	free(impl);
+	errno = -res;
+	return NULL;
+}
+
+static void param_eq_connect_port(void * Instance, unsigned long Port,
+                        float * DataLocation)
+{
+	struct param_eq_impl *impl = Instance;
+	impl->port[Port] = DataLocation;
+}
+
+static void param_eq_activate(void * Instance)
+{
+	struct param_eq_impl *impl = Instance;
+	uint32_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(impl->bq); i++)
+		impl->bq[i].x1 = impl->bq[i].x2 = 0.0f;
+}
+
+static void param_eq_cleanup(void * Instance)
+{
+	struct param_eq_impl *impl = Instance;
+	free(impl);
+}
+
+static void param_eq_run(void * Instance, unsigned long SampleCount)
+{
+	struct param_eq_impl *impl = Instance;
+	const float **in = (const float **)&impl->port[0];
+	float **out = &impl->port[PARAM_EQ_CHANNELS];
+	uint32_t i;
+
+	for (i = 0; i < PARAM_EQ_CHANNELS; i++) {
+		if (in[i] == NULL && out[i] != NULL)
+			dsp_ops_clear(dsp_ops, out[i], SampleCount);
+	}
+	dsp_ops_biquadn_run(dsp_ops, impl->bq, impl->n_bq, PARAM_EQ_MAX,
+			out, in, PARAM_EQ_CHANNELS, SampleCount);
+}
+
+static struct fc_port param_eq_ports[] = {
+	{ .index = 0,
+	  .name = "In 1",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 1,
+	  .name = "In 2",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 2,
+	  .name = "In 3",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 3,
+	  .name = "In 4",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 4,
+	  .name = "In 5",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 5,
+	  .name = "In 6",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 6,
+	  .name = "In 7",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 7,
+	  .name = "In 8",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 8,
+	  .name = "Out 1",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 9,
+	  .name = "Out 2",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 10,
+	  .name = "Out 3",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 11,
+	  .name = "Out 4",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 12,
+	  .name = "Out 5",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 13,
+	  .name = "Out 6",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 14,
+	  .name = "Out 7",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 15,
+	  .name = "Out 8",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+};
+
+static const struct fc_descriptor param_eq_desc = {
+	.name = "param_eq",
+	.flags = FC_DESCRIPTOR_SUPPORTS_NULL_DATA,
+
+	.n_ports = SPA_N_ELEMENTS(param_eq_ports),
+	.ports = param_eq_ports,
+
+	.instantiate = param_eq_instantiate,
+	.connect_port = param_eq_connect_port,
+	.activate = param_eq_activate,
+	.run = param_eq_run,
+	.cleanup = param_eq_cleanup,
+};
+
+/** crossover */
+#define CROSSOVER_BANDS	8
+#define CROSSOVER_MAX	(2 * (CROSSOVER_BANDS - 1))
+
+struct crossover_impl {
+	unsigned long rate;
+	float *port[1 + CROSSOVER_BANDS + CROSSOVER_BANDS - 1];
+
+	float freq[CROSSOVER_BANDS - 1];
+	uint32_t n_bands;
+	uint32_t n_bq;
+	struct biquad bq[CROSSOVER_BANDS * CROSSOVER_MAX];
+};
+
+static void *crossover_instantiate(const struct fc_descriptor * Descriptor,
+		unsigned long SampleRate, int index, const char *config)
+{
+	struct crossover_impl *impl;
+
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+	impl->n_bands = 1;
+	return impl;
+}
+
+static void crossover_connect_port(void * Instance, unsigned long Port,
+                        float * DataLocation)
+{
+	struct crossover_impl *impl = Instance;
+	impl->port[Port] = DataLocation;
+}
+
+static void crossover_set(struct crossover_impl *impl, struct biquad *bq,
+		int type, float freq, float Q)
+{
+	float x1 = bq->x1, x2 = bq->x2;
+	biquad_set(bq, type, freq * 2 / impl->rate, Q, 0.0f);
+	bq->x1 = x1;
+	bq->x2 = x2;
+}
+
+/* Every band is a cascade of biquads on the input so that all bands run in
+ * parallel SIMD lanes. Band k is the highpass of all lower crossovers, the
+ * lowpass of crossover k and the allpass of all higher crossovers, which
+ * keeps the bands in phase so that they sum to a flat response. The LR4
+ * filters are two Butterworth biquads, the LR4 allpass is one biquad. */
+static void crossover_update(struct crossover_impl *impl)
+{
+	float **freq = &impl->port[1 + CROSSOVER_BANDS];
+	uint32_t i, j, k, n_bands;
+
+	for (i = 0; i < CROSSOVER_BANDS - 1; i++) {
+		if (freq[i] == NULL || freq[i][0] <= 0.0f)
+			break;
+	}
+	n_bands = i + 1;
+
+	if (n_bands == impl->n_bands) {
+		for (i = 0; i < n_bands - 1; i++)
+			if (impl->freq[i] != freq[i][0])
+				break;
+		if (i == n_bands - 1)
+			return;
+	}
+	if (n_bands != impl->n_bands)
+		memset(impl->bq, 0, sizeof(impl->bq));
+
+	impl->n_bands = n_bands;
+	impl->n_bq = 2 * (n_bands - 1);
+	for (i = 0; i < n_bands - 1; i++)
+		impl->freq[i] = freq[i][0];
+
+	for (k = 0; k < n_bands; k++) {
+		struct biquad *bq = &impl->bq[k * CROSSOVER_MAX];
+
+		j = 0;
+		for (i = 0; i < k; i++) {
+			crossover_set(impl, &bq[j++], BQ_HIGHPASS, impl->freq[i], 0.0f);
+			crossover_set(impl, &bq[j++], BQ_HIGHPASS, impl->freq[i], 0.0f);
+		}
+		if (k < n_bands - 1) {
+			crossover_set(impl, &bq[j++], BQ_LOWPASS, impl->freq[k], 0.0f);
+			crossover_set(impl, &bq[j++], BQ_LOWPASS, impl->freq[k], 0.0f);
+		}
+		for (i = k + 1; i < n_bands - 1; i++)
+			crossover_set(impl, &bq[j++], BQ_ALLPASS, impl->freq[i], (float)M_SQRT1_2);
+		for (; j < impl->n_bq; j++)
+			crossover_set(impl, &bq[j], BQ_NONE, 0.0f, 0.0f);
+	}
+	pw_log_info("crossover: %u bands, %u biquads per band", n_bands, impl->n_bq);
+}
+
+static void crossover_activate(void * Instance)
+{
+	struct crossover_impl *impl = Instance;
+	uint32_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(impl->bq); i++)
+		impl->bq[i].x1 = impl->bq[i].x2 = 0.0f;
+}
+
+static void crossover_cleanup(void * Instance)
+{
+	struct crossover_impl *impl = Instance;
+	free(impl);
+}
+
+static void crossover_run(void * Instance, unsigned long SampleCount)
+{
+	struct crossover_impl *impl = Instance;
+	const float *in[CROSSOVER_BANDS];
+	float **out = &impl->port[1];
+	uint32_t i;
+
+	crossover_update(impl);
+
+	for (i = 0; i < CROSSOVER_BANDS; i++) {
+		in[i] = i < impl->n_bands ? impl->port[0] : NULL;
+		if (in[i] == NULL && out[i] != NULL)
+			dsp_ops_clear(dsp_ops, out[i], SampleCount);
+	}
+	dsp_ops_biquadn_run(dsp_ops, impl->bq, impl->n_bq, CROSSOVER_MAX,
+			out, in, impl->n_bands, SampleCount);
+}
+
+static struct fc_port crossover_ports[] = {
+	{ .index = 0,
+	  .name = "In",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 1,
+	  .name = "Out 1",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 2,
+	  .name = "Out 2",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 3,
+	  .name = "Out 3",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 4,
+	  .name = "Out 4",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 5,
+	  .name = "Out 5",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 6,
+	  .name = "Out 6",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 7,
+	  .name = "Out 7",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 8,
+	  .name = "Out 8",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 9,
+	  .name = "Freq 1",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+	{ .index = 10,
+	  .name = "Freq 2",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+	{ .index = 11,
+	  .name = "Freq 3",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+	{ .index = 12,
+	  .name = "Freq 4",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+	{ .index = 13,
+	  .name = "Freq 5",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+	{ .index = 14,
+	  .name = "Freq 6",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+	{ .index = 15,
+	  .name = "Freq 7",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .hint = FC_HINT_SAMPLE_RATE,
+	  .def = 0.0f, .min = 0.0f, .max = 1.0f,
+	},
+};
+
+static const struct fc_descriptor crossover_desc = {
+	.name = "crossover",
+	.flags = FC_DESCRIPTOR_SUPPORTS_NULL_DATA,
+
+	.n_ports = SPA_N_ELEMENTS(crossover_ports),
+	.ports = crossover_ports,
+
+	.instantiate = crossover_instantiate,
+	.connect_port = crossover_connect_port,
+	.activate = crossover_activate,
+	.run = crossover_run,
+	.cleanup = crossover_cleanup,
+};
+
+/** dynamics
+ *
+ * The compressor, limiter and loudness meter work on up to 8 linked
+ * channels. The level of all channels is detected together and the same
+ * gain is applied to all channels so that the stereo image does not move.
+ */
+#define DYN_CHANNELS	8
+#define DYN_PORTS	(DYN_CHANNELS * 2 + 6)
+
+/* flush denormals in the recursive state */
+#define DYN_F(x) (-FLT_MIN < (x) && (x) < FLT_MIN ? 0.0f : (x))
+
+static inline float dyn_coef(unsigned long rate, float msec)
+{
+	return msec > 0.0f ? expf(-1000.0f / (msec * rate)) : 0.0f;
+}
+
+static inline float dyn_db_to_gain(float db)
+{
+	return powf(10.0f, db / 20.0f);
+}
+
+static inline float dyn_gain_to_db(float gain)
+{
+	return 20.0f * log10f(SPA_MAX(gain, 1e-10f));
+}
+
+/* the peak of all channels for each sample, the loops are written so
+ * that the compiler can vectorize them */
+static void dyn_detect(float *det, float **in, uint32_t n_samples)
+{
+	uint32_t c, n;
+	bool first = true;
+
+	for (c = 0; c < DYN_CHANNELS; c++) {
+		const float *s = in[c];
+		if (s == NULL)
+			continue;
+		if (first) {
+			for (n = 0; n < n_samples; n++)
+				det[n] = fabsf(s[n]);
+			first = false;
+		} else {
+			for (n = 0; n < n_samples; n++) {
+				float v = fabsf(s[n]);
+				det[n] = v > det[n] ? v : det[n];
+			}
+		}
+	}
+	if (first)
+		dsp_ops_clear(dsp_ops, det, n_samples);
+}
+
+/** compressor */
+struct compressor_impl {
+	unsigned long rate;
+	float *port[DYN_PORTS];
+
+	float env;
+	float det[MAX_SAMPLES];
+	float gain[MAX_SAMPLES];
+};
+
+static void *compressor_instantiate(const struct fc_descriptor * Descriptor,
+		unsigned long SampleRate, int index, const char *config)
+{
+	struct compressor_impl *impl;
+
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+	return impl;
+}
+
+static void dyn_connect_port(void * Instance, unsigned long Port,
+                        float * DataLocation)
+{
+	/* all dynamics start with the rate and the ports */
+	struct compressor_impl *impl = Instance;
+	impl->port[Port] = DataLocation;
+}
+
+static void dyn_cleanup(void * Instance)
+{
+	free(Instance);
+}
+
+static void compressor_activate(void * Instance)
+{
+	struct compressor_impl *impl = Instance;
+	impl->env = 0.0f;
+}
+
+static void compressor_run(void * Instance, unsigned long SampleCount)
+{
+	struct compressor_impl *impl = Instance;
+	float **in = &impl->port[0], **out = &impl->port[DYN_CHANNELS];
+	float *notify = impl->port[16];
+	float thr = dyn_db_to_gain(impl->port[17][0]);
+	float slope = 1.0f / SPA_MAX(impl->port[18][0], 1.0f) - 1.0f;
+	float att = dyn_coef(impl->rate, impl->port[19][0]);
+	float rel = dyn_coef(impl->rate, impl->port[20][0]);
+	float makeup = dyn_db_to_gain(impl->port[21][0]);
+	float env = impl->env, min_gain = 1.0f;
+	uint32_t c, n, n_samples = SPA_MIN(SampleCount, MAX_SAMPLES);
+
+	dyn_detect(impl->det, in, n_samples);
+
+	for (n = 0; n < n_samples; n++) {
+		float x = impl->det[n], g = 1.0f;
+
+		env = x + (x > env ? att : rel) * (env - x);
+		if (env > thr) {
+			g = powf(env / thr, slope);
+			min_gain = SPA_MIN(min_gain, g);
+		}
+		impl->gain[n] = g * makeup;
+	}
+	impl->env = DYN_F(env);
+
+	for (c = 0; c < DYN_CHANNELS; c++) {
+		if (out[c] == NULL)
+			continue;
+		if (in[c] == NULL)
+			dsp_ops_clear(dsp_ops, out[c], n_samples);
+		else
+			dsp_ops_mult(dsp_ops, out[c],
+					(const void*[]) { in[c], impl->gain }, 2, n_samples);
+	}
+	if (notify != NULL)
+		notify[0] = dyn_gain_to_db(min_gain);
+}
+
+static struct fc_port compressor_ports[] = {
+	{ .index = 0,
+	  .name = "In 1",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 1,
+	  .name = "In 2",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 2,
+	  .name = "In 3",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 3,
+	  .name = "In 4",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 4,
+	  .name = "In 5",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 5,
+	  .name = "In 6",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 6,
+	  .name = "In 7",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 7,
+	  .name = "In 8",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 8,
+	  .name = "Out 1",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 9,
+	  .name = "Out 2",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 10,
+	  .name = "Out 3",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 11,
+	  .name = "Out 4",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 12,
+	  .name = "Out 5",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 13,
+	  .name = "Out 6",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 14,
+	  .name = "Out 7",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 15,
+	  .name = "Out 8",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 16,
+	  .name = "Gain Reduction",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_CONTROL,
+	},
+	{ .index = 17,
+	  .name = "Threshold",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = -20.0f, .min = -60.0f, .max = 0.0f
+	},
+	{ .index = 18,
+	  .name = "Ratio",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 4.0f, .min = 1.0f, .max = 100.0f
+	},
+	{ .index = 19,
+	  .name = "Attack",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 10.0f, .min = 0.0f, .max = 1000.0f
+	},
+	{ .index = 20,
+	  .name = "Release",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 100.0f, .min = 0.0f, .max = 10000.0f
+	},
+	{ .index = 21,
+	  .name = "Makeup",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 0.0f, .min = 0.0f, .max = 40.0f
+	},
+};
+
+static const struct fc_descriptor compressor_desc = {
+	.name = "compressor",
+	.flags = FC_DESCRIPTOR_SUPPORTS_NULL_DATA,
+
+	.n_ports = SPA_N_ELEMENTS(compressor_ports),
+	.ports = compressor_ports,
+
+	.instantiate = compressor_instantiate,
+	.connect_port = dyn_connect_port,
+	.activate = compressor_activate,
+	.run = compressor_run,
+	.cleanup = dyn_cleanup,
+};
+
+/** limiter */
+#define LIMITER_MAX_MSEC	20
+
+struct limiter_impl {
+	unsigned long rate;
+	float *port[DYN_PORTS];
+
+	float det[MAX_SAMPLES];
+	float gain[MAX_SAMPLES];
+
+	uint32_t max_delay;
+	uint32_t delay;
+	float lookahead;
+	/* per channel, delay samples of history followed by the input */
+	float *buffer[DYN_CHANNELS];
+
+	/* sliding minimum of the target gain over delay + 1 samples,
+	 * a queue of increasing values */
+	float *min_val;
+	uint64_t *min_pos;
+	uint32_t min_head, min_len;
+	uint64_t pos;
+
+	float release;
+	/* moving average over delay + 1 samples */
+	float *box;
+	uint32_t box_pos;
+	double box_sum;
+};
+
+static void limiter_reset(struct limiter_impl *impl, float lookahead)
+{
+	uint32_t i;
+
+	impl->lookahead = lookahead;
+	impl->delay = SPA_MIN((uint32_t)(lookahead * impl->rate / 1000.0f), impl->max_delay);
+
+	for (i = 0; i < DYN_CHANNELS; i++)
+		memset(impl->buffer[i], 0, impl->max_delay * sizeof(float));
+	impl->min_head = impl->min_len = 0;
+	impl->pos = 0;
+	impl->release = 1.0f;
+	for (i = 0; i <= impl->delay; i++)
+		impl->box[i] = 1.0f;
+	impl->box_pos = 0;
+	impl->box_sum = impl->delay + 1;
+}
+
+static void limiter_cleanup(void * Instance)
+{
+	struct limiter_impl *impl = Instance;
+	uint32_t i;
+	for (i = 0; i < DYN_CHANNELS; i++)
+		free(impl->buffer[i]);
+	free(impl->min_val);
+	free(impl->min_pos);
+	free(impl->box);
+	free(impl);
+}
+
+static void *limiter_instantiate(const struct fc_descriptor * Descriptor,
+		unsigned long SampleRate, int index, const char *config)
+{
+	struct limiter_impl *impl;
+	uint32_t i;
+
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+	impl->max_delay = SampleRate * LIMITER_MAX_MSEC / 1000;
+
+	for (i = 0; i < DYN_CHANNELS; i++) {
+		impl->buffer[i] = calloc(impl->max_delay + MAX_SAMPLES, sizeof(float));
+		if (impl->buffer[i] == NULL)
+			goto error;
+	}
+	impl->min_val = calloc(impl->max_delay + 1, sizeof(float));
+	impl->min_pos = calloc(impl->max_delay + 1, sizeof(uint64_t));
+	impl->box = calloc(impl->max_delay + 1, sizeof(float));
+	if (impl->min_val == NULL || impl->min_pos == NULL || impl->box == NULL)
+		goto error;
+
+	limiter_reset(impl, 0.0f);
+	return impl;
+error:
+	limiter_cleanup(impl);
+	errno = ENOMEM;
+	return NULL;
+}
+
+static void limiter_activate(void * Instance)
+{
+	struct limiter_impl *impl = Instance;
+	limiter_reset(impl, impl->port[18][0]);
+}
+
+/*
+ * The gain that keeps the peak at the threshold is computed for each input
+ * sample. The gain that is applied to the delayed output is the moving
+ * average of the sliding minimum of this gain over the lookahead window.
+ * Every value in the average is at or below the gain of the output sample,
+ * so the peak never goes over the threshold while the gain still changes
+ * smoothly over the lookahead window.
+ */
+static void limiter_run(void * Instance, unsigned long SampleCount)
+{
+	struct limiter_impl *impl = Instance;
+	float **in = &impl->port[0], **out = &impl->port[DYN_CHANNELS];
+	float *notify = impl->port[16];
+	float thr = dyn_db_to_gain(impl->port[17][0]);
+	float rel = dyn_coef(impl->rate, impl->port[19][0]);
+	float release = impl->release, min_gain = 1.0f;
+	uint32_t c, n, size, delay, n_samples = SPA_MIN(SampleCount, MAX_SAMPLES);
+
+	if (impl->lookahead != impl->port[18][0])
+		limiter_reset(impl, impl->port[18][0]);
+
+	delay = impl->delay;
+	size = delay + 1;
+
+	dyn_detect(impl->det, in, n_samples);
+
+	for (n = 0; n < n_samples; n++, impl->pos++) {
+		float x = impl->det[n], t, m, g;
+		uint32_t idx;
+
+		t = x > thr ? thr / x : 1.0f;
+
+		while (impl->min_len > 0) {
+			idx = (impl->min_head + impl->min_len - 1) % size;
+			if (impl->min_val[idx] < t)
+				break;
+			impl->min_len--;
+		}
+		idx = (impl->min_head + impl->min_len++) % size;
+		impl->min_val[idx] = t;
+		impl->min_pos[idx] = impl->pos;
+		if (impl->min_pos[impl->min_head] + size <= impl->pos) {
+			impl->min_head = (impl->min_head + 1) % size;
+			impl->min_len--;
+		}
+		m = impl->min_val[impl->min_head];
+
+		release = m < release ? m : m + rel * (release - m);
+
+		impl->box_sum += release - impl->box[impl->box_pos];
+		impl->box[impl->box_pos] = release;
+		if (++impl->box_pos == size)
+			impl->box_pos = 0;
+
+		g = SPA_MIN((float)(impl->box_sum / size), 1.0f);
+		impl->gain[n] = g;
+		min_gain = SPA_MIN(min_gain, g);
+	}
+	impl->release = DYN_F(release);
+
+	for (c = 0; c < DYN_CHANNELS; c++) {
+		float *buf = impl->buffer[c], *d = out[c];
+
+		if (in[c] == NULL) {
+			if (d != NULL)
+				dsp_ops_clear(dsp_ops, d, n_samples);
+			continue;
+		}
+		memcpy(&buf[delay], in[c], n_samples * sizeof(float));
+		if (d != NULL) {
+			for (n = 0; n < n_samples; n++)
+				d[n] = buf[n] * impl->gain[n];
+		}
+		memmove(buf, &buf[n_samples], delay * sizeof(float));
+	}
+	if (notify != NULL)
+		notify[0] = dyn_gain_to_db(min_gain);
+}
+
+static struct fc_port limiter_ports[] = {
+	{ .index = 0,
+	  .name = "In 1",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 1,
+	  .name = "In 2",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 2,
+	  .name = "In 3",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 3,
+	  .name = "In 4",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 4,
+	  .name = "In 5",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 5,
+	  .name = "In 6",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 6,
+	  .name = "In 7",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 7,
+	  .name = "In 8",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 8,
+	  .name = "Out 1",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 9,
+	  .name = "Out 2",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 10,
+	  .name = "Out 3",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 11,
+	  .name = "Out 4",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 12,
+	  .name = "Out 5",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 13,
+	  .name = "Out 6",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 14,
+	  .name = "Out 7",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 15,
+	  .name = "Out 8",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 16,
+	  .name = "Gain Reduction",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_CONTROL,
+	},
+	{ .index = 17,
+	  .name = "Threshold",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = -1.0f, .min = -40.0f, .max = 0.0f
+	},
+	{ .index = 18,
+	  .name = "Lookahead",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 5.0f, .min = 0.0f, .max = 20.0f
+	},
+	{ .index = 19,
+	  .name = "Release",
+	  .flags = FC_PORT_INPUT | FC_PORT_CONTROL,
+	  .def = 50.0f, .min = 0.0f, .max = 10000.0f
+	},
+};
+
+static const struct fc_descriptor limiter_desc = {
+	.name = "limiter",
+	.flags = FC_DESCRIPTOR_SUPPORTS_NULL_DATA,
+
+	.n_ports = SPA_N_ELEMENTS(limiter_ports),
+	.ports = limiter_ports,
+
+	.instantiate = limiter_instantiate,
+	.connect_port = dyn_connect_port,
+	.activate = limiter_activate,
+	.run = limiter_run,
+	.cleanup = limiter_cleanup,
+};
+
+/** loudness, EBU R128 */
+#define LOUDNESS_BLOCK_MSEC	100
+#define LOUDNESS_SHORT_BLOCKS	30
+#define LOUDNESS_MOMENTARY_BLOCKS	4
+/* 0.1 LU bins for the integrated loudness from -70 to +10 LUFS */
+#define LOUDNESS_HIST_MIN	-70.0
+#define LOUDNESS_HIST_BINS	800
+
+struct loudness_impl {
+	unsigned long rate;
+	float *port[DYN_PORTS];
+
+	/* K-weighting, two biquads per channel */
+	struct biquad kw[DYN_CHANNELS * 2];
+	float *tmp[DYN_CHANNELS];
+
+	uint32_t block_len;
+	uint32_t block_pos;
+	double block_sum;
+
+	double blocks[LOUDNESS_SHORT_BLOCKS];
+	uint32_t n_blocks;
+
+	uint32_t hist[LOUDNESS_HIST_BINS];
+	uint64_t n_gated;
+};
+
+static inline double loudness_lufs(double power)
+{
+	return power > 0.0 ? -0.691 + 10.0 * log10(power) : -INFINITY;
+}
+
+/* the K-weighting filters of ITU-R BS.1770 for any rate */
+static void loudness_set_filters(struct loudness_impl *impl)
+{
+	double f0, G, Q, K, Vh, Vb, a0;
+	struct biquad shelf, hp;
+	uint32_t i;
+
+	f0 = 1681.974450955533;
+	G = 3.999843853973347;
+	Q = 0.7071752369554196;
+	K = tan(M_PI * f0 / impl->rate);
+	Vh = pow(10.0, G / 20.0);
+	Vb = pow(Vh, 0.4996667741545416);
+	a0 = 1.0 + K / Q + K * K;
+	shelf = (struct biquad) {
+		.b0 = (float)((Vh + Vb * K / Q + K * K) / a0),
+		.b1 = (float)(2.0 * (K * K - Vh) / a0),
+		.b2 = (float)((Vh - Vb * K / Q + K * K) / a0),
+		.a1 = (float)(2.0 * (K * K - 1.0) / a0),
+		.a2 = (float)((1.0 - K / Q + K * K) / a0),
+	};
+
+	f0 = 38.13547087602444;
+	Q = 0.5003270373238773;
+	K = tan(M_PI * f0 / impl->rate);
+	a0 = 1.0 + K / Q + K * K;
+	hp = (struct biquad) {
+		.b0 = 1.0f, .b1 = -2.0f, .b2 = 1.0f,
+		.a1 = (float)(2.0 * (K * K - 1.0) / a0),
+		.a2 = (float)((1.0 - K / Q + K * K) / a0),
+	};
+	for (i = 0; i < DYN_CHANNELS; i++) {
+		impl->kw[i * 2 + 0] = shelf;
+		impl->kw[i * 2 + 1] = hp;
+	}
+}
+
+static void loudness_cleanup(void * Instance)
+{
+	struct loudness_impl *impl = Instance;
+	uint32_t i;
+	for (i = 0; i < DYN_CHANNELS; i++)
+		free(impl->tmp[i]);
+	free(impl);
+}
+
+static void *loudness_instantiate(const struct fc_descriptor * Descriptor,
+		unsigned long SampleRate, int index, const char *config)
+{
+	struct loudness_impl *impl;
+	uint32_t i;
+
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+	impl->block_len = SampleRate * LOUDNESS_BLOCK_MSEC / 1000;
+
+	for (i = 0; i < DYN_CHANNELS; i++) {
+		if ((impl->tmp[i] = calloc(MAX_SAMPLES, sizeof(float))) == NULL) {
+			loudness_cleanup(impl);
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+	loudness_set_filters(impl);
+	return impl;
+}
+
+static void loudness_activate(void * Instance)
+{
+	struct loudness_impl *impl = Instance;
+	uint32_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(impl->kw); i++)
+		impl->kw[i].x1 = impl->kw[i].x2 = 0.0f;
+	impl->block_pos = 0;
+	impl->block_sum = 0.0;
+	impl->n_blocks = 0;
+	impl->n_gated = 0;
+	memset(impl->hist, 0, sizeof(impl->hist));
+}
+
+static double loudness_power(struct loudness_impl *impl, uint32_t n_blocks)
+{
+	double sum = 0.0;
+	uint32_t i;
+
+	n_blocks = SPA_MIN(n_blocks, impl->n_blocks);
+	if (n_blocks == 0)
+		return 0.0;
+	for (i = 0; i < n_blocks; i++)
+		sum += impl->blocks[(impl->n_blocks - 1 - i) % LOUDNESS_SHORT_BLOCKS];
+	return sum / n_blocks;
+}
+
+static double loudness_integrated(struct loudness_impl *impl)
+{
+	double sum = 0.0, gate;
+	uint64_t count = 0;
+	uint32_t i, start;
+
+	if (impl->n_gated == 0)
+		return -INFINITY;
+
+	/* the relative gate is 10 LU below the loudness of all blocks over
+	 * the absolute gate of -70 LUFS */
+	for (i = 0; i < LOUDNESS_HIST_BINS; i++)
+		sum += impl->hist[i] * pow(10.0, (LOUDNESS_HIST_MIN + (i + 0.5) / 10.0 + 0.691) / 10.0);
+	gate = loudness_lufs(sum / impl->n_gated) - 10.0;
+
+	start = (uint32_t)SPA_CLAMP((gate - LOUDNESS_HIST_MIN) * 10.0, 0.0, LOUDNESS_HIST_BINS - 1.0);
+	for (i = start, sum = 0.0; i < LOUDNESS_HIST_BINS; i++) {
+		sum += impl->hist[i] * pow(10.0, (LOUDNESS_HIST_MIN + (i + 0.5) / 10.0 + 0.691) / 10.0);
+		count += impl->hist[i];
+	}
+	return count > 0 ? loudness_lufs(sum / count) : -INFINITY;
+}
+
+static void loudness_block(struct loudness_impl *impl)
+{
+	double momentary;
+
+	impl->blocks[impl->n_blocks % LOUDNESS_SHORT_BLOCKS] = impl->block_sum / impl->block_len;
+	impl->n_blocks++;
+	impl->block_sum = 0.0;
+	impl->block_pos = 0;
+
+	/* the gating blocks are the momentary blocks of 400ms, every 100ms */
+	if (impl->n_blocks >= LOUDNESS_MOMENTARY_BLOCKS) {
+		momentary = loudness_lufs(loudness_power(impl, LOUDNESS_MOMENTARY_BLOCKS));
+		if (momentary > LOUDNESS_HIST_MIN) {
+			int bin = SPA_MIN((int)((momentary - LOUDNESS_HIST_MIN) * 10.0),
+					LOUDNESS_HIST_BINS - 1);
+			impl->hist[bin]++;
+			impl->n_gated++;
+		}
+	}
+}
+
+static void loudness_run(void * Instance, unsigned long SampleCount)
+{
+	struct loudness_impl *impl = Instance;
+	float **in = &impl->port[0], **out = &impl->port[DYN_CHANNELS];
+	float **tmp = impl->tmp;
+	uint32_t c, n, i, chunk, n_samples = SPA_MIN(SampleCount, MAX_SAMPLES);
+
+	for (c = 0; c < DYN_CHANNELS; c++) {
+		if (out[c] == NULL)
+			continue;
+		if (in[c] == NULL)
+			dsp_ops_clear(dsp_ops, out[c], n_samples);
+		else if (in[c] != out[c])
+			dsp_ops_copy(dsp_ops, out[c], in[c], n_samples);
+	}
+
+	dsp_ops_biquadn_run(dsp_ops, impl->kw, 2, 2, tmp, (const float **)in,
+			DYN_CHANNELS, n_samples);
+
+	for (n = 0; n < n_samples; n += chunk) {
+		chunk = SPA_MIN(n_samples - n, impl->block_len - impl->block_pos);
+
+		for (c = 0; c < DYN_CHANNELS; c++) {
+			const float *s = &tmp[c][n];
+			float sum = 0.0f;
+			if (in[c] == NULL)
+				continue;
+			for (i = 0; i < chunk; i++)
+				sum += s[i] * s[i];
+			impl->block_sum += sum;
+		}
+		impl->block_pos += chunk;
+		if (impl->block_pos == impl->block_len)
+			loudness_block(impl);
+	}
+
+	if (impl->port[16] != NULL)
+		impl->port[16][0] = (float)loudness_lufs(loudness_power(impl, LOUDNESS_MOMENTARY_BLOCKS));
+	if (impl->port[17] != NULL)
+		impl->port[17][0] = (float)loudness_lufs(loudness_power(impl, LOUDNESS_SHORT_BLOCKS));
+	if (impl->port[18] != NULL)
+		impl->port[18][0] = (float)loudness_integrated(impl);
+}
+
+static struct fc_port loudness_ports[] = {
+	{ .index = 0,
+	  .name = "In 1",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 1,
+	  .name = "In 2",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 2,
+	  .name = "In 3",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 3,
+	  .name = "In 4",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 4,
+	  .name = "In 5",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 5,
+	  .name = "In 6",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 6,
+	  .name = "In 7",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 7,
+	  .name = "In 8",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 8,
+	  .name = "Out 1",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 9,
+	  .name = "Out 2",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 10,
+	  .name = "Out 3",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 11,
+	  .name = "Out 4",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 12,
+	  .name = "Out 5",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 13,
+	  .name = "Out 6",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 14,
+	  .name = "Out 7",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 15,
+	  .name = "Out 8",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 16,
+	  .name = "Momentary",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_CONTROL,
+	},
+	{ .index = 17,
+	  .name = "Short-term",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_CONTROL,
+	},
+	{ .index = 18,
+	  .name = "Integrated",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_CONTROL,
+	},
+};
+
+static const struct fc_descriptor loudness_desc = {
+	.name = "loudness",
+	.flags = FC_DESCRIPTOR_SUPPORTS_NULL_DATA,
+
+	.n_ports = SPA_N_ELEMENTS(loudness_ports),
+	.ports = loudness_ports,
+
+	.instantiate = loudness_instantiate,
+	.connect_port = dyn_connect_port,
+	.activate = loudness_activate,
+	.run = loudness_run,
+	.cleanup = loudness_cleanup,
+};
+
 static const struct fc_descriptor * builtin_descriptor(unsigned long Index)
 {
 	switch(Index) {
@@ -1725,6 +3465,16 @@ static const struct fc_descriptor * builtin_descriptor(unsigned long Index)
 		return &mult_desc;
 	case 20:
 		return &sine_desc;
+	case 21:
+		return &param_eq_desc;
+	case 22:
+		return &crossover_desc;
+	case 23:
+		return &compressor_desc;
+	case 24:
+		return &limiter_desc;
+	case 25:
+		return &loudness_desc;
 	}
 	return NULL;
 }
@@ -1750,6 +3500,9 @@ struct fc_plugin *load_builtin_plugin(const struct spa_support *support, uint32_
 		struct dsp_ops *dsp, const char *plugin, const char *config)
 {
 	dsp_ops = dsp;
+	thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
+	data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
+	main_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
 	pffft_select_cpu(dsp->cpu_flags);
 	return &builtin_plugin;
 }
@@ -7,11 +7,46 @@
 #include "convolver.h"
 
 #include <spa/utils/defs.h>
+#include <spa/utils/list.h>
 
 #include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 static struct dsp_ops *dsp;
 
+/* The FFT'd partitions of an IR. They only depend on the IR and the block
+ * size so they are shared between all convolvers in the process that use
+ * the same IR, like the many instances of the same filter-chain. */
+struct ir_spectra {
+	struct spa_list link;
+	int ref;
+
+	struct dsp_ops *dsp;
+	int blockSize;
+	int len;
+	uint64_t hash;
+	float *ir;
+
+	int segCount;
+	float **segments;
+};
+
+static struct spa_list spectra_list = { &spectra_list, &spectra_list };
+static pthread_mutex_t spectra_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the spectra of one IR, convolved with the shared input spectra */
+struct convolver1_ir {
+	int segCount;
+	struct ir_spectra *spectra;
+
+	float *pre_mult;
+	float *conv;
+	float *overlap;
+};
+
 struct convolver1 {
 	int blockSize;
 	int segSize;
@@ -19,22 +54,20 @@ struct convolver1 {
 	int fftComplexSize;
 
 	float **segments;
-	float **segmentsIr;
 
 	float *fft_buffer;
 
 	void *fft;
 	void *ifft;
 
-	float *pre_mult;
-	float *conv;
-	float *overlap;
-
 	float *inputBuffer;
 	int inputBufferFill;
 
 	int current;
 	float scale;
+
+	int n_ir;
+	struct convolver1_ir ir[];
 };
 
 static void *fft_alloc(int size)
@@ -76,40 +109,214 @@ static int next_power_of_two(int val)
 	return r;
 }
 
+
+static int trim_ir(const float *ir, int irlen)
+{
+	while (irlen > 0 && fabs(ir[irlen-1]) < 0.000001f)
+		irlen--;
+	return irlen;
+}
+
+static uint64_t ir_hash(const float *ir, int len)
+{
+	const uint8_t *p = (const uint8_t*)ir;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < len * sizeof(float); i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static void ir_spectra_free(struct ir_spectra *s)
+{
+	int i;
+	if (s->segments) {
+		for (i = 0; i < s->segCount; i++)
+			fft_cpx_free(s->segments[i]);
+		free(s->segments);
+	}
+	free(s->ir);
+	free(s);
+}
+
+static void ir_spectra_unref(struct ir_spectra *s)
+{
+	if (s == NULL)
+		return;
+	pthread_mutex_lock(&spectra_lock);
+	if (--s->ref == 0) {
+		spa_list_remove(&s->link);
+		ir_spectra_free(s);
+	}
+	pthread_mutex_unlock(&spectra_lock);
+}
+
+static struct ir_spectra *ir_spectra_new(struct convolver1 *conv, const float *ir, int len,
+		uint64_t hash)
+{
+	struct ir_spectra *s;
+	int i;
+
+	if ((s = calloc(1, sizeof(*s))) == NULL)
+		return NULL;
+
+	s->ref = 1;
+	s->dsp = dsp;
+	s->blockSize = conv->blockSize;
+	s->len = len;
+	s->hash = hash;
+	s->segCount = (len + conv->blockSize-1) / conv->blockSize;
+	s->ir = malloc(len * sizeof(float));
+	s->segments = calloc(s->segCount, sizeof(float*));
+	if (s->ir == NULL || s->segments == NULL)
+		goto error;
+
+	memcpy(s->ir, ir, len * sizeof(float));
+
+	for (i = 0; i < s->segCount; i++) {
+		int left = len - (i * conv->blockSize);
+		int copy = SPA_MIN(conv->blockSize, left);
+
+		if ((s->segments[i] = fft_cpx_alloc(conv->fftComplexSize)) == NULL)
+			goto error;
+
+		dsp_ops_copy(dsp, conv->fft_buffer, &ir[i * conv->blockSize], copy);
+		if (copy < conv->segSize)
+			dsp_ops_clear(dsp, conv->fft_buffer + copy, conv->segSize - copy);
+
+	        dsp_ops_fft_run(dsp, conv->fft, 1, conv->fft_buffer, s->segments[i]);
+	}
+	return s;
+error:
+	ir_spectra_free(s);
+	return NULL;
+}
+
+/* find the spectra of the IR in the cache or make new ones */
+static struct ir_spectra *ir_spectra_get(struct convolver1 *conv, const float *ir, int len)
+{
+	struct ir_spectra *s;
+	uint64_t hash = ir_hash(ir, len);
+
+	pthread_mutex_lock(&spectra_lock);
+	spa_list_for_each(s, &spectra_list, link) {
+		if (s->dsp == dsp && s->blockSize == conv->blockSize &&
+		    s->len == len && s->hash == hash &&
+		    memcmp(s->ir, ir, len * sizeof(float)) == 0) {
+			s->ref++;
+			goto done;
+		}
+	}
+	if ((s = ir_spectra_new(conv, ir, len, hash)) != NULL)
+		spa_list_append(&spectra_list, &s->link);
+done:
+	pthread_mutex_unlock(&spectra_lock);
+	return s;
+}
+
+static float **fft_alloc_array(int n, int size)
+{
+	float **a;
+	int i;
+
+	if ((a = calloc(n, sizeof(float *))) == NULL)
+		return NULL;
+	for (i = 0; i < n; i++) {
+		if ((a[i] = fft_alloc(size)) == NULL)
+			break;
+	}
+	if (i < n) {
+		while (i-- > 0)
+			fft_free(a[i]);
+		free(a);
+		return NULL;
+	}
+	return a;
+}
+
+static void fft_free_array(float **a, int n)
+{
+	int i;
+	if (a == NULL)
+		return;
+	for (i = 0; i < n; i++)
+		fft_free(a[i]);
+	free(a);
+}
+
 static void convolver1_reset(struct convolver1 *conv)
 {
 	int i;
+	if (conv->segCount == 0)
+		return;
 	for (i = 0; i < conv->segCount; i++)
 		fft_cpx_clear(conv->segments[i], conv->fftComplexSize);
-	dsp_ops_clear(dsp, conv->overlap, conv->blockSize);
 	dsp_ops_clear(dsp, conv->inputBuffer, conv->segSize);
-	fft_cpx_clear(conv->pre_mult, conv->fftComplexSize);
-	fft_cpx_clear(conv->conv, conv->fftComplexSize);
+	for (i = 0; i < conv->n_ir; i++) {
+		struct convolver1_ir *r = &conv->ir[i];
+		if (r->segCount == 0)
+			continue;
+		dsp_ops_clear(dsp, r->overlap, conv->blockSize);
+		fft_cpx_clear(r->pre_mult, conv->fftComplexSize);
+		fft_cpx_clear(r->conv, conv->fftComplexSize);
+	}
 	conv->inputBufferFill = 0;
 	conv->current = 0;
 }
 
-static struct convolver1 *convolver1_new(int block, const float *ir, int irlen)
+static void convolver1_free(struct convolver1 *conv)
+{
+	int i, k;
+	for (k = 0; k < conv->n_ir; k++) {
+		struct convolver1_ir *r = &conv->ir[k];
+		ir_spectra_unref(r->spectra);
+		fft_cpx_free(r->pre_mult);
+		fft_cpx_free(r->conv);
+		fft_free(r->overlap);
+	}
+	if (conv->segments) {
+		for (i = 0; i < conv->segCount; i++)
+			fft_cpx_free(conv->segments[i]);
+		free(conv->segments);
+	}
+	if (conv->fft)
+		dsp_ops_fft_free(dsp, conv->fft);
+	if (conv->ifft)
+		dsp_ops_fft_free(dsp, conv->ifft);
+	fft_free(conv->fft_buffer);
+	fft_free(conv->inputBuffer);
+	free(conv);
+}
+
+/* make a convolver for n_ir IRs that all use the same input. The FFT of
+ * the input is only done once for all of them. */
+static struct convolver1 *convolver1_new(int block, const float *ir[], const int irlen[], int n_ir)
 {
 	struct convolver1 *conv;
-	int i;
+	int i, k;
 
 	if (block == 0)
 		return NULL;
 
-	while (irlen > 0 && fabs(ir[irlen-1]) < 0.000001f)
-		irlen--;
-
-	conv = calloc(1, sizeof(*conv));
+	conv = calloc(1, sizeof(*conv) + n_ir * sizeof(struct convolver1_ir));
 	if (conv == NULL)
 		return NULL;
 
-	if (irlen == 0)
+	conv->n_ir = n_ir;
+	conv->blockSize = next_power_of_two(block);
+
+	for (k = 0; k < n_ir; k++) {
+		int len = trim_ir(ir[k], irlen[k]);
+		conv->ir[k].segCount = (len + conv->blockSize-1) / conv->blockSize;
+		conv->segCount = SPA_MAX(conv->segCount, conv->ir[k].segCount);
+	}
+	if (conv->segCount == 0)
 		return conv;
 
-	conv->blockSize = next_power_of_two(block);
 	conv->segSize = 2 * conv->blockSize;
-	conv->segCount = (irlen + conv->blockSize-1) / conv->blockSize;
 	conv->fftComplexSize = (conv->segSize / 2) + 1;
 
 	conv->fft = dsp_ops_fft_new(dsp, conv->segSize, true);
@@ -120,78 +327,55 @@ static struct convolver1 *convolver1_new(int block, const float *ir, int irlen)
 		goto error;
 
 	conv->fft_buffer = fft_alloc(conv->segSize);
-	if (conv->fft_buffer == NULL)
-		goto error;
-
+	conv->inputBuffer = fft_alloc(conv->segSize);
 	conv->segments = calloc(conv->segCount, sizeof(float*));
-	conv->segmentsIr = calloc(conv->segCount, sizeof(float*));
+	if (conv->fft_buffer == NULL || conv->inputBuffer == NULL ||
+	    conv->segments == NULL)
+		goto error;
 
 	for (i = 0; i < conv->segCount; i++) {
-		int left = irlen - (i * conv->blockSize);
-		int copy = SPA_MIN(conv->blockSize, left);
+		if ((conv->segments[i] = fft_cpx_alloc(conv->fftComplexSize)) == NULL)
+			goto error;
+	}
 
-		conv->segments[i] = fft_cpx_alloc(conv->fftComplexSize);
-		conv->segmentsIr[i] = fft_cpx_alloc(conv->fftComplexSize);
+	for (k = 0; k < n_ir; k++) {
+		struct convolver1_ir *r = &conv->ir[k];
+		int len = trim_ir(ir[k], irlen[k]);
 
-		dsp_ops_copy(dsp, conv->fft_buffer, &ir[i * conv->blockSize], copy);
-		if (copy < conv->segSize)
-			dsp_ops_clear(dsp, conv->fft_buffer + copy, conv->segSize - copy);
+		if (r->segCount == 0)
+			continue;
 
-	        dsp_ops_fft_run(dsp, conv->fft, 1, conv->fft_buffer, conv->segmentsIr[i]);
+		r->spectra = ir_spectra_get(conv, ir[k], len);
+		r->pre_mult = fft_cpx_alloc(conv->fftComplexSize);
+		r->conv = fft_cpx_alloc(conv->fftComplexSize);
+		r->overlap = fft_alloc(conv->blockSize);
+		if (r->spectra == NULL || r->pre_mult == NULL ||
+		    r->conv == NULL || r->overlap == NULL)
+			goto error;
 	}
-	conv->pre_mult = fft_cpx_alloc(conv->fftComplexSize);
-	conv->conv = fft_cpx_alloc(conv->fftComplexSize);
-	conv->overlap = fft_alloc(conv->blockSize);
-	conv->inputBuffer = fft_alloc(conv->segSize);
 	conv->scale = 1.0f / conv->segSize;
 	convolver1_reset(conv);
 
 	return conv;
 error:
-	if (conv->fft)
-		dsp_ops_fft_free(dsp, conv->fft);
-	if (conv->ifft)
-		dsp_ops_fft_free(dsp, conv->ifft);
-	if (conv->fft_buffer)
-		fft_free(conv->fft_buffer);
-	free(conv);
+	convolver1_free(conv);
 	return NULL;
 }
 
-static void convolver1_free(struct convolver1 *conv)
-{
-	int i;
-	for (i = 0; i < conv->segCount; i++) {
-		fft_cpx_free(conv->segments[i]);
-		fft_cpx_free(conv->segmentsIr[i]);
-	}
-	if (conv->fft)
-		dsp_ops_fft_free(dsp, conv->fft);
-	if (conv->ifft)
-		dsp_ops_fft_free(dsp, conv->ifft);
-	if (conv->fft_buffer)
-		fft_free(conv->fft_buffer);
-	free(conv->segments);
-	free(conv->segmentsIr);
-	fft_cpx_free(conv->pre_mult);
-	fft_cpx_free(conv->conv);
-	fft_free(conv->overlap);
-	fft_free(conv->inputBuffer);
-	free(conv);
-}
-
-static int convolver1_run(struct convolver1 *conv, const float *input, float *output, int len)
+static int convolver1_run(struct convolver1 *conv, const float *input, float *output[], int len)
 {
-	int i, processed = 0;
+	int i, k, processed = 0;
 
-	if (conv == NULL || conv->segCount == 0) {
-		dsp_ops_clear(dsp, output, len);
+	if (conv->segCount == 0) {
+		for (k = 0; k < conv->n_ir; k++)
+			dsp_ops_clear(dsp, output[k], len);
 		return len;
 	}
 
 	while (processed < len) {
 		const int processing = SPA_MIN(len - processed, conv->blockSize - conv->inputBufferFill);
 		const int inputBufferPos = conv->inputBufferFill;
+		const bool blockDone = inputBufferPos + processing == conv->blockSize;
 
 		dsp_ops_copy(dsp, conv->inputBuffer + inputBufferPos, input + processed, processing);
 		if (inputBufferPos == 0 && processing < conv->blockSize)
@@ -199,51 +383,60 @@ static int convolver1_run(struct convolver1 *conv, const float *input, float *ou
 
 		dsp_ops_fft_run(dsp, conv->fft, 1, conv->inputBuffer, conv->segments[conv->current]);
 
-		if (conv->segCount > 1) {
-			if (conv->inputBufferFill == 0) {
-				int indexAudio = (conv->current + 1) % conv->segCount;
+		for (k = 0; k < conv->n_ir; k++) {
+			struct convolver1_ir *r = &conv->ir[k];
 
-				dsp_ops_fft_cmul(dsp, conv->fft, conv->pre_mult,
-						conv->segmentsIr[1],
-						conv->segments[indexAudio],
-						conv->fftComplexSize, conv->scale);
-
-				for (i = 2; i < conv->segCount; i++) {
-					indexAudio = (conv->current + i) % conv->segCount;
+			if (r->segCount == 0) {
+				dsp_ops_clear(dsp, output[k] + processed, processing);
+				continue;
+			}
+			if (r->segCount > 1) {
+				if (inputBufferPos == 0) {
+					int indexAudio = (conv->current + 1) % conv->segCount;
 
-					dsp_ops_fft_cmuladd(dsp, conv->fft,
-							conv->pre_mult,
-							conv->pre_mult,
-							conv->segmentsIr[i],
+					dsp_ops_fft_cmul(dsp, conv->fft, r->pre_mult,
+							r->spectra->segments[1],
 							conv->segments[indexAudio],
 							conv->fftComplexSize, conv->scale);
+
+					for (i = 2; i < r->segCount; i++) {
+						indexAudio = (conv->current + i) % conv->segCount;
+
+						dsp_ops_fft_cmuladd(dsp, conv->fft,
+								r->pre_mult,
+								r->pre_mult,
+								r->spectra->segments[i],
+								conv->segments[indexAudio],
+								conv->fftComplexSize, conv->scale);
+					}
 				}
+				dsp_ops_fft_cmuladd(dsp, conv->fft,
+						r->conv,
+						r->pre_mult,
+						conv->segments[conv->current],
+						r->spectra->segments[0],
+						conv->fftComplexSize, conv->scale);
+			} else {
+				dsp_ops_fft_cmul(dsp, conv->fft,
+						r->conv,
+						conv->segments[conv->current],
+						r->spectra->segments[0],
+						conv->fftComplexSize, conv->scale);
 			}
-			dsp_ops_fft_cmuladd(dsp, conv->fft,
-					conv->conv,
-					conv->pre_mult,
-					conv->segments[conv->current],
-					conv->segmentsIr[0],
-					conv->fftComplexSize, conv->scale);
-		} else {
-			dsp_ops_fft_cmul(dsp, conv->fft,
-					conv->conv,
-					conv->segments[conv->current],
-					conv->segmentsIr[0],
-					conv->fftComplexSize, conv->scale);
-		}
 
-		dsp_ops_fft_run(dsp, conv->ifft, -1, conv->conv, conv->fft_buffer);
+			dsp_ops_fft_run(dsp, conv->ifft, -1, r->conv, conv->fft_buffer);
+
+			dsp_ops_sum(dsp, output[k] + processed, conv->fft_buffer + inputBufferPos,
+					r->overlap + inputBufferPos, processing);
 
-		dsp_ops_sum(dsp, output + processed, conv->fft_buffer + inputBufferPos,
-				conv->overlap + inputBufferPos, processing);
+			if (blockDone)
+				dsp_ops_copy(dsp, r->overlap, conv->fft_buffer + conv->blockSize,
+						conv->blockSize);
+		}
 
 		conv->inputBufferFill += processing;
-		if (conv->inputBufferFill == conv->blockSize) {
+		if (blockDone) {
 			conv->inputBufferFill = 0;
-
-			dsp_ops_copy(dsp, conv->overlap, conv->fft_buffer + conv->blockSize, conv->blockSize);
-
 			conv->current = (conv->current > 0) ? (conv->current - 1) : (conv->segCount - 1);
 		}
 
@@ -256,106 +449,249 @@ struct convolver
 {
 	int headBlockSize;
 	int tailBlockSize;
+	int n_ir;
 	struct convolver1 *headConvolver;
 	struct convolver1 *tailConvolver0;
-	float *tailOutput0;
-	float *tailPrecalculated0;
+	float **tailOutput0;
+	float **tailPrecalculated0;
 	struct convolver1 *tailConvolver;
-	float *tailOutput;
-	float *tailPrecalculated;
+	float **tailOutput;
+	float **tailPrecalculated;
 	float *tailInput;
 	int tailInputFill;
 	int precalculatedPos;
+	float **outputs;
+
+	/* the tail convolver can run in a thread, it then has a whole
+	 * tail block to produce the next tailOutput */
+	struct spa_thread_utils *thread_utils;
+	struct spa_thread *thread;
+	sem_t thread_start;
+	sem_t thread_done;
+	bool thread_running;
+	bool thread_busy;
+	float *tailThreadInput;
 };
 
+static void *tail_thread(void *data)
+{
+	struct convolver *conv = data;
+
+	while (true) {
+		sem_wait(&conv->thread_start);
+		if (!conv->thread_running)
+			break;
+		convolver1_run(conv->tailConvolver, conv->tailThreadInput,
+				conv->tailOutput, conv->tailBlockSize);
+		sem_post(&conv->thread_done);
+	}
+	return NULL;
+}
+
+static void tail_thread_wait(struct convolver *conv)
+{
+	if (conv->thread_busy) {
+		sem_wait(&conv->thread_done);
+		conv->thread_busy = false;
+	}
+}
+
+int convolver_start_thread(struct convolver *conv, struct spa_thread_utils *utils)
+{
+	int min, max;
+
+	if (conv->tailConvolver == NULL || conv->thread != NULL)
+		return 0;
+	if (utils == NULL)
+		return -ENOTSUP;
+
+	conv->tailThreadInput = fft_alloc(conv->tailBlockSize);
+	if (conv->tailThreadInput == NULL)
+		return -errno;
+
+	sem_init(&conv->thread_start, 0, 0);
+	sem_init(&conv->thread_done, 0, 0);
+	conv->thread_utils = utils;
+	conv->thread_running = true;
+
+	conv->thread = spa_thread_utils_create(utils, NULL, tail_thread, conv);
+	if (conv->thread == NULL) {
+		int res = -errno;
+		sem_destroy(&conv->thread_start);
+		sem_destroy(&conv->thread_done);
+		fft_free(conv->tailThreadInput);
+		conv->tailThreadInput = NULL;
+		return res;
+	}
+	/* below the data thread so that it is never delayed by the tail */
+	if (spa_thread_utils_get_rt_range(utils, NULL, &min, &max) >= 0)
+		spa_thread_utils_acquire_rt(utils, conv->thread, min);
+	return 0;
+}
+
+static void convolver_stop_thread(struct convolver *conv)
+{
+	if (conv->thread == NULL)
+		return;
+
+	tail_thread_wait(conv);
+	conv->thread_running = false;
+	sem_post(&conv->thread_start);
+	spa_thread_utils_join(conv->thread_utils, conv->thread, NULL);
+	sem_destroy(&conv->thread_start);
+	sem_destroy(&conv->thread_done);
+	fft_free(conv->tailThreadInput);
+	conv->thread = NULL;
+}
+
 void convolver_reset(struct convolver *conv)
 {
+	int k;
+
+	tail_thread_wait(conv);
 	if (conv->headConvolver)
 		convolver1_reset(conv->headConvolver);
 	if (conv->tailConvolver0) {
 		convolver1_reset(conv->tailConvolver0);
-		dsp_ops_clear(dsp, conv->tailOutput0, conv->tailBlockSize);
-		dsp_ops_clear(dsp, conv->tailPrecalculated0, conv->tailBlockSize);
+		for (k = 0; k < conv->n_ir; k++) {
+			dsp_ops_clear(dsp, conv->tailOutput0[k], conv->tailBlockSize);
+			dsp_ops_clear(dsp, conv->tailPrecalculated0[k], conv->tailBlockSize);
+		}
 	}
 	if (conv->tailConvolver) {
 		convolver1_reset(conv->tailConvolver);
-		dsp_ops_clear(dsp, conv->tailOutput, conv->tailBlockSize);
-		dsp_ops_clear(dsp, conv->tailPrecalculated, conv->tailBlockSize);
+		for (k = 0; k < conv->n_ir; k++) {
+			dsp_ops_clear(dsp, conv->tailOutput[k], conv->tailBlockSize);
+			dsp_ops_clear(dsp, conv->tailPrecalculated[k], conv->tailBlockSize);
+		}
 	}
 	conv->tailInputFill = 0;
 	conv->precalculatedPos = 0;
 }
 
-struct convolver *convolver_new(struct dsp_ops *dsp_ops, int head_block, int tail_block, const float *ir, int irlen)
+struct convolver *convolver_new_multi(struct dsp_ops *dsp_ops, int head_block, int tail_block,
+		const float *ir[], const int irlen[], int n_ir)
 {
 	struct convolver *conv;
-	int head_ir_len;
+	const float **irs = NULL;
+	int k, *len = NULL, *lens = NULL, max_len = 0;
 
 	dsp = dsp_ops;
 
-	if (head_block == 0 || tail_block == 0)
+	if (head_block == 0 || tail_block == 0 || n_ir <= 0)
 		return NULL;
 
 	head_block = SPA_MAX(1, head_block);
 	if (head_block > tail_block)
 		SPA_SWAP(head_block, tail_block);
 
-	while (irlen > 0 && fabs(ir[irlen-1]) < 0.000001f)
-		irlen--;
-
 	conv = calloc(1, sizeof(*conv));
 	if (conv == NULL)
 		return NULL;
 
-	if (irlen == 0)
-		return conv;
+	conv->n_ir = n_ir;
+
+	irs = calloc(n_ir, sizeof(float *));
+	len = calloc(n_ir, sizeof(int));
+	lens = calloc(n_ir, sizeof(int));
+	conv->outputs = calloc(n_ir, sizeof(float *));
+	if (irs == NULL || len == NULL || lens == NULL || conv->outputs == NULL)
+		goto error;
+
+	for (k = 0; k < n_ir; k++) {
+		len[k] = trim_ir(ir[k], irlen[k]);
+		max_len = SPA_MAX(max_len, len[k]);
+	}
+	if (max_len == 0)
+		goto done;
 
 	conv->headBlockSize = next_power_of_two(head_block);
 	conv->tailBlockSize = next_power_of_two(tail_block);
 
-	head_ir_len = SPA_MIN(irlen, conv->tailBlockSize);
-	conv->headConvolver = convolver1_new(conv->headBlockSize, ir, head_ir_len);
+	for (k = 0; k < n_ir; k++)
+		lens[k] = SPA_MIN(len[k], conv->tailBlockSize);
+	conv->headConvolver = convolver1_new(conv->headBlockSize, ir, lens, n_ir);
+	if (conv->headConvolver == NULL)
+		goto error;
 
-	if (irlen > conv->tailBlockSize) {
-		int conv1IrLen = SPA_MIN(irlen - conv->tailBlockSize, conv->tailBlockSize);
-		conv->tailConvolver0 = convolver1_new(conv->headBlockSize, ir + conv->tailBlockSize, conv1IrLen);
-		conv->tailOutput0 = fft_alloc(conv->tailBlockSize);
-		conv->tailPrecalculated0 = fft_alloc(conv->tailBlockSize);
+	if (max_len > conv->tailBlockSize) {
+		for (k = 0; k < n_ir; k++) {
+			lens[k] = SPA_CLAMP(len[k] - conv->tailBlockSize, 0, conv->tailBlockSize);
+			irs[k] = lens[k] > 0 ? ir[k] + conv->tailBlockSize : ir[k];
+		}
+		conv->tailConvolver0 = convolver1_new(conv->headBlockSize, irs, lens, n_ir);
+		conv->tailOutput0 = fft_alloc_array(n_ir, conv->tailBlockSize);
+		conv->tailPrecalculated0 = fft_alloc_array(n_ir, conv->tailBlockSize);
+		if (conv->tailConvolver0 == NULL || conv->tailOutput0 == NULL ||
+		    conv->tailPrecalculated0 == NULL)
+			goto error;
 	}
 
-	if (irlen > 2 * conv->tailBlockSize) {
-		int tailIrLen = irlen - (2 * conv->tailBlockSize);
-		conv->tailConvolver = convolver1_new(conv->tailBlockSize, ir + (2 * conv->tailBlockSize), tailIrLen);
-		conv->tailOutput = fft_alloc(conv->tailBlockSize);
-		conv->tailPrecalculated = fft_alloc(conv->tailBlockSize);
+	if (max_len > 2 * conv->tailBlockSize) {
+		for (k = 0; k < n_ir; k++) {
+			lens[k] = SPA_MAX(len[k] - 2 * conv->tailBlockSize, 0);
+			irs[k] = lens[k] > 0 ? ir[k] + 2 * conv->tailBlockSize : ir[k];
+		}
+		conv->tailConvolver = convolver1_new(conv->tailBlockSize, irs, lens, n_ir);
+		conv->tailOutput = fft_alloc_array(n_ir, conv->tailBlockSize);
+		conv->tailPrecalculated = fft_alloc_array(n_ir, conv->tailBlockSize);
+		if (conv->tailConvolver == NULL || conv->tailOutput == NULL ||
+		    conv->tailPrecalculated == NULL)
+			goto error;
 	}
 
-	if (conv->tailConvolver0 || conv->tailConvolver)
-		conv->tailInput = fft_alloc(conv->tailBlockSize);
+	if (conv->tailConvolver0 || conv->tailConvolver) {
+		if ((conv->tailInput = fft_alloc(conv->tailBlockSize)) == NULL)
+			goto error;
+	}
 
 	convolver_reset(conv);
-
+done:
+	free(irs);
+	free(len);
+	free(lens);
 	return conv;
+error:
+	free(irs);
+	free(len);
+	free(lens);
+	convolver_free(conv);
+	return NULL;
+}
+
+struct convolver *convolver_new(struct dsp_ops *dsp_ops, int head_block, int tail_block, const float *ir, int irlen)
+{
+	return convolver_new_multi(dsp_ops, head_block, tail_block, &ir, &irlen, 1);
 }
 
 void convolver_free(struct convolver *conv)
 {
+	convolver_stop_thread(conv);
 	if (conv->headConvolver)
 		convolver1_free(conv->headConvolver);
 	if (conv->tailConvolver0)
 		convolver1_free(conv->tailConvolver0);
 	if (conv->tailConvolver)
 		convolver1_free(conv->tailConvolver);
-	fft_free(conv->tailOutput0);
-	fft_free(conv->tailPrecalculated0);
-	fft_free(conv->tailOutput);
-	fft_free(conv->tailPrecalculated);
+	fft_free_array(conv->tailOutput0, conv->n_ir);
+	fft_free_array(conv->tailPrecalculated0, conv->n_ir);
+	fft_free_array(conv->tailOutput, conv->n_ir);
+	fft_free_array(conv->tailPrecalculated, conv->n_ir);
 	fft_free(conv->tailInput);
+	free(conv->outputs);
 	free(conv);
 }
 
-int convolver_run(struct convolver *conv, const float *input, float *output, int length)
+int convolver_run_multi(struct convolver *conv, const float *input, float *output[], int length)
 {
+	int k;
+
+	if (conv->headConvolver == NULL) {
+		for (k = 0; k < conv->n_ir; k++)
+			dsp_ops_clear(dsp, output[k], length);
+		return 0;
+	}
+
 	convolver1_run(conv->headConvolver, input, output, length);
 
 	if (conv->tailInput) {
@@ -365,14 +701,16 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 			int remaining = length - processed;
 			int processing = SPA_MIN(remaining, conv->headBlockSize - (conv->tailInputFill % conv->headBlockSize));
 
-			if (conv->tailPrecalculated0)
-				dsp_ops_sum(dsp, &output[processed], &output[processed],
-						&conv->tailPrecalculated0[conv->precalculatedPos],
-						processing);
-			if (conv->tailPrecalculated)
-				dsp_ops_sum(dsp, &output[processed], &output[processed],
-						&conv->tailPrecalculated[conv->precalculatedPos],
-						processing);
+			for (k = 0; k < conv->n_ir; k++) {
+				if (conv->tailPrecalculated0)
+					dsp_ops_sum(dsp, &output[k][processed], &output[k][processed],
+							&conv->tailPrecalculated0[k][conv->precalculatedPos],
+							processing);
+				if (conv->tailPrecalculated)
+					dsp_ops_sum(dsp, &output[k][processed], &output[k][processed],
+							&conv->tailPrecalculated[k][conv->precalculatedPos],
+							processing);
+			}
 			conv->precalculatedPos += processing;
 
 			dsp_ops_copy(dsp, conv->tailInput + conv->tailInputFill, input + processed, processing);
@@ -380,9 +718,11 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 
 			if (conv->tailPrecalculated0 && (conv->tailInputFill % conv->headBlockSize == 0)) {
 				int blockOffset = conv->tailInputFill - conv->headBlockSize;
+				for (k = 0; k < conv->n_ir; k++)
+					conv->outputs[k] = conv->tailOutput0[k] + blockOffset;
 				convolver1_run(conv->tailConvolver0,
 						conv->tailInput + blockOffset,
-						conv->tailOutput0 + blockOffset,
+						conv->outputs,
 						conv->headBlockSize);
 				if (conv->tailInputFill == conv->tailBlockSize)
 					SPA_SWAP(conv->tailPrecalculated0, conv->tailOutput0);
@@ -390,9 +730,19 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 
 			if (conv->tailPrecalculated &&
 			    conv->tailInputFill == conv->tailBlockSize) {
-				SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
-				convolver1_run(conv->tailConvolver, conv->tailInput,
-						conv->tailOutput, conv->tailBlockSize);
+				if (conv->thread) {
+					/* the previous block should be done by now */
+					tail_thread_wait(conv);
+					SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
+					dsp_ops_copy(dsp, conv->tailThreadInput, conv->tailInput,
+							conv->tailBlockSize);
+					conv->thread_busy = true;
+					sem_post(&conv->thread_start);
+				} else {
+					SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
+					convolver1_run(conv->tailConvolver, conv->tailInput,
+							conv->tailOutput, conv->tailBlockSize);
+				}
 			}
 			if (conv->tailInputFill == conv->tailBlockSize) {
 				conv->tailInputFill = 0;
@@ -403,3 +753,8 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 	}
 	return 0;
 }
+
+int convolver_run(struct convolver *conv, const float *input, float *output, int length)
+{
+	return convolver_run_multi(conv, input, &output, length);
+}
@@ -5,10 +5,17 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <spa/support/thread.h>
+
 #include "dsp-ops.h"
 
 struct convolver *convolver_new(struct dsp_ops *dsp, int block, int tail, const float *ir, int irlen);
+struct convolver *convolver_new_multi(struct dsp_ops *dsp, int block, int tail,
+		const float *ir[], const int irlen[], int n_ir);
 void convolver_free(struct convolver *conv);
 
+int convolver_start_thread(struct convolver *conv, struct spa_thread_utils *utils);
+
 void convolver_reset(struct convolver *conv);
 int convolver_run(struct convolver *conv, const float *input, float *output, int length);
+int convolver_run_multi(struct convolver *conv, const float *input, float *output[], int length);
@@ -9,6 +9,7 @@
 #include <spa/utils/defs.h>
 
 #include "dsp-ops.h"
+#include "pffft.h"
 
 #include <immintrin.h>
 
@@ -63,3 +64,87 @@ void dsp_sum_avx(struct dsp_ops *ops, float *r, const float *a, const float *b,
 		_mm_store_ss(&r[n], in[0]);
 	}
 }
+
+/* The spectra are in the unordered pffft SSE layout: blocks of 4 real parts
+ * followed by 4 imaginary parts. Two blocks make one 8 wide real and one
+ * imaginary vector. For real transforms the first real and imaginary slot
+ * hold the DC and Nyquist bins, they are fixed up at the end. */
+static inline void load_cpx(const float *p, __m256 *re, __m256 *im)
+{
+	__m256 v0 = _mm256_load_ps(p), v1 = _mm256_load_ps(p + 8);
+	*re = _mm256_permute2f128_ps(v0, v1, 0x20);
+	*im = _mm256_permute2f128_ps(v0, v1, 0x31);
+}
+static inline void store_cpx(float *p, __m256 re, __m256 im)
+{
+	_mm256_store_ps(p, _mm256_permute2f128_ps(re, im, 0x20));
+	_mm256_store_ps(p + 8, _mm256_permute2f128_ps(re, im, 0x31));
+}
+
+void dsp_fft_cmul_avx(struct dsp_ops *ops, void *fft,
+	float * SPA_RESTRICT dst, const float * SPA_RESTRICT a,
+	const float * SPA_RESTRICT b, uint32_t len, const float scale)
+{
+	uint32_t n, n_floats;
+	bool real;
+	float dc, ny;
+	__m256 s = _mm256_set1_ps(scale);
+	__m256 ar, ai, br, bi, r, i;
+
+	if (pffft_simd_size() != 4) {
+		pffft_zconvolve(fft, a, b, dst, scale);
+		return;
+	}
+	real = pffft_get_transform(fft) == PFFFT_REAL;
+	n_floats = pffft_get_size(fft) * (real ? 1 : 2);
+	dc = a[0] * b[0] * scale;
+	ny = a[4] * b[4] * scale;
+
+	for (n = 0; n < n_floats; n += 16) {
+		load_cpx(&a[n], &ar, &ai);
+		load_cpx(&b[n], &br, &bi);
+		r = _mm256_sub_ps(_mm256_mul_ps(ar, br), _mm256_mul_ps(ai, bi));
+		i = _mm256_add_ps(_mm256_mul_ps(ar, bi), _mm256_mul_ps(ai, br));
+		store_cpx(&dst[n], _mm256_mul_ps(r, s), _mm256_mul_ps(i, s));
+	}
+	if (real) {
+		dst[0] = dc;
+		dst[4] = ny;
+	}
+}
+
+void dsp_fft_cmuladd_avx(struct dsp_ops *ops, void *fft,
+	float * dst, const float * src,
+	const float * SPA_RESTRICT a, const float * SPA_RESTRICT b,
+	uint32_t len, const float scale)
+{
+	uint32_t n, n_floats;
+	bool real;
+	float dc, ny;
+	__m256 s = _mm256_set1_ps(scale);
+	__m256 ar, ai, br, bi, cr, ci, r, i;
+
+	if (pffft_simd_size() != 4) {
+		pffft_zconvolve_accumulate(fft, a, b, src, dst, scale);
+		return;
+	}
+	real = pffft_get_transform(fft) == PFFFT_REAL;
+	n_floats = pffft_get_size(fft) * (real ? 1 : 2);
+	dc = src[0] + a[0] * b[0] * scale;
+	ny = src[4] + a[4] * b[4] * scale;
+
+	for (n = 0; n < n_floats; n += 16) {
+		load_cpx(&a[n], &ar, &ai);
+		load_cpx(&b[n], &br, &bi);
+		r = _mm256_sub_ps(_mm256_mul_ps(ar, br), _mm256_mul_ps(ai, bi));
+		i = _mm256_add_ps(_mm256_mul_ps(ar, bi), _mm256_mul_ps(ai, br));
+		load_cpx(&src[n], &cr, &ci);
+		r = _mm256_add_ps(cr, _mm256_mul_ps(r, s));
+		i = _mm256_add_ps(ci, _mm256_mul_ps(i, s));
+		store_cpx(&dst[n], r, i);
+	}
+	if (real) {
+		dst[0] = dc;
+		dst[4] = ny;
+	}
+}
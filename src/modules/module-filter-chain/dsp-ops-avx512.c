@@ -0,0 +1,102 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "dsp-ops.h"
+#include "pffft.h"
+
+#include <immintrin.h>
+
+/* The spectra are in the unordered pffft SSE layout: blocks of 4 real parts
+ * followed by 4 imaginary parts. Two 16 float loads are split into one real
+ * and one imaginary vector and merged back before the store. */
+static const int32_t re_idx[16] = { 0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27 };
+static const int32_t im_idx[16] = { 4, 5, 6, 7, 12, 13, 14, 15, 20, 21, 22, 23, 28, 29, 30, 31 };
+static const int32_t lo_idx[16] = { 0, 1, 2, 3, 16, 17, 18, 19, 4, 5, 6, 7, 20, 21, 22, 23 };
+static const int32_t hi_idx[16] = { 8, 9, 10, 11, 24, 25, 26, 27, 12, 13, 14, 15, 28, 29, 30, 31 };
+
+static inline void load_cpx(const float *p, __m512 *re, __m512 *im)
+{
+	const __m512i ri = _mm512_loadu_si512(re_idx), ii = _mm512_loadu_si512(im_idx);
+	__m512 v0 = _mm512_loadu_ps(p), v1 = _mm512_loadu_ps(p + 16);
+	*re = _mm512_permutex2var_ps(v0, ri, v1);
+	*im = _mm512_permutex2var_ps(v0, ii, v1);
+}
+static inline void store_cpx(float *p, __m512 re, __m512 im)
+{
+	const __m512i li = _mm512_loadu_si512(lo_idx), hi = _mm512_loadu_si512(hi_idx);
+	_mm512_storeu_ps(p, _mm512_permutex2var_ps(re, li, im));
+	_mm512_storeu_ps(p + 16, _mm512_permutex2var_ps(re, hi, im));
+}
+
+void dsp_fft_cmul_avx512(struct dsp_ops *ops, void *fft,
+	float * SPA_RESTRICT dst, const float * SPA_RESTRICT a,
+	const float * SPA_RESTRICT b, uint32_t len, const float scale)
+{
+	uint32_t n, n_floats;
+	bool real;
+	float dc, ny;
+	__m512 s = _mm512_set1_ps(scale);
+	__m512 ar, ai, br, bi, r, i;
+
+	if (pffft_simd_size() != 4) {
+		pffft_zconvolve(fft, a, b, dst, scale);
+		return;
+	}
+	real = pffft_get_transform(fft) == PFFFT_REAL;
+	n_floats = pffft_get_size(fft) * (real ? 1 : 2);
+	dc = a[0] * b[0] * scale;
+	ny = a[4] * b[4] * scale;
+
+	for (n = 0; n < n_floats; n += 32) {
+		load_cpx(&a[n], &ar, &ai);
+		load_cpx(&b[n], &br, &bi);
+		r = _mm512_fmsub_ps(ar, br, _mm512_mul_ps(ai, bi));
+		i = _mm512_fmadd_ps(ar, bi, _mm512_mul_ps(ai, br));
+		store_cpx(&dst[n], _mm512_mul_ps(r, s), _mm512_mul_ps(i, s));
+	}
+	if (real) {
+		dst[0] = dc;
+		dst[4] = ny;
+	}
+}
+
+void dsp_fft_cmuladd_avx512(struct dsp_ops *ops, void *fft,
+	float * dst, const float * src,
+	const float * SPA_RESTRICT a, const float * SPA_RESTRICT b,
+	uint32_t len, const float scale)
+{
+	uint32_t n, n_floats;
+	bool real;
+	float dc, ny;
+	__m512 s = _mm512_set1_ps(scale);
+	__m512 ar, ai, br, bi, cr, ci, r, i;
+
+	if (pffft_simd_size() != 4) {
+		pffft_zconvolve_accumulate(fft, a, b, src, dst, scale);
+		return;
+	}
+	real = pffft_get_transform(fft) == PFFFT_REAL;
+	n_floats = pffft_get_size(fft) * (real ? 1 : 2);
+	dc = src[0] + a[0] * b[0] * scale;
+	ny = src[4] + a[4] * b[4] * scale;
+
+	for (n = 0; n < n_floats; n += 32) {
+		load_cpx(&a[n], &ar, &ai);
+		load_cpx(&b[n], &br, &bi);
+		load_cpx(&src[n], &cr, &ci);
+		r = _mm512_fmsub_ps(ar, br, _mm512_mul_ps(ai, bi));
+		i = _mm512_fmadd_ps(ar, bi, _mm512_mul_ps(ai, br));
+		store_cpx(&dst[n], _mm512_fmadd_ps(r, s, cr), _mm512_fmadd_ps(i, s, ci));
+	}
+	if (real) {
+		dst[0] = dc;
+		dst[4] = ny;
+	}
+}
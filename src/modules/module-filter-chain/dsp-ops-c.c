@@ -135,6 +135,29 @@ void dsp_biquad_run_c(struct dsp_ops *ops, struct biquad *bq,
 #undef F
 }
 
+void dsp_biquadn_run_c(struct dsp_ops *ops, struct biquad *bq,
+		uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[], const float * SPA_RESTRICT in[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < n_src; i++, bq += bq_stride) {
+		const float *s = in[i];
+		float *d = out[i];
+
+		if (s == NULL || d == NULL)
+			continue;
+
+		if (n_bq == 0)
+			dsp_copy_c(ops, d, s, n_samples);
+		for (j = 0; j < n_bq; j++) {
+			dsp_biquad_run_c(ops, &bq[j], d, s, n_samples);
+			s = d;
+		}
+	}
+}
+
 void dsp_sum_c(struct dsp_ops *ops, float * dst,
 		const float * SPA_RESTRICT a, const float * SPA_RESTRICT b, uint32_t n_samples)
 {
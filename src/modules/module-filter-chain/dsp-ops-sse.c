@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 
 #include <spa/utils/defs.h>
 
@@ -120,3 +121,112 @@ void dsp_sum_sse(struct dsp_ops *ops, float *r, const float *a, const float *b,
 		_mm_store_ss(&r[n], in[0]);
 	}
 }
+
+#define BQ_STAGES	16u
+
+/* run a cascade of up to BQ_STAGES biquads on 4 channels at once, one
+ * channel in each lane. Blocks of 4 samples are transposed so that each
+ * vector holds the same sample of the 4 channels. */
+static void biquad4_run_sse(struct biquad *bq, uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[4], const float * SPA_RESTRICT in[4],
+		uint32_t n_samples)
+{
+	__m128 b0[BQ_STAGES], b1[BQ_STAGES], b2[BQ_STAGES];
+	__m128 a1[BQ_STAGES], a2[BQ_STAGES];
+	__m128 x1[BQ_STAGES], x2[BQ_STAGES];
+	__m128 v[4], x, y;
+	float t[4] __attribute__ ((aligned (16)));
+	uint32_t i, j, k;
+
+	for (j = 0; j < n_bq; j++) {
+		struct biquad *q[4] = { &bq[j], &bq[bq_stride + j],
+			&bq[2 * bq_stride + j], &bq[3 * bq_stride + j] };
+		b0[j] = _mm_setr_ps(q[0]->b0, q[1]->b0, q[2]->b0, q[3]->b0);
+		b1[j] = _mm_setr_ps(q[0]->b1, q[1]->b1, q[2]->b1, q[3]->b1);
+		b2[j] = _mm_setr_ps(q[0]->b2, q[1]->b2, q[2]->b2, q[3]->b2);
+		a1[j] = _mm_setr_ps(q[0]->a1, q[1]->a1, q[2]->a1, q[3]->a1);
+		a2[j] = _mm_setr_ps(q[0]->a2, q[1]->a2, q[2]->a2, q[3]->a2);
+		x1[j] = _mm_setr_ps(q[0]->x1, q[1]->x1, q[2]->x1, q[3]->x1);
+		x2[j] = _mm_setr_ps(q[0]->x2, q[1]->x2, q[2]->x2, q[3]->x2);
+	}
+
+	for (i = 0; i + 4 <= n_samples; i += 4) {
+		v[0] = _mm_loadu_ps(&in[0][i]);
+		v[1] = _mm_loadu_ps(&in[1][i]);
+		v[2] = _mm_loadu_ps(&in[2][i]);
+		v[3] = _mm_loadu_ps(&in[3][i]);
+		_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+		for (k = 0; k < 4; k++) {
+			x = v[k];
+			for (j = 0; j < n_bq; j++) {
+				y = _mm_add_ps(_mm_mul_ps(x, b0[j]), x1[j]);
+				x1[j] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x, b1[j]),
+							_mm_mul_ps(y, a1[j])), x2[j]);
+				x2[j] = _mm_sub_ps(_mm_mul_ps(x, b2[j]), _mm_mul_ps(y, a2[j]));
+				x = y;
+			}
+			v[k] = x;
+		}
+
+		_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+		_mm_storeu_ps(&out[0][i], v[0]);
+		_mm_storeu_ps(&out[1][i], v[1]);
+		_mm_storeu_ps(&out[2][i], v[2]);
+		_mm_storeu_ps(&out[3][i], v[3]);
+	}
+	for (; i < n_samples; i++) {
+		x = _mm_setr_ps(in[0][i], in[1][i], in[2][i], in[3][i]);
+		for (j = 0; j < n_bq; j++) {
+			y = _mm_add_ps(_mm_mul_ps(x, b0[j]), x1[j]);
+			x1[j] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x, b1[j]),
+						_mm_mul_ps(y, a1[j])), x2[j]);
+			x2[j] = _mm_sub_ps(_mm_mul_ps(x, b2[j]), _mm_mul_ps(y, a2[j]));
+			x = y;
+		}
+		_mm_store_ps(t, x);
+		out[0][i] = t[0];
+		out[1][i] = t[1];
+		out[2][i] = t[2];
+		out[3][i] = t[3];
+	}
+
+#define F(x) (-FLT_MIN < (x) && (x) < FLT_MIN ? 0.0f : (x))
+	for (j = 0; j < n_bq; j++) {
+		_mm_store_ps(t, x1[j]);
+		for (k = 0; k < 4; k++)
+			bq[k * bq_stride + j].x1 = F(t[k]);
+		_mm_store_ps(t, x2[j]);
+		for (k = 0; k < 4; k++)
+			bq[k * bq_stride + j].x2 = F(t[k]);
+	}
+#undef F
+}
+
+void dsp_biquadn_run_sse(struct dsp_ops *ops, struct biquad *bq,
+		uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[], const float * SPA_RESTRICT in[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, j, n;
+
+	for (i = 0; i < n_src; ) {
+		if (n_bq > 0 && i + 4 <= n_src &&
+		    in[i] && in[i+1] && in[i+2] && in[i+3] &&
+		    out[i] && out[i+1] && out[i+2] && out[i+3]) {
+			const float * SPA_RESTRICT *s = &in[i];
+
+			for (j = 0; j < n_bq; j += n) {
+				n = SPA_MIN(n_bq - j, BQ_STAGES);
+				biquad4_run_sse(&bq[i * bq_stride + j], n, bq_stride,
+						&out[i], s, n_samples);
+				s = (const float * SPA_RESTRICT *)&out[i];
+			}
+			i += 4;
+		} else {
+			dsp_biquadn_run_c(ops, &bq[i * bq_stride], n_bq, bq_stride,
+					&out[i], &in[i], 1, n_samples);
+			i++;
+		}
+	}
+}
@@ -20,20 +20,38 @@ struct dsp_info {
 
 static struct dsp_info dsp_table[] =
 {
+#if defined (HAVE_AVX512) && defined (HAVE_AVX)
+	{ SPA_CPU_FLAG_AVX512,
+		.funcs.clear = dsp_clear_c,
+		.funcs.copy = dsp_copy_c,
+		.funcs.mix_gain = dsp_mix_gain_sse,
+		.funcs.biquad_run = dsp_biquad_run_c,
+		.funcs.biquadn_run = dsp_biquadn_run_sse,
+		.funcs.sum = dsp_sum_avx,
+		.funcs.linear = dsp_linear_c,
+		.funcs.mult = dsp_mult_c,
+		.funcs.fft_new = dsp_fft_new_c,
+		.funcs.fft_free = dsp_fft_free_c,
+		.funcs.fft_run = dsp_fft_run_c,
+		.funcs.fft_cmul = dsp_fft_cmul_avx512,
+		.funcs.fft_cmuladd = dsp_fft_cmuladd_avx512,
+	},
+#endif
 #if defined (HAVE_AVX)
 	{ SPA_CPU_FLAG_AVX,
 		.funcs.clear = dsp_clear_c,
 		.funcs.copy = dsp_copy_c,
 		.funcs.mix_gain = dsp_mix_gain_sse,
 		.funcs.biquad_run = dsp_biquad_run_c,
+		.funcs.biquadn_run = dsp_biquadn_run_sse,
 		.funcs.sum = dsp_sum_avx,
 		.funcs.linear = dsp_linear_c,
 		.funcs.mult = dsp_mult_c,
 		.funcs.fft_new = dsp_fft_new_c,
 		.funcs.fft_free = dsp_fft_free_c,
 		.funcs.fft_run = dsp_fft_run_c,
-		.funcs.fft_cmul = dsp_fft_cmul_c,
-		.funcs.fft_cmuladd = dsp_fft_cmuladd_c,
+		.funcs.fft_cmul = dsp_fft_cmul_avx,
+		.funcs.fft_cmuladd = dsp_fft_cmuladd_avx,
 	},
 #endif
 #if defined (HAVE_SSE)
@@ -42,6 +60,7 @@ static struct dsp_info dsp_table[] =
 		.funcs.copy = dsp_copy_c,
 		.funcs.mix_gain = dsp_mix_gain_sse,
 		.funcs.biquad_run = dsp_biquad_run_c,
+		.funcs.biquadn_run = dsp_biquadn_run_sse,
 		.funcs.sum = dsp_sum_sse,
 		.funcs.linear = dsp_linear_c,
 		.funcs.mult = dsp_mult_c,
@@ -57,6 +76,7 @@ static struct dsp_info dsp_table[] =
 		.funcs.copy = dsp_copy_c,
 		.funcs.mix_gain = dsp_mix_gain_c,
 		.funcs.biquad_run = dsp_biquad_run_c,
+		.funcs.biquadn_run = dsp_biquadn_run_c,
 		.funcs.sum = dsp_sum_c,
 		.funcs.linear = dsp_linear_c,
 		.funcs.mult = dsp_mult_c,
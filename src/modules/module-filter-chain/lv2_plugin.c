@@ -4,11 +4,14 @@
 
 #include <dlfcn.h>
 #include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include <spa/utils/defs.h>
 #include <spa/utils/list.h>
 #include <spa/utils/string.h>
-#include <spa/support/loop.h>
+#include <spa/utils/ringbuffer.h>
+#include <spa/support/thread.h>
 
 #include <pipewire/log.h>
 #include <pipewire/utils.h>
@@ -39,6 +42,8 @@
 
 #include "plugin.h"
 
+#define WORK_RING_SIZE	8192u
+
 static struct context *_context;
 
 typedef struct URITable {
@@ -88,8 +93,15 @@ struct context {
 	int ref;
 	LilvWorld *world;
 
-	struct spa_loop *data_loop;
-	struct spa_loop *main_loop;
+	struct spa_thread_utils *thread_utils;
+
+	/* one non-RT thread does the work of all LV2 instances */
+	struct spa_thread *work_thread;
+	sem_t work_sem;
+	bool work_running;
+	pthread_mutex_t work_lock;
+	struct spa_list work_list;
+	uint8_t work_buf[WORK_RING_SIZE];
 
 	LilvNode *lv2_InputPort;
 	LilvNode *lv2_OutputPort;
@@ -117,9 +129,23 @@ struct context {
 
 #define context_map(c,uri) ((c)->map.map((c)->map.handle,(uri)))
 
+static void context_stop_worker(struct context *c)
+{
+	if (c->work_thread == NULL)
+		return;
+	c->work_running = false;
+	sem_post(&c->work_sem);
+	spa_thread_utils_join(c->thread_utils, c->work_thread, NULL);
+	c->work_thread = NULL;
+}
+
 static void context_free(struct context *c)
 {
+	context_stop_worker(c);
+	sem_destroy(&c->work_sem);
+	pthread_mutex_destroy(&c->work_lock);
 	if (c->world) {
+		lilv_node_free(c->worker_iface);
 		lilv_node_free(c->worker_schedule);
 		lilv_node_free(c->powerOf2BlockLength);
 		lilv_node_free(c->fixedBlockLength);
@@ -153,6 +179,10 @@ static struct context *context_new(const struct spa_support *support, uint32_t n
 		return NULL;
 
 	uri_table_init(&c->uri_table);
+	spa_list_init(&c->work_list);
+	pthread_mutex_init(&c->work_lock, NULL);
+	sem_init(&c->work_sem, 0, 0);
+
 	c->world = lilv_world_new();
 	if (c->world == NULL)
 		goto error;
@@ -185,8 +215,7 @@ static struct context *context_new(const struct spa_support *support, uint32_t n
 	c->atom_Int = context_map(c, LV2_ATOM__Int);
 	c->atom_Float = context_map(c, LV2_ATOM__Float);
 
-	c->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
-	c->main_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
+	c->thread_utils = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_ThreadUtils);
 
 	return c;
 error:
@@ -227,6 +256,7 @@ struct descriptor {
 struct instance {
 	struct descriptor *desc;
 	LilvInstance *instance;
+	struct spa_list link;
 	LV2_Worker_Schedule work_schedule;
 	LV2_Feature work_schedule_feature;
 	LV2_Options_Option options[6];
@@ -236,48 +266,118 @@ struct instance {
 
 	const LV2_Worker_Interface *work_iface;
 
+	/* requests from the data thread and responses from the work thread,
+	 * each message is a uint32_t size followed by the data */
+	struct spa_ringbuffer work_ring;
+	uint8_t work_data[WORK_RING_SIZE];
+	struct spa_ringbuffer resp_ring;
+	uint8_t resp_data[WORK_RING_SIZE];
+	uint8_t resp_buf[WORK_RING_SIZE];
+
 	int32_t block_length;
 	LV2_Atom empty_atom;
 };
 
-static int
-do_respond(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
-		size_t size, void *user_data)
+static int ring_push(struct spa_ringbuffer *ring, uint8_t *data,
+		const void *msg, uint32_t size)
 {
-	struct instance *i = (struct instance*)user_data;
-	i->work_iface->work_response(i->instance->lv2_handle, size, data);
+	uint32_t index;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_write_index(ring, &index);
+	if (filled < 0 || filled + sizeof(size) + size > WORK_RING_SIZE)
+		return -ENOSPC;
+
+	spa_ringbuffer_write_data(ring, data, WORK_RING_SIZE,
+			index & (WORK_RING_SIZE - 1), &size, sizeof(size));
+	index += sizeof(size);
+	spa_ringbuffer_write_data(ring, data, WORK_RING_SIZE,
+			index & (WORK_RING_SIZE - 1), msg, size);
+	spa_ringbuffer_write_update(ring, index + size);
 	return 0;
 }
 
-/** Called by the plugin to respond to non-RT work. */
+/* returns the size of the message copied into msg or 0 when the ring is empty */
+static uint32_t ring_pop(struct spa_ringbuffer *ring, uint8_t *data, uint8_t *msg)
+{
+	uint32_t index, size;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_read_index(ring, &index);
+	if (filled < (int32_t)sizeof(size))
+		return 0;
+
+	spa_ringbuffer_read_data(ring, data, WORK_RING_SIZE,
+			index & (WORK_RING_SIZE - 1), &size, sizeof(size));
+	index += sizeof(size);
+	spa_ringbuffer_read_data(ring, data, WORK_RING_SIZE,
+			index & (WORK_RING_SIZE - 1), msg, size);
+	spa_ringbuffer_read_update(ring, index + size);
+	return size;
+}
+
+/** Called by the plugin from work() to respond to non-RT work. */
 static LV2_Worker_Status
 work_respond(LV2_Worker_Respond_Handle handle, uint32_t size, const void *data)
 {
 	struct instance *i = (struct instance*)handle;
-	struct context *c = i->desc->p->c;
-	spa_loop_invoke(c->data_loop, do_respond, 1, data, size, false, i);
+	if (ring_push(&i->resp_ring, i->resp_data, data, size) < 0)
+		return LV2_WORKER_ERR_NO_SPACE;
 	return LV2_WORKER_SUCCESS;
 }
 
-static int
-do_schedule(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
-		size_t size, void *user_data)
-{
-	struct instance *i = (struct instance*)user_data;
-	i->work_iface->work(i->instance->lv2_handle, work_respond, i, size, data);
-	return 0;
-}
-
-/** Called by the plugin to schedule non-RT work. */
+/** Called by the plugin from run() to schedule non-RT work. */
 static LV2_Worker_Status
 work_schedule(LV2_Worker_Schedule_Handle handle, uint32_t size, const void *data)
 {
 	struct instance *i = (struct instance*)handle;
 	struct context *c = i->desc->p->c;
-	spa_loop_invoke(c->main_loop, do_schedule, 1, data, size, false, i);
+	if (ring_push(&i->work_ring, i->work_data, data, size) < 0)
+		return LV2_WORKER_ERR_NO_SPACE;
+	sem_post(&c->work_sem);
 	return LV2_WORKER_SUCCESS;
 }
 
+/* every wakeup handles the pending requests of all instances, the lock
+ * keeps instances from going away while their work is running */
+static void *work_thread(void *data)
+{
+	struct context *c = data;
+	struct instance *i;
+	uint32_t size;
+
+	while (true) {
+		sem_wait(&c->work_sem);
+		if (!c->work_running)
+			break;
+		pthread_mutex_lock(&c->work_lock);
+		spa_list_for_each(i, &c->work_list, link) {
+			while ((size = ring_pop(&i->work_ring, i->work_data, c->work_buf)) > 0)
+				i->work_iface->work(i->instance->lv2_handle,
+						work_respond, i, size, c->work_buf);
+		}
+		pthread_mutex_unlock(&c->work_lock);
+	}
+	return NULL;
+}
+
+static int context_start_worker(struct context *c)
+{
+	if (c->work_thread != NULL)
+		return 0;
+	if (c->thread_utils == NULL) {
+		pw_log_error("no thread utils, can't start LV2 worker");
+		return -ENOTSUP;
+	}
+	c->work_running = true;
+	c->work_thread = spa_thread_utils_create(c->thread_utils, NULL, work_thread, c);
+	if (c->work_thread == NULL) {
+		pw_log_error("can't create LV2 worker thread: %m");
+		return -errno;
+	}
+	return 0;
+}
+
 static void *lv2_instantiate(const struct fc_descriptor *desc,
                         unsigned long SampleRate, int index, const char *config)
 {
@@ -340,6 +440,18 @@ static void *lv2_instantiate(const struct fc_descriptor *desc,
                 i->work_iface = (const LV2_Worker_Interface*)
 			lilv_instance_get_extension_data(i->instance, LV2_WORKER__interface);
         }
+	if (i->work_iface != NULL) {
+		if (context_start_worker(c) < 0) {
+			lilv_instance_free(i->instance);
+			free(i);
+			return NULL;
+		}
+		spa_ringbuffer_init(&i->work_ring);
+		spa_ringbuffer_init(&i->resp_ring);
+		pthread_mutex_lock(&c->work_lock);
+		spa_list_append(&c->work_list, &i->link);
+		pthread_mutex_unlock(&c->work_lock);
+	}
 	for (n = 0; n < desc->n_ports; n++) {
 		const LilvPort *port = lilv_plugin_get_port_by_index(p->p, n);
 		if (lilv_port_is_a(p->p, port, c->atom_AtomPort)) {
@@ -353,6 +465,13 @@ static void *lv2_instantiate(const struct fc_descriptor *desc,
 static void lv2_cleanup(void *instance)
 {
 	struct instance *i = instance;
+	struct context *c = i->desc->p->c;
+
+	if (i->work_iface != NULL) {
+		pthread_mutex_lock(&c->work_lock);
+		spa_list_remove(&i->link);
+		pthread_mutex_unlock(&c->work_lock);
+	}
 	lilv_instance_free(i->instance);
 	free(i);
 }
@@ -378,9 +497,15 @@ static void lv2_deactivate(void *instance)
 static void lv2_run(void *instance, unsigned long SampleCount)
 {
 	struct instance *i = instance;
+	uint32_t size;
+
 	lilv_instance_run(i->instance, SampleCount);
-	if (i->work_iface != NULL && i->work_iface->end_run != NULL)
-		i->work_iface->end_run(i->instance);
+	if (i->work_iface == NULL)
+		return;
+	while ((size = ring_pop(&i->resp_ring, i->resp_data, i->resp_buf)) > 0)
+		i->work_iface->work_response(i->instance->lv2_handle, size, i->resp_buf);
+	if (i->work_iface->end_run != NULL)
+		i->work_iface->end_run(i->instance->lv2_handle);
 }
 
 static void lv2_free(const struct fc_descriptor *desc)
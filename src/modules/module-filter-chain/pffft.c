@@ -2336,6 +2336,16 @@ void pffft_destroy_setup(PFFFT_Setup * s)
 	free(s);
 }
 
+int pffft_get_size(PFFFT_Setup *setup)
+{
+	return setup->N;
+}
+
+pffft_transform_t pffft_get_transform(PFFFT_Setup *setup)
+{
+	return setup->transform;
+}
+
 void pffft_transform(PFFFT_Setup *setup, const float *input, float *output, float *work, pffft_direction_t direction)
 {
 	return funcs->transform(setup, input, output, work, direction, 0);
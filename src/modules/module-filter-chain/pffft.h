@@ -174,6 +174,10 @@ extern "C" {
 
   void pffft_select_cpu(int flags);
 
+  /* return the size and transform type the setup was made with */
+  int pffft_get_size(PFFFT_Setup *setup);
+  pffft_transform_t pffft_get_transform(PFFFT_Setup *setup);
+
 #ifdef __cplusplus
 }
 #endif
@@ -63,6 +63,9 @@ struct fc_descriptor {
 	void (*deactivate) (void *instance);
 
 	void (*run) (void *instance, unsigned long SampleCount);
+	/* optional, runs n_instances instances of the descriptor at once. It is
+	 * used instead of run when the descriptor is duplicated for the channels. */
+	void (*run_multi) (void **instances, uint32_t n_instances, unsigned long SampleCount);
 };
 
 static inline void fc_plugin_free(struct fc_plugin *plugin)
@@ -28,8 +28,8 @@ struct spatializer_impl {
 
 	struct MYSOFA_EASY *sofa;
 	unsigned int interpolate:1;
-	struct convolver *l_conv[3];
-	struct convolver *r_conv[3];
+	/* left and right IR in one convolver, they share the input FFT */
+	struct convolver *conv[3];
 };
 
 static void * spatializer_instantiate(const struct fc_descriptor * Descriptor,
@@ -192,14 +192,12 @@ do_switch(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
 {
 	struct spatializer_impl *impl = user_data;
 
-	if (impl->l_conv[0] == NULL) {
-		SPA_SWAP(impl->l_conv[0], impl->l_conv[2]);
-		SPA_SWAP(impl->r_conv[0], impl->r_conv[2]);
-	} else {
-		SPA_SWAP(impl->l_conv[1], impl->l_conv[2]);
-		SPA_SWAP(impl->r_conv[1], impl->r_conv[2]);
-	}
-	impl->interpolate = impl->l_conv[0] && impl->l_conv[1];
+	if (impl->conv[0] == NULL)
+		SPA_SWAP(impl->conv[0], impl->conv[2]);
+	else
+		SPA_SWAP(impl->conv[1], impl->conv[2]);
+
+	impl->interpolate = impl->conv[0] && impl->conv[1];
 
 	return 0;
 }
@@ -207,10 +205,12 @@ do_switch(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
 static void spatializer_reload(void * Instance)
 {
 	struct spatializer_impl *impl = Instance;
-	float *left_ir = calloc(impl->n_samples, sizeof(float));
-	float *right_ir = calloc(impl->n_samples, sizeof(float));
-	float left_delay;
-	float right_delay;
+	/* room for the IR and a delay of up to n_samples */
+	float *left_ir = calloc(impl->n_samples * 2, sizeof(float));
+	float *right_ir = calloc(impl->n_samples * 2, sizeof(float));
+	const float *ir[2] = { left_ir, right_ir };
+	int irlen[2] = { impl->n_samples, impl->n_samples };
+	float delay[2];
 	float coords[3];
 
 	for (uint8_t i = 0; i < 3; i++)
@@ -224,37 +224,45 @@ static void spatializer_reload(void * Instance)
 		coords[2],
 		left_ir,
 		right_ir,
-		&left_delay,
-		&right_delay
+		&delay[0],
+		&delay[1]
 	);
 
-	// TODO: make use of delay
-	if ((left_delay != 0.0f || right_delay != 0.0f) && (!isnan(left_delay) || !isnan(right_delay))) {
-		pw_log_warn("delay dropped l: %f, r: %f", left_delay, right_delay);
+	/* apply the interaural delay, in seconds, by delaying the IR */
+	for (uint8_t i = 0; i < 2; i++) {
+		float *d = (float*)ir[i];
+		int samples;
+
+		if (isnan(delay[i]) || delay[i] <= 0.0f)
+			continue;
+
+		samples = SPA_CLAMP((int)lrintf(delay[i] * impl->rate), 0, impl->n_samples);
+		if (samples == 0)
+			continue;
+
+		memmove(&d[samples], d, impl->n_samples * sizeof(float));
+		memset(d, 0, samples * sizeof(float));
+		irlen[i] += samples;
 	}
 
-	if (impl->l_conv[2])
-		convolver_free(impl->l_conv[2]);
-	if (impl->r_conv[2])
-		convolver_free(impl->r_conv[2]);
+	if (impl->conv[2])
+		convolver_free(impl->conv[2]);
 
-	impl->l_conv[2] = convolver_new(dsp_ops, impl->blocksize, impl->tailsize,
-			left_ir, impl->n_samples);
-	impl->r_conv[2] = convolver_new(dsp_ops, impl->blocksize, impl->tailsize,
-			right_ir, impl->n_samples);
+	impl->conv[2] = convolver_new_multi(dsp_ops, impl->blocksize, impl->tailsize,
+			ir, irlen, 2);
 
 	free(left_ir);
 	free(right_ir);
 
-	if (impl->l_conv[2] == NULL || impl->r_conv[2] == NULL) {
-		pw_log_error("reloading left or right convolver failed");
+	if (impl->conv[2] == NULL) {
+		pw_log_error("reloading convolver failed");
 		return;
 	}
 	spa_loop_invoke(data_loop, do_switch, 1, NULL, 0, true, impl);
 }
 
 struct free_data {
-	void *item[2];
+	void *item;
 };
 
 static int
@@ -262,10 +270,8 @@ do_free(struct spa_loop *loop, bool async, uint32_t seq, const void *data,
 		size_t size, void *user_data)
 {
 	const struct free_data *fd = data;
-	if (fd->item[0])
-		convolver_free(fd->item[0]);
-	if (fd->item[1])
-		convolver_free(fd->item[1]);
+	if (fd->item)
+		convolver_free(fd->item);
 	return 0;
 }
 
@@ -277,28 +283,25 @@ static void spatializer_run(void * Instance, unsigned long SampleCount)
 		uint32_t len = SPA_MIN(SampleCount, MAX_SAMPLES);
 		struct free_data free_data;
 		float *l = impl->tmp[0], *r = impl->tmp[1];
+		float *out[2] = { impl->port[0], impl->port[1] };
 
-		convolver_run(impl->l_conv[0], impl->port[2], impl->port[0], len);
-		convolver_run(impl->l_conv[1], impl->port[2], l, len);
-		convolver_run(impl->r_conv[0], impl->port[2], impl->port[1], len);
-		convolver_run(impl->r_conv[1], impl->port[2], r, len);
+		convolver_run_multi(impl->conv[0], impl->port[2], out, len);
+		convolver_run_multi(impl->conv[1], impl->port[2], impl->tmp, len);
 
-		for (uint32_t i = 0; i < SampleCount; i++) {
-			float t = (float)i / SampleCount;
+		for (uint32_t i = 0; i < len; i++) {
+			float t = (float)i / len;
 			impl->port[0][i] = impl->port[0][i] * (1.0f - t) + l[i] * t;
 			impl->port[1][i] = impl->port[1][i] * (1.0f - t) + r[i] * t;
 		}
-		free_data.item[0] = impl->l_conv[0];
-		free_data.item[1] = impl->r_conv[0];
-		impl->l_conv[0] = impl->l_conv[1];
-		impl->r_conv[0] = impl->r_conv[1];
-		impl->l_conv[1] = impl->r_conv[1] = NULL;
+		free_data.item = impl->conv[0];
+		impl->conv[0] = impl->conv[1];
+		impl->conv[1] = NULL;
 		impl->interpolate = false;
 
 		spa_loop_invoke(main_loop, do_free, 1, &free_data, sizeof(free_data), false, impl);
-	} else if (impl->l_conv[0] && impl->r_conv[0]) {
-		convolver_run(impl->l_conv[0], impl->port[2], impl->port[0], SampleCount);
-		convolver_run(impl->r_conv[0], impl->port[2], impl->port[1], SampleCount);
+	} else if (impl->conv[0]) {
+		float *out[2] = { impl->port[0], impl->port[1] };
+		convolver_run_multi(impl->conv[0], impl->port[2], out, SampleCount);
 	}
 }
 
@@ -316,10 +319,8 @@ static void spatializer_cleanup(void * Instance)
 	struct spatializer_impl *impl = Instance;
 
 	for (uint8_t i = 0; i < 3; i++) {
-		if (impl->l_conv[i])
-			convolver_free(impl->l_conv[i]);
-		if (impl->r_conv[i])
-			convolver_free(impl->r_conv[i]);
+		if (impl->conv[i])
+			convolver_free(impl->conv[i]);
 	}
 	if (impl->sofa)
 		mysofa_close_cached(impl->sofa);
@@ -338,10 +339,8 @@ static void spatializer_control_changed(void * Instance)
 static void spatializer_deactivate(void * Instance)
 {
 	struct spatializer_impl *impl = Instance;
-	if (impl->l_conv[0])
-		convolver_reset(impl->l_conv[0]);
-	if (impl->r_conv[0])
-		convolver_reset(impl->r_conv[0]);
+	if (impl->conv[0])
+		convolver_reset(impl->conv[0]);
 	impl->interpolate = false;
 }
 
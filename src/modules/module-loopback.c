@@ -39,6 +39,12 @@
  *
  * - `node.description`: a human readable name for the loopback streams
  * - `target.delay.sec`: delay in seconds as float (Since 0.3.60)
+ * - `loopback.sync`: process the capture stream in the same cycle as the nodes
+ *                   that feed it. This removes one cycle of latency for each
+ *                   loopback, which adds up when loopbacks are chained. Don't
+ *                   use this when the playback stream can end up linked to
+ *                   the capture stream, directly or through other nodes.
+ *                   Default false. (Since 1.3.0)
  * - `capture.props = {}`: properties to be passed to the input stream
  * - `playback.props = {}`: properties to be passed to the output stream
  *
@@ -182,6 +188,7 @@ static const struct spa_dict_item module_props[] = {
 				"( audio.channels=<number of channels> ) "
 				"( audio.position=<channel map> ) "
 				"( target.delay.sec=<delay as seconds in float> ) "
+				"( loopback.sync=<process capture in the same cycle, default false> ) "
 				"( capture.props=<properties> ) "
 				"( playback.props=<properties> ) " },
 	{ PW_KEY_MODULE_VERSION, PACKAGE_VERSION },
@@ -226,6 +233,7 @@ struct impl {
 
 	unsigned int do_disconnect:1;
 	unsigned int recalc_delay:1;
+	unsigned int sync:1;
 
 	struct spa_io_position *position;
 
@@ -608,13 +616,16 @@ static int setup_streams(struct impl *impl)
 	spa_pod_builder_init(&b, buffer, sizeof(buffer));
 	params[n_params++] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat,
 			&impl->capture_info);
+	/* an async capture stream reads what its peers produced in the previous
+	 * cycle, a sync one waits for them and triggers the playback right
+	 * after */
 	if ((res = pw_stream_connect(impl->capture,
 			PW_DIRECTION_INPUT,
 			PW_ID_ANY,
 			PW_STREAM_FLAG_AUTOCONNECT |
 			PW_STREAM_FLAG_MAP_BUFFERS |
 			PW_STREAM_FLAG_RT_PROCESS |
-			PW_STREAM_FLAG_ASYNC,
+			(impl->sync ? 0 : PW_STREAM_FLAG_ASYNC),
 			params, n_params)) < 0)
 		return res;
 
@@ -794,6 +805,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	if ((str = pw_properties_get(props, "target.delay.sec")) != NULL)
 		spa_atof(str, &impl->target_delay);
+	impl->sync = pw_properties_get_bool(props, "loopback.sync", false);
 	if (impl->target_delay > 0.0f &&
 	    pw_properties_get(props, PW_KEY_NODE_LATENCY) == NULL)
 		/* a source and sink (USB) usually have a 1.5 quantum delay, so we use
@@ -20,6 +20,16 @@
  * ## Module Name
  *
  * `libpipewire-module-metadata`
+ *
+ * ## Metadata Properties
+ *
+ * Metadata created with the factory accepts these properties:
+ *
+ * - `metadata.name`: the name of the metadata
+ * - `metadata.values`: an array of initial values
+ * - `metadata.coalesce`: when true, updates for the same subject and key are
+ *    merged per client and sent once per main loop iteration. Clients might
+ *    not see the intermediate values of a key after a core sync. Default false.
  */
 
 #define NAME "metadata"
@@ -28,7 +38,8 @@
                         "("PW_KEY_METADATA_VALUES" = [ "						\
                         "   { ( id = <int> ) key = <string> ( type = <string> ) value = <json> } "	\
                         "   ..."									\
-                        "  ] )"
+                        "  ] ) "									\
+                        "( metadata.coalesce = <bool> )"
 
 PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 #define PW_LOG_TOPIC_DEFAULT mod_topic
@@ -63,6 +63,8 @@
  * - `netjack2.save`: if jack port connections should be save automatically. Can also be
  *                   placed per stream.
  * - `netjack2.latency`: the latency in cycles, default 2
+ * - `netjack2.threads`: the number of extra realtime threads used to encode and
+ *                   decode the channels with opus, default 0
  * - `audio.channels`: the number of audio ports. Can also be added to the stream props.
  * - `midi.ports`: the number of midi ports. Can also be added to the stream props.
  * - `source.props`: Extra properties for the source filter.
@@ -144,6 +146,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 			"( netjack2.client-name=<name of the NETJACK2 client> ) "	\
 			"( netjack2.save=<bool, save ports> ) "			\
 			"( netjack2.latency=<latency in cycles, default 2> ) "	\
+			"( netjack2.threads=<number of opus threads, default 0> ) "	\
 			"( midi.ports=<number of midi ports> ) "		\
 			"( audio.channels=<number of channels> ) "		\
 			"( audio.position=<channel map> ) "			\
@@ -205,6 +208,8 @@ struct impl {
 	int mtu;
 	uint32_t latency;
 	uint32_t quantum_limit;
+	uint32_t n_threads;
+	struct spa_thread_utils *thread_utils;
 
 	struct pw_impl_module *module;
 	struct spa_hook module_listener;
@@ -855,6 +860,8 @@ static int handle_follower_setup(struct impl *impl, struct nj2_session_params *p
 	peer->send_volume = &impl->sink.volume;
 	peer->recv_volume = &impl->source.volume;
 	peer->quantum_limit = impl->quantum_limit;
+	peer->n_threads = impl->n_threads;
+	peer->thread_utils = impl->thread_utils;
 	netjack2_init(peer);
 
 	int bufsize = NETWORK_MAX_LATENCY * (peer->params.mtu +
@@ -1265,6 +1272,14 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	}
 	impl->latency = pw_properties_get_uint32(impl->props, "netjack2.latency",
 			DEFAULT_NETWORK_LATENCY);
+	impl->n_threads = pw_properties_get_uint32(impl->props, "netjack2.threads", 0);
+	if (impl->n_threads > 0) {
+		const struct spa_support *support;
+		uint32_t n_support;
+		support = pw_context_get_support(context, &n_support);
+		impl->thread_utils = spa_support_find(support, n_support,
+				SPA_TYPE_INTERFACE_ThreadUtils);
+	}
 
 	pw_properties_set(props, PW_KEY_NODE_LOOP_NAME, impl->data_loop->name);
 	if (pw_properties_get(props, PW_KEY_NODE_VIRTUAL) == NULL)
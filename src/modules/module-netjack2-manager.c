@@ -70,6 +70,8 @@
  * - `netjack2.period-size`: the buffer size to use, default 1024
  * - `netjack2.encoding`: the encoding, float|opus|int, default float
  * - `netjack2.kbps`: the number of kilobits per second when encoding, default 64
+ * - `netjack2.threads`: the number of extra realtime threads used to encode and
+ *                   decode the channels with opus, default 0
  * - `audio.channels`: the number of audio ports. Can also be added to the stream props.
  * - `midi.ports`: the number of midi ports. Can also be added to the stream props.
  * - `source.props`: Extra properties for the source filter.
@@ -88,6 +90,10 @@
  * - \ref PW_KEY_NODE_VIRTUAL
  * - \ref PW_KEY_MEDIA_CLASS
  * - \ref PW_KEY_TARGET_OBJECT to specify the remote node.name or serial.id to link to
+ * - \ref PW_KEY_NODE_LOOP_NAME to run all followers in the given data loop. When not
+ *   given, each follower uses the least used data loop of the context, so that the
+ *   followers are processed in parallel when there are multiple data loops (see
+ *   `context.num-data-loops`).
  *
  * ## Example configuration of a duplex sink/source
  *
@@ -151,6 +157,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 			"( netjack2.connect=<bool, autoconnect ports> ) "	\
 			"( netjack2.sample-rate=<sampl erate, default 48000> ) "\
 			"( netjack2.period-size=<period size, default 1024> ) "	\
+			"( netjack2.threads=<number of opus threads, default 0> ) "	\
 			"( midi.ports=<number of midi ports> ) "		\
 			"( audio.channels=<number of channels> ) "		\
 			"( audio.position=<channel map> ) "			\
@@ -219,6 +226,7 @@ struct follower {
 	uint32_t pw_xrun;
 	uint32_t nj2_xrun;
 
+	struct pw_loop *data_loop;
 	struct spa_source *setup_socket;
 	struct spa_source *socket;
 
@@ -252,6 +260,8 @@ struct impl {
 	uint32_t encoding;
 	uint32_t kbps;
 	uint32_t quantum_limit;
+	uint32_t n_threads;
+	struct spa_thread_utils *thread_utils;
 
 	struct pw_impl_module *module;
 	struct spa_hook module_listener;
@@ -268,6 +278,7 @@ struct impl {
 	uint32_t follower_id;
 
 	unsigned int do_disconnect:1;
+	unsigned int follower_loops:1;
 };
 
 static void reset_volume(struct volume *vol, uint32_t n_volumes)
@@ -349,7 +360,7 @@ static void sink_process(void *d, struct spa_io_position *position)
 	netjack2_send_data(&follower->peer, nframes, midi, n_midi, audio, n_audio);
 
 	if (follower->socket)
-		pw_loop_update_io(s->impl->data_loop, follower->socket, SPA_IO_IN);
+		pw_loop_update_io(follower->data_loop, follower->socket, SPA_IO_IN);
 }
 
 static void source_process(void *d, struct spa_io_position *position)
@@ -382,9 +393,11 @@ static void follower_free(struct follower *follower)
 	pw_properties_free(follower->sink.props);
 
 	if (follower->socket)
-		pw_loop_destroy_source(impl->data_loop, follower->socket);
+		pw_loop_destroy_source(follower->data_loop, follower->socket);
 	if (follower->setup_socket)
 		pw_loop_destroy_source(impl->main_loop, follower->setup_socket);
+	if (follower->data_loop)
+		pw_context_release_loop(impl->context, follower->data_loop);
 
 	netjack2_cleanup(&follower->peer);
 	free(follower);
@@ -469,13 +482,13 @@ on_data_io(void *data, int fd, uint32_t mask)
 
 	if (mask & (SPA_IO_ERR | SPA_IO_HUP)) {
 		pw_log_warn("error:%08x", mask);
-		pw_loop_destroy_source(impl->data_loop, follower->socket);
+		pw_loop_destroy_source(follower->data_loop, follower->socket);
 		follower->socket = NULL;
 		pw_loop_invoke(impl->main_loop, do_stop_follower, 1, NULL, 0, false, follower);
 		return;
 	}
 	if (mask & SPA_IO_IN) {
-		pw_loop_update_io(impl->data_loop, follower->socket, 0);
+		pw_loop_update_io(follower->data_loop, follower->socket, 0);
 
 		pw_filter_trigger_process(follower->source.filter);
 	}
@@ -927,6 +940,27 @@ static int handle_follower_available(struct impl *impl, struct nj2_session_param
 	pw_properties_setf(follower->sink.props, PW_KEY_NODE_DESCRIPTION, "%s NETJACK2 to %s",
 			params->name, params->follower_name);
 
+	if (impl->follower_loops) {
+		/* each follower takes the least used data loop */
+		const char *str = pw_properties_get(impl->props, PW_KEY_NODE_LOOP_CLASS);
+		struct spa_dict_item items[] = {
+			SPA_DICT_ITEM_INIT(PW_KEY_NODE_LOOP_CLASS, str),
+		};
+		follower->data_loop = pw_context_acquire_loop(impl->context,
+				str ? &SPA_DICT_INIT_ARRAY(items) : NULL);
+	} else {
+		follower->data_loop = pw_context_acquire_loop(impl->context, &impl->props->dict);
+	}
+	if (follower->data_loop == NULL) {
+		res = -errno;
+		pw_log_error("can't acquire data loop: %m");
+		goto cleanup;
+	}
+	pw_properties_set(follower->source.props, PW_KEY_NODE_LOOP_NAME,
+			follower->data_loop->name);
+	pw_properties_set(follower->sink.props, PW_KEY_NODE_LOOP_NAME,
+			follower->data_loop->name);
+
 	peer->params.mtu = impl->mtu;
 	peer->params.id = follower->id;
 	snprintf(peer->params.driver_name, sizeof(peer->params.driver_name), "%s", pw_get_host_name());
@@ -975,7 +1009,7 @@ static int handle_follower_available(struct impl *impl, struct nj2_session_param
 		goto socket_failed;
 	}
 
-	follower->socket = pw_loop_add_io(impl->data_loop, fd,
+	follower->socket = pw_loop_add_io(follower->data_loop, fd,
 			0, false, on_data_io, follower);
 	if (follower->socket == NULL) {
 		res = -errno;
@@ -988,6 +1022,8 @@ static int handle_follower_available(struct impl *impl, struct nj2_session_param
 	peer->send_volume = &follower->sink.volume;
 	peer->recv_volume = &follower->source.volume;
 	peer->quantum_limit = impl->quantum_limit;
+	peer->n_threads = impl->n_threads;
+	peer->thread_utils = impl->thread_utils;
 	netjack2_init(peer);
 
 	int bufsize = NETWORK_MAX_LATENCY * (peer->params.mtu +
@@ -1259,6 +1295,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto error;
 	}
 	impl->props = props;
+	impl->follower_loops = pw_properties_get(props, PW_KEY_NODE_LOOP_NAME) == NULL;
 	impl->data_loop = pw_context_acquire_loop(context, &props->dict);
 	impl->quantum_limit = pw_properties_get_uint32(
 			pw_context_get_properties(context),
@@ -1314,6 +1351,14 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	}
 	impl->kbps = pw_properties_get_uint32(impl->props, "netjack2.kbps",
 			DEFAULT_KBPS);
+	impl->n_threads = pw_properties_get_uint32(impl->props, "netjack2.threads", 0);
+	if (impl->n_threads > 0) {
+		const struct spa_support *support;
+		uint32_t n_support;
+		support = pw_context_get_support(context, &n_support);
+		impl->thread_utils = spa_support_find(support, n_support,
+				SPA_TYPE_INTERFACE_ThreadUtils);
+	}
 
 	pw_properties_set(props, PW_KEY_NODE_LOOP_NAME, impl->data_loop->name);
 	if (pw_properties_get(props, PW_KEY_NODE_VIRTUAL) == NULL)
@@ -1,5 +1,9 @@
 
 #include <byteswap.h>
+#include <semaphore.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #ifdef HAVE_OPUS_CUSTOM
 #include <opus/opus.h>
@@ -70,15 +74,32 @@ static inline void do_volume_to_s16(int16_t *dst, const float *src, struct volum
 		uint32_t ch, uint32_t n_samples)
 {
 	float v = vol->mute ? 0.0f : vol->volumes[ch];
-	uint32_t i;
+	uint32_t i = 0;
 
-	if (v == 0.0f || src == NULL)
+	if (v == 0.0f || src == NULL) {
 		memset(dst, 0, n_samples * sizeof(int16_t));
-	else if (v == 1.0f) {
-		for (i = 0; i < n_samples; i++)
+		return;
+	}
+#if defined(__SSE2__)
+	{
+		const __m128 scale = _mm_set1_ps(v * S16_SCALE);
+		const __m128 min = _mm_set1_ps(S16_MIN), max = _mm_set1_ps(S16_MAX);
+
+		for (; i + 8 <= n_samples; i += 8) {
+			__m128 s0 = _mm_mul_ps(_mm_loadu_ps(&src[i]), scale);
+			__m128 s1 = _mm_mul_ps(_mm_loadu_ps(&src[i+4]), scale);
+			s0 = _mm_min_ps(_mm_max_ps(s0, min), max);
+			s1 = _mm_min_ps(_mm_max_ps(s1, min), max);
+			_mm_storeu_si128((__m128i*)&dst[i],
+					_mm_packs_epi32(_mm_cvttps_epi32(s0), _mm_cvttps_epi32(s1)));
+		}
+	}
+#endif
+	if (v == 1.0f) {
+		for (; i < n_samples; i++)
 			dst[i] = F32_TO_S16(src[i]);
 	} else {
-		for (i = 0; i < n_samples; i++)
+		for (; i < n_samples; i++)
 			dst[i] = F32_TO_S16(src[i] * v);
 	}
 }
@@ -87,19 +108,50 @@ static inline void do_volume_from_s16(float *dst, const int16_t *src, struct vol
 		uint32_t ch, uint32_t n_samples)
 {
 	float v = vol->mute ? 0.0f : vol->volumes[ch];
-	uint32_t i;
+	uint32_t i = 0;
 
-	if (v == 0.0f || src == NULL)
+	if (v == 0.0f || src == NULL) {
 		memset(dst, 0, n_samples * sizeof(float));
-	else if (v == 1.0f) {
-		for (i = 0; i < n_samples; i++)
+		return;
+	}
+#if defined(__SSE2__)
+	{
+		const __m128 scale = _mm_set1_ps(v / S16_SCALE);
+
+		for (; i + 8 <= n_samples; i += 8) {
+			__m128i in = _mm_loadu_si128((const __m128i*)&src[i]);
+			/* sign extend to 32 bits */
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+			_mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(&dst[i+4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+	}
+#endif
+	if (v == 1.0f) {
+		for (; i < n_samples; i++)
 			dst[i] = S16_TO_F32(src[i]);
 	} else {
-		for (i = 0; i < n_samples; i++)
+		for (; i < n_samples; i++)
 			dst[i] = S16_TO_F32(src[i]) * v;
 	}
 }
 
+#define MAX_WORKERS	8
+
+struct netjack2_peer;
+
+/* encodes or decodes a range of the channels in parallel with the data
+ * thread */
+struct nj2_worker {
+	struct netjack2_peer *peer;
+	struct spa_thread *thread;
+	sem_t start;
+
+	uint32_t first;
+	uint32_t n_channels;
+};
+
 struct netjack2_peer {
 	int fd;
 
@@ -126,9 +178,137 @@ struct netjack2_peer {
 	OpusCustomDecoder **opus_dec;
 #endif
 
+	/* configuration, set before netjack2_init() */
+	uint32_t n_threads;
+	struct spa_thread_utils *thread_utils;
+
+	uint32_t n_workers;
+	struct nj2_worker workers[MAX_WORKERS];
+	sem_t workers_done;
+	bool workers_running;
+
+	/* the job of the workers, called for each channel */
+	void (*job) (struct netjack2_peer *peer, uint32_t channel);
+	uint32_t job_frames;
+	struct data_info *job_info;
+	uint32_t job_n_info;
+
 	unsigned fix_midi:1;
 };
 
+static void netjack2_stop_workers(struct netjack2_peer *peer)
+{
+	uint32_t i;
+
+	if (!peer->workers_running)
+		return;
+
+	peer->workers_running = false;
+	for (i = 0; i < peer->n_workers; i++) {
+		struct nj2_worker *w = &peer->workers[i];
+		if (w->thread) {
+			sem_post(&w->start);
+			spa_thread_utils_join(peer->thread_utils, w->thread, NULL);
+			w->thread = NULL;
+		}
+		sem_destroy(&w->start);
+	}
+	sem_destroy(&peer->workers_done);
+	peer->n_workers = 0;
+}
+
+#ifdef HAVE_OPUS_CUSTOM
+/* the workers are only used to encode and decode opus */
+static void *netjack2_worker_thread(void *data)
+{
+	struct nj2_worker *w = data;
+	struct netjack2_peer *peer = w->peer;
+	uint32_t i;
+
+	while (true) {
+		sem_wait(&w->start);
+		if (!peer->workers_running)
+			break;
+		for (i = 0; i < w->n_channels; i++)
+			peer->job(peer, w->first + i);
+		sem_post(&peer->workers_done);
+	}
+	return NULL;
+}
+
+/* when the workers can't be started, the data thread does all channels */
+static int netjack2_start_workers(struct netjack2_peer *peer, uint32_t n_channels)
+{
+	uint32_t i;
+	int res;
+
+	peer->n_workers = SPA_MIN(SPA_MIN(peer->n_threads, (uint32_t)MAX_WORKERS),
+			n_channels > 0 ? n_channels - 1 : 0);
+	if (peer->n_workers == 0)
+		return 0;
+
+	if (peer->thread_utils == NULL) {
+		pw_log_warn("no thread utils, can't start %u netjack2 threads",
+				peer->n_workers);
+		peer->n_workers = 0;
+		return -ENOTSUP;
+	}
+	sem_init(&peer->workers_done, 0, 0);
+	for (i = 0; i < peer->n_workers; i++) {
+		peer->workers[i].peer = peer;
+		sem_init(&peer->workers[i].start, 0, 0);
+	}
+
+	peer->workers_running = true;
+	for (i = 0; i < peer->n_workers; i++) {
+		struct nj2_worker *w = &peer->workers[i];
+
+		w->thread = spa_thread_utils_create(peer->thread_utils, NULL,
+				netjack2_worker_thread, w);
+		if (w->thread == NULL) {
+			res = -errno;
+			pw_log_error("can't create netjack2 thread: %m");
+			netjack2_stop_workers(peer);
+			return res;
+		}
+		spa_thread_utils_acquire_rt(peer->thread_utils, w->thread, -1);
+	}
+	pw_log_info("started %u netjack2 threads", peer->n_workers);
+	return 0;
+}
+
+/* run job for n_channels, divided over the data thread and the workers */
+static void netjack2_run_parallel(struct netjack2_peer *peer,
+		void (*job) (struct netjack2_peer *peer, uint32_t channel),
+		uint32_t n_channels)
+{
+	uint32_t i, n_parts, part, first, n_started = 0;
+
+	if (!peer->workers_running || n_channels < 2) {
+		for (i = 0; i < n_channels; i++)
+			job(peer, i);
+		return;
+	}
+
+	peer->job = job;
+	n_parts = SPA_MIN(peer->n_workers + 1, n_channels);
+	part = (n_channels + n_parts - 1) / n_parts;
+
+	for (i = 0, first = part; i < peer->n_workers && first < n_channels; i++) {
+		struct nj2_worker *w = &peer->workers[i];
+		w->first = first;
+		w->n_channels = SPA_MIN(part, n_channels - first);
+		first += w->n_channels;
+		sem_post(&w->start);
+		n_started++;
+	}
+	for (i = 0; i < SPA_MIN(part, n_channels); i++)
+		job(peer, i);
+	for (i = 0; i < n_started; i++)
+		sem_wait(&peer->workers_done);
+}
+#endif
+
 static int netjack2_init(struct netjack2_peer *peer)
 {
 	int res = 0;
@@ -182,6 +362,9 @@ static int netjack2_init(struct netjack2_peer *peer)
 					1, &res)) == NULL)
 				goto error_opus;
 		}
+		if (peer->n_threads > 0)
+			netjack2_start_workers(peer, SPA_MAX(peer->params.send_audio_channels,
+						peer->params.recv_audio_channels));
 #else
 		return -ENOTSUP;
 #endif
@@ -200,6 +383,7 @@ error_opus:
 
 static void netjack2_cleanup(struct netjack2_peer *peer)
 {
+	netjack2_stop_workers(peer);
 
 	free(peer->empty);
 	free(peer->midi_data);
@@ -489,6 +673,48 @@ static int netjack2_send_float(struct netjack2_peer *peer, uint32_t nframes,
 	return 0;
 }
 
+#ifdef HAVE_OPUS_CUSTOM
+static void netjack2_encode_opus(struct netjack2_peer *peer, uint32_t i)
+{
+	uint32_t max_encoded = peer->max_encoded_size;
+	uint16_t *ap = SPA_PTROFF(peer->encoded_data, i * max_encoded, uint16_t);
+	void *pcm;
+	int res;
+
+	if (i >= peer->job_n_info || (pcm = peer->job_info[i].data) == NULL)
+		pcm = peer->empty;
+
+	res = opus_custom_encode_float(peer->opus_enc[i],
+			pcm, peer->job_frames, (unsigned char*)&ap[1], max_encoded - 2);
+
+	if (res < 0 || res > 0xffff) {
+		pw_log_warn("encoding error %d", res);
+		ap[0] = 0;
+	} else {
+		ap[0] = htons(res);
+	}
+}
+
+static void netjack2_decode_opus(struct netjack2_peer *peer, uint32_t i)
+{
+	uint16_t *ap = SPA_PTROFF(peer->encoded_data, i * peer->max_encoded_size, uint16_t);
+	void *pcm;
+	int res;
+
+	if (i >= peer->job_n_info || (pcm = peer->job_info[i].data) == NULL)
+		return;
+
+	res = opus_custom_decode_float(peer->opus_dec[i],
+			(unsigned char*)&ap[1], ntohs(ap[0]),
+			pcm, peer->sync.frames);
+
+	if (res < 0 || res > 0xffff || res != peer->sync.frames)
+		pw_log_warn("decoding error %d", res);
+	else
+		peer->job_info[i].filled = true;
+}
+#endif
+
 static int netjack2_send_opus(struct netjack2_peer *peer, uint32_t nframes,
 		struct data_info *info, uint32_t n_info)
 {
@@ -512,24 +738,10 @@ static int netjack2_send_opus(struct netjack2_peer *peer, uint32_t nframes,
 
 	encoded_data = peer->encoded_data;
 
-	for (i = 0; i < active_ports; i++) {
-		uint16_t *ap = SPA_PTROFF(encoded_data, i * max_encoded, uint16_t);
-		void *pcm;
-		int res;
-
-		if (i >= n_info || (pcm = info[i].data) == NULL)
-			pcm = peer->empty;
-
-		res = opus_custom_encode_float(peer->opus_enc[i],
-				pcm, nframes, (unsigned char*)&ap[1], max_encoded - 2);
-
-		if (res < 0 || res > 0xffff) {
-			pw_log_warn("encoding error %d", res);
-			ap[0] = 0;
-		} else {
-			ap[0] = htons(res);
-		}
-	}
+	peer->job_frames = nframes;
+	peer->job_info = info;
+	peer->job_n_info = n_info;
+	netjack2_run_parallel(peer, netjack2_encode_opus, active_ports);
 
 	strcpy(header.type, "header");
 	header.data_type = htonl('a');
@@ -879,23 +1091,9 @@ static int netjack2_recv_opus(struct netjack2_peer *peer, struct nj2_packet_head
 	if (++(*count) < peer->sync.num_packets)
 		return 0;
 
-	for (i = 0; i < active_ports; i++) {
-		uint16_t *ap = SPA_PTROFF(encoded_data, i * max_encoded, uint16_t);
-		void *pcm;
-		int res;
-
-		if (i >= n_info || (pcm = info[i].data) == NULL)
-			continue;
-
-		res = opus_custom_decode_float(peer->opus_dec[i],
-				(unsigned char*)&ap[1], ntohs(ap[0]),
-				pcm, peer->sync.frames);
-
-		if (res < 0 || res > 0xffff || res != peer->sync.frames)
-			pw_log_warn("decoding error %d", res);
-		else
-			info[i].filled = true;
-	}
+	peer->job_info = info;
+	peer->job_n_info = n_info;
+	netjack2_run_parallel(peer, netjack2_decode_opus, active_ports);
 	return 0;
 #else
 	return -ENOTSUP;
@@ -151,36 +151,52 @@ void init_eq_node(FILE *f, const char *node_desc) {
 	fprintf(f, "media.name = \"%s\"\n", node_desc);
 	fprintf(f, "filter.graph = {\n");
 	fprintf(f, "nodes = [\n");
-}
-
-void add_eq_node(FILE *f, struct eq_node_param *param, uint32_t eq_band_idx) {
+	/* all bands go in one param_eq node that filters the channels in parallel */
 	fprintf(f, "{\n");
 	fprintf(f, "type = builtin\n");
-	fprintf(f, "name = eq_band_%d\n", eq_band_idx);
+	fprintf(f, "name = eq\n");
+	fprintf(f, "label = param_eq\n");
+	fprintf(f, "config = {\n");
+	fprintf(f, "filters = [\n");
+}
+
+void add_eq_node(FILE *f, struct eq_node_param *param) {
+	const char *type;
 
 	if (strcmp(param->filter_type, "PK") == 0) {
-		fprintf(f, "label = bq_peaking\n");
+		type = "bq_peaking";
 	} else if (strcmp(param->filter_type, "LSC") == 0) {
-		fprintf(f, "label = bq_lowshelf\n");
+		type = "bq_lowshelf";
 	} else if (strcmp(param->filter_type, "HSC") == 0) {
-		fprintf(f, "label = bq_highshelf\n");
+		type = "bq_highshelf";
 	} else {
-		fprintf(f, "label = bq_peaking\n");
+		type = "bq_peaking";
 	}
 
-	fprintf(f, "control = { \"Freq\" = %d \"Q\" = %f \"Gain\" = %f }\n", param->freq, param->q_fact, param->gain);
-
-	fprintf(f, "}\n");
+	fprintf(f, "{ type = %s freq = %d q = %f gain = %f }\n", type, param->freq, param->q_fact, param->gain);
 }
 
 void end_eq_node(struct impl *impl, FILE *f, uint32_t number_of_nodes) {
-	fprintf(f, "]\n");
+	uint32_t i, n_ports = 8;
 
-	fprintf(f, "links = [\n");
-	for (uint32_t i = 1; i < number_of_nodes; i++) {
-		fprintf(f, "{ output = \"eq_band_%d:Out\" input = \"eq_band_%d:In\" }\n", i, i + 1);
-	}
 	fprintf(f, "]\n");
+	fprintf(f, "}\n");
+	fprintf(f, "}\n");
+	fprintf(f, "]\n");
+
+	/* the node is duplicated until all channels are handled, use as many
+	 * ports per node as possible */
+	while (impl->channels % n_ports != 0)
+		n_ports--;
+
+	fprintf(f, "inputs = [");
+	for (i = 1; i <= n_ports; i++)
+		fprintf(f, " \"eq:In %d\"", i);
+	fprintf(f, " ]\n");
+	fprintf(f, "outputs = [");
+	for (i = 1; i <= n_ports; i++)
+		fprintf(f, " \"eq:Out %d\"", i);
+	fprintf(f, " ]\n");
 
 	fprintf(f, "}\n");
 	fprintf(f, "audio.channels = %d\n", impl->channels);
@@ -209,7 +225,6 @@ int32_t parse_eq_filter_file(struct impl *impl, FILE *f)
 	char *line = NULL;
 	ssize_t nread;
 	size_t len, size;
-	uint32_t eq_band_idx = 1;
 	uint32_t eq_bands = 0;
 	int32_t res = 0;
 
@@ -243,9 +258,8 @@ int32_t parse_eq_filter_file(struct impl *impl, FILE *f)
 		eq_param.freq = 0;
 		eq_param.q_fact = 1.0;
 
-		add_eq_node(memstream, &eq_param, eq_band_idx);
+		add_eq_node(memstream, &eq_param);
 
-		eq_band_idx++;
 		eq_bands++;
 	}
 
@@ -266,9 +280,8 @@ int32_t parse_eq_filter_file(struct impl *impl, FILE *f)
 		 */
 		if (sscanf(line, "%*s %*d: %3s %3s %*s %5d %*s %*s %6f %*s %*c %6f", eq_param.filter, eq_param.filter_type, &eq_param.freq, &eq_param.gain, &eq_param.q_fact) == 5) {
 			if (strcmp(eq_param.filter, "ON") == 0) {
-				add_eq_node(memstream, &eq_param, eq_band_idx);
+				add_eq_node(memstream, &eq_param);
 
-				eq_band_idx++;
 				eq_bands++;
 			}
 		}
@@ -46,6 +46,8 @@
  * - `tunnel.mode`: the desired tunnel to create. (Default `playback`)
  * - `tunnel.may-pause`: if the tunnel stream is allowed to pause on xrun
  * - `pipe.filename`: the filename of the pipe.
+ * - `pipe.chunk.msec`: collect the samples for the pipe in chunks of this many
+ *   milliseconds before writing them. Only for `capture` and `sink` modes.
  * - `stream.props`: Extra properties for the local stream.
  *
  * When `tunnel.mode` is `capture`, a capture stream on the default source is
@@ -66,6 +68,12 @@
  * `tunnel.mode`, this is by default false. A paused stream will consume no
  * CPU and will resume when the fifo becomes readable or writable again.
  *
+ * `pipe.chunk.msec` is for readers that don't need low latency, like a snapcast
+ * server. The samples are written in large chunks so that the reader wakes up
+ * less often. When `node.latency` is not given, it is set to the chunk size so
+ * that the graph can run with a larger quantum for the stream. The chunks are
+ * given to the pipe with vmsplice() when possible to avoid a copy.
+ *
  * When `pipe.filename` is not given, a default fifo in `/tmp/fifo_input` or
  * `/tmp/fifo_output` will be created that can be written and read respectively,
  * depending on the selected `tunnel.mode`.
@@ -142,6 +150,7 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 			"( tunnel.mode=capture|playback|sink|source )"		\
 			"( tunnel.may-pause=<bool, if the stream can pause> )"	\
 			"( pipe.filename=<filename> )"				\
+			"( pipe.chunk.msec=<chunk size in milliseconds> )"	\
 			"( stream.props=<properties> ) "
 
 
@@ -189,10 +198,12 @@ struct impl {
 	unsigned int driving:1;
 	unsigned int may_pause:1;
 	unsigned int paused:1;
+	unsigned int use_vmsplice:1;
 
 	struct spa_ringbuffer ring;
 	void *buffer;
 	uint32_t target_buffer;
+	uint32_t chunk_size;
 
 	struct spa_io_rate_match *rate_match;
 	struct spa_io_position *position;
@@ -318,6 +329,85 @@ static void pause_stream(struct impl *impl, bool paused)
 	pw_loop_invoke(impl->main_loop, do_pause, 1, &paused, sizeof(bool), false, impl);
 }
 
+/* write the complete chunks from the ringbuffer to the pipe */
+static void flush_chunks(struct impl *impl)
+{
+	uint32_t index, offs, n_iov;
+	int32_t avail;
+	ssize_t written;
+	struct iovec iov[2];
+
+	avail = spa_ringbuffer_get_read_index(&impl->ring, &index);
+
+	while (avail >= (int32_t)impl->chunk_size) {
+		offs = index & RINGBUFFER_MASK;
+		iov[0].iov_base = SPA_PTROFF(impl->buffer, offs, void);
+		iov[0].iov_len = SPA_MIN((uint32_t)avail, RINGBUFFER_SIZE - offs);
+		iov[1].iov_base = impl->buffer;
+		iov[1].iov_len = avail - iov[0].iov_len;
+		n_iov = iov[1].iov_len > 0 ? 2 : 1;
+
+		/* vmsplice() makes the pipe point to the pages of the ringbuffer,
+		 * this is safe because the pipe is smaller than the ringbuffer
+		 * and the pages are consumed before they are written again */
+		if (impl->use_vmsplice)
+			written = vmsplice(impl->fd, iov, n_iov, SPLICE_F_NONBLOCK);
+		else
+			written = writev(impl->fd, iov, n_iov);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				pw_log_debug("pipe (%s) overrun: %m", impl->filename);
+				pause_stream(impl, true);
+			} else if (impl->use_vmsplice && (errno == EINVAL || errno == ENOSYS)) {
+				pw_log_info("vmsplice() failed, using write(): %m");
+				impl->use_vmsplice = false;
+				continue;
+			} else {
+				pw_log_warn("Failed to write to pipe (%s): %m",
+						impl->filename);
+			}
+			break;
+		}
+		index += written;
+		avail -= written;
+	}
+	spa_ringbuffer_read_update(&impl->ring, index);
+}
+
+static void playback_stream_chunks(struct impl *impl, struct pw_buffer *buf)
+{
+	uint32_t i, size, offs, index;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_write_index(&impl->ring, &index);
+
+	for (i = 0; i < buf->buffer->n_datas; i++) {
+		struct spa_data *d;
+		d = &buf->buffer->datas[i];
+
+		offs = SPA_MIN(d->chunk->offset, d->maxsize);
+		size = SPA_MIN(d->chunk->size, d->maxsize - offs);
+
+		if (filled + size > RINGBUFFER_SIZE) {
+			pw_log_debug("pipe (%s) overrun %d + %u", impl->filename,
+					filled, size);
+			break;
+		}
+		spa_ringbuffer_write_data(&impl->ring,
+				impl->buffer, RINGBUFFER_SIZE,
+				index & RINGBUFFER_MASK,
+				SPA_PTROFF(d->data, offs, void), size);
+		index += size;
+		filled += size;
+	}
+	spa_ringbuffer_write_update(&impl->ring, index);
+
+	flush_chunks(impl);
+}
+
 static void playback_stream_process(void *data)
 {
 	struct impl *impl = data;
@@ -329,6 +419,11 @@ static void playback_stream_process(void *data)
 		pw_log_debug("out of buffers: %m");
 		return;
 	}
+	if (impl->chunk_size > 0) {
+		playback_stream_chunks(impl, buf);
+		pw_stream_queue_buffer(impl->stream, buf);
+		return;
+	}
 
 	for (i = 0; i < buf->buffer->n_datas; i++) {
 		struct spa_data *d;
@@ -650,6 +745,15 @@ static int create_fifo(struct impl *impl)
 		pw_log_error("'%s' is not a FIFO.", filename);
 		goto error;
 	}
+	if (impl->chunk_size > 0) {
+		/* make room for two chunks in the pipe, the pipe needs to stay
+		 * smaller than the ringbuffer for vmsplice() */
+		if (fcntl(fd, F_SETPIPE_SZ, impl->chunk_size * 2) < 0)
+			pw_log_warn("can't set pipe size of '%s' to %u: %m",
+					filename, impl->chunk_size * 2);
+		res = fcntl(fd, F_GETPIPE_SZ);
+		impl->use_vmsplice = res > 0 && res <= (int)(RINGBUFFER_SIZE / 2);
+	}
 	impl->socket = pw_loop_add_io(impl->data_loop, fd,
 			0, false, on_pipe_io, impl);
 	if (impl->socket == NULL) {
@@ -945,6 +1049,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, PW_KEY_MEDIA_CLASS);
 	copy_props(impl, props, PW_KEY_TARGET_OBJECT);
 	copy_props(impl, props, "pipe.filename");
+	copy_props(impl, props, "pipe.chunk.msec");
 
 	parse_audio_info(impl->stream_props, &impl->info);
 
@@ -962,6 +1067,20 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	copy_props(impl, props, PW_KEY_NODE_RATE);
 
+	if (impl->direction == PW_DIRECTION_INPUT &&
+	    (str = pw_properties_get(props, "pipe.chunk.msec")) != NULL) {
+		uint32_t rate = impl->info.rate ? impl->info.rate : DEFAULT_RATE;
+		uint32_t frames = atoi(str) * rate / 1000;
+
+		impl->chunk_size = SPA_MIN(frames * impl->frame_size, RINGBUFFER_SIZE / 4);
+		impl->chunk_size = SPA_ROUND_DOWN(impl->chunk_size, impl->frame_size);
+
+		if (impl->chunk_size > 0 &&
+		    pw_properties_get(impl->stream_props, PW_KEY_NODE_LATENCY) == NULL)
+			pw_properties_setf(impl->stream_props, PW_KEY_NODE_LATENCY,
+					"%u/%u", impl->chunk_size / impl->frame_size, rate);
+	}
+
 	impl->buffer = calloc(1, RINGBUFFER_SIZE);
 	if (impl->buffer == NULL) {
 		res = -errno;
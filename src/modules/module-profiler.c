@@ -34,14 +34,26 @@
  *
  * `libpipewire-module-profiler`
  *
+ * ## Module Options
+ *
+ * - `profile.interval.ms`: the minimum time between sending profiler data
+ *    to the clients. The default of 0 sends the data of every cycle as soon
+ *    as possible. A larger value wakes up the main loop less often and
+ *    sends the data of multiple cycles together, which disturbs the graph
+ *    less at small quantums.
+ *
  * ## Example configuration
  *
- * The module has no arguments and is usually added to the config file of
- * the main pipewire daemon.
+ * The module is usually added to the config file of the main pipewire
+ * daemon.
  *
  *\code{.unparsed}
  * context.modules = [
- * { name = libpipewire-module-profiler }
+ * { name = libpipewire-module-profiler
+ *   args = {
+ *     #profile.interval.ms = 0
+ *   }
+ * }
  * ]
  *\endcode
  *
@@ -82,6 +94,7 @@ struct node {
 	struct spa_hook node_rt_listener;
 
 	int64_t count;
+	uint64_t flush_time;
 	struct spa_ringbuffer buffer;
 	uint8_t tmp[TMP_BUFFER];
 	uint8_t data[DATA_BUFFER];
@@ -104,6 +117,7 @@ struct impl {
 	struct spa_list node_list;
 
 	uint32_t busy;
+	uint64_t interval;
 	struct spa_source *flush_event;
 	unsigned int listening:1;
 
@@ -218,7 +232,9 @@ static void context_do_profile(void *data)
 			SPA_POD_Long(a->finish_time),
 			SPA_POD_Int(a->status),
 			SPA_POD_Fraction(&node->latency),
-			SPA_POD_Int(a->xrun_count));
+			SPA_POD_Int(a->xrun_count),
+			SPA_POD_Int(a->overrun_count),
+			SPA_POD_Long(a->overrun_time));
 
 	spa_list_for_each(t, &node->rt.target_list, link) {
 		struct pw_impl_node *n = t->node;
@@ -251,7 +267,9 @@ static void context_do_profile(void *data)
 			SPA_POD_Long(na->finish_time),
 			SPA_POD_Int(na->status),
 			SPA_POD_Fraction(&latency),
-			SPA_POD_Int(na->xrun_count));
+			SPA_POD_Int(na->xrun_count),
+			SPA_POD_Int(na->overrun_count),
+			SPA_POD_Long(na->overrun_time));
 	}
 	spa_pod_builder_pop(&b, &f[0]);
 
@@ -274,7 +292,14 @@ static void context_do_profile(void *data)
 			b.data, b.state.offset);
 	spa_ringbuffer_write_update(&n->buffer, idx + b.state.offset);
 
-	pw_loop_signal_event(impl->main_loop, impl->flush_event);
+	/* wake up the main loop when the interval expired or when the
+	 * queue is getting full */
+	if (impl->interval == 0 ||
+	    filled + b.state.offset > DATA_BUFFER / 2 ||
+	    pos->clock.nsec >= n->flush_time + impl->interval) {
+		n->flush_time = pos->clock.nsec;
+		pw_loop_signal_event(impl->main_loop, impl->flush_event);
+	}
 done:
 	n->count++;
 }
@@ -474,6 +499,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->context = context;
 	impl->properties = props;
 	impl->main_loop = pw_context_get_main_loop(impl->context);
+	impl->interval = pw_properties_get_uint64(props, "profile.interval.ms", 0) * SPA_NSEC_PER_MSEC;
 
 	impl->global = pw_global_new(context,
 			PW_TYPE_INTERFACE_Profiler,
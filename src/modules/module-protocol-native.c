@@ -170,6 +170,9 @@ static const struct spa_dict_item module_props[] = {
 #define SO_PEERSEC 31
 #endif
 
+/* messages handled for one client before the other clients get a turn */
+#define MAX_CLIENT_MESSAGES	64
+
 #define LOCK_SUFFIX     ".lock"
 #define LOCK_SUFFIXLEN  5
 
@@ -255,6 +258,7 @@ struct client_data {
 
 	unsigned int busy:1;
 	unsigned int need_flush:1;
+	unsigned int need_resume:1;
 
 	struct protocol_compat_v2 compat_v2;
 };
@@ -317,7 +321,7 @@ static void pre_demarshal(struct pw_protocol_native_connection *conn,
 		if (spa_pod_parser_push_struct(&parser, &f[1]) < 0)
 			break;
 		if (opcode < n_opcodes) {
-			if ((ret = opcodes[opcode].demarshal(object, &parser)) < 0)
+			if ((ret = opcodes[opcode].demarshal(object, conn, &parser)) < 0)
 				pw_log_error("failed processing message footer (opcode %u): %d (%s)",
 						opcode, ret, spa_strerror(ret));
 		} else {
@@ -336,9 +340,11 @@ process_messages(struct client_data *data)
 	struct pw_context *context = client->context;
 	const struct pw_protocol_native_message *msg;
 	struct pw_resource *resource;
+	uint32_t n_messages = 0;
 	int res;
 
 	context->current_client = client;
+	data->need_resume = false;
 
 	/* when the client is busy processing an async action, stop processing messages
 	 * for the client until it finishes the action */
@@ -347,6 +353,14 @@ process_messages(struct client_data *data)
 	        const struct pw_protocol_marshal *marshal;
 		uint32_t permissions, required;
 
+		/* don't let a flooding client starve the others, continue
+		 * with the remaining messages in the next loop iteration */
+		if (n_messages++ == MAX_CLIENT_MESSAGES) {
+			data->need_resume = true;
+			pw_loop_signal_event(data->server->loop, data->server->resume);
+			break;
+		}
+
 		res = pw_protocol_native_connection_get_next(conn, &msg);
 		if (res < 0) {
 			if (res == -EAGAIN)
@@ -442,6 +456,7 @@ client_busy_changed(void *data, bool busy)
 	uint32_t mask = c->source->mask;
 
 	c->busy = busy;
+	c->need_resume = !busy;
 
 	SPA_FLAG_UPDATE(mask, SPA_IO_IN, !busy);
 
@@ -492,6 +507,9 @@ connection_data(void *data, int fd, uint32_t mask)
 					this->source, this->source->mask & ~SPA_IO_OUT);
 		} else if (res != -EAGAIN)
 			goto error;
+		/* let the objects merge their updates while the client is slow */
+		pw_impl_client_set_congested(client,
+				pw_protocol_native_connection_has_pending(this->connection));
 	}
 done:
 	pw_impl_client_unref(client);
@@ -1175,6 +1193,7 @@ static void impl_disconnect(struct pw_protocol_client *client)
 	impl->source = NULL;
 
 	pw_protocol_native_connection_set_fd(impl->connection, -1);
+	impl->footer_state.ring_offered = false;
 }
 
 static void impl_destroy(struct pw_protocol_client *client)
@@ -1285,7 +1304,7 @@ impl_new_client(struct pw_protocol *protocol,
 {
 	struct client *impl;
 	struct pw_protocol_client *this;
-	const char *str = NULL;
+	const char *str = NULL, *ring;
 	int res;
 
 	if ((impl = calloc(1, sizeof(struct client))) == NULL)
@@ -1321,6 +1340,13 @@ impl_new_client(struct pw_protocol *protocol,
 
 	pw_log_debug("%p: connect %s", protocol, str);
 
+	/* offer shared memory rings for the messages when configured */
+	if ((ring = props ? spa_dict_lookup(props, PW_KEY_REMOTE_RING_SIZE) : NULL) == NULL)
+		ring = pw_properties_get(pw_context_get_properties(protocol->context),
+				PW_KEY_REMOTE_RING_SIZE);
+	if (ring != NULL)
+		spa_atou32(ring, &impl->footer_state.ring_size, 0);
+
 	if (spa_streq(str, "screencast"))
 		this->connect = pw_protocol_native_connect_portal_screencast;
 	else if (spa_streq(str, "internal"))
@@ -1382,6 +1408,8 @@ static void do_resume(void *_data, uint64_t count)
 	pw_log_debug("flush");
 
 	spa_list_for_each_safe(data, tmp, &this->client_list, protocol_link) {
+		if (!data->need_resume)
+			continue;
 		data->client->refcount++;
 		if ((res = process_messages(data)) < 0)
 			handle_client_error(data->client, res, "do_resume");
@@ -1581,7 +1609,7 @@ static int impl_ext_end_proxy(struct pw_proxy *proxy,
 	struct client *impl = SPA_CONTAINER_OF(core->conn, struct client, this);
 	ensure_loop(impl->context->main_loop);
 	assert_single_pod(builder);
-	marshal_core_footers(&impl->footer_state, core, builder);
+	marshal_core_footers(&impl->footer_state, core, impl->connection, builder);
 	return core->send_seq = pw_protocol_native_connection_end(impl->connection, builder);
 }
 
@@ -0,0 +1,414 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/parser.h>
+#include <spa/param/param.h>
+#include <spa/param/props.h>
+#include <spa/utils/result.h>
+
+#include <pipewire/pipewire.h>
+
+#include "connection.h"
+
+#define NAME "protocol-native"
+PW_LOG_TOPIC(mod_topic, "mod." NAME);
+PW_LOG_TOPIC(mod_topic_connection, "conn." NAME);
+
+#define MAX_COUNT	100000
+#define MAX_LATENCY	20000
+#define BATCH		64
+#define RING_SIZE	(256 * 1024)
+
+#define OPCODE_MESSAGE	1
+#define OPCODE_QUIT	2
+
+/* payloads that look like the messages of the native protocol */
+struct payload {
+	const char *name;
+	void (*build) (struct pw_protocol_native_connection *conn,
+			struct spa_pod_builder *b, uint32_t size, int fd);
+};
+
+static uint8_t bytes[1024 * 1024];
+static float volumes[64 * 1024];
+
+static void build_dict(struct spa_pod_builder *b, uint32_t size)
+{
+	struct spa_pod_frame f;
+	uint32_t i, n_items = SPA_MAX(size / 64, 1u);
+	char key[64], value[64];
+
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_int(b, n_items);
+	for (i = 0; i < n_items; i++) {
+		snprintf(key, sizeof(key), "object.property.%u", i);
+		snprintf(value, sizeof(value), "some value of property %u", i);
+		spa_pod_builder_string(b, key);
+		spa_pod_builder_string(b, value);
+	}
+	spa_pod_builder_pop(b, &f);
+}
+
+static void build_set_param(struct pw_protocol_native_connection *conn,
+		struct spa_pod_builder *b, uint32_t size, int fd)
+{
+	struct spa_pod_frame f[2];
+	uint32_t n_volumes = SPA_CLAMP(size / sizeof(float), 1u, SPA_N_ELEMENTS(volumes));
+
+	spa_pod_builder_push_struct(b, &f[0]);
+	spa_pod_builder_id(b, SPA_PARAM_Props);
+	spa_pod_builder_int(b, 0);
+	spa_pod_builder_push_object(b, &f[1], SPA_TYPE_OBJECT_Props, SPA_PARAM_Props);
+	spa_pod_builder_add(b,
+			SPA_PROP_volume, SPA_POD_Float(1.0f),
+			SPA_PROP_mute, SPA_POD_Bool(false),
+			SPA_PROP_channelVolumes, SPA_POD_Array(sizeof(float),
+				SPA_TYPE_Float, n_volumes, volumes),
+			0);
+	spa_pod_builder_pop(b, &f[1]);
+	spa_pod_builder_pop(b, &f[0]);
+}
+
+static void build_info(struct pw_protocol_native_connection *conn,
+		struct spa_pod_builder *b, uint32_t size, int fd)
+{
+	struct spa_pod_frame f;
+
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_int(b, 42);
+	spa_pod_builder_int(b, 64);
+	spa_pod_builder_int(b, 64);
+	spa_pod_builder_long(b, 0xff);
+	spa_pod_builder_id(b, 3);
+	spa_pod_builder_string(b, NULL);
+	build_dict(b, size);
+	spa_pod_builder_pop(b, &f);
+}
+
+static void build_global(struct pw_protocol_native_connection *conn,
+		struct spa_pod_builder *b, uint32_t size, int fd)
+{
+	struct spa_pod_frame f;
+
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_int(b, 42);
+	spa_pod_builder_int(b, PW_PERM_RWXM);
+	spa_pod_builder_string(b, PW_TYPE_INTERFACE_Node);
+	spa_pod_builder_int(b, PW_VERSION_NODE);
+	build_dict(b, size);
+	spa_pod_builder_pop(b, &f);
+}
+
+static void build_bytes(struct pw_protocol_native_connection *conn,
+		struct spa_pod_builder *b, uint32_t size, int fd)
+{
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Bytes(bytes, SPA_MIN(size, sizeof(bytes))));
+}
+
+static void build_fd(struct pw_protocol_native_connection *conn,
+		struct spa_pod_builder *b, uint32_t size, int fd)
+{
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Int(42),
+			SPA_POD_Fd(pw_protocol_native_connection_add_fd(conn, fd)));
+}
+
+static const struct payload payloads[] = {
+	{ "set_param", build_set_param },
+	{ "info", build_info },
+	{ "global", build_global },
+	{ "bytes", build_bytes },
+	{ "fd", build_fd },
+};
+
+static const uint32_t sizes[] = { 64, 1024, 16 * 1024, 256 * 1024 };
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void write_message(struct pw_protocol_native_connection *conn,
+		const struct payload *p, uint32_t opcode, uint32_t size, int fd)
+{
+	struct spa_pod_builder *b;
+	int res;
+
+	b = pw_protocol_native_connection_begin(conn, 1, opcode, NULL);
+	spa_assert_se(b != NULL);
+	p->build(conn, b, size, fd);
+	res = pw_protocol_native_connection_end(conn, b);
+	spa_assert_se(SPA_RESULT_IS_ASYNC(res));
+}
+
+/* read all available messages, returns the number of messages or < 0 */
+static int read_messages(struct pw_protocol_native_connection *conn,
+		const struct pw_protocol_native_message **last)
+{
+	const struct pw_protocol_native_message *msg;
+	struct spa_pod_parser prs;
+	struct spa_pod_frame f;
+	uint32_t i;
+	int res, count = 0;
+
+	while ((res = pw_protocol_native_connection_get_next(conn, &msg)) == 1) {
+		/* parse the message header like the demarshal functions do */
+		spa_pod_parser_init(&prs, msg->data, msg->size);
+		spa_assert_se(spa_pod_parser_push_struct(&prs, &f) == 0);
+
+		/* we own the fds now */
+		for (i = 0; i < msg->n_fds; i++)
+			close(pw_protocol_native_connection_get_fd(conn, i));
+
+		if (last)
+			*last = msg;
+		count++;
+	}
+	if (res < 0 && res != -EAGAIN)
+		return res;
+	return count;
+}
+
+static void run_throughput(const char *mode, struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out, const struct payload *p,
+		uint32_t size)
+{
+	uint32_t i, j, count, sent = 0, received = 0;
+	uint64_t t1, t2;
+	int res, fd = p->build == build_fd ? STDOUT_FILENO : -1;
+
+	/* keep the amount of data about the same for all sizes */
+	count = SPA_CLAMP(256u * 1024 * 1024 / SPA_MAX(size, 1u), 1000u, (uint32_t)MAX_COUNT);
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i += BATCH) {
+		for (j = 0; j < BATCH && i + j < count; j++) {
+			write_message(out, p, OPCODE_MESSAGE, size, fd);
+			sent++;
+		}
+		/* the socket returns -EAGAIN when it is full, the ring keeps
+		 * the data pending until the reader made room */
+		while (true) {
+			res = pw_protocol_native_connection_flush(out);
+			spa_assert_se(res == 0 || res == -EAGAIN);
+			if (res == 0 && !pw_protocol_native_connection_has_pending(out))
+				break;
+			res = read_messages(in, NULL);
+			spa_assert_se(res >= 0);
+			received += res;
+		}
+	}
+	while (received < sent) {
+		res = read_messages(in, NULL);
+		spa_assert_se(res >= 0);
+		received += res;
+	}
+	t2 = get_time_ns();
+
+	fprintf(stderr, "%-6s %-9s %7u: %8.0f msgs/sec %8.1f MB/sec %6.2f usec/msg\n",
+			mode, p->name, size,
+			count * (double)SPA_NSEC_PER_SEC / (t2 - t1),
+			(double)count * size * SPA_NSEC_PER_SEC / (t2 - t1) / (1024 * 1024),
+			(t2 - t1) / 1000.0 / count);
+}
+
+static void connect_ring(struct pw_protocol_native_connection *client,
+		struct pw_protocol_native_connection *server)
+{
+	int fd;
+
+	/* the same handshake as the client and server do for the ring */
+	fd = pw_protocol_native_connection_offer_ring(client, RING_SIZE);
+	spa_assert_se(fd >= 0);
+	spa_assert_se(pw_protocol_native_connection_use_ring(server,
+				fcntl(fd, F_DUPFD_CLOEXEC, 0), RING_SIZE) == 0);
+	write_message(server, &payloads[0], OPCODE_MESSAGE, 64, -1);
+	spa_assert_se(pw_protocol_native_connection_flush(server) == 0);
+	spa_assert_se(read_messages(client, NULL) == 1);
+	spa_assert_se(pw_protocol_native_connection_flush(client) == 0);
+	spa_assert_se(read_messages(server, NULL) == 0);
+}
+
+static void test_throughput(struct pw_context *context, bool ring)
+{
+	struct pw_protocol_native_connection *client, *server;
+	const char *mode = ring ? "ring" : "socket";
+	int fds[2];
+
+	spa_assert_se(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+	client = pw_protocol_native_connection_new(context, fds[0]);
+	spa_assert_se(client != NULL);
+	server = pw_protocol_native_connection_new(context, fds[1]);
+	spa_assert_se(server != NULL);
+
+	if (ring)
+		connect_ring(client, server);
+
+	SPA_FOR_EACH_ELEMENT_VAR(payloads, p) {
+		if (p->build == build_fd) {
+			run_throughput(mode, server, client, p, 0);
+			continue;
+		}
+		SPA_FOR_EACH_ELEMENT_VAR(sizes, s)
+			run_throughput(mode, server, client, p, *s);
+	}
+
+	pw_protocol_native_connection_destroy(client);
+	pw_protocol_native_connection_destroy(server);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+struct echo {
+	struct pw_protocol_native_connection *conn;
+	int fd;
+};
+
+/* the server side of the latency test, sends every message back */
+static void *echo_thread(void *data)
+{
+	struct echo *e = data;
+	const struct pw_protocol_native_message *msg;
+	struct pollfd pfd = { .fd = e->fd, .events = POLLIN };
+	struct spa_pod_builder *b;
+	int res;
+
+	while (true) {
+		if (poll(&pfd, 1, -1) < 0)
+			break;
+		while ((res = pw_protocol_native_connection_get_next(e->conn, &msg)) == 1) {
+			if (msg->opcode == OPCODE_QUIT)
+				return NULL;
+			b = pw_protocol_native_connection_begin(e->conn, msg->id, msg->opcode, NULL);
+			spa_pod_builder_raw(b, msg->data, msg->size);
+			pw_protocol_native_connection_end(e->conn, b);
+		}
+		if (res != -EAGAIN)
+			break;
+		while (pw_protocol_native_connection_flush(e->conn) == -EAGAIN)
+			poll(&(struct pollfd) { .fd = e->fd, .events = POLLOUT }, 1, -1);
+	}
+	return NULL;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t ca = *(const uint64_t*)a, cb = *(const uint64_t*)b;
+	return ca < cb ? -1 : ca > cb ? 1 : 0;
+}
+
+static void run_latency(struct pw_protocol_native_connection *conn, int fd,
+		const struct payload *p, uint32_t size)
+{
+	static uint64_t times[MAX_LATENCY];
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	uint32_t i, count;
+	uint64_t t1, total = 0;
+	int res;
+
+	count = SPA_CLAMP(64u * 1024 * 1024 / SPA_MAX(size, 1u), 100u, (uint32_t)MAX_LATENCY);
+
+	for (i = 0; i < count; i++) {
+		t1 = get_time_ns();
+		write_message(conn, p, OPCODE_MESSAGE, size, -1);
+		while ((res = pw_protocol_native_connection_flush(conn)) == -EAGAIN) {
+			/* large messages, wait for the echo thread to drain the socket */
+			poll(&(struct pollfd) { .fd = fd, .events = POLLOUT }, 1, -1);
+		}
+		spa_assert_se(res == 0);
+		while (true) {
+			spa_assert_se(poll(&pfd, 1, -1) == 1);
+			if ((res = read_messages(conn, NULL)) != 0)
+				break;
+		}
+		spa_assert_se(res == 1);
+		times[i] = get_time_ns() - t1;
+		total += times[i];
+	}
+	qsort(times, count, sizeof(uint64_t), compare_u64);
+
+	fprintf(stderr, "rtt    %-9s %7u: avg %7.2f p50 %7.2f p99 %7.2f max %7.2f usec\n",
+			p->name, size, total / 1000.0 / count,
+			times[count / 2] / 1000.0,
+			times[SPA_MIN(count * 99 / 100, count - 1)] / 1000.0,
+			times[count - 1] / 1000.0);
+}
+
+static void test_latency(struct pw_context *context)
+{
+	struct pw_protocol_native_connection *client;
+	struct echo echo;
+	pthread_t thread;
+	int fds[2];
+
+	spa_assert_se(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+	client = pw_protocol_native_connection_new(context, fds[0]);
+	spa_assert_se(client != NULL);
+	echo.conn = pw_protocol_native_connection_new(context, fds[1]);
+	spa_assert_se(echo.conn != NULL);
+	echo.fd = fds[1];
+
+	spa_assert_se(pthread_create(&thread, NULL, echo_thread, &echo) == 0);
+
+	SPA_FOR_EACH_ELEMENT_VAR(payloads, p) {
+		if (p->build == build_fd)
+			continue;
+		SPA_FOR_EACH_ELEMENT_VAR(sizes, s)
+			run_latency(client, fds[0], p, *s);
+	}
+
+	write_message(client, &payloads[0], OPCODE_QUIT, 64, -1);
+	spa_assert_se(pw_protocol_native_connection_flush(client) == 0);
+	pthread_join(thread, NULL);
+
+	pw_protocol_native_connection_destroy(client);
+	pw_protocol_native_connection_destroy(echo.conn);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	uint32_t i;
+
+	pw_init(&argc, &argv);
+
+	PW_LOG_TOPIC_INIT(mod_topic);
+	PW_LOG_TOPIC_INIT(mod_topic_connection);
+
+	for (i = 0; i < SPA_N_ELEMENTS(bytes); i++)
+		bytes[i] = i & 0xff;
+	for (i = 0; i < SPA_N_ELEMENTS(volumes); i++)
+		volumes[i] = 1.0f / (i + 1);
+
+	loop = pw_main_loop_new(NULL);
+	spa_assert_se(loop != NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+	spa_assert_se(context != NULL);
+
+	test_throughput(context, false);
+	test_throughput(context, true);
+	test_latency(context);
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
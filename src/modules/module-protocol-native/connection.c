@@ -2,6 +2,8 @@
 /* SPDX-FileCopyrightText: Copyright © 2018 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include "config.h"
+
 #include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -9,9 +11,13 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 
+#include <spa/utils/atomic.h>
 #include <spa/utils/result.h>
+#include <spa/utils/ringbuffer.h>
 #include <spa/pod/builder.h>
 
 #include <pipewire/pipewire.h>
@@ -24,6 +30,8 @@ PW_LOG_TOPIC_EXTERN(mod_topic_connection);
 #define spa_debug(...) pw_logt_debug(mod_topic_connection, __VA_ARGS__)
 #include <spa/debug/pod.h>
 
+#include <sdt-probes.h>
+
 #include "connection.h"
 #include "defs.h"
 
@@ -34,6 +42,32 @@ PW_LOG_TOPIC_EXTERN(mod_topic_connection);
 #define HDR_SIZE_V0	8
 #define HDR_SIZE	16
 
+#ifndef F_GET_SEALS
+#define F_GET_SEALS	(F_LINUX_SPECIFIC_BASE + 10)
+#define F_SEAL_SHRINK	0x0002
+#endif
+
+/* id of the message that marks the start of the ring in a direction */
+#define RING_START_ID	SPA_ID_INVALID
+#define RING_MIN_SIZE	(4u * 1024)
+#define RING_MAX_SIZE	(16u * 1024 * 1024)
+
+/* Header of a ring in shared memory, the peer can write to all of the fields
+ * so make sure to never trust the values. */
+struct ring_header {
+	struct spa_ringbuffer rb;
+	uint32_t size;
+	int32_t reader_waiting;		/* reader wants a wakeup for new data */
+	int32_t writer_waiting;		/* writer wants a wakeup for free space */
+	uint32_t padding[11];
+};
+
+struct ring {
+	struct ring_header *hdr;
+	void *data;
+	uint32_t size;
+};
+
 struct buffer {
 	uint8_t *buffer_data;
 	size_t buffer_size;
@@ -65,6 +99,17 @@ struct impl {
 
 	uint32_t version;
 	size_t hdr_size;
+
+	struct pw_memblock *ring_mem;	/* rings we allocated */
+	void *ring_map;			/* or rings we mapped from the peer */
+	size_t ring_map_size;
+	struct ring in_ring, out_ring;
+	size_t out_socket_size;		/* bytes to send on the socket before the ring */
+	uint32_t out_socket_fds;	/* fds to send with those bytes */
+	unsigned int ring_in:1;		/* messages are read from the ring */
+	unsigned int ring_out:1;	/* messages are written to the ring */
+	unsigned int ring_wakeup:1;	/* the peer needs a wakeup */
+	unsigned int ring_need_fds:1;	/* a message is waiting for its fds */
 };
 
 /** \endcond */
@@ -139,7 +184,10 @@ static void *connection_ensure_size(struct pw_protocol_native_connection *conn,
 		void *np;
 		size_t ns;
 
-		ns = SPA_ROUND_UP_N(buf->buffer_size + size, MAX_BUFFER_SIZE);
+		/* grow at least twice the size to avoid many reallocs when
+		 * large messages are built or received in small steps */
+		ns = SPA_MAX(buf->buffer_size + size, buf->buffer_maxsize * 2);
+		ns = SPA_ROUND_UP_N(ns, MAX_BUFFER_SIZE);
 		np = realloc(buf->buffer_data, ns);
 		if (np == NULL) {
 			res = -errno;
@@ -195,7 +243,10 @@ static void close_all_fds(struct msghdr *msg, struct cmsghdr *from)
 	}
 }
 
-static int refill_buffer(struct pw_protocol_native_connection *conn, struct buffer *buf)
+/* Receive data in \a data and the fds in \a buf, returns the number of
+ * bytes received */
+static ssize_t read_socket(struct pw_protocol_native_connection *conn, struct buffer *buf,
+		void *data, size_t avail)
 {
 	ssize_t len;
 	struct cmsghdr *cmsg = NULL;
@@ -206,11 +257,8 @@ static int refill_buffer(struct pw_protocol_native_connection *conn, struct buff
 		struct cmsghdr align;
 	} cmsgbuf;
 	int i, n_fds = 0, *fds;
-	size_t avail;
 
-	avail = buf->buffer_maxsize - buf->buffer_size;
-
-	iov[0].iov_base = buf->buffer_data + buf->buffer_size;
+	iov[0].iov_base = data;
 	iov[0].iov_len = avail;
 	msg.msg_iov = iov;
 	msg.msg_iovlen = 1;
@@ -234,8 +282,6 @@ static int refill_buffer(struct pw_protocol_native_connection *conn, struct buff
 		break;
 	}
 
-	buf->buffer_size += len;
-
 	/* handle control messages */
 	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
 		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
@@ -253,7 +299,7 @@ static int refill_buffer(struct pw_protocol_native_connection *conn, struct buff
 	pw_log_trace("connection %p: %d read %zd bytes and %d fds", conn, conn->fd, len,
 		     n_fds);
 
-	return 0;
+	return len;
 
 	/* ERRORS */
 recv_error:
@@ -271,6 +317,103 @@ too_many_fds:
 	return -EPROTO;
 }
 
+static int refill_buffer(struct pw_protocol_native_connection *conn, struct buffer *buf)
+{
+	ssize_t len;
+
+	len = read_socket(conn, buf, buf->buffer_data + buf->buffer_size,
+			buf->buffer_maxsize - buf->buffer_size);
+	if (len < 0)
+		return len;
+
+	buf->buffer_size += len;
+	return 0;
+}
+
+static void ring_wakeup(struct impl *impl)
+{
+	impl->ring_wakeup = true;
+	spa_hook_list_call(&impl->this.listener_list,
+			struct pw_protocol_native_connection_events, need_flush, 0);
+}
+
+/* When messages are in the ring, the socket only has the fds of the messages
+ * and bytes to wake us up. */
+static int drain_socket(struct pw_protocol_native_connection *conn, struct buffer *buf)
+{
+	uint8_t data[64];
+	ssize_t len = 0;
+
+	/* drop the fds of the messages that were already returned */
+	if (buf->fds_offset > 0) {
+		buf->n_fds -= SPA_MIN(buf->fds_offset, buf->n_fds);
+		memmove(buf->fds, &buf->fds[buf->fds_offset], buf->n_fds * sizeof(int));
+		buf->fds_offset = 0;
+	}
+	/* the peer can be many messages ahead, leave the fds we can't hold
+	 * in the socket until the messages that use them are parsed */
+	while (buf->n_fds + MAX_FDS_MSG <= MAX_FDS &&
+	    (len = read_socket(conn, buf, data, sizeof(data))) > 0);
+
+	return len < 0 && len != -EAGAIN ? len : 0;
+}
+
+static int refill_ring(struct pw_protocol_native_connection *conn, struct buffer *buf)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct ring *r = &impl->in_ring;
+	struct buffer *out = &impl->out;
+	uint32_t index, n_fds = buf->n_fds;
+	int32_t avail, filled;
+	int res;
+
+	avail = spa_ringbuffer_get_read_index(&r->hdr->rb, &index);
+	if (avail == 0 || impl->ring_need_fds) {
+		if ((res = drain_socket(conn, buf)) < 0)
+			return res;
+		impl->ring_need_fds = false;
+
+		if (avail == 0) {
+			/* ask for a wakeup and check again so that we don't
+			 * miss data that was added in the meantime */
+			SPA_ATOMIC_STORE(r->hdr->reader_waiting, 1);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			avail = spa_ringbuffer_get_read_index(&r->hdr->rb, &index);
+		}
+	}
+	if (avail < 0 || (uint32_t)avail > r->size) {
+		pw_log_warn("connection %p: invalid ring read avail:%d", conn, avail);
+		return -EPROTO;
+	}
+	if (avail == 0) {
+		/* we are idle, flush our own messages when the peer made space */
+		if (impl->ring_out && out->buffer_size > out->offset) {
+			filled = spa_ringbuffer_get_write_index(&impl->out_ring.hdr->rb, &index);
+			if (filled >= 0 && (uint32_t)filled < impl->out_ring.size)
+				spa_hook_list_call(&conn->listener_list,
+						struct pw_protocol_native_connection_events,
+						need_flush, 0);
+		}
+		return buf->n_fds > n_fds ? 0 : -EAGAIN;
+	}
+
+	if (connection_ensure_size(conn, buf, avail) == NULL)
+		return -errno;
+
+	spa_ringbuffer_read_data(&r->hdr->rb, r->data, r->size, index & (r->size - 1),
+			buf->buffer_data + buf->buffer_size, avail);
+	spa_ringbuffer_read_update(&r->hdr->rb, index + avail);
+	buf->buffer_size += avail;
+
+	pw_log_trace("connection %p: %d read %d bytes from ring", conn, conn->fd, avail);
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (SPA_ATOMIC_XCHG(r->hdr->writer_waiting, 0))
+		ring_wakeup(impl);
+
+	return 0;
+}
+
 static void clear_buffer(struct buffer *buf, bool fds)
 {
 	uint32_t i;
@@ -404,6 +547,196 @@ static int ensure_stack_level(struct impl *impl, struct pw_protocol_native_messa
 	return 0;
 }
 
+static void ring_setup(struct impl *impl, void *ptr, uint32_t size, bool owner)
+{
+	struct ring r[2];
+	uint32_t i;
+
+	/* the first ring is written by the owner of the memory */
+	for (i = 0; i < 2; i++) {
+		r[i].hdr = SPA_PTROFF(ptr, i * (sizeof(struct ring_header) + size),
+				struct ring_header);
+		r[i].data = SPA_PTROFF(r[i].hdr, sizeof(struct ring_header), void);
+		r[i].size = size;
+	}
+	impl->out_ring = r[owner ? 0 : 1];
+	impl->in_ring = r[owner ? 1 : 0];
+}
+
+static void ring_clear(struct impl *impl)
+{
+	if (impl->ring_mem)
+		pw_memblock_unref(impl->ring_mem);
+	if (impl->ring_map)
+		munmap(impl->ring_map, impl->ring_map_size);
+	impl->ring_mem = NULL;
+	impl->ring_map = NULL;
+	spa_zero(impl->in_ring);
+	spa_zero(impl->out_ring);
+	impl->out_socket_size = 0;
+	impl->out_socket_fds = 0;
+	impl->ring_in = impl->ring_out = false;
+	impl->ring_wakeup = impl->ring_need_fds = false;
+}
+
+/* Queue the message that tells the peer that our next messages are in the
+ * ring. Everything before it still goes over the socket. */
+static int ring_start_out(struct impl *impl)
+{
+	struct buffer *buf = &impl->out;
+	uint32_t *p;
+
+	if ((p = connection_ensure_size(&impl->this, buf, impl->hdr_size)) == NULL)
+		return -errno;
+
+	p[0] = RING_START_ID;
+	p[1] = 0;
+	p[2] = 0;
+	p[3] = 0;
+	buf->buffer_size += impl->hdr_size;
+
+	impl->out_socket_size = buf->buffer_size - buf->offset;
+	impl->out_socket_fds = buf->n_fds;
+	impl->ring_out = true;
+
+	pw_log_debug("connection %p: start writing to ring size:%u", impl,
+			impl->out_ring.size);
+
+	spa_hook_list_call(&impl->this.listener_list,
+			struct pw_protocol_native_connection_events, need_flush, 0);
+	return 0;
+}
+
+/* The peer sends the next messages in the ring */
+static int ring_start_in(struct impl *impl)
+{
+	struct buffer *buf = &impl->in;
+
+	if (impl->ring_in)
+		return -EPROTO;
+
+	pw_log_debug("connection %p: start reading from ring size:%u", impl,
+			impl->in_ring.size);
+
+	/* what follows on the socket is only there to pass fds and wakeups */
+	buf->buffer_size = buf->offset;
+	clear_buffer(buf, false);
+	impl->ring_in = true;
+
+	if (!impl->ring_out)
+		return ring_start_out(impl);
+	return 0;
+}
+
+static bool ring_size_valid(uint32_t size)
+{
+	return size >= RING_MIN_SIZE && size <= RING_MAX_SIZE &&
+		(size & (size - 1)) == 0;
+}
+
+/** Offer shared memory rings to pass messages
+ *
+ * \param conn the connection
+ * \param size the size of the ring in each direction, a power of 2
+ * \return the fd to pass to the peer or < 0 on error
+ *
+ * Allocates the rings. When the peer accepts them with
+ * pw_protocol_native_connection_use_ring(), the messages in both directions
+ * go through the rings and the socket is only used for the fds and to wake
+ * up the peer. The returned fd remains owned by the connection.
+ *
+ * \memberof pw_protocol_native_connection
+ */
+int pw_protocol_native_connection_offer_ring(struct pw_protocol_native_connection *conn,
+		uint32_t size)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct pw_memblock *mem;
+
+	if (impl->version < 3 || !ring_size_valid(size))
+		return -EINVAL;
+	if (impl->in_ring.hdr != NULL)
+		return -EBUSY;
+
+	mem = pw_mempool_alloc(pw_context_get_mempool(impl->context),
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, 2 * (sizeof(struct ring_header) + size));
+	if (mem == NULL)
+		return -errno;
+
+	impl->ring_mem = mem;
+	ring_setup(impl, mem->map->ptr, size, true);
+	impl->in_ring.hdr->size = impl->out_ring.hdr->size = size;
+
+	pw_log_debug("connection %p: offer ring size:%u fd:%d", conn, size, mem->fd);
+	return mem->fd;
+}
+
+/** Use the shared memory rings offered by the peer
+ *
+ * \param conn the connection
+ * \param fd the fd of the rings, ownership is taken
+ * \param size the size of the ring in each direction
+ * \return 0 on success, < 0 on error
+ *
+ * \memberof pw_protocol_native_connection
+ */
+int pw_protocol_native_connection_use_ring(struct pw_protocol_native_connection *conn,
+		int fd, uint32_t size)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct stat st;
+	size_t map_size;
+	void *ptr;
+	int res, seals;
+
+	if (impl->version < 3 || !ring_size_valid(size)) {
+		res = -EINVAL;
+		goto error;
+	}
+	if (impl->in_ring.hdr != NULL) {
+		res = -EBUSY;
+		goto error;
+	}
+	map_size = 2 * (sizeof(struct ring_header) + size);
+
+	/* the peer must not be able to shrink the memory under us */
+	if ((seals = fcntl(fd, F_GET_SEALS)) < 0 || !(seals & F_SEAL_SHRINK)) {
+		res = -EPERM;
+		goto error;
+	}
+	if (fstat(fd, &st) < 0) {
+		res = -errno;
+		goto error;
+	}
+	if (st.st_size < 0 || (size_t)st.st_size < map_size) {
+		res = -EINVAL;
+		goto error;
+	}
+	ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		res = -errno;
+		goto error;
+	}
+	close(fd);
+
+	impl->ring_map = ptr;
+	impl->ring_map_size = map_size;
+	ring_setup(impl, ptr, size, false);
+
+	pw_log_debug("connection %p: use ring size:%u", conn, size);
+
+	return ring_start_out(impl);
+
+error:
+	pw_log_warn("connection %p: can't use ring fd:%d size:%u: %s", conn, fd, size,
+			spa_strerror(res));
+	close(fd);
+	return res;
+}
+
 /** Make a new connection object for the given socket
  *
  * \param fd the socket
@@ -458,7 +791,13 @@ no_mem:
 
 int pw_protocol_native_connection_set_fd(struct pw_protocol_native_connection *conn, int fd)
 {
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+
 	pw_log_debug("connection %p: fd:%d", conn, fd);
+	/* the rings belong to the old socket, messages queued before the
+	 * first socket is set go out on it, including a ring offer */
+	if (conn->fd >= 0)
+		ring_clear(impl);
 	conn->fd = fd;
 	return 0;
 }
@@ -483,6 +822,7 @@ void pw_protocol_native_connection_destroy(struct pw_protocol_native_connection
 	clear_buffer(&impl->in, true);
 	free(impl->out.buffer_data);
 	free(impl->in.buffer_data);
+	ring_clear(impl);
 
 	while (!spa_list_is_empty(&impl->reenter_stack))
 		pop_reenter_stack(impl, 1);
@@ -501,7 +841,7 @@ static int prepare_packet(struct pw_protocol_native_connection *conn, struct buf
 	size = buf->buffer_size - buf->offset;
 
 	if (size < impl->hdr_size)
-		return impl->hdr_size;
+		return impl->hdr_size - size;
 
 	p = (uint32_t *) data;
 
@@ -534,12 +874,19 @@ static int prepare_packet(struct pw_protocol_native_connection *conn, struct buf
 	size -= impl->hdr_size;
 	buf->msg.fds = &buf->fds[buf->fds_offset];
 
+	if (size < len)
+		return len - size;
+
+	/* with the ring, the fds come separately over the socket. Reading
+	 * them also drops the fds of the previous messages. */
+	if (impl->ring_in && buf->msg.n_fds + buf->fds_offset > buf->n_fds) {
+		impl->ring_need_fds = true;
+		return 1;
+	}
+
 	if (buf->msg.n_fds + buf->fds_offset > MAX_FDS)
 		return -EPROTO;
 
-	if (size < len)
-		return len;
-
 	buf->msg.size = len;
 	buf->msg.data = data;
 
@@ -585,12 +932,21 @@ pw_protocol_native_connection_get_next(struct pw_protocol_native_connection *con
 		len = prepare_packet(conn, buf);
 		if (len < 0)
 			return len;
-		if (len == 0)
-			break;
+		if (len == 0) {
+			if (SPA_LIKELY(buf->msg.id != RING_START_ID || impl->in_ring.hdr == NULL))
+				break;
+			if ((res = ring_start_in(impl)) < 0)
+				return res;
+			continue;
+		}
 
 		if (connection_ensure_size(conn, buf, len) == NULL)
 			return -errno;
-		if ((res = refill_buffer(conn, buf)) < 0)
+		if (impl->ring_in)
+			res = refill_ring(conn, buf);
+		else
+			res = refill_buffer(conn, buf);
+		if (res < 0)
 			return res;
 	}
 
@@ -656,9 +1012,10 @@ static int builder_overflow(void *data, uint32_t size)
 	struct impl *impl = data;
 	struct spa_pod_builder *b = &impl->builder;
 
-	b->size = SPA_ROUND_UP_N(size, 4096);
-	if ((b->data = begin_write(&impl->this, b->size)) == NULL)
+	if ((b->data = begin_write(&impl->this, SPA_ROUND_UP_N(size, 4096))) == NULL)
 		return -errno;
+	/* use all the space we have now */
+	b->size = impl->out.buffer_maxsize - impl->out.buffer_size - impl->hdr_size;
         return 0;
 }
 
@@ -675,6 +1032,14 @@ pw_protocol_native_connection_begin(struct pw_protocol_native_connection *conn,
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
 	struct buffer *buf = &impl->out;
 
+	/* move the unsent data to the start when that is cheaper than
+	 * growing the buffer with it */
+	if (buf->offset > 0 && buf->buffer_size - buf->offset <= buf->offset) {
+		buf->buffer_size -= buf->offset;
+		memmove(buf->buffer_data, buf->buffer_data + buf->offset, buf->buffer_size);
+		buf->offset = 0;
+	}
+
 	buf->msg.id = id;
 	buf->msg.opcode = opcode;
 	impl->builder = SPA_POD_BUILDER_INIT(NULL, 0);
@@ -737,18 +1102,11 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 	return res;
 }
 
-/** Flush the connection object
- *
- * \param conn the connection object
- * \return 0 on success < 0 error code on error
- *
- * Write the queued messages on the connection to the socket
- *
- * \memberof pw_protocol_native_connection
- */
-int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *conn)
+/* Send \a size bytes of \a data and \a n_fds fds on the socket, the pointers
+ * and counters are updated with what was sent */
+static int send_socket(struct pw_protocol_native_connection *conn,
+		void **data, size_t *size, int **fds, uint32_t *n_fds)
 {
-	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
 	ssize_t sent, outsize;
 	struct msghdr msg = { 0 };
 	struct iovec iov[1];
@@ -757,31 +1115,20 @@ int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *co
 		char cmsgbuf[CMSG_SPACE(MAX_FDS_MSG * sizeof(int))];
 		struct cmsghdr align;
 	} cmsgbuf;
-	int res = 0, *fds;
-	uint32_t fds_len, to_close, n_fds, outfds, i;
-	struct buffer *buf;
-	void *data;
-	size_t size;
+	uint32_t fds_len, outfds;
 
-	buf = &impl->out;
-	data = buf->buffer_data;
-	size = buf->buffer_size;
-	fds = buf->fds;
-	n_fds = buf->n_fds;
-	to_close = 0;
-
-	while (size > 0) {
-		if (n_fds > MAX_FDS_MSG) {
+	while (*size > 0) {
+		if (*n_fds > MAX_FDS_MSG) {
 			outfds = MAX_FDS_MSG;
-			outsize = SPA_MIN(sizeof(uint32_t), size);
+			outsize = SPA_MIN(sizeof(uint32_t), *size);
 		} else {
-			outfds = n_fds;
-			outsize = size;
+			outfds = *n_fds;
+			outsize = *size;
 		}
 
 		fds_len = outfds * sizeof(int);
 
-		iov[0].iov_base = data;
+		iov[0].iov_base = *data;
 		iov[0].iov_len = outsize;
 		msg.msg_iov = iov;
 		msg.msg_iovlen = 1;
@@ -793,7 +1140,7 @@ int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *co
 			cmsg->cmsg_level = SOL_SOCKET;
 			cmsg->cmsg_type = SCM_RIGHTS;
 			cmsg->cmsg_len = CMSG_LEN(fds_len);
-			memcpy(CMSG_DATA(cmsg), fds, fds_len);
+			memcpy(CMSG_DATA(cmsg), *fds, fds_len);
 			msg.msg_controllen = cmsg->cmsg_len;
 		} else {
 			msg.msg_control = NULL;
@@ -805,29 +1152,144 @@ int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *co
 			if (sent < 0) {
 				if (errno == EINTR)
 					continue;
-				else {
-					res = -errno;
-					goto exit;
-				}
+				else
+					return -errno;
 			}
 			break;
 		}
 		pw_log_trace("connection %p: %d written %zd bytes and %u fds", conn, conn->fd, sent,
 			     outfds);
 
-		size -= sent;
-		data = SPA_PTROFF(data, sent, void);
-		n_fds -= outfds;
-		fds += outfds;
-		to_close += outfds;
+		*size -= sent;
+		*data = SPA_PTROFF(*data, sent, void);
+		*n_fds -= outfds;
+		*fds += outfds;
+	}
+	return 0;
+}
+
+/* Send the messages through the ring, the fds of the messages and the
+ * wakeups of the peer go over the socket */
+static int flush_ring(struct pw_protocol_native_connection *conn,
+		void **data, size_t *size, int **fds, uint32_t *n_fds)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct ring *r = &impl->out_ring;
+	uint8_t byte = 0;
+	void *bdata;
+	size_t bsize, ssize;
+	uint32_t index, len, sfds, bfds;
+	int32_t filled;
+	bool waiting = false, written = false;
+	int res;
+
+	/* first what was queued before the start of the ring */
+	if (impl->out_socket_size > 0) {
+		ssize = impl->out_socket_size;
+		sfds = impl->out_socket_fds;
+		res = send_socket(conn, data, &ssize, fds, &sfds);
+		*size -= impl->out_socket_size - ssize;
+		*n_fds -= impl->out_socket_fds - sfds;
+		impl->out_socket_size = ssize;
+		impl->out_socket_fds = sfds;
+		if (res < 0)
+			return res;
+	}
+
+	/* the fds need to be there before the messages that use them */
+	while (*n_fds > 0) {
+		bdata = &byte;
+		bsize = 1;
+		bfds = SPA_MIN(*n_fds, (uint32_t)MAX_FDS_MSG);
+		*n_fds -= bfds;
+		res = send_socket(conn, &bdata, &bsize, fds, &bfds);
+		*n_fds += bfds;
+		if (res < 0)
+			return res;
+	}
+
+	while (*size > 0) {
+		filled = spa_ringbuffer_get_write_index(&r->hdr->rb, &index);
+		if (filled < 0 || (uint32_t)filled > r->size) {
+			pw_log_warn("connection %p: invalid ring write filled:%d", conn, filled);
+			return -EPROTO;
+		}
+		if ((uint32_t)filled == r->size) {
+			if (waiting)
+				break;
+			/* ask for a wakeup when there is space and check again */
+			SPA_ATOMIC_STORE(r->hdr->writer_waiting, 1);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			waiting = true;
+			continue;
+		}
+		len = SPA_MIN(r->size - filled, *size);
+		spa_ringbuffer_write_data(&r->hdr->rb, r->data, r->size, index & (r->size - 1),
+				*data, len);
+		spa_ringbuffer_write_update(&r->hdr->rb, index + len);
+
+		pw_log_trace("connection %p: %d written %u bytes to ring", conn, conn->fd, len);
+
+		*data = SPA_PTROFF(*data, len, void);
+		*size -= len;
+		written = true;
 	}
+	if (written) {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (SPA_ATOMIC_XCHG(r->hdr->reader_waiting, 0))
+			impl->ring_wakeup = true;
+	}
+	if (impl->ring_wakeup) {
+		bdata = &byte;
+		bsize = 1;
+		bfds = 0;
+		if ((res = send_socket(conn, &bdata, &bsize, fds, &bfds)) < 0)
+			return res;
+		impl->ring_wakeup = false;
+	}
+	/* when the ring is full, the peer wakes us up when there is space */
+	return 0;
+}
+
+/** Flush the connection object
+ *
+ * \param conn the connection object
+ * \return 0 on success < 0 error code on error
+ *
+ * Write the queued messages on the connection to the socket
+ *
+ * \memberof pw_protocol_native_connection
+ */
+int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *conn)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	int res, *fds;
+	uint32_t to_close, n_fds, i;
+	struct buffer *buf;
+	void *data;
+	size_t size;
+
+	buf = &impl->out;
+	data = buf->buffer_data + buf->offset;
+	size = buf->buffer_size - buf->offset;
+	fds = buf->fds;
+	n_fds = buf->n_fds;
 
-	res = 0;
+	SDT_PROBE(pipewire, connection_flush, conn, size, n_fds, impl->ring_out);
 
-exit:
+	if (impl->ring_out)
+		res = flush_ring(conn, &data, &size, &fds, &n_fds);
+	else
+		res = send_socket(conn, &data, &size, &fds, &n_fds);
+
+	to_close = fds - buf->fds;
+
+	/* keep the unsent data in place, it is moved when more messages
+	 * are added */
 	if (size > 0)
-		memmove(buf->buffer_data, data, size);
-	buf->buffer_size = size;
+		buf->offset = SPA_PTRDIFF(data, buf->buffer_data);
+	else
+		buf->buffer_size = buf->offset = 0;
 	for (i = 0; i < to_close; i++) {
 		pw_log_debug("%p: close fd:%d", conn, buf->fds[i]);
 		close(buf->fds[i]);
@@ -838,6 +1300,19 @@ exit:
 	return res;
 }
 
+/** Check if the connection has unsent messages
+ *
+ * \param conn the connection object
+ * \return true when queued messages could not be flushed
+ *
+ * \memberof pw_protocol_native_connection
+ */
+bool pw_protocol_native_connection_has_pending(struct pw_protocol_native_connection *conn)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	return impl->out.buffer_size > impl->out.offset;
+}
+
 /** Clear the connection object
  *
  * \param conn the connection object
@@ -855,6 +1330,8 @@ int pw_protocol_native_connection_clear(struct pw_protocol_native_connection *co
 
 	clear_buffer(&impl->out, true);
 	clear_buffer(&impl->in, true);
+	impl->out_socket_size = 0;
+	impl->out_socket_fds = 0;
 
 	return 0;
 }
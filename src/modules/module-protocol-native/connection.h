@@ -79,12 +79,20 @@ pw_protocol_native_connection_flush(struct pw_protocol_native_connection *conn);
 int
 pw_protocol_native_connection_clear(struct pw_protocol_native_connection *conn);
 
+bool
+pw_protocol_native_connection_has_pending(struct pw_protocol_native_connection *conn);
+
 void pw_protocol_native_connection_enter(struct pw_protocol_native_connection *conn);
 void pw_protocol_native_connection_leave(struct pw_protocol_native_connection *conn);
 
 struct spa_pod *pw_protocol_native_connection_get_footer(struct pw_protocol_native_connection *conn,
 		const struct pw_protocol_native_message *msg);
 
+int pw_protocol_native_connection_offer_ring(struct pw_protocol_native_connection *conn,
+		uint32_t size);
+int pw_protocol_native_connection_use_ring(struct pw_protocol_native_connection *conn,
+		int fd, uint32_t size);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -52,9 +52,10 @@ static void end_footer(struct footer_builder *fb)
 }
 
 void marshal_core_footers(struct footer_core_global_state *state, struct pw_core *core,
-		struct spa_pod_builder *builder)
+		struct pw_protocol_native_connection *conn, struct spa_pod_builder *builder)
 {
 	struct footer_builder fb = FOOTER_BUILDER_INIT(builder);
+	int fd;
 
 	if (core->recv_generation != state->last_recv_generation) {
 		state->last_recv_generation = core->recv_generation;
@@ -67,6 +68,23 @@ void marshal_core_footers(struct footer_core_global_state *state, struct pw_core
 		end_footer_entry(&fb);
 	}
 
+	if (state->ring_size > 0 && !state->ring_offered) {
+		state->ring_offered = true;
+
+		if ((fd = pw_protocol_native_connection_offer_ring(conn, state->ring_size)) < 0) {
+			pw_log_warn("core %p: can't offer ring size:%u: %s",
+					core, state->ring_size, spa_strerror(fd));
+		} else {
+			pw_log_debug("core %p: offer ring size:%u", core, state->ring_size);
+
+			start_footer_entry(&fb, FOOTER_CLIENT_OPCODE_RING);
+			spa_pod_builder_fd(fb.builder,
+					pw_protocol_native_connection_add_fd(conn, fd));
+			spa_pod_builder_int(fb.builder, state->ring_size);
+			end_footer_entry(&fb);
+		}
+	}
+
 	end_footer(&fb);
 }
 
@@ -89,7 +107,8 @@ void marshal_client_footers(struct footer_client_global_state *state, struct pw_
 	end_footer(&fb);
 }
 
-static int demarshal_core_generation(void *object, struct spa_pod_parser *parser)
+static int demarshal_core_generation(void *object, struct pw_protocol_native_connection *conn,
+		struct spa_pod_parser *parser)
 {
 	struct pw_core *core = object;
 	int64_t generation;
@@ -106,7 +125,8 @@ static int demarshal_core_generation(void *object, struct spa_pod_parser *parser
 	return 0;
 }
 
-static int demarshal_client_generation(void *object, struct spa_pod_parser *parser)
+static int demarshal_client_generation(void *object, struct pw_protocol_native_connection *conn,
+		struct spa_pod_parser *parser)
 {
 	struct pw_impl_client *client = object;
 	int64_t generation;
@@ -123,10 +143,31 @@ static int demarshal_client_generation(void *object, struct spa_pod_parser *pars
 	return 0;
 }
 
+static int demarshal_client_ring(void *object, struct pw_protocol_native_connection *conn,
+		struct spa_pod_parser *parser)
+{
+	struct pw_impl_client *client = object;
+	int64_t idx;
+	int32_t size;
+	int fd;
+
+	if (spa_pod_parser_get_fd(parser, &idx) < 0 ||
+	    spa_pod_parser_get_int(parser, &size) < 0)
+		return -EINVAL;
+
+	if ((fd = pw_protocol_native_connection_get_fd(conn, idx)) < 0)
+		return -EINVAL;
+
+	pw_log_debug("impl-client %p: recv ring size:%d", client, size);
+
+	return pw_protocol_native_connection_use_ring(conn, fd, size);
+}
+
 const struct footer_demarshal footer_core_demarshal[FOOTER_CORE_OPCODE_LAST] = {
 	[FOOTER_CORE_OPCODE_GENERATION] = (struct footer_demarshal){ .demarshal = demarshal_core_generation },
 };
 
 const struct footer_demarshal footer_client_demarshal[FOOTER_CLIENT_OPCODE_LAST] = {
 	[FOOTER_CLIENT_OPCODE_GENERATION] = (struct footer_demarshal){ .demarshal = demarshal_client_generation },
+	[FOOTER_CLIENT_OPCODE_RING] = (struct footer_demarshal){ .demarshal = demarshal_client_ring },
 };
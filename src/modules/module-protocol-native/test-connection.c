@@ -2,6 +2,7 @@
 /* SPDX-FileCopyrightText: Copyright © 2019 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <fcntl.h>
 #include <sys/socket.h>
 
 #include <spa/pod/builder.h>
@@ -165,6 +166,155 @@ static void test_reentering(struct pw_protocol_native_connection *in,
 	}
 }
 
+static void test_large(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	const struct pw_protocol_native_message *msg;
+	struct spa_pod_builder *b;
+	struct spa_pod_parser prs;
+	const void *data;
+	uint32_t i, j, size, len = 1024 * 1024;
+	uint8_t *bytes;
+	bool added = false;
+	int res;
+
+	bytes = malloc(len);
+	spa_assert_se(bytes != NULL);
+	for (i = 0; i < len; i++)
+		bytes[i] = i & 0xff;
+
+	/* queue more than the socket can take at once */
+	for (i = 0; i < 4; i++) {
+		b = pw_protocol_native_connection_begin(out, 1, 6, NULL);
+		spa_assert_se(b != NULL);
+		spa_pod_builder_add_struct(b,
+				SPA_POD_Int(i),
+				SPA_POD_Bytes(bytes, len));
+		res = pw_protocol_native_connection_end(out, b);
+		spa_assert_se(SPA_RESULT_IS_ASYNC(res));
+	}
+
+	for (i = 0; i < 4;) {
+		res = pw_protocol_native_connection_flush(out);
+		spa_assert_se(res == 0 || res == -EAGAIN);
+
+		/* add a small message after a partial flush */
+		if (!added) {
+			write_message(out, 1);
+			added = true;
+		}
+
+		while (i < 4) {
+			res = pw_protocol_native_connection_get_next(in, &msg);
+			if (res == -EAGAIN)
+				break;
+			spa_assert_se(res == 1);
+			spa_assert_se(msg->opcode == 6);
+
+			spa_pod_parser_init(&prs, msg->data, msg->size);
+			spa_assert_se(spa_pod_parser_get_struct(&prs,
+					SPA_POD_Int(&j),
+					SPA_POD_Bytes(&data, &size)) >= 0);
+			spa_assert_se(j == i);
+			spa_assert_se(size == len);
+			spa_assert_se(memcmp(data, bytes, len) == 0);
+			i++;
+		}
+	}
+	res = pw_protocol_native_connection_flush(out);
+	spa_assert_se(res == 0);
+	spa_assert_se(read_message(in, NULL) == 0);
+	spa_assert_se(read_message(in, NULL) == -1);
+
+	free(bytes);
+}
+
+/* the writer is more than MAX_FDS fds ahead of the reader */
+static void test_many_fds(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	const struct pw_protocol_native_message *msg;
+	uint32_t i, j, sent = 0, received = 0;
+	int res;
+
+	for (i = 0; i < 20; i++) {
+		for (j = 0; j < 100; j++, sent++)
+			write_message(out, 1);
+		while (true) {
+			res = pw_protocol_native_connection_flush(out);
+			spa_assert_se(res == 0 || res == -EAGAIN);
+			if (res == 0 && !pw_protocol_native_connection_has_pending(out))
+				break;
+			while ((res = pw_protocol_native_connection_get_next(in, &msg)) == 1) {
+				spa_assert_se(msg->n_fds == 1);
+				close(msg->fds[0]);
+				received++;
+			}
+			spa_assert_se(res == -EAGAIN);
+		}
+	}
+	while (received < sent) {
+		res = pw_protocol_native_connection_get_next(in, &msg);
+		spa_assert_se(res == 1);
+		spa_assert_se(msg->n_fds == 1);
+		close(msg->fds[0]);
+		received++;
+	}
+	spa_assert_se(pw_protocol_native_connection_get_next(in, &msg) == -EAGAIN);
+}
+
+static void test_ring(struct pw_context *context)
+{
+	struct pw_protocol_native_connection *client, *server;
+	const struct pw_protocol_native_message *msg;
+	int fds[2], fd;
+
+	spa_assert_se(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+	client = pw_protocol_native_connection_new(context, fds[0]);
+	spa_assert_se(client != NULL);
+	server = pw_protocol_native_connection_new(context, fds[1]);
+	spa_assert_se(server != NULL);
+
+	spa_assert_se(pw_protocol_native_connection_offer_ring(client, 1000) == -EINVAL);
+	fd = pw_protocol_native_connection_offer_ring(client, 64 * 1024);
+	spa_assert_se(fd >= 0);
+	spa_assert_se(pw_protocol_native_connection_offer_ring(client, 64 * 1024) == -EBUSY);
+
+	/* a message before the ring still goes over the socket */
+	write_message(server, 1);
+	spa_assert_se(pw_protocol_native_connection_use_ring(server,
+				fcntl(fd, F_DUPFD_CLOEXEC, 0), 64 * 1024) == 0);
+	write_message(server, 2);
+	spa_assert_se(pw_protocol_native_connection_flush(server) == 0);
+
+	/* the client starts its ring when it sees the start of the server ring */
+	spa_assert_se(read_message(client, NULL) == 0);
+	spa_assert_se(read_message(client, &msg) == 0);
+	spa_assert_se(msg->n_fds == 1);
+	spa_assert_se(read_message(client, NULL) == -1);
+	spa_assert_se(pw_protocol_native_connection_flush(client) == 0);
+	spa_assert_se(pw_protocol_native_connection_get_next(server, &msg) == -EAGAIN);
+
+	write_message(client, 1);
+	write_message(client, 2);
+	spa_assert_se(pw_protocol_native_connection_flush(client) == 0);
+	spa_assert_se(read_message(server, &msg) == 0);
+	spa_assert_se(msg->n_fds == 1);
+	spa_assert_se(read_message(server, NULL) == 0);
+	spa_assert_se(read_message(server, NULL) == -1);
+
+	/* messages that don't fit in the ring */
+	test_large(server, client);
+	test_large(client, server);
+	test_many_fds(server, client);
+
+	pw_protocol_native_connection_destroy(client);
+	pw_protocol_native_connection_destroy(server);
+	close(fds[0]);
+	close(fds[1]);
+}
+
 int main(int argc, char *argv[])
 {
 	struct pw_main_loop *loop;
@@ -195,6 +345,8 @@ int main(int argc, char *argv[])
 	test_create(out);
 	test_read_write(in, out);
 	test_reentering(in, out);
+	test_large(in, out);
+	test_ring(context);
 
 	pw_protocol_native_connection_destroy(in);
 	pw_protocol_native_connection_destroy(out);
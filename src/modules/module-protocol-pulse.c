@@ -65,6 +65,7 @@
  *     ]
  *     #server.dbus-name       = "org.pulseaudio.Server"
  *     #pulse.allow-module-loading = true
+ *     #pulse.allow-shm        = true
  *     #pulse.min.req          = 128/48000     # 2.7ms
  *     #pulse.default.req      = 960/48000     # 20 milliseconds
  *     #pulse.min.frag         = 128/48000     # 2.7ms
@@ -135,6 +136,14 @@
  * By default, clients are allowed to load and unload modules. You can disable this
  * feature with this option.
  *
+ *\code{.unparsed}
+ *     pulse.allow-shm = true
+ *\endcode
+ *
+ * Local clients of the same user can pass playback data in shared memory (memfd
+ * or POSIX shm pools) instead of sending it over the socket. You can disable this
+ * with this option.
+ *
  * ### Playback buffering options
  *
  *\code{.unparsed}
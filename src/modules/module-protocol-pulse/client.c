@@ -5,8 +5,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include <spa/utils/defs.h>
 #include <spa/utils/hook.h>
@@ -27,10 +29,15 @@
 #include "operation.h"
 #include "pending-sample.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 
 PW_LOG_TOPIC_EXTERN(pulse_conn);
 
+/* subscription events are collected for this long before they are sent so
+ * that bursts of changes to the same object result in one event */
+#define SUBSCRIBE_EVENT_BATCH_NSEC	(20 * SPA_NSEC_PER_MSEC)
+
 #define client_emit_disconnect(c) spa_hook_list_call(&(c)->listener_list, struct client_events, disconnect, 0)
 #define client_emit_routes_changed(c) spa_hook_list_call(&(c)->listener_list, struct client_events, routes_changed, 0)
 
@@ -44,11 +51,15 @@ struct client *client_new(struct server *server)
 	client->server = server;
 	client->impl = server->impl;
 	client->connect_tag = SPA_ID_INVALID;
+	client->in_fd = -1;
 
 	pw_map_init(&client->streams, 16, 16);
 	spa_list_init(&client->out_messages);
+	spa_list_init(&client->pending_events);
 	spa_list_init(&client->operations);
 	spa_list_init(&client->pending_samples);
+	spa_list_init(&client->idle_samples);
+	spa_list_init(&client->shm_pools);
 	spa_hook_list_init(&client->listener_list);
 
 	spa_list_append(&server->clients, &client->link);
@@ -116,12 +127,31 @@ void client_disconnect(struct client *client)
 		client->source = NULL;
 	}
 
+	if (client->event_timer) {
+		pw_loop_destroy_source(impl->loop, client->event_timer);
+		client->event_timer = NULL;
+	}
+
 	if (client->manager) {
 		pw_manager_destroy(client->manager);
 		client->manager = NULL;
 	}
 }
 
+/* The stream of a memblock that is received directly in the ringbuffer is
+ * going away, receive the rest of the memblock in a message that will be
+ * dropped. */
+void client_memblock_cancel(struct client *client, struct stream *stream)
+{
+	if (client->in_stream != stream)
+		return;
+
+	client->in_stream = NULL;
+	if (!client->disconnect)
+		client->message = message_alloc(client->impl, ntohl(client->desc.channel),
+				ntohl(client->desc.length));
+}
+
 void client_free(struct client *client)
 {
 	struct impl *impl = client->impl;
@@ -139,10 +169,18 @@ void client_free(struct client *client)
 
 	spa_list_consume(p, &client->pending_samples, link)
 		pending_sample_free(p);
+	spa_list_consume(p, &client->idle_samples, link)
+		pending_sample_free(p);
 
 	if (client->message)
 		message_free(client->message, false, false);
 
+	if (client->in_fd >= 0)
+		close(client->in_fd);
+	shm_pools_free(client);
+
+	spa_list_consume(msg, &client->pending_events, link)
+		message_free(msg, true, false);
 	spa_list_consume(msg, &client->out_messages, link)
 		message_free(msg, true, false);
 
@@ -193,7 +231,7 @@ int client_queue_message(struct client *client, struct message *msg)
 		goto error;
 	}
 
-	if (msg->length == 0) {
+	if (msg->length == 0 && msg->flags == 0) {
 		res = 0;
 		goto error;
 	} else if (msg->length > msg->allocated) {
@@ -219,6 +257,54 @@ error:
 	return res;
 }
 
+/* send data with our credentials, clients check them before they enable
+ * shared memory */
+static int send_creds(struct client *client, const void *data, size_t size)
+{
+#ifdef SCM_CREDENTIALS
+	struct ucred *ucred;
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	union {
+		struct cmsghdr align;
+		uint8_t buf[CMSG_SPACE(sizeof(struct ucred))];
+	} ctrl;
+
+	spa_zero(ctrl);
+	iov.iov_base = (void*)data;
+	iov.iov_len = size;
+
+	spa_zero(msg);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctrl.buf;
+	msg.msg_controllen = sizeof(ctrl.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_CREDENTIALS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(struct ucred));
+
+	ucred = (struct ucred *)CMSG_DATA(cmsg);
+	ucred->pid = getpid();
+	ucred->uid = getuid();
+	ucred->gid = getgid();
+
+	while (true) {
+		ssize_t sent = sendmsg(client->source->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (sent < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		return sent;
+	}
+#else
+	return -ENOTSUP;
+#endif
+}
+
 static int client_try_flush_messages(struct client *client)
 {
 	pw_log_trace("client %p: flushing", client);
@@ -236,10 +322,18 @@ static int client_try_flush_messages(struct client *client)
 			desc.channel = htonl(m->channel);
 			desc.offset_hi = 0;
 			desc.offset_lo = 0;
-			desc.flags = 0;
+			desc.flags = htonl(m->flags);
 
 			data = SPA_PTROFF(&desc, client->out_index, void);
 			size = sizeof(desc) - client->out_index;
+
+			if (client->out_index == 0 && m->creds) {
+				int res = send_creds(client, data, size);
+				if (res < 0)
+					return res;
+				client->out_index += res;
+				continue;
+			}
 		} else if (client->out_index < m->length + sizeof(desc)) {
 			uint32_t idx = client->out_index - sizeof(desc);
 			data = m->data + idx;
@@ -300,8 +394,19 @@ static bool drop_from_out_queue(struct client *client, struct message *m)
 	return true;
 }
 
-/* returns true if an event with the (mask, event, index) triplet should be dropped because it is redundant */
-static bool client_prune_subscribe_events(struct client *client, uint32_t event, uint32_t index)
+static bool drop_event(struct client *client, struct spa_list *list, struct message *m)
+{
+	if (list == &client->out_messages)
+		return drop_from_out_queue(client, m);
+
+	message_free(m, true, false);
+	return true;
+}
+
+/* returns true if an event with the (mask, event, index) triplet should be dropped because
+ * it is redundant with the events in list */
+static bool client_prune_subscribe_events(struct client *client, struct spa_list *list,
+		uint32_t event, uint32_t index)
 {
 	struct message *m, *t;
 
@@ -309,7 +414,7 @@ static bool client_prune_subscribe_events(struct client *client, uint32_t event,
 		return false;
 
 	/* NOTE: reverse iteration */
-	spa_list_for_each_safe_reverse(m, t, &client->out_messages, link) {
+	spa_list_for_each_safe_reverse(m, t, list, link) {
 		if (m->type != MESSAGE_TYPE_SUBSCRIPTION_EVENT)
 			continue;
 		if ((m->u.subscription_event.event ^ event) & SUBSCRIPTION_EVENT_FACILITY_MASK)
@@ -324,7 +429,7 @@ static bool client_prune_subscribe_events(struct client *client, uint32_t event,
 
 			bool is_new = (m->u.subscription_event.event & SUBSCRIPTION_EVENT_TYPE_MASK) == SUBSCRIPTION_EVENT_NEW;
 
-			if (drop_from_out_queue(client, m)) {
+			if (drop_event(client, list, m)) {
 				pw_log_debug("client %p: dropped redundant event due to remove event for object %u",
 					     client, index);
 
@@ -354,8 +459,27 @@ drop:
 	return true;
 }
 
+static void on_event_timeout(void *data, uint64_t expirations)
+{
+	struct client *client = data;
+	struct message *m;
+
+	spa_list_consume(m, &client->pending_events, link) {
+		spa_list_remove(&m->link);
+
+		if (client_prune_subscribe_events(client, &client->out_messages,
+					m->u.subscription_event.event,
+					m->u.subscription_event.index))
+			message_free(m, false, false);
+		else
+			client_queue_message(client, m);
+	}
+}
+
 int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t event, uint32_t index)
 {
+	struct impl *impl = client->impl;
+
 	if (client->disconnect)
 		return -ENOTCONN;
 
@@ -364,10 +488,15 @@ int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t
 
 	pw_log_debug("client %p: SUBSCRIBE event:%08x index:%u", client, event, index);
 
-	if (client_prune_subscribe_events(client, event, index))
+	if (client_prune_subscribe_events(client, &client->pending_events, event, index))
 		return 0;
 
-	struct message *reply = message_alloc(client->impl, -1, 0);
+	if (client->event_timer == NULL)
+		client->event_timer = pw_loop_add_timer(impl->loop, on_event_timeout, client);
+	if (client->event_timer == NULL)
+		return -errno;
+
+	struct message *reply = message_alloc(impl, -1, 0);
 	if (!reply)
 		return -errno;
 
@@ -382,5 +511,16 @@ int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t
 		TAG_U32, index,
 		TAG_INVALID);
 
-	return client_queue_message(client, reply);
+	/* the first event of a batch starts the timer, later events don't
+	 * delay it further */
+	if (spa_list_is_empty(&client->pending_events)) {
+		struct timespec value = {
+			.tv_sec = SUBSCRIBE_EVENT_BATCH_NSEC / SPA_NSEC_PER_SEC,
+			.tv_nsec = SUBSCRIBE_EVENT_BATCH_NSEC % SPA_NSEC_PER_SEC,
+		}, interval = { 0 };
+		pw_loop_update_timer(impl->loop, client->event_timer, &value, &interval, false);
+	}
+	spa_list_append(&client->pending_events, &reply->link);
+
+	return 0;
 }
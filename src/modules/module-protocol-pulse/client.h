@@ -15,6 +15,7 @@
 struct impl;
 struct server;
 struct message;
+struct stream;
 struct spa_source;
 struct pw_properties;
 struct pw_core;
@@ -66,17 +67,27 @@ struct client {
 	uint32_t out_index;
 	struct descriptor desc;
 	struct message *message;
+	struct stream *in_stream;		/**< memblock received directly in the ringbuffer */
+	uint32_t in_ring_index;
+	int in_fd;				/**< fd received with the last descriptor */
+
+	struct spa_list shm_pools;
 
 	struct pw_map streams;
 	struct spa_list out_messages;
+	struct spa_list pending_events;		/**< subscription events of the current batch */
+	struct spa_source *event_timer;
 
 	struct spa_list operations;
 
 	struct spa_list pending_samples;
+	struct spa_list idle_samples;		/**< finished sample plays kept for reuse */
 
 	unsigned int disconnect:1;
 	unsigned int new_msg_since_last_flush:1;
 	unsigned int authenticated:1;
+	unsigned int shm:1;			/**< memblocks can be passed in shared memory */
+	unsigned int memfd:1;			/**< memfd pools can be registered */
 
 	struct pw_manager_object *prev_default_sink;
 	struct pw_manager_object *prev_default_source;
@@ -99,6 +110,7 @@ void client_disconnect(struct client *client);
 void client_free(struct client *client);
 int client_queue_message(struct client *client, struct message *msg);
 int client_flush_messages(struct client *client);
+void client_memblock_cancel(struct client *client, struct stream *stream);
 int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t event, uint32_t id);
 
 void client_update_routes(struct client *client, const char *key, const char *value);
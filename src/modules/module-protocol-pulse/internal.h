@@ -22,10 +22,12 @@
 struct pw_loop;
 struct pw_context;
 struct pw_work_queue;
+struct pw_mempool;
 struct pw_properties;
 
 struct defs {
 	bool allow_module_loading;
+	bool allow_shm;
 	struct spa_fraction min_req;
 	struct spa_fraction default_req;
 	struct spa_fraction min_frag;
@@ -63,6 +65,7 @@ struct impl {
 	struct spa_list cleanup_clients;
 
 	struct pw_map samples;
+	struct pw_mempool *sample_pool;
 	struct pw_map modules;
 
 	struct spa_list free_messages;
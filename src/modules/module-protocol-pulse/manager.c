@@ -522,6 +522,7 @@ static int metadata_property(void *data,
 {
 	struct object *o = data;
 	struct manager *m = o->manager;
+	m->this.generation++;
 	manager_emit_metadata(m, &o->this, subject, key, type, value);
 	return 0;
 }
@@ -536,6 +537,7 @@ static void metadata_init(struct object *object)
 	struct object *o = object;
 	struct manager *m = o->manager;
 	o->this.creating = false;
+	m->this.generation++;
 	manager_emit_added(m, &o->this);
 }
 
@@ -669,6 +671,7 @@ static void registry_event_global_remove(void *data, uint32_t id)
 
 	if (!o->this.creating) {
 		o->this.change_mask = ~0;
+		m->this.generation++;
 		manager_emit_removed(m, &o->this);
 	}
 	object_destroy(o);
@@ -705,9 +708,11 @@ static void on_core_done(void *data, uint32_t id, int seq)
 		spa_list_for_each(o, &m->this.object_list, this.link) {
 			if (o->this.creating) {
 				o->this.creating = false;
+				m->this.generation++;
 				manager_emit_added(m, &o->this);
 				o->changed = 0;
 			} else if (o->changed > 0) {
+				m->this.generation++;
 				manager_emit_updated(m, &o->this);
 				o->changed = 0;
 			}
@@ -902,6 +907,7 @@ static void object_data_timeout(void *data, uint64_t count)
 		d->timer = NULL;
 	}
 
+	m->this.generation++;
 	manager_emit_object_data_timeout(m, &o->this, d->key);
 }
 
@@ -918,6 +924,7 @@ void *pw_manager_object_add_temporary_data(struct pw_manager_object *obj, const
 		return NULL;
 
 	d = SPA_PTROFF(data, -sizeof(struct object_data), void);
+	o->manager->this.generation++;
 
 	if (d->timer == NULL)
 		d->timer = pw_loop_add_timer(o->manager->loop, object_data_timeout, d);
@@ -51,6 +51,9 @@ struct pw_manager {
 
 	uint32_t n_objects;
 	struct spa_list object_list;
+
+	uint64_t generation;		/**< changes when objects, metadata or temporary
+					  *  object data change */
 };
 
 struct pw_manager_param {
@@ -651,6 +651,21 @@ int message_put(struct message *m, ...)
 	return 0;
 }
 
+int message_append(struct message *m, const void *data, uint32_t size)
+{
+	if (m == NULL)
+		return -EINVAL;
+
+	if (ensure_size(m, size) > 0)
+		memcpy(m->data + m->length, data, size);
+	m->length += size;
+
+	if (m->length > m->allocated)
+		return -ENOMEM;
+
+	return 0;
+}
+
 int message_dump(enum spa_log_level level, const char *prefix, struct message *m)
 {
 	int res;
@@ -848,6 +863,8 @@ struct message *message_alloc(struct impl *impl, uint32_t channel, uint32_t size
 	}
 
 	msg->type = MESSAGE_TYPE_UNSPECIFIED;
+	msg->flags = 0;
+	msg->creds = false;
 	msg->channel = channel;
 	msg->offset = 0;
 	msg->length = size;
@@ -26,6 +26,8 @@ struct message {
 	uint32_t length;
 	uint32_t offset;
 	uint8_t *data;
+	uint32_t flags;			/**< descriptor flags */
+	bool creds;			/**< send credentials with the message */
 
 	enum message_type type;
 	union {
@@ -62,6 +64,7 @@ struct message *message_alloc(struct impl *impl, uint32_t channel, uint32_t size
 void message_free(struct message *msg, bool dequeue, bool destroy);
 int message_get(struct message *m, ...);
 int message_put(struct message *m, ...);
+int message_append(struct message *m, const void *data, uint32_t size);
 int message_dump(enum spa_log_level level, const char *prefix, struct message *m);
 
 #endif /* PULSE_SERVER_MESSAGE_H */
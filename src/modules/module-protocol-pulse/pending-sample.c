@@ -2,8 +2,14 @@
 /* SPDX-FileCopyrightText: Copyright © 2020 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <errno.h>
+#include <time.h>
+
 #include <spa/utils/list.h>
 #include <spa/utils/hook.h>
+#include <spa/utils/string.h>
+#include <pipewire/loop.h>
+#include <pipewire/properties.h>
 #include <pipewire/work-queue.h>
 
 #include "client.h"
@@ -15,14 +21,68 @@
 #include "operation.h"
 #include "pending-sample.h"
 #include "reply.h"
+#include "sample.h"
 #include "sample-play.h"
 
+/* finished plays are kept around for a while so that the stream can be
+ * reused when the client plays the same sample again */
+#define MAX_IDLE_SAMPLES		4
+#define IDLE_SAMPLE_TIMEOUT_SEC		10
+
+static void on_idle_timeout(void *data, uint64_t expirations)
+{
+	struct pending_sample *ps = data;
+
+	pw_log_debug("[%s] idle sample play %s timeout", ps->client->name,
+			ps->play->sample ? ps->play->sample->name : "");
+
+	pending_sample_free(ps);
+}
+
+static int park_pending_sample(struct pending_sample *ps)
+{
+	struct client *client = ps->client;
+	struct impl *impl = client->impl;
+	struct timespec value = { .tv_sec = IDLE_SAMPLE_TIMEOUT_SEC }, interval = { 0 };
+	struct pending_sample *p;
+	uint32_t n_idle = 0;
+	int res;
+
+	if (ps->result < 0 || ps->props == NULL || client->disconnect)
+		return -EINVAL;
+
+	spa_list_for_each(p, &client->idle_samples, link)
+		n_idle++;
+	if (n_idle >= MAX_IDLE_SAMPLES)
+		return -ENOSPC;
+
+	if (ps->idle_timer == NULL)
+		ps->idle_timer = pw_loop_add_timer(impl->loop, on_idle_timeout, ps);
+	if (ps->idle_timer == NULL)
+		return -errno;
+
+	if ((res = sample_play_stop(ps->play)) < 0)
+		return res;
+
+	operation_free_by_tag(client, ps->tag);
+	ps->tag = SPA_ID_INVALID;
+	ps->idle = true;
+
+	spa_list_remove(&ps->link);
+	spa_list_append(&client->idle_samples, &ps->link);
+
+	pw_loop_update_timer(impl->loop, ps->idle_timer, &value, &interval, false);
+
+	return 0;
+}
+
 static void do_pending_sample_finish(void *obj, void *data, int res, uint32_t id)
 {
 	struct pending_sample *ps = obj;
 	struct client *client = ps->client;
 
-	pending_sample_free(ps);
+	if (park_pending_sample(ps) < 0)
+		pending_sample_free(ps);
 	client_unref(client);
 }
 
@@ -62,8 +122,11 @@ static void on_sample_play_ready(void *data, uint32_t id)
 	struct pending_sample *ps = data;
 	struct client *client = ps->client;
 
-	if (!ps->replied)
-		operation_new_cb(client, ps->tag, sample_play_ready_reply, ps);
+	if (ps->idle || ps->ready || ps->replied)
+		return;
+
+	ps->ready = true;
+	operation_new_cb(client, ps->tag, sample_play_ready_reply, ps);
 }
 
 static void on_sample_play_done(void *data, int res)
@@ -71,6 +134,15 @@ static void on_sample_play_done(void *data, int res)
 	struct pending_sample *ps = data;
 	struct client *client = ps->client;
 
+	if (ps->idle) {
+		/* the stream failed while idle, don't reuse it */
+		if (res < 0)
+			ps->result = res;
+		return;
+	}
+
+	ps->result = res;
+
 	if (!ps->replied && res < 0) {
 		reply_error(client, COMMAND_PLAY_SAMPLE, ps->tag, res);
 		ps->replied = true;
@@ -92,6 +164,9 @@ static void on_client_disconnect(void *data)
 {
 	struct pending_sample *ps = data;
 
+	if (ps->idle)
+		return;
+
 	ps->replied = true;
 	operation_free_by_tag(ps->client, ps->tag);
 
@@ -103,16 +178,90 @@ static const struct client_events client_events = {
 	.disconnect = on_client_disconnect,
 };
 
+static bool props_equal(const struct pw_properties *a, const struct pw_properties *b)
+{
+	const struct spa_dict_item *it;
+
+	if (a == NULL || b == NULL || a->dict.n_items != b->dict.n_items)
+		return false;
+
+	spa_dict_for_each(it, &a->dict) {
+		if (!spa_streq(it->value, spa_dict_lookup(&b->dict, it->key)))
+			return false;
+	}
+	return true;
+}
+
+static struct pending_sample *find_idle_sample(struct client *client, struct sample *sample,
+		const struct pw_properties *props)
+{
+	struct pending_sample *ps;
+
+	spa_list_for_each(ps, &client->idle_samples, link) {
+		if (ps->result >= 0 && ps->play->sample == sample &&
+		    props_equal(ps->props, props))
+			return ps;
+	}
+	return NULL;
+}
+
+static int restart_pending_sample(struct pending_sample *ps, uint32_t tag)
+{
+	struct client *client = ps->client;
+	struct timespec value = { 0 }, interval = { 0 };
+	int res;
+
+	if ((res = sample_play_restart(ps->play)) < 0)
+		return res;
+
+	pw_log_debug("[%s] reuse sample play %s tag:%u", client->name,
+			ps->play->sample->name, tag);
+
+	pw_loop_update_timer(client->impl->loop, ps->idle_timer, &value, &interval, false);
+
+	ps->tag = tag;
+	ps->result = 0;
+	ps->ready = false;
+	ps->replied = false;
+	ps->done = false;
+	ps->idle = false;
+
+	spa_list_remove(&ps->link);
+	spa_list_append(&client->pending_samples, &ps->link);
+	client->ref++;
+
+	/* the stream is already connected, reply right away */
+	on_sample_play_ready(ps, ps->play->id);
+
+	return 0;
+}
+
 int pending_sample_new(struct client *client, struct sample *sample, struct pw_properties *props, uint32_t tag)
 {
 	struct pending_sample *ps;
-	struct sample_play *p = sample_play_new(client->core, sample, props, sizeof(*ps));
-	if (!p)
+	struct pw_properties *copy;
+	struct sample_play *p;
+
+	if ((ps = find_idle_sample(client, sample, props)) != NULL) {
+		if (restart_pending_sample(ps, tag) == 0) {
+			pw_properties_free(props);
+			return 0;
+		}
+		pending_sample_free(ps);
+	}
+
+	copy = pw_properties_copy(props);
+
+	p = sample_play_new(client->core, sample, props, sizeof(*ps));
+	if (!p) {
+		pw_properties_free(copy);
 		return -errno;
+	}
 
 	ps = p->user_data;
 	ps->client = client;
 	ps->play = p;
+	ps->props = copy;
 	ps->tag = tag;
 	sample_play_add_listener(p, &ps->listener, &sample_play_events, ps);
 	client_add_listener(client, &ps->client_listener, &client_events, ps);
@@ -132,7 +281,12 @@ void pending_sample_free(struct pending_sample *ps)
 	spa_hook_remove(&ps->client_listener);
 	pw_work_queue_cancel(impl->work_queue, ps, SPA_ID_INVALID);
 
-	operation_free_by_tag(client, ps->tag);
+	if (ps->tag != SPA_ID_INVALID)
+		operation_free_by_tag(client, ps->tag);
+
+	if (ps->idle_timer)
+		pw_loop_destroy_source(impl->loop, ps->idle_timer);
+	pw_properties_free(ps->props);
 
 	sample_play_destroy(ps->play);
 }
@@ -11,6 +11,7 @@
 #include <spa/utils/hook.h>
 
 struct client;
+struct spa_source;
 struct pw_properties;
 struct sample;
 struct sample_play;
@@ -21,9 +22,14 @@ struct pending_sample {
 	struct sample_play *play;
 	struct spa_hook listener;
 	struct spa_hook client_listener;
+	struct pw_properties *props;		/**< requested properties, to match idle plays */
+	struct spa_source *idle_timer;
 	uint32_t tag;
+	int result;
+	unsigned ready:1;
 	unsigned replied:1;
 	unsigned done:1;
+	unsigned idle:1;			/**< finished, can be restarted */
 };
 
 int pending_sample_new(struct client *client, struct sample *sample, struct pw_properties *props, uint32_t tag);
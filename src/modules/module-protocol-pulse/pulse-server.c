@@ -10,6 +10,7 @@
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #include <pipewire/log.h>
 
@@ -52,6 +53,7 @@
 #include "reply.h"
 #include "sample.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 #include "utils.h"
 #include "volume.h"
@@ -66,6 +68,7 @@
 #define DEFAULT_FORMAT		"F32"
 #define DEFAULT_POSITION	"[ FL FR ]"
 #define DEFAULT_IDLE_TIMEOUT	"0"
+#define DEFAULT_ALLOW_SHM	"true"
 
 #define MAX_FORMATS	32
 /* The max amount of data we send in one block when capturing. In PulseAudio this
@@ -110,12 +113,34 @@ void broadcast_subscribe_event(struct impl *impl, uint32_t mask, uint32_t event,
 	}
 }
 
+/* Shared memory is only used with clients of the same user on the unix
+ * socket, the data in the pools of other users could leak otherwise. */
+static bool client_allow_shm(struct client *client, uint32_t version)
+{
+	uid_t uid;
+
+	if (!client->impl->defs.allow_shm ||
+	    (version & PROTOCOL_VERSION_MASK) < 13 ||
+	    !SPA_FLAG_IS_SET(version, SHM_VERSION_FLAG))
+		return false;
+#ifdef SCM_CREDENTIALS
+	if (client->server == NULL || client->server->addr.ss_family != AF_UNIX)
+		return false;
+	if (get_client_uid(client, client->source->fd, &uid) < 0)
+		return false;
+	return uid == getuid();
+#else
+	return false;
+#endif
+}
+
 static int do_command_auth(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	struct message *reply;
 	uint32_t version;
 	const void *cookie;
 	size_t len;
+	bool shm, memfd;
 
 	if (message_get(m,
 			TAG_U32, &version,
@@ -128,22 +153,56 @@ static int do_command_auth(struct client *client, uint32_t command, uint32_t tag
 	if (len != NATIVE_COOKIE_LENGTH)
 		return -EINVAL;
 
+	shm = client_allow_shm(client, version);
+	memfd = shm && (version & PROTOCOL_VERSION_MASK) >= 31 &&
+		SPA_FLAG_IS_SET(version, SHM_VERSION_MEMFD_FLAG);
+
 	if ((version & PROTOCOL_VERSION_MASK) >= 13)
 		version &= PROTOCOL_VERSION_MASK;
 
 	client->version = version;
 	client->authenticated = true;
+	client->shm = shm;
+	client->memfd = memfd;
 
-	pw_log_info("client:%p AUTH tag:%u version:%d", client, tag, version);
+	pw_log_info("client:%p AUTH tag:%u version:%d shm:%d memfd:%d", client, tag,
+			version, shm, memfd);
 
 	reply = reply_new(client, tag);
 	message_put(reply,
-			TAG_U32, PROTOCOL_VERSION,
+			TAG_U32, PROTOCOL_VERSION |
+				(shm ? SHM_VERSION_FLAG : 0) |
+				(memfd ? SHM_VERSION_MEMFD_FLAG : 0),
 			TAG_INVALID);
+	/* the client only enables shm when it can verify our credentials */
+	reply->creds = shm;
 
 	return client_queue_message(client, reply);
 }
 
+static int do_register_memfd_shmid(struct client *client, uint32_t command, uint32_t tag, struct message *m)
+{
+	uint32_t shm_id;
+	int fd = client->in_fd;
+
+	client->in_fd = -1;
+
+	if (message_get(m,
+			TAG_U32, &shm_id,
+			TAG_INVALID) < 0 || fd < 0 || !client->memfd) {
+		if (fd >= 0)
+			close(fd);
+		return -EPROTO;
+	}
+
+	pw_log_info("[%s] REGISTER_MEMFD_SHMID tag:%u id:%u", client->name, tag, shm_id);
+
+	/* there is no reply, a pool that can't be used makes the memblocks
+	 * in it fail later */
+	shm_pool_register_memfd(client, shm_id, fd);
+	return 0;
+}
+
 static int reply_set_client_name(struct client *client, uint32_t tag)
 {
 	struct pw_manager *manager = client->manager;
@@ -2364,6 +2423,13 @@ static int do_finish_upload_stream(struct client *client, uint32_t command, uint
 		if (sample == NULL)
 			goto error_errno;
 
+		sample->impl = impl;
+		if ((res = sample_set_data(sample, stream->buffer,
+						SPA_MIN(stream->attr.maxlength, MAXLENGTH))) < 0) {
+			free(sample);
+			goto error;
+		}
+
 		if (old != NULL) {
 			sample->index = old->index;
 			spa_assert_se(pw_map_insert_at(&impl->samples, sample->index, sample) == 0);
@@ -2372,13 +2438,22 @@ static int do_finish_upload_stream(struct client *client, uint32_t command, uint
 			sample_unref(old);
 		} else {
 			sample->index = pw_map_insert_new(&impl->samples, sample);
-			if (sample->index == SPA_ID_INVALID)
-				goto error_errno;
+			if (sample->index == SPA_ID_INVALID) {
+				res = -errno;
+				pw_memblock_unref(sample->mem);
+				free(sample);
+				goto error;
+			}
 		}
 	} else {
+		uint32_t old_length = old->length;
+
+		if ((res = sample_set_data(old, stream->buffer,
+						SPA_MIN(stream->attr.maxlength, MAXLENGTH))) < 0)
+			goto error;
+
 		pw_properties_free(old->props);
-		free(old->buffer);
-		impl->stat.sample_cache -= old->length;
+		impl->stat.sample_cache -= old_length;
 
 		sample = old;
 	}
@@ -2394,13 +2469,10 @@ static int do_finish_upload_stream(struct client *client, uint32_t command, uint
 	sample->props = stream->props;
 	sample->ss = stream->ss;
 	sample->map = stream->map;
-	sample->buffer = stream->buffer;
-	sample->length = stream->attr.maxlength;
 
 	impl->stat.sample_cache += sample->length;
 
 	stream->props = NULL;
-	stream->buffer = NULL;
 	stream_free(stream);
 
 	broadcast_subscribe_event(impl,
@@ -4382,14 +4454,70 @@ static int do_get_sample_info_list(struct client *client, uint32_t command, uint
 
 struct info_list_data {
 	struct client *client;
+	uint32_t command;
 	struct message *reply;
 	int (*fill_func) (struct client *client, struct message *m, struct pw_manager_object *o);
 };
 
+/* The serialized info of an object, valid as long as the manager generation
+ * did not change. Followed by size bytes of message data. */
+struct info_cache {
+	uint64_t generation;
+	uint64_t quirks;
+	uint32_t command;
+	uint32_t size;
+	int res;
+};
+
+static bool info_cache_valid(struct info_cache *c, struct info_list_data *info)
+{
+	struct client *client = info->client;
+
+	return c != NULL &&
+		c->generation == client->manager->generation &&
+		c->quirks == client->quirks &&
+		c->command == info->command;
+}
+
 static int do_list_info(void *data, struct pw_manager_object *object)
 {
 	struct info_list_data *info = data;
-	info->fill_func(info->client, info->reply, object);
+	struct client *client = info->client;
+	struct message *reply = info->reply;
+	struct temporary_move_data *d;
+	struct info_cache *c;
+	uint32_t start;
+	int res;
+
+	/* the move target is not part of the object, don't cache */
+	d = pw_manager_object_get_data(object, "temporary_move_data");
+	if (d != NULL && d->peer_index != SPA_ID_INVALID) {
+		info->fill_func(client, reply, object);
+		return 0;
+	}
+
+	c = pw_manager_object_get_data(object, "info_cache");
+	if (info_cache_valid(c, info)) {
+		if (c->res >= 0)
+			message_append(reply, SPA_PTROFF(c, sizeof(*c), void), c->size);
+		return 0;
+	}
+
+	start = reply->length;
+	res = info->fill_func(client, reply, object);
+	if (reply->length > reply->allocated)
+		return 0;
+
+	c = pw_manager_object_add_data(object, "info_cache",
+			sizeof(*c) + reply->length - start);
+	if (c != NULL) {
+		c->generation = client->manager->generation;
+		c->quirks = client->quirks;
+		c->command = info->command;
+		c->size = reply->length - start;
+		c->res = res;
+		memcpy(SPA_PTROFF(c, sizeof(*c), void), reply->data + start, c->size);
+	}
 	return 0;
 }
 
@@ -4412,6 +4540,7 @@ static int do_get_info_list(struct client *client, uint32_t command, uint32_t ta
 
 	spa_zero(info);
 	info.client = client;
+	info.command = command;
 
 	switch (command) {
 	case COMMAND_GET_CLIENT_INFO_LIST:
@@ -5319,7 +5448,7 @@ const struct command commands[COMMAND_MAX] =
 
 	/* Supported since protocol v31 (9.0)
 	 * BOTH DIRECTIONS */
-	COMMAND(REGISTER_MEMFD_SHMID, do_error_access),
+	COMMAND(REGISTER_MEMFD_SHMID, do_register_memfd_shmid, COMMAND_ACCESS_WITHOUT_MANAGER),
 
 	/* Supported since protocol v35 (15.0) */
 	COMMAND(SEND_OBJECT_MESSAGE, do_send_object_message),
@@ -5364,6 +5493,11 @@ static void impl_clear(struct impl *impl)
 	pw_map_for_each(&impl->samples, impl_free_sample, impl);
 	pw_map_clear(&impl->samples);
 
+	if (impl->sample_pool) {
+		pw_mempool_destroy(impl->sample_pool);
+		impl->sample_pool = NULL;
+	}
+
 	spa_hook_list_clean(&impl->hooks);
 
 #ifdef HAVE_DBUS
@@ -5481,6 +5615,7 @@ static void load_defaults(struct defs *def, struct pw_properties *props)
 	parse_format(props, "pulse.default.format", DEFAULT_FORMAT, &def->sample_spec);
 	parse_position(props, "pulse.default.position", DEFAULT_POSITION, &def->channel_map);
 	parse_uint32(props, "pulse.idle.timeout", DEFAULT_IDLE_TIMEOUT, &def->idle_timeout);
+	parse_bool(props, "pulse.allow-shm", DEFAULT_ALLOW_SHM, &def->allow_shm);
 	def->sample_spec.channels = def->channel_map.channels;
 	def->quantum_limit = 8192;
 }
@@ -5510,6 +5645,9 @@ struct pw_protocol_pulse *pw_protocol_pulse_new(struct pw_context *context,
 
 	impl->loop = pw_context_get_main_loop(context);
 	impl->work_queue = pw_context_get_work_queue(context);
+	impl->sample_pool = pw_mempool_new(NULL);
+	if (impl->sample_pool == NULL)
+		goto error_free;
 
 	if (props == NULL)
 		props = pw_properties_new(NULL, NULL);
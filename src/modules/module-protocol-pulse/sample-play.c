@@ -184,6 +184,25 @@ void sample_play_destroy(struct sample_play *p)
 	free(p);
 }
 
+/* deactivate the stream so that it can be restarted later */
+int sample_play_stop(struct sample_play *p)
+{
+	if (p->stream == NULL)
+		return -EIO;
+
+	return pw_stream_set_active(p->stream, false);
+}
+
+/* play the sample again from the start on the existing stream */
+int sample_play_restart(struct sample_play *p)
+{
+	if (p->stream == NULL || p->sample == NULL)
+		return -EIO;
+
+	p->offset = 0;
+	return pw_stream_set_active(p->stream, true);
+}
+
 void sample_play_add_listener(struct sample_play *p, struct spa_hook *listener,
 			      const struct sample_play_events *events, void *data)
 {
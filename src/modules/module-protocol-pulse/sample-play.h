@@ -50,6 +50,9 @@ struct sample_play *sample_play_new(struct pw_core *core,
 
 void sample_play_destroy(struct sample_play *p);
 
+int sample_play_stop(struct sample_play *p);
+int sample_play_restart(struct sample_play *p);
+
 void sample_play_add_listener(struct sample_play *p, struct spa_hook *listener,
 			      const struct sample_play_events *events, void *data);
 
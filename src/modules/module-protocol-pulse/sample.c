@@ -2,16 +2,54 @@
 /* SPDX-FileCopyrightText: Copyright © 2020 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <spa/buffer/buffer.h>
 #include <pipewire/log.h>
 #include <pipewire/map.h>
+#include <pipewire/mem.h>
 #include <pipewire/properties.h>
 
 #include "internal.h"
 #include "log.h"
 #include "sample.h"
 
+static void sample_clear_data(struct sample *sample)
+{
+	if (sample->mem)
+		pw_memblock_unref(sample->mem);
+	sample->mem = NULL;
+	sample->buffer = NULL;
+	sample->length = 0;
+}
+
+/* Keep the data in a sealed memfd of exactly the sample size, the
+ * playback streams reference it for as long as they play. */
+int sample_set_data(struct sample *sample, const void *data, uint32_t length)
+{
+	struct impl * const impl = sample->impl;
+	struct pw_memblock *mem;
+
+	mem = pw_mempool_alloc(impl->sample_pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, length);
+	if (mem == NULL)
+		return -errno;
+
+	memcpy(mem->map->ptr, data, length);
+
+	sample_clear_data(sample);
+	sample->mem = mem;
+	sample->buffer = mem->map->ptr;
+	sample->length = length;
+
+	return 0;
+}
+
 void sample_free(struct sample *sample)
 {
 	struct impl * const impl = sample->impl;
@@ -25,6 +63,6 @@ void sample_free(struct sample *sample)
 
 	pw_properties_free(sample->props);
 
-	free(sample->buffer);
+	sample_clear_data(sample);
 	free(sample);
 }
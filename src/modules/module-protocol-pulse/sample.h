@@ -11,6 +11,7 @@
 
 struct impl;
 struct pw_properties;
+struct pw_memblock;
 
 struct sample {
 	int ref;
@@ -21,9 +22,11 @@ struct sample {
 	struct channel_map map;
 	struct pw_properties *props;
 	uint32_t length;
-	uint8_t *buffer;
+	struct pw_memblock *mem;	/**< sealed memfd with the sample data */
+	uint8_t *buffer;		/**< mapped sample data */
 };
 
+int sample_set_data(struct sample *sample, const void *data, uint32_t length);
 void sample_free(struct sample *sample);
 
 static inline struct sample *sample_ref(struct sample *sample)
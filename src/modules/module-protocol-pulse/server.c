@@ -39,6 +39,7 @@
 #include "message.h"
 #include "reply.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 #include "utils.h"
 #include "flatpak-utils.h"
@@ -48,6 +49,12 @@
 
 #define LISTEN_BACKLOG 32
 #define MAX_CLIENTS 64
+#define MAX_FDS 2
+/* reads done for one client before the other clients get a turn */
+#define MAX_CLIENT_READS 128
+
+/* block id, pool id, offset and size */
+#define SHM_INFO_SIZE	(4 * sizeof(uint32_t))
 
 PW_LOG_TOPIC_EXTERN(pulse_conn);
 
@@ -103,33 +110,23 @@ finish:
 	return 0;
 }
 
-static int handle_memblock(struct client *client, struct message *msg)
+/* apply the seek of the memblock in client->desc and return the ringbuffer
+ * index where the data of length bytes should be written */
+static int memblock_seek(struct client *client, struct stream *stream,
+		uint32_t length, uint32_t *ring_index)
 {
-	struct stream *stream;
-	uint32_t channel, flags, index;
+	uint32_t flags, index;
 	int64_t offset, diff;
 	int32_t filled;
-	int res = 0;
 
-	channel = ntohl(client->desc.channel);
 	offset = (int64_t) (
 		(((uint64_t) ntohl(client->desc.offset_hi)) << 32) |
 		(((uint64_t) ntohl(client->desc.offset_lo))));
 	flags = ntohl(client->desc.flags);
 
-	pw_log_debug("client %p: received memblock channel:%d offset:%" PRIi64 " flags:%08x size:%u",
-		     client, channel, offset, flags, msg->length);
-
-	stream = pw_map_lookup(&client->streams, channel);
-	if (stream == NULL || stream->type == STREAM_TYPE_RECORD) {
-		pw_log_info("client %p [%s]: received memblock for unknown channel %d",
-			    client, client->name, channel);
-		goto finish;
-	}
-
 	filled = spa_ringbuffer_get_write_index(&stream->ring, &index);
-	pw_log_debug("new block %p %p/%u filled:%d index:%d flags:%02x offset:%" PRIu64,
-		     msg, msg->data, msg->length, filled, index, flags, offset);
+	pw_log_debug("new block %u filled:%d index:%d flags:%02x offset:%" PRIu64,
+		     length, filled, index, flags, offset);
 
 	switch (flags & FLAG_SEEKMASK) {
 	case SEEK_RELATIVE:
@@ -145,8 +142,7 @@ static int handle_memblock(struct client *client, struct message *msg)
 	default:
 		pw_log_warn("client %p [%s]: received memblock frame with invalid seek mode: %" PRIu32,
 			    client, client->name, (uint32_t)(flags & FLAG_SEEKMASK));
-		res = -EPROTO;
-		goto finish;
+		return -EPROTO;
 	}
 
 	index += diff;
@@ -157,34 +153,178 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	if (filled < 0) {
 		/* underrun, reported on reader side */
-	} else if (filled + msg->length > stream->attr.maxlength) {
+	} else if (filled + length > stream->attr.maxlength) {
 		/* overrun */
 		stream_send_overflow(stream);
 	}
+	*ring_index = index;
+	return 0;
+}
+
+/* length bytes were written at index in the ringbuffer */
+static void memblock_complete(struct stream *stream, uint32_t index, uint32_t length)
+{
+	index += length;
+	spa_ringbuffer_write_update(&stream->ring, index);
+
+	stream->write_index += length;
+	stream->requested -= length;
+
+	stream_send_request(stream);
+
+	if (stream->is_paused && !stream->corked)
+		stream_set_paused(stream, false, "new data");
+}
+
+static struct stream *memblock_stream(struct client *client, uint32_t channel)
+{
+	struct stream *stream = pw_map_lookup(&client->streams, channel);
+	if (stream == NULL || stream->type == STREAM_TYPE_RECORD)
+		return NULL;
+	return stream;
+}
+
+static int memblock_write(struct client *client, const void *data, uint32_t length)
+{
+	struct stream *stream;
+	uint32_t channel, index;
+	int res;
+
+	channel = ntohl(client->desc.channel);
+
+	pw_log_debug("client %p: received memblock channel:%d flags:%08x size:%u",
+		     client, channel, ntohl(client->desc.flags), length);
+
+	stream = memblock_stream(client, channel);
+	if (stream == NULL) {
+		pw_log_info("client %p [%s]: received memblock for unknown channel %d",
+			    client, client->name, channel);
+		return 0;
+	}
+
+	if ((res = memblock_seek(client, stream, length, &index)) < 0)
+		return res;
 
 	/* always write data to ringbuffer, we expect the other side
 	 * to recover */
 	spa_ringbuffer_write_data(&stream->ring,
 			stream->buffer, MAXLENGTH,
 			index % MAXLENGTH,
-			msg->data,
-			SPA_MIN(msg->length, MAXLENGTH));
-	index += msg->length;
-	spa_ringbuffer_write_update(&stream->ring, index);
+			data,
+			SPA_MIN(length, MAXLENGTH));
 
-	stream->write_index += msg->length;
-	stream->requested -= msg->length;
+	memblock_complete(stream, index, length);
+	return 0;
+}
 
-	stream_send_request(stream);
+static int handle_memblock(struct client *client, struct message *msg)
+{
+	int res = memblock_write(client, msg->data, msg->length);
+	message_free(msg, false, false);
+	return res;
+}
 
-	if (stream->is_paused && !stream->corked)
-		stream_set_paused(stream, false, "new data");
+/* the memblock is a reference to a block in one of the client pools, copy
+ * the data and tell the client it can reuse the block */
+static int handle_memblock_shm(struct client *client, struct message *msg)
+{
+	uint32_t info[SHM_INFO_SIZE / sizeof(uint32_t)];
+	uint32_t block_id, shm_id, offset, length;
+	const void *data;
+	struct message *reply;
+	int res = 0;
 
-finish:
+	memcpy(info, msg->data, sizeof(info));
+	block_id = ntohl(info[0]);
+	shm_id = ntohl(info[1]);
+	offset = ntohl(info[2]);
+	length = ntohl(info[3]);
+
+	data = shm_pool_get_data(client, shm_id,
+			SPA_FLAG_IS_SET(msg->flags, FLAG_SHMDATA_MEMFD_BLOCK),
+			offset, length);
+	if (data == NULL) {
+		pw_log_warn("client %p [%s]: invalid shm memblock block:%u pool:%u offset:%u size:%u",
+				client, client->name, block_id, shm_id, offset, length);
+	} else {
+		res = memblock_write(client, data, length);
+	}
 	message_free(msg, false, false);
+
+	if ((reply = message_alloc(client->impl, block_id, 0)) != NULL) {
+		reply->flags = FLAG_SHMRELEASE;
+		client_queue_message(client, reply);
+	}
 	return res;
 }
 
+/* receive data and the fds that are passed with it, the first fd is
+ * kept for the command in the frame */
+static ssize_t recv_fds(struct client *client, void *data, size_t size)
+{
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	union {
+		struct cmsghdr align;
+		uint8_t buf[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+	} ctrl;
+	ssize_t r;
+
+	iov.iov_base = data;
+	iov.iov_len = size;
+
+	spa_zero(msg);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctrl.buf;
+	msg.msg_controllen = sizeof(ctrl.buf);
+
+	if ((r = recvmsg(client->source->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC)) < 0)
+		return r;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		uint32_t i, n_fds;
+
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < n_fds; i++) {
+			int fd;
+			memcpy(&fd, SPA_PTROFF(CMSG_DATA(cmsg), i * sizeof(int), void), sizeof(int));
+			if (client->in_fd < 0) {
+				client->in_fd = fd;
+			} else {
+				pw_log_warn("client %p: dropping extra fd %d", client, fd);
+				close(fd);
+			}
+		}
+	}
+	return r;
+}
+
+/* Memblocks for a stream that don't depend on the read position are
+ * received directly in the ringbuffer of the stream instead of in a
+ * message that is copied later. */
+static bool memblock_direct(struct client *client, uint32_t channel, uint32_t length)
+{
+	struct stream *stream;
+	uint32_t flags = ntohl(client->desc.flags) & FLAG_SEEKMASK;
+
+	if (flags != SEEK_RELATIVE && flags != SEEK_ABSOLUTE)
+		return false;
+	if (length > MAXLENGTH || (stream = memblock_stream(client, channel)) == NULL)
+		return false;
+	if (memblock_seek(client, stream, length, &client->in_ring_index) < 0)
+		return false;
+
+	pw_log_trace("client %p: memblock channel:%d size:%u to ringbuffer index:%u",
+			client, channel, length, client->in_ring_index);
+	client->in_stream = stream;
+	return true;
+}
+
 static int do_read(struct client *client)
 {
 	struct impl * const impl = client->impl;
@@ -198,17 +338,35 @@ static int do_read(struct client *client)
 	} else {
 		uint32_t idx = client->in_index - sizeof(client->desc);
 
-		if (client->message == NULL || client->message->length < idx) {
-			res = -EPROTO;
-			goto exit;
-		}
+		if (client->in_stream != NULL) {
+			struct stream *stream = client->in_stream;
+			uint32_t length = ntohl(client->desc.length), offs;
+
+			if (length < idx) {
+				res = -EPROTO;
+				goto exit;
+			}
+			offs = (client->in_ring_index + idx) % MAXLENGTH;
+			data = SPA_PTROFF(stream->buffer, offs, void);
+			size = SPA_MIN(length - idx, MAXLENGTH - offs);
+		} else {
+			if (client->message == NULL || client->message->length < idx) {
+				res = -EPROTO;
+				goto exit;
+			}
 
-		data = SPA_PTROFF(client->message->data, idx, void);
-		size = client->message->length - idx;
+			data = SPA_PTROFF(client->message->data, idx, void);
+			size = client->message->length - idx;
+		}
 	}
 
 	while (true) {
-		ssize_t r = recv(client->source->fd, data, size, MSG_DONTWAIT);
+		ssize_t r;
+
+		if (client->memfd && client->in_index < sizeof(client->desc))
+			r = recv_fds(client, data, size);
+		else
+			r = recv(client->source->fd, data, size, MSG_DONTWAIT);
 
 		if (r == 0 && size != 0) {
 			res = -EPIPE;
@@ -231,12 +389,28 @@ static int do_read(struct client *client)
 		uint32_t flags, length, channel;
 
 		flags = ntohl(client->desc.flags);
+		length = ntohl(client->desc.length);
+
 		if ((flags & FLAG_SHMMASK) != 0) {
-			res = -EPROTO;
-			goto exit;
+			if (!client->shm) {
+				res = -EPROTO;
+				goto exit;
+			}
+			if ((flags & FLAG_SHMREVOKE) == FLAG_SHMREVOKE ||
+			    (flags & FLAG_SHMREVOKE) == FLAG_SHMRELEASE) {
+				/* we never pass blocks to the client, there is
+				 * nothing to release or revoke */
+				client->in_index = 0;
+				goto exit;
+			}
+			if ((flags & FLAG_SHMDATA) == 0 || length != SHM_INFO_SIZE) {
+				pw_log_warn("client %p: received invalid shm frame flags:%08x size:%u",
+					    client, flags, length);
+				res = -EPROTO;
+				goto exit;
+			}
 		}
 
-		length = ntohl(client->desc.length);
 		if (length > FRAME_SIZE_MAX_ALLOW || length <= 0) {
 			pw_log_warn("client %p: received invalid frame size: %u",
 				    client, length);
@@ -256,8 +430,22 @@ static int do_read(struct client *client)
 
 		if (client->message)
 			message_free(client->message, false, false);
+		client->message = NULL;
+
+		if (channel == (uint32_t)-1 || (flags & FLAG_SHMDATA) ||
+		    !memblock_direct(client, channel, length)) {
+			client->message = message_alloc(impl, channel, length);
+			if (client->message)
+				client->message->flags = flags & FLAG_SHMMASK;
+		}
+	} else if (client->in_stream &&
+	    client->in_index >= ntohl(client->desc.length) + sizeof(client->desc)) {
+		struct stream * const stream = client->in_stream;
 
-		client->message = message_alloc(impl, channel, length);
+		client->in_stream = NULL;
+		client->in_index = 0;
+
+		memblock_complete(stream, client->in_ring_index, ntohl(client->desc.length));
 	} else if (client->message &&
 	    client->in_index >= client->message->length + sizeof(client->desc)) {
 		struct message * const msg = client->message;
@@ -265,8 +453,15 @@ static int do_read(struct client *client)
 		client->message = NULL;
 		client->in_index = 0;
 
-		if (msg->channel == (uint32_t)-1)
+		if (msg->channel == (uint32_t)-1) {
 			res = handle_packet(client, msg);
+			/* fds are only valid for the packet they came with */
+			if (client->in_fd >= 0) {
+				close(client->in_fd);
+				client->in_fd = -1;
+			}
+		} else if (msg->flags & FLAG_SHMDATA)
+			res = handle_memblock_shm(client, msg);
 		else
 			res = handle_memblock(client, msg);
 	}
@@ -279,6 +474,7 @@ static void
 on_client_data(void *data, int fd, uint32_t mask)
 {
 	struct client * const client = data;
+	uint32_t n_reads;
 	int res;
 
 	client->ref++;
@@ -295,7 +491,9 @@ on_client_data(void *data, int fd, uint32_t mask)
 
 	if (mask & SPA_IO_IN) {
 		pw_log_trace("client %p: can read", client);
-		while (true) {
+		/* don't let a flooding client starve the others, the socket
+		 * stays readable and we get called again for the rest */
+		for (n_reads = 0; n_reads < MAX_CLIENT_READS; n_reads++) {
 			res = do_read(client);
 			if (res < 0) {
 				if (res != -EAGAIN && res != -EWOULDBLOCK)
@@ -0,0 +1,135 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/list.h>
+#include <pipewire/log.h>
+
+#include "client.h"
+#include "log.h"
+#include "shm.h"
+
+#define MAX_POOLS	32
+
+static struct shm_pool *pool_find(struct client *client, uint32_t id, bool memfd)
+{
+	struct shm_pool *p;
+	spa_list_for_each(p, &client->shm_pools, link) {
+		if (p->id == id && p->memfd == memfd)
+			return p;
+	}
+	return NULL;
+}
+
+static void pool_free(struct shm_pool *p)
+{
+	spa_list_remove(&p->link);
+	munmap(p->data, p->size);
+	free(p);
+}
+
+static struct shm_pool *pool_attach(struct client *client, uint32_t id, bool memfd, int fd)
+{
+	struct shm_pool *p, *old;
+	struct stat st;
+	void *data;
+	uint32_t n_pools = 0;
+
+	spa_list_for_each(p, &client->shm_pools, link)
+		n_pools++;
+	if (n_pools >= MAX_POOLS) {
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0)
+		return NULL;
+	if (st.st_size <= 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	if ((p = calloc(1, sizeof(*p))) == NULL) {
+		munmap(data, st.st_size);
+		return NULL;
+	}
+	p->id = id;
+	p->memfd = memfd;
+	p->data = data;
+	p->size = st.st_size;
+
+	if ((old = pool_find(client, id, memfd)) != NULL)
+		pool_free(old);
+	spa_list_append(&client->shm_pools, &p->link);
+
+	pw_log_info("client %p: attached %s pool id:%u size:%zu", client,
+			memfd ? "memfd" : "shm", id, p->size);
+	return p;
+}
+
+/* takes ownership of fd */
+int shm_pool_register_memfd(struct client *client, uint32_t id, int fd)
+{
+	struct shm_pool *p;
+	int res = 0;
+
+	if ((p = pool_attach(client, id, true, fd)) == NULL) {
+		res = -errno;
+		pw_log_warn("client %p: can't attach memfd pool id:%u: %m", client, id);
+	}
+	close(fd);
+	return res;
+}
+
+/* POSIX shm pools are not registered, they are opened by id on first use */
+static struct shm_pool *pool_open_shm(struct client *client, uint32_t id)
+{
+	struct shm_pool *p;
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), "/dev/shm/pulse-shm-%u", id);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)) < 0) {
+		pw_log_warn("client %p: can't open %s: %m", client, path);
+		return NULL;
+	}
+	if ((p = pool_attach(client, id, false, fd)) == NULL)
+		pw_log_warn("client %p: can't attach %s: %m", client, path);
+	close(fd);
+	return p;
+}
+
+const void *shm_pool_get_data(struct client *client, uint32_t id, bool memfd,
+		uint32_t offset, uint32_t size)
+{
+	struct shm_pool *p;
+
+	if ((p = pool_find(client, id, memfd)) == NULL) {
+		if (memfd || (p = pool_open_shm(client, id)) == NULL)
+			return NULL;
+	}
+	if ((uint64_t)offset + size > p->size)
+		return NULL;
+
+	return SPA_PTROFF(p->data, offset, const void);
+}
+
+void shm_pools_free(struct client *client)
+{
+	struct shm_pool *p;
+	spa_list_consume(p, &client->shm_pools, link)
+		pool_free(p);
+}
@@ -0,0 +1,33 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef PULSE_SERVER_SHM_H
+#define PULSE_SERVER_SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <spa/utils/list.h>
+
+struct client;
+
+#define SHM_VERSION_FLAG	0x80000000u
+#define SHM_VERSION_MEMFD_FLAG	0x40000000u
+
+/* a memory pool of a client, memblocks are passed as a reference to a
+ * block in one of these */
+struct shm_pool {
+	struct spa_list link;
+	uint32_t id;
+	bool memfd;
+	void *data;
+	size_t size;
+};
+
+int shm_pool_register_memfd(struct client *client, uint32_t id, int fd);
+const void *shm_pool_get_data(struct client *client, uint32_t id, bool memfd,
+		uint32_t offset, uint32_t size);
+void shm_pools_free(struct client *client);
+
+#endif /* PULSE_SERVER_SHM_H */
@@ -112,6 +112,8 @@ void stream_free(struct stream *stream)
 	if (stream->killed)
 		stream_send_killed(stream);
 
+	client_memblock_cancel(client, stream);
+
 	if (stream->stream) {
 		spa_hook_remove(&stream->stream_listener);
 		pw_stream_disconnect(stream->stream);
@@ -240,6 +240,7 @@ struct impl {
 	uint8_t aes_key[AES_CHUNK_SIZE]; /* Key for aes-cbc */
 	uint8_t aes_iv[AES_CHUNK_SIZE];  /* Initialization vector for cbc */
 	EVP_CIPHER_CTX *ctx;
+	unsigned int ctx_ready:1;
 
 	uint16_t control_port;
 	int control_fd;
@@ -276,6 +277,9 @@ struct impl {
 	struct spa_io_position *io_position;
 
 	uint32_t filled;
+
+	uint32_t packet_size;
+	uint8_t *send_buffer;	/* RTP_MAX_BATCH packets of packet_size */
 };
 
 static inline void bit_writer(uint8_t **p, int *pos, uint8_t data, int len)
@@ -291,10 +295,30 @@ static inline void bit_writer(uint8_t **p, int *pos, uint8_t data, int len)
 	}
 }
 
+/* write a byte at bit offset 7 */
+static inline uint8_t *bit_writer_byte7(uint8_t *p, uint8_t data)
+{
+	p[0] |= data >> 7;
+	p[1] = data << 1;
+	return p + 1;
+}
+
+static int aes_setup(struct impl *impl)
+{
+	/* do the key schedule once, each packet only resets the IV */
+	if (EVP_EncryptInit_ex(impl->ctx, EVP_aes_128_cbc(), NULL, impl->aes_key, impl->aes_iv) != 1)
+		return -EIO;
+	EVP_CIPHER_CTX_set_padding(impl->ctx, 0);
+	impl->ctx_ready = true;
+	return 0;
+}
+
 static int aes_encrypt(struct impl *impl, uint8_t *data, int len)
 {
 	int i = len & ~0xf, clen = i;
-	EVP_EncryptInit(impl->ctx, EVP_aes_128_cbc(), impl->aes_key, impl->aes_iv);
+	if (!impl->ctx_ready)
+		return 0;
+	EVP_EncryptInit_ex(impl->ctx, NULL, NULL, NULL, impl->aes_iv);
 	EVP_EncryptUpdate(impl->ctx, data, &clen, data, i);
 	return i;
 }
@@ -431,11 +455,13 @@ static int write_codec_pcm(void *dst, void *frames, uint32_t n_frames)
 	bit_writer(&bp, &bpos, (n_frames >> 8)  & 0xff, 8);
 	bit_writer(&bp, &bpos, (n_frames)       & 0xff, 8);
 
+	/* the header is 55 bits, the samples are all at bit offset 7 */
+	spa_assert(bpos == 7);
 	for (i = 0; i < n_frames; i++) {
-		bit_writer(&bp, &bpos, *(d + 1), 8);
-		bit_writer(&bp, &bpos, *(d + 0), 8);
-		bit_writer(&bp, &bpos, *(d + 3), 8);
-		bit_writer(&bp, &bpos, *(d + 2), 8);
+		bp = bit_writer_byte7(bp, d[1]);
+		bp = bit_writer_byte7(bp, d[0]);
+		bp = bit_writer_byte7(bp, d[3]);
+		bp = bit_writer_byte7(bp, d[2]);
 		d += 4;
 	}
 	return bp - b + 1;
@@ -450,18 +476,16 @@ static ssize_t send_packet(int fd, struct msghdr *msg)
 	return n;
 }
 
-static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
+/* encode and encrypt the packet in iov into out, which has room for
+ * packet_size bytes, and make the iovecs to send it in out_vec. Returns
+ * the number of iovecs. */
+static size_t make_packet(struct impl *impl, struct iovec *iov, uint32_t *out,
+		uint32_t *tcp_pkt, struct iovec *out_vec)
 {
-	struct impl *impl = data;
-	const size_t max = 8 + impl->mtu;
-	uint32_t tcp_pkt[1], out[max], len, n_frames, rtptime;
-	struct iovec out_vec[3];
 	struct rtp_header *header;
-	struct msghdr msg;
+	uint32_t len, n_frames, rtptime;
 	uint8_t *dst;
-
-	if (!impl->recording)
-		return;
+	size_t n_vec = 0;
 
 	header = (struct rtp_header*)iov[0].iov_base;
 	if (header->v != 2)
@@ -476,14 +500,6 @@ static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
 
 	n_frames = iov[1].iov_len / impl->stride;
 
-	msg.msg_name = NULL;
-	msg.msg_namelen = 0;
-	msg.msg_iov = out_vec;
-	msg.msg_iovlen = 0;
-	msg.msg_control = NULL;
-	msg.msg_controllen = 0;
-	msg.msg_flags = 0;
-
 	dst = (uint8_t*)&out[0];
 
 	switch (impl->codec) {
@@ -502,17 +518,71 @@ static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
 	if (impl->protocol == PROTO_TCP) {
 		out[0] |= htonl((uint32_t) len + 12);
 		tcp_pkt[0] = htonl(0x24000000);
-  		out_vec[msg.msg_iovlen++] = (struct iovec) { tcp_pkt, 4 };
+		out_vec[n_vec++] = (struct iovec) { tcp_pkt, 4 };
 	}
 
-	out_vec[msg.msg_iovlen++] = (struct iovec) { header, 12 };
-	out_vec[msg.msg_iovlen++] = (struct iovec) { out, len };
+	out_vec[n_vec++] = (struct iovec) { header, 12 };
+	out_vec[n_vec++] = (struct iovec) { out, len };
+
+	return n_vec;
+}
+
+static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
+{
+	struct impl *impl = data;
+	uint32_t tcp_pkt[1];
+	struct iovec out_vec[3];
+	struct msghdr msg;
+
+	if (!impl->recording)
+		return;
+
+	spa_zero(msg);
+	msg.msg_iov = out_vec;
+	msg.msg_iovlen = make_packet(impl, iov, (uint32_t*)impl->send_buffer,
+			tcp_pkt, out_vec);
 
-	pw_log_debug("raop sending %zu", out_vec[0].iov_len + out_vec[1].iov_len + out_vec[2].iov_len);
+	pw_log_debug("raop sending %zu", out_vec[0].iov_len + out_vec[1].iov_len +
+			(msg.msg_iovlen > 2 ? out_vec[2].iov_len : 0));
 
 	send_packet(impl->server_fd, &msg);
 }
 
+static void stream_send_packets(void *data, struct iovec *iov, size_t iovlen, uint32_t n_packets)
+{
+	struct impl *impl = data;
+	uint32_t i, tcp_pkt[RTP_MAX_BATCH];
+	struct iovec out_vec[RTP_MAX_BATCH * 3];
+	struct mmsghdr msgs[RTP_MAX_BATCH];
+	int n;
+
+	if (!impl->recording)
+		return;
+
+	n_packets = SPA_MIN(n_packets, (uint32_t)RTP_MAX_BATCH);
+	for (i = 0; i < n_packets; i++) {
+		uint32_t *out = SPA_PTROFF(impl->send_buffer, i * impl->packet_size, uint32_t);
+		spa_zero(msgs[i]);
+		msgs[i].msg_hdr.msg_iov = &out_vec[i * 3];
+		msgs[i].msg_hdr.msg_iovlen = make_packet(impl, &iov[i * iovlen], out,
+				&tcp_pkt[i], &out_vec[i * 3]);
+	}
+
+	pw_log_debug("raop sending %u packets", n_packets);
+
+	i = 0;
+	while (i < n_packets) {
+		n = sendmmsg(impl->server_fd, &msgs[i], n_packets - i, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pw_log_debug("sendmmsg() failed: %m");
+			break;
+		}
+		i += n;
+	}
+}
+
 static inline void
 set_iovec(struct spa_ringbuffer *rbuf, void *buffer, uint32_t size,
 		uint32_t offset, struct iovec *iov, uint32_t len)
@@ -1275,6 +1345,9 @@ static int rtsp_do_announce(struct impl *impl)
 		    (res = pw_getrandom(impl->aes_iv, sizeof(impl->aes_iv), 0)) < 0)
 			return res;
 
+		if ((res = aes_setup(impl)) < 0)
+			return res;
+
 		base64_encode(rac, sizeof(rac), sac, '\0');
 		pw_properties_set(impl->headers, "Apple-Challenge", sac);
 
@@ -1688,7 +1761,8 @@ static const struct rtp_stream_events stream_events = {
 	.destroy = stream_destroy,
 	.state_changed = stream_state_changed,
 	.param_changed = stream_param_changed,
-	.send_packet = stream_send_packet
+	.send_packet = stream_send_packet,
+	.send_packets = stream_send_packets,
 };
 
 static void core_error(void *data, uint32_t id, int seq, int res, const char *message)
@@ -1731,6 +1805,7 @@ static void impl_destroy(struct impl *impl)
 
 	if (impl->ctx)
 		EVP_CIPHER_CTX_free(impl->ctx);
+	free(impl->send_buffer);
 
 	pw_properties_free(impl->headers);
 	pw_properties_free(impl->stream_props);
@@ -1874,6 +1949,13 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->mtu = impl->stride * impl->psamples;
 	impl->sync_period = impl->rate / impl->psamples;
 
+	impl->packet_size = SPA_ROUND_UP_N(8 + impl->mtu, sizeof(uint32_t));
+	impl->send_buffer = calloc(RTP_MAX_BATCH, impl->packet_size);
+	if (impl->send_buffer == NULL) {
+		res = -errno;
+		goto error;
+	}
+
 	if ((str = pw_properties_get(props, "raop.latency.ms")) == NULL)
 		str = SPA_STRINGIFY(DEFAULT_LATENCY_MS);
 	impl->latency = SPA_MAX(impl->latency, msec_to_samples(impl, atoi(str)));
@@ -45,6 +45,15 @@
  * - `remote.repair.port = <str>`: remote receiver TCP/UDP port for receiver packets
  * - `remote.control.port = <str>`: remote receiver TCP/UDP port for control packets
  * - `fec.code = <str>`: Possible values: `disable`, `rs8m`, `ldpc`
+ * - `fec.source-packets = <int>`: number of source packets in a FEC block
+ * - `fec.repair-packets = <int>`: number of repair packets in a FEC block
+ * - `packet.length.msec = <int>`: the duration of the packets in milliseconds
+ * - `roc.affinity = [ <int> ... ]`: the CPUs for the threads of roc. All roc sinks and
+ *   sources share one roc context and its threads, the first module that is loaded
+ *   sets the affinity.
+ *
+ * When the packet length and the number of source packets are given, the node
+ * latency is set to one FEC block so that each cycle writes a complete block.
  *
  * ## General options
  *
@@ -97,10 +106,14 @@ struct module_roc_sink_data {
 
 	roc_endpoint *remote_source_addr;
 	roc_endpoint *remote_repair_addr;
-	roc_context *context;
+	struct pw_roc_context *context;
 	roc_sender *sender;
+	char *affinity;
 
 	roc_fec_encoding fec_code;
+	uint32_t fec_source_packets;
+	uint32_t fec_repair_packets;
+	uint32_t packet_length_msec;
 	uint32_t rate;
 	char *remote_ip;
 	int remote_source_port;
@@ -217,7 +230,9 @@ static void impl_destroy(struct module_roc_sink_data *data)
 	pw_properties_free(data->capture_props);
 
 	spa_clear_ptr(data->sender, roc_sender_close);
-	spa_clear_ptr(data->context, roc_context_close);
+	if (data->context)
+		pw_roc_context_release(data->module_context, data->context);
+	free(data->affinity);
 
 	spa_clear_ptr(data->remote_source_addr, roc_endpoint_deallocate);
 	spa_clear_ptr(data->remote_repair_addr, roc_endpoint_deallocate);
@@ -241,7 +256,6 @@ static const struct pw_impl_module_events module_events = {
 
 static int roc_sink_setup(struct module_roc_sink_data *data)
 {
-	roc_context_config context_config;
 	roc_sender_config sender_config;
 	struct spa_audio_info_raw info = { 0 };
 	const struct spa_pod *params[1];
@@ -251,12 +265,10 @@ static int roc_sink_setup(struct module_roc_sink_data *data)
 	int res;
 	roc_protocol audio_proto, repair_proto;
 
-	memset(&context_config, 0, sizeof(context_config));
-
-	res = roc_context_open(&context_config, &data->context);
-	if (res) {
-		pw_log_error("failed to create roc context: %d", res);
-		return -EINVAL;
+	data->context = pw_roc_context_acquire(data->module_context, data->affinity);
+	if (data->context == NULL) {
+		pw_log_error("failed to create roc context: %m");
+		return -errno;
 	}
 
 	spa_zero(sender_config);
@@ -266,6 +278,9 @@ static int roc_sink_setup(struct module_roc_sink_data *data)
 	sender_config.frame_encoding.format = ROC_FORMAT_PCM_FLOAT32;
 	sender_config.packet_encoding = ROC_PACKET_ENCODING_AVP_L16_STEREO;
 	sender_config.fec_encoding = data->fec_code;
+	sender_config.fec_block_source_packets = data->fec_source_packets;
+	sender_config.fec_block_repair_packets = data->fec_repair_packets;
+	sender_config.packet_length = data->packet_length_msec * SPA_NSEC_PER_MSEC;
 
 	info.rate = data->rate;
 
@@ -277,7 +292,16 @@ static int roc_sink_setup(struct module_roc_sink_data *data)
 
 	pw_properties_setf(data->capture_props, PW_KEY_NODE_RATE, "1/%d", info.rate);
 
-	res = roc_sender_open(data->context, &sender_config, &data->sender);
+	/* write a complete FEC block each cycle so that roc encodes the
+	 * block at once */
+	if (data->fec_code != ROC_FEC_ENCODING_DISABLE &&
+	    data->packet_length_msec > 0 && data->fec_source_packets > 0 &&
+	    pw_properties_get(data->capture_props, PW_KEY_NODE_LATENCY) == NULL)
+		pw_properties_setf(data->capture_props, PW_KEY_NODE_LATENCY, "%u/%u",
+				data->fec_source_packets * data->packet_length_msec *
+				info.rate / 1000, info.rate);
+
+	res = roc_sender_open(data->context->context, &sender_config, &data->sender);
 	if (res) {
 		pw_log_error("failed to create roc sender: %d", res);
 		return -EINVAL;
@@ -354,6 +378,10 @@ static const struct spa_dict_item module_roc_sink_info[] = {
 	{ PW_KEY_MODULE_DESCRIPTION, "roc sink" },
 	{ PW_KEY_MODULE_USAGE,	"( sink.name=<name for the sink> ) "
 				"( fec.code=<empty>|disable|rs8m|ldpc ) "
+				"( fec.source-packets=<source packets in a FEC block> ) "
+				"( fec.repair-packets=<repair packets in a FEC block> ) "
+				"( packet.length.msec=<packet duration in milliseconds> ) "
+				"( roc.affinity=<array of CPUs for the roc threads> ) "
 				"remote.ip=<remote receiver ip> "
 				"( remote.source.port=<remote receiver port for source packets> ) "
 				"( remote.repair.port=<remote receiver port for repair packets> ) "
@@ -455,6 +483,12 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	} else {
 		data->fec_code = ROC_FEC_ENCODING_DEFAULT;
 	}
+	data->fec_source_packets = pw_properties_get_uint32(props, "fec.source-packets", 0);
+	data->fec_repair_packets = pw_properties_get_uint32(props, "fec.repair-packets", 0);
+	data->packet_length_msec = pw_properties_get_uint32(props, "packet.length.msec", 0);
+
+	if ((str = pw_properties_get(props, "roc.affinity")) != NULL)
+		data->affinity = strdup(str);
 
 
 	data->core = pw_context_get_object(data->module_context, PW_TYPE_INTERFACE_Core);
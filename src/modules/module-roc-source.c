@@ -48,6 +48,9 @@
  * - `resampler.profile = <str>`: Possible values: `disable`, `high`,
  *   `medium`, `low`.
  * - `fec.code = <str>`: Possible values: `disable`, `rs8m`, `ldpc`
+ * - `roc.affinity = [ <int> ... ]`: the CPUs for the threads of roc. All roc sinks and
+ *   sources share one roc context and its threads, the first module that is loaded
+ *   sets the affinity.
  *
  * ## General options
  *
@@ -103,8 +106,9 @@ struct module_roc_source_data {
 
 	roc_endpoint *local_source_addr;
 	roc_endpoint *local_repair_addr;
-	roc_context *context;
+	struct pw_roc_context *context;
 	roc_receiver *receiver;
+	char *affinity;
 
 	roc_resampler_profile resampler_profile;
 	roc_fec_encoding fec_code;
@@ -226,7 +230,9 @@ static void impl_destroy(struct module_roc_source_data *data)
 	pw_properties_free(data->playback_props);
 
 	spa_clear_ptr(data->receiver, roc_receiver_close);
-	spa_clear_ptr(data->context, roc_context_close);
+	if (data->context)
+		pw_roc_context_release(data->module_context, data->context);
+	free(data->affinity);
 
 	spa_clear_ptr(data->local_source_addr, roc_endpoint_deallocate);
 	spa_clear_ptr(data->local_repair_addr, roc_endpoint_deallocate);
@@ -250,7 +256,6 @@ static const struct pw_impl_module_events module_events = {
 
 static int roc_source_setup(struct module_roc_source_data *data)
 {
-	roc_context_config context_config;
 	roc_receiver_config receiver_config;
 	struct spa_audio_info_raw info = { 0 };
 	const struct spa_pod *params[1];
@@ -260,11 +265,10 @@ static int roc_source_setup(struct module_roc_source_data *data)
 	int res;
 	roc_protocol audio_proto, repair_proto;
 
-	spa_zero(context_config);
-	res = roc_context_open(&context_config, &data->context);
-	if (res) {
-		pw_log_error("failed to create roc context: %d", res);
-		return -EINVAL;
+	data->context = pw_roc_context_acquire(data->module_context, data->affinity);
+	if (data->context == NULL) {
+		pw_log_error("failed to create roc context: %m");
+		return -errno;
 	}
 
 	spa_zero(receiver_config);
@@ -298,7 +302,7 @@ static int roc_source_setup(struct module_roc_source_data *data)
 	 */
 	receiver_config.target_latency = (unsigned long long)data->sess_latency_msec * SPA_NSEC_PER_MSEC;
 
-	res = roc_receiver_open(data->context, &receiver_config, &data->receiver);
+	res = roc_receiver_open(data->context->context, &receiver_config, &data->receiver);
 	if (res) {
 		pw_log_error("failed to create roc receiver: %d", res);
 		return -EINVAL;
@@ -377,6 +381,7 @@ static const struct spa_dict_item module_roc_source_info[] = {
 	{ PW_KEY_MODULE_USAGE,	"( source.name=<name for the source> ) "
 				"( resampler.profile=<empty>|disable|high|medium|low ) "
 				"( fec.code=<empty>|disable|rs8m|ldpc ) "
+				"( roc.affinity=<array of CPUs for the roc threads> ) "
 				"( sess.latency.msec=<target network latency in milliseconds> ) "
 				"( local.ip=<local receiver ip> ) "
 				"( local.source.port=<local receiver port for source packets> ) "
@@ -489,6 +494,9 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		data->fec_code = ROC_FEC_ENCODING_DEFAULT;
 	}
 
+	if ((str = pw_properties_get(props, "roc.affinity")) != NULL)
+		data->affinity = strdup(str);
+
 	data->core = pw_context_get_object(data->module_context, PW_TYPE_INTERFACE_Core);
 	if (data->core == NULL) {
 		str = pw_properties_get(props, PW_KEY_REMOTE_NAME);
@@ -1,11 +1,22 @@
 #ifndef MODULE_ROC_COMMON_H
 #define MODULE_ROC_COMMON_H
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
 #include <roc/config.h>
+#include <roc/context.h>
 #include <roc/endpoint.h>
 
+#include <spa/utils/defs.h>
+#include <spa/utils/json.h>
 #include <spa/utils/string.h>
 
+#include <pipewire/context.h>
+
 #define PW_ROC_DEFAULT_IP "0.0.0.0"
 #define PW_ROC_DEFAULT_SOURCE_PORT 10001
 #define PW_ROC_DEFAULT_REPAIR_PORT 10002
@@ -14,6 +25,96 @@
 #define PW_ROC_DEFAULT_RATE 44100
 #define PW_ROC_DEFAULT_CONTROL_PROTO ROC_PROTO_RTCP
 
+#define PW_ROC_CONTEXT_TYPE "PipeWire:Roc:Context"
+
+/* The roc context, with the network thread of roc, is shared by all roc
+ * modules of the PipeWire context. It is stored as an object of the
+ * context, the type string is owned by the object so that it stays valid
+ * when the module that made it is unloaded. */
+struct pw_roc_context {
+	char type[sizeof(PW_ROC_CONTEXT_TYPE)];
+	roc_context *context;
+	int ref;
+};
+
+#ifdef __linux__
+static inline void pw_roc_parse_affinity(const char *affinity, cpu_set_t *set)
+{
+	struct spa_json it[2];
+	int v;
+
+	CPU_ZERO(set);
+	spa_json_init(&it[0], affinity, strlen(affinity));
+	if (spa_json_enter_array(&it[0], &it[1]) <= 0)
+		spa_json_init(&it[1], affinity, strlen(affinity));
+
+	while (spa_json_get_int(&it[1], &v) > 0) {
+		if (v >= 0 && v < CPU_SETSIZE)
+			CPU_SET(v, set);
+	}
+}
+#endif
+
+/* get the shared roc context or make it. roc has no API to place its
+ * threads, they inherit the CPU affinity of the thread that opens the
+ * context so we open it with the affinity set to the given CPUs. */
+static inline struct pw_roc_context *pw_roc_context_acquire(struct pw_context *context,
+		const char *affinity)
+{
+	struct pw_roc_context *rc;
+	roc_context_config config;
+	int res;
+
+	if ((rc = pw_context_get_object(context, PW_ROC_CONTEXT_TYPE)) != NULL) {
+		rc->ref++;
+		return rc;
+	}
+	if ((rc = calloc(1, sizeof(*rc))) == NULL)
+		return NULL;
+	snprintf(rc->type, sizeof(rc->type), "%s", PW_ROC_CONTEXT_TYPE);
+
+	spa_zero(config);
+#ifdef __linux__
+	if (affinity != NULL) {
+		cpu_set_t set, old;
+		bool restore;
+
+		pw_roc_parse_affinity(affinity, &set);
+		restore = pthread_getaffinity_np(pthread_self(), sizeof(old), &old) == 0 &&
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+		res = roc_context_open(&config, &rc->context);
+		if (restore)
+			pthread_setaffinity_np(pthread_self(), sizeof(old), &old);
+	} else
+#endif
+		res = roc_context_open(&config, &rc->context);
+
+	if (res) {
+		free(rc);
+		errno = EINVAL;
+		return NULL;
+	}
+	rc->ref = 1;
+	if (pw_context_set_object(context, rc->type, rc) < 0) {
+		res = errno;
+		roc_context_close(rc->context);
+		free(rc);
+		errno = res;
+		return NULL;
+	}
+	return rc;
+}
+
+/* the senders and receivers need to be closed before the last release */
+static inline void pw_roc_context_release(struct pw_context *context, struct pw_roc_context *rc)
+{
+	if (--rc->ref > 0)
+		return;
+	pw_context_set_object(context, rc->type, NULL);
+	roc_context_close(rc->context);
+	free(rc);
+}
+
 static inline int pw_roc_parse_fec_encoding(roc_fec_encoding *out, const char *str)
 {
 	if (!str || !*str)
@@ -48,6 +48,7 @@
 
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
+#include <spa/utils/json.h>
 
 #include <pipewire/impl.h>
 #include <pipewire/thread.h>
@@ -89,6 +90,11 @@
  * - `rtkit.enabled`: enable the use of rtkit, default true
  * - `uclamp.min`: the minimum utilisation value the scheduler should consider
  * - `uclamp.max`: the maximum utilisation value the scheduler should consider
+ * - `rt.affinity`: the CPUs to pin realtime threads to. This can be an array of
+ *              CPU numbers, `isolated` to use the CPUs that were isolated with the
+ *              `isolcpus` kernel option or `nohz_full` to use the CPUs without
+ *              scheduler ticks. Threads that already have their own affinity, like
+ *              data loops with `thread.affinity`, are not changed. Default unset.
 
  * The nice level is by default set to an invalid value so that clients don't
  * automatically have the nice level raised.
@@ -110,6 +116,7 @@
  *         #rtkit.enabled = true
  *         #uclamp.min = 0
  *         #uclamp.max = 1024
+ *         #rt.affinity = isolated
  *     }
  *     flags = [ ifexists nofail ]
  * }
@@ -151,7 +158,8 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 			"( rtportal.enabled=<default true> ) " \
 			"( rtkit.enabled=<default true> ) " \
 			"( uclamp.min=<default "SPA_STRINGIFY(DEFAULT_UCLAMP_MIN)"> ) " \
-			"( uclamp.max=<default "SPA_STRINGIFY(DEFAULT_UCLAMP_MAX)"> )"
+			"( uclamp.max=<default "SPA_STRINGIFY(DEFAULT_UCLAMP_MAX)"> ) " \
+			"( rt.affinity=<[ cpu ... ] | isolated | nohz_full> )"
 
 static const struct spa_dict_item module_props[] = {
 	{ PW_KEY_MODULE_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
@@ -200,6 +208,10 @@ struct impl {
 	int uclamp_min;
 	int uclamp_max;
 
+	cpu_set_t process_cpus;		/**< affinity of the process */
+	cpu_set_t rt_cpus;		/**< affinity for realtime threads */
+	bool have_rt_cpus;
+
 	struct spa_hook module_listener;
 
 	unsigned rlimits_enabled:1;
@@ -642,6 +654,116 @@ static int set_rlimit(struct rlimit *rlim)
 	return res;
 }
 
+/* parse a kernel cpu list like "1-3,6" */
+static int parse_cpu_list(const char *str, cpu_set_t *set)
+{
+	char *end;
+	long a, b;
+	int n_cpus = 0;
+
+	CPU_ZERO(set);
+	while (*str != '\0' && *str != '\n') {
+		a = b = strtol(str, &end, 10);
+		if (end == str || a < 0)
+			return -EINVAL;
+		if (*end == '-') {
+			str = end + 1;
+			b = strtol(str, &end, 10);
+			if (end == str || b < a)
+				return -EINVAL;
+		}
+		for (; a <= b && a < CPU_SETSIZE; a++, n_cpus++)
+			CPU_SET(a, set);
+		str = *end == ',' ? end + 1 : end;
+	}
+	return n_cpus;
+}
+
+static int read_cpu_list(const char *name, cpu_set_t *set)
+{
+	char path[128], buf[1024];
+	FILE *f;
+	int res;
+
+	spa_scnprintf(path, sizeof(path), "/sys/devices/system/cpu/%s", name);
+	if ((f = fopen(path, "re")) == NULL)
+		return -errno;
+	res = fgets(buf, sizeof(buf), f) ? parse_cpu_list(buf, set) : 0;
+	fclose(f);
+	return res;
+}
+
+static int parse_rt_affinity(const char *str, cpu_set_t *set)
+{
+	struct spa_json it[2];
+	int v, n_cpus = 0;
+
+	if (spa_streq(str, "isolated") || spa_streq(str, "nohz_full"))
+		return read_cpu_list(str, set);
+
+	CPU_ZERO(set);
+	spa_json_init(&it[0], str, strlen(str));
+	if (spa_json_enter_array(&it[0], &it[1]) <= 0)
+		spa_json_init(&it[1], str, strlen(str));
+
+	while (spa_json_get_int(&it[1], &v) > 0) {
+		if (v >= 0 && v < CPU_SETSIZE) {
+			CPU_SET(v, set);
+			n_cpus++;
+		}
+	}
+	return n_cpus;
+}
+
+static void cpu_set_to_string(const cpu_set_t *set, char *str, size_t size)
+{
+	int i, first = -1;
+	size_t len = 0;
+
+	str[0] = '\0';
+	for (i = 0; i <= CPU_SETSIZE; i++) {
+		bool isset = i < CPU_SETSIZE && CPU_ISSET(i, set);
+		if (isset && first < 0)
+			first = i;
+		else if (!isset && first >= 0) {
+			len += spa_scnprintf(str + len, size - len, "%s%d", len ? "," : "", first);
+			if (i - 1 > first)
+				len += spa_scnprintf(str + len, size - len, "-%d", i - 1);
+			first = -1;
+		}
+	}
+}
+
+/* pin a thread that gets realtime priority to the rt.affinity CPUs. Threads
+ * with an affinity that differs from the process affinity were placed
+ * explicitly and are left alone. */
+static void pin_rt_thread(struct impl *impl, struct spa_thread *thread)
+{
+	pthread_t pt = (pthread_t)thread;
+	cpu_set_t set;
+	char cpus[256];
+	int err;
+
+	if (!impl->have_rt_cpus)
+		return;
+
+	if ((err = pthread_getaffinity_np(pt, sizeof(set), &set)) != 0) {
+		pw_log_warn("thread %p: can't get affinity: %s", thread, strerror(err));
+		return;
+	}
+	cpu_set_to_string(&set, cpus, sizeof(cpus));
+	if (!CPU_EQUAL(&set, &impl->process_cpus)) {
+		pw_log_info("thread %p: keep affinity CPUs %s", thread, cpus);
+		return;
+	}
+	if ((err = pthread_setaffinity_np(pt, sizeof(impl->rt_cpus), &impl->rt_cpus)) != 0) {
+		pw_log_warn("thread %p: can't set affinity: %s", thread, strerror(err));
+		return;
+	}
+	cpu_set_to_string(&impl->rt_cpus, cpus, sizeof(cpus));
+	pw_log_info("thread %p: pinned to CPUs %s", thread, cpus);
+}
+
 static int acquire_rt_sched(struct spa_thread *thread, int priority)
 {
 	int err, min, max;
@@ -827,6 +949,8 @@ static int impl_acquire_rt(void *object, struct spa_thread *thread, int priority
 	if (priority == -1) {
 		priority = impl->rt_prio;
 	}
+	pin_rt_thread(impl, thread);
+
 	if (impl->use_rtkit) {
 		struct rt_params params;
 		struct thread *thr;
@@ -890,6 +1014,8 @@ static int impl_acquire_rt(void *object, struct spa_thread *thread, int priority
 	if (priority == -1)
 		priority = impl->rt_prio;
 
+	pin_rt_thread(impl, thread);
+
 	return acquire_rt_sched(thread, priority);
 }
 
@@ -1058,6 +1184,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	struct pw_context *context = pw_impl_module_get_context(module);
 	struct impl *impl;
 	struct pw_properties *props;
+	const char *str;
 	int res = 0;
 
 	PW_LOG_TOPIC_INIT(mod_topic);
@@ -1089,6 +1216,18 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->rl.rlim_max = impl->rt_time_hard;
 	impl->main_pid = _gettid();
 
+	if ((str = pw_properties_get(props, "rt.affinity")) != NULL) {
+		if (sched_getaffinity(0, sizeof(impl->process_cpus), &impl->process_cpus) < 0) {
+			pw_log_warn("can't get process affinity: %m");
+		} else if ((res = parse_rt_affinity(str, &impl->rt_cpus)) <= 0) {
+			pw_log_warn("rt.affinity '%s' has no usable CPUs: %s", str,
+					res < 0 ? spa_strerror(res) : "empty");
+		} else {
+			impl->have_rt_cpus = true;
+		}
+		res = 0;
+	}
+
 	bool can_use_rtkit = false, use_rtkit = false;
 
 	if (!IS_VALID_NICE_LEVEL(impl->nice_level)) {
@@ -116,6 +116,7 @@
  *                     create-stream = {
  *                         #sess.latency.msec = 100
  *                         #sess.ts-direct = false
+ *                         #net.hw-timestamp = false
  *                         #target.object = ""
  *                     }
  *                 }
@@ -292,6 +292,33 @@ static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
 		pw_log_warn("sendmsg() failed: %m");
 }
 
+static void stream_send_packets(void *data, struct iovec *iov, size_t iovlen, uint32_t n_packets)
+{
+	struct impl *impl = data;
+	struct mmsghdr msgs[RTP_MAX_BATCH];
+	uint32_t i;
+	int n;
+
+	n_packets = SPA_MIN(n_packets, (uint32_t)RTP_MAX_BATCH);
+	for (i = 0; i < n_packets; i++) {
+		spa_zero(msgs[i]);
+		msgs[i].msg_hdr.msg_iov = &iov[i * iovlen];
+		msgs[i].msg_hdr.msg_iovlen = iovlen;
+	}
+
+	i = 0;
+	while (i < n_packets) {
+		n = sendmmsg(impl->rtp_fd, &msgs[i], n_packets - i, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pw_log_warn("sendmmsg() failed: %m");
+			break;
+		}
+		i += n;
+	}
+}
+
 static void stream_state_changed(void *data, bool started, const char *error)
 {
 	struct impl *impl = data;
@@ -384,6 +411,7 @@ static const struct rtp_stream_events stream_events = {
 	.state_changed = stream_state_changed,
 	.param_changed = stream_param_changed,
 	.send_packet = stream_send_packet,
+	.send_packets = stream_send_packets,
 };
 
 static void core_destroy(void *d)
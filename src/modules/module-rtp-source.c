@@ -14,6 +14,11 @@
 #include <netinet/in.h>
 #include <net/if.h>
 #include <ctype.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#endif
 
 #include <spa/utils/hook.h>
 #include <spa/utils/result.h>
@@ -58,10 +63,26 @@
  * - `source.port = <int>`: the source port
  * - `node.always-process = <bool>`: true to receive even when not running
  * - `sess.latency.msec = <float>`: target network latency in milliseconds, default 100
+ * - `sess.latency.adaptive = <bool>`: adapt the latency to the measured jitter of the
+ *                packets, sess.latency.msec is then the maximum latency, default false
+ * - `sess.latency.min.msec = <float>`: the minimum adaptive latency, default 2 * ptime
  * - `sess.ignore-ssrc = <bool>`: ignore SSRC, default false
  * - `sess.media = <string>`: the media type audio|midi|opus, default audio
+ * - `net.hw-timestamp = <bool>`: use the hardware receive timestamps of the NIC on
+ *                local.ifname. With sess.ts-direct and a driver that follows the PTP
+ *                clock of the same NIC, the link latency of the packets is checked
+ *                against the target latency. default false
  * - `stream.props = {}`: properties to be passed to the stream
  *
+ * Lost packets are concealed by repeating the previous packet (or with the
+ * packet loss concealment of the decoder for opus) and reordered packets are
+ * put back in place when they are not played yet. The stream properties
+ * rtp.jitter.msec, rtp.latency.msec, rtp.lost, rtp.late and rtp.concealed are
+ * updated every second.
+ *
+ * Multicast sources on the same port, interface and data loop share one socket.
+ * The packets are dispatched to the sources with their destination group address.
+ *
  * ## General options
  *
  * Options with well-known behavior:
@@ -117,11 +138,17 @@ PW_LOG_TOPIC(mod_topic, "mod." NAME);
 
 #define DEFAULT_TS_OFFSET		-1
 
+/* max number of packets read with one recvmmsg() */
+#define RECV_BATCH			16
+
 #define USAGE   "( local.ifname=<local interface name to use> ) "						\
 		"( source.ip=<source IP address, default:"DEFAULT_SOURCE_IP"> ) "				\
  		"source.port=<int, source port> "								\
 		"( sess.latency.msec=<target network latency, default "SPA_STRINGIFY(DEFAULT_SESS_LATENCY)"> ) "\
+		"( sess.latency.adaptive=<adapt the latency to the jitter, default false> ) "\
+		"( sess.latency.min.msec=<minimum adaptive latency> ) "\
 		"( sess.ignore-ssrc=<to ignore SSRC, default false> ) "\
+		"( net.hw-timestamp=<use hardware receive timestamps, default false> ) "\
  		"( sess.media=<string, the media type audio|midi|opus, default audio> ) "			\
 		"( audio.format=<format, default:"DEFAULT_FORMAT"> ) "						\
 		"( audio.rate=<sample rate, default:"SPA_STRINGIFY(DEFAULT_RATE)"> ) "				\
@@ -151,6 +178,7 @@ struct impl {
 	unsigned int do_disconnect:1;
 
 	char *ifname;
+	bool hw_timestamp;
 	bool always_process;
 	uint32_t cleanup_interval;
 
@@ -162,50 +190,287 @@ struct impl {
 	uint16_t src_port;
 	struct sockaddr_storage src_addr;
 	socklen_t src_len;
-	struct spa_source *source;
+
+	struct receiver *receiver;
+	struct spa_list receiver_link;
+	struct sockaddr_storage group;	/* the address we listen on */
 
 	unsigned receiving:1;
 	unsigned last_receiving:1;
 };
 
+#ifdef SO_TIMESTAMPING
+#define TIMESTAMP_CONTROL_SIZE	CMSG_SPACE(sizeof(struct scm_timestamping))
+#else
+#define TIMESTAMP_CONTROL_SIZE	0
+#endif
+#define RECV_CONTROL_SIZE	(CMSG_SPACE(sizeof(struct in6_pktinfo)) + TIMESTAMP_CONTROL_SIZE)
+
+/* A socket and the rtp-source modules that receive from it. Multicast
+ * sources on the same port, interface and data loop share one socket, the
+ * packets are dispatched on their destination group address. */
+struct receiver {
+	struct spa_list link;
+	struct pw_loop *data_loop;
+	struct spa_source *source;
+
+	unsigned shared:1;
+	unsigned hw_timestamp:1;
+	int af;
+	uint16_t port;
+	char *ifname;
+	uint32_t n_groups;
+
+	struct spa_list streams;	/* modified from the data loop */
+
+	uint8_t recv_buffer[RECV_BATCH][2048];
+	uint8_t recv_control[RECV_BATCH][RECV_CONTROL_SIZE];
+};
+
+static struct spa_list receivers = SPA_LIST_INIT(&receivers);
+
+static bool is_multicast(const struct sockaddr_storage *sa)
+{
+	if (sa->ss_family == AF_INET) {
+		static const uint32_t ipv4_mcast_mask = 0xe0000000;
+		const struct sockaddr_in *sa4 = (const struct sockaddr_in*)sa;
+		return (ntohl(sa4->sin_addr.s_addr) & ipv4_mcast_mask) == ipv4_mcast_mask;
+	} else if (sa->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *sa6 = (const struct sockaddr_in6*)sa;
+		return sa6->sin6_addr.s6_addr[0] == 0xff;
+	}
+	return false;
+}
+
+static bool group_equal(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+	if (a->ss_family != b->ss_family)
+		return false;
+	if (a->ss_family == AF_INET)
+		return ((const struct sockaddr_in*)a)->sin_addr.s_addr ==
+			((const struct sockaddr_in*)b)->sin_addr.s_addr;
+	if (a->ss_family == AF_INET6)
+		return memcmp(&((const struct sockaddr_in6*)a)->sin6_addr,
+				&((const struct sockaddr_in6*)b)->sin6_addr,
+				sizeof(struct in6_addr)) == 0;
+	return false;
+}
+
+/* get the destination address and the hardware receive timestamp from the
+ * control messages */
+static void get_packet_info(struct msghdr *msg, struct sockaddr_storage *dst,
+		uint64_t *rx_nsec)
+{
+	struct cmsghdr *cmsg;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+#ifdef IP_PKTINFO
+		if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+			struct in_pktinfo *pi = (struct in_pktinfo*)CMSG_DATA(cmsg);
+			struct sockaddr_in *sa4 = (struct sockaddr_in*)dst;
+			sa4->sin_family = AF_INET;
+			sa4->sin_addr = pi->ipi_addr;
+			continue;
+		}
+#endif
+#ifdef IPV6_PKTINFO
+		if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+			struct in6_pktinfo *pi = (struct in6_pktinfo*)CMSG_DATA(cmsg);
+			struct sockaddr_in6 *sa6 = (struct sockaddr_in6*)dst;
+			sa6->sin6_family = AF_INET6;
+			sa6->sin6_addr = pi->ipi6_addr;
+			continue;
+		}
+#endif
+#ifdef SO_TIMESTAMPING
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+			/* ts[2] is the raw hardware timestamp, in the timebase of the PHC */
+			struct scm_timestamping *ts = (struct scm_timestamping*)CMSG_DATA(cmsg);
+			*rx_nsec = SPA_TIMESPEC_TO_NSEC(&ts->ts[2]);
+			continue;
+		}
+#endif
+	}
+}
+
+static struct impl *receiver_find_stream(struct receiver *r, const struct sockaddr_storage *dst)
+{
+	struct impl *impl;
+
+	spa_list_for_each(impl, &r->streams, receiver_link) {
+		if (!r->shared || group_equal(&impl->group, dst))
+			return impl;
+	}
+	return NULL;
+}
+
+static void receive_packet(struct impl *impl, uint8_t *buffer, ssize_t len, uint64_t rx_nsec)
+{
+	if (len < 12) {
+		pw_log_warn("short packet received");
+		return;
+	}
+	if (SPA_LIKELY(impl->stream)) {
+		if (rtp_stream_receive_packet_at(impl->stream, buffer, len, rx_nsec) < 0)
+			pw_log_warn("recv error: %m");
+	}
+	impl->receiving = true;
+}
+
 static void
 on_rtp_io(void *data, int fd, uint32_t mask)
 {
-	struct impl *impl = data;
-	ssize_t len;
-	uint8_t buffer[2048];
+	struct receiver *r = data;
+	struct mmsghdr msgs[RECV_BATCH];
+	struct iovec iov[RECV_BATCH];
+	bool use_control = r->shared || r->hw_timestamp;
+	int i, n;
+
+	if (!(mask & SPA_IO_IN))
+		return;
+
+	/* read all pending packets with as few syscalls as possible */
+	while (true) {
+		for (i = 0; i < RECV_BATCH; i++) {
+			iov[i].iov_base = r->recv_buffer[i];
+			iov[i].iov_len = sizeof(r->recv_buffer[i]);
+			spa_zero(msgs[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			if (use_control) {
+				msgs[i].msg_hdr.msg_control = r->recv_control[i];
+				msgs[i].msg_hdr.msg_controllen = sizeof(r->recv_control[i]);
+			}
+		}
+
+		n = recvmmsg(fd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				pw_log_warn("recv error: %m");
+			return;
+		}
+
+		for (i = 0; i < n; i++) {
+			struct sockaddr_storage dst;
+			uint64_t rx_nsec = 0;
+			struct impl *impl;
 
-	if (mask & SPA_IO_IN) {
-		if ((len = recv(fd, buffer, sizeof(buffer), 0)) < 0)
-			goto receive_error;
+			spa_zero(dst);
+			if (use_control)
+				get_packet_info(&msgs[i].msg_hdr, &dst, &rx_nsec);
 
-		if (len < 12)
-			goto short_packet;
+			if ((impl = receiver_find_stream(r, &dst)) == NULL)
+				continue;
 
-		if (SPA_LIKELY(impl->stream)) {
-			if (rtp_stream_receive_packet(impl->stream, buffer, len) < 0)
-				goto receive_error;
+			receive_packet(impl, r->recv_buffer[i], msgs[i].msg_len,
+					r->hw_timestamp ? rx_nsec : 0);
 		}
+		if (n < RECV_BATCH)
+			break;
+	}
+}
+
+/* enable hardware timestamps of all received packets on the interface and
+ * ask for the raw hardware timestamps on the socket */
+static int enable_hw_timestamp(int fd, const char *ifname)
+{
+#ifdef SO_TIMESTAMPING
+	struct hwtstamp_config config;
+	struct ifreq req;
+	int val;
 
-		impl->receiving = true;
+	if (ifname == NULL) {
+		pw_log_error("hardware timestamps need local.ifname");
+		return -EINVAL;
 	}
-	return;
 
-receive_error:
-	pw_log_warn("recv error: %m");
-	return;
-short_packet:
-	pw_log_warn("short packet received");
-	return;
+	spa_zero(req);
+	spa_zero(config);
+	snprintf(req.ifr_name, sizeof(req.ifr_name), "%s", ifname);
+	req.ifr_data = (void*)&config;
+
+	/* ptp4l might have configured the interface already, only
+	 * widen the receive filter when needed */
+	if (ioctl(fd, SIOCGHWTSTAMP, &req) < 0 || config.rx_filter != HWTSTAMP_FILTER_ALL) {
+		config.rx_filter = HWTSTAMP_FILTER_ALL;
+		if (ioctl(fd, SIOCSHWTSTAMP, &req) < 0)
+			pw_log_warn("SIOCSHWTSTAMP %s failed: %m", ifname);
+	}
+
+	val = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+	if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &val, sizeof(val)) < 0) {
+		pw_log_error("setsockopt SO_TIMESTAMPING failed: %m");
+		return -errno;
+	}
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
 }
 
-static int make_socket(const struct sockaddr* sa, socklen_t salen, char *ifname)
+static int set_timestamping(int fd, const char *ifname, bool hw_timestamp)
+{
+	int val;
+
+	if (hw_timestamp)
+		return enable_hw_timestamp(fd, ifname);
+#ifdef SO_TIMESTAMP
+	val = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &val, sizeof(val)) < 0) {
+		pw_log_error("setsockopt failed: %m");
+		return -errno;
+	}
+#endif
+	return 0;
+}
+
+static int join_group(int fd, const struct sockaddr_storage *sa, const char *ifname, bool join)
 {
-	int af, fd, val, res;
 	struct ifreq req;
+	char addr[128];
+	int res;
+
+	spa_zero(req);
+	if (ifname) {
+		snprintf(req.ifr_name, sizeof(req.ifr_name), "%s", ifname);
+		res = ioctl(fd, SIOCGIFINDEX, &req);
+	        if (res < 0)
+	                pw_log_warn("SIOCGIFINDEX %s failed: %m", ifname);
+	}
+	pw_net_get_ip(sa, addr, sizeof(addr), NULL, NULL);
+
+	if (sa->ss_family == AF_INET) {
+		const struct sockaddr_in *sa4 = (const struct sockaddr_in*)sa;
+		struct ip_mreqn mr4;
+		memset(&mr4, 0, sizeof(mr4));
+		mr4.imr_multiaddr = sa4->sin_addr;
+		mr4.imr_ifindex = req.ifr_ifindex;
+		pw_log_info("%s IPv4 group: %s", join ? "join" : "leave", addr);
+		res = setsockopt(fd, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+				&mr4, sizeof(mr4));
+	} else if (sa->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *sa6 = (const struct sockaddr_in6*)sa;
+		struct ipv6_mreq mr6;
+		memset(&mr6, 0, sizeof(mr6));
+		mr6.ipv6mr_multiaddr = sa6->sin6_addr;
+		mr6.ipv6mr_interface = req.ifr_ifindex;
+		pw_log_info("%s IPv6 group: %s", join ? "join" : "leave", addr);
+		res = setsockopt(fd, IPPROTO_IPV6, join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+				&mr6, sizeof(mr6));
+	} else {
+		return -EINVAL;
+	}
+	return res < 0 ? -errno : 0;
+}
+
+static int make_socket(const struct sockaddr* sa, socklen_t salen, char *ifname,
+		bool hw_timestamp)
+{
+	int af, fd, val, res;
 	struct sockaddr_storage ba = *(struct sockaddr_storage *)sa;
 	bool do_connect = false;
-	char addr[128];
 
 	af = sa->sa_family;
 	if ((fd = socket(af, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) {
@@ -213,14 +478,9 @@ static int make_socket(const struct sockaddr* sa, socklen_t salen, char *ifname)
 		pw_log_error("socket failed: %m");
 		return res;
 	}
-#ifdef SO_TIMESTAMP
-	val = 1;
-	if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &val, sizeof(val)) < 0) {
-		res = -errno;
-		pw_log_error("setsockopt failed: %m");
+	if ((res = set_timestamping(fd, ifname, hw_timestamp)) < 0)
 		goto error;
-	}
-#endif
+
 	val = 1;
 	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val)) < 0) {
 		res = -errno;
@@ -228,54 +488,25 @@ static int make_socket(const struct sockaddr* sa, socklen_t salen, char *ifname)
 		goto error;
 	}
 
-	spa_zero(req);
-	if (ifname) {
-		snprintf(req.ifr_name, sizeof(req.ifr_name), "%s", ifname);
-		res = ioctl(fd, SIOCGIFINDEX, &req);
-	        if (res < 0)
-	                pw_log_warn("SIOCGIFINDEX %s failed: %m", ifname);
-	}
 	res = 0;
-	if (af == AF_INET) {
-		static const uint32_t ipv4_mcast_mask = 0xe0000000;
-		struct sockaddr_in *sa4 = (struct sockaddr_in*)sa;
-		if ((ntohl(sa4->sin_addr.s_addr) & ipv4_mcast_mask) == ipv4_mcast_mask) {
-			struct ip_mreqn mr4;
-			memset(&mr4, 0, sizeof(mr4));
-			mr4.imr_multiaddr = sa4->sin_addr;
-			mr4.imr_ifindex = req.ifr_ifindex;
-			pw_net_get_ip((struct sockaddr_storage*)sa, addr, sizeof(addr), NULL, NULL);
-			pw_log_info("join IPv4 group: %s", addr);
-			res = setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mr4, sizeof(mr4));
-		} else {
-			struct sockaddr_in *ba4 = (struct sockaddr_in*)&ba;
-			if (ba4->sin_addr.s_addr != INADDR_ANY) {
-				ba4->sin_addr.s_addr = INADDR_ANY;
-				do_connect = true;
-			}
+	if (is_multicast(&ba)) {
+		res = join_group(fd, &ba, ifname, true);
+	} else if (af == AF_INET) {
+		struct sockaddr_in *ba4 = (struct sockaddr_in*)&ba;
+		if (ba4->sin_addr.s_addr != INADDR_ANY) {
+			ba4->sin_addr.s_addr = INADDR_ANY;
+			do_connect = true;
 		}
 	} else if (af == AF_INET6) {
-		struct sockaddr_in6 *sa6 = (struct sockaddr_in6*)sa;
-		if (sa6->sin6_addr.s6_addr[0] == 0xff) {
-			struct ipv6_mreq mr6;
-			memset(&mr6, 0, sizeof(mr6));
-			mr6.ipv6mr_multiaddr = sa6->sin6_addr;
-			mr6.ipv6mr_interface = req.ifr_ifindex;
-			pw_net_get_ip((struct sockaddr_storage*)sa, addr, sizeof(addr), NULL, NULL);
-			pw_log_info("join IPv6 group: %s", addr);
-			res = setsockopt(fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mr6, sizeof(mr6));
-		} else {
-			struct sockaddr_in6 *ba6 = (struct sockaddr_in6*)&ba;
-			ba6->sin6_addr = in6addr_any;
-		}
+		struct sockaddr_in6 *ba6 = (struct sockaddr_in6*)&ba;
+		ba6->sin6_addr = in6addr_any;
 	} else {
 		res = -EINVAL;
 		goto error;
 	}
 
 	if (res < 0) {
-		res = -errno;
-		pw_log_error("join mcast failed: %m");
+		pw_log_error("join mcast failed: %s", spa_strerror(res));
 		goto error;
 	}
 
@@ -297,40 +528,217 @@ error:
 	return res;
 }
 
-static int stream_start(struct impl *impl)
+/* a socket bound to the any address that tells us the destination address
+ * of the packets so that they can be dispatched to the right stream */
+static int make_shared_socket(int af, uint16_t port, char *ifname, bool hw_timestamp)
 {
-	int fd;
+	int fd, val, res;
+	struct sockaddr_storage ba;
+	socklen_t len;
 
-	if (impl->source != NULL)
-		return 0;
+	spa_zero(ba);
+	if (af == AF_INET) {
+		struct sockaddr_in *ba4 = (struct sockaddr_in*)&ba;
+		ba4->sin_family = AF_INET;
+		ba4->sin_port = htons(port);
+		ba4->sin_addr.s_addr = INADDR_ANY;
+		len = sizeof(*ba4);
+	} else if (af == AF_INET6) {
+		struct sockaddr_in6 *ba6 = (struct sockaddr_in6*)&ba;
+		ba6->sin6_family = AF_INET6;
+		ba6->sin6_port = htons(port);
+		ba6->sin6_addr = in6addr_any;
+		len = sizeof(*ba6);
+	} else {
+		return -EINVAL;
+	}
 
-	pw_log_info("starting RTP listener");
+	if ((fd = socket(af, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) {
+		res = -errno;
+		pw_log_error("socket failed: %m");
+		return res;
+	}
+	if ((res = set_timestamping(fd, ifname, hw_timestamp)) < 0)
+		goto error;
 
-	if ((fd = make_socket((const struct sockaddr *)&impl->src_addr,
-					impl->src_len, impl->ifname)) < 0) {
-		pw_log_error("failed to create socket: %m");
-		return -errno;
+	val = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val)) < 0) {
+		res = -errno;
+		pw_log_error("setsockopt failed: %m");
+		goto error;
+	}
+	if (af == AF_INET)
+		res = setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &val, sizeof(val));
+	else
+		res = setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &val, sizeof(val));
+	if (res < 0) {
+		res = -errno;
+		pw_log_error("setsockopt PKTINFO failed: %m");
+		goto error;
+	}
+	if (bind(fd, (struct sockaddr*)&ba, len) < 0) {
+		res = -errno;
+		pw_log_error("bind() failed: %m");
+		goto error;
+	}
+	return fd;
+error:
+	close(fd);
+	return res;
+}
+
+static void receiver_free(struct receiver *r)
+{
+	spa_list_remove(&r->link);
+	if (r->source)
+		pw_loop_destroy_source(r->data_loop, r->source);
+	free(r->ifname);
+	free(r);
+}
+
+static struct receiver *receiver_new(struct impl *impl, bool shared)
+{
+	struct receiver *r;
+	int fd, res;
+
+	if ((r = calloc(1, sizeof(*r))) == NULL)
+		return NULL;
+
+	r->data_loop = impl->data_loop;
+	r->shared = shared;
+	r->hw_timestamp = impl->hw_timestamp;
+	r->af = impl->group.ss_family;
+	r->port = impl->src_port;
+	r->ifname = impl->ifname ? strdup(impl->ifname) : NULL;
+	spa_list_init(&r->streams);
+	spa_list_init(&r->link);
+
+	if (shared)
+		fd = make_shared_socket(r->af, r->port, r->ifname, r->hw_timestamp);
+	else
+		fd = make_socket((const struct sockaddr *)&impl->group,
+				impl->src_len, impl->ifname, impl->hw_timestamp);
+	if (fd < 0) {
+		res = fd;
+		goto error;
 	}
 
-	impl->source = pw_loop_add_io(impl->data_loop, fd,
-				SPA_IO_IN, true, on_rtp_io, impl);
-	if (impl->source == NULL) {
+	r->source = pw_loop_add_io(r->data_loop, fd, SPA_IO_IN, true, on_rtp_io, r);
+	if (r->source == NULL) {
+		res = -errno;
 		pw_log_error("can't create io source: %m");
 		close(fd);
+		goto error;
+	}
+	if (shared)
+		spa_list_append(&receivers, &r->link);
+	return r;
+error:
+	receiver_free(r);
+	errno = -res;
+	return NULL;
+}
+
+static bool receiver_matches(struct receiver *r, struct impl *impl)
+{
+	return r->shared &&
+		r->data_loop == impl->data_loop &&
+		r->af == impl->group.ss_family &&
+		r->port == impl->src_port &&
+		r->hw_timestamp == impl->hw_timestamp &&
+		spa_streq(r->ifname, impl->ifname);
+}
+
+/* join the group on a socket that is already open, when the group can't be
+ * joined there (already joined by another stream or the membership limit of
+ * the socket was reached) we try the next one or make a new socket */
+static struct receiver *receiver_join(struct impl *impl)
+{
+	struct receiver *r;
+	int res;
+
+#if defined(IP_PKTINFO) && defined(IPV6_RECVPKTINFO)
+	spa_list_for_each(r, &receivers, link) {
+		if (!receiver_matches(r, impl))
+			continue;
+		if (join_group(r->source->fd, &impl->group, impl->ifname, true) == 0)
+			goto done;
+	}
+	if ((r = receiver_new(impl, true)) == NULL)
+		return NULL;
+
+	if ((res = join_group(r->source->fd, &impl->group, impl->ifname, true)) < 0) {
+		pw_log_error("join mcast failed: %s", spa_strerror(res));
+		receiver_free(r);
+		errno = -res;
+		return NULL;
+	}
+done:
+	r->n_groups++;
+	return r;
+#else
+	return receiver_new(impl, false);
+#endif
+}
+
+static int do_add_stream(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	spa_list_append(&impl->receiver->streams, &impl->receiver_link);
+	return 0;
+}
+
+static int do_remove_stream(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	spa_list_remove(&impl->receiver_link);
+	return 0;
+}
+
+static int stream_start(struct impl *impl)
+{
+	struct receiver *r;
+
+	if (impl->receiver != NULL)
+		return 0;
+
+	pw_log_info("starting RTP listener");
+
+	impl->group = impl->src_addr;
+	if (is_multicast(&impl->group))
+		r = receiver_join(impl);
+	else
+		r = receiver_new(impl, false);
+
+	if (r == NULL) {
+		pw_log_error("failed to create socket: %m");
 		return -errno;
 	}
+	impl->receiver = r;
+	pw_loop_invoke(r->data_loop, do_add_stream, 0, NULL, 0, true, impl);
 	return 0;
 }
 
 static void stream_stop(struct impl *impl)
 {
-	if (!impl->source)
+	struct receiver *r = impl->receiver;
+
+	if (r == NULL)
 		return;
 
 	pw_log_info("stopping RTP listener");
 
-	pw_loop_destroy_source(impl->data_loop, impl->source);
-	impl->source = NULL;
+	pw_loop_invoke(r->data_loop, do_remove_stream, 0, NULL, 0, true, impl);
+	impl->receiver = NULL;
+
+	if (r->shared) {
+		join_group(r->source->fd, &impl->group, impl->ifname, false);
+		r->n_groups--;
+	}
+	if (spa_list_is_empty(&r->streams))
+		receiver_free(r);
 }
 
 static void stream_destroy(void *d)
@@ -462,10 +870,9 @@ static const struct pw_proxy_events core_proxy_events = {
 
 static void impl_destroy(struct impl *impl)
 {
+	stream_stop(impl);
 	if (impl->stream)
 		rtp_stream_destroy(impl->stream);
-	if (impl->source)
-		pw_loop_destroy_source(impl->data_loop, impl->source);
 
 	if (impl->core && impl->do_disconnect)
 		pw_core_disconnect(impl->core);
@@ -588,11 +995,14 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	copy_props(impl, props, "sess.min-ptime");
 	copy_props(impl, props, "sess.max-ptime");
 	copy_props(impl, props, "sess.latency.msec");
+	copy_props(impl, props, "sess.latency.adaptive");
+	copy_props(impl, props, "sess.latency.min.msec");
 	copy_props(impl, props, "sess.ts-direct");
 	copy_props(impl, props, "sess.ignore-ssrc");
 
 	str = pw_properties_get(props, "local.ifname");
 	impl->ifname = str ? strdup(str) : NULL;
+	impl->hw_timestamp = pw_properties_get_bool(props, "net.hw-timestamp", false);
 
 	impl->src_port = pw_properties_get_uint32(props, "source.port", 0);
 	if (impl->src_port == 0) {
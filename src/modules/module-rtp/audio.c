@@ -37,6 +37,7 @@ static void rtp_audio_process_playback(void *data)
 		memset(d[0].data, 0, wanted * stride);
 		if (impl->have_sync) {
 			impl->have_sync = false;
+			impl->n_underrun++;
 			level = SPA_LOG_LEVEL_WARN;
 		} else {
 			level = SPA_LOG_LEVEL_DEBUG;
@@ -94,6 +95,200 @@ static void rtp_audio_process_playback(void *data)
 	pw_stream_queue_buffer(impl->stream, buf);
 }
 
+/* With hardware receive timestamps in the PTP timebase and a media clock
+ * that follows the same PTP clock (sess.ts-direct), the arrival time of a
+ * packet can be compared with its RTP timestamp. The difference is the link
+ * latency, packets arriving later than the target latency are too late. */
+static void rtp_audio_check_arrival(struct impl *impl, uint32_t timestamp)
+{
+	uint64_t sec = impl->rx_time / SPA_NSEC_PER_SEC;
+	uint64_t nsec = impl->rx_time % SPA_NSEC_PER_SEC;
+	uint32_t arrival = (uint32_t)(sec * impl->rate + nsec * impl->rate / SPA_NSEC_PER_SEC);
+	int32_t latency = (int32_t)(arrival - timestamp);
+
+	if (latency > (int32_t)impl->target_buffer) {
+		if (!impl->rx_late)
+			pw_log_warn("late packet: link latency %d > target %u samples",
+					latency, impl->target_buffer);
+		impl->rx_late = true;
+	} else {
+		impl->rx_late = false;
+	}
+
+	if (impl->rx_report == 0 || arrival - impl->rx_report >= impl->rate) {
+		if (impl->rx_report != 0)
+			pw_log_debug("link latency min:%d max:%d target:%u samples",
+					impl->rx_latency_min, impl->rx_latency_max,
+					impl->target_buffer);
+		impl->rx_report = arrival;
+		impl->rx_latency_min = impl->rx_latency_max = latency;
+	} else {
+		impl->rx_latency_min = SPA_MIN(impl->rx_latency_min, latency);
+		impl->rx_latency_max = SPA_MAX(impl->rx_latency_max, latency);
+	}
+}
+
+struct rtp_stats {
+	float jitter;
+	float latency;
+	uint64_t lost;
+	uint64_t late;
+	uint64_t concealed;
+};
+
+static int do_update_stats(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	const struct rtp_stats *st = data;
+	struct spa_dict_item items[5];
+	char jitter[64], latency[64], lost[32], late[32], concealed[32];
+
+	if (impl->stream == NULL)
+		return 0;
+
+	snprintf(lost, sizeof(lost), "%"PRIu64, st->lost);
+	snprintf(late, sizeof(late), "%"PRIu64, st->late);
+	snprintf(concealed, sizeof(concealed), "%"PRIu64, st->concealed);
+	items[0] = SPA_DICT_ITEM_INIT("rtp.jitter.msec", spa_dtoa(jitter, sizeof(jitter), st->jitter));
+	items[1] = SPA_DICT_ITEM_INIT("rtp.latency.msec", spa_dtoa(latency, sizeof(latency), st->latency));
+	items[2] = SPA_DICT_ITEM_INIT("rtp.lost", lost);
+	items[3] = SPA_DICT_ITEM_INIT("rtp.late", late);
+	items[4] = SPA_DICT_ITEM_INIT("rtp.concealed", concealed);
+	pw_stream_update_properties(impl->stream, &SPA_DICT_INIT_ARRAY(items));
+	return 0;
+}
+
+/* move the target latency to the measured jitter, grow quickly when packets
+ * were too late and shrink one packet at a time. The DLL then slowly moves
+ * the fill level of the ringbuffer to the new target. */
+static void rtp_jitter_adapt(struct impl *impl)
+{
+	uint32_t target;
+
+	target = impl->psamples + (uint32_t)(JITTER_FACTOR * impl->jitter);
+	target = SPA_ROUND_UP(target, impl->psamples);
+
+	if (impl->n_late + impl->n_underrun != impl->last_late)
+		target = SPA_MAX(target, impl->target_buffer + impl->psamples);
+	else if (target < impl->target_buffer)
+		target = SPA_MAX(target, impl->target_buffer - impl->psamples);
+	impl->last_late = impl->n_late + impl->n_underrun;
+
+	target = SPA_CLAMP(target, impl->min_target, impl->max_target);
+	if (target != impl->target_buffer) {
+		pw_log_info("jitter:%f target latency %u -> %u", impl->jitter,
+				impl->target_buffer, target);
+		impl->target_buffer = target;
+	}
+}
+
+/* update the interarrival jitter of RFC 3550 with the arrival time of the
+ * packet with timestamp and publish the stats once per second */
+static void rtp_jitter_update(struct impl *impl, uint32_t timestamp)
+{
+	uint64_t nsec = impl->rx_time;
+	uint32_t arrival;
+	struct rtp_stats st;
+
+	if (nsec == 0) {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		nsec = SPA_TIMESPEC_TO_NSEC(&ts);
+	}
+	arrival = (uint32_t)((nsec / SPA_NSEC_PER_SEC) * impl->rate +
+			(nsec % SPA_NSEC_PER_SEC) * impl->rate / SPA_NSEC_PER_SEC);
+
+	if (impl->have_jitter) {
+		int32_t d = (int32_t)((arrival - impl->jitter_arrival) -
+				(timestamp - impl->jitter_ts));
+		impl->jitter += (fabsf((float)d) - impl->jitter) / 16.0f;
+	} else {
+		impl->jitter_report = timestamp;
+	}
+	impl->jitter_arrival = arrival;
+	impl->jitter_ts = timestamp;
+	impl->have_jitter = true;
+
+	if (timestamp - impl->jitter_report < impl->rate)
+		return;
+	impl->jitter_report = timestamp;
+
+	if (impl->adaptive)
+		rtp_jitter_adapt(impl);
+
+	st.jitter = impl->jitter * 1000.0f / impl->rate;
+	st.latency = impl->target_buffer * 1000.0f / impl->rate;
+	st.lost = impl->n_lost;
+	st.late = impl->n_late;
+	st.concealed = impl->n_concealed;
+	pw_loop_invoke(impl->main_loop, do_update_stats, SPA_ID_INVALID,
+			&st, sizeof(st), false, impl);
+}
+
+/* check the sequence number, gaps are handled with the timestamps */
+static void rtp_check_seq(struct impl *impl, uint16_t seq)
+{
+	int16_t diff = (int16_t)(seq - impl->seq);
+
+	if (impl->have_seq && diff != 0) {
+		if (diff > 0) {
+			pw_log_debug("lost %d packets (%d != %d) SSRC:%u",
+					diff, seq, impl->seq, impl->ssrc);
+			impl->n_lost += diff;
+		} else {
+			pw_log_debug("out of order packet (%d != %d) SSRC:%u",
+					seq, impl->seq, impl->ssrc);
+			return;
+		}
+	}
+	impl->seq = seq + 1;
+	impl->have_seq = true;
+}
+
+static uint8_t rtp_audio_silence(struct impl *impl)
+{
+	switch (impl->info.info.raw.format) {
+	case SPA_AUDIO_FORMAT_U8:
+		return 0x80;
+	case SPA_AUDIO_FORMAT_ALAW:
+		return 0xd5;
+	case SPA_AUDIO_FORMAT_ULAW:
+		return 0xff;
+	default:
+		return 0x00;
+	}
+}
+
+/* fill the samples of lost packets, from the current write index up to
+ * write, by repeating the last packet and then with silence */
+static void rtp_audio_conceal(struct impl *impl, uint32_t from, uint32_t write)
+{
+	uint32_t stride = impl->stride, n, avail, repeat;
+	uint8_t tmp[4096];
+
+	n = SPA_MIN(impl->last_samples, sizeof(tmp) / stride);
+	repeat = n * MAX_CONCEAL_PACKETS;
+
+	while ((avail = write - from) > 0) {
+		uint32_t chunk;
+
+		if (n > 0 && repeat > 0) {
+			chunk = SPA_MIN(SPA_MIN(avail, n), repeat);
+			spa_ringbuffer_read_data(&impl->ring, impl->buffer, BUFFER_SIZE,
+					((from - n) * stride) & BUFFER_MASK, tmp, chunk * stride);
+			repeat -= chunk;
+		} else {
+			chunk = SPA_MIN(avail, sizeof(tmp) / stride);
+			memset(tmp, rtp_audio_silence(impl), chunk * stride);
+		}
+		spa_ringbuffer_write_data(&impl->ring, impl->buffer, BUFFER_SIZE,
+				(from * stride) & BUFFER_MASK, tmp, chunk * stride);
+		from += chunk;
+	}
+	impl->n_concealed++;
+}
+
 static int rtp_audio_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 {
 	struct rtp_header *hdr;
@@ -120,25 +315,24 @@ static int rtp_audio_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 	impl->have_ssrc = !impl->ignore_ssrc;
 
 	seq = ntohs(hdr->sequence_number);
-	if (impl->have_seq && impl->seq != seq) {
-		pw_log_info("unexpected seq (%d != %d) SSRC:%u",
-				seq, impl->seq, hdr->ssrc);
-		impl->have_sync = false;
-	}
-	impl->seq = seq + 1;
-	impl->have_seq = true;
+	rtp_check_seq(impl, seq);
 
 	timestamp = ntohl(hdr->timestamp) - impl->ts_offset;
 
 	impl->receiving = true;
 
+	if (impl->rx_time != 0 && impl->direct_timestamp)
+		rtp_audio_check_arrival(impl, timestamp);
+	rtp_jitter_update(impl, timestamp);
+
 	plen = len - hlen;
 	samples = plen / stride;
 
 	filled = spa_ringbuffer_get_write_index(&impl->ring, &expected_write);
 
-	/* we always write to timestamp + delay */
-	write = timestamp + impl->target_buffer;
+	/* we always write to timestamp + delay, the delay is the target when
+	 * we synced, a new target is reached by the DLL */
+	write = timestamp + impl->sync_target;
 
 	if (!impl->have_sync) {
 		pw_log_info("sync to timestamp:%u seq:%u ts_offset:%u SSRC:%u target:%u direct:%u",
@@ -147,6 +341,8 @@ static int rtp_audio_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 
 		/* we read from timestamp, keeping target_buffer of data
 		 * in the ringbuffer. */
+		impl->sync_target = impl->target_buffer;
+		write = timestamp + impl->sync_target;
 		impl->ring.readindex = timestamp;
 		impl->ring.writeindex = write;
 		filled = impl->target_buffer;
@@ -156,8 +352,35 @@ static int rtp_audio_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 		memset(impl->buffer, 0, BUFFER_SIZE);
 		impl->have_sync = true;
 	} else if (expected_write != write) {
-		pw_log_debug("unexpected write (%u != %u)",
-				write, expected_write);
+		int32_t gap = (int32_t)(write - expected_write);
+
+		if (gap > 0 && gap <= (int32_t)impl->max_target) {
+			/* packets were lost */
+			pw_log_debug("conceal %d samples at %u", gap, expected_write);
+			rtp_audio_conceal(impl, expected_write, write);
+			filled += gap;
+		} else if (gap < 0 && -gap <= (int32_t)(2 * impl->max_target) &&
+		    (int32_t)(write + samples - expected_write) <= 0) {
+			if ((int32_t)(write + samples - impl->ring.readindex) <= 0) {
+				pw_log_debug("late packet (%u < %u)", write,
+						impl->ring.readindex);
+				impl->n_late++;
+				return 0;
+			}
+			/* a reordered packet that is not played yet, replace
+			 * the concealed samples */
+			spa_ringbuffer_write_data(&impl->ring,
+					impl->buffer,
+					BUFFER_SIZE,
+					(write * stride) & BUFFER_MASK,
+					&buffer[hlen], (samples * stride));
+			return 0;
+		} else {
+			pw_log_info("unexpected write (%u != %u) SSRC:%u",
+					write, expected_write, hdr->ssrc);
+			impl->have_sync = false;
+			return 0;
+		}
 	}
 
 	if (filled + samples > BUFFER_SIZE / stride) {
@@ -173,6 +396,7 @@ static int rtp_audio_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 				&buffer[hlen], (samples * stride));
 		write += samples;
 		spa_ringbuffer_write_update(&impl->ring, write);
+		impl->last_samples = samples;
 	}
 	return 0;
 
@@ -214,12 +438,24 @@ set_iovec(struct spa_ringbuffer *rbuf, void *buffer, uint32_t size,
 	iov[1].iov_base = buffer;
 }
 
+static void rtp_audio_send_packets(struct impl *impl, struct iovec *iov, size_t iovlen,
+		uint32_t n_packets)
+{
+	uint32_t i;
+
+	if (rtp_stream_emit_send_packets(impl, iov, iovlen, n_packets) > 0)
+		return;
+
+	for (i = 0; i < n_packets; i++)
+		rtp_stream_emit_send_packet(impl, &iov[i * iovlen], iovlen);
+}
+
 static void rtp_audio_flush_packets(struct impl *impl, uint32_t num_packets)
 {
 	int32_t avail, tosend;
-	uint32_t stride, timestamp;
-	struct iovec iov[3];
-	struct rtp_header header;
+	uint32_t stride, timestamp, n_batch = 0;
+	struct iovec iov[RTP_MAX_BATCH * 3];
+	struct rtp_header header[RTP_MAX_BATCH];
 
 	avail = spa_ringbuffer_get_read_index(&impl->ring, &timestamp);
 	tosend = impl->psamples;
@@ -236,37 +472,39 @@ static void rtp_audio_flush_packets(struct impl *impl, uint32_t num_packets)
 
 	stride = impl->stride;
 
-	spa_zero(header);
-	header.v = 2;
-	header.pt = impl->payload;
-	header.ssrc = htonl(impl->ssrc);
-
-	iov[0].iov_base = &header;
-	iov[0].iov_len = sizeof(header);
-
+	/* collect the packets and send them in batches of RTP_MAX_BATCH */
 	while (num_packets > 0) {
-		if (impl->marker_on_first && impl->first)
-			header.m = 1;
-		else
-			header.m = 0;
-		header.sequence_number = htons(impl->seq);
-		header.timestamp = htonl(impl->ts_offset + timestamp);
-
+		struct rtp_header *h = &header[n_batch];
+		struct iovec *v = &iov[n_batch * 3];
+
+		spa_zero(*h);
+		h->v = 2;
+		h->pt = impl->payload;
+		h->ssrc = htonl(impl->ssrc);
+		h->m = impl->marker_on_first && impl->first ? 1 : 0;
+		h->sequence_number = htons(impl->seq);
+		h->timestamp = htonl(impl->ts_offset + timestamp);
+
+		v[0].iov_base = h;
+		v[0].iov_len = sizeof(*h);
 		set_iovec(&impl->ring,
 			impl->buffer, BUFFER_SIZE,
 			(timestamp * stride) & BUFFER_MASK,
-			&iov[1], tosend * stride);
+			&v[1], tosend * stride);
 
 		pw_log_trace("sending %d packet:%d ts_offset:%d timestamp:%d",
 				tosend, num_packets, impl->ts_offset, timestamp);
 
-		rtp_stream_emit_send_packet(impl, iov, 3);
-
 		impl->seq++;
 		impl->first = false;
 		timestamp += tosend;
 		avail -= tosend;
 		num_packets--;
+
+		if (++n_batch == RTP_MAX_BATCH || num_packets == 0) {
+			rtp_audio_send_packets(impl, iov, 3, n_batch);
+			n_batch = 0;
+		}
 	}
 	spa_ringbuffer_read_update(&impl->ring, timestamp);
 done:
@@ -374,13 +374,25 @@ static void rtp_midi_flush_packets(struct impl *impl,
 
 	SPA_POD_SEQUENCE_FOREACH(sequence, c) {
 		void *ev;
+		uint8_t midi[16];
 		uint32_t size, delta, offset;
+		int res;
 
-		if (c->type != SPA_CONTROL_Midi)
+		switch (c->type) {
+		case SPA_CONTROL_Midi:
+			ev = SPA_POD_BODY(&c->value);
+			size = SPA_POD_BODY_SIZE(&c->value);
+			break;
+		case SPA_CONTROL_UMP:
+			if ((res = spa_ump_to_midi(SPA_POD_BODY(&c->value),
+					SPA_POD_BODY_SIZE(&c->value), midi, sizeof(midi))) <= 0)
+				continue;
+			ev = midi;
+			size = res;
+			break;
+		default:
 			continue;
-
-		ev = SPA_POD_BODY(&c->value),
-                size = SPA_POD_BODY_SIZE(&c->value);
+		}
 
 		offset = c->offset * impl->rate / rate;
 
@@ -42,6 +42,7 @@ static void rtp_opus_process_playback(void *data)
 		memset(d[0].data, 0, wanted * stride);
 		if (impl->have_sync) {
 			impl->have_sync = false;
+			impl->n_underrun++;
 			level = SPA_LOG_LEVEL_WARN;
 		} else {
 			level = SPA_LOG_LEVEL_DEBUG;
@@ -99,6 +100,45 @@ static void rtp_opus_process_playback(void *data)
 	pw_stream_queue_buffer(impl->stream, buf);
 }
 
+/* decode a packet, or conceal a lost packet when data is NULL, at write in
+ * the ringbuffer */
+static int rtp_opus_decode(struct impl *impl, const uint8_t *data, int32_t len,
+		uint32_t write, uint32_t max)
+{
+	OpusMSDecoder *dec = impl->stream_data;
+	uint32_t stride = impl->stride;
+	uint32_t index = (write * stride) & BUFFER_MASK2, end;
+	int res;
+
+	res = opus_multistream_decode_float(dec, data, len,
+			(float*)&impl->buffer[index], SPA_MIN(max, 2880u), 0);
+	if (res < 0) {
+		pw_log_warn("decode error: %s", opus_strerror(res));
+		return -EIO;
+	}
+
+	end = index + (res * stride);
+	/* fold to the lower part of the ringbuffer when overflow */
+	if (end > BUFFER_SIZE2)
+		memmove(impl->buffer, &impl->buffer[BUFFER_SIZE2], end - BUFFER_SIZE2);
+
+	return res;
+}
+
+/* let the decoder conceal the lost packets before write */
+static void rtp_opus_conceal(struct impl *impl, uint32_t from, uint32_t write)
+{
+	uint32_t avail;
+	int res;
+
+	while ((avail = write - from) > 0) {
+		if ((res = rtp_opus_decode(impl, NULL, 0, from, avail)) <= 0)
+			break;
+		from += res;
+	}
+	impl->n_concealed++;
+}
+
 static int rtp_opus_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 {
 	struct rtp_header *hdr;
@@ -106,7 +146,6 @@ static int rtp_opus_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 	uint16_t seq;
 	uint32_t timestamp, samples, write, expected_write;
 	uint32_t stride = impl->stride;
-	OpusMSDecoder *dec = impl->stream_data;
 	int32_t filled;
 	int res;
 
@@ -127,24 +166,20 @@ static int rtp_opus_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 	impl->have_ssrc = !impl->ignore_ssrc;
 
 	seq = ntohs(hdr->sequence_number);
-	if (impl->have_seq && impl->seq != seq) {
-		pw_log_info("unexpected seq (%d != %d) SSRC:%u",
-				seq, impl->seq, hdr->ssrc);
-		impl->have_sync = false;
-	}
-	impl->seq = seq + 1;
-	impl->have_seq = true;
+	rtp_check_seq(impl, seq);
 
 	timestamp = ntohl(hdr->timestamp) - impl->ts_offset;
 
 	impl->receiving = true;
+	rtp_jitter_update(impl, timestamp);
 
 	plen = len - hlen;
 
 	filled = spa_ringbuffer_get_write_index(&impl->ring, &expected_write);
 
-	/* we always write to timestamp + delay */
-	write = timestamp + impl->target_buffer;
+	/* we always write to timestamp + delay, the delay is the target when
+	 * we synced, a new target is reached by the DLL */
+	write = timestamp + impl->sync_target;
 
 	if (!impl->have_sync) {
 		pw_log_info("sync to timestamp:%u seq:%u ts_offset:%u SSRC:%u target:%u direct:%u",
@@ -153,6 +188,8 @@ static int rtp_opus_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 
 		/* we read from timestamp, keeping target_buffer of data
 		 * in the ringbuffer. */
+		impl->sync_target = impl->target_buffer;
+		write = timestamp + impl->sync_target;
 		impl->ring.readindex = timestamp;
 		impl->ring.writeindex = write;
 		filled = impl->target_buffer;
@@ -162,8 +199,26 @@ static int rtp_opus_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 		memset(impl->buffer, 0, BUFFER_SIZE);
 		impl->have_sync = true;
 	} else if (expected_write != write) {
-		pw_log_debug("unexpected write (%u != %u)",
-				write, expected_write);
+		int32_t gap = (int32_t)(write - expected_write);
+
+		if (gap > 0 && gap <= (int32_t)impl->max_target) {
+			/* packets were lost */
+			pw_log_debug("conceal %d samples at %u", gap, expected_write);
+			rtp_opus_conceal(impl, expected_write, write);
+			filled += gap;
+		} else if (gap < 0 && -gap <= (int32_t)(2 * impl->max_target)) {
+			/* the decoder state moved on, we can't use reordered
+			 * packets */
+			if ((int32_t)(write - impl->ring.readindex) <= 0)
+				impl->n_late++;
+			pw_log_debug("drop late packet (%u < %u)", write, expected_write);
+			return 0;
+		} else {
+			pw_log_info("unexpected write (%u != %u) SSRC:%u",
+					write, expected_write, hdr->ssrc);
+			impl->have_sync = false;
+			return 0;
+		}
 	}
 
 	if (filled + plen > BUFFER_SIZE2 / stride) {
@@ -171,19 +226,10 @@ static int rtp_opus_receive(struct impl *impl, uint8_t *buffer, ssize_t len)
 				BUFFER_SIZE2 / stride);
 		impl->have_sync = false;
 	} else {
-		uint32_t index = (write * stride) & BUFFER_MASK2, end;
-
-		res = opus_multistream_decode_float(dec,
-				&buffer[hlen], plen,
-				(float*)&impl->buffer[index], 2880,
-				0);
-
-		end = index + (res * stride);
-		/* fold to the lower part of the ringbuffer when overflow */
-		if (end > BUFFER_SIZE2)
-			memmove(impl->buffer, &impl->buffer[BUFFER_SIZE2], end - BUFFER_SIZE2);
+		if ((res = rtp_opus_decode(impl, &buffer[hlen], plen, write, 2880)) < 0)
+			return res;
 
-		pw_log_info("receiving %zd len:%d timestamp:%d %u", plen, res, timestamp, index);
+		pw_log_trace("receiving %zd len:%d timestamp:%d", plen, res, timestamp);
 		samples = res;
 
 		write += samples;
@@ -11,6 +11,7 @@
 #include <spa/utils/dll.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/control/control.h>
+#include <spa/control/ump-utils.h>
 #include <spa/debug/types.h>
 #include <spa/debug/mem.h>
 #include <spa/debug/log.h>
@@ -32,6 +33,13 @@ PW_LOG_TOPIC_EXTERN(mod_topic);
 #define BUFFER_SIZE2			(BUFFER_SIZE>>1)
 #define BUFFER_MASK2			(BUFFER_SIZE2-1)
 
+/* the adaptive target latency is the packet time plus this many times the
+ * interarrival jitter */
+#define JITTER_FACTOR			4.0f
+/* lost packets are concealed by repeating the previous packet this many
+ * times, longer gaps are filled with silence */
+#define MAX_CONCEAL_PACKETS		3
+
 #define rtp_stream_emit(s,m,v,...)		spa_hook_list_call(&s->listener_list, \
 							struct rtp_stream_events, m, v, ##__VA_ARGS__)
 #define rtp_stream_emit_destroy(s)		rtp_stream_emit(s, destroy, 0)
@@ -39,6 +47,7 @@ PW_LOG_TOPIC_EXTERN(mod_topic);
 #define rtp_stream_emit_param_changed(s,i,p)	rtp_stream_emit(s, param_changed,0,i,p)
 #define rtp_stream_emit_send_packet(s,i,l)	rtp_stream_emit(s, send_packet,0,i,l)
 #define rtp_stream_emit_send_feedback(s,seq)	rtp_stream_emit(s, send_feedback,0,seq)
+#define rtp_stream_emit_send_packets(s,i,l,n)	rtp_stream_emit(s, send_packets,1,i,l,n)
 
 struct impl {
 	struct spa_audio_info info;
@@ -83,6 +92,29 @@ struct impl {
 	float last_timestamp;
 	float last_time;
 
+	uint64_t rx_time;		/* PTP time of the received packet, 0 when unknown */
+	uint32_t rx_report;
+	int32_t rx_latency_min;
+	int32_t rx_latency_max;
+	unsigned rx_late:1;
+
+	/* jitter buffer of the receiver */
+	uint32_t sync_target;		/* target_buffer when we synced, the write delay */
+	uint32_t min_target;
+	uint32_t max_target;
+	uint32_t last_samples;		/* samples in the last packet, for concealment */
+	uint32_t jitter_arrival;
+	uint32_t jitter_ts;
+	uint32_t jitter_report;
+	float jitter;			/* RFC 3550 interarrival jitter in samples */
+	uint64_t n_lost;
+	uint64_t n_late;
+	uint64_t n_concealed;
+	uint64_t n_underrun;
+	uint64_t last_late;
+	unsigned adaptive:1;
+	unsigned have_jitter:1;
+
 	unsigned direct_timestamp:1;
 	unsigned always_process:1;
 	unsigned started:1;
@@ -512,6 +544,26 @@ struct rtp_stream *rtp_stream_new(struct pw_core *core,
 		pw_log_warn("sess.latency.msec should be an integer multiple of rtp.ptime");
 		impl->target_buffer = (uint32_t)((impl->target_buffer / ptime) * impl->psamples);
 	}
+	impl->sync_target = impl->max_target = impl->min_target = impl->target_buffer;
+
+	/* With an adaptive latency, sess.latency.msec is the upper limit and
+	 * the target follows the measured jitter. In direct timestamp mode the
+	 * latency is the offset to the media clock and can't change. */
+	if (direction == PW_DIRECTION_OUTPUT &&
+	    pw_properties_get_bool(props, "sess.latency.adaptive", false)) {
+		if (impl->direct_timestamp) {
+			pw_log_warn("sess.latency.adaptive is not possible with sess.ts-direct");
+		} else {
+			str = pw_properties_get(props, "sess.latency.min.msec");
+			if (!spa_atof(str, &latency_msec))
+				latency_msec = 2.0f * ptime;
+			impl->min_target = SPA_ROUND_UP(msec_to_samples(impl, latency_msec),
+					impl->psamples);
+			impl->min_target = SPA_CLAMP(impl->min_target,
+					impl->psamples, impl->max_target);
+			impl->adaptive = true;
+		}
+	}
 
 	pw_properties_setf(props, PW_KEY_NODE_RATE, "1/%d", impl->rate);
 	if (direction == PW_DIRECTION_INPUT) {
@@ -628,8 +680,15 @@ int rtp_stream_update_properties(struct rtp_stream *s, const struct spa_dict *di
 }
 
 int rtp_stream_receive_packet(struct rtp_stream *s, uint8_t *buffer, size_t len)
+{
+	return rtp_stream_receive_packet_at(s, buffer, len, 0);
+}
+
+int rtp_stream_receive_packet_at(struct rtp_stream *s, uint8_t *buffer, size_t len,
+		uint64_t rx_nsec)
 {
 	struct impl *impl = (struct impl*)s;
+	impl->rx_time = rx_nsec;
 	return impl->receive_rtp(impl, buffer, len);
 }
 
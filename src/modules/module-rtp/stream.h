@@ -23,8 +23,11 @@ struct rtp_stream;
 #define DEFAULT_MIN_PTIME	2.0f
 #define DEFAULT_MAX_PTIME	20.0f
 
+/* max number of packets passed in one send_packets event */
+#define RTP_MAX_BATCH		32
+
 struct rtp_stream_events {
-#define RTP_VERSION_STREAM_EVENTS        0
+#define RTP_VERSION_STREAM_EVENTS        1
 	uint32_t version;
 
 	void (*destroy) (void *data);
@@ -36,6 +39,10 @@ struct rtp_stream_events {
 	void (*send_packet) (void *data, struct iovec *iov, size_t iovlen);
 
 	void (*send_feedback) (void *data, uint32_t seqnum);
+
+	/* since 1, send n_packets packets of iovlen iovecs each, when not
+	 * implemented, send_packet is called for each packet */
+	void (*send_packets) (void *data, struct iovec *iov, size_t iovlen, uint32_t n_packets);
 };
 
 struct rtp_stream *rtp_stream_new(struct pw_core *core,
@@ -47,6 +54,8 @@ void rtp_stream_destroy(struct rtp_stream *s);
 int rtp_stream_update_properties(struct rtp_stream *s, const struct spa_dict *dict);
 
 int rtp_stream_receive_packet(struct rtp_stream *s, uint8_t *buffer, size_t len);
+int rtp_stream_receive_packet_at(struct rtp_stream *s, uint8_t *buffer, size_t len,
+		uint64_t rx_nsec);
 
 uint64_t rtp_stream_get_time(struct rtp_stream *s, uint32_t *rate);
 
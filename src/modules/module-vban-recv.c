@@ -112,6 +112,9 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
 #define DEFAULT_SOURCE_IP		"127.0.0.1"
 #define DEFAULT_SOURCE_PORT		6980
 
+/* max number of packets read with one recvmmsg() */
+#define RECV_BATCH			16
+
 #define USAGE   "( local.ifname=<local interface name to use> ) "						\
 		"( source.ip=<source IP address, default:"DEFAULT_SOURCE_IP"> ) "				\
  		"( source.port=<int, source port, default:"SPA_STRINGIFY(DEFAULT_SOURCE_PORT)"> "		\
@@ -158,6 +161,8 @@ struct impl {
 	socklen_t src_len;
 	struct spa_source *source;
 
+	uint8_t recv_buffer[RECV_BATCH][2048];
+
 	unsigned receiving:1;
 };
 
@@ -165,29 +170,48 @@ static void
 on_vban_io(void *data, int fd, uint32_t mask)
 {
 	struct impl *impl = data;
-	ssize_t len;
-	uint8_t buffer[2048];
+	struct mmsghdr msgs[RECV_BATCH];
+	struct iovec iov[RECV_BATCH];
+	int i, n;
+
+	if (!(mask & SPA_IO_IN))
+		return;
 
-	if (mask & SPA_IO_IN) {
-		if ((len = recv(fd, buffer, sizeof(buffer), 0)) < 0)
-			goto receive_error;
+	/* read all pending packets with as few syscalls as possible */
+	while (true) {
+		for (i = 0; i < RECV_BATCH; i++) {
+			iov[i].iov_base = impl->recv_buffer[i];
+			iov[i].iov_len = sizeof(impl->recv_buffer[i]);
+			spa_zero(msgs[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		n = recvmmsg(fd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				pw_log_warn("recv error: %m");
+			return;
+		}
 
-		if (len < 12)
-			goto short_packet;
+		for (i = 0; i < n; i++) {
+			ssize_t len = msgs[i].msg_len;
 
-		if (SPA_LIKELY(impl->stream))
-			vban_stream_receive_packet(impl->stream, buffer, len);
+			if (len < 12) {
+				pw_log_warn("short packet received");
+				continue;
+			}
+			if (SPA_LIKELY(impl->stream))
+				vban_stream_receive_packet(impl->stream,
+						impl->recv_buffer[i], len);
 
-		impl->receiving = true;
+			impl->receiving = true;
+		}
+		if (n < RECV_BATCH)
+			break;
 	}
-	return;
-
-receive_error:
-	pw_log_warn("recv error: %m");
-	return;
-short_packet:
-	pw_log_warn("short packet received");
-	return;
 }
 
 static int make_socket(const struct sockaddr* sa, socklen_t salen, char *ifname)
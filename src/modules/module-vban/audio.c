@@ -175,12 +175,25 @@ set_iovec(struct spa_ringbuffer *rbuf, void *buffer, uint32_t size,
 	iov[1].iov_base = buffer;
 }
 
+static void vban_audio_send_packets(struct impl *impl, struct iovec *iov, size_t iovlen,
+		uint32_t n_packets)
+{
+	uint32_t i;
+
+	if (vban_stream_emit_send_packets(impl, iov, iovlen, n_packets) > 0)
+		return;
+
+	for (i = 0; i < n_packets; i++)
+		vban_stream_emit_send_packet(impl, &iov[i * iovlen], iovlen);
+}
+
 static void vban_audio_flush_packets(struct impl *impl)
 {
 	int32_t avail, tosend;
-	uint32_t stride, timestamp;
-	struct iovec iov[3];
-	struct vban_header header;
+	uint32_t stride, timestamp, n_batch = 0;
+	struct iovec iov[VBAN_MAX_BATCH * 3];
+	struct vban_header header[VBAN_MAX_BATCH];
+	uint32_t n_frames;
 
 	avail = spa_ringbuffer_get_read_index(&impl->ring, &timestamp);
 	tosend = impl->psamples;
@@ -190,28 +203,37 @@ static void vban_audio_flush_packets(struct impl *impl)
 
 	stride = impl->stride;
 
-	header = impl->header;
-	header.format_nbs = tosend - 1;
-	header.format_nbc = impl->stream_info.info.raw.channels - 1;
-
-	iov[0].iov_base = &header;
-	iov[0].iov_len = sizeof(header);
+	n_frames = impl->header.n_frames;
 
+	/* collect the packets and send them in batches of VBAN_MAX_BATCH, the
+	 * payload is sent straight from the ringbuffer */
 	while (avail >= tosend) {
+		struct vban_header *h = &header[n_batch];
+		struct iovec *v = &iov[n_batch * 3];
+
+		*h = impl->header;
+		h->format_nbs = tosend - 1;
+		h->format_nbc = impl->stream_info.info.raw.channels - 1;
+		h->n_frames = n_frames++;
+
+		v[0].iov_base = h;
+		v[0].iov_len = sizeof(*h);
 		set_iovec(&impl->ring,
 			impl->buffer, BUFFER_SIZE,
 			(timestamp * stride) & BUFFER_MASK,
-			&iov[1], tosend * stride);
+			&v[1], tosend * stride);
 
 		pw_log_trace("sending %d timestamp:%08x", tosend, timestamp);
 
-		vban_stream_emit_send_packet(impl, iov, 3);
-
 		timestamp += tosend;
 		avail -= tosend;
-		header.n_frames++;
+
+		if (++n_batch == VBAN_MAX_BATCH || avail < tosend) {
+			vban_audio_send_packets(impl, iov, 3, n_batch);
+			n_batch = 0;
+		}
 	}
-	impl->header.n_frames = header.n_frames;
+	impl->header.n_frames = n_frames;
 	spa_ringbuffer_read_update(&impl->ring, timestamp);
 }
 
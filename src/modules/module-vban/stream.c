@@ -34,6 +34,7 @@
 #define vban_stream_emit_state_changed(s,n,e)	vban_stream_emit(s, state_changed,0,n,e)
 #define vban_stream_emit_send_packet(s,i,l)	vban_stream_emit(s, send_packet,0,i,l)
 #define vban_stream_emit_send_feedback(s,seq)	vban_stream_emit(s, send_feedback,0,seq)
+#define vban_stream_emit_send_packets(s,i,l,n)	vban_stream_emit(s, send_packets,1,i,l,n)
 
 struct impl {
 	struct spa_audio_info info;
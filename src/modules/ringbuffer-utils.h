@@ -0,0 +1,128 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef RINGBUFFER_UTILS_H
+#define RINGBUFFER_UTILS_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/ringbuffer.h>
+
+/* A ringbuffer with planar audio. All channels share the same read and
+ * write index and are allocated in one block. */
+struct pw_planar_ring {
+	struct spa_ringbuffer ring;
+	uint32_t channels;
+	uint32_t size;		/* size of one channel in bytes */
+	uint8_t *data;
+};
+
+static inline int pw_planar_ring_alloc(struct pw_planar_ring *r, uint32_t channels, uint32_t size)
+{
+	uint8_t *data;
+
+	data = calloc(channels, size);
+	if (data == NULL && channels > 0 && size > 0)
+		return -errno;
+	free(r->data);
+	r->data = data;
+	r->channels = channels;
+	r->size = size;
+	spa_ringbuffer_init(&r->ring);
+	return 0;
+}
+
+static inline void pw_planar_ring_free(struct pw_planar_ring *r)
+{
+	free(r->data);
+	r->data = NULL;
+	r->channels = r->size = 0;
+}
+
+static inline void pw_planar_ring_reset(struct pw_planar_ring *r)
+{
+	spa_ringbuffer_init(&r->ring);
+	if (r->data)
+		memset(r->data, 0, (size_t)r->channels * r->size);
+}
+
+static inline void *pw_planar_ring_channel(struct pw_planar_ring *r, uint32_t channel)
+{
+	return r->data + (size_t)channel * r->size;
+}
+
+/* get the offset of index in the channels and how many of the size bytes
+ * are contiguous from there */
+static inline uint32_t pw_planar_ring_split(struct pw_planar_ring *r, uint32_t index,
+		uint32_t size, uint32_t *offset)
+{
+	*offset = index % r->size;
+	return SPA_MIN(size, r->size - *offset);
+}
+
+/* write size bytes of n_src channels at index, missing channels are cleared */
+static inline void pw_planar_ring_write_data(struct pw_planar_ring *r, uint32_t index,
+		const void * const src[], uint32_t n_src, uint32_t size)
+{
+	uint32_t i, offs, l0, l1;
+
+	l0 = pw_planar_ring_split(r, index, size, &offs);
+	l1 = size - l0;
+
+	for (i = 0; i < r->channels; i++) {
+		uint8_t *d = pw_planar_ring_channel(r, i);
+		if (i < n_src && src[i] != NULL) {
+			memcpy(d + offs, src[i], l0);
+			if (SPA_UNLIKELY(l1 > 0))
+				memcpy(d, SPA_PTROFF(src[i], l0, void), l1);
+		} else {
+			memset(d + offs, 0, l0);
+			if (SPA_UNLIKELY(l1 > 0))
+				memset(d, 0, l1);
+		}
+	}
+}
+
+/* read size bytes at index into n_dst channels, extra channels are cleared */
+static inline void pw_planar_ring_read_data(struct pw_planar_ring *r, uint32_t index,
+		void * const dst[], uint32_t n_dst, uint32_t size)
+{
+	uint32_t i, offs, l0, l1;
+
+	l0 = pw_planar_ring_split(r, index, size, &offs);
+	l1 = size - l0;
+
+	for (i = 0; i < n_dst; i++) {
+		if (dst[i] == NULL)
+			continue;
+		if (i < r->channels) {
+			const uint8_t *s = pw_planar_ring_channel(r, i);
+			memcpy(dst[i], s + offs, l0);
+			if (SPA_UNLIKELY(l1 > 0))
+				memcpy(SPA_PTROFF(dst[i], l0, void), s, l1);
+		} else {
+			memset(dst[i], 0, size);
+		}
+	}
+}
+
+/* make ptrs point to size bytes at index of each channel. When the data
+ * does not wrap around, the pointers are in the ringbuffer memory and true
+ * is returned. Else the pointers are set to tmp and false is returned, the
+ * caller then needs to read or write the data from or to tmp. */
+static inline bool pw_planar_ring_get_ptrs(struct pw_planar_ring *r, uint32_t index,
+		uint32_t size, void *ptrs[], void * const tmp[])
+{
+	uint32_t i, offs;
+	bool direct = pw_planar_ring_split(r, index, size, &offs) == size;
+
+	for (i = 0; i < r->channels; i++)
+		ptrs[i] = direct ? (uint8_t*)pw_planar_ring_channel(r, i) + offs : tmp[i];
+	return direct;
+}
+
+#endif /* RINGBUFFER_UTILS_H */
@@ -25,8 +25,90 @@ struct port {
 	uint32_t port_id;
 };
 
+struct cache_entry {
+	struct spa_list link;
+	struct pw_memblock *mem;
+};
+
+/* Find recycled buffer memory with the same size and flags. The layout of the
+ * buffers is made again in the memory so only the size has to match. */
+static struct pw_memblock *cache_take(struct pw_context *context,
+		enum pw_memblock_flags flags, uint32_t type, size_t size)
+{
+	struct cache_entry *e;
+	struct pw_memblock *m;
+
+	if (context->buffer_cache.max_size == 0)
+		return NULL;
+
+	spa_list_for_each(e, &context->buffer_cache.entries, link) {
+		m = e->mem;
+		if (m->size != size || m->type != type || m->flags != flags)
+			continue;
+
+		spa_list_remove(&e->link);
+		free(e);
+		context->buffer_cache.size -= size;
+		context->buffer_cache.hits++;
+
+		pw_log_debug("%p: reuse mem:%p size:%zu hits:%"PRIu64" misses:%"PRIu64,
+				context, m, size, context->buffer_cache.hits,
+				context->buffer_cache.misses);
+		return m;
+	}
+	context->buffer_cache.misses++;
+	return NULL;
+}
+
+static void cache_evict(struct pw_context *context, size_t max_size)
+{
+	struct cache_entry *e;
+
+	while (context->buffer_cache.size > max_size) {
+		e = spa_list_last(&context->buffer_cache.entries, struct cache_entry, link);
+		pw_log_debug("%p: evict mem:%p size:%u", context, e->mem, e->mem->size);
+		context->buffer_cache.size -= e->mem->size;
+		spa_list_remove(&e->link);
+		pw_memblock_unref(e->mem);
+		free(e);
+	}
+}
+
+/* Keep buffer memory for a later negotiation, takes ownership of mem.
+ * Memory that was ever given to a client is not kept, the client can
+ * still have it mapped and would see the buffers of the next user. */
+static void cache_put(struct pw_context *context, struct pw_memblock *mem)
+{
+	struct cache_entry *e;
+	size_t max_size = context->buffer_cache.max_size;
+
+	if (mem->ref > 1 || mem->size > max_size ||
+	    pw_memblock_is_exported(mem) ||
+	    (e = calloc(1, sizeof(*e))) == NULL) {
+		pw_memblock_unref(mem);
+		return;
+	}
+	cache_evict(context, max_size - mem->size);
+
+	e->mem = mem;
+	spa_list_prepend(&context->buffer_cache.entries, &e->link);
+	context->buffer_cache.size += mem->size;
+
+	pw_log_debug("%p: recycle mem:%p size:%u cached:%zu", context, mem,
+			mem->size, context->buffer_cache.size);
+}
+
+void pw_buffers_cache_clear(struct pw_context *context)
+{
+	if (context->buffer_cache.hits + context->buffer_cache.misses > 0)
+		pw_log_info("%p: buffer cache hits %"PRIu64" of %"PRIu64" allocations",
+				context, context->buffer_cache.hits,
+				context->buffer_cache.hits + context->buffer_cache.misses);
+	cache_evict(context, 0);
+}
+
 /* Allocate an array of buffers that can be shared */
-static int alloc_buffers(struct pw_mempool *pool,
+static int alloc_buffers(struct pw_context *context,
 			 uint32_t n_buffers,
 			 uint32_t n_metas,
 			 struct spa_meta *metas,
@@ -43,7 +125,9 @@ static int alloc_buffers(struct pw_mempool *pool,
 	uint32_t i;
 	struct spa_data *datas;
 	struct pw_memblock *m;
+	struct pw_memmap *map;
 	struct spa_buffer_alloc_info info = { 0, };
+	struct pw_mempool *pool = context->pool;
 
 	if (!SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED))
 		SPA_FLAG_SET(info.flags, SPA_BUFFER_ALLOC_FLAG_INLINE_ALL);
@@ -78,22 +162,40 @@ static int alloc_buffers(struct pw_mempool *pool,
 	skel = SPA_PTROFF(buffers, n_buffers * sizeof(struct spa_buffer *), void);
 	skel = SPA_PTR_ALIGN(skel, info.max_align, void);
 
-	if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED)) {
-		/* pointer to buffer structures */
-		m = pw_mempool_alloc(pool,
+	if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED) &&
+	    info.max_align <= PW_MEMPOOL_SLICE_ALIGN) {
+		/* small buffers can share the memory with other ports */
+		map = pw_mempool_alloc_map(pool,
 				PW_MEMBLOCK_FLAG_READWRITE |
-				PW_MEMBLOCK_FLAG_SEAL |
-				PW_MEMBLOCK_FLAG_MAP,
+				PW_MEMBLOCK_FLAG_SEAL,
 				SPA_DATA_MemFd,
 				n_buffers * info.mem_size);
-		if (m == NULL) {
+		if (map == NULL) {
 			free(buffers);
 			return -errno;
 		}
+		m = NULL;
+		data = map->ptr;
+		/* slices are recycled */
+		memset(data, 0, n_buffers * info.mem_size);
+	} else if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED)) {
+		enum pw_memblock_flags mflags = PW_MEMBLOCK_FLAG_READWRITE |
+				PW_MEMBLOCK_FLAG_SEAL | PW_MEMBLOCK_FLAG_MAP;
+		size_t size = n_buffers * info.mem_size;
 
+		/* pointer to buffer structures */
+		if ((m = cache_take(context, mflags, SPA_DATA_MemFd, size)) != NULL) {
+			/* don't leak the old contents to the new peers */
+			memset(m->map->ptr, 0, size);
+		} else if ((m = pw_mempool_alloc(pool, mflags, SPA_DATA_MemFd, size)) == NULL) {
+			free(buffers);
+			return -errno;
+		}
+		map = NULL;
 		data = m->map->ptr;
 	} else {
 		m = NULL;
+		map = NULL;
 		data = NULL;
 	}
 
@@ -102,9 +204,14 @@ static int alloc_buffers(struct pw_mempool *pool,
 	spa_buffer_alloc_layout_array(&info, n_buffers, buffers, skel, data);
 
 	allocation->mem = m;
+	allocation->map = map;
 	allocation->n_buffers = n_buffers;
 	allocation->buffers = buffers;
 	allocation->flags = flags;
+	allocation->context = context;
+	allocation->size = info.max_align + n_buffers * (sizeof(struct spa_buffer *) + info.skel_size);
+	if (data != NULL)
+		allocation->size += n_buffers * info.mem_size;
 
 	return 0;
 }
@@ -330,7 +437,7 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 		data_types[i] = types;
 	}
 
-	if ((res = alloc_buffers(context->pool,
+	if ((res = alloc_buffers(context,
 				 max_buffers,
 				 n_metas,
 				 metas,
@@ -349,8 +456,14 @@ SPA_EXPORT
 void pw_buffers_clear(struct pw_buffers *buffers)
 {
 	pw_log_debug("%p: clear %d buffers:%p", buffers, buffers->n_buffers, buffers->buffers);
-	if (buffers->mem)
-		pw_memblock_unref(buffers->mem);
+	if (buffers->mem) {
+		if (buffers->context)
+			cache_put(buffers->context, buffers->mem);
+		else
+			pw_memblock_unref(buffers->mem);
+	}
+	if (buffers->map)
+		pw_memmap_free(buffers->map);
 	free(buffers->buffers);
 	spa_zero(*buffers);
 }
@@ -36,6 +36,9 @@ struct pw_buffers {
 	struct spa_buffer **buffers;	/**< port buffers */
 	uint32_t n_buffers;		/**< number of port buffers */
 	uint32_t flags;			/**< flags */
+	struct pw_memmap *map;		/**< allocated buffer memory slice */
+	struct pw_context *context;	/**< context to recycle the memory in */
+	size_t size;			/**< allocated size of the buffers */
 };
 
 int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
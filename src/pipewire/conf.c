@@ -13,8 +13,10 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <dirent.h>
 #include <regex.h>
+#include <pthread.h>
 #ifdef HAVE_PWD_H
 #include <pwd.h>
 #endif
@@ -30,6 +32,8 @@
 #include <spa/utils/json.h>
 #include <spa/debug/log.h>
 
+#include <spa-private/cache-dir.h>
+
 #include <pipewire/impl.h>
 #include <pipewire/private.h>
 
@@ -468,14 +472,270 @@ static int conf_filter(const struct dirent *entry)
 	return spa_strendswith(entry->d_name, ".conf");
 }
 
+/* The merged result of a config file and its drop-in fragments is cached in
+ * a binary file so that it can be loaded without parsing the JSON again.
+ *
+ * The cache contains the config file, the drop-in directories and all the
+ * fragments with their mtime, size and inode. It is only used when the config
+ * file and directories that would be loaded now are the same and none of the
+ * files or directories changed. */
+#define CONF_CACHE_MAGIC	0x43435750	/* PWCC */
+#define CONF_CACHE_VERSION	1
+
+struct conf_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;		/* size of the file */
+	uint32_t checksum;	/* FNV-1a of all data after the header */
+	uint32_t n_roots;	/* the config file and the drop-in directories */
+	uint32_t n_deps;	/* n_roots + the drop-in fragments */
+	uint32_t n_items;
+	uint32_t padding;
+	/* n_deps struct conf_cache_dep follow, then n_items key\0value\0 pairs */
+};
+
+struct conf_cache_dep {
+	uint64_t mtime;
+	uint64_t size;
+	uint64_t ino;
+	uint32_t path_len;	/* including the 0 byte, padded to 8 in the file */
+	uint32_t padding;
+};
+
+static uint32_t conf_cache_checksum(const void *data, size_t size)
+{
+	const uint8_t *p = data;
+	uint32_t h = 2166136261u;
+	while (size--)
+		h = (h ^ *p++) * 16777619u;
+	return h;
+}
+
+static int get_cache_path(char *path, size_t size, const char *prefix, const char *name)
+{
+	char base[PATH_MAX];
+	uint32_t hash;
+	int res;
+
+	if ((res = get_pipewire_cache_dir(base, sizeof(base), NULL, true)) < 0)
+		return res;
+
+	/* the config file is checked when loading, collisions only cause
+	 * a cache miss */
+	hash = conf_cache_checksum(name, strlen(name));
+	if (prefix != NULL)
+		hash ^= conf_cache_checksum(prefix, strlen(prefix) + 1);
+
+	if (spa_scnprintf(path, size, "%s/config-%08x.cache", base, hash) >= (int)size - 1)
+		return -ENAMETOOLONG;
+	return 0;
+}
+
+static void conf_dep_init(struct conf_cache_dep *d, const struct stat *st, size_t path_len)
+{
+	spa_zero(*d);
+	d->mtime = st->st_mtim.tv_sec * SPA_NSEC_PER_SEC + st->st_mtim.tv_nsec;
+	d->size = st->st_size;
+	d->ino = st->st_ino;
+	d->path_len = path_len;
+}
+
+static int conf_dep_add(struct pw_array *deps, const char *path)
+{
+	struct conf_cache_dep *d;
+	struct stat st;
+	size_t len = strlen(path) + 1;
+
+	if (stat(path, &st) < 0)
+		return -errno;
+	if ((d = pw_array_add(deps, sizeof(*d) + SPA_ROUND_UP_N(len, 8))) == NULL)
+		return -errno;
+	conf_dep_init(d, &st, len);
+	memset(SPA_PTROFF(d, sizeof(*d), void), 0, SPA_ROUND_UP_N(len, 8));
+	memcpy(SPA_PTROFF(d, sizeof(*d), void), path, len);
+	return 0;
+}
+
+static bool conf_dep_valid(const struct conf_cache_dep *d, const char *path)
+{
+	struct conf_cache_dep check;
+	struct stat st;
+
+	if (stat(path, &st) < 0)
+		return false;
+	conf_dep_init(&check, &st, d->path_len);
+	return memcmp(&check, d, sizeof(check)) == 0;
+}
+
+static int conf_cache_load(const char *cache_path, const struct pw_array *roots,
+		uint32_t n_roots, struct pw_properties *conf)
+{
+	const struct conf_cache_header *h;
+	const char *p, *end, *str;
+	void *data;
+	struct stat sbuf;
+	uint32_t i;
+	int res = -EINVAL;
+
+	spa_autoclose int fd = open(cache_path, O_CLOEXEC | O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	if (fstat(fd, &sbuf) < 0)
+		return -errno;
+	if (sbuf.st_size < (off_t)sizeof(*h) || sbuf.st_size > UINT32_MAX)
+		return -EINVAL;
+	if ((data = mmap(NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+		return -errno;
+
+	h = data;
+	p = SPA_PTROFF(data, sizeof(*h), const char);
+	end = SPA_PTROFF(data, sbuf.st_size, const char);
+
+	if (h->magic != CONF_CACHE_MAGIC || h->version != CONF_CACHE_VERSION ||
+	    h->size != sbuf.st_size || h->n_roots != n_roots || h->n_deps < n_roots ||
+	    h->checksum != conf_cache_checksum(p, end - p))
+		goto done;
+
+	/* the config file and directories must be the same */
+	if ((size_t)(end - p) < roots->size || memcmp(p, roots->data, roots->size) != 0)
+		goto done;
+
+	for (i = 0; i < h->n_deps; i++) {
+		const struct conf_cache_dep *d = (const struct conf_cache_dep *)p;
+		const char *path = SPA_PTROFF(d, sizeof(*d), const char);
+
+		if ((size_t)(end - p) < sizeof(*d) ||
+		    (size_t)(end - path) < SPA_ROUND_UP_N(d->path_len, 8) ||
+		    d->path_len == 0 || path[d->path_len - 1] != '\0')
+			goto done;
+		if (!conf_dep_valid(d, path)) {
+			pw_log_debug("%p: config cache '%s' is stale: %s changed",
+					conf, cache_path, path);
+			res = -ESTALE;
+			goto done;
+		}
+		p = path + SPA_ROUND_UP_N(d->path_len, 8);
+	}
+
+	/* check the items before adding them */
+	for (i = 0, str = p; i < h->n_items * 2u; i++) {
+		if ((str = memchr(str, '\0', end - str)) == NULL)
+			goto done;
+		str++;
+	}
+	if (str != end)
+		goto done;
+
+	for (i = 0; i < h->n_items; i++) {
+		const char *key = p, *value = key + strlen(key) + 1;
+		pw_properties_set(conf, key, value);
+		p = value + strlen(value) + 1;
+	}
+	res = 0;
+done:
+	munmap(data, sbuf.st_size);
+	return res;
+}
+static int conf_cache_save(const char *cache_path, const struct pw_array *deps,
+		uint32_t n_roots, uint32_t n_deps, const struct pw_properties *conf)
+{
+	struct conf_cache_header *h;
+	const struct conf_cache_dep *d;
+	const struct spa_dict_item *it;
+	struct pw_array data;
+	struct timespec now;
+	char tmp_name[PATH_MAX];
+	uint64_t now_ns;
+	size_t len;
+	int res, fd;
+
+	/* files changed in the last seconds could change again without a
+	 * visible change in mtime, don't cache those */
+	clock_gettime(CLOCK_REALTIME, &now);
+	now_ns = SPA_TIMESPEC_TO_NSEC(&now);
+	for (len = 0; len < deps->size;
+	     len += sizeof(*d) + SPA_ROUND_UP_N(d->path_len, 8)) {
+		d = SPA_PTROFF(deps->data, len, const struct conf_cache_dep);
+		if (d->mtime + 2 * SPA_NSEC_PER_SEC > now_ns)
+			return -EAGAIN;
+	}
+
+	pw_array_init(&data, 4096);
+	if ((h = pw_array_add(&data, sizeof(*h))) == NULL)
+		goto error;
+	spa_zero(*h);
+	if (pw_array_add(&data, deps->size) == NULL)
+		goto error;
+	memcpy(SPA_PTROFF(data.data, sizeof(*h), void), deps->data, deps->size);
+
+	spa_dict_for_each(it, &conf->dict) {
+		size_t kl = strlen(it->key) + 1, vl = strlen(it->value) + 1;
+		char *p;
+		if ((p = pw_array_add(&data, kl + vl)) == NULL)
+			goto error;
+		memcpy(p, it->key, kl);
+		memcpy(p + kl, it->value, vl);
+	}
+
+	h = data.data;
+	h->magic = CONF_CACHE_MAGIC;
+	h->version = CONF_CACHE_VERSION;
+	h->size = data.size;
+	h->n_roots = n_roots;
+	h->n_deps = n_deps;
+	h->n_items = conf->dict.n_items;
+	h->checksum = conf_cache_checksum(SPA_PTROFF(h, sizeof(*h), void),
+			data.size - sizeof(*h));
+
+	spa_scnprintf(tmp_name, sizeof(tmp_name), "%s.XXXXXX", cache_path);
+	if ((fd = mkostemp(tmp_name, O_CLOEXEC)) < 0)
+		goto error;
+
+	for (len = 0; len < data.size; len += res) {
+		if ((res = write(fd, SPA_PTROFF(data.data, len, void), data.size - len)) < 0) {
+			if (errno == EINTR) {
+				res = 0;
+				continue;
+			}
+			close(fd);
+			unlink(tmp_name);
+			goto error;
+		}
+	}
+	close(fd);
+
+	if (rename(tmp_name, cache_path) < 0) {
+		unlink(tmp_name);
+		goto error;
+	}
+	pw_array_clear(&data);
+
+	pw_log_debug("%p: saved config cache '%s'", conf, cache_path);
+	return 0;
+
+error:
+	res = -errno;
+	pw_log_debug("%p: can't save config cache '%s': %m", conf, cache_path);
+	pw_array_clear(&data);
+	return res;
+}
+
+struct conf_dir {
+	int level;
+	char path[PATH_MAX];
+};
+
 SPA_EXPORT
 int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties *conf)
 {
-	char path[PATH_MAX];
-	char fname[PATH_MAX + 256];
+	char path[PATH_MAX], cache_path[PATH_MAX];
+	char fname[PATH_MAX + 256], dname[PATH_MAX];
 	int i, res, level = 0;
 	spa_autoptr(pw_properties) override = NULL;
-	const char *dname;
+	struct pw_array dirs, deps;
+	struct conf_dir *dir;
+	uint32_t n_roots = 1, n_deps;
+	bool use_cache, cacheable = true;
 
 	if (name == NULL) {
 		pw_log_debug("%p: config name must not be NULL", conf);
@@ -486,41 +746,88 @@ int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties
 		pw_log_debug("%p: can't load config '%s': %m", conf, path);
 		return -ENOENT;
 	}
+	spa_scnprintf(dname, sizeof(dname), "%s.d", name);
+
+	/* the cache contains the complete result, it can only be used
+	 * when there is nothing else in conf */
+	use_cache = conf->dict.n_items == 0 &&
+		pw_check_option("config-cache", "true") &&
+		get_cache_path(cache_path, sizeof(cache_path), prefix, name) == 0;
+
+	pw_array_init(&dirs, sizeof(struct conf_dir) * 4);
+	pw_array_init(&deps, 1024);
+
+	/* the directories with the drop-in fragments */
+	while (true) {
+		if ((dir = pw_array_add(&dirs, sizeof(*dir))) == NULL) {
+			res = -errno;
+			goto exit;
+		}
+		if (get_config_dir(dir->path, sizeof(dir->path), prefix, dname, &level) <= 0) {
+			dirs.size -= sizeof(*dir);
+			break;
+		}
+		dir->level = level;
+		n_roots++;
+	}
+
+	if (use_cache) {
+		if (conf_dep_add(&deps, path) < 0)
+			use_cache = false;
+		pw_array_for_each(dir, &dirs)
+			if (conf_dep_add(&deps, dir->path) < 0)
+				use_cache = false;
+	}
+	if (use_cache &&
+	    conf_cache_load(cache_path, &deps, n_roots, conf) == 0) {
+		pw_log_info("%p: loaded config '%s' from cache '%s' with %d items",
+				conf, path, cache_path, conf->dict.n_items);
+		res = 0;
+		goto exit;
+	}
+	n_deps = n_roots;
+
 	pw_properties_set(conf, "config.prefix", prefix);
 	pw_properties_set(conf, "config.name", name);
 	pw_properties_set(conf, "config.path", path);
 
 	if ((res = conf_load(path, conf)) < 0)
-		return res;
+		goto exit;
 
-	pw_properties_setf(conf, "config.name.d", "%s.d", name);
-	dname = pw_properties_get(conf, "config.name.d");
+	pw_properties_set(conf, "config.name.d", dname);
 
-	while (true) {
+	pw_array_for_each(dir, &dirs) {
 		struct dirent **entries = NULL;
 		int n;
 
-		if (get_config_dir(path, sizeof(path), prefix, dname, &level) <= 0)
-			break;
-
-		n = scandir(path, &entries, conf_filter, alphasort);
+		n = scandir(dir->path, &entries, conf_filter, alphasort);
 		if (n == 0)
 			continue;
 		if (n < 0) {
-			pw_log_warn("scandir %s failed: %m", path);
+			pw_log_warn("scandir %s failed: %m", dir->path);
+			cacheable = false;
 			continue;
 		}
 		if (override == NULL &&
-		    (override = pw_properties_new(NULL, NULL)) == NULL)
-			return -errno;
+		    (override = pw_properties_new(NULL, NULL)) == NULL) {
+			res = -errno;
+			goto exit;
+		}
 
 		for (i = 0; i < n; i++) {
 			const char *name = entries[i]->d_name;
 
-			snprintf(fname, sizeof(fname), "%s/%s", path, name);
-			if (check_override(conf, name, level)) {
+			snprintf(fname, sizeof(fname), "%s/%s", dir->path, name);
+			if (use_cache && conf_dep_add(&deps, fname) == 0)
+				n_deps++;
+			else
+				cacheable = false;
+
+			if (check_override(conf, name, dir->level)) {
 				if (conf_load(fname, override) >= 0)
-					add_override(conf, override, fname, name, level, i);
+					add_override(conf, override, fname, name, dir->level, i);
+				else
+					cacheable = false;
 				pw_properties_clear(override);
 			} else {
 				pw_log_info("skip override %s with lower priority", fname);
@@ -530,7 +837,13 @@ int pw_conf_load_conf(const char *prefix, const char *name, struct pw_properties
 		free(entries);
 	}
 
-	return 0;
+	if (use_cache && cacheable)
+		conf_cache_save(cache_path, &deps, n_roots, n_deps, conf);
+	res = 0;
+exit:
+	pw_array_clear(&dirs);
+	pw_array_clear(&deps);
+	return res;
 }
 
 SPA_EXPORT
@@ -629,20 +942,70 @@ static int load_module(struct pw_context *context, const char *key, const char *
  *  "!null" -> same as !null
  *  !"null" and "!\"null\"" matches anything that is not the string "null"
  */
-static bool find_match(struct spa_json *arr, const struct spa_dict *props, bool condition)
+#define MATCH_NEGATE	(1<<0)
+#define MATCH_REGEX	(1<<1)
+#define MATCH_NULL	(1<<2)	/* value is null */
+#define MATCH_INVALID	(1<<3)	/* invalid regex, never matches a value */
+#define MATCH_SKIP	(1<<4)	/* invalid string, ignored when the key exists */
+
+struct match_item {
+	char *key;
+	char *value;
+	regex_t preg;
+	uint32_t flags;
+};
+
+struct match_list {
+	struct pw_array items;		/* all match_item, for all objects */
+	struct pw_array objects;	/* number of items in each object */
+	unsigned int malformed:1;
+};
+
+static void match_list_init(struct match_list *list)
+{
+	pw_array_init(&list->items, sizeof(struct match_item) * 8);
+	pw_array_init(&list->objects, sizeof(uint32_t) * 8);
+	list->malformed = false;
+}
+
+static void match_list_clear(struct match_list *list)
+{
+	struct match_item *item;
+
+	pw_array_for_each(item, &list->items) {
+		free(item->key);
+		free(item->value);
+		if ((item->flags & (MATCH_REGEX | MATCH_INVALID | MATCH_NULL | MATCH_SKIP)) == MATCH_REGEX)
+			regfree(&item->preg);
+	}
+	pw_array_clear(&list->items);
+	pw_array_clear(&list->objects);
+}
+
+/* parse the match array once into a list of items, unescaping the strings and
+ * compiling the regular expressions so that they can be matched against
+ * many objects */
+static int match_list_compile(struct match_list *list, struct spa_json *arr)
 {
 	struct spa_json it[1];
 	const char *as = arr->cur;
-	int az = (int)(arr->end - arr->cur), r, count = 0;
+	int az = (int)(arr->end - arr->cur), r;
 
 	while ((r = spa_json_enter_object(arr, &it[0])) > 0) {
 		char key[256], val[1024];
-		const char *str, *value;
-		int match = 0, fail = 0;
+		const char *value;
+		uint32_t *n_items;
 		int len;
 
+		if ((n_items = pw_array_add(&list->objects, sizeof(uint32_t))) == NULL)
+			return -errno;
+		*n_items = 0;
+
 		while (spa_json_get_string(&it[0], key, sizeof(key)) > 0) {
-			bool success = false, is_null, reg = false, parse_string = true;
+			struct match_item *item;
+			char *k, *v;
+			bool parse_string = true;
+			uint32_t flags = 0;
 			int skip = 0;
 
 			if ((len = spa_json_next(&it[0], &value)) <= 0) {
@@ -668,74 +1031,119 @@ static bool find_match(struct spa_json *arr, const struct spa_dict *props, bool
 			/* parse the modifiers, after the modifier we unescape the string
 			 * again to be able to detect and handle null and "null" */
 			if (len > skip && value[skip] == '!') {
-				success = !success;
+				flags |= MATCH_NEGATE;
 				skip++;
 				parse_string = true;
 			}
 			if (len > skip && value[skip] == '~') {
-				reg = true;
+				flags |= MATCH_REGEX;
 				skip++;
 				parse_string = true;
 			}
 
-			str = spa_dict_lookup(props, key);
-
 			/* parse the remaining part of the string, if there was a modifier,
 			 * we need to check for null again. Otherwise null was in quotes without
 			 * a modifier. */
-			is_null = parse_string && spa_json_is_null(value+skip, len-skip);
-			if (is_null || str == NULL) {
-				if (is_null && str == NULL)
-					success = !success;
-			} else {
+			if (parse_string && spa_json_is_null(value+skip, len-skip)) {
+				flags |= MATCH_NULL;
+			} else if (!parse_string) {
 				/* only unescape string once or again after modifier */
-				if (!parse_string) {
-					memmove(val, value+skip, len-skip);
-					val[len-skip] = '\0';
-				} else if (spa_json_parse_stringn(value+skip, len-skip, val, sizeof(val)) < 0) {
-					pw_log_warn("invalid string '%.*s' in '%.*s'",
-							len-skip, value+skip, az, as);
-					continue;
+				memmove(val, value+skip, len-skip);
+				val[len-skip] = '\0';
+			} else if (spa_json_parse_stringn(value+skip, len-skip, val, sizeof(val)) < 0) {
+				pw_log_warn("invalid string '%.*s' in '%.*s'",
+						len-skip, value+skip, az, as);
+				flags |= MATCH_SKIP;
+			}
+
+			k = strdup(key);
+			v = (flags & (MATCH_NULL | MATCH_SKIP)) ? NULL : strdup(val);
+			if (k == NULL || (v == NULL && !(flags & (MATCH_NULL | MATCH_SKIP))) ||
+			    (item = pw_array_add(&list->items, sizeof(*item))) == NULL) {
+				free(k);
+				free(v);
+				return -errno;
+			}
+			item->flags = flags;
+			item->key = k;
+			item->value = v;
+			(*n_items)++;
+
+			if ((flags & (MATCH_REGEX | MATCH_NULL | MATCH_SKIP)) == MATCH_REGEX) {
+				int res;
+				if ((res = regcomp(&item->preg, val, REG_EXTENDED | REG_NOSUB)) != 0) {
+					char errbuf[1024];
+					regerror(res, &item->preg, errbuf, sizeof(errbuf));
+					pw_log_warn("invalid regex %s: %s in '%.*s'",
+							val, errbuf, az, as);
+					item->flags |= MATCH_INVALID;
 				}
+			}
+		}
+	}
+	if (r < 0) {
+		pw_log_warn("malformed object array in '%.*s'", az, as);
+		list->malformed = true;
+	}
+	return 0;
+}
+
+static bool match_list_eval(const struct match_list *list, const struct spa_dict *props,
+		bool condition)
+{
+	const struct match_item *item = list->items.data;
+	const uint32_t *n_items;
 
-				if (reg) {
-					regex_t preg;
-					int res;
-					if ((res = regcomp(&preg, val, REG_EXTENDED | REG_NOSUB)) != 0) {
-						char errbuf[1024];
-						regerror(res, &preg, errbuf, sizeof(errbuf));
-						pw_log_warn("invalid regex %s: %s in '%.*s'",
-								val, errbuf, az, as);
-					} else {
-						if (regexec(&preg, str, 0, NULL, 0) == 0)
-							success = !success;
-						regfree(&preg);
-					}
-				} else if (strcmp(str, val) == 0) {
+	pw_array_for_each(n_items, &list->objects) {
+		const struct match_item *end = item + *n_items;
+		int match = 0, fail = 0;
+
+		for (; item < end; item++) {
+			bool success = SPA_FLAG_IS_SET(item->flags, MATCH_NEGATE);
+			const char *str = spa_dict_lookup(props, item->key);
+
+			if (SPA_FLAG_IS_SET(item->flags, MATCH_NULL) || str == NULL) {
+				if (SPA_FLAG_IS_SET(item->flags, MATCH_NULL) && str == NULL)
 					success = !success;
-				}
+			} else if (SPA_FLAG_IS_SET(item->flags, MATCH_SKIP)) {
+				continue;
+			} else if (SPA_FLAG_IS_SET(item->flags, MATCH_INVALID)) {
+				/* invalid regex never matches */
+			} else if (SPA_FLAG_IS_SET(item->flags, MATCH_REGEX)) {
+				if (regexec(&item->preg, str, 0, NULL, 0) == 0)
+					success = !success;
+			} else if (strcmp(str, item->value) == 0) {
+				success = !success;
 			}
 			if (success) {
 				match++;
-				pw_log_debug("'%s' match '%s' < > '%.*s'", key, str, len, value);
+				pw_log_debug("'%s' match '%s' < > '%s'", item->key, str, item->value);
 			}
 			else {
-				pw_log_debug("'%s' fail '%s' < > '%.*s'", key, str, len, value);
+				pw_log_debug("'%s' fail '%s' < > '%s'", item->key, str, item->value);
 				fail++;
 				break;
 			}
 		}
 		if (match > 0 && fail == 0)
 			return true;
-		count++;
+		item = end;
 	}
-	if (r < 0)
-		pw_log_warn("malformed object array in '%.*s'", az, as);
-	else if (count == 0 && condition)
-		/* empty match for condition means success */
-		return true;
+	/* empty match for condition means success */
+	return !list->malformed && pw_array_get_len(&list->objects, uint32_t) == 0 &&
+		condition;
+}
 
-	return false;
+static bool find_match(struct spa_json *arr, const struct spa_dict *props, bool condition)
+{
+	struct match_list list;
+	bool res = false;
+
+	match_list_init(&list);
+	if (match_list_compile(&list, arr) >= 0)
+		res = match_list_eval(&list, props, condition);
+	match_list_clear(&list);
+	return res;
 }
 
 /*
@@ -1240,46 +1648,78 @@ int pw_conf_load_conf_for_context(struct pw_properties *props, struct pw_propert
 	return res;
 }
 
-/**
- * [
- *     {
- *         matches = [
- *             # any of the items in matches needs to match, if one does,
- *             # actions are emitted.
- *             {
- *                 # all keys must match the value. ! negates. ~ starts regex.
- *                 <key> = <value>
- *                 ...
- *             }
- *             ...
- *         ]
- *         actions = {
- *             <action> = <value>
- *             ...
- *         }
- *     }
- * ]
- */
-SPA_EXPORT
-int pw_conf_match_rules(const char *str, size_t len, const char *location,
-		const struct spa_dict *props,
-		int (*callback) (void *data, const char *location, const char *action,
-			const char *str, size_t len),
-		void *data)
+struct match_rule {
+	struct match_list matches;
+	const char *actions;
+	int actions_len;
+	unsigned int have_matches:1;
+};
+
+/* rules compiled from a JSON string, cached by their text so that the rules
+ * are parsed once and a changed config results in a new entry */
+struct match_rules {
+	struct spa_list link;
+	int ref;
+	struct pw_array rules;
+	size_t len;
+	char str[];
+};
+
+#define MAX_RULES_CACHE	32
+
+static pthread_mutex_t rules_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct spa_list rules_cache = { &rules_cache, &rules_cache };
+static uint32_t n_rules_cache;
+
+static void match_rules_free(struct match_rules *rules)
+{
+	struct match_rule *rule;
+
+	pw_array_for_each(rule, &rules->rules)
+		match_list_clear(&rule->matches);
+	pw_array_clear(&rules->rules);
+	free(rules);
+}
+
+static void match_rules_unref(struct match_rules *rules)
 {
+	bool destroy;
+
+	pthread_mutex_lock(&rules_lock);
+	destroy = --rules->ref == 0;
+	pthread_mutex_unlock(&rules_lock);
+
+	if (destroy)
+		match_rules_free(rules);
+}
+
+static struct match_rules *match_rules_compile(const char *str, size_t len)
+{
+	struct match_rules *rules;
+	struct match_rule *rule;
+	struct spa_json it[4];
 	const char *val;
-	struct spa_json it[4], actions;
-	int r;
+	int r, l;
 
-	spa_json_init(&it[0], str, len);
+	if ((rules = calloc(1, sizeof(*rules) + len + 1)) == NULL)
+		return NULL;
+	memcpy(rules->str, str, len);
+	rules->len = len;
+	pw_array_init(&rules->rules, sizeof(struct match_rule) * 8);
+
+	spa_json_init(&it[0], rules->str, len);
 	if (spa_json_enter_array(&it[0], &it[1]) < 0) {
 		pw_log_warn("expect array of match rules in: '%.*s'", (int)len, str);
-		return 0;
+		return rules;
 	}
 
 	while ((r = spa_json_enter_object(&it[1], &it[2])) > 0) {
 		char key[64];
-		bool have_match = false, have_actions = false;
+
+		if ((rule = pw_array_add(&rules->rules, sizeof(*rule))) == NULL)
+			goto error;
+		spa_zero(*rule);
+		match_list_init(&rule->matches);
 
 		while (spa_json_get_string(&it[2], key, sizeof(key)) > 0) {
 			if (spa_streq(key, "matches")) {
@@ -1288,15 +1728,23 @@ int pw_conf_match_rules(const char *str, size_t len, const char *location,
 							(int)len, str);
 					break;
 				}
-
-				have_match = find_match(&it[3], props, false);
+				/* the last matches is used */
+				match_list_clear(&rule->matches);
+				match_list_init(&rule->matches);
+				if (match_list_compile(&rule->matches, &it[3]) < 0)
+					goto error;
+				rule->have_matches = true;
 			}
 			else if (spa_streq(key, "actions")) {
-				if (spa_json_enter_object(&it[2], &actions) > 0)
-					have_actions = true;
-				else
+				if ((l = spa_json_next(&it[2], &val)) > 0 &&
+				    spa_json_is_object(val, l)) {
+					rule->actions = val;
+					rule->actions_len = spa_json_container_len(&it[2], val, l);
+				} else {
+					rule->actions = NULL;
 					pw_log_warn("expected object as match actions in '%.*s'",
 							(int)len, str);
+				}
 			}
 			else {
 				pw_log_warn("unknown match key '%s'", key);
@@ -1307,33 +1755,147 @@ int pw_conf_match_rules(const char *str, size_t len, const char *location,
 				}
 			}
 		}
-		if (!have_match)
+	}
+	if (r < 0)
+		pw_log_warn("malformed object array in '%.*s'", (int)len, str);
+	return rules;
+
+error:
+	pw_log_warn("can't compile match rules: %m");
+	match_rules_free(rules);
+	return NULL;
+}
+
+static struct match_rules *match_rules_get(const char *str, size_t len)
+{
+	struct match_rules *rules, *old = NULL;
+
+	pthread_mutex_lock(&rules_lock);
+	spa_list_for_each(rules, &rules_cache, link) {
+		if (rules->len == len && memcmp(rules->str, str, len) == 0) {
+			spa_list_remove(&rules->link);
+			spa_list_prepend(&rules_cache, &rules->link);
+			rules->ref++;
+			pthread_mutex_unlock(&rules_lock);
+			return rules;
+		}
+	}
+	pthread_mutex_unlock(&rules_lock);
+
+	if ((rules = match_rules_compile(str, len)) == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&rules_lock);
+	rules->ref = 2;
+	spa_list_prepend(&rules_cache, &rules->link);
+	if (++n_rules_cache > MAX_RULES_CACHE) {
+		old = spa_list_last(&rules_cache, struct match_rules, link);
+		spa_list_remove(&old->link);
+		n_rules_cache--;
+		if (--old->ref > 0)
+			old = NULL;
+	}
+	pthread_mutex_unlock(&rules_lock);
+
+	if (old)
+		match_rules_free(old);
+	return rules;
+}
+
+void pw_conf_clear_match_cache(void)
+{
+	struct match_rules *rules;
+	struct spa_list free_list;
+
+	spa_list_init(&free_list);
+
+	pthread_mutex_lock(&rules_lock);
+	spa_list_consume(rules, &rules_cache, link) {
+		spa_list_remove(&rules->link);
+		if (--rules->ref == 0)
+			spa_list_append(&free_list, &rules->link);
+	}
+	n_rules_cache = 0;
+	pthread_mutex_unlock(&rules_lock);
+
+	spa_list_consume(rules, &free_list, link) {
+		spa_list_remove(&rules->link);
+		match_rules_free(rules);
+	}
+}
+
+/**
+ * [
+ *     {
+ *         matches = [
+ *             # any of the items in matches needs to match, if one does,
+ *             # actions are emitted.
+ *             {
+ *                 # all keys must match the value. ! negates. ~ starts regex.
+ *                 <key> = <value>
+ *                 ...
+ *             }
+ *             ...
+ *         ]
+ *         actions = {
+ *             <action> = <value>
+ *             ...
+ *         }
+ *     }
+ * ]
+ */
+SPA_EXPORT
+int pw_conf_match_rules(const char *str, size_t len, const char *location,
+		const struct spa_dict *props,
+		int (*callback) (void *data, const char *location, const char *action,
+			const char *str, size_t len),
+		void *data)
+{
+	struct match_rules *rules;
+	struct match_rule *rule;
+	int res = 0;
+
+	/* the rules are compiled once and reused for all objects, the actions
+	 * point into the cached copy of the rules */
+	if ((rules = match_rules_get(str, len)) == NULL)
+		return -errno;
+
+	pw_array_for_each(rule, &rules->rules) {
+		struct spa_json it[2];
+		const char *val;
+		char key[64];
+
+		if (!rule->have_matches || !match_list_eval(&rule->matches, props, false))
 			continue;
-		if (!have_actions) {
+		if (rule->actions == NULL) {
 			pw_log_warn("no actions for match rule '%.*s'", (int)len, str);
 			continue;
 		}
 
-		while (spa_json_get_string(&actions, key, sizeof(key)) > 0) {
-			int res, len;
+		spa_json_init(&it[0], rule->actions, rule->actions_len);
+		if (spa_json_enter_object(&it[0], &it[1]) <= 0)
+			continue;
+
+		while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+			int l;
 			pw_log_debug("action %s", key);
 
-			if ((len = spa_json_next(&actions, &val)) <= 0) {
+			if ((l = spa_json_next(&it[1], &val)) <= 0) {
 				pw_log_warn("malformed action: key '%s' has no value in '%.*s'",
 						key, (int)len, str);
 				break;
 			}
 
-			if (spa_json_is_container(val, len))
-				len = spa_json_container_len(&actions, val, len);
+			if (spa_json_is_container(val, l))
+				l = spa_json_container_len(&it[1], val, l);
 
-			if ((res = callback(data, location, key, val, len)) < 0)
-				return res;
+			if ((res = callback(data, location, key, val, l)) < 0)
+				goto done;
 		}
 	}
-	if (r < 0)
-		pw_log_warn("malformed object array in '%.*s'", (int)len, str);
-	return 0;
+done:
+	match_rules_unref(rules);
+	return res < 0 ? res : 0;
 }
 
 struct match {
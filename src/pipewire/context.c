@@ -360,6 +360,8 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	spa_list_init(&this->control_list[1]);
 	spa_list_init(&this->export_list);
 	spa_list_init(&this->driver_list);
+	spa_list_init(&this->buffer_cache.entries);
+	spa_list_init(&this->format_cache.entries);
 	spa_hook_list_init(&this->listener_list);
 	spa_hook_list_init(&this->driver_listener_list);
 
@@ -432,11 +434,15 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	if ((res = setup_data_loops(impl)) < 0)
 		goto error_free;
 
-	this->pool = pw_mempool_new(NULL);
+	this->pool = pw_context_new_mempool(this);
 	if (this->pool == NULL) {
 		res = -errno;
 		goto error_free;
 	}
+	this->buffer_cache.max_size = pw_properties_get_uint64(properties,
+			"mem.cache-size", 0);
+	this->format_cache.max_entries = pw_properties_get_uint32(properties,
+			"link.format-cache", 0);
 
 	this->main_loop = main_loop;
 	this->work_queue = pw_work_queue_new(this->main_loop);
@@ -520,6 +526,26 @@ error_cleanup:
 	return NULL;
 }
 
+struct format_entry {
+	struct spa_list link;
+	uint64_t output_serial;
+	uint64_t input_serial;
+	struct spa_pod *format;
+};
+
+static void format_cache_evict(struct pw_context *context, uint32_t max_entries)
+{
+	struct format_entry *e;
+
+	while (context->format_cache.n_entries > max_entries) {
+		e = spa_list_last(&context->format_cache.entries, struct format_entry, link);
+		spa_list_remove(&e->link);
+		context->format_cache.n_entries--;
+		free(e->format);
+		free(e);
+	}
+}
+
 /** Destroy a context object
  *
  * \param context a context to destroy
@@ -582,8 +608,12 @@ void pw_context_destroy(struct pw_context *context)
 
 	}
 
-	if (context->pool)
+	format_cache_evict(context, 0);
+
+	if (context->pool) {
+		pw_buffers_cache_clear(context);
 		pw_mempool_destroy(context->pool);
+	}
 
 	if (context->work_queue)
 		pw_work_queue_destroy(context->work_queue);
@@ -638,6 +668,8 @@ const struct spa_support *context_get_support(struct pw_context *context, uint32
 		context->support[n++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_DataSystem, loop->system);
 		context->support[n++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_DataLoop, loop->loop);
 	}
+	context->support[n++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_ThreadUtils,
+			context->thread_utils ? context->thread_utils : pw_thread_utils_get());
 	*n_support = n;
 	return context->support;
 }
@@ -764,6 +796,27 @@ struct pw_mempool *pw_context_get_mempool(struct pw_context *context)
 	return context->pool;
 }
 
+/** Make a new mempool with the memory properties of the context */
+struct pw_mempool *pw_context_new_mempool(struct pw_context *context)
+{
+	static const char * const keys[] = {
+		"mem.hugepages",
+		"mem.prefault",
+		"mem.slab-size",
+		NULL
+	};
+	struct pw_properties *props;
+	struct pw_mempool *pool;
+
+	if ((props = pw_properties_new(NULL, NULL)) == NULL)
+		return NULL;
+	pw_properties_update_keys(props, &context->properties->dict, keys);
+
+	if ((pool = pw_mempool_new(props)) == NULL)
+		pw_properties_free(props);
+	return pool;
+}
+
 SPA_EXPORT
 const struct pw_properties *pw_context_get_properties(struct pw_context *context)
 {
@@ -894,6 +947,52 @@ SPA_PRINTF_FUNC(7, 8) int pw_context_debug_port_params(struct pw_context *this,
         return 0;
 }
 
+/* Find a format that was negotiated before between the ports. The serials of
+ * the ports change when their EnumFormat param changes so stale entries are
+ * never found again and are evicted eventually. */
+static struct spa_pod *format_cache_find(struct pw_context *context,
+		struct pw_impl_port *output, struct pw_impl_port *input,
+		struct spa_pod_builder *builder)
+{
+	struct format_entry *e;
+	struct spa_pod_builder_state state;
+
+	spa_list_for_each(e, &context->format_cache.entries, link) {
+		if (e->output_serial != output->format_serial ||
+		    e->input_serial != input->format_serial)
+			continue;
+
+		spa_list_remove(&e->link);
+		spa_list_prepend(&context->format_cache.entries, &e->link);
+
+		spa_pod_builder_get_state(builder, &state);
+		if (spa_pod_builder_raw_padded(builder, e->format, SPA_POD_SIZE(e->format)) < 0)
+			return NULL;
+		return spa_pod_builder_deref(builder, state.offset);
+	}
+	return NULL;
+}
+
+static void format_cache_add(struct pw_context *context,
+		struct pw_impl_port *output, struct pw_impl_port *input,
+		const struct spa_pod *format)
+{
+	struct format_entry *e;
+
+	if ((e = calloc(1, sizeof(*e))) == NULL)
+		return;
+	if ((e->format = spa_pod_copy(format)) == NULL) {
+		free(e);
+		return;
+	}
+	e->output_serial = output->format_serial;
+	e->input_serial = input->format_serial;
+
+	format_cache_evict(context, context->format_cache.max_entries - 1);
+	spa_list_prepend(&context->format_cache.entries, &e->link);
+	context->format_cache.n_entries++;
+}
+
 /** Find a common format between two ports
  *
  * \param context a context object
@@ -930,6 +1029,7 @@ int pw_context_find_format(struct pw_context *context,
 	struct spa_pod *filter;
 	struct spa_node *in_node, *out_node;
 	uint32_t in_port, out_port;
+	bool use_cache;
 
 	out_state = output->state;
 	in_state = input->state;
@@ -1018,6 +1118,15 @@ int pw_context_find_format(struct pw_context *context,
 			}
 		}
 	} else if (in_state == PW_IMPL_PORT_STATE_CONFIGURE && out_state == PW_IMPL_PORT_STATE_CONFIGURE) {
+		use_cache = context->format_cache.max_entries > 0 &&
+			output_mix == SPA_ID_INVALID && input_mix == SPA_ID_INVALID;
+
+		if (use_cache &&
+		    (*format = format_cache_find(context, output, input, builder)) != NULL) {
+			pw_log_debug("%p: using cached format:", context);
+			pw_log_format(SPA_LOG_LEVEL_DEBUG, *format);
+			return 1;
+		}
 	      again:
 		/* both ports need a format */
 		pw_log_debug("%p: do enum input %d", context, iidx);
@@ -1054,6 +1163,9 @@ int pw_context_find_format(struct pw_context *context,
 
 		pw_log_debug("%p: Got filtered:", context);
 		pw_log_format(SPA_LOG_LEVEL_DEBUG, *format);
+
+		if (use_cache)
+			format_cache_add(context, output, input, *format);
 	} else {
 		res = -EBADF;
 		*error = spa_aprintf("error bad node state");
@@ -1074,6 +1186,13 @@ static int ensure_state(struct pw_impl_node *node, bool running)
 		state = PW_NODE_STATE_RUNNING;
 	else if (state > PW_NODE_STATE_IDLE)
 		state = PW_NODE_STATE_IDLE;
+
+	/* nothing changed for this node since the last recalc and it is
+	 * already in the right state, skip the state update */
+	if (pw_impl_node_state_is_settled(node, state))
+		return 0;
+
+	node->recalc_state = false;
 	return pw_impl_node_set_state(node, state);
 }
 
@@ -1289,6 +1408,50 @@ static void remove_from_driver(struct pw_context *context, struct spa_list *node
 	}
 }
 
+/* Update the processing time estimate of the followers of a driver and calculate
+ * the critical path of each follower, which is the longest sum of processing
+ * times from the follower to the end of the graph. The targets of the nodes are
+ * then sorted so that the longest chains are started first. */
+static void sort_followers(struct pw_context *context, struct pw_impl_node *driver)
+{
+	struct pw_impl_node *s;
+	struct pw_node_peer *p;
+	bool changed = true;
+	int hop;
+
+	spa_list_for_each(s, &driver->follower_list, follower_link) {
+		struct pw_node_activation *a = s->rt.target.activation;
+		uint64_t awake = a->awake_time, finish = a->finish_time;
+
+		if (s != driver && finish > awake)
+			s->process_time = (s->process_time * 7 + (finish - awake)) / 8;
+		s->critical_path = s->process_time;
+	}
+	/* relax the critical path until it is stable, feedback loops in the
+	 * graph will stop after MAX_HOPS */
+	for (hop = 0; changed && hop < MAX_HOPS; hop++) {
+		changed = false;
+		spa_list_for_each(s, &driver->follower_list, follower_link) {
+			if (s == driver)
+				continue;
+			spa_list_for_each(p, &s->peer_list, link) {
+				struct pw_impl_node *t = p->target.node;
+				uint64_t cp;
+
+				if (t == NULL || t == driver || t->driver_node != driver)
+					continue;
+				cp = s->process_time + t->critical_path;
+				if (cp > s->critical_path) {
+					s->critical_path = cp;
+					changed = true;
+				}
+			}
+		}
+	}
+	spa_list_for_each(s, &driver->follower_list, follower_link)
+		pw_impl_node_sort_targets(s);
+}
+
 static inline void get_quantums(struct pw_context *context, uint32_t *def,
 		uint32_t *min, uint32_t *max, uint32_t *rate, uint32_t *floor, uint32_t *ceil)
 {
@@ -1812,6 +1975,10 @@ again:
 			target_quantum = node_def_quantum;
 			if (latency.denom != 0)
 				target_quantum = (latency.num * current_rate / latency.denom);
+			else if (settings->clock_elastic_quantum && !force_quantum)
+				/* nobody asked for a latency, use the largest quantum
+				 * allowed by the max-latency of the followers */
+				target_quantum = node_max_quantum;
 			target_quantum = SPA_CLAMP(target_quantum, node_min_quantum, node_max_quantum);
 			target_quantum = SPA_CLAMP(target_quantum, floor_quantum, ceil_quantum);
 
@@ -1865,6 +2032,8 @@ again:
 				n->rt.position->clock.target_duration,
 				n->rt.position->clock.target_rate.denom, n->name);
 
+		sort_followers(context, n);
+
 		/* first change the node states of the followers to the new target */
 		spa_list_for_each(s, &n->follower_list, follower_link) {
 			if (s->transport)
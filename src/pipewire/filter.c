@@ -117,6 +117,11 @@ struct filter {
 
 	struct spa_list port_list;
 	struct pw_map ports[2];
+	uint32_t n_ports;
+
+	/* data pointers of the input and then the output ports */
+	void **port_buffers;
+	uint32_t max_port_buffers;
 
 	uint64_t change_mask_all;
 	struct spa_node_info info;
@@ -145,6 +150,7 @@ struct filter {
 	unsigned int allow_mlock:1;
 	unsigned int warn_mlock:1;
 	unsigned int trigger:1;
+	unsigned int process_buffers:1;
 	int in_emit_param_changed;
 };
 
@@ -324,12 +330,56 @@ static void clear_params(struct filter *impl, struct port *port, uint32_t id)
 	}
 }
 
+struct port_buffers {
+	void **buffers;
+	uint32_t max_buffers;
+};
+
+static int
+do_set_port_buffers(struct spa_loop *loop,
+                 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct filter *impl = user_data;
+	const struct port_buffers *pb = data;
+	impl->port_buffers = pb->buffers;
+	impl->max_port_buffers = pb->max_buffers;
+	return 0;
+}
+
+static int ensure_port_buffers(struct filter *filter, uint32_t n_ports)
+{
+	struct port_buffers pb;
+	void **old = filter->port_buffers;
+
+	if (n_ports <= filter->max_port_buffers)
+		return 0;
+
+	pb.max_buffers = SPA_MAX(filter->max_port_buffers * 2, 16u);
+	while (pb.max_buffers < n_ports)
+		pb.max_buffers *= 2;
+	if ((pb.buffers = calloc(pb.max_buffers * 2, sizeof(void *))) == NULL)
+		return -errno;
+
+	if (filter->data_loop)
+		pw_loop_invoke(filter->data_loop, do_set_port_buffers, 1,
+				&pb, sizeof(pb), true, filter);
+	else
+		do_set_port_buffers(NULL, false, 1, &pb, sizeof(pb), filter);
+	free(old);
+	return 0;
+}
+
 static struct port *alloc_port(struct filter *filter,
 		enum spa_direction direction, uint32_t user_data_size)
 {
 	struct port *p;
 
+	if (ensure_port_buffers(filter, filter->n_ports + 1) < 0)
+		return NULL;
+
 	p = calloc(1, sizeof(struct port) + user_data_size);
+	if (p == NULL)
+		return NULL;
 	p->filter = filter;
 	p->direction = direction;
 	p->latency[SPA_DIRECTION_INPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT);
@@ -340,6 +390,7 @@ static struct port *alloc_port(struct filter *filter,
 	spa_ringbuffer_init(&p->queued.ring);
 	p->id = pw_map_insert_new(&filter->ports[direction], p);
 	spa_list_append(&filter->port_list, &p->link);
+	filter->n_ports++;
 
 	return p;
 }
@@ -969,10 +1020,56 @@ static int impl_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffe
 	return 0;
 }
 
+static inline void *get_dsp_buffer(struct port *p, uint32_t n_samples)
+{
+	struct buffer *b;
+	struct spa_data *d;
+
+	if (SPA_UNLIKELY((b = pop_queue(p, &p->dequeued)) == NULL))
+		return NULL;
+
+	d = &b->this.buffer->datas[0];
+
+	if (p->direction == SPA_DIRECTION_OUTPUT) {
+		d->chunk->offset = 0;
+		d->chunk->size = n_samples * sizeof(float);
+		d->chunk->stride = sizeof(float);
+		d->chunk->flags = 0;
+	}
+	push_queue(p, &p->queued, b);
+
+	return d->data;
+}
+
+static void call_process_buffers(struct filter *impl)
+{
+	struct spa_io_position *position = impl->this.node->rt.position;
+	uint32_t n_samples = position ? position->clock.duration : 0;
+	uint32_t n_in = 0, n_out = 0, max = impl->max_port_buffers;
+	void **in = impl->port_buffers, **out = in + max;
+	struct port *p;
+
+	spa_list_for_each(p, &impl->port_list, link) {
+		if (p->direction == SPA_DIRECTION_INPUT) {
+			if (SPA_LIKELY(n_in < max))
+				in[n_in++] = get_dsp_buffer(p, n_samples);
+		} else {
+			if (SPA_LIKELY(n_out < max))
+				out[n_out++] = get_dsp_buffer(p, n_samples);
+		}
+	}
+	spa_callbacks_call_fast(&impl->rt_callbacks, struct pw_filter_events,
+			process_buffers, 0, position, n_in, in, n_out, out);
+}
+
 static void call_process(struct filter *impl)
 {
 	pw_log_trace_fp("%p: call process", impl);
-	if (impl->rt_callbacks.funcs)
+	if (impl->rt_callbacks.funcs == NULL)
+		return;
+	if (impl->process_buffers)
+		call_process_buffers(impl);
+	else
 		spa_callbacks_call_fast(&impl->rt_callbacks, struct pw_filter_events,
 				process, 0, impl->this.node->rt.position);
 }
@@ -1368,6 +1465,7 @@ static int filter_disconnect(struct filter *impl)
 static void free_port(struct filter *impl, struct port *port)
 {
 	spa_list_remove(&port->link);
+	impl->n_ports--;
 	spa_node_emit_port_info(&impl->hooks, port->direction, port->id, NULL);
 	pw_map_remove(&impl->ports[port->direction], port->id);
 	clear_buffers(port);
@@ -1417,6 +1515,7 @@ void pw_filter_destroy(struct pw_filter *filter)
 	if (impl->data.context)
 		pw_context_destroy(impl->data.context);
 
+	free(impl->port_buffers);
 	free(impl);
 }
 
@@ -1451,7 +1550,10 @@ void pw_filter_add_listener(struct pw_filter *filter,
 	ensure_loop(impl->main_loop);
 
 	spa_hook_list_append(&filter->listener_list, listener, events, data);
-	if (events->process && impl->rt_callbacks.funcs == NULL) {
+	if ((events->process ||
+	    (events->version >= 2 && events->process_buffers)) &&
+	    impl->rt_callbacks.funcs == NULL) {
+		impl->process_buffers = events->version >= 2 && events->process_buffers;
 		impl->rt_callbacks = SPA_CALLBACKS_INIT(events, data);
 		listener->removed = hook_removed;
 		listener->priv = impl;
@@ -1995,26 +2097,69 @@ int pw_filter_queue_buffer(void *port_data, struct pw_buffer *buffer)
 }
 
 SPA_EXPORT
-void *pw_filter_get_dsp_buffer(void *port_data, uint32_t n_samples)
+int pw_filter_dequeue_buffers(void *port_data, struct pw_buffer **buffers,
+		uint32_t n_buffers)
 {
 	struct port *p = SPA_CONTAINER_OF(port_data, struct port, user_data);
-	struct pw_buffer *buf;
-	struct spa_data *d;
+	struct queue *queue = &p->dequeued;
+	struct buffer *b;
+	uint32_t index, i, n;
+	int32_t avail;
 
-	if (SPA_UNLIKELY((buf = pw_filter_dequeue_buffer(port_data)) == NULL))
-		return NULL;
+	/* take the buffers with one update of the queue */
+	avail = spa_ringbuffer_get_read_index(&queue->ring, &index);
+	n = SPA_CLAMP(avail, 0, (int32_t)SPA_MIN(n_buffers, (uint32_t)INT32_MAX));
 
-	d = &buf->buffer->datas[0];
+	for (i = 0; i < n; i++) {
+		b = &p->buffers[queue->ids[(index + i) & MASK_BUFFERS]];
+		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_QUEUED);
+		buffers[i] = &b->this;
+	}
+	if (n > 0)
+		spa_ringbuffer_read_update(&queue->ring, index + n);
 
-	if (p->direction == SPA_DIRECTION_OUTPUT) {
-		d->chunk->offset = 0;
-		d->chunk->size = n_samples * sizeof(float);
-		d->chunk->stride = sizeof(float);
-		d->chunk->flags = 0;
+	pw_log_trace_fp("%p: dequeued %u/%u buffers", p->filter, n, n_buffers);
+	return n;
+}
+
+SPA_EXPORT
+int pw_filter_queue_buffers(void *port_data, struct pw_buffer **buffers,
+		uint32_t n_buffers)
+{
+	struct port *p = SPA_CONTAINER_OF(port_data, struct port, user_data);
+	struct queue *queue = &p->queued;
+	struct buffer *b;
+	uint32_t index, i, j;
+
+	for (i = 0; i < n_buffers; i++) {
+		b = SPA_CONTAINER_OF(buffers[i], struct buffer, this);
+		if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_QUEUED))
+			return -EINVAL;
+		for (j = 0; j < i; j++)
+			if (buffers[j] == buffers[i])
+				return -EINVAL;
 	}
-	pw_filter_queue_buffer(port_data, buf);
+	if (n_buffers == 0)
+		return 0;
 
-	return d->data;
+	/* add the buffers with one update of the queue */
+	spa_ringbuffer_get_write_index(&queue->ring, &index);
+	for (i = 0; i < n_buffers; i++) {
+		b = SPA_CONTAINER_OF(buffers[i], struct buffer, this);
+		SPA_FLAG_SET(b->flags, BUFFER_FLAG_QUEUED);
+		queue->ids[(index + i) & MASK_BUFFERS] = b->id;
+	}
+	spa_ringbuffer_write_update(&queue->ring, index + n_buffers);
+
+	pw_log_trace_fp("%p: queued %u buffers", p->filter, n_buffers);
+	return 0;
+}
+
+SPA_EXPORT
+void *pw_filter_get_dsp_buffer(void *port_data, uint32_t n_samples)
+{
+	struct port *p = SPA_CONTAINER_OF(port_data, struct port, user_data);
+	return get_dsp_buffer(p, n_samples);
 }
 
 static int
@@ -57,7 +57,7 @@ struct pw_buffer {
 /** Events for a filter. These events are always called from the mainloop
  * unless explicitly documented otherwise. */
 struct pw_filter_events {
-#define PW_VERSION_FILTER_EVENTS	1
+#define PW_VERSION_FILTER_EVENTS	2
 	uint32_t version;
 
 	void (*destroy) (void *data);
@@ -87,6 +87,15 @@ struct pw_filter_events {
 
 	/** A command notify, Since 0.3.39:1 */
 	void (*command) (void *data, const struct spa_command *command);
+
+	/** do processing with the data of the ports. When set, this is called
+	 *  instead of process. \a in and \a out contain the data pointers of
+	 *  the input and output ports in the order the ports were added, as
+	 *  pw_filter_get_dsp_buffer() would return them for
+	 *  position->clock.duration samples. A pointer is NULL when the port
+	 *  has no data. Since 1.3.0:2 */
+	void (*process_buffers) (void *data, struct spa_io_position *position,
+			uint32_t n_in, void **in, uint32_t n_out, void **out);
 };
 
 /** Convert a filter state to a readable string  */
@@ -230,6 +239,17 @@ struct pw_buffer *pw_filter_dequeue_buffer(void *port_data);
 /** Submit a buffer for playback or recycle a buffer for capture. */
 int pw_filter_queue_buffer(void *port_data, struct pw_buffer *buffer);
 
+/** Get up to \a n_buffers buffers of a port at once.
+ * \return the number of buffers, 0 when there are none or < 0 on error */
+int pw_filter_dequeue_buffers(void *port_data, struct pw_buffer **buffers,
+		uint32_t n_buffers);
+
+/** Submit or recycle \a n_buffers buffers of a port at once. Either all or
+ * none of the buffers are queued.
+ * \return 0 on success or < 0 on error */
+int pw_filter_queue_buffers(void *port_data, struct pw_buffer **buffers,
+		uint32_t n_buffers);
+
 /** Get a data pointer to the buffer data */
 void *pw_filter_get_dsp_buffer(void *port_data, uint32_t n_samples);
 
@@ -342,7 +342,6 @@ SPA_EXPORT
 int pw_global_update_permissions(struct pw_global *global, struct pw_impl_client *client,
 		uint32_t old_permissions, uint32_t new_permissions)
 {
-	struct pw_context *context = global->context;
 	struct pw_resource *resource, *t;
 	bool do_hide, do_show;
 
@@ -354,10 +353,7 @@ int pw_global_update_permissions(struct pw_global *global, struct pw_impl_client
 
 	pw_global_emit_permissions_changed(global, client, old_permissions, new_permissions);
 
-	spa_list_for_each(resource, &context->registry_resource_list, link) {
-		if (resource->client != client)
-			continue;
-
+	spa_list_for_each(resource, &client->registry_list, registry_link) {
 		if (do_hide) {
 			pw_log_debug("client %p: resource %p hide global %d",
 					client, resource, global->id);
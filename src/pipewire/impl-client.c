@@ -21,6 +21,7 @@ struct impl {
 	struct pw_array permissions;
 	struct spa_hook pool_listener;
 	unsigned int registered:1;
+	unsigned int memory_pending:1;
 };
 
 #define pw_client_resource(r,m,v,...)		pw_resource_call(r,struct pw_client_events,m,v,__VA_ARGS__)
@@ -161,6 +162,7 @@ static bool check_client_property_update(struct pw_impl_client *client,
 		PW_KEY_OBJECT_ID,
 		PW_KEY_OBJECT_SERIAL,
 		PW_KEY_ACCESS,
+		PW_KEY_CLIENT_MEMORY,
 		NULL
 	};
 
@@ -373,6 +375,35 @@ error_resource:
 	return -errno;
 }
 
+static void do_update_memory(void *obj, void *data, int res, uint32_t id)
+{
+	struct impl *impl = obj;
+	struct pw_impl_client *client = &impl->this;
+	struct pw_mempool_stats stats;
+	struct spa_dict_item items[1];
+	char size[32];
+
+	impl->memory_pending = false;
+
+	pw_mempool_get_stats(client->pool, &stats);
+	spa_scnprintf(size, sizeof(size), "%"PRIu64, stats.size);
+	items[0] = SPA_DICT_ITEM_INIT(PW_KEY_CLIENT_MEMORY, size);
+	update_properties(client, &SPA_DICT_INIT_ARRAY(items), false);
+}
+
+/* blocks come and go in bursts when links are made, update the
+ * property once when the burst is over */
+static void schedule_update_memory(struct impl *impl)
+{
+	struct pw_impl_client *client = &impl->this;
+
+	if (impl->memory_pending || client->destroyed)
+		return;
+	impl->memory_pending = true;
+	pw_work_queue_add(pw_context_get_work_queue(client->context),
+			impl, 0, do_update_memory, NULL);
+}
+
 static void pool_added(void *data, struct pw_memblock *block)
 {
 	struct impl *impl = data;
@@ -384,6 +415,7 @@ static void pool_added(void *data, struct pw_memblock *block)
 				block->id, block->type, block->fd,
 				block->flags & (PW_MEMBLOCK_FLAG_READWRITE | PW_MEMBLOCK_FLAG_UNMAPPABLE));
 	}
+	schedule_update_memory(impl);
 }
 
 static void pool_removed(void *data, struct pw_memblock *block)
@@ -393,6 +425,7 @@ static void pool_removed(void *data, struct pw_memblock *block)
 	pw_log_debug("%p: removed block %d", client, block->id);
 	if (client->core_resource)
 		pw_core_resource_remove_mem(client->core_resource, block->id);
+	schedule_update_memory(impl);
 }
 
 static const struct pw_mempool_events pool_events = {
@@ -467,7 +500,7 @@ struct pw_impl_client *pw_context_create_client(struct pw_impl_core *core,
 	p->id = PW_ID_ANY;
 	p->permissions = 0;
 
-	this->pool = pw_mempool_new(NULL);
+	this->pool = pw_context_new_mempool(this->context);
 	if (this->pool == NULL) {
 		res = -errno;
 		goto error_clear_array;
@@ -477,6 +510,7 @@ struct pw_impl_client *pw_context_create_client(struct pw_impl_core *core,
 	this->properties = properties;
 	this->permission_func = client_permission_func;
 	this->permission_data = impl;
+	spa_list_init(&this->registry_list);
 
 	if (user_data_size > 0)
 		this->user_data = SPA_PTROFF(impl, sizeof(struct impl), void);
@@ -668,6 +702,7 @@ void pw_impl_client_destroy(struct pw_impl_client *client)
 	pw_impl_client_emit_destroy(client);
 
 	spa_hook_remove(&impl->context_listener);
+	pw_work_queue_cancel(pw_context_get_work_queue(client->context), impl, SPA_ID_INVALID);
 
 	if (client->registered)
 		spa_list_remove(&client->link);
@@ -743,6 +778,8 @@ int pw_impl_client_update_permissions(struct pw_impl_client *client,
 					client, old_perm, new_perm);
 
 			def->permissions = new_perm;
+			if (old_perm == new_perm)
+				continue;
 
 			spa_list_for_each(global, &context->global_list, link) {
 				if (global->id == client->info.id)
@@ -795,6 +832,16 @@ void pw_impl_client_set_busy(struct pw_impl_client *client, bool busy)
 	}
 }
 
+SPA_EXPORT
+void pw_impl_client_set_congested(struct pw_impl_client *client, bool congested)
+{
+	if (client->congested != congested) {
+		pw_log_debug("%p: congested %d", client, congested);
+		client->congested = congested;
+		pw_impl_client_emit_congested_changed(client, congested);
+	}
+}
+
 SPA_EXPORT
 int pw_impl_client_check_permissions(struct pw_impl_client *client,
 		uint32_t global_id, uint32_t permissions)
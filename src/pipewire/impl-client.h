@@ -70,7 +70,7 @@ struct pw_impl_client;
 
 /** The events that a client can emit */
 struct pw_impl_client_events {
-#define PW_VERSION_IMPL_CLIENT_EVENTS	0
+#define PW_VERSION_IMPL_CLIENT_EVENTS	1
         uint32_t version;
 
 	/** emitted when the client is destroyed */
@@ -95,6 +95,11 @@ struct pw_impl_client_events {
 	 * message. In the busy state no messages should be processed.
 	 * Processing should resume when the client becomes not busy */
 	void (*busy_changed) (void *data, bool busy);
+
+	/** emitted when the client does not read its messages fast enough
+	 * and messages are queued. When the client is no longer congested,
+	 * the updates that were held back should be sent. Since version 1 */
+	void (*congested_changed) (void *data, bool congested);
 };
 
 /** Create a new client. This is mainly used by protocols. */
@@ -159,6 +164,11 @@ void pw_impl_client_add_listener(struct pw_impl_client *client,
   * started and no further processing is allowed to happen for the client */
 void pw_impl_client_set_busy(struct pw_impl_client *client, bool busy);
 
+/** Mark the client congested. This is used by protocols when the messages
+  * for the client can't be sent. Objects can then hold back and merge
+  * updates until the client is no longer congested */
+void pw_impl_client_set_congested(struct pw_impl_client *client, bool congested);
+
 /**
  * \}
  */
@@ -141,6 +141,7 @@ static void destroy_registry_resource(void *_data)
 	struct resource_data *data = _data;
 	struct pw_resource *resource = data->resource;
 	spa_list_remove(&resource->link);
+	spa_list_remove(&resource->registry_link);
 	spa_hook_remove(&data->resource_listener);
 	spa_hook_remove(&data->object_listener);
 }
@@ -261,6 +262,7 @@ static struct pw_registry *core_get_registry(void *object, uint32_t version, siz
 				data);
 
 	spa_list_append(&context->registry_resource_list, &registry_resource->link);
+	spa_list_append(&client->registry_list, &registry_resource->registry_link);
 
 	spa_list_for_each(global, &context->global_list, link) {
 		uint32_t permissions = pw_global_get_permissions(global, client);
@@ -92,6 +92,32 @@ static inline void output_set_busy_id(struct pw_impl_link *link, uint32_t id)
 		pw_log_error("%s: invalid busy count:%d", link->name, link->output->busy_count);
 }
 
+/* all links of an output port use the same buffers, the peers read from
+ * them without copying. Keep the number of links that do this in the port
+ * properties. */
+static void update_shared_links(struct pw_impl_port *port)
+{
+	struct pw_impl_link *l;
+	struct spa_dict_item items[1];
+	uint32_t n_links = 0;
+	char val[16];
+
+	spa_list_for_each(l, &port->links, output_link)
+		if (l->prepared)
+			n_links++;
+
+	if (port->n_shared_links == n_links)
+		return;
+
+	pw_log_info("%p: %u links share %u buffers", port, n_links,
+			port->buffers.n_buffers);
+
+	port->n_shared_links = n_links;
+	spa_scnprintf(val, sizeof(val), "%u", n_links);
+	items[0] = SPA_DICT_ITEM_INIT(PW_KEY_PORT_SHARED_LINKS, val);
+	pw_impl_port_update_properties(port, &SPA_DICT_INIT_ARRAY(items));
+}
+
 static void link_update_state(struct pw_impl_link *link, enum pw_link_state state, int res, char *error)
 {
 	struct impl *impl = SPA_CONTAINER_OF(link, struct impl, this);
@@ -138,10 +164,14 @@ static void link_update_state(struct pw_impl_link *link, enum pw_link_state stat
 	if (old < PW_LINK_STATE_PAUSED && state == PW_LINK_STATE_PAUSED) {
 		link->prepared = true;
 		link->preparing = false;
+		link->output->node->recalc_state = true;
+		link->input->node->recalc_state = true;
 		pw_context_recalc_graph(link->context, "link prepared");
 	} else if (old == PW_LINK_STATE_PAUSED && state < PW_LINK_STATE_PAUSED) {
 		link->prepared = false;
 		link->preparing = false;
+		link->output->node->recalc_state = true;
+		link->input->node->recalc_state = true;
 		pw_context_recalc_graph(link->context, "link unprepared");
 	} else if (state == PW_LINK_STATE_INIT) {
 		link->prepared = false;
@@ -153,6 +183,8 @@ static void link_update_state(struct pw_impl_link *link, enum pw_link_state stat
 		input_set_busy_id(link, SPA_ID_INVALID);
 		pw_work_queue_cancel(impl->work, &link->input_link, SPA_ID_INVALID);
 	}
+	if (link->output)
+		update_shared_links(link->output);
 }
 
 static void complete_ready(void *obj, void *data, int res, uint32_t id)
@@ -778,6 +810,7 @@ static void output_remove(struct pw_impl_link *this, struct pw_impl_port *port)
 
 	spa_list_remove(&this->output_link);
 	pw_impl_port_emit_link_removed(this->output, this);
+	update_shared_links(this->output);
 
 	pw_impl_port_recalc_latency(this->output);
 	pw_impl_port_recalc_tag(this->output);
@@ -1327,6 +1360,11 @@ struct pw_impl_link *pw_context_create_link(struct pw_context *context,
 
 	if (impl->async)
 		 pw_properties_set(properties, PW_KEY_LINK_ASYNC, "true");
+	else if (output_node->async || input_node->async)
+		pw_log_warn("(%s) (%s) -> (%s) async node on port without async io %04x:%04x, "
+				"link will share the io area with the next cycle",
+				this->name, output_node->name, input_node->name,
+				output->flags, input->flags);
 
 	spa_hook_list_init(&this->listener_list);
 
@@ -1532,6 +1570,11 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 
 	try_unlink_controls(impl, link->output, link->input);
 
+	if (was_prepared) {
+		impl->onode->recalc_state = true;
+		impl->inode->recalc_state = true;
+	}
+
 	output_remove(link, link->output);
 	input_remove(link, link->input);
 
@@ -22,10 +22,17 @@ PW_LOG_TOPIC_EXTERN(log_metadata);
 
 #define pw_metadata_emit_property(hooks,...)	pw_metadata_emit(hooks,property, 0, ##__VA_ARGS__)
 
+#define INDEX_MIN_ITEMS		16
+
 struct metadata {
 	struct spa_interface iface;
 	struct pw_array storage;
 	struct spa_hook_list hooks;		/**< event listeners */
+
+	uint32_t *index;			/**< open addressing table of item position + 1,
+						  *  hashed on subject and key */
+	uint32_t index_mask;
+	unsigned int index_dirty:1;
 };
 
 struct item {
@@ -67,6 +74,69 @@ static int change_item(struct item *item, const char *type, const char *value)
 	return changed;
 }
 
+static uint32_t item_hash(uint32_t subject, const char *key)
+{
+	uint32_t h = 2166136261u ^ subject;
+	while (*key)
+		h = (h ^ (uint8_t)*key++) * 16777619u;
+	return h;
+}
+
+static void index_insert(struct metadata *this, uint32_t pos)
+{
+	struct item *item = pw_array_get_unchecked(&this->storage, pos, struct item);
+	uint32_t i = item_hash(item->subject, item->key);
+
+	while (this->index[i & this->index_mask] != 0)
+		i++;
+	this->index[i & this->index_mask] = pos + 1;
+}
+
+/* rebuild the index so that it is at most half full */
+static int index_rebuild(struct metadata *this)
+{
+	uint32_t i, size, n_items = pw_array_get_len(&this->storage, struct item);
+	uint32_t *index;
+
+	for (size = 64; size < n_items * 2; size <<= 1);
+
+	if (this->index == NULL || size != this->index_mask + 1) {
+		if ((index = calloc(size, sizeof(uint32_t))) == NULL)
+			return -errno;
+		free(this->index);
+		this->index = index;
+		this->index_mask = size - 1;
+	} else {
+		memset(this->index, 0, size * sizeof(uint32_t));
+	}
+	for (i = 0; i < n_items; i++)
+		index_insert(this, i);
+	this->index_dirty = false;
+	return 0;
+}
+
+static void index_free(struct metadata *this)
+{
+	free(this->index);
+	this->index = NULL;
+	this->index_mask = 0;
+	this->index_dirty = false;
+}
+
+/* called after appending an item to the storage */
+static void index_add(struct metadata *this)
+{
+	uint32_t n_items = pw_array_get_len(&this->storage, struct item);
+
+	if (this->index == NULL || this->index_dirty ||
+	    n_items * 2 > this->index_mask + 1) {
+		if (n_items >= INDEX_MIN_ITEMS)
+			this->index_dirty = true;
+		return;
+	}
+	index_insert(this, n_items - 1);
+}
+
 static void emit_properties(struct metadata *this)
 {
 	struct item *item;
@@ -103,10 +173,31 @@ static int impl_add_listener(void *object,
         return 0;
 }
 
-static struct item *find_item(struct pw_array *storage, uint32_t subject, const char *key)
+static struct item *lookup_item(struct metadata *this, uint32_t subject, const char *key)
+{
+	struct item *item;
+	uint32_t i, pos;
+
+	for (i = item_hash(subject, key); (pos = this->index[i & this->index_mask]) != 0; i++) {
+		item = pw_array_get_unchecked(&this->storage, pos - 1, struct item);
+		if (item->subject == subject && spa_streq(item->key, key))
+			return item;
+	}
+	return NULL;
+}
+
+static struct item *find_item(struct metadata *this, struct pw_array *storage,
+		uint32_t subject, const char *key)
 {
 	struct item *item;
 
+	if (key != NULL && storage == &this->storage) {
+		if (this->index_dirty && index_rebuild(this) < 0)
+			index_free(this);
+		if (this->index != NULL)
+			return lookup_item(this, subject, key);
+	}
+
 	pw_array_for_each(item, storage) {
 		if (item->subject == subject && (key == NULL || spa_streq(item->key, key)))
 			return item;
@@ -120,7 +211,7 @@ static int clear_subjects(struct metadata *this, struct pw_array *storage, uint3
 	uint32_t removed = 0;
 
 	while (true) {
-		item = find_item(storage, subject, NULL);
+		item = find_item(this, storage, subject, NULL);
 		if (item == NULL)
 			break;
 
@@ -130,6 +221,8 @@ static int clear_subjects(struct metadata *this, struct pw_array *storage, uint3
 		pw_array_remove(storage, item);
 		removed++;
 	}
+	if (removed > 0 && storage == &this->storage && this->index != NULL)
+		this->index_dirty = true;
 	if (removed > 0)
 		pw_metadata_emit_property(&this->hooks, subject, NULL, NULL, NULL);
 
@@ -146,6 +239,7 @@ static void clear_items(struct metadata *this)
 	 * adds new metadata we just keep on emptying the metadata forever. */
 	tmp = this->storage;
 	pw_array_init(&this->storage, 4096);
+	index_free(this);
 
 	pw_array_consume(item, &tmp)
 		clear_subjects(this, &tmp, item->subject);
@@ -167,11 +261,13 @@ static int impl_set_property(void *object,
 	if (key == NULL)
 		return clear_subjects(this, &this->storage, subject);
 
-	item = find_item(&this->storage, subject, key);
+	item = find_item(this, &this->storage, subject, key);
 	if (value == NULL) {
 		if (item != NULL) {
 			clear_item(item);
 			pw_array_remove(&this->storage, item);
+			if (this->index != NULL)
+				this->index_dirty = true;
 			type = NULL;
 			changed++;
 			pw_log_info("%p: remove id:%d key:%s", this,
@@ -182,6 +278,7 @@ static int impl_set_property(void *object,
 		if (item == NULL)
 			return -errno;
 		set_item(item, subject, key, type, value);
+		index_add(this);
 		changed++;
 		pw_log_info("%p: add id:%d key:%s type:%s value:%s", this,
 				subject, key, type, value);
@@ -231,12 +328,19 @@ static void metadata_reset(struct metadata *this)
 	spa_hook_list_clean(&this->hooks);
 	clear_items(this);
 	pw_array_clear(&this->storage);
+	index_free(this);
 }
 
+#define KEY_METADATA_COALESCE	"metadata.coalesce"
+
 struct impl {
 	struct pw_impl_metadata this;
 
 	struct metadata def;
+
+	unsigned int coalesce:1;
+	struct spa_source *flush;		/**< sends the pending updates */
+	struct spa_list pending_list;		/**< resources with pending updates */
 };
 
 struct resource_data {
@@ -246,8 +350,81 @@ struct resource_data {
 	struct spa_hook resource_listener;
 	struct spa_hook object_listener;
 	struct spa_hook metadata_listener;
+
+	struct pw_array pending;		/**< coalesced struct item updates */
+	struct spa_list link;			/**< link in impl pending_list */
+	unsigned int queued:1;
 };
 
+#define pw_metadata_resource(r,m,v,...)      \
+	pw_resource_call_res(r,struct pw_metadata_events,m,v,__VA_ARGS__)
+
+#define pw_metadata_resource_property(r,...)        \
+        pw_metadata_resource(r,property,0,__VA_ARGS__)
+
+static void flush_resource(struct resource_data *d)
+{
+	struct item *item;
+
+	pw_array_for_each(item, &d->pending) {
+		pw_metadata_resource_property(d->resource,
+				item->subject, item->key, item->type, item->value);
+		clear_item(item);
+	}
+	pw_array_reset(&d->pending);
+
+	if (d->queued) {
+		spa_list_remove(&d->link);
+		d->queued = false;
+	}
+}
+
+static void flush_pending(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	struct resource_data *d;
+
+	spa_list_consume(d, &impl->pending_list, link)
+		flush_resource(d);
+}
+
+/* Keep only the last update of each subject and key until the next main
+ * loop iteration. A clear of a subject is sent right away after the
+ * updates that came before it so that the client sees them in order. */
+static int queue_property(struct impl *impl, struct resource_data *d, uint32_t subject,
+		const char *key, const char *type, const char *value)
+{
+	struct item *item;
+
+	if (key == NULL) {
+		flush_resource(d);
+		pw_metadata_resource_property(d->resource, subject, key, type, value);
+		return 0;
+	}
+	pw_array_for_each(item, &d->pending) {
+		if (item->subject == subject && spa_streq(item->key, key)) {
+			free(item->type);
+			free(item->value);
+			item->type = type ? strdup(type) : NULL;
+			item->value = value ? strdup(value) : NULL;
+			return 0;
+		}
+	}
+	if ((item = pw_array_add(&d->pending, sizeof(*item))) == NULL)
+		return -errno;
+
+	item->subject = subject;
+	item->key = strdup(key);
+	item->type = type ? strdup(type) : NULL;
+	item->value = value ? strdup(value) : NULL;
+
+	if (!d->queued) {
+		spa_list_append(&impl->pending_list, &d->link);
+		d->queued = true;
+		pw_loop_signal_event(impl->this.context->main_loop, impl->flush);
+	}
+	return 0;
+}
 
 static int metadata_property(void *data, uint32_t subject, const char *key,
 		const char *type, const char *value)
@@ -293,6 +470,16 @@ struct pw_impl_metadata *pw_context_create_metadata(struct pw_context *context,
 
 	pw_impl_metadata_set_implementation(this, metadata_init(&impl->def));
 
+	spa_list_init(&impl->pending_list);
+	impl->coalesce = pw_properties_get_bool(properties, KEY_METADATA_COALESCE, false);
+	if (impl->coalesce) {
+		impl->flush = pw_loop_add_event(context->main_loop, flush_pending, impl);
+		if (impl->flush == NULL) {
+			res = -errno;
+			goto error_free;
+		}
+	}
+
 	if (user_data_size > 0)
 		this->user_data = SPA_PTROFF(this, sizeof(*this), void);
 
@@ -300,6 +487,9 @@ struct pw_impl_metadata *pw_context_create_metadata(struct pw_context *context,
 
 	return this;
 
+error_free:
+	metadata_reset(&impl->def);
+	free(impl);
 error_exit:
 	pw_properties_free(properties);
 	errno = -res;
@@ -359,6 +549,8 @@ void pw_impl_metadata_destroy(struct pw_impl_metadata *metadata)
 	pw_log_debug("%p: free", metadata);
 
 	metadata_reset(&impl->def);
+	if (impl->flush)
+		pw_loop_destroy_source(metadata->context->main_loop, impl->flush);
 
 	spa_hook_list_clean(&metadata->listener_list);
 
@@ -367,12 +559,6 @@ void pw_impl_metadata_destroy(struct pw_impl_metadata *metadata)
 	free(metadata);
 }
 
-#define pw_metadata_resource(r,m,v,...)      \
-	pw_resource_call_res(r,struct pw_metadata_events,m,v,__VA_ARGS__)
-
-#define pw_metadata_resource_property(r,...)        \
-        pw_metadata_resource(r,property,0,__VA_ARGS__)
-
 static int metadata_resource_property(void *data,
 			uint32_t subject,
 			const char *key,
@@ -380,13 +566,17 @@ static int metadata_resource_property(void *data,
 			const char *value)
 {
 	struct resource_data *d = data;
+	struct impl *impl = SPA_CONTAINER_OF(d->impl, struct impl, this);
 	struct pw_resource *resource = d->resource;
 	struct pw_impl_client *client = pw_resource_get_client(resource);
 
 	int res = pw_impl_client_check_permissions(client, subject, PW_PERM_R);
 	if (res >= 0 ||
-		    (res == -ENOENT && key == NULL && type == NULL && value == NULL))
+		    (res == -ENOENT && key == NULL && type == NULL && value == NULL)) {
+		if (impl->coalesce)
+			return queue_property(impl, d, subject, key, type, value);
 		pw_metadata_resource_property(d->resource, subject, key, type, value);
+	}
 	return 0;
 }
 
@@ -436,11 +626,18 @@ static const struct pw_metadata_methods metadata_methods = {
 static void global_unbind(void *data)
 {
 	struct resource_data *d = data;
+	struct item *item;
+
 	if (d->resource) {
 	        spa_hook_remove(&d->resource_listener);
 	        spa_hook_remove(&d->object_listener);
 	        spa_hook_remove(&d->metadata_listener);
 	}
+	if (d->queued)
+		spa_list_remove(&d->link);
+	pw_array_for_each(item, &d->pending)
+		clear_item(item);
+	pw_array_clear(&d->pending);
 }
 
 static const struct pw_resource_events resource_events = {
@@ -464,6 +661,7 @@ global_bind(void *object, struct pw_impl_client *client, uint32_t permissions,
         data = pw_resource_get_user_data(resource);
         data->impl = this;
         data->resource = resource;
+	pw_array_init(&data->pending, 32 * sizeof(struct item));
 
 	pw_log_debug("%p: %u bound to %d", this, id, resource->id);
 	pw_global_add_resource(global, resource);
@@ -2,6 +2,8 @@
 /* SPDX-FileCopyrightText: Copyright © 2018 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include "config.h"
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -20,6 +22,8 @@
 #include <spa/utils/string.h>
 #include <spa/utils/json-pod.h>
 
+#include <sdt-probes.h>
+
 #include "pipewire/impl-node.h"
 #include "pipewire/private.h"
 
@@ -64,6 +68,12 @@ struct resource_data {
 	uint32_t subscribe_ids[MAX_PARAMS];
 	uint32_t n_subscribe_ids;
 
+	/* updates held back while the client is congested */
+	struct spa_hook client_listener;
+	uint64_t pending_change_mask;
+	uint32_t pending_ids[MAX_PARAMS];
+	uint32_t n_pending_ids;
+
 	/* for async replies */
 	int seq;
 	int end;
@@ -142,16 +152,73 @@ static inline void deactivate_target(struct pw_impl_node *node, struct pw_node_t
 	}
 }
 
-/* called from data-loop when all the targets of a node need to be triggered */
-static inline void trigger_targets(struct pw_impl_node *node, int status, uint64_t nsec)
+/* a target is local when it is processed in this process by the same data loop
+ * as the node. Local targets will only be able to run after we return to the
+ * loop. */
+static inline bool target_is_local(struct pw_impl_node *node, struct pw_node_target *t)
+{
+	struct pw_impl_node *n = t->node;
+	return n != NULL && !n->remote && !n->exported && n->data_loop == node->data_loop;
+}
+
+/* called from data-loop, decrement the dependency counter of a local target and
+ * when there are no more dependencies, queue the node on the ready list. The node
+ * is then processed directly from the data loop without going through the eventfd. */
+static inline void trigger_target_ready(struct pw_node_target *t, uint64_t nsec,
+		struct spa_list *ready)
+{
+	struct pw_node_activation *a = t->activation;
+	struct pw_node_activation_state *state = &a->state[0];
+
+	pw_log_trace_fp("%p: (%s-%u) state:%p pending:%d/%d", t->node,
+			t->name, t->id, state, state->pending, state->required);
+
+	if (pw_node_activation_state_dec(state)) {
+		if (SPA_ATOMIC_CAS(a->status,
+					PW_NODE_ACTIVATION_NOT_TRIGGERED,
+					PW_NODE_ACTIVATION_TRIGGERED)) {
+			a->signal_time = nsec;
+			spa_list_append(ready, &t->node->rt.ready_link);
+		}
+	}
+}
+
+/* called from data-loop when all the targets of a node need to be triggered.
+ *
+ * We first signal the targets that run in another data loop or process so that
+ * independent branches of the graph can start processing in parallel. The targets
+ * that run in our data loop are signaled last because they can't start before we
+ * return to the loop anyway.
+ *
+ * When a ready list is given, the local targets that become ready are added to the
+ * list instead of writing their eventfd. */
+static inline void trigger_targets(struct pw_impl_node *node, int status, uint64_t nsec,
+		struct spa_list *ready)
 {
 	struct pw_node_target *ta;
+	uint32_t n_local = 0;
 
 	pw_log_trace_fp("%p: (%s-%u) trigger targets %"PRIu64,
 			node, node->name, node->info.id, nsec);
+	SDT_PROBE(pipewire, node_trigger_targets, node->info.id, status, nsec);
+
+	spa_list_for_each(ta, &node->rt.target_list, link) {
+		if (target_is_local(node, ta))
+			n_local++;
+		else
+			ta->trigger(ta, nsec);
+	}
+	if (n_local == 0)
+		return;
 
-	spa_list_for_each(ta, &node->rt.target_list, link)
-		ta->trigger(ta, nsec);
+	spa_list_for_each(ta, &node->rt.target_list, link) {
+		if (!target_is_local(node, ta))
+			continue;
+		if (ready != NULL)
+			trigger_target_ready(ta, nsec, ready);
+		else
+			ta->trigger(ta, nsec);
+	}
 }
 
 /** \endcond */
@@ -334,6 +401,15 @@ static int start_node(struct pw_impl_node *this)
 	return res;
 }
 
+static void resource_send_info(struct resource_data *d, uint64_t change_mask)
+{
+	struct pw_node_info info = d->node->info;
+
+	info.change_mask = change_mask | d->pending_change_mask;
+	d->pending_change_mask = 0;
+	pw_node_resource_info(d->resource, &info);
+}
+
 static void emit_info_changed(struct pw_impl_node *node, bool flags_changed)
 {
 	if (node->info.change_mask == 0 && !flags_changed)
@@ -343,13 +419,59 @@ static void emit_info_changed(struct pw_impl_node *node, bool flags_changed)
 
 	if (node->global && node->info.change_mask != 0) {
 		struct pw_resource *resource;
-		spa_list_for_each(resource, &node->global->resource_list, link)
-			pw_node_resource_info(resource, &node->info);
+		spa_list_for_each(resource, &node->global->resource_list, link) {
+			struct resource_data *d = pw_resource_get_user_data(resource);
+
+			/* only keep the latest state for congested clients. Param
+			 * changes are sent right away so that the client sees each
+			 * change of the param serial */
+			if (resource->client->congested &&
+			    !(node->info.change_mask & PW_NODE_CHANGE_MASK_PARAMS)) {
+				d->pending_change_mask |= node->info.change_mask;
+				continue;
+			}
+			resource_send_info(d, node->info.change_mask);
+		}
 	}
 
 	node->info.change_mask = 0;
 }
 
+/* the buffers of the ports and the activation are accounted to the node,
+ * the implementation can add its private memory with a property */
+static int update_memory(struct pw_impl_node *node)
+{
+	struct pw_impl_port *p;
+	uint64_t buffers = 0, total;
+	int changed = 0;
+
+	spa_list_for_each(p, &node->input_ports, link)
+		buffers += p->buffers.size + p->mix_buffers.size;
+	spa_list_for_each(p, &node->output_ports, link)
+		buffers += p->buffers.size + p->mix_buffers.size;
+
+	total = buffers + pw_properties_get_uint64(node->properties,
+			PW_KEY_NODE_MEMORY_PRIVATE, 0);
+	if (node->activation)
+		total += node->activation->size;
+
+	changed += pw_properties_setf(node->properties,
+			PW_KEY_NODE_MEMORY_BUFFERS, "%"PRIu64, buffers);
+	changed += pw_properties_setf(node->properties,
+			PW_KEY_NODE_MEMORY, "%"PRIu64, total);
+	if (changed) {
+		node->info.props = &node->properties->dict;
+		node->info.change_mask |= PW_NODE_CHANGE_MASK_PROPS;
+	}
+	return changed;
+}
+
+void pw_impl_node_update_memory(struct pw_impl_node *node)
+{
+	if (update_memory(node) > 0)
+		emit_info_changed(node, false);
+}
+
 static int resource_is_subscribed(struct pw_resource *resource, uint32_t id)
 {
 	struct resource_data *data = pw_resource_get_user_data(resource);
@@ -371,6 +493,9 @@ static int notify_param(void *data, int seq, uint32_t id,
 	spa_list_for_each(resource, &node->global->resource_list, link) {
 		if (!resource_is_subscribed(resource, id))
 			continue;
+		/* the params are enumerated again when the client can take them */
+		if (resource->client->congested)
+			continue;
 
 		pw_log_debug("%p: resource %p notify param %d", node, resource, id);
 		pw_node_resource_param(resource, seq, id, index, next, param);
@@ -378,6 +503,18 @@ static int notify_param(void *data, int seq, uint32_t id,
 	return 0;
 }
 
+static void resource_add_pending_id(struct resource_data *d, uint32_t id)
+{
+	uint32_t i;
+
+	for (i = 0; i < d->n_pending_ids; i++) {
+		if (d->pending_ids[i] == id)
+			return;
+	}
+	if (d->n_pending_ids < SPA_N_ELEMENTS(d->pending_ids))
+		d->pending_ids[d->n_pending_ids++] = id;
+}
+
 static void emit_params(struct pw_impl_node *node, uint32_t *changed_ids, uint32_t n_changed_ids)
 {
 	uint32_t i;
@@ -392,10 +529,16 @@ static void emit_params(struct pw_impl_node *node, uint32_t *changed_ids, uint32
 		struct pw_resource *resource;
 		int subscribed = 0;
 
-		/* first check if anyone is subscribed */
+		/* first check if anyone is subscribed, remember the params
+		 * for the congested clients */
 		spa_list_for_each(resource, &node->global->resource_list, link) {
-			if ((subscribed = resource_is_subscribed(resource, changed_ids[i])))
-				break;
+			if (!resource_is_subscribed(resource, changed_ids[i]))
+				continue;
+			if (resource->client->congested)
+				resource_add_pending_id(pw_resource_get_user_data(resource),
+						changed_ids[i]);
+			else
+				subscribed = 1;
 		}
 		if (!subscribed)
 			continue;
@@ -665,6 +808,7 @@ static void resource_destroy(void *data)
 	remove_busy_resource(d);
 	spa_hook_remove(&d->resource_listener);
 	spa_hook_remove(&d->object_listener);
+	spa_hook_remove(&d->client_listener);
 }
 
 static void resource_pong(void *data, int seq)
@@ -681,6 +825,33 @@ static const struct pw_resource_events resource_events = {
 	.pong = resource_pong,
 };
 
+static void client_congested_changed(void *data, bool congested)
+{
+	struct resource_data *d = data;
+	uint32_t i, n_ids;
+
+	if (congested)
+		return;
+
+	if (d->pending_change_mask != 0) {
+		pw_log_debug("%p: resource %p send pending info %08"PRIx64, d->node,
+				d->resource, d->pending_change_mask);
+		resource_send_info(d, 0);
+	}
+
+	n_ids = d->n_pending_ids;
+	d->n_pending_ids = 0;
+	for (i = 0; i < n_ids; i++) {
+		if (resource_is_subscribed(d->resource, d->pending_ids[i]))
+			node_enum_params(d, 1, d->pending_ids[i], 0, UINT32_MAX, NULL);
+	}
+}
+
+static const struct pw_impl_client_events client_events = {
+	PW_VERSION_IMPL_CLIENT_EVENTS,
+	.congested_changed = client_congested_changed,
+};
+
 static int
 global_bind(void *object, struct pw_impl_client *client, uint32_t permissions,
 	    uint32_t version, uint32_t id)
@@ -705,6 +876,9 @@ global_bind(void *object, struct pw_impl_client *client, uint32_t permissions,
 	pw_resource_add_object_listener(resource,
 			&data->object_listener,
 			&node_methods, data);
+	pw_impl_client_add_listener(client,
+			&data->client_listener,
+			&client_events, data);
 
 	pw_log_debug("%p: bound to %d", this, resource->id);
 	pw_global_add_resource(global, resource);
@@ -878,6 +1052,59 @@ int pw_impl_node_remove_target(struct pw_impl_node *node, struct pw_node_target
 	return 0;
 }
 
+static inline uint64_t target_critical_path(struct pw_node_target *t)
+{
+	return t->node ? t->node->critical_path : 0;
+}
+
+static int
+do_sort_targets(struct spa_loop *loop,
+                bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *node = user_data;
+	struct pw_node_target *t, *s;
+	struct spa_list sorted;
+
+	/* insertion sort, keeps the order of targets with equal cost */
+	spa_list_init(&sorted);
+	spa_list_consume(t, &node->rt.target_list, link) {
+		spa_list_remove(&t->link);
+		spa_list_for_each(s, &sorted, link) {
+			if (target_critical_path(t) > target_critical_path(s))
+				break;
+		}
+		spa_list_append(&s->link, &t->link);
+	}
+	spa_list_insert_list(&node->rt.target_list, &sorted);
+	return 0;
+}
+
+/* Sort the targets so that the targets with the longest critical path
+ * are triggered first. This makes the most expensive chains of the
+ * graph start as early as possible in the cycle. */
+int pw_impl_node_sort_targets(struct pw_impl_node *node)
+{
+	struct pw_node_target *t;
+	uint64_t last = UINT64_MAX;
+	bool sorted = true;
+
+	spa_list_for_each(t, &node->rt.target_list, link) {
+		uint64_t cp = target_critical_path(t);
+		if (cp > last) {
+			sorted = false;
+			break;
+		}
+		last = cp;
+	}
+	if (sorted)
+		return 0;
+
+	pw_log_debug("%p: sort targets", node);
+	pw_loop_invoke(node->data_loop,
+			do_sort_targets, SPA_ID_INVALID, NULL, 0, true, node);
+	return 1;
+}
+
 static void update_io(struct pw_impl_node *node)
 {
 	struct pw_node_target *t = &node->rt.target;
@@ -965,8 +1192,10 @@ int pw_impl_node_register(struct pw_impl_node *this,
 	spa_list_for_each(port, &this->output_ports, link)
 		pw_impl_port_register(port, NULL);
 
-	if (this->active)
+	if (this->active) {
+		this->recalc_state = true;
 		pw_context_recalc_graph(context, "register active node");
+	}
 
 	return 0;
 
@@ -1031,6 +1260,7 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 
 	node->driver_node = driver;
 	node->moved = true;
+	node->recalc_state = true;
 
 	/* first send new driver target to node, the node is not yet being
 	 * scheduled so it won't trigger yet */
@@ -1285,8 +1515,10 @@ static void check_properties(struct pw_impl_node *node)
 	pw_log_debug("%p: driver:%d recalc:%s active:%d", node, node->driver,
 			recalc_reason, node->active);
 
-	if (recalc_reason != NULL && node->active)
+	if (recalc_reason != NULL && node->active) {
+		node->recalc_state = true;
 		pw_context_recalc_graph(context, recalc_reason);
+	}
 }
 
 static const char *str_status(uint32_t status)
@@ -1424,11 +1656,12 @@ static inline void calculate_stats(struct pw_impl_node *this,  struct pw_node_ac
 }
 
 /* The main processing entry point of a node. This is called from the data-loop and usually
- * as a result of signaling the eventfd of the node.
+ * as a result of signaling the eventfd of the node or from the ready list of the data-loop
+ * when a local peer node completed.
  *
  * This code runs on the client and the server, depending on where the node is.
  */
-static inline int process_node(void *data, uint64_t nsec)
+static inline int process_node(void *data, uint64_t nsec, struct spa_list *ready)
 {
 	struct pw_impl_node *this = data;
 	struct pw_impl_port *p;
@@ -1442,6 +1675,7 @@ static inline int process_node(void *data, uint64_t nsec)
 		return 0;
 
 	a->awake_time = nsec;
+	SDT_PROBE(pipewire, node_process_start, this->info.id, a->signal_time, nsec);
 	pw_log_trace_fp("%p: %s process remote:%u exported:%u %"PRIu64" %"PRIu64,
 			this, this->name, this->remote, this->exported,
 			a->signal_time, nsec);
@@ -1475,6 +1709,7 @@ static inline int process_node(void *data, uint64_t nsec)
 	nsec = get_time_ns(data_system);
 	old_status = SPA_ATOMIC_XCHG(a->status, PW_NODE_ACTIVATION_FINISHED);
 	a->finish_time = nsec;
+	SDT_PROBE(pipewire, node_process_end, this->info.id, status, nsec - a->awake_time);
 
 	pw_log_trace_fp("%p: finished status:%d %"PRIu64, this, status, nsec);
 
@@ -1482,7 +1717,7 @@ static inline int process_node(void *data, uint64_t nsec)
 	 * graph because that means we finished the graph. */
 	if (SPA_LIKELY(!this->driving)) {
 		if ((!this->async || a->server_version < 1) && old_status == PW_NODE_ACTIVATION_AWAKE)
-			trigger_targets(this, status, nsec);
+			trigger_targets(this, status, nsec, ready);
 	} else {
 		/* calculate CPU time when finished */
 		a->signal_time = this->driver_start;
@@ -1515,6 +1750,7 @@ static void node_on_fd_events(struct spa_source *source)
 	if (SPA_LIKELY(source->rmask & SPA_IO_IN)) {
 		uint64_t cmd, nsec;
 		struct spa_system *data_system = this->rt.target.system;
+		struct spa_list ready;
 
 		nsec = get_time_ns(data_system);
 
@@ -1530,7 +1766,15 @@ static void node_on_fd_events(struct spa_source *source)
 		pw_log_trace_fp("%p: remote:%u exported:%u %s got process %"PRIu64,
 				this, this->remote, this->exported, this->name, nsec);
 
-		process_node(this, nsec);
+		spa_list_init(&ready);
+		process_node(this, nsec, &ready);
+
+		/* run the nodes in our data loop that became ready */
+		while (!spa_list_is_empty(&ready)) {
+			struct pw_impl_node *n = spa_list_first(&ready, struct pw_impl_node, rt.ready_link);
+			spa_list_remove(&n->rt.ready_link);
+			process_node(n, get_time_ns(data_system), &ready);
+		}
 	}
 }
 
@@ -1622,15 +1866,17 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 
 	size = sizeof(struct pw_node_activation);
 
-	this->activation = pw_mempool_alloc(this->context->pool,
+	/* when the pool has a slab size, activation records of many nodes are
+	 * packed into one shared memfd, the slice can be recycled so clear it */
+	this->activation = pw_mempool_alloc_map(this->context->pool,
 			PW_MEMBLOCK_FLAG_READWRITE |
-			PW_MEMBLOCK_FLAG_SEAL |
-			PW_MEMBLOCK_FLAG_MAP,
+			PW_MEMBLOCK_FLAG_SEAL,
 			SPA_DATA_MemFd, size);
 	if (this->activation == NULL) {
 		res = -errno;
                 goto error_clean;
 	}
+	memset(this->activation->ptr, 0, size);
 
 	impl->work = pw_context_get_work_queue(this->context);
 	impl->pending_id = SPA_ID_INVALID;
@@ -1654,7 +1900,7 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	spa_list_init(&this->rt.output_mix);
 	spa_list_init(&this->rt.target_list);
 
-	this->rt.target.activation = this->activation->map->ptr;
+	this->rt.target.activation = this->activation->ptr;
 	this->rt.target.node = this;
 	this->rt.target.system = this->data_loop->system;
 	this->rt.target.fd = this->source.fd;
@@ -1671,15 +1917,17 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	this->rt.rate_limit.burst = 1;
 
 	this->driver_node = this;
+	this->recalc_state = true;
 	spa_list_append(&this->follower_list, &this->follower_link);
 
 	check_properties(this);
+	update_memory(this);
 
 	return this;
 
 error_clean:
 	if (this->activation)
-		pw_memblock_unref(this->activation);
+		pw_memmap_free(this->activation);
 	if (this->source.fd != -1)
 		spa_system_close(this->data_loop->system, this->source.fd);
 	if (this->data_loop)
@@ -1742,6 +1990,7 @@ static int update_properties(struct pw_impl_node *node, const struct spa_dict *d
 
 	if (changed) {
 		check_properties(node);
+		update_memory(node);
 		node->info.change_mask |= PW_NODE_CHANGE_MASK_PROPS;
 	}
 	return changed;
@@ -1808,8 +2057,10 @@ static void node_info(void *data, const struct spa_node_info *info)
 	if (n_changed_ids > 0)
 		emit_params(node, changed_ids, n_changed_ids);
 
-	if (flags_changed)
+	if (flags_changed) {
+		node->recalc_state = true;
 		pw_context_recalc_graph(node->context, "node flags changed");
+	}
 }
 
 static void node_port_info(void *data, enum spa_direction direction, uint32_t port_id,
@@ -2029,7 +2280,7 @@ static int node_ready(void *data, int status)
 			old_status = SPA_ATOMIC_LOAD(a->status);
 			if (old_status != PW_NODE_ACTIVATION_FINISHED) {
 				SPA_ATOMIC_STORE(a->status, PW_NODE_ACTIVATION_TRIGGERED);
-				process_node(node, nsec);
+				process_node(node, nsec, NULL);
 				debug_xrun_graph(node, nsec);
 			}
 		}
@@ -2081,6 +2332,12 @@ retry_status:
 				update_xrun_stats(ta, 1, nsec / 1000, 0);
 				debug_xrun_target(node, t, old_status, nsec);
 			}
+			/* the node was still processing, it is the one that used up
+			 * the cycle budget, the triggered nodes were waiting for it */
+			if (old_status == PW_NODE_ACTIVATION_AWAKE) {
+				ta->overrun_count++;
+				ta->overrun_time = nsec / 1000;
+			}
 
 			/* this is the node with reposition info */
 			if (SPA_UNLIKELY(id == reposition_owner))
@@ -2136,7 +2393,7 @@ retry_status:
 			spa_node_process_fast(p->mix);
 	}
 	/* now signal all the nodes we drive */
-	trigger_targets(node, status, nsec);
+	trigger_targets(node, status, nsec, NULL);
 	return 0;
 }
 
@@ -2383,7 +2640,7 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 
 	spa_hook_list_clean(&node->listener_list);
 
-	pw_memblock_unref(node->activation);
+	pw_memmap_free(node->activation);
 
 	pw_param_clear(&impl->param_list, SPA_ID_INVALID);
 	pw_param_clear(&impl->pending_list, SPA_ID_INVALID);
@@ -2505,6 +2762,9 @@ int pw_impl_node_for_each_param(struct pw_impl_node *node,
 		result.id = param_id;
 		result.next = 0;
 
+		/* the builder memory is reused for all params */
+		spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 4096);
+
 		spa_list_for_each(p, &impl->param_list, link) {
 			if (p->id != param_id)
 				continue;
@@ -2513,18 +2773,17 @@ int pw_impl_node_for_each_param(struct pw_impl_node *node,
 			if (result.index < index)
 				continue;
 
-			spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 4096);
+			spa_pod_dynamic_builder_reset(&b);
 
 			if (spa_pod_filter(&b.b, &result.param, p->param, filter) == 0)  {
 				pw_log_debug("%p: %d param %u", node, seq, result.index);
 				result_node_params(&user_data, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
 				count++;
 			}
-			spa_pod_dynamic_builder_clean(&b);
-
 			if (count == max)
 				break;
 		}
+		spa_pod_dynamic_builder_clean(&b);
 		res = 0;
 	} else {
 		user_data.cache = impl->cache_params &&
@@ -2637,6 +2896,13 @@ error:
 	return SPA_ID_INVALID;
 }
 
+bool pw_impl_node_state_is_settled(struct pw_impl_node *node, enum pw_node_state state)
+{
+	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
+	return !node->recalc_state && impl->pending_id == SPA_ID_INVALID &&
+		impl->pending_state == state && node->info.state == state;
+}
+
 static void on_state_complete(void *obj, void *data, int res, uint32_t seq)
 {
 	struct pw_impl_node *node = obj;
@@ -2759,6 +3025,7 @@ int pw_impl_node_set_active(struct pw_impl_node *node, bool active)
 		node->active = active;
 		pw_impl_node_emit_active_changed(node, active);
 
+		node->recalc_state = true;
 		if (node->registered)
 			pw_context_recalc_graph(node->context,
 					active ? "node activate" : "node deactivate");
@@ -33,6 +33,9 @@ struct impl {
 
 	struct {
 		struct spa_list mix_list;
+#define MAX_SHARED_BUFFERS	64
+		uint32_t refs[MAX_SHARED_BUFFERS];
+		uint64_t released;
 	} rt;
 
 	struct spa_list param_list;
@@ -206,24 +209,61 @@ do_add_mix(struct spa_loop *loop,
 	if (!mix->rt.active) {
 		spa_list_append(&impl->rt.mix_list, &mix->rt.link);
 		mix->rt.active = true;
+		mix->rt.held = 0;
 	}
 	return 0;
 }
 
+/* release a shared buffer held by the peer of mix. When the last peer
+ * released it, the buffer is handed back to the node in the io area on
+ * the next cycle, this also works for remote nodes that don't implement
+ * reuse_buffer. */
+static void tee_release(struct impl *impl, struct pw_impl_port_mix *mix, uint32_t id)
+{
+	if (id >= MAX_SHARED_BUFFERS || !(mix->rt.held & (1ULL << id)))
+		return;
+
+	mix->rt.held &= ~(1ULL << id);
+	if (impl->rt.refs[id] > 0 && --impl->rt.refs[id] == 0)
+		impl->rt.released |= 1ULL << id;
+}
+
+static void tee_release_all(struct impl *impl, struct pw_impl_port_mix *mix)
+{
+	while (mix->rt.held != 0)
+		tee_release(impl, mix, __builtin_ctzll(mix->rt.held));
+}
+
 static int
 do_remove_mix(struct spa_loop *loop,
 		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct pw_impl_port_mix *mix = user_data;
 	struct pw_impl_port *this = mix->p;
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	pw_log_trace("%p: remove mix %p", this, mix);
 	if (mix->rt.active) {
 		spa_list_remove(&mix->rt.link);
 		mix->rt.active = false;
+		tee_release_all(impl, mix);
 	}
 	return 0;
 }
 
+static int
+do_reset_shared(struct spa_loop *loop,
+		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	struct pw_impl_port_mix *mix;
+
+	spa_zero(impl->rt.refs);
+	impl->rt.released = 0;
+	spa_list_for_each(mix, &impl->rt.mix_list, rt.link)
+		mix->rt.held = 0;
+	return 0;
+}
+
 static int port_set_io(void *object,
 		enum spa_direction direction, uint32_t port_id, uint32_t id,
 		void *data, size_t size)
@@ -268,6 +308,38 @@ static int tee_process(void *object)
 	uint32_t cycle = this->node->rt.position->clock.cycle & 1;
 
 	pw_log_trace_fp("%p: tee input status:%d id:%d cycle:%d", this, io->status, io->buffer_id, cycle);
+
+	if (this->shared_buffers) {
+		uint32_t id = io->buffer_id;
+		bool share = io->status == SPA_STATUS_HAVE_DATA && id < MAX_SHARED_BUFFERS;
+
+		spa_list_for_each(mix, &impl->rt.mix_list, rt.link) {
+			struct spa_io_buffers *mio = mix->io[cycle];
+
+			/* the peer returns the buffer it is done with, a buffer
+			 * that was not consumed is dropped */
+			tee_release(impl, mix, mio->buffer_id);
+			*mio = *io;
+			if (share && !(mix->rt.held & (1ULL << id))) {
+				mix->rt.held |= 1ULL << id;
+				impl->rt.refs[id]++;
+			}
+		}
+		if (share && impl->rt.refs[id] == 0)
+			impl->rt.released |= 1ULL << id;
+
+		/* recycle one released buffer in the node */
+		if (impl->rt.released != 0) {
+			io->buffer_id = __builtin_ctzll(impl->rt.released);
+			impl->rt.released &= ~(1ULL << io->buffer_id);
+			pw_log_trace_fp("%p: tee recycle shared buffer %d", this, io->buffer_id);
+		} else if (share) {
+			io->buffer_id = SPA_ID_INVALID;
+		}
+		io->status = SPA_STATUS_NEED_DATA;
+		return SPA_STATUS_HAVE_DATA | SPA_STATUS_NEED_DATA;
+	}
+
 	spa_list_for_each(mix, &impl->rt.mix_list, rt.link) {
 		pw_log_trace_fp("%p: port %d %p->%p id:%d", this,
 				mix->port.port_id, io, mix->io[cycle], mix->io[cycle]->buffer_id);
@@ -284,6 +356,16 @@ static int tee_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
 	struct pw_impl_port *this = &impl->this;
 
 	pw_log_trace_fp("%p: tee reuse buffer %d %d", this, port_id, buffer_id);
+	if (this->shared_buffers) {
+		struct pw_impl_port_mix *mix;
+		spa_list_for_each(mix, &impl->rt.mix_list, rt.link) {
+			if (mix->port.port_id == port_id) {
+				tee_release(impl, mix, buffer_id);
+				break;
+			}
+		}
+		return 0;
+	}
 	spa_node_port_reuse_buffer(this->node->node, this->port_id, buffer_id);
 	return 0;
 }
@@ -617,9 +699,17 @@ static int process_tag_param(void *data, int seq,
 	return 0;
 }
 
+static void update_format_serial(struct pw_impl_port *port)
+{
+	static uint64_t format_serial = 0;
+	port->format_serial = ++format_serial;
+}
+
 static void check_params(struct pw_impl_port *port)
 {
 	uint32_t i;
+
+	update_format_serial(port);
 	for (i = 0; i < port->info.n_params; i++)
 		port->info.params[i].user = 0;
 
@@ -674,6 +764,9 @@ static void update_info(struct pw_impl_port *port, const struct spa_port_info *i
 				changed_ids[n_changed_ids++] = id;
 
 			switch (id) {
+			case SPA_PARAM_EnumFormat:
+				update_format_serial(port);
+				break;
 			case SPA_PARAM_Latency:
 				port->have_latency_param =
 					SPA_FLAG_IS_SET(info->params[i].flags, SPA_PARAM_INFO_WRITE);
@@ -750,6 +843,7 @@ struct pw_impl_port *pw_context_create_port(
 	this->properties = properties;
 	this->state = PW_IMPL_PORT_STATE_INIT;
 	this->rt.io = SPA_IO_BUFFERS_INIT;
+	update_format_serial(this);
 
         if (user_data_size > 0)
 		this->user_data = SPA_PTROFF(impl, sizeof(struct impl), void);
@@ -852,8 +946,10 @@ static int setup_mixer(struct pw_impl_port *port, const struct spa_pod *param)
 	int res;
 	const char *fallback_lib, *factory_name;
 	struct spa_handle *handle;
-	struct spa_dict_item items[3];
+	struct spa_dict_item items[4];
+	uint32_t n_items = 0;
 	char quantum_limit[16];
+	const char *str;
 	void *iface;
 	struct pw_context *context = port->node->context;
 
@@ -904,14 +1000,16 @@ static int setup_mixer(struct pw_impl_port *port, const struct spa_pod *param)
 		return -ENOTSUP;
 	}
 
-	items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_LIBRARY_NAME, fallback_lib);
+	items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LIBRARY_NAME, fallback_lib);
 	spa_scnprintf(quantum_limit, sizeof(quantum_limit), "%u",
 			context->settings.clock_quantum_limit);
-	items[1] = SPA_DICT_ITEM_INIT("clock.quantum-limit", quantum_limit);
-	items[2] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_LOOP_NAME, port->node->data_loop->name);
+	items[n_items++] = SPA_DICT_ITEM_INIT("clock.quantum-limit", quantum_limit);
+	items[n_items++] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_LOOP_NAME, port->node->data_loop->name);
+	if ((str = pw_properties_get(port->node->properties, "mixer.threads")) != NULL)
+		items[n_items++] = SPA_DICT_ITEM_INIT("mixer.threads", str);
 
 	handle = pw_context_load_spa_handle(context, factory_name,
-			&SPA_DICT_INIT_ARRAY(items));
+			&SPA_DICT_INIT(items, n_items));
 	if (handle == NULL)
 		return -errno;
 
@@ -1149,6 +1247,7 @@ int pw_impl_port_register(struct pw_impl_port *port,
 		PW_KEY_PORT_EXTRA,
 		PW_KEY_PORT_IGNORE_LATENCY,
 		PW_KEY_PORT_GROUP,
+		PW_KEY_PORT_SHARED_BUFFERS,
 		NULL
 	};
 
@@ -1229,6 +1328,11 @@ int pw_impl_port_add(struct pw_impl_port *port, struct pw_impl_node *node)
 
 	port->ignore_latency = pw_properties_get_bool(port->properties, PW_KEY_PORT_IGNORE_LATENCY, false);
 
+	/* the node can enable shared buffers for all its output ports */
+	port->shared_buffers = port->direction == PW_DIRECTION_OUTPUT &&
+		pw_properties_get_bool(port->properties, PW_KEY_PORT_SHARED_BUFFERS,
+			pw_properties_get_bool(nprops, PW_KEY_PORT_SHARED_BUFFERS, false));
+
 	is_control = PW_IMPL_PORT_IS_CONTROL(port);
 	if (is_control) {
 		dir = port->direction == PW_DIRECTION_INPUT ?  "control" : "notify";
@@ -1430,6 +1534,9 @@ static void pw_impl_port_remove(struct pw_impl_port *port)
 	spa_list_remove(&port->link);
 	pw_impl_node_emit_port_removed(node, port);
 	port->node = NULL;
+
+	if (port->buffers.size + port->mix_buffers.size > 0)
+		pw_impl_node_update_memory(node);
 }
 
 void pw_impl_port_destroy(struct pw_impl_port *port)
@@ -1549,6 +1656,9 @@ int pw_impl_port_for_each_param(struct pw_impl_port *port,
 		result.id = param_id;
 		result.next = 0;
 
+		/* the builder memory is reused for all params */
+		spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 4096);
+
 		spa_list_for_each(p, &impl->param_list, link) {
 			if (p->id != param_id)
 				continue;
@@ -1557,18 +1667,17 @@ int pw_impl_port_for_each_param(struct pw_impl_port *port,
 			if (result.index < index)
 				continue;
 
-			spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 4096);
+			spa_pod_dynamic_builder_reset(&b);
 
 			if (spa_pod_filter(&b.b, &result.param, p->param, filter) >= 0) {
 				pw_log_debug("%p: %d param %u", port, seq, result.index);
 				result_port_params(&user_data, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
 				count++;
 			}
-			spa_pod_dynamic_builder_clean(&b);
-
 			if (count == max)
 				break;
 		}
+		spa_pod_dynamic_builder_clean(&b);
 		res = 0;
 	} else {
 		struct spa_node *qnode;
@@ -1879,6 +1988,7 @@ int pw_impl_port_set_param(struct pw_impl_port *port, uint32_t id, uint32_t flag
 		}
 		pw_buffers_clear(&port->buffers);
 		pw_buffers_clear(&port->mix_buffers);
+		pw_impl_node_update_memory(node);
 
 		if (param == NULL || res < 0) {
 			pw_impl_port_update_state(port, PW_IMPL_PORT_STATE_CONFIGURE, 0, NULL);
@@ -1937,6 +2047,10 @@ static int negotiate_mixer_buffers(struct pw_impl_port *port, uint32_t flags,
 	pw_log_debug("%p: %d.%d use %d buffers on node: %p",
 			port, port->direction, port->port_id, n_buffers, node->node);
 
+	if (port->shared_buffers)
+		pw_loop_invoke(node->data_loop, do_reset_shared, SPA_ID_INVALID, NULL, 0, true,
+				SPA_CONTAINER_OF(port, struct impl, this));
+
 	res = spa_node_port_use_buffers(node->node,
 			port->direction, port->port_id,
 			flags, buffers, n_buffers);
@@ -1987,6 +2101,7 @@ int pw_impl_port_use_buffers(struct pw_impl_port *port, struct pw_impl_port_mix
 		} else if (n_buffers > 0 && !SPA_RESULT_IS_ASYNC(res)) {
 			pw_impl_port_update_state(port, PW_IMPL_PORT_STATE_PAUSED, 0, NULL);
 		}
+		pw_impl_node_update_memory(port->node);
 	}
 
 	/* then use the buffers on the mixer */
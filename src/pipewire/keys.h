@@ -77,6 +77,9 @@ extern "C" {
 #define PW_KEY_LOOP_RETRY_TIMEOUT	"loop.retry-timeout"	/**< when the loop invoke queue is full, the timeout
 								  *  in microseconds before retrying.
 								  *  default = 1 second, 0 = disable */
+#define PW_KEY_LOOP_SPIN_TIME		"loop.spin-time"	/**< the time in microseconds to poll for events
+								  *  before going to sleep.
+								  *  default = 0, disabled */
 
 /* context */
 #define PW_KEY_CONTEXT_PROFILE_MODULES	"context.profile.modules"	/**< a context profile for modules, deprecated */
@@ -110,6 +113,10 @@ extern "C" {
 								  *  in order. */
 #define PW_KEY_REMOTE_INTENTION		"remote.intention"	/**< The intention of the remote connection,
 								  *  "generic", "screencast" */
+#define PW_KEY_REMOTE_RING_SIZE		"remote.ring-size"	/**< Size of the shared memory rings in
+								  *  bytes to pass the messages to the
+								  *  remote, a power of 2. 0 to use only
+								  *  the socket. */
 
 /** application keys */
 #define PW_KEY_APP_NAME			"application.name"	/**< application name. Ex: "Totem Music Player" */
@@ -139,6 +146,8 @@ extern "C" {
 #define PW_KEY_CLIENT_NAME		"client.name"		/**< the client name */
 #define PW_KEY_CLIENT_API		"client.api"		/**< the client api used to access
 								  *  PipeWire */
+#define PW_KEY_CLIENT_MEMORY		"client.memory"		/**< size in bytes of the memory
+								  *  shared with the client */
 
 /** Node keys */
 #define PW_KEY_NODE_ID			"node.id"		/**< node id */
@@ -212,6 +221,13 @@ extern "C" {
 								  *   but it will be triggered explicitly. */
 #define PW_KEY_NODE_CHANNELNAMES		"node.channel-names"		/**< names of node's
 									*   channels (unrelated to positions) */
+#define PW_KEY_NODE_MEMORY		"node.memory"		/**< total size in bytes of the memory
+								  *  held by the node */
+#define PW_KEY_NODE_MEMORY_BUFFERS	"node.memory.buffers"	/**< size in bytes of the buffers
+								  *  allocated for the node ports */
+#define PW_KEY_NODE_MEMORY_PRIVATE	"node.memory.private"	/**< size in bytes of the private
+								  *  memory of the node implementation,
+								  *  set by the implementation */
 #define PW_KEY_NODE_DEVICE_PORT_NAME_PREFIX			"node.device-port-name-prefix"		/** override
 									*		port name prefix for device ports, like capture and playback
 									*		or disable the prefix completely if an empty string is provided */
@@ -232,6 +248,12 @@ extern "C" {
 #define PW_KEY_PORT_PASSIVE		"port.passive"		/**< the ports wants passive links, since 0.3.67 */
 #define PW_KEY_PORT_IGNORE_LATENCY	"port.ignore-latency"	/**< latency ignored by peers, since 0.3.71 */
 #define PW_KEY_PORT_GROUP		"port.group"		/**< the port group of the port 1.2.0 */
+#define PW_KEY_PORT_SHARED_BUFFERS	"port.shared-buffers"	/**< the buffers of an output port are shared
+								  *  read-only with all links and only recycled
+								  *  when all peers released them, since 1.3.0 */
+#define PW_KEY_PORT_SHARED_LINKS	"port.shared-links"	/**< the number of prepared links that read the
+								  *  buffers of an output port without a copy,
+								  *  since 1.3.0 */
 
 /** link properties */
 #define PW_KEY_LINK_ID			"link.id"		/**< a link id */
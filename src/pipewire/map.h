@@ -200,6 +200,11 @@ static inline void *pw_map_lookup(const struct pw_map *map, uint32_t id)
 }
 
 /** Iterate all map items
+ *
+ * \a func is allowed to insert and remove items. The map storage can move
+ * when it grows, so the items are iterated by index. Items that are inserted
+ * at a higher index during the iteration are also visited.
+ *
  * \param map the map to iterate
  * \param func the function to call for each item, the item data and \a data is
  *		passed to the function. When \a func returns a non-zero result,
@@ -211,9 +216,11 @@ static inline int pw_map_for_each(const struct pw_map *map,
 				  int (*func) (void *item_data, void *data), void *data)
 {
 	union pw_map_item *item;
+	uint32_t id;
 	int res = 0;
 
-	pw_array_for_each(item, &map->items) {
+	for (id = 0; id < pw_map_get_size(map); id++) {
+		item = pw_map_get_item(map, id);
 		if (!pw_map_item_is_free(item))
 			if ((res = func(item->data, data)) != 0)
 				break;
@@ -14,14 +14,20 @@
 #include <stdlib.h>
 #include <sys/syscall.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
 
 #include <spa/utils/list.h>
+#include <spa/utils/result.h>
 #include <spa/buffer/buffer.h>
 
 #include <pipewire/log.h>
 #include <pipewire/map.h>
 #include <pipewire/mem.h>
 
+#include "private.h"
+
 PW_LOG_TOPIC_EXTERN(log_mem);
 #define PW_LOG_TOPIC_DEFAULT log_mem
 
@@ -69,6 +75,10 @@ static inline int memfd_create(const char *name, unsigned int flags)
 #define MFD_EXEC 0x0010U
 #endif
 
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+
 #ifdef HAVE_MEMFD_CREATE
 static int pw_memfd_create(const char *name, unsigned int flags)
 {
@@ -114,7 +124,16 @@ struct mempool {
 
 	struct pw_map map;		/* map memblock to id */
 	struct spa_list blocks;		/* list of memblock */
+	struct spa_list slabs;		/* list of slab */
 	uint32_t pagesize;
+
+	uint32_t slab_size;		/* size of the slabs, 0 = disabled */
+	uint32_t hugepagesize;		/* size of huge pages, 0 = disabled */
+	unsigned int prefault:1;	/* populate the mappings */
+
+	uint32_t n_blocks;		/* number of blocks */
+	uint64_t size;			/* total size of the blocks */
+	uint64_t mapped;		/* size of the mappings */
 };
 
 struct memblock {
@@ -125,6 +144,24 @@ struct memblock {
 	struct memblock *owner;		/* owner of fd, if another memblock */
 	struct spa_hook owner_listener;	/* listen for fd owner memblock events */
 	struct spa_hook_list listener_list;
+	struct slab *slab;		/* slab using this block */
+	uint64_t accounted;		/* size accounted in the pool */
+	unsigned int exported:1;	/* fd was imported in another pool */
+};
+
+/* a shared memblock that is cut into slices for small allocations */
+struct slab {
+	struct spa_list link;		/* link in mempool */
+	struct memblock *block;
+	uint32_t flags;			/* flags of the block */
+	uint32_t used;			/* bytes in use */
+	struct spa_list free;		/* free ranges, sorted by offset */
+};
+
+struct slab_range {
+	struct spa_list link;
+	uint32_t offset;
+	uint32_t size;
 };
 
 struct memblock_events {
@@ -149,8 +186,31 @@ struct memmap {
 	struct pw_memmap this;
 	struct mapping *mapping;
 	struct spa_list link;
+	struct slab *slab;		/* slab of the slice */
+	uint32_t slice_size;		/* allocated size in the slab */
+	unsigned int own_block:1;	/* unref the block when freed */
 };
 
+static uint32_t get_hugepagesize(void)
+{
+	uint32_t size = 0;
+#if defined(HAVE_MEMFD_CREATE) && defined(__linux__)
+	struct stat sb;
+	int fd;
+
+	if ((fd = pw_memfd_create("pipewire-memfd:hugetlb", MFD_CLOEXEC | MFD_HUGETLB)) < 0) {
+		pw_log_warn("huge pages are not available: %m");
+		return 0;
+	}
+	if (fstat(fd, &sb) == 0)
+		size = sb.st_blksize;
+	close(fd);
+#else
+	pw_log_warn("huge pages are not supported");
+#endif
+	return size;
+}
+
 SPA_EXPORT
 struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 {
@@ -166,11 +226,21 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 
 	impl->pagesize = sysconf(_SC_PAGESIZE);
 
-	pw_log_debug("%p: new", this);
+	if (props) {
+		if (pw_properties_get_bool(props, "mem.hugepages", false))
+			impl->hugepagesize = get_hugepagesize();
+		impl->prefault = pw_properties_get_bool(props, "mem.prefault", false);
+		impl->slab_size = SPA_ROUND_UP_N(pw_properties_get_uint32(props,
+					"mem.slab-size", 0), impl->pagesize);
+	}
+
+	pw_log_debug("%p: new hugepagesize:%u prefault:%d slab-size:%u", this,
+			impl->hugepagesize, impl->prefault, impl->slab_size);
 
 	spa_hook_list_init(&impl->listener_list);
 	pw_map_init(&impl->map, 64, 64);
 	spa_list_init(&impl->blocks);
+	spa_list_init(&impl->slabs);
 
 	return this;
 }
@@ -188,6 +258,17 @@ void pw_mempool_clear(struct pw_mempool *pool)
 	pw_map_reset(&impl->map);
 }
 
+SPA_EXPORT
+int pw_mempool_get_stats(struct pw_mempool *pool, struct pw_mempool_stats *stats)
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+
+	stats->n_blocks = impl->n_blocks;
+	stats->size = impl->size;
+	stats->mapped = impl->mapped;
+	return 0;
+}
+
 SPA_EXPORT
 void pw_mempool_destroy(struct pw_mempool *pool)
 {
@@ -316,6 +397,10 @@ static struct mapping * memblock_map(struct memblock *b,
 
 	if (flags & PW_MEMMAP_FLAG_LOCKED)
 		fl |= MAP_LOCKED;
+#ifdef MAP_POPULATE
+	if (p->prefault)
+		fl |= MAP_POPULATE;
+#endif
 
 	if (flags & PW_MEMMAP_FLAG_TWICE) {
 		pw_log_error("%p: implement me PW_MEMMAP_FLAG_TWICE", p);
@@ -353,6 +438,7 @@ static struct mapping * memblock_map(struct memblock *b,
 	m->size = size;
 	b->this.ref++;
 	spa_list_append(&b->mappings, &m->link);
+	p->mapped += size;
 
         pw_log_debug("%p: block:%p fd:%d flags:%08x map:%p ptr:%p (%u %u) block-ref:%d", p, &b->this,
 			b->this.fd, b->this.flags, m, m->ptr, offset, size, b->this.ref);
@@ -368,8 +454,10 @@ static void mapping_free(struct mapping *m)
         pw_log_debug("%p: mapping:%p block:%p fd:%d ptr:%p size:%u block-ref:%d",
 			p, m, b, b->this.fd, m->ptr, m->size, b->this.ref);
 
-	if (m->do_unmap)
+	if (m->do_unmap) {
 		munmap(m->ptr, m->size);
+		p->mapped -= m->size;
+	}
 	spa_list_remove(&m->link);
 	free(m);
 }
@@ -384,6 +472,19 @@ static void mapping_unmap(struct mapping *m)
 	pw_memblock_unref(&b->this);
 }
 
+/* files on hugetlbfs need to be mapped at huge page boundaries */
+static uint32_t block_pagesize(struct mempool *p, int fd, const struct stat *sb)
+{
+#ifdef __linux__
+	struct statfs sfs;
+
+	if ((uint32_t) sb->st_blksize > p->pagesize &&
+	    fstatfs(fd, &sfs) == 0 && sfs.f_type == HUGETLBFS_MAGIC)
+		return sb->st_blksize;
+#endif
+	return p->pagesize;
+}
+
 SPA_EXPORT
 struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 		enum pw_memmap_flags flags, uint32_t offset, uint32_t size, uint32_t tag[5])
@@ -417,7 +518,7 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 		return NULL;
 	}
 
-	pw_map_range_init(&range, offset, size, p->pagesize);
+	pw_map_range_init(&range, offset, size, block_pagesize(p, b->this.fd, &sb));
 
 	m = memblock_find_mapping(b, flags, offset, size);
 	if (m == NULL)
@@ -438,7 +539,8 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 	mm->this.flags = flags;
 	mm->this.offset = offset;
 	mm->this.size = size;
-	mm->this.ptr = SPA_PTROFF(m->ptr, range.start, void);
+	/* the mapping can be an existing one that starts before offset */
+	mm->this.ptr = SPA_PTROFF(m->ptr, offset - m->offset, void);
 
         pw_log_debug("%p: map:%p block:%p fd:%d flags:%08x ptr:%p (%u %u) mapping:%p ref:%d", p,
 			&mm->this, b, b->this.fd, b->this.flags, mm->this.ptr, offset, size, m, m->ref);
@@ -469,6 +571,117 @@ struct pw_memmap * pw_mempool_map_id(struct pw_mempool *pool,
 	return pw_memblock_map(&b->this, flags, offset, size, tag);
 }
 
+static struct slab *slab_new(struct mempool *impl, uint32_t flags)
+{
+	struct pw_memblock *m;
+	struct slab_range *r;
+	struct slab *s;
+
+	if ((s = calloc(1, sizeof(*s))) == NULL)
+		return NULL;
+	if ((r = calloc(1, sizeof(*r))) == NULL)
+		goto error_free;
+
+	m = pw_mempool_alloc(&impl->this, flags, SPA_DATA_MemFd, impl->slab_size);
+	if (m == NULL)
+		goto error_free_range;
+
+	s->block = SPA_CONTAINER_OF(m, struct memblock, this);
+	s->block->slab = s;
+	s->flags = flags;
+	spa_list_init(&s->free);
+	r->offset = 0;
+	r->size = impl->slab_size;
+	spa_list_append(&s->free, &r->link);
+	spa_list_append(&impl->slabs, &s->link);
+
+	pw_log_debug("%p: new slab:%p block:%p id:%u size:%u", impl, s, m, m->id, m->size);
+	return s;
+
+error_free_range:
+	free(r);
+error_free:
+	free(s);
+	return NULL;
+}
+
+/* free the slab but not the block, this is done by the caller */
+static void slab_free(struct slab *s)
+{
+	struct slab_range *r;
+
+	spa_list_remove(&s->link);
+	spa_list_consume(r, &s->free, link) {
+		spa_list_remove(&r->link);
+		free(r);
+	}
+	s->block->slab = NULL;
+	free(s);
+}
+
+static int slab_alloc(struct slab *s, uint32_t size, uint32_t *offset)
+{
+	struct slab_range *r;
+
+	spa_list_for_each(r, &s->free, link) {
+		if (r->size < size)
+			continue;
+		*offset = r->offset;
+		r->offset += size;
+		r->size -= size;
+		if (r->size == 0) {
+			spa_list_remove(&r->link);
+			free(r);
+		}
+		s->used += size;
+		return 0;
+	}
+	return -ENOSPC;
+}
+
+static void slab_release(struct slab *s, uint32_t offset, uint32_t size)
+{
+	struct memblock *b = s->block;
+	struct slab_range *r, *prev = NULL, *next = NULL;
+
+	spa_list_for_each(r, &s->free, link) {
+		if (r->offset > offset) {
+			next = r;
+			break;
+		}
+		prev = r;
+	}
+	s->used -= size;
+
+	if (prev && prev->offset + prev->size == offset) {
+		prev->size += size;
+		if (next && prev->offset + prev->size == next->offset) {
+			prev->size += next->size;
+			spa_list_remove(&next->link);
+			free(next);
+		}
+	} else if (next && offset + size == next->offset) {
+		next->offset = offset;
+		next->size += size;
+	} else if ((r = calloc(1, sizeof(*r))) != NULL) {
+		r->offset = offset;
+		r->size = size;
+		if (next)
+			spa_list_insert(next->link.prev, &r->link);
+		else
+			spa_list_append(&s->free, &r->link);
+	} else {
+		pw_log_warn("%p: slab:%p lost %u bytes at %u: %m",
+				b->this.pool, s, size, offset);
+	}
+
+	if (s->used == 0) {
+		pw_log_debug("%p: free slab:%p block:%p", b->this.pool, s, b);
+		slab_free(s);
+		pw_memblock_unref(&b->this);
+	}
+}
+
 SPA_EXPORT
 int pw_memmap_free(struct pw_memmap *map)
 {
@@ -493,6 +706,11 @@ int pw_memmap_free(struct pw_memmap *map)
 	if (--m->ref == 0)
 		mapping_unmap(m);
 
+	if (mm->slab)
+		slab_release(mm->slab, mm->this.offset, mm->slice_size);
+	else if (mm->own_block)
+		pw_memblock_unref(&b->this);
+
 	free(mm);
 
 	return 0;
@@ -510,6 +728,42 @@ static inline enum pw_memmap_flags block_flags_to_mem(enum pw_memblock_flags fla
 	return fl;
 }
 
+#ifdef HAVE_MEMFD_CREATE
+/* Try to make a mapped block backed by huge pages. This fails when there are
+ * not enough huge pages reserved, the caller then uses normal pages. */
+static int alloc_hugetlb(struct mempool *impl, struct memblock *b, const char *name)
+{
+	int res;
+
+	b->this.fd = pw_memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+	if (b->this.fd == -1)
+		return -errno;
+
+	if (ftruncate(b->this.fd, SPA_ROUND_UP_N(b->this.size, impl->hugepagesize)) < 0) {
+		res = -errno;
+		goto error_close;
+	}
+	if (b->this.flags & PW_MEMBLOCK_FLAG_SEAL) {
+		unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+		if (fcntl(b->this.fd, F_ADD_SEALS, seals) == -1)
+			pw_log_warn("%p: Failed to add seals: %m", impl);
+	}
+	b->this.map = pw_memblock_map(&b->this,
+			block_flags_to_mem(b->this.flags), 0, b->this.size, NULL);
+	if (b->this.map == NULL) {
+		res = -errno;
+		goto error_close;
+	}
+	b->this.ref--;
+	return 0;
+
+error_close:
+	close(b->this.fd);
+	b->this.fd = -1;
+	return res;
+}
+#endif
+
 /** Create a new memblock
  * \param pool the pool to use
  * \param flags memblock flags
@@ -550,6 +804,17 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 		 "pipewire-memfd:flags=0x%08x,type=%" PRIu32 ",size=%zu",
 		 (unsigned int) flags, type, size);
 
+	if (impl->hugepagesize > 0 && size >= impl->hugepagesize &&
+	    SPA_FLAG_IS_SET(flags, PW_MEMBLOCK_FLAG_MAP)) {
+		if ((res = alloc_hugetlb(impl, b, name)) >= 0) {
+			pw_log_debug("%p: new hugetlb fd:%d", pool, b->this.fd);
+			goto done;
+		}
+		pw_log_warn("%p: can't allocate %zu bytes in huge pages, disabling: %s",
+				pool, size, spa_strerror(res));
+		impl->hugepagesize = 0;
+	}
+
 	b->this.fd = pw_memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_NOEXEC_SEAL);
 	if (b->this.fd == -1) {
 		res = -errno;
@@ -602,9 +867,14 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 		}
 		b->this.ref--;
 	}
-
+#ifdef HAVE_MEMFD_CREATE
+done:
+#endif
 	b->this.id = pw_map_insert_new(&impl->map, b);
 	spa_list_append(&impl->blocks, &b->link);
+	b->accounted = size;
+	impl->n_blocks++;
+	impl->size += b->accounted;
 	pw_log_debug("%p: block:%p id:%d type:%u flags:%08x size:%zu", pool,
 			&b->this, b->this.id, type, flags, size);
 
@@ -622,6 +892,73 @@ error_free:
 	return NULL;
 }
 
+/** Allocate a mapped slice of memory
+ * \param pool the pool to use
+ * \param flags memblock flags
+ * \param type the requested memory type one of enum spa_data_type
+ * \param size size to allocate
+ * \return a memmap of the slice or NULL with errno on error
+ *
+ * When the pool has slabs, small slices are packed together in shared
+ * memblocks, otherwise each slice gets its own memblock. Slices are aligned
+ * to PW_MEMPOOL_SLICE_ALIGN. The slice is released with pw_memmap_free().
+ */
+SPA_EXPORT
+struct pw_memmap * pw_mempool_alloc_map(struct pw_mempool *pool, enum pw_memblock_flags flags,
+		uint32_t type, size_t size)
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	struct pw_memblock *block;
+	struct pw_memmap *map;
+	struct memmap *mm;
+	struct slab *s;
+	uint32_t offset, slice_size;
+	int res;
+
+	flags |= PW_MEMBLOCK_FLAG_MAP;
+
+	if (impl->slab_size == 0 || type != SPA_DATA_MemFd ||
+	    size == 0 || size > impl->slab_size / 4) {
+		if ((block = pw_mempool_alloc(pool, flags, type, size)) == NULL)
+			return NULL;
+		map = pw_memblock_map(block, block_flags_to_mem(flags), 0, size, NULL);
+		if (map == NULL) {
+			res = -errno;
+			pw_memblock_unref(block);
+			errno = -res;
+			return NULL;
+		}
+		mm = SPA_CONTAINER_OF(map, struct memmap, this);
+		mm->own_block = true;
+		return map;
+	}
+
+	slice_size = SPA_ROUND_UP_N(size, PW_MEMPOOL_SLICE_ALIGN);
+
+	spa_list_for_each(s, &impl->slabs, link) {
+		if (s->flags == flags && slab_alloc(s, slice_size, &offset) >= 0)
+			goto found;
+	}
+	if ((s = slab_new(impl, flags)) == NULL)
+		return NULL;
+	slab_alloc(s, slice_size, &offset);
+found:
+	map = pw_memblock_map(&s->block->this, block_flags_to_mem(flags), offset, size, NULL);
+	if (map == NULL) {
+		res = -errno;
+		slab_release(s, offset, slice_size);
+		errno = -res;
+		return NULL;
+	}
+	mm = SPA_CONTAINER_OF(map, struct memmap, this);
+	mm->slab = s;
+	mm->slice_size = slice_size;
+
+	pw_log_debug("%p: slab:%p slice offset:%u size:%zu used:%u", pool, s,
+			offset, size, s->used);
+	return map;
+}
+
 static struct memblock * mempool_find_fd(struct pw_mempool *pool, int fd)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
@@ -646,6 +983,7 @@ struct pw_memblock * pw_mempool_import(struct pw_mempool *pool,
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
+	struct stat sb;
 
 	if (fd < 0) {
 		pw_log_error("%p: cannot import invalid fd:%d", pool, fd);
@@ -675,6 +1013,12 @@ struct pw_memblock * pw_mempool_import(struct pw_mempool *pool,
 	b->this.id = pw_map_insert_new(&impl->map, b);
 	spa_list_append(&impl->blocks, &b->link);
 
+	/* the size of imported memory is only known from the fd */
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0)
+		b->accounted = sb.st_size;
+	impl->n_blocks++;
+	impl->size += b->accounted;
+
 	pw_log_debug("%p: block:%p id:%u flags:%08x type:%u fd:%d",
 			pool, &b->this, b->this.id, flags, type, fd);
 
@@ -710,7 +1054,7 @@ struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 		struct pw_memblock *mem)
 {
 	struct pw_memblock *block;
-	struct memblock *b;
+	struct memblock *b, *root;
 
 	block = pw_mempool_import(pool,
 			mem->flags | PW_MEMBLOCK_FLAG_DONT_CLOSE,
@@ -718,6 +1062,12 @@ struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 	if (!block)
 		return NULL;
 
+	root = SPA_CONTAINER_OF(mem, struct memblock, this);
+	while (root->owner)
+		root = root->owner;
+	if (root->this.pool != pool)
+		root->exported = true;
+
 	pw_log_debug("%p: import block:%p flags:%08x type:%d fd:%d as %p", pool,
 			mem, mem->flags, mem->type, mem->fd, block);
 
@@ -813,6 +1163,18 @@ int pw_mempool_remove_id(struct pw_mempool *pool, uint32_t id)
 /** Free a memblock
  * \param block a memblock
  */
+/** Check if the fd of a block was ever imported in another pool. The
+ * users of the other pool, like clients, can keep the memory mapped
+ * after the block was removed from them. */
+bool pw_memblock_is_exported(struct pw_memblock *block)
+{
+	struct memblock *b = SPA_CONTAINER_OF(block, struct memblock, this);
+
+	while (b->owner)
+		b = b->owner;
+	return b->exported;
+}
+
 SPA_EXPORT
 void pw_memblock_free(struct pw_memblock *block)
 {
@@ -834,6 +1196,8 @@ void pw_memblock_free(struct pw_memblock *block)
 	if (block->id != SPA_ID_INVALID)
 		pw_map_remove(&impl->map, block->id);
 	spa_list_remove(&b->link);
+	impl->n_blocks--;
+	impl->size -= b->accounted;
 
 	if (!SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY))
 		pw_mempool_emit_removed(impl, block);
@@ -845,6 +1209,13 @@ void pw_memblock_free(struct pw_memblock *block)
 
 	memblock_emit_invalidated(b);
 
+	if (b->slab) {
+		/* the slices go away with the block */
+		spa_list_for_each(mm, &b->memmaps, link)
+			mm->slab = NULL;
+		slab_free(b->slab);
+	}
+
 	spa_list_consume(mm, &b->memmaps, link)
 		pw_memmap_free(&mm->this);
 
@@ -91,6 +91,13 @@ struct pw_mempool_events {
 	void (*removed) (void *data, struct pw_memblock *block);
 };
 
+/** Memory accounting of a pool */
+struct pw_mempool_stats {
+	uint32_t n_blocks;		/**< number of memory blocks */
+	uint64_t size;			/**< total size of the memory blocks */
+	uint64_t mapped;		/**< size of the memory mapped by the pool */
+};
+
 /** Create a new memory pool */
 struct pw_mempool *pw_mempool_new(struct pw_properties *props);
 
@@ -106,11 +113,22 @@ void pw_mempool_clear(struct pw_mempool *pool);
 /** Clear and destroy a pool */
 void pw_mempool_destroy(struct pw_mempool *pool);
 
+/** Get the memory accounting of a pool */
+int pw_mempool_get_stats(struct pw_mempool *pool, struct pw_mempool_stats *stats);
+
 
 /** Allocate a memory block from the pool */
 struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool,
 		enum pw_memblock_flags flags, uint32_t type, size_t size);
 
+/** alignment of the memory slices */
+#define PW_MEMPOOL_SLICE_ALIGN	64
+
+/** Allocate a mapped slice of memory from the pool, small slices can share
+ * a memblock. Free with pw_memmap_free() */
+struct pw_memmap * pw_mempool_alloc_map(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size);
+
 /** Import a block from another pool */
 struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 		struct pw_memblock *mem);
@@ -33,6 +33,8 @@
 
 #define SUPPORTLIB	"support/libspa-support"
 
+#define MAX_IDLE_PLUGINS	16
+
 PW_LOG_TOPIC_EXTERN(log_context);
 #define PW_LOG_TOPIC_DEFAULT log_context
 
@@ -59,6 +61,8 @@ struct handle {
 
 struct registry {
 	struct spa_list plugins;
+	struct spa_list idle;	/* unused plugins kept open for reuse (oldest first) */
+	uint32_t n_idle;
 	struct spa_list handles; /* all handles across all plugins by age (youngest first) */
 };
 
@@ -75,6 +79,7 @@ struct support {
 	unsigned int no_color:1;
 	unsigned int no_config:1;
 	unsigned int do_dlclose:1;
+	unsigned int config_cache:1;
 };
 
 static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -82,16 +87,25 @@ static pthread_mutex_t support_lock = PTHREAD_MUTEX_INITIALIZER;
 static struct support global_support;
 
 static struct plugin *
-find_plugin(struct registry *registry, const char *filename)
+find_plugin(struct spa_list *list, const char *filename)
 {
 	struct plugin *p;
-	spa_list_for_each(p, &registry->plugins, link) {
+	spa_list_for_each(p, list, link) {
 		if (spa_streq(p->filename, filename))
 			return p;
 	}
 	return NULL;
 }
 
+static void free_plugin(struct plugin *plugin)
+{
+	pw_log_debug("unloaded plugin:'%s'", plugin->filename);
+	if (pw_should_dlclose())
+		dlclose(plugin->hnd);
+	free(plugin->filename);
+	free(plugin);
+}
+
 static struct plugin *
 open_plugin(struct registry *registry,
 	    const char *path, size_t len, const char *lib)
@@ -105,10 +119,21 @@ open_plugin(struct registry *registry,
         if ((res = spa_scnprintf(filename, sizeof(filename), "%.*s/%s.so", (int)len, path, lib)) < 0)
 		goto error_out;
 
-	if ((plugin = find_plugin(registry, filename)) != NULL) {
+	if ((plugin = find_plugin(&registry->plugins, filename)) != NULL) {
 		plugin->ref++;
 		return plugin;
 	}
+	/* reuse a plugin that was unused but is still loaded, this avoids
+	 * a new dlopen and relocation when objects come and go */
+	if ((plugin = find_plugin(&registry->idle, filename)) != NULL) {
+		pw_log_debug("reuse plugin:'%s'", filename);
+		spa_list_remove(&plugin->link);
+		registry->n_idle--;
+		plugin->ref = 1;
+		spa_list_append(&registry->plugins, &plugin->link);
+		pw_log_topic_register_enum(plugin->log_topic_enum);
+		return plugin;
+	}
 
         if ((hnd = dlopen(filename, RTLD_NOW)) == NULL) {
 		res = -ENOENT;
@@ -147,19 +172,34 @@ error_out:
 }
 
 static void
-unref_plugin(struct plugin *plugin)
+unref_plugin(struct registry *registry, struct plugin *plugin)
 {
 	if (--plugin->ref == 0) {
 		spa_list_remove(&plugin->link);
 		pw_log_topic_unregister_enum(plugin->log_topic_enum);
-		pw_log_debug("unloaded plugin:'%s'", plugin->filename);
-		if (pw_should_dlclose())
-			dlclose(plugin->hnd);
-		free(plugin->filename);
-		free(plugin);
+
+		/* keep the plugin loaded, when there are too many unused
+		 * plugins, unload the oldest one */
+		spa_list_append(&registry->idle, &plugin->link);
+		if (++registry->n_idle > MAX_IDLE_PLUGINS) {
+			plugin = spa_list_first(&registry->idle, struct plugin, link);
+			spa_list_remove(&plugin->link);
+			registry->n_idle--;
+			free_plugin(plugin);
+		}
 	}
 }
 
+static void clear_idle_plugins(struct registry *registry)
+{
+	struct plugin *p;
+	spa_list_consume(p, &registry->idle, link) {
+		spa_list_remove(&p->link);
+		free_plugin(p);
+	}
+	registry->n_idle = 0;
+}
+
 static const struct spa_handle_factory *find_factory(struct plugin *plugin, const char *factory_name)
 {
 	int res = -ENOENT;
@@ -195,7 +235,7 @@ static void unref_handle(struct handle *handle)
 		pthread_mutex_unlock(&support_lock);
 		spa_handle_clear(&handle->handle);
 		pthread_mutex_lock(&support_lock);
-		unref_plugin(handle->plugin);
+		unref_plugin(&global_support.registry, handle->plugin);
 		free(handle->factory_name);
 		free(handle);
 	}
@@ -283,7 +323,7 @@ error_free_handle:
 	free(handle);
 error_unref_plugin:
 	pthread_mutex_lock(&support_lock);
-	unref_plugin(plugin);
+	unref_plugin(&sup->registry, plugin);
 error_out:
 	errno = -res;
 	return NULL;
@@ -487,7 +527,7 @@ SPA_EXPORT
 void pw_init(int *argc, char **argv[])
 {
 	const char *str;
-	struct spa_dict_item items[6];
+	struct spa_dict_item items[7];
 	uint32_t n_items;
 	struct spa_dict info;
 	struct support *support = &global_support;
@@ -513,6 +553,10 @@ void pw_init(int *argc, char **argv[])
 	if ((str = getenv("PIPEWIRE_NO_CONFIG")) != NULL)
 		support->no_config = pw_properties_parse_bool(str);
 
+	support->config_cache = true;
+	if ((str = getenv("PIPEWIRE_CONFIG_CACHE")) != NULL)
+		support->config_cache = pw_properties_parse_bool(str);
+
 	init_i18n(support);
 
 	if ((str = getenv("SPA_PLUGIN_DIR")) == NULL)
@@ -524,6 +568,7 @@ void pw_init(int *argc, char **argv[])
 	support->support_lib = str;
 
 	spa_list_init(&support->registry.plugins);
+	spa_list_init(&support->registry.idle);
 	spa_list_init(&support->registry.handles);
 
 	if (pw_log_is_default()) {
@@ -540,6 +585,8 @@ void pw_init(int *argc, char **argv[])
 		items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_LEVEL, level);
 		if ((str = getenv("PIPEWIRE_LOG")) != NULL)
 			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_FILE, str);
+		if ((str = getenv("PIPEWIRE_LOG_ASYNC")) != NULL)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LOG_ASYNC, str);
 		info = SPA_DICT_INIT(items, n_items);
 
 		log = add_interface(support, SPA_NAME_SUPPORT_LOG, SPA_TYPE_INTERFACE_Log, &info);
@@ -609,10 +656,12 @@ void pw_deinit(void)
 		goto done;
 
 	pthread_mutex_lock(&support_lock);
+	pw_conf_clear_match_cache();
 	pw_log_deinit();
 
 	spa_list_consume(h, &registry->handles, link)
 		unref_handle(h);
+	clear_idle_plugins(registry);
 
 	free(support->i18n_domain);
 	spa_zero(global_support);
@@ -733,6 +782,8 @@ bool pw_check_option(const char *option, const char *value)
 		return global_support.no_config == spa_atob(value);
 	else if (spa_streq(option, "do-dlclose"))
 		return global_support.do_dlclose == spa_atob(value);
+	else if (spa_streq(option, "config-cache"))
+		return global_support.config_cache == spa_atob(value);
 	return false;
 }
 
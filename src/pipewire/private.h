@@ -50,6 +50,7 @@ struct settings {
 	unsigned int mem_warn_mlock:1;
 	unsigned int mem_allow_mlock:1;
 	unsigned int clock_power_of_two_quantum:1;
+	unsigned int clock_elastic_quantum:1;
 	unsigned int check_quantum:1;
 	unsigned int check_rate:1;
 #define CLOCK_RATE_UPDATE_MODE_HARD 0
@@ -185,6 +186,7 @@ typedef uint32_t (*pw_permission_func_t) (struct pw_global *global,
 #define pw_impl_client_emit_resource_impl(o,r)		pw_impl_client_emit(o, resource_impl, 0, r)
 #define pw_impl_client_emit_resource_removed(o,r)	pw_impl_client_emit(o, resource_removed, 0, r)
 #define pw_impl_client_emit_busy_changed(o,b)		pw_impl_client_emit(o, busy_changed, 0, b)
+#define pw_impl_client_emit_congested_changed(o,c)	pw_impl_client_emit(o, congested_changed, 1, c)
 
 #define pw_impl_core_emit(s,m,v,...) spa_hook_list_call(&s->listener_list, struct pw_impl_core_events, m, v, ##__VA_ARGS__)
 
@@ -241,6 +243,7 @@ struct pw_impl_client {
 
 	pw_permission_func_t permission_func;	/**< get permissions of an object */
 	void *permission_data;			/**< data passed to permission function */
+	struct spa_list registry_list;		/**< registry resources of the client */
 
 	struct pw_properties *properties;	/**< Client properties */
 
@@ -267,6 +270,7 @@ struct pw_impl_client {
 	unsigned int ucred_valid:1;	/**< if the ucred member is valid */
 	unsigned int busy:1;
 	unsigned int destroyed:1;
+	unsigned int congested:1;	/**< messages are queued for the client */
 
 	int refcount;
 
@@ -393,6 +397,20 @@ struct pw_context {
 
 	struct pw_mempool *pool;		/**< global memory pool */
 
+	struct {
+		struct spa_list entries;	/**< recycled buffer memory, most recent first */
+		size_t size;			/**< size of the recycled memory */
+		size_t max_size;		/**< max size of the recycled memory */
+		uint64_t hits;			/**< allocations served from the cache */
+		uint64_t misses;		/**< allocations not found in the cache */
+	} buffer_cache;
+
+	struct {
+		struct spa_list entries;	/**< negotiated formats, most recent first */
+		uint32_t n_entries;		/**< number of cached formats */
+		uint32_t max_entries;		/**< max number of cached formats */
+	} format_cache;
+
 	uint64_t stamp;
 	uint64_t serial;
 	uint64_t generation;			/**< registry generation number */
@@ -637,6 +655,9 @@ struct pw_node_activation {
 	uint32_t command;				/* next command */
 	uint32_t reposition_owner;			/* owner id with new reposition info, last one
 							 * to update wins */
+	uint32_t overrun_count;				/* number of cycles where the node was still
+							 * processing when the next cycle started */
+	uint64_t overrun_time;				/* time of last overrun in microseconds */
 };
 
 static inline uint64_t get_time_ns(struct spa_system *system)
@@ -772,6 +793,8 @@ struct pw_impl_node {
 	unsigned int sync:1;		/**< the sync-groups are active */
 	unsigned int transport:1;	/**< the transport is active */
 	unsigned int async:1;		/**< async processing, one cycle latency */
+	unsigned int recalc_state:1;	/**< the state needs to be updated in the next
+					  *  graph recalc */
 
 	uint32_t port_user_data_size;	/**< extra size for port user data */
 
@@ -804,7 +827,7 @@ struct pw_impl_node {
 	uint32_t force_rate;			/**< forced rate */
 	uint32_t stamp;				/**< stamp of last update */
 	struct spa_source source;		/**< source to remotely trigger this node */
-	struct pw_memblock *activation;
+	struct pw_memmap *activation;		/**< mapped activation record */
 	struct {
 		struct spa_io_clock *clock;	/**< io area of the clock or NULL */
 		struct spa_io_position *position;
@@ -817,6 +840,7 @@ struct pw_impl_node {
 		struct pw_node_target target;		/* our target that is signaled by the
 							   driver */
 		struct spa_list driver_link;		/* our link in driver */
+		struct spa_list ready_link;		/* link in ready list of the data loop */
 
 		struct spa_ratelimit rate_limit;
 
@@ -830,6 +854,10 @@ struct pw_impl_node {
 	uint64_t driver_start;
 	uint64_t elapsed;		/* elapsed time in playing */
 
+	uint64_t process_time;		/* running estimate of the processing time */
+	uint64_t critical_path;		/* longest processing time from this node to
+					 * the end of the cycle, for sorting targets */
+
 	void *user_data;                /**< extra user data */
 };
 
@@ -849,6 +877,7 @@ struct pw_impl_port_mix {
 	struct {
 		bool active;
 		struct spa_list link;
+		uint64_t held;		/**< shared buffers held by the peer */
 	} rt;
 };
 
@@ -945,6 +974,8 @@ struct pw_impl_port {
 	} rt;					/**< data only accessed from the data thread */
 	unsigned int destroying:1;
 	unsigned int passive:1;
+	unsigned int shared_buffers:1;	/**< output buffers are refcounted between all links */
+	uint32_t n_shared_links;	/**< prepared links using the output buffers */
 	int busy_count;
 
 	struct spa_latency_info latency[2];	/**< latencies */
@@ -955,6 +986,8 @@ struct pw_impl_port {
 	unsigned int have_tag_param:1;
 	struct spa_pod *tag[2];			/**< tags */
 
+	uint64_t format_serial;			/**< unique, changes when the formats change */
+
 	void *owner_data;		/**< extra owner data */
 	void *user_data;                /**< extra user data */
 };
@@ -1029,6 +1062,7 @@ struct pw_resource {
 	struct pw_context *context;	/**< the context object */
 	struct pw_global *global;	/**< global of resource */
 	struct spa_list link;		/**< link in global resource_list */
+	struct spa_list registry_link;	/**< link in client registry_list */
 
 	struct pw_impl_client *client;	/**< owner client */
 
@@ -1261,6 +1295,12 @@ void pw_proxy_remove(struct pw_proxy *proxy);
 
 int pw_context_recalc_graph(struct pw_context *context, const char *reason);
 
+struct pw_mempool *pw_context_new_mempool(struct pw_context *context);
+
+void pw_buffers_cache_clear(struct pw_context *context);
+
+bool pw_memblock_is_exported(struct pw_memblock *block);
+
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
 int pw_impl_port_register(struct pw_impl_port *port,
@@ -1328,9 +1368,15 @@ int pw_impl_port_recalc_tag(struct pw_impl_port *port);
 /** Change the state of the node */
 int pw_impl_node_set_state(struct pw_impl_node *node, enum pw_node_state state);
 
+/** Check if the node is in \a state and no state update is needed */
+bool pw_impl_node_state_is_settled(struct pw_impl_node *node, enum pw_node_state state);
+
 
 int pw_impl_node_update_ports(struct pw_impl_node *node);
 
+/** Update the memory accounting properties of the node */
+void pw_impl_node_update_memory(struct pw_impl_node *node);
+
 int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driver);
 
 int pw_impl_node_trigger(struct pw_impl_node *node);
@@ -1339,6 +1385,7 @@ int pw_impl_node_set_io(struct pw_impl_node *node, uint32_t id, void *data, size
 
 int pw_impl_node_add_target(struct pw_impl_node *node, struct pw_node_target *t);
 int pw_impl_node_remove_target(struct pw_impl_node *node, struct pw_node_target *t);
+int pw_impl_node_sort_targets(struct pw_impl_node *node);
 
 /** Prepare a link
   * Starts the negotiation of formats and buffers on \a link */
@@ -1392,6 +1439,8 @@ void pw_settings_init(struct pw_context *context);
 int pw_settings_expose(struct pw_context *context);
 void pw_settings_clean(struct pw_context *context);
 
+void pw_conf_clear_match_cache(void);
+
 bool pw_should_dlclose(void);
 
 void pw_log_topic_register_enum(const struct spa_log_topic_enum *e);
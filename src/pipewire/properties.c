@@ -25,9 +25,17 @@ struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	/* open addressing hash index on the keys, slots contain the item
+	 * index + 1 or 0 when free. Only used with INDEX_MIN_ITEMS or more
+	 * items, mask is 0 when there is no index. */
+	uint32_t *index;
+	uint32_t mask;
 };
 /** \endcond */
 
+#define INDEX_MIN_ITEMS		16
+
 static int add_item(struct properties *impl, const char *key, bool take_key, const char *value, bool take_value)
 {
 	struct spa_dict_item *item;
@@ -68,6 +76,112 @@ static void clear_item(struct spa_dict_item *item)
 	free((char *) item->value);
 }
 
+static inline uint32_t key_hash(const char *key)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	while (*key)
+		h = (h ^ (uint8_t)*key++) * 16777619u;
+	return h;
+}
+
+static inline struct spa_dict_item *get_item(const struct properties *impl, uint32_t idx)
+{
+	return pw_array_get_unchecked(&impl->items, idx, struct spa_dict_item);
+}
+
+/* find the slot with key or the free slot where it should go */
+static uint32_t index_find_slot(const struct properties *impl, const char *key)
+{
+	uint32_t pos = key_hash(key) & impl->mask;
+
+	while (impl->index[pos] != 0 &&
+	    !spa_streq(get_item(impl, impl->index[pos] - 1)->key, key))
+		pos = (pos + 1) & impl->mask;
+	return pos;
+}
+
+static void index_free(struct properties *impl)
+{
+	free(impl->index);
+	impl->index = NULL;
+	impl->mask = 0;
+}
+
+static void index_rebuild(struct properties *impl)
+{
+	uint32_t i, size, n_items = pw_array_get_len(&impl->items, struct spa_dict_item);
+
+	index_free(impl);
+	if (n_items < INDEX_MIN_ITEMS)
+		return;
+
+	/* keep the load factor below 1/2 */
+	for (size = 32; size < n_items * 2; size <<= 1);
+	if ((impl->index = calloc(size, sizeof(uint32_t))) == NULL)
+		return;
+	impl->mask = size - 1;
+
+	for (i = 0; i < n_items; i++)
+		impl->index[index_find_slot(impl, get_item(impl, i)->key)] = i + 1;
+}
+
+/* the last item was appended */
+static void index_add(struct properties *impl)
+{
+	uint32_t n_items = pw_array_get_len(&impl->items, struct spa_dict_item);
+
+	if (impl->mask == 0 || n_items * 2 > impl->mask + 1) {
+		index_rebuild(impl);
+		return;
+	}
+	impl->index[index_find_slot(impl, get_item(impl, n_items - 1)->key)] = n_items;
+}
+
+/* item is removed and the last item will be moved in its place */
+static void index_remove(struct properties *impl, struct spa_dict_item *item)
+{
+	uint32_t n_items = pw_array_get_len(&impl->items, struct spa_dict_item);
+	uint32_t pos, next, want, idx = item - get_item(impl, 0);
+
+	if (impl->mask == 0)
+		return;
+
+	if (n_items - 1 < INDEX_MIN_ITEMS / 2) {
+		index_free(impl);
+		return;
+	}
+	pos = index_find_slot(impl, item->key);
+	impl->index[pos] = 0;
+
+	/* shift back the following entries of the cluster into the free slot */
+	for (next = (pos + 1) & impl->mask; impl->index[next] != 0;
+	     next = (next + 1) & impl->mask) {
+		want = key_hash(get_item(impl, impl->index[next] - 1)->key) & impl->mask;
+		if (((next - want) & impl->mask) >= ((next - pos) & impl->mask)) {
+			impl->index[pos] = impl->index[next];
+			impl->index[next] = 0;
+			pos = next;
+		}
+	}
+	if (idx != n_items - 1)
+		impl->index[index_find_slot(impl, get_item(impl, n_items - 1)->key)] = idx + 1;
+}
+
+static const struct spa_dict_item *find_item(const struct properties *impl, const char *key)
+{
+	const struct spa_dict *dict = &impl->this.dict;
+	uint32_t idx;
+
+	/* the items could have been sorted in place with spa_dict_qsort(), the
+	 * index is then stale until the next rebuild but we can bsearch */
+	if (impl->mask == 0 || SPA_FLAG_IS_SET(dict->flags, SPA_DICT_FLAG_SORTED))
+		return spa_dict_lookup_item(dict, key);
+
+	idx = impl->index[index_find_slot(impl, key)];
+	return idx ? get_item(impl, idx - 1) : NULL;
+}
+
 static void properties_init(struct properties *impl, int prealloc)
 {
 	pw_array_init(&impl->items, 16);
@@ -113,6 +227,7 @@ struct pw_properties *pw_properties_new(const char *key, ...)
 	}
 	va_end(varargs);
 	update_dict(&impl->this);
+	index_rebuild(impl);
 
 	return &impl->this;
 error:
@@ -144,6 +259,7 @@ struct pw_properties *pw_properties_new_dict(const struct spa_dict *dict)
 				goto error;
 	}
 	update_dict(&impl->this);
+	index_rebuild(impl);
 
 	return &impl->this;
 
@@ -158,12 +274,13 @@ static int do_replace(struct pw_properties *properties, const char *key, bool ta
 {
 	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
 	struct spa_dict_item *item;
+	bool sorted = SPA_FLAG_IS_SET(properties->dict.flags, SPA_DICT_FLAG_SORTED);
 	int res = 0;
 
 	if (key == NULL || key[0] == 0)
 		goto exit_noupdate;
 
-	item = (struct spa_dict_item*) spa_dict_lookup_item(&properties->dict, key);
+	item = (struct spa_dict_item*) find_item(impl, key);
 
 	if (item == NULL) {
 		if (value == NULL)
@@ -171,6 +288,11 @@ static int do_replace(struct pw_properties *properties, const char *key, bool ta
 		if ((res = add_item(impl, key, take_key, value, take_value)) < 0)
 			return res;
 		SPA_FLAG_CLEAR(properties->dict.flags, SPA_DICT_FLAG_SORTED);
+		update_dict(properties);
+		if (sorted)
+			index_rebuild(impl);
+		else
+			index_add(impl);
 	} else {
 		if (value && spa_streq(item->value, value))
 			goto exit_noupdate;
@@ -179,11 +301,15 @@ static int do_replace(struct pw_properties *properties, const char *key, bool ta
 			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
 						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
 						     struct spa_dict_item);
+			if (!sorted)
+				index_remove(impl, item);
 			clear_item(item);
 			item->key = last->key;
 			item->value = last->value;
 			impl->items.size -= sizeof(struct spa_dict_item);
 			SPA_FLAG_CLEAR(properties->dict.flags, SPA_DICT_FLAG_SORTED);
+			if (sorted)
+				index_rebuild(impl);
 		} else {
 			char *v = NULL;
 			if (!take_value && value && (v = strdup(value)) == NULL) {
@@ -249,8 +375,9 @@ static int update_string(struct pw_properties *props, const char *str, size_t si
 			}
 		}
 		if (props) {
+			struct properties *impl = SPA_CONTAINER_OF(props, struct properties, this);
 			const struct spa_dict_item *item;
-			item = spa_dict_lookup_item(&props->dict, key);
+			item = find_item(impl, key);
 			if (item && spa_streq(item->value, val)) {
 				free(val);
 				continue;
@@ -465,6 +592,7 @@ void pw_properties_clear(struct pw_properties *properties)
 		clear_item(item);
 	pw_array_reset(&impl->items);
 	properties->dict.n_items = 0;
+	index_free(impl);
 }
 
 /** Update properties
@@ -639,7 +767,13 @@ int pw_properties_setf(struct pw_properties *properties, const char *key, const
 SPA_EXPORT
 const char *pw_properties_get(const struct pw_properties *properties, const char *key)
 {
-	return spa_dict_lookup(&properties->dict, key);
+	const struct properties *impl = SPA_CONTAINER_OF(properties, const struct properties, this);
+	const struct spa_dict_item *item;
+
+	if (key == NULL)
+		return NULL;
+	item = find_item(impl, key);
+	return item ? item->value : NULL;
 }
 
 /** Fetch a property as uint32_t.
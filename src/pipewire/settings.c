@@ -28,6 +28,7 @@
 #define DEFAULT_CLOCK_QUANTUM_LIMIT		8192u
 #define DEFAULT_CLOCK_QUANTUM_FLOOR		4u
 #define DEFAULT_CLOCK_POWER_OF_TWO_QUANTUM	true
+#define DEFAULT_CLOCK_ELASTIC_QUANTUM		false
 #define DEFAULT_VIDEO_WIDTH			640
 #define DEFAULT_VIDEO_HEIGHT			480
 #define DEFAULT_VIDEO_RATE_NUM			25u
@@ -222,6 +223,8 @@ void pw_settings_init(struct pw_context *this)
 	d->log_level = get_default_int(p, "log.level", pw_log_level);
 	d->clock_power_of_two_quantum = get_default_bool(p, "clock.power-of-two-quantum",
 			DEFAULT_CLOCK_POWER_OF_TWO_QUANTUM);
+	d->clock_elastic_quantum = get_default_bool(p, "clock.elastic-quantum",
+			DEFAULT_CLOCK_ELASTIC_QUANTUM);
 	d->link_max_buffers = get_default_int(p, "link.max-buffers", DEFAULT_LINK_MAX_BUFFERS);
 	d->mem_warn_mlock = get_default_bool(p, "mem.warn-mlock", DEFAULT_MEM_WARN_MLOCK);
 	d->mem_allow_mlock = get_default_bool(p, "mem.allow-mlock", DEFAULT_MEM_ALLOW_MLOCK);
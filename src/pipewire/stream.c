@@ -32,6 +32,8 @@ PW_LOG_TOPIC_EXTERN(log_stream);
 
 #define MASK_BUFFERS	(MAX_BUFFERS-1)
 
+#define CACHE_LINE_SIZE	64
+
 static bool mlock_warned = false;
 
 struct buffer {
@@ -56,6 +58,13 @@ struct data {
 	struct spa_hook stream_listener;
 };
 
+struct ring {
+	struct spa_ringbuffer rb;
+	uint32_t size;
+	uint32_t stride;
+	void *data;
+};
+
 struct param {
 	uint32_t id;
 #define PARAM_FLAG_LOCKED	(1 << 0)
@@ -95,8 +104,6 @@ struct stream {
 
 	struct spa_io_buffers *io;
 	struct spa_io_rate_match *rate_match;
-	uint32_t rate_queued;
-	uint64_t rate_size;
 
 	uint64_t port_change_mask_all;
 	struct spa_port_info port_info;
@@ -132,15 +139,27 @@ struct stream {
 	struct queue queued;
 
 	struct data data;
+
+	/* the time snapshot, written by the data thread in copy_position() and
+	 * read with the seq from any thread in pw_stream_get_time_n(). It is
+	 * kept on its own cache lines so that readers don't contend with the
+	 * other fields of the stream. */
+	uint8_t _pad0[CACHE_LINE_SIZE];
 	uintptr_t seq;
 	struct pw_time time;
+	uint64_t quantum;
+	uint32_t rate_queued;
+	uint64_t rate_size;
+	uint8_t _pad1[CACHE_LINE_SIZE];
+
 	uint64_t base_pos;
 	uint32_t clock_id;
 	struct spa_latency_info latency;
-	uint64_t quantum;
 
 	struct spa_callbacks rt_callbacks;
 
+	struct ring *ring;
+
 	unsigned int disconnecting:1;
 	unsigned int disconnect_core:1;
 	unsigned int draining:1;
@@ -431,13 +450,96 @@ static inline uint32_t update_requested(struct stream *impl)
 	return buffer->this.requested > 0 ? 1 : 0;
 }
 
+/* fill the next free buffer from the ring, pad with silence */
+static void ring_process_output(struct stream *impl, struct ring *r)
+{
+	struct buffer *b;
+	struct spa_data *d;
+	uint32_t index, size, n;
+	int32_t avail;
+
+	if ((b = queue_pop(impl, &impl->dequeued)) == NULL)
+		return;
+	if (b->busy && SPA_ATOMIC_INC(b->busy->count) > 1) {
+		SPA_ATOMIC_DEC(b->busy->count);
+		queue_push(impl, &impl->dequeued, b);
+		return;
+	}
+
+	d = &b->this.buffer->datas[0];
+	size = d->data ? d->maxsize / r->stride : 0;
+	if (b->this.requested > 0)
+		size = SPA_MIN(size, b->this.requested);
+	size *= r->stride;
+
+	avail = spa_ringbuffer_get_read_index(&r->rb, &index);
+	n = SPA_CLAMP(avail, 0, (int32_t)size);
+	n -= n % r->stride;
+	if (n > 0) {
+		spa_ringbuffer_read_data(&r->rb, r->data, r->size, index & (r->size - 1),
+				d->data, n);
+		spa_ringbuffer_read_update(&r->rb, index + n);
+	}
+	if (n < size) {
+		pw_log_trace_fp("%p: ring underrun %u < %u", impl, n, size);
+		memset(SPA_PTROFF(d->data, n, void), 0, size - n);
+	}
+	d->chunk->offset = 0;
+	d->chunk->size = size;
+	d->chunk->stride = r->stride;
+	d->chunk->flags = 0;
+	b->this.size = size / r->stride;
+
+	if (b->busy)
+		SPA_ATOMIC_DEC(b->busy->count);
+	queue_push(impl, &impl->queued, b);
+}
+
+/* move the data of the received buffers into the ring */
+static void ring_process_input(struct stream *impl, struct ring *r)
+{
+	struct buffer *b;
+	struct spa_data *d;
+	uint32_t index, offset, size, n;
+	int32_t filled;
+
+	while ((b = queue_pop(impl, &impl->dequeued)) != NULL) {
+		d = &b->this.buffer->datas[0];
+		offset = SPA_MIN(d->chunk->offset, d->maxsize);
+		size = SPA_MIN(d->chunk->size, d->maxsize - offset);
+		if (d->data == NULL)
+			size = 0;
+
+		filled = spa_ringbuffer_get_write_index(&r->rb, &index);
+		n = SPA_CLAMP((int32_t)r->size - filled, 0, (int32_t)size);
+		n -= n % r->stride;
+		if (n > 0) {
+			spa_ringbuffer_write_data(&r->rb, r->data, r->size, index & (r->size - 1),
+					SPA_PTROFF(d->data, offset, void), n);
+			spa_ringbuffer_write_update(&r->rb, index + n);
+		}
+		if (n < size) {
+			pw_log_trace_fp("%p: ring overrun %u < %u", impl, n, size);
+		}
+
+		if (b->busy)
+			SPA_ATOMIC_DEC(b->busy->count);
+		queue_push(impl, &impl->queued, b);
+	}
+}
+
 static inline void call_process(struct stream *impl)
 {
 	pw_log_trace_fp("%p: call process buffers:%d", impl, impl->n_buffers);
 	if (impl->n_buffers == 0 ||
 	    (impl->direction == SPA_DIRECTION_OUTPUT && update_requested(impl) <= 0))
 		return;
-	if (impl->rt_callbacks.funcs)
+	if (impl->ring) {
+		if (impl->direction == SPA_DIRECTION_OUTPUT)
+			ring_process_output(impl, impl->ring);
+		else
+			ring_process_input(impl, impl->ring);
+	} else if (impl->rt_callbacks.funcs)
 		spa_callbacks_call_fast(&impl->rt_callbacks, struct pw_stream_events, process, 0);
 }
 
@@ -623,6 +725,7 @@ static inline void copy_position(struct stream *impl, int64_t queued)
 	if (SPA_LIKELY(p != NULL)) {
 		impl->time.now = p->clock.nsec;
 		impl->time.rate = p->clock.rate;
+		impl->time.rate_diff = p->clock.rate_diff > 0.0 ? p->clock.rate_diff : 1.0;
 		if (SPA_UNLIKELY(impl->clock_id != p->clock.id)) {
 			impl->base_pos = p->clock.position - impl->time.ticks;
 			impl->clock_id = p->clock.id;
@@ -1672,6 +1775,7 @@ void pw_stream_destroy(struct pw_stream *stream)
 		pw_context_destroy(impl->data.context);
 
 	pw_properties_free(impl->port_props);
+	free(impl->ring);
 	free(impl);
 }
 
@@ -1957,6 +2061,10 @@ pw_stream_connect(struct pw_stream *stream,
 		if (pw_properties_get(stream->properties, PW_KEY_NODE_DONT_RECONNECT) == NULL)
 			pw_properties_set(stream->properties, PW_KEY_NODE_DONT_RECONNECT, "true");
 
+	/* the ring is filled and drained in the realtime thread */
+	if (impl->ring != NULL)
+		flags |= PW_STREAM_FLAG_RT_PROCESS | PW_STREAM_FLAG_MAP_BUFFERS;
+
 	if (!SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_RT_PROCESS)) {
 		if (pw_properties_get(stream->properties, PW_KEY_NODE_LOOP_CLASS) == NULL)
 			pw_properties_set(stream->properties, PW_KEY_NODE_LOOP_CLASS, "main");
@@ -2352,7 +2460,7 @@ int pw_stream_get_time_n(struct pw_stream *stream, struct pw_time *time, size_t
 		time->queued_buffers = impl->n_buffers - avail_buffers;
 	if (size >= offsetof(struct pw_time, size))
 		time->avail_buffers = avail_buffers;
-	if (size >= sizeof(struct pw_time))
+	if (size >= offsetof(struct pw_time, rate_diff))
 		time->size = rate_size;
 
 	pw_log_trace_fp("%p: %"PRIi64" %"PRIi64" %"PRIu64" %d/%d %"PRIu64" %"
@@ -2396,6 +2504,10 @@ struct pw_buffer *pw_stream_dequeue_buffer(struct pw_stream *stream)
 	struct buffer *b;
 	int res;
 
+	if (impl->ring != NULL) {
+		errno = EBUSY;
+		return NULL;
+	}
 	if ((b = queue_pop(impl, &impl->dequeued)) == NULL) {
 		res = -errno;
 		pw_log_trace_fp("%p: no more buffers: %m", stream);
@@ -2417,6 +2529,124 @@ struct pw_buffer *pw_stream_dequeue_buffer(struct pw_stream *stream)
 	return &b->this;
 }
 
+SPA_EXPORT
+int pw_stream_dequeue_buffers(struct pw_stream *stream, struct pw_buffer **buffers,
+		uint32_t n_buffers)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct queue *queue = &impl->dequeued;
+	struct buffer *b;
+	uint32_t index, i, n;
+	int32_t avail;
+
+	if (impl->ring != NULL)
+		return -EBUSY;
+
+	/* take the buffers with one update of the queue */
+	avail = spa_ringbuffer_get_read_index(&queue->ring, &index);
+	n = SPA_CLAMP(avail, 0, (int32_t)SPA_MIN(n_buffers, (uint32_t)INT32_MAX));
+
+	for (i = 0; i < n; i++) {
+		b = &impl->buffers[queue->ids[(index + i) & MASK_BUFFERS]];
+
+		/* stop at the first buffer that the peer still uses */
+		if (b->busy && impl->direction == SPA_DIRECTION_OUTPUT) {
+			if (SPA_ATOMIC_INC(b->busy->count) > 1) {
+				SPA_ATOMIC_DEC(b->busy->count);
+				pw_log_trace_fp("%p: buffer %d busy", stream, b->id);
+				break;
+			}
+		}
+		queue->outcount += b->this.size;
+		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_QUEUED);
+		buffers[i] = &b->this;
+	}
+	if (i > 0)
+		spa_ringbuffer_read_update(&queue->ring, index + i);
+
+	pw_log_trace_fp("%p: dequeued %u/%u buffers", stream, i, n_buffers);
+	return i;
+}
+
+SPA_EXPORT
+int pw_stream_queue_buffers(struct pw_stream *stream, struct pw_buffer **buffers,
+		uint32_t n_buffers)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct queue *queue = &impl->queued;
+	struct buffer *b;
+	uint32_t index, i, j;
+	int res = 0;
+
+	for (i = 0; i < n_buffers; i++) {
+		b = SPA_CONTAINER_OF(buffers[i], struct buffer, this);
+		if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_QUEUED) ||
+		    b->id >= impl->n_buffers)
+			return -EINVAL;
+		for (j = 0; j < i; j++)
+			if (buffers[j] == buffers[i])
+				return -EINVAL;
+	}
+	if (n_buffers == 0)
+		return 0;
+
+	/* add the buffers with one update of the queue */
+	spa_ringbuffer_get_write_index(&queue->ring, &index);
+	for (i = 0; i < n_buffers; i++) {
+		b = SPA_CONTAINER_OF(buffers[i], struct buffer, this);
+		if (b->busy)
+			SPA_ATOMIC_DEC(b->busy->count);
+		SPA_FLAG_SET(b->flags, BUFFER_FLAG_QUEUED);
+		queue->incount += b->this.size;
+		queue->ids[(index + i) & MASK_BUFFERS] = b->id;
+	}
+	spa_ringbuffer_write_update(&queue->ring, index + n_buffers);
+
+	pw_log_trace_fp("%p: queued %u buffers", stream, n_buffers);
+
+	if (impl->direction == SPA_DIRECTION_OUTPUT &&
+	    stream->node->driving && !impl->using_trigger) {
+		pw_log_debug("deprecated: use pw_stream_trigger_process() to drive the stream.");
+		res = pw_loop_invoke(impl->data_loop,
+			do_trigger_deprecated, 1, NULL, 0, false, impl);
+	}
+	return res;
+}
+
+SPA_EXPORT
+struct spa_meta_sync_timeline *pw_stream_get_sync_timeline(struct pw_stream *stream,
+		struct pw_buffer *buffer, int *acquire_fd, int *release_fd)
+{
+	struct spa_buffer *buf = buffer->buffer;
+	struct spa_meta_sync_timeline *stl;
+	uint32_t i, n_syncobj = 0;
+	int fds[2] = { -1, -1 };
+
+	stl = spa_buffer_find_meta_data(buf, SPA_META_SyncTimeline, sizeof(*stl));
+	if (stl == NULL)
+		goto not_supported;
+
+	/* the acquire and release syncobjs are the last datas */
+	for (i = 0; i < buf->n_datas && n_syncobj < 2; i++) {
+		if (buf->datas[i].type == SPA_DATA_SyncObj)
+			fds[n_syncobj++] = buf->datas[i].fd;
+	}
+	if (n_syncobj == 0)
+		goto not_supported;
+	if (n_syncobj == 1)
+		fds[1] = fds[0];
+
+	if (acquire_fd)
+		*acquire_fd = fds[0];
+	if (release_fd)
+		*release_fd = fds[1];
+	return stl;
+
+not_supported:
+	errno = ENOTSUP;
+	return NULL;
+}
+
 SPA_EXPORT
 int pw_stream_queue_buffer(struct pw_stream *stream, struct pw_buffer *buffer)
 {
@@ -2498,6 +2728,77 @@ int pw_stream_flush(struct pw_stream *stream, bool drain)
 	return 0;
 }
 
+SPA_EXPORT
+int pw_stream_set_ring(struct pw_stream *stream, uint32_t size, uint32_t stride)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r;
+
+	if (stream->node != NULL)
+		return -EBUSY;
+	if (size == 0 || (size & (size - 1)) != 0 || size > INT32_MAX ||
+	    stride == 0 || stride > size)
+		return -EINVAL;
+
+	if ((r = calloc(1, sizeof(*r) + size)) == NULL)
+		return -errno;
+
+	spa_ringbuffer_init(&r->rb);
+	r->size = size;
+	r->stride = stride;
+	r->data = SPA_PTROFF(r, sizeof(*r), void);
+
+	pw_log_debug("%p: ring size:%u stride:%u", impl, size, stride);
+
+	free(impl->ring);
+	impl->ring = r;
+	return 0;
+}
+
+SPA_EXPORT
+int pw_stream_ring_write(struct pw_stream *stream, const void *data, uint32_t size)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r = impl->ring;
+	uint32_t index, n;
+	int32_t filled;
+
+	if (r == NULL)
+		return -EINVAL;
+
+	filled = spa_ringbuffer_get_write_index(&r->rb, &index);
+	n = SPA_CLAMP((int32_t)r->size - filled, 0, (int32_t)SPA_MIN(size, (uint32_t)INT32_MAX));
+	n -= n % r->stride;
+	if (n > 0) {
+		spa_ringbuffer_write_data(&r->rb, r->data, r->size, index & (r->size - 1),
+				data, n);
+		spa_ringbuffer_write_update(&r->rb, index + n);
+	}
+	return n;
+}
+
+SPA_EXPORT
+int pw_stream_ring_read(struct pw_stream *stream, void *data, uint32_t size)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r = impl->ring;
+	uint32_t index, n;
+	int32_t avail;
+
+	if (r == NULL)
+		return -EINVAL;
+
+	avail = spa_ringbuffer_get_read_index(&r->rb, &index);
+	n = SPA_CLAMP(avail, 0, (int32_t)SPA_MIN(size, (uint32_t)INT32_MAX));
+	n -= n % r->stride;
+	if (n > 0) {
+		spa_ringbuffer_read_data(&r->rb, r->data, r->size, index & (r->size - 1),
+				data, n);
+		spa_ringbuffer_read_update(&r->rb, index + n);
+	}
+	return n;
+}
+
 SPA_EXPORT
 bool pw_stream_is_driving(struct pw_stream *stream)
 {
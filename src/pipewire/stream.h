@@ -145,6 +145,16 @@ extern "C" {
  * The process event is emitted when PipeWire has emptied a buffer that
  * can now be refilled.
  *
+ * \subsection ssec_ring Exchange data with a ring
+ *
+ * With \ref pw_stream_set_ring(), the stream dequeues and queues the
+ * buffers itself in the realtime thread and copies the data from or to
+ * a ring. The process event is not emitted. Any thread can then use
+ * \ref pw_stream_ring_write() for playback streams and
+ * \ref pw_stream_ring_read() for capture streams without taking locks
+ * or waking up the realtime thread and without being able to make it
+ * miss its deadline.
+ *
  * \section sec_stream_driving Driving the graph
  *
  * Starting in 0.3.34, it is possible for a stream to drive the graph.
@@ -296,6 +306,20 @@ struct pw_stream_control {
  *  (pw_time.ticks + elapsed) * 1000 * pw_time.rate.num / pw_time.rate.denom
  *\endcode
  *
+ * The clock of the driver usually doesn't run at exactly the nominal rate. Since
+ * 1.3.0, pw_time.rate_diff contains the rate of the driver clock against the
+ * monotonic clock, as estimated by the driver, and gives a more precise
+ * extrapolation:
+ *
+ *\code{.c}
+ *    int64_t elapsed = (int64_t)(pw_time.rate_diff * pw_time.rate.denom * diff /
+ *                      (pw_time.rate.num * SPA_NSEC_PER_SEC));
+ *\endcode
+ *
+ * pw_stream_get_time_n() doesn't block and doesn't make system calls, it can be
+ * called from any thread, also at a high rate. pw_stream_get_nsec() uses the
+ * monotonic clock, which is usually read without a system call.
+ *
  * Below is an overview of the different timing values:
  *
  *\code{.unparsed}
@@ -345,6 +369,10 @@ struct pw_time {
 					  *  samples requested by the resampler for the current
 					  *  quantum. for audio/raw capture streams this will be the number
 					  *  of samples available for the current quantum. Since 1.1.0 */
+	double rate_diff;		/**< the rate of the driver clock against the monotonic
+					  *  clock, 1.0 when the clocks run at the same rate.
+					  *  Can be used to extrapolate \a ticks and \a delay.
+					  *  Since 1.3.0 */
 };
 
 #include <pipewire/port.h>
@@ -552,9 +580,65 @@ struct pw_buffer *pw_stream_dequeue_buffer(struct pw_stream *stream);
 /** Submit a buffer for playback or recycle a buffer for capture. */
 int pw_stream_queue_buffer(struct pw_stream *stream, struct pw_buffer *buffer);
 
+/** Get up to \a n_buffers buffers at once, in the same order as
+ * pw_stream_dequeue_buffer() would return them.
+ * \return the number of buffers, 0 when there are none or < 0 on error */
+int pw_stream_dequeue_buffers(struct pw_stream *stream, struct pw_buffer **buffers,
+		uint32_t n_buffers);
+
+/** Submit or recycle \a n_buffers buffers at once. Either all or none of
+ * the buffers are queued.
+ * \return 0 on success or < 0 on error */
+int pw_stream_queue_buffers(struct pw_stream *stream, struct pw_buffer **buffers,
+		uint32_t n_buffers);
+
+/** Get the explicit sync timeline of a buffer.
+ *
+ * Buffers with a SPA_META_SyncTimeline metadata carry a DRM syncobj with
+ * the acquire timeline and one with the release timeline. The data can
+ * be accessed when the acquire point is signaled. The consumer clears
+ * SPA_META_SYNC_TIMELINE_UNSCHEDULED_RELEASE in the metadata flags when
+ * it will signal the release point, after which the producer must wait
+ * for the release point before reusing the buffer.
+ *
+ * \param acquire_fd the syncobj with the acquire timeline
+ * \param release_fd the syncobj with the release timeline
+ * \return the timeline metadata or NULL with errno set to ENOTSUP when
+ *	the buffer does not use explicit sync. Since 1.3.0 */
+struct spa_meta_sync_timeline *pw_stream_get_sync_timeline(struct pw_stream *stream,
+		struct pw_buffer *buffer, int *acquire_fd, int *release_fd);
+
 /** Activate or deactivate the stream */
 int pw_stream_set_active(struct pw_stream *stream, bool active);
 
+/** Exchange the data through a ring instead of process events.
+ *
+ * The stream takes the data for its buffers from the ring for playback
+ * and places the data of the buffers in the ring for capture. When there
+ * is not enough data for playback, the buffer is padded with silence.
+ * When the ring is full on capture, the data is dropped. The stream
+ * buffers are mapped and pw_stream_dequeue_buffer() can't be used.
+ *
+ * This must be called before pw_stream_connect().
+ *
+ * \param stream a \ref pw_stream
+ * \param size the size of the ring in bytes, a power of 2
+ * \param stride the size of a frame in bytes, only complete frames are
+ *     exchanged
+ * \return 0 on success, < 0 on error
+ */
+int pw_stream_set_ring(struct pw_stream *stream, uint32_t size, uint32_t stride);
+
+/** Write data to the ring of a playback stream, see pw_stream_set_ring().
+ * This can be called from any thread but only from one thread at a time.
+ * \return the number of bytes written or < 0 on error */
+int pw_stream_ring_write(struct pw_stream *stream, const void *data, uint32_t size);
+
+/** Read data from the ring of a capture stream, see pw_stream_set_ring().
+ * This can be called from any thread but only from one thread at a time.
+ * \return the number of bytes read or < 0 on error */
+int pw_stream_ring_read(struct pw_stream *stream, void *data, uint32_t size);
+
 /** Flush a stream. When \a drain is true, the drained callback will
  * be called when all data is played or recorded */
 int pw_stream_flush(struct pw_stream *stream, bool drain);
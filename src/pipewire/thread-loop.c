@@ -509,6 +509,111 @@ void pw_thread_loop_accept(struct pw_thread_loop *loop)
 	pthread_cond_signal(&loop->accept_cond);
 }
 
+struct invoke_block {
+	spa_invoke_func_t func;
+	uint32_t seq;
+	const void *data;
+	size_t size;
+	void *user_data;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int res;
+	bool done;
+};
+
+static int do_invoke_block(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct invoke_block *b = user_data;
+	int res;
+
+	res = b->func(loop, async, b->seq, b->data, b->size, b->user_data);
+
+	pthread_mutex_lock(&b->lock);
+	b->res = res;
+	b->done = true;
+	pthread_cond_signal(&b->cond);
+	pthread_mutex_unlock(&b->lock);
+	return 0;
+}
+
+/** Invoke a function in the thread of the loop
+ *
+ * \param loop a \ref pw_thread_loop
+ * \param func the function to call
+ * \param seq a sequence number passed to \a func
+ * \param data data passed to \a func, copied when \a block is false
+ * \param size the size of \a data
+ * \param block wait for \a func to complete
+ * \param user_data user data passed to \a func
+ * \return the result of \a func when \a block is true or when called
+ *         from the loop thread, an async result or 0 otherwise.
+ *         -EDEADLK when asked to block with the lock held.
+ *
+ * Queue \a func to be called in the thread of \a loop with the lock held.
+ * The call is added to a lock-free per-thread queue of the loop, so this
+ * function does not need the lock and does not wait for the loop thread
+ * to release it. Use this from threads that would otherwise contend on
+ * the lock for short calls into PipeWire objects.
+ *
+ * When called from the loop thread or when the loop is not running,
+ * \a func is called directly with the lock held.
+ *
+ * When \a block is true, this function waits until \a func has been
+ * called. This must not be done with the lock held because the loop thread
+ * needs it to call \a func.
+ *
+ * Since: 1.3.0
+ */
+SPA_EXPORT
+int pw_thread_loop_invoke(struct pw_thread_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, void *user_data)
+{
+	struct invoke_block b;
+	int res;
+
+	if (!loop->running || pw_thread_loop_in_thread(loop)) {
+		do_lock(loop);
+		res = func(loop->loop->loop, false, seq, data, size, user_data);
+		do_unlock(loop);
+		return res;
+	}
+	if (!block)
+		return pw_loop_invoke(loop->loop, func, seq, data, size, false, user_data);
+
+	/* the lock is recursive, when we can take it and it was already
+	 * taken, it is held by this thread */
+	if (pthread_mutex_trylock(&loop->lock) == 0) {
+		bool locked = loop->recurse > 0;
+		pthread_mutex_unlock(&loop->lock);
+		if (locked)
+			return -EDEADLK;
+	}
+
+	b = (struct invoke_block) {
+		.func = func,
+		.seq = seq,
+		.data = data,
+		.size = size,
+		.user_data = user_data,
+	};
+	pthread_mutex_init(&b.lock, NULL);
+	pthread_cond_init(&b.cond, NULL);
+
+	if ((res = pw_loop_invoke(loop->loop, do_invoke_block, seq, NULL, 0, false, &b)) >= 0) {
+		pthread_mutex_lock(&b.lock);
+		while (!b.done)
+			pthread_cond_wait(&b.cond, &b.lock);
+		pthread_mutex_unlock(&b.lock);
+		res = b.res;
+	}
+	pthread_cond_destroy(&b.cond);
+	pthread_mutex_destroy(&b.lock);
+	return res;
+}
+
 /** Check if we are inside the thread of the loop
  *
  * \param loop a \ref pw_thread_loop to signal
@@ -57,6 +57,14 @@ extern "C" {
  * on to the lock more than necessary though, as the threaded loop stops
  * while the lock is held.
  *
+ * \section sec_thread_loop_invoke Invoking
+ *
+ * Short calls into PipeWire objects can also be queued to the loop thread
+ * with pw_thread_loop_invoke(), without taking the lock. The function is
+ * then called in the loop thread with the lock held, optionally waiting
+ * for its result. This avoids contention on the lock when many threads
+ * make small calls.
+ *
  * \section sec_thread_loop_events Events and Callbacks
  *
  * All events and callbacks are called with the thread lock held.
@@ -146,6 +154,11 @@ void pw_thread_loop_accept(struct pw_thread_loop *loop);
 /** Check if inside the thread */
 bool pw_thread_loop_in_thread(struct pw_thread_loop *loop);
 
+/** Call \a func in the thread of the loop without taking the lock. Since 1.3.0 */
+int pw_thread_loop_invoke(struct pw_thread_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, void *user_data);
+
 /**
  * \}
  */
@@ -0,0 +1,421 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <spa/utils/string.h>
+#include <spa/utils/names.h>
+#include <spa/param/audio/raw.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+/* Builds a graph of N sources, each through a chain of M filters, into K sinks
+ * in a local context and runs it freewheeling from a dummy driver. Reports the
+ * number of cycles per second and the distribution of the cycle times. */
+
+#define DEFAULT_STREAMS		8
+#define DEFAULT_FILTERS		2
+#define DEFAULT_SINKS		1
+#define DEFAULT_SECONDS		5
+#define DEFAULT_QUANTUM		256
+
+#define MAX_PORTS		64
+#define MAX_CYCLES		(1u << 22)
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct spa_source *timer;
+
+	uint32_t n_streams;
+	uint32_t n_filters;
+	uint32_t n_sinks;
+	uint32_t seconds;
+	uint32_t quantum;
+
+	struct pw_impl_node *driver;
+	struct spa_hook driver_listener;
+	uint32_t n_nodes;
+	uint32_t n_links;
+
+	/* written by the data thread only */
+	uint64_t start;
+	uint32_t n_cycles;
+	uint32_t n_incomplete;
+	uint32_t *cycles;
+};
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void driver_start(void *data)
+{
+	struct data *d = data;
+	d->start = get_time_ns();
+}
+
+static void driver_complete(void *data)
+{
+	struct data *d = data;
+	if (d->start != 0 && d->n_cycles < MAX_CYCLES)
+		d->cycles[d->n_cycles++] = (uint32_t)SPA_MIN(get_time_ns() - d->start, UINT32_MAX);
+	d->start = 0;
+}
+
+static void driver_incomplete(void *data)
+{
+	struct data *d = data;
+	d->n_incomplete++;
+}
+
+static const struct pw_impl_node_rt_events driver_events = {
+	PW_VERSION_IMPL_NODE_RT_EVENTS,
+	.start = driver_start,
+	.complete = driver_complete,
+	.incomplete = driver_incomplete,
+};
+
+static struct pw_impl_node *create_node(struct data *d, const char *factory_name,
+		struct pw_properties *props)
+{
+	struct pw_impl_factory *factory;
+	struct pw_impl_node *node;
+	char name[256];
+
+	factory = pw_context_find_factory(d->context, factory_name);
+	if (factory == NULL) {
+		fprintf(stderr, "can't find factory %s\n", factory_name);
+		pw_properties_free(props);
+		return NULL;
+	}
+	pw_properties_set(props, PW_KEY_NODE_GROUP, "benchmark");
+	snprintf(name, sizeof(name), "%s", pw_properties_get(props, PW_KEY_NODE_NAME));
+
+	node = pw_impl_factory_create_object(factory, NULL, PW_TYPE_INTERFACE_Node,
+			PW_VERSION_NODE, props, 0);
+	if (node == NULL) {
+		fprintf(stderr, "can't create node %s: %m\n", name);
+		return NULL;
+	}
+	pw_impl_node_set_active(node, true);
+	d->n_nodes++;
+	return node;
+}
+
+static struct pw_impl_node *create_adapter(struct data *d, const char *name,
+		const char *factory_name, uint32_t index, bool monitor)
+{
+	struct pw_properties *props;
+
+	props = pw_properties_new(
+			SPA_KEY_FACTORY_NAME, factory_name,
+			PW_KEY_NODE_DRIVER, "false",
+			PW_KEY_AUDIO_CHANNELS, "2",
+			SPA_KEY_AUDIO_POSITION, "FL,FR",
+			"monitor.passthrough", monitor ? "true" : "false",
+			NULL);
+	pw_properties_setf(props, PW_KEY_NODE_NAME, "%s.%u", name, index);
+	pw_properties_setf(props, "adapter.auto-port-config",
+			"{ mode = dsp monitor = %s position = preserve }",
+			monitor ? "true" : "false");
+
+	return create_node(d, "adapter", props);
+}
+
+struct port_list {
+	struct pw_impl_port *ports[MAX_PORTS];
+	uint32_t n_ports;
+};
+
+static int collect_port(void *data, struct pw_impl_port *port)
+{
+	struct port_list *l = data;
+	if (l->n_ports < MAX_PORTS)
+		l->ports[l->n_ports++] = port;
+	return 0;
+}
+
+/* link the output ports of one node to the input ports of another, in order */
+static int link_nodes(struct data *d, struct pw_impl_node *output, struct pw_impl_node *input)
+{
+	struct port_list out = { .n_ports = 0 }, in = { .n_ports = 0 };
+	uint32_t i, n_links;
+
+	pw_impl_node_for_each_port(output, PW_DIRECTION_OUTPUT, collect_port, &out);
+	pw_impl_node_for_each_port(input, PW_DIRECTION_INPUT, collect_port, &in);
+
+	n_links = SPA_MIN(out.n_ports, in.n_ports);
+	if (n_links == 0) {
+		fprintf(stderr, "no ports to link %s -> %s\n",
+				pw_impl_node_get_info(output)->props ?
+				spa_dict_lookup(pw_impl_node_get_info(output)->props, PW_KEY_NODE_NAME) : "",
+				pw_impl_node_get_info(input)->props ?
+				spa_dict_lookup(pw_impl_node_get_info(input)->props, PW_KEY_NODE_NAME) : "");
+		return -ENOENT;
+	}
+	for (i = 0; i < n_links; i++) {
+		struct pw_impl_link *link;
+
+		link = pw_context_create_link(d->context, out.ports[i], in.ports[i],
+				NULL, pw_properties_new(PW_KEY_OBJECT_LINGER, "true", NULL), 0);
+		if (link == NULL) {
+			fprintf(stderr, "can't create link: %m\n");
+			return -errno;
+		}
+		pw_impl_link_register(link, NULL);
+		d->n_links++;
+	}
+	return 0;
+}
+
+static void settle(struct data *d)
+{
+	struct pw_loop *loop = pw_main_loop_get_loop(d->loop);
+	int i;
+
+	/* dispatch the pending work so that the ports are created
+	 * and the links are negotiated */
+	pw_loop_enter(loop);
+	for (i = 0; i < 100; i++) {
+		if (pw_loop_iterate(loop, 10) <= 0)
+			break;
+	}
+	pw_loop_leave(loop);
+}
+
+static int build_graph(struct data *d)
+{
+	struct pw_impl_node *sinks[d->n_sinks];
+	struct pw_impl_node *prev[d->n_streams];
+	uint32_t i, j;
+	int res;
+
+	d->driver = create_node(d, "spa-node-factory",
+			pw_properties_new(
+				SPA_KEY_FACTORY_NAME, SPA_NAME_SUPPORT_NODE_DRIVER,
+				PW_KEY_NODE_NAME, "benchmark-driver",
+				PW_KEY_PRIORITY_DRIVER, "100000",
+				"node.freewheel", "true",
+				"freewheel.wait", "1",
+				NULL));
+	if (d->driver == NULL)
+		return -errno;
+
+	for (i = 0; i < d->n_sinks; i++) {
+		sinks[i] = create_adapter(d, "sink", "support.null-audio-sink", i, false);
+		if (sinks[i] == NULL)
+			return -errno;
+	}
+	for (i = 0; i < d->n_streams; i++) {
+		prev[i] = create_adapter(d, "source", "audiotestsrc", i, false);
+		if (prev[i] == NULL)
+			return -errno;
+	}
+	settle(d);
+
+	for (i = 0; i < d->n_streams; i++) {
+		for (j = 0; j < d->n_filters; j++) {
+			struct pw_impl_node *filter;
+
+			filter = create_adapter(d, "filter", "support.null-audio-sink",
+					i * d->n_filters + j, true);
+			if (filter == NULL)
+				return -errno;
+			settle(d);
+
+			if ((res = link_nodes(d, prev[i], filter)) < 0)
+				return res;
+			prev[i] = filter;
+		}
+		if ((res = link_nodes(d, prev[i], sinks[i % d->n_sinks])) < 0)
+			return res;
+	}
+	settle(d);
+	return 0;
+}
+
+static void on_timeout(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+	pw_main_loop_quit(d->loop);
+}
+
+static int compare_cycle(const void *a, const void *b)
+{
+	uint32_t ca = *(const uint32_t*)a, cb = *(const uint32_t*)b;
+	return ca < cb ? -1 : ca > cb ? 1 : 0;
+}
+
+static uint32_t percentile(struct data *d, double p)
+{
+	return d->cycles[SPA_MIN((uint32_t)(d->n_cycles * p), d->n_cycles - 1)];
+}
+
+static void report(struct data *d, uint64_t elapsed)
+{
+	uint64_t total = 0;
+	uint32_t i;
+
+	if (d->n_cycles == 0) {
+		fprintf(stderr, "no cycles completed\n");
+		return;
+	}
+	for (i = 0; i < d->n_cycles; i++)
+		total += d->cycles[i];
+
+	qsort(d->cycles, d->n_cycles, sizeof(uint32_t), compare_cycle);
+
+	fprintf(stderr, "graph %ux%ux%u nodes:%u links:%u quantum:%u\n",
+			d->n_streams, d->n_filters, d->n_sinks,
+			d->n_nodes, d->n_links, d->quantum);
+	fprintf(stderr, "cycles:%u incomplete:%u elapsed:%"PRIu64" = %.1f cycles/sec\n",
+			d->n_cycles, d->n_incomplete, elapsed,
+			d->n_cycles * (double)SPA_NSEC_PER_SEC / elapsed);
+	fprintf(stderr, "cycle time (usec) avg:%.2f p50:%.2f p99:%.2f p99.9:%.2f max:%.2f\n",
+			total / 1000.0 / d->n_cycles,
+			percentile(d, 0.5) / 1000.0,
+			percentile(d, 0.99) / 1000.0,
+			percentile(d, 0.999) / 1000.0,
+			d->cycles[d->n_cycles - 1] / 1000.0);
+	fprintf(stderr, "per node (usec) avg:%.3f\n",
+			total / 1000.0 / d->n_cycles / d->n_nodes);
+}
+
+static void show_help(const char *name, bool error)
+{
+	fprintf(error ? stderr : stdout, "%s [options]\n"
+		"  -h, --help                            Show this help\n"
+		"  -s, --streams                         Number of sources (default %d)\n"
+		"  -f, --filters                         Filters per source (default %d)\n"
+		"  -k, --sinks                           Number of sinks (default %d)\n"
+		"  -t, --time                            Seconds to run (default %d)\n"
+		"  -q, --quantum                         Quantum (default %d)\n",
+		name, DEFAULT_STREAMS, DEFAULT_FILTERS, DEFAULT_SINKS,
+		DEFAULT_SECONDS, DEFAULT_QUANTUM);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0, };
+	struct pw_loop *l;
+	struct pw_properties *props;
+	struct timespec timeout;
+	uint64_t t1, t2;
+	int c, res = 0;
+	static const struct option long_options[] = {
+		{ "help",	no_argument,		NULL, 'h' },
+		{ "streams",	required_argument,	NULL, 's' },
+		{ "filters",	required_argument,	NULL, 'f' },
+		{ "sinks",	required_argument,	NULL, 'k' },
+		{ "time",	required_argument,	NULL, 't' },
+		{ "quantum",	required_argument,	NULL, 'q' },
+		{ NULL, 0, NULL, 0}
+	};
+
+	pw_init(&argc, &argv);
+
+	data.n_streams = DEFAULT_STREAMS;
+	data.n_filters = DEFAULT_FILTERS;
+	data.n_sinks = DEFAULT_SINKS;
+	data.seconds = DEFAULT_SECONDS;
+	data.quantum = DEFAULT_QUANTUM;
+
+	while ((c = getopt_long(argc, argv, "hs:f:k:t:q:", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			show_help(argv[0], false);
+			return 0;
+		case 's':
+			data.n_streams = atoi(optarg);
+			break;
+		case 'f':
+			data.n_filters = atoi(optarg);
+			break;
+		case 'k':
+			data.n_sinks = atoi(optarg);
+			break;
+		case 't':
+			data.seconds = atoi(optarg);
+			break;
+		case 'q':
+			data.quantum = atoi(optarg);
+			break;
+		default:
+			show_help(argv[0], true);
+			return -1;
+		}
+	}
+	if (data.n_streams == 0 || data.n_sinks == 0 || data.quantum == 0) {
+		show_help(argv[0], true);
+		return -1;
+	}
+
+	data.cycles = calloc(MAX_CYCLES, sizeof(uint32_t));
+	if (data.cycles == NULL) {
+		res = -errno;
+		goto exit;
+	}
+
+	data.loop = pw_main_loop_new(NULL);
+	if (data.loop == NULL) {
+		res = -errno;
+		goto exit;
+	}
+	l = pw_main_loop_get_loop(data.loop);
+
+	props = pw_properties_new(PW_KEY_CONFIG_NAME, "null", NULL);
+	pw_properties_setf(props, "default.clock.quantum", "%u", data.quantum);
+	pw_properties_setf(props, "default.clock.min-quantum", "%u", data.quantum);
+
+	data.context = pw_context_new(l, props, 0);
+	if (data.context == NULL) {
+		res = -errno;
+		goto exit;
+	}
+
+	if (pw_context_load_module(data.context, "libpipewire-module-spa-node-factory", NULL, NULL) == NULL ||
+	    pw_context_load_module(data.context, "libpipewire-module-adapter", NULL, NULL) == NULL) {
+		fprintf(stderr, "can't load modules: %m\n");
+		res = -errno;
+		goto exit;
+	}
+
+	if ((res = build_graph(&data)) < 0)
+		goto exit;
+
+	pw_impl_node_add_rt_listener(data.driver, &data.driver_listener,
+			&driver_events, &data);
+
+	data.timer = pw_loop_add_timer(l, on_timeout, &data);
+	timeout.tv_sec = data.seconds;
+	timeout.tv_nsec = 0;
+	pw_loop_update_timer(l, data.timer, &timeout, NULL, false);
+
+	t1 = get_time_ns();
+	pw_main_loop_run(data.loop);
+	t2 = get_time_ns();
+
+	/* this syncs with the data thread */
+	pw_impl_node_remove_rt_listener(data.driver, &data.driver_listener);
+
+	report(&data, t2 - t1);
+
+exit:
+	if (data.context)
+		pw_context_destroy(data.context);
+	if (data.loop)
+		pw_main_loop_destroy(data.loop);
+	free(data.cycles);
+	pw_deinit();
+
+	return res < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
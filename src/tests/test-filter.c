@@ -3,6 +3,7 @@
 /* SPDX-License-Identifier: MIT */
 
 #include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
 #include <pipewire/main-loop.h>
 #include <pipewire/filter.h>
 
@@ -28,6 +29,8 @@ static void test_abi(void)
 		void (*process) (void *data, struct spa_io_position *position);
 		void (*drained) (void *data);
 		void (*command) (void *data, const struct spa_command *command);
+		void (*process_buffers) (void *data, struct spa_io_position *position,
+			uint32_t n_in, void **in, uint32_t n_out, void **out);
 	} test = { PW_VERSION_FILTER_EVENTS, NULL };
 
 	struct pw_filter_events ev;
@@ -41,8 +44,9 @@ static void test_abi(void)
 	TEST_FUNC(ev, test, process);
 	TEST_FUNC(ev, test, drained);
 	TEST_FUNC(ev, test, command);
+	TEST_FUNC(ev, test, process_buffers);
 
-	spa_assert_se(PW_VERSION_FILTER_EVENTS == 1);
+	spa_assert_se(PW_VERSION_FILTER_EVENTS == 2);
 	spa_assert_se(sizeof(ev) == sizeof(test));
 
 	spa_assert_se(PW_FILTER_STATE_ERROR == -1);
@@ -326,6 +330,13 @@ static void test_create_port(void)
 	spa_assert_se(port_count == 1);
 	printf("port added\n");
 
+	/* no buffers negotiated yet */
+	{
+		struct pw_buffer *bufs[4];
+		spa_assert_se(pw_filter_dequeue_buffers(port, bufs, 4) == 0);
+		spa_assert_se(pw_filter_queue_buffers(port, bufs, 0) == 0);
+	}
+
 	printf("remove port\n");
 	pw_filter_remove_port(port);
 	roundtrip(core, loop);
@@ -340,6 +351,125 @@ static void test_create_port(void)
 	pw_main_loop_destroy(loop);
 }
 
+#define MAX_TEST_BUFFERS	16
+
+struct queue_port {
+	struct pw_buffer *buffers[MAX_TEST_BUFFERS];
+	uint32_t n_buffers;
+};
+
+static void queue_add_buffer(void *data, void *port_data, struct pw_buffer *buffer)
+{
+	struct queue_port *p = port_data;
+	spa_assert_se(p->n_buffers < MAX_TEST_BUFFERS);
+	p->buffers[p->n_buffers++] = buffer;
+}
+
+static const struct pw_filter_events queue_filter_events =
+{
+	PW_VERSION_FILTER_EVENTS,
+	.add_buffer = queue_add_buffer,
+};
+
+static struct queue_port *connect_dsp_filter(struct pw_core *core, const char *name,
+		enum pw_direction direction, struct spa_hook *listener,
+		struct pw_filter **filter)
+{
+	struct queue_port *port;
+
+	*filter = pw_filter_new(core, name,
+			pw_properties_new(
+				PW_KEY_MEDIA_TYPE, "Audio",
+				PW_KEY_NODE_AUTOCONNECT, "false",
+				NULL));
+	spa_assert_se(*filter != NULL);
+	pw_filter_add_listener(*filter, listener, &queue_filter_events, NULL);
+
+	port = pw_filter_add_port(*filter, direction,
+			PW_FILTER_PORT_FLAG_MAP_BUFFERS,
+			sizeof(struct queue_port),
+			pw_properties_new(
+				PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+				PW_KEY_PORT_NAME, name,
+				NULL),
+			NULL, 0);
+	spa_assert_se(port != NULL);
+	spa_assert_se(pw_filter_connect(*filter, 0, NULL, 0) == 0);
+	return port;
+}
+
+static void test_queue_buffers(void)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct pw_filter *output, *input;
+	struct spa_hook output_listener = { 0, }, input_listener = { 0, };
+	struct queue_port *out, *in;
+	struct pw_properties *props;
+	struct pw_proxy *link;
+	struct pw_buffer *bufs[MAX_TEST_BUFFERS], *b[2];
+	uint32_t i, n_buffers;
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+	spa_assert_se(context != NULL);
+	spa_assert_se(pw_context_load_module(context,
+				"libpipewire-module-link-factory", NULL, NULL) != NULL);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert_se(core != NULL);
+
+	out = connect_dsp_filter(core, "output", PW_DIRECTION_OUTPUT,
+			&output_listener, &output);
+	in = connect_dsp_filter(core, "input", PW_DIRECTION_INPUT,
+			&input_listener, &input);
+
+	for (i = 0; i < 100 && (pw_filter_get_node_id(output) == SPA_ID_INVALID ||
+			pw_filter_get_node_id(input) == SPA_ID_INVALID); i++)
+		pw_loop_iterate(pw_main_loop_get_loop(loop), 100);
+
+	/* link the filters, there is no driver so the buffers are negotiated
+	 * but the graph does not run and nothing moves between the queues */
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, PW_KEY_LINK_OUTPUT_NODE, "%u", pw_filter_get_node_id(output));
+	pw_properties_setf(props, PW_KEY_LINK_INPUT_NODE, "%u", pw_filter_get_node_id(input));
+	link = pw_core_create_object(core, "link-factory",
+			PW_TYPE_INTERFACE_Link, PW_VERSION_LINK, &props->dict, 0);
+	pw_properties_free(props);
+	spa_assert_se(link != NULL);
+
+	for (i = 0; i < 100 && (out->n_buffers == 0 || in->n_buffers == 0); i++)
+		pw_loop_iterate(pw_main_loop_get_loop(loop), 100);
+	n_buffers = out->n_buffers;
+	spa_assert_se(n_buffers >= 2);
+
+	/* all buffers, in order, with one call */
+	spa_assert_se(pw_filter_dequeue_buffers(out, bufs, 1) == 1);
+	spa_assert_se(pw_filter_dequeue_buffers(out, &bufs[1], MAX_TEST_BUFFERS) ==
+			(int)n_buffers - 1);
+	for (i = 0; i < n_buffers; i++)
+		spa_assert_se(bufs[i] == out->buffers[i]);
+	spa_assert_se(pw_filter_dequeue_buffers(out, bufs, MAX_TEST_BUFFERS) == 0);
+
+	/* all or none of the buffers are queued */
+	b[0] = b[1] = out->buffers[1];
+	spa_assert_se(pw_filter_queue_buffers(out, b, 2) == -EINVAL);
+	spa_assert_se(pw_filter_queue_buffers(out, &out->buffers[0], 1) == 0);
+	b[1] = out->buffers[0];
+	spa_assert_se(pw_filter_queue_buffers(out, b, 2) == -EINVAL);
+	spa_assert_se(pw_filter_queue_buffers(out, &out->buffers[1], n_buffers - 1) == 0);
+	spa_assert_se(pw_filter_queue_buffers(out, &out->buffers[1], 1) == -EINVAL);
+
+	/* nothing was received */
+	spa_assert_se(pw_filter_dequeue_buffers(in, bufs, MAX_TEST_BUFFERS) == 0);
+
+	pw_proxy_destroy(link);
+	pw_filter_destroy(input);
+	pw_filter_destroy(output);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+}
+
 int main(int argc, char *argv[])
 {
 	pw_init(&argc, &argv);
@@ -348,6 +478,7 @@ int main(int argc, char *argv[])
 	test_create();
 	test_properties();
 	test_create_port();
+	test_queue_buffers();
 
 	pw_deinit();
 
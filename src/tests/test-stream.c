@@ -2,11 +2,18 @@
 /* SPDX-FileCopyrightText: Copyright © 2019 Wim Taymans */
 /* SPDX-License-Identifier: MIT */
 
+#include <errno.h>
+#include <string.h>
+
 #include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
 #include <pipewire/main-loop.h>
 #include <pipewire/stream.h>
 
 #include <spa/utils/string.h>
+#include <spa/buffer/meta.h>
+#include <spa/param/buffers.h>
+#include <spa/param/video/format-utils.h>
 
 #define TEST_FUNC(a,b,func)	\
 do {				\
@@ -48,7 +55,7 @@ static void test_abi(void)
 
 #if defined(__x86_64__) && defined(__LP64__)
 	spa_assert_se(sizeof(struct pw_buffer) == 40);
-	spa_assert_se(sizeof(struct pw_time) == 64);
+	spa_assert_se(sizeof(struct pw_time) == 72);
 #else
 	fprintf(stderr, "%zd\n", sizeof(struct pw_buffer));
 	fprintf(stderr, "%zd\n", sizeof(struct pw_time));
@@ -132,6 +139,7 @@ static void test_create(void)
 	struct spa_hook listener = { 0, };
 	const char *error = NULL;
 	struct pw_time tm;
+	struct pw_buffer *bufs[4];
 
 	loop = pw_main_loop_new(NULL);
 	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 12);
@@ -161,6 +169,8 @@ static void test_create(void)
 	spa_assert_se(tm.buffered == 0);
 
 	spa_assert_se(pw_stream_dequeue_buffer(stream) == NULL);
+	spa_assert_se(pw_stream_dequeue_buffers(stream, bufs, 4) == 0);
+	spa_assert_se(pw_stream_queue_buffers(stream, bufs, 0) == 0);
 
 	/* check destroy */
 	destroy_count = 0;
@@ -223,6 +233,197 @@ static void test_properties(void)
 	pw_main_loop_destroy(loop);
 }
 
+static void test_ring(void)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct pw_stream *stream;
+	uint8_t in[4096], out[4096];
+	uint32_t i;
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 12);
+	spa_assert_se(context != NULL);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert_se(core != NULL);
+	stream = pw_stream_new(core, "test", NULL);
+	spa_assert_se(stream != NULL);
+
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = i;
+
+	/* no ring */
+	spa_assert_se(pw_stream_ring_write(stream, in, 16) == -EINVAL);
+	spa_assert_se(pw_stream_ring_read(stream, out, 16) == -EINVAL);
+	/* not a power of 2 */
+	spa_assert_se(pw_stream_set_ring(stream, 1000, 4) == -EINVAL);
+	spa_assert_se(pw_stream_set_ring(stream, 1024, 0) == -EINVAL);
+	spa_assert_se(pw_stream_set_ring(stream, 1024, 12) == 0);
+
+	/* only complete frames */
+	spa_assert_se(pw_stream_ring_write(stream, in, 30) == 24);
+	spa_assert_se(pw_stream_ring_read(stream, out, 20) == 12);
+	spa_assert_se(memcmp(in, out, 12) == 0);
+
+	/* fill up and wrap around */
+	spa_assert_se(pw_stream_ring_write(stream, in + 24, sizeof(in)) == 1008);
+	spa_assert_se(pw_stream_ring_write(stream, in, sizeof(in)) == 0);
+	spa_assert_se(pw_stream_ring_read(stream, out, sizeof(out)) == 1020);
+	spa_assert_se(memcmp(in + 12, out, 1020) == 0);
+	spa_assert_se(pw_stream_ring_read(stream, out, sizeof(out)) == 0);
+
+	/* the buffers are handled by the stream */
+	spa_assert_se(pw_stream_dequeue_buffer(stream) == NULL);
+	spa_assert_se(errno == EBUSY);
+
+	pw_stream_destroy(stream);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+}
+
+#define MAX_TEST_BUFFERS	16
+
+struct queue_data {
+	struct pw_buffer *buffers[MAX_TEST_BUFFERS];
+	uint32_t n_buffers;
+};
+
+static void queue_add_buffer(void *data, struct pw_buffer *buffer)
+{
+	struct queue_data *d = data;
+	spa_assert_se(d->n_buffers < MAX_TEST_BUFFERS);
+	d->buffers[d->n_buffers++] = buffer;
+}
+
+static const struct pw_stream_events queue_stream_events =
+{
+	PW_VERSION_STREAM_EVENTS,
+	.add_buffer = queue_add_buffer,
+};
+
+static struct pw_stream *connect_video_stream(struct pw_core *core, const char *name,
+		enum pw_direction direction, struct spa_hook *listener, struct queue_data *data)
+{
+	struct pw_stream *stream;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod *params[3];
+	uint32_t n_params = 0;
+
+	stream = pw_stream_new(core, name,
+			pw_properties_new(
+				PW_KEY_MEDIA_TYPE, "Video",
+				PW_KEY_NODE_AUTOCONNECT, "false",
+				NULL));
+	spa_assert_se(stream != NULL);
+	pw_stream_add_listener(stream, listener, &queue_stream_events, data);
+
+	params[n_params++] = spa_format_video_raw_build(&b, SPA_PARAM_EnumFormat,
+			&SPA_VIDEO_INFO_RAW_INIT(
+				.format = SPA_VIDEO_FORMAT_RGBA,
+				.size = SPA_RECTANGLE(16, 16),
+				.framerate = SPA_FRACTION(25, 1)));
+	if (direction == PW_DIRECTION_OUTPUT) {
+		params[n_params++] = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+				SPA_PARAM_BUFFERS_buffers, SPA_POD_Int(4),
+				SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+				SPA_PARAM_BUFFERS_size,    SPA_POD_Int(16 * 16 * 4),
+				SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(16 * 4));
+		params[n_params++] = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Busy),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_busy)));
+	}
+	spa_assert_se(pw_stream_connect(stream, direction, PW_ID_ANY,
+				PW_STREAM_FLAG_MAP_BUFFERS, params, n_params) == 0);
+	return stream;
+}
+
+static void test_queue_buffers(void)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct pw_stream *output, *input;
+	struct spa_hook output_listener = { 0, }, input_listener = { 0, };
+	struct queue_data out = { 0, }, in = { 0, };
+	struct pw_properties *props;
+	struct pw_proxy *link;
+	struct pw_buffer *bufs[MAX_TEST_BUFFERS], *b[2];
+	struct spa_meta_busy *busy;
+	uint32_t i;
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+	spa_assert_se(context != NULL);
+	spa_assert_se(pw_context_load_module(context,
+				"libpipewire-module-link-factory", NULL, NULL) != NULL);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert_se(core != NULL);
+
+	output = connect_video_stream(core, "output", PW_DIRECTION_OUTPUT,
+			&output_listener, &out);
+	input = connect_video_stream(core, "input", PW_DIRECTION_INPUT,
+			&input_listener, &in);
+
+	for (i = 0; i < 100 && (pw_stream_get_node_id(output) == SPA_ID_INVALID ||
+			pw_stream_get_node_id(input) == SPA_ID_INVALID); i++)
+		pw_loop_iterate(pw_main_loop_get_loop(loop), 100);
+
+	/* link the streams, there is no driver so the buffers are negotiated
+	 * but the graph does not run and nothing moves between the queues */
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, PW_KEY_LINK_OUTPUT_NODE, "%u", pw_stream_get_node_id(output));
+	pw_properties_setf(props, PW_KEY_LINK_INPUT_NODE, "%u", pw_stream_get_node_id(input));
+	link = pw_core_create_object(core, "link-factory",
+			PW_TYPE_INTERFACE_Link, PW_VERSION_LINK, &props->dict, 0);
+	pw_properties_free(props);
+	spa_assert_se(link != NULL);
+
+	for (i = 0; i < 100 && (out.n_buffers == 0 || in.n_buffers == 0); i++)
+		pw_loop_iterate(pw_main_loop_get_loop(loop), 100);
+	spa_assert_se(out.n_buffers == 4);
+	spa_assert_se(in.n_buffers == 4);
+
+	/* dequeue stops at the buffer that the peer still uses */
+	busy = spa_buffer_find_meta_data(out.buffers[1]->buffer,
+			SPA_META_Busy, sizeof(*busy));
+	spa_assert_se(busy != NULL);
+	busy->count = 1;
+	spa_assert_se(pw_stream_dequeue_buffers(output, bufs, MAX_TEST_BUFFERS) == 1);
+	spa_assert_se(bufs[0] == out.buffers[0]);
+	spa_assert_se(pw_stream_dequeue_buffers(output, bufs, MAX_TEST_BUFFERS) == 0);
+
+	busy->count = 0;
+	spa_assert_se(pw_stream_dequeue_buffers(output, &bufs[1], MAX_TEST_BUFFERS) == 3);
+	for (i = 0; i < 4; i++)
+		spa_assert_se(bufs[i] == out.buffers[i]);
+	spa_assert_se(pw_stream_dequeue_buffers(output, bufs, MAX_TEST_BUFFERS) == 0);
+	spa_assert_se(busy->count == 1);
+
+	/* all or none of the buffers are queued */
+	b[0] = b[1] = out.buffers[1];
+	spa_assert_se(pw_stream_queue_buffers(output, b, 2) == -EINVAL);
+	spa_assert_se(pw_stream_queue_buffers(output, &out.buffers[0], 1) == 0);
+	b[1] = out.buffers[0];
+	spa_assert_se(pw_stream_queue_buffers(output, b, 2) == -EINVAL);
+	spa_assert_se(busy->count == 1);
+	spa_assert_se(pw_stream_queue_buffers(output, &out.buffers[1], 3) == 0);
+	spa_assert_se(busy->count == 0);
+	spa_assert_se(pw_stream_queue_buffers(output, &out.buffers[3], 1) == -EINVAL);
+
+	/* nothing was received */
+	spa_assert_se(pw_stream_dequeue_buffers(input, bufs, MAX_TEST_BUFFERS) == 0);
+
+	pw_proxy_destroy(link);
+	pw_stream_destroy(input);
+	pw_stream_destroy(output);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+}
+
 int main(int argc, char *argv[])
 {
 	pw_init(&argc, &argv);
@@ -230,6 +431,8 @@ int main(int argc, char *argv[])
 	test_abi();
 	test_create();
 	test_properties();
+	test_ring();
+	test_queue_buffers();
 
 	pw_deinit();
 
@@ -14,6 +14,8 @@
 #include <assert.h>
 #include <ctype.h>
 #include <locale.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include <sndfile.h>
 
@@ -25,6 +27,7 @@
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
+#include <spa/utils/atomic.h>
 #include <spa/debug/types.h>
 #include <spa/debug/file.h>
 
@@ -58,6 +61,8 @@
 #define DEFAULT_VOLUME		1.0
 #define DEFAULT_QUALITY		4
 
+#define READAHEAD_CHUNK		(256 * 1024)
+
 enum mode {
 	mode_none,
 	mode_playback,
@@ -135,6 +140,24 @@ struct data {
 	bool drained;
 	uint64_t clock_time;
 
+	/* a thread reads the file in large chunks ahead of the stream, the
+	 * process callback only copies from the buffer */
+	struct {
+		unsigned int msec;
+		fill_fn fill;
+		pthread_t thread;
+		sem_t sem;
+		uint8_t *data;
+		uint32_t size;
+		uint32_t chunk;
+		uint64_t read_pos;
+		uint64_t write_pos;
+		uint8_t silence;
+		int running;
+		int eof;
+		uint32_t underruns;
+	} readahead;
+
 	struct {
 		struct midi_file *file;
 		struct midi_file_info info;
@@ -707,6 +730,158 @@ static const struct pw_core_events core_events = {
 	.error = on_core_error,
 };
 
+/* fill the buffer with the next chunk, returns 0 when the buffer is full */
+static int readahead_read(struct data *d)
+{
+	uint64_t filled;
+	uint32_t offs, n_frames;
+	bool null_frame = false;
+	int res;
+
+	filled = d->readahead.write_pos - SPA_ATOMIC_LOAD(d->readahead.read_pos);
+	if (d->readahead.size - filled < d->readahead.chunk)
+		return 0;
+
+	offs = d->readahead.write_pos % d->readahead.size;
+	n_frames = SPA_MIN(d->readahead.chunk, d->readahead.size - offs) / d->stride;
+
+	res = d->readahead.fill(d, d->readahead.data + offs, n_frames, &null_frame);
+	if (res <= 0) {
+		SPA_ATOMIC_STORE(d->readahead.eof, 1);
+		return res < 0 ? res : -ENODATA;
+	}
+	SPA_ATOMIC_STORE(d->readahead.write_pos, d->readahead.write_pos + res * d->stride);
+	return res;
+}
+
+static void *readahead_thread(void *userdata)
+{
+	struct data *d = userdata;
+	int res;
+
+	while (SPA_ATOMIC_LOAD(d->readahead.running)) {
+		if ((res = readahead_read(d)) < 0) {
+			if (res != -ENODATA)
+				fprintf(stderr, "read-ahead error: %s\n", spa_strerror(res));
+			break;
+		}
+		if (res == 0)
+			sem_wait(&d->readahead.sem);
+	}
+	return NULL;
+}
+
+/* called from the process callback instead of the real fill function */
+static int readahead_fill(struct data *d, void *dest, unsigned int n_frames, bool *null_frame)
+{
+	uint64_t avail;
+	uint32_t n_bytes, offs, l0;
+
+	avail = SPA_ATOMIC_LOAD(d->readahead.write_pos) - d->readahead.read_pos;
+	n_bytes = SPA_MIN(n_frames * d->stride, avail);
+
+	if (n_bytes == 0) {
+		if (SPA_ATOMIC_LOAD(d->readahead.eof))
+			return 0;
+		/* the thread could not keep up, play silence instead of
+		 * blocking the graph */
+		d->readahead.underruns++;
+		memset(dest, d->readahead.silence, n_frames * d->stride);
+		return n_frames;
+	}
+	offs = d->readahead.read_pos % d->readahead.size;
+	l0 = SPA_MIN(n_bytes, d->readahead.size - offs);
+	memcpy(dest, d->readahead.data + offs, l0);
+	memcpy(SPA_PTROFF(dest, l0, void), d->readahead.data, n_bytes - l0);
+
+	SPA_ATOMIC_STORE(d->readahead.read_pos, d->readahead.read_pos + n_bytes);
+	sem_post(&d->readahead.sem);
+
+	return n_bytes / d->stride;
+}
+
+static int readahead_start(struct data *d)
+{
+	uint64_t bytes_per_sec;
+	uint32_t n_chunks;
+	int res;
+
+	if (d->readahead.running || d->stride == 0)
+		return 0;
+
+	switch (d->data_type) {
+	case TYPE_PCM:
+		bytes_per_sec = (uint64_t)d->rate * d->stride;
+		d->readahead.silence = d->spa_format == SPA_AUDIO_FORMAT_U8 ? 0x80 :
+			d->spa_format == SPA_AUDIO_FORMAT_ULAW ? 0xff :
+			d->spa_format == SPA_AUDIO_FORMAT_ALAW ? 0xd5 : 0;
+		break;
+	case TYPE_DSD:
+		bytes_per_sec = d->dsf.file ?
+			(uint64_t)d->dsf.info.rate / 8 * d->dsf.info.channels :
+			(uint64_t)d->dff.info.rate / 8 * d->dff.info.channels;
+		d->readahead.silence = 0x69;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	/* the chunks and the buffer are a whole number of frames */
+	d->readahead.chunk = SPA_MAX(READAHEAD_CHUNK / d->stride, 1u) * d->stride;
+	n_chunks = SPA_MAX(bytes_per_sec * d->readahead.msec / 1000 / d->readahead.chunk, 2u);
+	d->readahead.size = n_chunks * d->readahead.chunk;
+	d->readahead.read_pos = d->readahead.write_pos = 0;
+
+	if ((d->readahead.data = malloc(d->readahead.size)) == NULL)
+		return -errno;
+	if (sem_init(&d->readahead.sem, 0, 0) < 0) {
+		res = -errno;
+		goto error_free;
+	}
+
+	/* prefill so that the stream starts with data */
+	d->readahead.fill = d->fill;
+	while ((res = readahead_read(d)) > 0);
+	if (res < 0 && res != -ENODATA)
+		goto error_sem;
+
+	d->readahead.running = 1;
+	if ((res = -pthread_create(&d->readahead.thread, NULL, readahead_thread, d)) < 0) {
+		d->readahead.running = 0;
+		goto error_sem;
+	}
+	d->fill = readahead_fill;
+
+	if (d->verbose)
+		printf("read-ahead: %u bytes in chunks of %u bytes\n",
+				d->readahead.size, d->readahead.chunk);
+	return 0;
+
+error_sem:
+	sem_destroy(&d->readahead.sem);
+error_free:
+	free(d->readahead.data);
+	d->readahead.data = NULL;
+	return res;
+}
+
+static void readahead_stop(struct data *d)
+{
+	if (!d->readahead.running)
+		return;
+
+	SPA_ATOMIC_STORE(d->readahead.running, 0);
+	sem_post(&d->readahead.sem);
+	pthread_join(d->readahead.thread, NULL);
+	sem_destroy(&d->readahead.sem);
+	free(d->readahead.data);
+	d->readahead.data = NULL;
+	d->fill = d->readahead.fill;
+
+	if (d->verbose && d->readahead.underruns > 0)
+		printf("read-ahead: %u underruns\n", d->readahead.underruns);
+}
+
 static void
 on_state_changed(void *userdata, enum pw_stream_state old,
 		 enum pw_stream_state state, const char *error)
@@ -790,6 +965,11 @@ on_param_changed(void *userdata, uint32_t id, const struct spa_pod *param)
 	if (id != SPA_PARAM_Format || param == NULL)
 		return;
 
+	if (data->readahead.msec > 0 && data->mode == mode_playback &&
+	    data->data_type == TYPE_PCM &&
+	    (err = readahead_start(data)) < 0)
+		fprintf(stderr, "can't start read-ahead: %s\n", spa_strerror(err));
+
 	if ((err = spa_format_parse(param, &info.media_type, &info.media_subtype)) < 0)
 		return;
 
@@ -817,6 +997,9 @@ on_param_changed(void *userdata, uint32_t id, const struct spa_pod *param)
 				data->dsf.layout.interleave,
 				data->stride);
 	}
+
+	if (data->readahead.msec > 0 && (err = readahead_start(data)) < 0)
+		fprintf(stderr, "can't start read-ahead: %s\n", spa_strerror(err));
 }
 
 static void on_process(void *userdata)
@@ -951,6 +1134,7 @@ enum {
 	OPT_CHANNELMAP,
 	OPT_FORMAT,
 	OPT_VOLUME,
+	OPT_READ_AHEAD,
 };
 
 static const struct option long_options[] = {
@@ -977,6 +1161,7 @@ static const struct option long_options[] = {
 	{ "format",		required_argument, NULL, OPT_FORMAT },
 	{ "volume",		required_argument, NULL, OPT_VOLUME },
 	{ "quality",		required_argument, NULL, 'q' },
+	{ "read-ahead",		required_argument, NULL, OPT_READ_AHEAD },
 
 	{ NULL, 0, NULL, 0 }
 };
@@ -1021,6 +1206,8 @@ static void show_usage(const char *name, bool is_error)
 	     "      --format                          Sample format %s (req. for rec) (default %s)\n"
 	     "      --volume                          Stream volume 0-1.0 (default %.3f)\n"
 	     "  -q  --quality                         Resampler quality (0 - 15) (default %d)\n"
+	     "      --read-ahead                      Read MSEC ahead of playback in a thread\n"
+	     "                                          (default 0, disabled)\n"
 	     "\n"),
 	     DEFAULT_RATE,
 	     DEFAULT_CHANNELS,
@@ -1780,6 +1967,9 @@ int main(int argc, char *argv[])
 		case OPT_VOLUME:
 			data.volume = (float)atof(optarg);
 			break;
+		case OPT_READ_AHEAD:
+			data.readahead.msec = atoi(optarg);
+			break;
 		default:
 			goto error_usage;
 		}
@@ -2052,6 +2242,7 @@ error_connect_fail:
 		spa_hook_remove(&data.stream_listener);
 		pw_stream_destroy(data.stream);
 	}
+	readahead_stop(&data);
 error_no_stream:
 error_bad_file:
 	spa_hook_remove(&data.core_listener);
@@ -46,6 +46,10 @@ struct data {
 	struct pw_core *core;
 	struct spa_hook core_listener;
 	int sync_seq;
+	uint32_t sync_serial;		/* serial of the last started sync */
+	uint32_t sync_done;		/* serial of the last completed sync */
+	unsigned int sync_pending:1;
+	unsigned int sync_needed:1;
 
 	struct pw_registry *registry;
 	struct spa_hook registry_listener;
@@ -64,6 +68,8 @@ struct data {
 	uint32_t state;
 
 	unsigned int monitor:1;
+	unsigned int stream:1;
+	unsigned int patch:1;
 };
 
 struct param {
@@ -101,6 +107,8 @@ struct object {
 	uint32_t n_params;
 
 	int changed;
+	uint32_t sync;			/* serial of the sync that completes the object */
+	char *json;			/* last written object, for patches */
 	struct spa_list param_list;
 	struct spa_list pending_list;
 	struct spa_list data_list;
@@ -110,10 +118,19 @@ struct object {
 	struct spa_hook object_listener;
 };
 
-static void core_sync(struct data *d)
+static uint32_t core_sync(struct data *d)
 {
+	/* one sync covers all the requests made before it, when one is
+	 * in flight, only start a new one when it completes */
+	if (d->sync_pending) {
+		d->sync_needed = true;
+		return d->sync_serial + 1;
+	}
 	d->sync_seq = pw_core_sync(d->core, PW_ID_CORE, d->sync_seq);
+	d->sync_pending = true;
+	d->sync_needed = false;
 	pw_log_debug("sync start %u", d->sync_seq);
+	return ++d->sync_serial;
 }
 
 static uint32_t clear_params(struct spa_list *param_list, uint32_t id)
@@ -208,6 +225,7 @@ static void object_destroy(struct object *o)
 	pw_properties_free(o->props);
 	clear_params(&o->param_list, SPA_ID_INVALID);
 	clear_params(&o->pending_list, SPA_ID_INVALID);
+	free(o->json);
 	free(o->type);
 	free(o);
 }
@@ -535,6 +553,18 @@ static void put_flags(struct data *d, const char *key,
 	put_end(d, "]", STATE_SIMPLE);
 }
 
+/* one operation of a JSON patch (RFC 6902) */
+static void put_patch(struct data *d, const char *op, const char *path,
+		const char *value, int len)
+{
+	put_begin(d, NULL, "{", 0);
+	put_string(d, "op", op);
+	put_string(d, "path", path);
+	if (value != NULL)
+		put_fmt(d, "value", "%.*s", len, value);
+	put_end(d, "}", 0);
+}
+
 /* core */
 static void core_dump(struct object *o)
 {
@@ -597,7 +627,7 @@ static void client_event_info(void *data, const struct pw_client_info *info)
 
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -659,7 +689,7 @@ static void module_event_info(void *data, const struct pw_module_info *info)
 
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -721,7 +751,7 @@ static void factory_event_info(void *data, const struct pw_factory_info *info)
 
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -805,7 +835,7 @@ static void device_event_info(void *data, const struct pw_device_info *info)
 	}
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -910,7 +940,7 @@ static void node_event_info(void *data, const struct pw_node_info *info)
 	}
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -1004,7 +1034,7 @@ static void port_event_info(void *data, const struct pw_port_info *info)
 	}
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -1087,7 +1117,7 @@ static void link_event_info(void *data, const struct pw_link_info *info)
 
 	if (changed) {
 		o->changed += changed;
-		core_sync(o->data);
+		o->sync = core_sync(o->data);
 	}
 }
 
@@ -1231,7 +1261,7 @@ static int metadata_property(void *data,
 		e->changed++;
 	}
 	o->changed++;
-	core_sync(o->data);
+	o->sync = core_sync(o->data);
 	return 0;
 }
 
@@ -1353,7 +1383,7 @@ static void registry_event_global(void *data, uint32_t id,
 		o->changed++;
 	}
 
-	core_sync(d);
+	o->sync = core_sync(d);
 	return;
 
 bind_failed:
@@ -1396,7 +1426,24 @@ static void registry_event_global_remove(void *data, uint32_t id)
 	if ((o = find_object(d, id)) == NULL)
 		return;
 
-	if (!d->pattern || object_matches(o, d->pattern)) {
+	if (d->patch) {
+		if (o->json != NULL) {
+			char path[16];
+			snprintf(path, sizeof(path), "/%u", o->id);
+			d->state = STATE_FIRST;
+			put_begin(d, NULL, "[", STATE_SIMPLE);
+			put_patch(d, "remove", path, NULL, 0);
+			put_end(d, "]\n", STATE_SIMPLE);
+		}
+	} else if (d->stream) {
+		if (!d->pattern || object_matches(o, d->pattern)) {
+			d->state = STATE_FIRST;
+			put_begin(d, NULL, "{", STATE_SIMPLE);
+			put_int(d, "id", o->id);
+			put_value(d, o->class && o->class->dump ? "info" : "props", NULL);
+			put_end(d, "}\n", STATE_SIMPLE);
+		}
+	} else if (!d->pattern || object_matches(o, d->pattern)) {
 		d->state = STATE_FIRST;
 		if (d->state == STATE_FIRST)
 			put_begin(d, NULL, "[", 0);
@@ -1420,7 +1467,7 @@ static const struct pw_registry_events registry_events = {
 	.global_remove = registry_event_global_remove,
 };
 
-static void dump_objects(struct data *d)
+static void put_object(struct data *d, struct object *o, uint32_t flags)
 {
 	static const struct flags_info fl[] = {
 		{ "r", PW_PERM_R },
@@ -1431,30 +1478,196 @@ static void dump_objects(struct data *d)
 		{ NULL, },
 	};
 
-	struct object *o;
+	put_begin(d, NULL, "{", flags);
+	put_int(d, "id", o->id);
+	put_value(d, "type", o->type);
+	put_int(d, "version", o->version);
+	put_flags(d, "permissions", o->permissions, fl);
+	if (o->class && o->class->dump)
+		o->class->dump(o);
+	else if (o->props)
+		put_dict(d, "props", &o->props->dict);
+	put_end(d, "}", flags);
+}
+
+/* write the object as compact JSON without colors into a string */
+static char *render_object(struct data *d, struct object *o)
+{
+	FILE *out = d->out;
+	uint32_t state = d->state;
+	int level = d->level;
+	bool c = colors;
+	char *str = NULL;
+	size_t size;
+
+	if ((d->out = open_memstream(&str, &size)) == NULL) {
+		d->out = out;
+		return NULL;
+	}
+	colors = false;
+	d->state = STATE_FIRST;
+	d->level = 0;
+	put_object(d, o, STATE_SIMPLE);
+	fclose(d->out);
+
+	colors = c;
+	d->out = out;
+	d->state = state;
+	d->level = level;
+	return str;
+}
+
+static int json_value(struct spa_json *it, const char **value)
+{
+	int len;
+	if ((len = spa_json_next(it, value)) <= 0)
+		return len;
+	if (spa_json_is_container(*value, len))
+		len = spa_json_container_len(it, *value, len);
+	return len;
+}
+
+static bool json_find(const char *obj, int olen, const char *key, const char **value, int *len)
+{
+	struct spa_json it[2];
+	char k[256];
+
+	spa_json_init(&it[0], obj, olen);
+	if (spa_json_enter_object(&it[0], &it[1]) <= 0)
+		return false;
+	while (spa_json_get_string(&it[1], k, sizeof(k)) > 0) {
+		if ((*len = json_value(&it[1], value)) <= 0)
+			break;
+		if (spa_streq(k, key))
+			return true;
+	}
+	return false;
+}
+
+/* append a key to a JSON pointer (RFC 6901) */
+static size_t path_append(char *path, size_t plen, size_t size, const char *key)
+{
+	if (plen + 1 < size)
+		path[plen++] = '/';
+	for (; *key && plen + 2 < size; key++) {
+		if (*key == '~' || *key == '/') {
+			path[plen++] = '~';
+			path[plen++] = *key == '~' ? '0' : '1';
+		} else {
+			path[plen++] = *key;
+		}
+	}
+	path[plen] = '\0';
+	return plen;
+}
+
+static void diff_value(struct data *d, char *path, size_t plen, size_t size,
+		const char *old, int olen, const char *new, int nlen);
+
+static void diff_object(struct data *d, char *path, size_t plen, size_t size,
+		const char *old, int olen, const char *new, int nlen)
+{
+	struct spa_json it[2];
+	char key[256];
+	const char *v, *ov;
+	int len, ol;
+	size_t l;
+
+	spa_json_init(&it[0], new, nlen);
+	if (spa_json_enter_object(&it[0], &it[1]) > 0) {
+		while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+			if ((len = json_value(&it[1], &v)) <= 0)
+				break;
+			l = path_append(path, plen, size, key);
+			if (json_find(old, olen, key, &ov, &ol))
+				diff_value(d, path, l, size, ov, ol, v, len);
+			else
+				put_patch(d, "add", path, v, len);
+			path[plen] = '\0';
+		}
+	}
+	spa_json_init(&it[0], old, olen);
+	if (spa_json_enter_object(&it[0], &it[1]) > 0) {
+		while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+			if ((len = json_value(&it[1], &v)) <= 0)
+				break;
+			if (json_find(new, nlen, key, &ov, &ol))
+				continue;
+			path_append(path, plen, size, key);
+			put_patch(d, "remove", path, NULL, 0);
+			path[plen] = '\0';
+		}
+	}
+}
+
+/* objects are compared key by key, other values are replaced as a whole */
+static void diff_value(struct data *d, char *path, size_t plen, size_t size,
+		const char *old, int olen, const char *new, int nlen)
+{
+	if (spa_json_is_object(old, olen) && spa_json_is_object(new, nlen))
+		diff_object(d, path, plen, size, old, olen, new, nlen);
+	else if (olen != nlen || memcmp(old, new, nlen) != 0)
+		put_patch(d, "replace", path, new, nlen);
+}
+
+static void patch_object(struct data *d, struct object *o)
+{
+	char path[1024], *json;
+	size_t plen;
+
+	if ((json = render_object(d, o)) == NULL)
+		return;
+	if (o->json != NULL && spa_streq(o->json, json)) {
+		free(json);
+		return;
+	}
+	if (d->state == STATE_FIRST)
+		put_begin(d, NULL, "[", STATE_SIMPLE);
+
+	plen = snprintf(path, sizeof(path), "/%u", o->id);
+	if (o->json == NULL)
+		put_patch(d, "add", path, json, strlen(json));
+	else
+		diff_value(d, path, plen, sizeof(path),
+				o->json, strlen(o->json), json, strlen(json));
+	free(o->json);
+	o->json = json;
+}
+
+static void dump_objects(struct data *d)
+{
+	struct object *o, *t;
 
 	d->state = STATE_FIRST;
-	spa_list_for_each(o, &d->object_list, link) {
+	spa_list_for_each_safe(o, t, &d->object_list, link) {
 		if (d->pattern != NULL && !object_matches(o, d->pattern))
 			continue;
-		if (o->changed == 0)
+		if (o->changed == 0 || o->sync > d->sync_done)
+			continue;
+		o->changed = 0;
+
+		if (d->patch) {
+			patch_object(d, o);
+			continue;
+		}
+		if (d->stream) {
+			/* one object per line, the object is not needed
+			 * anymore when it is not monitored */
+			d->state = STATE_FIRST;
+			put_object(d, o, STATE_SIMPLE);
+			fputc('\n', d->out);
+			if (!d->monitor)
+				object_destroy(o);
 			continue;
+		}
 		if (d->state == STATE_FIRST)
 			put_begin(d, NULL, "[", 0);
-		put_begin(d, NULL, "{", 0);
-		put_int(d, "id", o->id);
-		put_value(d, "type", o->type);
-		put_int(d, "version", o->version);
-		put_flags(d, "permissions", o->permissions, fl);
-		if (o->class && o->class->dump)
-			o->class->dump(o);
-		else if (o->props)
-			put_dict(d, "props", &o->props->dict);
-		put_end(d, "}", 0);
-		o->changed = 0;
+		put_object(d, o, 0);
 	}
+	if (d->stream)
+		return;
 	if (d->state != STATE_FIRST)
-		put_end(d, "]\n", 0);
+		put_end(d, "]\n", d->patch ? STATE_SIMPLE : 0);
 }
 
 static void on_core_error(void *data, uint32_t id, int seq, int res, const char *message)
@@ -1485,12 +1698,21 @@ static void on_core_done(void *data, uint32_t id, int seq)
 
 		pw_log_debug("sync end %u/%u", d->sync_seq, seq);
 
+		d->sync_pending = false;
+		d->sync_done = d->sync_serial;
+		if (d->sync_needed) {
+			core_sync(d);
+			/* write the objects that are complete right away */
+			if (!d->stream && !d->patch)
+				return;
+		}
+
 		spa_list_for_each(o, &d->object_list, link)
 			object_update_params(&o->param_list, &o->pending_list,
 					o->n_params, o->params);
 
 		dump_objects(d);
-		if (!d->monitor)
+		if (!d->monitor && !d->sync_pending)
 			pw_main_loop_quit(d->loop);
 	}
 }
@@ -1515,6 +1737,9 @@ static void show_help(struct data *data, const char *name, bool error)
 		"      --version                         Show version\n"
 		"  -r, --remote                          Remote daemon name\n"
 		"  -m, --monitor                         monitor changes\n"
+		"  -s, --stream                          write one object per line as soon as\n"
+		"                                        it is complete\n"
+		"  -p, --patch                           monitor changes as JSON patches\n"
 		"  -N, --no-colors                       disable color output\n"
 		"  -C, --color[=WHEN]                    whether to enable color support. WHEN is `never`, `always`, or `auto`\n",
 		name);
@@ -1531,6 +1756,8 @@ int main(int argc, char *argv[])
 		{ "version",	no_argument,		NULL, 'V' },
 		{ "remote",	required_argument,	NULL, 'r' },
 		{ "monitor",	no_argument,		NULL, 'm' },
+		{ "stream",	no_argument,		NULL, 's' },
+		{ "patch",	no_argument,		NULL, 'p' },
 		{ "no-colors",	no_argument,		NULL, 'N' },
 		{ "color",	optional_argument,	NULL, 'C' },
 		{ NULL, 0, NULL, 0}
@@ -1545,7 +1772,7 @@ int main(int argc, char *argv[])
 		colors = true;
 	setlinebuf(data.out);
 
-	while ((c = getopt_long(argc, argv, "hVr:mNC", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hVr:mspNC", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h' :
 			show_help(&data, argv[0], false);
@@ -1564,6 +1791,13 @@ int main(int argc, char *argv[])
 		case 'm' :
 			data.monitor = true;
 			break;
+		case 's' :
+			data.stream = true;
+			break;
+		case 'p' :
+			data.patch = true;
+			data.monitor = true;
+			break;
 		case 'N' :
 			colors = false;
 			break;
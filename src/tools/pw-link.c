@@ -79,6 +79,8 @@ struct data {
 	bool opt_monitor;
 	const char *opt_output;
 	const char *opt_input;
+	char **opt_pairs; /* output and input of each link, for `MODE_CONNECT` */
+	int n_opt_pairs;
 	struct pw_properties *props;
 
 	struct pw_context *context;
@@ -441,32 +443,32 @@ static int create_link_target(struct data *data)
 }
 
 /*
- * create_link_proxies() looks at the current objects and tries to find the
- * matching output and input nodes (multiple links) or the matching output and
- * input ports.
+ * link_pair() looks at the current objects and tries to find the matching
+ * output and input nodes (multiple links) or the matching output and input
+ * ports.
  *
- * If successful, it fills data->target_links with proxies for all links and
- * returns the number of links. This can be zero (two nodes with no ports). It
- * might return (negative) errors. -ENOENT means no matching nodes or ports
- * were found.
+ * If successful, it returns the number of links. This can be zero (two nodes
+ * with no ports). When create is true, it also fills data->target_links with
+ * proxies for all links. It might return (negative) errors. -ENOENT means no
+ * matching nodes or ports were found.
  */
-static int create_link_proxies(struct data *data)
+static int link_pair(struct data *data, const char *output, const char *input, bool create)
 {
 	uint32_t in_port = 0, out_port = 0;
 	struct object *n, *p;
 	struct object *in_node = NULL, *out_node = NULL;
 
-	spa_assert(data->opt_output);
-	spa_assert(data->opt_input);
+	spa_assert(output);
+	spa_assert(input);
 
 	spa_list_for_each(n, &data->objects, link) {
 		if (n->type != OBJECT_NODE)
 			continue;
 
-		if (out_node == NULL && node_matches(data, n, data->opt_output)) {
+		if (out_node == NULL && node_matches(data, n, output)) {
 			out_node = n;
 			continue;
-		} else if (in_node == NULL && node_matches(data, n, data->opt_input)) {
+		} else if (in_node == NULL && node_matches(data, n, input)) {
 			in_node = n;
 			continue;
 		}
@@ -478,10 +480,10 @@ static int create_link_proxies(struct data *data)
 				continue;
 
 			if (out_port == 0 && p->data.port.direction == PW_DIRECTION_OUTPUT &&
-			    port_matches(data, n, p, data->opt_output))
+			    port_matches(data, n, p, output))
 				out_port = p->id;
 			else if (in_port == 0 && p->data.port.direction == PW_DIRECTION_INPUT &&
-			    port_matches(data, n, p, data->opt_input))
+			    port_matches(data, n, p, input))
 				in_port = p->id;
 		}
 	}
@@ -498,6 +500,8 @@ static int create_link_proxies(struct data *data)
 
 			if (!port_out || !port_in)
 				return i;
+			if (!create)
+				continue;
 
 			pw_properties_setf(data->props, PW_KEY_LINK_OUTPUT_PORT, "%u", port_out->id);
 			pw_properties_setf(data->props, PW_KEY_LINK_INPUT_PORT, "%u", port_in->id);
@@ -511,6 +515,8 @@ static int create_link_proxies(struct data *data)
 
 	if (in_port == 0 || out_port == 0)
 		return -ENOENT;
+	if (!create)
+		return 1;
 
 	pw_properties_setf(data->props, PW_KEY_LINK_OUTPUT_PORT, "%u", out_port);
 	pw_properties_setf(data->props, PW_KEY_LINK_INPUT_PORT, "%u", in_port);
@@ -523,6 +529,32 @@ static int create_link_proxies(struct data *data)
 	return !ret ? 1 : ret;
 }
 
+/*
+ * create_link_proxies() creates the links of all the output and input pairs.
+ * All pairs are matched first so that no links are made when one of them
+ * can't be found. The links are then all created at once and their states
+ * are collected together.
+ *
+ * It returns the total number of links or the first (negative) error.
+ */
+static int create_link_proxies(struct data *data)
+{
+	int i, res, n_links = 0;
+
+	for (i = 0; i < data->n_opt_pairs; i++) {
+		res = link_pair(data, data->opt_pairs[2*i], data->opt_pairs[2*i+1], false);
+		if (res < 0)
+			return res;
+	}
+	for (i = 0; i < data->n_opt_pairs; i++) {
+		res = link_pair(data, data->opt_pairs[2*i], data->opt_pairs[2*i+1], true);
+		if (res < 0)
+			return res;
+		n_links += res;
+	}
+	return n_links;
+}
+
 static int do_unlink_ports(struct data *data)
 {
 	struct object *l, *n, *p;
@@ -823,7 +855,7 @@ static void show_help(struct data *data, const char *name, bool error)
 		"  -m, --monitor                         Monitor links and ports\n"
 		"  -I, --id                              List IDs\n"
 		"  -v, --verbose                         Verbose port properties\n"
-		"Connect: %1$s [options] output input\n"
+		"Connect: %1$s [options] output input [output input ...]\n"
 		"  -L, --linger                          Linger (default, unless -m is used)\n"
 		"  -P, --passive                         Passive link\n"
 		"  -p, --props=PROPS                     Properties as JSON object\n"
@@ -977,6 +1009,9 @@ static int run(int argc, char *argv[])
 	if (!data.opt_monitor)
 		pw_properties_set(data.props, PW_KEY_OBJECT_LINGER, "true");
 
+	data.opt_pairs = &argv[optind];
+	data.n_opt_pairs = (argc - optind) / 2;
+
 	if (optind < argc)
 		data.opt_output = argv[optind++];
 	if (optind < argc)
@@ -996,6 +1031,11 @@ static int run(int argc, char *argv[])
 			fprintf(stderr, "missing output and input port names to connect\n");
 			return -1;
 		}
+		if ((argc - optind) % 2 != 0) {
+			fprintf(stderr, "missing input port name to connect to %s\n",
+					argv[argc - 1]);
+			return -1;
+		}
 		break;
 	}
 
@@ -11,6 +11,7 @@
 #include <spa/utils/result.h>
 #include <spa/utils/defs.h>
 #include <spa/control/control.h>
+#include <spa/control/ump-utils.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/props.h>
 
@@ -85,14 +86,27 @@ static void on_process(void *_data, struct spa_io_position *position)
 
 	SPA_POD_SEQUENCE_FOREACH((struct spa_pod_sequence*)pod, c) {
 		struct midi_event ev;
+		uint8_t midi[16];
+		int size;
 
-		if (c->type != SPA_CONTROL_Midi)
+		switch (c->type) {
+		case SPA_CONTROL_Midi:
+			ev.data = SPA_POD_BODY(&c->value);
+			ev.size = SPA_POD_BODY_SIZE(&c->value);
+			break;
+		case SPA_CONTROL_UMP:
+			if ((size = spa_ump_to_midi(SPA_POD_BODY(&c->value),
+					SPA_POD_BODY_SIZE(&c->value), midi, sizeof(midi))) <= 0)
+				continue;
+			ev.data = midi;
+			ev.size = size;
+			break;
+		default:
 			continue;
+		}
 
 		ev.track = 0;
 		ev.sec = (frame + c->offset) / (float) position->clock.rate.denom;
-		ev.data = SPA_POD_BODY(&c->value),
-		ev.size = SPA_POD_BODY_SIZE(&c->value);
 
 		printf("%4d: ", c->offset);
 		midi_file_dump_event(stdout, &ev);
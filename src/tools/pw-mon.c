@@ -55,6 +55,7 @@ struct data {
 
 	struct spa_list pending_list;
 	struct spa_list global_list;
+	int sync_seq;
 
 	bool hide_params;
 	bool hide_props;
@@ -80,6 +81,20 @@ struct proxy_data {
 	struct spa_list param_list;
 };
 
+#define PENDING_NEXT_SYNC	-1
+
+static void start_sync(struct data *d)
+{
+	struct proxy_data *pd;
+
+	d->sync_seq = pw_core_sync(d->core, 0, d->sync_seq);
+
+	spa_list_for_each(pd, &d->pending_list, pending_link) {
+		if (pd->pending_seq == PENDING_NEXT_SYNC)
+			pd->pending_seq = d->sync_seq;
+	}
+}
+
 static void add_pending(struct proxy_data *pd)
 {
 	struct data *d = pd->data;
@@ -87,7 +102,11 @@ static void add_pending(struct proxy_data *pd)
 	if (pd->pending_seq == 0) {
 		spa_list_append(&d->pending_list, &pd->pending_link);
 	}
-	pd->pending_seq = pw_core_sync(d->core, 0, pd->pending_seq);
+	/* share one sync between the objects, the next one is started when
+	 * the one in flight completes */
+	pd->pending_seq = PENDING_NEXT_SYNC;
+	if (d->sync_seq == 0)
+		start_sync(d);
 }
 
 static void remove_pending(struct proxy_data *pd)
@@ -102,13 +121,21 @@ static void on_core_done(void *data, uint32_t id, int seq)
 {
 	struct data *d = data;
 	struct proxy_data *pd, *t;
+	bool next = false;
+
+	if (seq != d->sync_seq)
+		return;
+	d->sync_seq = 0;
 
 	spa_list_for_each_safe(pd, t, &d->pending_list, pending_link) {
 		if (pd->pending_seq == seq) {
 			remove_pending(pd);
 			pd->print_func(pd);
-		}
+		} else if (pd->pending_seq == PENDING_NEXT_SYNC)
+			next = true;
 	}
+	if (next)
+		start_sync(d);
 }
 
 static void clear_params(struct proxy_data *data)
@@ -11,6 +11,7 @@
 #include <spa/utils/string.h>
 #include <spa/pod/parser.h>
 #include <spa/debug/types.h>
+#include <spa/utils/json.h>
 
 #include <pipewire/impl.h>
 #include <pipewire/extensions/profiler.h>
@@ -18,6 +19,7 @@
 #define MAX_NAME		128
 #define MAX_FOLLOWERS		64
 #define DEFAULT_FILENAME	"profiler.log"
+#define DEFAULT_TRACE_FILENAME	"profiler.json"
 
 struct follower {
 	uint32_t id;
@@ -36,6 +38,7 @@ struct data {
 
 	const char *filename;
 	FILE *output;
+	unsigned int trace:1;
 
 	int64_t count;
 	int64_t start_status;
@@ -46,6 +49,7 @@ struct data {
 	int check_profiler;
 
 	uint32_t driver_id;
+	char driver_name[MAX_NAME];
 
 	int n_followers;
 	struct follower followers[MAX_FOLLOWERS];
@@ -112,6 +116,7 @@ static int process_driver_block(struct data *d, const struct spa_pod *pod, struc
 
 	if (d->driver_id == 0) {
 		d->driver_id = driver_id;
+		snprintf(d->driver_name, sizeof(d->driver_name), "%s", name);
 		printf("logging driver %u\n", driver_id);
 	}
 	else if (d->driver_id != driver_id)
@@ -176,6 +181,21 @@ static int process_follower_block(struct data *d, const struct spa_pod *pod, str
 	return 0;
 }
 
+static void print_status(struct data *d, struct point *point)
+{
+	if (d->count == 0) {
+		d->start_status = point->clock.nsec;
+		d->last_status = point->clock.nsec;
+	}
+	else if (point->clock.nsec - d->last_status > SPA_NSEC_PER_SEC) {
+		printf("logging %"PRIi64" samples  %"PRIi64" seconds [CPU %f %f %f]\r",
+				d->count, (int64_t) ((d->last_status - d->start_status) / SPA_NSEC_PER_SEC),
+				point->cpu_load[0], point->cpu_load[1], point->cpu_load[2]);
+		d->last_status = point->clock.nsec;
+	}
+	d->count++;
+}
+
 static void dump_point(struct data *d, struct point *point)
 {
 	int i;
@@ -219,17 +239,61 @@ static void dump_point(struct data *d, struct point *point)
 		}
 	}
 	fprintf(d->output, "\n");
-	if (d->count == 0) {
-		d->start_status = point->clock.nsec;
-		d->last_status = point->clock.nsec;
-	}
-	else if (point->clock.nsec - d->last_status > SPA_NSEC_PER_SEC) {
-		printf("logging %"PRIi64" samples  %"PRIi64" seconds [CPU %f %f %f]\r",
-				d->count, (int64_t) ((d->last_status - d->start_status) / SPA_NSEC_PER_SEC),
-				point->cpu_load[0], point->cpu_load[1], point->cpu_load[2]);
-		d->last_status = point->clock.nsec;
+}
+
+/* Trace Event Format, as used by chrome://tracing and Perfetto. Every node
+ * is a thread of the driver process and every cycle of a node is a complete
+ * event from awake to finish. */
+static void dump_trace_event(struct data *d, uint32_t id, const char *name,
+		struct measurement *m)
+{
+	char str[MAX_NAME * 2];
+
+	if (m->status == 0 || m->awake < m->signal || m->finish < m->awake)
+		return;
+
+	spa_json_encode_string(str, sizeof(str) - 1, name);
+	str[sizeof(str) - 1] = '\0';
+
+	fprintf(d->output, "{\"name\":%s,\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+			"\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"wait\":%.3f,\"status\":%d}},\n",
+			str, d->driver_id, id,
+			m->awake / 1000.0, (m->finish - m->awake) / 1000.0,
+			(m->awake - m->signal) / 1000.0, m->status);
+}
+
+static void dump_trace(struct data *d, struct point *point)
+{
+	int i;
+
+	dump_trace_event(d, d->driver_id, d->driver_name, &point->driver);
+	for (i = 0; i < d->n_followers; i++)
+		dump_trace_event(d, d->followers[i].id, d->followers[i].name,
+				&point->follower[i]);
+	fprintf(d->output, "{\"name\":\"cpu\",\"ph\":\"C\",\"pid\":%u,\"ts\":%.3f,"
+			"\"args\":{\"load\":%f}},\n",
+			d->driver_id, point->driver.signal / 1000.0, point->cpu_load[0]);
+}
+
+static void dump_trace_names(struct data *d)
+{
+	char str[MAX_NAME * 2];
+	int i;
+
+	spa_json_encode_string(str, sizeof(str) - 1, d->driver_name);
+	str[sizeof(str) - 1] = '\0';
+	fprintf(d->output, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+			"\"args\":{\"name\":%s}},\n", d->driver_id, str);
+
+	for (i = 0; i < d->n_followers; i++) {
+		spa_json_encode_string(str, sizeof(str) - 1, d->followers[i].name);
+		str[sizeof(str) - 1] = '\0';
+		fprintf(d->output, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,"
+				"\"tid\":%u,\"args\":{\"name\":%s}},\n",
+				d->driver_id, d->followers[i].id, str);
 	}
-	d->count++;
+	/* the array ends with an empty object to avoid a trailing comma */
+	fprintf(d->output, "{}\n]\n");
 }
 
 static void dump_scripts(struct data *d)
@@ -440,7 +504,11 @@ static void profiler_profile(void *data, const struct spa_pod *pod)
 		if (res < 0)
 			continue;
 
-		dump_point(d, &point);
+		if (d->trace)
+			dump_trace(d, &point);
+		else
+			dump_point(d, &point);
+		print_status(d, &point);
 	}
 }
 
@@ -526,9 +594,11 @@ static void show_help(const char *name, bool error)
 		"  -h, --help                            Show this help\n"
 		"      --version                         Show version\n"
 		"  -r, --remote                          Remote daemon name\n"
-		"  -o, --output                          Profiler output name (default \"%s\")\n",
+		"  -o, --output                          Profiler output name (default \"%s\")\n"
+		"  -t, --trace                           Write a Chrome/Perfetto JSON trace\n"
+		"                                        (default output \"%s\")\n",
 		name,
-		DEFAULT_FILENAME);
+		DEFAULT_FILENAME, DEFAULT_TRACE_FILENAME);
 }
 
 int main(int argc, char *argv[])
@@ -536,12 +606,13 @@ int main(int argc, char *argv[])
 	struct data data = { 0 };
 	struct pw_loop *l;
 	const char *opt_remote = NULL;
-	const char *opt_output = DEFAULT_FILENAME;
+	const char *opt_output = NULL;
 	static const struct option long_options[] = {
 		{ "help",	no_argument,		NULL, 'h' },
 		{ "version",	no_argument,		NULL, 'V' },
 		{ "remote",	required_argument,	NULL, 'r' },
 		{ "output",	required_argument,	NULL, 'o' },
+		{ "trace",	no_argument,		NULL, 't' },
 		{ NULL, 0, NULL, 0}
 	};
 	int c;
@@ -549,7 +620,7 @@ int main(int argc, char *argv[])
 	setlocale(LC_ALL, "");
 	pw_init(&argc, &argv);
 
-	while ((c = getopt_long(argc, argv, "hVr:o:", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hVr:o:t", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			show_help(argv[0], false);
@@ -568,6 +639,9 @@ int main(int argc, char *argv[])
 		case 'r':
 			opt_remote = optarg;
 			break;
+		case 't':
+			data.trace = 1;
+			break;
 		default:
 			show_help(argv[0], true);
 			return -1;
@@ -602,6 +676,8 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (opt_output == NULL)
+		opt_output = data.trace ? DEFAULT_TRACE_FILENAME : DEFAULT_FILENAME;
 	data.filename = opt_output;
 
 	data.output = fopen(data.filename, "we");
@@ -611,6 +687,8 @@ int main(int argc, char *argv[])
 	}
 
 	printf("Logging to %s\n", data.filename);
+	if (data.trace)
+		fprintf(data.output, "[\n");
 
 	pw_core_add_listener(data.core,
 				   &data.core_listener,
@@ -635,9 +713,13 @@ int main(int argc, char *argv[])
 	pw_context_destroy(data.context);
 	pw_main_loop_destroy(data.loop);
 
+	if (data.trace)
+		dump_trace_names(&data);
+
 	fclose(data.output);
 
-	dump_scripts(&data);
+	if (!data.trace)
+		dump_scripts(&data);
 
 	pw_deinit();
 
@@ -3,6 +3,7 @@
 /* SPDX-License-Identifier: MIT */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <signal.h>
 #include <getopt.h>
 #include <locale.h>
@@ -24,6 +25,9 @@
 
 #define XRUN_INVALID	(uint32_t)-1
 
+#define MAX_SAMPLES	1024
+#define MAX_BUCKETS	12
+
 struct driver {
 	int64_t count;
 	float cpu_load[3];
@@ -44,6 +48,30 @@ struct measurement {
 	uint32_t xrun_count;
 };
 
+/* the last MAX_SAMPLES wakeup delays and processing times of a node */
+struct stats {
+	uint32_t n_samples;
+	uint32_t pos;
+	uint32_t wait[MAX_SAMPLES];
+	uint32_t busy[MAX_SAMPLES];
+};
+
+/* memory reported in the node and client properties */
+struct memory {
+	uint64_t total;
+	uint64_t buffers;
+	uint64_t private;
+};
+
+struct client {
+	struct spa_list link;
+	uint32_t id;
+	uint64_t memory;
+	struct pw_proxy *proxy;
+	struct spa_hook proxy_listener;
+	struct spa_hook object_listener;
+};
+
 struct node {
 	struct spa_list link;
 	struct data *data;
@@ -51,6 +79,9 @@ struct node {
 	char name[MAX_NAME+1];
 	enum pw_node_state state;
 	struct measurement measurement;
+	struct stats stats;
+	struct memory memory;
+	uint32_t client_id;
 	struct driver info;
 	struct node *driver;
 	uint32_t generation;
@@ -79,13 +110,19 @@ struct data {
 
 	int n_nodes;
 	struct spa_list node_list;
+	struct spa_list client_list;
 	uint32_t generation;
 	unsigned pending_refresh:1;
 
 	WINDOW *win;
 
 	unsigned int batch_mode:1;
+	unsigned int show_stats:1;
+	unsigned int show_memory:1;
 	int iterations;
+
+	FILE *output;
+	uint64_t start_time;
 };
 
 struct point {
@@ -185,6 +222,19 @@ static const char *find_node_name(const struct spa_dict *props)
 	return NULL;
 }
 
+static uint64_t get_size(const struct spa_dict *props, const char *key)
+{
+	const char *str = spa_dict_lookup(props, key);
+	return str ? strtoull(str, NULL, 10) : 0;
+}
+
+static void update_memory(struct memory *m, const struct spa_dict *props)
+{
+	m->total = get_size(props, PW_KEY_NODE_MEMORY);
+	m->buffers = get_size(props, PW_KEY_NODE_MEMORY_BUFFERS);
+	m->private = get_size(props, PW_KEY_NODE_MEMORY_PRIVATE);
+}
+
 static void set_node_name(struct node *n, const char *name)
 {
 	if (name)
@@ -202,8 +252,12 @@ static void node_info(void *data, const struct pw_node_info *info)
 		do_refresh(n->data, !n->data->batch_mode);
 	}
 
-	if (info->change_mask & PW_NODE_CHANGE_MASK_PROPS)
+	if (info->change_mask & PW_NODE_CHANGE_MASK_PROPS) {
 		set_node_name(n, find_node_name(info->props));
+		update_memory(&n->memory, info->props);
+		n->client_id = SPA_ID_INVALID;
+		spa_atou32(spa_dict_lookup(info->props, PW_KEY_CLIENT_ID), &n->client_id, 0);
+	}
 }
 
 static void node_param(void *data, int seq,
@@ -318,6 +372,76 @@ static const struct pw_node_events node_events = {
 	.param = node_param,
 };
 
+static struct client *find_client(struct data *d, uint32_t id)
+{
+	struct client *c;
+	spa_list_for_each(c, &d->client_list, link) {
+		if (c->id == id)
+			return c;
+	}
+	return NULL;
+}
+
+static void client_info(void *data, const struct pw_client_info *info)
+{
+	struct client *c = data;
+
+	if (info->change_mask & PW_CLIENT_CHANGE_MASK_PROPS)
+		c->memory = get_size(info->props, PW_KEY_CLIENT_MEMORY);
+}
+
+static const struct pw_client_events client_events = {
+	PW_VERSION_CLIENT_EVENTS,
+	.info = client_info,
+};
+
+static void on_client_removed(void *data)
+{
+	struct client *c = data;
+	pw_proxy_destroy(c->proxy);
+}
+
+static void on_client_destroy(void *data)
+{
+	struct client *c = data;
+	c->proxy = NULL;
+	spa_hook_remove(&c->proxy_listener);
+	spa_hook_remove(&c->object_listener);
+}
+
+static const struct pw_proxy_events client_proxy_events = {
+	PW_VERSION_PROXY_EVENTS,
+	.removed = on_client_removed,
+	.destroy = on_client_destroy,
+};
+
+static struct client *add_client(struct data *d, uint32_t id)
+{
+	struct client *c;
+
+	if ((c = calloc(1, sizeof(*c))) == NULL)
+		return NULL;
+
+	c->id = id;
+	c->proxy = pw_registry_bind(d->registry, id, PW_TYPE_INTERFACE_Client, PW_VERSION_CLIENT, 0);
+	if (c->proxy) {
+		pw_proxy_add_listener(c->proxy,
+				&c->proxy_listener, &client_proxy_events, c);
+		pw_proxy_add_object_listener(c->proxy,
+				&c->object_listener, &client_events, c);
+	}
+	spa_list_append(&d->client_list, &c->link);
+	return c;
+}
+
+static void remove_client(struct data *d, struct client *c)
+{
+	if (c->proxy)
+		pw_proxy_destroy(c->proxy);
+	spa_list_remove(&c->link);
+	free(c);
+}
+
 static struct node *add_node(struct data *d, uint32_t id, const char *name)
 {
 	struct node *n;
@@ -328,6 +452,7 @@ static struct node *add_node(struct data *d, uint32_t id, const char *name)
 	n->data = d;
 	n->id = id;
 	n->driver = n;
+	n->client_id = SPA_ID_INVALID;
 
 	n->proxy = pw_registry_bind(d->registry, id, PW_TYPE_INTERFACE_Node, PW_VERSION_NODE, 0);
 	if (n->proxy) {
@@ -362,6 +487,44 @@ static void remove_node(struct data *d, struct node *n)
 	free(n);
 }
 
+static void get_times(const struct measurement *m, uint64_t *waiting, uint64_t *busy)
+{
+	if (m->awake >= m->signal)
+		*waiting = m->awake - m->signal;
+	else if (m->signal > m->prev_signal)
+		*waiting = -2;
+	else
+		*waiting = -1;
+
+	if (m->finish >= m->awake)
+		*busy = m->finish - m->awake;
+	else if (m->awake > m->prev_signal)
+		*busy = -2;
+	else
+		*busy = -1;
+}
+
+static void add_sample(struct node *n, const struct measurement *m)
+{
+	struct stats *s = &n->stats;
+	uint64_t waiting, busy;
+
+	/* only complete cycles, the same block is reported again when the
+	 * node did not run in this cycle */
+	if (m->signal <= m->prev_signal || m->signal == n->measurement.signal)
+		return;
+
+	get_times(m, &waiting, &busy);
+	if (waiting >= UINT32_MAX || busy >= UINT32_MAX)
+		return;
+
+	s->wait[s->pos] = waiting;
+	s->busy[s->pos] = busy;
+	s->pos = (s->pos + 1) % MAX_SAMPLES;
+	if (s->n_samples < MAX_SAMPLES)
+		s->n_samples++;
+}
+
 static int process_driver_block(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	char *name = NULL;
@@ -387,6 +550,7 @@ static int process_driver_block(struct data *d, const struct spa_pod *pod, struc
 	if ((n = find_node(d, id)) == NULL)
 		return -ENOENT;
 
+	add_sample(n, &m);
 	n->driver = n;
 	n->measurement = m;
 	n->info = point->info;
@@ -420,6 +584,7 @@ static int process_follower_block(struct data *d, const struct spa_pod *pod, str
 	if ((n = find_node(d, id)) == NULL)
 		return -ENOENT;
 
+	add_sample(n, &m);
 	n->measurement = m;
 	if (n->driver != point->driver) {
 		n->driver = point->driver;
@@ -483,6 +648,130 @@ static const char *state_as_string(enum pw_node_state state, uint32_t transport)
 	return "!";
 }
 
+static int compare_sample(const void *a, const void *b)
+{
+	uint32_t va = *(const uint32_t*)a, vb = *(const uint32_t*)b;
+	return va < vb ? -1 : va > vb;
+}
+
+/* p50, p99 and p99.9 of the samples, sorted in place */
+static void get_percentiles(uint32_t *samples, uint32_t n_samples, uint64_t perc[3])
+{
+	if (n_samples == 0) {
+		perc[0] = perc[1] = perc[2] = -1;
+		return;
+	}
+	qsort(samples, n_samples, sizeof(uint32_t), compare_sample);
+	perc[0] = samples[n_samples * 500 / 1000];
+	perc[1] = samples[n_samples * 990 / 1000];
+	perc[2] = samples[n_samples * 999 / 1000];
+}
+
+/* busy time in power of two microsecond buckets, <1us, <2us, ... >=1ms */
+static const char *print_histogram(char *buf, size_t len, const uint32_t *samples, uint32_t n_samples)
+{
+	static const char levels[] = " .:-=+*#%@";
+	uint32_t i, b, count[MAX_BUCKETS] = { 0 }, max = 0;
+
+	for (i = 0; i < n_samples; i++) {
+		uint32_t us = samples[i] / 1000;
+		for (b = 0; us > 0 && b < MAX_BUCKETS - 1; b++)
+			us >>= 1;
+		if (++count[b] > max)
+			max = count[b];
+	}
+	for (i = 0; i < MAX_BUCKETS && i < len - 1; i++)
+		buf[i] = max ? levels[(count[i] * (sizeof(levels) - 2) + max - 1) / max] : ' ';
+	buf[i] = '\0';
+	return buf;
+}
+
+static void print_node_stats(struct data *d, struct driver *i, struct node *n, int y)
+{
+	char buf[6][64], hist[MAX_BUCKETS+1];
+	uint32_t samples[MAX_SAMPLES];
+	uint64_t wait[3], busy[3];
+	struct stats *s = &n->stats;
+	bool active;
+
+	active = n->state == PW_NODE_STATE_RUNNING || n->state == PW_NODE_STATE_IDLE;
+
+	memcpy(samples, s->wait, s->n_samples * sizeof(uint32_t));
+	get_percentiles(samples, s->n_samples, wait);
+	memcpy(samples, s->busy, s->n_samples * sizeof(uint32_t));
+	print_histogram(hist, sizeof(hist), samples, s->n_samples);
+	get_percentiles(samples, s->n_samples, busy);
+
+	print_mode_dependent(d, y, 0, "%s %4.1u %5u %s %s %s %s %s %s |%s| %s%s",
+			state_as_string(n->state, i->transport_state),
+			n->id, s->n_samples,
+			print_time(buf[0], active, 64, wait[0]),
+			print_time(buf[1], active, 64, wait[1]),
+			print_time(buf[2], active, 64, wait[2]),
+			print_time(buf[3], active, 64, busy[0]),
+			print_time(buf[4], active, 64, busy[1]),
+			print_time(buf[5], active, 64, busy[2]),
+			hist,
+			n->driver == n ? "" : " + ",
+			n->name);
+}
+
+static void export_node_stats(struct data *d, struct node *n, uint64_t now)
+{
+	uint32_t samples[MAX_SAMPLES];
+	uint64_t wait[3], busy[3];
+	struct stats *s = &n->stats;
+
+	if (s->n_samples == 0)
+		return;
+
+	memcpy(samples, s->wait, s->n_samples * sizeof(uint32_t));
+	get_percentiles(samples, s->n_samples, wait);
+	memcpy(samples, s->busy, s->n_samples * sizeof(uint32_t));
+	get_percentiles(samples, s->n_samples, busy);
+
+	fprintf(d->output, "%.3f,%u,\"%s\",%u,%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+			(now - d->start_time) / (double)SPA_NSEC_PER_SEC,
+			n->id, n->name, s->n_samples,
+			wait[0], wait[1], wait[2], busy[0], busy[1], busy[2]);
+}
+
+static const char *print_size(char *buf, size_t len, uint64_t size)
+{
+	if (size >= 1024 * 1024 * 1024)
+		snprintf(buf, len, "%6.1fG", size / (1024.0 * 1024.0 * 1024.0));
+	else if (size >= 1024 * 1024)
+		snprintf(buf, len, "%6.1fM", size / (1024.0 * 1024.0));
+	else if (size >= 1024)
+		snprintf(buf, len, "%6.1fK", size / 1024.0);
+	else
+		snprintf(buf, len, "%7"PRIu64, size);
+	return buf;
+}
+
+static void print_node_memory(struct data *d, struct driver *i, struct node *n, int y)
+{
+	char buf[4][64], client[16];
+	struct client *c;
+
+	c = n->client_id != SPA_ID_INVALID ? find_client(d, n->client_id) : NULL;
+	if (c)
+		snprintf(client, sizeof(client), "%u", c->id);
+	else
+		snprintf(client, sizeof(client), "-");
+
+	print_mode_dependent(d, y, 0, "%s %4.1u %s %s %s %6.6s %s %s%s",
+			state_as_string(n->state, i->transport_state),
+			n->id,
+			print_size(buf[0], 64, n->memory.buffers),
+			print_size(buf[1], 64, n->memory.private),
+			print_size(buf[2], 64, n->memory.total),
+			client,
+			print_size(buf[3], 64, c ? c->memory : 0),
+			n->driver == n ? "" : " + ",
+			n->name);
+}
+
 static void print_node(struct data *d, struct driver *i, struct node *n, int y)
 {
 	char buf1[64];
@@ -494,6 +783,15 @@ static void print_node(struct data *d, struct driver *i, struct node *n, int y)
 	struct spa_fraction frac;
 	bool active;
 
+	if (d->show_stats) {
+		print_node_stats(d, i, n, y);
+		return;
+	}
+	if (d->show_memory) {
+		print_node_memory(d, i, n, y);
+		return;
+	}
+
 	active = n->state == PW_NODE_STATE_RUNNING || n->state == PW_NODE_STATE_IDLE;
 
 	if (!active)
@@ -508,19 +806,7 @@ static void print_node(struct data *d, struct driver *i, struct node *n, int y)
 	else
 		quantum = 0.0f;
 
-	if (n->measurement.awake >= n->measurement.signal)
-		waiting = n->measurement.awake - n->measurement.signal;
-	else if (n->measurement.signal > n->measurement.prev_signal)
-		waiting = -2;
-	else
-		waiting = -1;
-
-	if (n->measurement.finish >= n->measurement.awake)
-		busy = n->measurement.finish - n->measurement.awake;
-	else if (n->measurement.awake > n->measurement.prev_signal)
-		busy = -2;
-	else
-		busy = -1;
+	get_times(&n->measurement, &waiting, &busy);
 
 	print_mode_dependent(d, y, 0, "%s %4.1u %6.1u %6.1u %s %s %s %s  %3.1u %16.16s %s%s",
 			state_as_string(n->state, i->transport_state),
@@ -542,9 +828,21 @@ static void clear_node(struct node *n)
 	n->driver = n;
 	spa_zero(n->measurement);
 	spa_zero(n->info);
+	n->stats.n_samples = n->stats.pos = 0;
 }
 
 #define HEADER	"S   ID  QUANT   RATE    WAIT    BUSY   W/Q   B/Q  ERR FORMAT           NAME "
+#define HEADER_STATS	"S   ID  SAMPL  WAIT50  WAIT99 WAIT999  BUSY50  BUSY99 BUSY999 BUSY HISTOGRAM NAME "
+#define HEADER_MEMORY	"S   ID BUFFERS PRIVATE   TOTAL CLIENT  CL-MEM NAME "
+
+static const char *get_header(struct data *d)
+{
+	if (d->show_stats)
+		return HEADER_STATS;
+	if (d->show_memory)
+		return HEADER_MEMORY;
+	return HEADER;
+}
 
 static void do_refresh(struct data *d, bool force_refresh)
 {
@@ -557,11 +855,11 @@ static void do_refresh(struct data *d, bool force_refresh)
 	if (!d->batch_mode) {
 		wclear(d->win);
 		wattron(d->win, A_REVERSE);
-		wprintw(d->win, "%-*.*s", COLS, COLS, HEADER);
+		wprintw(d->win, "%-*.*s", COLS, COLS, get_header(d));
 		wattroff(d->win, A_REVERSE);
 		wprintw(d->win, "\n");
 	} else
-		printf(HEADER "\n");
+		printf("%s\n", get_header(d));
 
 	spa_list_for_each_safe(n, t, &d->node_list, link) {
 		if (n->driver != n)
@@ -606,6 +904,16 @@ static void do_timeout(void *data, uint64_t expirations)
 {
 	struct data *d = data;
 	d->generation++;
+
+	if (d->output) {
+		struct timespec now;
+		struct node *n;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		spa_list_for_each(n, &d->node_list, link)
+			export_node_stats(d, n, SPA_TIMESPEC_TO_NSEC(&now));
+		fflush(d->output);
+	}
 	do_refresh(d, true);
 }
 
@@ -664,6 +972,9 @@ static void registry_event_global(void *data, uint32_t id,
 	if (spa_streq(type, PW_TYPE_INTERFACE_Node)) {
 		if (add_node(d, id, find_node_name(props)) == NULL)
 			pw_log_warn("can add node %u: %m", id);
+	} else if (spa_streq(type, PW_TYPE_INTERFACE_Client)) {
+		if (add_client(d, id) == NULL)
+			pw_log_warn("can add client %u: %m", id);
 	} else if (spa_streq(type, PW_TYPE_INTERFACE_Profiler)) {
 		if (d->profiler != NULL) {
 			printf("Ignoring profiler %d: already attached\n", id);
@@ -690,8 +1001,11 @@ static void registry_event_global_remove(void *data, uint32_t id)
 {
 	struct data *d = data;
 	struct node *n;
+	struct client *c;
 	if ((n = find_node(d, id)) != NULL)
 		remove_node(d, n);
+	if ((c = find_client(d, id)) != NULL)
+		remove_client(d, c);
 
 	do_refresh(d, false);
 }
@@ -755,6 +1069,9 @@ static void show_help(const char *name, bool error)
 		"  -b, --batch-mode		         run in non-interactive batch mode\n"
 		"  -n, --iterations = NUMBER             exit after NUMBER batch iterations\n"
 		"  -r, --remote                          Remote daemon name\n"
+		"  -p, --percentiles                     Show percentiles and a histogram\n"
+		"  -o, --output = FILE                   Write percentiles to FILE as CSV\n"
+		"  -m, --memory                          Show the memory of nodes and clients\n"
 		"\n"
 		"  -h, --help                            Show this help\n"
 		"  -V  --version                         Show version\n",
@@ -785,6 +1102,16 @@ static void do_handle_io(void *data, int fd, uint32_t mask)
 		case 'q':
 			pw_main_loop_quit(d->loop);
 			break;
+		case 'p':
+			d->show_stats = !d->show_stats;
+			d->show_memory = false;
+			do_refresh(d, true);
+			break;
+		case 'm':
+			d->show_memory = !d->show_memory;
+			d->show_stats = false;
+			do_refresh(d, true);
+			break;
 		default:
 			do_refresh(d, !d->batch_mode);
 			break;
@@ -796,11 +1123,14 @@ int main(int argc, char *argv[])
 {
 	struct data data = { 0 };
 	struct pw_loop *l;
-	const char *opt_remote = NULL;
+	const char *opt_remote = NULL, *opt_output = NULL;
 	static const struct option long_options[] = {
 		{ "batch-mode",	no_argument,		NULL, 'b' },
 		{ "iterations",	required_argument,	NULL, 'n' },
 		{ "remote",	required_argument,	NULL, 'r' },
+		{ "percentiles", no_argument,		NULL, 'p' },
+		{ "output",	required_argument,	NULL, 'o' },
+		{ "memory",	no_argument,		NULL, 'm' },
 		{ "help",	no_argument,		NULL, 'h' },
 		{ "version",	no_argument,		NULL, 'V' },
 		{ NULL, 0, NULL, 0}
@@ -808,6 +1138,7 @@ int main(int argc, char *argv[])
 	int c;
 	struct timespec value, interval;
 	struct node *n;
+	struct client *cl;
 
 	setlocale(LC_ALL, "");
 	pw_init(&argc, &argv);
@@ -815,8 +1146,9 @@ int main(int argc, char *argv[])
 	data.iterations = -1;
 
 	spa_list_init(&data.node_list);
+	spa_list_init(&data.client_list);
 
-	while ((c = getopt_long(argc, argv, "hVr:o:bn:", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hVr:o:pmbn:", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			show_help(argv[0], false);
@@ -838,6 +1170,15 @@ int main(int argc, char *argv[])
 		case 'n':
 			spa_atoi32(optarg, &data.iterations, 10);
 			break;
+		case 'p':
+			data.show_stats = 1;
+			break;
+		case 'o':
+			opt_output = optarg;
+			break;
+		case 'm':
+			data.show_memory = 1;
+			break;
 		default:
 			show_help(argv[0], true);
 			return -1;
@@ -853,6 +1194,19 @@ int main(int argc, char *argv[])
 	if (!data.batch_mode)
 		data.iterations = -1;
 
+	if (opt_output) {
+		struct timespec now;
+
+		if ((data.output = fopen(opt_output, "w")) == NULL) {
+			fprintf(stderr, "Can't open %s: %m\n", opt_output);
+			return -1;
+		}
+		fprintf(data.output, "time,id,name,samples,wait_p50,wait_p99,wait_p999,"
+				"busy_p50,busy_p99,busy_p999\n");
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		data.start_time = SPA_TIMESPEC_TO_NSEC(&now);
+	}
+
 	l = pw_main_loop_get_loop(data.loop);
 	pw_loop_add_signal(l, SIGINT, do_quit, &data);
 	pw_loop_add_signal(l, SIGTERM, do_quit, &data);
@@ -909,6 +1263,8 @@ int main(int argc, char *argv[])
 
 	spa_list_consume(n, &data.node_list, link)
 		remove_node(&data, n);
+	spa_list_consume(cl, &data.client_list, link)
+		remove_client(&data, cl);
 	if (data.profiler) {
 		spa_hook_remove(&data.profiler_listener);
 		pw_proxy_destroy((struct pw_proxy*)data.profiler);
@@ -919,6 +1275,9 @@ int main(int argc, char *argv[])
 	pw_context_destroy(data.context);
 	pw_main_loop_destroy(data.loop);
 
+	if (data.output)
+		fclose(data.output);
+
 	pw_deinit();
 
 	return 0;
@@ -24,6 +24,7 @@ PWTEST(client_abi)
 		void (*resource_added) (void *data, struct pw_resource *resource);
 		void (*resource_removed) (void *data, struct pw_resource *resource);
 		void (*busy_changed) (void *data, bool busy);
+		void (*congested_changed) (void *data, bool congested);
 	} test = { PW_VERSION_IMPL_CLIENT_EVENTS, NULL };
 
 	struct pw_impl_client_events ev;
@@ -35,8 +36,9 @@ PWTEST(client_abi)
 	TEST_FUNC(ev, test, resource_added);
 	TEST_FUNC(ev, test, resource_removed);
 	TEST_FUNC(ev, test, busy_changed);
+	TEST_FUNC(ev, test, congested_changed);
 
-	pwtest_int_eq(PW_VERSION_IMPL_CLIENT_EVENTS, 0);
+	pwtest_int_eq(PW_VERSION_IMPL_CLIENT_EVENTS, 1);
 	pwtest_int_eq(sizeof(ev), sizeof(test));
 
 	return PWTEST_PASS;
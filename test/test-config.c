@@ -73,10 +73,57 @@ PWTEST(config_load_nullname)
 	return PWTEST_PASS;
 }
 
+static int match_count(void *data, const char *location, const char *action,
+		const char *str, size_t len)
+{
+	int *count = data;
+	(*count)++;
+	return 0;
+}
+
+static int match_rules(const char *rules, const struct spa_dict *props)
+{
+	int count = 0;
+	pw_conf_match_rules(rules, strlen(rules), "test", props, match_count, &count);
+	return count;
+}
+
+PWTEST(config_match_rules)
+{
+	static const struct spa_dict_item items[] = {
+		{ "node.name", "alsa_output.pci" },
+		{ "media.class", "Audio/Sink" },
+		{ "foo", "null" },
+	};
+	const struct spa_dict props = SPA_DICT_INIT_ARRAY(items);
+	const char *rules = "[ { matches = [ { node.name = \"~alsa_output.*\" } ] "
+		"actions = { update-props = { a = 1 } } } ]";
+	int i;
+
+	/* compiled rules are reused */
+	for (i = 0; i < 3; i++)
+		pwtest_int_eq(match_rules(rules, &props), 1);
+
+	pwtest_int_eq(match_rules("[ { matches = [ { node.name = \"~bluez.*\" } ] "
+				"actions = { a = 1 } } ]", &props), 0);
+	pwtest_int_eq(match_rules("[ { matches = [ { node.name = \"!~bluez.*\" "
+				"media.class = Audio/Sink } ] actions = { a = 1 b = 2 } } ]", &props), 2);
+	pwtest_int_eq(match_rules("[ { matches = [ { bar = null } ] actions = { a = 1 } } ]", &props), 1);
+	pwtest_int_eq(match_rules("[ { matches = [ { foo = null } ] actions = { a = 1 } } ]", &props), 0);
+	pwtest_int_eq(match_rules("[ { matches = [ { foo = \"null\" } ] actions = { a = 1 } } ]", &props), 1);
+	pwtest_int_eq(match_rules("[ { matches = [ { foo = !null } ] actions = { a = 1 } } ]", &props), 1);
+	pwtest_int_eq(match_rules("[ { matches = [ { a = b } { media.class = Audio/Sink } ] "
+				"actions = { a = 1 } } ]", &props), 1);
+	pwtest_int_eq(match_rules("[ { matches = [ ] actions = { a = 1 } } ]", &props), 0);
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(context)
 {
 	pwtest_add(config_load_abspath, PWTEST_NOARG);
 	pwtest_add(config_load_nullname, PWTEST_NOARG);
+	pwtest_add(config_match_rules, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
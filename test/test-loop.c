@@ -435,6 +435,48 @@ PWTEST(cancel_thread_while_dispatching)
 	return PWTEST_PASS;
 }
 
+static void spin_event_func(void *data, uint64_t count)
+{
+	int *n_events = data;
+	(*n_events)++;
+}
+
+PWTEST(loop_spin_time)
+{
+	static const struct spa_dict_item loop_props_items[] = {
+		{ PW_KEY_LOOP_SPIN_TIME, "2000" },
+	};
+	static const struct spa_dict loop_props = SPA_DICT_INIT_ARRAY(loop_props_items);
+	struct pw_loop *l;
+	struct spa_source *source;
+	int n_events = 0;
+
+	pw_init(NULL, NULL);
+
+	l = pw_loop_new(&loop_props);
+	pwtest_ptr_notnull(l);
+
+	source = pw_loop_add_event(l, spin_event_func, &n_events);
+	pwtest_ptr_notnull(source);
+
+	pw_loop_enter(l);
+	/* nothing to do, the timeout must still be respected */
+	pwtest_int_eq(pw_loop_iterate(l, 10), 0);
+	pwtest_int_eq(n_events, 0);
+
+	pwtest_neg_errno_ok(pw_loop_signal_event(l, source));
+	pwtest_int_eq(pw_loop_iterate(l, -1), 1);
+	pwtest_int_eq(n_events, 1);
+	pw_loop_leave(l);
+
+	pw_loop_destroy_source(l, source);
+	pw_loop_destroy(l);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(support)
 {
 	pwtest_add(pwtest_loop_destroy2, PWTEST_NOARG);
@@ -443,6 +485,7 @@ PWTEST_SUITE(support)
 	pwtest_add(destroy_managed_source_before_dispatch, PWTEST_NOARG);
 	pwtest_add(destroy_managed_source_before_dispatch_recurse, PWTEST_NOARG);
 	pwtest_add(cancel_thread_while_dispatching, PWTEST_NOARG);
+	pwtest_add(loop_spin_time, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
@@ -210,6 +210,42 @@ PWTEST(map_insert_at_free)
 	return PWTEST_PASS;
 }
 
+struct grow_data {
+	struct pw_map *map;
+	int count;
+};
+
+static int grow_func(void *item_data, void *data)
+{
+	struct grow_data *d = data;
+
+	/* make the map storage move while iterating */
+	if (d->count++ == 0) {
+		int i;
+		for (i = 0; i < 64; i++)
+			pw_map_insert_new(d->map, item_data);
+	}
+	return 0;
+}
+
+PWTEST(map_for_each_grow)
+{
+	struct pw_map map = PW_MAP_INIT(2);
+	int data[2] = {1, 2};
+	struct grow_data d = { &map, 0 };
+
+	pw_map_insert_new(&map, &data[0]);
+	pw_map_insert_new(&map, &data[1]);
+
+	pwtest_int_eq(pw_map_for_each(&map, grow_func, &d), 0);
+	pwtest_int_eq(d.count, 66);
+	pwtest_int_eq(pw_map_get_size(&map), 66U);
+
+	pw_map_clear(&map);
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(pw_map)
 {
 	pwtest_add(map_add_remove, PWTEST_NOARG);
@@ -217,6 +253,7 @@ PWTEST_SUITE(pw_map)
 	pwtest_add(map_size, PWTEST_NOARG);
 	pwtest_add(map_double_remove, PWTEST_NOARG);
 	pwtest_add(map_insert_at_free, PWTEST_ARG_RANGE, 0, 63);
+	pwtest_add(map_for_each_grow, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
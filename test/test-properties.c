@@ -584,6 +584,53 @@ PWTEST(properties_update)
 	return PWTEST_PASS;
 }
 
+PWTEST(properties_many)
+{
+	struct pw_properties *props;
+	char key[64], value[64];
+	int i;
+
+	props = pw_properties_new(NULL, NULL);
+	pwtest_ptr_notnull(props);
+
+	for (i = 0; i < 200; i++) {
+		spa_scnprintf(key, sizeof(key), "key.%d", i);
+		spa_scnprintf(value, sizeof(value), "%d", i);
+		pwtest_int_eq(pw_properties_set(props, key, value), 1);
+	}
+	pwtest_int_eq(props->dict.n_items, 200U);
+
+	/* remove the odd keys, this moves items around */
+	for (i = 1; i < 200; i += 2) {
+		spa_scnprintf(key, sizeof(key), "key.%d", i);
+		pwtest_int_eq(pw_properties_set(props, key, NULL), 1);
+	}
+	pwtest_int_eq(props->dict.n_items, 100U);
+
+	for (i = 0; i < 200; i++) {
+		spa_scnprintf(key, sizeof(key), "key.%d", i);
+		spa_scnprintf(value, sizeof(value), "%d", i);
+		if (i & 1)
+			pwtest_ptr_null(pw_properties_get(props, key));
+		else
+			pwtest_str_eq(pw_properties_get(props, key), value);
+	}
+
+	/* sorting in place keeps lookups working */
+	spa_dict_qsort(&props->dict);
+	pwtest_str_eq(pw_properties_get(props, "key.42"), "42");
+	pwtest_int_eq(pw_properties_set(props, "key.42", NULL), 1);
+	pwtest_int_eq(pw_properties_set(props, "key.43", "43"), 1);
+	pwtest_ptr_null(pw_properties_get(props, "key.42"));
+	pwtest_str_eq(pw_properties_get(props, "key.43"), "43");
+	pwtest_str_eq(pw_properties_get(props, "key.198"), "198");
+	pwtest_int_eq(props->dict.n_items, 100U);
+
+	pw_properties_free(props);
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(properties)
 {
 	pwtest_add(properties_abi, PWTEST_NOARG);
@@ -603,6 +650,7 @@ PWTEST_SUITE(properties)
 	pwtest_add(properties_new_dict, PWTEST_NOARG);
 	pwtest_add(properties_new_json, PWTEST_NOARG);
 	pwtest_add(properties_update, PWTEST_NOARG);
+	pwtest_add(properties_many, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
@@ -4,6 +4,8 @@
 
 #include <spa/pod/pod.h>
 #include <spa/pod/builder.h>
+#include <spa/pod/dynamic.h>
+#include <spa/pod/filter.h>
 #include <spa/pod/command.h>
 #include <spa/pod/event.h>
 #include <spa/pod/iter.h>
@@ -1668,6 +1670,136 @@ PWTEST(pod_overflow2)
 	return PWTEST_PASS;
 }
 
+PWTEST(pod_dynamic)
+{
+	uint8_t buffer[64];
+	struct spa_pod_dynamic_builder b;
+	struct spa_pod_frame f;
+	struct spa_pod *pod;
+	void *data;
+	uint32_t i, n, size = 0;
+
+	spa_pod_dynamic_builder_init(&b, buffer, sizeof(buffer), 256);
+
+	for (n = 0; n < 4; n++) {
+		spa_pod_dynamic_builder_reset(&b);
+		spa_assert_se(b.b.state.offset == 0);
+
+		spa_pod_builder_push_struct(&b.b, &f);
+		for (i = 0; i < 1024; i++)
+			spa_pod_builder_int(&b.b, i);
+		pod = spa_pod_builder_pop(&b.b, &f);
+		spa_assert_se(pod != NULL);
+		spa_assert_se(b.b.data != buffer);
+		spa_assert_se(SPA_POD_BODY_SIZE(pod) == 1024 * 16);
+
+		i = 0;
+		SPA_POD_STRUCT_FOREACH(pod, data) {
+			int32_t val;
+			spa_assert_se(spa_pod_get_int(data, &val) == 0);
+			spa_assert_se(val == (int32_t)i++);
+		}
+		spa_assert_se(i == 1024);
+
+		/* memory is kept after the first round */
+		if (n == 0)
+			size = b.b.size;
+		spa_assert_se(b.b.size == size);
+	}
+	spa_pod_dynamic_builder_clean(&b);
+
+	return PWTEST_PASS;
+}
+
+static struct spa_pod *build_enum(struct spa_pod_builder *b, uint32_t type,
+		const void *vals, uint32_t n_vals, uint32_t size)
+{
+	struct spa_pod_frame f[2];
+	uint32_t i;
+
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, 0);
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_size, 0);
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+	for (i = 0; i < n_vals; i++) {
+		const void *v = SPA_PTROFF(vals, i * size, void);
+		if (type == SPA_TYPE_Int)
+			spa_pod_builder_int(b, *(int32_t*)v);
+		else
+			spa_pod_builder_rectangle(b, ((struct spa_rectangle*)v)->width,
+					((struct spa_rectangle*)v)->height);
+	}
+	spa_pod_builder_pop(b, &f[1]);
+	return spa_pod_builder_pop(b, &f[0]);
+}
+
+static void check_filter_enum(uint32_t type, uint32_t n1, uint32_t n2, uint32_t range)
+{
+	static uint8_t buffer[3][64 * 1024];
+	static struct spa_rectangle v1[256], v2[256], expect[256 * 256];
+	struct spa_pod_builder b;
+	struct spa_pod *p1, *p2, *res;
+	const struct spa_pod_prop *prop;
+	const struct spa_pod *val;
+	uint32_t i, j, size, n_expect = 0, n_vals, choice;
+	int r;
+
+	size = type == SPA_TYPE_Int ? sizeof(int32_t) : sizeof(struct spa_rectangle);
+
+	for (i = 0; i < n1; i++)
+		v1[i] = SPA_RECTANGLE(rand() % range, rand() % range);
+	for (i = 0; i < n2; i++)
+		v2[i] = SPA_RECTANGLE(rand() % range, rand() % range);
+
+	/* the first value is the default, the others are the alternatives */
+	for (i = 1; i < n1; i++) {
+		for (j = 1; j < n2; j++) {
+			if (memcmp(SPA_PTROFF(v1, i * size, void),
+				   SPA_PTROFF(v2, j * size, void), size) == 0)
+				memcpy(SPA_PTROFF(expect, n_expect++ * size, void),
+						SPA_PTROFF(v1, i * size, void), size);
+		}
+	}
+
+	spa_pod_builder_init(&b, buffer[0], sizeof(buffer[0]));
+	p1 = build_enum(&b, type, v1, n1, size);
+	spa_pod_builder_init(&b, buffer[1], sizeof(buffer[1]));
+	p2 = build_enum(&b, type, v2, n2, size);
+	spa_assert_se(p1 != NULL && p2 != NULL);
+
+	spa_pod_builder_init(&b, buffer[2], sizeof(buffer[2]));
+	r = spa_pod_filter(&b, &res, p1, p2);
+	if (n_expect == 0) {
+		spa_assert_se(r == -EINVAL);
+		return;
+	}
+	spa_assert_se(r == 0);
+
+	prop = spa_pod_find_prop(res, NULL, SPA_FORMAT_VIDEO_size);
+	spa_assert_se(prop != NULL);
+	val = spa_pod_get_values(&prop->value, &n_vals, &choice);
+	spa_assert_se(choice == SPA_CHOICE_Enum);
+	spa_assert_se(n_vals == n_expect + 1);
+	spa_assert_se(memcmp(SPA_PTROFF(SPA_POD_BODY_CONST(val), size, void),
+				expect, n_expect * size) == 0);
+}
+
+PWTEST(pod_filter_enum)
+{
+	static const uint32_t sizes[] = { 1, 2, 7, 8, 9, 31, 100, 256 };
+	uint32_t i, j;
+
+	srand(4);
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(sizes); j++) {
+			check_filter_enum(SPA_TYPE_Int, sizes[i], sizes[j], 16);
+			check_filter_enum(SPA_TYPE_Int, sizes[i], sizes[j], 1024);
+			check_filter_enum(SPA_TYPE_Rectangle, sizes[i], sizes[j], 4);
+			check_filter_enum(SPA_TYPE_Rectangle, sizes[i], sizes[j], 32);
+		}
+	}
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(spa_pod)
 {
 	pwtest_add(pod_abi_sizes, PWTEST_NOARG);
@@ -1682,6 +1814,8 @@ PWTEST_SUITE(spa_pod)
 	pwtest_add(pod_static, PWTEST_NOARG);
 	pwtest_add(pod_overflow, PWTEST_NOARG);
 	pwtest_add(pod_overflow2, PWTEST_NOARG);
+	pwtest_add(pod_dynamic, PWTEST_NOARG);
+	pwtest_add(pod_filter_enum, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
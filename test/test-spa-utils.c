@@ -78,6 +78,8 @@ PWTEST(utils_abi)
 
 	/* ringbuffer */
 	pwtest_int_eq(sizeof(struct spa_ringbuffer), 8U);
+	pwtest_int_eq(sizeof(struct spa_ringbuffer_padded), 2 * (size_t)SPA_RINGBUFFER_CACHELINE);
+	pwtest_int_eq(offsetof(struct spa_ringbuffer_padded, writeindex), (size_t)SPA_RINGBUFFER_CACHELINE);
 
 	/* type */
 	pwtest_int_eq(SPA_TYPE_START, 0);
@@ -417,6 +419,69 @@ PWTEST(utils_hook)
 	return PWTEST_PASS;
 }
 
+struct remove_data {
+	struct spa_hook hooks[3];
+	int calls[3];
+};
+
+static void test_hook_remove_0(void *data)
+{
+	struct remove_data *d = data;
+	d->calls[0]++;
+	/* remove ourselves and the next hook */
+	spa_hook_remove(&d->hooks[0]);
+	spa_hook_remove(&d->hooks[1]);
+}
+
+static void test_hook_remove_2(void *data)
+{
+	struct remove_data *d = data;
+	d->calls[2]++;
+}
+
+PWTEST(utils_hook_remove)
+{
+	struct spa_hook_list hl;
+	struct my_hook callbacks[3] = {
+		{2, test_hook_callback_4},
+		{2, test_hook_remove_0},
+		{2, test_hook_remove_2},
+	};
+	struct my_hook empty = { 2, NULL };
+	struct remove_data data = {0};
+	struct spa_hook skip;
+	int count;
+
+	spa_hook_list_init(&hl);
+
+	/* hooks without the method are skipped */
+	spa_zero(skip);
+	spa_hook_list_append(&hl, &skip, &empty, &data);
+	spa_hook_list_append(&hl, &data.hooks[0], &callbacks[1], &data);
+	spa_hook_list_append(&hl, &data.hooks[1], &callbacks[0], &data);
+	spa_hook_list_append(&hl, &data.hooks[2], &callbacks[2], &data);
+
+	/* the first callback removes itself and the next one */
+	count = spa_hook_list_call(&hl, struct my_hook, invoke, 2);
+	pwtest_int_eq(count, 2);
+	pwtest_int_eq(data.calls[0], 1);
+	pwtest_int_eq(data.calls[2], 1);
+
+	count = spa_hook_list_call(&hl, struct my_hook, invoke, 2);
+	pwtest_int_eq(count, 1);
+	pwtest_int_eq(data.calls[0], 1);
+	pwtest_int_eq(data.calls[2], 2);
+
+	spa_hook_remove(&data.hooks[2]);
+	spa_hook_remove(&skip);
+	pwtest_bool_true(spa_list_is_empty(&hl.list));
+
+	count = spa_hook_list_call(&hl, struct my_hook, invoke, 2);
+	pwtest_int_eq(count, 0);
+
+	return PWTEST_PASS;
+}
+
 PWTEST(utils_ringbuffer)
 {
 	struct spa_ringbuffer rb;
@@ -477,6 +542,70 @@ PWTEST(utils_ringbuffer)
 	return PWTEST_PASS;
 }
 
+PWTEST(utils_ringbuffer_padded)
+{
+	struct spa_ringbuffer_padded rb;
+	char buffer[20];
+	char readbuf[20];
+	uint32_t idx;
+	int32_t fill;
+
+	spa_ringbuffer_padded_init(&rb);
+	fill = spa_ringbuffer_padded_get_write_index(&rb, &idx, 20, 14);
+	pwtest_int_eq(idx, 0U);
+	pwtest_int_eq(fill, 0);
+
+	/* two writes, published with one update */
+	spa_ringbuffer_padded_write_data(&rb, buffer, 20, idx % 20, "hello ", 6);
+	spa_ringbuffer_padded_write_data(&rb, buffer, 20, (idx + 6) % 20, "pipewire", 8);
+	fill = spa_ringbuffer_padded_get_read_index(&rb, &idx, 1);
+	pwtest_int_eq(idx, 0U);
+	pwtest_int_eq(fill, 0);
+	spa_ringbuffer_padded_write_update(&rb, idx + 14);
+
+	/* the reader uses its copy of the write index while it has enough data */
+	fill = spa_ringbuffer_padded_get_read_index(&rb, &idx, 0);
+	pwtest_int_eq(idx, 0U);
+	pwtest_int_eq(fill, 0);
+	fill = spa_ringbuffer_padded_get_read_index(&rb, &idx, 6);
+	pwtest_int_eq(idx, 0U);
+	pwtest_int_eq(fill, 14);
+
+	spa_ringbuffer_padded_read_data(&rb, buffer, 20, idx % 20, readbuf, 6);
+	spa_ringbuffer_padded_read_update(&rb, idx + 6);
+	pwtest_int_eq(memcmp(readbuf, "hello ", 6), 0);
+
+	fill = spa_ringbuffer_padded_get_read_index(&rb, &idx, 6);
+	pwtest_int_eq(idx, 6U);
+	pwtest_int_eq(fill, 8);
+
+	/* the writer still sees the old read index while there is space */
+	fill = spa_ringbuffer_padded_get_write_index(&rb, &idx, 20, 6);
+	pwtest_int_eq(idx, 14U);
+	pwtest_int_eq(fill, 14);
+	fill = spa_ringbuffer_padded_get_write_index(&rb, &idx, 20, 10);
+	pwtest_int_eq(idx, 14U);
+	pwtest_int_eq(fill, 8);
+
+	spa_ringbuffer_padded_write_data(&rb, buffer, 20, idx % 20, " rocks !!!", 10);
+	spa_ringbuffer_padded_write_update(&rb, idx + 10);
+
+	fill = spa_ringbuffer_padded_get_read_index(&rb, &idx, 18);
+	pwtest_int_eq(idx, 6U);
+	pwtest_int_eq(fill, 18);
+
+	spa_ringbuffer_padded_read_data(&rb, buffer, 20, idx % 20, readbuf, 18);
+	spa_ringbuffer_padded_read_update(&rb, idx + 18);
+	pwtest_str_eq_n(readbuf, "pipewire rocks !!!", 18);
+
+	fill = spa_ringbuffer_padded_get_write_index(&rb, &idx, 20, 20);
+	pwtest_int_eq(idx, 24U);
+	pwtest_int_eq(fill, 0);
+
+	pwtest_str_eq_n(buffer, " !!!o pipewire rocks", 20);
+	return PWTEST_PASS;
+}
+
 PWTEST(utils_strtol)
 {
 	int32_t v = 0xabcd;
@@ -1009,7 +1138,9 @@ PWTEST_SUITE(spa_utils)
 	pwtest_add(utils_dict, PWTEST_NOARG);
 	pwtest_add(utils_list, PWTEST_NOARG);
 	pwtest_add(utils_hook, PWTEST_NOARG);
+	pwtest_add(utils_hook_remove, PWTEST_NOARG);
 	pwtest_add(utils_ringbuffer, PWTEST_NOARG);
+	pwtest_add(utils_ringbuffer_padded, PWTEST_NOARG);
 	pwtest_add(utils_strtol, PWTEST_NOARG);
 	pwtest_add(utils_strtoul, PWTEST_NOARG);
 	pwtest_add(utils_strtoll, PWTEST_NOARG);